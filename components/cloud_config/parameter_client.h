@@ -18,7 +18,9 @@
 #include <string_view>
 #include <vector>
 
+#include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/types/span.h"
 
 // TODO: Replace config cpio client once ready
 namespace kv_server {
@@ -45,6 +47,14 @@ class ParameterClient {
 
   virtual absl::StatusOr<bool> GetBoolParameter(
       std::string_view parameter_name) const = 0;
+
+  // Fetches `parameter_names` together, so that getting them afterwards does
+  // not wait for a request each. Parameters that fail to be prefetched are
+  // fetched on their own when they are got.
+  virtual absl::Status PrefetchParameters(
+      absl::Span<const std::string> parameter_names) const {
+    return absl::OkStatus();
+  }
 };
 }  // namespace kv_server
 
@@ -19,17 +19,23 @@
 #include <string>
 #include <string_view>
 #include <thread>
+#include <vector>
 
+#include "absl/container/flat_hash_map.h"
 #include "absl/log/log.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/numbers.h"
 #include "absl/strings/str_format.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/span.h"
 #include "aws/core/Aws.h"
 #include "aws/core/utils/Outcome.h"
 #include "aws/ssm/SSMClient.h"
 #include "aws/ssm/model/GetParameterRequest.h"
 #include "aws/ssm/model/GetParameterResult.h"
+#include "aws/ssm/model/GetParametersRequest.h"
+#include "aws/ssm/model/GetParametersResult.h"
 #include "components/cloud_config/parameter_client.h"
 #include "components/errors/error_util_aws.h"
 
@@ -41,6 +47,15 @@ class AwsParameterClient : public ParameterClient {
   absl::StatusOr<std::string> GetParameter(
       std::string_view parameter_name,
       std::optional<std::string> default_value = std::nullopt) const override {
+    {
+      absl::MutexLock lock(&mutex_);
+      if (auto iter = prefetched_.find(parameter_name);
+          iter != prefetched_.end()) {
+        LOG(INFO) << "Got prefetched parameter: " << parameter_name
+                  << " with value: " << iter->second;
+        return iter->second;
+      }
+    }
     LOG(INFO) << "Getting parameter: " << parameter_name;
     Aws::SSM::Model::GetParameterRequest request;
     request.SetName(std::string(parameter_name));
@@ -109,6 +124,41 @@ class AwsParameterClient : public ParameterClient {
     return parameter_bool;
   };
 
+  absl::Status PrefetchParameters(
+      absl::Span<const std::string> parameter_names) const override {
+    // https://docs.aws.amazon.com/systems-manager/latest/APIReference/API_GetParameters.html
+    // Requests are sent concurrently, with at most 10 names each.
+    std::vector<std::thread> threads;
+    absl::Status status;
+    for (size_t start = 0; start < parameter_names.size();
+         start += kMaxParametersPerRequest) {
+      threads.emplace_back([this, &status,
+                            names = parameter_names.subspan(
+                                start, kMaxParametersPerRequest)]() {
+        Aws::SSM::Model::GetParametersRequest request;
+        for (const std::string& name : names) {
+          request.AddNames(name);
+        }
+        const auto outcome = ssm_client_->GetParameters(request);
+        absl::MutexLock lock(&mutex_);
+        if (!outcome.IsSuccess()) {
+          LOG(WARNING) << "Unable to prefetch parameters with error: "
+                       << outcome.GetError();
+          status.Update(AwsErrorToStatus(outcome.GetError()));
+          return;
+        }
+        for (const auto& parameter : outcome.GetResult().GetParameters()) {
+          prefetched_.insert_or_assign(parameter.GetName(),
+                                       parameter.GetValue());
+        }
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    return status;
+  }
+
   explicit AwsParameterClient(ParameterClient::ClientOptions client_options)
       : client_options_(std::move(client_options)) {
     if (client_options.client_for_unit_testing_ != nullptr) {
@@ -120,8 +170,13 @@ class AwsParameterClient : public ParameterClient {
   }
 
  private:
+  static constexpr size_t kMaxParametersPerRequest = 10;
+
   ClientOptions client_options_;
   std::unique_ptr<Aws::SSM::SSMClient> ssm_client_;
+  mutable absl::Mutex mutex_;
+  mutable absl::flat_hash_map<std::string, std::string> prefetched_
+      ABSL_GUARDED_BY(mutex_);
 };
 
 }  // namespace
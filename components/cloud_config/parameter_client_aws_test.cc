@@ -14,10 +14,13 @@
 #include <memory>
 #include <string>
 #include <thread>
+#include <vector>
 
+#include "absl/strings/str_cat.h"
 #include "aws/ssm/SSMClient.h"
 #include "aws/ssm/SSMErrors.h"
 #include "aws/ssm/model/GetParameterRequest.h"
+#include "aws/ssm/model/GetParametersRequest.h"
 #include "components/cloud_config/parameter_client.h"
 #include "components/util/platform_initializer.h"
 #include "gmock/gmock.h"
@@ -34,6 +37,9 @@ class MockSsmClient : public ::Aws::SSM::SSMClient {
   MOCK_METHOD(Aws::SSM::Model::GetParameterOutcome, GetParameter,
               (const Aws::SSM::Model::GetParameterRequest& request),
               (const, override));
+  MOCK_METHOD(Aws::SSM::Model::GetParametersOutcome, GetParameters,
+              (const Aws::SSM::Model::GetParametersRequest& request),
+              (const, override));
 };
 
 class ParameterClientAwsTest : public ::testing::Test {
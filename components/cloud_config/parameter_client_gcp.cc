@@ -27,6 +27,8 @@
 #include "absl/strings/str_format.h"
 #include "absl/strings/string_view.h"
 #include "absl/synchronization/blocking_counter.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/span.h"
 #include "components/cloud_config/parameter_client.h"
 #include "src/public/core/interface/errors.h"
 #include "src/public/core/interface/execution_result.h"
@@ -73,6 +75,15 @@ class GcpParameterClient : public ParameterClient {
   absl::StatusOr<std::string> GetParameter(
       std::string_view parameter_name,
       std::optional<std::string> default_value = std::nullopt) const override {
+    {
+      absl::MutexLock lock(&mutex_);
+      if (auto iter = prefetched_.find(parameter_name);
+          iter != prefetched_.end()) {
+        LOG(INFO) << "Got prefetched parameter: " << parameter_name
+                  << " with value: " << iter->second;
+        return iter->second;
+      }
+    }
     LOG(INFO) << "Getting parameter: " << parameter_name;
     GetParameterRequest get_parameter_request;
     get_parameter_request.set_parameter_name(parameter_name);
@@ -150,8 +161,48 @@ class GcpParameterClient : public ParameterClient {
     return parameter_bool;
   }
 
+  absl::Status PrefetchParameters(
+      absl::Span<const std::string> parameter_names) const override {
+    // All the requests are sent before waiting for their responses.
+    absl::BlockingCounter counter(parameter_names.size());
+    int num_failed = 0;
+    for (const std::string& parameter_name : parameter_names) {
+      GetParameterRequest get_parameter_request;
+      get_parameter_request.set_parameter_name(parameter_name);
+      parameter_client_->GetParameter(
+          std::move(get_parameter_request),
+          [this, &parameter_name, &num_failed, &counter](
+              const ExecutionResult result, GetParameterResponse response) {
+            {
+              absl::MutexLock lock(&mutex_);
+              if (result.Successful()) {
+                // GCP secret manager does not support empty string natively.
+                prefetched_.insert_or_assign(
+                    parameter_name,
+                    response.parameter_value() != "EMPTY_STRING"
+                        ? response.parameter_value()
+                        : "");
+              } else {
+                num_failed++;
+              }
+            }
+            counter.DecrementCount();
+          });
+    }
+    counter.Wait();
+    if (num_failed > 0) {
+      return absl::UnavailableError(absl::StrFormat(
+          "Failed to prefetch %d of %d parameters.", num_failed,
+          parameter_names.size()));
+    }
+    return absl::OkStatus();
+  }
+
  private:
   std::unique_ptr<ParameterClientInterface> parameter_client_;
+  mutable absl::Mutex mutex_;
+  mutable absl::flat_hash_map<std::string, std::string> prefetched_
+      ABSL_GUARDED_BY(mutex_);
 };
 
 }  // namespace
@@ -143,5 +143,18 @@ TEST_F(ParameterClientGcpTest, GetInt32ParameterInvalidReturn) {
   EXPECT_FALSE(int32_param.ok());
 }
 
+TEST_F(ParameterClientGcpTest, PrefetchParametersSuccess) {
+  const std::vector<std::string> parameter_names = {"int32_test_flag",
+                                                    "empty_string_flag"};
+  EXPECT_TRUE(gcp_parameter_client_->PrefetchParameters(parameter_names).ok());
+  auto int32_param =
+      gcp_parameter_client_->GetInt32Parameter("int32_test_flag");
+  EXPECT_TRUE(int32_param.ok());
+  EXPECT_EQ(int32_param.value(), 2023);
+  auto string_param = gcp_parameter_client_->GetParameter("empty_string_flag");
+  EXPECT_TRUE(string_param.ok());
+  EXPECT_TRUE(string_param.value().empty());
+}
+
 }  // namespace
 }  // namespace kv_server
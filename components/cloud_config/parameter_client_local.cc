@@ -65,8 +65,269 @@ ABSL_FLAG(std::string, telemetry_config, "mode: EXPERIMENT",
           "Telemetry configuration for exporting raw or noised metrics");
 ABSL_FLAG(std::string, data_loading_prefix_allowlist, "",
           "Allowlist for blob prefixes.");
+ABSL_FLAG(std::string, data_loading_priority_prefixes, "",
+          "Comma separated allowlisted prefixes loaded first on startup, one "
+          "after the other, before the other prefixes.");
 ABSL_FLAG(bool, add_missing_keys_v1, false,
           "Whether to add missing keys for v1.");
+ABSL_FLAG(int32_t, cache_num_segments, 1,
+          "Number of independently locked segments in the key value cache. "
+          "Values greater than 1 enable the sharded cache.");
+ABSL_FLAG(bool, use_epoch_based_cache, false,
+          "Whether key-value lookups use the epoch based lock free cache.");
+ABSL_FLAG(bool, cache_intern_set_values, false,
+          "Whether the cache interns set values and runs queries on ids.");
+ABSL_FLAG(bool, cache_precompute_json_values, false,
+          "Whether the cache parses values as JSON once when they are loaded, "
+          "so that V1 lookups do not parse them on every request.");
+ABSL_FLAG(bool, cache_compress_values, false,
+          "Whether the cache stores values compressed with zstd, with a "
+          "dictionary per prefix trained on its first loaded values.");
+ABSL_FLAG(bool, cache_deduplicate_values, false,
+          "Whether the cache stores identical values of different keys once.");
+ABSL_FLAG(bool, cache_isolate_prefixes, false,
+          "Whether the cache keeps the data of every prefix in a sub-cache of "
+          "its own, so that loading or cleaning up one data source does not "
+          "block the others.");
+ABSL_FLAG(bool, cache_index_set_values, false,
+          "Whether the cache keeps an index from every value of the key-value "
+          "sets to the keys whose sets hold it, for getKeysContaining.");
+ABSL_FLAG(bool, cache_index_keys, false,
+          "Whether the cache keeps its keys in order, for getValuesByPrefix.");
+ABSL_FLAG(std::string, cache_cold_value_directory, "",
+          "Directory that the cache spills the values looked up the least "
+          "into. Empty keeps all values in memory.");
+ABSL_FLAG(int32_t, cache_max_hot_value_mb, 1024,
+          "Megabytes of values that the cache keeps in memory when it spills "
+          "values to disk.");
+ABSL_FLAG(int32_t, cache_hot_key_sample_rate, 0,
+          "Samples one in this many lookups of the cache to find the keys "
+          "looked up the most. 0 disables the sampling.");
+ABSL_FLAG(bool, v1_direct_serialization, false,
+          "Whether V1 responses are serialized directly from the cache "
+          "values instead of being built as protos.");
+ABSL_FLAG(int32_t, lookup_hedge_percentile, 0,
+          "Percentile of recent remote lookup latencies after which a shard "
+          "lookup is also sent to another replica. 0 disables hedging.");
+ABSL_FLAG(bool, lookup_skip_empty_shards, false,
+          "Whether shards that none of the keys of a lookup map to are not "
+          "sent a request. Reveals which shards the keys map to.");
+ABSL_FLAG(int32_t, lookup_padding_bucket, 0,
+          "If positive, requests to remote shards are padded to a multiple of "
+          "this many bytes.");
+ABSL_FLAG(bool, lookup_query_pushdown, false,
+          "Whether the parts of a query whose sets are all on one shard are "
+          "run on that shard.");
+ABSL_FLAG(bool, lookup_plan_queries_with_set_sizes, false,
+          "Whether sharded queries first look up the sizes of their sets, "
+          "which order the evaluation and skip fetching sets that cannot "
+          "change the result.");
+ABSL_FLAG(bool, push_delta_notifications, false,
+          "Whether new delta files are loaded as they are notified, and only "
+          "listed every backup poll to find lost notifications.");
+ABSL_FLAG(int32_t, data_loading_concurrency, 1,
+          "Number of data files loaded at the same time when initializing the "
+          "cache.");
+ABSL_FLAG(int32_t, lookup_channels_per_replica, 1,
+          "Number of gRPC channels, each with its own connection, from this "
+          "server to each replica of the other shards.");
+ABSL_FLAG(int32_t, lookup_keepalive_ms, 0,
+          "Interval in milliseconds of the keepalive pings of the connections "
+          "between shards. 0 disables keepalive pings.");
+ABSL_FLAG(int32_t, blob_read_ahead_chunks, 0,
+          "Number of ranges of data files read ahead, concurrently, of the one "
+          "being loaded. 0 disables reading ahead.");
+ABSL_FLAG(std::string, blob_cache_directory, "",
+          "Directory in which data files are cached across restarts. Empty "
+          "disables the cache.");
+ABSL_FLAG(int32_t, blob_cache_max_size_mb, 0,
+          "If positive, maximum size in MB of the cached data files.");
+ABSL_FLAG(int32_t, reader_shards_per_thread, 1,
+          "Number of shards data files are split into per data loading "
+          "thread. Threads that finish their shards early read the remaining "
+          "ones, so more shards keep threads busy on files with slow "
+          "ranges.");
+ABSL_FLAG(std::string, cache_checkpoint_file, "",
+          "File to which the cache is checkpointed and from which it is "
+          "restored on startup. Empty disables checkpoints.");
+ABSL_FLAG(std::string, sharding_replicated_keys, "",
+          "Comma separated keys that every shard loads and looks up locally, "
+          "for keys requested by nearly every request.");
+ABSL_FLAG(int32_t, cache_checkpoint_mins, 10,
+          "Minimum number of minutes between cache checkpoints.");
+ABSL_FLAG(int32_t, cache_cleanup_millis, 0,
+          "Interval between removals of deleted keys from the cache on a "
+          "background thread. 0 removes them after loading every file.");
+ABSL_FLAG(int32_t, cache_cleanup_pause_ms, 1,
+          "Maximum time the background removal of deleted keys locks a map "
+          "of the cache at once.");
+ABSL_FLAG(int32_t, snapshot_reload_mins, 0,
+          "If positive, checks for new snapshot files every this many minutes "
+          "and reloads the cache from them into a new cache that replaces the "
+          "current one once loaded. 0 only loads snapshot files on startup.");
+ABSL_FLAG(int32_t, readiness_max_lag_secs, 0,
+          "If positive, the server is only ready once initialized and the "
+          "delta files of every prefix available on startup are loaded, and "
+          "no file waits to be loaded for longer than this many seconds. 0 "
+          "makes it ready once initialized.");
+ABSL_FLAG(int32_t, realtime_coalesce_millis, 0,
+          "Window in which realtime updates are coalesced, keeping the latest "
+          "update of every key, before being applied together. 0 applies "
+          "every update as it arrives.");
+ABSL_FLAG(int32_t, delta_prefetch_max_mb, 0,
+          "If positive, the next queued delta file is downloaded while the "
+          "current one is loaded, unless it is larger than this many MB.");
+ABSL_FLAG(int32_t, udf_warm_up_invocations, 0,
+          "Number of times every UDF worker runs new UDF code before requests "
+          "use it.");
+ABSL_FLAG(int32_t, response_brotli_quality, 11,
+          "Brotli quality of compressed V2 responses, from 0 to 11.");
+ABSL_FLAG(int32_t, response_brotli_window, 22,
+          "Base 2 logarithm of the Brotli window size of compressed V2 "
+          "responses, from 10 to 24.");
+ABSL_FLAG(int32_t, grpc_max_concurrent_streams, 0,
+          "If positive, maximum number of concurrent streams of every "
+          "connection to the gRPC server.");
+ABSL_FLAG(int32_t, grpc_max_threads_per_core, 0,
+          "If positive, maximum number of threads of the gRPC server per CPU "
+          "core.");
+ABSL_FLAG(int32_t, grpc_memory_quota_mb, 0,
+          "If positive, maximum memory in MB that the gRPC server uses for "
+          "its connections and calls.");
+ABSL_FLAG(std::string, serving_cpus, "",
+          "CPUs of the threads that serve requests, e.g. \"0-15,32-47\". "
+          "Empty runs them on any CPU.");
+ABSL_FLAG(std::string, serving_memory_policy, "",
+          "NUMA policy of the memory of the threads that serve requests, "
+          "\"local\" or \"interleave\". Empty is \"local\".");
+ABSL_FLAG(std::string, data_loading_cpus, "",
+          "CPUs of the threads that load data into the cache, e.g. "
+          "\"16-31,48-63\". Empty runs them on the serving CPUs.");
+ABSL_FLAG(std::string, data_loading_memory_policy, "",
+          "NUMA policy of the memory of the threads that load data into the "
+          "cache, and so of the cache, \"local\" or \"interleave\". Empty "
+          "is \"local\".");
+ABSL_FLAG(int32_t, admission_max_in_flight, 0,
+          "Maximum number of requests in flight before requests are shed. 0 "
+          "disables load shedding.");
+ABSL_FLAG(int32_t, admission_critical_reserve_percent, 20,
+          "Percentage of admission-max-in-flight reserved to requests with "
+          "the critical priority hint.");
+ABSL_FLAG(int32_t, admission_latency_target_ms, 0,
+          "Average request latency in milliseconds above which requests "
+          "without the critical priority hint are shed earlier. 0 disables "
+          "the latency signal.");
+ABSL_FLAG(int32_t, lookup_batch_window_micros, 0,
+          "Time in microseconds the lookup server of a shard waits to merge "
+          "concurrent lookups into one cache lookup. 0 disables batching.");
+ABSL_FLAG(int32_t, lookup_batch_max_keys, 1000,
+          "Number of keys at which a batch of lookups on the lookup server of "
+          "a shard is looked up before the end of its window.");
+ABSL_FLAG(int32_t, lookup_key_filter_interval_ms, 0,
+          "Interval in milliseconds at which each shard rebuilds the Bloom "
+          "filter of its keys, and the other shards fetch it to skip lookups "
+          "of keys that the shard does not have. 0 disables key filters. Only "
+          "used when sharded.");
+ABSL_FLAG(int32_t, lookup_key_filter_bits_per_key, 10,
+          "Bits per key of the shard key filters. More bits lower the false "
+          "positive rate at the cost of memory and transfer size. Only used "
+          "when sharded.");
+ABSL_FLAG(int32_t, lookup_cache_max_entries, 0,
+          "Maximum number of keys whose sharded lookup results are cached for "
+          "the UDF hooks. 0 disables the lookup cache. Only used when "
+          "sharded.");
+ABSL_FLAG(int32_t, lookup_cache_ttl_ms, 1000,
+          "Time in milliseconds for which a cached sharded lookup result is "
+          "served, unless a mutation of its key is loaded first. Only used "
+          "when sharded.");
+ABSL_FLAG(int32_t, query_evaluation_threads, 0,
+          "Number of threads that evaluate the independent operands of large "
+          "set queries in parallel. 0 evaluates queries on the request thread "
+          "only.");
+ABSL_FLAG(int32_t, lookup_response_compression_min_bytes, 0,
+          "Minimum size in bytes of the responses of remote shards that they "
+          "compress with zstd, which trades their CPU for network bandwidth "
+          "on large key sets. 0 disables compression.");
+ABSL_FLAG(bool, v1_merge_namespace_lookups, false,
+          "Whether the V1 API looks up the keys of all the namespaces of a "
+          "request at once, with one cache lookup, rather than one lookup per "
+          "namespace. The namespaces of large requests are then processed "
+          "concurrently on the query evaluation threads, if any.");
+ABSL_FLAG(int32_t, udf_batch_window_us, 0,
+          "How long, in microseconds, a UDF execution waits for concurrent "
+          "executions of the same code object to run together in one "
+          "invocation of its batch handler. Only applies to code objects with "
+          "a batch handler. 0 disables batching.");
+ABSL_FLAG(int32_t, udf_max_batch_size, 16,
+          "Most UDF executions that run together in one invocation of the "
+          "batch handler.");
+ABSL_FLAG(int32_t, udf_cache_max_mb, 0,
+          "Most megabytes of values that UDFs keep in the cache of the "
+          "cacheGet and cachePut functions. 0 disables the cache.");
+ABSL_FLAG(bool, load_compacted_delta_files, false,
+          "Whether to load the compacted delta files written by data_cli "
+          "compact_deltas in place of the delta files they include.");
+ABSL_FLAG(int32_t, data_loading_apply_threads, 0,
+          "Number of threads that apply the batches of records read from a "
+          "data file to the cache, while the data-loading-num-threads threads "
+          "keep reading and decompressing the file. If 0, records are applied "
+          "on the reading threads.");
+ABSL_FLAG(bool, download_snapshot_files, false,
+          "Whether snapshot files are downloaded into memory with parallel "
+          "range reads before they are loaded, rather than streamed.");
+ABSL_FLAG(bool, bulk_load_snapshots, false,
+          "Whether snapshot files loaded into an empty cache are staged and "
+          "the cache is built from them at once, rather than applying their "
+          "records one by one. Takes memory for a copy of the records while "
+          "the cache is built.");
+ABSL_FLAG(int32_t, heap_allocator_max_per_cpu_cache_bytes, 0,
+          "Maximum bytes of free memory the heap allocator caches for every "
+          "CPU. Smaller caches make memory freed by some threads available to "
+          "the others. 0 keeps the allocator default.");
+ABSL_FLAG(bool, release_heap_memory_after_loading, false,
+          "Whether to return the free heap memory to the OS after the initial "
+          "data load and after every snapshot reload, so that the resident "
+          "memory drops back from its peak while loading.");
+ABSL_FLAG(bool, cache_use_huge_pages, false,
+          "Whether the slabs that the cache stores keys and values in are "
+          "backed by transparent huge pages, which saves TLB misses on "
+          "lookups in large caches.");
+ABSL_FLAG(int32_t, response_cache_max_entries, 0,
+          "Most responses to V2 requests cached and served to identical "
+          "requests, evicting the least recently used. Zero disables the "
+          "response cache.");
+ABSL_FLAG(int32_t, response_cache_ttl_ms, 1000,
+          "Milliseconds a cached response to a V2 request is served for. "
+          "Responses are also dropped when data is loaded.");
+ABSL_FLAG(bool, use_siphash_sharding, false,
+          "Whether keys are sharded with SipHash instead of SHA-256, which is "
+          "several times faster but assigns keys to different shards. Data "
+          "files written for a shard must be sharded the same way. Only used "
+          "when sharded.");
+ABSL_FLAG(int32_t, num_logical_shards, 0,
+          "Number of logical shards that keys are hashed into and that are "
+          "mapped to the num_shards physical shards, so that changing "
+          "num_shards only moves whole logical shards. 0 hashes keys into the "
+          "physical shards directly. Only used if num_shards is greater than "
+          "1.");
+ABSL_FLAG(bool, trust_data_file_records, false,
+          "If true, records of snapshot and delta files are decoded without "
+          "verifying their flatbuffers, relying on the chunk hashes of the "
+          "files.");
+ABSL_FLAG(bool, use_data_file_manifest, false,
+          "If true, data files are listed from the DATA_FILE_MANIFEST file of "
+          "their directory, if any, and only the files named after it are "
+          "listed from blob storage.");
+ABSL_FLAG(int32_t, data_loading_max_records_per_second, 0,
+          "If positive, maximum number of records of new data files loaded "
+          "per second. Files of the initial load and realtime updates are not "
+          "throttled.");
+ABSL_FLAG(int32_t, data_loading_min_records_per_second, 0,
+          "Number of records of new data files loaded per second however high "
+          "the serving latency is.");
+ABSL_FLAG(int32_t, data_loading_latency_target_ms, 0,
+          "If positive, the loading rate of new data files halves whenever "
+          "the average serving latency exceeds this many milliseconds.");
 
 namespace kv_server {
 namespace {
@@ -95,6 +356,28 @@ class LocalParameterClient : public ParameterClient {
     string_flag_values_.insert(
         {"kv-server-local-data-loading-blob-prefix-allowlist",
          absl::GetFlag(FLAGS_data_loading_prefix_allowlist)});
+    string_flag_values_.insert(
+        {"kv-server-local-data-loading-priority-prefixes",
+         absl::GetFlag(FLAGS_data_loading_priority_prefixes)});
+    string_flag_values_.insert({"kv-server-local-blob-cache-directory",
+                                absl::GetFlag(FLAGS_blob_cache_directory)});
+    string_flag_values_.insert(
+        {"kv-server-local-cache-cold-value-directory",
+         absl::GetFlag(FLAGS_cache_cold_value_directory)});
+    string_flag_values_.insert({"kv-server-local-cache-checkpoint-file",
+                                absl::GetFlag(FLAGS_cache_checkpoint_file)});
+    string_flag_values_.insert(
+        {"kv-server-local-sharding-replicated-keys",
+         absl::GetFlag(FLAGS_sharding_replicated_keys)});
+    string_flag_values_.insert({"kv-server-local-serving-cpus",
+                                absl::GetFlag(FLAGS_serving_cpus)});
+    string_flag_values_.insert({"kv-server-local-serving-memory-policy",
+                                absl::GetFlag(FLAGS_serving_memory_policy)});
+    string_flag_values_.insert({"kv-server-local-data-loading-cpus",
+                                absl::GetFlag(FLAGS_data_loading_cpus)});
+    string_flag_values_.insert(
+        {"kv-server-local-data-loading-memory-policy",
+         absl::GetFlag(FLAGS_data_loading_memory_policy)});
     // Insert more string flag values here.
 
     int32_t_flag_values_.insert(
@@ -129,17 +412,189 @@ class LocalParameterClient : public ParameterClient {
          absl::ToInt64Milliseconds(absl::GetFlag(FLAGS_udf_timeout))});
     int32_t_flag_values_.insert({"kv-server-local-udf-min-log-level",
                                  absl::GetFlag(FLAGS_udf_min_log_level)});
+    int32_t_flag_values_.insert({"kv-server-local-cache-num-segments",
+                                 absl::GetFlag(FLAGS_cache_num_segments)});
+    int32_t_flag_values_.insert({"kv-server-local-lookup-hedge-percentile",
+                                 absl::GetFlag(FLAGS_lookup_hedge_percentile)});
+    int32_t_flag_values_.insert({"kv-server-local-lookup-padding-bucket",
+                                 absl::GetFlag(FLAGS_lookup_padding_bucket)});
+    int32_t_flag_values_.insert(
+        {"kv-server-local-data-loading-concurrency",
+         absl::GetFlag(FLAGS_data_loading_concurrency)});
+    int32_t_flag_values_.insert(
+        {"kv-server-local-lookup-channels-per-replica",
+         absl::GetFlag(FLAGS_lookup_channels_per_replica)});
+    int32_t_flag_values_.insert({"kv-server-local-lookup-keepalive-ms",
+                                 absl::GetFlag(FLAGS_lookup_keepalive_ms)});
+    int32_t_flag_values_.insert({"kv-server-local-blob-read-ahead-chunks",
+                                 absl::GetFlag(FLAGS_blob_read_ahead_chunks)});
+    int32_t_flag_values_.insert({"kv-server-local-blob-cache-max-size-mb",
+                                 absl::GetFlag(FLAGS_blob_cache_max_size_mb)});
+    int32_t_flag_values_.insert({"kv-server-local-cache-max-hot-value-mb",
+                                 absl::GetFlag(FLAGS_cache_max_hot_value_mb)});
+    int32_t_flag_values_.insert(
+        {"kv-server-local-cache-hot-key-sample-rate",
+         absl::GetFlag(FLAGS_cache_hot_key_sample_rate)});
+    int32_t_flag_values_.insert({"kv-server-local-cache-checkpoint-mins",
+                                 absl::GetFlag(FLAGS_cache_checkpoint_mins)});
+    int32_t_flag_values_.insert(
+        {"kv-server-local-reader-shards-per-thread",
+         absl::GetFlag(FLAGS_reader_shards_per_thread)});
+    int32_t_flag_values_.insert({"kv-server-local-cache-cleanup-millis",
+                                 absl::GetFlag(FLAGS_cache_cleanup_millis)});
+    int32_t_flag_values_.insert(
+        {"kv-server-local-cache-cleanup-pause-ms",
+         absl::GetFlag(FLAGS_cache_cleanup_pause_ms)});
+    int32_t_flag_values_.insert({"kv-server-local-snapshot-reload-mins",
+                                 absl::GetFlag(FLAGS_snapshot_reload_mins)});
+    int32_t_flag_values_.insert(
+        {"kv-server-local-readiness-max-lag-secs",
+         absl::GetFlag(FLAGS_readiness_max_lag_secs)});
+    int32_t_flag_values_.insert(
+        {"kv-server-local-realtime-coalesce-millis",
+         absl::GetFlag(FLAGS_realtime_coalesce_millis)});
+    int32_t_flag_values_.insert({"kv-server-local-delta-prefetch-max-mb",
+                                 absl::GetFlag(FLAGS_delta_prefetch_max_mb)});
+    int32_t_flag_values_.insert(
+        {"kv-server-local-udf-warm-up-invocations",
+         absl::GetFlag(FLAGS_udf_warm_up_invocations)});
+    int32_t_flag_values_.insert({"kv-server-local-response-brotli-quality",
+                                 absl::GetFlag(FLAGS_response_brotli_quality)});
+    int32_t_flag_values_.insert({"kv-server-local-response-brotli-window",
+                                 absl::GetFlag(FLAGS_response_brotli_window)});
+    int32_t_flag_values_.insert(
+        {"kv-server-local-grpc-max-concurrent-streams",
+         absl::GetFlag(FLAGS_grpc_max_concurrent_streams)});
+    int32_t_flag_values_.insert(
+        {"kv-server-local-grpc-max-threads-per-core",
+         absl::GetFlag(FLAGS_grpc_max_threads_per_core)});
+    int32_t_flag_values_.insert({"kv-server-local-grpc-memory-quota-mb",
+                                 absl::GetFlag(FLAGS_grpc_memory_quota_mb)});
+    int32_t_flag_values_.insert({"kv-server-local-admission-max-in-flight",
+                                 absl::GetFlag(FLAGS_admission_max_in_flight)});
+    int32_t_flag_values_.insert(
+        {"kv-server-local-admission-critical-reserve-percent",
+         absl::GetFlag(FLAGS_admission_critical_reserve_percent)});
+    int32_t_flag_values_.insert(
+        {"kv-server-local-admission-latency-target-ms",
+         absl::GetFlag(FLAGS_admission_latency_target_ms)});
+    int32_t_flag_values_.insert(
+        {"kv-server-local-lookup-batch-window-micros",
+         absl::GetFlag(FLAGS_lookup_batch_window_micros)});
+    int32_t_flag_values_.insert({"kv-server-local-lookup-batch-max-keys",
+                                 absl::GetFlag(FLAGS_lookup_batch_max_keys)});
+    int32_t_flag_values_.insert(
+        {"kv-server-local-lookup-key-filter-interval-ms",
+         absl::GetFlag(FLAGS_lookup_key_filter_interval_ms)});
+    int32_t_flag_values_.insert(
+        {"kv-server-local-lookup-key-filter-bits-per-key",
+         absl::GetFlag(FLAGS_lookup_key_filter_bits_per_key)});
+    int32_t_flag_values_.insert(
+        {"kv-server-local-lookup-cache-max-entries",
+         absl::GetFlag(FLAGS_lookup_cache_max_entries)});
+    int32_t_flag_values_.insert({"kv-server-local-lookup-cache-ttl-ms",
+                                 absl::GetFlag(FLAGS_lookup_cache_ttl_ms)});
+    int32_t_flag_values_.insert(
+        {"kv-server-local-query-evaluation-threads",
+         absl::GetFlag(FLAGS_query_evaluation_threads)});
+    int32_t_flag_values_.insert(
+        {"kv-server-local-lookup-response-compression-min-bytes",
+         absl::GetFlag(FLAGS_lookup_response_compression_min_bytes)});
+    bool_flag_values_.insert(
+        {"kv-server-local-v1-merge-namespace-lookups",
+         absl::GetFlag(FLAGS_v1_merge_namespace_lookups)});
+    int32_t_flag_values_.insert(
+        {"kv-server-local-udf-batch-window-us",
+         absl::GetFlag(FLAGS_udf_batch_window_us)});
+    int32_t_flag_values_.insert(
+        {"kv-server-local-udf-max-batch-size",
+         absl::GetFlag(FLAGS_udf_max_batch_size)});
+    int32_t_flag_values_.insert(
+        {"kv-server-local-udf-cache-max-mb",
+         absl::GetFlag(FLAGS_udf_cache_max_mb)});
+    bool_flag_values_.insert(
+        {"kv-server-local-load-compacted-delta-files",
+         absl::GetFlag(FLAGS_load_compacted_delta_files)});
+    int32_t_flag_values_.insert(
+        {"kv-server-local-data-loading-apply-threads",
+         absl::GetFlag(FLAGS_data_loading_apply_threads)});
+    bool_flag_values_.insert(
+        {"kv-server-local-download-snapshot-files",
+         absl::GetFlag(FLAGS_download_snapshot_files)});
+    bool_flag_values_.insert({"kv-server-local-bulk-load-snapshots",
+                              absl::GetFlag(FLAGS_bulk_load_snapshots)});
+    int32_t_flag_values_.insert(
+        {"kv-server-local-heap-allocator-max-per-cpu-cache-bytes",
+         absl::GetFlag(FLAGS_heap_allocator_max_per_cpu_cache_bytes)});
+    bool_flag_values_.insert(
+        {"kv-server-local-release-heap-memory-after-loading",
+         absl::GetFlag(FLAGS_release_heap_memory_after_loading)});
+    bool_flag_values_.insert(
+        {"kv-server-local-cache-use-huge-pages",
+         absl::GetFlag(FLAGS_cache_use_huge_pages)});
+    int32_t_flag_values_.insert(
+        {"kv-server-local-response-cache-max-entries",
+         absl::GetFlag(FLAGS_response_cache_max_entries)});
+    int32_t_flag_values_.insert(
+        {"kv-server-local-response-cache-ttl-ms",
+         absl::GetFlag(FLAGS_response_cache_ttl_ms)});
+    int32_t_flag_values_.insert({"kv-server-local-num-logical-shards",
+                                 absl::GetFlag(FLAGS_num_logical_shards)});
+    int32_t_flag_values_.insert(
+        {"kv-server-local-data-loading-max-records-per-second",
+         absl::GetFlag(FLAGS_data_loading_max_records_per_second)});
+    int32_t_flag_values_.insert(
+        {"kv-server-local-data-loading-min-records-per-second",
+         absl::GetFlag(FLAGS_data_loading_min_records_per_second)});
+    int32_t_flag_values_.insert(
+        {"kv-server-local-data-loading-latency-target-ms",
+         absl::GetFlag(FLAGS_data_loading_latency_target_ms)});
     // Insert more int32 flag values here.
     bool_flag_values_.insert({"kv-server-local-route-v1-to-v2",
                               absl::GetFlag(FLAGS_route_v1_to_v2)});
     bool_flag_values_.insert({"kv-server-local-add-missing-keys-v1",
                               absl::GetFlag(FLAGS_add_missing_keys_v1)});
+    bool_flag_values_.insert({"kv-server-local-use-epoch-based-cache",
+                              absl::GetFlag(FLAGS_use_epoch_based_cache)});
+    bool_flag_values_.insert({"kv-server-local-cache-intern-set-values",
+                              absl::GetFlag(FLAGS_cache_intern_set_values)});
+    bool_flag_values_.insert(
+        {"kv-server-local-cache-precompute-json-values",
+         absl::GetFlag(FLAGS_cache_precompute_json_values)});
+    bool_flag_values_.insert({"kv-server-local-cache-compress-values",
+                              absl::GetFlag(FLAGS_cache_compress_values)});
+    bool_flag_values_.insert({"kv-server-local-cache-deduplicate-values",
+                              absl::GetFlag(FLAGS_cache_deduplicate_values)});
+    bool_flag_values_.insert({"kv-server-local-cache-isolate-prefixes",
+                              absl::GetFlag(FLAGS_cache_isolate_prefixes)});
+    bool_flag_values_.insert({"kv-server-local-cache-index-set-values",
+                              absl::GetFlag(FLAGS_cache_index_set_values)});
+    bool_flag_values_.insert({"kv-server-local-cache-index-keys",
+                              absl::GetFlag(FLAGS_cache_index_keys)});
+    bool_flag_values_.insert({"kv-server-local-v1-direct-serialization",
+                              absl::GetFlag(FLAGS_v1_direct_serialization)});
+    bool_flag_values_.insert({"kv-server-local-lookup-skip-empty-shards",
+                              absl::GetFlag(FLAGS_lookup_skip_empty_shards)});
+    bool_flag_values_.insert({"kv-server-local-lookup-query-pushdown",
+                              absl::GetFlag(FLAGS_lookup_query_pushdown)});
+    bool_flag_values_.insert(
+        {"kv-server-local-lookup-plan-queries-with-set-sizes",
+         absl::GetFlag(FLAGS_lookup_plan_queries_with_set_sizes)});
+    bool_flag_values_.insert(
+        {"kv-server-local-push-delta-notifications",
+         absl::GetFlag(FLAGS_push_delta_notifications)});
     bool_flag_values_.insert({"kv-server-local-use-real-coordinators", false});
     bool_flag_values_.insert(
         {"kv-server-local-use-external-metrics-collector-endpoint", false});
     bool_flag_values_.insert({"kv-server-local-use-sharding-key-regex", false});
     bool_flag_values_.insert({"kv-server-local-enable-otel-logger",
                               absl::GetFlag(FLAGS_enable_otel_logger)});
+    bool_flag_values_.insert({"kv-server-local-use-siphash-sharding",
+                              absl::GetFlag(FLAGS_use_siphash_sharding)});
+    bool_flag_values_.insert({"kv-server-local-trust-data-file-records",
+                              absl::GetFlag(FLAGS_trust_data_file_records)});
+    bool_flag_values_.insert({"kv-server-local-use-data-file-manifest",
+                              absl::GetFlag(FLAGS_use_data_file_manifest)});
     // Insert more bool flag values here.
   }
 
@@ -110,6 +110,318 @@ TEST(ParameterClientLocal, ExpectedFlagDefaultsArePresent) {
     ASSERT_TRUE(statusor.ok());
     EXPECT_EQ(0, *statusor);
   }
+  {
+    const auto statusor =
+        client->GetInt32Parameter("kv-server-local-cache-num-segments");
+    ASSERT_TRUE(statusor.ok());
+    EXPECT_EQ(1, *statusor);
+  }
+  {
+    const auto statusor =
+        client->GetInt32Parameter("kv-server-local-lookup-hedge-percentile");
+    ASSERT_TRUE(statusor.ok());
+    EXPECT_EQ(0, *statusor);
+  }
+  {
+    const auto statusor =
+        client->GetInt32Parameter("kv-server-local-lookup-padding-bucket");
+    ASSERT_TRUE(statusor.ok());
+    EXPECT_EQ(0, *statusor);
+  }
+  {
+    const auto statusor =
+        client->GetInt32Parameter("kv-server-local-data-loading-concurrency");
+    ASSERT_TRUE(statusor.ok());
+    EXPECT_EQ(1, *statusor);
+  }
+  {
+    const auto statusor = client->GetInt32Parameter(
+        "kv-server-local-lookup-channels-per-replica");
+    ASSERT_TRUE(statusor.ok());
+    EXPECT_EQ(1, *statusor);
+  }
+  {
+    const auto statusor =
+        client->GetInt32Parameter("kv-server-local-lookup-keepalive-ms");
+    ASSERT_TRUE(statusor.ok());
+    EXPECT_EQ(0, *statusor);
+  }
+  {
+    const auto statusor =
+        client->GetInt32Parameter("kv-server-local-blob-read-ahead-chunks");
+    ASSERT_TRUE(statusor.ok());
+    EXPECT_EQ(0, *statusor);
+  }
+  {
+    const auto statusor =
+        client->GetInt32Parameter("kv-server-local-blob-cache-max-size-mb");
+    ASSERT_TRUE(statusor.ok());
+    EXPECT_EQ(0, *statusor);
+  }
+  {
+    const auto statusor =
+        client->GetInt32Parameter("kv-server-local-cache-max-hot-value-mb");
+    ASSERT_TRUE(statusor.ok());
+    EXPECT_EQ(1024, *statusor);
+  }
+  {
+    const auto statusor =
+        client->GetInt32Parameter("kv-server-local-cache-hot-key-sample-rate");
+    ASSERT_TRUE(statusor.ok());
+    EXPECT_EQ(0, *statusor);
+  }
+  {
+    const auto statusor =
+        client->GetInt32Parameter("kv-server-local-cache-checkpoint-mins");
+    ASSERT_TRUE(statusor.ok());
+    EXPECT_EQ(10, *statusor);
+  }
+  {
+    const auto statusor =
+        client->GetInt32Parameter("kv-server-local-reader-shards-per-thread");
+    ASSERT_TRUE(statusor.ok());
+    EXPECT_EQ(1, *statusor);
+  }
+  {
+    const auto statusor =
+        client->GetInt32Parameter("kv-server-local-cache-cleanup-millis");
+    ASSERT_TRUE(statusor.ok());
+    EXPECT_EQ(0, *statusor);
+  }
+  {
+    const auto statusor = client->GetInt32Parameter(
+        "kv-server-local-cache-cleanup-pause-ms");
+    ASSERT_TRUE(statusor.ok());
+    EXPECT_EQ(1, *statusor);
+  }
+  {
+    const auto statusor = client->GetInt32Parameter(
+        "kv-server-local-realtime-coalesce-millis");
+    ASSERT_TRUE(statusor.ok());
+    EXPECT_EQ(0, *statusor);
+  }
+  {
+    const auto statusor =
+        client->GetInt32Parameter("kv-server-local-snapshot-reload-mins");
+    ASSERT_TRUE(statusor.ok());
+    EXPECT_EQ(0, *statusor);
+  }
+  {
+    const auto statusor =
+        client->GetInt32Parameter("kv-server-local-readiness-max-lag-secs");
+    ASSERT_TRUE(statusor.ok());
+    EXPECT_EQ(0, *statusor);
+  }
+  {
+    const auto statusor =
+        client->GetInt32Parameter("kv-server-local-delta-prefetch-max-mb");
+    ASSERT_TRUE(statusor.ok());
+    EXPECT_EQ(0, *statusor);
+  }
+  {
+    const auto statusor =
+        client->GetInt32Parameter("kv-server-local-udf-warm-up-invocations");
+    ASSERT_TRUE(statusor.ok());
+    EXPECT_EQ(0, *statusor);
+  }
+  {
+    const auto statusor =
+        client->GetInt32Parameter("kv-server-local-response-brotli-quality");
+    ASSERT_TRUE(statusor.ok());
+    EXPECT_EQ(11, *statusor);
+  }
+  {
+    const auto statusor =
+        client->GetInt32Parameter("kv-server-local-response-brotli-window");
+    ASSERT_TRUE(statusor.ok());
+    EXPECT_EQ(22, *statusor);
+  }
+  {
+    const auto statusor = client->GetInt32Parameter(
+        "kv-server-local-grpc-max-concurrent-streams");
+    ASSERT_TRUE(statusor.ok());
+    EXPECT_EQ(0, *statusor);
+  }
+  {
+    const auto statusor =
+        client->GetInt32Parameter("kv-server-local-grpc-max-threads-per-core");
+    ASSERT_TRUE(statusor.ok());
+    EXPECT_EQ(0, *statusor);
+  }
+  {
+    const auto statusor =
+        client->GetInt32Parameter("kv-server-local-grpc-memory-quota-mb");
+    ASSERT_TRUE(statusor.ok());
+    EXPECT_EQ(0, *statusor);
+  }
+  {
+    const auto statusor =
+        client->GetInt32Parameter("kv-server-local-admission-max-in-flight");
+    ASSERT_TRUE(statusor.ok());
+    EXPECT_EQ(0, *statusor);
+  }
+  {
+    const auto statusor = client->GetInt32Parameter(
+        "kv-server-local-admission-critical-reserve-percent");
+    ASSERT_TRUE(statusor.ok());
+    EXPECT_EQ(20, *statusor);
+  }
+  {
+    const auto statusor = client->GetInt32Parameter(
+        "kv-server-local-admission-latency-target-ms");
+    ASSERT_TRUE(statusor.ok());
+    EXPECT_EQ(0, *statusor);
+  }
+  {
+    const auto statusor =
+        client->GetInt32Parameter("kv-server-local-lookup-batch-window-micros");
+    ASSERT_TRUE(statusor.ok());
+    EXPECT_EQ(0, *statusor);
+  }
+  {
+    const auto statusor =
+        client->GetInt32Parameter("kv-server-local-lookup-batch-max-keys");
+    ASSERT_TRUE(statusor.ok());
+    EXPECT_EQ(1000, *statusor);
+  }
+  {
+    const auto statusor = client->GetInt32Parameter(
+        "kv-server-local-lookup-key-filter-interval-ms");
+    ASSERT_TRUE(statusor.ok());
+    EXPECT_EQ(0, *statusor);
+  }
+  {
+    const auto statusor = client->GetInt32Parameter(
+        "kv-server-local-lookup-key-filter-bits-per-key");
+    ASSERT_TRUE(statusor.ok());
+    EXPECT_EQ(10, *statusor);
+  }
+  {
+    const auto statusor =
+        client->GetInt32Parameter("kv-server-local-lookup-cache-max-entries");
+    ASSERT_TRUE(statusor.ok());
+    EXPECT_EQ(0, *statusor);
+  }
+  {
+    const auto statusor =
+        client->GetInt32Parameter("kv-server-local-lookup-cache-ttl-ms");
+    ASSERT_TRUE(statusor.ok());
+    EXPECT_EQ(1000, *statusor);
+  }
+  {
+    const auto statusor = client->GetInt32Parameter(
+        "kv-server-local-query-evaluation-threads");
+    ASSERT_TRUE(statusor.ok());
+    EXPECT_EQ(0, *statusor);
+  }
+  {
+    const auto statusor = client->GetInt32Parameter(
+        "kv-server-local-lookup-response-compression-min-bytes");
+    ASSERT_TRUE(statusor.ok());
+    EXPECT_EQ(0, *statusor);
+  }
+  {
+    const auto statusor = client->GetBoolParameter(
+        "kv-server-local-v1-merge-namespace-lookups");
+    ASSERT_TRUE(statusor.ok());
+    EXPECT_FALSE(*statusor);
+  }
+  {
+    const auto statusor = client->GetInt32Parameter(
+        "kv-server-local-udf-batch-window-us");
+    ASSERT_TRUE(statusor.ok());
+    EXPECT_EQ(0, *statusor);
+  }
+  {
+    const auto statusor = client->GetInt32Parameter(
+        "kv-server-local-udf-max-batch-size");
+    ASSERT_TRUE(statusor.ok());
+    EXPECT_EQ(16, *statusor);
+  }
+  {
+    const auto statusor = client->GetInt32Parameter(
+        "kv-server-local-udf-cache-max-mb");
+    ASSERT_TRUE(statusor.ok());
+    EXPECT_EQ(0, *statusor);
+  }
+  {
+    const auto statusor = client->GetBoolParameter(
+        "kv-server-local-load-compacted-delta-files");
+    ASSERT_TRUE(statusor.ok());
+    EXPECT_FALSE(*statusor);
+  }
+  {
+    const auto statusor = client->GetInt32Parameter(
+        "kv-server-local-data-loading-apply-threads");
+    ASSERT_TRUE(statusor.ok());
+    EXPECT_EQ(0, *statusor);
+  }
+  {
+    const auto statusor = client->GetBoolParameter(
+        "kv-server-local-download-snapshot-files");
+    ASSERT_TRUE(statusor.ok());
+    EXPECT_FALSE(*statusor);
+  }
+  {
+    const auto statusor =
+        client->GetBoolParameter("kv-server-local-bulk-load-snapshots");
+    ASSERT_TRUE(statusor.ok());
+    EXPECT_FALSE(*statusor);
+  }
+  {
+    const auto statusor = client->GetInt32Parameter(
+        "kv-server-local-heap-allocator-max-per-cpu-cache-bytes");
+    ASSERT_TRUE(statusor.ok());
+    EXPECT_EQ(0, *statusor);
+  }
+  {
+    const auto statusor = client->GetBoolParameter(
+        "kv-server-local-release-heap-memory-after-loading");
+    ASSERT_TRUE(statusor.ok());
+    EXPECT_FALSE(*statusor);
+  }
+  {
+    const auto statusor = client->GetBoolParameter(
+        "kv-server-local-cache-use-huge-pages");
+    ASSERT_TRUE(statusor.ok());
+    EXPECT_FALSE(*statusor);
+  }
+  {
+    const auto statusor = client->GetInt32Parameter(
+        "kv-server-local-response-cache-max-entries");
+    ASSERT_TRUE(statusor.ok());
+    EXPECT_EQ(0, *statusor);
+  }
+  {
+    const auto statusor = client->GetInt32Parameter(
+        "kv-server-local-response-cache-ttl-ms");
+    ASSERT_TRUE(statusor.ok());
+    EXPECT_EQ(1000, *statusor);
+  }
+  {
+    const auto statusor =
+        client->GetInt32Parameter("kv-server-local-num-logical-shards");
+    ASSERT_TRUE(statusor.ok());
+    EXPECT_EQ(0, *statusor);
+  }
+  {
+    const auto statusor = client->GetInt32Parameter(
+        "kv-server-local-data-loading-max-records-per-second");
+    ASSERT_TRUE(statusor.ok());
+    EXPECT_EQ(0, *statusor);
+  }
+  {
+    const auto statusor = client->GetInt32Parameter(
+        "kv-server-local-data-loading-min-records-per-second");
+    ASSERT_TRUE(statusor.ok());
+    EXPECT_EQ(0, *statusor);
+  }
+  {
+    const auto statusor = client->GetInt32Parameter(
+        "kv-server-local-data-loading-latency-target-ms");
+    ASSERT_TRUE(statusor.ok());
+    EXPECT_EQ(0, *statusor);
+  }
   {
     const auto statusor =
         client->GetBoolParameter("kv-server-local-route-v1-to-v2");
@@ -122,6 +434,84 @@ TEST(ParameterClientLocal, ExpectedFlagDefaultsArePresent) {
     ASSERT_TRUE(statusor.ok());
     EXPECT_EQ(false, *statusor);
   }
+  {
+    const auto statusor =
+        client->GetBoolParameter("kv-server-local-use-epoch-based-cache");
+    ASSERT_TRUE(statusor.ok());
+    EXPECT_EQ(false, *statusor);
+  }
+  {
+    const auto statusor =
+        client->GetBoolParameter("kv-server-local-cache-intern-set-values");
+    ASSERT_TRUE(statusor.ok());
+    EXPECT_EQ(false, *statusor);
+  }
+  {
+    const auto statusor = client->GetBoolParameter(
+        "kv-server-local-cache-precompute-json-values");
+    ASSERT_TRUE(statusor.ok());
+    EXPECT_EQ(false, *statusor);
+  }
+  {
+    const auto statusor =
+        client->GetBoolParameter("kv-server-local-cache-compress-values");
+    ASSERT_TRUE(statusor.ok());
+    EXPECT_EQ(false, *statusor);
+  }
+  {
+    const auto statusor =
+        client->GetBoolParameter("kv-server-local-cache-deduplicate-values");
+    ASSERT_TRUE(statusor.ok());
+    EXPECT_EQ(false, *statusor);
+  }
+  {
+    const auto statusor =
+        client->GetBoolParameter("kv-server-local-cache-isolate-prefixes");
+    ASSERT_TRUE(statusor.ok());
+    EXPECT_EQ(false, *statusor);
+  }
+  {
+    const auto statusor =
+        client->GetBoolParameter("kv-server-local-cache-index-set-values");
+    ASSERT_TRUE(statusor.ok());
+    EXPECT_EQ(false, *statusor);
+  }
+  {
+    const auto statusor =
+        client->GetBoolParameter("kv-server-local-cache-index-keys");
+    ASSERT_TRUE(statusor.ok());
+    EXPECT_EQ(false, *statusor);
+  }
+  {
+    const auto statusor =
+        client->GetBoolParameter("kv-server-local-v1-direct-serialization");
+    ASSERT_TRUE(statusor.ok());
+    EXPECT_EQ(false, *statusor);
+  }
+  {
+    const auto statusor =
+        client->GetBoolParameter("kv-server-local-lookup-skip-empty-shards");
+    ASSERT_TRUE(statusor.ok());
+    EXPECT_FALSE(*statusor);
+  }
+  {
+    const auto statusor =
+        client->GetBoolParameter("kv-server-local-lookup-query-pushdown");
+    ASSERT_TRUE(statusor.ok());
+    EXPECT_FALSE(*statusor);
+  }
+  {
+    const auto statusor = client->GetBoolParameter(
+        "kv-server-local-lookup-plan-queries-with-set-sizes");
+    ASSERT_TRUE(statusor.ok());
+    EXPECT_FALSE(*statusor);
+  }
+  {
+    const auto statusor =
+        client->GetBoolParameter("kv-server-local-push-delta-notifications");
+    ASSERT_TRUE(statusor.ok());
+    EXPECT_FALSE(*statusor);
+  }
   {
     const auto statusor =
         client->GetBoolParameter("kv-server-local-use-real-coordinators");
@@ -140,12 +530,83 @@ TEST(ParameterClientLocal, ExpectedFlagDefaultsArePresent) {
     ASSERT_TRUE(statusor.ok());
     EXPECT_EQ(false, *statusor);
   }
+  {
+    const auto statusor =
+        client->GetBoolParameter("kv-server-local-use-siphash-sharding");
+    ASSERT_TRUE(statusor.ok());
+    EXPECT_EQ(false, *statusor);
+  }
+  {
+    const auto statusor =
+        client->GetBoolParameter("kv-server-local-trust-data-file-records");
+    ASSERT_TRUE(statusor.ok());
+    EXPECT_EQ(false, *statusor);
+  }
+  {
+    const auto statusor =
+        client->GetBoolParameter("kv-server-local-use-data-file-manifest");
+    ASSERT_TRUE(statusor.ok());
+    EXPECT_EQ(false, *statusor);
+  }
   {
     const auto statusor =
         client->GetParameter("kv-server-local-telemetry-config");
     ASSERT_TRUE(statusor.ok());
     EXPECT_EQ("mode: EXPERIMENT", *statusor);
   }
+  {
+    const auto statusor =
+        client->GetParameter("kv-server-local-blob-cache-directory");
+    ASSERT_TRUE(statusor.ok());
+    EXPECT_EQ("", *statusor);
+  }
+  {
+    const auto statusor =
+        client->GetParameter("kv-server-local-cache-cold-value-directory");
+    ASSERT_TRUE(statusor.ok());
+    EXPECT_EQ("", *statusor);
+  }
+  {
+    const auto statusor =
+        client->GetParameter("kv-server-local-cache-checkpoint-file");
+    ASSERT_TRUE(statusor.ok());
+    EXPECT_EQ("", *statusor);
+  }
+  {
+    const auto statusor =
+        client->GetParameter("kv-server-local-data-loading-priority-prefixes");
+    ASSERT_TRUE(statusor.ok());
+    EXPECT_EQ("", *statusor);
+  }
+  {
+    const auto statusor =
+        client->GetParameter("kv-server-local-sharding-replicated-keys");
+    ASSERT_TRUE(statusor.ok());
+    EXPECT_EQ("", *statusor);
+  }
+  {
+    const auto statusor = client->GetParameter("kv-server-local-serving-cpus");
+    ASSERT_TRUE(statusor.ok());
+    EXPECT_EQ("", *statusor);
+  }
+  {
+    const auto statusor =
+        client->GetParameter("kv-server-local-serving-memory-policy");
+    ASSERT_TRUE(statusor.ok());
+    EXPECT_EQ("", *statusor);
+  }
+  {
+    const auto statusor =
+        client->GetParameter("kv-server-local-data-loading-cpus");
+    ASSERT_TRUE(statusor.ok());
+    EXPECT_EQ("", *statusor);
+  }
+  {
+    const auto statusor =
+        client->GetParameter("kv-server-local-data-loading-memory-policy");
+    ASSERT_TRUE(statusor.ok());
+    EXPECT_EQ("", *statusor);
+  }
 }
 
 }  // namespace
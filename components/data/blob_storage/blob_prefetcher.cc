@@ -0,0 +1,88 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "components/data/blob_storage/blob_prefetcher.h"
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "absl/log/log.h"
+
+namespace kv_server {
+namespace {
+
+// Size of the reads of prefetched blobs.
+constexpr int64_t kReadSize = 1 << 20;
+
+}  // namespace
+
+BlobPrefetcher::BlobPrefetcher(BlobStorageClient& client, int64_t max_bytes)
+    : client_(client), max_bytes_(max_bytes) {}
+
+BlobPrefetcher::~BlobPrefetcher() { WaitForDownload(); }
+
+void BlobPrefetcher::WaitForDownload() {
+  if (download_thread_.joinable()) {
+    download_thread_.join();
+  }
+}
+
+void BlobPrefetcher::Prefetch(BlobStorageClient::DataLocation location) {
+  WaitForDownload();
+  contents_.reset();
+  location_ = location;
+  download_thread_ =
+      std::thread(&BlobPrefetcher::Download, this, std::move(location));
+}
+
+std::shared_ptr<const std::string> BlobPrefetcher::Take(
+    const BlobStorageClient::DataLocation& location) {
+  if (!location_.has_value() || !(*location_ == location)) {
+    return nullptr;
+  }
+  WaitForDownload();
+  location_.reset();
+  return std::move(contents_);
+}
+
+void BlobPrefetcher::Download(BlobStorageClient::DataLocation location) {
+  std::unique_ptr<BlobReader> reader = client_.GetBlobReader(location);
+  std::istream& stream = reader->Stream();
+  auto contents = std::make_shared<std::string>();
+  // Reads at most one byte more than `max_bytes_` to find larger blobs.
+  while (stream.good() && contents->size() <= max_bytes_) {
+    const size_t size = contents->size();
+    const int64_t read_size =
+        std::min<int64_t>(kReadSize, max_bytes_ + 1 - size);
+    contents->resize(size + read_size);
+    stream.read(&(*contents)[size], read_size);
+    contents->resize(size + stream.gcount());
+  }
+  if (contents->size() > max_bytes_) {
+    VLOG(2) << "Not prefetching " << location << ", larger than "
+            << max_bytes_ << " bytes";
+    return;
+  }
+  if (stream.bad()) {
+    VLOG(2) << "Failed to prefetch " << location;
+    return;
+  }
+  VLOG(2) << "Prefetched " << contents->size() << " bytes of " << location;
+  contents_ = std::move(contents);
+}
+
+}  // namespace kv_server
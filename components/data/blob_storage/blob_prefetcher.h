@@ -0,0 +1,70 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef COMPONENTS_DATA_BLOB_STORAGE_BLOB_PREFETCHER_H_
+#define COMPONENTS_DATA_BLOB_STORAGE_BLOB_PREFETCHER_H_
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <thread>
+
+#include "components/data/blob_storage/blob_storage_client.h"
+
+namespace kv_server {
+
+// Downloads a blob into memory on a background thread, so that it can be
+// read without waiting for the blob storage once it is needed. Only one blob
+// is prefetched at a time, which bounds the memory used to `max_bytes`.
+//
+// Not thread safe.
+class BlobPrefetcher {
+ public:
+  // Blobs larger than `max_bytes` are not prefetched.
+  BlobPrefetcher(BlobStorageClient& client, int64_t max_bytes);
+
+  // Waits for the download in progress.
+  ~BlobPrefetcher();
+
+  BlobPrefetcher(const BlobPrefetcher&) = delete;
+  BlobPrefetcher& operator=(const BlobPrefetcher&) = delete;
+
+  // Starts downloading `location`. Drops the previously prefetched blob if it
+  // was not taken.
+  void Prefetch(BlobStorageClient::DataLocation location);
+
+  // Returns the contents of `location` once its download finishes, or
+  // nullptr if `location` is not the prefetched blob, its download failed,
+  // or it is larger than `max_bytes`.
+  std::shared_ptr<const std::string> Take(
+      const BlobStorageClient::DataLocation& location);
+
+ private:
+  // Runs on `download_thread_`.
+  void Download(BlobStorageClient::DataLocation location);
+  void WaitForDownload();
+
+  BlobStorageClient& client_;
+  const int64_t max_bytes_;
+  std::optional<BlobStorageClient::DataLocation> location_;
+  std::thread download_thread_;
+  // Only written by `download_thread_`, and only read after joining it.
+  std::shared_ptr<const std::string> contents_;
+};
+
+}  // namespace kv_server
+
+#endif  // COMPONENTS_DATA_BLOB_STORAGE_BLOB_PREFETCHER_H_
@@ -0,0 +1,124 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "components/data/blob_storage/blob_prefetcher.h"
+
+#include <memory>
+#include <sstream>
+#include <string>
+
+#include "absl/synchronization/notification.h"
+#include "components/data/blob_storage/memory_blob_reader.h"
+#include "components/data/common/mocks.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace kv_server {
+namespace {
+
+using testing::Return;
+
+std::unique_ptr<BlobReader> NewMemoryBlobReader(std::string contents) {
+  return std::make_unique<MemoryBlobReader>(
+      std::make_shared<const std::string>(std::move(contents)));
+}
+
+std::string ReadAll(BlobReader& reader) {
+  std::stringstream contents;
+  contents << reader.Stream().rdbuf();
+  return contents.str();
+}
+
+class BlobPrefetcherTest : public ::testing::Test {
+ protected:
+  MockBlobStorageClient client_;
+  const BlobStorageClient::DataLocation location_{.bucket = "bucket",
+                                                  .key = "DELTA_1"};
+  const BlobStorageClient::DataLocation other_location_{.bucket = "bucket",
+                                                        .key = "DELTA_2"};
+};
+
+TEST_F(BlobPrefetcherTest, TakesPrefetchedBlob) {
+  EXPECT_CALL(client_, GetBlobReader(location_))
+      .WillOnce(Return(NewMemoryBlobReader("contents")));
+  BlobPrefetcher prefetcher(client_, /*max_bytes=*/100);
+  prefetcher.Prefetch(location_);
+  std::shared_ptr<const std::string> contents = prefetcher.Take(location_);
+  ASSERT_NE(contents, nullptr);
+  EXPECT_EQ(*contents, "contents");
+  // The blob can only be taken once.
+  EXPECT_EQ(prefetcher.Take(location_), nullptr);
+}
+
+TEST_F(BlobPrefetcherTest, ReadsTakenBlobFromMemory) {
+  EXPECT_CALL(client_, GetBlobReader(location_))
+      .WillOnce(Return(NewMemoryBlobReader("contents")));
+  BlobPrefetcher prefetcher(client_, /*max_bytes=*/100);
+  prefetcher.Prefetch(location_);
+  std::shared_ptr<const std::string> contents = prefetcher.Take(location_);
+  ASSERT_NE(contents, nullptr);
+  MemoryBlobReader reader1(contents);
+  MemoryBlobReader reader2(contents);
+  EXPECT_EQ(reader1.Contents(), "contents");
+  EXPECT_EQ(ReadAll(reader1), "contents");
+  reader2.Stream().seekg(4);
+  EXPECT_EQ(ReadAll(reader2), "ents");
+}
+
+TEST_F(BlobPrefetcherTest, DoesNotReturnOtherBlobs) {
+  absl::Notification read;
+  EXPECT_CALL(client_, GetBlobReader(location_)).WillOnce([&read]() {
+    read.Notify();
+    return NewMemoryBlobReader("contents");
+  });
+  BlobPrefetcher prefetcher(client_, /*max_bytes=*/100);
+  EXPECT_EQ(prefetcher.Take(location_), nullptr);
+  prefetcher.Prefetch(location_);
+  EXPECT_EQ(prefetcher.Take(other_location_), nullptr);
+  read.WaitForNotification();
+}
+
+TEST_F(BlobPrefetcherTest, DropsBlobPrefetchedBeforeTheLastOne) {
+  EXPECT_CALL(client_, GetBlobReader(location_))
+      .WillOnce(Return(NewMemoryBlobReader("contents")));
+  EXPECT_CALL(client_, GetBlobReader(other_location_))
+      .WillOnce(Return(NewMemoryBlobReader("other contents")));
+  BlobPrefetcher prefetcher(client_, /*max_bytes=*/100);
+  prefetcher.Prefetch(location_);
+  prefetcher.Prefetch(other_location_);
+  EXPECT_EQ(prefetcher.Take(location_), nullptr);
+  std::shared_ptr<const std::string> contents =
+      prefetcher.Take(other_location_);
+  ASSERT_NE(contents, nullptr);
+  EXPECT_EQ(*contents, "other contents");
+}
+
+TEST_F(BlobPrefetcherTest, SkipsBlobsLargerThanMaxBytes) {
+  EXPECT_CALL(client_, GetBlobReader(location_))
+      .WillOnce(Return(NewMemoryBlobReader("contents")));
+  EXPECT_CALL(client_, GetBlobReader(other_location_))
+      .WillOnce(Return(NewMemoryBlobReader("content")));
+  BlobPrefetcher prefetcher(client_, /*max_bytes=*/7);
+  prefetcher.Prefetch(location_);
+  EXPECT_EQ(prefetcher.Take(location_), nullptr);
+  prefetcher.Prefetch(other_location_);
+  std::shared_ptr<const std::string> contents =
+      prefetcher.Take(other_location_);
+  ASSERT_NE(contents, nullptr);
+  EXPECT_EQ(*contents, "content");
+}
+
+}  // namespace
+}  // namespace kv_server
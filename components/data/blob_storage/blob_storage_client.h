@@ -19,8 +19,11 @@
 
 #include <functional>
 #include <iostream>
+#include <iterator>
 #include <memory>
+#include <optional>
 #include <string>
+#include <string_view>
 #include <thread>
 #include <vector>
 
@@ -37,6 +40,11 @@ class BlobReader {
   virtual std::istream& Stream() = 0;
   // True if the istream returned by `Stream` supports `seek`.
   virtual bool CanSeek() const = 0;
+  // Returns the whole blob if it is mapped in memory, so that it can be read
+  // without copies. The view is valid for the lifetime of the reader.
+  virtual std::optional<std::string_view> Contents() const {
+    return std::nullopt;
+  }
 };
 
 // Abstraction to interact with cloud file storage.
@@ -62,6 +70,15 @@ class BlobStorageClient {
     ClientOptions() = default;
     int64_t max_connections = std::thread::hardware_concurrency();
     int64_t max_range_bytes = 8 * 1024 * 1024;  // 8MB
+    // Number of ranges read ahead of the one being consumed by blob readers,
+    // see `SeekingInputStreambuf::Options::num_read_ahead_chunks`.
+    int64_t num_read_ahead_chunks = 0;
+    // Size of the parts that `PutBlob` reads streams which cannot seek in, and
+    // uploads as they are read. S3 requires parts of at least 5MB.
+    int64_t upload_part_bytes = 16 * 1024 * 1024;  // 16MB
+    // Number of parts of a blob uploaded at once. Uploads buffer at most one
+    // more part than this.
+    int64_t max_concurrent_upload_parts = 4;
   };
 
   virtual ~BlobStorageClient() = default;
@@ -80,6 +97,35 @@ class BlobStorageClient {
   // Keys are lexicographically ordered.
   virtual absl::StatusOr<std::vector<std::string>> ListBlobs(
       DataLocation location, ListOptions options) = 0;
+
+  // Returns an identifier of the current version of the blob, which changes
+  // whenever the blob is overwritten.
+  virtual absl::StatusOr<std::string> GetBlobETag(DataLocation location) {
+    return absl::UnimplementedError("Blob ETags are not supported.");
+  }
+
+  // Downloads the whole blob into memory. Cloud storage clients download
+  // ranges of the blob in parallel, which is much faster for large blobs than
+  // reading them through `GetBlobReader`.
+  virtual absl::StatusOr<std::shared_ptr<const std::string>> DownloadBlob(
+      DataLocation location) {
+    std::unique_ptr<BlobReader> reader = GetBlobReader(location);
+    if (reader == nullptr) {
+      return absl::NotFoundError(
+          absl::StrCat("Failed to open blob ", location.key));
+    }
+    if (auto contents = reader->Contents(); contents.has_value()) {
+      return std::make_shared<const std::string>(*contents);
+    }
+    auto contents = std::make_shared<const std::string>(
+        std::istreambuf_iterator<char>(reader->Stream()),
+        std::istreambuf_iterator<char>());
+    if (reader->Stream().bad()) {
+      return absl::UnavailableError(
+          absl::StrCat("Failed to download blob ", location.key));
+    }
+    return contents;
+  }
 };
 
 inline std::ostream& operator<<(
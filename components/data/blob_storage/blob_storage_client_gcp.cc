@@ -30,6 +30,7 @@
 #include "absl/strings/match.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_split.h"
+#include "absl/synchronization/mutex.h"
 #include "components/data/blob_storage/blob_prefix_allowlist.h"
 #include "components/data/blob_storage/blob_storage_client.h"
 #include "components/data/blob_storage/seeking_input_streambuf.h"
@@ -39,10 +40,37 @@
 namespace kv_server {
 namespace {
 
+// Size of the ranges downloaded in parallel by `DownloadBlob`.
+constexpr int64_t kDownloadPartBytes = 16 * 1024 * 1024;
+
 std::string AppendPrefix(const std::string& value, const std::string& prefix) {
   return prefix.empty() ? value : absl::StrCat(prefix, "/", value);
 }
 
+// Reads at most `size` bytes of the object at `offset` straight into
+// `dest_buffer`. Returns the number of bytes read, which is less than `size`
+// if the object ends before.
+absl::StatusOr<int64_t> ReadObjectRange(
+    google::cloud::storage::Client& client, const std::string& bucket,
+    const std::string& object_name, int64_t offset, int64_t size,
+    char* dest_buffer,
+    google::cloud::storage::Generation generation =
+        google::cloud::storage::Generation()) {
+  auto stream = client.ReadObject(
+      bucket, object_name,
+      google::cloud::storage::ReadRange(offset, offset + size), generation);
+  if (!stream.status().ok()) {
+    return GoogleErrorStatusToAbslStatus(stream.status());
+  }
+  // A short read sets the failbit, which is not an error since the object may
+  // end before the range.
+  stream.read(dest_buffer, size);
+  if (!stream.status().ok()) {
+    return GoogleErrorStatusToAbslStatus(stream.status());
+  }
+  return stream.gcount();
+}
+
 class GcpBlobInputStreamBuf : public SeekingInputStreambuf {
  public:
   GcpBlobInputStreamBuf(google::cloud::storage::Client& client,
@@ -51,6 +79,7 @@ class GcpBlobInputStreamBuf : public SeekingInputStreambuf {
       : SeekingInputStreambuf(std::move(options)),
         client_(client),
         location_(std::move(location)) {}
+  ~GcpBlobInputStreamBuf() override { WaitForReadAheads(); }
 
   GcpBlobInputStreamBuf(const GcpBlobInputStreamBuf&) = delete;
   GcpBlobInputStreamBuf& operator=(const GcpBlobInputStreamBuf&) = delete;
@@ -67,16 +96,9 @@ class GcpBlobInputStreamBuf : public SeekingInputStreambuf {
 
   absl::StatusOr<int64_t> ReadChunk(int64_t offset, int64_t chunk_size,
                                     char* dest_buffer) override {
-    auto stream = client_.ReadObject(
-        location_.bucket, AppendPrefix(location_.key, location_.prefix),
-        google::cloud::storage::ReadRange(offset, offset + chunk_size));
-    if (!stream.status().ok()) {
-      return GoogleErrorStatusToAbslStatus(stream.status());
-    }
-    std::string contents(std::istreambuf_iterator<char>{stream}, {});
-    int64_t true_size = contents.size();
-    std::copy(contents.begin(), contents.end(), dest_buffer);
-    return true_size;
+    return ReadObjectRange(client_, location_.bucket,
+                           AppendPrefix(location_.key, location_.prefix),
+                           offset, chunk_size, dest_buffer);
   }
 
  private:
@@ -87,15 +109,19 @@ class GcpBlobInputStreamBuf : public SeekingInputStreambuf {
 class GcpBlobReader : public BlobReader {
  public:
   GcpBlobReader(google::cloud::storage::Client& client,
-                BlobStorageClient::DataLocation location)
+                BlobStorageClient::DataLocation location,
+                int64_t num_read_ahead_chunks, ThreadPool* read_ahead_executor)
       : BlobReader(),
         streambuf_(client, location,
-                   GetOptions([this, location](absl::Status status) {
-                     LOG(ERROR) << "Blob "
-                                << AppendPrefix(location.key, location.prefix)
-                                << " failed stream with: " << status;
-                     is_.setstate(std::ios_base::badbit);
-                   })),
+                   GetOptions(num_read_ahead_chunks, read_ahead_executor,
+                              [this, location](absl::Status status) {
+                                LOG(ERROR)
+                                    << "Blob "
+                                    << AppendPrefix(location.key,
+                                                    location.prefix)
+                                    << " failed stream with: " << status;
+                                is_.setstate(std::ios_base::badbit);
+                              })),
         is_(&streambuf_) {}
 
   std::istream& Stream() { return is_; }
@@ -103,8 +129,11 @@ class GcpBlobReader : public BlobReader {
 
  private:
   static SeekingInputStreambuf::Options GetOptions(
+      int64_t num_read_ahead_chunks, ThreadPool* read_ahead_executor,
       std::function<void(absl::Status)> error_callback) {
     SeekingInputStreambuf::Options options;
+    options.num_read_ahead_chunks = num_read_ahead_chunks;
+    options.read_ahead_executor = read_ahead_executor;
     options.error_callback = std::move(error_callback);
     return options;
   }
@@ -115,18 +144,31 @@ class GcpBlobReader : public BlobReader {
 }  // namespace
 
 GcpBlobStorageClient::GcpBlobStorageClient(
-    std::unique_ptr<google::cloud::storage::Client> client)
-    : client_(std::move(client)) {}
+    std::unique_ptr<google::cloud::storage::Client> client,
+    int64_t num_read_ahead_chunks, int64_t upload_part_bytes)
+    : client_(std::move(client)),
+      num_read_ahead_chunks_(num_read_ahead_chunks),
+      upload_part_bytes_(upload_part_bytes) {
+  if (num_read_ahead_chunks_ > 0) {
+    read_ahead_executor_ =
+        std::make_unique<ThreadPool>(std::thread::hardware_concurrency());
+  }
+}
 
 std::unique_ptr<BlobReader> GcpBlobStorageClient::GetBlobReader(
     DataLocation location) {
-  return std::make_unique<GcpBlobReader>(*client_, std::move(location));
+  return std::make_unique<GcpBlobReader>(*client_, std::move(location),
+                                         num_read_ahead_chunks_,
+                                         read_ahead_executor_.get());
 }
 
 absl::Status GcpBlobStorageClient::PutBlob(BlobReader& blob_reader,
                                            DataLocation location) {
+  // The client buffers a single request of the upload, and rounds its size
+  // up to a multiple of the 256KiB that resumable uploads require.
   auto blob_ostream = client_->WriteObject(
-      location.bucket, AppendPrefix(location.key, location.prefix));
+      location.bucket, AppendPrefix(location.key, location.prefix),
+      google::cloud::storage::UploadBufferSize(upload_part_bytes_));
   if (!blob_ostream) {
     return GoogleErrorStatusToAbslStatus(blob_ostream.last_status());
   }
@@ -143,6 +185,61 @@ absl::Status GcpBlobStorageClient::DeleteBlob(DataLocation location) {
   return status.ok() ? absl::OkStatus() : GoogleErrorStatusToAbslStatus(status);
 }
 
+absl::StatusOr<std::string> GcpBlobStorageClient::GetBlobETag(
+    DataLocation location) {
+  auto object_metadata = client_->GetObjectMetadata(
+      location.bucket, AppendPrefix(location.key, location.prefix));
+  if (!object_metadata) {
+    return GoogleErrorStatusToAbslStatus(object_metadata.status());
+  }
+  return object_metadata->etag();
+}
+
+absl::StatusOr<std::shared_ptr<const std::string>>
+GcpBlobStorageClient::DownloadBlob(DataLocation location) {
+  const std::string object_name = AppendPrefix(location.key, location.prefix);
+  auto object_metadata =
+      client_->GetObjectMetadata(location.bucket, object_name);
+  if (!object_metadata) {
+    return GoogleErrorStatusToAbslStatus(object_metadata.status());
+  }
+  const int64_t size = object_metadata->size();
+  // Every range is read from the same generation, in case the object is
+  // overwritten meanwhile.
+  const google::cloud::storage::Generation generation(
+      object_metadata->generation());
+  auto contents = std::make_shared<std::string>(size, '\0');
+  const int64_t num_parts =
+      (size + kDownloadPartBytes - 1) / kDownloadPartBytes;
+  absl::Mutex mutex;
+  absl::Status status;
+  {
+    ThreadPool thread_pool(std::max<int64_t>(
+        1, std::min<int64_t>(num_parts, std::thread::hardware_concurrency())));
+    for (int64_t offset = 0; offset < size; offset += kDownloadPartBytes) {
+      thread_pool.Schedule([this, &location, &object_name, &generation,
+                            &contents, &mutex, &status, offset, size]() {
+        const int64_t part_size = std::min(kDownloadPartBytes, size - offset);
+        auto read_size =
+            ReadObjectRange(*client_, location.bucket, object_name, offset,
+                            part_size, contents->data() + offset, generation);
+        absl::Status part_status = read_size.status();
+        if (read_size.ok() && *read_size != part_size) {
+          part_status = absl::DataLossError(absl::StrCat(
+              "Short read of ", object_name, " at offset ", offset));
+        }
+        absl::MutexLock lock(&mutex);
+        status.Update(std::move(part_status));
+      });
+    }
+    // The thread pool waits for the reads when destroyed.
+  }
+  if (!status.ok()) {
+    return status;
+  }
+  return contents;
+}
+
 absl::StatusOr<std::vector<std::string>> GcpBlobStorageClient::ListBlobs(
     DataLocation location, ListOptions options) {
   auto list_object_reader =
@@ -178,9 +275,11 @@ class GcpBlobStorageClientFactory : public BlobStorageClientFactory {
  public:
   ~GcpBlobStorageClientFactory() = default;
   std::unique_ptr<BlobStorageClient> CreateBlobStorageClient(
-      BlobStorageClient::ClientOptions /*client_options*/) override {
+      BlobStorageClient::ClientOptions client_options) override {
     return std::make_unique<GcpBlobStorageClient>(
-        std::make_unique<google::cloud::storage::Client>());
+        std::make_unique<google::cloud::storage::Client>(),
+        client_options.num_read_ahead_chunks,
+        client_options.upload_part_bytes);
   }
 };
 }  // namespace
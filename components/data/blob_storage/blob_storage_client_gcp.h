@@ -21,6 +21,7 @@
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "components/data/blob_storage/blob_storage_client.h"
+#include "components/util/thread_pool.h"
 #include "google/cloud/storage/client.h"
 
 namespace kv_server {
@@ -28,12 +29,16 @@ namespace kv_server {
 class GcpBlobStorageClient : public BlobStorageClient {
  public:
   explicit GcpBlobStorageClient(
-      std::unique_ptr<google::cloud::storage::Client> client);
+      std::unique_ptr<google::cloud::storage::Client> client,
+      int64_t num_read_ahead_chunks = 0,
+      int64_t upload_part_bytes = ClientOptions().upload_part_bytes);
 
   ~GcpBlobStorageClient() = default;
 
   std::unique_ptr<BlobReader> GetBlobReader(DataLocation location) override;
 
+  // Streams the blob in a resumable upload, in requests of
+  // `ClientOptions::upload_part_bytes`.
   absl::Status PutBlob(BlobReader& blob_reader, DataLocation location) override;
 
   absl::Status DeleteBlob(DataLocation location) override;
@@ -41,7 +46,17 @@ class GcpBlobStorageClient : public BlobStorageClient {
   absl::StatusOr<std::vector<std::string>> ListBlobs(
       DataLocation location, ListOptions options) override;
 
+  absl::StatusOr<std::string> GetBlobETag(DataLocation location) override;
+
+  // Downloads ranges of the blob in parallel.
+  absl::StatusOr<std::shared_ptr<const std::string>> DownloadBlob(
+      DataLocation location) override;
+
  private:
   std::unique_ptr<google::cloud::storage::Client> client_;
+  int64_t num_read_ahead_chunks_;
+  int64_t upload_part_bytes_;
+  // Reads blob ranges ahead for all readers. Null if read-ahead is disabled.
+  std::unique_ptr<ThreadPool> read_ahead_executor_;
 };
 }  // namespace kv_server
@@ -18,14 +18,18 @@
 #include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <memory>
 #include <string>
 #include <thread>
 #include <utility>
 
 #include "absl/log/log.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
 #include "absl/strings/match.h"
 #include "absl/strings/str_cat.h"
 #include "components/data/blob_storage/blob_storage_client.h"
+#include "components/data/blob_storage/mapped_file_blob_reader.h"
 #include "components/data/blob_storage/seeking_input_streambuf.h"
 
 namespace kv_server {
@@ -46,6 +50,12 @@ class FileBlobReader : public BlobReader {
 
 std::unique_ptr<BlobReader> FileBlobStorageClient::GetBlobReader(
     DataLocation location) {
+  absl::StatusOr<std::unique_ptr<MappedFileBlobReader>> mapped_reader =
+      MappedFileBlobReader::Create(GetFullPath(location));
+  if (mapped_reader.ok()) {
+    return *std::move(mapped_reader);
+  }
+  VLOG(2) << "Reading without mapping: " << mapped_reader.status();
   std::unique_ptr<BlobReader> reader =
       std::make_unique<FileBlobReader>(GetFullPath(location));
 
@@ -122,6 +132,26 @@ absl::StatusOr<std::vector<std::string>> FileBlobStorageClient::ListBlobs(
   return blob_names;
 }
 
+absl::StatusOr<std::string> FileBlobStorageClient::GetBlobETag(
+    DataLocation location) {
+  // Files have no ETag, so their size and modification time are used
+  // instead.
+  std::error_code error_code;
+  const auto fullpath = GetFullPath(location);
+  const auto size = std::filesystem::file_size(fullpath, error_code);
+  if (error_code) {
+    return absl::NotFoundError(
+        absl::StrCat("Failed to get blob size: ", error_code.message()));
+  }
+  const auto write_time =
+      std::filesystem::last_write_time(fullpath, error_code);
+  if (error_code) {
+    return absl::NotFoundError(absl::StrCat(
+        "Failed to get blob modification time: ", error_code.message()));
+  }
+  return absl::StrCat(size, "-", write_time.time_since_epoch().count());
+}
+
 std::filesystem::path FileBlobStorageClient::GetFullPath(
     const DataLocation& location) {
   return location.prefix.empty()
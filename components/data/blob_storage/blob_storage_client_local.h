@@ -39,6 +39,8 @@ class FileBlobStorageClient : public BlobStorageClient {
   absl::StatusOr<std::vector<std::string>> ListBlobs(
       DataLocation location, ListOptions options) override;
 
+  absl::StatusOr<std::string> GetBlobETag(DataLocation location) override;
+
  private:
   std::filesystem::path GetFullPath(const DataLocation& location);
 };
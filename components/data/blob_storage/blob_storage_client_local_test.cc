@@ -20,9 +20,11 @@
 #include <filesystem>
 #include <fstream>
 #include <limits>
+#include <optional>
 #include <sstream>
 #include <streambuf>
 #include <string>
+#include <string_view>
 #include <utility>
 
 #include "absl/flags/flag.h"
@@ -162,6 +164,75 @@ TEST(LocalBlobStorageClientTest, ListSubDirectoryWithFiles) {
             std::vector<std::string>({"object1", "object2", "object3"}));
 }
 
+TEST(LocalBlobStorageClientTest, GetBlobReaderMapsFile) {
+  std::unique_ptr<BlobStorageClient> client =
+      std::make_unique<FileBlobStorageClient>();
+  CreateFileInTmpDir("mapped");
+  BlobStorageClient::DataLocation location{
+      .bucket = ::testing::TempDir(),
+      .key = "mapped",
+  };
+  auto reader = client->GetBlobReader(location);
+  ASSERT_NE(reader, nullptr);
+  ASSERT_TRUE(reader->Contents().has_value());
+  EXPECT_EQ(*reader->Contents(), "arbitrary file contents");
+  std::istream& stream = reader->Stream();
+  stream.seekg(-8, std::ios_base::end);
+  std::stringstream tail;
+  tail << stream.rdbuf();
+  EXPECT_EQ(tail.str(), "contents");
+  stream.clear();
+  stream.seekg(0, std::ios_base::end);
+  EXPECT_EQ(stream.tellg(), 23);
+}
+
+TEST(LocalBlobStorageClientTest, GetBlobReaderOfEmptyFile) {
+  std::unique_ptr<BlobStorageClient> client =
+      std::make_unique<FileBlobStorageClient>();
+  std::ofstream(std::filesystem::path(::testing::TempDir()) / "empty");
+  BlobStorageClient::DataLocation location{
+      .bucket = ::testing::TempDir(),
+      .key = "empty",
+  };
+  auto reader = client->GetBlobReader(location);
+  ASSERT_NE(reader, nullptr);
+  EXPECT_EQ(reader->Contents(), std::optional<std::string_view>(""));
+}
+
+TEST(LocalBlobStorageClientTest, GetBlobReaderOfMissingFile) {
+  std::unique_ptr<BlobStorageClient> client =
+      std::make_unique<FileBlobStorageClient>();
+  BlobStorageClient::DataLocation location{
+      .bucket = ::testing::TempDir(),
+      .key = "missing",
+  };
+  EXPECT_EQ(client->GetBlobReader(location), nullptr);
+}
+
+TEST(LocalBlobStorageClientTest, DownloadBlob) {
+  std::unique_ptr<BlobStorageClient> client =
+      std::make_unique<FileBlobStorageClient>();
+  CreateFileInTmpDir("downloaded");
+  BlobStorageClient::DataLocation location{
+      .bucket = ::testing::TempDir(),
+      .key = "downloaded",
+  };
+  auto contents = client->DownloadBlob(location);
+  ASSERT_TRUE(contents.ok()) << contents.status();
+  EXPECT_EQ(**contents, "arbitrary file contents");
+}
+
+TEST(LocalBlobStorageClientTest, DownloadMissingBlob) {
+  std::unique_ptr<BlobStorageClient> client =
+      std::make_unique<FileBlobStorageClient>();
+  BlobStorageClient::DataLocation location{
+      .bucket = ::testing::TempDir(),
+      .key = "missing",
+  };
+  EXPECT_EQ(client->DownloadBlob(location).status().code(),
+            absl::StatusCode::kNotFound);
+}
+
 // TODO(237669491): Add tests here
 
 }  // namespace
@@ -14,25 +14,38 @@
 
 #include "components/data/blob_storage/blob_storage_client_s3.h"
 
+#include <algorithm>
 #include <cstdint>
 #include <iostream>
+#include <memory>
+#include <string>
 #include <thread>
 #include <utility>
+#include <vector>
 
 #include "absl/log/log.h"
 #include "absl/strings/match.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_split.h"
+#include "absl/synchronization/mutex.h"
 #include "aws/core/Aws.h"
+#include "aws/core/utils/memory/AWSMemory.h"
+#include "aws/core/utils/stream/PreallocatedStreamBuf.h"
 #include "aws/core/utils/threading/Executor.h"
 #include "aws/s3/S3Client.h"
+#include "aws/s3/model/AbortMultipartUploadRequest.h"
 #include "aws/s3/model/Bucket.h"
+#include "aws/s3/model/CompleteMultipartUploadRequest.h"
+#include "aws/s3/model/CompletedMultipartUpload.h"
+#include "aws/s3/model/CompletedPart.h"
+#include "aws/s3/model/CreateMultipartUploadRequest.h"
 #include "aws/s3/model/DeleteObjectRequest.h"
 #include "aws/s3/model/GetObjectRequest.h"
 #include "aws/s3/model/HeadObjectRequest.h"
 #include "aws/s3/model/ListObjectsV2Request.h"
 #include "aws/s3/model/Object.h"
 #include "aws/s3/model/PutObjectRequest.h"
+#include "aws/s3/model/UploadPartRequest.h"
 #include "aws/transfer/TransferHandle.h"
 #include "aws/transfer/TransferManager.h"
 #include "components/data/blob_storage/blob_prefix_allowlist.h"
@@ -43,10 +56,43 @@
 namespace kv_server {
 namespace {
 
+constexpr char kReadChunkAllocationTag[] = "S3BlobInputStreamBuf";
+constexpr char kDownloadAllocationTag[] = "S3BlobDownload";
+constexpr char kUploadAllocationTag[] = "S3BlobUpload";
+// Smallest part S3 accepts in a multipart upload, other than the last one.
+constexpr int64_t kMinUploadPartBytes = 5 * 1024 * 1024;
+
 std::string AppendPrefix(const std::string& value, const std::string& prefix) {
   return prefix.empty() ? value : absl::StrCat(prefix, "/", value);
 }
 
+// Reads the next part of `stream` into `part`, which is shrunk to the bytes
+// read if the stream ends first.
+absl::Status ReadPart(std::istream& stream, std::string& part) {
+  stream.read(part.data(), part.size());
+  if (stream.bad()) {
+    return absl::DataLossError("Failed to read the blob to upload.");
+  }
+  part.resize(stream.gcount());
+  return absl::OkStatus();
+}
+
+// Request body that the SDK reads straight out of `part`. `part` must outlive
+// the request.
+class PartBody {
+ public:
+  explicit PartBody(std::string& part)
+      : streambuf_(reinterpret_cast<unsigned char*>(part.data()),
+                   part.size()) {}
+
+  std::shared_ptr<Aws::IOStream> Stream() {
+    return Aws::MakeShared<Aws::IOStream>(kUploadAllocationTag, &streambuf_);
+  }
+
+ private:
+  Aws::Utils::Stream::PreallocatedStreamBuf streambuf_;
+};
+
 // Sequentially load byte range data with a fixed amount of memory usage.
 class S3BlobInputStreamBuf : public SeekingInputStreambuf {
  public:
@@ -56,6 +102,7 @@ class S3BlobInputStreamBuf : public SeekingInputStreambuf {
       : SeekingInputStreambuf(std::move(options)),
         client_(client),
         location_(std::move(location)) {}
+  ~S3BlobInputStreamBuf() override { WaitForReadAheads(); }
 
   S3BlobInputStreamBuf(const S3BlobInputStreamBuf&) = delete;
   S3BlobInputStreamBuf& operator=(const S3BlobInputStreamBuf&) = delete;
@@ -78,16 +125,20 @@ class S3BlobInputStreamBuf : public SeekingInputStreambuf {
     request.SetBucket(location_.bucket);
     request.SetKey(AppendPrefix(location_.key, location_.prefix));
     request.SetRange(GetRange(offset, chunk_size));
+    // The SDK writes the body straight into `dest_buffer` instead of into a
+    // stream of its own that would then be copied.
+    Aws::Utils::Stream::PreallocatedStreamBuf dest_streambuf(
+        reinterpret_cast<unsigned char*>(dest_buffer), chunk_size);
+    request.SetResponseStreamFactory([&dest_streambuf]() {
+      // Retries write the body again from the start.
+      dest_streambuf.pubseekpos(0, std::ios_base::out);
+      return Aws::New<Aws::IOStream>(kReadChunkAllocationTag, &dest_streambuf);
+    });
     auto outcome = client_.GetObject(request);
     if (!outcome.IsSuccess()) {
       return AwsErrorToStatus(outcome.GetError());
     }
-    auto& stream = outcome.GetResultWithOwnership().GetBody();
-    stream.seekg(0, stream.end);
-    const uint64_t bytes_read = stream.tellg();
-    stream.seekg(0, stream.beg);
-    stream.read(dest_buffer, bytes_read);
-    return bytes_read;
+    return outcome.GetResult().GetContentLength();
   }
 
  private:
@@ -107,10 +158,12 @@ class S3BlobReader : public BlobReader {
  public:
   S3BlobReader(Aws::S3::S3Client& client,
                BlobStorageClient::DataLocation location,
-               int64_t max_range_bytes)
+               int64_t max_range_bytes, int64_t num_read_ahead_chunks,
+               ThreadPool* read_ahead_executor)
       : BlobReader(),
         streambuf_(client, location,
-                   GetOptions(max_range_bytes,
+                   GetOptions(max_range_bytes, num_read_ahead_chunks,
+                              read_ahead_executor,
                               [this, location](absl::Status status) {
                                 LOG(ERROR) << "Blob " << location.key
                                            << " failed stream with: " << status;
@@ -123,9 +176,13 @@ class S3BlobReader : public BlobReader {
 
  private:
   static SeekingInputStreambuf::Options GetOptions(
-      int64_t buffer_size, std::function<void(absl::Status)> error_callback) {
+      int64_t buffer_size, int64_t num_read_ahead_chunks,
+      ThreadPool* read_ahead_executor,
+      std::function<void(absl::Status)> error_callback) {
     SeekingInputStreambuf::Options options;
     options.buffer_size = buffer_size;
+    options.num_read_ahead_chunks = num_read_ahead_chunks;
+    options.read_ahead_executor = read_ahead_executor;
     options.error_callback = std::move(error_callback);
     return options;
   }
@@ -136,32 +193,44 @@ class S3BlobReader : public BlobReader {
 }  // namespace
 
 S3BlobStorageClient::S3BlobStorageClient(
-    std::shared_ptr<Aws::S3::S3Client> client, int64_t max_range_bytes)
-    : client_(client), max_range_bytes_(max_range_bytes) {
+    std::shared_ptr<Aws::S3::S3Client> client, int64_t max_range_bytes,
+    int64_t num_read_ahead_chunks, int64_t upload_part_bytes,
+    int64_t max_concurrent_upload_parts)
+    : client_(client),
+      max_range_bytes_(max_range_bytes),
+      num_read_ahead_chunks_(num_read_ahead_chunks),
+      upload_part_bytes_(std::max<int64_t>(upload_part_bytes, 1)),
+      max_concurrent_upload_parts_(
+          std::max<int64_t>(max_concurrent_upload_parts, 1)) {
+  if (num_read_ahead_chunks_ > 0) {
+    read_ahead_executor_ =
+        std::make_unique<ThreadPool>(std::thread::hardware_concurrency());
+  }
+  upload_executor_ = std::make_unique<ThreadPool>(max_concurrent_upload_parts_);
   executor_ = std::make_unique<Aws::Utils::Threading::PooledThreadExecutor>(
       std::thread::hardware_concurrency());
   Aws::Transfer::TransferManagerConfiguration transfer_config(executor_.get());
   transfer_config.s3Client = client_;
+  // Lets every executor thread transfer a part at once.
+  transfer_config.transferBufferMaxHeapSize =
+      transfer_config.bufferSize * std::thread::hardware_concurrency();
   transfer_manager_ = Aws::Transfer::TransferManager::Create(transfer_config);
 }
 
 std::unique_ptr<BlobReader> S3BlobStorageClient::GetBlobReader(
     DataLocation location) {
-  return std::make_unique<S3BlobReader>(*client_, std::move(location),
-                                        max_range_bytes_);
+  return std::make_unique<S3BlobReader>(
+      *client_, std::move(location), max_range_bytes_, num_read_ahead_chunks_,
+      read_ahead_executor_.get());
 }
 
 absl::Status S3BlobStorageClient::PutBlob(BlobReader& reader,
                                           DataLocation location) {
-  std::unique_ptr<std::iostream> iostream;
-  std::stringstream ss;
-  if (reader.CanSeek()) {
-    iostream = std::make_unique<std::iostream>(reader.Stream().rdbuf());
-  } else {
-    // TODO: Do a manual multipart upload
-    ss << reader.Stream().rdbuf();
-    iostream = std::make_unique<std::iostream>(ss.rdbuf());
+  if (!reader.CanSeek()) {
+    return UploadStream(reader.Stream(), location.bucket,
+                        AppendPrefix(location.key, location.prefix));
   }
+  auto iostream = std::make_unique<std::iostream>(reader.Stream().rdbuf());
   // S3 requires a shared_pointer, other platforms do not.
   // Wrap the raw pointer as a shared_ptr and don't deallocate.
   // The owner of the stream is the caller.
@@ -174,6 +243,116 @@ absl::Status S3BlobStorageClient::PutBlob(BlobReader& reader,
   return success ? absl::OkStatus() : AwsErrorToStatus(handle->GetLastError());
 }
 
+absl::Status S3BlobStorageClient::UploadStream(std::istream& stream,
+                                               const std::string& bucket,
+                                               const std::string& key) {
+  auto part = std::make_unique<std::string>(upload_part_bytes_, '\0');
+  if (auto status = ReadPart(stream, *part); !status.ok()) {
+    return status;
+  }
+  if (static_cast<int64_t>(part->size()) < upload_part_bytes_) {
+    Aws::S3::Model::PutObjectRequest request;
+    request.SetBucket(bucket);
+    request.SetKey(key);
+    PartBody body(*part);
+    request.SetBody(body.Stream());
+    request.SetContentLength(part->size());
+    const auto outcome = client_->PutObject(request);
+    return outcome.IsSuccess() ? absl::OkStatus()
+                               : AwsErrorToStatus(outcome.GetError());
+  }
+  Aws::S3::Model::CreateMultipartUploadRequest create_request;
+  create_request.SetBucket(bucket);
+  create_request.SetKey(key);
+  const auto create_outcome = client_->CreateMultipartUpload(create_request);
+  if (!create_outcome.IsSuccess()) {
+    return AwsErrorToStatus(create_outcome.GetError());
+  }
+  const std::string upload_id = create_outcome.GetResult().GetUploadId();
+
+  // Parts are read on this thread while up to `max_concurrent_upload_parts_`
+  // earlier ones upload, which bounds the memory used by the upload.
+  absl::Mutex mutex;
+  int64_t num_uploading = 0;
+  absl::Status status;
+  std::vector<Aws::S3::Model::CompletedPart> completed_parts;
+  const auto can_read_part = [&]() {
+    return num_uploading < max_concurrent_upload_parts_ || !status.ok();
+  };
+  for (int part_number = 1; !part->empty(); part_number++) {
+    {
+      absl::MutexLock lock(&mutex);
+      completed_parts.emplace_back().SetPartNumber(part_number);
+      num_uploading++;
+    }
+    upload_executor_->Schedule([&, part_number, part = std::move(part)]() {
+      Aws::S3::Model::UploadPartRequest request;
+      request.SetBucket(bucket);
+      request.SetKey(key);
+      request.SetUploadId(upload_id);
+      request.SetPartNumber(part_number);
+      PartBody body(*part);
+      request.SetBody(body.Stream());
+      request.SetContentLength(part->size());
+      const auto outcome = client_->UploadPart(request);
+      absl::MutexLock lock(&mutex);
+      if (outcome.IsSuccess()) {
+        completed_parts[part_number - 1].SetETag(
+            outcome.GetResult().GetETag());
+      } else if (status.ok()) {
+        status = AwsErrorToStatus(outcome.GetError());
+      }
+      num_uploading--;
+    });
+    {
+      absl::MutexLock lock(&mutex);
+      mutex.Await(absl::Condition(&can_read_part));
+      if (!status.ok()) {
+        break;
+      }
+    }
+    part = std::make_unique<std::string>(upload_part_bytes_, '\0');
+    if (auto read_status = ReadPart(stream, *part); !read_status.ok()) {
+      absl::MutexLock lock(&mutex);
+      status = read_status;
+      break;
+    }
+  }
+  {
+    absl::MutexLock lock(&mutex);
+    mutex.Await(absl::Condition(
+        +[](int64_t* num_uploading) { return *num_uploading == 0; },
+        &num_uploading));
+  }
+
+  if (status.ok()) {
+    Aws::S3::Model::CompletedMultipartUpload completed_upload;
+    completed_upload.SetParts(std::move(completed_parts));
+    Aws::S3::Model::CompleteMultipartUploadRequest complete_request;
+    complete_request.SetBucket(bucket);
+    complete_request.SetKey(key);
+    complete_request.SetUploadId(upload_id);
+    complete_request.SetMultipartUpload(std::move(completed_upload));
+    const auto complete_outcome =
+        client_->CompleteMultipartUpload(complete_request);
+    if (complete_outcome.IsSuccess()) {
+      return absl::OkStatus();
+    }
+    status = AwsErrorToStatus(complete_outcome.GetError());
+  }
+  // Otherwise S3 keeps, and bills, the parts already uploaded.
+  Aws::S3::Model::AbortMultipartUploadRequest abort_request;
+  abort_request.SetBucket(bucket);
+  abort_request.SetKey(key);
+  abort_request.SetUploadId(upload_id);
+  if (const auto abort_outcome = client_->AbortMultipartUpload(abort_request);
+      !abort_outcome.IsSuccess()) {
+    LOG(ERROR) << "Failed to abort the upload of " << key << ": "
+               << AwsErrorToStatus(abort_outcome.GetError());
+  }
+  return status;
+}
+
 absl::Status S3BlobStorageClient::DeleteBlob(DataLocation location) {
   Aws::S3::Model::DeleteObjectRequest request;
   request.SetBucket(std::move(location.bucket));
@@ -183,6 +362,45 @@ absl::Status S3BlobStorageClient::DeleteBlob(DataLocation location) {
                              : AwsErrorToStatus(outcome.GetError());
 }
 
+absl::StatusOr<std::string> S3BlobStorageClient::GetBlobETag(
+    DataLocation location) {
+  Aws::S3::Model::HeadObjectRequest request;
+  request.SetBucket(std::move(location.bucket));
+  request.SetKey(AppendPrefix(location.key, location.prefix));
+  auto outcome = client_->HeadObject(request);
+  if (!outcome.IsSuccess()) {
+    return AwsErrorToStatus(outcome.GetError());
+  }
+  return outcome.GetResult().GetETag();
+}
+
+absl::StatusOr<std::shared_ptr<const std::string>>
+S3BlobStorageClient::DownloadBlob(DataLocation location) {
+  const std::string key = AppendPrefix(location.key, location.prefix);
+  Aws::S3::Model::HeadObjectRequest request;
+  request.SetBucket(location.bucket);
+  request.SetKey(key);
+  auto outcome = client_->HeadObject(request);
+  if (!outcome.IsSuccess()) {
+    return AwsErrorToStatus(outcome.GetError());
+  }
+  auto contents = std::make_shared<std::string>(
+      outcome.GetResult().GetContentLength(), '\0');
+  // The transfer manager downloads parts of the blob in parallel and writes
+  // each one at its offset, straight into `contents`.
+  Aws::Utils::Stream::PreallocatedStreamBuf dest_streambuf(
+      reinterpret_cast<unsigned char*>(contents->data()), contents->size());
+  auto handle = transfer_manager_->DownloadFile(
+      location.bucket, key, [&dest_streambuf]() {
+        return Aws::New<Aws::IOStream>(kDownloadAllocationTag, &dest_streambuf);
+      });
+  handle->WaitUntilFinished();
+  if (handle->GetStatus() != Aws::Transfer::TransferStatus::COMPLETED) {
+    return AwsErrorToStatus(handle->GetLastError());
+  }
+  return contents;
+}
+
 absl::StatusOr<std::vector<std::string>> S3BlobStorageClient::ListBlobs(
     DataLocation location, ListOptions options) {
   Aws::S3::Model::ListObjectsV2Request request;
@@ -231,7 +449,10 @@ class S3BlobStorageClientFactory : public BlobStorageClientFactory {
         std::make_shared<Aws::S3::S3Client>(config);
 
     return std::make_unique<S3BlobStorageClient>(
-        client, client_options.max_range_bytes);
+        client, client_options.max_range_bytes,
+        client_options.num_read_ahead_chunks,
+        std::max(client_options.upload_part_bytes, kMinUploadPartBytes),
+        client_options.max_concurrent_upload_parts);
   }
 };
 }  // namespace
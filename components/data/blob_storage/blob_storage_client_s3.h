@@ -25,18 +25,26 @@
 #include "aws/s3/S3Client.h"
 #include "aws/transfer/TransferManager.h"
 #include "components/data/blob_storage/blob_storage_client.h"
+#include "components/util/thread_pool.h"
 
 namespace kv_server {
 
 class S3BlobStorageClient : public BlobStorageClient {
  public:
   explicit S3BlobStorageClient(std::shared_ptr<Aws::S3::S3Client> client,
-                               int64_t max_range_bytes);
+                               int64_t max_range_bytes,
+                               int64_t num_read_ahead_chunks = 0,
+                               int64_t upload_part_bytes =
+                                   ClientOptions().upload_part_bytes,
+                               int64_t max_concurrent_upload_parts =
+                                   ClientOptions().max_concurrent_upload_parts);
 
   ~S3BlobStorageClient() = default;
 
   std::unique_ptr<BlobReader> GetBlobReader(DataLocation location) override;
 
+  // Streams which cannot seek are uploaded in parts as they are read, see
+  // `ClientOptions::upload_part_bytes`.
   absl::Status PutBlob(BlobReader& reader, DataLocation location) override;
 
   absl::Status DeleteBlob(DataLocation location) override;
@@ -44,12 +52,30 @@ class S3BlobStorageClient : public BlobStorageClient {
   absl::StatusOr<std::vector<std::string>> ListBlobs(
       DataLocation location, ListOptions options) override;
 
+  absl::StatusOr<std::string> GetBlobETag(DataLocation location) override;
+
+  // Downloads the parts of the blob in parallel with the transfer manager.
+  absl::StatusOr<std::shared_ptr<const std::string>> DownloadBlob(
+      DataLocation location) override;
+
  private:
+  // Uploads `stream` in a multipart upload of parts of `upload_part_bytes_`,
+  // or in a single request if it is shorter than a part.
+  absl::Status UploadStream(std::istream& stream, const std::string& bucket,
+                            const std::string& key);
+
   // TODO: Consider switch to CRT client.
   // AWS API requires shared_ptr
   std::unique_ptr<Aws::Utils::Threading::PooledThreadExecutor> executor_;
   std::shared_ptr<Aws::S3::S3Client> client_;
   std::shared_ptr<Aws::Transfer::TransferManager> transfer_manager_;
   int64_t max_range_bytes_;
+  int64_t num_read_ahead_chunks_;
+  int64_t upload_part_bytes_;
+  int64_t max_concurrent_upload_parts_;
+  // Reads blob ranges ahead for all readers. Null if read-ahead is disabled.
+  std::unique_ptr<ThreadPool> read_ahead_executor_;
+  // Uploads the parts of streams which cannot seek.
+  std::unique_ptr<ThreadPool> upload_executor_;
 };
 }  // namespace kv_server
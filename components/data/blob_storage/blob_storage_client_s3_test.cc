@@ -17,18 +17,29 @@
 #include "components/data/blob_storage/blob_storage_client_s3.h"
 
 #include <algorithm>
+#include <iterator>
+#include <sstream>
 #include <string>
 #include <utility>
 
 #include "absl/flags/flag.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/synchronization/mutex.h"
+#include "aws/core/AmazonWebServiceRequest.h"
 #include "aws/core/Aws.h"
 #include "aws/s3/S3Client.h"
+#include "aws/s3/model/AbortMultipartUploadRequest.h"
+#include "aws/s3/model/CompleteMultipartUploadRequest.h"
+#include "aws/s3/model/CreateMultipartUploadRequest.h"
 #include "aws/s3/model/DeleteObjectRequest.h"
 #include "aws/s3/model/ListObjectsV2Request.h"
 #include "aws/s3/model/Object.h"
+#include "aws/s3/model/PutObjectRequest.h"
+#include "aws/s3/model/UploadPartRequest.h"
 #include "components/data/blob_storage/blob_storage_client.h"
+#include "components/data/common/mocks.h"
 #include "components/telemetry/server_definition.h"
 #include "components/util/platform_initializer.h"
 #include "gmock/gmock.h"
@@ -38,7 +49,10 @@ namespace kv_server {
 namespace {
 
 using testing::AllOf;
+using testing::ElementsAre;
 using testing::Property;
+using testing::Return;
+using testing::ReturnRef;
 
 constexpr int64_t kMaxRangeBytes = 1024 * 1024 * 8;
 
@@ -51,8 +65,35 @@ class MockS3Client : public ::Aws::S3::S3Client {
   MOCK_METHOD(Aws::S3::Model::ListObjectsV2Outcome, ListObjectsV2,
               (const Aws::S3::Model::ListObjectsV2Request& request),
               (const, override));
+
+  MOCK_METHOD(Aws::S3::Model::PutObjectOutcome, PutObject,
+              (const Aws::S3::Model::PutObjectRequest& request),
+              (const, override));
+
+  MOCK_METHOD(Aws::S3::Model::CreateMultipartUploadOutcome,
+              CreateMultipartUpload,
+              (const Aws::S3::Model::CreateMultipartUploadRequest& request),
+              (const, override));
+
+  MOCK_METHOD(Aws::S3::Model::UploadPartOutcome, UploadPart,
+              (const Aws::S3::Model::UploadPartRequest& request),
+              (const, override));
+
+  MOCK_METHOD(Aws::S3::Model::CompleteMultipartUploadOutcome,
+              CompleteMultipartUpload,
+              (const Aws::S3::Model::CompleteMultipartUploadRequest& request),
+              (const, override));
+
+  MOCK_METHOD(Aws::S3::Model::AbortMultipartUploadOutcome,
+              AbortMultipartUpload,
+              (const Aws::S3::Model::AbortMultipartUploadRequest& request),
+              (const, override));
 };
 
+std::string ReadBody(const Aws::AmazonWebServiceRequest& request) {
+  return std::string(std::istreambuf_iterator<char>(*request.GetBody()), {});
+}
+
 class BlobStorageClientS3Test : public ::testing::Test {
  protected:
   PlatformInitializer initializer_;
@@ -220,5 +261,100 @@ TEST_F(BlobStorageClientS3Test, ListBlobsWithPrefixSucceeds) {
               testing::UnorderedElementsAreArray({"DELTA_1699834075511696"}));
 }
 
+TEST_F(BlobStorageClientS3Test, PutBlobUploadsShortStreamInOneRequest) {
+  auto mock_s3_client = std::make_shared<MockS3Client>();
+  EXPECT_CALL(*mock_s3_client, PutObject)
+      .WillOnce([](const Aws::S3::Model::PutObjectRequest& request) {
+        EXPECT_EQ(request.GetBucket(), "bucket");
+        EXPECT_EQ(request.GetKey(), "directory1/blob");
+        EXPECT_EQ(ReadBody(request), "abc");
+        return Aws::S3::Model::PutObjectResult();
+      });
+  EXPECT_CALL(*mock_s3_client, CreateMultipartUpload).Times(0);
+
+  S3BlobStorageClient client(mock_s3_client, kMaxRangeBytes,
+                             /*num_read_ahead_chunks=*/0,
+                             /*upload_part_bytes=*/4);
+  std::stringstream stream("abc");
+  MockBlobReader reader;
+  EXPECT_CALL(reader, CanSeek).WillRepeatedly(Return(false));
+  EXPECT_CALL(reader, Stream).WillRepeatedly(ReturnRef(stream));
+  EXPECT_TRUE(client
+                  .PutBlob(reader, {.bucket = "bucket",
+                                    .prefix = "directory1",
+                                    .key = "blob"})
+                  .ok());
+}
+
+TEST_F(BlobStorageClientS3Test, PutBlobUploadsStreamInParts) {
+  auto mock_s3_client = std::make_shared<MockS3Client>();
+  Aws::S3::Model::CreateMultipartUploadResult create_result;
+  create_result.SetUploadId("upload");
+  EXPECT_CALL(*mock_s3_client, CreateMultipartUpload)
+      .WillOnce(Return(create_result));
+  absl::Mutex mutex;
+  std::vector<std::string> parts(3);
+  EXPECT_CALL(*mock_s3_client, UploadPart)
+      .Times(3)
+      .WillRepeatedly([&](const Aws::S3::Model::UploadPartRequest& request) {
+        EXPECT_EQ(request.GetUploadId(), "upload");
+        absl::MutexLock lock(&mutex);
+        parts[request.GetPartNumber() - 1] = ReadBody(request);
+        Aws::S3::Model::UploadPartResult result;
+        result.SetETag(absl::StrCat("etag", request.GetPartNumber()));
+        return result;
+      });
+  EXPECT_CALL(*mock_s3_client, CompleteMultipartUpload)
+      .WillOnce(
+          [](const Aws::S3::Model::CompleteMultipartUploadRequest& request) {
+            EXPECT_EQ(request.GetUploadId(), "upload");
+            std::vector<std::string> etags;
+            for (const auto& part : request.GetMultipartUpload().GetParts()) {
+              etags.push_back(part.GetETag());
+            }
+            EXPECT_THAT(etags, ElementsAre("etag1", "etag2", "etag3"));
+            return Aws::S3::Model::CompleteMultipartUploadResult();
+          });
+  EXPECT_CALL(*mock_s3_client, AbortMultipartUpload).Times(0);
+
+  S3BlobStorageClient client(mock_s3_client, kMaxRangeBytes,
+                             /*num_read_ahead_chunks=*/0,
+                             /*upload_part_bytes=*/4,
+                             /*max_concurrent_upload_parts=*/2);
+  std::stringstream stream("abcdefghij");
+  MockBlobReader reader;
+  EXPECT_CALL(reader, CanSeek).WillRepeatedly(Return(false));
+  EXPECT_CALL(reader, Stream).WillRepeatedly(ReturnRef(stream));
+  EXPECT_TRUE(client.PutBlob(reader, {.bucket = "bucket", .key = "blob"}).ok());
+  EXPECT_THAT(parts, ElementsAre("abcd", "efgh", "ij"));
+}
+
+TEST_F(BlobStorageClientS3Test, PutBlobAbortsUploadIfPartFails) {
+  auto mock_s3_client = std::make_shared<MockS3Client>();
+  Aws::S3::Model::CreateMultipartUploadResult create_result;
+  create_result.SetUploadId("upload");
+  EXPECT_CALL(*mock_s3_client, CreateMultipartUpload)
+      .WillOnce(Return(create_result));
+  // By default an error is returned for every part.
+  EXPECT_CALL(*mock_s3_client, UploadPart).Times(testing::AtLeast(1));
+  EXPECT_CALL(*mock_s3_client, CompleteMultipartUpload).Times(0);
+  EXPECT_CALL(*mock_s3_client,
+              AbortMultipartUpload(Property(
+                  &Aws::S3::Model::AbortMultipartUploadRequest::GetUploadId,
+                  "upload")))
+      .WillOnce(Return(Aws::S3::Model::AbortMultipartUploadResult()));
+
+  S3BlobStorageClient client(mock_s3_client, kMaxRangeBytes,
+                             /*num_read_ahead_chunks=*/0,
+                             /*upload_part_bytes=*/4,
+                             /*max_concurrent_upload_parts=*/1);
+  std::stringstream stream("abcdefghij");
+  MockBlobReader reader;
+  EXPECT_CALL(reader, CanSeek).WillRepeatedly(Return(false));
+  EXPECT_CALL(reader, Stream).WillRepeatedly(ReturnRef(stream));
+  EXPECT_EQ(client.PutBlob(reader, {.bucket = "bucket", .key = "blob"}).code(),
+            absl::StatusCode::kUnknown);
+}
+
 }  // namespace
 }  // namespace kv_server
@@ -0,0 +1,219 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/data/blob_storage/caching_blob_storage_client.h"
+
+#include <algorithm>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include "absl/log/log.h"
+#include "absl/strings/escaping.h"
+#include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
+#include "components/data/blob_storage/mapped_file_blob_reader.h"
+
+namespace kv_server {
+namespace {
+
+// Suffix of the files being downloaded.
+constexpr char kDownloadSuffix[] = ".download";
+
+}  // namespace
+
+CachingBlobStorageClient::CachingBlobStorageClient(
+    std::unique_ptr<BlobStorageClient> client, Options options)
+    : client_(std::move(client)), options_(std::move(options)) {}
+
+std::unique_ptr<BlobReader> CachingBlobStorageClient::GetBlobReader(
+    DataLocation location) {
+  absl::StatusOr<std::string> etag = client_->GetBlobETag(location);
+  if (!etag.ok() && !absl::IsUnimplemented(etag.status())) {
+    LOG(WARNING) << "Not caching blob " << location << ": " << etag.status();
+    return client_->GetBlobReader(std::move(location));
+  }
+  // Web-safe base64 never contains '.', so cached file names are the
+  // location and the ETag separated by a '.'.
+  const std::string file_name =
+      absl::StrCat(CachedFilePrefix(location), ".",
+                   etag.ok() ? absl::WebSafeBase64Escape(*etag) : "");
+  const std::filesystem::path path =
+      std::filesystem::path(options_.directory) / file_name;
+  std::shared_ptr<absl::Mutex> file_mutex;
+  {
+    absl::MutexLock lock(&mutex_);
+    std::shared_ptr<absl::Mutex>& mutex = file_mutexes_[file_name];
+    if (mutex == nullptr) {
+      mutex = std::make_shared<absl::Mutex>();
+    }
+    file_mutex = mutex;
+  }
+  absl::MutexLock file_lock(file_mutex.get());
+  std::error_code error_code;
+  if (!std::filesystem::exists(path, error_code)) {
+    if (const absl::Status status = Download(location, path); !status.ok()) {
+      LOG(WARNING) << "Failed to cache blob " << location << ": " << status;
+      return client_->GetBlobReader(std::move(location));
+    }
+  } else {
+    VLOG(2) << "Reading cached blob " << location << " from " << path;
+  }
+  absl::StatusOr<std::unique_ptr<MappedFileBlobReader>> reader =
+      MappedFileBlobReader::Create(path.string());
+  if (!reader.ok()) {
+    LOG(WARNING) << "Failed to read cached blob " << location << ": "
+                 << reader.status();
+    return client_->GetBlobReader(std::move(location));
+  }
+  return *std::move(reader);
+}
+
+absl::Status CachingBlobStorageClient::PutBlob(BlobReader& reader,
+                                               DataLocation location) {
+  return client_->PutBlob(reader, std::move(location));
+}
+
+absl::Status CachingBlobStorageClient::DeleteBlob(DataLocation location) {
+  RemoveCachedVersions(CachedFilePrefix(location), /*keep=*/"");
+  return client_->DeleteBlob(std::move(location));
+}
+
+absl::StatusOr<std::vector<std::string>> CachingBlobStorageClient::ListBlobs(
+    DataLocation location, ListOptions options) {
+  return client_->ListBlobs(std::move(location), std::move(options));
+}
+
+absl::StatusOr<std::string> CachingBlobStorageClient::GetBlobETag(
+    DataLocation location) {
+  return client_->GetBlobETag(std::move(location));
+}
+
+std::string CachingBlobStorageClient::CachedFilePrefix(
+    const DataLocation& location) {
+  return absl::WebSafeBase64Escape(
+      absl::StrCat(location.bucket, "/", location.prefix, "/", location.key));
+}
+
+absl::Status CachingBlobStorageClient::Download(
+    const DataLocation& location, const std::filesystem::path& path) {
+  std::error_code error_code;
+  std::filesystem::create_directories(options_.directory, error_code);
+  if (error_code) {
+    return absl::InternalError(absl::StrCat(
+        "Unable to create cache directory: ", error_code.message()));
+  }
+  std::unique_ptr<BlobReader> reader = client_->GetBlobReader(location);
+  if (reader == nullptr) {
+    return absl::NotFoundError("Unable to read blob.");
+  }
+  // Downloads to a temporary file renamed once complete, so that a crash
+  // never leaves a partial blob in the cache.
+  std::filesystem::path download_path = path;
+  download_path += kDownloadSuffix;
+  {
+    std::ofstream download(download_path,
+                           std::ios_base::binary | std::ios_base::trunc);
+    std::istream& stream = reader->Stream();
+    // Inserting an empty streambuf sets the failbit, so empty blobs are not
+    // inserted.
+    if (stream.peek() != std::istream::traits_type::eof()) {
+      download << stream.rdbuf();
+    }
+    download.close();
+    if (!download || stream.bad()) {
+      std::filesystem::remove(download_path, error_code);
+      return absl::DataLossError("Unable to download blob.");
+    }
+  }
+  RemoveCachedVersions(CachedFilePrefix(location), path);
+  std::filesystem::rename(download_path, path, error_code);
+  if (error_code) {
+    std::filesystem::remove(download_path, error_code);
+    return absl::InternalError(absl::StrCat(
+        "Unable to rename downloaded blob: ", error_code.message()));
+  }
+  VLOG(2) << "Cached blob " << location << " in " << path;
+  Evict(path);
+  return absl::OkStatus();
+}
+
+void CachingBlobStorageClient::RemoveCachedVersions(
+    const std::string& file_prefix, const std::filesystem::path& keep) {
+  const std::string versions_prefix = absl::StrCat(file_prefix, ".");
+  std::error_code error_code;
+  for (const auto& entry :
+       std::filesystem::directory_iterator(options_.directory, error_code)) {
+    const std::string file_name = entry.path().filename().string();
+    if (entry.path() == keep || !absl::StartsWith(file_name, versions_prefix) ||
+        absl::EndsWith(file_name, kDownloadSuffix)) {
+      continue;
+    }
+    std::error_code remove_error_code;
+    std::filesystem::remove(entry.path(), remove_error_code);
+  }
+}
+
+void CachingBlobStorageClient::Evict(const std::filesystem::path& keep) {
+  if (options_.max_size_bytes <= 0) {
+    return;
+  }
+  struct CachedFile {
+    std::filesystem::path path;
+    std::filesystem::file_time_type write_time;
+    int64_t size;
+  };
+  absl::MutexLock lock(&mutex_);
+  std::vector<CachedFile> files;
+  int64_t total_size = 0;
+  std::error_code error_code;
+  for (const auto& entry :
+       std::filesystem::directory_iterator(options_.directory, error_code)) {
+    if (!entry.is_regular_file(error_code) ||
+        absl::EndsWith(entry.path().filename().string(), kDownloadSuffix)) {
+      continue;
+    }
+    CachedFile file{
+        .path = entry.path(),
+        .write_time = entry.last_write_time(error_code),
+        .size = static_cast<int64_t>(entry.file_size(error_code)),
+    };
+    if (error_code) {
+      continue;
+    }
+    total_size += file.size;
+    if (file.path != keep) {
+      files.push_back(std::move(file));
+    }
+  }
+  std::sort(files.begin(), files.end(),
+            [](const CachedFile& a, const CachedFile& b) {
+              return a.write_time < b.write_time;
+            });
+  for (const CachedFile& file : files) {
+    if (total_size <= options_.max_size_bytes) {
+      break;
+    }
+    // Blobs being read stay readable, since their mappings outlive the file.
+    if (std::filesystem::remove(file.path, error_code)) {
+      VLOG(2) << "Evicted cached blob " << file.path;
+      total_size -= file.size;
+    }
+  }
+}
+
+}  // namespace kv_server
@@ -0,0 +1,92 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef COMPONENTS_DATA_BLOB_STORAGE_CACHING_BLOB_STORAGE_CLIENT_H_
+#define COMPONENTS_DATA_BLOB_STORAGE_CACHING_BLOB_STORAGE_CLIENT_H_
+
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/synchronization/mutex.h"
+#include "components/data/blob_storage/blob_storage_client.h"
+
+namespace kv_server {
+
+// Wraps a blob storage client with a cache of blobs on local disk, so that a
+// restarted server reads the blobs that did not change from disk instead of
+// downloading them again. Cached blobs are keyed by location and ETag, and
+// are read through memory mappings. The blobs of clients that do not support
+// ETags are assumed to never change. Reads fall back to `client` if the blob
+// cannot be cached.
+//
+// Safe to use from multiple threads.
+class CachingBlobStorageClient : public BlobStorageClient {
+ public:
+  struct Options {
+    // Directory of the cached blobs, created if missing.
+    std::string directory;
+    // If positive, the least recently cached blobs are evicted to keep the
+    // total size of the cache at most this.
+    int64_t max_size_bytes = 0;
+  };
+
+  CachingBlobStorageClient(std::unique_ptr<BlobStorageClient> client,
+                           Options options);
+
+  std::unique_ptr<BlobReader> GetBlobReader(DataLocation location) override;
+
+  absl::Status PutBlob(BlobReader& reader, DataLocation location) override;
+
+  // Also evicts the blob from the cache.
+  absl::Status DeleteBlob(DataLocation location) override;
+
+  absl::StatusOr<std::vector<std::string>> ListBlobs(
+      DataLocation location, ListOptions options) override;
+
+  absl::StatusOr<std::string> GetBlobETag(DataLocation location) override;
+
+ private:
+  // Returns the prefix of the names of the cached versions of `location`.
+  static std::string CachedFilePrefix(const DataLocation& location);
+
+  // Downloads `location` to `path` and removes its other cached versions.
+  absl::Status Download(const DataLocation& location,
+                        const std::filesystem::path& path);
+  // Removes the cached files named `file_prefix` followed by an ETag, except
+  // `keep`.
+  void RemoveCachedVersions(const std::string& file_prefix,
+                            const std::filesystem::path& keep);
+  // Evicts cached files other than `keep` until the cache fits in
+  // `Options::max_size_bytes`.
+  void Evict(const std::filesystem::path& keep) ABSL_LOCKS_EXCLUDED(mutex_);
+
+  std::unique_ptr<BlobStorageClient> client_;
+  const Options options_;
+  absl::Mutex mutex_;
+  // Serializes the downloads of each cached file.
+  absl::flat_hash_map<std::string, std::shared_ptr<absl::Mutex>> file_mutexes_
+      ABSL_GUARDED_BY(mutex_);
+};
+
+}  // namespace kv_server
+
+#endif  // COMPONENTS_DATA_BLOB_STORAGE_CACHING_BLOB_STORAGE_CLIENT_H_
@@ -0,0 +1,178 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/data/blob_storage/caching_blob_storage_client.h"
+
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "absl/status/status.h"
+#include "components/data/common/mocks.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace kv_server {
+namespace {
+
+using testing::_;
+using testing::Return;
+
+class StringBlobReader : public BlobReader {
+ public:
+  explicit StringBlobReader(std::string_view blob)
+      : stream_(std::string(blob)) {}
+  std::istream& Stream() override { return stream_; }
+  bool CanSeek() const override { return true; }
+
+ private:
+  std::stringstream stream_;
+};
+
+std::unique_ptr<BlobReader> NewStringBlobReader(std::string_view blob) {
+  return std::make_unique<StringBlobReader>(blob);
+}
+
+std::string ReadAll(BlobReader& reader) {
+  std::stringstream contents;
+  contents << reader.Stream().rdbuf();
+  return contents.str();
+}
+
+int64_t NumCachedFiles(const std::string& directory) {
+  int64_t num_files = 0;
+  for (const auto& entry : std::filesystem::directory_iterator(directory)) {
+    num_files++;
+  }
+  return num_files;
+}
+
+class CachingBlobStorageClientTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    const std::string test_name =
+        ::testing::UnitTest::GetInstance()->current_test_info()->name();
+    directory_ =
+        (std::filesystem::path(::testing::TempDir()) / test_name).string();
+    std::filesystem::remove_all(directory_);
+    auto mock_client = std::make_unique<MockBlobStorageClient>();
+    mock_client_ = mock_client.get();
+    client_ = std::make_unique<CachingBlobStorageClient>(
+        std::move(mock_client),
+        CachingBlobStorageClient::Options{.directory = directory_});
+  }
+
+  std::string directory_;
+  MockBlobStorageClient* mock_client_;
+  std::unique_ptr<CachingBlobStorageClient> client_;
+  const BlobStorageClient::DataLocation location_{.bucket = "bucket",
+                                                  .key = "DELTA_1"};
+};
+
+TEST_F(CachingBlobStorageClientTest, ReadsUnchangedBlobsFromCache) {
+  EXPECT_CALL(*mock_client_, GetBlobETag(location_))
+      .Times(2)
+      .WillRepeatedly(Return("v1"));
+  EXPECT_CALL(*mock_client_, GetBlobReader(location_))
+      .WillOnce(Return(NewStringBlobReader("contents")));
+  for (int i = 0; i < 2; i++) {
+    std::unique_ptr<BlobReader> reader = client_->GetBlobReader(location_);
+    ASSERT_NE(reader, nullptr);
+    ASSERT_TRUE(reader->Contents().has_value());
+    EXPECT_EQ(*reader->Contents(), "contents");
+    EXPECT_EQ(ReadAll(*reader), "contents");
+  }
+}
+
+TEST_F(CachingBlobStorageClientTest, DownloadsChangedBlobs) {
+  EXPECT_CALL(*mock_client_, GetBlobETag(location_))
+      .WillOnce(Return("v1"))
+      .WillOnce(Return("v2"));
+  EXPECT_CALL(*mock_client_, GetBlobReader(location_))
+      .WillOnce(Return(NewStringBlobReader("old")))
+      .WillOnce(Return(NewStringBlobReader("new")));
+  EXPECT_EQ(ReadAll(*client_->GetBlobReader(location_)), "old");
+  EXPECT_EQ(ReadAll(*client_->GetBlobReader(location_)), "new");
+  // The old version is removed.
+  EXPECT_EQ(NumCachedFiles(directory_), 1);
+}
+
+TEST_F(CachingBlobStorageClientTest, CachesBlobsOfClientsWithoutETags) {
+  EXPECT_CALL(*mock_client_, GetBlobETag(location_))
+      .Times(2)
+      .WillRepeatedly(Return(absl::UnimplementedError("")));
+  EXPECT_CALL(*mock_client_, GetBlobReader(location_))
+      .WillOnce(Return(NewStringBlobReader("contents")));
+  EXPECT_EQ(ReadAll(*client_->GetBlobReader(location_)), "contents");
+  EXPECT_EQ(ReadAll(*client_->GetBlobReader(location_)), "contents");
+}
+
+TEST_F(CachingBlobStorageClientTest, CachesEmptyBlobs) {
+  EXPECT_CALL(*mock_client_, GetBlobETag(location_))
+      .Times(2)
+      .WillRepeatedly(Return("v1"));
+  EXPECT_CALL(*mock_client_, GetBlobReader(location_))
+      .WillOnce(Return(NewStringBlobReader("")));
+  EXPECT_EQ(ReadAll(*client_->GetBlobReader(location_)), "");
+  EXPECT_EQ(client_->GetBlobReader(location_)->Contents(),
+            std::optional<std::string_view>(""));
+}
+
+TEST_F(CachingBlobStorageClientTest, ReadsUncachedOnETagErrors) {
+  EXPECT_CALL(*mock_client_, GetBlobETag(location_))
+      .WillOnce(Return(absl::UnavailableError("")));
+  EXPECT_CALL(*mock_client_, GetBlobReader(location_))
+      .WillOnce(Return(NewStringBlobReader("contents")));
+  std::unique_ptr<BlobReader> reader = client_->GetBlobReader(location_);
+  EXPECT_FALSE(reader->Contents().has_value());
+  EXPECT_EQ(ReadAll(*reader), "contents");
+  EXPECT_FALSE(std::filesystem::exists(directory_));
+}
+
+TEST_F(CachingBlobStorageClientTest, DeleteBlobEvictsIt) {
+  EXPECT_CALL(*mock_client_, GetBlobETag(location_)).WillOnce(Return("v1"));
+  EXPECT_CALL(*mock_client_, GetBlobReader(location_))
+      .WillOnce(Return(NewStringBlobReader("contents")));
+  EXPECT_CALL(*mock_client_, DeleteBlob(location_))
+      .WillOnce(Return(absl::OkStatus()));
+  ASSERT_NE(client_->GetBlobReader(location_), nullptr);
+  EXPECT_EQ(NumCachedFiles(directory_), 1);
+  EXPECT_TRUE(client_->DeleteBlob(location_).ok());
+  EXPECT_EQ(NumCachedFiles(directory_), 0);
+}
+
+TEST_F(CachingBlobStorageClientTest, EvictsBlobsOverMaxSize) {
+  auto mock_client = std::make_unique<MockBlobStorageClient>();
+  EXPECT_CALL(*mock_client, GetBlobETag(_)).WillRepeatedly(Return("v1"));
+  EXPECT_CALL(*mock_client, GetBlobReader(_))
+      .WillRepeatedly([](BlobStorageClient::DataLocation) {
+        return NewStringBlobReader("12345");
+      });
+  CachingBlobStorageClient client(
+      std::move(mock_client),
+      CachingBlobStorageClient::Options{.directory = directory_,
+                                        .max_size_bytes = 12});
+  for (std::string key : {"DELTA_1", "DELTA_2", "DELTA_3"}) {
+    EXPECT_EQ(ReadAll(*client.GetBlobReader({.bucket = "bucket", .key = key})),
+              "12345");
+  }
+  EXPECT_EQ(NumCachedFiles(directory_), 2);
+}
+
+}  // namespace
+}  // namespace kv_server
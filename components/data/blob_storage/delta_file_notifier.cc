@@ -19,6 +19,7 @@
 #include <utility>
 #include <vector>
 
+#include "absl/container/btree_set.h"
 #include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
 #include "absl/log/log.h"
@@ -41,13 +42,15 @@ class DeltaFileNotifierImpl : public DeltaFileNotifier {
                                  const absl::Duration poll_frequency,
                                  std::unique_ptr<SleepFor> sleep_for,
                                  SteadyClock& clock,
-                                 BlobPrefixAllowlist blob_prefix_allowlist)
+                                 BlobPrefixAllowlist blob_prefix_allowlist,
+                                 bool push_notifications)
       : thread_manager_(ThreadManager::Create("Delta file notifier")),
         client_(client),
         poll_frequency_(poll_frequency),
         sleep_for_(std::move(sleep_for)),
         clock_(clock),
-        blob_prefix_allowlist_(std::move(blob_prefix_allowlist)) {}
+        blob_prefix_allowlist_(std::move(blob_prefix_allowlist)),
+        push_notifications_(push_notifications) {}
 
   absl::Status Start(
       BlobStorageChangeNotifier& change_notifier,
@@ -58,6 +61,12 @@ class DeltaFileNotifierImpl : public DeltaFileNotifier {
         [this, location = std::move(location),
          prefix_start_after_map = std::move(prefix_start_after_map),
          callback = std::move(callback), &change_notifier]() mutable {
+          if (push_notifications_) {
+            WatchNotifications(change_notifier, std::move(location),
+                               std::move(prefix_start_after_map),
+                               std::move(callback));
+            return;
+          }
           Watch(change_notifier, std::move(location),
                 std::move(prefix_start_after_map), std::move(callback));
         });
@@ -87,6 +96,18 @@ class DeltaFileNotifierImpl : public DeltaFileNotifier {
       BlobStorageClient::DataLocation location,
       absl::flat_hash_map<std::string, std::string>&& prefix_start_after_map,
       std::function<void(const std::string& key)> callback);
+  // Calls `callback` on the delta files of notifications as they arrive, and
+  // lists the delta files after the ones listed before every
+  // `poll_frequency_` to find the files whose notifications were lost.
+  void WatchNotifications(
+      BlobStorageChangeNotifier& change_notifier,
+      BlobStorageClient::DataLocation location,
+      absl::flat_hash_map<std::string, std::string>&& prefix_start_after_map,
+      std::function<void(const std::string& key)> callback);
+  // Waits, at most `max_backoff_time`, after the `sequential_failures`th
+  // failure in a row to get notifications.
+  void BackOff(const absl::Status& status, uint32_t sequential_failures,
+               absl::Duration max_backoff_time);
 
   std::unique_ptr<ThreadManager> thread_manager_;
   BlobStorageClient& client_;
@@ -94,6 +115,7 @@ class DeltaFileNotifierImpl : public DeltaFileNotifier {
   std::unique_ptr<SleepFor> sleep_for_;
   SteadyClock& clock_;
   BlobPrefixAllowlist blob_prefix_allowlist_;
+  const bool push_notifications_;
 };
 
 absl::StatusOr<std::string> DeltaFileNotifierImpl::WaitForNotification(
@@ -148,6 +170,19 @@ absl::StatusOr<bool> DeltaFileNotifierImpl::ShouldListBlobs(
          IsDeltaFilename(notification_blob.key);
 }
 
+void DeltaFileNotifierImpl::BackOff(const absl::Status& status,
+                                    uint32_t sequential_failures,
+                                    absl::Duration max_backoff_time) {
+  const absl::Duration backoff_time = std::min(
+      max_backoff_time, ExponentialBackoffForRetry(sequential_failures));
+  LOG(ERROR) << "Failed to get delta file notifications: " << status
+             << ".  Waiting for " << backoff_time;
+  if (!sleep_for_->Duration(backoff_time)) {
+    LOG(ERROR) << "Failed to sleep for " << backoff_time
+               << ".  SleepFor invalid.";
+  }
+}
+
 absl::flat_hash_map<std::string, std::vector<std::string>> ListPrefixDeltaFiles(
     BlobStorageClient::DataLocation location,
     const BlobPrefixAllowlist& prefix_allowlist,
@@ -191,17 +226,8 @@ void DeltaFileNotifierImpl::Watch(
     const absl::StatusOr<bool> should_list_blobs =
         ShouldListBlobs(change_notifier, expiring_flag, prefix_start_after_map);
     if (!should_list_blobs.ok()) {
-      ++sequential_failures;
-      const absl::Duration backoff_time =
-          std::min(expiring_flag.GetTimeRemaining(),
-                   ExponentialBackoffForRetry(sequential_failures));
-      LOG(ERROR) << "Failed to get delta file notifications: "
-                 << should_list_blobs.status() << ".  Waiting for "
-                 << backoff_time;
-      if (!sleep_for_->Duration(backoff_time)) {
-        LOG(ERROR) << "Failed to sleep for " << backoff_time
-                   << ".  SleepFor invalid.";
-      }
+      BackOff(should_list_blobs.status(), ++sequential_failures,
+              expiring_flag.GetTimeRemaining());
       continue;
     }
     sequential_failures = 0;
@@ -230,24 +256,97 @@ void DeltaFileNotifierImpl::Watch(
   }
 }
 
+void DeltaFileNotifierImpl::WatchNotifications(
+    BlobStorageChangeNotifier& change_notifier,
+    BlobStorageClient::DataLocation location,
+    absl::flat_hash_map<std::string, std::string>&& prefix_start_after_map,
+    std::function<void(const std::string& key)> callback) {
+  LOG(INFO) << "Started to watch notifications of " << location;
+  // Delta files notified after the last listed one, per prefix. They are
+  // skipped when they are listed.
+  absl::flat_hash_map<std::string, absl::btree_set<std::string>>
+      prefix_notified_blobs;
+  // Flag starts expired, and forces an initial listing.
+  ExpiringFlag expiring_flag(clock_);
+  uint32_t sequential_failures = 0;
+  while (!thread_manager_->ShouldStop()) {
+    bool should_list_blobs = !expiring_flag.Get();
+    if (!should_list_blobs) {
+      absl::StatusOr<std::vector<std::string>> changes =
+          change_notifier.GetNotifications(
+              expiring_flag.GetTimeRemaining(),
+              [this]() { return thread_manager_->ShouldStop(); });
+      if (absl::IsDeadlineExceeded(changes.status())) {
+        VLOG(5) << "Reconciliation listing";
+        should_list_blobs = true;
+      } else if (!changes.ok()) {
+        BackOff(changes.status(), ++sequential_failures,
+                expiring_flag.GetTimeRemaining());
+        continue;
+      } else {
+        sequential_failures = 0;
+        std::sort(changes->begin(), changes->end());
+        for (const std::string& change : *changes) {
+          auto blob = ParseBlobName(change);
+          if (!blob_prefix_allowlist_.Contains(blob.prefix) ||
+              !IsDeltaFilename(blob.key)) {
+            continue;
+          }
+          if (auto iter = prefix_start_after_map.find(blob.prefix);
+              iter != prefix_start_after_map.end() &&
+              blob.key <= iter->second) {
+            // Ignore notifications for keys we've already listed.
+            continue;
+          }
+          if (prefix_notified_blobs[blob.prefix].insert(blob.key).second) {
+            callback(change);
+          }
+        }
+        continue;
+      }
+    }
+    expiring_flag.Set(poll_frequency_);
+    auto prefix_blobs_map = ListPrefixDeltaFiles(
+        location, blob_prefix_allowlist_, prefix_start_after_map, client_);
+    for (const auto& [prefix, prefix_blobs] : prefix_blobs_map) {
+      absl::btree_set<std::string>& notified_blobs =
+          prefix_notified_blobs[prefix];
+      std::string& start_after = prefix_start_after_map[prefix];
+      for (const auto& blob : prefix_blobs) {
+        if (!IsDeltaFilename(blob)) {
+          continue;
+        }
+        if (!notified_blobs.contains(blob)) {
+          VLOG(2) << "Found delta file without notification: " << blob;
+          callback(prefix.empty() ? blob : absl::StrCat(prefix, "/", blob));
+        }
+        start_after = std::max(start_after, blob);
+      }
+      notified_blobs.erase(notified_blobs.begin(),
+                           notified_blobs.upper_bound(start_after));
+    }
+  }
+}
+
 }  // namespace
 
 std::unique_ptr<DeltaFileNotifier> DeltaFileNotifier::Create(
     BlobStorageClient& client, const absl::Duration poll_frequency,
-    BlobPrefixAllowlist blob_prefix_allowlist) {
+    BlobPrefixAllowlist blob_prefix_allowlist, bool push_notifications) {
   return std::make_unique<DeltaFileNotifierImpl>(
       client, poll_frequency, std::make_unique<SleepFor>(),
-      SteadyClock::RealClock(), std::move(blob_prefix_allowlist));
+      SteadyClock::RealClock(), std::move(blob_prefix_allowlist),
+      push_notifications);
 }
 
 // For test only
 std::unique_ptr<DeltaFileNotifier> DeltaFileNotifier::Create(
     BlobStorageClient& client, const absl::Duration poll_frequency,
     std::unique_ptr<SleepFor> sleep_for, SteadyClock& clock,
-    BlobPrefixAllowlist blob_prefix_allowlist) {
+    BlobPrefixAllowlist blob_prefix_allowlist, bool push_notifications) {
   return std::make_unique<DeltaFileNotifierImpl>(
       client, poll_frequency, std::move(sleep_for), clock,
-      std::move(blob_prefix_allowlist));
+      std::move(blob_prefix_allowlist), push_notifications);
 }
 
 }  // namespace kv_server
@@ -59,17 +59,27 @@ class DeltaFileNotifier {
   // successful.
   virtual bool IsRunning() const = 0;
 
+  // By default, lists the new Delta files of `location` on every
+  // notification and every `poll_frequency`.
+  //
+  // With `push_notifications`, calls `callback` on the notified Delta files
+  // without listing them, and only lists the Delta files after the ones
+  // listed before every `poll_frequency` to find the files whose
+  // notifications were lost. Such files may be found after newer ones, so
+  // `callback` is not called in ascending order of the file name.
   static std::unique_ptr<DeltaFileNotifier> Create(
       BlobStorageClient& client,
       const absl::Duration poll_frequency = absl::Minutes(5),
-      BlobPrefixAllowlist blob_prefix_allowlist = BlobPrefixAllowlist(""));
+      BlobPrefixAllowlist blob_prefix_allowlist = BlobPrefixAllowlist(""),
+      bool push_notifications = false);
 
   // Used for test
   static std::unique_ptr<DeltaFileNotifier> Create(
       BlobStorageClient& client, const absl::Duration poll_frequency,
       std::unique_ptr<SleepFor> sleep_for,
       privacy_sandbox::server_common::SteadyClock& clock,
-      BlobPrefixAllowlist blob_prefix_allowlist = BlobPrefixAllowlist(""));
+      BlobPrefixAllowlist blob_prefix_allowlist = BlobPrefixAllowlist(""),
+      bool push_notifications = false);
 };
 
 }  // namespace kv_server
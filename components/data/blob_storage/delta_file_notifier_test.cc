@@ -365,5 +365,98 @@ TEST_F(DeltaFileNotifierTest, NotifiesWithNewPrefixedFiles) {
   EXPECT_FALSE(notifier_->IsRunning());
 }
 
+class PushDeltaFileNotifierTest : public DeltaFileNotifierTest {
+ protected:
+  void SetUp() override {
+    std::unique_ptr<MockSleepFor> mock_sleep_for =
+        std::make_unique<MockSleepFor>();
+    sleep_for_ = mock_sleep_for.get();
+    notifier_ = DeltaFileNotifier::Create(
+        client_, poll_frequency_, std::move(mock_sleep_for), sim_clock_,
+        BlobPrefixAllowlist(kBlobPrefix1), /*push_notifications=*/true);
+  }
+};
+
+TEST_F(PushDeltaFileNotifierTest, NotifiesWithoutListingFiles) {
+  EXPECT_CALL(change_notifier_, GetNotifications(_, _))
+      .WillOnce(Return(std::vector<std::string>({ToDeltaFileName(4).value(),
+                                                 ToDeltaFileName(3).value()})))
+      .WillOnce(Return(std::vector<std::string>(
+          {ToDeltaFileName(2).value(), ToDeltaFileName(3).value(),
+           ToDeltaFileName(5).value(), "DELTA_6"})))
+      .WillRepeatedly(Return(std::vector<std::string>()));
+  EXPECT_CALL(
+      client_,
+      ListBlobs(Field(&BlobStorageClient::DataLocation::prefix, ""),
+                Field(&BlobStorageClient::ListOptions::start_after,
+                      ToDeltaFileName(1).value())))
+      .WillOnce(Return(std::vector<std::string>({ToDeltaFileName(2).value()})));
+  EXPECT_CALL(
+      client_,
+      ListBlobs(Field(&BlobStorageClient::DataLocation::prefix, kBlobPrefix1),
+                Field(&BlobStorageClient::ListOptions::start_after, "")))
+      .WillOnce(Return(std::vector<std::string>()));
+
+  absl::Notification finished;
+  testing::MockFunction<void(const std::string& record)> callback;
+  {
+    testing::InSequence s;
+    EXPECT_CALL(callback, Call(ToDeltaFileName(2).value()));
+    EXPECT_CALL(callback, Call(ToDeltaFileName(3).value()));
+    EXPECT_CALL(callback, Call(ToDeltaFileName(4).value()));
+    EXPECT_CALL(callback, Call(ToDeltaFileName(5).value())).WillOnce([&]() {
+      finished.Notify();
+    });
+  }
+
+  absl::Status status = notifier_->Start(
+      change_notifier_, {.bucket = "testbucket"},
+      {std::make_pair("", initial_key_)}, callback.AsStdFunction());
+  ASSERT_TRUE(status.ok());
+  finished.WaitForNotification();
+  status = notifier_->Stop();
+  ASSERT_TRUE(status.ok());
+  EXPECT_FALSE(notifier_->IsRunning());
+}
+
+TEST_F(PushDeltaFileNotifierTest, ListsFilesWithLostNotifications) {
+  EXPECT_CALL(change_notifier_, GetNotifications(_, _))
+      .WillOnce(Return(std::vector<std::string>({ToDeltaFileName(3).value()})))
+      .WillOnce(Return(absl::DeadlineExceededError("too long")))
+      .WillRepeatedly(Return(std::vector<std::string>()));
+  EXPECT_CALL(
+      client_,
+      ListBlobs(Field(&BlobStorageClient::DataLocation::prefix, ""),
+                Field(&BlobStorageClient::ListOptions::start_after,
+                      ToDeltaFileName(1).value())))
+      .WillOnce(Return(std::vector<std::string>()))
+      .WillOnce(Return(std::vector<std::string>(
+          {ToDeltaFileName(2).value(), ToDeltaFileName(3).value()})));
+  EXPECT_CALL(
+      client_,
+      ListBlobs(Field(&BlobStorageClient::DataLocation::prefix, kBlobPrefix1),
+                Field(&BlobStorageClient::ListOptions::start_after, "")))
+      .WillRepeatedly(Return(std::vector<std::string>()));
+
+  absl::Notification finished;
+  testing::MockFunction<void(const std::string& record)> callback;
+  {
+    testing::InSequence s;
+    EXPECT_CALL(callback, Call(ToDeltaFileName(3).value()));
+    EXPECT_CALL(callback, Call(ToDeltaFileName(2).value())).WillOnce([&]() {
+      finished.Notify();
+    });
+  }
+
+  absl::Status status = notifier_->Start(
+      change_notifier_, {.bucket = "testbucket"},
+      {std::make_pair("", initial_key_)}, callback.AsStdFunction());
+  ASSERT_TRUE(status.ok());
+  finished.WaitForNotification();
+  status = notifier_->Stop();
+  ASSERT_TRUE(status.ok());
+  EXPECT_FALSE(notifier_->IsRunning());
+}
+
 }  // namespace
 }  // namespace kv_server
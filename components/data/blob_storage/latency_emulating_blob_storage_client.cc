@@ -0,0 +1,191 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/data/blob_storage/latency_emulating_blob_storage_client.h"
+
+#include <algorithm>
+#include <functional>
+#include <istream>
+#include <thread>
+#include <utility>
+
+#include "absl/log/log.h"
+#include "absl/strings/str_cat.h"
+#include "components/data/blob_storage/seeking_input_streambuf.h"
+
+namespace kv_server {
+namespace {
+
+// Reads ranges of the underlying blob, delaying each read like a range
+// request.
+class LatencyEmulatingStreambuf : public SeekingInputStreambuf {
+ public:
+  LatencyEmulatingStreambuf(std::unique_ptr<BlobReader> reader,
+                            std::function<void(int64_t)> delay,
+                            SeekingInputStreambuf::Options options)
+      : SeekingInputStreambuf(std::move(options)),
+        reader_(std::move(reader)),
+        delay_(std::move(delay)) {}
+  ~LatencyEmulatingStreambuf() override { WaitForReadAheads(); }
+
+  LatencyEmulatingStreambuf(const LatencyEmulatingStreambuf&) = delete;
+  LatencyEmulatingStreambuf& operator=(const LatencyEmulatingStreambuf&) =
+      delete;
+
+ protected:
+  absl::StatusOr<int64_t> SizeImpl() override {
+    delay_(0);
+    absl::MutexLock lock(&mutex_);
+    if (auto contents = reader_->Contents(); contents.has_value()) {
+      return contents->size();
+    }
+    std::istream& stream = reader_->Stream();
+    stream.clear();
+    stream.seekg(0, std::ios_base::end);
+    const int64_t size = stream.tellg();
+    if (size < 0) {
+      return absl::UnavailableError("Failed to get the size of the blob.");
+    }
+    return size;
+  }
+
+  // Reads ahead call this from multiple threads. Only the read from the
+  // underlying blob is serialized, not the delay.
+  absl::StatusOr<int64_t> ReadChunk(int64_t offset, int64_t chunk_size,
+                                    char* dest_buffer) override {
+    delay_(chunk_size);
+    absl::MutexLock lock(&mutex_);
+    if (auto contents = reader_->Contents(); contents.has_value()) {
+      return contents->copy(dest_buffer, chunk_size, offset);
+    }
+    std::istream& stream = reader_->Stream();
+    stream.clear();
+    stream.seekg(offset);
+    stream.read(dest_buffer, chunk_size);
+    if (stream.bad()) {
+      return absl::UnavailableError(
+          absl::StrCat("Failed to read the blob at offset ", offset));
+    }
+    return stream.gcount();
+  }
+
+ private:
+  absl::Mutex mutex_;
+  std::unique_ptr<BlobReader> reader_ ABSL_PT_GUARDED_BY(mutex_);
+  std::function<void(int64_t)> delay_;
+};
+
+class LatencyEmulatingBlobReader : public BlobReader {
+ public:
+  LatencyEmulatingBlobReader(std::unique_ptr<BlobReader> reader,
+                             std::function<void(int64_t)> delay,
+                             SeekingInputStreambuf::Options options)
+      : streambuf_(std::move(reader), std::move(delay),
+                   WithErrorCallback(std::move(options))),
+        stream_(&streambuf_) {}
+
+  std::istream& Stream() override { return stream_; }
+  bool CanSeek() const override { return true; }
+
+ private:
+  SeekingInputStreambuf::Options WithErrorCallback(
+      SeekingInputStreambuf::Options options) {
+    options.error_callback = [this](absl::Status status) {
+      LOG(ERROR) << "Blob failed stream with: " << status;
+      stream_.setstate(std::ios_base::badbit);
+    };
+    return options;
+  }
+
+  LatencyEmulatingStreambuf streambuf_;
+  std::istream stream_;
+};
+
+}  // namespace
+
+LatencyEmulatingBlobStorageClient::LatencyEmulatingBlobStorageClient(
+    std::unique_ptr<BlobStorageClient> client, Options options)
+    : client_(std::move(client)), options_(std::move(options)) {
+  if (options_.num_read_ahead_chunks > 0) {
+    read_ahead_executor_ =
+        std::make_unique<ThreadPool>(std::thread::hardware_concurrency());
+  }
+}
+
+std::unique_ptr<BlobReader> LatencyEmulatingBlobStorageClient::GetBlobReader(
+    DataLocation location) {
+  std::unique_ptr<BlobReader> reader =
+      client_->GetBlobReader(std::move(location));
+  if (reader == nullptr) {
+    return nullptr;
+  }
+  SeekingInputStreambuf::Options options;
+  options.buffer_size = options_.max_range_bytes;
+  options.num_read_ahead_chunks = options_.num_read_ahead_chunks;
+  options.read_ahead_executor = read_ahead_executor_.get();
+  return std::make_unique<LatencyEmulatingBlobReader>(
+      std::move(reader), [this](int64_t num_bytes) { Delay(num_bytes); },
+      std::move(options));
+}
+
+absl::Status LatencyEmulatingBlobStorageClient::PutBlob(BlobReader& reader,
+                                                        DataLocation location) {
+  Delay(0);
+  return client_->PutBlob(reader, std::move(location));
+}
+
+absl::Status LatencyEmulatingBlobStorageClient::DeleteBlob(
+    DataLocation location) {
+  Delay(0);
+  return client_->DeleteBlob(std::move(location));
+}
+
+absl::StatusOr<std::vector<std::string>>
+LatencyEmulatingBlobStorageClient::ListBlobs(DataLocation location,
+                                             ListOptions options) {
+  Delay(0);
+  return client_->ListBlobs(std::move(location), std::move(options));
+}
+
+absl::StatusOr<std::string> LatencyEmulatingBlobStorageClient::GetBlobETag(
+    DataLocation location) {
+  Delay(0);
+  return client_->GetBlobETag(std::move(location));
+}
+
+void LatencyEmulatingBlobStorageClient::Delay(int64_t num_bytes) {
+  const absl::Time now = absl::Now();
+  absl::Time end = now + options_.request_latency;
+  if (options_.request_bandwidth_bytes_per_second > 0) {
+    end += absl::Seconds(static_cast<double>(num_bytes) /
+                         options_.request_bandwidth_bytes_per_second);
+  }
+  {
+    absl::MutexLock lock(&mutex_);
+    if (options_.max_jitter > absl::ZeroDuration()) {
+      end += absl::Uniform(bit_gen_, 0.0, 1.0) * options_.max_jitter;
+    }
+    // Transfers share the total bandwidth in the order they start.
+    if (options_.total_bandwidth_bytes_per_second > 0 && num_bytes > 0) {
+      transfers_end_ =
+          std::max(transfers_end_, now + options_.request_latency) +
+          absl::Seconds(static_cast<double>(num_bytes) /
+                        options_.total_bandwidth_bytes_per_second);
+      end = std::max(end, transfers_end_);
+    }
+  }
+  absl::SleepFor(end - absl::Now());
+}
+
+}  // namespace kv_server
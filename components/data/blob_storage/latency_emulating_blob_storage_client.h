@@ -0,0 +1,89 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef COMPONENTS_DATA_BLOB_STORAGE_LATENCY_EMULATING_BLOB_STORAGE_CLIENT_H_
+#define COMPONENTS_DATA_BLOB_STORAGE_LATENCY_EMULATING_BLOB_STORAGE_CLIENT_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/random/random.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "components/data/blob_storage/blob_storage_client.h"
+#include "components/util/thread_pool.h"
+
+namespace kv_server {
+
+// Wraps a blob storage client so that every request to it takes as long as a
+// request to a cloud object store, to benchmark data loading from local blobs
+// under the latencies and bandwidths of S3 or GCS. Like the cloud storage
+// clients, blob readers read ranges of `Options::max_range_bytes`, one request
+// per range, so the underlying blobs must be seekable.
+//
+// Safe to use from multiple threads.
+class LatencyEmulatingBlobStorageClient : public BlobStorageClient {
+ public:
+  struct Options {
+    // Time to the first byte of every request.
+    absl::Duration request_latency = absl::ZeroDuration();
+    // Requests take up to this much longer, drawn uniformly.
+    absl::Duration max_jitter = absl::ZeroDuration();
+    // If positive, the most bytes per second transferred by each request.
+    int64_t request_bandwidth_bytes_per_second = 0;
+    // If positive, the most bytes per second transferred by all requests,
+    // e.g. the network bandwidth of the machine.
+    int64_t total_bandwidth_bytes_per_second = 0;
+    // Same as the fields of `ClientOptions`.
+    int64_t max_range_bytes = 8 * 1024 * 1024;  // 8MB
+    int64_t num_read_ahead_chunks = 0;
+  };
+
+  LatencyEmulatingBlobStorageClient(std::unique_ptr<BlobStorageClient> client,
+                                    Options options);
+
+  std::unique_ptr<BlobReader> GetBlobReader(DataLocation location) override;
+
+  absl::Status PutBlob(BlobReader& reader, DataLocation location) override;
+
+  absl::Status DeleteBlob(DataLocation location) override;
+
+  absl::StatusOr<std::vector<std::string>> ListBlobs(
+      DataLocation location, ListOptions options) override;
+
+  absl::StatusOr<std::string> GetBlobETag(DataLocation location) override;
+
+ private:
+  // Blocks for as long as a request transferring `num_bytes` takes.
+  void Delay(int64_t num_bytes) ABSL_LOCKS_EXCLUDED(mutex_);
+
+  std::unique_ptr<BlobStorageClient> client_;
+  const Options options_;
+  std::unique_ptr<ThreadPool> read_ahead_executor_;
+  absl::Mutex mutex_;
+  absl::BitGen bit_gen_ ABSL_GUARDED_BY(mutex_);
+  // Time the transfers scheduled so far within
+  // `Options::total_bandwidth_bytes_per_second` end.
+  absl::Time transfers_end_ ABSL_GUARDED_BY(mutex_) = absl::InfinitePast();
+};
+
+}  // namespace kv_server
+
+#endif  // COMPONENTS_DATA_BLOB_STORAGE_LATENCY_EMULATING_BLOB_STORAGE_CLIENT_H_
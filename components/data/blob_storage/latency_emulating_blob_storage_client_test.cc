@@ -0,0 +1,111 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/data/blob_storage/latency_emulating_blob_storage_client.h"
+
+#include <memory>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "components/data/common/mocks.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace kv_server {
+namespace {
+
+using testing::Return;
+
+class StringBlobReader : public BlobReader {
+ public:
+  explicit StringBlobReader(std::string_view blob)
+      : stream_(std::string(blob)) {}
+  std::istream& Stream() override { return stream_; }
+  bool CanSeek() const override { return true; }
+
+ private:
+  std::stringstream stream_;
+};
+
+std::string ReadAll(BlobReader& reader) {
+  std::stringstream contents;
+  contents << reader.Stream().rdbuf();
+  return contents.str();
+}
+
+std::unique_ptr<MockBlobStorageClient> MockClientWithBlob(
+    std::string_view blob) {
+  auto client = std::make_unique<MockBlobStorageClient>();
+  EXPECT_CALL(*client, GetBlobReader)
+      .WillRepeatedly([blob](BlobStorageClient::DataLocation) {
+        return std::make_unique<StringBlobReader>(blob);
+      });
+  return client;
+}
+
+TEST(LatencyEmulatingBlobStorageClientTest, ReadsBlobInRanges) {
+  const std::string blob = "0123456789abcdefghij";
+  for (int64_t num_read_ahead_chunks : {0, 2}) {
+    LatencyEmulatingBlobStorageClient client(
+        MockClientWithBlob(blob),
+        {.max_range_bytes = 3, .num_read_ahead_chunks = num_read_ahead_chunks});
+    auto reader = client.GetBlobReader({.key = "blob"});
+    ASSERT_NE(reader, nullptr);
+    EXPECT_EQ(ReadAll(*reader), blob);
+    reader->Stream().clear();
+    reader->Stream().seekg(12);
+    EXPECT_EQ(ReadAll(*reader), "cdefghij");
+  }
+}
+
+TEST(LatencyEmulatingBlobStorageClientTest, DelaysEveryRequest) {
+  // Getting the size of the blob and reading its 2 ranges are 3 requests.
+  LatencyEmulatingBlobStorageClient client(
+      MockClientWithBlob("0123456789"),
+      {.request_latency = absl::Milliseconds(20), .max_range_bytes = 5});
+  const absl::Time start = absl::Now();
+  auto reader = client.GetBlobReader({.key = "blob"});
+  EXPECT_EQ(ReadAll(*reader), "0123456789");
+  EXPECT_GE(absl::Now() - start, absl::Milliseconds(60));
+}
+
+TEST(LatencyEmulatingBlobStorageClientTest, CapsBandwidth) {
+  const std::string blob(1000, 'a');
+  LatencyEmulatingBlobStorageClient client(
+      MockClientWithBlob(blob), {.request_bandwidth_bytes_per_second = 10000});
+  const absl::Time start = absl::Now();
+  auto reader = client.GetBlobReader({.key = "blob"});
+  EXPECT_EQ(ReadAll(*reader), blob);
+  EXPECT_GE(absl::Now() - start, absl::Milliseconds(100));
+}
+
+TEST(LatencyEmulatingBlobStorageClientTest, ForwardsOtherRequests) {
+  auto mock_client = std::make_unique<MockBlobStorageClient>();
+  EXPECT_CALL(*mock_client, ListBlobs)
+      .WillOnce(Return(std::vector<std::string>{"DELTA_1"}));
+  EXPECT_CALL(*mock_client, DeleteBlob).WillOnce(Return(absl::OkStatus()));
+  LatencyEmulatingBlobStorageClient client(
+      std::move(mock_client), {.request_latency = absl::Milliseconds(1)});
+  auto blobs = client.ListBlobs({}, {});
+  ASSERT_TRUE(blobs.ok()) << blobs.status();
+  EXPECT_THAT(*blobs, testing::ElementsAre("DELTA_1"));
+  EXPECT_TRUE(client.DeleteBlob({.key = "DELTA_1"}).ok());
+}
+
+}  // namespace
+}  // namespace kv_server
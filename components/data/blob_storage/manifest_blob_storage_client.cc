@@ -0,0 +1,156 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/data/blob_storage/manifest_blob_storage_client.h"
+
+#include <algorithm>
+#include <sstream>
+#include <utility>
+
+#include "absl/log/log.h"
+#include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_join.h"
+#include "absl/strings/str_split.h"
+#include "components/data/blob_storage/memory_blob_reader.h"
+
+namespace kv_server {
+
+absl::Status WriteDataFileManifest(BlobStorageClient& client,
+                                   BlobStorageClient::DataLocation location) {
+  location.key.clear();
+  absl::StatusOr<std::vector<std::string>> blob_names =
+      client.ListBlobs(location, {});
+  if (!blob_names.ok()) {
+    return blob_names.status();
+  }
+  blob_names->erase(std::remove(blob_names->begin(), blob_names->end(),
+                                kDataFileManifestName),
+                    blob_names->end());
+  std::sort(blob_names->begin(), blob_names->end());
+  MemoryBlobReader reader(std::make_shared<const std::string>(
+      absl::StrCat(absl::StrJoin(*blob_names, "\n"), "\n")));
+  location.key = kDataFileManifestName;
+  return client.PutBlob(reader, std::move(location));
+}
+
+ManifestBlobStorageClient::ManifestBlobStorageClient(
+    std::unique_ptr<BlobStorageClient> client)
+    : client_(std::move(client)) {}
+
+std::unique_ptr<BlobReader> ManifestBlobStorageClient::GetBlobReader(
+    DataLocation location) {
+  return client_->GetBlobReader(std::move(location));
+}
+
+absl::Status ManifestBlobStorageClient::PutBlob(BlobReader& reader,
+                                                DataLocation location) {
+  return client_->PutBlob(reader, std::move(location));
+}
+
+absl::Status ManifestBlobStorageClient::DeleteBlob(DataLocation location) {
+  return client_->DeleteBlob(std::move(location));
+}
+
+absl::StatusOr<std::vector<std::string>> ManifestBlobStorageClient::ListBlobs(
+    DataLocation location, ListOptions options) {
+  // Blobs with different name prefixes are not named in order of creation.
+  if (options.prefix.empty()) {
+    return client_->ListBlobs(std::move(location), std::move(options));
+  }
+  absl::StatusOr<std::shared_ptr<const std::vector<std::string>>> manifest =
+      GetManifest(location);
+  if (!manifest.ok()) {
+    LOG(WARNING) << "Listing blobs in " << location
+                 << " without a manifest: " << manifest.status();
+    return client_->ListBlobs(std::move(location), std::move(options));
+  }
+  std::vector<std::string> blob_names;
+  std::string last_blob_name;
+  for (const std::string& blob_name : **manifest) {
+    if (!absl::StartsWith(blob_name, options.prefix)) {
+      continue;
+    }
+    last_blob_name = blob_name;
+    if (blob_name > options.start_after) {
+      blob_names.push_back(blob_name);
+    }
+  }
+  options.start_after = std::max(options.start_after, last_blob_name);
+  absl::StatusOr<std::vector<std::string>> new_blob_names =
+      client_->ListBlobs(std::move(location), std::move(options));
+  if (!new_blob_names.ok()) {
+    return new_blob_names.status();
+  }
+  blob_names.insert(blob_names.end(),
+                    std::make_move_iterator(new_blob_names->begin()),
+                    std::make_move_iterator(new_blob_names->end()));
+  return blob_names;
+}
+
+absl::StatusOr<std::string> ManifestBlobStorageClient::GetBlobETag(
+    DataLocation location) {
+  return client_->GetBlobETag(std::move(location));
+}
+
+absl::StatusOr<std::shared_ptr<const std::string>>
+ManifestBlobStorageClient::DownloadBlob(DataLocation location) {
+  return client_->DownloadBlob(std::move(location));
+}
+
+absl::StatusOr<std::shared_ptr<const std::vector<std::string>>>
+ManifestBlobStorageClient::GetManifest(const DataLocation& location) {
+  const std::string directory =
+      absl::StrCat(location.bucket, "/", location.prefix);
+  {
+    absl::MutexLock lock(&mutex_);
+    if (auto iter = manifests_.find(directory); iter != manifests_.end()) {
+      return iter->second;
+    }
+  }
+  DataLocation manifest_location{.bucket = location.bucket,
+                                 .prefix = location.prefix};
+  absl::StatusOr<std::vector<std::string>> manifest_names =
+      client_->ListBlobs(manifest_location,
+                         {.prefix = std::string(kDataFileManifestName)});
+  if (!manifest_names.ok()) {
+    return manifest_names.status();
+  }
+  auto blob_names = std::make_shared<std::vector<std::string>>();
+  if (std::find(manifest_names->begin(), manifest_names->end(),
+                kDataFileManifestName) != manifest_names->end()) {
+    manifest_location.key = kDataFileManifestName;
+    std::unique_ptr<BlobReader> reader =
+        client_->GetBlobReader(manifest_location);
+    std::stringstream stream;
+    stream << reader->Stream().rdbuf();
+    if (reader->Stream().bad()) {
+      return absl::UnavailableError(
+          absl::StrCat("Failed to read manifest ", directory));
+    }
+    const std::string contents = stream.str();
+    for (std::string_view blob_name :
+         absl::StrSplit(contents, '\n', absl::SkipWhitespace())) {
+      blob_names->emplace_back(blob_name);
+    }
+    std::sort(blob_names->begin(), blob_names->end());
+    LOG(INFO) << "Read " << blob_names->size() << " blob names from "
+              << manifest_location;
+  }
+  absl::MutexLock lock(&mutex_);
+  return manifests_.try_emplace(directory, std::move(blob_names))
+      .first->second;
+}
+
+}  // namespace kv_server
@@ -0,0 +1,88 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef COMPONENTS_DATA_BLOB_STORAGE_MANIFEST_BLOB_STORAGE_CLIENT_H_
+#define COMPONENTS_DATA_BLOB_STORAGE_MANIFEST_BLOB_STORAGE_CLIENT_H_
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/synchronization/mutex.h"
+#include "components/data/blob_storage/blob_storage_client.h"
+
+namespace kv_server {
+
+// Name of the manifest blob of a bucket directory. It holds the names of the
+// data files of the directory, one per line, lexicographically ordered.
+inline constexpr std::string_view kDataFileManifestName = "DATA_FILE_MANIFEST";
+
+// Writes the manifest of the directory of `location`, listing all the blobs
+// in it. Meant to be called by the data pipeline once it wrote data files,
+// and again once it deleted some, since servers assume that the files in the
+// manifest exist.
+absl::Status WriteDataFileManifest(BlobStorageClient& client,
+                                   BlobStorageClient::DataLocation location);
+
+// Wraps a blob storage client so that blobs are listed from the manifest of
+// their directory, if it has one, and only the blobs after the last matching
+// one in the manifest are listed from `client`. This avoids listing all the
+// historical data files of large buckets. Assumes that new blobs are named
+// after the existing ones with the same name prefix, as data files are.
+// Listings without a name prefix are not served from the manifest. Manifests
+// are read once per directory.
+//
+// Safe to use from multiple threads.
+class ManifestBlobStorageClient : public BlobStorageClient {
+ public:
+  explicit ManifestBlobStorageClient(std::unique_ptr<BlobStorageClient> client);
+
+  std::unique_ptr<BlobReader> GetBlobReader(DataLocation location) override;
+
+  absl::Status PutBlob(BlobReader& reader, DataLocation location) override;
+
+  absl::Status DeleteBlob(DataLocation location) override;
+
+  absl::StatusOr<std::vector<std::string>> ListBlobs(
+      DataLocation location, ListOptions options) override;
+
+  absl::StatusOr<std::string> GetBlobETag(DataLocation location) override;
+
+  absl::StatusOr<std::shared_ptr<const std::string>> DownloadBlob(
+      DataLocation location) override;
+
+ private:
+  // Returns the blob names in the manifest of the directory of `location`,
+  // empty if it has none.
+  absl::StatusOr<std::shared_ptr<const std::vector<std::string>>> GetManifest(
+      const DataLocation& location) ABSL_LOCKS_EXCLUDED(mutex_);
+
+  std::unique_ptr<BlobStorageClient> client_;
+  absl::Mutex mutex_;
+  // By bucket and prefix.
+  absl::flat_hash_map<std::string,
+                      std::shared_ptr<const std::vector<std::string>>>
+      manifests_ ABSL_GUARDED_BY(mutex_);
+};
+
+}  // namespace kv_server
+
+#endif  // COMPONENTS_DATA_BLOB_STORAGE_MANIFEST_BLOB_STORAGE_CLIENT_H_
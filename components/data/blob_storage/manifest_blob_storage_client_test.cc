@@ -0,0 +1,156 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/data/blob_storage/manifest_blob_storage_client.h"
+
+#include <memory>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "components/data/common/mocks.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace kv_server {
+namespace {
+
+using testing::_;
+using testing::AllOf;
+using testing::ElementsAre;
+using testing::Field;
+using testing::Return;
+
+class StringBlobReader : public BlobReader {
+ public:
+  explicit StringBlobReader(std::string_view blob)
+      : stream_(std::string(blob)) {}
+  std::istream& Stream() override { return stream_; }
+  bool CanSeek() const override { return true; }
+
+ private:
+  std::stringstream stream_;
+};
+
+const BlobStorageClient::DataLocation kDirectory{.bucket = "bucket",
+                                                 .prefix = "prefix"};
+
+class ManifestBlobStorageClientTest : public ::testing::Test {
+ protected:
+  ManifestBlobStorageClientTest() {
+    auto mock_client = std::make_unique<MockBlobStorageClient>();
+    mock_client_ = mock_client.get();
+    client_ = std::make_unique<ManifestBlobStorageClient>(
+        std::move(mock_client));
+  }
+
+  void ExpectManifest(std::string_view contents) {
+    EXPECT_CALL(*mock_client_,
+                ListBlobs(kDirectory,
+                          Field(&BlobStorageClient::ListOptions::prefix,
+                                kDataFileManifestName)))
+        .WillOnce(Return(std::vector<std::string>{
+            std::string(kDataFileManifestName)}));
+    EXPECT_CALL(*mock_client_, GetBlobReader(Field(
+                                   &BlobStorageClient::DataLocation::key,
+                                   kDataFileManifestName)))
+        .WillOnce([contents](BlobStorageClient::DataLocation) {
+          return std::make_unique<StringBlobReader>(contents);
+        });
+  }
+
+  MockBlobStorageClient* mock_client_;
+  std::unique_ptr<ManifestBlobStorageClient> client_;
+};
+
+TEST_F(ManifestBlobStorageClientTest, ListsOnlyBlobsAfterManifest) {
+  ExpectManifest("DELTA_1\nDELTA_2\nSNAPSHOT_1\n");
+  EXPECT_CALL(
+      *mock_client_,
+      ListBlobs(kDirectory,
+                AllOf(Field(&BlobStorageClient::ListOptions::prefix, "DELTA_"),
+                      Field(&BlobStorageClient::ListOptions::start_after,
+                            "DELTA_2"))))
+      .Times(2)
+      .WillRepeatedly(Return(std::vector<std::string>{"DELTA_3"}));
+  EXPECT_THAT(*client_->ListBlobs(kDirectory, {.prefix = "DELTA_"}),
+              ElementsAre("DELTA_1", "DELTA_2", "DELTA_3"));
+  // The manifest is only read once.
+  EXPECT_THAT(*client_->ListBlobs(kDirectory, {.prefix = "DELTA_",
+                                               .start_after = "DELTA_1"}),
+              ElementsAre("DELTA_2", "DELTA_3"));
+}
+
+TEST_F(ManifestBlobStorageClientTest, ListsAfterStartPastManifest) {
+  ExpectManifest("DELTA_1\n");
+  EXPECT_CALL(*mock_client_,
+              ListBlobs(kDirectory,
+                        Field(&BlobStorageClient::ListOptions::start_after,
+                              "DELTA_5")))
+      .WillOnce(Return(std::vector<std::string>{"DELTA_6"}));
+  EXPECT_THAT(*client_->ListBlobs(kDirectory, {.prefix = "DELTA_",
+                                               .start_after = "DELTA_5"}),
+              ElementsAre("DELTA_6"));
+}
+
+TEST_F(ManifestBlobStorageClientTest, ListsAllBlobsWithoutManifest) {
+  EXPECT_CALL(*mock_client_,
+              ListBlobs(kDirectory,
+                        Field(&BlobStorageClient::ListOptions::prefix,
+                              kDataFileManifestName)))
+      .WillOnce(Return(std::vector<std::string>()));
+  EXPECT_CALL(*mock_client_,
+              ListBlobs(kDirectory,
+                        Field(&BlobStorageClient::ListOptions::prefix,
+                              "SNAPSHOT_")))
+      .WillOnce(Return(std::vector<std::string>{"SNAPSHOT_1"}));
+  EXPECT_THAT(*client_->ListBlobs(kDirectory, {.prefix = "SNAPSHOT_"}),
+              ElementsAre("SNAPSHOT_1"));
+}
+
+TEST_F(ManifestBlobStorageClientTest, FallsBackToListingOnManifestError) {
+  EXPECT_CALL(*mock_client_,
+              ListBlobs(kDirectory,
+                        Field(&BlobStorageClient::ListOptions::prefix,
+                              kDataFileManifestName)))
+      .WillOnce(Return(absl::UnavailableError("")));
+  EXPECT_CALL(*mock_client_,
+              ListBlobs(kDirectory,
+                        Field(&BlobStorageClient::ListOptions::prefix,
+                              "DELTA_")))
+      .WillOnce(Return(std::vector<std::string>{"DELTA_1"}));
+  EXPECT_THAT(*client_->ListBlobs(kDirectory, {.prefix = "DELTA_"}),
+              ElementsAre("DELTA_1"));
+}
+
+TEST(WriteDataFileManifestTest, WritesSortedBlobNames) {
+  MockBlobStorageClient client;
+  EXPECT_CALL(client, ListBlobs(kDirectory, _))
+      .WillOnce(Return(std::vector<std::string>{
+          "SNAPSHOT_1", std::string(kDataFileManifestName), "DELTA_1"}));
+  EXPECT_CALL(client, PutBlob(_, Field(&BlobStorageClient::DataLocation::key,
+                                       kDataFileManifestName)))
+      .WillOnce([](BlobReader& reader, BlobStorageClient::DataLocation) {
+        std::stringstream contents;
+        contents << reader.Stream().rdbuf();
+        EXPECT_EQ(contents.str(), "DELTA_1\nSNAPSHOT_1\n");
+        return absl::OkStatus();
+      });
+  EXPECT_TRUE(WriteDataFileManifest(client, kDirectory).ok());
+}
+
+}  // namespace
+}  // namespace kv_server
@@ -0,0 +1,84 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/data/blob_storage/mapped_file_blob_reader.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <memory>
+#include <string>
+
+#include "absl/log/log.h"
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+
+namespace kv_server {
+
+absl::StatusOr<std::unique_ptr<MappedFileBlobReader>>
+MappedFileBlobReader::Create(const std::string& filename) {
+  const int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return absl::ErrnoToStatus(errno,
+                               absl::StrCat("Unable to open: ", filename));
+  }
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) != 0) {
+    const int fstat_errno = errno;
+    close(fd);
+    return absl::ErrnoToStatus(fstat_errno,
+                               absl::StrCat("Unable to stat: ", filename));
+  }
+  if (!S_ISREG(file_stat.st_mode)) {
+    close(fd);
+    return absl::FailedPreconditionError(
+        absl::StrCat("Not a regular file: ", filename));
+  }
+  const size_t size = file_stat.st_size;
+  void* data = nullptr;
+  int mmap_errno = 0;
+  if (size > 0) {
+    data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    mmap_errno = errno;
+  }
+  // The mapping stays valid after the file is closed.
+  close(fd);
+  if (data == MAP_FAILED) {
+    return absl::ErrnoToStatus(mmap_errno,
+                               absl::StrCat("Unable to map: ", filename));
+  }
+  if (size > 0 && madvise(data, size, MADV_SEQUENTIAL) != 0) {
+    VLOG(2) << "madvise failed for " << filename << ": " << errno;
+  }
+  return absl::WrapUnique(
+      new MappedFileBlobReader(static_cast<char*>(data), size));
+}
+
+MappedFileBlobReader::MappedFileBlobReader(char* data, size_t size)
+    : data_(data),
+      size_(size),
+      streambuf_(data, size),
+      stream_(&streambuf_) {}
+
+MappedFileBlobReader::~MappedFileBlobReader() {
+  if (size_ > 0) {
+    munmap(data_, size_);
+  }
+}
+
+}  // namespace kv_server
@@ -0,0 +1,62 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef COMPONENTS_DATA_BLOB_STORAGE_MAPPED_FILE_BLOB_READER_H_
+#define COMPONENTS_DATA_BLOB_STORAGE_MAPPED_FILE_BLOB_READER_H_
+
+#include <istream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "absl/status/statusor.h"
+#include "components/data/blob_storage/blob_storage_client.h"
+#include "components/data/blob_storage/memory_blob_reader.h"
+
+namespace kv_server {
+
+// Reads a memory-mapped file, so that readers using `Contents()` read the
+// data straight from the page cache. The file must not be truncated while it
+// is read.
+class MappedFileBlobReader : public BlobReader {
+ public:
+  // Returns an error if `filename` is not a regular file that can be mapped.
+  static absl::StatusOr<std::unique_ptr<MappedFileBlobReader>> Create(
+      const std::string& filename);
+
+  ~MappedFileBlobReader() override;
+  MappedFileBlobReader(const MappedFileBlobReader&) = delete;
+  MappedFileBlobReader& operator=(const MappedFileBlobReader&) = delete;
+
+  std::istream& Stream() override { return stream_; }
+  bool CanSeek() const override { return true; }
+  std::optional<std::string_view> Contents() const override {
+    return std::string_view(data_, size_);
+  }
+
+ private:
+  MappedFileBlobReader(char* data, size_t size);
+
+  char* const data_;
+  const size_t size_;
+  MemoryStreambuf streambuf_;
+  std::istream stream_;
+};
+
+}  // namespace kv_server
+
+#endif  // COMPONENTS_DATA_BLOB_STORAGE_MAPPED_FILE_BLOB_READER_H_
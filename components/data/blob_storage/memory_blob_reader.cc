@@ -0,0 +1,63 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "components/data/blob_storage/memory_blob_reader.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+
+namespace kv_server {
+
+MemoryStreambuf::MemoryStreambuf(const char* data, size_t size) {
+  // The get area is only read from.
+  char* begin = const_cast<char*>(data);
+  setg(begin, begin, begin + size);
+}
+
+MemoryStreambuf::pos_type MemoryStreambuf::seekoff(
+    off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) {
+  off_type new_position;
+  switch (dir) {
+    case std::ios_base::beg:
+      new_position = off;
+      break;
+    case std::ios_base::cur:
+      new_position = (gptr() - eback()) + off;
+      break;
+    case std::ios_base::end:
+      new_position = (egptr() - eback()) + off;
+      break;
+    default:
+      return pos_type(off_type(-1));
+  }
+  if (new_position < 0 || new_position > egptr() - eback()) {
+    return pos_type(off_type(-1));
+  }
+  setg(eback(), eback() + new_position, egptr());
+  return pos_type(new_position);
+}
+
+MemoryStreambuf::pos_type MemoryStreambuf::seekpos(
+    pos_type pos, std::ios_base::openmode which) {
+  return seekoff(off_type(pos), std::ios_base::beg, which);
+}
+
+MemoryBlobReader::MemoryBlobReader(std::shared_ptr<const std::string> contents)
+    : contents_(std::move(contents)),
+      streambuf_(contents_->data(), contents_->size()),
+      stream_(&streambuf_) {}
+
+}  // namespace kv_server
@@ -0,0 +1,65 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef COMPONENTS_DATA_BLOB_STORAGE_MEMORY_BLOB_READER_H_
+#define COMPONENTS_DATA_BLOB_STORAGE_MEMORY_BLOB_READER_H_
+
+#include <istream>
+#include <memory>
+#include <optional>
+#include <streambuf>
+#include <string>
+#include <string_view>
+
+#include "components/data/blob_storage/blob_storage_client.h"
+
+namespace kv_server {
+
+// Seekable streambuf reading a span of memory in place.
+class MemoryStreambuf : public std::streambuf {
+ public:
+  MemoryStreambuf(const char* data, size_t size);
+
+ protected:
+  pos_type seekoff(off_type off, std::ios_base::seekdir dir,
+                   std::ios_base::openmode which) override;
+  pos_type seekpos(pos_type pos, std::ios_base::openmode which) override;
+};
+
+// Reads a blob held in memory. Readers sharing the same contents read them
+// without copies.
+class MemoryBlobReader : public BlobReader {
+ public:
+  explicit MemoryBlobReader(std::shared_ptr<const std::string> contents);
+
+  MemoryBlobReader(const MemoryBlobReader&) = delete;
+  MemoryBlobReader& operator=(const MemoryBlobReader&) = delete;
+
+  std::istream& Stream() override { return stream_; }
+  bool CanSeek() const override { return true; }
+  std::optional<std::string_view> Contents() const override {
+    return *contents_;
+  }
+
+ private:
+  const std::shared_ptr<const std::string> contents_;
+  MemoryStreambuf streambuf_;
+  std::istream stream_;
+};
+
+}  // namespace kv_server
+
+#endif  // COMPONENTS_DATA_BLOB_STORAGE_MEMORY_BLOB_READER_H_
@@ -49,6 +49,8 @@ SeekingInputStreambuf::SeekingInputStreambuf(Options options)
   setg(buffer_.data(), buffer_.data(), buffer_.data() + buffer_.length());
 }
 
+SeekingInputStreambuf::~SeekingInputStreambuf() { WaitForReadAheads(); }
+
 std::streampos SeekingInputStreambuf::seekpos(std::streampos pos,
                                               std::ios_base::openmode which) {
   return seekoff(std::streamoff(pos), std::ios_base::beg, which);
@@ -123,33 +125,119 @@ std::streambuf::int_type SeekingInputStreambuf::underflow() {
   if (src_limit_position_ >= *size) {
     return traits_type::eof();
   }
-  const int64_t total_bytes_to_read =
-      std::max(std::min(*size - src_limit_position_, options_.buffer_size), 1l);
+  if (!(IsReadAheadEnabled() ? FillBufferFromReadAheads(*size)
+                              : FillBuffer(*size))) {
+    return traits_type::eof();
+  }
+  setg(buffer_.data(), buffer_.data(), buffer_.data() + buffer_.length());
+  MaybeVerboseLogLatency(kUnderflowEventName, latency_recorder.GetLatency());
+  return traits_type::to_int_type(buffer_[0]);
+}
+
+absl::StatusOr<int64_t> SeekingInputStreambuf::ReadFully(int64_t offset,
+                                                         int64_t chunk_size,
+                                                         char* dest_buffer) {
   int64_t total_bytes_read = 0;
-  buffer_.resize(total_bytes_to_read);
-  while (total_bytes_read < total_bytes_to_read) {
-    int64_t chunk_size = total_bytes_to_read - total_bytes_read;
+  while (total_bytes_read < chunk_size) {
     auto actual_bytes_read =
-        ReadChunk(src_limit_position_, chunk_size, buffer_.data());
+        ReadChunk(offset + total_bytes_read, chunk_size - total_bytes_read,
+                  dest_buffer + total_bytes_read);
     if (ABSL_PREDICT_FALSE(!actual_bytes_read.ok())) {
-      MaybeReportError(actual_bytes_read.status());
-      return traits_type::eof();
+      return actual_bytes_read.status();
     }
-    if (ABSL_PREDICT_FALSE(*actual_bytes_read < 0)) {
+    if (ABSL_PREDICT_FALSE(*actual_bytes_read <= 0)) {
       break;
     }
-    src_limit_position_ += *actual_bytes_read;
     total_bytes_read += *actual_bytes_read;
   }
-  if (total_bytes_read == 0) {
-    return traits_type::eof();
+  return total_bytes_read;
+}
+
+bool SeekingInputStreambuf::FillBuffer(int64_t size) {
+  const int64_t total_bytes_to_read =
+      std::max(std::min(size - src_limit_position_, options_.buffer_size), 1l);
+  buffer_.resize(total_bytes_to_read);
+  const auto total_bytes_read =
+      ReadFully(src_limit_position_, total_bytes_to_read, buffer_.data());
+  if (ABSL_PREDICT_FALSE(!total_bytes_read.ok())) {
+    MaybeReportError(total_bytes_read.status());
+    return false;
   }
-  if (ABSL_PREDICT_FALSE(total_bytes_read < total_bytes_to_read)) {
-    buffer_.resize(total_bytes_read);
+  if (*total_bytes_read == 0) {
+    return false;
   }
-  setg(buffer_.data(), buffer_.data(), buffer_.data() + buffer_.length());
-  MaybeVerboseLogLatency(kUnderflowEventName, latency_recorder.GetLatency());
-  return traits_type::to_int_type(buffer_[0]);
+  buffer_.resize(*total_bytes_read);
+  src_limit_position_ += *total_bytes_read;
+  return true;
+}
+
+bool SeekingInputStreambuf::FillBufferFromReadAheads(int64_t size) {
+  if (!read_aheads_.empty() &&
+      read_aheads_.front()->offset != src_limit_position_) {
+    // The cursor moved, so the reads ahead are abandoned. Running ones still
+    // finish in the background.
+    read_aheads_.clear();
+  }
+  int64_t next_offset =
+      read_aheads_.empty()
+          ? src_limit_position_
+          : read_aheads_.back()->offset + options_.buffer_size;
+  while (static_cast<int64_t>(read_aheads_.size()) <=
+             options_.num_read_ahead_chunks &&
+         next_offset < size) {
+    const int64_t chunk_size =
+        std::min(size - next_offset, options_.buffer_size);
+    ScheduleReadAhead(next_offset, chunk_size);
+    next_offset += chunk_size;
+  }
+  const std::shared_ptr<ReadAhead> read_ahead = std::move(read_aheads_.front());
+  read_aheads_.pop_front();
+  read_ahead->done.WaitForNotification();
+  if (ABSL_PREDICT_FALSE(!read_ahead->bytes_read.ok())) {
+    read_aheads_.clear();
+    MaybeReportError(read_ahead->bytes_read.status());
+    return false;
+  }
+  if (*read_ahead->bytes_read == 0) {
+    return false;
+  }
+  // Later reads ahead assume full chunks, so a short read abandons them on the
+  // next underflow.
+  buffer_ = std::move(read_ahead->buffer);
+  buffer_.resize(*read_ahead->bytes_read);
+  src_limit_position_ += *read_ahead->bytes_read;
+  return true;
+}
+
+void SeekingInputStreambuf::ScheduleReadAhead(int64_t offset,
+                                              int64_t chunk_size) {
+  auto read_ahead = std::make_shared<ReadAhead>();
+  read_ahead->offset = offset;
+  read_ahead->buffer.resize(chunk_size);
+  read_aheads_.push_back(read_ahead);
+  {
+    absl::MutexLock lock(&read_ahead_mutex_);
+    num_running_read_aheads_++;
+  }
+  options_.read_ahead_executor->Schedule([this, read_ahead, chunk_size]() {
+    read_ahead->bytes_read =
+        ReadFully(read_ahead->offset, chunk_size, read_ahead->buffer.data());
+    read_ahead->done.Notify();
+    absl::MutexLock lock(&read_ahead_mutex_);
+    num_running_read_aheads_--;
+  });
+}
+
+bool SeekingInputStreambuf::IsReadAheadEnabled() const {
+  return options_.num_read_ahead_chunks > 0 && options_.buffer_size > 0 &&
+         options_.read_ahead_executor != nullptr;
+}
+
+void SeekingInputStreambuf::WaitForReadAheads() {
+  absl::MutexLock lock(&read_ahead_mutex_);
+  read_ahead_mutex_.Await(absl::Condition(
+      +[](int64_t* num_running) { return *num_running == 0; },
+      &num_running_read_aheads_));
 }
 
 std::streamsize SeekingInputStreambuf::showmanyc() {
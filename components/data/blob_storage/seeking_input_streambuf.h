@@ -14,12 +14,17 @@
  * limitations under the License.
  */
 
+#include <deque>
 #include <memory>
 #include <streambuf>
 #include <string>
 
+#include "absl/base/thread_annotations.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/synchronization/notification.h"
+#include "components/util/thread_pool.h"
 #include "src/telemetry/telemetry_provider.h"
 
 #ifndef COMPONENTS_DATA_BLOB_STORAGE_SEEKING_INPUT_STREAMBUF_H_
@@ -60,6 +65,11 @@ namespace kv_server {
 // StringBlobInputStreambuf sstreambuf("test blob.");
 // std::istream blob_stream(&sstreambuf);
 // ...
+//
+// With `Options::num_read_ahead_chunks` set, the chunks after the cursor are
+// read ahead concurrently on `Options::read_ahead_executor`, so `ReadChunk`
+// must then be safe to call from multiple threads, and child streambufs must
+// call `WaitForReadAheads()` in their destructor.
 class SeekingInputStreambuf : public std::streambuf {
  public:
   struct Options {
@@ -69,10 +79,16 @@ class SeekingInputStreambuf : public std::streambuf {
     // underlying source which can be painfully slow and expensive.
     std::int64_t buffer_size = 8 * 1024 * 1024;  // 8MB
     std::function<void(absl::Status)> error_callback = [](absl::Status) {};
+    // Number of chunks of `buffer_size` bytes read ahead of the one being
+    // consumed. Read-ahead is disabled if not positive, if buffering is
+    // disabled or if `read_ahead_executor` is null.
+    std::int64_t num_read_ahead_chunks = 0;
+    // Runs the reads ahead. Not owned, and must outlive the streambuf.
+    ThreadPool* read_ahead_executor = nullptr;
   };
 
   explicit SeekingInputStreambuf(Options options = Options());
-  virtual ~SeekingInputStreambuf() = default;
+  virtual ~SeekingInputStreambuf();
   SeekingInputStreambuf(const SeekingInputStreambuf&) = delete;
   SeekingInputStreambuf& operator=(const SeekingInputStreambuf&) = delete;
   absl::StatusOr<int64_t> Size();
@@ -104,7 +120,29 @@ class SeekingInputStreambuf : public std::streambuf {
   virtual absl::StatusOr<int64_t> ReadChunk(int64_t offset, int64_t chunk_size,
                                             char* dest_buffer) = 0;
 
+  // Blocks until no read ahead is running.
+  void WaitForReadAheads() ABSL_LOCKS_EXCLUDED(read_ahead_mutex_);
+
  private:
+  // A chunk read ahead of the cursor.
+  struct ReadAhead {
+    int64_t offset;
+    std::string buffer;
+    absl::StatusOr<int64_t> bytes_read;
+    absl::Notification done;
+  };
+
+  // Reads up to `chunk_size` bytes at `offset` with as many `ReadChunk` calls
+  // as needed, and returns the number of bytes read.
+  absl::StatusOr<int64_t> ReadFully(int64_t offset, int64_t chunk_size,
+                                    char* dest_buffer);
+  // Fills `buffer_` from the source, at `src_limit_position_`. Returns false
+  // at the end of the source or on errors.
+  bool FillBuffer(int64_t size);
+  bool FillBufferFromReadAheads(int64_t size);
+  void ScheduleReadAhead(int64_t offset, int64_t chunk_size)
+      ABSL_LOCKS_EXCLUDED(read_ahead_mutex_);
+  bool IsReadAheadEnabled() const;
   int64_t BufferAvailableChars();
   int64_t BufferStartPosition();
   int64_t BufferCursorPosition();
@@ -117,6 +155,12 @@ class SeekingInputStreambuf : public std::streambuf {
   // already.
   int64_t src_limit_position_ = 0;
   int64_t src_cached_size_ = -1;
+  // Reads ahead in order of their offsets, the first one starting at
+  // `src_limit_position_` unless the cursor moved.
+  std::deque<std::shared_ptr<ReadAhead>> read_aheads_;
+  absl::Mutex read_ahead_mutex_;
+  // Number of reads ahead running, including abandoned ones.
+  int64_t num_running_read_aheads_ ABSL_GUARDED_BY(read_ahead_mutex_) = 0;
 };
 
 }  // namespace kv_server
@@ -26,6 +26,7 @@
 #include "absl/status/statusor.h"
 #include "absl/strings/str_format.h"
 #include "components/telemetry/server_definition.h"
+#include "components/util/thread_pool.h"
 #include "gtest/gtest.h"
 
 namespace kv_server {
@@ -39,11 +40,21 @@ SeekingInputStreambuf::Options GetOptions(int64_t buffer_size) {
   return options;
 }
 
+SeekingInputStreambuf::Options GetReadAheadOptions(
+    int64_t buffer_size, int64_t num_read_ahead_chunks) {
+  static ThreadPool* const executor = new ThreadPool(/*num_threads=*/4);
+  SeekingInputStreambuf::Options options = GetOptions(buffer_size);
+  options.num_read_ahead_chunks = num_read_ahead_chunks;
+  options.read_ahead_executor = executor;
+  return options;
+}
+
 class StringBlobInputStreambuf : public SeekingInputStreambuf {
  public:
   StringBlobInputStreambuf(std::string_view blob,
                            SeekingInputStreambuf::Options options)
       : SeekingInputStreambuf(std::move(options)), blob_(blob) {}
+  ~StringBlobInputStreambuf() override { WaitForReadAheads(); }
 
  protected:
   absl::StatusOr<int64_t> ReadChunk(int64_t offset, int64_t chunk_size,
@@ -84,7 +95,11 @@ INSTANTIATE_TEST_SUITE_P(
     BufferSize, SeekingInputStreambufTest,
     testing::Values(
         GetOptions(/*buffer_size=*/0), GetOptions(/*buffer_size=*/1 << 4),
-        GetOptions(/*buffer_size=*/std::numeric_limits<int64_t>::max())));
+        GetOptions(/*buffer_size=*/std::numeric_limits<int64_t>::max()),
+        GetReadAheadOptions(/*buffer_size=*/1 << 3,
+                            /*num_read_ahead_chunks=*/2),
+        GetReadAheadOptions(/*buffer_size=*/1 << 4,
+                            /*num_read_ahead_chunks=*/16)));
 
 TEST_P(SeekingInputStreambufTest, VerifyCanReadEntireBlob) {
   constexpr std::string_view blob =
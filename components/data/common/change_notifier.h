@@ -15,6 +15,7 @@
 #ifndef COMPONENTS_DATA_COMMON_CHANGE_NOTIFIER_H_
 #define COMPONENTS_DATA_COMMON_CHANGE_NOTIFIER_H_
 
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <vector>
@@ -42,6 +43,12 @@ class ChangeNotifier {
       absl::Duration max_wait,
       const std::function<bool()>& should_stop_callback) = 0;
 
+  // Returns the approximate number of notifications waiting to be received.
+  // May be called concurrently with `GetNotifications`.
+  virtual absl::StatusOr<int64_t> GetBacklog() {
+    return absl::UnimplementedError("Backlog is not supported.");
+  }
+
   static absl::StatusOr<std::unique_ptr<ChangeNotifier>> Create(
       NotifierMetadata notifier_metadata);
 };
@@ -21,7 +21,9 @@
 #include "absl/log/log.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/strings/numbers.h"
 #include "absl/strings/str_format.h"
+#include "absl/synchronization/mutex.h"
 #include "absl/synchronization/notification.h"
 #include "aws/core/Aws.h"
 #include "aws/sns/SNSClient.h"
@@ -32,6 +34,7 @@
 #include "aws/sqs/model/CreateQueueResult.h"
 #include "aws/sqs/model/DeleteMessageBatchRequest.h"
 #include "aws/sqs/model/DeleteMessageBatchRequestEntry.h"
+#include "aws/sqs/model/DeleteMessageBatchResult.h"
 #include "aws/sqs/model/DeleteMessageRequest.h"
 #include "aws/sqs/model/GetQueueAttributesRequest.h"
 #include "aws/sqs/model/GetQueueAttributesResult.h"
@@ -74,13 +77,8 @@ class AwsChangeNotifier : public ChangeNotifier {
       const std::function<bool()>& should_stop_callback) override {
     LOG(INFO) << "Getting notifications for topic " << sns_arn_;
     do {
-      if (!queue_manager_->IsSetupComplete()) {
-        absl::Status status = queue_manager_->SetupQueue();
-        if (!status.ok()) {
-          LOG(ERROR) << "Could not set up queue for topic " << sns_arn_;
-          LogServerErrorMetric(kAwsChangeNotifierQueueSetupFailure);
-          return status;
-        }
+      if (absl::Status status = MaybeSetupQueue(); !status.ok()) {
+        return status;
       }
       if (max_wait <= kMaxLongPollDuration) {
         return GetNotificationsInternal(max_wait);
@@ -97,7 +95,44 @@ class AwsChangeNotifier : public ChangeNotifier {
     return absl::DeadlineExceededError("No messages found.");
   }
 
+  absl::StatusOr<int64_t> GetBacklog() override {
+    if (absl::Status status = MaybeSetupQueue(); !status.ok()) {
+      return status;
+    }
+    Aws::SQS::Model::GetQueueAttributesRequest request;
+    request.SetQueueUrl(GetSqsUrl());
+    request.AddAttributeNames(
+        Aws::SQS::Model::QueueAttributeName::ApproximateNumberOfMessages);
+    const auto outcome = sqs_->GetQueueAttributes(request);
+    if (!outcome.IsSuccess()) {
+      return AwsErrorToStatus(outcome.GetError());
+    }
+    const auto& attributes = outcome.GetResult().GetAttributes();
+    const auto it = attributes.find(
+        Aws::SQS::Model::QueueAttributeName::ApproximateNumberOfMessages);
+    int64_t backlog;
+    if (it == attributes.end() || !absl::SimpleAtoi(it->second, &backlog)) {
+      return absl::InternalError("Queue has no valid message count.");
+    }
+    return backlog;
+  }
+
  private:
+  // Notifications may be received from several threads at once, so the queue
+  // is set up under a lock.
+  absl::Status MaybeSetupQueue() ABSL_LOCKS_EXCLUDED(mutex_) {
+    absl::MutexLock lock(&mutex_);
+    if (queue_manager_->IsSetupComplete()) {
+      return absl::OkStatus();
+    }
+    absl::Status status = queue_manager_->SetupQueue();
+    if (!status.ok()) {
+      LOG(ERROR) << "Could not set up queue for topic " << sns_arn_;
+      LogServerErrorMetric(kAwsChangeNotifierQueueSetupFailure);
+    }
+    return status;
+  }
+
   std::string GetSqsUrl() {
     auto queue_metadata = queue_manager_->GetQueueMetadata();
     auto aws_queue_metadata = std::get<AwsQueueMetadata>(queue_metadata);
@@ -116,7 +151,8 @@ class AwsChangeNotifier : public ChangeNotifier {
                                : AwsErrorToStatus(outcome.GetError());
   }
 
-  void MaybeTagQueue() {
+  void MaybeTagQueue() ABSL_LOCKS_EXCLUDED(mutex_) {
+    absl::MutexLock lock(&mutex_);
     const absl::Time now = absl::Now();
     if (now - last_updated_ >= kLastUpdatedFrequency) {
       const std::string tag = std::to_string(absl::ToUnixSeconds(now));
@@ -195,17 +231,25 @@ class AwsChangeNotifier : public ChangeNotifier {
     Aws::SQS::Model::DeleteMessageBatchRequest req;
     req.SetQueueUrl(queue_url);
     req.SetEntries(std::move(delete_message_batch_request_entries));
-    const auto outcome = sqs_->DeleteMessageBatch(req);
-    if (!outcome.IsSuccess()) {
-      LOG(ERROR) << "Failed to delete message from SQS: "
-                 << outcome.GetError().GetMessage();
-      LogServerErrorMetric(kAwsChangeNotifierMessagesDeletionFailure);
-    }
+    // The messages are already received, so they are deleted in the
+    // background instead of delaying the next receive call.
+    sqs_->DeleteMessageBatchAsync(
+        req, [](const Aws::SQS::SQSClient*,
+                const Aws::SQS::Model::DeleteMessageBatchRequest&,
+                const Aws::SQS::Model::DeleteMessageBatchOutcome& outcome,
+                const std::shared_ptr<const Aws::Client::AsyncCallerContext>&) {
+          if (!outcome.IsSuccess()) {
+            LOG(ERROR) << "Failed to delete message from SQS: "
+                       << outcome.GetError().GetMessage();
+            LogServerErrorMetric(kAwsChangeNotifierMessagesDeletionFailure);
+          }
+        });
   }
 
   MessageService* queue_manager_;
   const std::string sns_arn_;
-  absl::Time last_updated_ = absl::InfinitePast();
+  absl::Mutex mutex_;
+  absl::Time last_updated_ ABSL_GUARDED_BY(mutex_) = absl::InfinitePast();
   std::unique_ptr<Aws::SQS::SQSClient> sqs_;
 };
 }  // namespace
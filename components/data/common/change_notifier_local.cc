@@ -12,6 +12,12 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
 #include <filesystem>
 #include <vector>
 
@@ -30,10 +36,19 @@ namespace {
 // TODO(b/237669491): This is arbitrary, consider changing it.
 constexpr absl::Duration kPollInterval = absl::Seconds(5);
 
+// Changes after which a file of the directory is complete: it was closed
+// after being written, or moved into the directory.
+constexpr uint32_t kInotifyMask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_ONLYDIR;
+
+// Notifies of the files added to a local directory. The directory is watched
+// with inotify, so that new files are noticed as soon as they are complete,
+// and only polled if it cannot be watched.
 class LocalChangeNotifier : public ChangeNotifier {
  public:
   explicit LocalChangeNotifier(std::filesystem::path local_directory)
       : local_directory_(local_directory) {
+    // Before listing the directory, so that no file is missed.
+    WatchDirectory();
     VLOG(1) << "Building initial list of local files in directory: "
             << local_directory_.string();
     auto status_or = FindNewFiles({});
@@ -45,7 +60,12 @@ class LocalChangeNotifier : public ChangeNotifier {
     VLOG(1) << "Found " << files_in_directory_.size() << " files.";
   }
 
-  ~LocalChangeNotifier() { sleep_for_.Stop(); }
+  ~LocalChangeNotifier() {
+    sleep_for_.Stop();
+    if (inotify_fd_ >= 0) {
+      close(inotify_fd_);
+    }
+  }
 
   absl::StatusOr<std::vector<std::string>> GetNotifications(
       absl::Duration max_wait,
@@ -64,7 +84,8 @@ class LocalChangeNotifier : public ChangeNotifier {
         return absl::DeadlineExceededError("No messages found");
       }
 
-      auto status_or = FindNewFiles(files_in_directory_);
+      auto status_or = inotify_fd_ >= 0 ? ReadInotifyEvents()
+                                        : FindNewFiles(files_in_directory_);
       if (!status_or.ok()) {
         return status_or.status();
       }
@@ -76,12 +97,91 @@ class LocalChangeNotifier : public ChangeNotifier {
         return std::vector<std::string>{status_or->begin(), status_or->end()};
       }
 
-      max_wait -= kPollInterval;
-      sleep_for_.Duration(kPollInterval);
+      if (inotify_fd_ < 0) {
+        max_wait -= kPollInterval;
+        sleep_for_.Duration(kPollInterval);
+        continue;
+      }
+      const absl::Time start = absl::Now();
+      // Still wakes up every poll interval to call `should_stop_callback`.
+      WaitForInotifyEvents(std::min(max_wait, kPollInterval));
+      max_wait -= absl::Now() - start;
     }
   }
 
  private:
+  // Leaves `inotify_fd_` negative if the directory cannot be watched.
+  void WatchDirectory() {
+    inotify_fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotify_fd_ < 0) {
+      LOG(WARNING) << "Polling " << local_directory_.string() << ": "
+                   << absl::ErrnoToStatus(errno, "inotify_init1 failed");
+      return;
+    }
+    if (inotify_add_watch(inotify_fd_, local_directory_.c_str(),
+                          kInotifyMask) < 0) {
+      LOG(WARNING) << "Polling " << local_directory_.string() << ": "
+                   << absl::ErrnoToStatus(errno, "inotify_add_watch failed");
+      close(inotify_fd_);
+      inotify_fd_ = -1;
+    }
+  }
+
+  void WaitForInotifyEvents(absl::Duration timeout) const {
+    pollfd poll_fd = {.fd = inotify_fd_, .events = POLLIN};
+    if (poll(&poll_fd, 1, absl::ToInt64Milliseconds(timeout)) < 0 &&
+        errno != EINTR) {
+      LOG(ERROR) << absl::ErrnoToStatus(errno, "Failed to poll inotify");
+      sleep_for_.Duration(timeout);
+    }
+  }
+
+  // Returns the files completed since the last call that are not in
+  // `files_in_directory_`, without waiting. Lists the directory instead if
+  // events were lost, and from then on if the watch was removed.
+  absl::StatusOr<absl::flat_hash_set<std::string>> ReadInotifyEvents() {
+    absl::flat_hash_set<std::string> new_files;
+    bool events_lost = false;
+    alignas(inotify_event) char buffer[4096];
+    while (true) {
+      const ssize_t length = read(inotify_fd_, buffer, sizeof(buffer));
+      if (length < 0 && errno == EINTR) {
+        continue;
+      }
+      if (length < 0 && errno == EAGAIN) {
+        break;
+      }
+      if (length < 0) {
+        return absl::ErrnoToStatus(errno, "Failed to read inotify events");
+      }
+      for (ssize_t offset = 0; offset < length;) {
+        const auto* event =
+            reinterpret_cast<const inotify_event*>(buffer + offset);
+        offset += sizeof(inotify_event) + event->len;
+        if (event->mask & IN_IGNORED) {
+          LOG(WARNING) << "Stopped watching " << local_directory_.string()
+                       << ", polling it instead";
+          close(inotify_fd_);
+          inotify_fd_ = -1;
+          return FindNewFiles(files_in_directory_);
+        }
+        if (event->mask & IN_Q_OVERFLOW) {
+          events_lost = true;
+        } else if (event->len > 0 &&
+                   !files_in_directory_.contains(event->name)) {
+          VLOG(1) << "Found new file: " << event->name;
+          new_files.emplace(event->name);
+        }
+      }
+    }
+    if (events_lost) {
+      LOG(WARNING) << "Lost inotify events, listing "
+                   << local_directory_.string();
+      return FindNewFiles(files_in_directory_);
+    }
+    return new_files;
+  }
+
   // Returns a set of file paths that are in the watched directory but not in
   // previous_files.  Returns just the filename, not the path.
   absl::StatusOr<absl::flat_hash_set<std::string>> FindNewFiles(
@@ -109,6 +209,8 @@ class LocalChangeNotifier : public ChangeNotifier {
   SleepFor sleep_for_;
 
   std::filesystem::path local_directory_;
+  // Watches `local_directory_`, if not negative.
+  int inotify_fd_ = -1;
   // We can't store std::filesystem::path objects in the set because the paths
   // aren't guaranteed to be canonical so we store the string paths instead.
   absl::flat_hash_set<std::string> files_in_directory_;
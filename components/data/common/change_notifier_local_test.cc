@@ -18,10 +18,12 @@
 #include <fstream>
 #include <sstream>
 #include <string>
+#include <thread>
 #include <utility>
 
 #include "absl/log/log.h"
 #include "absl/status/statusor.h"
+#include "absl/time/clock.h"
 #include "components/data/common/change_notifier.h"
 #include "gtest/gtest.h"
 
@@ -171,5 +173,64 @@ TEST_F(ChangeNotifierLocalTest, MultipleGetNotificationsCalls) {
   }
 }
 
+TEST_F(ChangeNotifierLocalTest, NoticesNewFileWithoutPolling) {
+  absl::StatusOr<std::unique_ptr<ChangeNotifier>> notifier =
+      ChangeNotifier::Create(
+          kv_server::LocalNotifierMetadata{::testing::TempDir()});
+  ASSERT_TRUE(notifier.ok());
+  auto should_stop_callback = []() { return false; };
+
+  const absl::Time start = absl::Now();
+  std::thread writer([this] {
+    absl::SleepFor(absl::Milliseconds(100));
+    CreateFileInTmpDir("filename");
+  });
+  const auto status_or =
+      (*notifier)->GetNotifications(absl::Seconds(60), should_stop_callback);
+  writer.join();
+  ASSERT_TRUE(status_or.ok());
+  EXPECT_EQ(status_or.value(), std::vector<std::string>{"filename"});
+  // The directory is polled every 5 seconds if it is not watched.
+  EXPECT_LT(absl::Now() - start, absl::Seconds(4));
+}
+
+TEST_F(ChangeNotifierLocalTest, NotifiesOfFilesOnceWritten) {
+  absl::StatusOr<std::unique_ptr<ChangeNotifier>> notifier =
+      ChangeNotifier::Create(
+          kv_server::LocalNotifierMetadata{::testing::TempDir()});
+  ASSERT_TRUE(notifier.ok());
+  auto should_stop_callback = []() { return false; };
+
+  std::ofstream file(std::filesystem::path(::testing::TempDir()) / "filename");
+  file << "arbitrary file contents";
+  EXPECT_EQ(
+      (*notifier)
+          ->GetNotifications(absl::Milliseconds(500), should_stop_callback)
+          .status()
+          .code(),
+      absl::StatusCode::kDeadlineExceeded);
+
+  file.close();
+  const auto status_or =
+      (*notifier)->GetNotifications(absl::Seconds(1), should_stop_callback);
+  ASSERT_TRUE(status_or.ok());
+  EXPECT_EQ(status_or.value(), std::vector<std::string>{"filename"});
+}
+
+TEST_F(ChangeNotifierLocalTest, NotifiesOfFilesMovedIntoDirectory) {
+  const std::filesystem::path staged = CreateFileInTmpDir("staged");
+  absl::StatusOr<std::unique_ptr<ChangeNotifier>> notifier =
+      ChangeNotifier::Create(
+          kv_server::LocalNotifierMetadata{::testing::TempDir()});
+  ASSERT_TRUE(notifier.ok());
+  auto should_stop_callback = []() { return false; };
+
+  std::filesystem::rename(staged, staged.parent_path() / "filename");
+  const auto status_or =
+      (*notifier)->GetNotifications(absl::Seconds(1), should_stop_callback);
+  ASSERT_TRUE(status_or.ok());
+  EXPECT_EQ(status_or.value(), std::vector<std::string>{"filename"});
+}
+
 }  // namespace
 }  // namespace kv_server
@@ -38,6 +38,8 @@ class MockBlobStorageClient : public BlobStorageClient {
   MOCK_METHOD(absl::Status, DeleteBlob, (DataLocation location), (override));
   MOCK_METHOD(absl::StatusOr<std::vector<std::string>>, ListBlobs,
               (DataLocation location, ListOptions options), (override));
+  MOCK_METHOD(absl::StatusOr<std::string>, GetBlobETag, (DataLocation location),
+              (override));
 };
 
 class MockBlobStorageChangeNotifier : public BlobStorageChangeNotifier {
@@ -26,6 +26,7 @@ class MockDeltaFileRecordChangeNotifier : public DeltaFileRecordChangeNotifier {
               (absl::Duration max_wait,
                const std::function<bool()>& should_stop_callback),
               (override));
+  MOCK_METHOD(absl::StatusOr<int64_t>, GetBacklog, (), (override));
 };
 
 }  // namespace kv_server
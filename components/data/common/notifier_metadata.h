@@ -39,6 +39,12 @@ struct AwsNotifierMetadata {
   MessageService* queue_manager;
   int32_t num_shards = 1;
   int32_t shard_num;
+  // If positive, realtime messages are applied by this many threads while
+  // the next messages are received, instead of by the receiving thread.
+  int32_t num_applier_threads = 0;
+  // Maximum number of threads receiving realtime messages at once. Threads
+  // beyond the first are only used while the queue has a backlog.
+  int32_t max_receivers = 1;
 
   // If this is set then it will be used instead of a real SQSClient.  The
   // ChangeNotifier takes ownership of this.
@@ -55,6 +61,13 @@ struct GcpNotifierMetadata {
   int32_t num_threads = 1;
   int32_t num_shards = 1;
   int32_t shard_num;
+  // If positive, realtime messages are applied by this many threads instead
+  // of by the threads of the subscriber.
+  int32_t num_applier_threads = 0;
+  // Flow control of the subscriber. Not positive values keep the defaults of
+  // the Pub/Sub client library.
+  int64_t max_outstanding_messages = 0;
+  int64_t max_outstanding_bytes = 0;
 };
 using NotifierMetadata =
     std::variant<AwsNotifierMetadata, LocalNotifierMetadata,
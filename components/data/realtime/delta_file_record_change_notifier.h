@@ -17,12 +17,14 @@
 #ifndef COMPONENTS_DATA_REALTIME_DELTA_FILE_RECORD_NOTIFIER_H_
 #define COMPONENTS_DATA_REALTIME_DELTA_FILE_RECORD_NOTIFIER_H_
 
+#include <cstdint>
 #include <filesystem>
 #include <memory>
 #include <optional>
 #include <string>
 #include <vector>
 
+#include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/time/time.h"
 #include "components/data/common/change_notifier.h"
@@ -69,6 +71,12 @@ class DeltaFileRecordChangeNotifier {
       absl::Duration max_wait,
       const std::function<bool()>& should_stop_callback) = 0;
 
+  // Returns the approximate number of notifications waiting to be received,
+  // see `ChangeNotifier::GetBacklog`.
+  virtual absl::StatusOr<int64_t> GetBacklog() {
+    return absl::UnimplementedError("Backlog is not supported.");
+  }
+
   static std::unique_ptr<DeltaFileRecordChangeNotifier> Create(
       std::unique_ptr<ChangeNotifier> change_notifier);
 };
@@ -61,7 +61,7 @@ class AwsDeltaFileRecordChangeNotifier : public DeltaFileRecordChangeNotifier {
                                .notifications_received = absl::Now()};
     std::vector<std::string> realtime_messages;
     for (const auto& message : *notifications) {
-      const auto parsedMessage = ParseObjectKeyFromJson(message);
+      auto parsedMessage = ParseObjectKeyFromJson(message);
       if (!parsedMessage.ok()) {
         LOG(ERROR) << "Failed to parse JSON: " << message
                    << ", error: " << parsedMessage.status();
@@ -76,6 +76,10 @@ class AwsDeltaFileRecordChangeNotifier : public DeltaFileRecordChangeNotifier {
     return nc;
   }
 
+  absl::StatusOr<int64_t> GetBacklog() override {
+    return change_notifier_->GetBacklog();
+  }
+
  private:
   absl::StatusOr<ParsedBody> ParseObjectKeyFromJson(const std::string& body) {
     Aws::Utils::Json::JsonValue json(body);
@@ -94,7 +98,7 @@ class AwsDeltaFileRecordChangeNotifier : public DeltaFileRecordChangeNotifier {
       return absl::InvalidArgumentError(
           "The body of the message is not a base64 encoded string.");
     }
-    ParsedBody pb = {.message = string_decoded};
+    ParsedBody pb = {.message = std::move(string_decoded)};
     const auto message_attributes = view.GetObject("MessageAttributes");
     const auto sns_time_stamp = view.GetObject("Timestamp").AsString();
 
@@ -14,16 +14,22 @@
 
 #include <algorithm>
 #include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
 #include <thread>
 #include <utility>
 #include <vector>
 
 #include "absl/log/log.h"
 #include "absl/status/status.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
 #include "components/data/common/thread_manager.h"
 #include "components/data/realtime/delta_file_record_change_notifier.h"
 #include "components/data/realtime/realtime_notifier.h"
 #include "components/errors/retry.h"
+#include "components/util/thread_pool.h"
 #include "public/constants.h"
 #include "src/telemetry/telemetry.h"
 #include "src/util/duration.h"
@@ -31,118 +37,286 @@
 namespace kv_server {
 namespace {
 
+// Maximum number of received messages waiting to be applied, per applier
+// thread. Receiving waits while that many are pending, so that bursts of
+// messages do not queue up without bound.
+constexpr int64_t kMaxPendingMessagesPerApplierThread = 64;
+
+// How often the number of receivers is adjusted to the queue backlog, and how
+// many waiting messages each receiver is expected to keep up with.
+constexpr absl::Duration kReceiverScalingInterval = absl::Seconds(10);
+constexpr int64_t kBacklogPerReceiver = 100;
+
 class RealtimeNotifierImpl : public RealtimeNotifier {
  public:
+  // If `num_applier_threads` is positive, messages are applied by a pool of
+  // that many threads while the watching thread receives the next ones.
+  // If `max_receivers` is greater than one, up to that many threads receive
+  // messages at once, depending on the backlog of the queue.
   explicit RealtimeNotifierImpl(
       std::unique_ptr<SleepFor> sleep_for,
-      std::unique_ptr<DeltaFileRecordChangeNotifier> change_notifier)
+      std::unique_ptr<DeltaFileRecordChangeNotifier> change_notifier,
+      int32_t num_applier_threads = 0, int32_t max_receivers = 1)
       : thread_manager_(ThreadManager::Create("Realtime notifier")),
         sleep_for_(std::move(sleep_for)),
-        change_notifier_(std::move(change_notifier)) {}
+        change_notifier_(std::move(change_notifier)),
+        num_applier_threads_(num_applier_threads),
+        max_receivers_(std::max(max_receivers, 1)) {}
 
   absl::Status Start(
       std::function<absl::StatusOr<DataLoadingStats>(const std::string& key)>
           callback) override {
-    return thread_manager_->Start([this, &change_notifier = *change_notifier_,
-                                   callback = std::move(callback)]() mutable {
-      Watch(change_notifier, std::move(callback));
-    });
+    if (IsRunning()) {
+      return absl::FailedPreconditionError("Already running");
+    }
+    callback_ = std::move(callback);
+    if (num_applier_threads_ > 0) {
+      applier_pool_ = std::make_unique<ThreadPool>(
+          num_applier_threads_,
+          [](int64_t queue_depth, absl::Duration queue_wait) {
+            LogIfError(KVServerContextMap()
+                           ->SafeMetric()
+                           .LogHistogram<kRealtimeApplyQueueDepth>(
+                               static_cast<double>(queue_depth)));
+          });
+    }
+    return thread_manager_->Start([this]() { Watch(); });
   }
 
   absl::Status Stop() override {
     absl::Status status = sleep_for_->Stop();
     status.Update(thread_manager_->Stop());
+    // Applies the messages that were received before stopping.
+    applier_pool_.reset();
     return status;
   }
 
   bool IsRunning() const override { return thread_manager_->IsRunning(); }
 
  private:
-  void Watch(
-      DeltaFileRecordChangeNotifier& change_notifier,
-      std::function<absl::StatusOr<DataLoadingStats>(const std::string& key)>
-          callback) {
+  // Applies `realtime_message`, received at `notifications_received`, and
+  // logs its latencies.
+  void ApplyMessage(const RealtimeMessage& realtime_message,
+                    absl::Time notifications_received) {
+    if (auto count = callback_(realtime_message.parsed_notification);
+        !count.ok()) {
+      LOG(ERROR) << "Data loading callback failed: " << count.status();
+      LogServerErrorMetric(kRealtimeMessageApplicationFailure);
+    }
+    LogIfError(
+        KVServerContextMap()->SafeMetric().LogHistogram<kRealtimeApplyLag>(
+            absl::ToDoubleMicroseconds(absl::Now() - notifications_received)));
+    auto e2e_cloud_provided_latency = absl::ToDoubleMicroseconds(
+        absl::Now() - realtime_message.notifications_sns_inserted);
+    // we're getting this value based on two different clocks. Opentelemetry
+    // does not allow negative values for histograms. However, not logging
+    // this will affect the pvalues, so the next best thing is set it to 0.
+    if (e2e_cloud_provided_latency < 0) {
+      e2e_cloud_provided_latency = 0;
+    }
+    LogIfError(
+        KVServerContextMap()
+            ->SafeMetric()
+            .LogHistogram<kReceivedLowLatencyNotificationsE2ECloudProvided>(
+                e2e_cloud_provided_latency));
+
+    if (realtime_message.notifications_inserted) {
+      // we're getting this value based on two different clocks.
+      // Opentelemetry does not allow negative values for histograms.
+      // However, not logging this will affect the pvalues, so the next best
+      // thing is set it to 0.
+      auto e2e_latency = absl::ToDoubleMicroseconds(
+          absl::Now() - realtime_message.notifications_inserted.value());
+      if (e2e_latency < 0) {
+        e2e_latency = 0;
+      }
+      LogIfError(KVServerContextMap()
+                     ->SafeMetric()
+                     .LogHistogram<kReceivedLowLatencyNotificationsE2E>(
+                         e2e_latency));
+    }
+  }
+
+  // Schedules `realtime_message` on `applier_pool_`, once fewer than the
+  // maximum number of messages are pending. Messages may be applied out of
+  // order, the cache keeps the update of every key with the latest logical
+  // commit time.
+  void ScheduleMessage(RealtimeMessage realtime_message,
+                       absl::Time notifications_received) {
+    {
+      absl::MutexLock lock(&pending_mutex_);
+      pending_mutex_.Await(absl::Condition(
+          this, &RealtimeNotifierImpl::CanScheduleMessage));
+      ++num_pending_messages_;
+    }
+    applier_pool_->Schedule([this,
+                             realtime_message = std::move(realtime_message),
+                             notifications_received]() {
+      ApplyMessage(realtime_message, notifications_received);
+      absl::MutexLock lock(&pending_mutex_);
+      --num_pending_messages_;
+    });
+  }
+
+  bool CanScheduleMessage() const
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(pending_mutex_) {
+    return num_pending_messages_ <
+           num_applier_threads_ * kMaxPendingMessagesPerApplierThread;
+  }
+
+  // Receives messages on this thread and, if there may be more than one
+  // receiver, on `max_receivers_ - 1` extra threads that only receive while
+  // the backlog of the queue calls for them.
+  void Watch() {
+    {
+      absl::MutexLock lock(&receivers_mutex_);
+      num_active_receivers_ = 1;
+      stop_receivers_ = false;
+    }
+    std::vector<std::thread> receivers;
+    for (int32_t i = 1; i < max_receivers_; ++i) {
+      receivers.emplace_back([this, i]() { ExtraReceiverLoop(i); });
+    }
     // Starts with zero wait to force an initial short poll.
     // Later polls are long polls.
     auto max_wait = absl::ZeroDuration();
     uint32_t sequential_failures = 0;
+    absl::Time next_scaling = absl::InfinitePast();
     while (!thread_manager_->ShouldStop()) {
-      auto updates = change_notifier.GetNotifications(
-          max_wait, [this]() { return thread_manager_->ShouldStop(); });
-
-      if (absl::IsDeadlineExceeded(updates.status())) {
-        sequential_failures = 0;
-        max_wait = absl::InfiniteDuration();
+      if (receivers.empty()) {
+        Receive(max_wait, sequential_failures,
+                [this]() { return thread_manager_->ShouldStop(); });
         continue;
       }
+      if (absl::Now() >= next_scaling) {
+        ScaleReceivers();
+        next_scaling = absl::Now() + kReceiverScalingInterval;
+      }
+      // Returns from long polls in time to scale again.
+      Receive(max_wait, sequential_failures, [this, &next_scaling]() {
+        return thread_manager_->ShouldStop() || absl::Now() >= next_scaling;
+      });
+    }
+    {
+      absl::MutexLock lock(&receivers_mutex_);
+      stop_receivers_ = true;
+    }
+    for (auto& receiver : receivers) {
+      receiver.join();
+    }
+  }
 
-      if (!updates.ok()) {
-        ++sequential_failures;
-        const absl::Duration backoff_time =
-            ExponentialBackoffForRetry(sequential_failures);
-        LOG(ERROR) << "Failed to get realtime notifications: "
-                   << updates.status() << ".  Waiting for " << backoff_time;
-        LogServerErrorMetric(kRealtimeGetNotificationsFailure);
-        if (!sleep_for_->Duration(backoff_time)) {
-          LOG(ERROR) << "Failed to sleep for " << backoff_time
-                     << ".  SleepFor invalid.";
-          LogServerErrorMetric(kRealtimeSleepFailure);
+  // Receives messages while `receiver_index` is below the number of active
+  // receivers, and waits otherwise.
+  void ExtraReceiverLoop(int32_t receiver_index) {
+    auto is_active = [this, receiver_index]() {
+      absl::MutexLock lock(&receivers_mutex_);
+      return receiver_index < num_active_receivers_;
+    };
+    auto max_wait = absl::ZeroDuration();
+    uint32_t sequential_failures = 0;
+    while (true) {
+      {
+        absl::MutexLock lock(&receivers_mutex_);
+        auto can_receive = [this, receiver_index]()
+            ABSL_EXCLUSIVE_LOCKS_REQUIRED(receivers_mutex_) {
+              return stop_receivers_ ||
+                     receiver_index < num_active_receivers_;
+            };
+        receivers_mutex_.Await(absl::Condition(&can_receive));
+        if (stop_receivers_) {
+          return;
         }
-        continue;
       }
+      Receive(max_wait, sequential_failures, [this, &is_active]() {
+        return thread_manager_->ShouldStop() || !is_active();
+      });
+    }
+  }
+
+  // Sets the number of active receivers to one per `kBacklogPerReceiver`
+  // messages waiting in the queue, between one and `max_receivers_`. Keeps
+  // the current number if the backlog is unknown.
+  void ScaleReceivers() {
+    const absl::StatusOr<int64_t> backlog = change_notifier_->GetBacklog();
+    if (!backlog.ok()) {
+      LOG(ERROR) << "Failed to get realtime backlog: " << backlog.status();
+      return;
+    }
+    const int64_t wanted =
+        (*backlog + kBacklogPerReceiver - 1) / kBacklogPerReceiver;
+    const int32_t num_receivers = static_cast<int32_t>(
+        std::clamp<int64_t>(wanted, 1, max_receivers_));
+    absl::MutexLock lock(&receivers_mutex_);
+    if (num_receivers != num_active_receivers_) {
+      LOG(INFO) << "Realtime backlog is " << *backlog << ", using "
+                << num_receivers << " receivers";
+      num_active_receivers_ = num_receivers;
+    }
+  }
+
+  // Receives one batch of messages, waiting up to `max_wait`, and applies or
+  // schedules them. `max_wait` and `sequential_failures` are kept by the
+  // calling receiver across calls.
+  void Receive(absl::Duration& max_wait, uint32_t& sequential_failures,
+               const std::function<bool()>& should_stop_callback) {
+    auto updates =
+        change_notifier_->GetNotifications(max_wait, should_stop_callback);
+
+    if (absl::IsDeadlineExceeded(updates.status())) {
       sequential_failures = 0;
+      max_wait = absl::InfiniteDuration();
+      return;
+    }
 
-      for (const auto& realtime_message : updates->realtime_messages) {
-        if (auto count = callback(realtime_message.parsed_notification);
-            !count.ok()) {
-          LOG(ERROR) << "Data loading callback failed: " << count.status();
-          LogServerErrorMetric(kRealtimeMessageApplicationFailure);
-        }
-        auto e2e_cloud_provided_latency = absl::ToDoubleMicroseconds(
-            absl::Now() - realtime_message.notifications_sns_inserted);
-        // we're getting this value based on two different clocks. Opentelemetry
-        // does not allow negative values for histograms. However, not logging
-        // this will affect the pvalues, so the next best thing is set it to 0.
-        if (e2e_cloud_provided_latency < 0) {
-          e2e_cloud_provided_latency = 0;
-        }
-        LogIfError(
-            KVServerContextMap()
-                ->SafeMetric()
-                .LogHistogram<kReceivedLowLatencyNotificationsE2ECloudProvided>(
-                    e2e_cloud_provided_latency));
-
-        if (realtime_message.notifications_inserted) {
-          // we're getting this value based on two different clocks.
-          // Opentelemetry does not allow negative values for histograms.
-          // However, not logging this will affect the pvalues, so the next best
-          // thing is set it to 0.
-          auto e2e_latency = absl::ToDoubleMicroseconds(
-              absl::Now() - realtime_message.notifications_inserted.value());
-          if (e2e_latency < 0) {
-            e2e_latency = 0;
-          }
-          LogIfError(KVServerContextMap()
-                         ->SafeMetric()
-                         .LogHistogram<kReceivedLowLatencyNotificationsE2E>(
-                             e2e_latency));
-        }
+    if (!updates.ok()) {
+      ++sequential_failures;
+      const absl::Duration backoff_time =
+          ExponentialBackoffForRetry(sequential_failures);
+      LOG(ERROR) << "Failed to get realtime notifications: "
+                 << updates.status() << ".  Waiting for " << backoff_time;
+      LogServerErrorMetric(kRealtimeGetNotificationsFailure);
+      if (!sleep_for_->Duration(backoff_time)) {
+        LOG(ERROR) << "Failed to sleep for " << backoff_time
+                   << ".  SleepFor invalid.";
+        LogServerErrorMetric(kRealtimeSleepFailure);
+      }
+      return;
+    }
+    sequential_failures = 0;
+
+    for (auto& realtime_message : updates->realtime_messages) {
+      if (applier_pool_ == nullptr) {
+        ApplyMessage(realtime_message, updates->notifications_received);
+      } else {
+        ScheduleMessage(std::move(realtime_message),
+                        updates->notifications_received);
       }
-      LogIfError(KVServerContextMap()
-                     ->SafeMetric()
-                     .LogHistogram<kReceivedLowLatencyNotifications>(
-                         absl::ToDoubleMicroseconds(
-                             absl::Now() - updates->notifications_received)));
-      // if we don't move it here, then it will destroy this object
-      // downstack, and the latency of the trace will be incorrect.
-      auto low_latency_scope = std::move(updates->scope);
-      max_wait = absl::InfiniteDuration();
     }
+    LogIfError(KVServerContextMap()
+                   ->SafeMetric()
+                   .LogHistogram<kReceivedLowLatencyNotifications>(
+                       absl::ToDoubleMicroseconds(
+                           absl::Now() - updates->notifications_received)));
+    // if we don't move it here, then it will destroy this object
+    // downstack, and the latency of the trace will be incorrect.
+    auto low_latency_scope = std::move(updates->scope);
+    max_wait = absl::InfiniteDuration();
   }
 
   std::unique_ptr<ThreadManager> thread_manager_;
   std::unique_ptr<SleepFor> sleep_for_;
   std::unique_ptr<DeltaFileRecordChangeNotifier> change_notifier_;
+  const int32_t num_applier_threads_;
+  const int32_t max_receivers_;
+  std::function<absl::StatusOr<DataLoadingStats>(const std::string& key)>
+      callback_;
+  std::unique_ptr<ThreadPool> applier_pool_;
+  absl::Mutex pending_mutex_;
+  int64_t num_pending_messages_ ABSL_GUARDED_BY(pending_mutex_) = 0;
+  absl::Mutex receivers_mutex_;
+  int32_t num_active_receivers_ ABSL_GUARDED_BY(receivers_mutex_) = 1;
+  bool stop_receivers_ ABSL_GUARDED_BY(receivers_mutex_) = false;
 };
 
 }  // namespace
@@ -152,6 +326,13 @@ absl::StatusOr<std::unique_ptr<RealtimeNotifier>> RealtimeNotifier::Create(
     RealtimeNotifierMetadata realtime_notifier_metadata) {
   auto options =
       std::get_if<AwsRealtimeNotifierMetadata>(&realtime_notifier_metadata);
+  int32_t num_applier_threads = 0;
+  int32_t max_receivers = 1;
+  if (auto* aws_metadata = std::get_if<AwsNotifierMetadata>(&notifier_metadata);
+      aws_metadata != nullptr) {
+    num_applier_threads = aws_metadata->num_applier_threads;
+    max_receivers = aws_metadata->max_receivers;
+  }
   std::unique_ptr<DeltaFileRecordChangeNotifier>
       delta_file_record_change_notifier;
   if (options && options->change_notifier_for_unit_testing) {
@@ -173,7 +354,8 @@ absl::StatusOr<std::unique_ptr<RealtimeNotifier>> RealtimeNotifier::Create(
     sleep_for = std::make_unique<SleepFor>();
   }
   return std::make_unique<RealtimeNotifierImpl>(
-      std::move(sleep_for), std::move(delta_file_record_change_notifier));
+      std::move(sleep_for), std::move(delta_file_record_change_notifier),
+      num_applier_threads, max_receivers);
 }
 
 }  // namespace kv_server
@@ -13,9 +13,12 @@
 // limitations under the License.
 
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
+#include "absl/container/flat_hash_set.h"
+#include "absl/synchronization/mutex.h"
 #include "absl/synchronization/notification.h"
 #include "components/data/common/mocks.h"
 #include "components/data/common/mocks_aws.h"
@@ -150,6 +153,83 @@ TEST_F(RealtimeNotifierAwsTest, NotifiesWithHighPriorityUpdates) {
   EXPECT_FALSE((*maybe_notifier)->IsRunning());
 }
 
+TEST_F(RealtimeNotifierAwsTest, AppliesUpdatesOnApplierThreads) {
+  EXPECT_CALL(*change_notifier_, GetNotifications(_, _))
+      .WillOnce([]() {
+        NotificationsContext nc = GetNotificationsContext();
+        nc.realtime_messages = std::vector<RealtimeMessage>(
+            {RealtimeMessage{.parsed_notification = "update_1"},
+             RealtimeMessage{.parsed_notification = "update_2"},
+             RealtimeMessage{.parsed_notification = "update_3"}});
+        return nc;
+      })
+      .WillRepeatedly([]() { return GetNotificationsContext(); });
+
+  absl::Mutex mutex;
+  std::vector<std::string> applied;
+  testing::MockFunction<absl::StatusOr<DataLoadingStats>(
+      const std::string& record)>
+      callback;
+  EXPECT_CALL(callback, Call)
+      .Times(3)
+      .WillRepeatedly([&](const std::string& key) {
+        absl::MutexLock lock(&mutex);
+        applied.push_back(key);
+        return DataLoadingStats{};
+      });
+  AwsRealtimeNotifierMetadata options = {
+      .maybe_sleep_for = std::move(mock_sleep_for_),
+      .change_notifier_for_unit_testing = change_notifier_.release(),
+  };
+  auto maybe_notifier = RealtimeNotifier::Create(
+      AwsNotifierMetadata{.num_applier_threads = 2}, std::move(options));
+  ASSERT_TRUE(maybe_notifier.ok());
+  ASSERT_TRUE((*maybe_notifier)->Start(callback.AsStdFunction()).ok());
+  {
+    absl::MutexLock lock(&mutex);
+    mutex.Await(absl::Condition(
+        +[](std::vector<std::string>* applied) { return applied->size() == 3; },
+        &applied));
+  }
+  ASSERT_TRUE((*maybe_notifier)->Stop().ok());
+  EXPECT_FALSE((*maybe_notifier)->IsRunning());
+  EXPECT_THAT(applied,
+              testing::UnorderedElementsAre("update_1", "update_2", "update_3"));
+}
+
+TEST_F(RealtimeNotifierAwsTest, ReceivesOnMoreThreadsWithBacklog) {
+  EXPECT_CALL(*change_notifier_, GetBacklog).WillRepeatedly(Return(1000));
+  absl::Mutex mutex;
+  absl::flat_hash_set<std::thread::id> receivers;
+  EXPECT_CALL(*change_notifier_, GetNotifications(_, _))
+      .WillRepeatedly([&]() {
+        absl::MutexLock lock(&mutex);
+        receivers.insert(std::this_thread::get_id());
+        return GetNotificationsContext();
+      });
+  testing::MockFunction<absl::StatusOr<DataLoadingStats>(
+      const std::string& record)>
+      callback;
+  AwsRealtimeNotifierMetadata options = {
+      .maybe_sleep_for = std::move(mock_sleep_for_),
+      .change_notifier_for_unit_testing = change_notifier_.release(),
+  };
+  auto maybe_notifier = RealtimeNotifier::Create(
+      AwsNotifierMetadata{.max_receivers = 3}, std::move(options));
+  ASSERT_TRUE(maybe_notifier.ok());
+  ASSERT_TRUE((*maybe_notifier)->Start(callback.AsStdFunction()).ok());
+  {
+    absl::MutexLock lock(&mutex);
+    mutex.Await(absl::Condition(
+        +[](absl::flat_hash_set<std::thread::id>* receivers) {
+          return receivers->size() == 3;
+        },
+        &receivers));
+  }
+  ASSERT_TRUE((*maybe_notifier)->Stop().ok());
+  EXPECT_FALSE((*maybe_notifier)->IsRunning());
+}
+
 TEST_F(RealtimeNotifierAwsTest, GetChangesFailure) {
   std::string high_priority_update_1 = "high_priority_update_1";
   EXPECT_CALL(*change_notifier_, GetNotifications(_, _))
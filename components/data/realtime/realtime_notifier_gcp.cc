@@ -20,6 +20,7 @@
 #include "components/data/common/msg_svc.h"
 #include "components/data/common/thread_manager.h"
 #include "components/data/realtime/realtime_notifier.h"
+#include "components/util/thread_pool.h"
 #include "google/cloud/pubsub/message.h"
 #include "google/cloud/pubsub/subscriber.h"
 #include "src/telemetry/telemetry.h"
@@ -35,11 +36,17 @@ using ::google::cloud::pubsub::Subscriber;
 
 class RealtimeNotifierGcp : public RealtimeNotifier {
  public:
+  // If `num_applier_threads` is positive, messages are applied and acked by a
+  // pool of that many threads instead of the subscriber's callback threads.
+  // Messages stay outstanding until they are acked, so the flow control of the
+  // subscriber bounds the messages waiting for the pool.
   explicit RealtimeNotifierGcp(std::unique_ptr<Subscriber> gcp_subscriber,
-                               std::unique_ptr<SleepFor> sleep_for)
+                               std::unique_ptr<SleepFor> sleep_for,
+                               int32_t num_applier_threads = 0)
       : thread_manager_(ThreadManager::Create("Realtime notifier")),
         sleep_for_(std::move(sleep_for)),
-        gcp_subscriber_(std::move(gcp_subscriber)) {}
+        gcp_subscriber_(std::move(gcp_subscriber)),
+        num_applier_threads_(num_applier_threads) {}
 
   ~RealtimeNotifierGcp() {
     if (const auto s = Stop(); !s.ok()) {
@@ -50,10 +57,21 @@ class RealtimeNotifierGcp : public RealtimeNotifier {
   absl::Status Start(
       std::function<absl::StatusOr<DataLoadingStats>(const std::string& key)>
           callback) override {
-    return thread_manager_->Start(
-        [this, callback = std::move(callback)]() mutable {
-          Watch(std::move(callback));
-        });
+    if (IsRunning()) {
+      return absl::FailedPreconditionError("Already running");
+    }
+    callback_ = std::move(callback);
+    if (num_applier_threads_ > 0) {
+      applier_pool_ = std::make_unique<ThreadPool>(
+          num_applier_threads_,
+          [](int64_t queue_depth, absl::Duration queue_wait) {
+            LogIfError(KVServerContextMap()
+                           ->SafeMetric()
+                           .LogHistogram<kRealtimeApplyQueueDepth>(
+                               static_cast<double>(queue_depth)));
+          });
+    }
+    return thread_manager_->Start([this]() { Watch(); });
   }
 
   absl::Status Stop() override {
@@ -71,6 +89,8 @@ class RealtimeNotifierGcp : public RealtimeNotifier {
     }
     status.Update(thread_manager_->Stop());
     LOG(INFO) << "Thread manager just called stop.";
+    // Applies the messages that were received before stopping.
+    applier_pool_.reset();
     return status;
   }
 
@@ -106,19 +126,18 @@ class RealtimeNotifierGcp : public RealtimeNotifier {
                        absl::ToDoubleMicroseconds(e2eDuration)));
   }
 
-  void OnMessageReceived(
-      pubsub::Message const& m, pubsub::AckHandler h,
-      std::function<absl::StatusOr<DataLoadingStats>(const std::string& key)>&
-          callback) {
+  void OnMessageReceived(pubsub::Message const& m, pubsub::AckHandler h) {
     auto start = absl::Now();
-    std::string string_decoded;
+    // Decodes into a buffer reused by the messages of this thread, whose
+    // records are read in place by the callback.
+    thread_local std::string string_decoded;
     if (!absl::Base64Unescape(m.data(), &string_decoded)) {
       LogServerErrorMetric(kRealtimeDecodeMessageFailure);
       LOG(ERROR) << "The body of the message is not a base64 encoded string.";
       std::move(h).ack();
       return;
     }
-    if (auto count = callback(string_decoded); !count.ok()) {
+    if (auto count = callback_(string_decoded); !count.ok()) {
       LOG(ERROR) << "Data loading callback failed: " << count.status();
       LogServerErrorMetric(kRealtimeMessageApplicationFailure);
     }
@@ -131,14 +150,18 @@ class RealtimeNotifierGcp : public RealtimeNotifier {
                        absl::ToDoubleMicroseconds(absl::Now() - start)));
   }
 
-  void Watch(
-      std::function<absl::StatusOr<DataLoadingStats>(const std::string& key)>
-          callback) {
+  void Watch() {
     {
       absl::MutexLock lock(&mutex_);
       session_ = gcp_subscriber_->Subscribe(
-          [&](pubsub::Message const& m, pubsub::AckHandler h) {
-            OnMessageReceived(m, std::move(h), callback);
+          [this](pubsub::Message const& m, pubsub::AckHandler h) {
+            if (applier_pool_ == nullptr) {
+              OnMessageReceived(m, std::move(h));
+              return;
+            }
+            applier_pool_->Schedule([this, m, h = std::move(h)]() mutable {
+              OnMessageReceived(m, std::move(h));
+            });
           });
     }
     LOG(INFO) << "Realtime updater initialized.";
@@ -151,6 +174,10 @@ class RealtimeNotifierGcp : public RealtimeNotifier {
   future<cloud::Status> session_ ABSL_GUARDED_BY(mutex_);
   std::unique_ptr<SleepFor> sleep_for_;
   std::unique_ptr<Subscriber> gcp_subscriber_;
+  const int32_t num_applier_threads_;
+  std::function<absl::StatusOr<DataLoadingStats>(const std::string& key)>
+      callback_;
+  std::unique_ptr<ThreadPool> applier_pool_;
 };
 
 absl::StatusOr<std::unique_ptr<Subscriber>> CreateSubscriber(
@@ -172,13 +199,25 @@ absl::StatusOr<std::unique_ptr<Subscriber>> CreateSubscriber(
   LOG(INFO) << "Listening to queue_id " << queue_metadata.queue_id
             << " project id " << notifier_metadata.project_id << " with "
             << notifier_metadata.num_threads << " threads.";
-  return std::make_unique<Subscriber>(pubsub::MakeSubscriberConnection(
-      pubsub::Subscription(notifier_metadata.project_id,
-                           queue_metadata.queue_id),
+  auto options =
       Options{}
           .set<pubsub::MaxConcurrencyOption>(notifier_metadata.num_threads)
           .set<GrpcBackgroundThreadPoolSizeOption>(
-              notifier_metadata.num_threads)));
+              notifier_metadata.num_threads);
+  // Flow control limits are only overridden if set, the defaults of the
+  // client library apply otherwise.
+  if (notifier_metadata.max_outstanding_messages > 0) {
+    options.set<pubsub::MaxOutstandingMessagesOption>(
+        notifier_metadata.max_outstanding_messages);
+  }
+  if (notifier_metadata.max_outstanding_bytes > 0) {
+    options.set<pubsub::MaxOutstandingBytesOption>(
+        notifier_metadata.max_outstanding_bytes);
+  }
+  return std::make_unique<Subscriber>(pubsub::MakeSubscriberConnection(
+      pubsub::Subscription(notifier_metadata.project_id,
+                           queue_metadata.queue_id),
+      std::move(options)));
 }
 }  // namespace
 
@@ -193,6 +232,11 @@ absl::StatusOr<std::unique_ptr<RealtimeNotifier>> RealtimeNotifier::Create(
   } else {
     sleep_for = std::make_unique<SleepFor>();
   }
+  int32_t num_applier_threads = 0;
+  if (auto* gcp_metadata = std::get_if<GcpNotifierMetadata>(&metadata);
+      gcp_metadata != nullptr) {
+    num_applier_threads = gcp_metadata->num_applier_threads;
+  }
   std::unique_ptr<Subscriber> gcp_subscriber;
   if (realtime_notifier_metadata &&
       realtime_notifier_metadata->gcp_subscriber_for_unit_testing) {
@@ -205,8 +249,8 @@ absl::StatusOr<std::unique_ptr<RealtimeNotifier>> RealtimeNotifier::Create(
     }
     gcp_subscriber = std::move(*maybe_gcp_subscriber);
   }
-  return std::make_unique<RealtimeNotifierGcp>(std::move(gcp_subscriber),
-                                               std::move(sleep_for));
+  return std::make_unique<RealtimeNotifierGcp>(
+      std::move(gcp_subscriber), std::move(sleep_for), num_applier_threads);
 }
 
 }  // namespace kv_server
@@ -18,6 +18,7 @@
 #include <vector>
 
 #include "absl/strings/escaping.h"
+#include "absl/synchronization/mutex.h"
 #include "absl/synchronization/notification.h"
 #include "components/data/common/mocks.h"
 #include "components/data/realtime/realtime_notifier.h"
@@ -172,5 +173,52 @@ TEST_F(RealtimeNotifierGcpTest, NotifiesWithHighPriorityUpdates) {
   EXPECT_FALSE((*maybe_notifier)->IsRunning());
 }
 
+TEST_F(RealtimeNotifierGcpTest, AppliesAndAcksUpdatesOnApplierThreads) {
+  EXPECT_CALL(*mock_, options);
+  EXPECT_CALL(*mock_, Subscribe)
+      .WillOnce([&](SubscriberConnection::SubscribeParams const& p) {
+        for (const std::string update : {"update_1", "update_2", "update_3"}) {
+          auto ack = std::make_unique<MockAckHandler>();
+          EXPECT_CALL(*ack, ack()).Times(1);
+          auto encoded = absl::Base64Escape(update);
+          p.callback(MessageBuilder{}.SetData(encoded).Build(),
+                     AckHandler(std::move(ack)));
+        }
+        return make_ready_future(google::cloud::Status{});
+      });
+
+  absl::Mutex mutex;
+  std::vector<std::string> applied;
+  testing::MockFunction<absl::StatusOr<DataLoadingStats>(
+      const std::string& record)>
+      callback;
+  EXPECT_CALL(callback, Call)
+      .Times(3)
+      .WillRepeatedly([&](const std::string& key) {
+        absl::MutexLock lock(&mutex);
+        applied.push_back(key);
+        return DataLoadingStats{};
+      });
+  auto subscriber = std::make_unique<Subscriber>(Subscriber(mock_));
+  GcpRealtimeNotifierMetadata options = {
+      .gcp_subscriber_for_unit_testing = subscriber.release(),
+      .maybe_sleep_for = std::move(mock_sleep_for_),
+  };
+  auto maybe_notifier = RealtimeNotifier::Create(
+      GcpNotifierMetadata{.num_applier_threads = 2}, std::move(options));
+  ASSERT_TRUE(maybe_notifier.ok());
+  ASSERT_TRUE((*maybe_notifier)->Start(callback.AsStdFunction()).ok());
+  {
+    absl::MutexLock lock(&mutex);
+    mutex.Await(absl::Condition(
+        +[](std::vector<std::string>* applied) { return applied->size() == 3; },
+        &applied));
+  }
+  ASSERT_TRUE((*maybe_notifier)->Stop().ok());
+  EXPECT_FALSE((*maybe_notifier)->IsRunning());
+  EXPECT_THAT(applied,
+              testing::UnorderedElementsAre("update_1", "update_2", "update_3"));
+}
+
 }  // namespace
 }  // namespace kv_server
@@ -0,0 +1,99 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/data_server/cache/cache.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+#include "components/query/roaring_bitmap.h"
+
+namespace kv_server {
+namespace {
+
+std::vector<std::string> ToDecimalStrings(absl::Span<const uint32_t> values) {
+  std::vector<std::string> strings;
+  strings.reserve(values.size());
+  for (uint32_t value : values) {
+    strings.push_back(absl::StrCat(value));
+  }
+  return strings;
+}
+
+}  // namespace
+
+void KeepHottestKeys(int64_t num_keys_per_prefix, HotKeys& hot_keys) {
+  for (auto& [prefix, keys] : hot_keys) {
+    std::sort(keys.begin(), keys.end(), [](const HotKey& a, const HotKey& b) {
+      return std::tie(b.estimated_lookups, a.key) <
+             std::tie(a.estimated_lookups, b.key);
+    });
+    if (static_cast<int64_t>(keys.size()) > num_keys_per_prefix) {
+      keys.erase(keys.begin() + std::max<int64_t>(num_keys_per_prefix, 0),
+                 keys.end());
+    }
+  }
+}
+
+std::unique_ptr<GetUInt32ValueSetResult> Cache::GetUInt32ValueSet(
+    const RequestContext& request_context,
+    const absl::flat_hash_set<std::string_view>& key_set) const {
+  auto result = GetUInt32ValueSetResult::Create();
+  std::unique_ptr<GetKeyValueSetResult> value_sets =
+      GetKeyValueSet(request_context, key_set);
+  if (value_sets == nullptr) {
+    return result;
+  }
+  for (std::string_view key : key_set) {
+    RoaringBitmap values;
+    for (std::string_view value : value_sets->GetValueSet(key)) {
+      // Skips the values of string sets that are not numbers.
+      if (uint32_t number; absl::SimpleAtoi(value, &number)) {
+        values.Add(number);
+      }
+    }
+    if (!values.IsEmpty()) {
+      result->AddOwnedValueSet(key, std::move(values));
+    }
+  }
+  return result;
+}
+
+void Cache::UpdateKeyValueUInt32Set(std::string_view key,
+                                    absl::Span<const uint32_t> value_set,
+                                    int64_t logical_commit_time,
+                                    std::string_view prefix) {
+  std::vector<std::string> strings = ToDecimalStrings(value_set);
+  std::vector<std::string_view> views(strings.begin(), strings.end());
+  UpdateKeyValueSet(key, absl::MakeSpan(views), logical_commit_time, prefix);
+}
+
+void Cache::DeleteValuesInUInt32Set(std::string_view key,
+                                    absl::Span<const uint32_t> value_set,
+                                    int64_t logical_commit_time,
+                                    std::string_view prefix) {
+  std::vector<std::string> strings = ToDecimalStrings(value_set);
+  std::vector<std::string_view> views(strings.begin(), strings.end());
+  DeleteValuesInSet(key, absl::MakeSpan(views), logical_commit_time, prefix);
+}
+
+}  // namespace kv_server
@@ -17,6 +17,7 @@
 #ifndef COMPONENTS_DATA_SERVER_CACHE_CACHE_H_
 #define COMPONENTS_DATA_SERVER_CACHE_CACHE_H_
 
+#include <cstdint>
 #include <iostream>
 #include <memory>
 #include <string>
@@ -26,11 +27,76 @@
 
 #include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
+#include "absl/functional/function_ref.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+#include "components/data_server/cache/checkpoint_io.h"
+#include "components/data_server/cache/get_key_value_result.h"
 #include "components/data_server/cache/get_key_value_set_result.h"
+#include "components/data_server/cache/get_uint32_value_set_result.h"
 #include "components/util/request_context.h"
 
 namespace kv_server {
 
+// An update or deletion of the cache, see the `Cache` methods of the same
+// names. Holds views of the key and values.
+struct CacheMutation {
+  enum class Type {
+    kUpdateKeyValue,
+    kUpdateKeyValueSet,
+    kDeleteKey,
+    kDeleteValuesInSet,
+    kUpdateKeyValueUInt32Set,
+    kDeleteValuesInUInt32Set,
+  };
+  Type type;
+  std::string_view key;
+  // Set for `kUpdateKeyValue`.
+  std::string_view value;
+  // Set for `kUpdateKeyValueSet` and `kDeleteValuesInSet`.
+  absl::Span<std::string_view> value_set;
+  int64_t logical_commit_time;
+  // Set for `kUpdateKeyValueUInt32Set` and `kDeleteValuesInUInt32Set`.
+  absl::Span<const uint32_t> uint32_value_set = {};
+};
+
+// Amount of data that a cache holds for one prefix, i.e. one data source.
+struct PrefixStats {
+  // Keys with a single value that is not deleted.
+  int64_t num_keys = 0;
+  // Bytes of the keys and values counted by `num_keys`.
+  int64_t value_bytes = 0;
+  // Values of key-value sets that are not deleted.
+  int64_t num_set_values = 0;
+  // Deleted keys and set values that are kept until they are cleaned up.
+  int64_t num_tombstones = 0;
+
+  PrefixStats& operator+=(const PrefixStats& other) {
+    num_keys += other.num_keys;
+    value_bytes += other.value_bytes;
+    num_set_values += other.num_set_values;
+    num_tombstones += other.num_tombstones;
+    return *this;
+  }
+};
+
+// A key that is looked up often, as estimated from a sample of the lookups.
+struct HotKey {
+  std::string key;
+  // Recent lookups of the key, counting older lookups less.
+  int64_t estimated_lookups = 0;
+};
+
+// Hot keys of every prefix.
+using HotKeys = absl::flat_hash_map<std::string, std::vector<HotKey>>;
+
+// Sorts the keys of every prefix of `hot_keys`, hottest first, and keeps the
+// first `num_keys_per_prefix`, e.g. after merging the hot keys of several
+// caches.
+void KeepHottestKeys(int64_t num_keys_per_prefix, HotKeys& hot_keys);
+
 // Interface for in-memory datastore.
 // One cache object is only for keys in one namespace.
 class Cache {
@@ -42,11 +108,24 @@ class Cache {
       const RequestContext& request_context,
       const absl::flat_hash_set<std::string_view>& key_list) const = 0;
 
+  // Looks up the given keys and returns a result with views of the values that
+  // stay valid for the lifetime of the result, without copying the values.
+  virtual std::unique_ptr<GetKeyValueResult> GetKeyValues(
+      const RequestContext& request_context,
+      const absl::flat_hash_set<std::string_view>& key_set) const = 0;
+
   // Looks up and returns key-value set result for the given key set.
   virtual std::unique_ptr<GetKeyValueSetResult> GetKeyValueSet(
       const RequestContext& request_context,
       const absl::flat_hash_set<std::string_view>& key_set) const = 0;
 
+  // Looks up and returns the sets of 32-bit unsigned integers of the given
+  // keys. By default, reads the sets stored by the default
+  // `UpdateKeyValueUInt32Set`, i.e. the values in decimal in string sets.
+  virtual std::unique_ptr<GetUInt32ValueSetResult> GetUInt32ValueSet(
+      const RequestContext& request_context,
+      const absl::flat_hash_set<std::string_view>& key_set) const;
+
   // Inserts or updates the key with the new value for a given prefix
   virtual void UpdateKeyValue(std::string_view key, std::string_view value,
                               int64_t logical_commit_time,
@@ -59,6 +138,14 @@ class Cache {
                                  int64_t logical_commit_time,
                                  std::string_view prefix = "") = 0;
 
+  // Inserts or updates values in the set of 32-bit unsigned integers for a
+  // given key and prefix, like `UpdateKeyValueSet`. By default, stores the
+  // values in decimal in the string set of the key.
+  virtual void UpdateKeyValueUInt32Set(std::string_view key,
+                                       absl::Span<const uint32_t> value_set,
+                                       int64_t logical_commit_time,
+                                       std::string_view prefix = "");
+
   // Deletes a particular (key, value) pair for a given prefix.
   virtual void DeleteKey(std::string_view key, int64_t logical_commit_time,
                          std::string_view prefix = "") = 0;
@@ -71,10 +158,154 @@ class Cache {
                                  int64_t logical_commit_time,
                                  std::string_view prefix = "") = 0;
 
+  // Deletes values in the set of 32-bit unsigned integers for a given key and
+  // prefix, like `DeleteValuesInSet`.
+  virtual void DeleteValuesInUInt32Set(std::string_view key,
+                                       absl::Span<const uint32_t> value_set,
+                                       int64_t logical_commit_time,
+                                       std::string_view prefix = "");
+
   // Removes the values that were deleted before the specified
   // logical_commit_time for a given prefix.
   virtual void RemoveDeletedKeys(int64_t logical_commit_time,
                                  std::string_view prefix = "") = 0;
+
+  // Applies `mutations` for a given prefix, as if by calling the method of
+  // each mutation in order. Implementations may take their locks once for the
+  // whole batch rather than once per mutation.
+  virtual void ApplyBatch(absl::Span<const CacheMutation> mutations,
+                          std::string_view prefix = "") {
+    for (const CacheMutation& mutation : mutations) {
+      switch (mutation.type) {
+        case CacheMutation::Type::kUpdateKeyValue:
+          UpdateKeyValue(mutation.key, mutation.value,
+                         mutation.logical_commit_time, prefix);
+          break;
+        case CacheMutation::Type::kUpdateKeyValueSet:
+          UpdateKeyValueSet(mutation.key, mutation.value_set,
+                            mutation.logical_commit_time, prefix);
+          break;
+        case CacheMutation::Type::kDeleteKey:
+          DeleteKey(mutation.key, mutation.logical_commit_time, prefix);
+          break;
+        case CacheMutation::Type::kDeleteValuesInSet:
+          DeleteValuesInSet(mutation.key, mutation.value_set,
+                            mutation.logical_commit_time, prefix);
+          break;
+        case CacheMutation::Type::kUpdateKeyValueUInt32Set:
+          UpdateKeyValueUInt32Set(mutation.key, mutation.uint32_value_set,
+                                  mutation.logical_commit_time, prefix);
+          break;
+        case CacheMutation::Type::kDeleteValuesInUInt32Set:
+          DeleteValuesInUInt32Set(mutation.key, mutation.uint32_value_set,
+                                  mutation.logical_commit_time, prefix);
+          break;
+      }
+    }
+  }
+
+  // Hints that about `num_keys` keys with a single value and `num_set_keys`
+  // keys with a set of values are about to be added, so that implementations
+  // can grow their tables once instead of rehashing while they are added.
+  virtual void Reserve(int64_t num_keys, int64_t num_set_keys) {}
+
+  // Moves the removal of deleted values from `RemoveDeletedKeys`, which then
+  // only records the cleanup time of the prefix, to a background thread.
+  // Every `interval`, the thread removes the values deleted at or before the
+  // recorded cleanup times, holding each lock for about `max_pause` at a time
+  // so that reads are not blocked for long. Caches that do not support it
+  // return an error and keep removing values in `RemoveDeletedKeys`.
+  virtual absl::Status StartBackgroundCleanup(absl::Duration interval,
+                                              absl::Duration max_pause) {
+    return absl::UnimplementedError("Background cleanup is not supported");
+  }
+
+  // Writes the contents of the cache, including deleted keys and values and
+  // the cleanup times of every prefix, in a layout that `RestoreCheckpoint`
+  // of a cache of the same type loads in bulk. Updates block while the
+  // checkpoint is written.
+  virtual absl::Status WriteCheckpoint(CheckpointWriter& writer) const {
+    return absl::UnimplementedError("Cache checkpoints are not supported.");
+  }
+
+  // Loads a checkpoint written by `WriteCheckpoint` into the cache, which must
+  // be empty. Leaves the cache unchanged on failure.
+  virtual absl::Status RestoreCheckpoint(CheckpointReader& reader) {
+    return absl::UnimplementedError("Cache checkpoints are not supported.");
+  }
+
+  // Starts building the cache, which must be empty, in bulk from data without
+  // conflicting changes, such as snapshot files. Until `FinishBulkLoad` is
+  // called, updates and deletions are only staged, without comparing logical
+  // commit times, and lookups do not see them. Caches that do not support it
+  // return an error and keep applying changes as they come.
+  virtual absl::Status StartBulkLoad() {
+    return absl::UnimplementedError("Bulk loading is not supported.");
+  }
+
+  // Builds the cache from the changes staged since `StartBulkLoad`, keeping
+  // the latest change of every key and set value as if they were applied one
+  // by one, and makes it visible to lookups at once.
+  virtual absl::Status FinishBulkLoad() {
+    return absl::UnimplementedError("Bulk loading is not supported.");
+  }
+
+  // Calls `callback` with every key that has a value or a set of values, and
+  // possibly with keys that were deleted, e.g. to build a filter of the keys.
+  // Updates may be blocked while the keys are visited.
+  virtual absl::Status ForEachKey(
+      absl::FunctionRef<void(std::string_view key)> callback) const {
+    return absl::UnimplementedError("Iterating over keys is not supported.");
+  }
+
+  // Starts keeping an index from every value of the key-value sets to the
+  // keys whose sets hold it, which `GetKeysContaining` reads. Must be called
+  // before any set is added. Caches that do not support it return an error.
+  virtual absl::Status EnableSetValueIndex() {
+    return absl::UnimplementedError("Set value index is not supported.");
+  }
+
+  // Returns the keys whose key-value sets hold `value`, in no particular
+  // order, once `EnableSetValueIndex` was called.
+  virtual absl::StatusOr<std::vector<std::string>> GetKeysContaining(
+      const RequestContext& request_context, std::string_view value) const {
+    return absl::UnimplementedError("Set value index is not supported.");
+  }
+
+  // Starts keeping the keys of the key-value pairs that are not deleted in
+  // order, which `GetKeysWithPrefix` reads. Must be called before any key is
+  // added. Caches that do not support it return an error.
+  virtual absl::Status EnableSortedKeyIndex() {
+    return absl::UnimplementedError("Sorted key index is not supported.");
+  }
+
+  // Returns up to `limit` of the keys starting with `key_prefix`, in order,
+  // once `EnableSortedKeyIndex` was called.
+  virtual absl::StatusOr<std::vector<std::string>> GetKeysWithPrefix(
+      const RequestContext& request_context, std::string_view key_prefix,
+      int64_t limit) const {
+    return absl::UnimplementedError("Sorted key index is not supported.");
+  }
+
+  // Starts estimating how often keys are looked up from one in `sample_rate`
+  // lookups, which `GetHotKeys` reads. Only lookups of keys that are found
+  // are counted. Caches that do not support it return an error.
+  virtual absl::Status EnableHotKeyTracking(int32_t sample_rate) {
+    return absl::UnimplementedError("Hot key tracking is not supported.");
+  }
+
+  // Returns up to `num_keys_per_prefix` of the keys of every prefix that were
+  // looked up the most recently, hottest first, once `EnableHotKeyTracking`
+  // was called. Caches that do not track them return no prefix.
+  virtual HotKeys GetHotKeys(int64_t num_keys_per_prefix) const { return {}; }
+
+  // Returns the amount of data held for every prefix that was updated, which
+  // implementations count as the data changes rather than by scanning it.
+  // Caches that do not count it return no prefix.
+  virtual absl::flat_hash_map<std::string, PrefixStats> GetPrefixStats()
+      const {
+    return {};
+  }
 };
 
 }  // namespace kv_server
@@ -0,0 +1,85 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/data_server/cache/checkpoint_io.h"
+
+#include <cstring>
+
+namespace kv_server {
+
+void CheckpointWriter::WriteInt64(int64_t value) {
+  output_.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void CheckpointWriter::WriteBool(bool value) {
+  output_.put(value ? 1 : 0);
+}
+
+void CheckpointWriter::WriteString(std::string_view value) {
+  WriteInt64(value.size());
+  output_.write(value.data(), value.size());
+}
+
+absl::Status CheckpointWriter::status() const {
+  if (!output_) {
+    return absl::DataLossError("Unable to write checkpoint.");
+  }
+  return absl::OkStatus();
+}
+
+bool CheckpointReader::ReadInt64(int64_t* value) {
+  if (data_.size() < sizeof(*value)) {
+    return false;
+  }
+  std::memcpy(value, data_.data(), sizeof(*value));
+  data_.remove_prefix(sizeof(*value));
+  return true;
+}
+
+bool CheckpointReader::ReadBool(bool* value) {
+  if (data_.empty()) {
+    return false;
+  }
+  *value = data_.front() != 0;
+  data_.remove_prefix(1);
+  return true;
+}
+
+bool CheckpointReader::ReadString(std::string_view* value) {
+  std::string_view data = data_;
+  size_t size;
+  if (!ReadCount(&size)) {
+    data_ = data;
+    return false;
+  }
+  *value = data_.substr(0, size);
+  data_.remove_prefix(size);
+  return true;
+}
+
+bool CheckpointReader::ReadCount(size_t* count) {
+  std::string_view data = data_;
+  int64_t value;
+  if (!ReadInt64(&value)) {
+    return false;
+  }
+  if (value < 0 || static_cast<uint64_t>(value) > data_.size()) {
+    data_ = data;
+    return false;
+  }
+  *count = value;
+  return true;
+}
+
+}  // namespace kv_server
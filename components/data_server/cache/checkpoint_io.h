@@ -0,0 +1,70 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef COMPONENTS_DATA_SERVER_CACHE_CHECKPOINT_IO_H_
+#define COMPONENTS_DATA_SERVER_CACHE_CHECKPOINT_IO_H_
+
+#include <cstdint>
+#include <ostream>
+#include <string_view>
+
+#include "absl/status/status.h"
+
+namespace kv_server {
+
+// Writes the fields of a cache checkpoint. Integers are written in the byte
+// order of the host, checkpoints are only read back on the machine that wrote
+// them.
+class CheckpointWriter {
+ public:
+  explicit CheckpointWriter(std::ostream& output) : output_(output) {}
+
+  void WriteInt64(int64_t value);
+  void WriteBool(bool value);
+  // Writes the size of `value` followed by its bytes.
+  void WriteString(std::string_view value);
+
+  // Returns an error if any write failed.
+  absl::Status status() const;
+
+ private:
+  std::ostream& output_;
+};
+
+// Reads the fields written by a `CheckpointWriter` from memory. Strings are
+// read as views of the memory. Every read returns false, leaving its output
+// unset, if the data ends before the field.
+class CheckpointReader {
+ public:
+  explicit CheckpointReader(std::string_view data) : data_(data) {}
+
+  bool ReadInt64(int64_t* value);
+  bool ReadBool(bool* value);
+  bool ReadString(std::string_view* value);
+  // Reads the number of elements that follow. Every element takes at least
+  // one byte, so larger counts than the remaining bytes are rejected before
+  // callers reserve memory for them.
+  bool ReadCount(size_t* count);
+
+  size_t remaining() const { return data_.size(); }
+
+ private:
+  std::string_view data_;
+};
+
+}  // namespace kv_server
+
+#endif  // COMPONENTS_DATA_SERVER_CACHE_CHECKPOINT_IO_H_
@@ -0,0 +1,88 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/data_server/cache/checkpoint_io.h"
+
+#include <sstream>
+#include <string>
+#include <string_view>
+
+#include "gtest/gtest.h"
+
+namespace kv_server {
+namespace {
+
+TEST(CheckpointIoTest, ReadsWrittenFields) {
+  std::ostringstream output;
+  CheckpointWriter writer(output);
+  writer.WriteInt64(-42);
+  writer.WriteBool(true);
+  writer.WriteString("value");
+  writer.WriteString("");
+  ASSERT_TRUE(writer.status().ok());
+
+  const std::string data = output.str();
+  CheckpointReader reader(data);
+  int64_t number;
+  ASSERT_TRUE(reader.ReadInt64(&number));
+  EXPECT_EQ(number, -42);
+  bool flag;
+  ASSERT_TRUE(reader.ReadBool(&flag));
+  EXPECT_TRUE(flag);
+  std::string_view value;
+  ASSERT_TRUE(reader.ReadString(&value));
+  EXPECT_EQ(value, "value");
+  // Strings are views of the data.
+  EXPECT_GE(value.data(), data.data());
+  EXPECT_LT(value.data(), data.data() + data.size());
+  ASSERT_TRUE(reader.ReadString(&value));
+  EXPECT_EQ(value, "");
+  EXPECT_EQ(reader.remaining(), 0);
+  EXPECT_FALSE(reader.ReadInt64(&number));
+  EXPECT_FALSE(reader.ReadBool(&flag));
+}
+
+TEST(CheckpointIoTest, RejectsTruncatedStrings) {
+  std::ostringstream output;
+  CheckpointWriter writer(output);
+  writer.WriteString("value");
+  const std::string data = output.str();
+  CheckpointReader reader(std::string_view(data).substr(0, data.size() - 1));
+  std::string_view value;
+  EXPECT_FALSE(reader.ReadString(&value));
+  // Failed reads consume nothing.
+  EXPECT_EQ(reader.remaining(), data.size() - 1);
+}
+
+TEST(CheckpointIoTest, RejectsInvalidCounts) {
+  std::ostringstream output;
+  CheckpointWriter writer(output);
+  writer.WriteInt64(100);
+  writer.WriteInt64(-1);
+  writer.WriteInt64(1);
+  writer.WriteBool(false);
+  const std::string data = output.str();
+  CheckpointReader reader(data);
+  size_t count;
+  int64_t number;
+  EXPECT_FALSE(reader.ReadCount(&count));
+  ASSERT_TRUE(reader.ReadInt64(&number));
+  EXPECT_FALSE(reader.ReadCount(&count));
+  ASSERT_TRUE(reader.ReadInt64(&number));
+  ASSERT_TRUE(reader.ReadCount(&count));
+  EXPECT_EQ(count, 1);
+}
+
+}  // namespace
+}  // namespace kv_server
@@ -0,0 +1,337 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/data_server/cache/cold_value_log.h"
+
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/log/log.h"
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+
+namespace kv_server {
+namespace {
+
+// Reads `size` bytes at `offset` of `fd` into `data`.
+absl::Status ReadFully(int fd, char* data, size_t size, uint64_t offset) {
+  size_t read = 0;
+  while (read < size) {
+    const ssize_t result = pread(fd, data + read, size - read, offset + read);
+    if (result < 0 && errno == EINTR) {
+      continue;
+    }
+    if (result < 0) {
+      return absl::ErrnoToStatus(errno, "Failed to read a cold value");
+    }
+    if (result == 0) {
+      return absl::DataLossError(
+          absl::StrCat("Cold value at ", offset, " is truncated"));
+    }
+    read += result;
+  }
+  return absl::OkStatus();
+}
+
+// Read of a batch, with the number of bytes read or a negated errno once it
+// completed.
+struct PendingRead {
+  char* data;
+  uint32_t size;
+  uint64_t offset;
+  int result = 0;
+};
+
+// Submission and completion queues of an io_uring, set up with the raw system
+// calls, liburing is not a dependency of the server.
+class IoUring {
+ public:
+  static constexpr unsigned kEntries = 64;
+
+  // Returns the ring of the calling thread, or null if io_uring is not
+  // available, e.g. because of the kernel version or of seccomp.
+  static IoUring* ForThread() {
+    thread_local std::unique_ptr<IoUring> ring = Create();
+    return ring.get();
+  }
+
+  ~IoUring() {
+    if (sqes_ != MAP_FAILED) {
+      munmap(sqes_, sqes_size_);
+    }
+    if (cq_ring_ != MAP_FAILED && cq_ring_ != sq_ring_) {
+      munmap(cq_ring_, cq_ring_size_);
+    }
+    if (sq_ring_ != MAP_FAILED) {
+      munmap(sq_ring_, sq_ring_size_);
+    }
+    close(fd_);
+  }
+
+  // Submits at most `kEntries` reads of `fd` at once, and waits for all of
+  // them to complete. Returns false, without reading anything, if they could
+  // not be submitted.
+  bool Read(int fd, absl::Span<PendingRead> reads) {
+    unsigned tail = *sq_tail_;
+    for (size_t i = 0; i < reads.size(); i++) {
+      const unsigned index = tail & *sq_mask_;
+      io_uring_sqe& sqe = sqes_[index];
+      std::memset(&sqe, 0, sizeof(sqe));
+      sqe.opcode = IORING_OP_READ;
+      sqe.fd = fd;
+      sqe.addr = reinterpret_cast<uint64_t>(reads[i].data);
+      sqe.len = reads[i].size;
+      sqe.off = reads[i].offset;
+      sqe.user_data = i;
+      sq_array_[index] = index;
+      tail++;
+    }
+    __atomic_store_n(sq_tail_, tail, __ATOMIC_RELEASE);
+    unsigned to_submit = reads.size();
+    size_t num_completed = 0;
+    while (num_completed < reads.size()) {
+      const int result =
+          syscall(__NR_io_uring_enter, fd_, to_submit, /*min_complete=*/1,
+                  IORING_ENTER_GETEVENTS, nullptr, 0);
+      if (result < 0) {
+        if (to_submit == reads.size() && errno != EINTR && errno != EAGAIN &&
+            errno != EBUSY) {
+          // Takes the reads back, the kernel did not see them.
+          __atomic_store_n(sq_tail_, tail - to_submit, __ATOMIC_RELEASE);
+          return false;
+        }
+        continue;
+      }
+      to_submit -= std::min<unsigned>(result, to_submit);
+      unsigned head = *cq_head_;
+      const unsigned cq_tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+      for (; head != cq_tail; head++) {
+        const io_uring_cqe& cqe = cqes_[head & *cq_mask_];
+        reads[cqe.user_data].result = cqe.res;
+        num_completed++;
+      }
+      __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+    }
+    return true;
+  }
+
+ private:
+  explicit IoUring(int fd) : fd_(fd) {}
+
+  static std::unique_ptr<IoUring> Create() {
+    io_uring_params params = {};
+    const int fd = syscall(__NR_io_uring_setup, kEntries, &params);
+    if (fd < 0) {
+      VLOG(1) << "Reading cold values without io_uring: "
+              << absl::ErrnoToStatus(errno, "io_uring_setup");
+      return nullptr;
+    }
+    auto ring = absl::WrapUnique(new IoUring(fd));
+    ring->sq_ring_size_ =
+        params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cq_ring_size_ =
+        params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    const bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single_mmap) {
+      ring->sq_ring_size_ = std::max(ring->sq_ring_size_, ring->cq_ring_size_);
+    }
+    ring->sq_ring_ =
+        mmap(nullptr, ring->sq_ring_size_, PROT_READ | PROT_WRITE,
+             MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (ring->sq_ring_ == MAP_FAILED) {
+      return nullptr;
+    }
+    ring->cq_ring_ =
+        single_mmap ? ring->sq_ring_
+                    : mmap(nullptr, ring->cq_ring_size_, PROT_READ | PROT_WRITE,
+                           MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+    if (ring->cq_ring_ == MAP_FAILED) {
+      return nullptr;
+    }
+    ring->sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+    void* sqes = mmap(nullptr, ring->sqes_size_, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) {
+      return nullptr;
+    }
+    ring->sqes_ = static_cast<io_uring_sqe*>(sqes);
+    char* sq_ring = static_cast<char*>(ring->sq_ring_);
+    ring->sq_tail_ = reinterpret_cast<unsigned*>(sq_ring + params.sq_off.tail);
+    ring->sq_mask_ =
+        reinterpret_cast<unsigned*>(sq_ring + params.sq_off.ring_mask);
+    ring->sq_array_ =
+        reinterpret_cast<unsigned*>(sq_ring + params.sq_off.array);
+    char* cq_ring = static_cast<char*>(ring->cq_ring_);
+    ring->cq_head_ = reinterpret_cast<unsigned*>(cq_ring + params.cq_off.head);
+    ring->cq_tail_ = reinterpret_cast<unsigned*>(cq_ring + params.cq_off.tail);
+    ring->cq_mask_ =
+        reinterpret_cast<unsigned*>(cq_ring + params.cq_off.ring_mask);
+    ring->cqes_ =
+        reinterpret_cast<io_uring_cqe*>(cq_ring + params.cq_off.cqes);
+    return ring;
+  }
+
+  const int fd_;
+  void* sq_ring_ = MAP_FAILED;
+  size_t sq_ring_size_ = 0;
+  void* cq_ring_ = MAP_FAILED;
+  size_t cq_ring_size_ = 0;
+  io_uring_sqe* sqes_ = static_cast<io_uring_sqe*>(MAP_FAILED);
+  size_t sqes_size_ = 0;
+  unsigned* sq_tail_ = nullptr;
+  unsigned* sq_mask_ = nullptr;
+  unsigned* sq_array_ = nullptr;
+  unsigned* cq_head_ = nullptr;
+  unsigned* cq_tail_ = nullptr;
+  unsigned* cq_mask_ = nullptr;
+  io_uring_cqe* cqes_ = nullptr;
+};
+
+}  // namespace
+
+absl::StatusOr<std::unique_ptr<ColdValueLog>> ColdValueLog::Create(
+    Options options) {
+  std::string path =
+      (std::filesystem::path(options.directory) / "kv_cold_values.XXXXXX")
+          .string();
+  const int fd = mkstemp(path.data());
+  if (fd < 0) {
+    return absl::ErrnoToStatus(
+        errno, absl::StrCat("Failed to create a cold value log in ",
+                            options.directory));
+  }
+  // The open descriptor keeps the file until the log closes it, also when the
+  // server exits without cleaning up.
+  if (unlink(path.c_str()) != 0) {
+    const int error = errno;
+    close(fd);
+    return absl::ErrnoToStatus(error, absl::StrCat("Failed to unlink ", path));
+  }
+  return absl::WrapUnique(new ColdValueLog(std::move(options), fd));
+}
+
+ColdValueLog::ColdValueLog(Options options, int fd)
+    : options_(std::move(options)), fd_(fd) {}
+
+ColdValueLog::~ColdValueLog() { close(fd_); }
+
+absl::StatusOr<ColdValueLog::Location> ColdValueLog::Append(
+    std::string_view value) {
+  absl::MutexLock lock(&mutex_);
+  const Location location = {.offset = end_offset_,
+                             .size = static_cast<uint32_t>(value.size())};
+  size_t written = 0;
+  while (written < value.size()) {
+    const ssize_t size = pwrite(fd_, value.data() + written,
+                                value.size() - written, end_offset_ + written);
+    if (size < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      // Partially written bytes are skipped by the next append.
+      end_offset_ += written;
+      return absl::ErrnoToStatus(errno, "Failed to append a cold value");
+    }
+    written += size;
+  }
+  end_offset_ += value.size();
+  live_bytes_ += value.size();
+  return location;
+}
+
+absl::Status ColdValueLog::Read(Location location, std::string& buffer) const {
+  buffer.resize(location.size);
+  return ReadFully(fd_, buffer.data(), location.size, location.offset);
+}
+
+std::vector<absl::Status> ColdValueLog::ReadBatch(
+    absl::Span<const Location> locations,
+    absl::Span<std::string* const> buffers) const {
+  std::vector<PendingRead> reads;
+  reads.reserve(locations.size());
+  for (size_t i = 0; i < locations.size(); i++) {
+    buffers[i]->resize(locations[i].size);
+    reads.push_back({.data = buffers[i]->data(),
+                     .size = locations[i].size,
+                     .offset = locations[i].offset});
+  }
+  // A single read gains nothing from the ring.
+  if (IoUring* ring = reads.size() > 1 ? IoUring::ForThread() : nullptr;
+      ring != nullptr) {
+    for (size_t i = 0; i < reads.size(); i += IoUring::kEntries) {
+      const size_t size = std::min<size_t>(IoUring::kEntries, reads.size() - i);
+      if (!ring->Read(fd_, absl::MakeSpan(reads).subspan(i, size))) {
+        break;
+      }
+    }
+  }
+  // Completes the reads that the ring did not, or only partly did.
+  std::vector<absl::Status> statuses;
+  statuses.reserve(reads.size());
+  for (const PendingRead& read : reads) {
+    const uint32_t done = std::max(read.result, 0);
+    statuses.push_back(done >= read.size
+                           ? absl::OkStatus()
+                           : ReadFully(fd_, read.data + done, read.size - done,
+                                       read.offset + done));
+  }
+  return statuses;
+}
+
+void ColdValueLog::Retain(Location location) {
+  absl::MutexLock lock(&mutex_);
+  extra_references_[location.offset]++;
+}
+
+void ColdValueLog::Release(Location location) {
+  {
+    absl::MutexLock lock(&mutex_);
+    if (const auto iter = extra_references_.find(location.offset);
+        iter != extra_references_.end()) {
+      if (--iter->second == 0) {
+        extra_references_.erase(iter);
+      }
+      return;
+    }
+    live_bytes_ -= location.size;
+  }
+  // Only frees the file system blocks that the value covers entirely, the
+  // file keeps its size.
+  if (fallocate(fd_, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE,
+                location.offset, location.size) != 0) {
+    VLOG(2) << "Failed to reclaim the space of a cold value: "
+            << absl::ErrnoToStatus(errno, "fallocate");
+  }
+}
+
+int64_t ColdValueLog::live_bytes() const {
+  absl::MutexLock lock(&mutex_);
+  return live_bytes_;
+}
+
+}  // namespace kv_server
@@ -0,0 +1,114 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef COMPONENTS_DATA_SERVER_CACHE_COLD_VALUE_LOG_H_
+#define COMPONENTS_DATA_SERVER_CACHE_COLD_VALUE_LOG_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/span.h"
+
+namespace kv_server {
+
+// Append-only file on local disk that caches spill their cold values into,
+// so that only their keys and hot values are kept in memory. The file is
+// removed from the directory as soon as it is created, and its space is
+// reclaimed when the log is destroyed. The space of released values is
+// returned to the file system right away by punching holes, so that values
+// never move and their locations stay valid.
+//
+// Thread safe.
+class ColdValueLog {
+ public:
+  struct Options {
+    // Directory to create the file in, preferably on a local SSD.
+    std::string directory;
+    // Bytes of values that every cache spilling into the log keeps in memory.
+    int64_t max_hot_value_bytes = int64_t{1} << 30;
+    // Values smaller than this are always kept in memory, their location
+    // takes about as much memory as they do.
+    size_t min_cold_value_size = 256;
+    // Number of lookups of a cold value between two rebalancings of the cache
+    // that bring it back into memory.
+    uint8_t promotion_lookups = 2;
+  };
+
+  // Where a value was appended to the log.
+  struct Location {
+    uint64_t offset;
+    uint32_t size;
+  };
+
+  static absl::StatusOr<std::unique_ptr<ColdValueLog>> Create(Options options);
+  ~ColdValueLog();
+
+  ColdValueLog(const ColdValueLog&) = delete;
+  ColdValueLog& operator=(const ColdValueLog&) = delete;
+
+  const Options& options() const { return options_; }
+
+  // Appends `value` to the log. The location holds one reference.
+  absl::StatusOr<Location> Append(std::string_view value)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Reads the value at `location`, which must be referenced, into `buffer`.
+  absl::Status Read(Location location, std::string& buffer) const;
+  // Reads the values at `locations` into the matching `buffers`, and returns
+  // the status of every read. The reads are submitted together through an
+  // io_uring of the calling thread where the kernel allows it, so that they
+  // cost one system call and are served concurrently by the disk.
+  std::vector<absl::Status> ReadBatch(
+      absl::Span<const Location> locations,
+      absl::Span<std::string* const> buffers) const;
+
+  // Adds a reference to `location`, which must be referenced already.
+  void Retain(Location location) ABSL_LOCKS_EXCLUDED(mutex_);
+  // Drops a reference added by `Append` or `Retain`. Once the last reference
+  // is dropped, the space of the value is reclaimed.
+  void Release(Location location) ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Returns the total size of the referenced values.
+  int64_t live_bytes() const ABSL_LOCKS_EXCLUDED(mutex_);
+
+ private:
+  ColdValueLog(Options options, int fd);
+
+  const Options options_;
+  const int fd_;
+  mutable absl::Mutex mutex_;
+  // Offset that the next value is appended at.
+  uint64_t end_offset_ ABSL_GUARDED_BY(mutex_) = 0;
+  int64_t live_bytes_ ABSL_GUARDED_BY(mutex_) = 0;
+  // References to the values at these offsets beyond the first one. Values
+  // are only referenced more than once for short periods, while the records
+  // that hold them are moved.
+  absl::flat_hash_map<uint64_t, uint32_t> extra_references_
+      ABSL_GUARDED_BY(mutex_);
+};
+
+}  // namespace kv_server
+
+#endif  // COMPONENTS_DATA_SERVER_CACHE_COLD_VALUE_LOG_H_
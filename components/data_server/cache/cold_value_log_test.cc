@@ -0,0 +1,99 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/data_server/cache/cold_value_log.h"
+
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace kv_server {
+namespace {
+
+std::unique_ptr<ColdValueLog> CreateLog() {
+  auto log = ColdValueLog::Create(
+      {.directory = std::filesystem::temp_directory_path().string()});
+  EXPECT_TRUE(log.ok()) << log.status();
+  return log.ok() ? *std::move(log) : nullptr;
+}
+
+TEST(ColdValueLogTest, ReadsAppendedValues) {
+  std::unique_ptr<ColdValueLog> log = CreateLog();
+  ASSERT_NE(log, nullptr);
+  const std::string large_value(100000, 'x');
+  const auto first = log->Append("first");
+  const auto large = log->Append(large_value);
+  const auto empty = log->Append("");
+  ASSERT_TRUE(first.ok() && large.ok() && empty.ok());
+  std::string buffer;
+  ASSERT_TRUE(log->Read(*first, buffer).ok());
+  EXPECT_EQ(buffer, "first");
+  ASSERT_TRUE(log->Read(*large, buffer).ok());
+  EXPECT_EQ(buffer, large_value);
+  ASSERT_TRUE(log->Read(*empty, buffer).ok());
+  EXPECT_EQ(buffer, "");
+  EXPECT_EQ(log->live_bytes(), large_value.size() + 5);
+}
+
+TEST(ColdValueLogTest, ReadsBatchesOfValues) {
+  std::unique_ptr<ColdValueLog> log = CreateLog();
+  ASSERT_NE(log, nullptr);
+  // More values than fit in one submission of the ring.
+  std::vector<ColdValueLog::Location> locations;
+  for (int i = 0; i < 100; i++) {
+    const auto location = log->Append(std::string(i * 100, 'a' + i % 26));
+    ASSERT_TRUE(location.ok());
+    locations.push_back(*location);
+  }
+  std::vector<std::string> buffers(locations.size());
+  std::vector<std::string*> buffer_pointers;
+  for (std::string& buffer : buffers) {
+    buffer_pointers.push_back(&buffer);
+  }
+  const std::vector<absl::Status> statuses =
+      log->ReadBatch(locations, buffer_pointers);
+  ASSERT_EQ(statuses.size(), locations.size());
+  for (int i = 0; i < 100; i++) {
+    EXPECT_TRUE(statuses[i].ok()) << statuses[i];
+    EXPECT_EQ(buffers[i], std::string(i * 100, 'a' + i % 26));
+  }
+}
+
+TEST(ColdValueLogTest, ReleasesValuesWithTheirLastReference) {
+  std::unique_ptr<ColdValueLog> log = CreateLog();
+  ASSERT_NE(log, nullptr);
+  const auto first = log->Append("first");
+  const auto second = log->Append("second");
+  ASSERT_TRUE(first.ok() && second.ok());
+  log->Retain(*first);
+  log->Release(*first);
+  EXPECT_EQ(log->live_bytes(), 11);
+  log->Release(*first);
+  EXPECT_EQ(log->live_bytes(), 6);
+  // Releasing a value leaves the others where they are.
+  std::string buffer;
+  ASSERT_TRUE(log->Read(*second, buffer).ok());
+  EXPECT_EQ(buffer, "second");
+}
+
+TEST(ColdValueLogTest, FailsWithMissingDirectory) {
+  EXPECT_FALSE(ColdValueLog::Create({.directory = "/nonexistent/directory"})
+                   .ok());
+}
+
+}  // namespace
+}  // namespace kv_server
@@ -0,0 +1,624 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef COMPONENTS_DATA_SERVER_CACHE_COMPACT_STRING_MAP_H_
+#define COMPONENTS_DATA_SERVER_CACHE_COMPACT_STRING_MAP_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+
+namespace kv_server {
+
+// Map from strings to small trivially copyable values, sized for the many
+// small value sets of the cache.
+//
+// Up to `kMaxPackedSize` elements are packed back to back into a single
+// exactly sized buffer, so that a small map costs one allocation and no
+// per-element overhead besides a length. Up to `kMaxSortedSize` elements are
+// kept in a sorted array of offsets into a shared key buffer and looked up
+// with binary search. Larger maps use a hash map. Maps switch back to the
+// smaller representations once they shrink to half of these limits.
+//
+// `Compact` front codes larger maps instead, for sets that mostly stay the
+// same once loaded: keys are sorted into blocks of `kFrontCodedBlockSize`,
+// and every key but the first of a block is stored as the size of the prefix
+// it shares with the previous key and the rest of the key. This takes much
+// less memory for keys with long common prefixes, like URLs, but lookups
+// decode part of a block. Keys inserted afterwards are kept in a hash map
+// next to the blocks, and erased keys are only marked, until the map is
+// compacted again.
+//
+// Keys passed to `ForEach` are only valid until `fn` returns.
+template <typename Mapped>
+class CompactStringMap {
+  static_assert(std::is_trivially_copyable_v<Mapped>,
+                "Packed elements are copied bytewise.");
+
+ public:
+  static constexpr size_t kMaxPackedSize = 8;
+  static constexpr size_t kMaxSortedSize = 128;
+  static constexpr size_t kFrontCodedBlockSize = 16;
+
+  // Returns the value for `key`, if any.
+  std::optional<Mapped> find(std::string_view key) const {
+    if (const auto* packed = std::get_if<PackedElements>(&elements_)) {
+      const size_t offset = PackedLowerBound(*packed, key);
+      if (offset == packed->size || PackedKey(*packed, offset) != key) {
+        return std::nullopt;
+      }
+      return PackedValue(*packed, offset);
+    }
+    if (const auto* sorted = std::get_if<SortedElements>(&elements_)) {
+      auto it = SortedLowerBound(*sorted, key);
+      if (it == sorted->entries.end() || SortedKey(*sorted, *it) != key) {
+        return std::nullopt;
+      }
+      return it->value;
+    }
+    if (const auto* front_coded =
+            std::get_if<std::unique_ptr<FrontCodedElements>>(&elements_)) {
+      const FrontCodedElements& elements = **front_coded;
+      if (const std::optional<size_t> index = FrontCodedIndex(elements, key);
+          index.has_value()) {
+        if (elements.erased[*index]) {
+          return std::nullopt;
+        }
+        return elements.values[*index];
+      }
+      auto it = elements.overlay.find(key);
+      if (it == elements.overlay.end()) {
+        return std::nullopt;
+      }
+      return it->second;
+    }
+    const auto& hashed = *std::get<std::unique_ptr<HashedElements>>(elements_);
+    auto it = hashed.find(key);
+    if (it == hashed.end()) {
+      return std::nullopt;
+    }
+    return it->second;
+  }
+
+  // Inserts `key` with `value` or replaces its existing value.
+  void insert_or_assign(std::string_view key, const Mapped& value) {
+    if (auto* front_coded =
+            std::get_if<std::unique_ptr<FrontCodedElements>>(&elements_)) {
+      FrontCodedElements& elements = **front_coded;
+      if (const std::optional<size_t> index = FrontCodedIndex(elements, key);
+          index.has_value()) {
+        elements.values[*index] = value;
+        if (elements.erased[*index]) {
+          elements.erased[*index] = false;
+          elements.num_erased--;
+        }
+        return;
+      }
+      elements.overlay.insert_or_assign(key, value);
+      // Merged into the blocks once it holds a fair share of the elements,
+      // so that a map that keeps growing stays mostly front coded.
+      if (elements.overlay.size() > kMaxSortedSize &&
+          elements.overlay.size() > elements.values.size() / 8) {
+        elements_ = ToFrontCoded(SortedCopy());
+      }
+      return;
+    }
+    if (auto* packed = std::get_if<PackedElements>(&elements_)) {
+      const size_t offset = PackedLowerBound(*packed, key);
+      if (offset < packed->size && PackedKey(*packed, offset) == key) {
+        std::memcpy(packed->data.get() + offset + sizeof(uint32_t), &value,
+                    sizeof(Mapped));
+        return;
+      }
+      if (PackedSize(*packed) < kMaxPackedSize) {
+        PackedInsert(*packed, offset, key, value);
+        return;
+      }
+      elements_ = ToSorted(*packed);
+    }
+    if (auto* sorted = std::get_if<SortedElements>(&elements_)) {
+      auto it = SortedLowerBound(*sorted, key);
+      if (it != sorted->entries.end() && SortedKey(*sorted, *it) == key) {
+        it->value = value;
+        return;
+      }
+      if (sorted->entries.size() < kMaxSortedSize) {
+        SortedInsert(*sorted, it, key, value);
+        return;
+      }
+      auto hashed = std::make_unique<HashedElements>();
+      hashed->reserve(sorted->entries.size() + 1);
+      for (const SortedEntry& entry : sorted->entries) {
+        hashed->emplace(SortedKey(*sorted, entry), entry.value);
+      }
+      elements_ = std::move(hashed);
+    }
+    std::get<std::unique_ptr<HashedElements>>(elements_)->insert_or_assign(
+        key, value);
+  }
+
+  // Removes the element for `key`. Returns whether there was one.
+  bool erase(std::string_view key) {
+    if (auto* packed = std::get_if<PackedElements>(&elements_)) {
+      const size_t offset = PackedLowerBound(*packed, key);
+      if (offset == packed->size || PackedKey(*packed, offset) != key) {
+        return false;
+      }
+      PackedErase(*packed, offset);
+      return true;
+    }
+    if (auto* sorted = std::get_if<SortedElements>(&elements_)) {
+      auto it = SortedLowerBound(*sorted, key);
+      if (it == sorted->entries.end() || SortedKey(*sorted, *it) != key) {
+        return false;
+      }
+      SortedErase(*sorted, it);
+      if (sorted->entries.size() <= kMaxPackedSize / 2) {
+        PackedElements packed;
+        for (const SortedEntry& entry : sorted->entries) {
+          PackedInsert(packed, packed.size, SortedKey(*sorted, entry),
+                       entry.value);
+        }
+        elements_ = std::move(packed);
+      }
+      return true;
+    }
+    if (auto* front_coded =
+            std::get_if<std::unique_ptr<FrontCodedElements>>(&elements_)) {
+      FrontCodedElements& elements = **front_coded;
+      if (const std::optional<size_t> index = FrontCodedIndex(elements, key);
+          index.has_value()) {
+        if (elements.erased[*index]) {
+          return false;
+        }
+        elements.erased[*index] = true;
+        elements.num_erased++;
+      } else if (elements.overlay.erase(key) == 0) {
+        return false;
+      }
+      if (size() <= kMaxSortedSize / 2) {
+        elements_ = SortedCopy();
+      } else if (2 * elements.num_erased > elements.values.size()) {
+        elements_ = ToFrontCoded(SortedCopy());
+      }
+      return true;
+    }
+    auto& hashed = *std::get<std::unique_ptr<HashedElements>>(elements_);
+    if (hashed.erase(key) == 0) {
+      return false;
+    }
+    if (hashed.size() <= kMaxSortedSize / 2) {
+      std::vector<const typename HashedElements::value_type*> elements;
+      elements.reserve(hashed.size());
+      for (const auto& element : hashed) {
+        elements.push_back(&element);
+      }
+      std::sort(elements.begin(), elements.end(),
+                [](const auto* a, const auto* b) {
+                  return a->first < b->first;
+                });
+      SortedElements sorted;
+      sorted.entries.reserve(elements.size());
+      for (const auto* element : elements) {
+        SortedInsert(sorted, sorted.entries.end(), element->first,
+                     element->second);
+      }
+      elements_ = std::move(sorted);
+    }
+    return true;
+  }
+
+  // Calls `fn(key, value)` for every element, in no particular order.
+  template <typename Fn>
+  void ForEach(Fn&& fn) const {
+    if (const auto* packed = std::get_if<PackedElements>(&elements_)) {
+      for (size_t offset = 0; offset < packed->size;
+           offset = NextPackedOffset(*packed, offset)) {
+        fn(PackedKey(*packed, offset), PackedValue(*packed, offset));
+      }
+      return;
+    }
+    if (const auto* sorted = std::get_if<SortedElements>(&elements_)) {
+      for (const SortedEntry& entry : sorted->entries) {
+        fn(SortedKey(*sorted, entry), entry.value);
+      }
+      return;
+    }
+    if (const auto* front_coded =
+            std::get_if<std::unique_ptr<FrontCodedElements>>(&elements_)) {
+      const FrontCodedElements& elements = **front_coded;
+      std::string key;
+      const char* record = elements.blocks.data();
+      for (size_t i = 0; i < elements.values.size(); i++) {
+        const uint32_t shared_size = ReadVarint(record);
+        const uint32_t suffix_size = ReadVarint(record);
+        key.resize(shared_size);
+        key.append(record, suffix_size);
+        record += suffix_size;
+        if (!elements.erased[i]) {
+          fn(std::string_view(key), elements.values[i]);
+        }
+      }
+      for (const auto& [overlay_key, value] : elements.overlay) {
+        fn(std::string_view(overlay_key), value);
+      }
+      return;
+    }
+    for (const auto& [key, value] :
+         *std::get<std::unique_ptr<HashedElements>>(elements_)) {
+      fn(std::string_view(key), value);
+    }
+  }
+
+  size_t size() const {
+    if (const auto* packed = std::get_if<PackedElements>(&elements_)) {
+      return PackedSize(*packed);
+    }
+    if (const auto* sorted = std::get_if<SortedElements>(&elements_)) {
+      return sorted->entries.size();
+    }
+    if (const auto* front_coded =
+            std::get_if<std::unique_ptr<FrontCodedElements>>(&elements_)) {
+      return (*front_coded)->values.size() - (*front_coded)->num_erased +
+             (*front_coded)->overlay.size();
+    }
+    return std::get<std::unique_ptr<HashedElements>>(elements_)->size();
+  }
+  bool empty() const { return size() == 0; }
+
+  // Returns the value of one of the elements, if any.
+  std::optional<Mapped> AnyValue() const {
+    if (const auto* packed = std::get_if<PackedElements>(&elements_)) {
+      if (packed->size == 0) {
+        return std::nullopt;
+      }
+      return PackedValue(*packed, 0);
+    }
+    if (const auto* sorted = std::get_if<SortedElements>(&elements_)) {
+      if (sorted->entries.empty()) {
+        return std::nullopt;
+      }
+      return sorted->entries.front().value;
+    }
+    if (const auto* front_coded =
+            std::get_if<std::unique_ptr<FrontCodedElements>>(&elements_)) {
+      const FrontCodedElements& elements = **front_coded;
+      // At most half of the records are erased.
+      for (size_t i = 0; i < elements.values.size(); i++) {
+        if (!elements.erased[i]) {
+          return elements.values[i];
+        }
+      }
+      if (elements.overlay.empty()) {
+        return std::nullopt;
+      }
+      return elements.overlay.begin()->second;
+    }
+    const auto& hashed = *std::get<std::unique_ptr<HashedElements>>(elements_);
+    if (hashed.empty()) {
+      return std::nullopt;
+    }
+    return hashed.begin()->second;
+  }
+
+  // Front codes a map of more than `kMaxSortedSize` elements, merging the
+  // insertions and erasures since it was last compacted.
+  void Compact() {
+    if (size() <= kMaxSortedSize) {
+      return;
+    }
+    if (const auto* front_coded =
+            std::get_if<std::unique_ptr<FrontCodedElements>>(&elements_);
+        front_coded != nullptr && (*front_coded)->overlay.empty() &&
+        (*front_coded)->num_erased == 0) {
+      return;
+    }
+    elements_ = ToFrontCoded(SortedCopy());
+  }
+
+ private:
+  // Records of [uint32_t key size][Mapped][key], sorted by key.
+  struct PackedElements {
+    std::unique_ptr<char[]> data;
+    size_t size = 0;
+  };
+  struct SortedEntry {
+    uint32_t key_offset;
+    uint32_t key_size;
+    Mapped value;
+  };
+  // Entries sorted by key. Keys are appended to `keys` and reclaimed once
+  // more than half of it belongs to erased entries.
+  struct SortedElements {
+    std::vector<SortedEntry> entries;
+    std::string keys;
+    size_t erased_key_bytes = 0;
+  };
+  using HashedElements = absl::flat_hash_map<std::string, Mapped>;
+  struct FrontCodedElements {
+    // Records of [varint shared prefix size][varint suffix size][suffix],
+    // sorted by key. The first record of a block shares no prefix, so that
+    // blocks can be decoded on their own.
+    std::string blocks;
+    std::vector<uint32_t> block_offsets;
+    // Values and erasure marks of the records, in the same order.
+    std::vector<Mapped> values;
+    std::vector<bool> erased;
+    size_t num_erased = 0;
+    // Elements whose keys are not in the blocks.
+    HashedElements overlay;
+  };
+
+  static size_t PackedRecordSize(size_t key_size) {
+    return sizeof(uint32_t) + sizeof(Mapped) + key_size;
+  }
+  static std::string_view PackedKey(const PackedElements& packed,
+                                    size_t offset) {
+    uint32_t key_size;
+    std::memcpy(&key_size, packed.data.get() + offset, sizeof(key_size));
+    return std::string_view(
+        packed.data.get() + offset + sizeof(uint32_t) + sizeof(Mapped),
+        key_size);
+  }
+  static Mapped PackedValue(const PackedElements& packed, size_t offset) {
+    Mapped value;
+    std::memcpy(&value, packed.data.get() + offset + sizeof(uint32_t),
+                sizeof(Mapped));
+    return value;
+  }
+  static size_t NextPackedOffset(const PackedElements& packed, size_t offset) {
+    return offset + PackedRecordSize(PackedKey(packed, offset).size());
+  }
+  static size_t PackedSize(const PackedElements& packed) {
+    size_t size = 0;
+    for (size_t offset = 0; offset < packed.size;
+         offset = NextPackedOffset(packed, offset)) {
+      size++;
+    }
+    return size;
+  }
+  // Returns the offset of the first record whose key is not less than `key`.
+  static size_t PackedLowerBound(const PackedElements& packed,
+                                 std::string_view key) {
+    size_t offset = 0;
+    while (offset < packed.size && PackedKey(packed, offset) < key) {
+      offset = NextPackedOffset(packed, offset);
+    }
+    return offset;
+  }
+  static void PackedInsert(PackedElements& packed, size_t offset,
+                           std::string_view key, const Mapped& value) {
+    const uint32_t key_size = key.size();
+    const size_t record_size = PackedRecordSize(key.size());
+    auto data = std::make_unique<char[]>(packed.size + record_size);
+    char* record = data.get() + offset;
+    std::memcpy(data.get(), packed.data.get(), offset);
+    std::memcpy(record, &key_size, sizeof(key_size));
+    std::memcpy(record + sizeof(uint32_t), &value, sizeof(Mapped));
+    std::memcpy(record + sizeof(uint32_t) + sizeof(Mapped), key.data(),
+                key.size());
+    std::memcpy(record + record_size, packed.data.get() + offset,
+                packed.size - offset);
+    packed.data = std::move(data);
+    packed.size += record_size;
+  }
+  static void PackedErase(PackedElements& packed, size_t offset) {
+    const size_t record_size =
+        PackedRecordSize(PackedKey(packed, offset).size());
+    if (packed.size == record_size) {
+      packed = PackedElements();
+      return;
+    }
+    auto data = std::make_unique<char[]>(packed.size - record_size);
+    std::memcpy(data.get(), packed.data.get(), offset);
+    std::memcpy(data.get() + offset, packed.data.get() + offset + record_size,
+                packed.size - offset - record_size);
+    packed.data = std::move(data);
+    packed.size -= record_size;
+  }
+  static SortedElements ToSorted(const PackedElements& packed) {
+    SortedElements sorted;
+    sorted.entries.reserve(kMaxPackedSize + 1);
+    sorted.keys.reserve(packed.size);
+    for (size_t offset = 0; offset < packed.size;
+         offset = NextPackedOffset(packed, offset)) {
+      SortedInsert(sorted, sorted.entries.end(), PackedKey(packed, offset),
+                   PackedValue(packed, offset));
+    }
+    return sorted;
+  }
+  static std::string_view SortedKey(const SortedElements& sorted,
+                                    const SortedEntry& entry) {
+    return std::string_view(sorted.keys.data() + entry.key_offset,
+                            entry.key_size);
+  }
+  template <typename SortedElementsT>
+  static auto SortedLowerBound(SortedElementsT& sorted, std::string_view key) {
+    return std::lower_bound(sorted.entries.begin(), sorted.entries.end(), key,
+                            [&sorted](const SortedEntry& entry,
+                                      std::string_view key) {
+                              return SortedKey(sorted, entry) < key;
+                            });
+  }
+  static void SortedInsert(SortedElements& sorted,
+                           typename std::vector<SortedEntry>::iterator it,
+                           std::string_view key, const Mapped& value) {
+    const SortedEntry entry{
+        .key_offset = static_cast<uint32_t>(sorted.keys.size()),
+        .key_size = static_cast<uint32_t>(key.size()),
+        .value = value,
+    };
+    sorted.keys.append(key);
+    sorted.entries.insert(it, entry);
+  }
+  static void SortedErase(SortedElements& sorted,
+                          typename std::vector<SortedEntry>::iterator it) {
+    sorted.erased_key_bytes += it->key_size;
+    sorted.entries.erase(it);
+    if (2 * sorted.erased_key_bytes <= sorted.keys.size()) {
+      return;
+    }
+    std::string keys;
+    keys.reserve(sorted.keys.size() - sorted.erased_key_bytes);
+    for (SortedEntry& entry : sorted.entries) {
+      const std::string_view key = SortedKey(sorted, entry);
+      entry.key_offset = keys.size();
+      keys.append(key);
+    }
+    sorted.keys = std::move(keys);
+    sorted.erased_key_bytes = 0;
+  }
+  // Returns all the elements, sorted by key.
+  SortedElements SortedCopy() const {
+    SortedElements sorted;
+    sorted.entries.reserve(size());
+    ForEach([&sorted](std::string_view key, const Mapped& value) {
+      SortedInsert(sorted, sorted.entries.end(), key, value);
+    });
+    std::sort(sorted.entries.begin(), sorted.entries.end(),
+              [&sorted](const SortedEntry& a, const SortedEntry& b) {
+                return SortedKey(sorted, a) < SortedKey(sorted, b);
+              });
+    return sorted;
+  }
+  static void AppendVarint(std::string& out, uint32_t value) {
+    while (value >= 0x80) {
+      out.push_back(static_cast<char>(value | 0x80));
+      value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+  }
+  // Reads a varint at `data` and moves `data` past it.
+  static uint32_t ReadVarint(const char*& data) {
+    uint32_t value = 0;
+    for (int shift = 0;; shift += 7) {
+      const auto byte = static_cast<uint8_t>(*data++);
+      value |= static_cast<uint32_t>(byte & 0x7f) << shift;
+      if (byte < 0x80) {
+        return value;
+      }
+    }
+  }
+  static std::unique_ptr<FrontCodedElements> ToFrontCoded(
+      const SortedElements& sorted) {
+    auto elements = std::make_unique<FrontCodedElements>();
+    const size_t size = sorted.entries.size();
+    elements->block_offsets.reserve(
+        (size + kFrontCodedBlockSize - 1) / kFrontCodedBlockSize);
+    elements->values.reserve(size);
+    elements->erased.assign(size, false);
+    std::string_view previous_key;
+    for (size_t i = 0; i < size; i++) {
+      const std::string_view key = SortedKey(sorted, sorted.entries[i]);
+      size_t shared_size = 0;
+      if (i % kFrontCodedBlockSize == 0) {
+        elements->block_offsets.push_back(elements->blocks.size());
+      } else {
+        const size_t max_shared_size =
+            std::min(key.size(), previous_key.size());
+        while (shared_size < max_shared_size &&
+               key[shared_size] == previous_key[shared_size]) {
+          shared_size++;
+        }
+      }
+      AppendVarint(elements->blocks, shared_size);
+      AppendVarint(elements->blocks, key.size() - shared_size);
+      elements->blocks.append(key.substr(shared_size));
+      elements->values.push_back(sorted.entries[i].value);
+      previous_key = key;
+    }
+    elements->blocks.shrink_to_fit();
+    return elements;
+  }
+  static std::string_view FrontCodedFirstKey(const FrontCodedElements& elements,
+                                             uint32_t block_offset) {
+    const char* record = elements.blocks.data() + block_offset;
+    ReadVarint(record);
+    const uint32_t key_size = ReadVarint(record);
+    return std::string_view(record, key_size);
+  }
+  // Returns the index of the record of `key`, if any.
+  static std::optional<size_t> FrontCodedIndex(
+      const FrontCodedElements& elements, std::string_view key) {
+    // Finds the last block whose first key is not greater than `key`.
+    auto block = std::upper_bound(
+        elements.block_offsets.begin(), elements.block_offsets.end(), key,
+        [&elements](std::string_view key, uint32_t block_offset) {
+          return key < FrontCodedFirstKey(elements, block_offset);
+        });
+    if (block == elements.block_offsets.begin()) {
+      return std::nullopt;
+    }
+    --block;
+    size_t index = (block - elements.block_offsets.begin()) *
+                   kFrontCodedBlockSize;
+    const size_t end =
+        std::min(index + kFrontCodedBlockSize, elements.values.size());
+    const char* record = elements.blocks.data() + *block;
+    // Compares the keys of the block with `key` without decoding them: all
+    // of them are less than `key` so far, and the last one shares its first
+    // `matched_size` bytes with it.
+    size_t matched_size = 0;
+    for (; index < end; index++) {
+      const uint32_t shared_size = ReadVarint(record);
+      const uint32_t suffix_size = ReadVarint(record);
+      const std::string_view suffix(record, suffix_size);
+      record += suffix_size;
+      if (shared_size > matched_size) {
+        // Differs from `key` where the previous key did.
+        continue;
+      }
+      if (shared_size < matched_size) {
+        // Greater than the previous key where it still matched `key`.
+        return std::nullopt;
+      }
+      const std::string_view rest = key.substr(matched_size);
+      const int order = suffix.compare(rest);
+      if (order == 0) {
+        return index;
+      }
+      if (order > 0) {
+        return std::nullopt;
+      }
+      size_t common_size = 0;
+      while (common_size < suffix.size() &&
+             suffix[common_size] == rest[common_size]) {
+        common_size++;
+      }
+      matched_size += common_size;
+    }
+    return std::nullopt;
+  }
+
+  // Large maps are boxed to keep small maps small.
+  std::variant<PackedElements, SortedElements, std::unique_ptr<HashedElements>,
+               std::unique_ptr<FrontCodedElements>>
+      elements_;
+};
+
+}  // namespace kv_server
+
+#endif  // COMPONENTS_DATA_SERVER_CACHE_COMPACT_STRING_MAP_H_
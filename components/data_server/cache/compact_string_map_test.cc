@@ -0,0 +1,191 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/data_server/cache/compact_string_map.h"
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace kv_server {
+namespace {
+
+using testing::Pair;
+using testing::UnorderedElementsAre;
+using testing::UnorderedElementsAreArray;
+
+using Elements = std::vector<std::pair<std::string, int64_t>>;
+
+Elements ReadElements(const CompactStringMap<int64_t>& map) {
+  Elements elements;
+  map.ForEach([&elements](std::string_view key, int64_t value) {
+    elements.emplace_back(key, value);
+  });
+  return elements;
+}
+
+TEST(CompactStringMapTest, EmptyMap) {
+  CompactStringMap<int64_t> map;
+  EXPECT_TRUE(map.empty());
+  EXPECT_EQ(map.size(), 0);
+  EXPECT_EQ(map.find("key"), std::nullopt);
+  EXPECT_FALSE(map.erase("key"));
+  EXPECT_EQ(map.AnyValue(), std::nullopt);
+}
+
+TEST(CompactStringMapTest, InsertFindAndErase) {
+  CompactStringMap<int64_t> map;
+  map.insert_or_assign("b", 2);
+  map.insert_or_assign("a", 1);
+  map.insert_or_assign("", 0);
+  map.insert_or_assign("c", 3);
+  map.insert_or_assign("a", 11);
+  EXPECT_EQ(map.size(), 4);
+  EXPECT_EQ(map.find("a"), 11);
+  EXPECT_EQ(map.find(""), 0);
+  EXPECT_EQ(map.find("d"), std::nullopt);
+  EXPECT_TRUE(map.erase("b"));
+  EXPECT_FALSE(map.erase("b"));
+  EXPECT_THAT(ReadElements(map),
+              UnorderedElementsAre(Pair("", 0), Pair("a", 11), Pair("c", 3)));
+}
+
+TEST(CompactStringMapTest, StoresLongKeys) {
+  CompactStringMap<int64_t> map;
+  const std::string long_key(1000, 'k');
+  map.insert_or_assign(long_key, 1);
+  map.insert_or_assign("short", 2);
+  EXPECT_EQ(map.find(long_key), 1);
+  EXPECT_THAT(ReadElements(map),
+              UnorderedElementsAre(Pair(long_key, 1), Pair("short", 2)));
+}
+
+class CompactStringMapSizeTest : public testing::TestWithParam<int> {};
+
+TEST_P(CompactStringMapSizeTest, GrowsAndShrinksBack) {
+  CompactStringMap<int64_t> map;
+  Elements expected;
+  const int num_elements = GetParam();
+  for (int i = 0; i < num_elements; i++) {
+    map.insert_or_assign(absl::StrCat("key", i), i);
+    expected.emplace_back(absl::StrCat("key", i), i);
+  }
+  EXPECT_EQ(map.size(), num_elements);
+  EXPECT_THAT(ReadElements(map), UnorderedElementsAreArray(expected));
+  for (int i = 0; i < num_elements; i++) {
+    EXPECT_EQ(map.find(absl::StrCat("key", i)), i);
+  }
+  ASSERT_TRUE(map.AnyValue().has_value());
+  EXPECT_EQ(map.find(absl::StrCat("key", *map.AnyValue())), *map.AnyValue());
+  // Erases all but the last element, crossing back into the smaller
+  // representations.
+  for (int i = 0; i < num_elements - 1; i++) {
+    EXPECT_TRUE(map.erase(absl::StrCat("key", i)));
+    EXPECT_EQ(map.find(absl::StrCat("key", i)), std::nullopt);
+  }
+  EXPECT_THAT(ReadElements(map), UnorderedElementsAre(expected.back()));
+  map.insert_or_assign("new", -1);
+  EXPECT_EQ(map.size(), 2);
+  EXPECT_EQ(map.find("new"), -1);
+}
+
+TEST_P(CompactStringMapSizeTest, CompactKeepsElements) {
+  CompactStringMap<int64_t> map;
+  Elements expected;
+  const int num_elements = GetParam();
+  for (int i = 0; i < num_elements; i++) {
+    map.insert_or_assign(absl::StrCat("https://example.com/ads/", i), i);
+    expected.emplace_back(absl::StrCat("https://example.com/ads/", i), i);
+  }
+  map.Compact();
+  EXPECT_EQ(map.size(), num_elements);
+  EXPECT_THAT(ReadElements(map), UnorderedElementsAreArray(expected));
+  for (int i = 0; i < num_elements; i++) {
+    EXPECT_EQ(map.find(absl::StrCat("https://example.com/ads/", i)), i);
+  }
+  for (std::string_view missing_key :
+       {"", "https://example.com/", "https://example.com/ads/",
+        "https://example.com/ads/00", "https://example.com/ads/1a",
+        "https://example.com/ads/99999", "zzz"}) {
+    EXPECT_EQ(map.find(missing_key), std::nullopt) << missing_key;
+  }
+}
+
+TEST(CompactStringMapTest, CompactedMapTakesInsertionsAndErasures) {
+  CompactStringMap<int64_t> map;
+  const int num_elements = 4 * CompactStringMap<int64_t>::kMaxSortedSize;
+  for (int i = 0; i < num_elements; i += 2) {
+    map.insert_or_assign(absl::StrCat("key", i), i);
+  }
+  map.Compact();
+  // Odd keys are not in the blocks.
+  for (int i = 1; i < num_elements; i += 2) {
+    map.insert_or_assign(absl::StrCat("key", i), i);
+  }
+  map.insert_or_assign("key0", -1);
+  EXPECT_TRUE(map.erase("key2"));
+  EXPECT_FALSE(map.erase("key2"));
+  EXPECT_TRUE(map.erase("key3"));
+  EXPECT_EQ(map.find("key2"), std::nullopt);
+  EXPECT_EQ(map.find("key3"), std::nullopt);
+  EXPECT_NE(map.AnyValue(), 2);
+  map.insert_or_assign("key2", -2);
+  EXPECT_EQ(map.size(), num_elements - 1);
+  Elements expected = {{"key0", -1}, {"key2", -2}, {"key1", 1}};
+  for (int i = 4; i < num_elements; i++) {
+    expected.emplace_back(absl::StrCat("key", i), i);
+  }
+  EXPECT_THAT(ReadElements(map), UnorderedElementsAreArray(expected));
+  map.Compact();
+  EXPECT_EQ(map.size(), num_elements - 1);
+  EXPECT_THAT(ReadElements(map), UnorderedElementsAreArray(expected));
+  EXPECT_EQ(map.find("key1"), 1);
+  EXPECT_EQ(map.find("key3"), std::nullopt);
+}
+
+TEST(CompactStringMapTest, CompactedMapShrinksBack) {
+  CompactStringMap<int64_t> map;
+  const int num_elements = 4 * CompactStringMap<int64_t>::kMaxSortedSize;
+  for (int i = 0; i < num_elements; i++) {
+    map.insert_or_assign(absl::StrCat("key", i), i);
+  }
+  map.Compact();
+  for (int i = 0; i < num_elements - 1; i++) {
+    EXPECT_TRUE(map.erase(absl::StrCat("key", i)));
+    EXPECT_EQ(map.find(absl::StrCat("key", i)), std::nullopt);
+    EXPECT_EQ(map.find(absl::StrCat("key", i + 1)), i + 1);
+  }
+  const std::string last_key = absl::StrCat("key", num_elements - 1);
+  EXPECT_THAT(ReadElements(map),
+              UnorderedElementsAre(Pair(last_key, num_elements - 1)));
+  map.insert_or_assign("new", -1);
+  EXPECT_EQ(map.size(), 2);
+  EXPECT_EQ(map.find("new"), -1);
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    Sizes, CompactStringMapSizeTest,
+    testing::Values(1, CompactStringMap<int64_t>::kMaxPackedSize,
+                    CompactStringMap<int64_t>::kMaxPackedSize + 1,
+                    CompactStringMap<int64_t>::kMaxSortedSize,
+                    4 * CompactStringMap<int64_t>::kMaxSortedSize));
+
+}  // namespace
+}  // namespace kv_server
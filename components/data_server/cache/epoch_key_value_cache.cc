@@ -0,0 +1,459 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include "components/data_server/cache/epoch_key_value_cache.h"
+
+#include <atomic>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "absl/hash/hash.h"
+#include "absl/log/log.h"
+#include "absl/memory/memory.h"
+#include "absl/synchronization/mutex.h"
+#include "components/data_server/cache/cache.h"
+#include "components/data_server/cache/get_key_value_result.h"
+#include "components/data_server/cache/get_key_value_set_result.h"
+#include "components/data_server/cache/precomputed_json_value.h"
+
+namespace kv_server {
+namespace {
+
+constexpr size_t kInitialNumBuckets = 1024;
+
+// Spreads reader threads over the reader slots round-robin.
+size_t ThreadReaderSlot() {
+  static std::atomic<size_t> next_slot{0};
+  thread_local const size_t slot =
+      next_slot.fetch_add(1, std::memory_order_relaxed);
+  return slot;
+}
+
+}  // namespace
+
+EpochKeyValueCache::Table::Table(size_t num_buckets)
+    : num_buckets(num_buckets),
+      buckets(std::make_unique<std::atomic<Node*>[]>(num_buckets)) {}
+
+std::atomic<EpochKeyValueCache::Node*>& EpochKeyValueCache::Table::Bucket(
+    std::string_view key) const {
+  return buckets[absl::Hash<std::string_view>{}(key) % num_buckets];
+}
+
+EpochKeyValueCache::ReadGuard::ReadGuard(const EpochKeyValueCache& cache)
+    : slot_(cache.reader_slots_[ThreadReaderSlot() % kNumReaderSlots]) {
+  // Announce the reader in the counter of the epoch it observed. If a writer
+  // advanced the epoch in between, the writer may already have finished
+  // waiting on that counter, so retry with the new epoch.
+  while (true) {
+    epoch_ = cache.epoch_.load();
+    slot_.active[epoch_ & 1].fetch_add(1);
+    if (cache.epoch_.load() == epoch_) {
+      break;
+    }
+    slot_.active[epoch_ & 1].fetch_sub(1);
+  }
+}
+
+EpochKeyValueCache::ReadGuard::~ReadGuard() {
+  slot_.active[epoch_ & 1].fetch_sub(1, std::memory_order_release);
+}
+
+EpochKeyValueCache::EpochKeyValueCache(
+    std::shared_ptr<ValueInterner> value_interner, bool precompute_json_values)
+    : table_(new Table(kInitialNumBuckets)),
+      precompute_json_values_(precompute_json_values),
+      set_cache_(std::move(value_interner)) {}
+
+EpochKeyValueCache::~EpochKeyValueCache() {
+  // No reader can be active while the cache is destroyed.
+  std::unique_ptr<Table> table(table_.load());
+  for (size_t i = 0; i < table->num_buckets; i++) {
+    Node* node = table->buckets[i].load();
+    while (node != nullptr) {
+      Node* next = node->next.load();
+      delete node;
+      node = next;
+    }
+  }
+  for (Node* node : retired_nodes_) {
+    delete node;
+  }
+}
+
+absl::flat_hash_map<std::string, std::string>
+EpochKeyValueCache::GetKeyValuePairs(
+    const RequestContext& request_context,
+    const absl::flat_hash_set<std::string_view>& key_set) const {
+  ScopeLatencyMetricsRecorder<InternalLookupMetricsContext,
+                              kGetValuePairsLatencyInMicros>
+      latency_recorder(request_context.GetInternalLookupMetricsContext());
+  absl::flat_hash_map<std::string, std::string> kv_pairs;
+  {
+    ReadGuard guard(*this);
+    const Table* table = table_.load(std::memory_order_acquire);
+    for (std::string_view key : key_set) {
+      if (const Node* node = FindNode(*table, key);
+          node != nullptr && node->value != nullptr) {
+        const std::string_view value =
+            precompute_json_values_
+                ? SplitPrecomputedJsonValue(*node->value).value
+                : std::string_view(*node->value);
+        VLOG(9) << "Get called for " << key << ". returning value: " << value;
+        kv_pairs.insert_or_assign(key, value);
+      }
+    }
+  }
+  if (kv_pairs.empty()) {
+    LogCacheAccessMetrics(request_context, kKeyValueCacheMiss);
+  } else {
+    LogCacheAccessMetrics(request_context, kKeyValueCacheHit);
+  }
+  return kv_pairs;
+}
+
+std::unique_ptr<GetKeyValueResult> EpochKeyValueCache::GetKeyValues(
+    const RequestContext& request_context,
+    const absl::flat_hash_set<std::string_view>& key_set) const {
+  ScopeLatencyMetricsRecorder<InternalLookupMetricsContext,
+                              kGetValuePairsLatencyInMicros>
+      latency_recorder(request_context.GetInternalLookupMetricsContext());
+  auto result = GetKeyValueResult::Create();
+  {
+    ReadGuard guard(*this);
+    const Table* table = table_.load(std::memory_order_acquire);
+    for (std::string_view key : key_set) {
+      if (const Node* node = FindNode(*table, key);
+          node != nullptr && node->value != nullptr) {
+        // Taking a reference keeps the value alive after the node is freed.
+        if (!precompute_json_values_) {
+          result->AddKeyValue(key, *node->value, node->value,
+                              /*serialized_json=*/std::nullopt);
+          continue;
+        }
+        const PrecomputedJsonValue value =
+            SplitPrecomputedJsonValue(*node->value);
+        result->AddKeyValue(key, value.value, node->value,
+                            value.serialized_json);
+      }
+    }
+  }
+  if (result->size() == 0) {
+    LogCacheAccessMetrics(request_context, kKeyValueCacheMiss);
+  } else {
+    LogCacheAccessMetrics(request_context, kKeyValueCacheHit);
+  }
+  return result;
+}
+
+std::unique_ptr<GetKeyValueSetResult> EpochKeyValueCache::GetKeyValueSet(
+    const RequestContext& request_context,
+    const absl::flat_hash_set<std::string_view>& key_set) const {
+  return set_cache_.GetKeyValueSet(request_context, key_set);
+}
+
+void EpochKeyValueCache::UpdateKeyValue(std::string_view key,
+                                        std::string_view value,
+                                        int64_t logical_commit_time,
+                                        std::string_view prefix) {
+  ScopeLatencyMetricsRecorder<ServerSafeMetricsContext, kUpdateKeyValueLatency>
+      latency_recorder(KVServerContextMap()->SafeMetric());
+  VLOG(9) << "Received update for [" << key << "] at " << logical_commit_time
+          << ". value will be set to: " << value;
+  // Parsed before taking the lock, so that other writers do not wait for it.
+  auto stored_value = std::make_shared<const std::string>(
+      precompute_json_values_ ? PrecomputeJsonValue(value)
+                              : std::string(value));
+  absl::MutexLock lock(&writer_mutex_);
+  auto max_cleanup_logical_commit_time =
+      max_cleanup_logical_commit_time_map_[prefix];
+  if (logical_commit_time <= max_cleanup_logical_commit_time) {
+    VLOG(1) << "Skipping the update as its logical_commit_time: "
+            << logical_commit_time
+            << " is not newer than the current cutoff time:"
+            << max_cleanup_logical_commit_time;
+    return;
+  }
+  const Node* existing = FindNode(*table_.load(), key);
+  if (existing != nullptr &&
+      existing->last_logical_commit_time >= logical_commit_time) {
+    VLOG(1) << "Skipping the update as its logical_commit_time: "
+            << logical_commit_time
+            << " is not newer than the current value's time:"
+            << existing->last_logical_commit_time;
+    return;
+  }
+  if (existing != nullptr && existing->value == nullptr) {
+    if (auto prefix_deleted_nodes_iter = deleted_nodes_map_.find(prefix);
+        prefix_deleted_nodes_iter != deleted_nodes_map_.end()) {
+      auto dl_key_iter = prefix_deleted_nodes_iter->second.find(
+          existing->last_logical_commit_time);
+      if (dl_key_iter != prefix_deleted_nodes_iter->second.end() &&
+          dl_key_iter->second == key) {
+        prefix_deleted_nodes_iter->second.erase(dl_key_iter);
+      }
+    }
+  }
+  auto node = std::make_unique<Node>();
+  node->key = std::string(key);
+  node->value = std::move(stored_value);
+  node->last_logical_commit_time = logical_commit_time;
+  node->prefix_id = prefix_counters_.IdOf(prefix);
+  PublishNode(std::move(node));
+}
+
+void EpochKeyValueCache::UpdateKeyValueSet(
+    std::string_view key, absl::Span<std::string_view> input_value_set,
+    int64_t logical_commit_time, std::string_view prefix) {
+  set_cache_.UpdateKeyValueSet(key, input_value_set, logical_commit_time,
+                               prefix);
+}
+
+void EpochKeyValueCache::DeleteKey(std::string_view key,
+                                   int64_t logical_commit_time,
+                                   std::string_view prefix) {
+  ScopeLatencyMetricsRecorder<ServerSafeMetricsContext, kDeleteKeyLatency>
+      latency_recorder(KVServerContextMap()->SafeMetric());
+  absl::MutexLock lock(&writer_mutex_);
+  auto max_cleanup_logical_commit_time =
+      max_cleanup_logical_commit_time_map_[prefix];
+  if (logical_commit_time <= max_cleanup_logical_commit_time) {
+    return;
+  }
+  const Node* existing = FindNode(*table_.load(), key);
+  if (existing == nullptr ||
+      existing->last_logical_commit_time < logical_commit_time) {
+    // If key is missing, we still need to add a null value to the map to
+    // avoid the late coming update with smaller logical commit time
+    // inserting value to the map for the given key
+    auto node = std::make_unique<Node>();
+    node->key = std::string(key);
+    node->last_logical_commit_time = logical_commit_time;
+    node->prefix_id = prefix_counters_.IdOf(prefix);
+    PublishNode(std::move(node));
+    deleted_nodes_map_[prefix].emplace(logical_commit_time, key);
+  }
+}
+
+void EpochKeyValueCache::DeleteValuesInSet(
+    std::string_view key, absl::Span<std::string_view> value_set,
+    int64_t logical_commit_time, std::string_view prefix) {
+  set_cache_.DeleteValuesInSet(key, value_set, logical_commit_time, prefix);
+}
+
+void EpochKeyValueCache::RemoveDeletedKeys(int64_t logical_commit_time,
+                                           std::string_view prefix) {
+  ScopeLatencyMetricsRecorder<ServerSafeMetricsContext,
+                              kRemoveDeletedKeyLatency>
+      latency_recorder(KVServerContextMap()->SafeMetric());
+  CleanUpKeyValueMap(logical_commit_time, prefix);
+  set_cache_.CleanUpKeyValueSetMap(logical_commit_time, prefix);
+}
+
+void EpochKeyValueCache::CleanUpKeyValueMap(int64_t logical_commit_time,
+                                            std::string_view prefix) {
+  ScopeLatencyMetricsRecorder<ServerSafeMetricsContext,
+                              kCleanUpKeyValueMapLatency>
+      latency_recorder(KVServerContextMap()->SafeMetric());
+  absl::MutexLock lock(&writer_mutex_);
+  if (max_cleanup_logical_commit_time_map_[prefix] < logical_commit_time) {
+    max_cleanup_logical_commit_time_map_[prefix] = logical_commit_time;
+  }
+  if (auto deleted_nodes_per_prefix = deleted_nodes_map_.find(prefix);
+      deleted_nodes_per_prefix != deleted_nodes_map_.end()) {
+    auto it = deleted_nodes_per_prefix->second.begin();
+    while (it != deleted_nodes_per_prefix->second.end()) {
+      if (it->first > logical_commit_time) {
+        break;
+      }
+      // should always have this, but checking just in case
+      const Node* node = FindNode(*table_.load(), it->second);
+      if (node != nullptr && node->value == nullptr &&
+          node->last_logical_commit_time <= logical_commit_time) {
+        UnlinkNode(it->second);
+      }
+      ++it;
+    }
+    deleted_nodes_per_prefix->second.erase(
+        deleted_nodes_per_prefix->second.begin(), it);
+    if (deleted_nodes_per_prefix->second.empty()) {
+      deleted_nodes_map_.erase(prefix);
+    }
+  }
+  Reclaim();
+}
+
+EpochKeyValueCache::Node* EpochKeyValueCache::FindNode(const Table& table,
+                                                      std::string_view key) {
+  for (Node* node = table.Bucket(key).load(std::memory_order_acquire);
+       node != nullptr; node = node->next.load(std::memory_order_acquire)) {
+    if (node->key == key) {
+      return node;
+    }
+  }
+  return nullptr;
+}
+
+void EpochKeyValueCache::PublishNode(std::unique_ptr<Node> node) {
+  CountNode(*node, 1);
+  std::atomic<Node*>* link = &table_.load()->Bucket(node->key);
+  for (Node* current = link->load(); current != nullptr;
+       current = link->load()) {
+    if (current->key == node->key) {
+      // Readers either see the old or the new node, both are consistent.
+      node->next.store(current->next.load());
+      link->store(node.release(), std::memory_order_release);
+      CountNode(*current, -1);
+      Retire(current);
+      return;
+    }
+    link = &current->next;
+  }
+  // New key, becomes the head of its chain.
+  std::atomic<Node*>& head = table_.load()->Bucket(node->key);
+  node->next.store(head.load());
+  head.store(node.release(), std::memory_order_release);
+  num_nodes_++;
+  MaybeGrow();
+}
+
+void EpochKeyValueCache::UnlinkNode(std::string_view key) {
+  std::atomic<Node*>* link = &table_.load()->Bucket(key);
+  for (Node* current = link->load(); current != nullptr;
+       current = link->load()) {
+    if (current->key == key) {
+      // Concurrent readers positioned on `current` still reach the rest of
+      // the chain through its unchanged `next`.
+      link->store(current->next.load(), std::memory_order_release);
+      num_nodes_--;
+      CountNode(*current, -1);
+      Retire(current);
+      return;
+    }
+    link = &current->next;
+  }
+}
+
+void EpochKeyValueCache::MaybeGrow() {
+  Table* old_table = table_.load();
+  if (num_nodes_ <= old_table->num_buckets) {
+    return;
+  }
+  auto new_table = std::make_unique<Table>(old_table->num_buckets * 2);
+  for (size_t i = 0; i < old_table->num_buckets; i++) {
+    for (Node* node = old_table->buckets[i].load(); node != nullptr;
+         node = node->next.load()) {
+      auto copy = std::make_unique<Node>();
+      copy->key = node->key;
+      copy->value = node->value;
+      copy->last_logical_commit_time = node->last_logical_commit_time;
+      copy->prefix_id = node->prefix_id;
+      std::atomic<Node*>& head = new_table->Bucket(copy->key);
+      copy->next.store(head.load());
+      head.store(copy.release());
+      retired_nodes_.push_back(node);
+    }
+  }
+  table_.store(new_table.release(), std::memory_order_release);
+  retired_tables_.emplace_back(old_table);
+  Reclaim();
+}
+
+void EpochKeyValueCache::Retire(Node* node) {
+  retired_nodes_.push_back(node);
+  if (retired_nodes_.size() >= kMaxRetiredNodes) {
+    Reclaim();
+  }
+}
+
+void EpochKeyValueCache::CountNode(const Node& node, int64_t sign) {
+  if (node.value == nullptr) {
+    prefix_counters_.AddTombstones(node.prefix_id, sign);
+    return;
+  }
+  prefix_counters_.AddKeys(
+      node.prefix_id, sign,
+      sign * static_cast<int64_t>(node.key.size() + node.value->size()));
+}
+
+void EpochKeyValueCache::Reclaim() {
+  if (retired_nodes_.empty() && retired_tables_.empty()) {
+    return;
+  }
+  WaitForReaders();
+  for (Node* node : retired_nodes_) {
+    delete node;
+  }
+  retired_nodes_.clear();
+  retired_tables_.clear();
+}
+
+void EpochKeyValueCache::WaitForReaders() {
+  // Everything retired so far was unlinked before the epoch is advanced, so
+  // readers that announce themselves in the new epoch cannot reach it. Readers
+  // of the epoch before the previous one were drained by the previous call.
+  const uint64_t epoch = epoch_.fetch_add(1);
+  for (const ReaderSlot& slot : reader_slots_) {
+    while (slot.active[epoch & 1].load(std::memory_order_acquire) != 0) {
+      std::this_thread::yield();
+    }
+  }
+}
+
+void EpochKeyValueCache::LogCacheAccessMetrics(
+    const RequestContext& request_context,
+    std::string_view cache_access_event) const {
+  request_context.GetMetricsBatch().cache_access_events.Add(
+      cache_access_event);
+}
+
+absl::Status EpochKeyValueCache::ForEachKey(
+    absl::FunctionRef<void(std::string_view key)> callback) const {
+  {
+    ReadGuard guard(*this);
+    const Table* table = table_.load(std::memory_order_acquire);
+    for (size_t i = 0; i < table->num_buckets; i++) {
+      for (const Node* node = table->buckets[i].load(std::memory_order_acquire);
+           node != nullptr; node = node->next.load(std::memory_order_acquire)) {
+        if (node->value != nullptr) {
+          callback(node->key);
+        }
+      }
+    }
+  }
+  return set_cache_.ForEachKey(callback);
+}
+
+absl::flat_hash_map<std::string, PrefixStats>
+EpochKeyValueCache::GetPrefixStats() const {
+  absl::flat_hash_map<std::string, PrefixStats> stats =
+      prefix_counters_.Get();
+  for (const auto& [prefix, set_stats] : set_cache_.GetPrefixStats()) {
+    stats[prefix] += set_stats;
+  }
+  return stats;
+}
+
+std::unique_ptr<Cache> EpochKeyValueCache::Create(
+    bool intern_set_values, bool precompute_json_values) {
+  return absl::WrapUnique(new EpochKeyValueCache(
+      intern_set_values ? std::make_shared<ValueInterner>() : nullptr,
+      precompute_json_values));
+}
+
+}  // namespace kv_server
@@ -0,0 +1,222 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef COMPONENTS_DATA_SERVER_CACHE_EPOCH_KEY_VALUE_CACHE_H_
+#define COMPONENTS_DATA_SERVER_CACHE_EPOCH_KEY_VALUE_CACHE_H_
+
+#include <array>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/synchronization/mutex.h"
+#include "components/data_server/cache/cache.h"
+#include "components/data_server/cache/get_key_value_result.h"
+#include "components/data_server/cache/get_key_value_set_result.h"
+#include "components/data_server/cache/key_value_cache.h"
+#include "components/data_server/cache/prefix_counters.h"
+#include "components/data_server/cache/value_interner.h"
+
+namespace kv_server {
+
+// In-memory datastore whose key-value lookups never take a lock.
+//
+// Key-value pairs live in immutable nodes chained off an array of atomic
+// bucket heads. Readers pin the current epoch, walk the chains and copy the
+// values out or take references to them. Writers are serialized by a mutex,
+// publish new nodes with atomic stores and retire the nodes they replace.
+// Retired nodes are only freed once
+// every reader that pinned an epoch in which they were still reachable has
+// left, so a reader is never blocked by, and never observes a torn, update.
+//
+// Key-value sets keep using the lock based implementation of `KeyValueCache`.
+// One cache object is only for keys in one namespace.
+class EpochKeyValueCache : public Cache {
+ public:
+  ~EpochKeyValueCache();
+
+  // Looks up and returns key-value pairs for the given keys.
+  absl::flat_hash_map<std::string, std::string> GetKeyValuePairs(
+      const RequestContext& request_context,
+      const absl::flat_hash_set<std::string_view>& key_set) const override;
+
+  // Looks up the given keys and returns views of their values.
+  std::unique_ptr<GetKeyValueResult> GetKeyValues(
+      const RequestContext& request_context,
+      const absl::flat_hash_set<std::string_view>& key_set) const override;
+
+  // Looks up and returns key-value set result for the given key set.
+  std::unique_ptr<GetKeyValueSetResult> GetKeyValueSet(
+      const RequestContext& request_context,
+      const absl::flat_hash_set<std::string_view>& key_set) const override;
+
+  // Inserts or updates the key with the new value for a given prefix
+  void UpdateKeyValue(std::string_view key, std::string_view value,
+                      int64_t logical_commit_time,
+                      std::string_view prefix = "") override;
+
+  // Inserts or updates values in the set for a given key and prefix, if a value
+  // exists, updates its timestamp to the latest logical commit time.
+  void UpdateKeyValueSet(std::string_view key,
+                         absl::Span<std::string_view> input_value_set,
+                         int64_t logical_commit_time,
+                         std::string_view prefix = "") override;
+
+  // Deletes a particular (key, value) pair for a given prefix.
+  void DeleteKey(std::string_view key, int64_t logical_commit_time,
+                 std::string_view prefix = "") override;
+
+  // Deletes values in the set for a given key and prefix. The deletion, this
+  // object still exist and is marked "deleted", in case there are late-arriving
+  // updates to this value.
+  void DeleteValuesInSet(std::string_view key,
+                         absl::Span<std::string_view> value_set,
+                         int64_t logical_commit_time,
+                         std::string_view prefix = "") override;
+
+  // Removes the values that were deleted before the specified
+  // logical_commit_time for a given prefix and frees retired nodes that are
+  // no longer visible to any reader.
+  void RemoveDeletedKeys(int64_t logical_commit_time,
+                         std::string_view prefix = "") override;
+
+  // Walks the key-value chains with the epoch pinned, which delays the
+  // reclamation of retired nodes until the walk is done, and then visits the
+  // keys of the key-value sets.
+  absl::Status ForEachKey(
+      absl::FunctionRef<void(std::string_view key)> callback) const override;
+
+  // Adds the counters of the key-value sets to those of the key-value pairs.
+  absl::flat_hash_map<std::string, PrefixStats> GetPrefixStats()
+      const override;
+
+  // If `intern_set_values` is true, set values are interned, and if
+  // `precompute_json_values` is true, values are parsed as JSON once when they
+  // are loaded, see `KeyValueCache`.
+  static std::unique_ptr<Cache> Create(bool intern_set_values = false,
+                                       bool precompute_json_values = false);
+
+ private:
+  // Immutable once published, except for `next`, which writers swing to
+  // unlink or replace the following node.
+  struct Node {
+    std::string key;
+    // Null for deleted keys, which are kept until cleanup to reject late
+    // arriving updates with older logical commit times. Shared with lookup
+    // results, which may outlive the node. Laid out as described in
+    // precomputed_json_value.h if `precompute_json_values_`.
+    std::shared_ptr<const std::string> value;
+    int64_t last_logical_commit_time;
+    // Prefix of the last update or deletion of the key.
+    PrefixCounters::Id prefix_id = 0;
+    std::atomic<Node*> next{nullptr};
+  };
+  struct Table {
+    explicit Table(size_t num_buckets);
+    std::atomic<Node*>& Bucket(std::string_view key) const;
+    const size_t num_buckets;
+    const std::unique_ptr<std::atomic<Node*>[]> buckets;
+  };
+  // Per-thread-group reader counters, indexed by epoch parity. Padded to a
+  // cache line so that readers on different threads do not contend.
+  struct alignas(64) ReaderSlot {
+    std::atomic<int64_t> active[2] = {0, 0};
+  };
+  static constexpr size_t kNumReaderSlots = 64;
+  // Number of retired nodes after which writers reclaim memory without
+  // waiting for the next RemoveDeletedKeys call.
+  static constexpr size_t kMaxRetiredNodes = 4096;
+
+  // RAII pin of the current epoch for the duration of a read.
+  class ReadGuard {
+   public:
+    explicit ReadGuard(const EpochKeyValueCache& cache);
+    ~ReadGuard();
+    ReadGuard(const ReadGuard&) = delete;
+    ReadGuard& operator=(const ReadGuard&) = delete;
+
+   private:
+    ReaderSlot& slot_;
+    uint64_t epoch_;
+  };
+
+  EpochKeyValueCache(std::shared_ptr<ValueInterner> value_interner,
+                     bool precompute_json_values);
+
+  // Returns the node for `key` in `table` or nullptr. Readers must hold a
+  // ReadGuard, writers the writer mutex.
+  static Node* FindNode(const Table& table, std::string_view key);
+  // Publishes `node`, replacing the existing node for the same key, if any.
+  void PublishNode(std::unique_ptr<Node> node)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(writer_mutex_);
+  // Unlinks and retires the node for `key`, if any.
+  void UnlinkNode(std::string_view key)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(writer_mutex_);
+  // Doubles the number of buckets once the load factor exceeds one. The nodes
+  // are copied into the new table since readers may still be walking the old
+  // chains, the values themselves are shared.
+  void MaybeGrow() ABSL_EXCLUSIVE_LOCKS_REQUIRED(writer_mutex_);
+  void Retire(Node* node) ABSL_EXCLUSIVE_LOCKS_REQUIRED(writer_mutex_);
+  // Adds `sign` times `node` to `prefix_counters_`.
+  void CountNode(const Node& node, int64_t sign);
+  // Waits until no reader can observe retired objects and frees them.
+  void Reclaim() ABSL_EXCLUSIVE_LOCKS_REQUIRED(writer_mutex_);
+  // Advances the epoch and waits for readers of the previous epoch to leave.
+  void WaitForReaders() ABSL_EXCLUSIVE_LOCKS_REQUIRED(writer_mutex_);
+
+  // Removes deleted keys from key-value map for a given prefix
+  void CleanUpKeyValueMap(int64_t logical_commit_time, std::string_view prefix);
+  // Logs cache access metrics for cache hit or miss counts. The cache access
+  // event name is defined in server_definition.h file
+  void LogCacheAccessMetrics(const RequestContext& request_context,
+                             std::string_view cache_access_event) const;
+
+  // Serializes all writers of the key-value map. Readers never take it.
+  absl::Mutex writer_mutex_;
+  std::atomic<Table*> table_;
+  size_t num_nodes_ ABSL_GUARDED_BY(writer_mutex_) = 0;
+  std::atomic<uint64_t> epoch_{0};
+  mutable std::array<ReaderSlot, kNumReaderSlots> reader_slots_;
+  std::vector<Node*> retired_nodes_ ABSL_GUARDED_BY(writer_mutex_);
+  std::vector<std::unique_ptr<Table>> retired_tables_
+      ABSL_GUARDED_BY(writer_mutex_);
+
+  // Sorted mapping from the logical timestamp to a key, for nodes that were
+  // deleted, keyed by prefix. We keep this to do proper and efficient clean up.
+  absl::flat_hash_map<std::string, std::multimap<int64_t, std::string>>
+      deleted_nodes_map_ ABSL_GUARDED_BY(writer_mutex_);
+  // The key is the prefix and the value is the
+  // maximum timestamp that was passed to RemoveDeletedKeys.
+  absl::flat_hash_map<std::string, int64_t> max_cleanup_logical_commit_time_map_
+      ABSL_GUARDED_BY(writer_mutex_);
+
+  // Amount of data of every prefix in the key-value map.
+  PrefixCounters prefix_counters_;
+
+  const bool precompute_json_values_;
+  KeyValueCache set_cache_;
+
+  friend class EpochKeyValueCacheTestPeer;
+};
+
+}  // namespace kv_server
+
+#endif  // COMPONENTS_DATA_SERVER_CACHE_EPOCH_KEY_VALUE_CACHE_H_
@@ -0,0 +1,311 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/data_server/cache/epoch_key_value_cache.h"
+
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/strings/str_cat.h"
+#include "absl/synchronization/notification.h"
+#include "components/data_server/cache/cache.h"
+#include "components/data_server/cache/mocks.h"
+#include "gmock/gmock.h"
+#include "google/protobuf/struct.pb.h"
+#include "gtest/gtest.h"
+
+namespace kv_server {
+
+class EpochKeyValueCacheTestPeer {
+ public:
+  EpochKeyValueCacheTestPeer() = delete;
+  static std::multimap<int64_t, std::string> ReadDeletedNodes(
+      Cache& c, std::string_view prefix = "") {
+    auto& cache = static_cast<EpochKeyValueCache&>(c);
+    absl::MutexLock lock(&cache.writer_mutex_);
+    auto map_itr = cache.deleted_nodes_map_.find(prefix);
+    return map_itr == cache.deleted_nodes_map_.end()
+               ? std::multimap<int64_t, std::string>()
+               : map_itr->second;
+  }
+  static size_t NumRetiredNodes(Cache& c) {
+    auto& cache = static_cast<EpochKeyValueCache&>(c);
+    absl::MutexLock lock(&cache.writer_mutex_);
+    return cache.retired_nodes_.size();
+  }
+  static size_t NumBuckets(Cache& c) {
+    return static_cast<EpochKeyValueCache&>(c).table_.load()->num_buckets;
+  }
+};
+
+namespace {
+
+using testing::UnorderedElementsAre;
+
+class EpochCacheTest : public ::testing::Test {
+ protected:
+  EpochCacheTest() {
+    InitMetricsContextMap();
+    scope_metrics_context_ = std::make_unique<ScopeMetricsContext>();
+    request_context_ =
+        std::make_unique<RequestContext>(*scope_metrics_context_);
+  }
+  RequestContext& GetRequestContext() { return *request_context_; }
+  std::unique_ptr<ScopeMetricsContext> scope_metrics_context_;
+  std::unique_ptr<RequestContext> request_context_;
+};
+
+TEST_F(EpochCacheTest, RetrievesMatchingEntry) {
+  std::unique_ptr<Cache> cache = EpochKeyValueCache::Create();
+  cache->UpdateKeyValue("my_key", "my_value", 1);
+  absl::flat_hash_set<std::string_view> keys = {"my_key"};
+  absl::flat_hash_set<std::string_view> wrong_keys = {"wrong_key"};
+  EXPECT_THAT(cache->GetKeyValuePairs(GetRequestContext(), keys),
+              UnorderedElementsAre(KVPairEq("my_key", "my_value")));
+  EXPECT_TRUE(cache->GetKeyValuePairs(GetRequestContext(), wrong_keys).empty());
+}
+
+TEST_F(EpochCacheTest, GetKeyValuesReturnsViewsOfMatchingEntries) {
+  std::unique_ptr<Cache> cache = EpochKeyValueCache::Create();
+  cache->UpdateKeyValue("key1", "value1", 1);
+  cache->UpdateKeyValue("key2", "value2", 1);
+  auto result =
+      cache->GetKeyValues(GetRequestContext(), {"key1", "key2", "missing"});
+  EXPECT_EQ(result->size(), 2);
+  EXPECT_EQ(result->GetValue("key1"), "value1");
+  EXPECT_EQ(result->GetValue("key2"), "value2");
+  EXPECT_EQ(result->GetValue("missing"), std::nullopt);
+}
+
+TEST_F(EpochCacheTest, GetKeyValuesReturnsPrecomputedJsonValues) {
+  std::unique_ptr<Cache> cache = EpochKeyValueCache::Create(
+      /*intern_set_values=*/false, /*precompute_json_values=*/true);
+  cache->UpdateKeyValue("json", R"({"a":1})", 1);
+  cache->UpdateKeyValue("string", "value", 1);
+  auto result = cache->GetKeyValues(GetRequestContext(),
+                                    {"json", "string", "missing"});
+  EXPECT_EQ(result->GetValue("json"), R"({"a":1})");
+  EXPECT_EQ(result->GetValue("string"), "value");
+  google::protobuf::Value value;
+  ASSERT_TRUE(value.ParseFromString(
+      std::string(*result->GetSerializedJsonValue("json"))));
+  EXPECT_EQ(value.struct_value().fields().at("a").number_value(), 1);
+  EXPECT_EQ(result->GetSerializedJsonValue("string"), "");
+  EXPECT_EQ(result->GetSerializedJsonValue("missing"), std::nullopt);
+  EXPECT_THAT(cache->GetKeyValuePairs(GetRequestContext(), {"json"}),
+              UnorderedElementsAre(KVPairEq("json", R"({"a":1})")));
+}
+
+TEST_F(EpochCacheTest, GetKeyValuesResultOutlivesUpdateAndCleanup) {
+  std::unique_ptr<Cache> cache = EpochKeyValueCache::Create();
+  cache->UpdateKeyValue("my_key", "my_value", 1);
+  auto result = cache->GetKeyValues(GetRequestContext(), {"my_key"});
+  cache->UpdateKeyValue("my_key", "my_new_value", 2);
+  cache->DeleteKey("my_key", 3);
+  cache->RemoveDeletedKeys(4);
+  EXPECT_EQ(result->GetValue("my_key"), "my_value");
+  EXPECT_EQ(cache->GetKeyValues(GetRequestContext(), {"my_key"})->size(), 0);
+}
+
+TEST_F(EpochCacheTest, GetAfterUpdateReturnsNewValueAndRetiresOldNode) {
+  std::unique_ptr<Cache> cache = EpochKeyValueCache::Create();
+  cache->UpdateKeyValue("my_key", "my_value", 1);
+  cache->UpdateKeyValue("my_key", "my_new_value", 2);
+  cache->UpdateKeyValue("my_key", "my_old_value", 1);
+  EXPECT_THAT(cache->GetKeyValuePairs(GetRequestContext(), {"my_key"}),
+              UnorderedElementsAre(KVPairEq("my_key", "my_new_value")));
+  EXPECT_EQ(EpochKeyValueCacheTestPeer::NumRetiredNodes(*cache), 1);
+}
+
+TEST_F(EpochCacheTest, DeleteKeyKeepsTombstoneUntilCleanup) {
+  std::unique_ptr<Cache> cache = EpochKeyValueCache::Create();
+  cache->UpdateKeyValue("my_key", "my_value", 1);
+  cache->DeleteKey("my_key", 2);
+  EXPECT_TRUE(cache->GetKeyValuePairs(GetRequestContext(), {"my_key"}).empty());
+  // Late arriving update is rejected by the tombstone.
+  cache->UpdateKeyValue("my_key", "my_value", 1);
+  EXPECT_TRUE(cache->GetKeyValuePairs(GetRequestContext(), {"my_key"}).empty());
+  EXPECT_THAT(EpochKeyValueCacheTestPeer::ReadDeletedNodes(*cache),
+              UnorderedElementsAre(std::pair<const int64_t, std::string>(
+                  2, "my_key")));
+}
+
+TEST_F(EpochCacheTest, UpdateAfterDeleteRemovesDeletedNode) {
+  std::unique_ptr<Cache> cache = EpochKeyValueCache::Create();
+  cache->DeleteKey("my_key", 1);
+  cache->UpdateKeyValue("my_key", "my_value", 2);
+  EXPECT_THAT(cache->GetKeyValuePairs(GetRequestContext(), {"my_key"}),
+              UnorderedElementsAre(KVPairEq("my_key", "my_value")));
+  EXPECT_TRUE(EpochKeyValueCacheTestPeer::ReadDeletedNodes(*cache).empty());
+}
+
+TEST_F(EpochCacheTest, RemoveDeletedKeysReclaimsRetiredNodes) {
+  std::unique_ptr<Cache> cache = EpochKeyValueCache::Create();
+  cache->UpdateKeyValue("my_key", "my_value", 1);
+  cache->DeleteKey("my_key", 2);
+  cache->RemoveDeletedKeys(3);
+  EXPECT_TRUE(EpochKeyValueCacheTestPeer::ReadDeletedNodes(*cache).empty());
+  EXPECT_EQ(EpochKeyValueCacheTestPeer::NumRetiredNodes(*cache), 0);
+  // Updates at or before the cleanup cutoff are ignored.
+  cache->UpdateKeyValue("my_key", "my_value", 3);
+  EXPECT_TRUE(cache->GetKeyValuePairs(GetRequestContext(), {"my_key"}).empty());
+  cache->UpdateKeyValue("my_key", "my_value", 4);
+  EXPECT_THAT(cache->GetKeyValuePairs(GetRequestContext(), {"my_key"}),
+              UnorderedElementsAre(KVPairEq("my_key", "my_value")));
+}
+
+TEST_F(EpochCacheTest, RemoveDeletedKeysOnlyAffectsGivenPrefix) {
+  std::unique_ptr<Cache> cache = EpochKeyValueCache::Create();
+  cache->DeleteKey("key1", 2, "prefix1");
+  cache->DeleteKey("key2", 2, "prefix2");
+  cache->RemoveDeletedKeys(3, "prefix1");
+  EXPECT_TRUE(
+      EpochKeyValueCacheTestPeer::ReadDeletedNodes(*cache, "prefix1").empty());
+  EXPECT_EQ(EpochKeyValueCacheTestPeer::ReadDeletedNodes(*cache, "prefix2")
+                .size(),
+            1);
+}
+
+TEST_F(EpochCacheTest, GrowingTablePreservesAllEntries) {
+  std::unique_ptr<Cache> cache = EpochKeyValueCache::Create();
+  const size_t initial_num_buckets =
+      EpochKeyValueCacheTestPeer::NumBuckets(*cache);
+  std::vector<std::string> keys;
+  for (size_t i = 0; i < 3 * initial_num_buckets; i++) {
+    keys.push_back(absl::StrCat("key", i));
+    cache->UpdateKeyValue(keys.back(), absl::StrCat("value", i), 1);
+  }
+  EXPECT_GT(EpochKeyValueCacheTestPeer::NumBuckets(*cache),
+            initial_num_buckets);
+  absl::flat_hash_set<std::string_view> key_set(keys.begin(), keys.end());
+  auto kv_pairs = cache->GetKeyValuePairs(GetRequestContext(), key_set);
+  ASSERT_EQ(kv_pairs.size(), keys.size());
+  for (size_t i = 0; i < keys.size(); i++) {
+    EXPECT_EQ(kv_pairs[keys[i]], absl::StrCat("value", i));
+  }
+}
+
+TEST_F(EpochCacheTest, GetForCacheReturnsValueSets) {
+  std::unique_ptr<Cache> cache = EpochKeyValueCache::Create();
+  std::vector<std::string_view> values = {"v1", "v2", "v3"};
+  std::vector<std::string_view> values_to_delete = {"v1"};
+  cache->UpdateKeyValueSet("my_key", absl::MakeSpan(values), 1);
+  cache->DeleteValuesInSet("my_key", absl::MakeSpan(values_to_delete), 2);
+  cache->RemoveDeletedKeys(2);
+  cache->UpdateKeyValueSet("my_key", absl::MakeSpan(values_to_delete), 2);
+  EXPECT_THAT(cache->GetKeyValueSet(GetRequestContext(), {"my_key"})
+                  ->GetValueSet("my_key"),
+              UnorderedElementsAre("v2", "v3"));
+}
+
+TEST_F(EpochCacheTest, ConcurrentGetAndUpdateWithReclamation) {
+  std::unique_ptr<Cache> cache = EpochKeyValueCache::Create();
+  std::vector<std::string> keys;
+  absl::flat_hash_set<std::string_view> key_set;
+  for (int i = 0; i < 100; i++) {
+    keys.push_back(absl::StrCat("key", i));
+  }
+  for (const auto& key : keys) {
+    cache->UpdateKeyValue(key, "initial", 1);
+    key_set.insert(key);
+  }
+  absl::Notification start;
+  auto& request_context = GetRequestContext();
+  auto lookup_fn = [&cache, &key_set, &start, &request_context]() {
+    start.WaitForNotification();
+    for (int i = 0; i < 100; i++) {
+      EXPECT_EQ(cache->GetKeyValuePairs(request_context, key_set).size(),
+                key_set.size());
+    }
+  };
+  auto update_fn = [&cache, &keys, &start]() {
+    start.WaitForNotification();
+    for (int64_t logical_commit_time = 2; logical_commit_time < 200;
+         logical_commit_time++) {
+      for (const auto& key : keys) {
+        cache->UpdateKeyValue(key, absl::StrCat("value", logical_commit_time),
+                              logical_commit_time);
+      }
+      cache->RemoveDeletedKeys(1);
+    }
+  };
+  std::vector<std::thread> threads;
+  for (int i = 0; i < std::min(20, (int)std::thread::hardware_concurrency());
+       i++) {
+    threads.emplace_back(lookup_fn);
+  }
+  threads.emplace_back(update_fn);
+  start.Notify();
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  for (const auto& [key, value] :
+       cache->GetKeyValuePairs(GetRequestContext(), key_set)) {
+    EXPECT_EQ(value, "value199");
+  }
+}
+
+TEST_F(EpochCacheTest, ForEachKeyVisitsKeysAndSetKeys) {
+  std::unique_ptr<Cache> cache = EpochKeyValueCache::Create();
+  std::vector<std::string_view> values = {"v1", "v2"};
+  // Enough keys for the table to grow.
+  for (int i = 0; i < 100; i++) {
+    cache->UpdateKeyValue(absl::StrCat("key", i), "value", 1);
+  }
+  cache->DeleteKey("key0", 2);
+  cache->UpdateKeyValueSet("set1", absl::MakeSpan(values), 1);
+  absl::flat_hash_set<std::string> keys;
+  ASSERT_TRUE(cache
+                  ->ForEachKey([&keys](std::string_view key) {
+                    keys.emplace(key);
+                  })
+                  .ok());
+  EXPECT_EQ(keys.size(), size_t{100});
+  EXPECT_FALSE(keys.contains("key0"));
+  EXPECT_TRUE(keys.contains("key99"));
+  EXPECT_TRUE(keys.contains("set1"));
+}
+
+TEST_F(EpochCacheTest, PrefixStatsCountKeysAndSets) {
+  std::unique_ptr<Cache> cache = EpochKeyValueCache::Create();
+  std::vector<std::string_view> values = {"v1", "v2"};
+  std::vector<std::string_view> values_to_delete = {"v1"};
+  cache->UpdateKeyValue("key1", "value1", 1, "prefix");
+  cache->UpdateKeyValue("key2", "value2", 1, "prefix");
+  cache->DeleteKey("key2", 2, "prefix");
+  cache->UpdateKeyValueSet("set1", absl::MakeSpan(values), 1, "prefix");
+  cache->DeleteValuesInSet("set1", absl::MakeSpan(values_to_delete), 2,
+                           "prefix");
+  PrefixStats stats = cache->GetPrefixStats().at("prefix");
+  EXPECT_EQ(stats.num_keys, 1);
+  EXPECT_EQ(stats.value_bytes, 10);
+  EXPECT_EQ(stats.num_set_values, 1);
+  EXPECT_EQ(stats.num_tombstones, 2);
+
+  cache->RemoveDeletedKeys(2, "prefix");
+  stats = cache->GetPrefixStats().at("prefix");
+  EXPECT_EQ(stats.num_keys, 1);
+  EXPECT_EQ(stats.num_set_values, 1);
+  EXPECT_EQ(stats.num_tombstones, 0);
+}
+
+}  // namespace
+}  // namespace kv_server
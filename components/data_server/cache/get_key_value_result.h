@@ -0,0 +1,66 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef COMPONENTS_DATA_SERVER_CACHE_GET_KEY_VALUE_RESULT_H_
+#define COMPONENTS_DATA_SERVER_CACHE_GET_KEY_VALUE_RESULT_H_
+
+#include <memory>
+#include <optional>
+#include <string_view>
+
+namespace kv_server {
+// Class that holds views of the values retrieved from cache lookup, together
+// with references that keep the viewed values alive, so that values are not
+// copied out of the cache.
+class GetKeyValueResult {
+ public:
+  virtual ~GetKeyValueResult() = default;
+
+  // Returns the value for the given key, or std::nullopt if the key was not
+  // found. The returned view is valid for the lifetime of this object.
+  virtual std::optional<std::string_view> GetValue(
+      std::string_view key) const = 0;
+
+  // Returns the `google.protobuf.Value` that the value of `key` parses into as
+  // JSON, serialized, if the cache precomputed it when the value was loaded.
+  // The view is empty if the value is not JSON. Returns std::nullopt if the
+  // key was not found or the cache does not precompute JSON values.
+  virtual std::optional<std::string_view> GetSerializedJsonValue(
+      std::string_view key) const = 0;
+
+  // Returns the number of keys that were found.
+  virtual size_t size() const = 0;
+
+ private:
+  // Adds key, value to the result data map. `value_owner` keeps the storage
+  // that `value` points into alive until this object goes out of scope. `key`
+  // must outlive this object. `serialized_json` is the precomputed JSON form
+  // of `value`, if any, and is kept alive by `value_owner` too.
+  virtual void AddKeyValue(std::string_view key, std::string_view value,
+                           std::shared_ptr<const void> value_owner,
+                           std::optional<std::string_view> serialized_json) = 0;
+
+  static std::unique_ptr<GetKeyValueResult> Create();
+
+  friend class EpochKeyValueCache;
+  friend class KeyValueCache;
+  friend class ShardedKeyValueCache;
+  friend class PrefixedKeyValueCache;
+};
+
+}  // namespace kv_server
+
+#endif  // COMPONENTS_DATA_SERVER_CACHE_GET_KEY_VALUE_RESULT_H_
@@ -0,0 +1,85 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <memory>
+#include <optional>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "components/data_server/cache/get_key_value_result.h"
+
+namespace kv_server {
+namespace {
+
+// Class that holds views of the values retrieved from cache lookup and the
+// references that keep them alive
+class GetKeyValueResultImpl : public GetKeyValueResult {
+ public:
+  GetKeyValueResultImpl() {}
+
+  // Looks up the key in the data map and returns its value, if present.
+  std::optional<std::string_view> GetValue(
+      std::string_view key) const override {
+    auto key_itr = data_map_.find(key);
+    if (key_itr == data_map_.end()) {
+      return std::nullopt;
+    }
+    return key_itr->second;
+  }
+
+  std::optional<std::string_view> GetSerializedJsonValue(
+      std::string_view key) const override {
+    auto key_itr = serialized_json_map_.find(key);
+    if (key_itr == serialized_json_map_.end()) {
+      return std::nullopt;
+    }
+    return key_itr->second;
+  }
+
+  size_t size() const override { return data_map_.size(); }
+
+  GetKeyValueResultImpl(const GetKeyValueResultImpl&) = delete;
+  GetKeyValueResultImpl& operator=(const GetKeyValueResultImpl&) = delete;
+  GetKeyValueResultImpl(GetKeyValueResultImpl&& other) = default;
+  GetKeyValueResultImpl& operator=(GetKeyValueResultImpl&& other) = default;
+
+ private:
+  std::vector<std::shared_ptr<const void>> value_owners_;
+  absl::flat_hash_map<std::string_view, std::string_view> data_map_;
+  // Only filled by caches that precompute JSON values.
+  absl::flat_hash_map<std::string_view, std::string_view> serialized_json_map_;
+
+  // Adds key, value to the result data map and keeps a reference to the
+  // value's storage
+  void AddKeyValue(std::string_view key, std::string_view value,
+                   std::shared_ptr<const void> value_owner,
+                   std::optional<std::string_view> serialized_json) override {
+    value_owners_.push_back(std::move(value_owner));
+    data_map_.insert_or_assign(key, value);
+    if (serialized_json.has_value()) {
+      serialized_json_map_.insert_or_assign(key, *serialized_json);
+    }
+  }
+};
+}  // namespace
+
+std::unique_ptr<GetKeyValueResult> GetKeyValueResult::Create() {
+  return std::make_unique<GetKeyValueResultImpl>();
+}
+
+}  // namespace kv_server
@@ -18,32 +18,57 @@
 #define COMPONENTS_DATA_SERVER_CACHE_GET_KEY_VALUE_SET_RESULT_H_
 
 #include <memory>
+#include <string_view>
 #include <utility>
 #include <vector>
 
 #include "absl/container/flat_hash_set.h"
+#include "components/data_server/cache/value_set_snapshot.h"
+#include "components/query/roaring_bitmap.h"
 
 namespace kv_server {
-// Class that holds the data retrieved from cache lookup and read locks for
-// the lookup keys
+// Class that holds the snapshots of the value sets retrieved from cache lookup.
+// The sets are not locked, updates to them after the lookup are not visible.
 class GetKeyValueSetResult {
  public:
   virtual ~GetKeyValueSetResult() = default;
 
-  // Looks up and returns key-value set result for the given key set.
-  virtual absl::flat_hash_set<std::string_view> GetValueSet(
+  // Returns the value set of the given key, empty for missing keys, valid for
+  // the lifetime of this object.
+  virtual const absl::flat_hash_set<std::string_view>& GetValueSet(
       std::string_view key) const = 0;
 
+  // Returns the number of values in the set of the given key, 0 for missing
+  // keys, without copying the set.
+  virtual size_t GetValueSetSize(std::string_view key) const = 0;
+
+  // Returns whether the cache interns set values, in which case
+  // `GetValueSetIds` returns the ids of the values and set operations can be
+  // evaluated over the ids instead of the values.
+  virtual bool HasValueSetIds() const = 0;
+
+  // Returns the ids of the values in the set of the given key, empty for
+  // missing keys, or nullptr if `HasValueSetIds` is false.
+  virtual const RoaringBitmap* GetValueSetIds(std::string_view key) const = 0;
+
+  // Returns the values of `ids`, which must be ids returned by
+  // `GetValueSetIds` or a combination of them.
+  virtual std::vector<std::string_view> GetValues(
+      const RoaringBitmap& ids) const = 0;
+
  private:
-  // Adds key, value_set to the result data map, mantains the lock on `key`
-  // until this object goes out of scope.
+  // Adds the snapshot of the value set of `key`, which is held until this
+  // object goes out of scope. Snapshots of interned values all have the same
+  // interner.
   virtual void AddKeyValueSet(
-      std::string_view key, absl::flat_hash_set<std::string_view> value_set,
-      std::unique_ptr<absl::ReaderMutexLock> key_lock) = 0;
+      std::string_view key,
+      std::shared_ptr<const ValueSetSnapshot> value_set) = 0;
 
   static std::unique_ptr<GetKeyValueSetResult> Create();
 
   friend class KeyValueCache;
+  friend class ShardedKeyValueCache;
+  friend class PrefixedKeyValueCache;
 };
 
 }  // namespace kv_server
@@ -15,30 +15,65 @@
  */
 
 #include <memory>
+#include <string_view>
 #include <utility>
 #include <vector>
 
 #include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
 #include "components/data_server/cache/get_key_value_set_result.h"
+#include "components/data_server/cache/value_interner.h"
+#include "components/data_server/cache/value_set_snapshot.h"
+#include "components/query/roaring_bitmap.h"
 
 namespace kv_server {
 namespace {
 
-// Class that holds the data retrieved from cache lookup and read locks for
-// the lookup keys
+// Class that holds the snapshots of the value sets retrieved from cache lookup
 class GetKeyValueSetResultImpl : public GetKeyValueSetResult {
  public:
   GetKeyValueSetResultImpl() {}
 
   // Looks up the key in the data map and returns value set. If the value_set
   // for the key is missing, returns empty set.
-  absl::flat_hash_set<std::string_view> GetValueSet(
+  const absl::flat_hash_set<std::string_view>& GetValueSet(
       std::string_view key) const override {
     static const absl::flat_hash_set<std::string_view>* kEmptySet =
         new absl::flat_hash_set<std::string_view>();
+    if (auto key_itr = data_map_.find(key); key_itr != data_map_.end()) {
+      return key_itr->second->values();
+    }
+    return *kEmptySet;
+  }
+
+  size_t GetValueSetSize(std::string_view key) const override {
+    if (auto key_itr = data_map_.find(key); key_itr != data_map_.end()) {
+      return key_itr->second->size();
+    }
+    return 0;
+  }
+
+  bool HasValueSetIds() const override { return interner_ != nullptr; }
+
+  const RoaringBitmap* GetValueSetIds(std::string_view key) const override {
+    static const RoaringBitmap* kEmptyIds = new RoaringBitmap();
+    if (interner_ == nullptr) {
+      return nullptr;
+    }
     auto key_itr = data_map_.find(key);
-    return key_itr == data_map_.end() ? *kEmptySet : key_itr->second;
+    return key_itr == data_map_.end() ? kEmptyIds : key_itr->second->ids();
+  }
+
+  std::vector<std::string_view> GetValues(
+      const RoaringBitmap& ids) const override {
+    std::vector<std::string_view> values;
+    if (interner_ == nullptr) {
+      return values;
+    }
+    values.reserve(ids.Cardinality());
+    interner_->ForEachValue(
+        ids, [&values](std::string_view value) { values.push_back(value); });
+    return values;
   }
 
   GetKeyValueSetResultImpl(const GetKeyValueSetResultImpl&) = delete;
@@ -48,16 +83,18 @@ class GetKeyValueSetResultImpl : public GetKeyValueSetResult {
       default;
 
  private:
-  std::vector<std::unique_ptr<absl::ReaderMutexLock>> read_locks_;
-  absl::flat_hash_map<std::string_view, absl::flat_hash_set<std::string_view>>
+  absl::flat_hash_map<std::string_view, std::shared_ptr<const ValueSetSnapshot>>
       data_map_;
+  // Set if the snapshots hold the ids of interned values.
+  const ValueInterner* interner_ = nullptr;
 
-  // Adds key, value_set to the result data map, creates a read lock for
-  // the key mutex
+  // Adds key, value_set to the result data map
   void AddKeyValueSet(
-      std::string_view key, absl::flat_hash_set<std::string_view> value_set,
-      std::unique_ptr<absl::ReaderMutexLock> key_lock) override {
-    read_locks_.push_back(std::move(key_lock));
+      std::string_view key,
+      std::shared_ptr<const ValueSetSnapshot> value_set) override {
+    if (value_set->interner() != nullptr) {
+      interner_ = value_set->interner();
+    }
     data_map_.emplace(key, std::move(value_set));
   }
 };
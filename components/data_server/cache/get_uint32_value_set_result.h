@@ -0,0 +1,56 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef COMPONENTS_DATA_SERVER_CACHE_GET_UINT32_VALUE_SET_RESULT_H_
+#define COMPONENTS_DATA_SERVER_CACHE_GET_UINT32_VALUE_SET_RESULT_H_
+
+#include <memory>
+#include <string_view>
+
+#include "absl/synchronization/mutex.h"
+#include "components/query/roaring_bitmap.h"
+
+namespace kv_server {
+// Holds the sets of 32-bit unsigned integers retrieved from a cache lookup
+// and the read locks of the lookup keys.
+class GetUInt32ValueSetResult {
+ public:
+  virtual ~GetUInt32ValueSetResult() = default;
+
+  // Returns the values in the set of the given key, empty for missing keys.
+  virtual const RoaringBitmap& GetValueSet(std::string_view key) const = 0;
+
+ private:
+  // Adds the value set of `key`, and mantains the lock on `key`, if any,
+  // until this object goes out of scope.
+  virtual void AddValueSet(std::string_view key, const RoaringBitmap& values,
+                           std::unique_ptr<absl::ReaderMutexLock> key_lock) = 0;
+
+  // Adds a value set of `key` that this object holds itself.
+  virtual void AddOwnedValueSet(std::string_view key,
+                                RoaringBitmap values) = 0;
+
+  static std::unique_ptr<GetUInt32ValueSetResult> Create();
+
+  friend class Cache;
+  friend class KeyValueCache;
+  friend class ShardedKeyValueCache;
+  friend class PrefixedKeyValueCache;
+};
+
+}  // namespace kv_server
+
+#endif  // COMPONENTS_DATA_SERVER_CACHE_GET_UINT32_VALUE_SET_RESULT_H_
@@ -0,0 +1,64 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <memory>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/node_hash_map.h"
+#include "components/data_server/cache/get_uint32_value_set_result.h"
+#include "components/query/roaring_bitmap.h"
+
+namespace kv_server {
+namespace {
+
+class GetUInt32ValueSetResultImpl : public GetUInt32ValueSetResult {
+ public:
+  const RoaringBitmap& GetValueSet(std::string_view key) const override {
+    static const RoaringBitmap* kEmptySet = new RoaringBitmap();
+    auto key_itr = value_sets_.find(key);
+    return key_itr == value_sets_.end() ? *kEmptySet : *key_itr->second;
+  }
+
+ private:
+  std::vector<std::unique_ptr<absl::ReaderMutexLock>> read_locks_;
+  absl::flat_hash_map<std::string_view, const RoaringBitmap*> value_sets_;
+  // Sets added by `AddOwnedValueSet`, which `value_sets_` points into.
+  absl::node_hash_map<std::string_view, RoaringBitmap> owned_value_sets_;
+
+  void AddValueSet(std::string_view key, const RoaringBitmap& values,
+                   std::unique_ptr<absl::ReaderMutexLock> key_lock) override {
+    if (key_lock != nullptr) {
+      read_locks_.push_back(std::move(key_lock));
+    }
+    value_sets_.emplace(key, &values);
+  }
+
+  void AddOwnedValueSet(std::string_view key, RoaringBitmap values) override {
+    auto [owned_itr, inserted] =
+        owned_value_sets_.insert_or_assign(key, std::move(values));
+    value_sets_.insert_or_assign(key, &owned_itr->second);
+  }
+};
+}  // namespace
+
+std::unique_ptr<GetUInt32ValueSetResult> GetUInt32ValueSetResult::Create() {
+  return std::make_unique<GetUInt32ValueSetResultImpl>();
+}
+
+}  // namespace kv_server
@@ -0,0 +1,82 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef COMPONENTS_DATA_SERVER_CACHE_HASHED_KEY_H_
+#define COMPONENTS_DATA_SERVER_CACHE_HASHED_KEY_H_
+
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+#include "absl/container/flat_hash_set.h"
+#include "absl/hash/hash.h"
+
+namespace kv_server {
+
+struct HashedKey;
+
+// Hash of the keys of the key maps of the cache. Looking up a `HashedKey`
+// reuses its hash instead of hashing the key again.
+struct KeyHash {
+  using is_transparent = void;
+
+  size_t operator()(std::string_view key) const {
+    return absl::Hash<std::string_view>{}(key);
+  }
+  size_t operator()(const HashedKey& key) const;
+};
+
+// A key of a lookup with its `KeyHash`, so that the key is hashed once
+// however many maps and prefetches it goes through.
+struct HashedKey {
+  explicit HashedKey(std::string_view key) : key(key), hash(KeyHash{}(key)) {}
+
+  std::string_view key;
+  size_t hash;
+};
+
+inline size_t KeyHash::operator()(const HashedKey& key) const {
+  return key.hash;
+}
+
+struct KeyEq {
+  using is_transparent = void;
+
+  bool operator()(std::string_view lhs, std::string_view rhs) const {
+    return lhs == rhs;
+  }
+  bool operator()(const HashedKey& lhs, std::string_view rhs) const {
+    return lhs.key == rhs;
+  }
+  bool operator()(std::string_view lhs, const HashedKey& rhs) const {
+    return lhs == rhs.key;
+  }
+};
+
+// Returns the keys of `key_set` with their hashes.
+inline std::vector<HashedKey> HashKeys(
+    const absl::flat_hash_set<std::string_view>& key_set) {
+  std::vector<HashedKey> keys;
+  keys.reserve(key_set.size());
+  for (std::string_view key : key_set) {
+    keys.emplace_back(key);
+  }
+  return keys;
+}
+
+}  // namespace kv_server
+
+#endif  // COMPONENTS_DATA_SERVER_CACHE_HASHED_KEY_H_
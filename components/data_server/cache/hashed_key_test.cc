@@ -0,0 +1,55 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/data_server/cache/hashed_key.h"
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "gtest/gtest.h"
+
+namespace kv_server {
+namespace {
+
+TEST(HashedKeyTest, FindsKeysByTheirHash) {
+  absl::flat_hash_map<std::string, int, KeyHash, KeyEq> map;
+  for (int i = 0; i < 100; i++) {
+    map.emplace(std::to_string(i), i);
+  }
+  for (int i = 0; i < 100; i++) {
+    const std::string key = std::to_string(i);
+    const HashedKey hashed_key(key);
+    EXPECT_EQ(hashed_key.hash, KeyHash{}(key));
+    map.prefetch(hashed_key);
+    const auto iter = map.find(hashed_key);
+    ASSERT_NE(iter, map.end());
+    EXPECT_EQ(iter->second, i);
+  }
+  EXPECT_EQ(map.find(HashedKey("missing")), map.end());
+}
+
+TEST(HashedKeyTest, HashesEveryKeyOfASet) {
+  const absl::flat_hash_set<std::string_view> key_set = {"a", "b", "c"};
+  const std::vector<HashedKey> keys = HashKeys(key_set);
+  ASSERT_EQ(keys.size(), 3);
+  for (const HashedKey& key : keys) {
+    EXPECT_TRUE(key_set.contains(key.key));
+    EXPECT_EQ(key.hash, KeyHash{}(key.key));
+  }
+}
+
+}  // namespace
+}  // namespace kv_server
@@ -0,0 +1,153 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/data_server/cache/hot_key_sketch.h"
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <thread>
+#include <tuple>
+
+namespace kv_server {
+namespace {
+
+// Odd multipliers that map a key hash to an unrelated counter of every row.
+constexpr uint64_t kRowMultipliers[] = {
+    0x9e3779b97f4a7c15,
+    0xc2b2ae3d27d4eb4f,
+    0x165667b19e3779f9,
+    0xd6e8feb86659fd93,
+};
+
+int WidthBits(int64_t width) {
+  int bits = 1;
+  while ((int64_t{1} << bits) < width) {
+    bits++;
+  }
+  return bits;
+}
+
+}  // namespace
+
+HotKeySketch::HotKeySketch(Options options)
+    : sample_rate_(std::max(options.sample_rate, 1)),
+      width_bits_(WidthBits(options.width)),
+      max_candidates_(std::max<int64_t>(options.max_candidates, 1)),
+      samples_per_decay_(options.samples_per_decay > 0
+                             ? options.samples_per_decay
+                             : int64_t{16} << width_bits_),
+      counters_(std::make_unique<std::atomic<uint32_t>[]>(
+          size_t{kDepth} << width_bits_)) {}
+
+bool HotKeySketch::Sample() const {
+  // Xorshift, seeded differently on every thread.
+  thread_local uint64_t state =
+      std::hash<std::thread::id>{}(std::this_thread::get_id()) | 1;
+  state ^= state << 13;
+  state ^= state >> 7;
+  state ^= state << 17;
+  return state % sample_rate_ == 0;
+}
+
+std::atomic<uint32_t>& HotKeySketch::Counter(int row, size_t hash) const {
+  const uint64_t column =
+      (static_cast<uint64_t>(hash) * kRowMultipliers[row]) >>
+      (64 - width_bits_);
+  return counters_[(static_cast<size_t>(row) << width_bits_) + column];
+}
+
+void HotKeySketch::Add(const HashedKey& key, PrefixCounters::Id prefix_id) {
+  uint32_t count = std::numeric_limits<uint32_t>::max();
+  for (int row = 0; row < kDepth; row++) {
+    count = std::min(
+        count,
+        Counter(row, key.hash).fetch_add(1, std::memory_order_relaxed) + 1);
+  }
+  if ((num_samples_.fetch_add(1, std::memory_order_relaxed) + 1) %
+          samples_per_decay_ ==
+      0) {
+    absl::MutexLock lock(&mutex_);
+    Decay();
+    return;
+  }
+  if (count < min_candidate_count_.load(std::memory_order_relaxed)) {
+    return;
+  }
+  absl::MutexLock lock(&mutex_);
+  if (auto it = candidates_.find(key.key); it != candidates_.end()) {
+    it->second = {.prefix_id = prefix_id, .count = count};
+    return;
+  }
+  const auto is_colder = [](const auto& a, const auto& b) {
+    return a.second.count < b.second.count;
+  };
+  if (static_cast<int64_t>(candidates_.size()) >= max_candidates_) {
+    auto coldest =
+        std::min_element(candidates_.begin(), candidates_.end(), is_colder);
+    if (coldest->second.count >= count) {
+      min_candidate_count_.store(coldest->second.count,
+                                 std::memory_order_relaxed);
+      return;
+    }
+    candidates_.erase(coldest);
+  }
+  candidates_.emplace(key.key,
+                      CandidateCount{.prefix_id = prefix_id, .count = count});
+  if (static_cast<int64_t>(candidates_.size()) >= max_candidates_) {
+    min_candidate_count_.store(
+        std::min_element(candidates_.begin(), candidates_.end(), is_colder)
+            ->second.count,
+        std::memory_order_relaxed);
+  }
+}
+
+void HotKeySketch::Decay() {
+  for (size_t i = 0; i < (size_t{kDepth} << width_bits_); i++) {
+    counters_[i].store(counters_[i].load(std::memory_order_relaxed) / 2,
+                       std::memory_order_relaxed);
+  }
+  for (auto& [unused_key, candidate] : candidates_) {
+    candidate.count /= 2;
+  }
+  absl::erase_if(candidates_, [](const auto& candidate) {
+    return candidate.second.count == 0;
+  });
+  min_candidate_count_.store(
+      min_candidate_count_.load(std::memory_order_relaxed) / 2,
+      std::memory_order_relaxed);
+}
+
+std::vector<HotKeySketch::Candidate> HotKeySketch::Candidates() const {
+  std::vector<Candidate> candidates;
+  {
+    absl::MutexLock lock(&mutex_);
+    candidates.reserve(candidates_.size());
+    for (const auto& [key, candidate] : candidates_) {
+      candidates.push_back({
+          .key = key,
+          .prefix_id = candidate.prefix_id,
+          .estimated_lookups = int64_t{candidate.count} * sample_rate_,
+      });
+    }
+  }
+  std::sort(candidates.begin(), candidates.end(),
+            [](const Candidate& a, const Candidate& b) {
+              return std::tie(b.estimated_lookups, a.key) <
+                     std::tie(a.estimated_lookups, b.key);
+            });
+  return candidates;
+}
+
+}  // namespace kv_server
@@ -0,0 +1,108 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef COMPONENTS_DATA_SERVER_CACHE_HOT_KEY_SKETCH_H_
+#define COMPONENTS_DATA_SERVER_CACHE_HOT_KEY_SKETCH_H_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/synchronization/mutex.h"
+#include "components/data_server/cache/hashed_key.h"
+#include "components/data_server/cache/prefix_counters.h"
+
+namespace kv_server {
+
+// Estimates how often keys are looked up from a sample of the lookups, and
+// keeps the keys looked up the most as candidate hot keys.
+//
+// Lookups are sampled with a thread local random number generator, so that
+// lookups that are not sampled write no shared memory. Sampled lookups are
+// counted in a count-min sketch, and their key replaces the coldest candidate
+// if it is estimated to be looked up more. Counts are halved every
+// `samples_per_decay` samples, so that they reflect recent lookups.
+//
+// Thread safe.
+class HotKeySketch {
+ public:
+  struct Options {
+    // Counts one in `sample_rate` lookups, on average.
+    int32_t sample_rate = 64;
+    // Counters of every row of the sketch, rounded up to a power of two.
+    int64_t width = 4096;
+    int64_t max_candidates = 256;
+    // Defaults to 16 times `width`.
+    int64_t samples_per_decay = 0;
+  };
+
+  struct Candidate {
+    std::string key;
+    // Prefix of the entry of the key when it was last sampled.
+    PrefixCounters::Id prefix_id;
+    // Lookups since the counts were last halved, give or take the counts
+    // halved before.
+    int64_t estimated_lookups;
+  };
+
+  explicit HotKeySketch(Options options);
+  HotKeySketch(const HotKeySketch&) = delete;
+  HotKeySketch& operator=(const HotKeySketch&) = delete;
+
+  // Returns whether to count the current lookup.
+  bool Sample() const;
+
+  // Counts a sampled lookup of `key`, whose entry is of `prefix_id`.
+  void Add(const HashedKey& key, PrefixCounters::Id prefix_id)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Returns the candidates, hottest first.
+  std::vector<Candidate> Candidates() const ABSL_LOCKS_EXCLUDED(mutex_);
+
+ private:
+  static constexpr int kDepth = 4;
+
+  struct CandidateCount {
+    PrefixCounters::Id prefix_id;
+    uint32_t count;
+  };
+
+  std::atomic<uint32_t>& Counter(int row, size_t hash) const;
+  // Halves every count. Concurrent samples may be lost.
+  void Decay() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  const int32_t sample_rate_;
+  const int width_bits_;
+  const int64_t max_candidates_;
+  const int64_t samples_per_decay_;
+  // `kDepth` rows of `1 << width_bits_` counters.
+  const std::unique_ptr<std::atomic<uint32_t>[]> counters_;
+  std::atomic<int64_t> num_samples_ = 0;
+  // Count of the coldest candidate once there are `max_candidates_`, so that
+  // most samples do not take `mutex_`.
+  std::atomic<uint32_t> min_candidate_count_ = 0;
+  mutable absl::Mutex mutex_;
+  absl::flat_hash_map<std::string, CandidateCount> candidates_
+      ABSL_GUARDED_BY(mutex_);
+};
+
+}  // namespace kv_server
+
+#endif  // COMPONENTS_DATA_SERVER_CACHE_HOT_KEY_SKETCH_H_
@@ -0,0 +1,97 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/data_server/cache/hot_key_sketch.h"
+
+#include <string>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace kv_server {
+namespace {
+
+using testing::ElementsAre;
+using testing::Field;
+
+void AddLookups(HotKeySketch& sketch, std::string_view key, int num_lookups,
+                PrefixCounters::Id prefix_id = 0) {
+  for (int i = 0; i < num_lookups; i++) {
+    sketch.Add(HashedKey(key), prefix_id);
+  }
+}
+
+TEST(HotKeySketchTest, EstimatesLookupsOfHottestKeys) {
+  HotKeySketch sketch({.sample_rate = 1});
+  AddLookups(sketch, "hot", 100, /*prefix_id=*/1);
+  AddLookups(sketch, "warm", 10, /*prefix_id=*/2);
+  for (int i = 0; i < 100; i++) {
+    AddLookups(sketch, absl::StrCat("cold", i), 1);
+  }
+  const std::vector<HotKeySketch::Candidate> candidates = sketch.Candidates();
+  ASSERT_GE(candidates.size(), 2);
+  EXPECT_EQ(candidates[0].key, "hot");
+  EXPECT_EQ(candidates[0].prefix_id, 1);
+  EXPECT_EQ(candidates[0].estimated_lookups, 100);
+  EXPECT_EQ(candidates[1].key, "warm");
+  EXPECT_EQ(candidates[1].prefix_id, 2);
+  EXPECT_EQ(candidates[1].estimated_lookups, 10);
+}
+
+TEST(HotKeySketchTest, KeepsHottestCandidates) {
+  HotKeySketch sketch({.sample_rate = 1, .max_candidates = 2});
+  AddLookups(sketch, "a", 1);
+  AddLookups(sketch, "b", 5);
+  AddLookups(sketch, "c", 3);
+  AddLookups(sketch, "d", 2);
+  EXPECT_THAT(sketch.Candidates(),
+              ElementsAre(Field(&HotKeySketch::Candidate::key, "b"),
+                          Field(&HotKeySketch::Candidate::key, "c")));
+}
+
+TEST(HotKeySketchTest, ScalesCountsBySampleRate) {
+  HotKeySketch sketch({.sample_rate = 8});
+  AddLookups(sketch, "key", 3);
+  EXPECT_THAT(sketch.Candidates(),
+              ElementsAre(Field(&HotKeySketch::Candidate::estimated_lookups,
+                                24)));
+}
+
+TEST(HotKeySketchTest, HalvesCountsPeriodically) {
+  HotKeySketch sketch({.sample_rate = 1, .samples_per_decay = 10});
+  AddLookups(sketch, "old", 9);
+  // Decays on the tenth sample.
+  AddLookups(sketch, "new", 1);
+  AddLookups(sketch, "new", 6);
+  EXPECT_THAT(
+      sketch.Candidates(),
+      ElementsAre(Field(&HotKeySketch::Candidate::key, "new"),
+                  Field(&HotKeySketch::Candidate::key, "old")));
+  EXPECT_EQ(sketch.Candidates()[1].estimated_lookups, 4);
+}
+
+TEST(HotKeySketchTest, SamplesOneInSampleRateLookups) {
+  HotKeySketch sketch({.sample_rate = 10});
+  int num_sampled = 0;
+  for (int i = 0; i < 100000; i++) {
+    num_sampled += sketch.Sample();
+  }
+  EXPECT_GT(num_sampled, 9000);
+  EXPECT_LT(num_sampled, 11000);
+}
+
+}  // namespace
+}  // namespace kv_server
@@ -0,0 +1,228 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/data_server/cache/key_value_arena.h"
+
+#include <sys/mman.h>
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "absl/log/log.h"
+
+namespace kv_server {
+namespace {
+
+std::atomic<bool> use_huge_pages_by_default = false;
+
+// Each record is laid out as [key size][value size][key][value], sizes are
+// unaligned 32 bit integers.
+struct RecordHeader {
+  uint32_t key_size;
+  uint32_t value_size;
+};
+
+RecordHeader ReadHeader(std::string_view key) {
+  RecordHeader header;
+  std::memcpy(&header, key.data() - sizeof(RecordHeader), sizeof(header));
+  return header;
+}
+
+size_t RecordSize(const RecordHeader& header) {
+  return sizeof(RecordHeader) + header.key_size + header.value_size;
+}
+
+size_t RoundUpToHugePages(size_t size) {
+  return (size + KeyValueArena::kHugePageSize - 1) /
+         KeyValueArena::kHugePageSize * KeyValueArena::kHugePageSize;
+}
+
+// Maps `size` bytes, a multiple of the huge page size, at a huge page boundary
+// and advises the kernel to back them with huge pages. Returns null if the
+// memory cannot be mapped.
+char* MapHugePages(size_t size) {
+  // Mappings are only page aligned, so an extra huge page is mapped and the
+  // unaligned ends are unmapped again.
+  const size_t mapped_size = size + KeyValueArena::kHugePageSize;
+  void* mapped = mmap(nullptr, mapped_size, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (mapped == MAP_FAILED) {
+    PLOG_FIRST_N(WARNING, 1) << "Failed to map arena slab, falling back to "
+                                "regular allocations";
+    return nullptr;
+  }
+  const uintptr_t start = reinterpret_cast<uintptr_t>(mapped);
+  const uintptr_t aligned_start = RoundUpToHugePages(start);
+  if (aligned_start > start) {
+    munmap(mapped, aligned_start - start);
+  }
+  if (const size_t tail = start + mapped_size - (aligned_start + size);
+      tail > 0) {
+    munmap(reinterpret_cast<void*>(aligned_start + size), tail);
+  }
+  char* data = reinterpret_cast<char*>(aligned_start);
+  if (madvise(data, size, MADV_HUGEPAGE) != 0) {
+    // E.g. if transparent huge pages are disabled, the slab still works with
+    // regular pages.
+    PLOG_FIRST_N(WARNING, 1)
+        << "Transparent huge pages are not available for arena slabs";
+  }
+  return data;
+}
+
+}  // namespace
+
+KeyValueArena::Slab::Slab(size_t capacity, bool use_huge_pages)
+    : data(nullptr), capacity(capacity) {
+  if (use_huge_pages) {
+    data = MapHugePages(capacity);
+    mapped = data != nullptr;
+  }
+  if (data == nullptr) {
+    data = new char[capacity];
+  }
+}
+
+KeyValueArena::Slab::~Slab() {
+  if (mapped) {
+    munmap(data, capacity);
+  } else {
+    delete[] data;
+  }
+}
+
+KeyValueArena::KeyValueArena(size_t slab_size, bool use_huge_pages)
+    : slab_size_(use_huge_pages ? RoundUpToHugePages(slab_size) : slab_size),
+      use_huge_pages_(use_huge_pages) {}
+
+void KeyValueArena::EnableHugePages(bool enable) {
+  use_huge_pages_by_default.store(enable, std::memory_order_relaxed);
+}
+
+bool KeyValueArena::huge_pages_enabled() {
+  return use_huge_pages_by_default.load(std::memory_order_relaxed);
+}
+
+KeyValueArena::Entry KeyValueArena::Add(std::string_view key,
+                                        std::string_view value) {
+  const RecordHeader header{
+      .key_size = static_cast<uint32_t>(key.size()),
+      .value_size = static_cast<uint32_t>(value.size()),
+  };
+  const size_t record_size = RecordSize(header);
+  const uint32_t slab_id = SlabFor(record_size);
+  Slab& slab = *slabs_[slab_id];
+  char* record = slab.data + slab.used;
+  std::memcpy(record, &header, sizeof(header));
+  std::memcpy(record + sizeof(header), key.data(), key.size());
+  std::memcpy(record + sizeof(header) + key.size(), value.data(), value.size());
+  slab.used += record_size;
+  slab.live_bytes += record_size;
+  live_bytes_ += record_size;
+  return {.key = std::string_view(record + sizeof(header), key.size()),
+          .slab_id = slab_id};
+}
+
+std::string_view KeyValueArena::ValueOf(std::string_view key) {
+  return std::string_view(key.data() + key.size(),
+                          ReadHeader(key).value_size);
+}
+
+void KeyValueArena::Remove(const Entry& entry) {
+  const size_t record_size = RecordSize(ReadHeader(entry.key));
+  Slab& slab = *slabs_[entry.slab_id];
+  slab.live_bytes -= record_size;
+  live_bytes_ -= record_size;
+  if (slab.live_bytes == 0 && entry.slab_id != current_slab_id_) {
+    FreeSlab(entry.slab_id);
+  }
+}
+
+std::shared_ptr<const void> KeyValueArena::Pin(uint32_t slab_id) const {
+  return slabs_[slab_id];
+}
+
+std::vector<uint32_t> KeyValueArena::SparseSlabs(
+    double max_live_fraction) const {
+  std::vector<uint32_t> slab_ids;
+  for (uint32_t slab_id = 0; slab_id < slabs_.size(); slab_id++) {
+    if (slabs_[slab_id] == nullptr || slab_id == current_slab_id_) {
+      continue;
+    }
+    if (slabs_[slab_id]->live_bytes <
+        max_live_fraction * slabs_[slab_id]->capacity) {
+      slab_ids.push_back(slab_id);
+    }
+  }
+  return slab_ids;
+}
+
+void KeyValueArena::ForEachRecord(
+    uint32_t slab_id, absl::FunctionRef<void(const Entry&)> fn) const {
+  // Keeps the slab alive in case `fn` removes its last live record.
+  std::shared_ptr<const Slab> slab = slabs_[slab_id];
+  size_t offset = 0;
+  while (offset < slab->used) {
+    const char* key_data = slab->data + offset + sizeof(RecordHeader);
+    const RecordHeader header = ReadHeader(std::string_view(key_data, 0));
+    fn({.key = std::string_view(key_data, header.key_size),
+        .slab_id = slab_id});
+    offset += RecordSize(header);
+  }
+}
+
+uint32_t KeyValueArena::SlabFor(size_t size) {
+  if (size > slab_size_) {
+    // Oversized records get a slab of their own, which is never appended to.
+    return NewSlab(size);
+  }
+  if (!current_slab_id_.has_value() ||
+      slabs_[*current_slab_id_]->capacity - slabs_[*current_slab_id_]->used <
+          size) {
+    if (current_slab_id_.has_value() &&
+        slabs_[*current_slab_id_]->live_bytes == 0) {
+      FreeSlab(*current_slab_id_);
+    }
+    current_slab_id_ = NewSlab(slab_size_);
+  }
+  return *current_slab_id_;
+}
+
+uint32_t KeyValueArena::NewSlab(size_t capacity) {
+  // Oversized records would waste most of a huge page.
+  auto slab = std::make_shared<Slab>(
+      capacity, use_huge_pages_ && capacity == slab_size_);
+  allocated_bytes_ += capacity;
+  if (free_slab_ids_.empty()) {
+    slabs_.push_back(std::move(slab));
+    return slabs_.size() - 1;
+  }
+  const uint32_t slab_id = free_slab_ids_.back();
+  free_slab_ids_.pop_back();
+  slabs_[slab_id] = std::move(slab);
+  return slab_id;
+}
+
+void KeyValueArena::FreeSlab(uint32_t slab_id) {
+  allocated_bytes_ -= slabs_[slab_id]->capacity;
+  slabs_[slab_id] = nullptr;
+  free_slab_ids_.push_back(slab_id);
+}
+
+}  // namespace kv_server
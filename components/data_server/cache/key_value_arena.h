@@ -0,0 +1,135 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef COMPONENTS_DATA_SERVER_CACHE_KEY_VALUE_ARENA_H_
+#define COMPONENTS_DATA_SERVER_CACHE_KEY_VALUE_ARENA_H_
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+#include "absl/functional/function_ref.h"
+
+namespace kv_server {
+
+// Append-only slab storage for the keys and values of a cache.
+//
+// Each key-value pair is copied into one record of a fixed size slab, so an
+// entry costs a single small header instead of one or two heap allocations.
+// Records are never modified once written. Removing a record only marks its
+// bytes dead, a slab is freed once none of its records are live and sparse
+// slabs can be compacted by re-adding their live records (see
+// `SparseSlabs` and `ForEachRecord`).
+//
+// Slabs are reference counted, so views of a record stay valid for as long as
+// the slab is pinned, even after the record was removed or compacted away.
+//
+// Slabs can be backed by transparent huge pages, which saves TLB misses on
+// random lookups in large caches (see `EnableHugePages`).
+//
+// Not thread safe, callers synchronize access.
+class KeyValueArena {
+ public:
+  static constexpr size_t kDefaultSlabSize = 1 << 20;
+  static constexpr size_t kHugePageSize = 2 << 20;
+
+  // A stored record.
+  struct Entry {
+    // View of the stored copy of the key. The value is stored right after it,
+    // see `ValueOf`.
+    std::string_view key;
+    uint32_t slab_id;
+  };
+
+  // If `use_huge_pages` is true, `slab_size` is rounded up to a multiple of
+  // `kHugePageSize` and slabs are mapped on huge page boundaries and advised
+  // to be backed by huge pages. Slabs fall back to regular allocations if they
+  // cannot be mapped, and to regular pages if the kernel does not allow huge
+  // pages.
+  explicit KeyValueArena(size_t slab_size = kDefaultSlabSize,
+                         bool use_huge_pages = huge_pages_enabled());
+  KeyValueArena(const KeyValueArena&) = delete;
+  KeyValueArena& operator=(const KeyValueArena&) = delete;
+
+  // Copies `key` and `value` into the arena. `key` and `value` may point into
+  // the arena themselves.
+  Entry Add(std::string_view key, std::string_view value);
+
+  // Returns the value stored with `key`, which must be the key of an entry
+  // returned by `Add`.
+  static std::string_view ValueOf(std::string_view key);
+
+  // Marks the record of `entry` dead. Frees its slab once it has no live
+  // records left, unless it is the slab currently being filled.
+  void Remove(const Entry& entry);
+
+  // Returns an owner keeping the memory of `slab_id` alive.
+  std::shared_ptr<const void> Pin(uint32_t slab_id) const;
+
+  // Returns the ids of full slabs whose live bytes are below
+  // `max_live_fraction` of their size.
+  std::vector<uint32_t> SparseSlabs(double max_live_fraction) const;
+
+  // Calls `fn` with every record of `slab_id`, live or dead, in the order
+  // they were added. `fn` may add and remove records.
+  void ForEachRecord(uint32_t slab_id,
+                     absl::FunctionRef<void(const Entry&)> fn) const;
+
+  // Bytes allocated for slabs.
+  size_t allocated_bytes() const { return allocated_bytes_; }
+  // Bytes of records that were added but not removed, including headers.
+  size_t live_bytes() const { return live_bytes_; }
+  size_t num_slabs() const { return slabs_.size() - free_slab_ids_.size(); }
+
+  // Sets whether arenas created afterwards use huge pages by default.
+  static void EnableHugePages(bool enable);
+  static bool huge_pages_enabled();
+
+ private:
+  struct Slab {
+    Slab(size_t capacity, bool use_huge_pages);
+    ~Slab();
+    Slab(const Slab&) = delete;
+    Slab& operator=(const Slab&) = delete;
+    char* data;
+    const size_t capacity;
+    // Whether `data` is mapped rather than allocated with `new`.
+    bool mapped = false;
+    size_t used = 0;
+    size_t live_bytes = 0;
+  };
+
+  // Returns the id of a slab with at least `size` free bytes.
+  uint32_t SlabFor(size_t size);
+  uint32_t NewSlab(size_t capacity);
+  void FreeSlab(uint32_t slab_id);
+
+  const size_t slab_size_;
+  const bool use_huge_pages_;
+  // Indexed by slab id, null for freed slabs whose id is in `free_slab_ids_`.
+  std::vector<std::shared_ptr<Slab>> slabs_;
+  std::vector<uint32_t> free_slab_ids_;
+  // Slab that new records are appended to, if any.
+  std::optional<uint32_t> current_slab_id_;
+  size_t allocated_bytes_ = 0;
+  size_t live_bytes_ = 0;
+};
+
+}  // namespace kv_server
+
+#endif  // COMPONENTS_DATA_SERVER_CACHE_KEY_VALUE_ARENA_H_
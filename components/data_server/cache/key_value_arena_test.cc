@@ -0,0 +1,164 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/data_server/cache/key_value_arena.h"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace kv_server {
+namespace {
+
+using testing::ElementsAre;
+using testing::IsEmpty;
+
+TEST(KeyValueArenaTest, AddStoresCopiesOfKeyAndValue) {
+  KeyValueArena arena(/*slab_size=*/64);
+  std::string key = "key";
+  std::string value = "value";
+  auto entry = arena.Add(key, value);
+  key[0] = 'x';
+  value[0] = 'x';
+  EXPECT_EQ(entry.key, "key");
+  EXPECT_EQ(KeyValueArena::ValueOf(entry.key), "value");
+  EXPECT_EQ(arena.num_slabs(), 1);
+  EXPECT_EQ(arena.allocated_bytes(), 64);
+}
+
+TEST(KeyValueArenaTest, AddStartsNewSlabWhenFull) {
+  KeyValueArena arena(/*slab_size=*/32);
+  auto entry1 = arena.Add("key1", "value1");
+  auto entry2 = arena.Add("key2", "value2");
+  EXPECT_NE(entry1.slab_id, entry2.slab_id);
+  EXPECT_EQ(KeyValueArena::ValueOf(entry1.key), "value1");
+  EXPECT_EQ(KeyValueArena::ValueOf(entry2.key), "value2");
+  EXPECT_EQ(arena.num_slabs(), 2);
+}
+
+TEST(KeyValueArenaTest, OversizedRecordGetsOwnSlab) {
+  KeyValueArena arena(/*slab_size=*/32);
+  const std::string value(100, 'v');
+  auto small = arena.Add("key1", "value1");
+  auto large = arena.Add("key2", value);
+  auto next = arena.Add("key3", "v");
+  EXPECT_NE(small.slab_id, large.slab_id);
+  EXPECT_EQ(small.slab_id, next.slab_id);
+  EXPECT_EQ(KeyValueArena::ValueOf(large.key), value);
+  arena.Remove(large);
+  EXPECT_EQ(arena.num_slabs(), 1);
+}
+
+TEST(KeyValueArenaTest, RemoveFreesSlabWithoutLiveRecords) {
+  KeyValueArena arena(/*slab_size=*/32);
+  auto entry1 = arena.Add("key1", "value1");
+  auto entry2 = arena.Add("key2", "value2");
+  const size_t live_bytes = arena.live_bytes();
+  arena.Remove(entry1);
+  EXPECT_LT(arena.live_bytes(), live_bytes);
+  EXPECT_EQ(arena.num_slabs(), 1);
+  // The current slab is kept for new records.
+  arena.Remove(entry2);
+  EXPECT_EQ(arena.num_slabs(), 1);
+  EXPECT_EQ(arena.live_bytes(), 0);
+}
+
+TEST(KeyValueArenaTest, PinnedSlabOutlivesRemove) {
+  KeyValueArena arena(/*slab_size=*/32);
+  auto entry = arena.Add("key1", "value1");
+  arena.Add("key2", "value2");
+  auto pin = arena.Pin(entry.slab_id);
+  arena.Remove(entry);
+  EXPECT_EQ(arena.num_slabs(), 1);
+  EXPECT_EQ(KeyValueArena::ValueOf(entry.key), "value1");
+}
+
+TEST(KeyValueArenaTest, FreedSlabIdsAreReused) {
+  KeyValueArena arena(/*slab_size=*/32);
+  auto entry = arena.Add("key1", "value1");
+  arena.Add("key2", "value2");
+  arena.Remove(entry);
+  EXPECT_EQ(arena.Add("key3", "value3").slab_id, entry.slab_id);
+}
+
+TEST(KeyValueArenaTest, SparseSlabsSkipsCurrentSlab) {
+  KeyValueArena arena(/*slab_size=*/64);
+  auto entry1 = arena.Add("key1", "value1");
+  auto entry2 = arena.Add("key2", "value2");
+  arena.Add("key3", "value3");
+  auto entry4 = arena.Add("key4", "value4");
+  EXPECT_THAT(arena.SparseSlabs(0.5), IsEmpty());
+  // Leaves 18 of the 64 bytes of the first slab live.
+  arena.Remove(entry1);
+  arena.Remove(entry2);
+  EXPECT_THAT(arena.SparseSlabs(0.5), ElementsAre(entry1.slab_id));
+  EXPECT_THAT(arena.SparseSlabs(0.1), IsEmpty());
+  EXPECT_NE(entry4.slab_id, entry1.slab_id);
+}
+
+TEST(KeyValueArenaTest, ForEachRecordVisitsRecordsInOrder) {
+  KeyValueArena arena(/*slab_size=*/64);
+  auto entry = arena.Add("key1", "value1");
+  arena.Add("key2", "");
+  arena.Remove(entry);
+  std::vector<std::pair<std::string, std::string>> records;
+  arena.ForEachRecord(entry.slab_id, [&records](const auto& record) {
+    records.emplace_back(record.key, KeyValueArena::ValueOf(record.key));
+  });
+  EXPECT_THAT(records, ElementsAre(std::pair<std::string, std::string>(
+                                       "key1", "value1"),
+                                   std::pair<std::string, std::string>(
+                                       "key2", "")));
+}
+
+TEST(KeyValueArenaTest, ForEachRecordCanMoveRecords) {
+  KeyValueArena arena(/*slab_size=*/32);
+  auto entry1 = arena.Add("key1", "value1");
+  arena.Add("key2", "value2");
+  std::vector<KeyValueArena::Entry> moved;
+  arena.ForEachRecord(entry1.slab_id, [&arena, &moved](const auto& record) {
+    moved.push_back(
+        arena.Add(record.key, KeyValueArena::ValueOf(record.key)));
+    arena.Remove(record);
+  });
+  ASSERT_EQ(moved.size(), 1);
+  EXPECT_EQ(moved[0].key, "key1");
+  EXPECT_EQ(KeyValueArena::ValueOf(moved[0].key), "value1");
+  EXPECT_EQ(arena.num_slabs(), 2);
+}
+
+TEST(KeyValueArenaTest, HugePageSlabsAreAligned) {
+  KeyValueArena arena(/*slab_size=*/64, /*use_huge_pages=*/true);
+  const std::string value(100, 'v');
+  auto entry1 = arena.Add("key1", "value1");
+  auto entry2 = arena.Add("key2", value);
+  EXPECT_EQ(entry1.slab_id, entry2.slab_id);
+  EXPECT_EQ(KeyValueArena::ValueOf(entry2.key), value);
+  EXPECT_EQ(arena.allocated_bytes(), KeyValueArena::kHugePageSize);
+  // Records are appended to the slab from its start.
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(entry1.key.data()) %
+                KeyValueArena::kHugePageSize,
+            2 * sizeof(uint32_t));
+  arena.Remove(entry1);
+  arena.Remove(entry2);
+  EXPECT_EQ(arena.live_bytes(), 0);
+}
+
+}  // namespace
+}  // namespace kv_server
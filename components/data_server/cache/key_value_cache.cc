@@ -14,18 +14,226 @@
 #include "components/data_server/cache/key_value_cache.h"
 
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <limits>
 #include <memory>
+#include <optional>
+#include <string>
 #include <string_view>
+#include <thread>
+#include <utility>
 #include <vector>
 
 #include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
 #include "absl/log/log.h"
-#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
 #include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
 #include "components/data_server/cache/cache.h"
+#include "components/data_server/cache/checkpoint_io.h"
+#include "components/data_server/cache/cold_value_log.h"
+#include "components/data_server/cache/get_key_value_result.h"
 #include "components/data_server/cache/get_key_value_set_result.h"
+#include "components/data_server/cache/key_value_arena.h"
+#include "components/data_server/cache/precomputed_json_value.h"
+#include "components/data_server/cache/value_compressor.h"
+#include "components/data_server/cache/value_interner.h"
+#include "components/data_server/cache/value_set_snapshot.h"
+#include "components/query/roaring_bitmap.h"
+#include "components/util/lock_profiler.h"
 
 namespace kv_server {
+namespace {
+
+// Arena slabs with less than this fraction of live bytes are compacted on
+// cleanup. Bounds the memory held by dead records to about the live size.
+constexpr double kMaxLiveFractionToCompact = 0.5;
+
+// Number of deleted keys or set values removed between two checks of the
+// deadline of a cleanup slice.
+constexpr int64_t kRemovalsPerDeadlineCheck = 64;
+
+// Identifies the checkpoints written by `KeyValueCache`.
+constexpr char kCheckpointType[] = "KeyValueCache";
+
+void WriteCleanupTimes(
+    const absl::flat_hash_map<std::string, int64_t>& cleanup_times,
+    CheckpointWriter& writer) {
+  writer.WriteInt64(cleanup_times.size());
+  for (const auto& [prefix, logical_commit_time] : cleanup_times) {
+    writer.WriteString(prefix);
+    writer.WriteInt64(logical_commit_time);
+  }
+}
+
+absl::Status InvalidCheckpointError() {
+  return absl::DataLossError("Invalid key value cache checkpoint.");
+}
+
+// Reads a value of a set of 32-bit unsigned integers, which checkpoints hold
+// as an int64.
+bool ReadUInt32SetValue(CheckpointReader& reader, uint32_t* value) {
+  int64_t int64_value;
+  if (!reader.ReadInt64(&int64_value) || int64_value < 0 ||
+      int64_value > std::numeric_limits<uint32_t>::max()) {
+    return false;
+  }
+  *value = static_cast<uint32_t>(int64_value);
+  return true;
+}
+
+// Number of keys that the buckets of a lookup are prefetched ahead of. Large
+// maps take a cache miss per key looked up, prefetching lets the misses of
+// consecutive keys overlap.
+constexpr int kLookupPrefetchDistance = 8;
+
+// Looks up `keys` in `map` in order, prefetching the buckets of the keys that
+// come next.
+template <typename Map>
+class PrefetchingLookup {
+ public:
+  PrefetchingLookup(const Map& map, absl::Span<const HashedKey> keys)
+      : map_(map), next_(keys.begin()), end_(keys.end()) {
+    for (int i = 0; i < kLookupPrefetchDistance && next_ != end_; i++) {
+      map_.prefetch(*next_++);
+    }
+  }
+
+  // Returns the result of looking up `key`, the next key of `keys`.
+  typename Map::const_iterator Find(const HashedKey& key) {
+    if (next_ != end_) {
+      map_.prefetch(*next_++);
+    }
+    return map_.find(key);
+  }
+
+ private:
+  const Map& map_;
+  absl::Span<const HashedKey>::const_iterator next_;
+  const absl::Span<const HashedKey>::const_iterator end_;
+};
+
+// Tags of the values of the arena of a deduplicating or spilling cache,
+// followed by the stored value, by its id in the value store or by its
+// location in the cold value log.
+constexpr char kInlineValue = 0;
+constexpr char kValueId = 1;
+constexpr char kColdValue = 2;
+
+// Values shorter than this are stored inline, the bookkeeping of the value
+// store takes more memory than sharing them saves.
+constexpr size_t kMinDeduplicatedValueSize = 64;
+
+bool HoldsValueId(std::string_view arena_value) {
+  return !arena_value.empty() && arena_value.front() == kValueId;
+}
+
+uint32_t ValueIdOf(std::string_view arena_value) {
+  uint32_t id;
+  std::memcpy(&id, arena_value.data() + 1, sizeof(id));
+  return id;
+}
+
+bool HoldsColdValue(std::string_view arena_value) {
+  return !arena_value.empty() && arena_value.front() == kColdValue;
+}
+
+ColdValueLog::Location ColdValueLocationOf(std::string_view arena_value) {
+  ColdValueLog::Location location;
+  std::memcpy(&location.offset, arena_value.data() + 1,
+              sizeof(location.offset));
+  std::memcpy(&location.size,
+              arena_value.data() + 1 + sizeof(location.offset),
+              sizeof(location.size));
+  return location;
+}
+
+std::string_view ColdArenaValue(ColdValueLog::Location location,
+                                std::string& buffer) {
+  buffer.clear();
+  buffer.push_back(kColdValue);
+  buffer.append(reinterpret_cast<const char*>(&location.offset),
+                sizeof(location.offset));
+  buffer.append(reinterpret_cast<const char*>(&location.size),
+                sizeof(location.size));
+  return buffer;
+}
+
+// Returns whether `arena_value` is held in memory and large enough to be
+// spilled into the cold value log.
+bool IsSpillable(std::string_view arena_value, size_t min_cold_value_size) {
+  return !arena_value.empty() && arena_value.front() == kInlineValue &&
+         arena_value.size() > min_cold_value_size;
+}
+
+// The value options of a cache as constants. The value lookups instantiated
+// with a policy only hold the code of the options it has.
+template <bool IsDeduplicated, bool IsCold, bool IsCompressed,
+          bool IsPrecomputedJson>
+struct ValuePolicy {
+  static constexpr bool kDeduplicated = IsDeduplicated;
+  static constexpr bool kCold = IsCold;
+  static constexpr bool kCompressed = IsCompressed;
+  static constexpr bool kPrecomputedJson = IsPrecomputedJson;
+  // Whether records of the arena tag their values, see `TagsValues`.
+  static constexpr bool kTagged = IsDeduplicated || IsCold;
+};
+
+// Calls `fn` with the `ValuePolicy` of `options`, in the order of the
+// parameters of `ValuePolicy`, instantiating `fn` for every combination.
+template <bool... kOptions, typename Fn>
+void DispatchValuePolicy(Fn& fn) {
+  fn(ValuePolicy<kOptions...>());
+}
+template <bool... kOptions, typename Fn, typename... Options>
+void DispatchValuePolicy(Fn& fn, bool option, Options... options) {
+  if (option) {
+    DispatchValuePolicy<kOptions..., true>(fn, options...);
+  } else {
+    DispatchValuePolicy<kOptions..., false>(fn, options...);
+  }
+}
+
+}  // namespace
+
+KeyValueCache::KeyValueCache(std::shared_ptr<ValueInterner> value_interner,
+                             bool precompute_json_values,
+                             std::shared_ptr<ValueCompressor> value_compressor,
+                             std::shared_ptr<ValueInterner> value_store,
+                             std::shared_ptr<ColdValueLog> cold_value_log)
+    : precompute_json_values_(precompute_json_values),
+      value_interner_(std::move(value_interner)),
+      value_compressor_(std::move(value_compressor)),
+      value_store_(std::move(value_store)),
+      cold_value_log_(std::move(cold_value_log)) {}
+
+KeyValueCache::~KeyValueCache() {
+  if (cleanup_closure_ != nullptr) {
+    cleanup_closure_->Stop();
+  }
+  // The value store and the cold value log may be shared and outlive this
+  // cache too. A log that is not reclaims all its space when it is destroyed.
+  if (value_store_ != nullptr ||
+      (cold_value_log_ != nullptr && cold_value_log_.use_count() > 1)) {
+    for (const auto& [key, cache_value] : map_) {
+      ReleaseArenaValue(KeyValueArena::ValueOf(key));
+    }
+  }
+  if (value_interner_ == nullptr) {
+    return;
+  }
+  // The interner may be shared and outlive this cache.
+  for (const auto& [key, value_set] : key_to_value_set_map_) {
+    value_set.ForEach([this](std::string_view value, const SetValueMeta&) {
+      value_interner_->Release(*value_interner_->Find(value));
+    });
+  }
+}
 
 absl::flat_hash_map<std::string, std::string> KeyValueCache::GetKeyValuePairs(
     const RequestContext& request_context,
@@ -34,17 +242,7 @@ absl::flat_hash_map<std::string, std::string> KeyValueCache::GetKeyValuePairs(
                               kGetValuePairsLatencyInMicros>
       latency_recorder(request_context.GetInternalLookupMetricsContext());
   absl::flat_hash_map<std::string, std::string> kv_pairs;
-  absl::ReaderMutexLock lock(&mutex_);
-  for (std::string_view key : key_set) {
-    const auto key_iter = map_.find(key);
-    if (key_iter == map_.end() || key_iter->second.value == nullptr) {
-      continue;
-    } else {
-      VLOG(9) << "Get called for " << key
-              << ". returning value: " << *(key_iter->second.value);
-      kv_pairs.insert_or_assign(key, *(key_iter->second.value));
-    }
-  }
+  CollectKeyValuePairs(HashKeys(key_set), kv_pairs);
   if (kv_pairs.empty()) {
     LogCacheAccessMetrics(request_context, kKeyValueCacheMiss);
   } else {
@@ -53,51 +251,571 @@ absl::flat_hash_map<std::string, std::string> KeyValueCache::GetKeyValuePairs(
   return kv_pairs;
 }
 
+std::unique_ptr<GetKeyValueResult> KeyValueCache::GetKeyValues(
+    const RequestContext& request_context,
+    const absl::flat_hash_set<std::string_view>& key_set) const {
+  ScopeLatencyMetricsRecorder<InternalLookupMetricsContext,
+                              kGetValuePairsLatencyInMicros>
+      latency_recorder(request_context.GetInternalLookupMetricsContext());
+  auto result = GetKeyValueResult::Create();
+  CollectKeyValues(HashKeys(key_set), *result);
+  if (result->size() == 0) {
+    LogCacheAccessMetrics(request_context, kKeyValueCacheMiss);
+  } else {
+    LogCacheAccessMetrics(request_context, kKeyValueCacheHit);
+  }
+  return result;
+}
+
 std::unique_ptr<GetKeyValueSetResult> KeyValueCache::GetKeyValueSet(
     const RequestContext& request_context,
     const absl::flat_hash_set<std::string_view>& key_set) const {
   ScopeLatencyMetricsRecorder<InternalLookupMetricsContext,
                               kGetKeyValueSetLatencyInMicros>
       latency_recorder(request_context.GetInternalLookupMetricsContext());
-  // lock the cache map
-  absl::ReaderMutexLock lock(&set_map_mutex_);
   auto result = GetKeyValueSetResult::Create();
+  if (CollectKeyValueSets(HashKeys(key_set), *result)) {
+    LogCacheAccessMetrics(request_context, kKeyValueSetCacheHit);
+  } else {
+    LogCacheAccessMetrics(request_context, kKeyValueSetCacheMiss);
+  }
+  return result;
+}
+
+std::unique_ptr<GetUInt32ValueSetResult> KeyValueCache::GetUInt32ValueSet(
+    const RequestContext& request_context,
+    const absl::flat_hash_set<std::string_view>& key_set) const {
+  ScopeLatencyMetricsRecorder<InternalLookupMetricsContext,
+                              kGetKeyValueSetLatencyInMicros>
+      latency_recorder(request_context.GetInternalLookupMetricsContext());
+  auto result = GetUInt32ValueSetResult::Create();
+  if (CollectUInt32ValueSets(HashKeys(key_set), *result)) {
+    LogCacheAccessMetrics(request_context, kKeyValueSetCacheHit);
+  } else {
+    LogCacheAccessMetrics(request_context, kKeyValueSetCacheMiss);
+  }
+  return result;
+}
+
+template <typename Fn>
+void KeyValueCache::WithValuePolicy(Fn&& fn) const {
+  DispatchValuePolicy(fn, value_store_ != nullptr, cold_value_log_ != nullptr,
+                      value_compressor_ != nullptr, precompute_json_values_);
+}
+
+template <typename Policy>
+std::string_view KeyValueCache::ValueOf(std::string_view key,
+                                        std::string& buffer,
+                                        ColdValues* cold_values) const {
+  const std::string_view stored_value =
+      UncompressedValueOf<Policy>(key, buffer, cold_values);
+  if constexpr (Policy::kPrecomputedJson) {
+    return SplitPrecomputedJsonValue(stored_value).value;
+  } else {
+    return stored_value;
+  }
+}
+
+template <typename Policy>
+std::string_view KeyValueCache::UncompressedValueOf(
+    std::string_view key, std::string& buffer, ColdValues* cold_values) const {
+  if constexpr (Policy::kCompressed) {
+    return UncompressedValueOf(key, buffer, cold_values);
+  } else {
+    return StoredValueOf<Policy>(key, buffer, cold_values);
+  }
+}
+
+template <typename Policy>
+std::string_view KeyValueCache::StoredValueOf(std::string_view key,
+                                              std::string& buffer,
+                                              ColdValues* cold_values) const {
+  if constexpr (Policy::kTagged) {
+    return StoredValueOf(key, buffer, cold_values);
+  } else {
+    return KeyValueArena::ValueOf(key);
+  }
+}
+
+template <typename Policy>
+std::shared_ptr<const void> KeyValueCache::PinStoredValue(
+    std::string_view key, uint32_t slab_id) const {
+  if constexpr (Policy::kDeduplicated) {
+    return PinStoredValue(key, slab_id);
+  } else {
+    return arena_.Pin(slab_id);
+  }
+}
+
+void KeyValueCache::CollectKeyValuePairs(
+    absl::Span<const HashedKey> keys,
+    absl::flat_hash_map<std::string, std::string>& kv_pairs) const {
+  WithValuePolicy([&](auto policy) {
+    CollectKeyValuePairs<decltype(policy)>(keys, kv_pairs);
+  });
+}
+
+template <typename Policy>
+void KeyValueCache::CollectKeyValuePairs(
+    absl::Span<const HashedKey> keys,
+    absl::flat_hash_map<std::string, std::string>& kv_pairs) const {
+  ProfiledReaderMutexLock lock(&mutex_, LockSite::kCacheKeyMap);
+  ColdValues cold_values;
+  if constexpr (Policy::kCold) {
+    cold_values = ReadColdValues(keys);
+  }
+  std::string buffer;
+  HotKeySketch* hot_key_sketch =
+      hot_key_sketch_.load(std::memory_order_acquire);
+  PrefetchingLookup lookup(map_, keys);
+  for (const HashedKey& hashed_key : keys) {
+    const std::string_view key = hashed_key.key;
+    const auto key_iter = lookup.Find(hashed_key);
+    if (key_iter == map_.end() || key_iter->second.is_deleted) {
+      continue;
+    } else {
+      if constexpr (Policy::kCold) {
+        key_iter->second.lookups.Add();
+      }
+      if (hot_key_sketch != nullptr && hot_key_sketch->Sample()) {
+        hot_key_sketch->Add(hashed_key, key_iter->second.prefix_id);
+      }
+      std::string_view value =
+          ValueOf<Policy>(key_iter->first, buffer, &cold_values);
+      VLOG(9) << "Get called for " << key << ". returning value: " << value;
+      kv_pairs.insert_or_assign(key, value);
+    }
+  }
+}
+
+void KeyValueCache::CollectKeyValues(absl::Span<const HashedKey> keys,
+                                     GetKeyValueResult& result) const {
+  WithValuePolicy([&](auto policy) {
+    CollectKeyValues<decltype(policy)>(keys, result);
+  });
+}
+
+template <typename Policy>
+void KeyValueCache::CollectKeyValues(absl::Span<const HashedKey> keys,
+                                     GetKeyValueResult& result) const {
+  ProfiledReaderMutexLock lock(&mutex_, LockSite::kCacheKeyMap);
+  ColdValues cold_values;
+  if constexpr (Policy::kCold) {
+    cold_values = ReadColdValues(keys);
+  }
+  HotKeySketch* hot_key_sketch =
+      hot_key_sketch_.load(std::memory_order_acquire);
+  PrefetchingLookup lookup(map_, keys);
+  for (const HashedKey& hashed_key : keys) {
+    const std::string_view key = hashed_key.key;
+    const auto key_iter = lookup.Find(hashed_key);
+    if (key_iter == map_.end() || key_iter->second.is_deleted) {
+      continue;
+    }
+    if (hot_key_sketch != nullptr && hot_key_sketch->Sample()) {
+      hot_key_sketch->Add(hashed_key, key_iter->second.prefix_id);
+    }
+    std::string_view stored_value;
+    std::shared_ptr<const void> value_owner;
+    if constexpr (Policy::kCompressed || Policy::kCold) {
+      if constexpr (Policy::kCold) {
+        key_iter->second.lookups.Add();
+      }
+      // Decompressed and cold values are owned by the result, other values
+      // are still views into the cache.
+      auto buffer = std::make_shared<std::string>();
+      stored_value =
+          UncompressedValueOf<Policy>(key_iter->first, *buffer, &cold_values);
+      if (stored_value.data() == buffer->data()) {
+        value_owner = std::move(buffer);
+      }
+    } else {
+      std::string unused_buffer;
+      stored_value =
+          StoredValueOf<Policy>(key_iter->first, unused_buffer, nullptr);
+    }
+    if (value_owner == nullptr) {
+      value_owner =
+          PinStoredValue<Policy>(key_iter->first, key_iter->second.slab_id);
+    }
+    if constexpr (Policy::kPrecomputedJson) {
+      const PrecomputedJsonValue value =
+          SplitPrecomputedJsonValue(stored_value);
+      result.AddKeyValue(key, value.value, std::move(value_owner),
+                         value.serialized_json);
+    } else {
+      result.AddKeyValue(key, stored_value, std::move(value_owner),
+                         /*serialized_json=*/std::nullopt);
+    }
+  }
+}
+
+std::vector<int64_t> KeyValueCache::LastUpdateTimes(
+    absl::Span<const HashedKey> keys) const {
+  std::vector<int64_t> times;
+  times.reserve(keys.size());
+  ProfiledReaderMutexLock lock(&mutex_, LockSite::kCacheKeyMap);
+  PrefetchingLookup lookup(map_, keys);
+  for (const HashedKey& key : keys) {
+    const auto key_iter = lookup.Find(key);
+    times.push_back(key_iter == map_.end()
+                        ? kNoUpdate
+                        : key_iter->second.last_logical_commit_time);
+  }
+  return times;
+}
+
+std::vector<bool> KeyValueCache::HasValueSets(
+    absl::Span<const HashedKey> keys) const {
+  std::vector<bool> has_value_sets;
+  has_value_sets.reserve(keys.size());
+  ProfiledReaderMutexLock lock(&set_map_mutex_, LockSite::kCacheSetMap);
+  PrefetchingLookup lookup(key_to_value_set_map_, keys);
+  for (const HashedKey& key : keys) {
+    has_value_sets.push_back(lookup.Find(key) != key_to_value_set_map_.end());
+  }
+  return has_value_sets;
+}
+
+std::vector<bool> KeyValueCache::HasUInt32ValueSets(
+    absl::Span<const HashedKey> keys) const {
+  std::vector<bool> has_value_sets;
+  has_value_sets.reserve(keys.size());
+  ProfiledReaderMutexLock lock(&set_map_mutex_, LockSite::kCacheSetMap);
+  PrefetchingLookup lookup(key_to_uint32_value_set_map_, keys);
+  for (const HashedKey& key : keys) {
+    has_value_sets.push_back(lookup.Find(key) !=
+                             key_to_uint32_value_set_map_.end());
+  }
+  return has_value_sets;
+}
+
+int64_t KeyValueCache::NewestSetValueTime(const HashedKey& key) const {
+  ProfiledReaderMutexLock lock(&set_map_mutex_, LockSite::kCacheSetMap);
+  const auto key_iter = key_to_value_set_map_.find(key);
+  if (key_iter == key_to_value_set_map_.end()) {
+    return kNoUpdate;
+  }
+  ProfiledReaderMutexLock set_lock(&ValueSetMutex(key),
+                                   LockSite::kCacheValueSet);
+  int64_t time = kNoUpdate;
+  key_iter->second.ForEach(
+      [&time](std::string_view, const SetValueMeta& meta) {
+        if (!meta.is_deleted) {
+          time = std::max(time, meta.last_logical_commit_time);
+        }
+      });
+  return time;
+}
+
+int64_t KeyValueCache::NewestUInt32SetValueTime(const HashedKey& key) const {
+  ProfiledReaderMutexLock lock(&set_map_mutex_, LockSite::kCacheSetMap);
+  const auto key_iter = key_to_uint32_value_set_map_.find(key);
+  if (key_iter == key_to_uint32_value_set_map_.end()) {
+    return kNoUpdate;
+  }
+  ProfiledReaderMutexLock set_lock(&ValueSetMutex(key),
+                                   LockSite::kCacheValueSet);
+  int64_t time = kNoUpdate;
+  for (const auto& [value, meta] : key_iter->second.metas) {
+    if (!meta.is_deleted) {
+      time = std::max(time, meta.last_logical_commit_time);
+    }
+  }
+  return time;
+}
+
+KeyValueCache::ColdValues KeyValueCache::ReadColdValues(
+    absl::Span<const HashedKey> keys) const {
+  ColdValues cold_values;
+  if (cold_value_log_ == nullptr) {
+    return cold_values;
+  }
+  std::vector<std::string_view> cold_keys;
+  std::vector<ColdValueLog::Location> locations;
+  PrefetchingLookup lookup(map_, keys);
+  for (const HashedKey& key : keys) {
+    const auto key_iter = lookup.Find(key);
+    if (key_iter == map_.end() || key_iter->second.is_deleted) {
+      continue;
+    }
+    const std::string_view arena_value =
+        KeyValueArena::ValueOf(key_iter->first);
+    if (HoldsColdValue(arena_value)) {
+      cold_keys.push_back(key_iter->first);
+      locations.push_back(ColdValueLocationOf(arena_value));
+    }
+  }
+  if (cold_keys.empty()) {
+    return cold_values;
+  }
+  std::vector<std::string> buffers(cold_keys.size());
+  std::vector<std::string*> buffer_pointers;
+  buffer_pointers.reserve(buffers.size());
+  for (std::string& buffer : buffers) {
+    buffer_pointers.push_back(&buffer);
+  }
+  const std::vector<absl::Status> statuses =
+      cold_value_log_->ReadBatch(locations, buffer_pointers);
+  cold_values.reserve(cold_keys.size());
+  for (size_t i = 0; i < cold_keys.size(); i++) {
+    if (!statuses[i].ok()) {
+      LOG(ERROR) << "Failed to read the cold value of " << cold_keys[i]
+                 << ": " << statuses[i];
+      buffers[i].clear();
+    }
+    cold_values.emplace(cold_keys[i], std::move(buffers[i]));
+  }
+  return cold_values;
+}
+
+std::string_view KeyValueCache::ValueOf(std::string_view key,
+                                        std::string& buffer,
+                                        ColdValues* cold_values) const {
+  const std::string_view stored_value =
+      UncompressedValueOf(key, buffer, cold_values);
+  return precompute_json_values_
+             ? SplitPrecomputedJsonValue(stored_value).value
+             : stored_value;
+}
+
+std::string_view KeyValueCache::UncompressedValueOf(
+    std::string_view key, std::string& buffer, ColdValues* cold_values) const {
+  if (value_compressor_ == nullptr) {
+    return StoredValueOf(key, buffer, cold_values);
+  }
+  std::string cold_buffer;
+  const std::string_view stored_value =
+      StoredValueOf(key, cold_buffer, cold_values);
+  absl::StatusOr<std::string_view> value =
+      value_compressor_->Decompress(stored_value, buffer);
+  if (!value.ok()) {
+    LOG(ERROR) << "Failed to decompress the value of " << key << ": "
+               << value.status();
+    return "";
+  }
+  // Values stored uncompressed are views into `cold_buffer` if they are cold.
+  if (!cold_buffer.empty() && value->data() != buffer.data()) {
+    buffer.assign(*value);
+    return buffer;
+  }
+  return *value;
+}
+
+std::string_view KeyValueCache::StoredValueOf(std::string_view key,
+                                              std::string& buffer,
+                                              ColdValues* cold_values) const {
+  const std::string_view arena_value = KeyValueArena::ValueOf(key);
+  // Values of deleted keys are not tagged.
+  if (!TagsValues() || arena_value.empty()) {
+    return arena_value;
+  }
+  if (HoldsValueId(arena_value)) {
+    return value_store_->ValueOf(ValueIdOf(arena_value));
+  }
+  if (HoldsColdValue(arena_value)) {
+    if (cold_values != nullptr) {
+      if (const auto cold_iter = cold_values->find(key);
+          cold_iter != cold_values->end()) {
+        buffer = std::move(cold_iter->second);
+        return buffer;
+      }
+    }
+    if (absl::Status status = cold_value_log_->Read(
+            ColdValueLocationOf(arena_value), buffer);
+        !status.ok()) {
+      LOG(ERROR) << "Failed to read the cold value of " << key << ": "
+                 << status;
+      buffer.clear();
+    }
+    return buffer;
+  }
+  return arena_value.substr(1);
+}
+
+std::shared_ptr<const void> KeyValueCache::PinStoredValue(
+    std::string_view key, uint32_t slab_id) const {
+  const std::string_view arena_value = KeyValueArena::ValueOf(key);
+  if (value_store_ != nullptr && HoldsValueId(arena_value)) {
+    return value_store_->Pin(ValueIdOf(arena_value));
+  }
+  return arena_.Pin(slab_id);
+}
+
+std::string_view KeyValueCache::ToArenaValue(std::string_view stored_value,
+                                             std::string& buffer) const {
+  if (!TagsValues()) {
+    return stored_value;
+  }
+  buffer.clear();
+  if (value_store_ == nullptr ||
+      stored_value.size() < kMinDeduplicatedValueSize) {
+    buffer.push_back(kInlineValue);
+    buffer.append(stored_value);
+    return buffer;
+  }
+  const uint32_t id = value_store_->Intern(stored_value);
+  buffer.push_back(kValueId);
+  buffer.append(reinterpret_cast<const char*>(&id), sizeof(id));
+  return buffer;
+}
+
+void KeyValueCache::RetainArenaValue(std::string_view arena_value) const {
+  if (value_store_ != nullptr && HoldsValueId(arena_value)) {
+    value_store_->AddReference(ValueIdOf(arena_value));
+  } else if (cold_value_log_ != nullptr && HoldsColdValue(arena_value)) {
+    cold_value_log_->Retain(ColdValueLocationOf(arena_value));
+  }
+}
+
+void KeyValueCache::ReleaseArenaValue(std::string_view arena_value) const {
+  if (value_store_ != nullptr && HoldsValueId(arena_value)) {
+    value_store_->Release(ValueIdOf(arena_value));
+  } else if (cold_value_log_ != nullptr && HoldsColdValue(arena_value)) {
+    cold_value_log_->Release(ColdValueLocationOf(arena_value));
+  }
+}
+
+std::string KeyValueCache::ToStoredValue(std::string_view value,
+                                         std::string_view prefix) const {
+  if (!precompute_json_values_) {
+    return value_compressor_->Compress(value, prefix);
+  }
+  std::string stored_value = PrecomputeJsonValue(value);
+  return value_compressor_ == nullptr
+             ? stored_value
+             : value_compressor_->Compress(stored_value, prefix);
+}
+
+bool KeyValueCache::CollectKeyValueSets(absl::Span<const HashedKey> keys,
+                                        GetKeyValueSetResult& result) const {
+  // lock the cache map
+  ProfiledReaderMutexLock lock(&set_map_mutex_, LockSite::kCacheSetMap);
   bool cache_hit = false;
-  for (const auto& key : key_set) {
+  HotKeySketch* hot_key_sketch =
+      hot_key_sketch_.load(std::memory_order_acquire);
+  PrefetchingLookup lookup(key_to_value_set_map_, keys);
+  for (const HashedKey& hashed_key : keys) {
+    const std::string_view key = hashed_key.key;
     VLOG(8) << "Getting key: " << key;
-    const auto key_itr = key_to_value_set_map_.find(key);
+    const auto key_itr = lookup.Find(hashed_key);
     if (key_itr != key_to_value_set_map_.end()) {
-      absl::flat_hash_set<std::string_view> value_set;
-      auto set_lock =
-          std::make_unique<absl::ReaderMutexLock>(&key_itr->second->first);
-      for (const auto& v : key_itr->second->second) {
-        if (!v.second.is_deleted) {
-          value_set.emplace(v.first);
+      cache_hit = true;
+      std::shared_ptr<const ValueSetSnapshot> snapshot;
+      {
+        // Only held while the snapshot is taken, the result does not keep
+        // the set locked.
+        absl::ReaderMutexLock set_lock(&ValueSetMutex(hashed_key));
+        snapshot = SnapshotOf(hashed_key, key_itr->second);
+        if (hot_key_sketch != nullptr && hot_key_sketch->Sample()) {
+          if (const std::optional<SetValueMeta> meta =
+                  key_itr->second.AnyValue();
+              meta.has_value()) {
+            hot_key_sketch->Add(hashed_key, meta->prefix_id);
+          }
         }
       }
-      // Add key value set to the result
-      result->AddKeyValueSet(key, std::move(value_set), std::move(set_lock));
-      cache_hit = true;
+      result.AddKeyValueSet(key, std::move(snapshot));
     }
   }
-  if (cache_hit) {
-    LogCacheAccessMetrics(request_context, kKeyValueSetCacheHit);
+  return cache_hit;
+}
+
+std::shared_ptr<const ValueSetSnapshot> KeyValueCache::SnapshotOf(
+    const HashedKey& key, const ValueSet& value_set) const {
+  std::shared_ptr<const ValueSetSnapshot>& stored_snapshot =
+      key_to_value_set_snapshot_map_.find(key)->second;
+  if (std::shared_ptr<const ValueSetSnapshot> snapshot =
+          std::atomic_load(&stored_snapshot);
+      snapshot != nullptr) {
+    return snapshot;
+  }
+  std::shared_ptr<const ValueSetSnapshot> snapshot;
+  if (value_interner_ != nullptr) {
+    snapshot = std::make_shared<const ValueSetSnapshot>(
+        key_to_value_ids_map_.find(key)->second, value_interner_);
   } else {
-    LogCacheAccessMetrics(request_context, kKeyValueSetCacheMiss);
+    // Values are copied as they are passed, front coded sets decode them
+    // into a buffer.
+    std::string storage;
+    std::vector<uint32_t> sizes;
+    sizes.reserve(value_set.size());
+    value_set.ForEach(
+        [&storage, &sizes](std::string_view value, const SetValueMeta& meta) {
+          if (!meta.is_deleted) {
+            storage.append(value);
+            sizes.push_back(value.size());
+          }
+        });
+    snapshot =
+        std::make_shared<const ValueSetSnapshot>(std::move(storage), sizes);
   }
-  return result;
+  // Concurrent lookups may build the same snapshot, either one is kept.
+  std::atomic_store(&stored_snapshot, snapshot);
+  return snapshot;
+}
+
+bool KeyValueCache::CollectUInt32ValueSets(
+    absl::Span<const HashedKey> keys, GetUInt32ValueSetResult& result) const {
+  ProfiledReaderMutexLock lock(&set_map_mutex_, LockSite::kCacheSetMap);
+  bool cache_hit = false;
+  absl::flat_hash_set<absl::Mutex*> locked_mutexes;
+  HotKeySketch* hot_key_sketch =
+      hot_key_sketch_.load(std::memory_order_acquire);
+  PrefetchingLookup lookup(key_to_uint32_value_set_map_, keys);
+  for (const HashedKey& hashed_key : keys) {
+    const auto key_itr = lookup.Find(hashed_key);
+    if (key_itr == key_to_uint32_value_set_map_.end()) {
+      continue;
+    }
+    // Like in `CollectKeyValueSets`, every stripe is locked at most once.
+    std::unique_ptr<absl::ReaderMutexLock> set_lock;
+    absl::Mutex* set_mutex = &ValueSetMutex(hashed_key);
+    if (locked_mutexes.insert(set_mutex).second) {
+      set_lock = std::make_unique<absl::ReaderMutexLock>(set_mutex);
+    }
+    cache_hit = true;
+    if (hot_key_sketch != nullptr && hot_key_sketch->Sample() &&
+        !key_itr->second.metas.empty()) {
+      hot_key_sketch->Add(hashed_key,
+                          key_itr->second.metas.begin()->second.prefix_id);
+    }
+    result.AddValueSet(hashed_key.key, key_itr->second.values,
+                       std::move(set_lock));
+  }
+  return cache_hit;
 }
 
 // Replaces the current key-value entry with the new key-value entry.
 void KeyValueCache::UpdateKeyValue(std::string_view key, std::string_view value,
                                    int64_t logical_commit_time,
                                    std::string_view prefix) {
+  if (StageBulkLoad({.type = CacheMutation::Type::kUpdateKeyValue,
+                     .key = key,
+                     .value = value,
+                     .logical_commit_time = logical_commit_time},
+                    prefix)) {
+    return;
+  }
   ScopeLatencyMetricsRecorder<ServerSafeMetricsContext, kUpdateKeyValueLatency>
       latency_recorder(KVServerContextMap()->SafeMetric());
+  if (TransformsValues()) {
+    // Transformed before taking the lock, so that lookups do not wait for it.
+    const std::string stored_value = ToStoredValue(value, prefix);
+    ProfiledMutexLock lock(&mutex_, LockSite::kCacheKeyMap);
+    UpdateKeyValueLocked(key, stored_value, logical_commit_time, prefix);
+    return;
+  }
+  ProfiledMutexLock lock(&mutex_, LockSite::kCacheKeyMap);
+  UpdateKeyValueLocked(key, value, logical_commit_time, prefix);
+}
+
+void KeyValueCache::UpdateKeyValueLocked(std::string_view key,
+                                         std::string_view value,
+                                         int64_t logical_commit_time,
+                                         std::string_view prefix) {
   VLOG(9) << "Received update for [" << key << "] at " << logical_commit_time
           << ". value will be set to: " << value;
-  absl::MutexLock lock(&mutex_);
-
   auto max_cleanup_logical_commit_time =
       max_cleanup_logical_commit_time_map_[prefix];
 
@@ -123,7 +841,7 @@ void KeyValueCache::UpdateKeyValue(std::string_view key, std::string_view value,
 
   if (key_iter != map_.end() &&
       key_iter->second.last_logical_commit_time < logical_commit_time &&
-      key_iter->second.value == nullptr) {
+      key_iter->second.is_deleted) {
     // should always have this, but checking just in case
 
     if (auto prefix_deleted_nodes_iter = deleted_nodes_map_.find(prefix);
@@ -137,22 +855,93 @@ void KeyValueCache::UpdateKeyValue(std::string_view key, std::string_view value,
     }
   }
 
-  map_.insert_or_assign(key, {.value = std::make_unique<std::string>(value),
-                              .last_logical_commit_time = logical_commit_time});
+  std::string buffer;
+  PutEntry(key, ToArenaValue(value, buffer), logical_commit_time,
+           /*is_deleted=*/false, prefix_counters_.IdOf(prefix));
+}
+
+void KeyValueCache::PutEntry(std::string_view key, std::string_view value,
+                             int64_t logical_commit_time, bool is_deleted,
+                             PrefixCounters::Id prefix_id) {
+  // Add before releasing the old record, `key` may point into it.
+  const KeyValueArena::Entry entry = arena_.Add(key, value);
+  const CacheValue cache_value = {
+      .last_logical_commit_time = logical_commit_time,
+      .slab_id = entry.slab_id,
+      .is_deleted = is_deleted,
+      .prefix_id = prefix_id,
+  };
+  CountEntry(entry.key, cache_value, 1);
+  const auto key_iter = map_.find(key);
+  if (key_iter == map_.end()) {
+    if (index_keys_ && !is_deleted) {
+      sorted_key_index_.Add(key);
+    }
+    map_.emplace(entry.key, cache_value);
+    return;
+  }
+  // Compactions and spills rewrite records that stay deleted or not.
+  if (index_keys_ && key_iter->second.is_deleted != is_deleted) {
+    if (is_deleted) {
+      sorted_key_index_.Remove(key);
+    } else {
+      sorted_key_index_.Add(key);
+    }
+  }
+  // The map key is a view of the old record, so it needs to be replaced too.
+  auto node = map_.extract(key_iter);
+  CountEntry(node.key(), node.mapped(), -1);
+  ReleaseArenaValue(KeyValueArena::ValueOf(node.key()));
+  arena_.Remove({.key = node.key(), .slab_id = node.mapped().slab_id});
+  // Lookups are counted per key, whatever its value.
+  const LookupCount lookups = node.mapped().lookups;
+  node.key() = entry.key;
+  node.mapped() = cache_value;
+  node.mapped().lookups = lookups;
+  map_.insert(std::move(node));
+}
+
+void KeyValueCache::CountEntry(std::string_view key,
+                               const CacheValue& cache_value, int64_t sign) {
+  if (cache_value.is_deleted) {
+    prefix_counters_.AddTombstones(cache_value.prefix_id, sign);
+    return;
+  }
+  prefix_counters_.AddKeys(
+      cache_value.prefix_id, sign,
+      sign * static_cast<int64_t>(key.size() +
+                                  KeyValueArena::ValueOf(key).size()));
+}
+
+void KeyValueCache::CountSetValue(const SetValueMeta& meta, int64_t sign) {
+  if (meta.is_deleted) {
+    prefix_counters_.AddTombstones(meta.prefix_id, sign);
+  } else {
+    prefix_counters_.AddSetValues(meta.prefix_id, sign);
+  }
 }
 
 void KeyValueCache::UpdateKeyValueSet(
     std::string_view key, absl::Span<std::string_view> input_value_set,
     int64_t logical_commit_time, std::string_view prefix) {
+  if (StageBulkLoad({.type = CacheMutation::Type::kUpdateKeyValueSet,
+                     .key = key,
+                     .value_set = input_value_set,
+                     .logical_commit_time = logical_commit_time},
+                    prefix)) {
+    return;
+  }
   ScopeLatencyMetricsRecorder<ServerSafeMetricsContext,
                               kUpdateKeyValueSetLatency>
       latency_recorder(KVServerContextMap()->SafeMetric());
   VLOG(9) << "Received update for [" << key << "] at " << logical_commit_time;
-  std::unique_ptr<absl::MutexLock> key_lock;
-  absl::flat_hash_map<std::string, SetValueMeta>* existing_value_set;
+  std::unique_ptr<ProfiledMutexLock> key_lock;
+  ValueSet* existing_value_set;
+  RoaringBitmap* existing_value_ids = nullptr;
+  std::shared_ptr<const ValueSetSnapshot>* existing_snapshot;
   // The max cleanup time needs to be locked before doing this comparison
   {
-    absl::MutexLock lock_map(&set_map_mutex_);
+    ProfiledMutexLock lock_map(&set_map_mutex_, LockSite::kCacheSetMap);
 
     auto max_cleanup_logical_commit_time =
         max_cleanup_logical_commit_time_map_for_set_cache_[prefix];
@@ -173,44 +962,191 @@ void KeyValueCache::UpdateKeyValueSet(
       // There is no existing value set for the given key,
       // simply insert the key value set to the map, no need to update deleted
       // set nodes
-      auto mutex_value_map_pair = std::make_unique<std::pair<
-          absl::Mutex, absl::flat_hash_map<std::string, SetValueMeta>>>();
-
-      for (const auto& value : input_value_set) {
-        mutex_value_map_pair->second.emplace(
-            value, SetValueMeta{logical_commit_time, /*is_deleted=*/false});
-      }
-      key_to_value_set_map_.emplace(key, std::move(mutex_value_map_pair));
+      AddValueSet(key, input_value_set, logical_commit_time,
+                  /*is_deleted=*/false, prefix_counters_.IdOf(prefix));
       return;
     }
     // The given key has an existing value set, then
     // update the existing value if update is suggested by the comparison result
     // on the logical commit times.
     // Lock the key
-    key_lock = std::make_unique<absl::MutexLock>(&key_itr->second->first);
-    existing_value_set = &key_itr->second->second;
+    key_lock = std::make_unique<ProfiledMutexLock>(&ValueSetMutex(key),
+                                                   LockSite::kCacheValueSet);
+    existing_value_set = &key_itr->second;
+    if (value_interner_ != nullptr) {
+      existing_value_ids = &key_to_value_ids_map_.find(key)->second;
+    }
+    existing_snapshot = &key_to_value_set_snapshot_map_.find(key)->second;
   }  // end locking map;
 
-  for (const auto& value : input_value_set) {
-    auto& current_value_state = (*existing_value_set)[value];
-    if (current_value_state.last_logical_commit_time >= logical_commit_time) {
+  UpdateValues(key, *existing_value_set, existing_value_ids, existing_snapshot,
+               input_value_set, logical_commit_time,
+               prefix_counters_.IdOf(prefix));
+  // end locking key
+}
+
+void KeyValueCache::AddValueSet(std::string_view key,
+                                absl::Span<std::string_view> values,
+                                int64_t logical_commit_time, bool is_deleted,
+                                PrefixCounters::Id prefix_id) {
+  ValueSet value_set;
+  RoaringBitmap value_ids;
+  const SetValueMeta meta(logical_commit_time, is_deleted, prefix_id);
+  std::vector<std::string_view> indexed_values;
+  for (const auto& value : values) {
+    if (value_set.find(value).has_value()) {
+      continue;
+    }
+    if (!is_deleted && index_set_values_) {
+      indexed_values.push_back(value);
+    }
+    // Deleted values hold their id too, so it stays stable if they are added
+    // back.
+    if (value_interner_ != nullptr) {
+      const uint32_t id = value_interner_->Intern(value);
+      if (!is_deleted) {
+        value_ids.Add(id);
+      }
+    }
+    value_set.insert_or_assign(value, meta);
+    CountSetValue(meta, 1);
+  }
+  // Sets added whole mostly come from snapshots and rarely change after.
+  value_set.Compact();
+  key_to_value_set_map_.emplace(key, std::move(value_set));
+  if (value_interner_ != nullptr) {
+    key_to_value_ids_map_.emplace(key, std::move(value_ids));
+  }
+  key_to_value_set_snapshot_map_.emplace(key, nullptr);
+  if (!indexed_values.empty()) {
+    set_value_index_.Add(key, indexed_values);
+  }
+}
+
+void KeyValueCache::UpdateValues(
+    std::string_view key, ValueSet& value_set, RoaringBitmap* value_ids,
+    std::shared_ptr<const ValueSetSnapshot>* snapshot,
+    absl::Span<std::string_view> values, int64_t logical_commit_time,
+    PrefixCounters::Id prefix_id) {
+  std::vector<std::string_view> added_values;
+  for (const auto& value : values) {
+    const std::optional<SetValueMeta> current_value_state =
+        value_set.find(value);
+    if (current_value_state.has_value() &&
+        current_value_state->last_logical_commit_time >= logical_commit_time) {
       // no need to update
       continue;
     }
     // Insert new value or update existing value with
     // the recent logical commit time. If the existing value was marked
     // deleted, update is_deleted boolean to false
-    current_value_state.is_deleted = false;
-    current_value_state.last_logical_commit_time = logical_commit_time;
+    const SetValueMeta meta(logical_commit_time, /*deleted=*/false, prefix_id);
+    value_set.insert_or_assign(value, meta);
+    if (current_value_state.has_value()) {
+      CountSetValue(*current_value_state, -1);
+    }
+    CountSetValue(meta, 1);
+    if (value_ids != nullptr) {
+      value_ids->Add(current_value_state.has_value()
+                         ? *value_interner_->Find(value)
+                         : value_interner_->Intern(value));
+    }
+    if (!current_value_state.has_value() || current_value_state->is_deleted) {
+      added_values.push_back(value);
+    }
   }
-  // end locking key
-}
+  if (!added_values.empty()) {
+    std::atomic_store(snapshot, std::shared_ptr<const ValueSetSnapshot>());
+  }
+  if (index_set_values_ && !added_values.empty()) {
+    set_value_index_.Add(key, added_values);
+  }
+}
+
+void KeyValueCache::UpdateKeyValueUInt32Set(
+    std::string_view key, absl::Span<const uint32_t> value_set,
+    int64_t logical_commit_time, std::string_view prefix) {
+  if (StageBulkLoad({.type = CacheMutation::Type::kUpdateKeyValueUInt32Set,
+                     .key = key,
+                     .logical_commit_time = logical_commit_time,
+                     .uint32_value_set = value_set},
+                    prefix)) {
+    return;
+  }
+  ScopeLatencyMetricsRecorder<ServerSafeMetricsContext,
+                              kUpdateKeyValueSetLatency>
+      latency_recorder(KVServerContextMap()->SafeMetric());
+  ProfiledMutexLock lock_map(&set_map_mutex_, LockSite::kCacheSetMap);
+  if (logical_commit_time <=
+      max_cleanup_logical_commit_time_map_for_set_cache_[prefix]) {
+    return;
+  }
+  ChangeUInt32Values(key, value_set, logical_commit_time,
+                     /*is_deleted=*/false, prefix);
+}
+
+void KeyValueCache::ChangeUInt32Values(std::string_view key,
+                                       absl::Span<const uint32_t> values,
+                                       int64_t logical_commit_time,
+                                       bool is_deleted,
+                                       std::string_view prefix) {
+  if (values.empty()) {
+    return;
+  }
+  const SetValueMeta meta(logical_commit_time, is_deleted,
+                          prefix_counters_.IdOf(prefix));
+  auto [key_itr, inserted] = key_to_uint32_value_set_map_.try_emplace(key);
+  std::vector<uint32_t> deleted_values;
+  {
+    // Results of `GetUInt32ValueSet` keep the value set locked after the map
+    // lock is released.
+    ProfiledMutexLock key_lock(&ValueSetMutex(key), LockSite::kCacheValueSet);
+    UInt32ValueSet& value_set = key_itr->second;
+    for (const uint32_t value : values) {
+      auto [meta_itr, added] = value_set.metas.try_emplace(value, meta);
+      if (!added) {
+        if (meta_itr->second.last_logical_commit_time >= logical_commit_time) {
+          continue;
+        }
+        CountSetValue(meta_itr->second, -1);
+        meta_itr->second = meta;
+      }
+      CountSetValue(meta, 1);
+      // Deleted values are kept in `metas` so that late arriving updates
+      // with smaller logical commit times do not add them back.
+      if (is_deleted) {
+        value_set.values.Remove(value);
+        deleted_values.push_back(value);
+      } else {
+        value_set.values.Add(value);
+      }
+    }
+  }
+  if (!deleted_values.empty()) {
+    std::vector<uint32_t>& deleted_nodes =
+        deleted_uint32_set_nodes_map_[prefix][logical_commit_time][key];
+    deleted_nodes.insert(deleted_nodes.end(), deleted_values.begin(),
+                         deleted_values.end());
+  }
+}
 
 void KeyValueCache::DeleteKey(std::string_view key, int64_t logical_commit_time,
                               std::string_view prefix) {
+  if (StageBulkLoad({.type = CacheMutation::Type::kDeleteKey,
+                     .key = key,
+                     .logical_commit_time = logical_commit_time},
+                    prefix)) {
+    return;
+  }
   ScopeLatencyMetricsRecorder<ServerSafeMetricsContext, kDeleteKeyLatency>
       latency_recorder(KVServerContextMap()->SafeMetric());
-  absl::MutexLock lock(&mutex_);
+  ProfiledMutexLock lock(&mutex_, LockSite::kCacheKeyMap);
+  DeleteKeyLocked(key, logical_commit_time, prefix);
+}
+
+void KeyValueCache::DeleteKeyLocked(std::string_view key,
+                                    int64_t logical_commit_time,
+                                    std::string_view prefix) {
   auto max_cleanup_logical_commit_time =
       max_cleanup_logical_commit_time_map_[prefix];
   if (logical_commit_time <= max_cleanup_logical_commit_time) {
@@ -223,9 +1159,8 @@ void KeyValueCache::DeleteKey(std::string_view key, int64_t logical_commit_time,
     // If key is missing, we still need to add a null value to the map to
     // avoid the late coming update with smaller logical commit time
     // inserting value to the map for the given key
-    map_.insert_or_assign(
-        key,
-        {.value = nullptr, .last_logical_commit_time = logical_commit_time});
+    PutEntry(key, /*value=*/"", logical_commit_time, /*is_deleted=*/true,
+             prefix_counters_.IdOf(prefix));
     auto result = deleted_nodes_map_[prefix].emplace(logical_commit_time, key);
   }
 }
@@ -234,14 +1169,23 @@ void KeyValueCache::DeleteValuesInSet(std::string_view key,
                                       absl::Span<std::string_view> value_set,
                                       int64_t logical_commit_time,
                                       std::string_view prefix) {
+  if (StageBulkLoad({.type = CacheMutation::Type::kDeleteValuesInSet,
+                     .key = key,
+                     .value_set = value_set,
+                     .logical_commit_time = logical_commit_time},
+                    prefix)) {
+    return;
+  }
   ScopeLatencyMetricsRecorder<ServerSafeMetricsContext,
                               kDeleteValuesInSetLatency>
       latency_recorder(KVServerContextMap()->SafeMetric());
-  std::unique_ptr<absl::MutexLock> key_lock;
-  absl::flat_hash_map<std::string, SetValueMeta>* existing_value_set;
+  std::unique_ptr<ProfiledMutexLock> key_lock;
+  ValueSet* existing_value_set;
+  RoaringBitmap* existing_value_ids = nullptr;
+  std::shared_ptr<const ValueSetSnapshot>* existing_snapshot;
   // The max cleanup time needs to be locked before doing this comparison
   {
-    absl::MutexLock lock_map(&set_map_mutex_);
+    ProfiledMutexLock lock_map(&set_map_mutex_, LockSite::kCacheSetMap);
     auto max_cleanup_logical_commit_time =
         max_cleanup_logical_commit_time_map_for_set_cache_[prefix];
     if (logical_commit_time <= max_cleanup_logical_commit_time ||
@@ -253,14 +1197,8 @@ void KeyValueCache::DeleteValuesInSet(std::string_view key,
       // If the key is missing, still need to add all the deleted values to the
       // map to avoid late arriving update with smaller logical commit time
       // inserting values same as the deleted ones for the key
-      auto mutex_value_map_pair = std::make_unique<std::pair<
-          absl::Mutex, absl::flat_hash_map<std::string, SetValueMeta>>>();
-
-      for (const auto& value : value_set) {
-        mutex_value_map_pair->second.emplace(
-            value, SetValueMeta{logical_commit_time, /*is_deleted=*/true});
-      }
-      key_to_value_set_map_.emplace(key, std::move(mutex_value_map_pair));
+      AddValueSet(key, value_set, logical_commit_time, /*is_deleted=*/true,
+                  prefix_counters_.IdOf(prefix));
       // Add to deleted set nodes
       for (const std::string_view value : value_set) {
         deleted_set_nodes_map_[prefix][logical_commit_time][key].emplace(value);
@@ -268,14 +1206,63 @@ void KeyValueCache::DeleteValuesInSet(std::string_view key,
       return;
     }
     // Lock the key
-    key_lock = std::make_unique<absl::MutexLock>(&key_itr->second->first);
-    existing_value_set = &key_itr->second->second;
+    key_lock = std::make_unique<ProfiledMutexLock>(&ValueSetMutex(key),
+                                                   LockSite::kCacheValueSet);
+    existing_value_set = &key_itr->second;
+    if (value_interner_ != nullptr) {
+      existing_value_ids = &key_to_value_ids_map_.find(key)->second;
+    }
+    existing_snapshot = &key_to_value_set_snapshot_map_.find(key)->second;
   }  // end locking map
   // Keep track of the values to be added to the deleted set nodes
-  std::vector<std::string_view> values_to_delete;
-  for (const auto& value : value_set) {
-    auto& current_value_state = (*existing_value_set)[value];
-    if (current_value_state.last_logical_commit_time >= logical_commit_time) {
+  const std::vector<std::string_view> values_to_delete = DeleteValues(
+      key, *existing_value_set, existing_value_ids, existing_snapshot,
+      value_set, logical_commit_time, prefix_counters_.IdOf(prefix));
+  if (!values_to_delete.empty()) {
+    // Release key lock before locking the map to avoid potential deadlock
+    // caused by cycle in the ordering of lock acquisitions
+    key_lock.reset();
+    ProfiledMutexLock lock_map(&set_map_mutex_, LockSite::kCacheSetMap);
+    for (const std::string_view value : values_to_delete) {
+      deleted_set_nodes_map_[prefix][logical_commit_time][key].emplace(value);
+    }
+  }
+}
+
+void KeyValueCache::DeleteValuesInUInt32Set(
+    std::string_view key, absl::Span<const uint32_t> value_set,
+    int64_t logical_commit_time, std::string_view prefix) {
+  if (StageBulkLoad({.type = CacheMutation::Type::kDeleteValuesInUInt32Set,
+                     .key = key,
+                     .logical_commit_time = logical_commit_time,
+                     .uint32_value_set = value_set},
+                    prefix)) {
+    return;
+  }
+  ScopeLatencyMetricsRecorder<ServerSafeMetricsContext,
+                              kDeleteValuesInSetLatency>
+      latency_recorder(KVServerContextMap()->SafeMetric());
+  ProfiledMutexLock lock_map(&set_map_mutex_, LockSite::kCacheSetMap);
+  if (logical_commit_time <=
+      max_cleanup_logical_commit_time_map_for_set_cache_[prefix]) {
+    return;
+  }
+  ChangeUInt32Values(key, value_set, logical_commit_time, /*is_deleted=*/true,
+                     prefix);
+}
+
+std::vector<std::string_view> KeyValueCache::DeleteValues(
+    std::string_view key, ValueSet& value_set, RoaringBitmap* value_ids,
+    std::shared_ptr<const ValueSetSnapshot>* snapshot,
+    absl::Span<std::string_view> values, int64_t logical_commit_time,
+    PrefixCounters::Id prefix_id) {
+  std::vector<std::string_view> deleted_values;
+  bool deleted_live_values = false;
+  for (const auto& value : values) {
+    const std::optional<SetValueMeta> current_value_state =
+        value_set.find(value);
+    if (current_value_state.has_value() &&
+        current_value_state->last_logical_commit_time >= logical_commit_time) {
       // No need to delete
       continue;
     }
@@ -283,64 +1270,353 @@ void KeyValueCache::DeleteValuesInSet(std::string_view key,
     // deleted. We need to add the value in deleted state to the map to avoid
     // late arriving update with smaller logical commit time
     // inserting the same value
-    current_value_state.last_logical_commit_time = logical_commit_time;
-    current_value_state.is_deleted = true;
-    values_to_delete.push_back(value);
+    const SetValueMeta meta(logical_commit_time, /*deleted=*/true, prefix_id);
+    value_set.insert_or_assign(value, meta);
+    if (current_value_state.has_value()) {
+      CountSetValue(*current_value_state, -1);
+    }
+    CountSetValue(meta, 1);
+    if (value_ids != nullptr) {
+      if (current_value_state.has_value()) {
+        value_ids->Remove(*value_interner_->Find(value));
+      } else {
+        value_interner_->Intern(value);
+      }
+    }
+    if (current_value_state.has_value() && !current_value_state->is_deleted) {
+      deleted_live_values = true;
+    }
+    deleted_values.push_back(value);
   }
-  if (!values_to_delete.empty()) {
-    // Release key lock before locking the map to avoid potential deadlock
-    // caused by cycle in the ordering of lock acquisitions
-    key_lock.reset();
-    absl::MutexLock lock_map(&set_map_mutex_);
-    for (const std::string_view value : values_to_delete) {
-      deleted_set_nodes_map_[prefix][logical_commit_time][key].emplace(value);
+  if (deleted_live_values) {
+    std::atomic_store(snapshot, std::shared_ptr<const ValueSetSnapshot>());
+  }
+  if (index_set_values_ && !deleted_values.empty()) {
+    set_value_index_.Remove(key, deleted_values);
+  }
+  return deleted_values;
+}
+
+void KeyValueCache::ApplyBatch(absl::Span<const CacheMutation> mutations,
+                               std::string_view prefix) {
+  if (StageBulkLoad(mutations, prefix)) {
+    return;
+  }
+  ScopeLatencyMetricsRecorder<ServerSafeMetricsContext,
+                              kApplyCacheMutationBatchLatency>
+      latency_recorder(KVServerContextMap()->SafeMetric());
+  const PrefixCounters::Id prefix_id = prefix_counters_.IdOf(prefix);
+  // The key-value map and the key-value set map are independent, so their
+  // mutations are applied one map after the other, each under one lock.
+  bool has_set_mutations = false;
+  // Transformed before taking the lock, so that lookups do not wait for it.
+  std::vector<std::string> stored_values;
+  if (TransformsValues()) {
+    for (const CacheMutation& mutation : mutations) {
+      if (mutation.type == CacheMutation::Type::kUpdateKeyValue) {
+        stored_values.push_back(ToStoredValue(mutation.value, prefix));
+      }
+    }
+  }
+  {
+    ProfiledMutexLock lock(&mutex_, LockSite::kCacheKeyMap);
+    size_t num_updates = 0;
+    for (const CacheMutation& mutation : mutations) {
+      switch (mutation.type) {
+        case CacheMutation::Type::kUpdateKeyValue:
+          UpdateKeyValueLocked(mutation.key,
+                               TransformsValues()
+                                   ? std::string_view(
+                                         stored_values[num_updates++])
+                                   : mutation.value,
+                               mutation.logical_commit_time, prefix);
+          break;
+        case CacheMutation::Type::kDeleteKey:
+          DeleteKeyLocked(mutation.key, mutation.logical_commit_time, prefix);
+          break;
+        default:
+          has_set_mutations = true;
+      }
+    }
+  }
+  if (!has_set_mutations) {
+    return;
+  }
+  ProfiledMutexLock lock_map(&set_map_mutex_, LockSite::kCacheSetMap);
+  const int64_t max_cleanup_logical_commit_time =
+      max_cleanup_logical_commit_time_map_for_set_cache_[prefix];
+  for (const CacheMutation& mutation : mutations) {
+    if (mutation.type == CacheMutation::Type::kUpdateKeyValueUInt32Set ||
+        mutation.type == CacheMutation::Type::kDeleteValuesInUInt32Set) {
+      if (mutation.logical_commit_time > max_cleanup_logical_commit_time) {
+        ChangeUInt32Values(
+            mutation.key, mutation.uint32_value_set,
+            mutation.logical_commit_time,
+            mutation.type == CacheMutation::Type::kDeleteValuesInUInt32Set,
+            prefix);
+      }
+      continue;
+    }
+    const bool is_update =
+        mutation.type == CacheMutation::Type::kUpdateKeyValueSet;
+    if ((!is_update &&
+         mutation.type != CacheMutation::Type::kDeleteValuesInSet) ||
+        mutation.logical_commit_time <= max_cleanup_logical_commit_time ||
+        mutation.value_set.empty()) {
+      continue;
+    }
+    std::vector<std::string_view> deleted_values;
+    if (auto key_itr = key_to_value_set_map_.find(mutation.key);
+        key_itr == key_to_value_set_map_.end()) {
+      AddValueSet(mutation.key, mutation.value_set,
+                  mutation.logical_commit_time, /*is_deleted=*/!is_update,
+                  prefix_id);
+      if (!is_update) {
+        deleted_values.assign(mutation.value_set.begin(),
+                              mutation.value_set.end());
+      }
+    } else {
+      RoaringBitmap* value_ids =
+          value_interner_ == nullptr
+              ? nullptr
+              : &key_to_value_ids_map_.find(mutation.key)->second;
+      std::shared_ptr<const ValueSetSnapshot>* snapshot =
+          &key_to_value_set_snapshot_map_.find(mutation.key)->second;
+      // Lookups only hold the map lock shared, and take snapshots of the sets
+      // under their own locks.
+      ProfiledMutexLock key_lock(&ValueSetMutex(mutation.key),
+                                 LockSite::kCacheValueSet);
+      if (is_update) {
+        UpdateValues(mutation.key, key_itr->second, value_ids, snapshot,
+                     mutation.value_set, mutation.logical_commit_time,
+                     prefix_id);
+      } else {
+        deleted_values =
+            DeleteValues(mutation.key, key_itr->second, value_ids, snapshot,
+                         mutation.value_set, mutation.logical_commit_time,
+                         prefix_id);
+      }
+    }
+    for (const std::string_view value : deleted_values) {
+      deleted_set_nodes_map_[prefix][mutation.logical_commit_time]
+                            [mutation.key]
+                                .emplace(value);
     }
   }
 }
 
 void KeyValueCache::RemoveDeletedKeys(int64_t logical_commit_time,
                                       std::string_view prefix) {
+  if (StageBulkLoadCleanup(logical_commit_time, prefix)) {
+    return;
+  }
   ScopeLatencyMetricsRecorder<ServerSafeMetricsContext,
                               kRemoveDeletedKeyLatency>
       latency_recorder(KVServerContextMap()->SafeMetric());
+  if (cleanup_in_background_) {
+    SetCleanupTime(logical_commit_time, prefix);
+    return;
+  }
   CleanUpKeyValueMap(logical_commit_time, prefix);
   CleanUpKeyValueSetMap(logical_commit_time, prefix);
 }
 
+void KeyValueCache::SetCleanupTime(int64_t logical_commit_time,
+                                   std::string_view prefix) {
+  {
+    ProfiledMutexLock lock(&mutex_, LockSite::kCacheKeyMap);
+    int64_t& cleanup_time = max_cleanup_logical_commit_time_map_[prefix];
+    cleanup_time = std::max(cleanup_time, logical_commit_time);
+  }
+  ProfiledMutexLock lock(&set_map_mutex_, LockSite::kCacheSetMap);
+  int64_t& cleanup_time =
+      max_cleanup_logical_commit_time_map_for_set_cache_[prefix];
+  cleanup_time = std::max(cleanup_time, logical_commit_time);
+}
+
 void KeyValueCache::CleanUpKeyValueMap(int64_t logical_commit_time,
                                        std::string_view prefix) {
   ScopeLatencyMetricsRecorder<ServerSafeMetricsContext,
                               kCleanUpKeyValueMapLatency>
       latency_recorder(KVServerContextMap()->SafeMetric());
-  absl::MutexLock lock(&mutex_);
+  ProfiledMutexLock lock(&mutex_, LockSite::kCacheKeyMap);
   if (max_cleanup_logical_commit_time_map_[prefix] < logical_commit_time) {
     max_cleanup_logical_commit_time_map_[prefix] = logical_commit_time;
   }
-  auto deleted_nodes_per_prefix = deleted_nodes_map_.find(prefix);
-  if (deleted_nodes_per_prefix == deleted_nodes_map_.end()) {
-    return;
+  if (auto deleted_nodes_per_prefix = deleted_nodes_map_.find(prefix);
+      deleted_nodes_per_prefix != deleted_nodes_map_.end()) {
+    RemoveDeletedKeyValues(logical_commit_time, absl::InfiniteFuture(),
+                           deleted_nodes_per_prefix->second);
+    if (deleted_nodes_per_prefix->second.empty()) {
+      deleted_nodes_map_.erase(prefix);
+    }
   }
-  auto it = deleted_nodes_per_prefix->second.begin();
+  CompactArena();
+}
 
-  while (it != deleted_nodes_per_prefix->second.end()) {
-    if (it->first > logical_commit_time) {
+bool KeyValueCache::RemoveDeletedKeyValues(
+    int64_t logical_commit_time, absl::Time deadline,
+    std::multimap<int64_t, std::string>& deleted_keys) {
+  bool removed_all = true;
+  int64_t num_removed = 0;
+  auto it = deleted_keys.begin();
+  for (; it != deleted_keys.end() && it->first <= logical_commit_time; ++it) {
+    if (++num_removed % kRemovalsPerDeadlineCheck == 0 &&
+        absl::Now() >= deadline) {
+      removed_all = false;
       break;
     }
-
     // should always have this, but checking just in case
     auto key_iter = map_.find(it->second);
-    if (key_iter != map_.end() && key_iter->second.value == nullptr &&
+    if (key_iter != map_.end() && key_iter->second.is_deleted &&
         key_iter->second.last_logical_commit_time <= logical_commit_time) {
+      const KeyValueArena::Entry entry = {.key = key_iter->first,
+                                          .slab_id = key_iter->second.slab_id};
+      CountEntry(key_iter->first, key_iter->second, -1);
       map_.erase(key_iter);
+      arena_.Remove(entry);
     }
+  }
+  deleted_keys.erase(deleted_keys.begin(), it);
+  return removed_all;
+}
 
-    ++it;
+void KeyValueCache::CompactArena() {
+  for (uint32_t slab_id : arena_.SparseSlabs(kMaxLiveFractionToCompact)) {
+    arena_.ForEachRecord(slab_id, [this](const KeyValueArena::Entry& record) {
+      const auto key_iter = map_.find(record.key);
+      // Records the map no longer points at are dead.
+      if (key_iter == map_.end() ||
+          key_iter->first.data() != record.key.data()) {
+        return;
+      }
+      const std::string_view arena_value = KeyValueArena::ValueOf(record.key);
+      // The new record holds a reference of its own.
+      RetainArenaValue(arena_value);
+      PutEntry(record.key, arena_value,
+               key_iter->second.last_logical_commit_time,
+               key_iter->second.is_deleted, key_iter->second.prefix_id);
+    });
   }
-  deleted_nodes_per_prefix->second.erase(
-      deleted_nodes_per_prefix->second.begin(), it);
-  if (deleted_nodes_per_prefix->second.empty()) {
-    deleted_nodes_map_.erase(prefix);
+}
+
+void KeyValueCache::RebalanceValueTiers(absl::Duration max_pause) {
+  const ColdValueLog::Options& options = cold_value_log_->options();
+  std::vector<std::string> keys_to_spill;
+  std::vector<std::string> keys_to_promote;
+  {
+    ProfiledReaderMutexLock lock(&mutex_, LockSite::kCacheKeyMap);
+    // Sizes of the values that can be spilled, by their lookup count.
+    std::array<int64_t, UINT8_MAX + 1> spillable_bytes = {};
+    int64_t hot_value_bytes = 0;
+    for (const auto& [key, cache_value] : map_) {
+      const std::string_view arena_value = KeyValueArena::ValueOf(key);
+      const uint8_t lookups = cache_value.lookups.Get();
+      if (!HoldsColdValue(arena_value)) {
+        hot_value_bytes += arena_value.size();
+        if (IsSpillable(arena_value, options.min_cold_value_size)) {
+          spillable_bytes[lookups] += arena_value.size();
+        }
+      } else if (lookups >= options.promotion_lookups) {
+        keys_to_promote.emplace_back(key);
+        hot_value_bytes += ColdValueLocationOf(arena_value).size;
+      }
+    }
+    // Spills all the values looked up less than `max_lookups` times, and
+    // `bytes_to_spill` of those looked up `max_lookups` times.
+    int64_t bytes_to_spill = hot_value_bytes - options.max_hot_value_bytes;
+    int max_lookups = 0;
+    for (; max_lookups < UINT8_MAX &&
+           bytes_to_spill > spillable_bytes[max_lookups];
+         max_lookups++) {
+      bytes_to_spill -= spillable_bytes[max_lookups];
+    }
+    for (const auto& [key, cache_value] : map_) {
+      const std::string_view arena_value = KeyValueArena::ValueOf(key);
+      const uint8_t lookups = cache_value.lookups.Get();
+      cache_value.lookups.Decay();
+      if (lookups > max_lookups ||
+          (lookups == max_lookups && bytes_to_spill <= 0) ||
+          !IsSpillable(arena_value, options.min_cold_value_size)) {
+        continue;
+      }
+      keys_to_spill.emplace_back(key);
+      if (lookups == max_lookups) {
+        bytes_to_spill -= arena_value.size();
+      }
+    }
+  }
+  // Spills before promoting, so that memory use does not peak meanwhile.
+  size_t next_spill = 0;
+  size_t next_promotion = 0;
+  while (next_spill < keys_to_spill.size() ||
+         next_promotion < keys_to_promote.size()) {
+    ProfiledMutexLock lock(&mutex_, LockSite::kCacheKeyMap);
+    ScopeLatencyMetricsRecorder<ServerSafeMetricsContext,
+                                kBackgroundCleanUpPauseLatency>
+        latency_recorder(KVServerContextMap()->SafeMetric());
+    const absl::Time deadline = absl::Now() + max_pause;
+    do {
+      if (next_spill < keys_to_spill.size()) {
+        if (absl::Status status = SpillValue(keys_to_spill[next_spill++]);
+            !status.ok()) {
+          LOG(ERROR) << "Failed to spill values to disk: " << status;
+          next_spill = keys_to_spill.size();
+        }
+      } else {
+        PromoteValue(keys_to_promote[next_promotion++]);
+      }
+    } while ((next_spill < keys_to_spill.size() ||
+              next_promotion < keys_to_promote.size()) &&
+             absl::Now() < deadline);
   }
+  VLOG(2) << "Spilled " << keys_to_spill.size() << " values and promoted "
+          << keys_to_promote.size() << " cold values, "
+          << cold_value_log_->live_bytes() << " bytes of values are cold";
+}
+
+void KeyValueCache::PromoteValue(std::string_view key) {
+  const auto key_iter = map_.find(key);
+  if (key_iter == map_.end() ||
+      !HoldsColdValue(KeyValueArena::ValueOf(key_iter->first))) {
+    return;
+  }
+  std::string stored_value;
+  if (absl::Status status = cold_value_log_->Read(
+          ColdValueLocationOf(KeyValueArena::ValueOf(key_iter->first)),
+          stored_value);
+      !status.ok()) {
+    LOG(ERROR) << "Failed to read the cold value of " << key << ": "
+               << status;
+    return;
+  }
+  std::string buffer;
+  PutEntry(key_iter->first, ToArenaValue(stored_value, buffer),
+           key_iter->second.last_logical_commit_time, /*is_deleted=*/false,
+           key_iter->second.prefix_id);
+}
+
+absl::Status KeyValueCache::SpillValue(std::string_view key) {
+  const auto key_iter = map_.find(key);
+  if (key_iter == map_.end()) {
+    return absl::OkStatus();
+  }
+  const std::string_view arena_value = KeyValueArena::ValueOf(key_iter->first);
+  if (key_iter->second.is_deleted ||
+      !IsSpillable(arena_value,
+                   cold_value_log_->options().min_cold_value_size)) {
+    return absl::OkStatus();
+  }
+  absl::StatusOr<ColdValueLog::Location> location =
+      cold_value_log_->Append(arena_value.substr(1));
+  if (!location.ok()) {
+    return location.status();
+  }
+  std::string buffer;
+  PutEntry(key_iter->first, ColdArenaValue(*location, buffer),
+           key_iter->second.last_logical_commit_time, /*is_deleted=*/false,
+           key_iter->second.prefix_id);
+  return absl::OkStatus();
 }
 
 void KeyValueCache::CleanUpKeyValueSetMap(int64_t logical_commit_time,
@@ -348,59 +1624,1220 @@ void KeyValueCache::CleanUpKeyValueSetMap(int64_t logical_commit_time,
   ScopeLatencyMetricsRecorder<ServerSafeMetricsContext,
                               kCleanUpKeyValueSetMapLatency>
       latency_recorder(KVServerContextMap()->SafeMetric());
-  absl::MutexLock lock_set_map(&set_map_mutex_);
+  ProfiledMutexLock lock_set_map(&set_map_mutex_, LockSite::kCacheSetMap);
   if (max_cleanup_logical_commit_time_map_for_set_cache_[prefix] <
       logical_commit_time) {
     max_cleanup_logical_commit_time_map_for_set_cache_[prefix] =
         logical_commit_time;
   }
-  auto deleted_nodes_per_prefix = deleted_set_nodes_map_.find(prefix);
-  if (deleted_nodes_per_prefix == deleted_set_nodes_map_.end()) {
-    return;
+  if (auto deleted_nodes_per_prefix = deleted_set_nodes_map_.find(prefix);
+      deleted_nodes_per_prefix != deleted_set_nodes_map_.end()) {
+    RemoveDeletedSetValues(logical_commit_time, absl::InfiniteFuture(),
+                           deleted_nodes_per_prefix->second);
+    if (deleted_nodes_per_prefix->second.empty()) {
+      deleted_set_nodes_map_.erase(deleted_nodes_per_prefix);
+    }
   }
-  auto delete_itr = deleted_nodes_per_prefix->second.begin();
-  while (delete_itr != deleted_nodes_per_prefix->second.end()) {
-    if (delete_itr->first > logical_commit_time) {
-      break;
+  if (auto deleted_nodes_per_prefix =
+          deleted_uint32_set_nodes_map_.find(prefix);
+      deleted_nodes_per_prefix != deleted_uint32_set_nodes_map_.end()) {
+    RemoveDeletedUInt32SetValues(logical_commit_time, absl::InfiniteFuture(),
+                                 deleted_nodes_per_prefix->second);
+    if (deleted_nodes_per_prefix->second.empty()) {
+      deleted_uint32_set_nodes_map_.erase(deleted_nodes_per_prefix);
     }
-    for (const auto& [key, values] : delete_itr->second) {
+  }
+}
+
+bool KeyValueCache::RemoveDeletedSetValues(
+    int64_t logical_commit_time, absl::Time deadline,
+    DeletedSetValues& deleted_set_values) {
+  int64_t num_removed = 0;
+  // Sets left with values are compacted once at the end, which merges the
+  // values changed since they were loaded.
+  absl::flat_hash_set<std::string> changed_keys;
+  const auto compact_changed_sets =
+      [this, &changed_keys]() ABSL_NO_THREAD_SAFETY_ANALYSIS {
+        for (const std::string& key : changed_keys) {
+          if (auto key_itr = key_to_value_set_map_.find(key);
+              key_itr != key_to_value_set_map_.end()) {
+            ProfiledMutexLock key_lock(&ValueSetMutex(key),
+                                       LockSite::kCacheValueSet);
+            key_itr->second.Compact();
+          }
+        }
+      };
+  auto delete_itr = deleted_set_values.begin();
+  for (; delete_itr != deleted_set_values.end() &&
+         delete_itr->first <= logical_commit_time;
+       ++delete_itr) {
+    auto& deleted_values_per_key = delete_itr->second;
+    for (auto it = deleted_values_per_key.begin();
+         it != deleted_values_per_key.end(); ++it) {
+      if (++num_removed % kRemovalsPerDeadlineCheck == 0 &&
+          absl::Now() >= deadline) {
+        // Keeps the keys of this timestamp that are left for the next slice.
+        deleted_values_per_key.erase(deleted_values_per_key.begin(), it);
+        deleted_set_values.erase(deleted_set_values.begin(), delete_itr);
+        compact_changed_sets();
+        return false;
+      }
+      const auto& [key, values] = *it;
       if (auto key_itr = key_to_value_set_map_.find(key);
           key_itr != key_to_value_set_map_.end()) {
-        absl::MutexLock(&key_itr->second->first);
+        ProfiledMutexLock key_lock(&ValueSetMutex(key),
+                                   LockSite::kCacheValueSet);
         for (const auto& v_to_delete : values) {
-          auto existing_value_itr = key_itr->second->second.find(v_to_delete);
-          if (existing_value_itr != key_itr->second->second.end() &&
-              existing_value_itr->second.is_deleted &&
-              existing_value_itr->second.last_logical_commit_time <=
+          const std::optional<SetValueMeta> existing_value =
+              key_itr->second.find(v_to_delete);
+          if (existing_value.has_value() && existing_value->is_deleted &&
+              existing_value->last_logical_commit_time <=
                   logical_commit_time) {
+            if (value_interner_ != nullptr) {
+              value_interner_->Release(*value_interner_->Find(v_to_delete));
+            }
+            CountSetValue(*existing_value, -1);
             // Delete the existing value that is marked deleted from set
-            key_itr->second->second.erase(existing_value_itr);
+            key_itr->second.erase(v_to_delete);
           }
         }
-        if (key_itr->second->second.empty()) {
+        if (key_itr->second.empty()) {
           // If the value set is empty, erase the key-value_set from cache map
           key_to_value_set_map_.erase(key);
+          key_to_value_ids_map_.erase(key);
+          key_to_value_set_snapshot_map_.erase(key);
+        } else {
+          changed_keys.insert(key);
+        }
+      }
+    }
+  }
+  deleted_set_values.erase(deleted_set_values.begin(), delete_itr);
+  compact_changed_sets();
+  return true;
+}
+
+bool KeyValueCache::RemoveDeletedUInt32SetValues(
+    int64_t logical_commit_time, absl::Time deadline,
+    DeletedUInt32SetValues& deleted_set_values) {
+  int64_t num_removed = 0;
+  auto delete_itr = deleted_set_values.begin();
+  for (; delete_itr != deleted_set_values.end() &&
+         delete_itr->first <= logical_commit_time;
+       ++delete_itr) {
+    auto& deleted_values_per_key = delete_itr->second;
+    for (auto it = deleted_values_per_key.begin();
+         it != deleted_values_per_key.end(); ++it) {
+      if (++num_removed % kRemovalsPerDeadlineCheck == 0 &&
+          absl::Now() >= deadline) {
+        deleted_values_per_key.erase(deleted_values_per_key.begin(), it);
+        deleted_set_values.erase(deleted_set_values.begin(), delete_itr);
+        return false;
+      }
+      const auto& [key, values] = *it;
+      const auto key_itr = key_to_uint32_value_set_map_.find(key);
+      if (key_itr == key_to_uint32_value_set_map_.end()) {
+        continue;
+      }
+      ProfiledMutexLock key_lock(&ValueSetMutex(key), LockSite::kCacheValueSet);
+      auto& metas = key_itr->second.metas;
+      for (const uint32_t value : values) {
+        if (const auto meta_itr = metas.find(value);
+            meta_itr != metas.end() && meta_itr->second.is_deleted &&
+            meta_itr->second.last_logical_commit_time <= logical_commit_time) {
+          CountSetValue(meta_itr->second, -1);
+          metas.erase(meta_itr);
+        }
+      }
+      if (metas.empty()) {
+        key_to_uint32_value_set_map_.erase(key_itr);
+      }
+    }
+  }
+  deleted_set_values.erase(deleted_set_values.begin(), delete_itr);
+  return true;
+}
+
+int64_t KeyValueCache::RemoveDeletedKeysInSlices(absl::Duration max_pause) {
+  bool removed_all = false;
+  while (!removed_all) {
+    removed_all = true;
+    {
+      ProfiledMutexLock lock(&mutex_, LockSite::kCacheKeyMap);
+      ScopeLatencyMetricsRecorder<ServerSafeMetricsContext,
+                                  kBackgroundCleanUpPauseLatency>
+          latency_recorder(KVServerContextMap()->SafeMetric());
+      const absl::Time deadline = absl::Now() + max_pause;
+      for (auto it = deleted_nodes_map_.begin();
+           removed_all && it != deleted_nodes_map_.end();) {
+        const auto cleanup_time =
+            max_cleanup_logical_commit_time_map_.find(it->first);
+        if (cleanup_time != max_cleanup_logical_commit_time_map_.end()) {
+          removed_all = RemoveDeletedKeyValues(cleanup_time->second, deadline,
+                                               it->second);
+        }
+        if (it->second.empty()) {
+          deleted_nodes_map_.erase(it++);
+        } else {
+          ++it;
+        }
+      }
+      if (removed_all) {
+        CompactArena();
+      }
+    }
+    bool removed_all_set_values = true;
+    {
+      ProfiledMutexLock lock(&set_map_mutex_, LockSite::kCacheSetMap);
+      ScopeLatencyMetricsRecorder<ServerSafeMetricsContext,
+                                  kBackgroundCleanUpPauseLatency>
+          latency_recorder(KVServerContextMap()->SafeMetric());
+      const absl::Time deadline = absl::Now() + max_pause;
+      for (auto it = deleted_set_nodes_map_.begin();
+           removed_all_set_values && it != deleted_set_nodes_map_.end();) {
+        const auto cleanup_time =
+            max_cleanup_logical_commit_time_map_for_set_cache_.find(it->first);
+        if (cleanup_time !=
+            max_cleanup_logical_commit_time_map_for_set_cache_.end()) {
+          removed_all_set_values = RemoveDeletedSetValues(
+              cleanup_time->second, deadline, it->second);
+        }
+        if (it->second.empty()) {
+          deleted_set_nodes_map_.erase(it++);
+        } else {
+          ++it;
+        }
+      }
+      for (auto it = deleted_uint32_set_nodes_map_.begin();
+           removed_all_set_values &&
+           it != deleted_uint32_set_nodes_map_.end();) {
+        const auto cleanup_time =
+            max_cleanup_logical_commit_time_map_for_set_cache_.find(it->first);
+        if (cleanup_time !=
+            max_cleanup_logical_commit_time_map_for_set_cache_.end()) {
+          removed_all_set_values = RemoveDeletedUInt32SetValues(
+              cleanup_time->second, deadline, it->second);
+        }
+        if (it->second.empty()) {
+          deleted_uint32_set_nodes_map_.erase(it++);
+        } else {
+          ++it;
+        }
+      }
+    }
+    removed_all = removed_all && removed_all_set_values;
+  }
+  int64_t num_left = 0;
+  {
+    ProfiledReaderMutexLock lock(&mutex_, LockSite::kCacheKeyMap);
+    for (const auto& [prefix, deleted_keys] : deleted_nodes_map_) {
+      num_left += deleted_keys.size();
+    }
+  }
+  ProfiledReaderMutexLock lock(&set_map_mutex_, LockSite::kCacheSetMap);
+  for (const auto& [prefix, deleted_set_values] : deleted_set_nodes_map_) {
+    for (const auto& [logical_commit_time, deleted_values_per_key] :
+         deleted_set_values) {
+      for (const auto& [key, values] : deleted_values_per_key) {
+        num_left += values.size();
+      }
+    }
+  }
+  for (const auto& [prefix, deleted_set_values] :
+       deleted_uint32_set_nodes_map_) {
+    for (const auto& [logical_commit_time, deleted_values_per_key] :
+         deleted_set_values) {
+      for (const auto& [key, values] : deleted_values_per_key) {
+        num_left += values.size();
+      }
+    }
+  }
+  return num_left;
+}
+
+absl::Status KeyValueCache::StartBackgroundCleanup(absl::Duration interval,
+                                                   absl::Duration max_pause) {
+  if (cleanup_closure_ != nullptr) {
+    return absl::FailedPreconditionError("Background cleanup already started");
+  }
+  cleanup_in_background_ = true;
+  cleanup_closure_ = PeriodicClosure::Create();
+  return cleanup_closure_->StartDelayed(interval, [this, max_pause]() {
+    LogIfError(
+        KVServerContextMap()->SafeMetric().LogHistogram<kCacheTombstoneCount>(
+            static_cast<double>(RemoveDeletedKeysInSlices(max_pause))));
+    if (cold_value_log_ != nullptr) {
+      RebalanceValueTiers(max_pause);
+    }
+  });
+}
+
+void KeyValueCache::Reserve(int64_t num_keys, int64_t num_set_keys) {
+  if (num_keys > 0) {
+    ProfiledMutexLock lock(&mutex_, LockSite::kCacheKeyMap);
+    map_.reserve(map_.size() + num_keys);
+  }
+  if (num_set_keys > 0) {
+    ProfiledMutexLock lock(&set_map_mutex_, LockSite::kCacheSetMap);
+    key_to_value_set_map_.reserve(key_to_value_set_map_.size() + num_set_keys);
+    if (value_interner_ != nullptr) {
+      key_to_value_ids_map_.reserve(key_to_value_ids_map_.size() +
+                                    num_set_keys);
+    }
+    key_to_value_set_snapshot_map_.reserve(
+        key_to_value_set_snapshot_map_.size() + num_set_keys);
+  }
+}
+
+absl::Status KeyValueCache::ForEachKey(
+    absl::FunctionRef<void(std::string_view key)> callback) const {
+  {
+    ProfiledReaderMutexLock lock(&mutex_, LockSite::kCacheKeyMap);
+    for (const auto& [key, cache_value] : map_) {
+      if (!cache_value.is_deleted) {
+        callback(key);
+      }
+    }
+  }
+  ProfiledReaderMutexLock lock(&set_map_mutex_, LockSite::kCacheSetMap);
+  for (const auto& [key, value_set] : key_to_value_set_map_) {
+    callback(key);
+  }
+  for (const auto& [key, value_set] : key_to_uint32_value_set_map_) {
+    callback(key);
+  }
+  return absl::OkStatus();
+}
+
+absl::flat_hash_map<std::string, PrefixStats> KeyValueCache::GetPrefixStats()
+    const {
+  return prefix_counters_.Get();
+}
+
+absl::Status KeyValueCache::EnableSetValueIndex() {
+  ProfiledMutexLock lock(&set_map_mutex_, LockSite::kCacheSetMap);
+  if (!key_to_value_set_map_.empty()) {
+    return absl::FailedPreconditionError(
+        "The set value index must be enabled before any set is added.");
+  }
+  index_set_values_ = true;
+  return absl::OkStatus();
+}
+
+absl::StatusOr<std::vector<std::string>> KeyValueCache::GetKeysContaining(
+    const RequestContext& request_context, std::string_view value) const {
+  if (!index_set_values_) {
+    return absl::FailedPreconditionError("The set value index is not enabled.");
+  }
+  return set_value_index_.KeysContaining(value);
+}
+
+absl::Status KeyValueCache::EnableSortedKeyIndex() {
+  ProfiledMutexLock lock(&mutex_, LockSite::kCacheKeyMap);
+  if (!map_.empty()) {
+    return absl::FailedPreconditionError(
+        "The sorted key index must be enabled before any key is added.");
+  }
+  index_keys_ = true;
+  return absl::OkStatus();
+}
+
+absl::StatusOr<std::vector<std::string>> KeyValueCache::GetKeysWithPrefix(
+    const RequestContext& request_context, std::string_view key_prefix,
+    int64_t limit) const {
+  if (!index_keys_) {
+    return absl::FailedPreconditionError(
+        "The sorted key index is not enabled.");
+  }
+  return sorted_key_index_.KeysWithPrefix(key_prefix, limit);
+}
+
+absl::Status KeyValueCache::EnableHotKeyTracking(int32_t sample_rate) {
+  if (sample_rate < 1) {
+    return absl::InvalidArgumentError(
+        "The hot key sample rate must be positive.");
+  }
+  ProfiledMutexLock lock(&mutex_, LockSite::kCacheKeyMap);
+  if (hot_key_sketch_owner_ != nullptr) {
+    return absl::FailedPreconditionError(
+        "Hot key tracking is already enabled.");
+  }
+  hot_key_sketch_owner_ = std::make_unique<HotKeySketch>(
+      HotKeySketch::Options{.sample_rate = sample_rate});
+  hot_key_sketch_.store(hot_key_sketch_owner_.get(),
+                        std::memory_order_release);
+  return absl::OkStatus();
+}
+
+HotKeys KeyValueCache::GetHotKeys(int64_t num_keys_per_prefix) const {
+  const HotKeySketch* hot_key_sketch =
+      hot_key_sketch_.load(std::memory_order_acquire);
+  if (hot_key_sketch == nullptr) {
+    return {};
+  }
+  const std::vector<std::string> prefixes = prefix_counters_.Prefixes();
+  HotKeys hot_keys;
+  // Candidates come hottest first.
+  for (HotKeySketch::Candidate& candidate : hot_key_sketch->Candidates()) {
+    std::vector<HotKey>& keys =
+        hot_keys[candidate.prefix_id < prefixes.size()
+                     ? std::string_view(prefixes[candidate.prefix_id])
+                     : PrefixCounters::kOverflowPrefix];
+    if (static_cast<int64_t>(keys.size()) < num_keys_per_prefix) {
+      keys.push_back({.key = std::move(candidate.key),
+                      .estimated_lookups = candidate.estimated_lookups});
+    }
+  }
+  return hot_keys;
+}
+
+absl::Status KeyValueCache::WriteCheckpoint(CheckpointWriter& writer) const {
+  writer.WriteString(kCheckpointType);
+  {
+    ProfiledReaderMutexLock lock(&mutex_, LockSite::kCacheKeyMap);
+    writer.WriteInt64(map_.size());
+    std::string buffer;
+    for (const auto& [key, cache_value] : map_) {
+      writer.WriteString(key);
+      writer.WriteString(ValueOf(key, buffer));
+      writer.WriteInt64(cache_value.last_logical_commit_time);
+      writer.WriteBool(cache_value.is_deleted);
+      writer.WriteInt64(cache_value.prefix_id);
+    }
+    writer.WriteInt64(deleted_nodes_map_.size());
+    for (const auto& [prefix, deleted_nodes] : deleted_nodes_map_) {
+      writer.WriteString(prefix);
+      writer.WriteInt64(deleted_nodes.size());
+      for (const auto& [logical_commit_time, key] : deleted_nodes) {
+        writer.WriteInt64(logical_commit_time);
+        writer.WriteString(key);
+      }
+    }
+    WriteCleanupTimes(max_cleanup_logical_commit_time_map_, writer);
+  }
+  ProfiledReaderMutexLock lock(&set_map_mutex_, LockSite::kCacheSetMap);
+  WriteCleanupTimes(max_cleanup_logical_commit_time_map_for_set_cache_, writer);
+  writer.WriteInt64(key_to_value_set_map_.size());
+  for (const auto& [key, value_set] : key_to_value_set_map_) {
+    ProfiledReaderMutexLock key_lock(&ValueSetMutex(key),
+                                     LockSite::kCacheValueSet);
+    writer.WriteString(key);
+    writer.WriteInt64(value_set.size());
+    value_set.ForEach(
+        [&writer](std::string_view value, const SetValueMeta& meta) {
+          writer.WriteString(value);
+          writer.WriteInt64(meta.last_logical_commit_time);
+          writer.WriteBool(meta.is_deleted);
+          writer.WriteInt64(meta.prefix_id);
+        });
+  }
+  writer.WriteInt64(deleted_set_nodes_map_.size());
+  for (const auto& [prefix, deleted_nodes] : deleted_set_nodes_map_) {
+    writer.WriteString(prefix);
+    writer.WriteInt64(deleted_nodes.size());
+    for (const auto& [logical_commit_time, deleted_values] : deleted_nodes) {
+      writer.WriteInt64(logical_commit_time);
+      writer.WriteInt64(deleted_values.size());
+      for (const auto& [key, values] : deleted_values) {
+        writer.WriteString(key);
+        writer.WriteInt64(values.size());
+        for (const std::string& value : values) {
+          writer.WriteString(value);
+        }
+      }
+    }
+  }
+  writer.WriteInt64(key_to_uint32_value_set_map_.size());
+  for (const auto& [key, value_set] : key_to_uint32_value_set_map_) {
+    ProfiledReaderMutexLock key_lock(&ValueSetMutex(key),
+                                     LockSite::kCacheValueSet);
+    writer.WriteString(key);
+    writer.WriteInt64(value_set.metas.size());
+    for (const auto& [value, meta] : value_set.metas) {
+      writer.WriteInt64(value);
+      writer.WriteInt64(meta.last_logical_commit_time);
+      writer.WriteBool(meta.is_deleted);
+      writer.WriteInt64(meta.prefix_id);
+    }
+  }
+  writer.WriteInt64(deleted_uint32_set_nodes_map_.size());
+  for (const auto& [prefix, deleted_nodes] : deleted_uint32_set_nodes_map_) {
+    writer.WriteString(prefix);
+    writer.WriteInt64(deleted_nodes.size());
+    for (const auto& [logical_commit_time, deleted_values] : deleted_nodes) {
+      writer.WriteInt64(logical_commit_time);
+      writer.WriteInt64(deleted_values.size());
+      for (const auto& [key, values] : deleted_values) {
+        writer.WriteString(key);
+        writer.WriteInt64(values.size());
+        for (const uint32_t value : values) {
+          writer.WriteInt64(value);
+        }
+      }
+    }
+  }
+  // Written last, so that it has the ids of all the entries written before.
+  const std::vector<std::string> prefixes = prefix_counters_.Prefixes();
+  writer.WriteInt64(prefixes.size());
+  for (const std::string& prefix : prefixes) {
+    writer.WriteString(prefix);
+  }
+  return writer.status();
+}
+
+absl::Status KeyValueCache::RestoreCheckpoint(CheckpointReader& reader) {
+  absl::StatusOr<CheckpointImage> image = ReadCheckpointImage(reader);
+  if (!image.ok()) {
+    return image.status();
+  }
+  RestoreCheckpointImage(*image);
+  return absl::OkStatus();
+}
+
+absl::StatusOr<KeyValueCache::CheckpointImage>
+KeyValueCache::ReadCheckpointImage(CheckpointReader& reader) const {
+  {
+    ProfiledReaderMutexLock lock(&mutex_, LockSite::kCacheKeyMap);
+    if (!map_.empty()) {
+      return absl::FailedPreconditionError(
+          "Checkpoints can only be restored into an empty cache.");
+    }
+  }
+  {
+    ProfiledReaderMutexLock lock(&set_map_mutex_, LockSite::kCacheSetMap);
+    if (!key_to_value_set_map_.empty() ||
+        !key_to_uint32_value_set_map_.empty()) {
+      return absl::FailedPreconditionError(
+          "Checkpoints can only be restored into an empty cache.");
+    }
+  }
+  std::string_view type;
+  if (!reader.ReadString(&type) || type != kCheckpointType) {
+    return InvalidCheckpointError();
+  }
+  CheckpointImage image;
+  size_t count;
+  if (!reader.ReadCount(&count)) {
+    return InvalidCheckpointError();
+  }
+  image.key_values.reserve(count);
+  for (size_t i = 0; i < count; i++) {
+    CheckpointImage::KeyValue& key_value = image.key_values.emplace_back();
+    if (!reader.ReadString(&key_value.key) ||
+        !reader.ReadString(&key_value.value) ||
+        !reader.ReadInt64(&key_value.logical_commit_time) ||
+        !reader.ReadBool(&key_value.is_deleted) ||
+        !reader.ReadInt64(&key_value.prefix)) {
+      return InvalidCheckpointError();
+    }
+  }
+  size_t num_prefixes;
+  if (!reader.ReadCount(&num_prefixes)) {
+    return InvalidCheckpointError();
+  }
+  for (size_t i = 0; i < num_prefixes; i++) {
+    std::string_view prefix;
+    if (!reader.ReadString(&prefix) || !reader.ReadCount(&count)) {
+      return InvalidCheckpointError();
+    }
+    for (size_t j = 0; j < count; j++) {
+      CheckpointImage::DeletedKey& deleted_key =
+          image.deleted_keys.emplace_back();
+      deleted_key.prefix = prefix;
+      if (!reader.ReadInt64(&deleted_key.logical_commit_time) ||
+          !reader.ReadString(&deleted_key.key)) {
+        return InvalidCheckpointError();
+      }
+    }
+  }
+  for (std::vector<CheckpointImage::CleanupTime>* cleanup_times :
+       {&image.cleanup_times, &image.set_cleanup_times}) {
+    if (!reader.ReadCount(&count)) {
+      return InvalidCheckpointError();
+    }
+    for (size_t i = 0; i < count; i++) {
+      CheckpointImage::CleanupTime& cleanup_time =
+          cleanup_times->emplace_back();
+      if (!reader.ReadString(&cleanup_time.prefix) ||
+          !reader.ReadInt64(&cleanup_time.logical_commit_time)) {
+        return InvalidCheckpointError();
+      }
+    }
+  }
+  if (!reader.ReadCount(&count)) {
+    return InvalidCheckpointError();
+  }
+  image.key_value_sets.reserve(count);
+  for (size_t i = 0; i < count; i++) {
+    CheckpointImage::KeyValueSet& key_value_set =
+        image.key_value_sets.emplace_back();
+    if (!reader.ReadString(&key_value_set.key) ||
+        !reader.ReadCount(&key_value_set.num_values)) {
+      return InvalidCheckpointError();
+    }
+    for (size_t j = 0; j < key_value_set.num_values; j++) {
+      CheckpointImage::SetValue& set_value = image.set_values.emplace_back();
+      if (!reader.ReadString(&set_value.value) ||
+          !reader.ReadInt64(&set_value.meta.last_logical_commit_time) ||
+          !reader.ReadBool(&set_value.meta.is_deleted) ||
+          !reader.ReadInt64(&set_value.prefix)) {
+        return InvalidCheckpointError();
+      }
+    }
+  }
+  if (!reader.ReadCount(&num_prefixes)) {
+    return InvalidCheckpointError();
+  }
+  for (size_t i = 0; i < num_prefixes; i++) {
+    std::string_view prefix;
+    size_t num_times;
+    if (!reader.ReadString(&prefix) || !reader.ReadCount(&num_times)) {
+      return InvalidCheckpointError();
+    }
+    for (size_t j = 0; j < num_times; j++) {
+      int64_t logical_commit_time;
+      size_t num_keys;
+      if (!reader.ReadInt64(&logical_commit_time) ||
+          !reader.ReadCount(&num_keys)) {
+        return InvalidCheckpointError();
+      }
+      for (size_t k = 0; k < num_keys; k++) {
+        std::string_view key;
+        size_t num_values;
+        if (!reader.ReadString(&key) || !reader.ReadCount(&num_values)) {
+          return InvalidCheckpointError();
         }
+        for (size_t l = 0; l < num_values; l++) {
+          CheckpointImage::DeletedSetValue& deleted_value =
+              image.deleted_set_values.emplace_back();
+          deleted_value.prefix = prefix;
+          deleted_value.logical_commit_time = logical_commit_time;
+          deleted_value.key = key;
+          if (!reader.ReadString(&deleted_value.value)) {
+            return InvalidCheckpointError();
+          }
+        }
+      }
+    }
+  }
+  if (!reader.ReadCount(&count)) {
+    return InvalidCheckpointError();
+  }
+  image.key_uint32_value_sets.reserve(count);
+  for (size_t i = 0; i < count; i++) {
+    CheckpointImage::KeyValueSet& key_value_set =
+        image.key_uint32_value_sets.emplace_back();
+    if (!reader.ReadString(&key_value_set.key) ||
+        !reader.ReadCount(&key_value_set.num_values)) {
+      return InvalidCheckpointError();
+    }
+    for (size_t j = 0; j < key_value_set.num_values; j++) {
+      CheckpointImage::UInt32SetValue& set_value =
+          image.uint32_set_values.emplace_back();
+      if (!ReadUInt32SetValue(reader, &set_value.value) ||
+          !reader.ReadInt64(&set_value.meta.last_logical_commit_time) ||
+          !reader.ReadBool(&set_value.meta.is_deleted) ||
+          !reader.ReadInt64(&set_value.prefix)) {
+        return InvalidCheckpointError();
+      }
+    }
+  }
+  if (!reader.ReadCount(&num_prefixes)) {
+    return InvalidCheckpointError();
+  }
+  for (size_t i = 0; i < num_prefixes; i++) {
+    std::string_view prefix;
+    size_t num_times;
+    if (!reader.ReadString(&prefix) || !reader.ReadCount(&num_times)) {
+      return InvalidCheckpointError();
+    }
+    for (size_t j = 0; j < num_times; j++) {
+      int64_t logical_commit_time;
+      size_t num_keys;
+      if (!reader.ReadInt64(&logical_commit_time) ||
+          !reader.ReadCount(&num_keys)) {
+        return InvalidCheckpointError();
       }
+      for (size_t k = 0; k < num_keys; k++) {
+        std::string_view key;
+        size_t num_values;
+        if (!reader.ReadString(&key) || !reader.ReadCount(&num_values)) {
+          return InvalidCheckpointError();
+        }
+        for (size_t l = 0; l < num_values; l++) {
+          CheckpointImage::DeletedUInt32SetValue& deleted_value =
+              image.deleted_uint32_set_values.emplace_back();
+          deleted_value.prefix = prefix;
+          deleted_value.logical_commit_time = logical_commit_time;
+          deleted_value.key = key;
+          if (!ReadUInt32SetValue(reader, &deleted_value.value)) {
+            return InvalidCheckpointError();
+          }
+        }
+      }
+    }
+  }
+  if (!reader.ReadCount(&count)) {
+    return InvalidCheckpointError();
+  }
+  image.prefixes.resize(count);
+  for (std::string_view& prefix : image.prefixes) {
+    if (!reader.ReadString(&prefix)) {
+      return InvalidCheckpointError();
+    }
+  }
+  const int64_t num_prefixes_read = image.prefixes.size();
+  for (const CheckpointImage::KeyValue& key_value : image.key_values) {
+    if (key_value.prefix < 0 || key_value.prefix >= num_prefixes_read) {
+      return InvalidCheckpointError();
     }
-    ++delete_itr;
   }
-  deleted_nodes_per_prefix->second.erase(
-      deleted_nodes_per_prefix->second.begin(), delete_itr);
-  if (deleted_nodes_per_prefix->second.empty()) {
-    deleted_set_nodes_map_.erase(prefix);
+  for (const CheckpointImage::SetValue& set_value : image.set_values) {
+    if (set_value.prefix < 0 || set_value.prefix >= num_prefixes_read) {
+      return InvalidCheckpointError();
+    }
+  }
+  for (const CheckpointImage::UInt32SetValue& set_value :
+       image.uint32_set_values) {
+    if (set_value.prefix < 0 || set_value.prefix >= num_prefixes_read) {
+      return InvalidCheckpointError();
+    }
   }
+  return image;
+}
+
+void KeyValueCache::RestoreCheckpointImage(const CheckpointImage& image) {
+  std::vector<PrefixCounters::Id> prefix_ids;
+  prefix_ids.reserve(image.prefixes.size());
+  for (std::string_view prefix : image.prefixes) {
+    prefix_ids.push_back(prefix_counters_.IdOf(prefix));
+  }
+  {
+    ProfiledMutexLock lock(&mutex_, LockSite::kCacheKeyMap);
+    map_.reserve(image.key_values.size());
+    std::string arena_buffer;
+    for (const CheckpointImage::KeyValue& key_value : image.key_values) {
+      // Checkpoints hold the values without their precomputed JSON form,
+      // uncompressed and not deduplicated, so that they can be restored
+      // whatever the options.
+      std::string_view arena_value = key_value.value;
+      std::string stored_value;
+      if (!key_value.is_deleted) {
+        if (TransformsValues() && !image.values_stored) {
+          stored_value = ToStoredValue(key_value.value,
+                                       image.prefixes[key_value.prefix]);
+          arena_value = stored_value;
+        }
+        arena_value = ToArenaValue(arena_value, arena_buffer);
+      }
+      const KeyValueArena::Entry entry =
+          arena_.Add(key_value.key, arena_value);
+      const CacheValue cache_value = {
+          .last_logical_commit_time = key_value.logical_commit_time,
+          .slab_id = entry.slab_id,
+          .is_deleted = key_value.is_deleted,
+          .prefix_id = prefix_ids[key_value.prefix],
+      };
+      if (map_.try_emplace(entry.key, cache_value).second) {
+        CountEntry(entry.key, cache_value, 1);
+        if (index_keys_ && !key_value.is_deleted) {
+          sorted_key_index_.Add(key_value.key);
+        }
+      } else {
+        ReleaseArenaValue(KeyValueArena::ValueOf(entry.key));
+        arena_.Remove(entry);
+      }
+    }
+    // Deleted keys were written in order of their logical commit times.
+    for (const CheckpointImage::DeletedKey& deleted_key : image.deleted_keys) {
+      auto& deleted_nodes = deleted_nodes_map_[deleted_key.prefix];
+      deleted_nodes.emplace_hint(deleted_nodes.end(),
+                                 deleted_key.logical_commit_time,
+                                 std::string(deleted_key.key));
+    }
+    for (const CheckpointImage::CleanupTime& cleanup_time :
+         image.cleanup_times) {
+      int64_t& max_cleanup_logical_commit_time =
+          max_cleanup_logical_commit_time_map_[cleanup_time.prefix];
+      max_cleanup_logical_commit_time = std::max(
+          max_cleanup_logical_commit_time, cleanup_time.logical_commit_time);
+    }
+  }
+  ProfiledMutexLock lock(&set_map_mutex_, LockSite::kCacheSetMap);
+  for (const CheckpointImage::CleanupTime& cleanup_time :
+       image.set_cleanup_times) {
+    int64_t& max_cleanup_logical_commit_time =
+        max_cleanup_logical_commit_time_map_for_set_cache_[cleanup_time.prefix];
+    max_cleanup_logical_commit_time = std::max(
+        max_cleanup_logical_commit_time, cleanup_time.logical_commit_time);
+  }
+  key_to_value_set_map_.reserve(image.key_value_sets.size());
+  if (value_interner_ != nullptr) {
+    key_to_value_ids_map_.reserve(image.key_value_sets.size());
+  }
+  key_to_value_set_snapshot_map_.reserve(image.key_value_sets.size());
+  auto set_value = image.set_values.begin();
+  for (const CheckpointImage::KeyValueSet& key_value_set :
+       image.key_value_sets) {
+    if (key_to_value_set_map_.contains(key_value_set.key)) {
+      set_value += key_value_set.num_values;
+      continue;
+    }
+    ValueSet value_set;
+    RoaringBitmap value_ids;
+    std::vector<std::string_view> indexed_values;
+    for (size_t i = 0; i < key_value_set.num_values; i++, ++set_value) {
+      if (value_set.find(set_value->value).has_value()) {
+        continue;
+      }
+      if (!set_value->meta.is_deleted && index_set_values_) {
+        indexed_values.push_back(set_value->value);
+      }
+      // Like in `AddValueSet`, deleted values hold their id too.
+      if (value_interner_ != nullptr) {
+        const uint32_t id = value_interner_->Intern(set_value->value);
+        if (!set_value->meta.is_deleted) {
+          value_ids.Add(id);
+        }
+      }
+      const SetValueMeta meta(set_value->meta.last_logical_commit_time,
+                              set_value->meta.is_deleted,
+                              prefix_ids[set_value->prefix]);
+      value_set.insert_or_assign(set_value->value, meta);
+      CountSetValue(meta, 1);
+    }
+    value_set.Compact();
+    key_to_value_set_map_.emplace(key_value_set.key, std::move(value_set));
+    if (value_interner_ != nullptr) {
+      key_to_value_ids_map_.emplace(key_value_set.key, std::move(value_ids));
+    }
+    key_to_value_set_snapshot_map_.emplace(key_value_set.key, nullptr);
+    if (!indexed_values.empty()) {
+      set_value_index_.Add(key_value_set.key, indexed_values);
+    }
+  }
+  for (const CheckpointImage::DeletedSetValue& deleted_value :
+       image.deleted_set_values) {
+    deleted_set_nodes_map_[deleted_value.prefix]
+                          [deleted_value.logical_commit_time]
+                          [deleted_value.key]
+                              .emplace(deleted_value.value);
+  }
+  key_to_uint32_value_set_map_.reserve(image.key_uint32_value_sets.size());
+  auto uint32_set_value = image.uint32_set_values.begin();
+  for (const CheckpointImage::KeyValueSet& key_value_set :
+       image.key_uint32_value_sets) {
+    auto [key_itr, inserted] =
+        key_to_uint32_value_set_map_.try_emplace(key_value_set.key);
+    if (!inserted) {
+      uint32_set_value += key_value_set.num_values;
+      continue;
+    }
+    UInt32ValueSet& value_set = key_itr->second;
+    for (size_t i = 0; i < key_value_set.num_values; i++, ++uint32_set_value) {
+      const SetValueMeta meta(uint32_set_value->meta.last_logical_commit_time,
+                              uint32_set_value->meta.is_deleted,
+                              prefix_ids[uint32_set_value->prefix]);
+      if (!value_set.metas.try_emplace(uint32_set_value->value, meta).second) {
+        continue;
+      }
+      if (!meta.is_deleted) {
+        value_set.values.Add(uint32_set_value->value);
+      }
+      CountSetValue(meta, 1);
+    }
+  }
+  for (const CheckpointImage::DeletedUInt32SetValue& deleted_value :
+       image.deleted_uint32_set_values) {
+    deleted_uint32_set_nodes_map_[deleted_value.prefix]
+                                 [deleted_value.logical_commit_time]
+                                 [deleted_value.key]
+                                     .push_back(deleted_value.value);
+  }
+}
+
+absl::Status KeyValueCache::StartBulkLoad() {
+  absl::MutexLock lock(&bulk_load_mutex_);
+  if (bulk_load_ != nullptr) {
+    return absl::FailedPreconditionError("A bulk load is already in progress.");
+  }
+  bool is_empty;
+  {
+    ProfiledReaderMutexLock lock(&mutex_, LockSite::kCacheKeyMap);
+    is_empty = map_.empty();
+  }
+  if (is_empty) {
+    ProfiledReaderMutexLock lock(&set_map_mutex_, LockSite::kCacheSetMap);
+    is_empty = key_to_value_set_map_.empty() &&
+               key_to_uint32_value_set_map_.empty();
+  }
+  if (!is_empty) {
+    return absl::FailedPreconditionError(
+        "Bulk loads can only start on an empty cache.");
+  }
+  bulk_load_ = std::make_unique<BulkLoad>();
+  bulk_loading_.store(true, std::memory_order_release);
+  return absl::OkStatus();
+}
+
+absl::Status KeyValueCache::FinishBulkLoad() {
+  return FinishBulkLoadOnThreads(
+      std::max<int>(1, std::thread::hardware_concurrency()));
+}
+
+int64_t KeyValueCache::BulkLoad::PrefixIndex(std::string_view prefix) {
+  const auto it = std::find(prefixes.begin(), prefixes.end(), prefix);
+  if (it != prefixes.end()) {
+    return it - prefixes.begin();
+  }
+  prefixes.emplace_back(prefix);
+  return prefixes.size() - 1;
+}
+
+bool KeyValueCache::StageBulkLoad(absl::Span<const CacheMutation> mutations,
+                                  std::string_view prefix) {
+  if (!bulk_loading_.load(std::memory_order_acquire)) {
+    return false;
+  }
+  absl::ReaderMutexLock lock(&bulk_load_mutex_);
+  if (bulk_load_ == nullptr) {
+    return false;
+  }
+  int64_t prefix_index;
+  {
+    absl::MutexLock prefixes_lock(&bulk_load_->prefixes_mutex);
+    prefix_index = bulk_load_->PrefixIndex(prefix);
+  }
+  std::vector<std::vector<const CacheMutation*>> partition_mutations(
+      kNumBulkLoadPartitions);
+  for (const CacheMutation& mutation : mutations) {
+    partition_mutations[KeyHash{}(mutation.key) % kNumBulkLoadPartitions]
+        .push_back(&mutation);
+  }
+  for (size_t i = 0; i < kNumBulkLoadPartitions; i++) {
+    if (partition_mutations[i].empty()) {
+      continue;
+    }
+    BulkLoadPartition& partition = bulk_load_->partitions[i];
+    absl::MutexLock partition_lock(&partition.mutex);
+    for (const CacheMutation* mutation : partition_mutations[i]) {
+      // The value, if any, is copied with the key into one record.
+      const std::string_view key =
+          partition.arena.Add(mutation->key, mutation->value).key;
+      StagedMutation staged = {
+          .type = mutation->type,
+          .key = key,
+          .value = KeyValueArena::ValueOf(key),
+          .first_value = 0,
+          .num_values = 0,
+          .logical_commit_time = mutation->logical_commit_time,
+          .prefix = prefix_index,
+      };
+      switch (mutation->type) {
+        case CacheMutation::Type::kUpdateKeyValueSet:
+        case CacheMutation::Type::kDeleteValuesInSet:
+          staged.first_value = partition.set_values.size();
+          staged.num_values = mutation->value_set.size();
+          for (const std::string_view value : mutation->value_set) {
+            partition.set_values.push_back(
+                partition.arena.Add(value, /*value=*/"").key);
+          }
+          break;
+        case CacheMutation::Type::kUpdateKeyValueUInt32Set:
+        case CacheMutation::Type::kDeleteValuesInUInt32Set:
+          staged.first_value = partition.uint32_set_values.size();
+          staged.num_values = mutation->uint32_value_set.size();
+          partition.uint32_set_values.insert(
+              partition.uint32_set_values.end(),
+              mutation->uint32_value_set.begin(),
+              mutation->uint32_value_set.end());
+          break;
+        default:
+          break;
+      }
+      partition.mutations.push_back(staged);
+    }
+  }
+  return true;
+}
+
+bool KeyValueCache::StageBulkLoadCleanup(int64_t logical_commit_time,
+                                         std::string_view prefix) {
+  if (!bulk_loading_.load(std::memory_order_acquire)) {
+    return false;
+  }
+  absl::ReaderMutexLock lock(&bulk_load_mutex_);
+  if (bulk_load_ == nullptr) {
+    return false;
+  }
+  absl::MutexLock prefixes_lock(&bulk_load_->prefixes_mutex);
+  auto [it, inserted] = bulk_load_->cleanup_times.try_emplace(
+      bulk_load_->PrefixIndex(prefix), logical_commit_time);
+  it->second = std::max(it->second, logical_commit_time);
+  return true;
+}
+
+absl::Status KeyValueCache::FinishBulkLoadOnThreads(int num_threads) {
+  // Held until the cache is built, so that the changes made meanwhile wait
+  // to be applied to it rather than being staged too late.
+  absl::MutexLock lock(&bulk_load_mutex_);
+  if (bulk_load_ == nullptr) {
+    return absl::FailedPreconditionError("No bulk load is in progress.");
+  }
+  const absl::Time start = absl::Now();
+  BulkLoad& bulk_load = *bulk_load_;
+  std::vector<std::string_view> prefixes;
+  absl::flat_hash_map<int64_t, int64_t> cleanup_times;
+  {
+    absl::MutexLock prefixes_lock(&bulk_load.prefixes_mutex);
+    prefixes.assign(bulk_load.prefixes.begin(), bulk_load.prefixes.end());
+    cleanup_times = bulk_load.cleanup_times;
+  }
+  std::vector<CheckpointImage> partition_images(kNumBulkLoadPartitions);
+  std::array<KeyValueArena, kNumBulkLoadPartitions> stored_values;
+  std::atomic<size_t> next_partition = 0;
+  const auto merge_partitions = [&]() {
+    for (size_t i = next_partition++; i < kNumBulkLoadPartitions;
+         i = next_partition++) {
+      MergeBulkLoadPartition(bulk_load.partitions[i], cleanup_times,
+                             prefixes, stored_values[i], partition_images[i]);
+    }
+  };
+  std::vector<std::thread> threads;
+  for (int i = 1;
+       i < std::min<int>(num_threads, kNumBulkLoadPartitions); i++) {
+    threads.emplace_back(merge_partitions);
+  }
+  merge_partitions();
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  // Partitions hold distinct keys, so their images are simply concatenated.
+  CheckpointImage image;
+  image.prefixes = prefixes;
+  image.values_stored = true;
+  for (const auto& [prefix_index, logical_commit_time] : cleanup_times) {
+    image.cleanup_times.push_back(
+        {.prefix = prefixes[prefix_index],
+         .logical_commit_time = logical_commit_time});
+  }
+  image.set_cleanup_times = image.cleanup_times;
+  const auto append = [](auto& to, const auto& from) {
+    to.insert(to.end(), from.begin(), from.end());
+  };
+  for (const CheckpointImage& partition_image : partition_images) {
+    append(image.key_values, partition_image.key_values);
+    append(image.deleted_keys, partition_image.deleted_keys);
+    append(image.key_value_sets, partition_image.key_value_sets);
+    append(image.set_values, partition_image.set_values);
+    append(image.deleted_set_values, partition_image.deleted_set_values);
+    append(image.key_uint32_value_sets, partition_image.key_uint32_value_sets);
+    append(image.uint32_set_values, partition_image.uint32_set_values);
+    append(image.deleted_uint32_set_values,
+           partition_image.deleted_uint32_set_values);
+  }
+  RestoreCheckpointImage(image);
+  bulk_load_.reset();
+  bulk_loading_.store(false, std::memory_order_release);
+  LOG(INFO) << "Built the cache from its bulk load of "
+            << image.key_values.size() << " keys and "
+            << image.key_value_sets.size() + image.key_uint32_value_sets.size()
+            << " sets in " << absl::Now() - start;
+  return absl::OkStatus();
+}
+
+void KeyValueCache::MergeBulkLoadPartition(
+    BulkLoadPartition& partition,
+    const absl::flat_hash_map<int64_t, int64_t>& cleanup_times,
+    absl::Span<const std::string_view> prefixes, KeyValueArena& stored_values,
+    CheckpointImage& image) const {
+  absl::MutexLock lock(&partition.mutex);
+  const auto is_cleaned_up = [&cleanup_times](int64_t prefix,
+                                              int64_t logical_commit_time) {
+    const auto it = cleanup_times.find(prefix);
+    return it != cleanup_times.end() && logical_commit_time <= it->second;
+  };
+  // Sorted by key, and otherwise kept in the order they were staged, so that
+  // the first of the changes with the same logical commit time wins like
+  // when they are applied one by one.
+  std::vector<const StagedMutation*> mutations;
+  mutations.reserve(partition.mutations.size());
+  for (const StagedMutation& mutation : partition.mutations) {
+    mutations.push_back(&mutation);
+  }
+  std::stable_sort(mutations.begin(), mutations.end(),
+                   [](const StagedMutation* lhs, const StagedMutation* rhs) {
+                     return lhs->key < rhs->key;
+                   });
+  absl::flat_hash_map<std::string_view, CheckpointImage::SetValue> set_values;
+  absl::flat_hash_map<uint32_t, CheckpointImage::UInt32SetValue>
+      uint32_set_values;
+  for (auto begin = mutations.begin(); begin != mutations.end();) {
+    const std::string_view key = (*begin)->key;
+    const auto end = std::find_if(
+        begin, mutations.end(),
+        [key](const StagedMutation* mutation) { return mutation->key != key; });
+    const StagedMutation* latest = nullptr;
+    set_values.clear();
+    uint32_set_values.clear();
+    for (auto it = begin; it != end; ++it) {
+      const StagedMutation& mutation = **it;
+      // The prefix of the meta is unset, like in checkpoint images.
+      const SetValueMeta meta(
+          mutation.logical_commit_time,
+          mutation.type == CacheMutation::Type::kDeleteValuesInSet ||
+              mutation.type == CacheMutation::Type::kDeleteValuesInUInt32Set,
+          /*prefix=*/0);
+      switch (mutation.type) {
+        case CacheMutation::Type::kUpdateKeyValue:
+        case CacheMutation::Type::kDeleteKey:
+          if (latest == nullptr ||
+              latest->logical_commit_time < mutation.logical_commit_time) {
+            latest = &mutation;
+          }
+          break;
+        case CacheMutation::Type::kUpdateKeyValueSet:
+        case CacheMutation::Type::kDeleteValuesInSet:
+          for (size_t i = 0; i < mutation.num_values; i++) {
+            const std::string_view value =
+                partition.set_values[mutation.first_value + i];
+            auto [value_it, added] = set_values.try_emplace(
+                value, CheckpointImage::SetValue{.value = value,
+                                                 .meta = meta,
+                                                 .prefix = mutation.prefix});
+            if (!added && value_it->second.meta.last_logical_commit_time <
+                              mutation.logical_commit_time) {
+              value_it->second.meta = meta;
+              value_it->second.prefix = mutation.prefix;
+            }
+          }
+          break;
+        case CacheMutation::Type::kUpdateKeyValueUInt32Set:
+        case CacheMutation::Type::kDeleteValuesInUInt32Set:
+          for (size_t i = 0; i < mutation.num_values; i++) {
+            const uint32_t value =
+                partition.uint32_set_values[mutation.first_value + i];
+            auto [value_it, added] = uint32_set_values.try_emplace(
+                value,
+                CheckpointImage::UInt32SetValue{.value = value,
+                                                .meta = meta,
+                                                .prefix = mutation.prefix});
+            if (!added && value_it->second.meta.last_logical_commit_time <
+                              mutation.logical_commit_time) {
+              value_it->second.meta = meta;
+              value_it->second.prefix = mutation.prefix;
+            }
+          }
+          break;
+      }
+    }
+    begin = end;
+    if (latest != nullptr &&
+        latest->type == CacheMutation::Type::kUpdateKeyValue) {
+      std::string_view value = latest->value;
+      if (TransformsValues()) {
+        value = stored_values
+                    .Add(ToStoredValue(value, prefixes[latest->prefix]),
+                         /*value=*/"")
+                    .key;
+      }
+      image.key_values.push_back(
+          {.key = key,
+           .value = value,
+           .logical_commit_time = latest->logical_commit_time,
+           .is_deleted = false,
+           .prefix = latest->prefix});
+    } else if (latest != nullptr &&
+               !is_cleaned_up(latest->prefix, latest->logical_commit_time)) {
+      image.key_values.push_back(
+          {.key = key,
+           .value = "",
+           .logical_commit_time = latest->logical_commit_time,
+           .is_deleted = true,
+           .prefix = latest->prefix});
+      image.deleted_keys.push_back(
+          {.prefix = prefixes[latest->prefix],
+           .logical_commit_time = latest->logical_commit_time,
+           .key = key});
+    }
+    size_t num_values = 0;
+    for (const auto& [value, set_value] : set_values) {
+      const int64_t logical_commit_time =
+          set_value.meta.last_logical_commit_time;
+      if (set_value.meta.is_deleted) {
+        if (is_cleaned_up(set_value.prefix, logical_commit_time)) {
+          continue;
+        }
+        image.deleted_set_values.push_back(
+            {.prefix = prefixes[set_value.prefix],
+             .logical_commit_time = logical_commit_time,
+             .key = key,
+             .value = value});
+      }
+      image.set_values.push_back(set_value);
+      num_values++;
+    }
+    if (num_values > 0) {
+      image.key_value_sets.push_back({.key = key, .num_values = num_values});
+    }
+    num_values = 0;
+    for (const auto& [value, set_value] : uint32_set_values) {
+      const int64_t logical_commit_time =
+          set_value.meta.last_logical_commit_time;
+      if (set_value.meta.is_deleted) {
+        if (is_cleaned_up(set_value.prefix, logical_commit_time)) {
+          continue;
+        }
+        image.deleted_uint32_set_values.push_back(
+            {.prefix = prefixes[set_value.prefix],
+             .logical_commit_time = logical_commit_time,
+             .key = key,
+             .value = value});
+      }
+      image.uint32_set_values.push_back(set_value);
+      num_values++;
+    }
+    if (num_values > 0) {
+      image.key_uint32_value_sets.push_back(
+          {.key = key, .num_values = num_values});
+    }
+  }
+}
+
+absl::Mutex& KeyValueCache::ValueSetMutex(std::string_view key) const {
+  return ValueSetMutex(HashedKey(key));
+}
+
+absl::Mutex& KeyValueCache::ValueSetMutex(const HashedKey& key) const {
+  return value_set_mutexes_[key.hash % kNumValueSetStripes];
 }
 
 void KeyValueCache::LogCacheAccessMetrics(
     const RequestContext& request_context,
     std::string_view cache_access_event) const {
-  LogIfError(
-      request_context.GetInternalLookupMetricsContext()
-          .AccumulateMetric<kCacheAccessEventCount>(1, cache_access_event));
+  request_context.GetMetricsBatch().cache_access_events.Add(
+      cache_access_event);
 }
 
-std::unique_ptr<Cache> KeyValueCache::Create() {
-  return absl::WrapUnique(new KeyValueCache());
+std::unique_ptr<Cache> KeyValueCache::Create(
+    bool intern_set_values, bool precompute_json_values,
+    bool compress_values, bool deduplicate_values,
+    std::optional<ColdValueLog::Options> cold_value_log_options) {
+  std::shared_ptr<ColdValueLog> cold_value_log;
+  if (cold_value_log_options.has_value()) {
+    absl::StatusOr<std::unique_ptr<ColdValueLog>> log =
+        ColdValueLog::Create(*std::move(cold_value_log_options));
+    if (log.ok()) {
+      cold_value_log = *std::move(log);
+    } else {
+      LOG(ERROR) << "Keeping all values in memory: " << log.status();
+    }
+  }
+  return std::make_unique<KeyValueCache>(
+      intern_set_values ? std::make_shared<ValueInterner>() : nullptr,
+      precompute_json_values,
+      compress_values ? std::make_shared<ValueCompressor>() : nullptr,
+      deduplicate_values ? std::make_shared<ValueInterner>() : nullptr,
+      std::move(cold_value_log));
 }
 }  // namespace kv_server
@@ -17,9 +17,14 @@
 #ifndef COMPONENTS_DATA_SERVER_CACHE_KEY_VALUE_CACHE_H_
 #define COMPONENTS_DATA_SERVER_CACHE_KEY_VALUE_CACHE_H_
 
+#include <array>
+#include <atomic>
+#include <cstdint>
 #include <iostream>
+#include <limits>
 #include <map>
 #include <memory>
+#include <optional>
 #include <string>
 #include <string_view>
 #include <unordered_map>
@@ -29,8 +34,30 @@
 #include "absl/container/btree_map.h"
 #include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
+#include "absl/container/node_hash_map.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
 #include "components/data_server/cache/cache.h"
+#include "components/data_server/cache/checkpoint_io.h"
+#include "components/data_server/cache/cold_value_log.h"
+#include "components/data_server/cache/compact_string_map.h"
+#include "components/data_server/cache/get_key_value_result.h"
 #include "components/data_server/cache/get_key_value_set_result.h"
+#include "components/data_server/cache/get_uint32_value_set_result.h"
+#include "components/data_server/cache/hashed_key.h"
+#include "components/data_server/cache/hot_key_sketch.h"
+#include "components/data_server/cache/key_value_arena.h"
+#include "components/data_server/cache/prefix_counters.h"
+#include "components/data_server/cache/set_value_index.h"
+#include "components/data_server/cache/sorted_key_index.h"
+#include "components/data_server/cache/value_compressor.h"
+#include "components/data_server/cache/value_interner.h"
+#include "components/data_server/cache/value_set_snapshot.h"
+#include "components/query/roaring_bitmap.h"
+#include "components/util/periodic_closure.h"
 #include "public/base_types.pb.h"
 
 namespace kv_server {
@@ -38,16 +65,47 @@ namespace kv_server {
 // One cache object is only for keys in one namespace.
 class KeyValueCache : public Cache {
  public:
+  KeyValueCache() = default;
+  // Creates a cache that interns set values with `value_interner`, which may
+  // be shared with other caches. Results of `GetKeyValueSet` then hold the
+  // value sets as ids, see `GetKeyValueSetResult::GetValueSetIds`. If
+  // `precompute_json_values` is true, values are parsed as JSON once when they
+  // are loaded, see `GetKeyValueResult::GetSerializedJsonValue`. If
+  // `value_compressor` is set, values are stored compressed with it and
+  // decompressed by every lookup. If `value_store` is set, values that are
+  // large enough are stored once in it, however many keys have them. If
+  // `cold_value_log` is set, the values that are looked up the least are
+  // spilled into it by the background cleanup, see `RebalanceValueTiers`. All
+  // of them may be shared with other caches.
+  explicit KeyValueCache(
+      std::shared_ptr<ValueInterner> value_interner,
+      bool precompute_json_values = false,
+      std::shared_ptr<ValueCompressor> value_compressor = nullptr,
+      std::shared_ptr<ValueInterner> value_store = nullptr,
+      std::shared_ptr<ColdValueLog> cold_value_log = nullptr);
+  ~KeyValueCache() override;
+
   // Looks up and returns key-value pairs for the given keys.
   absl::flat_hash_map<std::string, std::string> GetKeyValuePairs(
       const RequestContext& request_context,
       const absl::flat_hash_set<std::string_view>& key_set) const override;
 
+  // Looks up the given keys and returns views of their values.
+  std::unique_ptr<GetKeyValueResult> GetKeyValues(
+      const RequestContext& request_context,
+      const absl::flat_hash_set<std::string_view>& key_set) const override;
+
   // Looks up and returns key-value set result for the given key set.
   std::unique_ptr<GetKeyValueSetResult> GetKeyValueSet(
       const RequestContext& request_context,
       const absl::flat_hash_set<std::string_view>& key_set) const override;
 
+  // Looks up and returns the sets of 32-bit unsigned integers of the given
+  // keys, which stay locked for the lifetime of the result.
+  std::unique_ptr<GetUInt32ValueSetResult> GetUInt32ValueSet(
+      const RequestContext& request_context,
+      const absl::flat_hash_set<std::string_view>& key_set) const override;
+
   // Inserts or updates the key with the new value for a given prefix
   void UpdateKeyValue(std::string_view key, std::string_view value,
                       int64_t logical_commit_time,
@@ -60,6 +118,14 @@ class KeyValueCache : public Cache {
                          int64_t logical_commit_time,
                          std::string_view prefix = "") override;
 
+  // Inserts or updates values in the set of 32-bit unsigned integers of the
+  // key, like `UpdateKeyValueSet`. Numeric sets are kept apart from string
+  // sets, with a bitmap of the values that are not deleted.
+  void UpdateKeyValueUInt32Set(std::string_view key,
+                               absl::Span<const uint32_t> value_set,
+                               int64_t logical_commit_time,
+                               std::string_view prefix = "") override;
+
   // Deletes a particular (key, value) pair for a given prefix.
   void DeleteKey(std::string_view key, int64_t logical_commit_time,
                  std::string_view prefix = "") override;
@@ -72,26 +138,143 @@ class KeyValueCache : public Cache {
                          int64_t logical_commit_time,
                          std::string_view prefix = "") override;
 
+  // Deletes values in the set of 32-bit unsigned integers of the key, like
+  // `DeleteValuesInSet`.
+  void DeleteValuesInUInt32Set(std::string_view key,
+                               absl::Span<const uint32_t> value_set,
+                               int64_t logical_commit_time,
+                               std::string_view prefix = "") override;
+
   // Removes the values that were deleted before the specified
-  // logical_commit_time for a given prefix.
-  // TODO: b/267182790 -- Cache cleanup should be done periodically from a
-  // background thread
+  // logical_commit_time for a given prefix, or only records the time once
+  // `StartBackgroundCleanup` was called.
   void RemoveDeletedKeys(int64_t logical_commit_time,
                          std::string_view prefix = "") override;
 
-  static std::unique_ptr<Cache> Create();
+  // Applies the key-value mutations under one lock of the key-value map, and
+  // the set mutations under one lock of the key-value set map.
+  void ApplyBatch(absl::Span<const CacheMutation> mutations,
+                  std::string_view prefix = "") override;
+
+  // Grows the key-value map and the key-value set maps to hold that many more
+  // keys than they hold now.
+  void Reserve(int64_t num_keys, int64_t num_set_keys) override;
+
+  // Removes deleted values in slices of about `max_pause` from a background
+  // thread, and logs the number of deleted keys and values left after every
+  // run. Also moves values between memory and the cold value log, if any.
+  absl::Status StartBackgroundCleanup(absl::Duration interval,
+                                      absl::Duration max_pause) override;
+
+  // Writes the maps one entry after the other, under reader locks.
+  absl::Status WriteCheckpoint(CheckpointWriter& writer) const override;
+
+  // Reads the whole checkpoint before adding its entries to maps reserved for
+  // them, under one lock of each map.
+  absl::Status RestoreCheckpoint(CheckpointReader& reader) override;
+
+  // Stages the changes into partitions by key until `FinishBulkLoad`, along
+  // with the times passed to `RemoveDeletedKeys`. Fails if the cache is not
+  // empty.
+  absl::Status StartBulkLoad() override;
+
+  // Merges the partitions on several threads, dropping the deleted keys and
+  // values that were cleaned up, then adds the result like a restored
+  // checkpoint.
+  absl::Status FinishBulkLoad() override;
+
+  // Visits the keys of the key-value map and then of the key-value set map,
+  // each under a reader lock of its map.
+  absl::Status ForEachKey(
+      absl::FunctionRef<void(std::string_view key)> callback) const override;
+
+  // Returns the counters kept up to date by every change of the maps, without
+  // taking their locks.
+  absl::flat_hash_map<std::string, PrefixStats> GetPrefixStats()
+      const override;
+
+  // Keeps `set_value_index_` up to date with the values of the key-value sets
+  // that are not deleted. Fails if a key-value set was already added.
+  absl::Status EnableSetValueIndex() override;
+
+  // Reads `set_value_index_`, without taking the locks of the maps.
+  absl::StatusOr<std::vector<std::string>> GetKeysContaining(
+      const RequestContext& request_context,
+      std::string_view value) const override;
+
+  // Keeps `sorted_key_index_` up to date with the keys of `map_` that are not
+  // deleted. Fails if a key was already added.
+  absl::Status EnableSortedKeyIndex() override;
+
+  // Reads `sorted_key_index_`, without taking the locks of the maps.
+  absl::StatusOr<std::vector<std::string>> GetKeysWithPrefix(
+      const RequestContext& request_context, std::string_view key_prefix,
+      int64_t limit) const override;
+
+  // Counts the sampled lookups of keys found in the maps in
+  // `hot_key_sketch_`. Fails if it is already enabled.
+  absl::Status EnableHotKeyTracking(int32_t sample_rate) override;
+
+  // Reads `hot_key_sketch_`, without taking the locks of the maps. Sets are
+  // reported under the prefix of one of their values.
+  HotKeys GetHotKeys(int64_t num_keys_per_prefix) const override;
+
+  // Spills cold values into a log created with `cold_value_log_options`, if
+  // set. Keeps all values in memory if the log cannot be created.
+  static std::unique_ptr<Cache> Create(
+      bool intern_set_values = false, bool precompute_json_values = false,
+      bool compress_values = false, bool deduplicate_values = false,
+      std::optional<ColdValueLog::Options> cold_value_log_options =
+          std::nullopt);
 
  private:
+  // Sorted mapping from the logical timestamp to the values deleted from the
+  // sets of keys at that time.
+  using DeletedSetValues = absl::btree_map<
+      int64_t,
+      absl::flat_hash_map<std::string, absl::flat_hash_set<std::string>>>;
+  using DeletedUInt32SetValues = absl::btree_map<
+      int64_t, absl::flat_hash_map<std::string, std::vector<uint32_t>>>;
+
+  // Saturating count of the lookups of a value, updated while `mutex_` is
+  // only held shared.
+  class LookupCount {
+   public:
+    LookupCount() = default;
+    LookupCount(const LookupCount& other) : count_(other.Get()) {}
+    LookupCount& operator=(const LookupCount& other) {
+      count_.store(other.Get(), std::memory_order_relaxed);
+      return *this;
+    }
+
+    void Add() const {
+      if (Get() < UINT8_MAX) {
+        count_.fetch_add(1, std::memory_order_relaxed);
+      }
+    }
+    uint8_t Get() const { return count_.load(std::memory_order_relaxed); }
+    // Halves the count, so that it reflects recent lookups more.
+    void Decay() const {
+      count_.store(Get() / 2, std::memory_order_relaxed);
+    }
+
+   private:
+    mutable std::atomic<uint8_t> count_ = 0;
+  };
+
   struct CacheValue {
-    // We need to be able to set the value to null. For deletion we're keeping
-    // the timestamp of the key (to prevent a specific type of out of order
-    // delete-update messages issue) until it is later cleaned up.
-    // We've also considered using optional, but it takes more space.
-    // sizeof(string) + sizeof(bool) -- for optional
-    // sizeof(string*) when null, sizeof(string*) + sizeof(string) otherwise
-    // -- for the unique pointer
-    std::unique_ptr<std::string> value;
+    // We need to be able to mark the value as deleted. For deletion we're
+    // keeping the timestamp of the key (to prevent a specific type of out of
+    // order delete-update messages issue) until it is later cleaned up.
     int64_t last_logical_commit_time;
+    // Slab of `arena_` that holds the key and the value, in its stored form.
+    // The value of a deleted key is empty.
+    uint32_t slab_id;
+    bool is_deleted;
+    // Prefix of the last update or deletion of the key.
+    PrefixCounters::Id prefix_id;
+    // Only counted if values are spilled into `cold_value_log_`.
+    LookupCount lookups;
   };
   struct SetValueMeta {
     // Last logical commit time for a value
@@ -101,16 +284,147 @@ class KeyValueCache : public Cache {
     // because after deletion, this value should still exist in case
     // there are late-arriving updates to this.
     bool is_deleted;
-    SetValueMeta() : last_logical_commit_time(0), is_deleted(false) {}
-    SetValueMeta(int64_t logical_commit_time, bool deleted)
-        : last_logical_commit_time(logical_commit_time), is_deleted(deleted) {}
+    // Prefix of the last update or deletion of the value.
+    PrefixCounters::Id prefix_id;
+    SetValueMeta()
+        : last_logical_commit_time(0), is_deleted(false), prefix_id(0) {}
+    SetValueMeta(int64_t logical_commit_time, bool deleted,
+                 PrefixCounters::Id prefix)
+        : last_logical_commit_time(logical_commit_time),
+          is_deleted(deleted),
+          prefix_id(prefix) {}
+  };
+  using ValueSet = CompactStringMap<SetValueMeta>;
+  // Set of 32-bit unsigned integers of a key. `values` holds the values of
+  // `metas` that are not deleted.
+  struct UInt32ValueSet {
+    RoaringBitmap values;
+    absl::flat_hash_map<uint32_t, SetValueMeta> metas;
   };
+  // Contents of a checkpoint, with views of its keys and values.
+  struct CheckpointImage {
+    struct KeyValue {
+      std::string_view key;
+      std::string_view value;
+      int64_t logical_commit_time;
+      bool is_deleted;
+      // Index in `prefixes`.
+      int64_t prefix;
+    };
+    struct DeletedKey {
+      std::string_view prefix;
+      int64_t logical_commit_time;
+      std::string_view key;
+    };
+    struct CleanupTime {
+      std::string_view prefix;
+      int64_t logical_commit_time;
+    };
+    struct SetValue {
+      std::string_view value;
+      // `meta.prefix_id` is unset, the prefix is the one at index `prefix` in
+      // `prefixes`.
+      SetValueMeta meta;
+      int64_t prefix;
+    };
+    struct KeyValueSet {
+      std::string_view key;
+      // Number of the next values of `set_values` that belong to the set.
+      size_t num_values;
+    };
+    struct DeletedSetValue {
+      std::string_view prefix;
+      int64_t logical_commit_time;
+      std::string_view key;
+      std::string_view value;
+    };
+    std::vector<KeyValue> key_values;
+    std::vector<DeletedKey> deleted_keys;
+    std::vector<CleanupTime> cleanup_times;
+    std::vector<CleanupTime> set_cleanup_times;
+    std::vector<KeyValueSet> key_value_sets;
+    std::vector<SetValue> set_values;
+    std::vector<DeletedSetValue> deleted_set_values;
+    struct UInt32SetValue {
+      uint32_t value;
+      SetValueMeta meta;
+      int64_t prefix;
+    };
+    struct DeletedUInt32SetValue {
+      std::string_view prefix;
+      int64_t logical_commit_time;
+      std::string_view key;
+      uint32_t value;
+    };
+    std::vector<KeyValueSet> key_uint32_value_sets;
+    std::vector<UInt32SetValue> uint32_set_values;
+    std::vector<DeletedUInt32SetValue> deleted_uint32_set_values;
+    // Prefixes of the keys and set values, indexed by the ids they had in the
+    // cache that wrote the checkpoint.
+    std::vector<std::string_view> prefixes;
+    // Whether the values of `key_values` are already in their stored form,
+    // see `ToStoredValue`, rather than as loaded.
+    bool values_stored = false;
+  };
+  // Number of partitions of the changes staged by a bulk load, by the hash of
+  // their keys, so that loading threads rarely wait for each other and every
+  // partition is merged on its own.
+  static constexpr size_t kNumBulkLoadPartitions = 64;
+  // Change staged by a bulk load.
+  struct StagedMutation {
+    CacheMutation::Type type;
+    // Views of the copies of the key and value in the arena of the partition.
+    std::string_view key;
+    std::string_view value;
+    // Range of the values of a set in the `set_values` or `uint32_set_values`
+    // of the partition.
+    size_t first_value;
+    size_t num_values;
+    int64_t logical_commit_time;
+    // Index in `BulkLoad::prefixes`.
+    int64_t prefix;
+  };
+  struct BulkLoadPartition {
+    absl::Mutex mutex;
+    KeyValueArena arena ABSL_GUARDED_BY(mutex) = KeyValueArena(
+        KeyValueArena::kDefaultSlabSize, /*use_huge_pages=*/false);
+    // In the order they were staged.
+    std::vector<StagedMutation> mutations ABSL_GUARDED_BY(mutex);
+    std::vector<std::string_view> set_values ABSL_GUARDED_BY(mutex);
+    std::vector<uint32_t> uint32_set_values ABSL_GUARDED_BY(mutex);
+  };
+  struct BulkLoad {
+    absl::Mutex prefixes_mutex;
+    std::vector<std::string> prefixes ABSL_GUARDED_BY(prefixes_mutex);
+    // Latest time passed to `RemoveDeletedKeys` by index in `prefixes`.
+    absl::flat_hash_map<int64_t, int64_t> cleanup_times
+        ABSL_GUARDED_BY(prefixes_mutex);
+    std::array<BulkLoadPartition, kNumBulkLoadPartitions> partitions;
+
+    // Returns the index of `prefix` in `prefixes`, adding it if needed.
+    int64_t PrefixIndex(std::string_view prefix)
+        ABSL_EXCLUSIVE_LOCKS_REQUIRED(prefixes_mutex);
+  };
+  // Number of locks shared by the value sets of all keys. A value set is
+  // guarded by the lock of its key's stripe.
+  static constexpr size_t kNumValueSetStripes = 64;
+
   // mutex for key value map;
   mutable absl::Mutex mutex_;
   // mutex for key value set map;
   mutable absl::Mutex set_map_mutex_;
-  // Mapping from a key to its value
-  absl::flat_hash_map<std::string, CacheValue> map_ ABSL_GUARDED_BY(mutex_);
+  mutable std::array<absl::Mutex, kNumValueSetStripes> value_set_mutexes_;
+  // Storage for the keys and values of `map_`.
+  KeyValueArena arena_ ABSL_GUARDED_BY(mutex_);
+  // Mapping from a key to its value. Keys are views of the records in
+  // `arena_`, with the value stored right after the key. If
+  // `precompute_json_values_`, stored values are laid out as described in
+  // precomputed_json_value.h. If `value_compressor_` is set, that layout is
+  // stored compressed. If `value_store_` or `cold_value_log_` is set, the
+  // record holds the stored value, its id in `value_store_` or its location
+  // in `cold_value_log_`, see `ToArenaValue`.
+  absl::flat_hash_map<std::string_view, CacheValue, KeyHash, KeyEq> map_
+      ABSL_GUARDED_BY(mutex_);
 
   // Sorted mapping from the logical timestamp to a key, for nodes that were
   // deleted We keep this to do proper and efficient clean up in map_.
@@ -138,23 +452,329 @@ class KeyValueCache : public Cache {
   // value string, and value is the ValueMeta. The inner map allows value
   // look up to check the meta data to determine to state of the value
   // in the cache, like logical commit time and whether the value
-  // is deleted or not.
-  absl::flat_hash_map<
-      std::string,
-      std::unique_ptr<std::pair<
-          absl::Mutex, absl::flat_hash_map<std::string, SetValueMeta>>>>
+  // is deleted or not. The inner maps are guarded by `ValueSetMutex` of
+  // their key, and must not move while that lock is held.
+  absl::node_hash_map<std::string, ValueSet, KeyHash, KeyEq>
       key_to_value_set_map_ ABSL_GUARDED_BY(set_map_mutex_);
+  const bool precompute_json_values_ = false;
+  // Set if set values are interned, null otherwise.
+  const std::shared_ptr<ValueInterner> value_interner_;
+  // Set if values are stored compressed, null otherwise.
+  const std::shared_ptr<ValueCompressor> value_compressor_;
+  // Set if values of `map_` are deduplicated, null otherwise. Every record of
+  // `arena_` that holds an id holds a reference to it.
+  const std::shared_ptr<ValueInterner> value_store_;
+  // Set if cold values are spilled to disk, null otherwise. Every record of
+  // `arena_` that holds a location holds a reference to it.
+  const std::shared_ptr<ColdValueLog> cold_value_log_;
+  // When interning, mapping from every key of `key_to_value_set_map_` to the
+  // ids of the values of its set that are not deleted. Every value in
+  // `key_to_value_set_map_` holds a reference to its id. The bitmaps are
+  // guarded like the value sets.
+  absl::node_hash_map<std::string, RoaringBitmap, KeyHash, KeyEq>
+      key_to_value_ids_map_ ABSL_GUARDED_BY(set_map_mutex_);
+  // Mapping from every key of `key_to_value_set_map_` to the snapshot of its
+  // set, null until the set is looked up and again once it changes. The
+  // snapshots are accessed atomically, with the `ValueSetMutex` of their key
+  // held shared by lookups, which build the missing ones, or exclusively by
+  // updates, which drop them.
+  mutable absl::node_hash_map<std::string,
+                              std::shared_ptr<const ValueSetSnapshot>, KeyHash,
+                              KeyEq>
+      key_to_value_set_snapshot_map_ ABSL_GUARDED_BY(set_map_mutex_);
   // The key of outer map is the prefix, and value is the sorted mapping
   // from logical timestamp to key-value_set map to keep track of
   // deleted key-values to handle out of order update case. In the inner map,
   // the key string is the key for the values, and the string
   // in the flat_hash_set is the value
-  absl::flat_hash_map<
-      std::string,
-      absl::btree_map<
-          int64_t,
-          absl::flat_hash_map<std::string, absl::flat_hash_set<std::string>>>>
-      deleted_set_nodes_map_ ABSL_GUARDED_BY(set_map_mutex_);
+  absl::flat_hash_map<std::string, DeletedSetValues> deleted_set_nodes_map_
+      ABSL_GUARDED_BY(set_map_mutex_);
+  // Mapping from a key to its set of 32-bit unsigned integers, with the
+  // deleted values of every prefix like `deleted_set_nodes_map_`. Guarded
+  // like the value sets, and cleaned up with them.
+  absl::node_hash_map<std::string, UInt32ValueSet, KeyHash, KeyEq>
+      key_to_uint32_value_set_map_ ABSL_GUARDED_BY(set_map_mutex_);
+  absl::flat_hash_map<std::string, DeletedUInt32SetValues>
+      deleted_uint32_set_nodes_map_ ABSL_GUARDED_BY(set_map_mutex_);
+  // Amount of data of every prefix in `map_` and `key_to_value_set_map_`.
+  PrefixCounters prefix_counters_;
+  // Keys of the sets of `key_to_value_set_map_` that hold every value that is
+  // not deleted, once `index_set_values_` is set. Updated under the
+  // `ValueSetMutex` of the key, or `set_map_mutex_` for new keys.
+  std::atomic<bool> index_set_values_ = false;
+  SetValueIndex set_value_index_;
+  // Keys of `map_` that are not deleted, once `index_keys_` is set. Updated
+  // under `mutex_`.
+  std::atomic<bool> index_keys_ = false;
+  SortedKeyIndex sorted_key_index_;
+  // Lookups of keys, once `EnableHotKeyTracking` was called. Owned by
+  // `hot_key_sketch_owner_` and read without locks.
+  std::atomic<HotKeySketch*> hot_key_sketch_ = nullptr;
+  std::unique_ptr<HotKeySketch> hot_key_sketch_owner_ ABSL_GUARDED_BY(mutex_);
+  // Held shared while changes are staged into `bulk_load_`, and exclusively
+  // while the bulk load starts or finishes.
+  absl::Mutex bulk_load_mutex_;
+  std::unique_ptr<BulkLoad> bulk_load_ ABSL_GUARDED_BY(bulk_load_mutex_);
+  // Whether `bulk_load_` is set, read first so that changes outside of bulk
+  // loads do not take `bulk_load_mutex_`.
+  std::atomic<bool> bulk_loading_ = false;
+
+  // Stages `mutations` into `bulk_load_` and returns true if a bulk load is in
+  // progress, otherwise returns false for them to be applied.
+  bool StageBulkLoad(absl::Span<const CacheMutation> mutations,
+                     std::string_view prefix)
+      ABSL_LOCKS_EXCLUDED(bulk_load_mutex_);
+  bool StageBulkLoad(const CacheMutation& mutation, std::string_view prefix)
+      ABSL_LOCKS_EXCLUDED(bulk_load_mutex_) {
+    return StageBulkLoad(absl::MakeConstSpan(&mutation, 1), prefix);
+  }
+  // Same for the cleanup time passed to `RemoveDeletedKeys`.
+  bool StageBulkLoadCleanup(int64_t logical_commit_time,
+                            std::string_view prefix)
+      ABSL_LOCKS_EXCLUDED(bulk_load_mutex_);
+  // Finishes the bulk load, merging its partitions on up to `num_threads`
+  // threads.
+  absl::Status FinishBulkLoadOnThreads(int num_threads)
+      ABSL_LOCKS_EXCLUDED(bulk_load_mutex_);
+  // Adds the latest change of every key and set value staged in `partition`
+  // to `image`, skipping the deleted ones at or before the cleanup time of
+  // their prefix in `cleanup_times`. `prefixes` are the prefixes of the bulk
+  // load. Values are added in their stored form, kept in `stored_values`.
+  void MergeBulkLoadPartition(
+      BulkLoadPartition& partition,
+      const absl::flat_hash_map<int64_t, int64_t>& cleanup_times,
+      absl::Span<const std::string_view> prefixes,
+      KeyValueArena& stored_values, CheckpointImage& image) const;
+
+  // Same as `UpdateKeyValue` and `DeleteKey`, without recording metrics.
+  void UpdateKeyValueLocked(std::string_view key, std::string_view value,
+                            int64_t logical_commit_time,
+                            std::string_view prefix)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  void DeleteKeyLocked(std::string_view key, int64_t logical_commit_time,
+                       std::string_view prefix)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  // Adds the value set of `key`, which must not exist yet, with all `values`
+  // marked deleted if `is_deleted`.
+  void AddValueSet(std::string_view key, absl::Span<std::string_view> values,
+                   int64_t logical_commit_time, bool is_deleted,
+                   PrefixCounters::Id prefix_id)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(set_map_mutex_);
+
+  // Adds or deletes `values` in the existing `value_set` of `key`, whose
+  // `ValueSetMutex` must be held, skipping values changed at or after
+  // `logical_commit_time`. `value_ids` are the ids of the set, or null if
+  // values are not interned. `snapshot` is the snapshot of the set, dropped if
+  // any value is added or deleted. `DeleteValues` returns the values it marked
+  // deleted.
+  void UpdateValues(std::string_view key, ValueSet& value_set,
+                    RoaringBitmap* value_ids,
+                    std::shared_ptr<const ValueSetSnapshot>* snapshot,
+                    absl::Span<std::string_view> values,
+                    int64_t logical_commit_time, PrefixCounters::Id prefix_id);
+  std::vector<std::string_view> DeleteValues(
+      std::string_view key, ValueSet& value_set, RoaringBitmap* value_ids,
+      std::shared_ptr<const ValueSetSnapshot>* snapshot,
+      absl::Span<std::string_view> values, int64_t logical_commit_time,
+      PrefixCounters::Id prefix_id);
+
+  // Adds `sign` times the entry of `key`, a key of `arena_`, or the set value
+  // of `meta` to `prefix_counters_`.
+  void CountEntry(std::string_view key, const CacheValue& cache_value,
+                  int64_t sign);
+  void CountSetValue(const SetValueMeta& meta, int64_t sign);
+
+  // Adds `values` to the set of 32-bit unsigned integers of `key`, or marks
+  // them deleted if `is_deleted`, skipping values changed at or after
+  // `logical_commit_time`. Takes the `ValueSetMutex` of `key`.
+  void ChangeUInt32Values(std::string_view key,
+                          absl::Span<const uint32_t> values,
+                          int64_t logical_commit_time, bool is_deleted,
+                          std::string_view prefix)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(set_map_mutex_);
+
+  // Looks up `keys`, which are distinct, and adds the existing key-value
+  // pairs to `kv_pairs`. Does not record any metrics.
+  void CollectKeyValuePairs(
+      absl::Span<const HashedKey> keys,
+      absl::flat_hash_map<std::string, std::string>& kv_pairs) const;
+
+  // Looks up `keys`, which are distinct, and adds views of the existing values
+  // to `result`. Does not record any metrics.
+  void CollectKeyValues(absl::Span<const HashedKey> keys,
+                        GetKeyValueResult& result) const;
+
+  // Same as above, instantiated with the `ValuePolicy` of the cache, see
+  // `WithValuePolicy`.
+  template <typename Policy>
+  void CollectKeyValuePairs(
+      absl::Span<const HashedKey> keys,
+      absl::flat_hash_map<std::string, std::string>& kv_pairs) const;
+  template <typename Policy>
+  void CollectKeyValues(absl::Span<const HashedKey> keys,
+                        GetKeyValueResult& result) const;
+
+  // Calls `fn` with the `ValuePolicy` of the value options of this cache,
+  // defined in the .cc file. The value lookups are instantiated for every
+  // combination of the options, and the one of the cache is picked once per
+  // lookup, so that the lookup of every key only runs the code of the options
+  // the cache has.
+  template <typename Fn>
+  void WithValuePolicy(Fn&& fn) const;
+
+  // Looks up `keys`, which are distinct, and adds the existing value sets to
+  // `result`. Returns true if at least one key was found. Does not record any
+  // metrics.
+  bool CollectKeyValueSets(absl::Span<const HashedKey> keys,
+                           GetKeyValueSetResult& result) const;
+  // Returns the snapshot of `value_set`, the set of `key`, building it if it
+  // is missing. The `ValueSetMutex` of `key` must be held.
+  std::shared_ptr<const ValueSetSnapshot> SnapshotOf(
+      const HashedKey& key, const ValueSet& value_set) const
+      ABSL_SHARED_LOCKS_REQUIRED(set_map_mutex_);
+  bool CollectUInt32ValueSets(absl::Span<const HashedKey> keys,
+                              GetUInt32ValueSetResult& result) const;
+
+  // Marks keys without any update in the results of `LastUpdateTimes` and
+  // `NewestSetValueTime`.
+  static constexpr int64_t kNoUpdate = std::numeric_limits<int64_t>::min();
+
+  // Returns the logical commit time of the last update or deletion of the
+  // value of every key of `keys`, or `kNoUpdate`.
+  std::vector<int64_t> LastUpdateTimes(absl::Span<const HashedKey> keys) const;
+
+  // Returns whether every key of `keys` has a value set, which may only hold
+  // deleted values.
+  std::vector<bool> HasValueSets(absl::Span<const HashedKey> keys) const;
+  std::vector<bool> HasUInt32ValueSets(absl::Span<const HashedKey> keys) const;
+
+  // Returns the logical commit time of the newest value in the set of `key`
+  // that is not deleted, or `kNoUpdate`. Visits every value of the set.
+  int64_t NewestSetValueTime(const HashedKey& key) const;
+  int64_t NewestUInt32SetValueTime(const HashedKey& key) const;
+
+  // Cold values read ahead of a lookup, by the key of `map_` they are stored
+  // under.
+  using ColdValues = absl::flat_hash_map<std::string_view, std::string>;
+
+  // Reads the cold values of `keys` from `cold_value_log_` in one batch, so
+  // that a lookup of many keys waits for the disk once. Values that fail to
+  // be read are logged and read as empty.
+  ColdValues ReadColdValues(absl::Span<const HashedKey> keys) const
+      ABSL_SHARED_LOCKS_REQUIRED(mutex_);
+
+  // Returns the value of `key`, a key of `map_`, without its precomputed JSON
+  // form. The view may be into `buffer`, which compressed values are
+  // decompressed into.
+  std::string_view ValueOf(std::string_view key, std::string& buffer,
+                           ColdValues* cold_values = nullptr) const
+      ABSL_SHARED_LOCKS_REQUIRED(mutex_);
+
+  // Returns the stored value of `key`, decompressed into `buffer` if values
+  // are compressed. Values that fail to decompress are logged and read as
+  // empty.
+  std::string_view UncompressedValueOf(std::string_view key,
+                                       std::string& buffer,
+                                       ColdValues* cold_values = nullptr) const
+      ABSL_SHARED_LOCKS_REQUIRED(mutex_);
+
+  // Returns the stored value of `key`, a key of `map_`, looked up in
+  // `value_store_` if it is deduplicated, or read into `buffer` if it is
+  // cold. Cold values found in `cold_values` are moved into `buffer` instead
+  // of being read again. Otherwise the view is valid while `mutex_` is held.
+  // Values that fail to be read are logged and read as empty.
+  std::string_view StoredValueOf(std::string_view key, std::string& buffer,
+                                 ColdValues* cold_values = nullptr) const
+      ABSL_SHARED_LOCKS_REQUIRED(mutex_);
+  // Returns an owner that keeps the view returned by `StoredValueOf(key)`
+  // valid after `mutex_` is released. `slab_id` is the slab of `key`.
+  std::shared_ptr<const void> PinStoredValue(std::string_view key,
+                                             uint32_t slab_id) const
+      ABSL_SHARED_LOCKS_REQUIRED(mutex_);
+
+  // Same as above, skipping the checks of the options `Policy` does not have.
+  template <typename Policy>
+  std::string_view ValueOf(std::string_view key, std::string& buffer,
+                           ColdValues* cold_values) const
+      ABSL_SHARED_LOCKS_REQUIRED(mutex_);
+  template <typename Policy>
+  std::string_view UncompressedValueOf(std::string_view key,
+                                       std::string& buffer,
+                                       ColdValues* cold_values) const
+      ABSL_SHARED_LOCKS_REQUIRED(mutex_);
+  template <typename Policy>
+  std::string_view StoredValueOf(std::string_view key, std::string& buffer,
+                                 ColdValues* cold_values) const
+      ABSL_SHARED_LOCKS_REQUIRED(mutex_);
+  template <typename Policy>
+  std::shared_ptr<const void> PinStoredValue(std::string_view key,
+                                             uint32_t slab_id) const
+      ABSL_SHARED_LOCKS_REQUIRED(mutex_);
+
+  // Returns the value to add to `arena_` for `stored_value`, which is either
+  // `stored_value` itself after a tag byte, or the id of the value in
+  // `value_store_`, with one reference, after another tag byte. Cold values
+  // are stored as their location in `cold_value_log_` after a third tag byte,
+  // see `RebalanceValueTiers`. Values are only tagged if `TagsValues()`. The
+  // view may be into `buffer`.
+  std::string_view ToArenaValue(std::string_view stored_value,
+                                std::string& buffer) const;
+  // Adds or releases the reference to the id or the location of
+  // `arena_value`, if any.
+  void RetainArenaValue(std::string_view arena_value) const;
+  void ReleaseArenaValue(std::string_view arena_value) const;
+  // Returns whether records of `arena_` tag their values, see `ToArenaValue`.
+  bool TagsValues() const {
+    return value_store_ != nullptr || cold_value_log_ != nullptr;
+  }
+
+  // Returns whether values are stored in another form than they are loaded
+  // in, and `ToStoredValue` needs to be called on them.
+  bool TransformsValues() const {
+    return precompute_json_values_ || value_compressor_ != nullptr;
+  }
+  // Returns the form of `value` to store for `prefix`.
+  std::string ToStoredValue(std::string_view value,
+                            std::string_view prefix) const;
+
+  // Stores the key-value pair in `arena_` and points the entry of `key` in
+  // `map_` at it, releasing the record the entry pointed at before. `value`
+  // is returned by `ToArenaValue`, its reference is taken over.
+  void PutEntry(std::string_view key, std::string_view value,
+                int64_t logical_commit_time, bool is_deleted,
+                PrefixCounters::Id prefix_id)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  // Re-adds the live records of sparse arena slabs so that the slabs can be
+  // freed.
+  void CompactArena() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  // Spills the values looked up the least into `cold_value_log_` until at
+  // most `max_hot_value_bytes` of values are left in memory, and brings back
+  // the cold values looked up at least `promotion_lookups` times since the
+  // last call. Then decays the lookup counts of all values. Picks the values
+  // under a reader lock, and moves them in slices that hold `mutex_` for
+  // about `max_pause` each.
+  void RebalanceValueTiers(absl::Duration max_pause)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+  // Bring the cold value of `key` back into memory, or spill its value into
+  // `cold_value_log_`, unless the key was changed in the meantime so that
+  // this no longer applies.
+  void PromoteValue(std::string_view key) ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  absl::Status SpillValue(std::string_view key)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  // Reads the checkpoint of one cache written by `WriteCheckpoint`. Fails if
+  // this cache is not empty.
+  absl::StatusOr<CheckpointImage> ReadCheckpointImage(
+      CheckpointReader& reader) const;
+  // Adds the contents of `image` to this cache, which must be empty.
+  void RestoreCheckpointImage(const CheckpointImage& image);
+
+  // Returns the lock of the stripe that the value set of `key` belongs to.
+  absl::Mutex& ValueSetMutex(std::string_view key) const;
+  absl::Mutex& ValueSetMutex(const HashedKey& key) const;
 
   // Removes deleted keys from key-value map for a given prefix
   void CleanUpKeyValueMap(int64_t logical_commit_time, std::string_view prefix);
@@ -162,12 +782,45 @@ class KeyValueCache : public Cache {
   // Removes deleted key-values from key-value_set map for a given prefix
   void CleanUpKeyValueSetMap(int64_t logical_commit_time,
                              std::string_view prefix);
+
+  // Raises the cleanup times of `prefix` to `logical_commit_time`, leaving the
+  // removal of the values deleted before to `RemoveDeletedKeysInSlices`.
+  void SetCleanupTime(int64_t logical_commit_time, std::string_view prefix);
+
+  // Remove the entries of `deleted_keys` and `deleted_set_values` of one
+  // prefix deleted at or before `logical_commit_time`, in the order they were
+  // deleted, until `deadline`. Return false if some of them are left.
+  bool RemoveDeletedKeyValues(int64_t logical_commit_time, absl::Time deadline,
+                              std::multimap<int64_t, std::string>& deleted_keys)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  bool RemoveDeletedSetValues(int64_t logical_commit_time, absl::Time deadline,
+                              DeletedSetValues& deleted_set_values)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(set_map_mutex_);
+  bool RemoveDeletedUInt32SetValues(
+      int64_t logical_commit_time, absl::Time deadline,
+      DeletedUInt32SetValues& deleted_set_values)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(set_map_mutex_);
+
+  // Removes the values deleted at or before the cleanup times recorded by
+  // `RemoveDeletedKeys`, in slices that hold `mutex_` and `set_map_mutex_`
+  // for about `max_pause` each. Returns the number of deleted keys and set
+  // values left, which were deleted after those times.
+  int64_t RemoveDeletedKeysInSlices(absl::Duration max_pause);
   // Logs cache access metrics for cache hit or miss counts. The cache access
   // event name is defined in server_definition.h file
   void LogCacheAccessMetrics(const RequestContext& request_context,
                              std::string_view cache_access_event) const;
 
+  // Set once deleted values are removed in the background rather than by
+  // `RemoveDeletedKeys`.
+  std::atomic<bool> cleanup_in_background_ = false;
+  // Runs the background cleanup, if started by this cache.
+  std::unique_ptr<PeriodicClosure> cleanup_closure_;
+
   friend class KeyValueCacheTestPeer;
+  friend class EpochKeyValueCache;
+  friend class ShardedKeyValueCache;
+  friend class PrefixedKeyValueCache;
 };
 }  // namespace kv_server
 
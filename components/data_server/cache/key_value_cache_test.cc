@@ -15,7 +15,11 @@
 #include "components/data_server/cache/key_value_cache.h"
 
 #include <algorithm>
+#include <cstdint>
+#include <filesystem>
 #include <memory>
+#include <optional>
+#include <sstream>
 #include <string>
 #include <string_view>
 #include <thread>
@@ -23,11 +27,18 @@
 #include <vector>
 
 #include "absl/container/flat_hash_map.h"
+#include "absl/strings/str_cat.h"
 #include "absl/synchronization/notification.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
 #include "components/data_server/cache/cache.h"
+#include "components/data_server/cache/checkpoint_io.h"
+#include "components/data_server/cache/cold_value_log.h"
 #include "components/data_server/cache/get_key_value_set_result.h"
+#include "components/data_server/cache/key_value_arena.h"
 #include "components/data_server/cache/mocks.h"
 #include "gmock/gmock.h"
+#include "google/protobuf/struct.pb.h"
 #include "gtest/gtest.h"
 #include "public/base_types.pb.h"
 #include "src/telemetry/telemetry_provider.h"
@@ -45,11 +56,17 @@ class KeyValueCacheTestPeer {
                ? std::multimap<int64_t, std::string>()
                : c.deleted_nodes_map_.find(prefix)->second;
   }
-  static absl::flat_hash_map<std::string, kv_server::KeyValueCache::CacheValue>&
+  static absl::flat_hash_map<std::string_view,
+                             kv_server::KeyValueCache::CacheValue, KeyHash,
+                             KeyEq>&
   ReadNodes(KeyValueCache& c) {
     absl::MutexLock lock(&c.mutex_);
     return c.map_;
   }
+  static const KeyValueArena& ReadArena(KeyValueCache& c) {
+    absl::MutexLock lock(&c.mutex_);
+    return c.arena_;
+  }
 
   static int GetDeletedSetNodesMapSize(const KeyValueCache& c,
                                        std::string prefix = "") {
@@ -81,23 +98,47 @@ class KeyValueCacheTestPeer {
                                                      std::string_view value) {
     absl::MutexLock lock(&c.set_map_mutex_);
     auto iter = c.key_to_value_set_map_.find(key);
-    return iter->second->second.find(value)->second;
+    return *iter->second.find(value);
   }
   static int GetSetValueSize(const KeyValueCache& c, std::string_view key) {
     absl::MutexLock lock(&c.set_map_mutex_);
     auto iter = c.key_to_value_set_map_.find(key);
-    return iter->second->second.size();
+    return iter->second.size();
+  }
+
+  static void RebalanceValueTiers(KeyValueCache& c) {
+    c.RebalanceValueTiers(absl::InfiniteDuration());
+  }
+  // Returns the size of the record of the value of `key` in the arena.
+  static size_t GetArenaValueSize(const KeyValueCache& c,
+                                  std::string_view key) {
+    absl::MutexLock lock(&c.mutex_);
+    return KeyValueArena::ValueOf(c.map_.find(key)->first).size();
+  }
+
+  static size_t GetInternedValueCount(const KeyValueCache& c) {
+    return c.value_interner_->size();
   }
 
   static void CallCacheCleanup(KeyValueCache& c, int64_t logical_commit_time) {
     c.RemoveDeletedKeys(logical_commit_time);
   }
+
+  static int64_t RemoveDeletedKeysInSlices(KeyValueCache& c,
+                                           absl::Duration max_pause) {
+    return c.RemoveDeletedKeysInSlices(max_pause);
+  }
 };
 
 namespace {
 
 using privacy_sandbox::server_common::TelemetryProvider;
+using testing::AllOf;
+using testing::Field;
+using testing::IsEmpty;
+using testing::Pair;
 using testing::UnorderedElementsAre;
+using testing::UnorderedElementsAreArray;
 
 class CacheTest : public ::testing::Test {
  protected:
@@ -124,6 +165,58 @@ TEST_F(CacheTest, RetrievesMatchingEntry) {
   EXPECT_THAT(kv_pairs, UnorderedElementsAre(KVPairEq("my_key", "my_value")));
 }
 
+TEST_F(CacheTest, GetKeyValuesReturnsViewsOfMatchingEntries) {
+  std::unique_ptr<Cache> cache = KeyValueCache::Create();
+  cache->UpdateKeyValue("key1", "value1", 1);
+  cache->UpdateKeyValue("key2", "value2", 1);
+  auto result =
+      cache->GetKeyValues(GetRequestContext(), {"key1", "key2", "missing"});
+  EXPECT_EQ(result->size(), 2);
+  EXPECT_EQ(result->GetValue("key1"), "value1");
+  EXPECT_EQ(result->GetValue("key2"), "value2");
+  EXPECT_EQ(result->GetValue("missing"), std::nullopt);
+  EXPECT_EQ(result->GetSerializedJsonValue("key1"), std::nullopt);
+}
+
+TEST_F(CacheTest, GetKeyValuesResultOutlivesUpdateAndCleanup) {
+  std::unique_ptr<Cache> cache = KeyValueCache::Create();
+  cache->UpdateKeyValue("my_key", "my_value", 1);
+  auto result = cache->GetKeyValues(GetRequestContext(), {"my_key"});
+  cache->UpdateKeyValue("my_key", "my_new_value", 2);
+  cache->DeleteKey("my_key", 3);
+  cache->RemoveDeletedKeys(4);
+  EXPECT_EQ(result->GetValue("my_key"), "my_value");
+  EXPECT_EQ(cache->GetKeyValues(GetRequestContext(), {"my_key"})->size(), 0);
+}
+
+TEST_F(CacheTest, GetKeyValuesReturnsPrecomputedJsonValues) {
+  std::unique_ptr<Cache> cache = KeyValueCache::Create(
+      /*intern_set_values=*/false, /*precompute_json_values=*/true);
+  cache->UpdateKeyValue("json", R"({"a":1})", 1);
+  cache->ApplyBatch(std::vector<CacheMutation>{
+      {CacheMutation::Type::kUpdateKeyValue, "string", "value", {}, 1},
+      {CacheMutation::Type::kUpdateKeyValue, "number", "2", {}, 1},
+  });
+  auto result = cache->GetKeyValues(GetRequestContext(),
+                                    {"json", "string", "number", "missing"});
+  EXPECT_EQ(result->GetValue("json"), R"({"a":1})");
+  EXPECT_EQ(result->GetValue("string"), "value");
+  EXPECT_EQ(result->GetValue("number"), "2");
+  google::protobuf::Value value;
+  ASSERT_TRUE(value.ParseFromString(
+      std::string(*result->GetSerializedJsonValue("json"))));
+  EXPECT_EQ(value.struct_value().fields().at("a").number_value(), 1);
+  ASSERT_TRUE(value.ParseFromString(
+      std::string(*result->GetSerializedJsonValue("number"))));
+  EXPECT_EQ(value.number_value(), 2);
+  EXPECT_EQ(result->GetSerializedJsonValue("string"), "");
+  EXPECT_EQ(result->GetSerializedJsonValue("missing"), std::nullopt);
+  // Other lookups only see the values.
+  EXPECT_THAT(cache->GetKeyValuePairs(GetRequestContext(), {"json", "string"}),
+              UnorderedElementsAre(KVPairEq("json", R"({"a":1})"),
+                                   KVPairEq("string", "value")));
+}
+
 TEST_F(CacheTest, GetWithMultipleKeysReturnsMatchingValues) {
   std::unique_ptr<Cache> cache = KeyValueCache::Create();
   cache->UpdateKeyValue("key1", "value1", 1);
@@ -196,6 +289,8 @@ TEST_F(CacheTest, GetForCacheMissingKeyReturnsEmptySet) {
   EXPECT_EQ(get_key_value_set_result->GetValueSet("missing_key").size(), 0);
   EXPECT_THAT(get_key_value_set_result->GetValueSet("my_key"),
               UnorderedElementsAre("v1", "v2"));
+  EXPECT_EQ(get_key_value_set_result->GetValueSetSize("missing_key"), 0);
+  EXPECT_EQ(get_key_value_set_result->GetValueSetSize("my_key"), 2);
 }
 
 TEST_F(CacheTest, DeleteKeyTestRemovesKeyEntry) {
@@ -257,12 +352,6 @@ TEST_F(CacheTest, DeleteKeyValueSetWrongKeyDoesNotRemoveKeyValueEntry) {
   EXPECT_THAT(result->GetValueSet("my_key"),
               UnorderedElementsAre("v1", "v2", "v3"));
   EXPECT_EQ(result->GetValueSet("wrong_key").size(), 0);
-  // Reset the unique pointer to destroy the GetKeyValueSetResult object which
-  // holds the key locks in the cache map. This reset is required before calling
-  // the GetSetValueMeta to avoid potential deadlocks,
-  // as the "GetSetValueMeta" call will need to acquire the
-  // cache map lock in the same thread.
-  result.reset();
 
   auto value_meta_v1 =
       KeyValueCacheTestPeer::GetSetValueMeta(*cache, "my_key", "v1");
@@ -546,6 +635,63 @@ TEST_F(CacheTest, CleanupTimestampsCantInsertOldRecordsAfterCleanup) {
   EXPECT_EQ(kv_pairs.size(), 0);
 }
 
+TEST_F(CacheTest, RemoveDeletedKeysCompactsSparseArenaSlabs) {
+  std::unique_ptr<KeyValueCache> cache = std::make_unique<KeyValueCache>();
+  const std::string value(1024, 'v');
+  std::vector<std::string> keys;
+  for (int i = 0; i < 4096; i++) {
+    keys.push_back(absl::StrCat("key", i));
+    cache->UpdateKeyValue(keys.back(), absl::StrCat(value, i), 1);
+  }
+  const size_t allocated_bytes =
+      KeyValueCacheTestPeer::ReadArena(*cache).allocated_bytes();
+  // Keys are added in order, so deleting three out of four keys leaves every
+  // full slab sparse.
+  for (size_t i = 0; i < keys.size(); i++) {
+    if (i % 4 != 0) {
+      cache->DeleteKey(keys[i], 2);
+    }
+  }
+  cache->RemoveDeletedKeys(3);
+
+  EXPECT_LT(KeyValueCacheTestPeer::ReadArena(*cache).allocated_bytes(),
+            allocated_bytes / 2);
+  absl::flat_hash_set<std::string_view> key_set(keys.begin(), keys.end());
+  auto kv_pairs = cache->GetKeyValuePairs(GetRequestContext(), key_set);
+  EXPECT_EQ(kv_pairs.size(), keys.size() / 4);
+  for (size_t i = 0; i < keys.size(); i += 4) {
+    EXPECT_EQ(kv_pairs[keys[i]], absl::StrCat(value, i));
+  }
+}
+
+TEST_F(CacheTest, UpdatesFreeArenaSlabsOfReplacedValues) {
+  std::unique_ptr<KeyValueCache> cache = std::make_unique<KeyValueCache>();
+  const std::string value(1024, 'v');
+  for (int64_t logical_commit_time = 1; logical_commit_time < 10;
+       logical_commit_time++) {
+    for (int i = 0; i < 1024; i++) {
+      cache->UpdateKeyValue(absl::StrCat("key", i), value,
+                            logical_commit_time);
+    }
+  }
+  const KeyValueArena& arena = KeyValueCacheTestPeer::ReadArena(*cache);
+  EXPECT_LT(arena.allocated_bytes(), 4 * arena.live_bytes());
+}
+
+TEST_F(CacheTest, GetKeyValuesResultOutlivesArenaCompaction) {
+  std::unique_ptr<KeyValueCache> cache = std::make_unique<KeyValueCache>();
+  const std::string value(1024, 'v');
+  for (int i = 0; i < 4096; i++) {
+    cache->UpdateKeyValue(absl::StrCat("key", i), value, 1);
+  }
+  auto result = cache->GetKeyValues(GetRequestContext(), {"key0"});
+  for (int i = 1; i < 4096; i++) {
+    cache->DeleteKey(absl::StrCat("key", i), 2);
+  }
+  cache->RemoveDeletedKeys(3);
+  EXPECT_EQ(result->GetValue("key0"), value);
+}
+
 TEST_F(CacheTest, CleanupTimestampsInsertKeyValueSetDoesntUpdateDeletedNodes) {
   std::unique_ptr<KeyValueCache> cache = std::make_unique<KeyValueCache>();
   std::vector<std::string_view> values = {"my_value"};
@@ -794,6 +940,21 @@ TEST_F(CacheTest, ConcurrentGetAndUpdateExpectUpdate) {
   }
 }
 
+TEST_F(CacheTest, ResultKeepsValueSetOfLookupWhileSetIsUpdated) {
+  KeyValueCache cache;
+  std::vector<std::string_view> values = {"v1"};
+  cache.UpdateKeyValueSet("key1", absl::MakeSpan(values), 1);
+  auto result = cache.GetKeyValueSet(GetRequestContext(), {"key1"});
+  std::vector<std::string_view> new_values = {"v2"};
+  // Does not wait for `result` to be destroyed.
+  cache.UpdateKeyValueSet("key1", absl::MakeSpan(new_values), 2);
+  cache.DeleteValuesInSet("key1", absl::MakeSpan(values), 3);
+  EXPECT_THAT(result->GetValueSet("key1"), UnorderedElementsAre("v1"));
+  EXPECT_THAT(cache.GetKeyValueSet(GetRequestContext(), {"key1"})
+                  ->GetValueSet("key1"),
+              UnorderedElementsAre("v2"));
+}
+
 TEST_F(CacheTest, ConcurrentGetAndDeleteExpectNoDelete) {
   auto cache = std::make_unique<KeyValueCache>();
   absl::flat_hash_set<std::string_view> keys = {"key1"};
@@ -1069,6 +1230,148 @@ TEST_F(CacheTest, ConcurrentGetUpdateDeleteCleanUp) {
   EXPECT_THAT(look_up_result_for_key2, UnorderedElementsAre("v2"));
 }
 
+TEST_F(CacheTest, GetKeyValueSetForKeysSharingLockStripes) {
+  auto cache = std::make_unique<KeyValueCache>();
+  std::vector<std::string> keys;
+  std::vector<std::string_view> values = {"v1", "v2"};
+  for (int i = 0; i < 1000; i++) {
+    keys.push_back(absl::StrCat("key", i));
+    cache->UpdateKeyValueSet(keys.back(), absl::MakeSpan(values), 1);
+  }
+  absl::flat_hash_set<std::string_view> key_set(keys.begin(), keys.end());
+  absl::Notification start;
+  auto& request_context = GetRequestContext();
+  auto lookup = [&cache, &keys, &key_set, &start, &request_context]() {
+    start.WaitForNotification();
+    for (int i = 0; i < 10; i++) {
+      auto result = cache->GetKeyValueSet(request_context, key_set);
+      for (const auto& key : keys) {
+        EXPECT_THAT(result->GetValueSet(key), testing::Contains("v1"));
+      }
+    }
+  };
+  auto update = [&cache, &keys, &start]() {
+    start.WaitForNotification();
+    std::vector<std::string_view> new_values = {"v3"};
+    for (int64_t logical_commit_time = 2; logical_commit_time < 10;
+         logical_commit_time++) {
+      for (const auto& key : keys) {
+        cache->UpdateKeyValueSet(key, absl::MakeSpan(new_values),
+                                 logical_commit_time);
+      }
+    }
+  };
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; i++) {
+    threads.emplace_back(lookup);
+  }
+  threads.emplace_back(update);
+  start.Notify();
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  EXPECT_THAT(
+      cache->GetKeyValueSet(request_context, {"key0"})->GetValueSet("key0"),
+      UnorderedElementsAre("v1", "v2", "v3"));
+}
+
+TEST_F(CacheTest, LargeValueSetUpdateDeleteAndCleanUp) {
+  auto cache = std::make_unique<KeyValueCache>();
+  std::vector<std::string> values;
+  for (int i = 0; i < 1000; i++) {
+    values.push_back(absl::StrCat("value", i));
+  }
+  std::vector<std::string_view> value_views(values.begin(), values.end());
+  cache->UpdateKeyValueSet("key", absl::MakeSpan(value_views), 1);
+  // Deletes all but the first two values.
+  std::vector<std::string_view> values_to_delete(value_views.begin() + 2,
+                                                 value_views.end());
+  cache->DeleteValuesInSet("key", absl::MakeSpan(values_to_delete), 2);
+  EXPECT_EQ(KeyValueCacheTestPeer::GetSetValueSize(*cache, "key"), 1000);
+  cache->RemoveDeletedKeys(3);
+  EXPECT_EQ(KeyValueCacheTestPeer::GetSetValueSize(*cache, "key"), 2);
+  EXPECT_THAT(
+      cache->GetKeyValueSet(GetRequestContext(), {"key"})->GetValueSet("key"),
+      UnorderedElementsAre("value0", "value1"));
+}
+
+TEST_F(CacheTest, LargeValueSetTakesUpdatesUntilCleanUp) {
+  auto cache = std::make_unique<KeyValueCache>();
+  std::vector<std::string> values;
+  for (int i = 0; i < 1000; i++) {
+    values.push_back(absl::StrCat("https://example.com/ads/", i));
+  }
+  std::vector<std::string_view> value_views(values.begin(), values.end());
+  cache->UpdateKeyValueSet("key", absl::MakeSpan(value_views), 1);
+  std::vector<std::string_view> added_values = {"https://example.com/new"};
+  cache->UpdateKeyValueSet("key", absl::MakeSpan(added_values), 2);
+  // Deletes all but the first ten values.
+  std::vector<std::string_view> values_to_delete(value_views.begin() + 10,
+                                                 value_views.end());
+  cache->DeleteValuesInSet("key", absl::MakeSpan(values_to_delete), 2);
+  std::vector<std::string> expected(values.begin(), values.begin() + 10);
+  expected.push_back("https://example.com/new");
+  EXPECT_THAT(
+      cache->GetKeyValueSet(GetRequestContext(), {"key"})->GetValueSet("key"),
+      UnorderedElementsAreArray(expected));
+  cache->RemoveDeletedKeys(3);
+  EXPECT_EQ(KeyValueCacheTestPeer::GetSetValueSize(*cache, "key"), 11);
+  EXPECT_THAT(
+      cache->GetKeyValueSet(GetRequestContext(), {"key"})->GetValueSet("key"),
+      UnorderedElementsAreArray(expected));
+}
+
+TEST_F(CacheTest, UInt32ValueSetUpdateDeleteAndCleanUp) {
+  KeyValueCache cache;
+  const std::vector<uint32_t> values = {1, 2, 70000};
+  const std::vector<uint32_t> values_to_delete = {2, 3};
+  cache.UpdateKeyValueUInt32Set("key", values, 1);
+  cache.DeleteValuesInUInt32Set("key", values_to_delete, 2);
+  // Older than the deletion, so 2 stays deleted.
+  cache.UpdateKeyValueUInt32Set("key", values_to_delete, 1);
+  EXPECT_THAT(cache.GetUInt32ValueSet(GetRequestContext(), {"key", "missing"})
+                  ->GetValueSet("key")
+                  .ToVector(),
+              testing::ElementsAre(1, 70000));
+  EXPECT_TRUE(cache.GetUInt32ValueSet(GetRequestContext(), {"missing"})
+                  ->GetValueSet("missing")
+                  .IsEmpty());
+  // The numeric sets are separate from the key-value sets of the same key.
+  EXPECT_TRUE(cache.GetKeyValueSet(GetRequestContext(), {"key"})
+                  ->GetValueSet("key")
+                  .empty());
+
+  cache.RemoveDeletedKeys(3);
+  // Updates at or before the cleanup time are dropped.
+  cache.UpdateKeyValueUInt32Set("key", values_to_delete, 3);
+  cache.UpdateKeyValueUInt32Set("key", std::vector<uint32_t>{4}, 4);
+  EXPECT_THAT(cache.GetUInt32ValueSet(GetRequestContext(), {"key"})
+                  ->GetValueSet("key")
+                  .ToVector(),
+              testing::ElementsAre(1, 4, 70000));
+}
+
+TEST_F(CacheTest, ApplyBatchAppliesUInt32ValueSetMutations) {
+  KeyValueCache cache;
+  const std::vector<uint32_t> values = {5, 6};
+  const std::vector<uint32_t> values_to_delete = {5};
+  const std::vector<CacheMutation> mutations = {
+      {.type = CacheMutation::Type::kUpdateKeyValueUInt32Set,
+       .key = "key",
+       .logical_commit_time = 1,
+       .uint32_value_set = values},
+      {.type = CacheMutation::Type::kDeleteValuesInUInt32Set,
+       .key = "key",
+       .logical_commit_time = 2,
+       .uint32_value_set = values_to_delete},
+  };
+  cache.ApplyBatch(mutations);
+  EXPECT_THAT(cache.GetUInt32ValueSet(GetRequestContext(), {"key"})
+                  ->GetValueSet("key")
+                  .ToVector(),
+              testing::ElementsAre(6));
+}
+
 TEST_F(CacheTest, MultiplePrefixKeyValueUpdates) {
   std::unique_ptr<Cache> cache = KeyValueCache::Create();
   // Call remove deleted keys for prefix1 to update the max delete cutoff
@@ -1276,5 +1579,778 @@ TEST_F(CacheTest, MultiplePrefixTimestampKeyValueSetCleanUps) {
   EXPECT_EQ(KeyValueCacheTestPeer::GetDeletedSetNodesMapSize(*cache, "prefix2"),
             1);
 }
+
+TEST_F(CacheTest, InternedValueSetsShareIds) {
+  KeyValueCache cache(std::make_shared<ValueInterner>());
+  std::vector<std::string_view> values1 = {"v1", "v2"};
+  std::vector<std::string_view> values2 = {"v2", "v3"};
+  cache.UpdateKeyValueSet("key1", absl::Span<std::string_view>(values1), 1);
+  cache.UpdateKeyValueSet("key2", absl::Span<std::string_view>(values2), 1);
+  absl::flat_hash_set<std::string_view> keys = {"key1", "key2"};
+  auto result = cache.GetKeyValueSet(GetRequestContext(), keys);
+  ASSERT_TRUE(result->HasValueSetIds());
+  RoaringBitmap ids = *result->GetValueSetIds("key1");
+  ids.IntersectWith(*result->GetValueSetIds("key2"));
+  EXPECT_THAT(result->GetValues(ids), UnorderedElementsAre("v2"));
+  EXPECT_THAT(result->GetValueSet("key1"), UnorderedElementsAre("v1", "v2"));
+  EXPECT_TRUE(result->GetValueSetIds("missing_key")->IsEmpty());
+  EXPECT_EQ(result->GetValueSetSize("key2"), 2);
+  EXPECT_EQ(result->GetValueSetSize("missing_key"), 0);
+  EXPECT_EQ(KeyValueCacheTestPeer::GetInternedValueCount(cache), 3);
+}
+
+TEST_F(CacheTest, InternedValueIdsFollowDeletesAndCleanups) {
+  KeyValueCache cache(std::make_shared<ValueInterner>());
+  std::vector<std::string_view> values = {"v1", "v2"};
+  std::vector<std::string_view> values_to_delete = {"v1", "v3"};
+  cache.UpdateKeyValueSet("my_key", absl::Span<std::string_view>(values), 1);
+  cache.DeleteValuesInSet(
+      "my_key", absl::Span<std::string_view>(values_to_delete), 2);
+  absl::flat_hash_set<std::string_view> keys = {"my_key"};
+  EXPECT_THAT(cache.GetKeyValueSet(GetRequestContext(), keys)
+                  ->GetValueSet("my_key"),
+              UnorderedElementsAre("v2"));
+  // Deleted values keep their ids until they are cleaned up.
+  EXPECT_EQ(KeyValueCacheTestPeer::GetInternedValueCount(cache), 3);
+  cache.RemoveDeletedKeys(2);
+  EXPECT_EQ(KeyValueCacheTestPeer::GetInternedValueCount(cache), 1);
+
+  cache.UpdateKeyValueSet("my_key", absl::Span<std::string_view>(values), 3);
+  EXPECT_THAT(cache.GetKeyValueSet(GetRequestContext(), keys)
+                  ->GetValueSet("my_key"),
+              UnorderedElementsAre("v1", "v2"));
+  cache.DeleteValuesInSet("my_key", absl::Span<std::string_view>(values), 4);
+  cache.RemoveDeletedKeys(4);
+  EXPECT_EQ(KeyValueCacheTestPeer::GetCacheKeyValueSetMapSize(cache), 0);
+  EXPECT_EQ(KeyValueCacheTestPeer::GetInternedValueCount(cache), 0);
+}
+
+TEST_F(CacheTest, ApplyBatchMatchesSingleMutations) {
+  KeyValueCache cache(std::make_shared<ValueInterner>());
+  std::vector<std::string_view> values = {"v1", "v2"};
+  std::vector<std::string_view> values_to_delete = {"v1", "v3"};
+  const std::vector<CacheMutation> mutations = {
+      {CacheMutation::Type::kUpdateKeyValue, "key1", "value1", {}, 2},
+      // Older than the update before, so ignored.
+      {CacheMutation::Type::kUpdateKeyValue, "key1", "stale", {}, 1},
+      {CacheMutation::Type::kUpdateKeyValue, "key2", "value2", {}, 1},
+      {CacheMutation::Type::kDeleteKey, "key2", "", {}, 2},
+      {CacheMutation::Type::kUpdateKeyValueSet,
+       "set1",
+       "",
+       absl::MakeSpan(values),
+       1},
+      {CacheMutation::Type::kDeleteValuesInSet,
+       "set1",
+       "",
+       absl::MakeSpan(values_to_delete),
+       2},
+      {CacheMutation::Type::kDeleteValuesInSet,
+       "set2",
+       "",
+       absl::MakeSpan(values),
+       2},
+      // Older than the deletion before, so ignored.
+      {CacheMutation::Type::kUpdateKeyValueSet,
+       "set2",
+       "",
+       absl::MakeSpan(values),
+       1},
+  };
+  cache.ApplyBatch(mutations);
+
+  EXPECT_THAT(cache.GetKeyValuePairs(GetRequestContext(), {"key1", "key2"}),
+              UnorderedElementsAre(KVPairEq("key1", "value1")));
+  auto result = cache.GetKeyValueSet(GetRequestContext(), {"set1", "set2"});
+  EXPECT_THAT(result->GetValueSet("set1"), UnorderedElementsAre("v2"));
+  EXPECT_THAT(result->GetValues(*result->GetValueSetIds("set1")),
+              UnorderedElementsAre("v2"));
+  EXPECT_TRUE(result->GetValueSet("set2").empty());
+  result.reset();
+
+  cache.RemoveDeletedKeys(2);
+  EXPECT_EQ(KeyValueCacheTestPeer::GetDeletedSetNodesMapSize(cache), 0);
+  EXPECT_EQ(KeyValueCacheTestPeer::GetInternedValueCount(cache), 1);
+  // Mutations at or before the cleanup cutoff are ignored.
+  cache.ApplyBatch(std::vector<CacheMutation>{
+      {CacheMutation::Type::kUpdateKeyValue, "key2", "value2", {}, 2},
+      {CacheMutation::Type::kUpdateKeyValueSet,
+       "set2",
+       "",
+       absl::MakeSpan(values),
+       2},
+  });
+  EXPECT_TRUE(cache.GetKeyValuePairs(GetRequestContext(), {"key2"}).empty());
+  EXPECT_TRUE(cache.GetKeyValueSet(GetRequestContext(), {"set2"})
+                  ->GetValueSet("set2")
+                  .empty());
+}
+
+// Returns the checkpoint of `cache`.
+std::string WriteCheckpoint(const Cache& cache) {
+  std::ostringstream output;
+  CheckpointWriter writer(output);
+  EXPECT_TRUE(cache.WriteCheckpoint(writer).ok());
+  return output.str();
+}
+
+TEST_F(CacheTest, ReserveGrowsTheKeyValueMap) {
+  std::unique_ptr<KeyValueCache> cache = std::make_unique<KeyValueCache>();
+  cache->UpdateKeyValue("key", "value", 1);
+  cache->Reserve(/*num_keys=*/1000, /*num_set_keys=*/0);
+  auto& nodes = KeyValueCacheTestPeer::ReadNodes(*cache);
+  EXPECT_GE(nodes.capacity(), 1001);
+  const size_t capacity = nodes.capacity();
+  for (int i = 0; i < 1000; i++) {
+    cache->UpdateKeyValue(absl::StrCat("key", i), "value", 2);
+  }
+  // No rehash while adding the reserved keys.
+  EXPECT_EQ(nodes.capacity(), capacity);
+  absl::flat_hash_set<std::string_view> keys = {"key", "key999"};
+  EXPECT_EQ(cache->GetKeyValuePairs(GetRequestContext(), keys).size(), 2);
+}
+
+TEST_F(CacheTest, BackgroundCleanupRemovesDeletedKeysInSlices) {
+  KeyValueCache cache;
+  ASSERT_TRUE(
+      cache.StartBackgroundCleanup(absl::Hours(1), absl::ZeroDuration()).ok());
+  EXPECT_FALSE(
+      cache.StartBackgroundCleanup(absl::Hours(1), absl::ZeroDuration()).ok());
+  std::vector<std::string_view> values = {"v1"};
+  for (int i = 0; i < 200; i++) {
+    const std::string key = absl::StrCat("key", i);
+    cache.UpdateKeyValue(key, "value", 1);
+    cache.DeleteKey(key, 2);
+    cache.UpdateKeyValueSet(key, absl::MakeSpan(values), 1);
+    cache.DeleteValuesInSet(key, absl::MakeSpan(values), 2);
+  }
+  cache.DeleteKey("late", 4);
+  cache.RemoveDeletedKeys(3);
+  // Only the cleanup time is recorded, which already drops older updates.
+  EXPECT_EQ(KeyValueCacheTestPeer::ReadDeletedNodes(cache).size(), 201);
+  EXPECT_EQ(KeyValueCacheTestPeer::GetDeletedSetNodesMapSize(cache), 1);
+  cache.UpdateKeyValue("key0", "value", 3);
+  absl::flat_hash_set<std::string_view> keys = {"key0"};
+  EXPECT_TRUE(cache.GetKeyValuePairs(GetRequestContext(), keys).empty());
+
+  // Every slice removes a few keys before checking its deadline, so all the
+  // keys deleted before the cleanup time are removed despite the zero pause.
+  EXPECT_EQ(KeyValueCacheTestPeer::RemoveDeletedKeysInSlices(
+                cache, absl::ZeroDuration()),
+            1);
+  EXPECT_THAT(KeyValueCacheTestPeer::ReadDeletedNodes(cache),
+              UnorderedElementsAre(std::pair<const int64_t, std::string>(
+                  4, "late")));
+  EXPECT_EQ(KeyValueCacheTestPeer::ReadNodes(cache).size(), 1);
+  EXPECT_EQ(KeyValueCacheTestPeer::GetDeletedSetNodesMapSize(cache), 0);
+  EXPECT_EQ(KeyValueCacheTestPeer::GetCacheKeyValueSetMapSize(cache), 0);
+}
+
+TEST_F(CacheTest, CheckpointRestoresContents) {
+  KeyValueCache cache(std::make_shared<ValueInterner>());
+  std::vector<std::string_view> values = {"v1", "v2"};
+  std::vector<std::string_view> values_to_delete = {"v1", "v3"};
+  cache.UpdateKeyValue("key1", "value1", 2);
+  cache.UpdateKeyValue("key2", "value2", 2, "prefix");
+  cache.DeleteKey("key2", 3, "prefix");
+  cache.UpdateKeyValueSet("set1", absl::MakeSpan(values), 2);
+  cache.DeleteValuesInSet("set1", absl::MakeSpan(values_to_delete), 3);
+  cache.RemoveDeletedKeys(1);
+  const std::string checkpoint = WriteCheckpoint(cache);
+
+  KeyValueCache restored(std::make_shared<ValueInterner>());
+  CheckpointReader reader(checkpoint);
+  ASSERT_TRUE(restored.RestoreCheckpoint(reader).ok());
+  EXPECT_EQ(reader.remaining(), 0);
+  EXPECT_THAT(restored.GetKeyValuePairs(GetRequestContext(), {"key1", "key2"}),
+              UnorderedElementsAre(KVPairEq("key1", "value1")));
+  auto result = restored.GetKeyValueSet(GetRequestContext(), {"set1"});
+  EXPECT_THAT(result->GetValueSet("set1"), UnorderedElementsAre("v2"));
+  EXPECT_THAT(result->GetValues(*result->GetValueSetIds("set1")),
+              UnorderedElementsAre("v2"));
+  result.reset();
+  EXPECT_EQ(KeyValueCacheTestPeer::GetInternedValueCount(restored), 3);
+  EXPECT_EQ(
+      KeyValueCacheTestPeer::ReadDeletedNodes(restored, "prefix").size(), 1);
+  EXPECT_THAT(KeyValueCacheTestPeer::ReadDeletedSetNodesForTimestamp(
+                  restored, 3, "set1"),
+              UnorderedElementsAre("v1", "v3"));
+
+  // Deleted keys and values still shadow older updates, and the cleanup
+  // cutoff still applies.
+  restored.UpdateKeyValue("key2", "stale", 2, "prefix");
+  restored.UpdateKeyValue("key3", "stale", 1);
+  restored.UpdateKeyValueSet("set1", absl::MakeSpan(values_to_delete), 2);
+  EXPECT_TRUE(
+      restored.GetKeyValuePairs(GetRequestContext(), {"key2", "key3"}).empty());
+  EXPECT_THAT(restored.GetKeyValueSet(GetRequestContext(), {"set1"})
+                  ->GetValueSet("set1"),
+              UnorderedElementsAre("v2"));
+
+  restored.RemoveDeletedKeys(3, "prefix");
+  restored.RemoveDeletedKeys(3);
+  EXPECT_TRUE(KeyValueCacheTestPeer::ReadDeletedNodes(restored, "prefix")
+                  .empty());
+  EXPECT_EQ(KeyValueCacheTestPeer::GetDeletedSetNodesMapSize(restored), 0);
+  EXPECT_EQ(KeyValueCacheTestPeer::GetInternedValueCount(restored), 1);
+}
+
+TEST_F(CacheTest, CheckpointRestoresUInt32ValueSets) {
+  KeyValueCache cache;
+  const std::vector<uint32_t> values = {1, 2};
+  const std::vector<uint32_t> values_to_delete = {1};
+  cache.UpdateKeyValueUInt32Set("set1", values, 2, "prefix");
+  cache.DeleteValuesInUInt32Set("set1", values_to_delete, 3, "prefix");
+  const std::string checkpoint = WriteCheckpoint(cache);
+
+  KeyValueCache restored;
+  CheckpointReader reader(checkpoint);
+  ASSERT_TRUE(restored.RestoreCheckpoint(reader).ok());
+  EXPECT_EQ(reader.remaining(), 0);
+  EXPECT_THAT(restored.GetUInt32ValueSet(GetRequestContext(), {"set1"})
+                  ->GetValueSet("set1")
+                  .ToVector(),
+              testing::ElementsAre(2));
+  // The deleted value still shadows older updates.
+  restored.UpdateKeyValueUInt32Set("set1", values_to_delete, 2, "prefix");
+  EXPECT_THAT(restored.GetUInt32ValueSet(GetRequestContext(), {"set1"})
+                  ->GetValueSet("set1")
+                  .ToVector(),
+              testing::ElementsAre(2));
+}
+
+TEST_F(CacheTest, CheckpointRestoresPrecomputedJsonValues) {
+  KeyValueCache cache(/*value_interner=*/nullptr,
+                      /*precompute_json_values=*/true);
+  cache.UpdateKeyValue("key1", R"(["value1"])", 1);
+  cache.DeleteKey("key2", 1);
+  const std::string checkpoint = WriteCheckpoint(cache);
+
+  // Checkpoints hold the values only, so they restore into caches that do not
+  // precompute JSON values too.
+  KeyValueCache plain;
+  CheckpointReader plain_reader(checkpoint);
+  ASSERT_TRUE(plain.RestoreCheckpoint(plain_reader).ok());
+  EXPECT_THAT(plain.GetKeyValuePairs(GetRequestContext(), {"key1", "key2"}),
+              UnorderedElementsAre(KVPairEq("key1", R"(["value1"])")));
+
+  KeyValueCache restored(/*value_interner=*/nullptr,
+                         /*precompute_json_values=*/true);
+  CheckpointReader reader(checkpoint);
+  ASSERT_TRUE(restored.RestoreCheckpoint(reader).ok());
+  auto result = restored.GetKeyValues(GetRequestContext(), {"key1", "key2"});
+  EXPECT_EQ(result->size(), 1);
+  EXPECT_EQ(result->GetValue("key1"), R"(["value1"])");
+  google::protobuf::Value value;
+  ASSERT_TRUE(value.ParseFromString(
+      std::string(*result->GetSerializedJsonValue("key1"))));
+  EXPECT_EQ(value.list_value().values(0).string_value(), "value1");
+}
+
+TEST_F(CacheTest, GetKeyValuesReturnsCompressedValues) {
+  KeyValueCache cache(
+      /*value_interner=*/nullptr, /*precompute_json_values=*/false,
+      std::make_shared<ValueCompressor>(ValueCompressor::Options{
+          .dictionary_size = 2 * 1024, .sample_size = 32 * 1024}));
+  constexpr int kNumKeys = 4000;
+  int64_t value_bytes = 0;
+  for (int i = 0; i < kNumKeys; i++) {
+    const std::string key = absl::StrCat("key", i);
+    const std::string value = absl::StrCat(
+        R"({"id":)", i, R"(,"ad":{"size":"300x250","render_url":)",
+        R"("https://ads.example/render?id=)", i, R"("}})");
+    cache.UpdateKeyValue(key, value, 1, "prefix");
+    value_bytes += key.size() + value.size();
+  }
+  // Values loaded once the dictionary is trained are stored compressed.
+  EXPECT_LT(cache.GetPrefixStats()["prefix"].value_bytes,
+            value_bytes * 2 / 3);
+  const std::string expected_value =
+      R"({"id":3999,"ad":{"size":"300x250","render_url":)"
+      R"("https://ads.example/render?id=3999"}})";
+  auto result = cache.GetKeyValues(GetRequestContext(), {"key3999", "key1"});
+  EXPECT_EQ(result->GetValue("key3999"), expected_value);
+  EXPECT_EQ(result->GetValue("key1"),
+            R"({"id":1,"ad":{"size":"300x250","render_url":)"
+            R"("https://ads.example/render?id=1"}})");
+  // The result owns the decompressed values.
+  cache.UpdateKeyValue("key3999", "new", 2, "prefix");
+  EXPECT_EQ(result->GetValue("key3999"), expected_value);
+  EXPECT_THAT(cache.GetKeyValuePairs(GetRequestContext(), {"key3999"}),
+              UnorderedElementsAre(KVPairEq("key3999", "new")));
+
+  // Checkpoints hold the values uncompressed.
+  const std::string checkpoint = WriteCheckpoint(cache);
+  KeyValueCache plain;
+  CheckpointReader reader(checkpoint);
+  ASSERT_TRUE(plain.RestoreCheckpoint(reader).ok());
+  EXPECT_THAT(plain.GetKeyValuePairs(GetRequestContext(), {"key1"}),
+              UnorderedElementsAre(KVPairEq(
+                  "key1", R"({"id":1,"ad":{"size":"300x250","render_url":)"
+                          R"("https://ads.example/render?id=1"}})")));
+}
+
+TEST_F(CacheTest, GetKeyValuesReturnsDeduplicatedValues) {
+  auto value_store = std::make_shared<ValueInterner>();
+  KeyValueCache cache(/*value_interner=*/nullptr,
+                      /*precompute_json_values=*/false,
+                      /*value_compressor=*/nullptr, value_store);
+  const std::string shared_value(1000, 'a');
+  constexpr int kNumKeys = 100;
+  for (int i = 0; i < kNumKeys; i++) {
+    cache.UpdateKeyValue(absl::StrCat("key", i), shared_value, 1, "prefix");
+  }
+  cache.UpdateKeyValue("small", "value", 1, "prefix");
+  // Every key only holds the id of the shared value.
+  EXPECT_LT(cache.GetPrefixStats()["prefix"].value_bytes, 100 * kNumKeys);
+  auto result =
+      cache.GetKeyValues(GetRequestContext(), {"key0", "key99", "small"});
+  EXPECT_EQ(result->GetValue("key0"), shared_value);
+  EXPECT_EQ(result->GetValue("key99"), shared_value);
+  EXPECT_EQ(result->GetValue("small"), "value");
+
+  // The result keeps the value once no key has it anymore.
+  const std::string other_value(1000, 'b');
+  for (int i = 0; i < kNumKeys; i++) {
+    cache.UpdateKeyValue(absl::StrCat("key", i), other_value, 2, "prefix");
+  }
+  EXPECT_EQ(result->GetValue("key0"), shared_value);
+  EXPECT_FALSE(value_store->Find(shared_value).has_value());
+  cache.DeleteKey("key0", 3, "prefix");
+  EXPECT_THAT(cache.GetKeyValuePairs(GetRequestContext(), {"key0", "key1"}),
+              UnorderedElementsAre(KVPairEq("key1", other_value)));
+
+  // Checkpoints hold the values themselves.
+  const std::string checkpoint = WriteCheckpoint(cache);
+  KeyValueCache plain;
+  CheckpointReader reader(checkpoint);
+  ASSERT_TRUE(plain.RestoreCheckpoint(reader).ok());
+  EXPECT_THAT(plain.GetKeyValuePairs(GetRequestContext(), {"key1", "small"}),
+              UnorderedElementsAre(KVPairEq("key1", other_value),
+                                   KVPairEq("small", "value")));
+}
+
+TEST_F(CacheTest, GetKeyValuesCombinesValueOptions) {
+  KeyValueCache cache(
+      /*value_interner=*/nullptr, /*precompute_json_values=*/true,
+      std::make_shared<ValueCompressor>(ValueCompressor::Options{
+          .dictionary_size = 2 * 1024, .sample_size = 32 * 1024}),
+      std::make_shared<ValueInterner>());
+  const std::string shared_value = absl::StrCat(
+      R"({"ad":{"size":"300x250","render_url":"https://ads.example/)",
+      std::string(1000, 'a'), R"("}})");
+  for (int i = 0; i < 1000; i++) {
+    cache.UpdateKeyValue(absl::StrCat("key", i), shared_value, 1, "prefix");
+  }
+  cache.UpdateKeyValue("small", "[1]", 1, "prefix");
+  auto result = cache.GetKeyValues(GetRequestContext(), {"key0", "small"});
+  EXPECT_EQ(result->GetValue("key0"), shared_value);
+  EXPECT_EQ(result->GetValue("small"), "[1]");
+  EXPECT_TRUE(result->GetSerializedJsonValue("small").has_value());
+  EXPECT_THAT(cache.GetKeyValuePairs(GetRequestContext(), {"key999"}),
+              UnorderedElementsAre(KVPairEq("key999", shared_value)));
+}
+
+TEST_F(CacheTest, SpillsValuesLookedUpTheLeastToDisk) {
+  absl::StatusOr<std::unique_ptr<ColdValueLog>> log = ColdValueLog::Create({
+      .directory = std::filesystem::temp_directory_path().string(),
+      .max_hot_value_bytes = 3000,
+      .min_cold_value_size = 100,
+      .promotion_lookups = 2,
+  });
+  ASSERT_TRUE(log.ok()) << log.status();
+  std::shared_ptr<ColdValueLog> cold_value_log = *std::move(log);
+  KeyValueCache cache(/*value_interner=*/nullptr,
+                      /*precompute_json_values=*/false,
+                      /*value_compressor=*/nullptr, /*value_store=*/nullptr,
+                      cold_value_log);
+  for (int i = 0; i < 10; i++) {
+    cache.UpdateKeyValue(absl::StrCat("key", i), std::string(1000, 'a' + i),
+                         1);
+  }
+  cache.UpdateKeyValue("small", "value", 1);
+  cache.GetKeyValuePairs(GetRequestContext(), {"key0", "key1"});
+  // Keeps the looked up values in memory, and values too small to spill.
+  KeyValueCacheTestPeer::RebalanceValueTiers(cache);
+  EXPECT_EQ(cold_value_log->live_bytes(), 8000);
+  EXPECT_GT(KeyValueCacheTestPeer::GetArenaValueSize(cache, "key0"), 1000);
+  EXPECT_GT(KeyValueCacheTestPeer::GetArenaValueSize(cache, "key1"), 1000);
+  EXPECT_LT(KeyValueCacheTestPeer::GetArenaValueSize(cache, "key5"), 100);
+  EXPECT_THAT(cache.GetKeyValuePairs(GetRequestContext(), {"key5", "small"}),
+              UnorderedElementsAre(KVPairEq("key5", std::string(1000, 'f')),
+                                   KVPairEq("small", "value")));
+  auto result = cache.GetKeyValues(GetRequestContext(), {"key5"});
+  EXPECT_EQ(result->GetValue("key5"), std::string(1000, 'f'));
+
+  // Brings the value looked up twice back, and spills the values looked up
+  // the least to make room for it. Updates release the cold values.
+  cache.UpdateKeyValue("key6", std::string(1000, 'z'), 2);
+  EXPECT_EQ(cold_value_log->live_bytes(), 7000);
+  KeyValueCacheTestPeer::RebalanceValueTiers(cache);
+  EXPECT_EQ(cold_value_log->live_bytes(), 8000);
+  EXPECT_GT(KeyValueCacheTestPeer::GetArenaValueSize(cache, "key5"), 1000);
+  EXPECT_EQ(result->GetValue("key5"), std::string(1000, 'f'));
+
+  // Checkpoints hold the values themselves.
+  const std::string checkpoint = WriteCheckpoint(cache);
+  KeyValueCache plain;
+  CheckpointReader reader(checkpoint);
+  ASSERT_TRUE(plain.RestoreCheckpoint(reader).ok());
+  EXPECT_THAT(plain.GetKeyValuePairs(GetRequestContext(),
+                                     {"key2", "key5", "key6"}),
+              UnorderedElementsAre(KVPairEq("key2", std::string(1000, 'c')),
+                                   KVPairEq("key5", std::string(1000, 'f')),
+                                   KVPairEq("key6", std::string(1000, 'z'))));
+}
+
+TEST_F(CacheTest, ReadsColdValuesOfOneLookupTogether) {
+  absl::StatusOr<std::unique_ptr<ColdValueLog>> log = ColdValueLog::Create({
+      .directory = std::filesystem::temp_directory_path().string(),
+      .max_hot_value_bytes = 0,
+      .min_cold_value_size = 100,
+  });
+  ASSERT_TRUE(log.ok()) << log.status();
+  std::shared_ptr<ColdValueLog> cold_value_log = *std::move(log);
+  KeyValueCache cache(/*value_interner=*/nullptr,
+                      /*precompute_json_values=*/false,
+                      /*value_compressor=*/nullptr, /*value_store=*/nullptr,
+                      cold_value_log);
+  for (int i = 0; i < 5; i++) {
+    cache.UpdateKeyValue(absl::StrCat("key", i), std::string(1000, 'a' + i),
+                         1);
+  }
+  cache.UpdateKeyValue("small", "value", 1);
+  KeyValueCacheTestPeer::RebalanceValueTiers(cache);
+  ASSERT_EQ(cold_value_log->live_bytes(), 5000);
+  EXPECT_THAT(
+      cache.GetKeyValuePairs(GetRequestContext(),
+                             {"key0", "key2", "key4", "small", "missing"}),
+      UnorderedElementsAre(KVPairEq("key0", std::string(1000, 'a')),
+                           KVPairEq("key2", std::string(1000, 'c')),
+                           KVPairEq("key4", std::string(1000, 'e')),
+                           KVPairEq("small", "value")));
+  auto result = cache.GetKeyValues(GetRequestContext(),
+                                   {"key1", "key3", "small", "missing"});
+  EXPECT_EQ(result->size(), 3);
+  EXPECT_EQ(result->GetValue("key1"), std::string(1000, 'b'));
+  EXPECT_EQ(result->GetValue("key3"), std::string(1000, 'd'));
+  EXPECT_EQ(result->GetValue("small"), "value");
+}
+
+TEST_F(CacheTest, CheckpointOfEmptyCache) {
+  std::unique_ptr<Cache> cache = KeyValueCache::Create();
+  const std::string checkpoint = WriteCheckpoint(*cache);
+  std::unique_ptr<Cache> restored = KeyValueCache::Create();
+  CheckpointReader reader(checkpoint);
+  ASSERT_TRUE(restored->RestoreCheckpoint(reader).ok());
+  EXPECT_TRUE(restored->GetKeyValuePairs(GetRequestContext(), {"key"}).empty());
+}
+
+TEST_F(CacheTest, CheckpointIsOnlyRestoredIntoEmptyCaches) {
+  std::unique_ptr<Cache> cache = KeyValueCache::Create();
+  cache->UpdateKeyValue("key1", "value1", 1);
+  const std::string checkpoint = WriteCheckpoint(*cache);
+  std::unique_ptr<Cache> restored = KeyValueCache::Create();
+  restored->UpdateKeyValue("key2", "value2", 1);
+  CheckpointReader reader(checkpoint);
+  EXPECT_EQ(restored->RestoreCheckpoint(reader).code(),
+            absl::StatusCode::kFailedPrecondition);
+  EXPECT_THAT(restored->GetKeyValuePairs(GetRequestContext(), {"key1", "key2"}),
+              UnorderedElementsAre(KVPairEq("key2", "value2")));
+}
+
+TEST_F(CacheTest, TruncatedCheckpointLeavesCacheEmpty) {
+  std::unique_ptr<Cache> cache = KeyValueCache::Create();
+  std::vector<std::string_view> values = {"v1", "v2"};
+  cache->UpdateKeyValue("key1", "value1", 1);
+  cache->UpdateKeyValueSet("set1", absl::MakeSpan(values), 1);
+  const std::string checkpoint = WriteCheckpoint(*cache);
+  std::unique_ptr<Cache> restored = KeyValueCache::Create();
+  CheckpointReader reader(
+      std::string_view(checkpoint).substr(0, checkpoint.size() - 1));
+  EXPECT_EQ(restored->RestoreCheckpoint(reader).code(),
+            absl::StatusCode::kDataLoss);
+  EXPECT_TRUE(restored->GetKeyValuePairs(GetRequestContext(), {"key1"}).empty());
+  EXPECT_TRUE(restored->GetKeyValueSet(GetRequestContext(), {"set1"})
+                  ->GetValueSet("set1")
+                  .empty());
+}
+
+TEST_F(CacheTest, BulkLoadPublishesLatestChangesOnFinish) {
+  KeyValueCache cache;
+  std::vector<std::string_view> values = {"v1", "v2"};
+  std::vector<std::string_view> values_to_delete = {"v1"};
+  const std::vector<uint32_t> uint32_values = {1, 2};
+  const std::vector<uint32_t> uint32_values_to_delete = {2};
+  ASSERT_TRUE(cache.StartBulkLoad().ok());
+  // Staged out of order, the latest change of every key and value wins.
+  cache.UpdateKeyValue("key1", "new", 3);
+  cache.UpdateKeyValue("key1", "stale", 2);
+  cache.DeleteKey("key2", 2);
+  cache.UpdateKeyValue("key2", "stale", 1);
+  cache.DeleteValuesInSet("set1", absl::MakeSpan(values_to_delete), 3);
+  cache.UpdateKeyValueSet("set1", absl::MakeSpan(values), 2);
+  cache.UpdateKeyValueUInt32Set("set2", uint32_values, 1);
+  cache.DeleteValuesInUInt32Set("set2", uint32_values_to_delete, 2);
+  cache.ApplyBatch(std::vector<CacheMutation>{
+      {.type = CacheMutation::Type::kUpdateKeyValue,
+       .key = "key3",
+       .value = "value3",
+       .logical_commit_time = 1}});
+  EXPECT_TRUE(cache
+                  .GetKeyValuePairs(GetRequestContext(),
+                                    {"key1", "key2", "key3"})
+                  .empty());
+
+  ASSERT_TRUE(cache.FinishBulkLoad().ok());
+  EXPECT_THAT(
+      cache.GetKeyValuePairs(GetRequestContext(), {"key1", "key2", "key3"}),
+      UnorderedElementsAre(KVPairEq("key1", "new"),
+                           KVPairEq("key3", "value3")));
+  EXPECT_THAT(
+      cache.GetKeyValueSet(GetRequestContext(), {"set1"})->GetValueSet("set1"),
+      UnorderedElementsAre("v2"));
+  EXPECT_THAT(cache.GetUInt32ValueSet(GetRequestContext(), {"set2"})
+                  ->GetValueSet("set2")
+                  .ToVector(),
+              testing::ElementsAre(1));
+  // Deleted keys and values still shadow older updates after the load.
+  EXPECT_EQ(KeyValueCacheTestPeer::ReadDeletedNodes(cache).size(), 1);
+  cache.UpdateKeyValue("key2", "stale", 1);
+  cache.UpdateKeyValueSet("set1", absl::MakeSpan(values_to_delete), 2);
+  EXPECT_TRUE(cache.GetKeyValuePairs(GetRequestContext(), {"key2"}).empty());
+  EXPECT_THAT(
+      cache.GetKeyValueSet(GetRequestContext(), {"set1"})->GetValueSet("set1"),
+      UnorderedElementsAre("v2"));
+}
+
+TEST_F(CacheTest, BulkLoadDropsDeletionsOlderThanCleanup) {
+  KeyValueCache cache;
+  std::vector<std::string_view> values = {"v1"};
+  ASSERT_TRUE(cache.StartBulkLoad().ok());
+  cache.DeleteKey("key1", 2);
+  cache.DeleteKey("key2", 4);
+  cache.DeleteValuesInSet("set1", absl::MakeSpan(values), 2);
+  cache.RemoveDeletedKeys(3);
+  ASSERT_TRUE(cache.FinishBulkLoad().ok());
+  EXPECT_THAT(KeyValueCacheTestPeer::ReadDeletedNodes(cache),
+              UnorderedElementsAre(std::pair<const int64_t, std::string>(
+                  4, "key2")));
+  EXPECT_EQ(KeyValueCacheTestPeer::GetDeletedSetNodesMapSize(cache), 0);
+  // The cleanup cutoff still applies after the load.
+  cache.UpdateKeyValue("key1", "stale", 3);
+  EXPECT_TRUE(cache.GetKeyValuePairs(GetRequestContext(), {"key1"}).empty());
+}
+
+TEST_F(CacheTest, BulkLoadIsOnlyStartedOnEmptyCaches) {
+  KeyValueCache cache;
+  cache.UpdateKeyValue("key1", "value1", 1);
+  EXPECT_EQ(cache.StartBulkLoad().code(),
+            absl::StatusCode::kFailedPrecondition);
+  // Changes are still applied right away.
+  cache.UpdateKeyValue("key2", "value2", 1);
+  EXPECT_THAT(cache.GetKeyValuePairs(GetRequestContext(), {"key1", "key2"}),
+              UnorderedElementsAre(KVPairEq("key1", "value1"),
+                                   KVPairEq("key2", "value2")));
+}
+
+TEST_F(CacheTest, ForEachKeyVisitsKeysAndSetKeys) {
+  std::unique_ptr<Cache> cache = KeyValueCache::Create();
+  std::vector<std::string_view> values = {"v1", "v2"};
+  cache->UpdateKeyValue("key1", "value1", 1);
+  cache->UpdateKeyValue("key2", "value2", 1);
+  cache->DeleteKey("key2", 2);
+  cache->UpdateKeyValueSet("set1", absl::MakeSpan(values), 1);
+  std::vector<std::string> keys;
+  ASSERT_TRUE(cache
+                  ->ForEachKey([&keys](std::string_view key) {
+                    keys.emplace_back(key);
+                  })
+                  .ok());
+  EXPECT_THAT(keys, UnorderedElementsAre("key1", "set1"));
+}
+
+auto PrefixStatsAre(int64_t num_keys, int64_t value_bytes,
+                    int64_t num_set_values, int64_t num_tombstones) {
+  return AllOf(Field(&PrefixStats::num_keys, num_keys),
+               Field(&PrefixStats::value_bytes, value_bytes),
+               Field(&PrefixStats::num_set_values, num_set_values),
+               Field(&PrefixStats::num_tombstones, num_tombstones));
+}
+
+TEST_F(CacheTest, PrefixStatsFollowUpdatesDeletesAndCleanup) {
+  KeyValueCache cache;
+  std::vector<std::string_view> values = {"v1", "v2"};
+  std::vector<std::string_view> values_to_delete = {"v1", "v3"};
+  cache.UpdateKeyValue("key1", "value1", 1, "prefix1");
+  cache.UpdateKeyValue("key2", "value2", 1, "prefix1");
+  cache.UpdateKeyValue("key1", "v", 2, "prefix1");
+  cache.DeleteKey("key2", 2, "prefix1");
+  cache.UpdateKeyValueSet("set1", absl::MakeSpan(values), 1, "prefix2");
+  cache.DeleteValuesInSet("set1", absl::MakeSpan(values_to_delete), 2,
+                          "prefix2");
+  // Stale updates change nothing.
+  cache.UpdateKeyValue("key2", "value2", 1, "prefix1");
+  cache.UpdateKeyValueSet("set1", absl::MakeSpan(values), 1, "prefix2");
+  EXPECT_THAT(cache.GetPrefixStats(),
+              UnorderedElementsAre(
+                  Pair("prefix1", PrefixStatsAre(1, 5, 0, 1)),
+                  Pair("prefix2", PrefixStatsAre(0, 0, 1, 2))));
+
+  cache.RemoveDeletedKeys(2, "prefix1");
+  cache.RemoveDeletedKeys(2, "prefix2");
+  EXPECT_THAT(cache.GetPrefixStats(),
+              UnorderedElementsAre(
+                  Pair("prefix1", PrefixStatsAre(1, 5, 0, 0)),
+                  Pair("prefix2", PrefixStatsAre(0, 0, 1, 0))));
+}
+
+TEST_F(CacheTest, PrefixStatsMoveWithKeysBetweenPrefixes) {
+  KeyValueCache cache;
+  std::vector<std::string_view> values = {"v1"};
+  cache.UpdateKeyValue("key1", "value1", 1, "prefix1");
+  cache.UpdateKeyValueSet("set1", absl::MakeSpan(values), 1, "prefix1");
+  cache.UpdateKeyValue("key1", "value1", 2, "prefix2");
+  cache.UpdateKeyValueSet("set1", absl::MakeSpan(values), 2, "prefix2");
+  EXPECT_THAT(cache.GetPrefixStats(),
+              UnorderedElementsAre(
+                  Pair("prefix1", PrefixStatsAre(0, 0, 0, 0)),
+                  Pair("prefix2", PrefixStatsAre(1, 10, 1, 0))));
+}
+
+TEST_F(CacheTest, CheckpointRestoresPrefixStats) {
+  KeyValueCache cache(std::make_shared<ValueInterner>());
+  std::vector<std::string_view> values = {"v1", "v2"};
+  std::vector<std::string_view> values_to_delete = {"v1"};
+  cache.UpdateKeyValue("key1", "value1", 1, "prefix1");
+  cache.DeleteKey("key2", 1, "prefix1");
+  cache.UpdateKeyValueSet("set1", absl::MakeSpan(values), 1, "prefix2");
+  cache.DeleteValuesInSet("set1", absl::MakeSpan(values_to_delete), 2,
+                          "prefix2");
+  const std::string checkpoint = WriteCheckpoint(cache);
+
+  KeyValueCache restored(std::make_shared<ValueInterner>());
+  CheckpointReader reader(checkpoint);
+  ASSERT_TRUE(restored.RestoreCheckpoint(reader).ok());
+  EXPECT_THAT(restored.GetPrefixStats(),
+              UnorderedElementsAre(
+                  Pair("prefix1", PrefixStatsAre(1, 10, 0, 1)),
+                  Pair("prefix2", PrefixStatsAre(0, 0, 1, 1))));
+}
+
+TEST_F(CacheTest, SetValueIndexFollowsSetUpdatesAndDeletes) {
+  KeyValueCache cache;
+  EXPECT_FALSE(cache.GetKeysContaining(GetRequestContext(), "v1").ok());
+  ASSERT_TRUE(cache.EnableSetValueIndex().ok());
+  std::vector<std::string_view> values = {"v1", "v2"};
+  std::vector<std::string_view> values_to_delete = {"v1"};
+  cache.UpdateKeyValueSet("set1", absl::MakeSpan(values), 1);
+  cache.UpdateKeyValueSet("set2", absl::MakeSpan(values_to_delete), 1);
+  cache.DeleteValuesInSet("set1", absl::MakeSpan(values_to_delete), 2);
+  // Older than the deletion, so v1 stays deleted from set1.
+  cache.UpdateKeyValueSet("set1", absl::MakeSpan(values_to_delete), 1);
+  EXPECT_THAT(*cache.GetKeysContaining(GetRequestContext(), "v1"),
+              UnorderedElementsAre("set2"));
+  EXPECT_THAT(*cache.GetKeysContaining(GetRequestContext(), "v2"),
+              UnorderedElementsAre("set1"));
+
+  cache.UpdateKeyValueSet("set1", absl::MakeSpan(values_to_delete), 3);
+  cache.RemoveDeletedKeys(3);
+  EXPECT_THAT(*cache.GetKeysContaining(GetRequestContext(), "v1"),
+              UnorderedElementsAre("set1", "set2"));
+  EXPECT_THAT(*cache.GetKeysContaining(GetRequestContext(), "missing"),
+              IsEmpty());
+  // Sets were already added.
+  EXPECT_FALSE(cache.EnableSetValueIndex().ok());
+}
+
+TEST_F(CacheTest, CheckpointRestoresSetValueIndex) {
+  KeyValueCache cache;
+  std::vector<std::string_view> values = {"v1", "v2"};
+  std::vector<std::string_view> values_to_delete = {"v1"};
+  cache.UpdateKeyValueSet("set1", absl::MakeSpan(values), 1);
+  cache.DeleteValuesInSet("set1", absl::MakeSpan(values_to_delete), 2);
+  const std::string checkpoint = WriteCheckpoint(cache);
+
+  KeyValueCache restored;
+  ASSERT_TRUE(restored.EnableSetValueIndex().ok());
+  CheckpointReader reader(checkpoint);
+  ASSERT_TRUE(restored.RestoreCheckpoint(reader).ok());
+  EXPECT_THAT(*restored.GetKeysContaining(GetRequestContext(), "v1"),
+              IsEmpty());
+  EXPECT_THAT(*restored.GetKeysContaining(GetRequestContext(), "v2"),
+              UnorderedElementsAre("set1"));
+}
+
+TEST_F(CacheTest, SortedKeyIndexFollowsUpdatesAndDeletes) {
+  KeyValueCache cache;
+  EXPECT_FALSE(cache.GetKeysWithPrefix(GetRequestContext(), "c1:", 10).ok());
+  ASSERT_TRUE(cache.EnableSortedKeyIndex().ok());
+  cache.UpdateKeyValue("c1:b", "value", 1);
+  cache.UpdateKeyValue("c1:a", "value", 1);
+  cache.UpdateKeyValue("c2:a", "value", 1);
+  cache.UpdateKeyValue("c1:c", "value", 1);
+  cache.UpdateKeyValue("c1:c", "new_value", 2);
+  cache.DeleteKey("c1:b", 2);
+  // Older than the deletion, so c1:b stays deleted.
+  cache.UpdateKeyValue("c1:b", "value", 1);
+  EXPECT_THAT(*cache.GetKeysWithPrefix(GetRequestContext(), "c1:", 10),
+              testing::ElementsAre("c1:a", "c1:c"));
+  EXPECT_THAT(*cache.GetKeysWithPrefix(GetRequestContext(), "c", 2),
+              testing::ElementsAre("c1:a", "c1:c"));
+
+  cache.UpdateKeyValue("c1:b", "value", 3);
+  cache.DeleteKey("c2:a", 3);
+  cache.RemoveDeletedKeys(3);
+  EXPECT_THAT(*cache.GetKeysWithPrefix(GetRequestContext(), "c", 10),
+              testing::ElementsAre("c1:a", "c1:b", "c1:c"));
+  // Keys were already added.
+  EXPECT_FALSE(cache.EnableSortedKeyIndex().ok());
+}
+
+TEST_F(CacheTest, CheckpointRestoresSortedKeyIndex) {
+  KeyValueCache cache;
+  cache.UpdateKeyValue("c1:a", "value", 1);
+  cache.UpdateKeyValue("c1:b", "value", 1);
+  cache.DeleteKey("c1:b", 2);
+  const std::string checkpoint = WriteCheckpoint(cache);
+
+  KeyValueCache restored;
+  ASSERT_TRUE(restored.EnableSortedKeyIndex().ok());
+  CheckpointReader reader(checkpoint);
+  ASSERT_TRUE(restored.RestoreCheckpoint(reader).ok());
+  EXPECT_THAT(*restored.GetKeysWithPrefix(GetRequestContext(), "c1:", 10),
+              testing::ElementsAre("c1:a"));
+}
+
+TEST_F(CacheTest, GetHotKeysOfEveryPrefix) {
+  KeyValueCache cache;
+  EXPECT_TRUE(cache.GetHotKeys(10).empty());
+  EXPECT_FALSE(cache.EnableHotKeyTracking(0).ok());
+  ASSERT_TRUE(cache.EnableHotKeyTracking(1).ok());
+  EXPECT_FALSE(cache.EnableHotKeyTracking(1).ok());
+  cache.UpdateKeyValue("hot", "value", 1, "prefix1");
+  cache.UpdateKeyValue("cold", "value", 1, "prefix1");
+  std::vector<std::string_view> values = {"v1", "v2"};
+  cache.UpdateKeyValueSet("set", absl::Span<std::string_view>(values), 1,
+                          "prefix2");
+  for (int i = 0; i < 3; i++) {
+    cache.GetKeyValuePairs(GetRequestContext(), {"hot", "missing"});
+  }
+  cache.GetKeyValuePairs(GetRequestContext(), {"cold"});
+  cache.GetKeyValueSet(GetRequestContext(), {"set"});
+  EXPECT_THAT(
+      cache.GetHotKeys(1),
+      UnorderedElementsAre(
+          Pair("prefix1", testing::ElementsAre(AllOf(
+                              Field(&HotKey::key, "hot"),
+                              Field(&HotKey::estimated_lookups, 3)))),
+          Pair("prefix2",
+               testing::ElementsAre(Field(&HotKey::key, "set")))));
+  EXPECT_THAT(cache.GetHotKeys(10)["prefix1"],
+              testing::ElementsAre(Field(&HotKey::key, "hot"),
+                                   Field(&HotKey::key, "cold")));
+}
+
 }  // namespace
 }  // namespace kv_server
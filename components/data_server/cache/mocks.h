@@ -16,6 +16,7 @@
 #define COMPONENTS_DATA_SERVER_CACHE_MOCKS_H_
 
 #include <memory>
+#include <optional>
 #include <string>
 #include <utility>
 #include <vector>
@@ -36,6 +37,10 @@ class MockCache : public Cache {
               (const RequestContext& request_context,
                const absl::flat_hash_set<std::string_view>&),
               (const, override));
+  MOCK_METHOD((std::unique_ptr<GetKeyValueResult>), GetKeyValues,
+              (const RequestContext& request_context,
+               const absl::flat_hash_set<std::string_view>&),
+              (const, override));
   MOCK_METHOD((std::unique_ptr<GetKeyValueSetResult>), GetKeyValueSet,
               (const RequestContext& request_context,
                const absl::flat_hash_set<std::string_view>&),
@@ -55,18 +60,114 @@ class MockCache : public Cache {
   MOCK_METHOD(void, DeleteKey,
               (std::string_view key, int64_t ts, std::string_view prefix),
               (override));
+  MOCK_METHOD((std::unique_ptr<GetUInt32ValueSetResult>), GetUInt32ValueSet,
+              (const RequestContext& request_context,
+               const absl::flat_hash_set<std::string_view>&),
+              (const, override));
+  MOCK_METHOD(void, UpdateKeyValueUInt32Set,
+              (std::string_view key, absl::Span<const uint32_t> value_set,
+               int64_t logical_commit_time, std::string_view prefix),
+              (override));
+  MOCK_METHOD(void, DeleteValuesInUInt32Set,
+              (std::string_view key, absl::Span<const uint32_t> value_set,
+               int64_t logical_commit_time, std::string_view prefix),
+              (override));
   MOCK_METHOD(void, RemoveDeletedKeys, (int64_t ts, std::string_view prefix),
               (override));
+  MOCK_METHOD(void, Reserve, (int64_t num_keys, int64_t num_set_keys),
+              (override));
+  MOCK_METHOD(absl::Status, WriteCheckpoint, (CheckpointWriter & writer),
+              (const, override));
+  MOCK_METHOD(absl::Status, RestoreCheckpoint, (CheckpointReader & reader),
+              (override));
+  MOCK_METHOD(absl::Status, EnableSetValueIndex, (), (override));
+  MOCK_METHOD(absl::StatusOr<std::vector<std::string>>, GetKeysContaining,
+              (const RequestContext& request_context, std::string_view value),
+              (const, override));
+  MOCK_METHOD(absl::Status, EnableSortedKeyIndex, (), (override));
+  MOCK_METHOD(absl::StatusOr<std::vector<std::string>>, GetKeysWithPrefix,
+              (const RequestContext& request_context,
+               std::string_view key_prefix, int64_t limit),
+              (const, override));
+  MOCK_METHOD(absl::Status, EnableHotKeyTracking, (int32_t sample_rate),
+              (override));
+  MOCK_METHOD(HotKeys, GetHotKeys, (int64_t num_keys_per_prefix),
+              (const, override));
+};
+
+// GetKeyValueResult that owns copies of the given key-value pairs, and of the
+// precomputed JSON forms of their values, if any.
+class FakeGetKeyValueResult : public GetKeyValueResult {
+ public:
+  explicit FakeGetKeyValueResult(
+      absl::flat_hash_map<std::string, std::string> kv_pairs,
+      absl::flat_hash_map<std::string, std::string> serialized_json = {})
+      : kv_pairs_(std::move(kv_pairs)),
+        serialized_json_(std::move(serialized_json)) {}
+  std::optional<std::string_view> GetValue(
+      std::string_view key) const override {
+    auto key_itr = kv_pairs_.find(key);
+    if (key_itr == kv_pairs_.end()) {
+      return std::nullopt;
+    }
+    return key_itr->second;
+  }
+  std::optional<std::string_view> GetSerializedJsonValue(
+      std::string_view key) const override {
+    auto key_itr = serialized_json_.find(key);
+    if (key_itr == serialized_json_.end()) {
+      return std::nullopt;
+    }
+    return key_itr->second;
+  }
+  size_t size() const override { return kv_pairs_.size(); }
+
+ private:
+  void AddKeyValue(std::string_view key, std::string_view value,
+                   std::shared_ptr<const void> value_owner,
+                   std::optional<std::string_view> serialized_json) override {}
+
+  absl::flat_hash_map<std::string, std::string> kv_pairs_;
+  absl::flat_hash_map<std::string, std::string> serialized_json_;
 };
 
+// Action for `MockCache::GetKeyValues` that returns a new
+// `FakeGetKeyValueResult` holding `kv_pairs` on every call.
+inline auto ReturnKeyValues(
+    absl::flat_hash_map<std::string, std::string> kv_pairs) {
+  return [kv_pairs = std::move(kv_pairs)](
+             const RequestContext&,
+             const absl::flat_hash_set<std::string_view>&)
+             -> std::unique_ptr<GetKeyValueResult> {
+    return std::make_unique<FakeGetKeyValueResult>(kv_pairs);
+  };
+}
+
 class MockGetKeyValueSetResult : public GetKeyValueSetResult {
  public:
-  MOCK_METHOD((absl::flat_hash_set<std::string_view>), GetValueSet,
+  MOCK_METHOD((const absl::flat_hash_set<std::string_view>&), GetValueSet,
               (std::string_view), (const, override));
+  MOCK_METHOD(size_t, GetValueSetSize, (std::string_view), (const, override));
+  MOCK_METHOD(bool, HasValueSetIds, (), (const, override));
+  MOCK_METHOD(const RoaringBitmap*, GetValueSetIds, (std::string_view),
+              (const, override));
+  MOCK_METHOD((std::vector<std::string_view>), GetValues,
+              (const RoaringBitmap&), (const, override));
   MOCK_METHOD(void, AddKeyValueSet,
-              (std::string_view, absl::flat_hash_set<std::string_view>,
+              (std::string_view, std::shared_ptr<const ValueSetSnapshot>),
+              (override));
+};
+
+class MockGetUInt32ValueSetResult : public GetUInt32ValueSetResult {
+ public:
+  MOCK_METHOD(const RoaringBitmap&, GetValueSet, (std::string_view),
+              (const, override));
+  MOCK_METHOD(void, AddValueSet,
+              (std::string_view, const RoaringBitmap&,
                std::unique_ptr<absl::ReaderMutexLock>),
               (override));
+  MOCK_METHOD(void, AddOwnedValueSet, (std::string_view, RoaringBitmap),
+              (override));
 };
 
 }  // namespace kv_server
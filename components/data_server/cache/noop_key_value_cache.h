@@ -17,6 +17,7 @@
 #define COMPONENTS_DATA_SERVER_CACHE_NOOP_KEY_VALUE_CACHE_H_
 
 #include <memory>
+#include <optional>
 #include <string>
 #include <vector>
 
@@ -30,6 +31,11 @@ class NoOpKeyValueCache : public Cache {
       const absl::flat_hash_set<std::string_view>& key_set) const override {
     return {};
   };
+  std::unique_ptr<kv_server::GetKeyValueResult> GetKeyValues(
+      const RequestContext& request_context,
+      const absl::flat_hash_set<std::string_view>& key_set) const override {
+    return std::make_unique<NoOpGetKeyValueResult>();
+  }
   std::unique_ptr<kv_server::GetKeyValueSetResult> GetKeyValueSet(
       const RequestContext& request_context,
       const absl::flat_hash_set<std::string_view>& key_set) const override {
@@ -55,14 +61,39 @@ class NoOpKeyValueCache : public Cache {
   }
 
  private:
+  class NoOpGetKeyValueResult : public GetKeyValueResult {
+    std::optional<std::string_view> GetValue(
+        std::string_view key) const override {
+      return std::nullopt;
+    }
+    std::optional<std::string_view> GetSerializedJsonValue(
+        std::string_view key) const override {
+      return std::nullopt;
+    }
+    size_t size() const override { return 0; }
+    void AddKeyValue(
+        std::string_view key, std::string_view value,
+        std::shared_ptr<const void> value_owner,
+        std::optional<std::string_view> serialized_json) override {}
+  };
   class NoOpGetKeyValueSetResult : public GetKeyValueSetResult {
-    absl::flat_hash_set<std::string_view> GetValueSet(
+    const absl::flat_hash_set<std::string_view>& GetValueSet(
         std::string_view key) const override {
+      return empty_set_;
+    }
+    size_t GetValueSetSize(std::string_view key) const override { return 0; }
+    bool HasValueSetIds() const override { return false; }
+    const RoaringBitmap* GetValueSetIds(std::string_view key) const override {
+      return nullptr;
+    }
+    std::vector<std::string_view> GetValues(
+        const RoaringBitmap& ids) const override {
       return {};
     }
     void AddKeyValueSet(
-        std::string_view key, absl::flat_hash_set<std::string_view> value_set,
-        std::unique_ptr<absl::ReaderMutexLock> key_lock) override {}
+        std::string_view key,
+        std::shared_ptr<const ValueSetSnapshot> value_set) override {}
+    const absl::flat_hash_set<std::string_view> empty_set_;
   };
 };
 
@@ -0,0 +1,54 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/data_server/cache/precomputed_json_value.h"
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+#include "google/protobuf/struct.pb.h"
+#include "google/protobuf/util/json_util.h"
+
+namespace kv_server {
+
+std::string PrecomputeJsonValue(std::string_view value) {
+  std::string serialized_json;
+  google::protobuf::Value value_proto;
+  if (google::protobuf::util::JsonStringToMessage(value, &value_proto).ok()) {
+    value_proto.SerializeToString(&serialized_json);
+  }
+  const uint32_t size = serialized_json.size();
+  std::string stored_value;
+  stored_value.reserve(value.size() + serialized_json.size() + sizeof(size));
+  stored_value.append(value)
+      .append(serialized_json)
+      .append(reinterpret_cast<const char*>(&size), sizeof(size));
+  return stored_value;
+}
+
+PrecomputedJsonValue SplitPrecomputedJsonValue(std::string_view stored_value) {
+  uint32_t size;
+  if (stored_value.size() < sizeof(size)) {
+    return {.value = stored_value};
+  }
+  std::memcpy(&size, stored_value.data() + stored_value.size() - sizeof(size),
+              sizeof(size));
+  const size_t value_size = stored_value.size() - sizeof(size) - size;
+  return {.value = stored_value.substr(0, value_size),
+          .serialized_json = stored_value.substr(value_size, size)};
+}
+
+}  // namespace kv_server
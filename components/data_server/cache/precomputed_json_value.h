@@ -0,0 +1,49 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef COMPONENTS_DATA_SERVER_CACHE_PRECOMPUTED_JSON_VALUE_H_
+#define COMPONENTS_DATA_SERVER_CACHE_PRECOMPUTED_JSON_VALUE_H_
+
+#include <string>
+#include <string_view>
+
+namespace kv_server {
+
+// Caches that precompute JSON values parse every value once when it is
+// loaded, instead of V1 lookups parsing it on every request. The stored value
+// is laid out as [value][serialized json][serialized json size], the size
+// being an unaligned 32 bit integer, so that caches keep storing one string
+// per key.
+
+// A stored value split into its parts.
+struct PrecomputedJsonValue {
+  std::string_view value;
+  // `google.protobuf.Value` that `value` parses into as JSON, serialized.
+  // Empty if `value` is not JSON.
+  std::string_view serialized_json;
+};
+
+// Returns `value` with its precomputed JSON form appended.
+std::string PrecomputeJsonValue(std::string_view value);
+
+// Splits a value returned by `PrecomputeJsonValue`. Values too short to hold
+// the size, such as the empty values of deleted keys, are returned as they
+// are.
+PrecomputedJsonValue SplitPrecomputedJsonValue(std::string_view stored_value);
+
+}  // namespace kv_server
+
+#endif  // COMPONENTS_DATA_SERVER_CACHE_PRECOMPUTED_JSON_VALUE_H_
@@ -0,0 +1,65 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/data_server/cache/precomputed_json_value.h"
+
+#include <string>
+
+#include "google/protobuf/struct.pb.h"
+#include "gtest/gtest.h"
+
+namespace kv_server {
+namespace {
+
+TEST(PrecomputedJsonValueTest, JsonValue) {
+  const std::string stored_value = PrecomputeJsonValue(R"({"a":[1,"b"]})");
+  const PrecomputedJsonValue value = SplitPrecomputedJsonValue(stored_value);
+  EXPECT_EQ(value.value, R"({"a":[1,"b"]})");
+  google::protobuf::Value value_proto;
+  ASSERT_TRUE(value_proto.ParseFromArray(value.serialized_json.data(),
+                                         value.serialized_json.size()));
+  const auto& list = value_proto.struct_value().fields().at("a").list_value();
+  ASSERT_EQ(list.values_size(), 2);
+  EXPECT_EQ(list.values(0).number_value(), 1);
+  EXPECT_EQ(list.values(1).string_value(), "b");
+}
+
+TEST(PrecomputedJsonValueTest, JsonScalar) {
+  const std::string stored_value = PrecomputeJsonValue(R"("string")");
+  const PrecomputedJsonValue value = SplitPrecomputedJsonValue(stored_value);
+  EXPECT_EQ(value.value, R"("string")");
+  google::protobuf::Value value_proto;
+  ASSERT_TRUE(value_proto.ParseFromArray(value.serialized_json.data(),
+                                         value.serialized_json.size()));
+  EXPECT_EQ(value_proto.string_value(), "string");
+}
+
+TEST(PrecomputedJsonValueTest, NonJsonValue) {
+  const std::string stored_value = PrecomputeJsonValue("not json");
+  const PrecomputedJsonValue value = SplitPrecomputedJsonValue(stored_value);
+  EXPECT_EQ(value.value, "not json");
+  EXPECT_TRUE(value.serialized_json.empty());
+}
+
+TEST(PrecomputedJsonValueTest, EmptyValue) {
+  const std::string stored_value = PrecomputeJsonValue("");
+  EXPECT_EQ(SplitPrecomputedJsonValue(stored_value).value, "");
+  // Deleted keys store empty values as they are.
+  const PrecomputedJsonValue value = SplitPrecomputedJsonValue("");
+  EXPECT_EQ(value.value, "");
+  EXPECT_TRUE(value.serialized_json.empty());
+}
+
+}  // namespace
+}  // namespace kv_server
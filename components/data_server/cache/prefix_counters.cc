@@ -0,0 +1,67 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/data_server/cache/prefix_counters.h"
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace kv_server {
+
+PrefixCounters::Id PrefixCounters::IdOf(std::string_view prefix) {
+  {
+    absl::ReaderMutexLock lock(&mutex_);
+    if (const auto it = ids_.find(prefix); it != ids_.end()) {
+      return it->second;
+    }
+  }
+  absl::MutexLock lock(&mutex_);
+  if (const auto it = ids_.find(prefix); it != ids_.end()) {
+    return it->second;
+  }
+  if (prefixes_.size() == kMaxPrefixes) {
+    return kMaxPrefixes - 1;
+  }
+  const Id id = prefixes_.size();
+  prefixes_.push_back(prefixes_.size() == kMaxPrefixes - 1
+                          ? std::string(kOverflowPrefix)
+                          : std::string(prefix));
+  ids_.emplace(prefix, id);
+  return id;
+}
+
+std::vector<std::string> PrefixCounters::Prefixes() const {
+  absl::ReaderMutexLock lock(&mutex_);
+  return prefixes_;
+}
+
+absl::flat_hash_map<std::string, PrefixStats> PrefixCounters::Get() const {
+  absl::flat_hash_map<std::string, PrefixStats> stats;
+  absl::ReaderMutexLock lock(&mutex_);
+  for (size_t id = 0; id < prefixes_.size(); id++) {
+    const Counters& counters = counters_[id];
+    stats[prefixes_[id]] = {
+        .num_keys = counters.num_keys.load(std::memory_order_relaxed),
+        .value_bytes = counters.value_bytes.load(std::memory_order_relaxed),
+        .num_set_values =
+            counters.num_set_values.load(std::memory_order_relaxed),
+        .num_tombstones =
+            counters.num_tombstones.load(std::memory_order_relaxed),
+    };
+  }
+  return stats;
+}
+
+}  // namespace kv_server
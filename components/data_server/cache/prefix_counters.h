@@ -0,0 +1,95 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef COMPONENTS_DATA_SERVER_CACHE_PREFIX_COUNTERS_H_
+#define COMPONENTS_DATA_SERVER_CACHE_PREFIX_COUNTERS_H_
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/synchronization/mutex.h"
+#include "components/data_server/cache/cache.h"
+
+namespace kv_server {
+
+// Counts the data that a cache holds for every prefix, updated by the cache
+// as entries are added, changed and removed. Prefixes are assigned small ids,
+// which cache entries store to find the counters of their prefix when they
+// change again.
+//
+// Thread safe.
+class PrefixCounters {
+ public:
+  using Id = uint8_t;
+
+  // Prefixes beyond the first `kMaxPrefixes - 1` share the last id, which is
+  // reported as `kOverflowPrefix`.
+  static constexpr size_t kMaxPrefixes = 64;
+  static constexpr std::string_view kOverflowPrefix = "<other>";
+
+  PrefixCounters() = default;
+  PrefixCounters(const PrefixCounters&) = delete;
+  PrefixCounters& operator=(const PrefixCounters&) = delete;
+
+  // Returns the id of `prefix`, assigning one if needed.
+  Id IdOf(std::string_view prefix) ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Returns the prefixes that were assigned an id, indexed by id.
+  std::vector<std::string> Prefixes() const ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Adjust the counters of the prefix of `id`.
+  void AddKeys(Id id, int64_t num_keys, int64_t value_bytes) {
+    counters_[id].num_keys.fetch_add(num_keys, std::memory_order_relaxed);
+    counters_[id].value_bytes.fetch_add(value_bytes,
+                                        std::memory_order_relaxed);
+  }
+  void AddSetValues(Id id, int64_t num_set_values) {
+    counters_[id].num_set_values.fetch_add(num_set_values,
+                                           std::memory_order_relaxed);
+  }
+  void AddTombstones(Id id, int64_t num_tombstones) {
+    counters_[id].num_tombstones.fetch_add(num_tombstones,
+                                           std::memory_order_relaxed);
+  }
+
+  // Returns the counters of every prefix that was assigned an id.
+  absl::flat_hash_map<std::string, PrefixStats> Get() const
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+ private:
+  struct Counters {
+    std::atomic<int64_t> num_keys = 0;
+    std::atomic<int64_t> value_bytes = 0;
+    std::atomic<int64_t> num_set_values = 0;
+    std::atomic<int64_t> num_tombstones = 0;
+  };
+
+  mutable absl::Mutex mutex_;
+  // Indexed by id.
+  std::vector<std::string> prefixes_ ABSL_GUARDED_BY(mutex_);
+  absl::flat_hash_map<std::string, Id> ids_ ABSL_GUARDED_BY(mutex_);
+  std::array<Counters, kMaxPrefixes> counters_;
+};
+
+}  // namespace kv_server
+
+#endif  // COMPONENTS_DATA_SERVER_CACHE_PREFIX_COUNTERS_H_
@@ -0,0 +1,73 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/data_server/cache/prefix_counters.h"
+
+#include <string>
+
+#include "absl/strings/str_cat.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace kv_server {
+namespace {
+
+using testing::ElementsAre;
+using testing::IsEmpty;
+
+TEST(PrefixCountersTest, AssignsOneIdPerPrefix) {
+  PrefixCounters counters;
+  const PrefixCounters::Id id = counters.IdOf("prefix1");
+  EXPECT_EQ(counters.IdOf("prefix1"), id);
+  EXPECT_NE(counters.IdOf("prefix2"), id);
+  EXPECT_THAT(counters.Prefixes(), ElementsAre("prefix1", "prefix2"));
+}
+
+TEST(PrefixCountersTest, CountsPerPrefix) {
+  PrefixCounters counters;
+  EXPECT_THAT(counters.Get(), IsEmpty());
+  const PrefixCounters::Id id1 = counters.IdOf("prefix1");
+  const PrefixCounters::Id id2 = counters.IdOf("prefix2");
+  counters.AddKeys(id1, 2, 10);
+  counters.AddKeys(id1, -1, -4);
+  counters.AddSetValues(id1, 3);
+  counters.AddTombstones(id2, 1);
+  const auto stats = counters.Get();
+  ASSERT_EQ(stats.size(), 2);
+  EXPECT_EQ(stats.at("prefix1").num_keys, 1);
+  EXPECT_EQ(stats.at("prefix1").value_bytes, 6);
+  EXPECT_EQ(stats.at("prefix1").num_set_values, 3);
+  EXPECT_EQ(stats.at("prefix1").num_tombstones, 0);
+  EXPECT_EQ(stats.at("prefix2").num_keys, 0);
+  EXPECT_EQ(stats.at("prefix2").num_tombstones, 1);
+}
+
+TEST(PrefixCountersTest, SharesLastIdBeyondMaxPrefixes) {
+  PrefixCounters counters;
+  for (size_t i = 0; i < PrefixCounters::kMaxPrefixes - 1; i++) {
+    counters.IdOf(absl::StrCat("prefix", i));
+  }
+  const PrefixCounters::Id last_id = counters.IdOf("last");
+  EXPECT_EQ(last_id, PrefixCounters::kMaxPrefixes - 1);
+  EXPECT_EQ(counters.IdOf("beyond"), last_id);
+  counters.AddKeys(counters.IdOf("last"), 1, 1);
+  counters.AddKeys(counters.IdOf("beyond"), 1, 1);
+  const auto stats = counters.Get();
+  EXPECT_EQ(stats.size(), PrefixCounters::kMaxPrefixes);
+  EXPECT_EQ(stats.at(std::string(PrefixCounters::kOverflowPrefix)).num_keys,
+            2);
+}
+
+}  // namespace
+}  // namespace kv_server
@@ -0,0 +1,50 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/data_server/cache/prefix_stats_logger.h"
+
+#include <cstdint>
+#include <string>
+
+#include "components/telemetry/server_definition.h"
+
+namespace kv_server {
+namespace {
+
+template <const auto& definition>
+void LogChange(const std::string& prefix, int64_t change) {
+  if (change == 0) {
+    return;
+  }
+  LogIfError(KVServerContextMap()->SafeMetric().LogUpDownCounter<definition>(
+      {{prefix, static_cast<double>(change)}}));
+}
+
+}  // namespace
+
+void PrefixStatsLogger::Log() {
+  for (const auto& [prefix, stats] : cache_.GetPrefixStats()) {
+    PrefixStats& logged = logged_stats_[prefix];
+    LogChange<kCachePrefixKeyCount>(prefix, stats.num_keys - logged.num_keys);
+    LogChange<kCachePrefixValueBytes>(prefix,
+                                      stats.value_bytes - logged.value_bytes);
+    LogChange<kCachePrefixSetValueCount>(
+        prefix, stats.num_set_values - logged.num_set_values);
+    LogChange<kCachePrefixTombstoneCount>(
+        prefix, stats.num_tombstones - logged.num_tombstones);
+    logged = stats;
+  }
+}
+
+}  // namespace kv_server
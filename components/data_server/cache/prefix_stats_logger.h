@@ -0,0 +1,46 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef COMPONENTS_DATA_SERVER_CACHE_PREFIX_STATS_LOGGER_H_
+#define COMPONENTS_DATA_SERVER_CACHE_PREFIX_STATS_LOGGER_H_
+
+#include <string>
+
+#include "absl/container/flat_hash_map.h"
+#include "components/data_server/cache/cache.h"
+
+namespace kv_server {
+
+// Logs the `Cache::GetPrefixStats` of a cache as gauges partitioned by
+// prefix. The metrics are up-down counters, so every call logs how much the
+// stats changed since the previous call.
+//
+// Not thread safe.
+class PrefixStatsLogger {
+ public:
+  // `cache` must outlive the logger.
+  explicit PrefixStatsLogger(const Cache& cache) : cache_(cache) {}
+
+  void Log();
+
+ private:
+  const Cache& cache_;
+  absl::flat_hash_map<std::string, PrefixStats> logged_stats_;
+};
+
+}  // namespace kv_server
+
+#endif  // COMPONENTS_DATA_SERVER_CACHE_PREFIX_STATS_LOGGER_H_
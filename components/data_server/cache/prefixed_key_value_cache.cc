@@ -0,0 +1,726 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include "components/data_server/cache/prefixed_key_value_cache.h"
+
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/time/time.h"
+#include "components/data_server/cache/cache.h"
+#include "components/data_server/cache/checkpoint_io.h"
+#include "components/data_server/cache/get_key_value_result.h"
+#include "components/data_server/cache/get_key_value_set_result.h"
+#include "components/data_server/cache/get_uint32_value_set_result.h"
+#include "components/data_server/cache/hashed_key.h"
+#include "components/data_server/cache/key_value_cache.h"
+#include "components/data_server/cache/sorted_key_index.h"
+
+namespace kv_server {
+namespace {
+
+// Identifies the checkpoints written by `PrefixedKeyValueCache`.
+constexpr char kCheckpointType[] = "PrefixedKeyValueCache";
+
+// Keeps the sub-caches that a lookup was served from alive until its result
+// is destroyed, even if their prefixes are dropped in the meantime.
+class PrefixedKeyValueResult : public GetKeyValueResult {
+ public:
+  PrefixedKeyValueResult(
+      std::vector<std::shared_ptr<const KeyValueCache>> sub_caches,
+      std::unique_ptr<GetKeyValueResult> result)
+      : sub_caches_(std::move(sub_caches)), result_(std::move(result)) {}
+
+  std::optional<std::string_view> GetValue(
+      std::string_view key) const override {
+    return result_->GetValue(key);
+  }
+
+  std::optional<std::string_view> GetSerializedJsonValue(
+      std::string_view key) const override {
+    return result_->GetSerializedJsonValue(key);
+  }
+
+  size_t size() const override { return result_->size(); }
+
+ private:
+  // Only called by the caches that create results.
+  void AddKeyValue(std::string_view key, std::string_view value,
+                   std::shared_ptr<const void> value_owner,
+                   std::optional<std::string_view> serialized_json) override {}
+
+  // Declared before `result_` so that they outlive it.
+  std::vector<std::shared_ptr<const KeyValueCache>> sub_caches_;
+  std::unique_ptr<GetKeyValueResult> result_;
+};
+
+class PrefixedUInt32ValueSetResult : public GetUInt32ValueSetResult {
+ public:
+  PrefixedUInt32ValueSetResult(
+      std::vector<std::shared_ptr<const KeyValueCache>> sub_caches,
+      std::unique_ptr<GetUInt32ValueSetResult> result)
+      : sub_caches_(std::move(sub_caches)), result_(std::move(result)) {}
+
+  const RoaringBitmap& GetValueSet(std::string_view key) const override {
+    return result_->GetValueSet(key);
+  }
+
+ private:
+  // Only called by the caches that create results.
+  void AddValueSet(std::string_view key, const RoaringBitmap& values,
+                   std::unique_ptr<absl::ReaderMutexLock> key_lock) override {}
+
+  void AddOwnedValueSet(std::string_view key, RoaringBitmap values) override {}
+
+  // Declared before `result_` so that the set locks that it holds are
+  // released before the sub-caches they belong to are destroyed.
+  std::vector<std::shared_ptr<const KeyValueCache>> sub_caches_;
+  std::unique_ptr<GetUInt32ValueSetResult> result_;
+};
+
+}  // namespace
+
+PrefixedKeyValueCache::PrefixedKeyValueCache(
+    std::shared_ptr<ValueInterner> value_interner, bool precompute_json_values,
+    std::shared_ptr<ValueCompressor> value_compressor,
+    std::shared_ptr<ValueInterner> value_store)
+    : value_interner_(std::move(value_interner)),
+      precompute_json_values_(precompute_json_values),
+      value_compressor_(std::move(value_compressor)),
+      value_store_(std::move(value_store)) {}
+
+absl::flat_hash_map<std::string, std::string>
+PrefixedKeyValueCache::GetKeyValuePairs(
+    const RequestContext& request_context,
+    const absl::flat_hash_set<std::string_view>& key_set) const {
+  ScopeLatencyMetricsRecorder<InternalLookupMetricsContext,
+                              kGetValuePairsLatencyInMicros>
+      latency_recorder(request_context.GetInternalLookupMetricsContext());
+  absl::flat_hash_map<std::string, std::string> kv_pairs;
+  kv_pairs.reserve(key_set.size());
+  const SubCaches sub_caches = GetSubCaches();
+  const auto partitioned_keys = PartitionKeys(sub_caches, HashKeys(key_set));
+  for (size_t i = 0; i < sub_caches.size(); i++) {
+    if (!partitioned_keys[i].empty()) {
+      sub_caches[i].second->CollectKeyValuePairs(partitioned_keys[i],
+                                                 kv_pairs);
+    }
+  }
+  if (kv_pairs.empty()) {
+    LogCacheAccessMetrics(request_context, kKeyValueCacheMiss);
+  } else {
+    LogCacheAccessMetrics(request_context, kKeyValueCacheHit);
+  }
+  return kv_pairs;
+}
+
+std::unique_ptr<GetKeyValueResult> PrefixedKeyValueCache::GetKeyValues(
+    const RequestContext& request_context,
+    const absl::flat_hash_set<std::string_view>& key_set) const {
+  ScopeLatencyMetricsRecorder<InternalLookupMetricsContext,
+                              kGetValuePairsLatencyInMicros>
+      latency_recorder(request_context.GetInternalLookupMetricsContext());
+  auto result = GetKeyValueResult::Create();
+  std::vector<std::shared_ptr<const KeyValueCache>> used_sub_caches;
+  const SubCaches sub_caches = GetSubCaches();
+  const auto partitioned_keys = PartitionKeys(sub_caches, HashKeys(key_set));
+  for (size_t i = 0; i < sub_caches.size(); i++) {
+    if (!partitioned_keys[i].empty()) {
+      sub_caches[i].second->CollectKeyValues(partitioned_keys[i], *result);
+      used_sub_caches.push_back(sub_caches[i].second);
+    }
+  }
+  if (result->size() == 0) {
+    LogCacheAccessMetrics(request_context, kKeyValueCacheMiss);
+  } else {
+    LogCacheAccessMetrics(request_context, kKeyValueCacheHit);
+  }
+  return std::make_unique<PrefixedKeyValueResult>(std::move(used_sub_caches),
+                                                  std::move(result));
+}
+
+std::unique_ptr<GetKeyValueSetResult> PrefixedKeyValueCache::GetKeyValueSet(
+    const RequestContext& request_context,
+    const absl::flat_hash_set<std::string_view>& key_set) const {
+  ScopeLatencyMetricsRecorder<InternalLookupMetricsContext,
+                              kGetKeyValueSetLatencyInMicros>
+      latency_recorder(request_context.GetInternalLookupMetricsContext());
+  auto result = GetKeyValueSetResult::Create();
+  bool cache_hit = false;
+  const SubCaches sub_caches = GetSubCaches();
+  const auto partitioned_keys = PartitionSetKeys(
+      sub_caches, HashKeys(key_set), /*uint32_sets=*/false);
+  for (size_t i = 0; i < sub_caches.size(); i++) {
+    if (!partitioned_keys[i].empty()) {
+      // The snapshots of the sets do not need the sub-cache to stay alive.
+      cache_hit |= sub_caches[i].second->CollectKeyValueSets(
+          partitioned_keys[i], *result);
+    }
+  }
+  if (cache_hit) {
+    LogCacheAccessMetrics(request_context, kKeyValueSetCacheHit);
+  } else {
+    LogCacheAccessMetrics(request_context, kKeyValueSetCacheMiss);
+  }
+  return result;
+}
+
+std::unique_ptr<GetUInt32ValueSetResult>
+PrefixedKeyValueCache::GetUInt32ValueSet(
+    const RequestContext& request_context,
+    const absl::flat_hash_set<std::string_view>& key_set) const {
+  ScopeLatencyMetricsRecorder<InternalLookupMetricsContext,
+                              kGetKeyValueSetLatencyInMicros>
+      latency_recorder(request_context.GetInternalLookupMetricsContext());
+  auto result = GetUInt32ValueSetResult::Create();
+  std::vector<std::shared_ptr<const KeyValueCache>> used_sub_caches;
+  bool cache_hit = false;
+  const SubCaches sub_caches = GetSubCaches();
+  const auto partitioned_keys = PartitionSetKeys(
+      sub_caches, HashKeys(key_set), /*uint32_sets=*/true);
+  for (size_t i = 0; i < sub_caches.size(); i++) {
+    if (!partitioned_keys[i].empty()) {
+      cache_hit |= sub_caches[i].second->CollectUInt32ValueSets(
+          partitioned_keys[i], *result);
+      used_sub_caches.push_back(sub_caches[i].second);
+    }
+  }
+  if (cache_hit) {
+    LogCacheAccessMetrics(request_context, kKeyValueSetCacheHit);
+  } else {
+    LogCacheAccessMetrics(request_context, kKeyValueSetCacheMiss);
+  }
+  return std::make_unique<PrefixedUInt32ValueSetResult>(
+      std::move(used_sub_caches), std::move(result));
+}
+
+void PrefixedKeyValueCache::UpdateKeyValue(std::string_view key,
+                                           std::string_view value,
+                                           int64_t logical_commit_time,
+                                           std::string_view prefix) {
+  GetOrCreateSubCache(prefix)->UpdateKeyValue(key, value, logical_commit_time,
+                                              prefix);
+}
+
+void PrefixedKeyValueCache::UpdateKeyValueSet(
+    std::string_view key, absl::Span<std::string_view> input_value_set,
+    int64_t logical_commit_time, std::string_view prefix) {
+  GetOrCreateSubCache(prefix)->UpdateKeyValueSet(key, input_value_set,
+                                                 logical_commit_time, prefix);
+}
+
+void PrefixedKeyValueCache::UpdateKeyValueUInt32Set(
+    std::string_view key, absl::Span<const uint32_t> value_set,
+    int64_t logical_commit_time, std::string_view prefix) {
+  GetOrCreateSubCache(prefix)->UpdateKeyValueUInt32Set(
+      key, value_set, logical_commit_time, prefix);
+}
+
+void PrefixedKeyValueCache::DeleteKey(std::string_view key,
+                                      int64_t logical_commit_time,
+                                      std::string_view prefix) {
+  GetOrCreateSubCache(prefix)->DeleteKey(key, logical_commit_time, prefix);
+  const CacheMutation mutation = {
+      .type = CacheMutation::Type::kDeleteKey,
+      .key = key,
+      .logical_commit_time = logical_commit_time,
+  };
+  PropagateDeletions({&mutation, 1}, prefix);
+}
+
+void PrefixedKeyValueCache::DeleteValuesInSet(
+    std::string_view key, absl::Span<std::string_view> value_set,
+    int64_t logical_commit_time, std::string_view prefix) {
+  GetOrCreateSubCache(prefix)->DeleteValuesInSet(key, value_set,
+                                                 logical_commit_time, prefix);
+  const CacheMutation mutation = {
+      .type = CacheMutation::Type::kDeleteValuesInSet,
+      .key = key,
+      .value_set = value_set,
+      .logical_commit_time = logical_commit_time,
+  };
+  PropagateDeletions({&mutation, 1}, prefix);
+}
+
+void PrefixedKeyValueCache::DeleteValuesInUInt32Set(
+    std::string_view key, absl::Span<const uint32_t> value_set,
+    int64_t logical_commit_time, std::string_view prefix) {
+  GetOrCreateSubCache(prefix)->DeleteValuesInUInt32Set(
+      key, value_set, logical_commit_time, prefix);
+  const CacheMutation mutation = {
+      .type = CacheMutation::Type::kDeleteValuesInUInt32Set,
+      .key = key,
+      .logical_commit_time = logical_commit_time,
+      .uint32_value_set = value_set,
+  };
+  PropagateDeletions({&mutation, 1}, prefix);
+}
+
+void PrefixedKeyValueCache::ApplyBatch(
+    absl::Span<const CacheMutation> mutations, std::string_view prefix) {
+  GetOrCreateSubCache(prefix)->ApplyBatch(mutations, prefix);
+  PropagateDeletions(mutations, prefix);
+}
+
+void PrefixedKeyValueCache::RemoveDeletedKeys(int64_t logical_commit_time,
+                                              std::string_view prefix) {
+  ScopeLatencyMetricsRecorder<ServerSafeMetricsContext,
+                              kRemoveDeletedKeyLatency>
+      latency_recorder(KVServerContextMap()->SafeMetric());
+  std::shared_ptr<KeyValueCache> sub_cache;
+  {
+    absl::ReaderMutexLock lock(&mutex_);
+    if (const auto it = sub_caches_.find(prefix); it != sub_caches_.end()) {
+      sub_cache = it->second;
+    }
+  }
+  if (sub_cache == nullptr) {
+    return;
+  }
+  if (cleanup_closure_ != nullptr) {
+    sub_cache->SetCleanupTime(logical_commit_time, prefix);
+    return;
+  }
+  sub_cache->CleanUpKeyValueMap(logical_commit_time, prefix);
+  sub_cache->CleanUpKeyValueSetMap(logical_commit_time, prefix);
+}
+
+absl::Status PrefixedKeyValueCache::StartBackgroundCleanup(
+    absl::Duration interval, absl::Duration max_pause) {
+  if (cleanup_closure_ != nullptr) {
+    return absl::FailedPreconditionError("Background cleanup already started");
+  }
+  cleanup_closure_ = PeriodicClosure::Create();
+  return cleanup_closure_->StartDelayed(interval, [this, max_pause]() {
+    int64_t num_left = 0;
+    for (const auto& [prefix, sub_cache] : GetSubCaches()) {
+      num_left += sub_cache->RemoveDeletedKeysInSlices(max_pause);
+    }
+    LogIfError(
+        KVServerContextMap()->SafeMetric().LogHistogram<kCacheTombstoneCount>(
+            static_cast<double>(num_left)));
+  });
+}
+
+absl::Status PrefixedKeyValueCache::ForEachKey(
+    absl::FunctionRef<void(std::string_view key)> callback) const {
+  for (const auto& [prefix, sub_cache] : GetSubCaches()) {
+    if (absl::Status status = sub_cache->ForEachKey(callback); !status.ok()) {
+      return status;
+    }
+  }
+  return absl::OkStatus();
+}
+
+absl::flat_hash_map<std::string, PrefixStats>
+PrefixedKeyValueCache::GetPrefixStats() const {
+  absl::flat_hash_map<std::string, PrefixStats> stats;
+  for (const auto& [prefix, sub_cache] : GetSubCaches()) {
+    for (const auto& [stats_prefix, sub_cache_stats] :
+         sub_cache->GetPrefixStats()) {
+      stats[stats_prefix] += sub_cache_stats;
+    }
+  }
+  return stats;
+}
+
+absl::Status PrefixedKeyValueCache::EnableSetValueIndex() {
+  absl::MutexLock lock(&mutex_);
+  for (const auto& [prefix, sub_cache] : sub_caches_) {
+    if (absl::Status status = sub_cache->EnableSetValueIndex(); !status.ok()) {
+      return status;
+    }
+  }
+  index_set_values_ = true;
+  return absl::OkStatus();
+}
+
+absl::StatusOr<std::vector<std::string>>
+PrefixedKeyValueCache::GetKeysContaining(const RequestContext& request_context,
+                                         std::string_view value) const {
+  if (!index_set_values_) {
+    return absl::FailedPreconditionError("The set value index is not enabled.");
+  }
+  const SubCaches sub_caches = GetSubCaches();
+  std::vector<absl::flat_hash_set<std::string>> sub_cache_keys(
+      sub_caches.size());
+  for (size_t i = 0; i < sub_caches.size(); i++) {
+    absl::StatusOr<std::vector<std::string>> keys =
+        sub_caches[i].second->GetKeysContaining(request_context, value);
+    if (!keys.ok()) {
+      return keys.status();
+    }
+    sub_cache_keys[i].insert(std::make_move_iterator(keys->begin()),
+                             std::make_move_iterator(keys->end()));
+  }
+  absl::flat_hash_set<std::string_view> candidate_keys;
+  for (const auto& keys : sub_cache_keys) {
+    candidate_keys.insert(keys.begin(), keys.end());
+  }
+  // A key is only returned by the sub-cache that serves its set, which may
+  // not hold the value even if an older set of another prefix does.
+  const auto partitioned_keys = PartitionSetKeys(
+      sub_caches, HashKeys(candidate_keys), /*uint32_sets=*/false);
+  std::vector<std::string> keys;
+  for (size_t i = 0; i < sub_caches.size(); i++) {
+    for (const HashedKey& key : partitioned_keys[i]) {
+      if (sub_cache_keys[i].contains(key.key)) {
+        keys.emplace_back(key.key);
+      }
+    }
+  }
+  return keys;
+}
+
+absl::Status PrefixedKeyValueCache::EnableSortedKeyIndex() {
+  absl::MutexLock lock(&mutex_);
+  for (const auto& [prefix, sub_cache] : sub_caches_) {
+    if (absl::Status status = sub_cache->EnableSortedKeyIndex(); !status.ok()) {
+      return status;
+    }
+  }
+  index_keys_ = true;
+  return absl::OkStatus();
+}
+
+absl::Status PrefixedKeyValueCache::EnableHotKeyTracking(
+    int32_t sample_rate) {
+  absl::MutexLock lock(&mutex_);
+  for (const auto& [prefix, sub_cache] : sub_caches_) {
+    if (absl::Status status = sub_cache->EnableHotKeyTracking(sample_rate);
+        !status.ok()) {
+      return status;
+    }
+  }
+  hot_key_sample_rate_ = sample_rate;
+  return absl::OkStatus();
+}
+
+HotKeys PrefixedKeyValueCache::GetHotKeys(int64_t num_keys_per_prefix) const {
+  HotKeys hot_keys;
+  for (const auto& [prefix, sub_cache] : GetSubCaches()) {
+    for (auto& [key_prefix, keys] :
+         sub_cache->GetHotKeys(num_keys_per_prefix)) {
+      std::vector<HotKey>& prefix_keys = hot_keys[key_prefix];
+      prefix_keys.insert(prefix_keys.end(),
+                         std::make_move_iterator(keys.begin()),
+                         std::make_move_iterator(keys.end()));
+    }
+  }
+  KeepHottestKeys(num_keys_per_prefix, hot_keys);
+  return hot_keys;
+}
+
+absl::StatusOr<std::vector<std::string>>
+PrefixedKeyValueCache::GetKeysWithPrefix(const RequestContext& request_context,
+                                         std::string_view key_prefix,
+                                         int64_t limit) const {
+  if (!index_keys_) {
+    return absl::FailedPreconditionError(
+        "The sorted key index is not enabled.");
+  }
+  const SubCaches sub_caches = GetSubCaches();
+  std::vector<absl::flat_hash_set<std::string>> sub_cache_keys(
+      sub_caches.size());
+  for (size_t i = 0; i < sub_caches.size(); i++) {
+    absl::StatusOr<std::vector<std::string>> keys =
+        sub_caches[i].second->GetKeysWithPrefix(request_context, key_prefix,
+                                                limit);
+    if (!keys.ok()) {
+      return keys.status();
+    }
+    sub_cache_keys[i].insert(std::make_move_iterator(keys->begin()),
+                             std::make_move_iterator(keys->end()));
+  }
+  absl::flat_hash_set<std::string_view> candidate_keys;
+  for (const auto& keys : sub_cache_keys) {
+    candidate_keys.insert(keys.begin(), keys.end());
+  }
+  // An older value of another prefix is not served if the key was deleted
+  // since.
+  const auto partitioned_keys =
+      PartitionKeys(sub_caches, HashKeys(candidate_keys));
+  std::vector<std::vector<std::string>> keys(1);
+  for (size_t i = 0; i < sub_caches.size(); i++) {
+    for (const HashedKey& key : partitioned_keys[i]) {
+      if (sub_cache_keys[i].contains(key.key)) {
+        keys[0].emplace_back(key.key);
+      }
+    }
+  }
+  return SortedKeyIndex::Merge(absl::MakeSpan(keys), limit);
+}
+
+absl::Status PrefixedKeyValueCache::WriteCheckpoint(
+    CheckpointWriter& writer) const {
+  const SubCaches sub_caches = GetSubCaches();
+  writer.WriteString(kCheckpointType);
+  writer.WriteInt64(sub_caches.size());
+  for (const auto& [prefix, sub_cache] : sub_caches) {
+    writer.WriteString(prefix);
+    if (absl::Status status = sub_cache->WriteCheckpoint(writer);
+        !status.ok()) {
+      return status;
+    }
+  }
+  return writer.status();
+}
+
+absl::Status PrefixedKeyValueCache::RestoreCheckpoint(
+    CheckpointReader& reader) {
+  std::string_view type;
+  int64_t num_prefixes;
+  if (!reader.ReadString(&type) || type != kCheckpointType ||
+      !reader.ReadInt64(&num_prefixes) || num_prefixes < 0) {
+    return absl::DataLossError("Invalid prefixed key value cache checkpoint.");
+  }
+  absl::flat_hash_map<std::string, std::shared_ptr<KeyValueCache>> sub_caches;
+  for (int64_t i = 0; i < num_prefixes; i++) {
+    std::string_view prefix;
+    if (!reader.ReadString(&prefix)) {
+      return absl::DataLossError(
+          "Invalid prefixed key value cache checkpoint.");
+    }
+    std::shared_ptr<KeyValueCache> sub_cache = NewSubCache();
+    if (absl::Status status = sub_cache->RestoreCheckpoint(reader);
+        !status.ok()) {
+      return status;
+    }
+    sub_caches.emplace(prefix, std::move(sub_cache));
+  }
+  absl::MutexLock lock(&mutex_);
+  sub_caches_ = std::move(sub_caches);
+  return absl::OkStatus();
+}
+
+void PrefixedKeyValueCache::DropPrefix(std::string_view prefix) {
+  std::shared_ptr<KeyValueCache> sub_cache;
+  {
+    absl::MutexLock lock(&mutex_);
+    const auto it = sub_caches_.find(prefix);
+    if (it == sub_caches_.end()) {
+      return;
+    }
+    sub_cache = std::move(it->second);
+    sub_caches_.erase(it);
+  }
+  // The sub-cache is destroyed here, outside of `mutex_`, unless lookups or
+  // the background cleanup still use it.
+}
+
+std::shared_ptr<KeyValueCache> PrefixedKeyValueCache::GetOrCreateSubCache(
+    std::string_view prefix) {
+  {
+    absl::ReaderMutexLock lock(&mutex_);
+    if (const auto it = sub_caches_.find(prefix); it != sub_caches_.end()) {
+      return it->second;
+    }
+  }
+  // Created outside of `mutex_`, the first update of a prefix is rare.
+  std::shared_ptr<KeyValueCache> sub_cache = NewSubCache();
+  absl::MutexLock lock(&mutex_);
+  return sub_caches_.try_emplace(prefix, std::move(sub_cache)).first->second;
+}
+
+std::shared_ptr<KeyValueCache> PrefixedKeyValueCache::NewSubCache() const {
+  auto sub_cache = std::make_shared<KeyValueCache>(
+      value_interner_, precompute_json_values_, value_compressor_,
+      value_store_);
+  // Cannot fail, the sub-cache is empty.
+  if (index_set_values_) {
+    sub_cache->EnableSetValueIndex().IgnoreError();
+  }
+  if (index_keys_) {
+    sub_cache->EnableSortedKeyIndex().IgnoreError();
+  }
+  if (const int32_t sample_rate = hot_key_sample_rate_; sample_rate > 0) {
+    sub_cache->EnableHotKeyTracking(sample_rate).IgnoreError();
+  }
+  return sub_cache;
+}
+
+PrefixedKeyValueCache::SubCaches PrefixedKeyValueCache::GetSubCaches() const {
+  absl::ReaderMutexLock lock(&mutex_);
+  return SubCaches(sub_caches_.begin(), sub_caches_.end());
+}
+
+std::vector<std::vector<HashedKey>> PrefixedKeyValueCache::PartitionKeys(
+    const SubCaches& sub_caches, std::vector<HashedKey> keys) {
+  std::vector<std::vector<HashedKey>> partitioned_keys(sub_caches.size());
+  if (sub_caches.size() == 1) {
+    partitioned_keys[0] = std::move(keys);
+    return partitioned_keys;
+  }
+  // Every key is served by the sub-cache with its newest update or deletion,
+  // so the deletion of a key hides the older values of other prefixes.
+  std::vector<int64_t> newest_times(keys.size(), KeyValueCache::kNoUpdate);
+  std::vector<size_t> owners(keys.size(), sub_caches.size());
+  for (size_t i = 0; i < sub_caches.size(); i++) {
+    const std::vector<int64_t> times =
+        sub_caches[i].second->LastUpdateTimes(keys);
+    for (size_t k = 0; k < keys.size(); k++) {
+      if (times[k] > newest_times[k]) {
+        newest_times[k] = times[k];
+        owners[k] = i;
+      }
+    }
+  }
+  for (size_t k = 0; k < keys.size(); k++) {
+    if (owners[k] < sub_caches.size()) {
+      partitioned_keys[owners[k]].push_back(keys[k]);
+    }
+  }
+  return partitioned_keys;
+}
+
+std::vector<std::vector<HashedKey>> PrefixedKeyValueCache::PartitionSetKeys(
+    const SubCaches& sub_caches, std::vector<HashedKey> keys,
+    bool uint32_sets) {
+  std::vector<std::vector<HashedKey>> partitioned_keys(sub_caches.size());
+  if (sub_caches.size() == 1) {
+    partitioned_keys[0] = std::move(keys);
+    return partitioned_keys;
+  }
+  std::vector<std::vector<bool>> has_value_sets;
+  has_value_sets.reserve(sub_caches.size());
+  for (const auto& [prefix, sub_cache] : sub_caches) {
+    has_value_sets.push_back(uint32_sets ? sub_cache->HasUInt32ValueSets(keys)
+                                         : sub_cache->HasValueSets(keys));
+  }
+  for (size_t k = 0; k < keys.size(); k++) {
+    size_t owner = sub_caches.size();
+    int64_t newest_time = KeyValueCache::kNoUpdate;
+    int num_holders = 0;
+    for (size_t i = 0; i < sub_caches.size(); i++) {
+      if (!has_value_sets[i][k]) {
+        continue;
+      }
+      if (owner == sub_caches.size()) {
+        owner = i;
+      }
+      num_holders++;
+    }
+    // Sets are only scanned for their newest value when several prefixes
+    // hold the key, which is the exception.
+    for (size_t i = owner; num_holders > 1 && i < sub_caches.size(); i++) {
+      if (!has_value_sets[i][k]) {
+        continue;
+      }
+      if (const int64_t time =
+              uint32_sets
+                  ? sub_caches[i].second->NewestUInt32SetValueTime(keys[k])
+                  : sub_caches[i].second->NewestSetValueTime(keys[k]);
+          time > newest_time) {
+        newest_time = time;
+        owner = i;
+      }
+    }
+    if (owner < sub_caches.size()) {
+      partitioned_keys[owner].push_back(keys[k]);
+    }
+  }
+  return partitioned_keys;
+}
+
+void PrefixedKeyValueCache::PropagateDeletions(
+    absl::Span<const CacheMutation> mutations, std::string_view prefix) const {
+  std::vector<const CacheMutation*> key_deletions;
+  std::vector<HashedKey> deleted_keys;
+  std::vector<const CacheMutation*> set_deletions;
+  std::vector<HashedKey> deleted_set_keys;
+  std::vector<const CacheMutation*> uint32_set_deletions;
+  std::vector<HashedKey> deleted_uint32_set_keys;
+  for (const CacheMutation& mutation : mutations) {
+    if (mutation.type == CacheMutation::Type::kDeleteKey) {
+      key_deletions.push_back(&mutation);
+      deleted_keys.emplace_back(mutation.key);
+    } else if (mutation.type == CacheMutation::Type::kDeleteValuesInSet) {
+      set_deletions.push_back(&mutation);
+      deleted_set_keys.emplace_back(mutation.key);
+    } else if (mutation.type ==
+               CacheMutation::Type::kDeleteValuesInUInt32Set) {
+      uint32_set_deletions.push_back(&mutation);
+      deleted_uint32_set_keys.emplace_back(mutation.key);
+    }
+  }
+  if (key_deletions.empty() && set_deletions.empty() &&
+      uint32_set_deletions.empty()) {
+    return;
+  }
+  for (const auto& [other_prefix, sub_cache] : GetSubCaches()) {
+    if (other_prefix == prefix) {
+      continue;
+    }
+    // Only the sub-caches that hold a key are changed, so that a prefix
+    // deleting its keys does not add tombstones to every other prefix.
+    std::vector<CacheMutation> propagated;
+    if (!key_deletions.empty()) {
+      const std::vector<int64_t> times =
+          sub_cache->LastUpdateTimes(deleted_keys);
+      for (size_t k = 0; k < key_deletions.size(); k++) {
+        if (times[k] != KeyValueCache::kNoUpdate &&
+            times[k] < key_deletions[k]->logical_commit_time) {
+          propagated.push_back(*key_deletions[k]);
+        }
+      }
+    }
+    if (!set_deletions.empty()) {
+      const std::vector<bool> has_value_sets =
+          sub_cache->HasValueSets(deleted_set_keys);
+      for (size_t k = 0; k < set_deletions.size(); k++) {
+        if (has_value_sets[k]) {
+          propagated.push_back(*set_deletions[k]);
+        }
+      }
+    }
+    if (!uint32_set_deletions.empty()) {
+      const std::vector<bool> has_value_sets =
+          sub_cache->HasUInt32ValueSets(deleted_uint32_set_keys);
+      for (size_t k = 0; k < uint32_set_deletions.size(); k++) {
+        if (has_value_sets[k]) {
+          propagated.push_back(*uint32_set_deletions[k]);
+        }
+      }
+    }
+    if (!propagated.empty()) {
+      sub_cache->ApplyBatch(propagated, other_prefix);
+    }
+  }
+}
+
+void PrefixedKeyValueCache::LogCacheAccessMetrics(
+    const RequestContext& request_context,
+    std::string_view cache_access_event) const {
+  request_context.GetMetricsBatch().cache_access_events.Add(
+      cache_access_event);
+}
+
+std::unique_ptr<PrefixedKeyValueCache> PrefixedKeyValueCache::Create(
+    bool intern_set_values, bool precompute_json_values, bool compress_values,
+    bool deduplicate_values) {
+  return absl::WrapUnique(new PrefixedKeyValueCache(
+      intern_set_values ? std::make_shared<ValueInterner>() : nullptr,
+      precompute_json_values,
+      compress_values ? std::make_shared<ValueCompressor>() : nullptr,
+      deduplicate_values ? std::make_shared<ValueInterner>() : nullptr));
+}
+
+}  // namespace kv_server
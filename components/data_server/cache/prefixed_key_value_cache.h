@@ -0,0 +1,254 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef COMPONENTS_DATA_SERVER_CACHE_PREFIXED_KEY_VALUE_CACHE_H_
+#define COMPONENTS_DATA_SERVER_CACHE_PREFIXED_KEY_VALUE_CACHE_H_
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "components/data_server/cache/cache.h"
+#include "components/data_server/cache/checkpoint_io.h"
+#include "components/data_server/cache/get_key_value_result.h"
+#include "components/data_server/cache/get_key_value_set_result.h"
+#include "components/data_server/cache/get_uint32_value_set_result.h"
+#include "components/data_server/cache/hashed_key.h"
+#include "components/data_server/cache/key_value_cache.h"
+#include "components/data_server/cache/value_compressor.h"
+#include "components/data_server/cache/value_interner.h"
+#include "components/util/periodic_closure.h"
+
+namespace kv_server {
+
+// In-memory datastore that keeps the data of every prefix, i.e. of every data
+// source, in an independent `KeyValueCache` created on the first update of
+// the prefix. Loading or cleaning up one prefix only locks its own sub-cache,
+// so it never blocks the lookups and updates of other prefixes, and all the
+// data of a prefix is dropped at once with `DropPrefix`.
+//
+// A key that several prefixes hold is served from the prefix with the newest
+// update or deletion of it. A key-value set is served whole from the prefix
+// with the newest value in it, sets of several prefixes are not merged.
+// Deletions are also applied to the other prefixes that hold the key, so that
+// their older values do not reappear once the deletion is cleaned up.
+// One cache object is only for keys in one namespace.
+class PrefixedKeyValueCache : public Cache {
+ public:
+  // Looks up and returns key-value pairs for the given keys.
+  absl::flat_hash_map<std::string, std::string> GetKeyValuePairs(
+      const RequestContext& request_context,
+      const absl::flat_hash_set<std::string_view>& key_set) const override;
+
+  // Looks up the given keys and returns views of their values.
+  std::unique_ptr<GetKeyValueResult> GetKeyValues(
+      const RequestContext& request_context,
+      const absl::flat_hash_set<std::string_view>& key_set) const override;
+
+  // Looks up and returns key-value set result for the given key set.
+  std::unique_ptr<GetKeyValueSetResult> GetKeyValueSet(
+      const RequestContext& request_context,
+      const absl::flat_hash_set<std::string_view>& key_set) const override;
+
+  // Looks up and returns the sets of 32-bit unsigned integers of the given
+  // keys, each served whole like a key-value set.
+  std::unique_ptr<GetUInt32ValueSetResult> GetUInt32ValueSet(
+      const RequestContext& request_context,
+      const absl::flat_hash_set<std::string_view>& key_set) const override;
+
+  // Inserts or updates the key with the new value in the sub-cache of the
+  // prefix.
+  void UpdateKeyValue(std::string_view key, std::string_view value,
+                      int64_t logical_commit_time,
+                      std::string_view prefix = "") override;
+
+  // Inserts or updates values in the set for a given key in the sub-cache of
+  // the prefix, if a value exists, updates its timestamp to the latest logical
+  // commit time.
+  void UpdateKeyValueSet(std::string_view key,
+                         absl::Span<std::string_view> input_value_set,
+                         int64_t logical_commit_time,
+                         std::string_view prefix = "") override;
+
+  // Inserts or updates values in the set of 32-bit unsigned integers of the
+  // key in the sub-cache of the prefix.
+  void UpdateKeyValueUInt32Set(std::string_view key,
+                               absl::Span<const uint32_t> value_set,
+                               int64_t logical_commit_time,
+                               std::string_view prefix = "") override;
+
+  // Deletes the key in the sub-cache of the prefix and in the sub-caches of
+  // the other prefixes that hold an older value of it.
+  void DeleteKey(std::string_view key, int64_t logical_commit_time,
+                 std::string_view prefix = "") override;
+
+  // Deletes values in the set for a given key in the sub-cache of the prefix
+  // and in the sub-caches of the other prefixes that hold a set for the key.
+  void DeleteValuesInSet(std::string_view key,
+                         absl::Span<std::string_view> value_set,
+                         int64_t logical_commit_time,
+                         std::string_view prefix = "") override;
+
+  // Deletes values in the set of 32-bit unsigned integers of the key like
+  // `DeleteValuesInSet`.
+  void DeleteValuesInUInt32Set(std::string_view key,
+                               absl::Span<const uint32_t> value_set,
+                               int64_t logical_commit_time,
+                               std::string_view prefix = "") override;
+
+  // Applies `mutations` as one batch of the sub-cache of the prefix, and their
+  // deletions as one batch of every other sub-cache that holds their keys.
+  void ApplyBatch(absl::Span<const CacheMutation> mutations,
+                  std::string_view prefix = "") override;
+
+  // Removes the values that were deleted before the specified
+  // logical_commit_time from the sub-cache of the prefix only, or only
+  // records the time once `StartBackgroundCleanup` was called.
+  void RemoveDeletedKeys(int64_t logical_commit_time,
+                         std::string_view prefix = "") override;
+
+  // Cleans up the sub-caches one after another from a single background
+  // thread, see `KeyValueCache::StartBackgroundCleanup`.
+  absl::Status StartBackgroundCleanup(absl::Duration interval,
+                                      absl::Duration max_pause) override;
+
+  // Writes the number of prefixes followed by every prefix and the checkpoint
+  // of its sub-cache, one sub-cache at a time.
+  absl::Status WriteCheckpoint(CheckpointWriter& writer) const override;
+
+  // Restores the checkpoints of all prefixes into new sub-caches, and only
+  // replaces the sub-caches of this cache once all of them are restored.
+  absl::Status RestoreCheckpoint(CheckpointReader& reader) override;
+
+  // Visits the keys of one sub-cache at a time. Keys that several prefixes
+  // hold are visited once for each of them.
+  absl::Status ForEachKey(
+      absl::FunctionRef<void(std::string_view key)> callback) const override;
+
+  // Merges the counters of all sub-caches.
+  absl::flat_hash_map<std::string, PrefixStats> GetPrefixStats()
+      const override;
+
+  // Enables the set value index of the sub-caches, including those created
+  // later.
+  absl::Status EnableSetValueIndex() override;
+
+  // Merges the keys of all sub-caches, keeping the keys that several
+  // prefixes hold only if the value is in the set they are served from.
+  absl::StatusOr<std::vector<std::string>> GetKeysContaining(
+      const RequestContext& request_context,
+      std::string_view value) const override;
+
+  // Enables the sorted key index of the sub-caches, including those created
+  // later.
+  absl::Status EnableSortedKeyIndex() override;
+
+  // Merges the first `limit` keys of every sub-cache in order, keeping the
+  // keys that several prefixes hold only if the sub-cache that serves them
+  // holds a value.
+  absl::StatusOr<std::vector<std::string>> GetKeysWithPrefix(
+      const RequestContext& request_context, std::string_view key_prefix,
+      int64_t limit) const override;
+
+  // Tracks the hot keys of the sub-caches, including those created later.
+  absl::Status EnableHotKeyTracking(int32_t sample_rate) override;
+
+  // Merges the hottest keys of all sub-caches. A key that several prefixes
+  // hold is reported under every prefix that served it.
+  HotKeys GetHotKeys(int64_t num_keys_per_prefix) const override;
+
+  // Drops all the keys and values of `prefix` in constant time, as if it was
+  // never updated. Updates of the prefix in progress may be lost, lookups in
+  // progress keep the values they found.
+  void DropPrefix(std::string_view prefix);
+
+  // Creates a cache whose sub-caches share their set value interner, value
+  // compressor and value store, see `KeyValueCache`.
+  static std::unique_ptr<PrefixedKeyValueCache> Create(
+      bool intern_set_values = false, bool precompute_json_values = false,
+      bool compress_values = false, bool deduplicate_values = false);
+
+ private:
+  using SubCaches =
+      std::vector<std::pair<std::string, std::shared_ptr<KeyValueCache>>>;
+
+  PrefixedKeyValueCache(std::shared_ptr<ValueInterner> value_interner,
+                        bool precompute_json_values,
+                        std::shared_ptr<ValueCompressor> value_compressor,
+                        std::shared_ptr<ValueInterner> value_store);
+
+  // Returns the sub-cache of `prefix`, creating it if needed.
+  std::shared_ptr<KeyValueCache> GetOrCreateSubCache(std::string_view prefix)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+  std::shared_ptr<KeyValueCache> NewSubCache() const;
+
+  // Returns the prefixes and their sub-caches as of now.
+  SubCaches GetSubCaches() const ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Splits `keys` into the keys of every sub-cache of `sub_caches` that
+  // serves them, see the class comment. Keys that no sub-cache holds are
+  // left out. `PartitionSetKeys` partitions the keys of the sets of 32-bit
+  // unsigned integers if `uint32_sets`, and of the key-value sets otherwise.
+  static std::vector<std::vector<HashedKey>> PartitionKeys(
+      const SubCaches& sub_caches, std::vector<HashedKey> keys);
+  static std::vector<std::vector<HashedKey>> PartitionSetKeys(
+      const SubCaches& sub_caches, std::vector<HashedKey> keys,
+      bool uint32_sets);
+
+  // Applies the deletions of `mutations`, which were applied to the sub-cache
+  // of `prefix`, to the other sub-caches that hold their keys.
+  void PropagateDeletions(absl::Span<const CacheMutation> mutations,
+                          std::string_view prefix) const;
+
+  // Logs cache access metrics for cache hit or miss counts. The cache access
+  // event name is defined in server_definition.h file
+  void LogCacheAccessMetrics(const RequestContext& request_context,
+                             std::string_view cache_access_event) const;
+
+  const std::shared_ptr<ValueInterner> value_interner_;
+  const bool precompute_json_values_;
+  const std::shared_ptr<ValueCompressor> value_compressor_;
+  const std::shared_ptr<ValueInterner> value_store_;
+  // Set once `EnableSetValueIndex` was called.
+  std::atomic<bool> index_set_values_ = false;
+  // Set once `EnableSortedKeyIndex` was called.
+  std::atomic<bool> index_keys_ = false;
+  // Set once `EnableHotKeyTracking` was called.
+  std::atomic<int32_t> hot_key_sample_rate_ = 0;
+
+  mutable absl::Mutex mutex_;
+  // Only held to find, add or remove sub-caches, which are used through
+  // their own references so that dropping a prefix does not wait for them.
+  absl::flat_hash_map<std::string, std::shared_ptr<KeyValueCache>> sub_caches_
+      ABSL_GUARDED_BY(mutex_);
+  // Runs the background cleanup once started. Declared after `sub_caches_` so
+  // that it stops before they are destroyed.
+  std::unique_ptr<PeriodicClosure> cleanup_closure_;
+};
+
+}  // namespace kv_server
+
+#endif  // COMPONENTS_DATA_SERVER_CACHE_PREFIXED_KEY_VALUE_CACHE_H_
@@ -0,0 +1,256 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/data_server/cache/prefixed_key_value_cache.h"
+
+#include <memory>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "absl/container/flat_hash_set.h"
+#include "absl/strings/str_cat.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "components/data_server/cache/cache.h"
+#include "components/data_server/cache/checkpoint_io.h"
+#include "components/data_server/cache/mocks.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace kv_server {
+namespace {
+
+using testing::UnorderedElementsAre;
+
+class PrefixedCacheTest : public ::testing::Test {
+ protected:
+  PrefixedCacheTest() {
+    InitMetricsContextMap();
+    scope_metrics_context_ = std::make_unique<ScopeMetricsContext>();
+    request_context_ =
+        std::make_unique<RequestContext>(*scope_metrics_context_);
+  }
+  RequestContext& GetRequestContext() { return *request_context_; }
+  std::unique_ptr<ScopeMetricsContext> scope_metrics_context_;
+  std::unique_ptr<RequestContext> request_context_;
+};
+
+TEST_F(PrefixedCacheTest, ReturnsValuesOfAllPrefixes) {
+  auto cache = PrefixedKeyValueCache::Create();
+  cache->UpdateKeyValue("key1", "value1", 1, "prefix1");
+  cache->UpdateKeyValue("key2", "value2", 1, "prefix2");
+  EXPECT_THAT(
+      cache->GetKeyValuePairs(GetRequestContext(), {"key1", "key2", "key3"}),
+      UnorderedElementsAre(KVPairEq("key1", "value1"),
+                           KVPairEq("key2", "value2")));
+  auto result = cache->GetKeyValues(GetRequestContext(), {"key1", "key2"});
+  EXPECT_EQ(result->GetValue("key1"), "value1");
+  EXPECT_EQ(result->GetValue("key2"), "value2");
+}
+
+TEST_F(PrefixedCacheTest, ServesKeysFromTheirNewestUpdate) {
+  auto cache = PrefixedKeyValueCache::Create();
+  cache->UpdateKeyValue("key1", "old", 1, "prefix1");
+  cache->UpdateKeyValue("key1", "new", 2, "prefix2");
+  cache->UpdateKeyValue("key2", "new", 2, "prefix1");
+  cache->UpdateKeyValue("key2", "old", 1, "prefix2");
+  EXPECT_THAT(cache->GetKeyValuePairs(GetRequestContext(), {"key1", "key2"}),
+              UnorderedElementsAre(KVPairEq("key1", "new"),
+                                   KVPairEq("key2", "new")));
+}
+
+TEST_F(PrefixedCacheTest, DeletionHidesValuesOfOtherPrefixesAfterCleanup) {
+  auto cache = PrefixedKeyValueCache::Create();
+  cache->UpdateKeyValue("my_key", "my_value", 1, "prefix1");
+  cache->DeleteKey("my_key", 2, "prefix2");
+  EXPECT_TRUE(cache->GetKeyValuePairs(GetRequestContext(), {"my_key"}).empty());
+  cache->RemoveDeletedKeys(3, "prefix2");
+  EXPECT_TRUE(cache->GetKeyValuePairs(GetRequestContext(), {"my_key"}).empty());
+}
+
+TEST_F(PrefixedCacheTest, RemoveDeletedKeysOnlyCleansUpItsPrefix) {
+  auto cache = PrefixedKeyValueCache::Create();
+  cache->UpdateKeyValue("key1", "value", 1, "prefix1");
+  cache->DeleteKey("key1", 2, "prefix1");
+  cache->UpdateKeyValue("key2", "value", 1, "prefix2");
+  cache->DeleteKey("key2", 2, "prefix2");
+  cache->RemoveDeletedKeys(3, "prefix1");
+  const auto stats = cache->GetPrefixStats();
+  EXPECT_EQ(stats.at("prefix1").num_tombstones, 0);
+  EXPECT_EQ(stats.at("prefix2").num_tombstones, 1);
+}
+
+TEST_F(PrefixedCacheTest, ServesValueSetsFromTheirNewestValue) {
+  auto cache = PrefixedKeyValueCache::Create();
+  std::vector<std::string_view> old_values = {"v1", "v2"};
+  std::vector<std::string_view> new_values = {"v3"};
+  cache->UpdateKeyValueSet("key1", absl::MakeSpan(old_values), 1, "prefix1");
+  cache->UpdateKeyValueSet("key1", absl::MakeSpan(new_values), 2, "prefix2");
+  cache->UpdateKeyValueSet("key2", absl::MakeSpan(old_values), 1, "prefix2");
+  auto result = cache->GetKeyValueSet(GetRequestContext(), {"key1", "key2"});
+  EXPECT_THAT(result->GetValueSet("key1"), UnorderedElementsAre("v3"));
+  EXPECT_THAT(result->GetValueSet("key2"), UnorderedElementsAre("v1", "v2"));
+}
+
+TEST_F(PrefixedCacheTest, DeletesValuesInSetsOfOtherPrefixes) {
+  auto cache = PrefixedKeyValueCache::Create();
+  std::vector<std::string_view> values = {"v1", "v2"};
+  std::vector<std::string_view> values_to_delete = {"v1"};
+  cache->UpdateKeyValueSet("my_key", absl::MakeSpan(values), 1, "prefix1");
+  cache->DeleteValuesInSet("my_key", absl::MakeSpan(values_to_delete), 2,
+                           "prefix2");
+  EXPECT_THAT(cache->GetKeyValueSet(GetRequestContext(), {"my_key"})
+                  ->GetValueSet("my_key"),
+              UnorderedElementsAre("v2"));
+}
+
+TEST_F(PrefixedCacheTest, ApplyBatchPropagatesDeletions) {
+  auto cache = PrefixedKeyValueCache::Create();
+  cache->UpdateKeyValue("key1", "value", 1, "prefix1");
+  cache->UpdateKeyValue("key2", "value", 1, "prefix1");
+  std::vector<CacheMutation> mutations = {
+      {CacheMutation::Type::kUpdateKeyValue, "key3", "value", {}, 2},
+      {CacheMutation::Type::kDeleteKey, "key1", "", {}, 2},
+  };
+  cache->ApplyBatch(mutations, "prefix2");
+  cache->RemoveDeletedKeys(3, "prefix2");
+  EXPECT_THAT(
+      cache->GetKeyValuePairs(GetRequestContext(), {"key1", "key2", "key3"}),
+      UnorderedElementsAre(KVPairEq("key2", "value"),
+                           KVPairEq("key3", "value")));
+}
+
+TEST_F(PrefixedCacheTest, DropPrefixRemovesOnlyItsValues) {
+  auto cache = PrefixedKeyValueCache::Create();
+  cache->UpdateKeyValue("key1", "value1", 1, "prefix1");
+  cache->UpdateKeyValue("shared", "old", 1, "prefix1");
+  cache->UpdateKeyValue("key2", "value2", 1, "prefix2");
+  cache->UpdateKeyValue("shared", "new", 2, "prefix2");
+  auto result = cache->GetKeyValues(GetRequestContext(), {"key2"});
+  cache->DropPrefix("prefix2");
+  EXPECT_EQ(result->GetValue("key2"), "value2");
+  EXPECT_THAT(
+      cache->GetKeyValuePairs(GetRequestContext(), {"key1", "key2", "shared"}),
+      UnorderedElementsAre(KVPairEq("key1", "value1"),
+                           KVPairEq("shared", "old")));
+  EXPECT_FALSE(cache->GetPrefixStats().contains("prefix2"));
+}
+
+TEST_F(PrefixedCacheTest, SetResultOutlivesDroppedPrefix) {
+  auto cache = PrefixedKeyValueCache::Create();
+  std::vector<std::string_view> values = {"v1", "v2"};
+  cache->UpdateKeyValueSet("my_key", absl::MakeSpan(values), 1, "prefix1");
+  auto result = cache->GetKeyValueSet(GetRequestContext(), {"my_key"});
+  cache->DropPrefix("prefix1");
+  EXPECT_THAT(result->GetValueSet("my_key"), UnorderedElementsAre("v1", "v2"));
+}
+
+TEST_F(PrefixedCacheTest, BackgroundCleanupCoversPrefixesCreatedLater) {
+  auto cache = PrefixedKeyValueCache::Create();
+  ASSERT_TRUE(cache
+                  ->StartBackgroundCleanup(absl::Milliseconds(1),
+                                           absl::Milliseconds(1))
+                  .ok());
+  for (int i = 0; i < 100; i++) {
+    cache->UpdateKeyValue(absl::StrCat("key", i), "value", 1, "prefix1");
+    cache->DeleteKey(absl::StrCat("key", i), 2, "prefix1");
+  }
+  cache->RemoveDeletedKeys(2, "prefix1");
+  absl::SleepFor(absl::Milliseconds(10));
+  for (int i = 0; i < 100; i++) {
+    // Older than the cleanup time, whether or not the deletion was removed.
+    cache->UpdateKeyValue(absl::StrCat("key", i), "value", 2, "prefix1");
+  }
+  EXPECT_TRUE(
+      cache->GetKeyValuePairs(GetRequestContext(), {"key0", "key99"}).empty());
+}
+
+TEST_F(PrefixedCacheTest, SetValueIndexReturnsKeysOfServedSets) {
+  auto cache = PrefixedKeyValueCache::Create();
+  ASSERT_TRUE(cache->EnableSetValueIndex().ok());
+  std::vector<std::string_view> old_values = {"v1", "v2"};
+  std::vector<std::string_view> new_values = {"v2"};
+  cache->UpdateKeyValueSet("key1", absl::MakeSpan(old_values), 1, "prefix1");
+  cache->UpdateKeyValueSet("key1", absl::MakeSpan(new_values), 2, "prefix2");
+  cache->UpdateKeyValueSet("key2", absl::MakeSpan(old_values), 1, "prefix2");
+  // key1 is served from prefix2, whose set does not hold v1.
+  EXPECT_THAT(*cache->GetKeysContaining(GetRequestContext(), "v1"),
+              UnorderedElementsAre("key2"));
+  EXPECT_THAT(*cache->GetKeysContaining(GetRequestContext(), "v2"),
+              UnorderedElementsAre("key1", "key2"));
+}
+
+TEST_F(PrefixedCacheTest, CheckpointRestoresEveryPrefix) {
+  auto cache = PrefixedKeyValueCache::Create(/*intern_set_values=*/true);
+  std::vector<std::string_view> values = {"v1", "v2"};
+  cache->UpdateKeyValue("key1", "value1", 1, "prefix1");
+  cache->UpdateKeyValueSet("key2", absl::MakeSpan(values), 1, "prefix2");
+  std::ostringstream output;
+  CheckpointWriter writer(output);
+  ASSERT_TRUE(cache->WriteCheckpoint(writer).ok());
+  const std::string checkpoint = output.str();
+
+  auto restored = PrefixedKeyValueCache::Create(/*intern_set_values=*/true);
+  CheckpointReader reader(checkpoint);
+  ASSERT_TRUE(restored->RestoreCheckpoint(reader).ok());
+  EXPECT_THAT(restored->GetKeyValuePairs(GetRequestContext(), {"key1"}),
+              UnorderedElementsAre(KVPairEq("key1", "value1")));
+  EXPECT_THAT(restored->GetKeyValueSet(GetRequestContext(), {"key2"})
+                  ->GetValueSet("key2"),
+              UnorderedElementsAre("v1", "v2"));
+  // Every prefix is restored into a sub-cache of its own.
+  restored->DropPrefix("prefix1");
+  EXPECT_TRUE(
+      restored->GetKeyValuePairs(GetRequestContext(), {"key1"}).empty());
+
+  CheckpointReader truncated_reader(
+      std::string_view(checkpoint).substr(0, checkpoint.size() / 2));
+  auto other = PrefixedKeyValueCache::Create(/*intern_set_values=*/true);
+  EXPECT_FALSE(other->RestoreCheckpoint(truncated_reader).ok());
+  EXPECT_TRUE(other->GetPrefixStats().empty());
+}
+
+TEST_F(PrefixedCacheTest, SortedKeyIndexMergesPrefixesInOrder) {
+  auto cache = PrefixedKeyValueCache::Create();
+  ASSERT_TRUE(cache->EnableSortedKeyIndex().ok());
+  cache->UpdateKeyValue("c1:b", "value", 1, "prefix1");
+  cache->UpdateKeyValue("c1:c", "value", 1, "prefix1");
+  cache->UpdateKeyValue("c1:a", "value", 1, "prefix2");
+  cache->UpdateKeyValue("c1:c", "value", 2, "prefix2");
+  // The deletion also applies to the older value of prefix1.
+  cache->DeleteKey("c1:b", 2, "prefix2");
+  EXPECT_THAT(*cache->GetKeysWithPrefix(GetRequestContext(), "c1:", 10),
+              testing::ElementsAre("c1:a", "c1:c"));
+  EXPECT_THAT(*cache->GetKeysWithPrefix(GetRequestContext(), "c1:", 1),
+              testing::ElementsAre("c1:a"));
+}
+
+TEST_F(PrefixedCacheTest, GetHotKeysOfEveryPrefix) {
+  auto cache = PrefixedKeyValueCache::Create();
+  cache->UpdateKeyValue("key1", "value", 1, "prefix1");
+  ASSERT_TRUE(cache->EnableHotKeyTracking(1).ok());
+  // Sub-caches created later track lookups too.
+  cache->UpdateKeyValue("key2", "value", 1, "prefix2");
+  cache->GetKeyValuePairs(GetRequestContext(), {"key1", "key2"});
+  HotKeys hot_keys = cache->GetHotKeys(10);
+  ASSERT_THAT(hot_keys, testing::SizeIs(2));
+  EXPECT_EQ(hot_keys["prefix1"].at(0).key, "key1");
+  EXPECT_EQ(hot_keys["prefix2"].at(0).key, "key2");
+}
+
+}  // namespace
+}  // namespace kv_server
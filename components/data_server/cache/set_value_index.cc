@@ -0,0 +1,58 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/data_server/cache/set_value_index.h"
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace kv_server {
+
+void SetValueIndex::Add(std::string_view key,
+                        absl::Span<const std::string_view> values) {
+  absl::MutexLock lock(&mutex_);
+  for (const std::string_view value : values) {
+    keys_by_value_[value].emplace(key);
+  }
+}
+
+void SetValueIndex::Remove(std::string_view key,
+                           absl::Span<const std::string_view> values) {
+  absl::MutexLock lock(&mutex_);
+  for (const std::string_view value : values) {
+    const auto value_iter = keys_by_value_.find(value);
+    if (value_iter == keys_by_value_.end()) {
+      continue;
+    }
+    value_iter->second.erase(key);
+    // Values that no set holds anymore are dropped with their last key.
+    if (value_iter->second.empty()) {
+      keys_by_value_.erase(value_iter);
+    }
+  }
+}
+
+std::vector<std::string> SetValueIndex::KeysContaining(
+    std::string_view value) const {
+  absl::ReaderMutexLock lock(&mutex_);
+  const auto value_iter = keys_by_value_.find(value);
+  if (value_iter == keys_by_value_.end()) {
+    return {};
+  }
+  return std::vector<std::string>(value_iter->second.begin(),
+                                  value_iter->second.end());
+}
+
+}  // namespace kv_server
@@ -0,0 +1,63 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef COMPONENTS_DATA_SERVER_CACHE_SET_VALUE_INDEX_H_
+#define COMPONENTS_DATA_SERVER_CACHE_SET_VALUE_INDEX_H_
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/span.h"
+
+namespace kv_server {
+
+// Inverted index of key-value sets, from every value to the keys whose sets
+// hold it, so that the keys holding a value are found in time proportional to
+// their number rather than to the sizes of all sets.
+//
+// Thread safe.
+class SetValueIndex {
+ public:
+  SetValueIndex() = default;
+  SetValueIndex(const SetValueIndex&) = delete;
+  SetValueIndex& operator=(const SetValueIndex&) = delete;
+
+  // Records that the set of `key` holds `values`.
+  void Add(std::string_view key, absl::Span<const std::string_view> values)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Records that the set of `key` no longer holds `values`.
+  void Remove(std::string_view key, absl::Span<const std::string_view> values)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Returns the keys whose sets hold `value`, in no particular order.
+  std::vector<std::string> KeysContaining(std::string_view value) const
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+ private:
+  mutable absl::Mutex mutex_;
+  absl::flat_hash_map<std::string, absl::flat_hash_set<std::string>>
+      keys_by_value_ ABSL_GUARDED_BY(mutex_);
+};
+
+}  // namespace kv_server
+
+#endif  // COMPONENTS_DATA_SERVER_CACHE_SET_VALUE_INDEX_H_
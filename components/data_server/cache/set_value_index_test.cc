@@ -0,0 +1,56 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/data_server/cache/set_value_index.h"
+
+#include <string_view>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace kv_server {
+namespace {
+
+using testing::IsEmpty;
+using testing::UnorderedElementsAre;
+
+TEST(SetValueIndexTest, ReturnsKeysOfSetsHoldingValue) {
+  SetValueIndex index;
+  const std::vector<std::string_view> values = {"v1", "v2"};
+  const std::vector<std::string_view> other_values = {"v2", "v3"};
+  index.Add("key1", values);
+  index.Add("key2", other_values);
+  EXPECT_THAT(index.KeysContaining("v1"), UnorderedElementsAre("key1"));
+  EXPECT_THAT(index.KeysContaining("v2"),
+              UnorderedElementsAre("key1", "key2"));
+  EXPECT_THAT(index.KeysContaining("missing"), IsEmpty());
+}
+
+TEST(SetValueIndexTest, RemovesKeysFromValues) {
+  SetValueIndex index;
+  const std::vector<std::string_view> values = {"v1", "v2"};
+  const std::vector<std::string_view> removed_values = {"v1", "missing"};
+  index.Add("key1", values);
+  index.Add("key2", values);
+  index.Remove("key1", removed_values);
+  EXPECT_THAT(index.KeysContaining("v1"), UnorderedElementsAre("key2"));
+  EXPECT_THAT(index.KeysContaining("v2"),
+              UnorderedElementsAre("key1", "key2"));
+  index.Remove("key2", removed_values);
+  EXPECT_THAT(index.KeysContaining("v1"), IsEmpty());
+}
+
+}  // namespace
+}  // namespace kv_server
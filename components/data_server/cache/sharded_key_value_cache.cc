@@ -0,0 +1,490 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include "components/data_server/cache/sharded_key_value_cache.h"
+
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "absl/log/log.h"
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/time/time.h"
+#include "components/data_server/cache/cache.h"
+#include "components/data_server/cache/checkpoint_io.h"
+#include "components/data_server/cache/cold_value_log.h"
+#include "components/data_server/cache/get_key_value_result.h"
+#include "components/data_server/cache/get_key_value_set_result.h"
+#include "components/data_server/cache/key_value_cache.h"
+#include "components/data_server/cache/sorted_key_index.h"
+
+namespace kv_server {
+namespace {
+
+// Identifies the checkpoints written by `ShardedKeyValueCache`.
+constexpr char kCheckpointType[] = "ShardedKeyValueCache";
+
+}  // namespace
+
+ShardedKeyValueCache::ShardedKeyValueCache(
+    int num_segments, std::shared_ptr<ValueInterner> value_interner,
+    bool precompute_json_values,
+    std::shared_ptr<ValueCompressor> value_compressor,
+    std::shared_ptr<ValueInterner> value_store,
+    std::shared_ptr<ColdValueLog> cold_value_log) {
+  segments_.reserve(num_segments);
+  for (int i = 0; i < num_segments; i++) {
+    segments_.push_back(std::make_unique<KeyValueCache>(
+        value_interner, precompute_json_values, value_compressor, value_store,
+        cold_value_log));
+  }
+}
+
+absl::flat_hash_map<std::string, std::string>
+ShardedKeyValueCache::GetKeyValuePairs(
+    const RequestContext& request_context,
+    const absl::flat_hash_set<std::string_view>& key_set) const {
+  ScopeLatencyMetricsRecorder<InternalLookupMetricsContext,
+                              kGetValuePairsLatencyInMicros>
+      latency_recorder(request_context.GetInternalLookupMetricsContext());
+  absl::flat_hash_map<std::string, std::string> kv_pairs;
+  kv_pairs.reserve(key_set.size());
+  const auto partitioned_keys = PartitionKeys(key_set);
+  for (size_t i = 0; i < segments_.size(); i++) {
+    if (!partitioned_keys[i].empty()) {
+      segments_[i]->CollectKeyValuePairs(partitioned_keys[i], kv_pairs);
+    }
+  }
+  if (kv_pairs.empty()) {
+    LogCacheAccessMetrics(request_context, kKeyValueCacheMiss);
+  } else {
+    LogCacheAccessMetrics(request_context, kKeyValueCacheHit);
+  }
+  return kv_pairs;
+}
+
+std::unique_ptr<GetKeyValueResult> ShardedKeyValueCache::GetKeyValues(
+    const RequestContext& request_context,
+    const absl::flat_hash_set<std::string_view>& key_set) const {
+  ScopeLatencyMetricsRecorder<InternalLookupMetricsContext,
+                              kGetValuePairsLatencyInMicros>
+      latency_recorder(request_context.GetInternalLookupMetricsContext());
+  auto result = GetKeyValueResult::Create();
+  const auto partitioned_keys = PartitionKeys(key_set);
+  for (size_t i = 0; i < segments_.size(); i++) {
+    if (!partitioned_keys[i].empty()) {
+      segments_[i]->CollectKeyValues(partitioned_keys[i], *result);
+    }
+  }
+  if (result->size() == 0) {
+    LogCacheAccessMetrics(request_context, kKeyValueCacheMiss);
+  } else {
+    LogCacheAccessMetrics(request_context, kKeyValueCacheHit);
+  }
+  return result;
+}
+
+std::unique_ptr<GetKeyValueSetResult> ShardedKeyValueCache::GetKeyValueSet(
+    const RequestContext& request_context,
+    const absl::flat_hash_set<std::string_view>& key_set) const {
+  ScopeLatencyMetricsRecorder<InternalLookupMetricsContext,
+                              kGetKeyValueSetLatencyInMicros>
+      latency_recorder(request_context.GetInternalLookupMetricsContext());
+  auto result = GetKeyValueSetResult::Create();
+  bool cache_hit = false;
+  const auto partitioned_keys = PartitionKeys(key_set);
+  for (size_t i = 0; i < segments_.size(); i++) {
+    if (!partitioned_keys[i].empty()) {
+      // Segment locks are taken one at a time, so a reader never holds more
+      // than one segment's map lock at once.
+      cache_hit |=
+          segments_[i]->CollectKeyValueSets(partitioned_keys[i], *result);
+    }
+  }
+  if (cache_hit) {
+    LogCacheAccessMetrics(request_context, kKeyValueSetCacheHit);
+  } else {
+    LogCacheAccessMetrics(request_context, kKeyValueSetCacheMiss);
+  }
+  return result;
+}
+
+std::unique_ptr<GetUInt32ValueSetResult>
+ShardedKeyValueCache::GetUInt32ValueSet(
+    const RequestContext& request_context,
+    const absl::flat_hash_set<std::string_view>& key_set) const {
+  ScopeLatencyMetricsRecorder<InternalLookupMetricsContext,
+                              kGetKeyValueSetLatencyInMicros>
+      latency_recorder(request_context.GetInternalLookupMetricsContext());
+  auto result = GetUInt32ValueSetResult::Create();
+  bool cache_hit = false;
+  const auto partitioned_keys = PartitionKeys(key_set);
+  for (size_t i = 0; i < segments_.size(); i++) {
+    if (!partitioned_keys[i].empty()) {
+      cache_hit |=
+          segments_[i]->CollectUInt32ValueSets(partitioned_keys[i], *result);
+    }
+  }
+  if (cache_hit) {
+    LogCacheAccessMetrics(request_context, kKeyValueSetCacheHit);
+  } else {
+    LogCacheAccessMetrics(request_context, kKeyValueSetCacheMiss);
+  }
+  return result;
+}
+
+void ShardedKeyValueCache::UpdateKeyValue(std::string_view key,
+                                          std::string_view value,
+                                          int64_t logical_commit_time,
+                                          std::string_view prefix) {
+  GetSegment(key).UpdateKeyValue(key, value, logical_commit_time, prefix);
+}
+
+void ShardedKeyValueCache::UpdateKeyValueSet(
+    std::string_view key, absl::Span<std::string_view> input_value_set,
+    int64_t logical_commit_time, std::string_view prefix) {
+  GetSegment(key).UpdateKeyValueSet(key, input_value_set, logical_commit_time,
+                                    prefix);
+}
+
+void ShardedKeyValueCache::UpdateKeyValueUInt32Set(
+    std::string_view key, absl::Span<const uint32_t> value_set,
+    int64_t logical_commit_time, std::string_view prefix) {
+  GetSegment(key).UpdateKeyValueUInt32Set(key, value_set, logical_commit_time,
+                                          prefix);
+}
+
+void ShardedKeyValueCache::DeleteKey(std::string_view key,
+                                     int64_t logical_commit_time,
+                                     std::string_view prefix) {
+  GetSegment(key).DeleteKey(key, logical_commit_time, prefix);
+}
+
+void ShardedKeyValueCache::DeleteValuesInSet(
+    std::string_view key, absl::Span<std::string_view> value_set,
+    int64_t logical_commit_time, std::string_view prefix) {
+  GetSegment(key).DeleteValuesInSet(key, value_set, logical_commit_time,
+                                    prefix);
+}
+
+void ShardedKeyValueCache::DeleteValuesInUInt32Set(
+    std::string_view key, absl::Span<const uint32_t> value_set,
+    int64_t logical_commit_time, std::string_view prefix) {
+  GetSegment(key).DeleteValuesInUInt32Set(key, value_set, logical_commit_time,
+                                          prefix);
+}
+
+void ShardedKeyValueCache::ApplyBatch(
+    absl::Span<const CacheMutation> mutations, std::string_view prefix) {
+  if (segments_.size() == 1) {
+    segments_[0]->ApplyBatch(mutations, prefix);
+    return;
+  }
+  std::vector<std::vector<CacheMutation>> segment_mutations(segments_.size());
+  for (const CacheMutation& mutation : mutations) {
+    segment_mutations[GetSegmentIndex(mutation.key)].push_back(mutation);
+  }
+  for (size_t i = 0; i < segments_.size(); ++i) {
+    if (!segment_mutations[i].empty()) {
+      segments_[i]->ApplyBatch(segment_mutations[i], prefix);
+    }
+  }
+}
+
+void ShardedKeyValueCache::RemoveDeletedKeys(int64_t logical_commit_time,
+                                             std::string_view prefix) {
+  ScopeLatencyMetricsRecorder<ServerSafeMetricsContext,
+                              kRemoveDeletedKeyLatency>
+      latency_recorder(KVServerContextMap()->SafeMetric());
+  // Segments are cleaned up one after another so that only one segment is
+  // write locked at any point in time and reads on other segments proceed.
+  for (auto& segment : segments_) {
+    if (segment->StageBulkLoadCleanup(logical_commit_time, prefix)) {
+      continue;
+    }
+    if (cleanup_closure_ != nullptr) {
+      segment->SetCleanupTime(logical_commit_time, prefix);
+      continue;
+    }
+    segment->CleanUpKeyValueMap(logical_commit_time, prefix);
+    segment->CleanUpKeyValueSetMap(logical_commit_time, prefix);
+  }
+}
+
+absl::Status ShardedKeyValueCache::StartBackgroundCleanup(
+    absl::Duration interval, absl::Duration max_pause) {
+  if (cleanup_closure_ != nullptr) {
+    return absl::FailedPreconditionError("Background cleanup already started");
+  }
+  cleanup_closure_ = PeriodicClosure::Create();
+  return cleanup_closure_->StartDelayed(interval, [this, max_pause]() {
+    int64_t num_left = 0;
+    for (auto& segment : segments_) {
+      num_left += segment->RemoveDeletedKeysInSlices(max_pause);
+    }
+    LogIfError(
+        KVServerContextMap()->SafeMetric().LogHistogram<kCacheTombstoneCount>(
+            static_cast<double>(num_left)));
+    for (auto& segment : segments_) {
+      if (segment->cold_value_log_ != nullptr) {
+        segment->RebalanceValueTiers(max_pause);
+      }
+    }
+  });
+}
+
+void ShardedKeyValueCache::Reserve(int64_t num_keys, int64_t num_set_keys) {
+  const int64_t num_segments = segments_.size();
+  for (auto& segment : segments_) {
+    segment->Reserve((num_keys + num_segments - 1) / num_segments,
+                     (num_set_keys + num_segments - 1) / num_segments);
+  }
+}
+
+absl::Status ShardedKeyValueCache::ForEachKey(
+    absl::FunctionRef<void(std::string_view key)> callback) const {
+  for (const auto& segment : segments_) {
+    if (absl::Status status = segment->ForEachKey(callback); !status.ok()) {
+      return status;
+    }
+  }
+  return absl::OkStatus();
+}
+
+absl::flat_hash_map<std::string, PrefixStats>
+ShardedKeyValueCache::GetPrefixStats() const {
+  absl::flat_hash_map<std::string, PrefixStats> stats;
+  for (const auto& segment : segments_) {
+    for (const auto& [prefix, segment_stats] : segment->GetPrefixStats()) {
+      stats[prefix] += segment_stats;
+    }
+  }
+  return stats;
+}
+
+absl::Status ShardedKeyValueCache::EnableSetValueIndex() {
+  for (auto& segment : segments_) {
+    if (absl::Status status = segment->EnableSetValueIndex(); !status.ok()) {
+      return status;
+    }
+  }
+  return absl::OkStatus();
+}
+
+absl::StatusOr<std::vector<std::string>>
+ShardedKeyValueCache::GetKeysContaining(const RequestContext& request_context,
+                                        std::string_view value) const {
+  std::vector<std::string> keys;
+  for (const auto& segment : segments_) {
+    absl::StatusOr<std::vector<std::string>> segment_keys =
+        segment->GetKeysContaining(request_context, value);
+    if (!segment_keys.ok()) {
+      return segment_keys.status();
+    }
+    keys.insert(keys.end(), std::make_move_iterator(segment_keys->begin()),
+                std::make_move_iterator(segment_keys->end()));
+  }
+  return keys;
+}
+
+absl::Status ShardedKeyValueCache::EnableSortedKeyIndex() {
+  for (auto& segment : segments_) {
+    if (absl::Status status = segment->EnableSortedKeyIndex(); !status.ok()) {
+      return status;
+    }
+  }
+  return absl::OkStatus();
+}
+
+absl::StatusOr<std::vector<std::string>>
+ShardedKeyValueCache::GetKeysWithPrefix(const RequestContext& request_context,
+                                        std::string_view key_prefix,
+                                        int64_t limit) const {
+  std::vector<std::vector<std::string>> segment_keys;
+  segment_keys.reserve(segments_.size());
+  for (const auto& segment : segments_) {
+    absl::StatusOr<std::vector<std::string>> keys =
+        segment->GetKeysWithPrefix(request_context, key_prefix, limit);
+    if (!keys.ok()) {
+      return keys.status();
+    }
+    segment_keys.push_back(*std::move(keys));
+  }
+  return SortedKeyIndex::Merge(absl::MakeSpan(segment_keys), limit);
+}
+
+absl::Status ShardedKeyValueCache::EnableHotKeyTracking(int32_t sample_rate) {
+  for (auto& segment : segments_) {
+    if (absl::Status status = segment->EnableHotKeyTracking(sample_rate);
+        !status.ok()) {
+      return status;
+    }
+  }
+  return absl::OkStatus();
+}
+
+HotKeys ShardedKeyValueCache::GetHotKeys(int64_t num_keys_per_prefix) const {
+  HotKeys hot_keys;
+  for (const auto& segment : segments_) {
+    for (auto& [prefix, keys] : segment->GetHotKeys(num_keys_per_prefix)) {
+      std::vector<HotKey>& prefix_keys = hot_keys[prefix];
+      prefix_keys.insert(prefix_keys.end(),
+                         std::make_move_iterator(keys.begin()),
+                         std::make_move_iterator(keys.end()));
+    }
+  }
+  KeepHottestKeys(num_keys_per_prefix, hot_keys);
+  return hot_keys;
+}
+
+absl::Status ShardedKeyValueCache::WriteCheckpoint(
+    CheckpointWriter& writer) const {
+  writer.WriteString(kCheckpointType);
+  writer.WriteInt64(segments_.size());
+  for (const auto& segment : segments_) {
+    if (absl::Status status = segment->WriteCheckpoint(writer); !status.ok()) {
+      return status;
+    }
+  }
+  return writer.status();
+}
+
+absl::Status ShardedKeyValueCache::RestoreCheckpoint(
+    CheckpointReader& reader) {
+  std::string_view type;
+  int64_t num_segments;
+  if (!reader.ReadString(&type) || type != kCheckpointType ||
+      !reader.ReadInt64(&num_segments)) {
+    return absl::DataLossError("Invalid sharded key value cache checkpoint.");
+  }
+  if (num_segments != static_cast<int64_t>(segments_.size())) {
+    return absl::FailedPreconditionError(
+        absl::StrCat("Checkpoint has ", num_segments,
+                     " segments but the cache has ", segments_.size()));
+  }
+  std::vector<KeyValueCache::CheckpointImage> images;
+  images.reserve(segments_.size());
+  for (const auto& segment : segments_) {
+    absl::StatusOr<KeyValueCache::CheckpointImage> image =
+        segment->ReadCheckpointImage(reader);
+    if (!image.ok()) {
+      return image.status();
+    }
+    images.push_back(*std::move(image));
+  }
+  for (size_t i = 0; i < segments_.size(); i++) {
+    segments_[i]->RestoreCheckpointImage(images[i]);
+  }
+  return absl::OkStatus();
+}
+
+absl::Status ShardedKeyValueCache::StartBulkLoad() {
+  for (size_t i = 0; i < segments_.size(); i++) {
+    if (absl::Status status = segments_[i]->StartBulkLoad(); !status.ok()) {
+      // Nothing was staged into the segments started so far.
+      for (size_t j = 0; j < i; j++) {
+        segments_[j]->FinishBulkLoad().IgnoreError();
+      }
+      return status;
+    }
+  }
+  return absl::OkStatus();
+}
+
+absl::Status ShardedKeyValueCache::FinishBulkLoad() {
+  const int num_threads_per_segment = std::max<int>(
+      1, std::thread::hardware_concurrency() / segments_.size());
+  std::vector<absl::Status> statuses(segments_.size());
+  std::vector<std::thread> threads;
+  threads.reserve(segments_.size());
+  for (size_t i = 0; i < segments_.size(); i++) {
+    threads.emplace_back([this, i, num_threads_per_segment, &statuses]() {
+      statuses[i] =
+          segments_[i]->FinishBulkLoadOnThreads(num_threads_per_segment);
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  for (const absl::Status& status : statuses) {
+    if (!status.ok()) {
+      return status;
+    }
+  }
+  return absl::OkStatus();
+}
+
+KeyValueCache& ShardedKeyValueCache::GetSegment(std::string_view key) const {
+  return *segments_[GetSegmentIndex(key)];
+}
+
+size_t ShardedKeyValueCache::GetSegmentIndex(std::string_view key) const {
+  // std::hash is used on purpose instead of absl::Hash: the segments'
+  // flat_hash_maps use absl::Hash internally, and deriving the segment from the
+  // same hash bits would reduce the entropy of the hashes within a segment.
+  return std::hash<std::string_view>{}(key) % segments_.size();
+}
+
+std::vector<std::vector<HashedKey>> ShardedKeyValueCache::PartitionKeys(
+    const absl::flat_hash_set<std::string_view>& key_set) const {
+  // The keys of `key_set` are distinct, so every segment's keys are kept in
+  // a vector rather than rehashed into a set of their own.
+  std::vector<std::vector<HashedKey>> partitioned_keys(segments_.size());
+  for (std::string_view key : key_set) {
+    partitioned_keys[GetSegmentIndex(key)].emplace_back(key);
+  }
+  return partitioned_keys;
+}
+
+void ShardedKeyValueCache::LogCacheAccessMetrics(
+    const RequestContext& request_context,
+    std::string_view cache_access_event) const {
+  request_context.GetMetricsBatch().cache_access_events.Add(
+      cache_access_event);
+}
+
+std::unique_ptr<Cache> ShardedKeyValueCache::Create(
+    int num_segments, bool intern_set_values, bool precompute_json_values,
+    bool compress_values, bool deduplicate_values,
+    std::optional<ColdValueLog::Options> cold_value_log_options) {
+  num_segments = std::max(num_segments, 1);
+  std::shared_ptr<ColdValueLog> cold_value_log;
+  if (cold_value_log_options.has_value()) {
+    cold_value_log_options->max_hot_value_bytes /= num_segments;
+    absl::StatusOr<std::unique_ptr<ColdValueLog>> log =
+        ColdValueLog::Create(*std::move(cold_value_log_options));
+    if (log.ok()) {
+      cold_value_log = *std::move(log);
+    } else {
+      LOG(ERROR) << "Keeping all values in memory: " << log.status();
+    }
+  }
+  return absl::WrapUnique(new ShardedKeyValueCache(
+      num_segments,
+      intern_set_values ? std::make_shared<ValueInterner>() : nullptr,
+      precompute_json_values,
+      compress_values ? std::make_shared<ValueCompressor>() : nullptr,
+      deduplicate_values ? std::make_shared<ValueInterner>() : nullptr,
+      std::move(cold_value_log)));
+}
+
+}  // namespace kv_server
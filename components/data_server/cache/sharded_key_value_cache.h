@@ -0,0 +1,224 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef COMPONENTS_DATA_SERVER_CACHE_SHARDED_KEY_VALUE_CACHE_H_
+#define COMPONENTS_DATA_SERVER_CACHE_SHARDED_KEY_VALUE_CACHE_H_
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/time/time.h"
+#include "components/data_server/cache/cache.h"
+#include "components/data_server/cache/checkpoint_io.h"
+#include "components/data_server/cache/cold_value_log.h"
+#include "components/data_server/cache/get_key_value_result.h"
+#include "components/data_server/cache/get_key_value_set_result.h"
+#include "components/data_server/cache/get_uint32_value_set_result.h"
+#include "components/data_server/cache/hashed_key.h"
+#include "components/data_server/cache/key_value_cache.h"
+#include "components/data_server/cache/value_compressor.h"
+#include "components/data_server/cache/value_interner.h"
+#include "components/util/periodic_closure.h"
+
+namespace kv_server {
+
+// In-memory datastore that hash-partitions keys into a fixed number of
+// independent `KeyValueCache` segments. Each segment has its own locks and its
+// own bookkeeping for deleted nodes, so reads and writes for keys in different
+// segments never contend with each other.
+// One cache object is only for keys in one namespace.
+class ShardedKeyValueCache : public Cache {
+ public:
+  // Looks up and returns key-value pairs for the given keys.
+  absl::flat_hash_map<std::string, std::string> GetKeyValuePairs(
+      const RequestContext& request_context,
+      const absl::flat_hash_set<std::string_view>& key_set) const override;
+
+  // Looks up the given keys and returns views of their values.
+  std::unique_ptr<GetKeyValueResult> GetKeyValues(
+      const RequestContext& request_context,
+      const absl::flat_hash_set<std::string_view>& key_set) const override;
+
+  // Looks up and returns key-value set result for the given key set.
+  std::unique_ptr<GetKeyValueSetResult> GetKeyValueSet(
+      const RequestContext& request_context,
+      const absl::flat_hash_set<std::string_view>& key_set) const override;
+
+  // Looks up and returns the sets of 32-bit unsigned integers of the given
+  // keys.
+  std::unique_ptr<GetUInt32ValueSetResult> GetUInt32ValueSet(
+      const RequestContext& request_context,
+      const absl::flat_hash_set<std::string_view>& key_set) const override;
+
+  // Inserts or updates the key with the new value for a given prefix
+  void UpdateKeyValue(std::string_view key, std::string_view value,
+                      int64_t logical_commit_time,
+                      std::string_view prefix = "") override;
+
+  // Inserts or updates values in the set for a given key and prefix, if a value
+  // exists, updates its timestamp to the latest logical commit time.
+  void UpdateKeyValueSet(std::string_view key,
+                         absl::Span<std::string_view> input_value_set,
+                         int64_t logical_commit_time,
+                         std::string_view prefix = "") override;
+
+  // Inserts or updates values in the set of 32-bit unsigned integers of the
+  // key in its segment.
+  void UpdateKeyValueUInt32Set(std::string_view key,
+                               absl::Span<const uint32_t> value_set,
+                               int64_t logical_commit_time,
+                               std::string_view prefix = "") override;
+
+  // Deletes a particular (key, value) pair for a given prefix.
+  void DeleteKey(std::string_view key, int64_t logical_commit_time,
+                 std::string_view prefix = "") override;
+
+  // Deletes values in the set for a given key and prefix. The deletion, this
+  // object still exist and is marked "deleted", in case there are late-arriving
+  // updates to this value.
+  void DeleteValuesInSet(std::string_view key,
+                         absl::Span<std::string_view> value_set,
+                         int64_t logical_commit_time,
+                         std::string_view prefix = "") override;
+
+  // Deletes values in the set of 32-bit unsigned integers of the key in its
+  // segment.
+  void DeleteValuesInUInt32Set(std::string_view key,
+                               absl::Span<const uint32_t> value_set,
+                               int64_t logical_commit_time,
+                               std::string_view prefix = "") override;
+
+  // Groups `mutations` by segment and applies each group as one batch of its
+  // segment.
+  void ApplyBatch(absl::Span<const CacheMutation> mutations,
+                  std::string_view prefix = "") override;
+
+  // Removes the values that were deleted before the specified
+  // logical_commit_time for a given prefix from every segment, or only
+  // records the time once `StartBackgroundCleanup` was called.
+  void RemoveDeletedKeys(int64_t logical_commit_time,
+                         std::string_view prefix = "") override;
+
+  // Spreads the reservation evenly over the segments.
+  void Reserve(int64_t num_keys, int64_t num_set_keys) override;
+
+  // Cleans up the segments one after another from a single background
+  // thread, see `KeyValueCache::StartBackgroundCleanup`.
+  absl::Status StartBackgroundCleanup(absl::Duration interval,
+                                      absl::Duration max_pause) override;
+
+  // Writes the number of segments followed by the checkpoint of every
+  // segment, one segment at a time.
+  absl::Status WriteCheckpoint(CheckpointWriter& writer) const override;
+
+  // Fails unless the checkpoint has as many segments as this cache, so that
+  // every key stays in its segment. Reads the checkpoints of all segments
+  // before restoring any of them.
+  absl::Status RestoreCheckpoint(CheckpointReader& reader) override;
+
+  // Starts the bulk load of every segment, which must all be empty.
+  absl::Status StartBulkLoad() override;
+
+  // Builds the segments in parallel, each merging its partitions on its share
+  // of the threads.
+  absl::Status FinishBulkLoad() override;
+
+  // Visits the keys of one segment at a time.
+  absl::Status ForEachKey(
+      absl::FunctionRef<void(std::string_view key)> callback) const override;
+
+  // Sums the counters of all segments.
+  absl::flat_hash_map<std::string, PrefixStats> GetPrefixStats()
+      const override;
+
+  // Enables the set value index of every segment.
+  absl::Status EnableSetValueIndex() override;
+
+  // Merges the keys of all segments, which own distinct keys.
+  absl::StatusOr<std::vector<std::string>> GetKeysContaining(
+      const RequestContext& request_context,
+      std::string_view value) const override;
+
+  // Enables the sorted key index of every segment.
+  absl::Status EnableSortedKeyIndex() override;
+
+  // Merges the first `limit` keys of every segment in order.
+  absl::StatusOr<std::vector<std::string>> GetKeysWithPrefix(
+      const RequestContext& request_context, std::string_view key_prefix,
+      int64_t limit) const override;
+
+  // Tracks the hot keys of every segment.
+  absl::Status EnableHotKeyTracking(int32_t sample_rate) override;
+
+  // Merges the hottest keys of all segments, which own distinct keys.
+  HotKeys GetHotKeys(int64_t num_keys_per_prefix) const override;
+
+  // Creates a cache with `num_segments` segments. `num_segments` values
+  // smaller than 1 are treated as 1. If `intern_set_values` is true, all
+  // segments intern set values with the same interner. If
+  // `precompute_json_values` is true, values are parsed as JSON once when they
+  // are loaded, see `KeyValueCache`. If `compress_values` is true, all
+  // segments store values compressed with the same dictionaries. If
+  // `deduplicate_values` is true, identical values are stored once across all
+  // segments. If `cold_value_log_options` is set, all segments spill cold
+  // values into the same log, and share its `max_hot_value_bytes` evenly.
+  static std::unique_ptr<Cache> Create(
+      int num_segments, bool intern_set_values = false,
+      bool precompute_json_values = false, bool compress_values = false,
+      bool deduplicate_values = false,
+      std::optional<ColdValueLog::Options> cold_value_log_options =
+          std::nullopt);
+
+ private:
+  ShardedKeyValueCache(int num_segments,
+                       std::shared_ptr<ValueInterner> value_interner,
+                       bool precompute_json_values,
+                       std::shared_ptr<ValueCompressor> value_compressor,
+                       std::shared_ptr<ValueInterner> value_store,
+                       std::shared_ptr<ColdValueLog> cold_value_log);
+
+  // Returns the segment that owns `key`.
+  KeyValueCache& GetSegment(std::string_view key) const;
+  size_t GetSegmentIndex(std::string_view key) const;
+
+  // Splits `key_set` into the hashed keys of every segment. Entries for
+  // segments that own none of the keys are left empty.
+  std::vector<std::vector<HashedKey>> PartitionKeys(
+      const absl::flat_hash_set<std::string_view>& key_set) const;
+
+  // Logs cache access metrics for cache hit or miss counts. The cache access
+  // event name is defined in server_definition.h file
+  void LogCacheAccessMetrics(const RequestContext& request_context,
+                             std::string_view cache_access_event) const;
+
+  std::vector<std::unique_ptr<KeyValueCache>> segments_;
+  // Runs the background cleanup once started. Declared after `segments_` so
+  // that it stops before they are destroyed.
+  std::unique_ptr<PeriodicClosure> cleanup_closure_;
+
+  friend class ShardedKeyValueCacheTestPeer;
+};
+
+}  // namespace kv_server
+
+#endif  // COMPONENTS_DATA_SERVER_CACHE_SHARDED_KEY_VALUE_CACHE_H_
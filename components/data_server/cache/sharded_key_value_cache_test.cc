@@ -0,0 +1,430 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/data_server/cache/sharded_key_value_cache.h"
+
+#include <algorithm>
+#include <memory>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/strings/str_cat.h"
+#include "absl/synchronization/notification.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "components/data_server/cache/cache.h"
+#include "components/data_server/cache/checkpoint_io.h"
+#include "components/data_server/cache/mocks.h"
+#include "gmock/gmock.h"
+#include "google/protobuf/struct.pb.h"
+#include "gtest/gtest.h"
+
+namespace kv_server {
+
+class ShardedKeyValueCacheTestPeer {
+ public:
+  ShardedKeyValueCacheTestPeer() = delete;
+  static int NumSegments(const Cache& c) {
+    return static_cast<const ShardedKeyValueCache&>(c).segments_.size();
+  }
+  static size_t GetSegmentIndex(const Cache& c, std::string_view key) {
+    return static_cast<const ShardedKeyValueCache&>(c).GetSegmentIndex(key);
+  }
+};
+
+namespace {
+
+using testing::UnorderedElementsAre;
+
+constexpr int kNumSegments = 8;
+
+class ShardedCacheTest : public ::testing::Test {
+ protected:
+  ShardedCacheTest() {
+    InitMetricsContextMap();
+    scope_metrics_context_ = std::make_unique<ScopeMetricsContext>();
+    request_context_ =
+        std::make_unique<RequestContext>(*scope_metrics_context_);
+  }
+  RequestContext& GetRequestContext() { return *request_context_; }
+  std::unique_ptr<ScopeMetricsContext> scope_metrics_context_;
+  std::unique_ptr<RequestContext> request_context_;
+};
+
+TEST_F(ShardedCacheTest, CreateClampsNumberOfSegments) {
+  EXPECT_EQ(ShardedKeyValueCacheTestPeer::NumSegments(
+                *ShardedKeyValueCache::Create(0)),
+            1);
+  EXPECT_EQ(ShardedKeyValueCacheTestPeer::NumSegments(
+                *ShardedKeyValueCache::Create(kNumSegments)),
+            kNumSegments);
+}
+
+TEST_F(ShardedCacheTest, RetrievesMatchingEntry) {
+  std::unique_ptr<Cache> cache = ShardedKeyValueCache::Create(kNumSegments);
+  cache->UpdateKeyValue("my_key", "my_value", 1);
+  absl::flat_hash_set<std::string_view> keys = {"my_key"};
+  absl::flat_hash_set<std::string_view> wrong_keys = {"wrong_key"};
+  EXPECT_THAT(cache->GetKeyValuePairs(GetRequestContext(), keys),
+              UnorderedElementsAre(KVPairEq("my_key", "my_value")));
+  EXPECT_TRUE(cache->GetKeyValuePairs(GetRequestContext(), wrong_keys).empty());
+}
+
+TEST_F(ShardedCacheTest, GetWithKeysInDifferentSegmentsReturnsAllValues) {
+  std::unique_ptr<Cache> cache = ShardedKeyValueCache::Create(kNumSegments);
+  std::vector<std::string> keys;
+  absl::flat_hash_set<size_t> segments;
+  for (int i = 0; segments.size() < 2; i++) {
+    keys.push_back(absl::StrCat("key", i));
+    segments.insert(
+        ShardedKeyValueCacheTestPeer::GetSegmentIndex(*cache, keys.back()));
+  }
+  absl::flat_hash_set<std::string_view> key_set;
+  for (const auto& key : keys) {
+    cache->UpdateKeyValue(key, absl::StrCat("value_", key), 1);
+    key_set.insert(key);
+  }
+  auto kv_pairs = cache->GetKeyValuePairs(GetRequestContext(), key_set);
+  ASSERT_EQ(kv_pairs.size(), keys.size());
+  for (const auto& key : keys) {
+    EXPECT_EQ(kv_pairs[key], absl::StrCat("value_", key));
+  }
+}
+
+TEST_F(ShardedCacheTest, GetKeyValuesReturnsViewsOfMatchingEntries) {
+  std::unique_ptr<Cache> cache = ShardedKeyValueCache::Create(kNumSegments);
+  cache->UpdateKeyValue("key1", "value1", 1);
+  cache->UpdateKeyValue("key2", "value2", 1);
+  auto result =
+      cache->GetKeyValues(GetRequestContext(), {"key1", "key2", "missing"});
+  EXPECT_EQ(result->size(), 2);
+  EXPECT_EQ(result->GetValue("key1"), "value1");
+  EXPECT_EQ(result->GetValue("key2"), "value2");
+  EXPECT_EQ(result->GetValue("missing"), std::nullopt);
+}
+
+TEST_F(ShardedCacheTest, GetKeyValuesReturnsPrecomputedJsonValues) {
+  std::unique_ptr<Cache> cache = ShardedKeyValueCache::Create(
+      /*num_segments=*/4, /*intern_set_values=*/false,
+      /*precompute_json_values=*/true);
+  cache->UpdateKeyValue("json", R"({"a":1})", 1);
+  cache->UpdateKeyValue("string", "value", 1);
+  auto result = cache->GetKeyValues(GetRequestContext(),
+                                    {"json", "string", "missing"});
+  EXPECT_EQ(result->GetValue("json"), R"({"a":1})");
+  EXPECT_EQ(result->GetValue("string"), "value");
+  google::protobuf::Value value;
+  ASSERT_TRUE(value.ParseFromString(
+      std::string(*result->GetSerializedJsonValue("json"))));
+  EXPECT_EQ(value.struct_value().fields().at("a").number_value(), 1);
+  EXPECT_EQ(result->GetSerializedJsonValue("string"), "");
+  EXPECT_EQ(result->GetSerializedJsonValue("missing"), std::nullopt);
+}
+
+TEST_F(ShardedCacheTest, GetKeyValuesResultOutlivesUpdateAndCleanup) {
+  std::unique_ptr<Cache> cache = ShardedKeyValueCache::Create(kNumSegments);
+  cache->UpdateKeyValue("my_key", "my_value", 1);
+  auto result = cache->GetKeyValues(GetRequestContext(), {"my_key"});
+  cache->UpdateKeyValue("my_key", "my_new_value", 2);
+  cache->DeleteKey("my_key", 3);
+  cache->RemoveDeletedKeys(4);
+  EXPECT_EQ(result->GetValue("my_key"), "my_value");
+  EXPECT_EQ(cache->GetKeyValues(GetRequestContext(), {"my_key"})->size(), 0);
+}
+
+TEST_F(ShardedCacheTest, GetAfterUpdateReturnsNewValue) {
+  std::unique_ptr<Cache> cache = ShardedKeyValueCache::Create(kNumSegments);
+  cache->UpdateKeyValue("my_key", "my_value", 1);
+  cache->UpdateKeyValue("my_key", "my_new_value", 2);
+  cache->UpdateKeyValue("my_key", "my_old_value", 1);
+  EXPECT_THAT(cache->GetKeyValuePairs(GetRequestContext(), {"my_key"}),
+              UnorderedElementsAre(KVPairEq("my_key", "my_new_value")));
+}
+
+TEST_F(ShardedCacheTest, DeleteKeyRemovesKeyEntry) {
+  std::unique_ptr<Cache> cache = ShardedKeyValueCache::Create(kNumSegments);
+  cache->UpdateKeyValue("my_key", "my_value", 1);
+  cache->DeleteKey("my_key", 2);
+  EXPECT_TRUE(cache->GetKeyValuePairs(GetRequestContext(), {"my_key"}).empty());
+}
+
+TEST_F(ShardedCacheTest, RemoveDeletedKeysBlocksOlderUpdatesInAllSegments) {
+  std::unique_ptr<Cache> cache = ShardedKeyValueCache::Create(kNumSegments);
+  std::vector<std::string> keys;
+  for (int i = 0; i < 4 * kNumSegments; i++) {
+    keys.push_back(absl::StrCat("key", i));
+    cache->UpdateKeyValue(keys.back(), "value", 1);
+    cache->DeleteKey(keys.back(), 2);
+  }
+  cache->RemoveDeletedKeys(3);
+  absl::flat_hash_set<std::string_view> key_set;
+  for (const auto& key : keys) {
+    // Older than the cleanup cutoff, so must be dropped in every segment.
+    cache->UpdateKeyValue(key, "stale_value", 3);
+    key_set.insert(key);
+  }
+  EXPECT_TRUE(cache->GetKeyValuePairs(GetRequestContext(), key_set).empty());
+}
+
+TEST_F(ShardedCacheTest, GetForCacheReturnsValueSets) {
+  std::unique_ptr<Cache> cache = ShardedKeyValueCache::Create(kNumSegments);
+  std::vector<std::string_view> values1 = {"v1", "v2"};
+  std::vector<std::string_view> values2 = {"v3"};
+  cache->UpdateKeyValueSet("key1", absl::MakeSpan(values1), 1);
+  cache->UpdateKeyValueSet("key2", absl::MakeSpan(values2), 1);
+  auto result =
+      cache->GetKeyValueSet(GetRequestContext(), {"key1", "key2", "missing"});
+  EXPECT_THAT(result->GetValueSet("key1"), UnorderedElementsAre("v1", "v2"));
+  EXPECT_THAT(result->GetValueSet("key2"), UnorderedElementsAre("v3"));
+  EXPECT_TRUE(result->GetValueSet("missing").empty());
+}
+
+TEST_F(ShardedCacheTest, InternedValueSetsShareIdsAcrossSegments) {
+  std::unique_ptr<Cache> cache = ShardedKeyValueCache::Create(
+      kNumSegments, /*intern_set_values=*/true);
+  std::vector<std::string> keys;
+  absl::flat_hash_set<size_t> segments;
+  for (int i = 0; segments.size() < 2; i++) {
+    keys.push_back(absl::StrCat("key", i));
+    segments.insert(
+        ShardedKeyValueCacheTestPeer::GetSegmentIndex(*cache, keys.back()));
+  }
+  absl::flat_hash_set<std::string_view> key_set;
+  for (const auto& key : keys) {
+    std::vector<std::string_view> values = {"shared", key};
+    cache->UpdateKeyValueSet(key, absl::MakeSpan(values), 1);
+    key_set.insert(key);
+  }
+  auto result = cache->GetKeyValueSet(GetRequestContext(), key_set);
+  ASSERT_TRUE(result->HasValueSetIds());
+  RoaringBitmap ids = *result->GetValueSetIds(keys.front());
+  for (const auto& key : keys) {
+    ids.IntersectWith(*result->GetValueSetIds(key));
+  }
+  EXPECT_THAT(result->GetValues(ids), UnorderedElementsAre("shared"));
+}
+TEST_F(ShardedCacheTest, DeleteValuesInSetThenCleanup) {
+  std::unique_ptr<Cache> cache = ShardedKeyValueCache::Create(kNumSegments);
+  std::vector<std::string_view> values = {"v1", "v2", "v3"};
+  std::vector<std::string_view> values_to_delete = {"v1", "v2"};
+  cache->UpdateKeyValueSet("my_key", absl::MakeSpan(values), 1);
+  cache->DeleteValuesInSet("my_key", absl::MakeSpan(values_to_delete), 2);
+  cache->RemoveDeletedKeys(2);
+  // Updates at or before the cleanup cutoff are ignored.
+  cache->UpdateKeyValueSet("my_key", absl::MakeSpan(values_to_delete), 2);
+  EXPECT_THAT(cache->GetKeyValueSet(GetRequestContext(), {"my_key"})
+                  ->GetValueSet("my_key"),
+              UnorderedElementsAre("v3"));
+}
+
+TEST_F(ShardedCacheTest, ConcurrentGetAndUpdateAcrossSegments) {
+  std::unique_ptr<Cache> cache = ShardedKeyValueCache::Create(kNumSegments);
+  const int num_keys = 4 * kNumSegments;
+  std::vector<std::string> keys;
+  absl::flat_hash_set<std::string_view> key_set;
+  for (int i = 0; i < num_keys; i++) {
+    keys.push_back(absl::StrCat("key", i));
+  }
+  for (const auto& key : keys) {
+    cache->UpdateKeyValue(key, "initial", 1);
+    key_set.insert(key);
+  }
+  absl::Notification start;
+  auto& request_context = GetRequestContext();
+  auto lookup_fn = [&cache, &key_set, &start, &request_context, num_keys]() {
+    start.WaitForNotification();
+    EXPECT_EQ(cache->GetKeyValuePairs(request_context, key_set).size(),
+              num_keys);
+  };
+  auto update_fn = [&cache, &keys, &start](int64_t logical_commit_time) {
+    start.WaitForNotification();
+    for (const auto& key : keys) {
+      cache->UpdateKeyValue(key, "updated", logical_commit_time);
+    }
+  };
+  std::vector<std::thread> threads;
+  for (int i = 0; i < std::min(20, (int)std::thread::hardware_concurrency());
+       i++) {
+    threads.emplace_back(lookup_fn);
+    threads.emplace_back(update_fn, i + 2);
+  }
+  start.Notify();
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  for (const auto& [key, value] : cache->GetKeyValuePairs(
+           GetRequestContext(), key_set)) {
+    EXPECT_EQ(value, "updated");
+  }
+}
+
+TEST_F(ShardedCacheTest, BackgroundCleanupKeepsRecordedCleanupTime) {
+  std::unique_ptr<Cache> cache = ShardedKeyValueCache::Create(kNumSegments);
+  ASSERT_TRUE(
+      cache->StartBackgroundCleanup(absl::Milliseconds(1), absl::Milliseconds(1))
+          .ok());
+  for (int i = 0; i < 100; i++) {
+    cache->UpdateKeyValue(absl::StrCat("key", i), "value", 1);
+    cache->DeleteKey(absl::StrCat("key", i), 2);
+  }
+  cache->UpdateKeyValue("kept", "value", 3);
+  cache->RemoveDeletedKeys(2);
+  absl::SleepFor(absl::Milliseconds(10));
+  for (int i = 0; i < 100; i++) {
+    // Older than the cleanup time, whether or not the deletion was removed.
+    cache->UpdateKeyValue(absl::StrCat("key", i), "value", 2);
+  }
+  absl::flat_hash_set<std::string_view> keys = {"key0", "key99", "kept"};
+  EXPECT_THAT(cache->GetKeyValuePairs(GetRequestContext(), keys),
+              UnorderedElementsAre(testing::Pair("kept", "value")));
+}
+
+TEST_F(ShardedCacheTest, ApplyBatchAcrossSegments) {
+  std::unique_ptr<Cache> cache = ShardedKeyValueCache::Create(kNumSegments);
+  std::vector<std::string> keys;
+  absl::flat_hash_set<size_t> segments;
+  for (int i = 0; segments.size() < 2; i++) {
+    keys.push_back(absl::StrCat("key", i));
+    segments.insert(
+        ShardedKeyValueCacheTestPeer::GetSegmentIndex(*cache, keys.back()));
+  }
+  std::vector<std::string_view> values = {"v1", "v2"};
+  std::vector<CacheMutation> mutations;
+  absl::flat_hash_set<std::string_view> key_set;
+  for (const auto& key : keys) {
+    mutations.push_back(
+        {CacheMutation::Type::kUpdateKeyValue, key, "value", {}, 1});
+    mutations.push_back(
+        {CacheMutation::Type::kUpdateKeyValueSet, key, "",
+         absl::MakeSpan(values), 1});
+    key_set.insert(key);
+  }
+  mutations.push_back({CacheMutation::Type::kDeleteKey, keys.back(), "", {}, 2});
+  cache->ApplyBatch(mutations);
+
+  const auto kv_pairs = cache->GetKeyValuePairs(GetRequestContext(), key_set);
+  EXPECT_EQ(kv_pairs.size(), keys.size() - 1);
+  EXPECT_FALSE(kv_pairs.contains(keys.back()));
+  auto result = cache->GetKeyValueSet(GetRequestContext(), key_set);
+  for (const auto& key : keys) {
+    EXPECT_THAT(result->GetValueSet(key), UnorderedElementsAre("v1", "v2"));
+  }
+}
+
+TEST_F(ShardedCacheTest, CheckpointRestoresEverySegment) {
+  std::unique_ptr<Cache> cache =
+      ShardedKeyValueCache::Create(kNumSegments, /*intern_set_values=*/true);
+  std::vector<std::string> keys;
+  std::vector<std::string_view> values = {"v1", "v2"};
+  for (int i = 0; i < 2 * kNumSegments; i++) {
+    keys.push_back(absl::StrCat("key", i));
+    cache->UpdateKeyValue(keys.back(), "value", 1);
+    cache->UpdateKeyValueSet(keys.back(), absl::MakeSpan(values), 1);
+  }
+  std::ostringstream output;
+  CheckpointWriter writer(output);
+  ASSERT_TRUE(cache->WriteCheckpoint(writer).ok());
+  const std::string checkpoint = output.str();
+
+  std::unique_ptr<Cache> restored =
+      ShardedKeyValueCache::Create(kNumSegments, /*intern_set_values=*/true);
+  CheckpointReader reader(checkpoint);
+  ASSERT_TRUE(restored->RestoreCheckpoint(reader).ok());
+  const absl::flat_hash_set<std::string_view> key_set(keys.begin(),
+                                                      keys.end());
+  EXPECT_EQ(restored->GetKeyValuePairs(GetRequestContext(), key_set).size(),
+            keys.size());
+  auto result = restored->GetKeyValueSet(GetRequestContext(), key_set);
+  for (const auto& key : keys) {
+    EXPECT_THAT(result->GetValueSet(key), UnorderedElementsAre("v1", "v2"));
+  }
+
+  // Keys would be in other segments of a cache with another segment count.
+  std::unique_ptr<Cache> other = ShardedKeyValueCache::Create(kNumSegments / 2);
+  CheckpointReader other_reader(checkpoint);
+  EXPECT_EQ(other->RestoreCheckpoint(other_reader).code(),
+            absl::StatusCode::kFailedPrecondition);
+}
+
+TEST_F(ShardedCacheTest, BulkLoadPublishesEverySegmentOnFinish) {
+  std::unique_ptr<Cache> cache =
+      ShardedKeyValueCache::Create(kNumSegments, /*intern_set_values=*/true);
+  std::vector<std::string> keys;
+  std::vector<std::string_view> values = {"v1", "v2"};
+  ASSERT_TRUE(cache->StartBulkLoad().ok());
+  for (int i = 0; i < 2 * kNumSegments; i++) {
+    keys.push_back(absl::StrCat("key", i));
+    cache->UpdateKeyValue(keys.back(), "value", 2);
+    cache->UpdateKeyValue(keys.back(), "stale", 1);
+    cache->UpdateKeyValueSet(keys.back(), absl::MakeSpan(values), 1);
+  }
+  const absl::flat_hash_set<std::string_view> key_set(keys.begin(),
+                                                      keys.end());
+  EXPECT_TRUE(cache->GetKeyValuePairs(GetRequestContext(), key_set).empty());
+
+  ASSERT_TRUE(cache->FinishBulkLoad().ok());
+  const auto kv_pairs = cache->GetKeyValuePairs(GetRequestContext(), key_set);
+  EXPECT_EQ(kv_pairs.size(), keys.size());
+  for (const auto& [key, value] : kv_pairs) {
+    EXPECT_EQ(value, "value");
+  }
+  auto result = cache->GetKeyValueSet(GetRequestContext(), key_set);
+  for (const auto& key : keys) {
+    EXPECT_THAT(result->GetValueSet(key), UnorderedElementsAre("v1", "v2"));
+  }
+}
+
+TEST_F(ShardedCacheTest, SortedKeyIndexMergesSegmentsInOrder) {
+  std::unique_ptr<Cache> cache = ShardedKeyValueCache::Create(kNumSegments);
+  ASSERT_TRUE(cache->EnableSortedKeyIndex().ok());
+  std::vector<std::string> keys;
+  for (int i = 0; i < 2 * kNumSegments; i++) {
+    keys.push_back(absl::StrCat("c1:", i));
+    cache->UpdateKeyValue(keys.back(), "value", 1);
+    cache->UpdateKeyValue(absl::StrCat("c2:", i), "value", 1);
+  }
+  std::sort(keys.begin(), keys.end());
+  EXPECT_EQ(*cache->GetKeysWithPrefix(GetRequestContext(), "c1:", 100), keys);
+  keys.resize(3);
+  EXPECT_EQ(*cache->GetKeysWithPrefix(GetRequestContext(), "c1:", 3), keys);
+}
+
+TEST_F(ShardedCacheTest, GetHotKeysMergesSegments) {
+  std::unique_ptr<Cache> cache = ShardedKeyValueCache::Create(kNumSegments);
+  ASSERT_TRUE(cache->EnableHotKeyTracking(1).ok());
+  absl::flat_hash_set<std::string_view> keys;
+  std::vector<std::string> key_storage;
+  for (int i = 0; i < 2 * kNumSegments; i++) {
+    key_storage.push_back(absl::StrCat("key", i));
+  }
+  for (int i = 0; i < 2 * kNumSegments; i++) {
+    cache->UpdateKeyValue(key_storage[i], "value", 1);
+    // key<i> is looked up i + 1 times.
+    keys.insert(key_storage[i]);
+    cache->GetKeyValuePairs(GetRequestContext(), keys);
+  }
+  const std::vector<HotKey> hot_keys = cache->GetHotKeys(2)[""];
+  ASSERT_EQ(hot_keys.size(), 2);
+  EXPECT_EQ(hot_keys[0].key, "key0");
+  EXPECT_EQ(hot_keys[1].key, "key1");
+}
+
+}  // namespace
+}  // namespace kv_server
@@ -0,0 +1,65 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/data_server/cache/sorted_key_index.h"
+
+#include <algorithm>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "absl/strings/match.h"
+
+namespace kv_server {
+
+void SortedKeyIndex::Add(std::string_view key) {
+  absl::MutexLock lock(&mutex_);
+  keys_.emplace(key);
+}
+
+void SortedKeyIndex::Remove(std::string_view key) {
+  absl::MutexLock lock(&mutex_);
+  keys_.erase(key);
+}
+
+std::vector<std::string> SortedKeyIndex::KeysWithPrefix(
+    std::string_view key_prefix, int64_t limit) const {
+  std::vector<std::string> keys;
+  absl::ReaderMutexLock lock(&mutex_);
+  for (auto it = keys_.lower_bound(key_prefix);
+       it != keys_.end() && static_cast<int64_t>(keys.size()) < limit &&
+       absl::StartsWith(*it, key_prefix);
+       ++it) {
+    keys.push_back(*it);
+  }
+  return keys;
+}
+
+std::vector<std::string> SortedKeyIndex::Merge(
+    absl::Span<std::vector<std::string>> keys, int64_t limit) {
+  std::vector<std::string> merged;
+  for (std::vector<std::string>& list : keys) {
+    merged.insert(merged.end(), std::make_move_iterator(list.begin()),
+                  std::make_move_iterator(list.end()));
+  }
+  std::sort(merged.begin(), merged.end());
+  merged.erase(std::unique(merged.begin(), merged.end()), merged.end());
+  if (static_cast<int64_t>(merged.size()) > limit) {
+    merged.resize(std::max<int64_t>(limit, 0));
+  }
+  return merged;
+}
+
+}  // namespace kv_server
@@ -0,0 +1,63 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef COMPONENTS_DATA_SERVER_CACHE_SORTED_KEY_INDEX_H_
+#define COMPONENTS_DATA_SERVER_CACHE_SORTED_KEY_INDEX_H_
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/btree_set.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/span.h"
+
+namespace kv_server {
+
+// Ordered index of keys, so that the keys sharing a prefix are found in time
+// proportional to their number rather than to the number of all keys.
+//
+// Thread safe.
+class SortedKeyIndex {
+ public:
+  SortedKeyIndex() = default;
+  SortedKeyIndex(const SortedKeyIndex&) = delete;
+  SortedKeyIndex& operator=(const SortedKeyIndex&) = delete;
+
+  void Add(std::string_view key) ABSL_LOCKS_EXCLUDED(mutex_);
+
+  void Remove(std::string_view key) ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Returns up to `limit` of the keys starting with `key_prefix`, in order.
+  std::vector<std::string> KeysWithPrefix(std::string_view key_prefix,
+                                          int64_t limit) const
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Returns the first `limit` distinct keys of `keys`, lists of keys that are
+  // each in order, e.g. the results of `KeysWithPrefix` of several indexes.
+  static std::vector<std::string> Merge(
+      absl::Span<std::vector<std::string>> keys, int64_t limit);
+
+ private:
+  mutable absl::Mutex mutex_;
+  absl::btree_set<std::string> keys_ ABSL_GUARDED_BY(mutex_);
+};
+
+}  // namespace kv_server
+
+#endif  // COMPONENTS_DATA_SERVER_CACHE_SORTED_KEY_INDEX_H_
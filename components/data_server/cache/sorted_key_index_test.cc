@@ -0,0 +1,64 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/data_server/cache/sorted_key_index.h"
+
+#include <string>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace kv_server {
+namespace {
+
+using testing::ElementsAre;
+using testing::IsEmpty;
+
+TEST(SortedKeyIndexTest, ReturnsKeysWithPrefixInOrder) {
+  SortedKeyIndex index;
+  index.Add("campaign2:ad1");
+  index.Add("campaign1:ad2");
+  index.Add("campaign1:ad1");
+  index.Add("campaign");
+  index.Add("campaign1:ad1");
+  EXPECT_THAT(index.KeysWithPrefix("campaign1:", 10),
+              ElementsAre("campaign1:ad1", "campaign1:ad2"));
+  EXPECT_THAT(index.KeysWithPrefix("campaign", 2),
+              ElementsAre("campaign", "campaign1:ad1"));
+  EXPECT_THAT(index.KeysWithPrefix("", 10),
+              ElementsAre("campaign", "campaign1:ad1", "campaign1:ad2",
+                          "campaign2:ad1"));
+  EXPECT_THAT(index.KeysWithPrefix("campaign3", 10), IsEmpty());
+  EXPECT_THAT(index.KeysWithPrefix("campaign1:", 0), IsEmpty());
+}
+
+TEST(SortedKeyIndexTest, RemovesKeys) {
+  SortedKeyIndex index;
+  index.Add("key1");
+  index.Add("key2");
+  index.Remove("key1");
+  index.Remove("missing");
+  EXPECT_THAT(index.KeysWithPrefix("key", 10), ElementsAre("key2"));
+}
+
+TEST(SortedKeyIndexTest, MergesFirstDistinctKeys) {
+  std::vector<std::vector<std::string>> keys = {
+      {"key1", "key3"}, {"key2", "key3", "key4"}, {}};
+  EXPECT_THAT(SortedKeyIndex::Merge(absl::MakeSpan(keys), 3),
+              ElementsAre("key1", "key2", "key3"));
+}
+
+}  // namespace
+}  // namespace kv_server
@@ -0,0 +1,278 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/data_server/cache/swappable_cache.h"
+
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace kv_server {
+namespace {
+
+// Keeps the cache that a result was looked up in alive with the result.
+class SwappableCacheKeyValueResult : public GetKeyValueResult {
+ public:
+  SwappableCacheKeyValueResult(std::shared_ptr<const Cache> cache,
+                               std::unique_ptr<GetKeyValueResult> result)
+      : cache_(std::move(cache)), result_(std::move(result)) {}
+
+  std::optional<std::string_view> GetValue(
+      std::string_view key) const override {
+    return result_->GetValue(key);
+  }
+
+  std::optional<std::string_view> GetSerializedJsonValue(
+      std::string_view key) const override {
+    return result_->GetSerializedJsonValue(key);
+  }
+
+  size_t size() const override { return result_->size(); }
+
+ private:
+  // Only called by the caches that create results.
+  void AddKeyValue(std::string_view key, std::string_view value,
+                   std::shared_ptr<const void> value_owner,
+                   std::optional<std::string_view> serialized_json) override {}
+
+  // Declared before `result_` so that it outlives it.
+  std::shared_ptr<const Cache> cache_;
+  std::unique_ptr<GetKeyValueResult> result_;
+};
+
+class SwappableCacheUInt32ValueSetResult : public GetUInt32ValueSetResult {
+ public:
+  SwappableCacheUInt32ValueSetResult(
+      std::shared_ptr<const Cache> cache,
+      std::unique_ptr<GetUInt32ValueSetResult> result)
+      : cache_(std::move(cache)), result_(std::move(result)) {}
+
+  const RoaringBitmap& GetValueSet(std::string_view key) const override {
+    return result_->GetValueSet(key);
+  }
+
+ private:
+  // Only called by the caches that create results.
+  void AddValueSet(std::string_view key, const RoaringBitmap& values,
+                   std::unique_ptr<absl::ReaderMutexLock> key_lock) override {}
+
+  void AddOwnedValueSet(std::string_view key, RoaringBitmap values) override {}
+
+  // Declared before `result_` so that it outlives it.
+  std::shared_ptr<const Cache> cache_;
+  std::unique_ptr<GetUInt32ValueSetResult> result_;
+};
+
+}  // namespace
+
+SwappableCache::SwappableCache(std::shared_ptr<Cache> cache)
+    : current_(std::move(cache)) {}
+
+std::shared_ptr<Cache> SwappableCache::Current() const {
+  absl::ReaderMutexLock lock(&mutex_);
+  return current_;
+}
+
+absl::flat_hash_map<std::string, std::string> SwappableCache::GetKeyValuePairs(
+    const RequestContext& request_context,
+    const absl::flat_hash_set<std::string_view>& key_set) const {
+  return Current()->GetKeyValuePairs(request_context, key_set);
+}
+
+std::unique_ptr<GetKeyValueResult> SwappableCache::GetKeyValues(
+    const RequestContext& request_context,
+    const absl::flat_hash_set<std::string_view>& key_set) const {
+  std::shared_ptr<Cache> cache = Current();
+  auto result = cache->GetKeyValues(request_context, key_set);
+  return std::make_unique<SwappableCacheKeyValueResult>(std::move(cache),
+                                                        std::move(result));
+}
+
+std::unique_ptr<GetKeyValueSetResult> SwappableCache::GetKeyValueSet(
+    const RequestContext& request_context,
+    const absl::flat_hash_set<std::string_view>& key_set) const {
+  // Results hold snapshots of the sets, which do not need the cache to stay
+  // alive.
+  return Current()->GetKeyValueSet(request_context, key_set);
+}
+
+std::unique_ptr<GetUInt32ValueSetResult> SwappableCache::GetUInt32ValueSet(
+    const RequestContext& request_context,
+    const absl::flat_hash_set<std::string_view>& key_set) const {
+  std::shared_ptr<Cache> cache = Current();
+  auto result = cache->GetUInt32ValueSet(request_context, key_set);
+  return std::make_unique<SwappableCacheUInt32ValueSetResult>(
+      std::move(cache), std::move(result));
+}
+
+void SwappableCache::UpdateKeyValue(std::string_view key,
+                                    std::string_view value,
+                                    int64_t logical_commit_time,
+                                    std::string_view prefix) {
+  absl::ReaderMutexLock lock(&mutex_);
+  current_->UpdateKeyValue(key, value, logical_commit_time, prefix);
+  if (next_ != nullptr) {
+    next_->UpdateKeyValue(key, value, logical_commit_time, prefix);
+  }
+}
+
+void SwappableCache::UpdateKeyValueSet(std::string_view key,
+                                       absl::Span<std::string_view> value_set,
+                                       int64_t logical_commit_time,
+                                       std::string_view prefix) {
+  absl::ReaderMutexLock lock(&mutex_);
+  current_->UpdateKeyValueSet(key, value_set, logical_commit_time, prefix);
+  if (next_ != nullptr) {
+    next_->UpdateKeyValueSet(key, value_set, logical_commit_time, prefix);
+  }
+}
+
+void SwappableCache::UpdateKeyValueUInt32Set(
+    std::string_view key, absl::Span<const uint32_t> value_set,
+    int64_t logical_commit_time, std::string_view prefix) {
+  absl::ReaderMutexLock lock(&mutex_);
+  current_->UpdateKeyValueUInt32Set(key, value_set, logical_commit_time,
+                                    prefix);
+  if (next_ != nullptr) {
+    next_->UpdateKeyValueUInt32Set(key, value_set, logical_commit_time, prefix);
+  }
+}
+
+void SwappableCache::DeleteKey(std::string_view key,
+                               int64_t logical_commit_time,
+                               std::string_view prefix) {
+  absl::ReaderMutexLock lock(&mutex_);
+  current_->DeleteKey(key, logical_commit_time, prefix);
+  if (next_ != nullptr) {
+    next_->DeleteKey(key, logical_commit_time, prefix);
+  }
+}
+
+void SwappableCache::DeleteValuesInSet(std::string_view key,
+                                       absl::Span<std::string_view> value_set,
+                                       int64_t logical_commit_time,
+                                       std::string_view prefix) {
+  absl::ReaderMutexLock lock(&mutex_);
+  current_->DeleteValuesInSet(key, value_set, logical_commit_time, prefix);
+  if (next_ != nullptr) {
+    next_->DeleteValuesInSet(key, value_set, logical_commit_time, prefix);
+  }
+}
+
+void SwappableCache::DeleteValuesInUInt32Set(
+    std::string_view key, absl::Span<const uint32_t> value_set,
+    int64_t logical_commit_time, std::string_view prefix) {
+  absl::ReaderMutexLock lock(&mutex_);
+  current_->DeleteValuesInUInt32Set(key, value_set, logical_commit_time,
+                                    prefix);
+  if (next_ != nullptr) {
+    next_->DeleteValuesInUInt32Set(key, value_set, logical_commit_time, prefix);
+  }
+}
+
+void SwappableCache::RemoveDeletedKeys(int64_t logical_commit_time,
+                                       std::string_view prefix) {
+  Current()->RemoveDeletedKeys(logical_commit_time, prefix);
+}
+
+void SwappableCache::ApplyBatch(absl::Span<const CacheMutation> mutations,
+                                std::string_view prefix) {
+  absl::ReaderMutexLock lock(&mutex_);
+  current_->ApplyBatch(mutations, prefix);
+  if (next_ != nullptr) {
+    next_->ApplyBatch(mutations, prefix);
+  }
+}
+
+void SwappableCache::Reserve(int64_t num_keys, int64_t num_set_keys) {
+  Current()->Reserve(num_keys, num_set_keys);
+}
+
+absl::Status SwappableCache::StartBackgroundCleanup(absl::Duration interval,
+                                                    absl::Duration max_pause) {
+  return Current()->StartBackgroundCleanup(interval, max_pause);
+}
+
+absl::Status SwappableCache::WriteCheckpoint(CheckpointWriter& writer) const {
+  return Current()->WriteCheckpoint(writer);
+}
+
+absl::Status SwappableCache::RestoreCheckpoint(CheckpointReader& reader) {
+  return Current()->RestoreCheckpoint(reader);
+}
+
+absl::Status SwappableCache::StartBulkLoad() {
+  return Current()->StartBulkLoad();
+}
+
+absl::Status SwappableCache::FinishBulkLoad() {
+  return Current()->FinishBulkLoad();
+}
+
+absl::Status SwappableCache::ForEachKey(
+    absl::FunctionRef<void(std::string_view key)> callback) const {
+  return Current()->ForEachKey(callback);
+}
+
+absl::flat_hash_map<std::string, PrefixStats> SwappableCache::GetPrefixStats()
+    const {
+  return Current()->GetPrefixStats();
+}
+
+absl::Status SwappableCache::EnableSetValueIndex() {
+  return Current()->EnableSetValueIndex();
+}
+
+absl::StatusOr<std::vector<std::string>> SwappableCache::GetKeysContaining(
+    const RequestContext& request_context, std::string_view value) const {
+  return Current()->GetKeysContaining(request_context, value);
+}
+
+absl::Status SwappableCache::EnableSortedKeyIndex() {
+  return Current()->EnableSortedKeyIndex();
+}
+
+absl::StatusOr<std::vector<std::string>> SwappableCache::GetKeysWithPrefix(
+    const RequestContext& request_context, std::string_view key_prefix,
+    int64_t limit) const {
+  return Current()->GetKeysWithPrefix(request_context, key_prefix, limit);
+}
+
+absl::Status SwappableCache::EnableHotKeyTracking(int32_t sample_rate) {
+  return Current()->EnableHotKeyTracking(sample_rate);
+}
+
+HotKeys SwappableCache::GetHotKeys(int64_t num_keys_per_prefix) const {
+  return Current()->GetHotKeys(num_keys_per_prefix);
+}
+
+void SwappableCache::StartSwap(std::shared_ptr<Cache> next) {
+  absl::MutexLock lock(&mutex_);
+  next_ = std::move(next);
+}
+
+std::shared_ptr<Cache> SwappableCache::AbortSwap() {
+  absl::MutexLock lock(&mutex_);
+  return std::exchange(next_, nullptr);
+}
+
+std::shared_ptr<Cache> SwappableCache::FinishSwap() {
+  absl::MutexLock lock(&mutex_);
+  if (next_ == nullptr) {
+    return nullptr;
+  }
+  return std::exchange(current_, std::exchange(next_, nullptr));
+}
+
+}  // namespace kv_server
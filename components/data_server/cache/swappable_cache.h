@@ -0,0 +1,177 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef COMPONENTS_DATA_SERVER_CACHE_SWAPPABLE_CACHE_H_
+#define COMPONENTS_DATA_SERVER_CACHE_SWAPPABLE_CACHE_H_
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "components/data_server/cache/cache.h"
+#include "components/data_server/cache/checkpoint_io.h"
+#include "components/data_server/cache/get_key_value_result.h"
+#include "components/data_server/cache/get_key_value_set_result.h"
+#include "components/data_server/cache/get_uint32_value_set_result.h"
+
+namespace kv_server {
+
+// Cache that forwards to a current cache which can be replaced while it is
+// served, so that a new cache can be loaded from scratch in the background
+// and swapped in once complete, instead of applying the data to the current
+// cache.
+//
+// A swap starts with `StartSwap`, after which updates are applied to both the
+// current and the next cache, so that the next cache does not miss the
+// updates applied while it is loaded, and completes with `FinishSwap`.
+// Deleted keys are only removed from the current cache: the next cache may
+// still be loaded with older updates of those keys.
+//
+// Lookups hold a reference to the cache they were served from until their
+// results are destroyed, so a swapped out cache stays valid until the last of
+// them is.
+class SwappableCache : public Cache {
+ public:
+  explicit SwappableCache(std::shared_ptr<Cache> cache);
+
+  absl::flat_hash_map<std::string, std::string> GetKeyValuePairs(
+      const RequestContext& request_context,
+      const absl::flat_hash_set<std::string_view>& key_set) const override;
+
+  std::unique_ptr<GetKeyValueResult> GetKeyValues(
+      const RequestContext& request_context,
+      const absl::flat_hash_set<std::string_view>& key_set) const override;
+
+  std::unique_ptr<GetKeyValueSetResult> GetKeyValueSet(
+      const RequestContext& request_context,
+      const absl::flat_hash_set<std::string_view>& key_set) const override;
+
+  std::unique_ptr<GetUInt32ValueSetResult> GetUInt32ValueSet(
+      const RequestContext& request_context,
+      const absl::flat_hash_set<std::string_view>& key_set) const override;
+
+  void UpdateKeyValue(std::string_view key, std::string_view value,
+                      int64_t logical_commit_time,
+                      std::string_view prefix = "") override;
+
+  void UpdateKeyValueSet(std::string_view key,
+                         absl::Span<std::string_view> value_set,
+                         int64_t logical_commit_time,
+                         std::string_view prefix = "") override;
+
+  void UpdateKeyValueUInt32Set(std::string_view key,
+                               absl::Span<const uint32_t> value_set,
+                               int64_t logical_commit_time,
+                               std::string_view prefix = "") override;
+
+  void DeleteKey(std::string_view key, int64_t logical_commit_time,
+                 std::string_view prefix = "") override;
+
+  void DeleteValuesInSet(std::string_view key,
+                         absl::Span<std::string_view> value_set,
+                         int64_t logical_commit_time,
+                         std::string_view prefix = "") override;
+
+  void DeleteValuesInUInt32Set(std::string_view key,
+                               absl::Span<const uint32_t> value_set,
+                               int64_t logical_commit_time,
+                               std::string_view prefix = "") override;
+
+  // Only removes the deleted keys of the current cache.
+  void RemoveDeletedKeys(int64_t logical_commit_time,
+                         std::string_view prefix = "") override;
+
+  void ApplyBatch(absl::Span<const CacheMutation> mutations,
+                  std::string_view prefix = "") override;
+
+  void Reserve(int64_t num_keys, int64_t num_set_keys) override;
+
+  // Starts the background cleanup of the current cache only. Caches passed
+  // to `StartSwap` have to be started by their creator.
+  absl::Status StartBackgroundCleanup(absl::Duration interval,
+                                      absl::Duration max_pause) override;
+
+  absl::Status WriteCheckpoint(CheckpointWriter& writer) const override;
+
+  absl::Status RestoreCheckpoint(CheckpointReader& reader) override;
+
+  // Bulk loads the current cache only, like `StartBackgroundCleanup`.
+  absl::Status StartBulkLoad() override;
+  absl::Status FinishBulkLoad() override;
+
+  absl::Status ForEachKey(
+      absl::FunctionRef<void(std::string_view key)> callback) const override;
+
+  absl::flat_hash_map<std::string, PrefixStats> GetPrefixStats()
+      const override;
+
+  // Enables the set value index of the current cache only, like
+  // `StartBackgroundCleanup`.
+  absl::Status EnableSetValueIndex() override;
+
+  absl::StatusOr<std::vector<std::string>> GetKeysContaining(
+      const RequestContext& request_context,
+      std::string_view value) const override;
+
+  // Enables the sorted key index of the current cache only, like
+  // `EnableSetValueIndex`.
+  absl::Status EnableSortedKeyIndex() override;
+
+  absl::StatusOr<std::vector<std::string>> GetKeysWithPrefix(
+      const RequestContext& request_context, std::string_view key_prefix,
+      int64_t limit) const override;
+
+  // Tracks the hot keys of the current cache only, like
+  // `EnableSetValueIndex`.
+  absl::Status EnableHotKeyTracking(int32_t sample_rate) override;
+
+  HotKeys GetHotKeys(int64_t num_keys_per_prefix) const override;
+
+  // Starts applying updates to `next` as well as to the current cache. Waits
+  // for the updates in progress, so that every update applied after it
+  // returns reaches `next`. Replaces the cache of a swap already started.
+  void StartSwap(std::shared_ptr<Cache> next);
+
+  // Stops applying updates to the cache passed to `StartSwap`, e.g. because
+  // it failed to load, and returns it.
+  std::shared_ptr<Cache> AbortSwap();
+
+  // Makes the cache passed to `StartSwap` current, and returns the previous
+  // one. Lookups in progress may still hold references to it. Does nothing
+  // and returns nullptr if no swap was started.
+  std::shared_ptr<Cache> FinishSwap();
+
+ private:
+  // Returns the current cache.
+  std::shared_ptr<Cache> Current() const ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Updates are applied holding `mutex_` shared, so that `StartSwap` and
+  // `FinishSwap` wait for the updates in progress.
+  mutable absl::Mutex mutex_;
+  std::shared_ptr<Cache> current_ ABSL_GUARDED_BY(mutex_);
+  std::shared_ptr<Cache> next_ ABSL_GUARDED_BY(mutex_);
+};
+
+}  // namespace kv_server
+
+#endif  // COMPONENTS_DATA_SERVER_CACHE_SWAPPABLE_CACHE_H_
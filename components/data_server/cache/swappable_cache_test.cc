@@ -0,0 +1,118 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/data_server/cache/swappable_cache.h"
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "components/data_server/cache/cache.h"
+#include "components/data_server/cache/key_value_cache.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace kv_server {
+namespace {
+
+using testing::Optional;
+using testing::UnorderedElementsAre;
+
+class SwappableCacheTest : public ::testing::Test {
+ protected:
+  SwappableCacheTest() {
+    InitMetricsContextMap();
+    scope_metrics_context_ = std::make_unique<ScopeMetricsContext>();
+    request_context_ =
+        std::make_unique<RequestContext>(*scope_metrics_context_);
+  }
+  RequestContext& GetRequestContext() { return *request_context_; }
+  std::unique_ptr<ScopeMetricsContext> scope_metrics_context_;
+  std::unique_ptr<RequestContext> request_context_;
+};
+
+TEST_F(SwappableCacheTest, ForwardsToCurrentCache) {
+  std::shared_ptr<Cache> current = KeyValueCache::Create();
+  SwappableCache cache(current);
+  cache.UpdateKeyValue("key", "value", 1);
+  std::vector<std::string_view> values = {"v1", "v2"};
+  cache.UpdateKeyValueSet("set_key", absl::MakeSpan(values), 1);
+
+  EXPECT_THAT(current->GetKeyValues(GetRequestContext(), {"key"})
+                  ->GetValue("key"),
+              Optional(std::string_view("value")));
+  EXPECT_THAT(cache.GetKeyValues(GetRequestContext(), {"key"})
+                  ->GetValue("key"),
+              Optional(std::string_view("value")));
+  EXPECT_THAT(cache.GetKeyValueSet(GetRequestContext(), {"set_key"})
+                  ->GetValueSet("set_key"),
+              UnorderedElementsAre("v1", "v2"));
+}
+
+TEST_F(SwappableCacheTest, UpdatesReachNextCacheUntilSwapped) {
+  std::shared_ptr<Cache> current = KeyValueCache::Create();
+  SwappableCache cache(current);
+  cache.UpdateKeyValue("old_key", "old_value", 1);
+  std::shared_ptr<Cache> next = KeyValueCache::Create();
+  cache.StartSwap(next);
+  cache.UpdateKeyValue("key", "value", 2);
+  // Lookups are still served by the current cache.
+  EXPECT_THAT(cache.GetKeyValues(GetRequestContext(), {"old_key"})
+                  ->GetValue("old_key"),
+              Optional(std::string_view("old_value")));
+
+  EXPECT_EQ(cache.FinishSwap(), current);
+  EXPECT_THAT(cache.GetKeyValues(GetRequestContext(), {"key"})
+                  ->GetValue("key"),
+              Optional(std::string_view("value")));
+  EXPECT_EQ(cache.GetKeyValues(GetRequestContext(), {"old_key"})
+                ->GetValue("old_key"),
+            std::nullopt);
+  cache.UpdateKeyValue("new_key", "new_value", 3);
+  EXPECT_EQ(current->GetKeyValues(GetRequestContext(), {"new_key"})
+                ->GetValue("new_key"),
+            std::nullopt);
+}
+
+TEST_F(SwappableCacheTest, AbortSwapKeepsCurrentCache) {
+  std::shared_ptr<Cache> next = KeyValueCache::Create();
+  SwappableCache cache(KeyValueCache::Create());
+  cache.StartSwap(next);
+  EXPECT_EQ(cache.AbortSwap(), next);
+  cache.UpdateKeyValue("key", "value", 1);
+  EXPECT_EQ(next->GetKeyValues(GetRequestContext(), {"key"})->GetValue("key"),
+            std::nullopt);
+  EXPECT_EQ(cache.FinishSwap(), nullptr);
+  EXPECT_THAT(cache.GetKeyValues(GetRequestContext(), {"key"})
+                  ->GetValue("key"),
+              Optional(std::string_view("value")));
+}
+
+TEST_F(SwappableCacheTest, ResultsOutliveSwappedOutCache) {
+  SwappableCache cache(KeyValueCache::Create());
+  cache.UpdateKeyValue("key", "value", 1);
+  std::vector<std::string_view> values = {"v1"};
+  cache.UpdateKeyValueSet("set_key", absl::MakeSpan(values), 1);
+  auto result = cache.GetKeyValues(GetRequestContext(), {"key"});
+  auto set_result = cache.GetKeyValueSet(GetRequestContext(), {"set_key"});
+  cache.StartSwap(KeyValueCache::Create());
+  // Released while the results still reference the cache.
+  cache.FinishSwap().reset();
+  EXPECT_THAT(result->GetValue("key"), Optional(std::string_view("value")));
+  EXPECT_THAT(set_result->GetValueSet("set_key"), UnorderedElementsAre("v1"));
+}
+
+}  // namespace
+}  // namespace kv_server
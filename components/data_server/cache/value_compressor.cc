@@ -0,0 +1,219 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/data_server/cache/value_compressor.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/log/log.h"
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "zdict.h"
+#include "zstd.h"
+
+namespace kv_server {
+namespace {
+
+// First byte of every stored value, telling how the rest of it is stored.
+constexpr char kUncompressed = 0;
+// The rest is a zstd frame that names the id of its dictionary.
+constexpr char kCompressed = 1;
+
+struct CCtxDeleter {
+  void operator()(ZSTD_CCtx* cctx) const { ZSTD_freeCCtx(cctx); }
+};
+
+struct DCtxDeleter {
+  void operator()(ZSTD_DCtx* dctx) const { ZSTD_freeDCtx(dctx); }
+};
+
+// Contexts are reused by every compression of a thread, creating them
+// allocates more than compressing a value.
+ZSTD_CCtx* ThreadCCtx() {
+  thread_local std::unique_ptr<ZSTD_CCtx, CCtxDeleter> cctx(ZSTD_createCCtx());
+  return cctx.get();
+}
+
+ZSTD_DCtx* ThreadDCtx() {
+  thread_local std::unique_ptr<ZSTD_DCtx, DCtxDeleter> dctx(ZSTD_createDCtx());
+  return dctx.get();
+}
+
+std::string Uncompressed(std::string_view value) {
+  std::string stored;
+  stored.reserve(value.size() + 1);
+  stored.push_back(kUncompressed);
+  stored.append(value);
+  return stored;
+}
+
+}  // namespace
+
+// Dictionary digested once for all the compressions and decompressions that
+// use it.
+class ValueCompressor::Dictionary {
+ public:
+  Dictionary(std::string_view data, int level)
+      : cdict_(ZSTD_createCDict(data.data(), data.size(), level)),
+        ddict_(ZSTD_createDDict(data.data(), data.size())) {}
+  ~Dictionary() {
+    ZSTD_freeCDict(cdict_);
+    ZSTD_freeDDict(ddict_);
+  }
+
+  Dictionary(const Dictionary&) = delete;
+  Dictionary& operator=(const Dictionary&) = delete;
+
+  bool ok() const { return cdict_ != nullptr && ddict_ != nullptr; }
+  const ZSTD_CDict* cdict() const { return cdict_; }
+  const ZSTD_DDict* ddict() const { return ddict_; }
+
+ private:
+  ZSTD_CDict* const cdict_;
+  ZSTD_DDict* const ddict_;
+};
+
+ValueCompressor::ValueCompressor(Options options)
+    : options_(std::move(options)) {}
+
+ValueCompressor::~ValueCompressor() = default;
+
+std::string ValueCompressor::Compress(std::string_view value,
+                                      std::string_view prefix) {
+  std::shared_ptr<const Dictionary> dictionary;
+  std::vector<std::string> samples;
+  {
+    absl::MutexLock lock(&mutex_);
+    PrefixState& state = prefixes_[prefix];
+    dictionary = state.dictionary;
+    if (dictionary == nullptr && !state.sampled) {
+      state.samples.emplace_back(value);
+      state.sample_size += value.size();
+      if (state.sample_size >= options_.sample_size) {
+        state.sampled = true;
+        samples = std::move(state.samples);
+        state.samples = {};
+      }
+    }
+  }
+  if (!samples.empty()) {
+    // Trained without holding `mutex_`, values of the prefix are stored
+    // uncompressed meanwhile.
+    TrainDictionary(prefix, samples);
+  }
+  if (dictionary == nullptr) {
+    return Uncompressed(value);
+  }
+  std::string stored(1 + ZSTD_compressBound(value.size()), '\0');
+  stored[0] = kCompressed;
+  const size_t compressed_size =
+      ZSTD_compress_usingCDict(ThreadCCtx(), stored.data() + 1,
+                               stored.size() - 1, value.data(), value.size(),
+                               dictionary->cdict());
+  if (ZSTD_isError(compressed_size) || compressed_size >= value.size()) {
+    return Uncompressed(value);
+  }
+  stored.resize(1 + compressed_size);
+  return stored;
+}
+
+absl::StatusOr<std::string_view> ValueCompressor::Decompress(
+    std::string_view stored, std::string& buffer) const {
+  // Values of deleted keys are stored empty.
+  if (stored.empty()) {
+    return stored;
+  }
+  const std::string_view payload = stored.substr(1);
+  if (stored.front() == kUncompressed) {
+    return payload;
+  }
+  if (stored.front() != kCompressed) {
+    return absl::DataLossError("Unknown stored value format");
+  }
+  const uint32_t id =
+      ZSTD_getDictID_fromFrame(payload.data(), payload.size());
+  const ZSTD_DDict* ddict = nullptr;
+  {
+    absl::ReaderMutexLock lock(&mutex_);
+    const auto iter = dictionaries_.find(id);
+    if (iter == dictionaries_.end()) {
+      return absl::DataLossError(
+          absl::StrCat("Unknown compression dictionary ", id));
+    }
+    ddict = iter->second->ddict();
+  }
+  // Frames written by ZSTD_compress_usingCDict always hold their content size.
+  const unsigned long long content_size =  // NOLINT
+      ZSTD_getFrameContentSize(payload.data(), payload.size());
+  if (content_size == ZSTD_CONTENTSIZE_ERROR ||
+      content_size == ZSTD_CONTENTSIZE_UNKNOWN) {
+    return absl::DataLossError("Invalid zstd frame header");
+  }
+  buffer.resize(content_size);
+  const size_t size =
+      ZSTD_decompress_usingDDict(ThreadDCtx(), buffer.data(), buffer.size(),
+                                 payload.data(), payload.size(), ddict);
+  if (ZSTD_isError(size)) {
+    return absl::DataLossError(
+        absl::StrCat("Failed to decompress: ", ZSTD_getErrorName(size)));
+  }
+  buffer.resize(size);
+  return buffer;
+}
+
+void ValueCompressor::TrainDictionary(
+    std::string_view prefix, const std::vector<std::string>& samples) {
+  std::string concatenated_samples;
+  std::vector<size_t> sample_sizes;
+  sample_sizes.reserve(samples.size());
+  for (const std::string& sample : samples) {
+    concatenated_samples.append(sample);
+    sample_sizes.push_back(sample.size());
+  }
+  std::string data(options_.dictionary_size, '\0');
+  const size_t size = ZDICT_trainFromBuffer(
+      data.data(), data.size(), concatenated_samples.data(),
+      sample_sizes.data(), sample_sizes.size());
+  if (ZDICT_isError(size)) {
+    LOG(WARNING) << "Storing the values of prefix " << prefix
+                 << " uncompressed, failed to train a dictionary: "
+                 << ZDICT_getErrorName(size);
+    return;
+  }
+  data.resize(size);
+  const uint32_t id = ZDICT_getDictID(data.data(), data.size());
+  auto dictionary = std::make_shared<const Dictionary>(data, options_.level);
+  if (!dictionary->ok()) {
+    LOG(WARNING) << "Storing the values of prefix " << prefix
+                 << " uncompressed, failed to load its dictionary";
+    return;
+  }
+  absl::MutexLock lock(&mutex_);
+  // Id 0 means that frames do not name their dictionary.
+  if (id == 0 || !dictionaries_.try_emplace(id, dictionary).second) {
+    LOG(WARNING) << "Storing the values of prefix " << prefix
+                 << " uncompressed, its dictionary id " << id
+                 << " is not unique";
+    return;
+  }
+  prefixes_[prefix].dictionary = std::move(dictionary);
+  LOG(INFO) << "Compressing the values of prefix " << prefix << " with a "
+            << size << " byte dictionary trained on " << samples.size()
+            << " values";
+}
+
+}  // namespace kv_server
@@ -0,0 +1,99 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef COMPONENTS_DATA_SERVER_CACHE_VALUE_COMPRESSOR_H_
+#define COMPONENTS_DATA_SERVER_CACHE_VALUE_COMPRESSOR_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/statusor.h"
+#include "absl/synchronization/mutex.h"
+
+namespace kv_server {
+
+// Compresses cache values with zstd, with one dictionary per prefix. The
+// dictionary of a prefix is trained on the first values stored for it, which
+// usually come from the snapshot it is loaded from, and is kept for the
+// lifetime of the compressor. Values stored before the dictionary is trained,
+// and values that do not get smaller, are stored uncompressed.
+//
+// Thread safe.
+class ValueCompressor {
+ public:
+  struct Options {
+    // Maximum size of a trained dictionary.
+    size_t dictionary_size = 64 * 1024;
+    // Total size of the values of a prefix to train its dictionary on.
+    size_t sample_size = 4 * 1024 * 1024;
+    // Zstd compression level.
+    int level = 3;
+  };
+
+  ValueCompressor() : ValueCompressor(Options()) {}
+  explicit ValueCompressor(Options options);
+  ~ValueCompressor();
+
+  ValueCompressor(const ValueCompressor&) = delete;
+  ValueCompressor& operator=(const ValueCompressor&) = delete;
+
+  // Returns the form of `value` to store for `prefix`. Trains the dictionary
+  // of `prefix` once enough of its values were seen.
+  std::string Compress(std::string_view value, std::string_view prefix)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Returns the value that `stored` was returned by `Compress` for. The view
+  // is into `stored`, or into `buffer` if the value was compressed.
+  absl::StatusOr<std::string_view> Decompress(std::string_view stored,
+                                              std::string& buffer) const
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+ private:
+  class Dictionary;
+  struct PrefixState {
+    // Values seen until the dictionary is trained.
+    std::vector<std::string> samples;
+    size_t sample_size = 0;
+    // Set once `samples` were handed to the training.
+    bool sampled = false;
+    std::shared_ptr<const Dictionary> dictionary;
+  };
+
+  // Trains the dictionary of `prefix` on `samples`. Failures are only logged,
+  // the values of `prefix` are then stored uncompressed.
+  void TrainDictionary(std::string_view prefix,
+                       const std::vector<std::string>& samples)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+  const Options options_;
+  mutable absl::Mutex mutex_;
+  absl::flat_hash_map<std::string, PrefixState> prefixes_
+      ABSL_GUARDED_BY(mutex_);
+  // Dictionaries of all prefixes by the id that compressed values refer to.
+  // Never removed, so that lookups can use them after releasing `mutex_`.
+  absl::flat_hash_map<uint32_t, std::shared_ptr<const Dictionary>>
+      dictionaries_ ABSL_GUARDED_BY(mutex_);
+};
+
+}  // namespace kv_server
+
+#endif  // COMPONENTS_DATA_SERVER_CACHE_VALUE_COMPRESSOR_H_
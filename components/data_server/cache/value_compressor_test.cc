@@ -0,0 +1,96 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/data_server/cache/value_compressor.h"
+
+#include <string>
+
+#include "absl/strings/str_cat.h"
+#include "gtest/gtest.h"
+
+namespace kv_server {
+namespace {
+
+constexpr ValueCompressor::Options kOptions = {
+    .dictionary_size = 4 * 1024,
+    .sample_size = 256 * 1024,
+};
+
+std::string JsonValue(int i) {
+  return absl::StrCat(R"({"campaign":{"id":)", i,
+                      R"(,"name":"campaign )", i * 7,
+                      R"(","budget":{"currency":"USD","daily":)", i % 100,
+                      R"(},"targeting":{"countries":["US","CA"],)",
+                      R"("devices":["mobile","desktop"]}}})");
+}
+
+// Compresses values of `prefix` until its dictionary is trained.
+void Train(ValueCompressor& compressor, std::string_view prefix) {
+  for (int i = 0; i * JsonValue(i).size() < 2 * kOptions.sample_size; i++) {
+    compressor.Compress(JsonValue(i), prefix);
+  }
+}
+
+std::string Decompress(const ValueCompressor& compressor,
+                       std::string_view stored) {
+  std::string buffer;
+  absl::StatusOr<std::string_view> value =
+      compressor.Decompress(stored, buffer);
+  EXPECT_TRUE(value.ok()) << value.status();
+  return value.ok() ? std::string(*value) : "";
+}
+
+TEST(ValueCompressorTest, StoresValuesUncompressedUntilTrained) {
+  ValueCompressor compressor(kOptions);
+  const std::string stored = compressor.Compress(JsonValue(1), "prefix");
+  EXPECT_EQ(stored.size(), JsonValue(1).size() + 1);
+  EXPECT_EQ(Decompress(compressor, stored), JsonValue(1));
+}
+
+TEST(ValueCompressorTest, CompressesValuesOnceTrained) {
+  ValueCompressor compressor(kOptions);
+  Train(compressor, "prefix");
+  const std::string value = JsonValue(123456);
+  const std::string stored = compressor.Compress(value, "prefix");
+  EXPECT_LT(stored.size(), value.size() / 2);
+  EXPECT_EQ(Decompress(compressor, stored), value);
+}
+
+TEST(ValueCompressorTest, TrainsOneDictionaryPerPrefix) {
+  ValueCompressor compressor(kOptions);
+  Train(compressor, "a");
+  const std::string value = JsonValue(7);
+  EXPECT_LT(compressor.Compress(value, "a").size(), value.size());
+  EXPECT_EQ(compressor.Compress(value, "b").size(), value.size() + 1);
+}
+
+TEST(ValueCompressorTest, StoresIncompressibleValuesUncompressed) {
+  ValueCompressor compressor(kOptions);
+  Train(compressor, "prefix");
+  const std::string stored = compressor.Compress("x", "prefix");
+  EXPECT_EQ(Decompress(compressor, stored), "x");
+  EXPECT_EQ(Decompress(compressor, ""), "");
+}
+
+TEST(ValueCompressorTest, FailsWithUnknownDictionary) {
+  ValueCompressor compressor(kOptions);
+  Train(compressor, "prefix");
+  const std::string stored = compressor.Compress(JsonValue(1), "prefix");
+  ValueCompressor other_compressor(kOptions);
+  std::string buffer;
+  EXPECT_FALSE(other_compressor.Decompress(stored, buffer).ok());
+}
+
+}  // namespace
+}  // namespace kv_server
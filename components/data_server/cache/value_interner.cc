@@ -0,0 +1,115 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/data_server/cache/value_interner.h"
+
+#include <memory>
+#include <optional>
+#include <string_view>
+
+#include "absl/log/check.h"
+
+namespace kv_server {
+
+uint32_t ValueInterner::Intern(std::string_view value) {
+  absl::MutexLock lock(&mutex_);
+  if (auto it = ids_.find(value); it != ids_.end()) {
+    values_[it->second].references++;
+    return it->second;
+  }
+  const KeyValueArena::Entry entry = arena_.Add(value, /*value=*/"");
+  uint32_t id;
+  if (free_ids_.empty()) {
+    id = values_.size();
+    values_.push_back({.entry = entry, .references = 1});
+  } else {
+    id = free_ids_.back();
+    free_ids_.pop_back();
+    values_[id] = {.entry = entry, .references = 1};
+  }
+  ids_.emplace(entry.key, id);
+  return id;
+}
+
+std::optional<uint32_t> ValueInterner::Find(std::string_view value) const {
+  absl::ReaderMutexLock lock(&mutex_);
+  if (auto it = ids_.find(value); it != ids_.end()) {
+    return it->second;
+  }
+  return std::nullopt;
+}
+
+void ValueInterner::AddReference(uint32_t id) {
+  absl::MutexLock lock(&mutex_);
+  DCHECK_GT(values_[id].references, 0);
+  values_[id].references++;
+}
+
+void ValueInterner::AddReferences(const RoaringBitmap& ids) {
+  absl::MutexLock lock(&mutex_);
+  ids.ForEach([this](uint32_t id) ABSL_NO_THREAD_SAFETY_ANALYSIS {
+    DCHECK_GT(values_[id].references, 0);
+    values_[id].references++;
+  });
+}
+
+void ValueInterner::Release(uint32_t id) {
+  absl::MutexLock lock(&mutex_);
+  ReleaseLocked(id);
+}
+
+void ValueInterner::Release(const RoaringBitmap& ids) {
+  absl::MutexLock lock(&mutex_);
+  ids.ForEach([this](uint32_t id) ABSL_NO_THREAD_SAFETY_ANALYSIS {
+    ReleaseLocked(id);
+  });
+}
+
+void ValueInterner::ReleaseLocked(uint32_t id) {
+  Value& value = values_[id];
+  DCHECK_GT(value.references, 0);
+  if (--value.references > 0) {
+    return;
+  }
+  ids_.erase(value.entry.key);
+  arena_.Remove(value.entry);
+  value.entry = {};
+  free_ids_.push_back(id);
+}
+
+std::string_view ValueInterner::ValueOf(uint32_t id) const {
+  absl::ReaderMutexLock lock(&mutex_);
+  return values_[id].entry.key;
+}
+
+std::shared_ptr<const void> ValueInterner::Pin(uint32_t id) const {
+  absl::ReaderMutexLock lock(&mutex_);
+  return arena_.Pin(values_[id].entry.slab_id);
+}
+
+void ValueInterner::ForEachValue(
+    const RoaringBitmap& ids,
+    absl::FunctionRef<void(std::string_view)> fn) const {
+  absl::ReaderMutexLock lock(&mutex_);
+  ids.ForEach([this, &fn](uint32_t id) ABSL_NO_THREAD_SAFETY_ANALYSIS {
+    fn(values_[id].entry.key);
+  });
+}
+
+size_t ValueInterner::size() const {
+  absl::ReaderMutexLock lock(&mutex_);
+  return ids_.size();
+}
+
+}  // namespace kv_server
@@ -0,0 +1,105 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef COMPONENTS_DATA_SERVER_CACHE_VALUE_INTERNER_H_
+#define COMPONENTS_DATA_SERVER_CACHE_VALUE_INTERNER_H_
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/functional/function_ref.h"
+#include "absl/synchronization/mutex.h"
+#include "components/data_server/cache/key_value_arena.h"
+#include "components/query/roaring_bitmap.h"
+
+namespace kv_server {
+
+// Assigns dense 32 bit ids to set values, so that value sets can be stored and
+// combined as `RoaringBitmap`s, and to the values of deduplicating caches. Ids
+// are reference counted: every use of a value holds a reference, and an id is
+// reused once its last reference is released.
+//
+// Thread safe.
+class ValueInterner {
+ public:
+  ValueInterner() = default;
+  ValueInterner(const ValueInterner&) = delete;
+  ValueInterner& operator=(const ValueInterner&) = delete;
+
+  // Returns the id of `value`, interning it if needed, and adds a reference to
+  // it.
+  uint32_t Intern(std::string_view value) ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Returns the id of `value` if it is interned.
+  std::optional<uint32_t> Find(std::string_view value) const
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Adds a reference to `id`, which must be referenced already.
+  void AddReference(uint32_t id) ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Adds a reference to every id of `ids`, which must be referenced already.
+  void AddReferences(const RoaringBitmap& ids) ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Drops a reference added by `Intern` or `AddReference`. Once the last
+  // reference is dropped, the value is forgotten.
+  void Release(uint32_t id) ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Drops a reference to every id of `ids`, like `Release`.
+  void Release(const RoaringBitmap& ids) ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Returns the value of `id`. The view stays valid for as long as a reference
+  // to `id` is held.
+  std::string_view ValueOf(uint32_t id) const ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Returns an owner that keeps the view returned by `ValueOf(id)` valid after
+  // the references to `id` are released.
+  std::shared_ptr<const void> Pin(uint32_t id) const
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Calls `fn` with the value of every id in `ids`, in ascending id order. The
+  // views stay valid for as long as references to their ids are held.
+  void ForEachValue(const RoaringBitmap& ids,
+                    absl::FunctionRef<void(std::string_view)> fn) const
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Number of interned values.
+  size_t size() const ABSL_LOCKS_EXCLUDED(mutex_);
+
+ private:
+  struct Value {
+    KeyValueArena::Entry entry;
+    uint32_t references;
+  };
+
+  void ReleaseLocked(uint32_t id) ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  mutable absl::Mutex mutex_;
+  KeyValueArena arena_ ABSL_GUARDED_BY(mutex_);
+  // Indexed by id. Ids in `free_ids_` have no references.
+  std::vector<Value> values_ ABSL_GUARDED_BY(mutex_);
+  std::vector<uint32_t> free_ids_ ABSL_GUARDED_BY(mutex_);
+  // Keys are views of the records in `arena_`.
+  absl::flat_hash_map<std::string_view, uint32_t> ids_ ABSL_GUARDED_BY(mutex_);
+};
+
+}  // namespace kv_server
+
+#endif  // COMPONENTS_DATA_SERVER_CACHE_VALUE_INTERNER_H_
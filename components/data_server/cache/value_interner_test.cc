@@ -0,0 +1,102 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/data_server/cache/value_interner.h"
+
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace kv_server {
+namespace {
+
+using testing::ElementsAre;
+using testing::Optional;
+
+std::vector<std::string> Values(const ValueInterner& interner,
+                                const RoaringBitmap& ids) {
+  std::vector<std::string> values;
+  interner.ForEachValue(
+      ids, [&values](std::string_view value) { values.emplace_back(value); });
+  return values;
+}
+
+TEST(ValueInternerTest, InternReturnsSameIdForSameValue) {
+  ValueInterner interner;
+  const uint32_t a = interner.Intern("a");
+  const uint32_t b = interner.Intern("b");
+  EXPECT_NE(a, b);
+  EXPECT_EQ(interner.Intern("a"), a);
+  EXPECT_THAT(interner.Find("a"), Optional(a));
+  EXPECT_EQ(interner.Find("c"), std::nullopt);
+  EXPECT_EQ(interner.size(), 2);
+  EXPECT_THAT(Values(interner, RoaringBitmap::FromIds({a, b})),
+              ElementsAre("a", "b"));
+}
+
+TEST(ValueInternerTest, ReleaseForgetsValueAfterLastReference) {
+  ValueInterner interner;
+  const uint32_t a = interner.Intern("a");
+  interner.Intern("a");
+  interner.Release(a);
+  EXPECT_THAT(interner.Find("a"), Optional(a));
+  interner.Release(a);
+  EXPECT_EQ(interner.Find("a"), std::nullopt);
+  EXPECT_EQ(interner.size(), 0);
+  // The id is reused for the next value.
+  EXPECT_EQ(interner.Intern("b"), a);
+  EXPECT_THAT(Values(interner, RoaringBitmap::FromIds({a})), ElementsAre("b"));
+}
+
+TEST(ValueInternerTest, PinnedValueOutlivesLastReference) {
+  ValueInterner interner;
+  const uint32_t a = interner.Intern("a");
+  interner.AddReference(a);
+  interner.Release(a);
+  EXPECT_EQ(interner.ValueOf(a), "a");
+  const std::string_view value = interner.ValueOf(a);
+  auto pin = interner.Pin(a);
+  interner.Release(a);
+  EXPECT_EQ(interner.size(), 0);
+  EXPECT_EQ(value, "a");
+}
+
+TEST(ValueInternerTest, ConcurrentInternAndRelease) {
+  ValueInterner interner;
+  const uint32_t shared = interner.Intern("shared");
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; t++) {
+    threads.emplace_back([&interner, t]() {
+      for (int i = 0; i < 1000; i++) {
+        const uint32_t id = interner.Intern(absl::StrCat("value", t, "_", i));
+        interner.Intern("shared");
+        interner.Release(id);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(interner.size(), 1);
+  EXPECT_THAT(Values(interner, RoaringBitmap::FromIds({shared})),
+              ElementsAre("shared"));
+}
+
+}  // namespace
+}  // namespace kv_server
@@ -0,0 +1,76 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/data_server/cache/value_set_snapshot.h"
+
+#include <memory>
+#include <string_view>
+#include <utility>
+
+namespace kv_server {
+
+ValueSetSnapshot::ValueSetSnapshot(absl::Span<const std::string_view> values) {
+  size_t storage_size = 0;
+  for (std::string_view value : values) {
+    storage_size += value.size();
+  }
+  // Reserved up front so that the views of the values stay valid.
+  storage_.reserve(storage_size);
+  values_.reserve(values.size());
+  for (std::string_view value : values) {
+    const size_t offset = storage_.size();
+    storage_.append(value);
+    values_.emplace(storage_.data() + offset, value.size());
+  }
+}
+
+ValueSetSnapshot::ValueSetSnapshot(std::string storage,
+                                   absl::Span<const uint32_t> sizes)
+    : storage_(std::move(storage)) {
+  values_.reserve(sizes.size());
+  size_t offset = 0;
+  for (const uint32_t size : sizes) {
+    values_.emplace(storage_.data() + offset, size);
+    offset += size;
+  }
+}
+
+ValueSetSnapshot::ValueSetSnapshot(RoaringBitmap ids,
+                                   std::shared_ptr<ValueInterner> interner)
+    : ids_(std::move(ids)), interner_(std::move(interner)) {
+  interner_->AddReferences(ids_);
+}
+
+ValueSetSnapshot::~ValueSetSnapshot() {
+  if (interner_ != nullptr) {
+    interner_->Release(ids_);
+  }
+}
+
+const absl::flat_hash_set<std::string_view>& ValueSetSnapshot::values() const {
+  if (interner_ != nullptr) {
+    absl::call_once(values_once_, [this]() {
+      values_.reserve(ids_.Cardinality());
+      interner_->ForEachValue(
+          ids_, [this](std::string_view value) { values_.insert(value); });
+    });
+  }
+  return values_;
+}
+
+size_t ValueSetSnapshot::size() const {
+  return interner_ == nullptr ? values_.size() : ids_.Cardinality();
+}
+
+}  // namespace kv_server
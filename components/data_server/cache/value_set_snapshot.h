@@ -0,0 +1,85 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef COMPONENTS_DATA_SERVER_CACHE_VALUE_SET_SNAPSHOT_H_
+#define COMPONENTS_DATA_SERVER_CACHE_VALUE_SET_SNAPSHOT_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "absl/base/call_once.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/types/span.h"
+#include "components/data_server/cache/value_interner.h"
+#include "components/query/roaring_bitmap.h"
+
+namespace kv_server {
+
+// Immutable copy of the values of a key-value set that are not deleted.
+//
+// A cache builds a snapshot of a set the first time it is looked up after an
+// update, and shares it between all the lookups of the set until the next
+// update. Lookup results hold snapshots rather than locks on the sets, so
+// updates never wait for the readers of a set, and readers do not build a
+// copy of the set each.
+//
+// Thread safe.
+class ValueSetSnapshot {
+ public:
+  // Copies `values`, which must be distinct.
+  explicit ValueSetSnapshot(absl::Span<const std::string_view> values);
+
+  // Takes distinct values stored back to back in `storage`, of `sizes`.
+  ValueSetSnapshot(std::string storage, absl::Span<const uint32_t> sizes);
+
+  // Holds a reference to every id of `ids`, values interned by `interner`,
+  // for the lifetime of the snapshot.
+  ValueSetSnapshot(RoaringBitmap ids, std::shared_ptr<ValueInterner> interner);
+
+  ~ValueSetSnapshot();
+
+  ValueSetSnapshot(const ValueSetSnapshot&) = delete;
+  ValueSetSnapshot& operator=(const ValueSetSnapshot&) = delete;
+
+  // Returns the values. If they are interned, they are looked up the first
+  // time this is called.
+  const absl::flat_hash_set<std::string_view>& values() const;
+
+  size_t size() const;
+
+  // Returns the ids of the values, or nullptr if they are not interned.
+  const RoaringBitmap* ids() const {
+    return interner_ == nullptr ? nullptr : &ids_;
+  }
+
+  // Returns the interner of `ids`, or nullptr if the values are not interned.
+  const ValueInterner* interner() const { return interner_.get(); }
+
+ private:
+  // Holds the values that are not interned, back to back.
+  std::string storage_;
+  RoaringBitmap ids_;
+  const std::shared_ptr<ValueInterner> interner_;
+  mutable absl::once_flag values_once_;
+  // Views of `storage_`, or of `interner_` once `values_once_` is done.
+  mutable absl::flat_hash_set<std::string_view> values_;
+};
+
+}  // namespace kv_server
+
+#endif  // COMPONENTS_DATA_SERVER_CACHE_VALUE_SET_SNAPSHOT_H_
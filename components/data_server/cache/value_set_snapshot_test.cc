@@ -0,0 +1,70 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/data_server/cache/value_set_snapshot.h"
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace kv_server {
+namespace {
+
+using testing::UnorderedElementsAre;
+
+TEST(ValueSetSnapshotTest, CopiesValues) {
+  std::string a = "a";
+  std::string b = "b";
+  const std::vector<std::string_view> values = {a, b};
+  ValueSetSnapshot snapshot(values);
+  a[0] = 'x';
+  b[0] = 'x';
+  EXPECT_THAT(snapshot.values(), UnorderedElementsAre("a", "b"));
+  EXPECT_EQ(snapshot.size(), 2);
+  EXPECT_EQ(snapshot.ids(), nullptr);
+  EXPECT_EQ(snapshot.interner(), nullptr);
+}
+
+TEST(ValueSetSnapshotTest, TakesStoredValues) {
+  const std::vector<uint32_t> sizes = {1, 0, 2};
+  ValueSetSnapshot snapshot("abcd", sizes);
+  EXPECT_THAT(snapshot.values(), UnorderedElementsAre("a", "", "bc"));
+  EXPECT_EQ(snapshot.size(), 3);
+  EXPECT_EQ(snapshot.ids(), nullptr);
+}
+
+TEST(ValueSetSnapshotTest, HoldsReferencesToInternedValues) {
+  auto interner = std::make_shared<ValueInterner>();
+  const uint32_t a = interner->Intern("a");
+  const uint32_t b = interner->Intern("b");
+  auto snapshot = std::make_unique<ValueSetSnapshot>(
+      RoaringBitmap::FromIds({a, b}), interner);
+  // The set the snapshot was taken of drops its values.
+  interner->Release(a);
+  interner->Release(b);
+  EXPECT_EQ(interner->size(), 2);
+  EXPECT_EQ(*snapshot->ids(), RoaringBitmap::FromIds({a, b}));
+  EXPECT_EQ(snapshot->interner(), interner.get());
+  EXPECT_EQ(snapshot->size(), 2);
+  EXPECT_THAT(snapshot->values(), UnorderedElementsAre("a", "b"));
+  snapshot.reset();
+  EXPECT_EQ(interner->size(), 0);
+}
+
+}  // namespace
+}  // namespace kv_server
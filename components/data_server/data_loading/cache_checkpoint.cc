@@ -0,0 +1,247 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/data_server/data_loading/cache_checkpoint.h"
+
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "components/data/blob_storage/mapped_file_blob_reader.h"
+#include "components/data_server/cache/checkpoint_io.h"
+
+namespace kv_server {
+namespace {
+
+// Starts every checkpoint file.
+constexpr char kMagic[] = "kv-server-cache-checkpoint";
+// Version of the layout of checkpoints, files of other versions are ignored.
+constexpr int64_t kVersion = 7;
+// Ends every complete checkpoint file.
+constexpr char kEndMarker[] = "end-of-cache-checkpoint";
+// Size of the buffer of checkpoint writes.
+constexpr size_t kWriteBufferSize = 1 << 20;
+
+void WriteMetadata(const CacheCheckpointMetadata& metadata,
+                   CheckpointWriter& writer) {
+  writer.WriteString(metadata.data_bucket);
+  writer.WriteInt64(metadata.shard_num);
+  writer.WriteInt64(metadata.num_shards);
+  writer.WriteInt64(metadata.logical_shards.size());
+  for (const int32_t logical_shard : metadata.logical_shards) {
+    writer.WriteInt64(logical_shard);
+  }
+  writer.WriteInt64(metadata.prefix_last_basenames.size());
+  for (const auto& [prefix, basename] : metadata.prefix_last_basenames) {
+    writer.WriteString(prefix);
+    writer.WriteString(basename);
+  }
+  writer.WriteBool(metadata.udf_config.has_value());
+  if (metadata.udf_config.has_value()) {
+    writer.WriteString(metadata.udf_config->js);
+    writer.WriteString(metadata.udf_config->wasm);
+    writer.WriteString(metadata.udf_config->udf_handler_name);
+    writer.WriteInt64(metadata.udf_config->logical_commit_time);
+    writer.WriteInt64(metadata.udf_config->version);
+    writer.WriteBool(metadata.udf_config->input_format ==
+                     UdfInputFormat::kProto);
+    writer.WriteString(metadata.udf_config->batch_handler_name);
+  }
+  writer.WriteBool(metadata.compression_dictionary != nullptr);
+  if (metadata.compression_dictionary != nullptr) {
+    writer.WriteString(metadata.compression_dictionary->data());
+    writer.WriteInt64(metadata.compression_dictionary->logical_commit_time());
+    writer.WriteInt64(metadata.compression_dictionary->version());
+  }
+}
+
+absl::StatusOr<CacheCheckpointMetadata> ReadMetadata(CheckpointReader& reader) {
+  const absl::Status invalid_metadata_error =
+      absl::DataLossError("Invalid cache checkpoint metadata.");
+  CacheCheckpointMetadata metadata;
+  std::string_view data_bucket;
+  int64_t shard_num;
+  int64_t num_shards;
+  size_t num_logical_shards;
+  if (!reader.ReadString(&data_bucket) || !reader.ReadInt64(&shard_num) ||
+      !reader.ReadInt64(&num_shards) ||
+      !reader.ReadCount(&num_logical_shards)) {
+    return invalid_metadata_error;
+  }
+  metadata.data_bucket = data_bucket;
+  metadata.shard_num = shard_num;
+  metadata.num_shards = num_shards;
+  for (size_t i = 0; i < num_logical_shards; i++) {
+    int64_t logical_shard;
+    if (!reader.ReadInt64(&logical_shard)) {
+      return invalid_metadata_error;
+    }
+    metadata.logical_shards.push_back(logical_shard);
+  }
+  size_t num_prefixes;
+  if (!reader.ReadCount(&num_prefixes)) {
+    return invalid_metadata_error;
+  }
+  for (size_t i = 0; i < num_prefixes; i++) {
+    std::string_view prefix;
+    std::string_view basename;
+    if (!reader.ReadString(&prefix) || !reader.ReadString(&basename)) {
+      return invalid_metadata_error;
+    }
+    metadata.prefix_last_basenames.emplace(prefix, basename);
+  }
+  bool has_udf_config;
+  if (!reader.ReadBool(&has_udf_config)) {
+    return invalid_metadata_error;
+  }
+  if (has_udf_config) {
+    std::string_view js;
+    std::string_view wasm;
+    std::string_view udf_handler_name;
+    bool proto_input;
+    std::string_view batch_handler_name;
+    CodeConfig& udf_config = metadata.udf_config.emplace();
+    if (!reader.ReadString(&js) || !reader.ReadString(&wasm) ||
+        !reader.ReadString(&udf_handler_name) ||
+        !reader.ReadInt64(&udf_config.logical_commit_time) ||
+        !reader.ReadInt64(&udf_config.version) ||
+        !reader.ReadBool(&proto_input) ||
+        !reader.ReadString(&batch_handler_name)) {
+      return invalid_metadata_error;
+    }
+    udf_config.input_format =
+        proto_input ? UdfInputFormat::kProto : UdfInputFormat::kJson;
+    udf_config.js = js;
+    udf_config.wasm = wasm;
+    udf_config.udf_handler_name = udf_handler_name;
+    udf_config.batch_handler_name = batch_handler_name;
+  }
+  bool has_compression_dictionary;
+  if (!reader.ReadBool(&has_compression_dictionary)) {
+    return invalid_metadata_error;
+  }
+  if (has_compression_dictionary) {
+    std::string_view dictionary;
+    int64_t logical_commit_time;
+    int64_t version;
+    if (!reader.ReadString(&dictionary) ||
+        !reader.ReadInt64(&logical_commit_time) ||
+        !reader.ReadInt64(&version)) {
+      return invalid_metadata_error;
+    }
+    auto compression_dictionary = CompressionDictionary::Create(
+        std::string(dictionary), logical_commit_time, version);
+    if (!compression_dictionary.ok()) {
+      return invalid_metadata_error;
+    }
+    metadata.compression_dictionary = *std::move(compression_dictionary);
+  }
+  return metadata;
+}
+
+}  // namespace
+
+absl::Status WriteCacheCheckpoint(const std::string& path,
+                                  const CacheCheckpointMetadata& metadata,
+                                  const Cache& cache) {
+  const std::string temporary_path = absl::StrCat(path, ".tmp");
+  absl::Status status;
+  {
+    std::vector<char> buffer(kWriteBufferSize);
+    std::ofstream file;
+    file.rdbuf()->pubsetbuf(buffer.data(), buffer.size());
+    file.open(temporary_path, std::ios_base::binary | std::ios_base::trunc);
+    CheckpointWriter writer(file);
+    writer.WriteString(kMagic);
+    writer.WriteInt64(kVersion);
+    WriteMetadata(metadata, writer);
+    status = cache.WriteCheckpoint(writer);
+    writer.WriteString(kEndMarker);
+    file.close();
+    if (status.ok()) {
+      status = writer.status();
+    }
+  }
+  std::error_code error_code;
+  if (status.ok()) {
+    std::filesystem::rename(temporary_path, path, error_code);
+    if (!error_code) {
+      return absl::OkStatus();
+    }
+    status = absl::InternalError(absl::StrCat(
+        "Unable to rename cache checkpoint: ", error_code.message()));
+  }
+  std::filesystem::remove(temporary_path, error_code);
+  return status;
+}
+
+CacheCheckpoint::CacheCheckpoint(std::unique_ptr<BlobReader> file,
+                                 CacheCheckpointMetadata metadata,
+                                 std::string_view cache_data)
+    : file_(std::move(file)),
+      metadata_(std::move(metadata)),
+      cache_data_(cache_data) {}
+
+absl::StatusOr<std::unique_ptr<CacheCheckpoint>> CacheCheckpoint::Open(
+    const std::string& path) {
+  absl::StatusOr<std::unique_ptr<MappedFileBlobReader>> file =
+      MappedFileBlobReader::Create(path);
+  if (!file.ok()) {
+    return file.status();
+  }
+  std::string_view contents = *(*file)->Contents();
+  // Checkpoints end with the size of the end marker followed by the marker.
+  constexpr std::string_view kEnd = kEndMarker;
+  constexpr size_t kEndSize = sizeof(int64_t) + kEnd.size();
+  if (contents.size() < kEndSize ||
+      contents.substr(contents.size() - kEnd.size()) != kEnd) {
+    return absl::DataLossError(
+        absl::StrCat("Incomplete cache checkpoint: ", path));
+  }
+  contents.remove_suffix(kEndSize);
+  CheckpointReader reader(contents);
+  std::string_view magic;
+  int64_t version;
+  if (!reader.ReadString(&magic) || magic != kMagic ||
+      !reader.ReadInt64(&version)) {
+    return absl::DataLossError(absl::StrCat("Not a cache checkpoint: ", path));
+  }
+  if (version != kVersion) {
+    return absl::FailedPreconditionError(
+        absl::StrCat("Cache checkpoint ", path, " has version ", version,
+                     " instead of ", kVersion));
+  }
+  absl::StatusOr<CacheCheckpointMetadata> metadata = ReadMetadata(reader);
+  if (!metadata.ok()) {
+    return metadata.status();
+  }
+  const std::string_view cache_data =
+      contents.substr(contents.size() - reader.remaining());
+  return absl::WrapUnique(new CacheCheckpoint(
+      *std::move(file), *std::move(metadata), cache_data));
+}
+
+absl::Status CacheCheckpoint::Restore(Cache& cache) const {
+  CheckpointReader reader(cache_data_);
+  return cache.RestoreCheckpoint(reader);
+}
+
+}  // namespace kv_server
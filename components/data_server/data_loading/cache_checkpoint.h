@@ -0,0 +1,87 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef COMPONENTS_DATA_SERVER_DATA_LOADING_CACHE_CHECKPOINT_H_
+#define COMPONENTS_DATA_SERVER_DATA_LOADING_CACHE_CHECKPOINT_H_
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "components/data/blob_storage/blob_storage_client.h"
+#include "components/data_server/cache/cache.h"
+#include "components/data_server/request_handler/compression_dictionary.h"
+#include "components/udf/code_config.h"
+
+namespace kv_server {
+
+// Describes the data loaded into a checkpointed cache, so that data loading
+// resumes where the checkpoint left off.
+struct CacheCheckpointMetadata {
+  std::string data_bucket;
+  int32_t shard_num = 0;
+  int32_t num_shards = 1;
+  // Logical shards mapped to `shard_num`, empty without logical sharding.
+  std::vector<int32_t> logical_shards;
+  // The last delta file loaded into the cache for every prefix, empty for the
+  // prefixes whose delta files were not loaded.
+  absl::flat_hash_map<std::string, std::string> prefix_last_basenames;
+  // The latest UDF code loaded from the data files, if any.
+  std::optional<CodeConfig> udf_config;
+  // The latest compression dictionary loaded from the data files, if any.
+  std::shared_ptr<const CompressionDictionary> compression_dictionary;
+};
+
+// Writes `metadata` and the contents of `cache` to a checkpoint at `path`.
+// The checkpoint is written to a temporary file first and then renamed, so
+// `path` always holds a complete checkpoint.
+absl::Status WriteCacheCheckpoint(const std::string& path,
+                                  const CacheCheckpointMetadata& metadata,
+                                  const Cache& cache);
+
+// A cache checkpoint, read through a memory mapping of its file.
+class CacheCheckpoint {
+ public:
+  // Returns an error if `path` does not hold a complete checkpoint of this
+  // version of the format.
+  static absl::StatusOr<std::unique_ptr<CacheCheckpoint>> Open(
+      const std::string& path);
+
+  const CacheCheckpointMetadata& metadata() const { return metadata_; }
+
+  // Loads the checkpointed contents into `cache`, see
+  // `Cache::RestoreCheckpoint`.
+  absl::Status Restore(Cache& cache) const;
+
+ private:
+  CacheCheckpoint(std::unique_ptr<BlobReader> file,
+                  CacheCheckpointMetadata metadata,
+                  std::string_view cache_data);
+
+  // Owns the memory of `cache_data_`.
+  const std::unique_ptr<BlobReader> file_;
+  const CacheCheckpointMetadata metadata_;
+  const std::string_view cache_data_;
+};
+
+}  // namespace kv_server
+
+#endif  // COMPONENTS_DATA_SERVER_DATA_LOADING_CACHE_CHECKPOINT_H_
@@ -0,0 +1,144 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/data_server/data_loading/cache_checkpoint.h"
+
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <string_view>
+
+#include "absl/status/status.h"
+#include "components/data_server/cache/mocks.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace kv_server {
+namespace {
+
+using testing::_;
+using testing::ElementsAre;
+using testing::Pair;
+using testing::UnorderedElementsAre;
+
+// Action for `MockCache::WriteCheckpoint` that writes `contents`.
+auto WriteContents(std::string contents) {
+  return [contents = std::move(contents)](CheckpointWriter& writer) {
+    writer.WriteString(contents);
+    return absl::OkStatus();
+  };
+}
+
+class CacheCheckpointTest : public ::testing::Test {
+ protected:
+  CacheCheckpointTest()
+      : path_((std::filesystem::path(::testing::TempDir()) /
+               ::testing::UnitTest::GetInstance()->current_test_info()->name())
+                  .string()) {
+    std::filesystem::remove(path_);
+  }
+
+  const std::string path_;
+  MockCache cache_;
+};
+
+TEST_F(CacheCheckpointTest, OpensWrittenCheckpoint) {
+  EXPECT_CALL(cache_, WriteCheckpoint(_))
+      .WillOnce(WriteContents("cache contents"));
+  const CacheCheckpointMetadata metadata = {
+      .data_bucket = "bucket",
+      .shard_num = 1,
+      .num_shards = 2,
+      .logical_shards = {1, 4},
+      .prefix_last_basenames = {{"", "DELTA_2"}, {"prefix", ""}},
+      .udf_config = CodeConfig{.js = "code",
+                               .udf_handler_name = "handler",
+                               .logical_commit_time = 3,
+                               .version = 4,
+                               .input_format = UdfInputFormat::kProto,
+                               .batch_handler_name = "batch_handler"},
+      .compression_dictionary =
+          *CompressionDictionary::Create("dictionary",
+                                         /*logical_commit_time=*/5,
+                                         /*version=*/6),
+  };
+  ASSERT_TRUE(WriteCacheCheckpoint(path_, metadata, cache_).ok());
+  EXPECT_FALSE(std::filesystem::exists(path_ + ".tmp"));
+
+  absl::StatusOr<std::unique_ptr<CacheCheckpoint>> checkpoint =
+      CacheCheckpoint::Open(path_);
+  ASSERT_TRUE(checkpoint.ok()) << checkpoint.status();
+  const CacheCheckpointMetadata& read_metadata = (*checkpoint)->metadata();
+  EXPECT_EQ(read_metadata.data_bucket, "bucket");
+  EXPECT_EQ(read_metadata.shard_num, 1);
+  EXPECT_EQ(read_metadata.num_shards, 2);
+  EXPECT_THAT(read_metadata.logical_shards, ElementsAre(1, 4));
+  EXPECT_THAT(read_metadata.prefix_last_basenames,
+              UnorderedElementsAre(Pair("", "DELTA_2"), Pair("prefix", "")));
+  ASSERT_TRUE(read_metadata.udf_config.has_value());
+  EXPECT_EQ(*read_metadata.udf_config, *metadata.udf_config);
+  ASSERT_NE(read_metadata.compression_dictionary, nullptr);
+  EXPECT_EQ(read_metadata.compression_dictionary->data(), "dictionary");
+  EXPECT_EQ(read_metadata.compression_dictionary->logical_commit_time(), 5);
+  EXPECT_EQ(read_metadata.compression_dictionary->version(), 6);
+
+  MockCache restored;
+  EXPECT_CALL(restored, RestoreCheckpoint(_))
+      .WillOnce([](CheckpointReader& reader) {
+        std::string_view contents;
+        EXPECT_TRUE(reader.ReadString(&contents));
+        EXPECT_EQ(contents, "cache contents");
+        EXPECT_EQ(reader.remaining(), 0);
+        return absl::OkStatus();
+      });
+  EXPECT_TRUE((*checkpoint)->Restore(restored).ok());
+}
+
+TEST_F(CacheCheckpointTest, OpenFailsForMissingCheckpoint) {
+  EXPECT_FALSE(CacheCheckpoint::Open(path_).ok());
+}
+
+TEST_F(CacheCheckpointTest, OpenFailsForIncompleteCheckpoint) {
+  EXPECT_CALL(cache_, WriteCheckpoint(_)).WillOnce(WriteContents("contents"));
+  ASSERT_TRUE(WriteCacheCheckpoint(path_, {}, cache_).ok());
+  std::filesystem::resize_file(path_, std::filesystem::file_size(path_) - 1);
+  EXPECT_EQ(CacheCheckpoint::Open(path_).status().code(),
+            absl::StatusCode::kDataLoss);
+}
+
+TEST_F(CacheCheckpointTest, OpenFailsForOtherFiles) {
+  std::ofstream(path_) << "end-of-cache-checkpoint";
+  EXPECT_EQ(CacheCheckpoint::Open(path_).status().code(),
+            absl::StatusCode::kDataLoss);
+}
+
+TEST_F(CacheCheckpointTest, FailedWriteKeepsPreviousCheckpoint) {
+  EXPECT_CALL(cache_, WriteCheckpoint(_))
+      .WillOnce(WriteContents("contents"))
+      .WillOnce(testing::Return(absl::UnimplementedError("")));
+  ASSERT_TRUE(
+      WriteCacheCheckpoint(path_, {.data_bucket = "first"}, cache_).ok());
+  EXPECT_FALSE(
+      WriteCacheCheckpoint(path_, {.data_bucket = "second"}, cache_).ok());
+  EXPECT_FALSE(std::filesystem::exists(path_ + ".tmp"));
+  absl::StatusOr<std::unique_ptr<CacheCheckpoint>> checkpoint =
+      CacheCheckpoint::Open(path_);
+  ASSERT_TRUE(checkpoint.ok()) << checkpoint.status();
+  EXPECT_EQ((*checkpoint)->metadata().data_bucket, "first");
+}
+
+}  // namespace
+}  // namespace kv_server
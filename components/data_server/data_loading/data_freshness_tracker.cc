@@ -0,0 +1,63 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/data_server/data_loading/data_freshness_tracker.h"
+
+#include <algorithm>
+
+namespace kv_server {
+
+void DataFreshnessTracker::AddAvailableFile(std::string_view prefix,
+                                            std::string_view basename,
+                                            absl::Time time) {
+  absl::MutexLock lock(&mutex_);
+  prefixes_[prefix].pending_files.try_emplace(basename, time);
+}
+
+void DataFreshnessTracker::MarkListed(std::string_view prefix) {
+  absl::MutexLock lock(&mutex_);
+  PrefixState& state = prefixes_[prefix];
+  state.listed = true;
+  state.caught_up = state.caught_up || state.pending_files.empty();
+}
+
+void DataFreshnessTracker::AddLoadedFile(std::string_view prefix,
+                                         std::string_view basename,
+                                         int64_t logical_commit_time) {
+  absl::MutexLock lock(&mutex_);
+  PrefixState& state = prefixes_[prefix];
+  state.pending_files.erase(basename);
+  state.logical_commit_time =
+      std::max(state.logical_commit_time, logical_commit_time);
+  state.caught_up =
+      state.caught_up || (state.listed && state.pending_files.empty());
+}
+
+absl::flat_hash_map<std::string, DataFreshnessTracker::PrefixFreshness>
+DataFreshnessTracker::Get(absl::Time now) const {
+  absl::flat_hash_map<std::string, PrefixFreshness> result;
+  absl::MutexLock lock(&mutex_);
+  for (const auto& [prefix, state] : prefixes_) {
+    PrefixFreshness& freshness = result[prefix];
+    freshness.caught_up = state.caught_up;
+    freshness.logical_commit_time = state.logical_commit_time;
+    freshness.num_pending_files = state.pending_files.size();
+    for (const auto& [basename, time] : state.pending_files) {
+      freshness.lag = std::max(freshness.lag, now - time);
+    }
+  }
+  return result;
+}
+
+}  // namespace kv_server
@@ -0,0 +1,82 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef COMPONENTS_DATA_SERVER_DATA_LOADING_DATA_FRESHNESS_TRACKER_H_
+#define COMPONENTS_DATA_SERVER_DATA_LOADING_DATA_FRESHNESS_TRACKER_H_
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+
+namespace kv_server {
+
+// Tracks how far the data loaded for every prefix lags behind the data files
+// available for it.
+//
+// Thread safe.
+class DataFreshnessTracker {
+ public:
+  struct PrefixFreshness {
+    // Whether all the files available when the prefix was listed on startup
+    // were loaded, once.
+    bool caught_up = false;
+    // Latest logical commit time of the records loaded.
+    int64_t logical_commit_time = 0;
+    // Number of files available but not loaded yet.
+    int64_t num_pending_files = 0;
+    // Time since the oldest file not loaded yet became available, zero if
+    // there is none.
+    absl::Duration lag = absl::ZeroDuration();
+  };
+
+  // Records that the file `basename` of `prefix` became available at `time`,
+  // to be loaded.
+  void AddAvailableFile(std::string_view prefix, std::string_view basename,
+                        absl::Time time);
+
+  // Records that all the files of `prefix` available on startup were added,
+  // so that the prefix is caught up once they are loaded.
+  void MarkListed(std::string_view prefix);
+
+  // Records that the file `basename` of `prefix` was loaded, with records up
+  // to `logical_commit_time`.
+  void AddLoadedFile(std::string_view prefix, std::string_view basename,
+                     int64_t logical_commit_time);
+
+  // Returns the freshness of every prefix listed or with files, at `now`.
+  absl::flat_hash_map<std::string, PrefixFreshness> Get(absl::Time now) const;
+
+ private:
+  struct PrefixState {
+    bool listed = false;
+    bool caught_up = false;
+    int64_t logical_commit_time = 0;
+    // Times the files not loaded yet became available, by basename.
+    absl::flat_hash_map<std::string, absl::Time> pending_files;
+  };
+
+  mutable absl::Mutex mutex_;
+  absl::flat_hash_map<std::string, PrefixState> prefixes_
+      ABSL_GUARDED_BY(mutex_);
+};
+
+}  // namespace kv_server
+
+#endif  // COMPONENTS_DATA_SERVER_DATA_LOADING_DATA_FRESHNESS_TRACKER_H_
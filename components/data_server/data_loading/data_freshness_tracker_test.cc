@@ -0,0 +1,72 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/data_server/data_loading/data_freshness_tracker.h"
+
+#include "gtest/gtest.h"
+
+namespace kv_server {
+namespace {
+
+const absl::Time kStart = absl::FromUnixSeconds(1000);
+
+TEST(DataFreshnessTrackerTest, CatchesUpOnceListedFilesAreLoaded) {
+  DataFreshnessTracker tracker;
+  tracker.AddAvailableFile("", "DELTA_1", kStart);
+  tracker.AddAvailableFile("", "DELTA_2", kStart);
+  tracker.MarkListed("");
+  tracker.AddLoadedFile("", "DELTA_1", 10);
+  auto freshness = tracker.Get(kStart + absl::Seconds(5));
+  EXPECT_FALSE(freshness[""].caught_up);
+  EXPECT_EQ(freshness[""].num_pending_files, 1);
+  EXPECT_EQ(freshness[""].lag, absl::Seconds(5));
+  EXPECT_EQ(freshness[""].logical_commit_time, 10);
+
+  tracker.AddLoadedFile("", "DELTA_2", 20);
+  freshness = tracker.Get(kStart + absl::Seconds(6));
+  EXPECT_TRUE(freshness[""].caught_up);
+  EXPECT_EQ(freshness[""].num_pending_files, 0);
+  EXPECT_EQ(freshness[""].lag, absl::ZeroDuration());
+  EXPECT_EQ(freshness[""].logical_commit_time, 20);
+}
+
+TEST(DataFreshnessTrackerTest, PrefixWithoutFilesIsCaughtUpOnceListed) {
+  DataFreshnessTracker tracker;
+  EXPECT_TRUE(tracker.Get(kStart).empty());
+  tracker.MarkListed("prefix");
+  EXPECT_TRUE(tracker.Get(kStart)["prefix"].caught_up);
+}
+
+TEST(DataFreshnessTrackerTest, FilesLoadedBeforeListingDoNotCatchUp) {
+  DataFreshnessTracker tracker;
+  tracker.AddAvailableFile("", "SNAPSHOT_1", kStart);
+  tracker.AddLoadedFile("", "SNAPSHOT_1", 10);
+  EXPECT_FALSE(tracker.Get(kStart)[""].caught_up);
+}
+
+TEST(DataFreshnessTrackerTest, LagsBehindOldestPendingFileOnceCaughtUp) {
+  DataFreshnessTracker tracker;
+  tracker.MarkListed("a");
+  tracker.MarkListed("b");
+  tracker.AddAvailableFile("a", "DELTA_3", kStart);
+  tracker.AddAvailableFile("a", "DELTA_4", kStart + absl::Seconds(10));
+  auto freshness = tracker.Get(kStart + absl::Seconds(30));
+  EXPECT_TRUE(freshness["a"].caught_up);
+  EXPECT_EQ(freshness["a"].num_pending_files, 2);
+  EXPECT_EQ(freshness["a"].lag, absl::Seconds(30));
+  EXPECT_EQ(freshness["b"].lag, absl::ZeroDuration());
+}
+
+}  // namespace
+}  // namespace kv_server
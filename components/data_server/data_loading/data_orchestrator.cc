@@ -15,20 +15,42 @@
 #include "components/data_server/data_loading/data_orchestrator.h"
 
 #include <algorithm>
+#include <atomic>
+#include <cstdint>
 #include <deque>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <tuple>
 #include <utility>
 #include <vector>
 
+#include "absl/base/const_init.h"
 #include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
 #include "absl/functional/bind_front.h"
+#include "absl/functional/function_ref.h"
 #include "absl/log/log.h"
 #include "absl/strings/str_cat.h"
+#include "absl/strings/str_join.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+#include "components/data/blob_storage/blob_prefetcher.h"
+#include "components/data/blob_storage/memory_blob_reader.h"
 #include "components/data/file_group/file_group_search_utils.h"
+#include "components/data_server/data_loading/cache_checkpoint.h"
+#include "components/data_server/data_loading/realtime_update_coalescer.h"
 #include "components/errors/retry.h"
+#include "components/udf/code_config.h"
+#include "components/util/lock_profiler.h"
+#include "components/util/thread_pool.h"
 #include "public/constants.h"
 #include "public/data_loading/data_loading_generated.h"
 #include "public/data_loading/filename_utils.h"
 #include "public/data_loading/records_utils.h"
+#include "public/sharding/logical_shard_mapping.h"
 #include "public/sharding/sharding_function.h"
 #include "src/telemetry/tracing.h"
 #include "src/util/status_macro/status_macros.h"
@@ -43,12 +65,39 @@ constexpr std::string_view kDefaultDataSourceForRealtimeUpdates = "realtime";
 
 using privacy_sandbox::server_common::TraceWithStatusOr;
 
+// Serializes the UDF code updates of files that are loaded concurrently.
+ABSL_CONST_INIT absl::Mutex udf_config_mutex(absl::kConstInit);
+
+// The latest UDF code loaded from the data, checkpointed with the cache.
+class LoadedUdfConfig {
+ public:
+  void Update(const CodeConfig& udf_config) {
+    absl::MutexLock lock(&mutex_);
+    if (!udf_config_.has_value() ||
+        udf_config.logical_commit_time >= udf_config_->logical_commit_time) {
+      udf_config_ = udf_config;
+    }
+  }
+
+  std::optional<CodeConfig> Get() const {
+    absl::MutexLock lock(&mutex_);
+    return udf_config_;
+  }
+
+ private:
+  mutable absl::Mutex mutex_;
+  std::optional<CodeConfig> udf_config_ ABSL_GUARDED_BY(mutex_);
+};
+
 // Holds an input stream pointing to a blob of Riegeli records.
 class BlobRecordStream : public RecordStream {
  public:
   explicit BlobRecordStream(std::unique_ptr<BlobReader> blob_reader)
       : blob_reader_(std::move(blob_reader)) {}
   std::istream& Stream() { return blob_reader_->Stream(); }
+  std::optional<std::string_view> Contents() override {
+    return blob_reader_->Contents();
+  }
 
  private:
   std::unique_ptr<BlobReader> blob_reader_;
@@ -76,43 +125,218 @@ void LogDataLoadingMetrics(std::string_view source,
                            data_loading_stats.total_dropped_records)}}));
 }
 
-absl::Status ApplyUpdateMutation(std::string_view prefix,
-                                 const KeyValueMutationRecord& record,
-                                 Cache& cache) {
-  if (record.value_type() == Value::StringValue) {
-    cache.UpdateKeyValue(record.key()->string_view(),
-                         GetRecordValue<std::string_view>(record),
-                         record.logical_commit_time(), prefix);
-    return absl::OkStatus();
+// Time spent in each stage of loading a file, and the amount of data loaded.
+// The stages that run for each batch of records are summed over the threads
+// of the record reader: each thread accumulates the times of a batch locally
+// and adds them once per batch, with relaxed atomics, so the threads never
+// wait on each other to account their batches.
+struct DataLoadingProfile {
+  // Reading the metadata of the file, which starts fetching the blob.
+  std::atomic<int64_t> open_micros = 0;
+  // Waiting for the loading throttle.
+  std::atomic<int64_t> throttle_micros = 0;
+  // Deserializing the records, dropping the records of other shards and
+  // building the cache mutations.
+  std::atomic<int64_t> decode_micros = 0;
+  // Applying the mutations to the cache, or adding them to the coalescer.
+  std::atomic<int64_t> apply_micros = 0;
+  // Reporting the mutated keys.
+  std::atomic<int64_t> notify_micros = 0;
+  // Removing the deleted keys once the file is loaded.
+  std::atomic<int64_t> cleanup_micros = 0;
+  std::atomic<int64_t> num_batches = 0;
+  std::atomic<int64_t> num_records = 0;
+  std::atomic<int64_t> record_bytes = 0;
+};
+
+// Returns the microseconds since `start`, and sets `start` to now, to time
+// consecutive stages.
+int64_t LapMicros(absl::Time& start) {
+  const absl::Time now = absl::Now();
+  const int64_t micros = absl::ToInt64Microseconds(now - start);
+  start = now;
+  return micros;
+}
+
+// Exports the stage times of `profile` as metrics, and logs them with the
+// throughput of the file, as one line of key=value pairs.
+void LogDataLoadingProfile(std::string_view source,
+                           const DataLoadingStats& data_loading_stats,
+                           const DataLoadingProfile& profile,
+                           absl::Duration wall_time) {
+  const int64_t open_micros = profile.open_micros.load();
+  const int64_t throttle_micros = profile.throttle_micros.load();
+  const int64_t decode_micros = profile.decode_micros.load();
+  const int64_t apply_micros = profile.apply_micros.load();
+  const int64_t notify_micros = profile.notify_micros.load();
+  const int64_t cleanup_micros = profile.cleanup_micros.load();
+  const int64_t num_records = profile.num_records.load();
+  const int64_t record_bytes = profile.record_bytes.load();
+  absl::flat_hash_map<std::string, double> stage_micros;
+  stage_micros[kDataLoadingStageOpen] = open_micros;
+  stage_micros[kDataLoadingStageThrottle] = throttle_micros;
+  stage_micros[kDataLoadingStageDecode] = decode_micros;
+  stage_micros[kDataLoadingStageApply] = apply_micros;
+  stage_micros[kDataLoadingStageNotify] = notify_micros;
+  stage_micros[kDataLoadingStageCleanup] = cleanup_micros;
+  LogIfError(KVServerContextMap()
+                 ->SafeMetric()
+                 .LogUpDownCounter<kDataLoadingStageTimeMicros>(
+                     std::move(stage_micros)));
+  LogIfError(KVServerContextMap()
+                 ->SafeMetric()
+                 .LogUpDownCounter<kDataLoadingRecordBytes>(
+                     {{std::string(source),
+                       static_cast<double>(record_bytes)}}));
+  const double wall_seconds =
+      std::max(absl::ToDoubleSeconds(wall_time), 1e-6);
+  LOG(INFO) << "Data loading profile: source=" << source
+            << " wall_ms=" << absl::ToInt64Milliseconds(wall_time)
+            << " batches=" << profile.num_batches.load()
+            << " records=" << num_records << " record_bytes=" << record_bytes
+            << " updated=" << data_loading_stats.total_updated_records
+            << " deleted=" << data_loading_stats.total_deleted_records
+            << " dropped=" << data_loading_stats.total_dropped_records
+            << " records_per_sec=" << static_cast<int64_t>(num_records /
+                                                           wall_seconds)
+            << " mib_per_sec=" << record_bytes / wall_seconds / (1 << 20)
+            << " open_us=" << open_micros << " throttle_us=" << throttle_micros
+            << " decode_us=" << decode_micros << " apply_us=" << apply_micros
+            << " notify_us=" << notify_micros
+            << " cleanup_us=" << cleanup_micros;
+}
+
+// Values of the set mutations of a batch, see `AppendCacheMutation`.
+struct SetValues {
+  std::vector<std::string_view> strings;
+  std::vector<uint32_t> uint32s;
+  // Decimal forms of the values of `UInt64Set` records, which are loaded as
+  // string sets. A deque so that `strings` keeps pointing into it as it grows.
+  std::deque<std::string> decimal_strings;
+};
+
+// Appends the cache mutation of `record` to `mutations`. The values of set
+// mutations are appended to `set_values`, which may still grow, so their
+// `value_set` only holds the number of values until `PointToSetValues`.
+absl::Status AppendCacheMutation(const KeyValueMutationRecord& record,
+                                 std::vector<CacheMutation>& mutations,
+                                 SetValues& set_values) {
+  if (record.mutation_type() != KeyValueMutationType::Update &&
+      record.mutation_type() != KeyValueMutationType::Delete) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("Invalid mutation type: ",
+                     EnumNameKeyValueMutationType(record.mutation_type())));
   }
-  if (record.value_type() == Value::StringSet) {
-    auto values = GetRecordValue<std::vector<std::string_view>>(record);
-    cache.UpdateKeyValueSet(record.key()->string_view(), absl::MakeSpan(values),
-                            record.logical_commit_time(), prefix);
-    return absl::OkStatus();
+  const bool is_update = record.mutation_type() == KeyValueMutationType::Update;
+  CacheMutation mutation;
+  mutation.key = record.key()->string_view();
+  mutation.logical_commit_time = record.logical_commit_time();
+  if (record.value_type() == Value::StringValue) {
+    mutation.type = is_update ? CacheMutation::Type::kUpdateKeyValue
+                              : CacheMutation::Type::kDeleteKey;
+    if (is_update) {
+      mutation.value = GetRecordValue<std::string_view>(record);
+    }
+  } else if (record.value_type() == Value::StringSet) {
+    mutation.type = is_update ? CacheMutation::Type::kUpdateKeyValueSet
+                              : CacheMutation::Type::kDeleteValuesInSet;
+    const auto& values = *record.value_as_StringSet()->value();
+    for (const auto* value : values) {
+      set_values.strings.push_back(value->string_view());
+    }
+    mutation.value_set = absl::Span<std::string_view>(nullptr, values.size());
+  } else if (record.value_type() == Value::UInt32Set) {
+    mutation.type = is_update ? CacheMutation::Type::kUpdateKeyValueUInt32Set
+                              : CacheMutation::Type::kDeleteValuesInUInt32Set;
+    // Copied rather than viewed, the vector of the record may not be aligned.
+    const auto& values = *record.value_as_UInt32Set()->value();
+    set_values.uint32s.insert(set_values.uint32s.end(), values.begin(),
+                              values.end());
+    mutation.uint32_value_set =
+        absl::Span<const uint32_t>(nullptr, values.size());
+  } else if (record.value_type() == Value::UInt64Set) {
+    // The cache only holds 32-bit integers natively.
+    mutation.type = is_update ? CacheMutation::Type::kUpdateKeyValueSet
+                              : CacheMutation::Type::kDeleteValuesInSet;
+    const auto& values = *record.value_as_UInt64Set()->value();
+    for (const uint64_t value : values) {
+      set_values.strings.push_back(
+          set_values.decimal_strings.emplace_back(absl::StrCat(value)));
+    }
+    mutation.value_set = absl::Span<std::string_view>(nullptr, values.size());
+  } else {
+    return absl::InvalidArgumentError(
+        absl::StrCat("Record with key: ", record.key()->string_view(),
+                     " has unsupported value type: ", record.value_type()));
   }
-  return absl::InvalidArgumentError(
-      absl::StrCat("Record with key: ", record.key()->string_view(),
-                   " has unsupported value type: ", record.value_type()));
+  mutations.push_back(mutation);
+  return absl::OkStatus();
 }
 
-absl::Status ApplyDeleteMutation(std::string_view prefix,
-                                 const KeyValueMutationRecord& record,
-                                 Cache& cache) {
-  if (record.value_type() == Value::StringValue) {
-    cache.DeleteKey(record.key()->string_view(), record.logical_commit_time(),
-                    prefix);
-    return absl::OkStatus();
+// Points the `value_set` of the set mutations of `mutations` at their values
+// in `set_values`, once all of them were appended by `AppendCacheMutation`.
+void PointToSetValues(std::vector<CacheMutation>& mutations,
+                      SetValues& set_values) {
+  size_t begin = 0;
+  size_t uint32_begin = 0;
+  for (CacheMutation& mutation : mutations) {
+    if (mutation.type == CacheMutation::Type::kUpdateKeyValueSet ||
+        mutation.type == CacheMutation::Type::kDeleteValuesInSet) {
+      const size_t size = mutation.value_set.size();
+      mutation.value_set =
+          absl::MakeSpan(set_values.strings).subspan(begin, size);
+      begin += size;
+    } else if (mutation.type ==
+                   CacheMutation::Type::kUpdateKeyValueUInt32Set ||
+               mutation.type ==
+                   CacheMutation::Type::kDeleteValuesInUInt32Set) {
+      const size_t size = mutation.uint32_value_set.size();
+      mutation.uint32_value_set =
+          absl::MakeConstSpan(set_values.uint32s).subspan(uint32_begin, size);
+      uint32_begin += size;
+    }
   }
-  if (record.value_type() == Value::StringSet) {
-    auto values = GetRecordValue<std::vector<std::string_view>>(record);
-    cache.DeleteValuesInSet(record.key()->string_view(), absl::MakeSpan(values),
-                            record.logical_commit_time(), prefix);
-    return absl::OkStatus();
+}
+
+// Whether the file with `metadata` may hold records of the server shard. Its
+// shard num is a logical shard if it was sharded into logical shards.
+bool MayHoldRecordsOfServerShard(const KVFileMetadata& metadata,
+                                 const DataOrchestrator::Options& options) {
+  const ShardingMetadata& sharding_metadata = metadata.sharding_metadata();
+  return !sharding_metadata.has_shard_num() ||
+         MayHoldRecordsOfShard(
+             options.key_sharder.logical_shard_mapping().get(),
+             sharding_metadata.num_logical_shards(),
+             sharding_metadata.shard_num(), options.shard_num);
+}
+
+// Returns true if the records of the server shard are read from the file
+// with `metadata` through its shard record ranges, skipping the ranges of the
+// other shards.
+bool ReadsServerShardRecordRanges(const KVFileMetadata& metadata,
+                                  const DataOrchestrator::Options& options) {
+  return options.num_shards > 1 &&
+         metadata.sharding_metadata().has_shard_record_ranges();
+}
+
+// Returns the logical commit time in `basename`, which orders delta and
+// compacted delta files alike.
+std::string_view LogicalCommitTimeOf(std::string_view basename) {
+  return basename.substr(basename.rfind(kFileComponentDelimiter) + 1);
+}
+
+// Returns the logical shards mapped to the server shard, empty without
+// logical sharding.
+std::vector<int32_t> GetServerLogicalShards(
+    const DataOrchestrator::Options& options) {
+  const LogicalShardMapping* mapping =
+      options.key_sharder.logical_shard_mapping().get();
+  if (mapping == nullptr) {
+    return {};
   }
-  return absl::InvalidArgumentError(
-      absl::StrCat("Record with key: ", record.key()->string_view(),
-                   " has unsupported value type: ", record.value_type()));
+  const std::vector<int> logical_shards =
+      mapping->GetLogicalShards(options.shard_num);
+  return std::vector<int32_t>(logical_shards.begin(), logical_shards.end());
 }
 
 bool ShouldProcessRecord(const KeyValueMutationRecord& record,
@@ -122,122 +346,259 @@ bool ShouldProcessRecord(const KeyValueMutationRecord& record,
   if (num_shards <= 1) {
     return true;
   }
-  auto sharding_result =
-      key_sharder.GetShardNumForKey(record.key()->string_view(), num_shards);
-  if (sharding_result.shard_num == server_shard_num) {
+  const std::string_view key = record.key()->string_view();
+  // Every shard loads the replicated keys.
+  if (key_sharder.IsReplicated(key)) {
+    return true;
+  }
+  const int shard_num = key_sharder.GetShardNum(key, num_shards);
+  if (shard_num == server_shard_num) {
     return true;
   }
   data_loading_stats.total_dropped_records++;
+  // The sharding key is only computed again when logged.
   LOG_EVERY_N(ERROR, 100000) << absl::StrFormat(
       "Data does not belong to this shard replica. Key: %s, Sharding key (if "
       "regex matched): %s, Actual "
       "shard id: %d, Server's shard id: %d.",
-      record.key()->string_view(), sharding_result.sharding_key,
-      sharding_result.shard_num, server_shard_num);
+      key, key_sharder.GetShardNumForKey(key, num_shards).sharding_key,
+      shard_num, server_shard_num);
   return false;
 }
 
-absl::Status ApplyKeyValueMutationToCache(
-    std::string_view prefix, const KeyValueMutationRecord& record, Cache& cache,
-    int64_t& max_timestamp, DataLoadingStats& data_loading_stats) {
-  switch (record.mutation_type()) {
-    case KeyValueMutationType::Update: {
-      if (auto status = ApplyUpdateMutation(prefix, record, cache);
-          !status.ok()) {
-        return status;
-      }
-      max_timestamp = std::max(max_timestamp, record.logical_commit_time());
-      data_loading_stats.total_updated_records++;
-      break;
-    }
-    case KeyValueMutationType::Delete: {
-      if (auto status = ApplyDeleteMutation(prefix, record, cache);
-          !status.ok()) {
-        return status;
-      }
-      max_timestamp = std::max(max_timestamp, record.logical_commit_time());
-      data_loading_stats.total_deleted_records++;
-      break;
-    }
-    default:
-      return absl::InvalidArgumentError(
-          absl::StrCat("Invalid mutation type: ",
-                       EnumNameKeyValueMutationType(record.mutation_type())));
-  }
-  return absl::OkStatus();
-}
-
 absl::StatusOr<DataLoadingStats> LoadCacheWithData(
     std::string_view data_source, std::string_view prefix,
     StreamRecordReader& record_reader, Cache& cache, int64_t& max_timestamp,
     const int32_t server_shard_num, const int32_t num_shards,
-    UdfClient& udf_client, const KeySharder& key_sharder) {
-  DataLoadingStats data_loading_stats;
-  const auto process_data_record_fn =
-      [prefix, &cache, &max_timestamp, &data_loading_stats, server_shard_num,
-       num_shards, &udf_client, &key_sharder](const DataRecord& data_record) {
-        if (data_record.record_type() == Record::KeyValueMutationRecord) {
-          const auto* record = data_record.record_as_KeyValueMutationRecord();
-          if (!ShouldProcessRecord(*record, num_shards, server_shard_num,
-                                   key_sharder, data_loading_stats)) {
-            // NOTE: currently upstream logic retries on non-ok status
-            // this will get us in a loop
+    UdfClient& udf_client, LoadedUdfConfig* loaded_udf_config,
+    CompressionDictionaryStore* compression_dictionaries,
+    const KeySharder& key_sharder, bool trusted_records,
+    const std::function<void(absl::Span<const std::string_view>)>&
+        mutated_keys_callback,
+    RealtimeUpdateCoalescer* coalescer = nullptr,
+    LoadingThrottle* throttle = nullptr,
+    DataLoadingProfile* profile = nullptr) {
+  // Batches may be processed concurrently, so each adds its counts to the
+  // totals once, without taking a lock.
+  std::atomic<int64_t> total_updated_records = 0;
+  std::atomic<int64_t> total_deleted_records = 0;
+  std::atomic<int64_t> total_dropped_records = 0;
+  std::atomic<int64_t> total_max_timestamp = max_timestamp;
+  const auto process_batch_fn =
+      [prefix, &cache, &total_updated_records, &total_deleted_records,
+       &total_dropped_records, &total_max_timestamp, server_shard_num,
+       num_shards, &udf_client, loaded_udf_config, compression_dictionaries,
+       &key_sharder, trusted_records, &mutated_keys_callback, coalescer,
+       throttle, profile](absl::Span<const std::string_view> raw_records) {
+        absl::Time stage_start = absl::Now();
+        int64_t throttle_micros = 0;
+        if (throttle != nullptr) {
+          throttle->Acquire(raw_records.size());
+          throttle_micros = LapMicros(stage_start);
+        }
+        DataLoadingStats batch_stats;
+        int64_t batch_max_timestamp = 0;
+        std::vector<CacheMutation> mutations;
+        mutations.reserve(raw_records.size());
+        // Only collected if they are reported.
+        std::vector<std::string_view> mutated_keys;
+        SetValues set_values;
+        const auto process_data_record_fn =
+            [&](const DataRecord& data_record) -> absl::Status {
+          if (data_record.record_type() == Record::KeyValueMutationRecord) {
+            const auto* record = data_record.record_as_KeyValueMutationRecord();
+            if (mutated_keys_callback) {
+              mutated_keys.push_back(record->key()->string_view());
+            }
+            if (!ShouldProcessRecord(*record, num_shards, server_shard_num,
+                                     key_sharder, batch_stats)) {
+              // NOTE: currently upstream logic retries on non-ok status
+              // this will get us in a loop
+              return absl::OkStatus();
+            }
+            PS_RETURN_IF_ERROR(
+                AppendCacheMutation(*record, mutations, set_values));
+            batch_max_timestamp =
+                std::max(batch_max_timestamp, record->logical_commit_time());
+            if (record->mutation_type() == KeyValueMutationType::Update) {
+              batch_stats.total_updated_records++;
+            } else {
+              batch_stats.total_deleted_records++;
+            }
+            return absl::OkStatus();
+          } else if (data_record.record_type() ==
+                     Record::UserDefinedFunctionsConfig) {
+            const auto* udf_config =
+                data_record.record_as_UserDefinedFunctionsConfig();
+            VLOG(3) << "Setting UDF code snippet for version: "
+                    << udf_config->version();
+            const bool proto_input = udf_config->input_format() ==
+                                     UserDefinedFunctionsInputFormat::Protobuf;
+            CodeConfig code_config{
+                .js = udf_config->code_snippet()->str(),
+                .udf_handler_name = udf_config->handler_name()->str(),
+                .logical_commit_time = udf_config->logical_commit_time(),
+                .version = udf_config->version(),
+                .input_format = proto_input ? UdfInputFormat::kProto
+                                            : UdfInputFormat::kJson,
+                .batch_handler_name =
+                    udf_config->batch_handler_name() == nullptr
+                        ? ""
+                        : udf_config->batch_handler_name()->str(),
+                .canary_percent = udf_config->canary_percent()};
+            absl::MutexLock lock(&udf_config_mutex);
+            PS_RETURN_IF_ERROR(udf_client.SetCodeObject(code_config));
+            // Canaries are not checkpointed, servers restored from a
+            // checkpoint run the code object they were canaries of.
+            if (loaded_udf_config != nullptr &&
+                code_config.canary_percent == 0) {
+              loaded_udf_config->Update(code_config);
+            }
+            return absl::OkStatus();
+          } else if (data_record.record_type() ==
+                     Record::CompressionDictionaryConfig) {
+            const auto* dictionary_config =
+                data_record.record_as_CompressionDictionaryConfig();
+            VLOG(3) << "Setting compression dictionary for version: "
+                    << dictionary_config->version();
+            if (compression_dictionaries == nullptr) {
+              return absl::OkStatus();
+            }
+            PS_ASSIGN_OR_RETURN(
+                auto dictionary,
+                CompressionDictionary::Create(
+                    std::string(reinterpret_cast<const char*>(
+                                    dictionary_config->dictionary()->data()),
+                                dictionary_config->dictionary()->size()),
+                    dictionary_config->logical_commit_time(),
+                    dictionary_config->version()));
+            compression_dictionaries->Update(std::move(dictionary));
             return absl::OkStatus();
           }
-          return ApplyKeyValueMutationToCache(
-              prefix, *record, cache, max_timestamp, data_loading_stats);
-        } else if (data_record.record_type() ==
-                   Record::UserDefinedFunctionsConfig) {
-          const auto* udf_config =
-              data_record.record_as_UserDefinedFunctionsConfig();
-          VLOG(3) << "Setting UDF code snippet for version: "
-                  << udf_config->version();
-          return udf_client.SetCodeObject(CodeConfig{
-              .js = udf_config->code_snippet()->str(),
-              .udf_handler_name = udf_config->handler_name()->str(),
-              .logical_commit_time = udf_config->logical_commit_time(),
-              .version = udf_config->version()});
+          return absl::InvalidArgumentError("Received unsupported record.");
+        };
+        absl::Status status;
+        // Converted to a `std::function` once per batch, not per record.
+        const std::function<absl::Status(const DataRecord&)> record_callback =
+            process_data_record_fn;
+        int64_t record_bytes = 0;
+        for (const std::string_view raw : raw_records) {
+          record_bytes += raw.size();
+          status.Update(trusted_records
+                            ? DeserializeTrustedDataRecord(raw, record_callback)
+                            : DeserializeDataRecord(raw, record_callback));
+        }
+        PointToSetValues(mutations, set_values);
+        const int64_t decode_micros = LapMicros(stage_start);
+        if (coalescer != nullptr) {
+          coalescer->Add(mutations, prefix);
+        } else {
+          cache.ApplyBatch(mutations, prefix);
+        }
+        const int64_t apply_micros = LapMicros(stage_start);
+        if (!mutated_keys.empty()) {
+          mutated_keys_callback(mutated_keys);
+        }
+        total_updated_records.fetch_add(batch_stats.total_updated_records,
+                                        std::memory_order_relaxed);
+        total_deleted_records.fetch_add(batch_stats.total_deleted_records,
+                                        std::memory_order_relaxed);
+        total_dropped_records.fetch_add(batch_stats.total_dropped_records,
+                                        std::memory_order_relaxed);
+        int64_t max = total_max_timestamp.load(std::memory_order_relaxed);
+        while (batch_max_timestamp > max &&
+               !total_max_timestamp.compare_exchange_weak(
+                   max, batch_max_timestamp, std::memory_order_relaxed)) {
+        }
+        if (profile != nullptr) {
+          profile->throttle_micros.fetch_add(throttle_micros,
+                                             std::memory_order_relaxed);
+          profile->decode_micros.fetch_add(decode_micros,
+                                           std::memory_order_relaxed);
+          profile->apply_micros.fetch_add(apply_micros,
+                                          std::memory_order_relaxed);
+          profile->notify_micros.fetch_add(LapMicros(stage_start),
+                                           std::memory_order_relaxed);
+          profile->num_batches.fetch_add(1, std::memory_order_relaxed);
+          profile->num_records.fetch_add(raw_records.size(),
+                                         std::memory_order_relaxed);
+          profile->record_bytes.fetch_add(record_bytes,
+                                          std::memory_order_relaxed);
         }
-        return absl::InvalidArgumentError("Received unsupported record.");
+        return status;
       };
-  // TODO(b/314302953): ReadStreamRecords will skip over individual records that
-  // have errors. We should pass the file name to the function so that it will
-  // appear in error logs.
-  PS_RETURN_IF_ERROR(record_reader.ReadStreamRecords(
-      [&process_data_record_fn](std::string_view raw) {
-        return DeserializeDataRecord(raw, process_data_record_fn);
-      }));
+  // TODO(b/314302953): ReadStreamRecordBatches will skip over individual
+  // records that have errors. We should pass the file name to the function so
+  // that it will appear in error logs.
+  const absl::Status status =
+      record_reader.ReadStreamRecordBatches(process_batch_fn);
+  max_timestamp = total_max_timestamp.load();
+  PS_RETURN_IF_ERROR(status);
+  const DataLoadingStats data_loading_stats{
+      .total_updated_records = total_updated_records.load(),
+      .total_deleted_records = total_deleted_records.load(),
+      .total_dropped_records = total_dropped_records.load(),
+  };
   LogDataLoadingMetrics(data_source, data_loading_stats);
   return data_loading_stats;
 }
 
-// Reads the file from `location` and updates the cache based on the delta read.
+// Reads the file from `location` and updates `cache` based on the delta read.
+// Then removes the keys deleted up to the latest record of the file from the
+// cache, unless `max_timestamp` is set, in which case it is set to the time of
+// that record instead, so that the caller can remove them later.
 absl::StatusOr<DataLoadingStats> LoadCacheWithDataFromFile(
     const BlobStorageClient::DataLocation& location,
-    const DataOrchestrator::Options& options) {
+    const DataOrchestrator::Options& options, Cache& cache,
+    LoadedUdfConfig& loaded_udf_config, int64_t* max_timestamp,
+    std::shared_ptr<const std::string> prefetched_contents,
+    LoadingThrottle* throttle) {
   LOG(INFO) << "Loading " << location;
-  int64_t max_timestamp = 0;
-  auto& cache = options.cache;
+  const absl::Time load_start = absl::Now();
+  absl::Time stage_start = load_start;
+  DataLoadingProfile profile;
+  int64_t file_max_timestamp = 0;
   auto record_reader =
       options.delta_stream_reader_factory.CreateConcurrentReader(
-          /*stream_factory=*/[&location, &options]() {
-            return std::make_unique<BlobRecordStream>(
-                options.blob_client.GetBlobReader(location));
+          /*stream_factory=*/[&location, &options, &prefetched_contents]() {
+            std::unique_ptr<BlobReader> blob_reader =
+                prefetched_contents == nullptr
+                    ? options.blob_client.GetBlobReader(location)
+                    : std::make_unique<MemoryBlobReader>(prefetched_contents);
+            return std::make_unique<BlobRecordStream>(std::move(blob_reader));
           });
   PS_ASSIGN_OR_RETURN(auto metadata, record_reader->GetKVFileMetadata(),
                       _ << "Blob " << location);
-  if (metadata.has_sharding_metadata() &&
-      metadata.sharding_metadata().shard_num() != options.shard_num) {
+  profile.open_micros = LapMicros(stage_start);
+  // Files with the records of all shards have no shard num, and the reader
+  // only reads the records of `options.shard_num` from them.
+  if (!MayHoldRecordsOfServerShard(metadata, options)) {
     LOG(INFO) << "Blob " << location << " belongs to shard num "
               << metadata.sharding_metadata().shard_num()
               << " but server shard num is " << options.shard_num
               << " Skipping it.";
+    if (options.freshness_tracker != nullptr) {
+      options.freshness_tracker->AddLoadedFile(location.prefix, location.key,
+                                               /*logical_commit_time=*/0);
+    }
     return DataLoadingStats{
         .total_updated_records = 0,
         .total_deleted_records = 0,
         .total_dropped_records = 0,
     };
   }
+  if (const SnapshotMetadata& snapshot = metadata.snapshot();
+      metadata.has_snapshot() && snapshot.has_num_keys()) {
+    // Files without a shard num hold the keys of all shards.
+    const int64_t num_file_shards =
+        metadata.sharding_metadata().has_shard_num() ? 1 : options.num_shards;
+    LOG(INFO) << "Reserving cache for snapshot " << location << " with "
+              << snapshot.num_keys() << " keys, " << snapshot.num_set_keys()
+              << " set keys and " << snapshot.total_value_bytes()
+              << " bytes of values";
+    cache.Reserve(snapshot.num_keys() / num_file_shards,
+                  snapshot.num_set_keys() / num_file_shards);
+  }
   std::string file_name =
       location.prefix.empty()
           ? location.key
@@ -245,19 +606,41 @@ absl::StatusOr<DataLoadingStats> LoadCacheWithDataFromFile(
   PS_ASSIGN_OR_RETURN(
       auto data_loading_stats,
       LoadCacheWithData(file_name, location.prefix, *record_reader, cache,
-                        max_timestamp, options.shard_num, options.num_shards,
-                        options.udf_client, options.key_sharder),
+                        file_max_timestamp, options.shard_num,
+                        options.num_shards, options.udf_client,
+                        &loaded_udf_config, options.compression_dictionaries,
+                        options.key_sharder, options.trust_data_file_records,
+                        options.mutated_keys_callback, /*coalescer=*/nullptr,
+                        throttle, &profile),
       _ << "Blob: " << location);
-  cache.RemoveDeletedKeys(max_timestamp, location.prefix);
+  if (max_timestamp == nullptr) {
+    stage_start = absl::Now();
+    cache.RemoveDeletedKeys(file_max_timestamp, location.prefix);
+    profile.cleanup_micros = LapMicros(stage_start);
+  } else {
+    *max_timestamp = file_max_timestamp;
+  }
+  LogDataLoadingProfile(file_name, data_loading_stats, profile,
+                        absl::Now() - load_start);
+  if (options.freshness_tracker != nullptr) {
+    options.freshness_tracker->AddLoadedFile(location.prefix, location.key,
+                                             file_max_timestamp);
+  }
   return data_loading_stats;
 }
 
 absl::StatusOr<DataLoadingStats> TraceLoadCacheWithDataFromFile(
     BlobStorageClient::DataLocation location,
-    const DataOrchestrator::Options& options) {
+    const DataOrchestrator::Options& options, Cache& cache,
+    LoadedUdfConfig& loaded_udf_config, int64_t* max_timestamp = nullptr,
+    std::shared_ptr<const std::string> prefetched_contents = nullptr,
+    LoadingThrottle* throttle = nullptr) {
   return TraceWithStatusOr(
-      [location, &options] {
-        return LoadCacheWithDataFromFile(std::move(location), options);
+      [location, &options, &cache, &loaded_udf_config, max_timestamp,
+       prefetched_contents = std::move(prefetched_contents), throttle] {
+        return LoadCacheWithDataFromFile(std::move(location), options, cache,
+                                         loaded_udf_config, max_timestamp,
+                                         prefetched_contents, throttle);
       },
       "LoadCacheWithDataFromFile",
       {{"bucket", std::move(location.bucket)},
@@ -265,15 +648,97 @@ absl::StatusOr<DataLoadingStats> TraceLoadCacheWithDataFromFile(
        {"key", std::move(location.key)}});
 }
 
+// Calls `load_file` for the indices of `num_files` files, with at most
+// `concurrency` calls at a time. Stops starting new calls after the first
+// failure, and returns it.
+absl::Status LoadFilesConcurrently(
+    int num_files, int concurrency,
+    absl::FunctionRef<absl::Status(int file_index)> load_file) {
+  if (num_files == 0) {
+    return absl::OkStatus();
+  }
+  absl::Mutex mutex;
+  absl::Status status;
+  {
+    ThreadPool thread_pool(std::min(concurrency, num_files));
+    for (int i = 0; i < num_files; i++) {
+      thread_pool.Schedule([i, &load_file, &mutex, &status]() {
+        {
+          absl::MutexLock lock(&mutex);
+          if (!status.ok()) {
+            return;
+          }
+        }
+        absl::Status file_status = load_file(i);
+        absl::MutexLock lock(&mutex);
+        status.Update(std::move(file_status));
+      });
+    }
+    // The thread pool waits for the loads when destroyed.
+  }
+  return status;
+}
+
+// Loads `num_files` files into `cache` with `load_file`,
+// `options.num_concurrent_files` at a time. Loading one file at a time,
+// `load_file` is passed a null max timestamp, so it removes the deleted keys
+// of every file once loaded. Otherwise they are removed once all the files are
+// loaded: the cache orders the mutations of a key by their logical commit
+// time, but a deleted key must be kept until the files with older updates of
+// the key are loaded too.
+absl::Status LoadFiles(
+    const DataOrchestrator::Options& options, Cache& cache,
+    const std::vector<BlobStorageClient::DataLocation>& files,
+    absl::FunctionRef<absl::Status(int file_index, int64_t* max_timestamp)>
+        load_file) {
+  if (options.num_concurrent_files <= 1) {
+    for (int i = 0; i < files.size(); i++) {
+      PS_RETURN_IF_ERROR(load_file(i, /*max_timestamp=*/nullptr));
+    }
+    return absl::OkStatus();
+  }
+  std::vector<int64_t> max_timestamps(files.size(), 0);
+  PS_RETURN_IF_ERROR(LoadFilesConcurrently(
+      files.size(), options.num_concurrent_files,
+      [&load_file, &max_timestamps](int file_index) {
+        return load_file(file_index, &max_timestamps[file_index]);
+      }));
+  absl::flat_hash_map<std::string, int64_t> prefix_max_timestamps;
+  for (int i = 0; i < files.size(); i++) {
+    int64_t& prefix_max_timestamp = prefix_max_timestamps[files[i].prefix];
+    prefix_max_timestamp = std::max(prefix_max_timestamp, max_timestamps[i]);
+  }
+  for (const auto& [prefix, max_timestamp] : prefix_max_timestamps) {
+    cache.RemoveDeletedKeys(max_timestamp, prefix);
+  }
+  return absl::OkStatus();
+}
+
 class DataOrchestratorImpl : public DataOrchestrator {
  public:
   // `last_basename` is the last file seen during init. The cache is up to
   // date until this file.
   DataOrchestratorImpl(
       Options options,
-      absl::flat_hash_map<std::string, std::string> prefix_last_basenames)
+      absl::flat_hash_map<std::string, std::string> prefix_last_basenames,
+      std::unique_ptr<LoadedUdfConfig> loaded_udf_config)
       : options_(std::move(options)),
-        prefix_last_basenames_(std::move(prefix_last_basenames)) {}
+        prefix_last_basenames_(std::move(prefix_last_basenames)),
+        loaded_udf_config_(std::move(loaded_udf_config)) {
+    if (options_.realtime_coalescing_window > absl::ZeroDuration()) {
+      realtime_coalescer_ = std::make_unique<RealtimeUpdateCoalescer>(
+          options_.cache, options_.realtime_coalescing_window);
+    }
+    if (options_.delta_prefetch_max_bytes > 0) {
+      delta_prefetcher_ = std::make_unique<BlobPrefetcher>(
+          options_.blob_client, options_.delta_prefetch_max_bytes);
+    }
+    if (options_.swappable_cache != nullptr &&
+        options_.snapshot_reload_interval > absl::ZeroDuration()) {
+      // The first check only records the latest snapshot files.
+      next_snapshot_check_time_ = absl::Now();
+    }
+  }
 
   ~DataOrchestratorImpl() override {
     if (!data_loader_thread_) return;
@@ -290,29 +755,127 @@ class DataOrchestratorImpl : public DataOrchestrator {
     }
     LOG(INFO) << "Delta notifier stopped";
     data_loader_thread_->join();
+    if (cache_release_thread_.joinable()) {
+      cache_release_thread_.join();
+    }
     LOG(INFO) << "Stopped loading new data";
   }
 
   static absl::StatusOr<absl::flat_hash_map<std::string, std::string>> Init(
-      Options& options) {
-    auto ending_delta_files = LoadSnapshotFiles(options);
-    if (!ending_delta_files.ok()) {
-      return ending_delta_files.status();
+      Options& options, LoadedUdfConfig& loaded_udf_config) {
+    const absl::Time start = absl::Now();
+    // A checkpoint of the cache replaces the snapshots of every prefix, the
+    // delta files loaded after it are loaded below.
+    const std::optional<absl::flat_hash_map<std::string, std::string>>
+        checkpoint_last_basenames =
+            RestoreCacheCheckpoint(options, loaded_udf_config);
+    absl::Duration snapshots_duration = absl::Now() - start;
+    absl::Duration deltas_duration = absl::ZeroDuration();
+    int64_t num_delta_files = 0;
+    absl::flat_hash_map<std::string, std::string> ending_delta_files;
+    for (const auto& prefixes : PrefixesByLoadPriority(options)) {
+      const absl::Time prefixes_start = absl::Now();
+      absl::flat_hash_map<std::string, std::string> prefix_ending_delta_files;
+      if (checkpoint_last_basenames.has_value()) {
+        for (const auto& prefix : prefixes) {
+          if (auto iter = checkpoint_last_basenames->find(prefix);
+              iter != checkpoint_last_basenames->end()) {
+            prefix_ending_delta_files.insert(*iter);
+          }
+        }
+      } else {
+        PS_ASSIGN_OR_RETURN(prefix_ending_delta_files,
+                            LoadSnapshotFiles(options, options.cache,
+                                              loaded_udf_config, prefixes));
+      }
+      const absl::Time snapshots_end = absl::Now();
+      snapshots_duration += snapshots_end - prefixes_start;
+      PS_RETURN_IF_ERROR(LoadCompactedDeltaFiles(
+          options, options.cache, loaded_udf_config, prefixes,
+          prefix_ending_delta_files, /*end_at=*/nullptr));
+      PS_ASSIGN_OR_RETURN(std::vector<BlobStorageClient::DataLocation>
+                              delta_files,
+                          ListDeltaFiles(options, prefixes,
+                                         prefix_ending_delta_files,
+                                         /*end_at=*/nullptr));
+      if (options.freshness_tracker != nullptr) {
+        for (const auto& blob : delta_files) {
+          options.freshness_tracker->AddAvailableFile(blob.prefix, blob.key,
+                                                      start);
+        }
+        for (const auto& prefix : prefixes) {
+          options.freshness_tracker->MarkListed(prefix);
+        }
+      }
+      PS_RETURN_IF_ERROR(LoadDeltaFiles(options, options.cache,
+                                        loaded_udf_config, delta_files));
+      deltas_duration += absl::Now() - snapshots_end;
+      num_delta_files += delta_files.size();
+      LOG(INFO) << "Loaded prefixes [" << absl::StrJoin(prefixes, ", ")
+                << "] in " << absl::Now() - prefixes_start;
+      ending_delta_files.insert(prefix_ending_delta_files.begin(),
+                                prefix_ending_delta_files.end());
     }
-    for (const auto& prefix : options.blob_prefix_allowlist.Prefixes()) {
+    LOG(INFO) << "Loaded snapshot files in " << snapshots_duration;
+    LogIfError(KVServerContextMap()
+                   ->SafeMetric()
+                   .LogHistogram<kInitSnapshotFilesLoadingLatency>(
+                       absl::ToDoubleMicroseconds(snapshots_duration)));
+    LOG(INFO) << "Loaded " << num_delta_files << " delta files in "
+              << deltas_duration;
+    LogIfError(KVServerContextMap()
+                   ->SafeMetric()
+                   .LogHistogram<kInitDeltaFilesLoadingLatency>(
+                       absl::ToDoubleMicroseconds(deltas_duration)));
+    return ending_delta_files;
+  }
+
+  // Groups the prefixes to load one group after the other on startup: every
+  // allowlisted prefix of `options.priority_prefixes` on its own, in order,
+  // then all the others.
+  static std::vector<absl::flat_hash_set<std::string>> PrefixesByLoadPriority(
+      const Options& options) {
+    std::vector<absl::flat_hash_set<std::string>> groups;
+    absl::flat_hash_set<std::string> others =
+        options.blob_prefix_allowlist.Prefixes();
+    for (const std::string& prefix : options.priority_prefixes) {
+      if (others.erase(prefix) > 0) {
+        groups.push_back({prefix});
+      }
+    }
+    if (!others.empty()) {
+      groups.push_back(std::move(others));
+    }
+    return groups;
+  }
+
+  // Lists the delta files of every prefix of `prefixes` after its file in
+  // `start_after`, and up to its file in `end_at` if set, and updates
+  // `start_after` to the last files listed.
+  static absl::StatusOr<std::vector<BlobStorageClient::DataLocation>>
+  ListDeltaFiles(
+      const Options& options, const absl::flat_hash_set<std::string>& prefixes,
+      absl::flat_hash_map<std::string, std::string>& start_after,
+      const absl::flat_hash_map<std::string, std::string>* end_at) {
+    std::vector<BlobStorageClient::DataLocation> delta_files;
+    for (const auto& prefix : prefixes) {
       auto location = BlobStorageClient::DataLocation{
           .bucket = options.data_bucket, .prefix = prefix};
-      auto iter = ending_delta_files->find(prefix);
+      auto iter = start_after.find(prefix);
       auto maybe_filenames = options.blob_client.ListBlobs(
-          location,
-          {.prefix = std::string(FilePrefix<FileType::DELTA>()),
-           .start_after =
-               iter != ending_delta_files->end() ? iter->second : ""});
+          location, {.prefix = std::string(FilePrefix<FileType::DELTA>()),
+                     .start_after =
+                         iter != start_after.end() ? iter->second : ""});
       if (!maybe_filenames.ok()) {
         return maybe_filenames.status();
       }
-      LOG(INFO) << "Initializing cache with " << maybe_filenames->size()
-                << " delta files from " << location;
+      std::string end_basename;
+      if (end_at != nullptr) {
+        auto end_iter = end_at->find(prefix);
+        end_basename = end_iter != end_at->end() ? end_iter->second : "";
+      }
+      LOG(INFO) << "Found " << maybe_filenames->size() << " delta files in "
+                << location;
       for (auto&& basename : std::move(*maybe_filenames)) {
         auto blob = BlobStorageClient::DataLocation{
             .bucket = options.data_bucket, .prefix = prefix, .key = basename};
@@ -321,15 +884,137 @@ class DataOrchestratorImpl : public DataOrchestrator {
                        << " not in delta file format. Skipping it.";
           continue;
         }
-        (*ending_delta_files)[prefix] = blob.key;
-        if (const auto s = TraceLoadCacheWithDataFromFile(blob, options);
-            !s.ok()) {
-          return s.status();
+        if (end_at != nullptr && blob.key > end_basename) {
+          continue;
+        }
+        start_after[prefix] = blob.key;
+        delta_files.push_back(std::move(blob));
+      }
+    }
+    return delta_files;
+  }
+
+  // If enabled, loads compacted delta files into `cache` in place of the
+  // delta files of every prefix of `prefixes` after its file in
+  // `start_after`, and up to its file in `end_at` if set, and updates
+  // `start_after` to the last delta file they include. Of the compacted files
+  // starting at the next delta file, the one including the most delta files
+  // is loaded, until none starts there.
+  static absl::Status LoadCompactedDeltaFiles(
+      const Options& options, Cache& cache,
+      LoadedUdfConfig& loaded_udf_config,
+      const absl::flat_hash_set<std::string>& prefixes,
+      absl::flat_hash_map<std::string, std::string>& start_after,
+      const absl::flat_hash_map<std::string, std::string>* end_at) {
+    if (!options.load_compacted_delta_files) {
+      return absl::OkStatus();
+    }
+    for (const auto& prefix : prefixes) {
+      auto location = BlobStorageClient::DataLocation{
+          .bucket = options.data_bucket, .prefix = prefix};
+      PS_ASSIGN_OR_RETURN(
+          std::vector<std::string> compacted_basenames,
+          options.blob_client.ListBlobs(
+              location, {.prefix = std::string(
+                             FilePrefix<FileType::COMPACTED_DELTA>())}));
+      auto iter = start_after.find(prefix);
+      std::string last_basename =
+          iter != start_after.end() ? iter->second : "";
+      std::string end_basename;
+      if (end_at != nullptr) {
+        auto end_iter = end_at->find(prefix);
+        end_basename = end_iter != end_at->end() ? end_iter->second : "";
+      }
+      // Compacted files including delta files after the last loaded one.
+      std::vector<std::pair<BlobStorageClient::DataLocation,
+                            CompactedDeltaMetadata>>
+          candidates;
+      for (auto&& basename : std::move(compacted_basenames)) {
+        if (!IsCompactedDeltaFilename(basename) ||
+            LogicalCommitTimeOf(basename) <=
+                LogicalCommitTimeOf(last_basename)) {
+          continue;
         }
-        LOG(INFO) << "Done loading " << blob;
+        auto blob = BlobStorageClient::DataLocation{
+            .bucket = options.data_bucket, .prefix = prefix, .key = basename};
+        auto record_reader =
+            options.delta_stream_reader_factory.CreateConcurrentReader(
+                /*stream_factory=*/[&blob, &options]() {
+                  return std::make_unique<BlobRecordStream>(
+                      options.blob_client.GetBlobReader(blob));
+                });
+        PS_ASSIGN_OR_RETURN(auto metadata, record_reader->GetKVFileMetadata(),
+                            _ << "Blob " << blob);
+        if (end_at != nullptr &&
+            metadata.compacted_delta().ending_delta_file() > end_basename) {
+          continue;
+        }
+        candidates.emplace_back(std::move(blob),
+                                std::move(*metadata.mutable_compacted_delta()));
+      }
+      if (candidates.empty()) {
+        continue;
+      }
+      PS_ASSIGN_OR_RETURN(
+          std::vector<std::string> delta_basenames,
+          options.blob_client.ListBlobs(
+              location, {.prefix = std::string(FilePrefix<FileType::DELTA>()),
+                         .start_after = last_basename}));
+      auto next_delta = delta_basenames.begin();
+      while (true) {
+        next_delta = std::find_if(next_delta, delta_basenames.end(),
+                                  [&last_basename](const std::string& name) {
+                                    return IsDeltaFilename(name) &&
+                                           name > last_basename;
+                                  });
+        if (next_delta == delta_basenames.end()) {
+          break;
+        }
+        const BlobStorageClient::DataLocation* best_blob = nullptr;
+        const CompactedDeltaMetadata* best_metadata = nullptr;
+        for (const auto& [blob, metadata] : candidates) {
+          if (metadata.starting_delta_file() == *next_delta &&
+              (best_metadata == nullptr ||
+               metadata.ending_delta_file() >
+                   best_metadata->ending_delta_file())) {
+            best_blob = &blob;
+            best_metadata = &metadata;
+          }
+        }
+        if (best_blob == nullptr) {
+          break;
+        }
+        LOG(INFO) << "Loading compacted delta file " << *best_blob
+                  << " in place of delta files "
+                  << best_metadata->starting_delta_file() << " to "
+                  << best_metadata->ending_delta_file();
+        PS_RETURN_IF_ERROR(TraceLoadCacheWithDataFromFile(
+                               *best_blob, options, cache, loaded_udf_config)
+                               .status());
+        last_basename = best_metadata->ending_delta_file();
+        start_after[prefix] = last_basename;
       }
     }
-    return ending_delta_files;
+    return absl::OkStatus();
+  }
+
+  // Loads `delta_files` into `cache`, see `LoadFiles`.
+  static absl::Status LoadDeltaFiles(
+      const Options& options, Cache& cache,
+      LoadedUdfConfig& loaded_udf_config,
+      const std::vector<BlobStorageClient::DataLocation>& delta_files) {
+    return LoadFiles(
+        options, cache, delta_files,
+        [&options, &cache, &loaded_udf_config, &delta_files](
+            int file_index, int64_t* max_timestamp) -> absl::Status {
+          const auto& blob = delta_files[file_index];
+          PS_RETURN_IF_ERROR(TraceLoadCacheWithDataFromFile(
+                                 blob, options, cache, loaded_udf_config,
+                                 max_timestamp)
+                                 .status());
+          LOG(INFO) << "Done loading " << blob;
+          return absl::OkStatus();
+        });
   }
 
   absl::Status Start() override {
@@ -348,6 +1033,9 @@ class DataOrchestratorImpl : public DataOrchestrator {
     }
     data_loader_thread_ = std::make_unique<std::thread>(
         absl::bind_front(&DataOrchestratorImpl::ProcessNewFiles, this));
+    if (realtime_coalescer_ != nullptr) {
+      PS_RETURN_IF_ERROR(realtime_coalescer_->Start());
+    }
 
     return options_.realtime_thread_pool_manager.Start(
         [this, &cache = options_.cache,
@@ -373,16 +1061,36 @@ class DataOrchestratorImpl : public DataOrchestrator {
     LOG(INFO) << "Thread for new file processing started";
     absl::Condition has_new_event(this,
                                   &DataOrchestratorImpl::HasNewEventToProcess);
+    MaybeWriteCacheCheckpoint();
     while (true) {
       std::string basename;
+      absl::Time enqueue_time;
+      std::optional<std::string> next_basename;
       {
-        absl::MutexLock l(&mu_, has_new_event);
+        absl::MutexLock l(&mu_);
+        // Also wakes up for the next check for new snapshot files, if any.
+        mu_.AwaitWithDeadline(has_new_event, next_snapshot_check_time_);
         if (stop_) {
           LOG(INFO) << "Thread for new file processing stopped";
           return;
         }
-        basename = std::move(unprocessed_basenames_.back());
-        unprocessed_basenames_.pop_back();
+        if (!unprocessed_basenames_.empty()) {
+          std::tie(basename, enqueue_time) =
+              std::move(unprocessed_basenames_.back());
+          unprocessed_basenames_.pop_back();
+        }
+        if (!unprocessed_basenames_.empty()) {
+          next_basename = unprocessed_basenames_.back().first;
+        }
+      }
+      if (absl::Now() >= next_snapshot_check_time_) {
+        MaybeReloadSnapshots();
+        next_snapshot_check_time_ =
+            absl::Now() + options_.snapshot_reload_interval;
+        MaybeWriteCacheCheckpoint();
+      }
+      if (basename.empty()) {
+        continue;
       }
       LOG(INFO) << "Loading " << basename;
       auto blob = ParseBlobName(basename);
@@ -395,34 +1103,284 @@ class DataOrchestratorImpl : public DataOrchestrator {
                      << basename;
         continue;
       }
+      // Files queued while the cache was reloaded may be in the snapshot.
+      if (auto iter = prefix_last_basenames_.find(blob.prefix);
+          iter != prefix_last_basenames_.end() && blob.key <= iter->second) {
+        LOG(INFO) << "Skipping " << basename << ", already loaded";
+        if (options_.freshness_tracker != nullptr) {
+          options_.freshness_tracker->AddLoadedFile(
+              blob.prefix, blob.key, /*logical_commit_time=*/0);
+        }
+        continue;
+      }
+      BlobStorageClient::DataLocation location{.bucket = options_.data_bucket,
+                                               .prefix = blob.prefix,
+                                               .key = blob.key};
+      std::shared_ptr<const std::string> prefetched_contents;
+      if (delta_prefetcher_ != nullptr) {
+        prefetched_contents = delta_prefetcher_->Take(location);
+        if (next_basename.has_value()) {
+          MaybePrefetchFile(*next_basename);
+        }
+      }
       RetryUntilOk(
-          [this, &basename, &blob] {
+          [this, &location, &prefetched_contents] {
             // TODO: distinguish status. Some can be retried while others
             // are fatal.
+            // Retries read the file from the blob storage again.
             return TraceLoadCacheWithDataFromFile(
-                {.bucket = options_.data_bucket,
-                 .prefix = blob.prefix,
-                 .key = blob.key},
-                options_);
+                location, options_, options_.cache, *loaded_udf_config_,
+                /*max_timestamp=*/nullptr,
+                std::exchange(prefetched_contents, nullptr),
+                options_.loading_throttle);
           },
           "LoadNewFile", LogStatusSafeMetricsFn<kLoadNewFilesStatus>());
+      LogIfError(KVServerContextMap()
+                     ->SafeMetric()
+                     .LogHistogram<kDeltaFileNotificationToLoadLatency>(
+                         absl::ToDoubleMicroseconds(absl::Now() -
+                                                    enqueue_time)));
+      std::string& last_basename = prefix_last_basenames_[blob.prefix];
+      last_basename = std::max(last_basename, blob.key);
+      MaybeWriteCacheCheckpoint();
+    }
+  }
+
+  // Loads the latest snapshot files, and the delta files loaded since, into a
+  // new cache and swaps it in, if a prefix has newer snapshot files than at
+  // the previous check. Updates keep being applied to the current cache
+  // meanwhile, and new delta files wait.
+  void MaybeReloadSnapshots() {
+    absl::flat_hash_map<std::string, std::string> snapshot_basenames;
+    for (const auto& prefix : options_.blob_prefix_allowlist.Prefixes()) {
+      auto snapshot_group = FindMostRecentFileGroup(
+          BlobStorageClient::DataLocation{.bucket = options_.data_bucket,
+                                          .prefix = prefix},
+          FileGroupFilter{.file_type = FileType::SNAPSHOT,
+                          .status = FileGroup::FileStatus::kComplete},
+          options_.blob_client);
+      if (!snapshot_group.ok()) {
+        LOG(ERROR) << "Failed to find snapshot files: "
+                   << snapshot_group.status();
+        return;
+      }
+      if (snapshot_group->has_value()) {
+        snapshot_basenames[prefix] = (*snapshot_group)->Basename();
+      }
+    }
+    bool has_new_snapshot = false;
+    for (const auto& [prefix, basename] : snapshot_basenames) {
+      auto iter = prefix_snapshot_basenames_.find(prefix);
+      has_new_snapshot = has_new_snapshot ||
+                         iter == prefix_snapshot_basenames_.end() ||
+                         basename > iter->second;
+    }
+    const bool first_check = !checked_snapshots_;
+    checked_snapshots_ = true;
+    if (first_check || !has_new_snapshot) {
+      prefix_snapshot_basenames_ = std::move(snapshot_basenames);
+      return;
+    }
+    LOG(INFO) << "Reloading the cache from new snapshot files";
+    const absl::Time start = absl::Now();
+    std::shared_ptr<Cache> next_cache = options_.create_cache();
+    options_.swappable_cache->StartSwap(next_cache);
+    const absl::flat_hash_set<std::string>& prefixes =
+        options_.blob_prefix_allowlist.Prefixes();
+    auto ending_delta_files = LoadSnapshotFiles(options_, *next_cache,
+                                                *loaded_udf_config_, prefixes);
+    absl::Status status = ending_delta_files.status();
+    if (status.ok()) {
+      status = LoadCompactedDeltaFiles(
+          options_, *next_cache, *loaded_udf_config_, prefixes,
+          *ending_delta_files, &prefix_last_basenames_);
+    }
+    if (status.ok()) {
+      // The cache is up to date until the last delta files loaded, the files
+      // after them are loaded into the swapped in cache.
+      auto delta_files = ListDeltaFiles(options_, prefixes,
+                                        *ending_delta_files,
+                                        &prefix_last_basenames_);
+      status = delta_files.ok()
+                   ? LoadDeltaFiles(options_, *next_cache,
+                                    *loaded_udf_config_, *delta_files)
+                   : delta_files.status();
+    }
+    next_cache.reset();
+    if (!status.ok()) {
+      LOG(ERROR) << "Failed to reload the cache from snapshot files: "
+                 << status;
+      ReleaseInBackground(options_.swappable_cache->AbortSwap());
+      return;
+    }
+    ReleaseInBackground(options_.swappable_cache->FinishSwap());
+    prefix_snapshot_basenames_ = std::move(snapshot_basenames);
+    // Snapshots may include delta files that were not loaded yet.
+    for (const auto& [prefix, basename] : *ending_delta_files) {
+      std::string& last_basename = prefix_last_basenames_[prefix];
+      last_basename = std::max(last_basename, basename);
+    }
+    LOG(INFO) << "Swapped in the cache reloaded from snapshot files in "
+              << absl::Now() - start;
+  }
+
+  // Destroys `cache` on a background thread once the lookups that still
+  // reference it are done, so that neither loading nor a request pays for it.
+  void ReleaseInBackground(std::shared_ptr<Cache> cache) {
+    if (cache_release_thread_.joinable()) {
+      cache_release_thread_.join();
+    }
+    cache_release_thread_ = std::thread([cache = std::move(cache)]() mutable {
+      while (cache.use_count() > 1) {
+        absl::SleepFor(absl::Milliseconds(10));
+      }
+      cache.reset();
+    });
+  }
+
+  // Starts downloading `basename` with `delta_prefetcher_` if it is a delta
+  // file that will be loaded.
+  void MaybePrefetchFile(const std::string& basename) {
+    auto blob = ParseBlobName(basename);
+    if (!IsDeltaFilename(blob.key) ||
+        !options_.blob_prefix_allowlist.Contains(blob.prefix)) {
+      return;
     }
+    delta_prefetcher_->Prefetch({.bucket = options_.data_bucket,
+                                 .prefix = std::move(blob.prefix),
+                                 .key = std::move(blob.key)});
+  }
+
+  // Writes a checkpoint of the cache if `options_.cache_checkpoint_interval`
+  // passed since the last one.
+  void MaybeWriteCacheCheckpoint() {
+    if (options_.cache_checkpoint_path.empty() ||
+        absl::Now() - last_checkpoint_time_ <
+            options_.cache_checkpoint_interval) {
+      return;
+    }
+    CacheCheckpointMetadata metadata{
+        .data_bucket = options_.data_bucket,
+        .shard_num = options_.shard_num,
+        .num_shards = options_.num_shards,
+        .logical_shards = GetServerLogicalShards(options_),
+        .udf_config = loaded_udf_config_->Get(),
+        .compression_dictionary =
+            options_.compression_dictionaries != nullptr
+                ? options_.compression_dictionaries->Get()
+                : nullptr,
+    };
+    for (const auto& prefix : options_.blob_prefix_allowlist.Prefixes()) {
+      auto iter = prefix_last_basenames_.find(prefix);
+      metadata.prefix_last_basenames[prefix] =
+          iter != prefix_last_basenames_.end() ? iter->second : "";
+    }
+    const absl::Time start = absl::Now();
+    if (const absl::Status status = WriteCacheCheckpoint(
+            options_.cache_checkpoint_path, metadata, options_.cache);
+        !status.ok()) {
+      LOG(ERROR) << "Failed to write cache checkpoint to "
+                 << options_.cache_checkpoint_path << ": " << status;
+    } else {
+      LOG(INFO) << "Wrote cache checkpoint to "
+                << options_.cache_checkpoint_path << " in "
+                << absl::Now() - start;
+    }
+    // Failed attempts wait for the next interval too, instead of retrying
+    // after every file.
+    last_checkpoint_time_ = absl::Now();
+  }
+
+  // Restores the cache from the checkpoint at `options.cache_checkpoint_path`
+  // if it was written for the same data and shard. Returns the last delta
+  // file loaded into the checkpoint for every prefix, or nullopt if the cache
+  // was not restored and has to be loaded from the snapshot files.
+  static std::optional<absl::flat_hash_map<std::string, std::string>>
+  RestoreCacheCheckpoint(const Options& options,
+                         LoadedUdfConfig& loaded_udf_config) {
+    if (options.cache_checkpoint_path.empty()) {
+      return std::nullopt;
+    }
+    auto checkpoint = CacheCheckpoint::Open(options.cache_checkpoint_path);
+    if (!checkpoint.ok()) {
+      LOG(INFO) << "Not restoring cache checkpoint: " << checkpoint.status();
+      return std::nullopt;
+    }
+    const CacheCheckpointMetadata& metadata = (*checkpoint)->metadata();
+    bool same_prefixes = metadata.prefix_last_basenames.size() ==
+                         options.blob_prefix_allowlist.Prefixes().size();
+    for (const auto& prefix : options.blob_prefix_allowlist.Prefixes()) {
+      same_prefixes =
+          same_prefixes && metadata.prefix_last_basenames.contains(prefix);
+    }
+    if (metadata.data_bucket != options.data_bucket ||
+        metadata.shard_num != options.shard_num ||
+        metadata.num_shards != options.num_shards ||
+        metadata.logical_shards != GetServerLogicalShards(options) ||
+        !same_prefixes) {
+      LOG(INFO) << "Not restoring cache checkpoint "
+                << options.cache_checkpoint_path
+                << " written for other data or shard";
+      return std::nullopt;
+    }
+    const absl::Time start = absl::Now();
+    if (const absl::Status status = (*checkpoint)->Restore(options.cache);
+        !status.ok()) {
+      LOG(ERROR) << "Failed to restore cache checkpoint "
+                 << options.cache_checkpoint_path << ": " << status;
+      return std::nullopt;
+    }
+    LOG(INFO) << "Restored cache checkpoint " << options.cache_checkpoint_path
+              << " in " << absl::Now() - start;
+    if (metadata.udf_config.has_value()) {
+      if (const absl::Status status =
+              options.udf_client.SetCodeObject(*metadata.udf_config);
+          !status.ok()) {
+        LOG(ERROR) << "Error setting UDF code object from cache checkpoint: "
+                   << status;
+      } else {
+        loaded_udf_config.Update(*metadata.udf_config);
+      }
+    }
+    if (metadata.compression_dictionary != nullptr &&
+        options.compression_dictionaries != nullptr) {
+      options.compression_dictionaries->Update(metadata.compression_dictionary);
+    }
+    absl::flat_hash_map<std::string, std::string> last_basenames;
+    for (const auto& [prefix, basename] : metadata.prefix_last_basenames) {
+      if (!basename.empty()) {
+        last_basenames.emplace(prefix, basename);
+      }
+    }
+    return last_basenames;
   }
 
   // Puts newly found file names into `unprocessed_basenames_`.
   void EnqueueNewFilesToProcess(const std::string& basename) {
-    absl::MutexLock l(&mu_);
-    unprocessed_basenames_.push_front(basename);
+    const absl::Time now = absl::Now();
+    if (options_.freshness_tracker != nullptr) {
+      // Only files that `ProcessNewFiles` loads count as pending.
+      auto blob = ParseBlobName(basename);
+      if (IsDeltaFilename(blob.key) &&
+          options_.blob_prefix_allowlist.Contains(blob.prefix)) {
+        options_.freshness_tracker->AddAvailableFile(blob.prefix, blob.key,
+                                                     now);
+      }
+    }
+    ProfiledMutexLock l(&mu_, LockSite::kDeltaFileQueue);
+    unprocessed_basenames_.emplace_front(basename, now);
     LOG(INFO) << "queued " << basename << " for loading";
     // TODO: block if the queue is too large: consumption is too slow.
   }
 
-  // Loads snapshot files if there are any.
+  // Loads the snapshot files of `prefixes` into `cache` if there are any.
   // Returns the latest delta file to be included in a snapshot.
   static absl::StatusOr<absl::flat_hash_map<std::string, std::string>>
-  LoadSnapshotFiles(const Options& options) {
-    absl::flat_hash_map<std::string, std::string> ending_delta_files;
-    for (const auto& prefix : options.blob_prefix_allowlist.Prefixes()) {
+  LoadSnapshotFiles(const Options& options, Cache& cache,
+                    LoadedUdfConfig& loaded_udf_config,
+                    const absl::flat_hash_set<std::string>& prefixes) {
+    std::vector<BlobStorageClient::DataLocation> snapshot_files;
+    for (const auto& prefix : prefixes) {
       auto location = BlobStorageClient::DataLocation{
           .bucket = options.data_bucket, .prefix = prefix};
       LOG(INFO) << "Initializing cache with snapshot file(s) from: "
@@ -439,69 +1397,203 @@ class DataOrchestratorImpl : public DataOrchestrator {
         continue;
       }
       for (const auto& snapshot : snapshot_group->Filenames()) {
-        auto snapshot_blob = BlobStorageClient::DataLocation{
-            .bucket = options.data_bucket, .prefix = prefix, .key = snapshot};
-        auto record_reader =
-            options.delta_stream_reader_factory.CreateConcurrentReader(
-                /*stream_factory=*/[&snapshot_blob, &options]() {
-                  return std::make_unique<BlobRecordStream>(
-                      options.blob_client.GetBlobReader(snapshot_blob));
-                });
-        PS_ASSIGN_OR_RETURN(auto metadata, record_reader->GetKVFileMetadata());
-        if (metadata.has_sharding_metadata() &&
-            metadata.sharding_metadata().shard_num() != options.shard_num) {
-          LOG(INFO) << "Snapshot " << snapshot_blob << " belongs to shard num "
-                    << metadata.sharding_metadata().shard_num()
-                    << " but server shard num is " << options.shard_num
-                    << ". Skipping it.";
-          continue;
-        }
-        LOG(INFO) << "Loading snapshot file: " << snapshot_blob;
-        PS_ASSIGN_OR_RETURN(
-            auto stats, TraceLoadCacheWithDataFromFile(snapshot_blob, options));
-        if (auto iter = ending_delta_files.find(prefix);
-            iter == ending_delta_files.end() ||
-            metadata.snapshot().ending_delta_file() > iter->second) {
-          ending_delta_files[prefix] = metadata.snapshot().ending_delta_file();
-        }
-        LOG(INFO) << "Done loading snapshot file: " << snapshot_blob;
+        snapshot_files.push_back(BlobStorageClient::DataLocation{
+            .bucket = options.data_bucket, .prefix = prefix, .key = snapshot});
       }
     }
+    // Ending delta files of the snapshots, unset for the snapshots of other
+    // shards.
+    std::vector<std::optional<std::string>> snapshot_ending_delta_files(
+        snapshot_files.size());
+    bool bulk_load = false;
+    if (options.bulk_load_snapshots && !snapshot_files.empty()) {
+      if (absl::Status status = cache.StartBulkLoad(); status.ok()) {
+        bulk_load = true;
+      } else {
+        LOG(INFO) << "Loading snapshot files without a bulk load: " << status;
+      }
+    }
+    absl::Status status = LoadFiles(
+        options, cache, snapshot_files,
+        [&options, &cache, &loaded_udf_config, &snapshot_files,
+         &snapshot_ending_delta_files](int file_index,
+                                       int64_t* max_timestamp) -> absl::Status {
+          PS_ASSIGN_OR_RETURN(
+              auto ending_delta_file,
+              LoadSnapshotFile(snapshot_files[file_index], options, cache,
+                               loaded_udf_config, max_timestamp));
+          snapshot_ending_delta_files[file_index] =
+              std::move(ending_delta_file);
+          return absl::OkStatus();
+        });
+    // Finished even if loading failed, so that the cache does not keep
+    // staging later changes.
+    if (bulk_load) {
+      absl::Status finish_status = cache.FinishBulkLoad();
+      if (status.ok()) {
+        status = std::move(finish_status);
+      }
+    }
+    PS_RETURN_IF_ERROR(status);
+    absl::flat_hash_map<std::string, std::string> ending_delta_files;
+    for (int i = 0; i < snapshot_files.size(); i++) {
+      if (!snapshot_ending_delta_files[i].has_value()) {
+        continue;
+      }
+      const std::string& prefix = snapshot_files[i].prefix;
+      if (auto iter = ending_delta_files.find(prefix);
+          iter == ending_delta_files.end() ||
+          *snapshot_ending_delta_files[i] > iter->second) {
+        ending_delta_files[prefix] = *snapshot_ending_delta_files[i];
+      }
+    }
+    if (options.snapshots_loaded_callback) {
+      options.snapshots_loaded_callback();
+    }
     return ending_delta_files;
   }
 
+  // Loads the snapshot file `snapshot_blob`, see `LoadCacheWithDataFromFile`.
+  // Returns the latest delta file included in the snapshot, or nullopt if the
+  // snapshot belongs to another shard and was skipped.
+  static absl::StatusOr<std::optional<std::string>> LoadSnapshotFile(
+      const BlobStorageClient::DataLocation& snapshot_blob,
+      const Options& options, Cache& cache,
+      LoadedUdfConfig& loaded_udf_config, int64_t* max_timestamp) {
+    // The metadata is streamed before downloading anything, so that the
+    // snapshots of other shards are skipped without reading them.
+    auto record_reader =
+        options.delta_stream_reader_factory.CreateConcurrentReader(
+            /*stream_factory=*/[&snapshot_blob, &options]() {
+              return std::make_unique<BlobRecordStream>(
+                  options.blob_client.GetBlobReader(snapshot_blob));
+            });
+    PS_ASSIGN_OR_RETURN(auto metadata, record_reader->GetKVFileMetadata());
+    if (!MayHoldRecordsOfServerShard(metadata, options)) {
+      LOG(INFO) << "Snapshot " << snapshot_blob << " belongs to shard num "
+                << metadata.sharding_metadata().shard_num()
+                << " but server shard num is " << options.shard_num
+                << ". Skipping it.";
+      return std::nullopt;
+    }
+    // Snapshots with the records of all shards are streamed, as only the
+    // record ranges of the server shard are read from them.
+    std::shared_ptr<const std::string> contents;
+    if (options.download_snapshot_files &&
+        !ReadsServerShardRecordRanges(metadata, options)) {
+      PS_ASSIGN_OR_RETURN(contents,
+                          options.blob_client.DownloadBlob(snapshot_blob));
+    }
+    LOG(INFO) << "Loading snapshot file: " << snapshot_blob;
+    PS_RETURN_IF_ERROR(TraceLoadCacheWithDataFromFile(
+                           snapshot_blob, options, cache, loaded_udf_config,
+                           max_timestamp, std::move(contents))
+                           .status());
+    LOG(INFO) << "Done loading snapshot file: " << snapshot_blob;
+    return metadata.snapshot().ending_delta_file();
+  }
+
   absl::StatusOr<DataLoadingStats> LoadCacheWithHighPriorityUpdates(
       std::string_view data_source, std::string_view prefix,
       StreamRecordReaderFactory& delta_stream_reader_factory,
       const std::string& record_string, Cache& cache) {
-    std::istringstream is(record_string);
     int64_t max_timestamp = 0;
-    auto record_reader = delta_stream_reader_factory.CreateReader(is);
+    // Realtime messages are small and already in memory, so they are read in
+    // place rather than copied through a stream.
+    auto record_reader =
+        delta_stream_reader_factory.CreateInMemoryReader(record_string);
     return LoadCacheWithData(data_source, prefix, *record_reader, cache,
                              max_timestamp, options_.shard_num,
                              options_.num_shards, options_.udf_client,
-                             options_.key_sharder);
+                             loaded_udf_config_.get(),
+                             options_.compression_dictionaries,
+                             options_.key_sharder, /*trusted_records=*/false,
+                             options_.mutated_keys_callback,
+                             realtime_coalescer_.get());
   }
 
   const Options options_;
   absl::Mutex mu_;
-  std::deque<std::string> unprocessed_basenames_ ABSL_GUARDED_BY(mu_);
+  // Names of the files to load, with the time they were reported.
+  std::deque<std::pair<std::string, absl::Time>> unprocessed_basenames_
+      ABSL_GUARDED_BY(mu_);
   std::unique_ptr<std::thread> data_loader_thread_;
   bool stop_ ABSL_GUARDED_BY(mu_) = false;
   // last basename of file in initialization.
   absl::flat_hash_map<std::string, std::string> prefix_last_basenames_;
+  const std::unique_ptr<LoadedUdfConfig> loaded_udf_config_;
+  // Only accessed by the data loader thread.
+  absl::Time last_checkpoint_time_ = absl::InfinitePast();
+  // Set if realtime updates are coalesced before they are applied.
+  std::unique_ptr<RealtimeUpdateCoalescer> realtime_coalescer_;
+  // Downloads the next queued delta file while one is loaded, if enabled.
+  std::unique_ptr<BlobPrefetcher> delta_prefetcher_;
+  // Only accessed by the data loader thread. Infinite future if the cache is
+  // not reloaded from new snapshot files.
+  absl::Time next_snapshot_check_time_ = absl::InfiniteFuture();
+  bool checked_snapshots_ = false;
+  // Basename of the latest snapshot files of every prefix at the last check.
+  absl::flat_hash_map<std::string, std::string> prefix_snapshot_basenames_;
+  // Destroys the last cache swapped out.
+  std::thread cache_release_thread_;
 };
 
 }  // namespace
 
 absl::StatusOr<std::unique_ptr<DataOrchestrator>> DataOrchestrator::TryCreate(
     Options options) {
-  const auto prefix_last_basenames = DataOrchestratorImpl::Init(options);
+  auto loaded_udf_config = std::make_unique<LoadedUdfConfig>();
+  auto prefix_last_basenames =
+      DataOrchestratorImpl::Init(options, *loaded_udf_config);
   if (!prefix_last_basenames.ok()) {
     return prefix_last_basenames.status();
   }
   auto orchestrator = std::make_unique<DataOrchestratorImpl>(
-      std::move(options), std::move(prefix_last_basenames.value()));
+      std::move(options), std::move(prefix_last_basenames.value()),
+      std::move(loaded_udf_config));
   return orchestrator;
 }
+
+absl::StatusOr<absl::flat_hash_map<int32_t, int32_t>>
+DataOrchestrator::ReadLogicalShardMapping(
+    BlobStorageClient& blob_client, StreamRecordReaderFactory& reader_factory,
+    std::string_view data_bucket) {
+  const BlobStorageClient::DataLocation location{
+      .bucket = std::string(data_bucket)};
+  PS_ASSIGN_OR_RETURN(
+      std::vector<std::string> basenames,
+      blob_client.ListBlobs(
+          location,
+          {.prefix =
+               std::string(FilePrefix<FileType::LOGICAL_SHARDING_CONFIG>())}));
+  // Names sort by logical commit time, the last config file is the latest.
+  auto latest = std::find_if(
+      basenames.rbegin(), basenames.rend(), [](const std::string& basename) {
+        return IsLogicalShardingConfigFilename(basename);
+      });
+  absl::flat_hash_map<int32_t, int32_t> physical_shards;
+  if (latest == basenames.rend()) {
+    return physical_shards;
+  }
+  const BlobStorageClient::DataLocation blob{.bucket = location.bucket,
+                                             .key = *latest};
+  LOG(INFO) << "Reading logical shard mapping from " << blob;
+  std::unique_ptr<BlobReader> blob_reader = blob_client.GetBlobReader(blob);
+  auto record_reader = reader_factory.CreateReader(blob_reader->Stream());
+  PS_RETURN_IF_ERROR(record_reader->ReadStreamRecords(
+      [&physical_shards](std::string_view raw) {
+        return DeserializeDataRecord(
+            raw, [&physical_shards](const DataRecord& data_record) {
+              if (data_record.record_type() != Record::ShardMappingRecord) {
+                return absl::OkStatus();
+              }
+              const auto* mapping =
+                  data_record.record_as_ShardMappingRecord();
+              physical_shards[mapping->logical_shard()] =
+                  mapping->physical_shard();
+              return absl::OkStatus();
+            });
+      }));
+  return physical_shards;
+}
 }  // namespace kv_server
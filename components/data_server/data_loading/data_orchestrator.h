@@ -15,13 +15,19 @@
 #ifndef COMPONENTS_DATA_SERVER_DATA_LOADING_DATA_ORCHESTRATOR_H_
 #define COMPONENTS_DATA_SERVER_DATA_LOADING_DATA_ORCHESTRATOR_H_
 
+#include <functional>
 #include <memory>
 #include <string>
+#include <string_view>
 #include <thread>
 #include <vector>
 
+#include "absl/container/flat_hash_map.h"
 #include "absl/functional/any_invocable.h"
 #include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
 #include "components/data/blob_storage/blob_prefix_allowlist.h"
 #include "components/data/blob_storage/blob_storage_change_notifier.h"
 #include "components/data/blob_storage/blob_storage_client.h"
@@ -29,6 +35,10 @@
 #include "components/data/realtime/realtime_notifier.h"
 #include "components/data/realtime/realtime_thread_pool_manager.h"
 #include "components/data_server/cache/cache.h"
+#include "components/data_server/cache/swappable_cache.h"
+#include "components/data_server/data_loading/data_freshness_tracker.h"
+#include "components/data_server/data_loading/loading_throttle.h"
+#include "components/data_server/request_handler/compression_dictionary.h"
 #include "components/udf/udf_client.h"
 #include "public/data_loading/readers/riegeli_stream_io.h"
 #include "public/data_loading/readers/stream_record_reader_factory.h"
@@ -58,13 +68,93 @@ class DataOrchestrator {
     const int32_t num_shards = 1;
     const KeySharder key_sharder;
     BlobPrefixAllowlist blob_prefix_allowlist;
+    // Number of snapshot or delta files loaded at the same time while
+    // initializing the cache, across all prefixes. Snapshots are all loaded
+    // before deltas.
+    int32_t num_concurrent_files = 1;
+    // Prefixes loaded first while initializing the cache, in order. Every one
+    // of them is loaded on its own, from its snapshot to its last delta file
+    // with all `num_concurrent_files`, so that it is caught up in
+    // `freshness_tracker` while the next ones load. The other prefixes are
+    // loaded together after them. Only the snapshots loaded first are bulk
+    // loaded, as bulk loads need an empty cache.
+    std::vector<std::string> priority_prefixes;
+    // If set, the cache is restored on startup from the checkpoint at this
+    // path if it was written for the same bucket, shard and prefixes, and
+    // only the delta files after the checkpointed ones are loaded. Assumes
+    // those delta files are still in the bucket. The cache is checkpointed
+    // once initialized and then at most every `cache_checkpoint_interval`
+    // while loading new files.
+    std::string cache_checkpoint_path;
+    absl::Duration cache_checkpoint_interval = absl::Minutes(10);
+    // If positive, realtime updates received within this window are
+    // coalesced and applied to the cache together, see
+    // `RealtimeUpdateCoalescer`.
+    absl::Duration realtime_coalescing_window = absl::ZeroDuration();
+    // If positive, the next queued delta file is downloaded into memory while
+    // the current one is loaded, unless it is larger than this, see
+    // `BlobPrefetcher`.
+    int64_t delta_prefetch_max_bytes = 0;
+    // If set, compression dictionary records are loaded into it. They are
+    // ignored otherwise.
+    CompressionDictionaryStore* compression_dictionaries = nullptr;
+    // If true, the records of snapshot and delta files are decoded without
+    // verifying their flatbuffers first, see `DeserializeTrustedDataRecord`.
+    // Riegeli still checks the hashes of the chunks of the files.
+    bool trust_data_file_records = false;
+    // If set, called with the keys of every batch of mutation records once
+    // the batch was handed to the cache, including the keys of other shards.
+    std::function<void(absl::Span<const std::string_view> keys)>
+        mutated_keys_callback;
+    // If set, limits the rate at which the records of the files loaded after
+    // `Start` are loaded, so that loading new files leaves CPU to serving.
+    // The initial load and realtime updates are not throttled.
+    LoadingThrottle* loading_throttle = nullptr;
+    // If set, along with a positive `snapshot_reload_interval`, every
+    // interval the orchestrator checks for snapshot files newer than at the
+    // previous check. When a prefix has some, it loads the latest snapshot
+    // files of every prefix and the delta files loaded since into a new
+    // cache from `create_cache`, while the current one keeps serving, and
+    // swaps it in. The swapped out cache is destroyed in the background.
+    // `swappable_cache` must be `cache`. Memory has to fit both caches.
+    SwappableCache* swappable_cache = nullptr;
+    std::function<std::unique_ptr<Cache>()> create_cache;
+    absl::Duration snapshot_reload_interval = absl::ZeroDuration();
+    // If set, records the delta files listed on startup and notified after,
+    // and the files loaded, to track how fresh the data of every prefix is.
+    DataFreshnessTracker* freshness_tracker = nullptr;
+    // If true, compacted delta files written by `data_cli compact_deltas` are
+    // loaded in place of the delta files they include, when they start right
+    // after the last snapshot or compacted delta file loaded.
+    bool load_compacted_delta_files = false;
+    // If true, snapshot files are downloaded into memory with parallel range
+    // reads before they are loaded, rather than streamed. Memory has to fit
+    // the snapshot files loaded concurrently. Snapshots of other shards, and
+    // snapshots of all shards read by shard record ranges, are not downloaded.
+    bool download_snapshot_files = false;
+    // If true, snapshot files loaded into an empty cache are staged and the
+    // cache is built from them at once, see `Cache::StartBulkLoad`, rather
+    // than applying their records one by one. Memory has to fit a copy of
+    // the staged records on top of the cache while it is built.
+    bool bulk_load_snapshots = false;
+    // If set, called once the snapshot files are loaded on startup and on
+    // every reload, e.g. to release the memory freed by loading them.
+    std::function<void()> snapshots_loaded_callback;
   };
 
   // Creates initial state. Scans the bucket and initializes the cache with data
-  // read from the files in the bucket.
+  // read from the files in the bucket, `num_concurrent_files` at a time.
   static absl::StatusOr<std::unique_ptr<DataOrchestrator>> TryCreate(
       Options options);
 
+  // Reads the `ShardMappingRecord`s of the latest logical sharding config
+  // file in `data_bucket` as a map from logical to physical shard. The map is
+  // empty if there is no such file.
+  static absl::StatusOr<absl::flat_hash_map<int32_t, int32_t>>
+  ReadLogicalShardMapping(BlobStorageClient& blob_client,
+                          StreamRecordReaderFactory& reader_factory,
+                          std::string_view data_bucket);
+
   // Starts a separate thread to monitor and load new data until the returned
   // this object is destructed.
   // Returns immediately without blocking.
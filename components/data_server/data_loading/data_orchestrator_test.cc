@@ -14,22 +14,35 @@
 
 #include "components/data_server/data_loading/data_orchestrator.h"
 
+#include <atomic>
+#include <sstream>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
+#include "absl/container/flat_hash_map.h"
 #include "absl/log/log.h"
+#include "absl/log/scoped_mock_log.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_split.h"
+#include "absl/synchronization/mutex.h"
 #include "absl/synchronization/notification.h"
 #include "components/data/common/mocks.h"
 #include "components/data/realtime/realtime_notifier.h"
 #include "components/data_server/cache/cache.h"
+#include "components/data_server/cache/key_value_cache.h"
 #include "components/data_server/cache/mocks.h"
+#include "components/data_server/cache/swappable_cache.h"
+#include "components/data_server/data_loading/data_freshness_tracker.h"
 #include "components/udf/code_config.h"
 #include "components/udf/mocks.h"
 #include "gmock/gmock.h"
 #include "google/protobuf/text_format.h"
 #include "gtest/gtest.h"
 #include "public/constants.h"
+#include "public/data_loading/data_loading_generated.h"
 #include "public/data_loading/filename_utils.h"
 #include "public/data_loading/records_utils.h"
 #include "public/sharding/key_sharder.h"
@@ -41,11 +54,14 @@ using kv_server::BlobPrefixAllowlist;
 using kv_server::BlobStorageChangeNotifier;
 using kv_server::BlobStorageClient;
 using kv_server::CodeConfig;
+using kv_server::CompressionDictionaryStore;
+using kv_server::DataFreshnessTracker;
 using kv_server::DataOrchestrator;
 using kv_server::DataRecordStruct;
 using kv_server::FilePrefix;
 using kv_server::FileType;
 using kv_server::KeyValueMutationRecordStruct;
+using kv_server::KeyValueCache;
 using kv_server::KeyValueMutationType;
 using kv_server::KVFileMetadata;
 using kv_server::MockBlobReader;
@@ -59,6 +75,8 @@ using kv_server::MockStreamRecordReader;
 using kv_server::MockStreamRecordReaderFactory;
 using kv_server::MockUdfClient;
 using kv_server::Record;
+using kv_server::SwappableCache;
+using kv_server::ToCompactedDeltaFileName;
 using kv_server::ToDeltaFileName;
 using kv_server::ToFlatBufferBuilder;
 using kv_server::ToSnapshotFileName;
@@ -70,9 +88,12 @@ using testing::_;
 using testing::AllOf;
 using testing::ByMove;
 using testing::Field;
+using testing::HasSubstr;
+using testing::InvokeWithoutArgs;
 using testing::Pair;
 using testing::Return;
 using testing::ReturnRef;
+using testing::SaveArg;
 using testing::UnorderedElementsAre;
 
 namespace {
@@ -85,6 +106,20 @@ BlobStorageClient::DataLocation GetTestLocation(
                                          .key = basename};
 }
 
+// Returns the integer fields of a "Data loading profile" log line.
+absl::flat_hash_map<std::string, int64_t> ParseDataLoadingProfile(
+    std::string_view log_line) {
+  absl::flat_hash_map<std::string, int64_t> fields;
+  for (std::string_view field : absl::StrSplit(log_line, ' ')) {
+    std::pair<std::string_view, std::string_view> key_value =
+        absl::StrSplit(field, absl::MaxSplits('=', 1));
+    if (int64_t value; absl::SimpleAtoi(key_value.second, &value)) {
+      fields[key_value.first] = value;
+    }
+  }
+  return fields;
+}
+
 class DataOrchestratorTest : public ::testing::Test {
  protected:
   void SetUp() override {
@@ -237,6 +272,108 @@ TEST_F(DataOrchestratorTest, InitCacheFiltersDeltasUsingSnapshotEndingFile) {
   EXPECT_TRUE(DataOrchestrator::TryCreate(options_).ok());
 }
 
+TEST_F(DataOrchestratorTest, InitCacheLoadsCompactedDeltaFiles) {
+  options_.load_compacted_delta_files = true;
+  EXPECT_CALL(
+      blob_client_,
+      ListBlobs(GetTestLocation(),
+                Field(&BlobStorageClient::ListOptions::prefix,
+                      FilePrefix<FileType::SNAPSHOT>())))
+      .WillOnce(Return(std::vector<std::string>()));
+  const std::string compacted_name = ToCompactedDeltaFileName(3).value();
+  EXPECT_CALL(
+      blob_client_,
+      ListBlobs(GetTestLocation(),
+                Field(&BlobStorageClient::ListOptions::prefix,
+                      FilePrefix<FileType::COMPACTED_DELTA>())))
+      .WillOnce(Return(std::vector<std::string>({compacted_name})));
+  EXPECT_CALL(
+      blob_client_,
+      ListBlobs(GetTestLocation(),
+                AllOf(Field(&BlobStorageClient::ListOptions::start_after, ""),
+                      Field(&BlobStorageClient::ListOptions::prefix,
+                            FilePrefix<FileType::DELTA>()))))
+      .WillOnce(Return(std::vector<std::string>(
+          {ToDeltaFileName(1).value(), ToDeltaFileName(2).value(),
+           ToDeltaFileName(3).value()})));
+  // The delta files included in the compacted file are not loaded.
+  EXPECT_CALL(
+      blob_client_,
+      ListBlobs(GetTestLocation(),
+                AllOf(Field(&BlobStorageClient::ListOptions::start_after,
+                            ToDeltaFileName(3).value()),
+                      Field(&BlobStorageClient::ListOptions::prefix,
+                            FilePrefix<FileType::DELTA>()))))
+      .WillOnce(Return(std::vector<std::string>()));
+
+  KVFileMetadata metadata;
+  metadata.mutable_compacted_delta()->set_starting_delta_file(
+      ToDeltaFileName(1).value());
+  metadata.mutable_compacted_delta()->set_ending_delta_file(
+      ToDeltaFileName(3).value());
+  auto metadata_reader = std::make_unique<MockStreamRecordReader>();
+  EXPECT_CALL(*metadata_reader, GetKVFileMetadata).WillOnce(Return(metadata));
+  auto compacted_reader = std::make_unique<MockStreamRecordReader>();
+  EXPECT_CALL(*compacted_reader, GetKVFileMetadata).WillOnce(Return(metadata));
+  EXPECT_CALL(*compacted_reader, ReadStreamRecords)
+      .WillOnce(
+          [](const std::function<absl::Status(std::string_view)>& callback) {
+            callback(ToStringView(ToFlatBufferBuilder(
+                         DataRecordStruct{.record =
+                                              KeyValueMutationRecordStruct{
+                                                  KeyValueMutationType::Delete,
+                                                  3, "bar", ""}})))
+                .IgnoreError();
+            return absl::OkStatus();
+          });
+  EXPECT_CALL(delta_stream_reader_factory_, CreateConcurrentReader)
+      .WillOnce(Return(ByMove(std::move(metadata_reader))))
+      .WillOnce(Return(ByMove(std::move(compacted_reader))));
+  EXPECT_CALL(cache_, DeleteKey("bar", 3, _)).Times(1);
+  EXPECT_CALL(cache_, RemoveDeletedKeys(3, _)).Times(1);
+
+  auto maybe_orchestrator = DataOrchestrator::TryCreate(options_);
+  ASSERT_TRUE(maybe_orchestrator.ok()) << maybe_orchestrator.status();
+  EXPECT_CALL(notifier_, Start(_, GetTestLocation(),
+                               UnorderedElementsAre(
+                                   Pair("", ToDeltaFileName(3).value())),
+                               _))
+      .WillOnce(Return(absl::UnknownError("")));
+  EXPECT_FALSE((*maybe_orchestrator)->Start().ok());
+}
+
+TEST_F(DataOrchestratorTest, InitCacheReservesCacheForSnapshotKeys) {
+  auto snapshot_name = ToSnapshotFileName(1);
+  EXPECT_CALL(
+      blob_client_,
+      ListBlobs(GetTestLocation(),
+                Field(&BlobStorageClient::ListOptions::prefix,
+                      FilePrefix<FileType::SNAPSHOT>())))
+      .WillOnce(Return(std::vector<std::string>({*snapshot_name})));
+  KVFileMetadata metadata;
+  *metadata.mutable_snapshot()->mutable_starting_file() =
+      ToDeltaFileName(1).value();
+  *metadata.mutable_snapshot()->mutable_ending_delta_file() =
+      ToDeltaFileName(5).value();
+  metadata.mutable_snapshot()->set_num_keys(100);
+  metadata.mutable_snapshot()->set_num_set_keys(10);
+  metadata.mutable_snapshot()->set_total_value_bytes(1000);
+  auto record_reader1 = std::make_unique<MockStreamRecordReader>();
+  EXPECT_CALL(*record_reader1, GetKVFileMetadata).WillOnce(Return(metadata));
+  auto record_reader2 = std::make_unique<MockStreamRecordReader>();
+  EXPECT_CALL(*record_reader2, GetKVFileMetadata).WillOnce(Return(metadata));
+  EXPECT_CALL(delta_stream_reader_factory_, CreateConcurrentReader)
+      .WillOnce(Return(ByMove(std::move(record_reader1))))
+      .WillOnce(Return(ByMove(std::move(record_reader2))));
+  EXPECT_CALL(cache_, Reserve(100, 10)).Times(1);
+  EXPECT_CALL(
+      blob_client_,
+      ListBlobs(GetTestLocation(), Field(&BlobStorageClient::ListOptions::prefix,
+                                         FilePrefix<FileType::DELTA>())))
+      .WillOnce(Return(std::vector<std::string>()));
+  EXPECT_TRUE(DataOrchestrator::TryCreate(options_).ok());
+}
+
 TEST_F(DataOrchestratorTest, InitCache_SkipsInvalidKVMutation) {
   const std::vector<std::string> fnames({ToDeltaFileName(1).value()});
   EXPECT_CALL(
@@ -372,6 +509,276 @@ TEST_F(DataOrchestratorTest, InitCacheSuccess) {
   EXPECT_FALSE((*maybe_orchestrator)->Start().ok());
 }
 
+TEST_F(DataOrchestratorTest, InitCacheTracksDataFreshness) {
+  EXPECT_CALL(blob_client_,
+              ListBlobs(GetTestLocation(),
+                        Field(&BlobStorageClient::ListOptions::prefix,
+                              FilePrefix<FileType::SNAPSHOT>())))
+      .WillOnce(Return(std::vector<std::string>()));
+  EXPECT_CALL(blob_client_,
+              ListBlobs(GetTestLocation(),
+                        Field(&BlobStorageClient::ListOptions::prefix,
+                              FilePrefix<FileType::DELTA>())))
+      .WillOnce(Return(std::vector<std::string>{ToDeltaFileName(1).value()}));
+  auto update_reader = std::make_unique<MockStreamRecordReader>();
+  EXPECT_CALL(*update_reader, GetKVFileMetadata)
+      .WillOnce(Return(KVFileMetadata()));
+  EXPECT_CALL(*update_reader, ReadStreamRecords)
+      .WillOnce(
+          [](const std::function<absl::Status(std::string_view)>& callback) {
+            callback(ToStringView(ToFlatBufferBuilder(
+                         DataRecordStruct{.record =
+                                              KeyValueMutationRecordStruct{
+                                                  KeyValueMutationType::Update,
+                                                  3, "bar", "bar value"}})))
+                .IgnoreError();
+            return absl::OkStatus();
+          });
+  EXPECT_CALL(delta_stream_reader_factory_, CreateConcurrentReader)
+      .WillOnce(Return(ByMove(std::move(update_reader))));
+  EXPECT_CALL(cache_, UpdateKeyValue("bar", "bar value", 3, _)).Times(1);
+
+  DataFreshnessTracker freshness_tracker;
+  options_.freshness_tracker = &freshness_tracker;
+  ASSERT_TRUE(DataOrchestrator::TryCreate(options_).ok());
+  auto freshness = freshness_tracker.Get(absl::Now());
+  EXPECT_TRUE(freshness[""].caught_up);
+  EXPECT_EQ(freshness[""].logical_commit_time, 3);
+  EXPECT_EQ(freshness[""].num_pending_files, 0);
+}
+
+TEST_F(DataOrchestratorTest, InitCacheLoadsFilesConcurrently) {
+  const std::vector<std::string> fnames(
+      {ToDeltaFileName(1).value(), ToDeltaFileName(2).value()});
+  EXPECT_CALL(
+      blob_client_,
+      ListBlobs(GetTestLocation(),
+                Field(&BlobStorageClient::ListOptions::prefix,
+                      FilePrefix<FileType::SNAPSHOT>())))
+      .WillOnce(Return(std::vector<std::string>()));
+  EXPECT_CALL(blob_client_,
+              ListBlobs(GetTestLocation(),
+                        Field(&BlobStorageClient::ListOptions::prefix,
+                              FilePrefix<FileType::DELTA>())))
+      .WillOnce(Return(fnames));
+
+  // Each file waits for the other one to be loading, so they can only be
+  // loaded concurrently.
+  absl::Notification update_started;
+  absl::Notification delete_started;
+  KVFileMetadata metadata;
+  auto update_reader = std::make_unique<MockStreamRecordReader>();
+  EXPECT_CALL(*update_reader, GetKVFileMetadata).WillOnce(Return(metadata));
+  EXPECT_CALL(*update_reader, ReadStreamRecords)
+      .WillOnce([&update_started, &delete_started](
+                    const std::function<absl::Status(std::string_view)>&
+                        callback) {
+        update_started.Notify();
+        EXPECT_TRUE(
+            delete_started.WaitForNotificationWithTimeout(absl::Seconds(10)));
+        callback(ToStringView(ToFlatBufferBuilder(DataRecordStruct{
+                     .record = KeyValueMutationRecordStruct{
+                         KeyValueMutationType::Update, 3, "bar",
+                         "bar value"}})))
+            .IgnoreError();
+        return absl::OkStatus();
+      });
+  auto delete_reader = std::make_unique<MockStreamRecordReader>();
+  EXPECT_CALL(*delete_reader, GetKVFileMetadata).WillOnce(Return(metadata));
+  EXPECT_CALL(*delete_reader, ReadStreamRecords)
+      .WillOnce([&update_started, &delete_started](
+                    const std::function<absl::Status(std::string_view)>&
+                        callback) {
+        delete_started.Notify();
+        EXPECT_TRUE(
+            update_started.WaitForNotificationWithTimeout(absl::Seconds(10)));
+        callback(ToStringView(ToFlatBufferBuilder(DataRecordStruct{
+                     .record = KeyValueMutationRecordStruct{
+                         KeyValueMutationType::Delete, 4, "bar",
+                         "bar value"}})))
+            .IgnoreError();
+        return absl::OkStatus();
+      });
+  EXPECT_CALL(delta_stream_reader_factory_, CreateConcurrentReader)
+      .WillOnce(Return(ByMove(std::move(update_reader))))
+      .WillOnce(Return(ByMove(std::move(delete_reader))));
+
+  EXPECT_CALL(cache_, UpdateKeyValue("bar", "bar value", 3, _)).Times(1);
+  EXPECT_CALL(cache_, DeleteKey("bar", 4, _)).Times(1);
+  // Deleted keys are removed once, after all the files are loaded.
+  EXPECT_CALL(cache_, RemoveDeletedKeys(4, "")).Times(1);
+
+  auto options = options_;
+  options.num_concurrent_files = 2;
+  auto maybe_orchestrator = DataOrchestrator::TryCreate(options);
+  ASSERT_TRUE(maybe_orchestrator.ok());
+
+  EXPECT_CALL(notifier_,
+              Start(_, GetTestLocation(),
+                    UnorderedElementsAre(Pair("", fnames[1])), _))
+      .WillOnce(Return(absl::UnknownError("")));
+  EXPECT_FALSE((*maybe_orchestrator)->Start().ok());
+}
+
+TEST_F(DataOrchestratorTest, InitCacheLogsDataLoadingProfileOfSnapshot) {
+  // Stages the test waits in, so that their totals are known to be filled.
+  constexpr absl::Duration kStageTime = absl::Milliseconds(2);
+  const std::string snapshot_name = ToSnapshotFileName(1).value();
+  EXPECT_CALL(
+      blob_client_,
+      ListBlobs(GetTestLocation(),
+                Field(&BlobStorageClient::ListOptions::prefix,
+                      FilePrefix<FileType::SNAPSHOT>())))
+      .WillOnce(Return(std::vector<std::string>({snapshot_name})));
+  EXPECT_CALL(
+      blob_client_,
+      ListBlobs(GetTestLocation(), Field(&BlobStorageClient::ListOptions::prefix,
+                                         FilePrefix<FileType::DELTA>())))
+      .WillOnce(Return(std::vector<std::string>()));
+  KVFileMetadata metadata;
+  *metadata.mutable_snapshot()->mutable_starting_file() =
+      ToDeltaFileName(1).value();
+  *metadata.mutable_snapshot()->mutable_ending_delta_file() =
+      ToDeltaFileName(5).value();
+  std::vector<std::string> records;
+  int64_t record_bytes = 0;
+  for (std::string_view key : {"foo", "bar", "baz"}) {
+    records.emplace_back(ToStringView(ToFlatBufferBuilder(
+        DataRecordStruct{.record = KeyValueMutationRecordStruct{
+                             KeyValueMutationType::Update, 3, key, "value"}})));
+    record_bytes += records.back().size();
+  }
+  // The first reader only reads the metadata of the snapshot.
+  auto metadata_reader = std::make_unique<MockStreamRecordReader>();
+  EXPECT_CALL(*metadata_reader, GetKVFileMetadata).WillOnce(Return(metadata));
+  auto record_reader = std::make_unique<MockStreamRecordReader>();
+  EXPECT_CALL(*record_reader, GetKVFileMetadata).WillOnce([&] {
+    absl::SleepFor(kStageTime);
+    return metadata;
+  });
+  EXPECT_CALL(*record_reader, ReadStreamRecords)
+      .WillOnce(
+          [&records](
+              const std::function<absl::Status(std::string_view)>& callback) {
+            for (const auto& record : records) {
+              callback(record).IgnoreError();
+            }
+            return absl::OkStatus();
+          });
+  EXPECT_CALL(delta_stream_reader_factory_, CreateConcurrentReader)
+      .WillOnce(Return(ByMove(std::move(metadata_reader))))
+      .WillOnce(Return(ByMove(std::move(record_reader))));
+  EXPECT_CALL(cache_, UpdateKeyValue(_, "value", 3, _))
+      .Times(3)
+      .WillRepeatedly(InvokeWithoutArgs([&] { absl::SleepFor(kStageTime); }));
+
+  absl::ScopedMockLog log;
+  std::string profile_line;
+  EXPECT_CALL(log, Log(absl::LogSeverity::kInfo, _,
+                       HasSubstr("Data loading profile: source=" +
+                                 snapshot_name)))
+      .WillOnce(SaveArg<2>(&profile_line));
+  log.StartCapturingLogs();
+  ASSERT_TRUE(DataOrchestrator::TryCreate(options_).ok());
+  log.StopCapturingLogs();
+
+  auto profile = ParseDataLoadingProfile(profile_line);
+  // Each record is read as its own batch.
+  EXPECT_EQ(profile["batches"], 3);
+  EXPECT_EQ(profile["records"], 3);
+  EXPECT_EQ(profile["record_bytes"], record_bytes);
+  EXPECT_EQ(profile["updated"], 3);
+  EXPECT_GE(profile["open_us"], absl::ToInt64Microseconds(kStageTime));
+  EXPECT_GE(profile["apply_us"], absl::ToInt64Microseconds(3 * kStageTime));
+  for (std::string_view stage :
+       {"throttle_us", "decode_us", "notify_us", "cleanup_us"}) {
+    EXPECT_TRUE(profile.contains(stage)) << stage;
+  }
+}
+
+TEST_F(DataOrchestratorTest, InitCacheAddsUpDataLoadingProfileOfThreads) {
+  constexpr int kNumThreads = 4;
+  constexpr absl::Duration kApplyTime = absl::Milliseconds(2);
+  const std::string delta_name = ToDeltaFileName(1).value();
+  EXPECT_CALL(
+      blob_client_,
+      ListBlobs(GetTestLocation(),
+                Field(&BlobStorageClient::ListOptions::prefix,
+                      FilePrefix<FileType::SNAPSHOT>())))
+      .WillOnce(Return(std::vector<std::string>()));
+  EXPECT_CALL(blob_client_,
+              ListBlobs(GetTestLocation(),
+                        Field(&BlobStorageClient::ListOptions::prefix,
+                              FilePrefix<FileType::DELTA>())))
+      .WillOnce(Return(std::vector<std::string>{delta_name}));
+  std::vector<std::string> records;
+  int64_t record_bytes = 0;
+  for (int i = 0; i < kNumThreads; i++) {
+    records.emplace_back(ToStringView(ToFlatBufferBuilder(DataRecordStruct{
+        .record = KeyValueMutationRecordStruct{KeyValueMutationType::Update, 3,
+                                               absl::StrCat("key", i),
+                                               "value"}})));
+    record_bytes += records.back().size();
+  }
+  auto record_reader = std::make_unique<MockStreamRecordReader>();
+  EXPECT_CALL(*record_reader, GetKVFileMetadata)
+      .WillOnce(Return(KVFileMetadata()));
+  // Each record is a batch processed by its own thread, like the batches of
+  // a concurrent reader.
+  EXPECT_CALL(*record_reader, ReadStreamRecords)
+      .WillOnce(
+          [&records](
+              const std::function<absl::Status(std::string_view)>& callback) {
+            std::vector<std::thread> threads;
+            for (const auto& record : records) {
+              threads.emplace_back(
+                  [&callback, &record] { callback(record).IgnoreError(); });
+            }
+            for (auto& thread : threads) {
+              thread.join();
+            }
+            return absl::OkStatus();
+          });
+  EXPECT_CALL(delta_stream_reader_factory_, CreateConcurrentReader)
+      .WillOnce(Return(ByMove(std::move(record_reader))));
+  // The batches are applied at the same time: each waits for all of them to
+  // be applying before taking its time.
+  absl::Mutex mutex;
+  int num_applying = 0;
+  EXPECT_CALL(cache_, UpdateKeyValue(_, "value", 3, _))
+      .Times(kNumThreads)
+      .WillRepeatedly(InvokeWithoutArgs([&] {
+        {
+          absl::MutexLock lock(&mutex);
+          num_applying++;
+          mutex.Await(absl::Condition(
+              +[](int* num_applying) { return *num_applying == kNumThreads; },
+              &num_applying));
+        }
+        absl::SleepFor(kApplyTime);
+      }));
+
+  absl::ScopedMockLog log;
+  std::string profile_line;
+  EXPECT_CALL(log, Log(absl::LogSeverity::kInfo, _,
+                       HasSubstr("Data loading profile: source=" +
+                                 delta_name)))
+      .WillOnce(SaveArg<2>(&profile_line));
+  log.StartCapturingLogs();
+  ASSERT_TRUE(DataOrchestrator::TryCreate(options_).ok());
+  log.StopCapturingLogs();
+
+  auto profile = ParseDataLoadingProfile(profile_line);
+  EXPECT_EQ(profile["batches"], kNumThreads);
+  EXPECT_EQ(profile["records"], kNumThreads);
+  EXPECT_EQ(profile["record_bytes"], record_bytes);
+  EXPECT_EQ(profile["updated"], kNumThreads);
+  // The apply times of all the threads are in the total, even though they
+  // overlapped.
+  EXPECT_GE(profile["apply_us"],
+            absl::ToInt64Microseconds(kNumThreads * kApplyTime));
+}
+
 TEST_F(DataOrchestratorTest, UpdateUdfCodeSuccess) {
   const std::vector<std::string> fnames({ToDeltaFileName(1).value()});
   EXPECT_CALL(
@@ -424,6 +831,51 @@ TEST_F(DataOrchestratorTest, UpdateUdfCodeSuccess) {
   EXPECT_FALSE((*maybe_orchestrator)->Start().ok());
 }
 
+TEST_F(DataOrchestratorTest, LoadsCompressionDictionary) {
+  EXPECT_CALL(
+      blob_client_,
+      ListBlobs(GetTestLocation(),
+                AllOf(Field(&BlobStorageClient::ListOptions::start_after, ""),
+                      Field(&BlobStorageClient::ListOptions::prefix,
+                            FilePrefix<FileType::SNAPSHOT>()))))
+      .WillOnce(Return(std::vector<std::string>()));
+  EXPECT_CALL(
+      blob_client_,
+      ListBlobs(GetTestLocation(),
+                AllOf(Field(&BlobStorageClient::ListOptions::start_after, ""),
+                      Field(&BlobStorageClient::ListOptions::prefix,
+                            FilePrefix<FileType::DELTA>()))))
+      .WillOnce(Return(std::vector<std::string>({ToDeltaFileName(1).value()})));
+
+  KVFileMetadata metadata;
+  auto reader = std::make_unique<MockStreamRecordReader>();
+  EXPECT_CALL(*reader, GetKVFileMetadata).Times(1).WillOnce(Return(metadata));
+  EXPECT_CALL(*reader, ReadStreamRecords)
+      .WillOnce(
+          [](const std::function<absl::Status(std::string_view)>& callback) {
+            const std::vector<uint8_t> dictionary = {'d', 'i', 'c', 't'};
+            flatbuffers::FlatBufferBuilder builder;
+            builder.Finish(kv_server::CreateDataRecord(
+                builder, Record::CompressionDictionaryConfig,
+                kv_server::CreateCompressionDictionaryConfigDirect(
+                    builder, &dictionary, /*logical_commit_time=*/1,
+                    /*version=*/2)
+                    .Union()));
+            callback(ToStringView(builder)).IgnoreError();
+            return absl::OkStatus();
+          });
+  EXPECT_CALL(delta_stream_reader_factory_, CreateConcurrentReader)
+      .WillOnce(Return(ByMove(std::move(reader))));
+
+  CompressionDictionaryStore compression_dictionaries;
+  options_.compression_dictionaries = &compression_dictionaries;
+  auto maybe_orchestrator = DataOrchestrator::TryCreate(options_);
+  ASSERT_TRUE(maybe_orchestrator.ok());
+  ASSERT_NE(compression_dictionaries.Get(), nullptr);
+  EXPECT_EQ(compression_dictionaries.Get()->data(), "dict");
+  EXPECT_EQ(compression_dictionaries.Get()->version(), 2);
+}
+
 TEST_F(DataOrchestratorTest, UpdateUdfCodeFails_OrchestratorContinues) {
   const std::vector<std::string> fnames({ToDeltaFileName(1).value()});
   EXPECT_CALL(
@@ -549,6 +1001,82 @@ TEST_F(DataOrchestratorTest, StartLoading) {
   all_records_loaded.WaitForNotificationWithTimeout(absl::Seconds(10));
 }
 
+TEST_F(DataOrchestratorTest, SwapsInCacheReloadedFromNewSnapshot) {
+  SwappableCache cache(KeyValueCache::Create());
+  cache.UpdateKeyValue("old_key", "old value", 1);
+  // The listing at init and the first check find no snapshot files.
+  std::atomic<int> num_snapshot_listings = 0;
+  EXPECT_CALL(blob_client_,
+              ListBlobs(_, Field(&BlobStorageClient::ListOptions::prefix,
+                                 FilePrefix<FileType::SNAPSHOT>())))
+      .WillRepeatedly([&num_snapshot_listings](
+                          BlobStorageClient::DataLocation,
+                          BlobStorageClient::ListOptions) {
+        return ++num_snapshot_listings <= 2
+                   ? std::vector<std::string>()
+                   : std::vector<std::string>({*ToSnapshotFileName(1)});
+      });
+  EXPECT_CALL(blob_client_,
+              ListBlobs(_, Field(&BlobStorageClient::ListOptions::prefix,
+                                 FilePrefix<FileType::DELTA>())))
+      .WillRepeatedly(Return(std::vector<std::string>()));
+  auto maybe_orchestrator = DataOrchestrator::TryCreate({
+      .data_bucket = GetTestLocation().bucket,
+      .cache = cache,
+      .blob_client = blob_client_,
+      .delta_notifier = notifier_,
+      .change_notifier = change_notifier_,
+      .udf_client = udf_client_,
+      .delta_stream_reader_factory = delta_stream_reader_factory_,
+      .realtime_thread_pool_manager = realtime_thread_pool_manager_,
+      .key_sharder =
+          kv_server::KeySharder(kv_server::ShardingFunction{/*seed=*/""}),
+      .blob_prefix_allowlist = kv_server::BlobPrefixAllowlist(""),
+      .swappable_cache = &cache,
+      .create_cache = [] { return KeyValueCache::Create(); },
+      .snapshot_reload_interval = absl::Milliseconds(10),
+  });
+  ASSERT_TRUE(maybe_orchestrator.ok());
+  auto orchestrator = std::move(maybe_orchestrator.value());
+
+  EXPECT_CALL(notifier_, Start).WillOnce(Return(absl::OkStatus()));
+  EXPECT_CALL(notifier_, IsRunning).WillOnce(Return(true));
+  EXPECT_CALL(notifier_, Stop()).WillOnce(Return(absl::OkStatus()));
+  KVFileMetadata metadata;
+  *metadata.mutable_snapshot()->mutable_ending_delta_file() =
+      ToDeltaFileName(1).value();
+  auto metadata_reader = std::make_unique<MockStreamRecordReader>();
+  EXPECT_CALL(*metadata_reader, GetKVFileMetadata).WillOnce(Return(metadata));
+  auto snapshot_reader = std::make_unique<MockStreamRecordReader>();
+  EXPECT_CALL(*snapshot_reader, GetKVFileMetadata).WillOnce(Return(metadata));
+  EXPECT_CALL(*snapshot_reader, ReadStreamRecords)
+      .WillOnce(
+          [](const std::function<absl::Status(std::string_view)>& callback) {
+            return callback(ToStringView(ToFlatBufferBuilder(DataRecordStruct{
+                .record = KeyValueMutationRecordStruct{
+                    KeyValueMutationType::Update, 3, "bar", "bar value"}})));
+          });
+  EXPECT_CALL(delta_stream_reader_factory_, CreateConcurrentReader)
+      .WillOnce(Return(ByMove(std::move(metadata_reader))))
+      .WillOnce(Return(ByMove(std::move(snapshot_reader))));
+
+  ASSERT_TRUE(orchestrator->Start().ok());
+  std::vector<std::string> keys;
+  for (int i = 0; i < 1000; i++) {
+    keys.clear();
+    ASSERT_TRUE(cache
+                    .ForEachKey([&keys](std::string_view key) {
+                      keys.emplace_back(key);
+                    })
+                    .ok());
+    if (keys == std::vector<std::string>({"bar"})) {
+      break;
+    }
+    absl::SleepFor(absl::Milliseconds(10));
+  }
+  EXPECT_THAT(keys, UnorderedElementsAre("bar"));
+}
+
 TEST_F(DataOrchestratorTest, CreateOrchestratorWithRealtimeDisabled) {
   ON_CALL(blob_client_, ListBlobs)
       .WillByDefault(Return(std::vector<std::string>({})));
@@ -640,6 +1168,96 @@ TEST_F(DataOrchestratorTest, InitCacheShardedSuccessSkipRecord) {
   ASSERT_TRUE(maybe_orchestrator.ok());
 }
 
+TEST_F(DataOrchestratorTest, InitCacheReportsMutatedKeysOfAllShards) {
+  testing::StrictMock<MockCache> strict_cache;
+
+  const std::vector<std::string> fnames(
+      {ToDeltaFileName(1).value(), ToDeltaFileName(2).value()});
+  EXPECT_CALL(
+      blob_client_,
+      ListBlobs(GetTestLocation(),
+                AllOf(Field(&BlobStorageClient::ListOptions::start_after, ""),
+                      Field(&BlobStorageClient::ListOptions::prefix,
+                            FilePrefix<FileType::SNAPSHOT>()))))
+      .Times(1)
+      .WillOnce(Return(std::vector<std::string>()));
+  EXPECT_CALL(
+      blob_client_,
+      ListBlobs(GetTestLocation(),
+                AllOf(Field(&BlobStorageClient::ListOptions::start_after, ""),
+                      Field(&BlobStorageClient::ListOptions::prefix,
+                            FilePrefix<FileType::DELTA>()))))
+      .WillOnce(Return(fnames));
+
+  KVFileMetadata metadata;
+  auto update_reader = std::make_unique<MockStreamRecordReader>();
+  EXPECT_CALL(*update_reader, GetKVFileMetadata)
+      .Times(1)
+      .WillOnce(Return(metadata));
+  EXPECT_CALL(*update_reader, ReadStreamRecords)
+      .Times(1)
+      .WillOnce(
+          [](const std::function<absl::Status(std::string_view)>& callback) {
+            // key: "shard1" -> shard num: 0
+            callback(ToStringView(ToFlatBufferBuilder(
+                         DataRecordStruct{.record =
+                                              KeyValueMutationRecordStruct{
+                                                  KeyValueMutationType::Update,
+                                                  3, "shard1", "bar value"}})))
+                .IgnoreError();
+            return absl::OkStatus();
+          });
+  auto delete_reader = std::make_unique<MockStreamRecordReader>();
+  EXPECT_CALL(*delete_reader, GetKVFileMetadata)
+      .Times(1)
+      .WillOnce(Return(metadata));
+  EXPECT_CALL(*delete_reader, ReadStreamRecords)
+      .Times(1)
+      .WillOnce(
+          [](const std::function<absl::Status(std::string_view)>& callback) {
+            // key: "shard2" -> shard num: 1
+            callback(ToStringView(ToFlatBufferBuilder(
+                         DataRecordStruct{.record =
+                                              KeyValueMutationRecordStruct{
+                                                  KeyValueMutationType::Delete,
+                                                  3, "shard2", "bar value"}})))
+                .IgnoreError();
+            return absl::OkStatus();
+          });
+  EXPECT_CALL(delta_stream_reader_factory_, CreateConcurrentReader)
+      .Times(2)
+      .WillOnce(Return(ByMove(std::move(update_reader))))
+      .WillOnce(Return(ByMove(std::move(delete_reader))));
+
+  EXPECT_CALL(strict_cache, RemoveDeletedKeys(0, _)).Times(1);
+  EXPECT_CALL(strict_cache, DeleteKey("shard2", 3, _)).Times(1);
+  EXPECT_CALL(strict_cache, RemoveDeletedKeys(3, _)).Times(1);
+
+  std::vector<std::string> mutated_keys;
+  auto sharded_options = DataOrchestrator::Options{
+      .data_bucket = GetTestLocation().bucket,
+      .cache = strict_cache,
+      .blob_client = blob_client_,
+      .delta_notifier = notifier_,
+      .change_notifier = change_notifier_,
+      .udf_client = udf_client_,
+      .delta_stream_reader_factory = delta_stream_reader_factory_,
+      .realtime_thread_pool_manager = realtime_thread_pool_manager_,
+      .shard_num = 1,
+      .num_shards = 2,
+      .key_sharder =
+          kv_server::KeySharder(kv_server::ShardingFunction{/*seed=*/""}),
+      .blob_prefix_allowlist = BlobPrefixAllowlist(""),
+      .mutated_keys_callback =
+          [&mutated_keys](absl::Span<const std::string_view> keys) {
+            mutated_keys.insert(mutated_keys.end(), keys.begin(), keys.end());
+          }};
+
+  auto maybe_orchestrator = DataOrchestrator::TryCreate(sharded_options);
+  ASSERT_TRUE(maybe_orchestrator.ok());
+  EXPECT_THAT(mutated_keys, UnorderedElementsAre("shard1", "shard2"));
+}
+
 TEST_F(DataOrchestratorTest, InitCacheSkipsSnapshotFilesForOtherShards) {
   auto snapshot_name = ToSnapshotFileName(1);
   EXPECT_CALL(
@@ -672,6 +1290,39 @@ TEST_F(DataOrchestratorTest, InitCacheSkipsSnapshotFilesForOtherShards) {
   EXPECT_TRUE(DataOrchestrator::TryCreate(options_).ok());
 }
 
+TEST_F(DataOrchestratorTest,
+       InitCacheDoesNotDownloadSnapshotFilesOfOtherShards) {
+  auto snapshot_name = ToSnapshotFileName(1);
+  EXPECT_CALL(
+      blob_client_,
+      ListBlobs(GetTestLocation(),
+                AllOf(Field(&BlobStorageClient::ListOptions::start_after, ""),
+                      Field(&BlobStorageClient::ListOptions::prefix,
+                            FilePrefix<FileType::SNAPSHOT>()))))
+      .WillOnce(Return(std::vector<std::string>({*snapshot_name})));
+  KVFileMetadata metadata;
+  *metadata.mutable_snapshot()->mutable_starting_file() =
+      ToDeltaFileName(1).value();
+  *metadata.mutable_snapshot()->mutable_ending_delta_file() =
+      ToDeltaFileName(5).value();
+  metadata.mutable_sharding_metadata()->set_shard_num(17);
+  auto record_reader = std::make_unique<MockStreamRecordReader>();
+  EXPECT_CALL(*record_reader, GetKVFileMetadata).WillOnce(Return(metadata));
+  EXPECT_CALL(delta_stream_reader_factory_, CreateConcurrentReader)
+      .WillOnce(Return(ByMove(std::move(record_reader))));
+  EXPECT_CALL(blob_client_, GetBlobReader).Times(0);
+  EXPECT_CALL(
+      blob_client_,
+      ListBlobs(GetTestLocation(),
+                AllOf(Field(&BlobStorageClient::ListOptions::start_after, ""),
+                      Field(&BlobStorageClient::ListOptions::prefix,
+                            FilePrefix<FileType::DELTA>()))))
+      .WillOnce(Return(std::vector<std::string>()));
+  auto options = options_;
+  options.download_snapshot_files = true;
+  EXPECT_TRUE(DataOrchestrator::TryCreate(options).ok());
+}
+
 TEST_F(DataOrchestratorTest, VerifyLoadingDataFromPrefixes) {
   for (auto file_type :
        {FilePrefix<FileType::DELTA>(), FilePrefix<FileType::SNAPSHOT>()}) {
@@ -692,4 +1343,93 @@ TEST_F(DataOrchestratorTest, VerifyLoadingDataFromPrefixes) {
   ASSERT_TRUE(maybe_orchestrator.ok());
 }
 
+TEST_F(DataOrchestratorTest, InitCacheLoadsPriorityPrefixesFirst) {
+  DataFreshnessTracker freshness_tracker;
+  testing::ExpectationSet priority_prefix_listed;
+  for (auto file_type :
+       {FilePrefix<FileType::DELTA>(), FilePrefix<FileType::SNAPSHOT>()}) {
+    priority_prefix_listed +=
+        EXPECT_CALL(blob_client_,
+                    ListBlobs(BlobStorageClient::DataLocation{
+                                  .bucket = "testbucket", .prefix = "prefix2"},
+                              Field(&BlobStorageClient::ListOptions::prefix,
+                                    file_type)))
+            .WillOnce(Return(std::vector<std::string>({})));
+  }
+  for (auto file_type :
+       {FilePrefix<FileType::DELTA>(), FilePrefix<FileType::SNAPSHOT>()}) {
+    for (auto prefix : {"", "prefix1"}) {
+      EXPECT_CALL(blob_client_,
+                  ListBlobs(BlobStorageClient::DataLocation{
+                                .bucket = "testbucket", .prefix = prefix},
+                            Field(&BlobStorageClient::ListOptions::prefix,
+                                  file_type)))
+          .After(priority_prefix_listed)
+          .WillOnce([&freshness_tracker](auto, auto) {
+            // The priority prefix is caught up before the others load.
+            EXPECT_TRUE(
+                freshness_tracker.Get(absl::Now())["prefix2"].caught_up);
+            return std::vector<std::string>({});
+          });
+    }
+  }
+  auto options = options_;
+  options.blob_prefix_allowlist = BlobPrefixAllowlist("prefix1,prefix2");
+  options.priority_prefixes = {"prefix2", "not_allowlisted"};
+  options.freshness_tracker = &freshness_tracker;
+  ASSERT_TRUE(DataOrchestrator::TryCreate(options).ok());
+}
+
+TEST_F(DataOrchestratorTest, ReadsLatestLogicalShardMapping) {
+  const std::vector<std::string> fnames(
+      {kv_server::ToLogicalShardingConfigFilename(1).value(),
+       kv_server::ToLogicalShardingConfigFilename(2).value()});
+  EXPECT_CALL(blob_client_,
+              ListBlobs(GetTestLocation(),
+                        Field(&BlobStorageClient::ListOptions::prefix,
+                              FilePrefix<FileType::LOGICAL_SHARDING_CONFIG>())))
+      .WillOnce(Return(fnames));
+  std::stringstream blob_stream;
+  EXPECT_CALL(blob_client_, GetBlobReader(GetTestLocation(fnames[1])))
+      .WillOnce([&blob_stream](BlobStorageClient::DataLocation) {
+        auto blob_reader = std::make_unique<MockBlobReader>();
+        EXPECT_CALL(*blob_reader, Stream)
+            .WillRepeatedly(ReturnRef(blob_stream));
+        return blob_reader;
+      });
+  auto record_reader = std::make_unique<MockStreamRecordReader>();
+  EXPECT_CALL(*record_reader, ReadStreamRecords)
+      .WillOnce(
+          [](const std::function<absl::Status(std::string_view)>& callback) {
+            for (const auto& mapping :
+                 {kv_server::ShardMappingRecordStruct{.logical_shard = 3,
+                                                      .physical_shard = 1},
+                  kv_server::ShardMappingRecordStruct{.logical_shard = 5,
+                                                      .physical_shard = 0}}) {
+              callback(ToStringView(ToFlatBufferBuilder(
+                           DataRecordStruct{.record = mapping})))
+                  .IgnoreError();
+            }
+            return absl::OkStatus();
+          });
+  EXPECT_CALL(delta_stream_reader_factory_, CreateReader)
+      .WillOnce(Return(ByMove(std::move(record_reader))));
+
+  auto physical_shards = DataOrchestrator::ReadLogicalShardMapping(
+      blob_client_, delta_stream_reader_factory_, GetTestLocation().bucket);
+  ASSERT_TRUE(physical_shards.ok()) << physical_shards.status();
+  EXPECT_THAT(*physical_shards, UnorderedElementsAre(Pair(3, 1), Pair(5, 0)));
+}
+
+TEST_F(DataOrchestratorTest, NoLogicalShardMappingWithoutConfigFile) {
+  EXPECT_CALL(blob_client_, ListBlobs)
+      .WillOnce(Return(std::vector<std::string>()));
+  EXPECT_CALL(blob_client_, GetBlobReader).Times(0);
+
+  auto physical_shards = DataOrchestrator::ReadLogicalShardMapping(
+      blob_client_, delta_stream_reader_factory_, GetTestLocation().bucket);
+  ASSERT_TRUE(physical_shards.ok()) << physical_shards.status();
+  EXPECT_TRUE(physical_shards->empty());
+}
+
 }  // namespace
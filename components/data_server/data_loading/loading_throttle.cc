@@ -0,0 +1,83 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/data_server/data_loading/loading_throttle.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "absl/log/log.h"
+
+namespace kv_server {
+namespace {
+
+// The rate grows back to the maximum in this many adjustments.
+constexpr int64_t kNumRateIncreaseSteps = 10;
+
+}  // namespace
+
+LoadingThrottle::LoadingThrottle(Options options)
+    : options_(std::move(options)),
+      max_records_per_second_(
+          std::max<int64_t>(1, options_.max_records_per_second)),
+      min_records_per_second_(std::clamp<int64_t>(
+          options_.min_records_per_second, 1, max_records_per_second_)),
+      records_per_second_(max_records_per_second_) {}
+
+void LoadingThrottle::Acquire(int64_t num_records) {
+  absl::SleepFor(Reserve(num_records, absl::Now()));
+}
+
+absl::Duration LoadingThrottle::Reserve(int64_t num_records, absl::Time now) {
+  absl::MutexLock lock(&mutex_);
+  MaybeAdjustRate(now);
+  // Time not used by loading is not saved up, so loading does not burst
+  // after a pause.
+  const absl::Time start_time = std::max(now, next_free_time_);
+  next_free_time_ =
+      start_time + absl::Seconds(1) * num_records / records_per_second_;
+  return start_time - now;
+}
+
+int64_t LoadingThrottle::RecordsPerSecond() const {
+  absl::MutexLock lock(&mutex_);
+  return records_per_second_;
+}
+
+void LoadingThrottle::MaybeAdjustRate(absl::Time now) {
+  if (options_.latency_target <= absl::ZeroDuration() ||
+      !options_.serving_latency ||
+      now - last_adjustment_time_ < options_.adjustment_interval) {
+    return;
+  }
+  last_adjustment_time_ = now;
+  const absl::Duration serving_latency = options_.serving_latency();
+  const int64_t previous_records_per_second = records_per_second_;
+  if (serving_latency > options_.latency_target) {
+    records_per_second_ =
+        std::max(min_records_per_second_, records_per_second_ / 2);
+  } else {
+    records_per_second_ = std::min(
+        max_records_per_second_,
+        records_per_second_ +
+            std::max<int64_t>(1,
+                              max_records_per_second_ / kNumRateIncreaseSteps));
+  }
+  if (records_per_second_ != previous_records_per_second) {
+    VLOG(2) << "Data loading rate changed to " << records_per_second_
+            << " records per second at serving latency " << serving_latency;
+  }
+}
+
+}  // namespace kv_server
@@ -0,0 +1,84 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef COMPONENTS_DATA_SERVER_DATA_LOADING_LOADING_THROTTLE_H_
+#define COMPONENTS_DATA_SERVER_DATA_LOADING_LOADING_THROTTLE_H_
+
+#include <cstdint>
+#include <functional>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+
+namespace kv_server {
+
+// Limits the rate at which the records of data files are loaded, so that
+// loading leaves CPU to serving. With a latency target, the rate follows the
+// serving latency: it halves whenever the latency exceeds the target, down to
+// a minimum rate that bounds how far loading falls behind, and grows back by
+// a tenth of the maximum rate at a time while the latency is under the
+// target.
+//
+// Thread safe.
+class LoadingThrottle {
+ public:
+  struct Options {
+    // Must be positive.
+    int64_t max_records_per_second = 0;
+    // Rate kept however high the serving latency is. At least 1.
+    int64_t min_records_per_second = 0;
+    // Zero keeps the rate at `max_records_per_second`.
+    absl::Duration latency_target = absl::ZeroDuration();
+    // Returns the average serving latency since its previous call, or zero
+    // without requests. Called at most every `adjustment_interval`.
+    std::function<absl::Duration()> serving_latency;
+    absl::Duration adjustment_interval = absl::Seconds(1);
+  };
+
+  explicit LoadingThrottle(Options options);
+
+  LoadingThrottle(const LoadingThrottle&) = delete;
+  LoadingThrottle& operator=(const LoadingThrottle&) = delete;
+
+  // Waits until `num_records` more records may be loaded.
+  void Acquire(int64_t num_records) ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Reserves `num_records` records at `now`, and returns how long the caller
+  // has to wait before loading them.
+  absl::Duration Reserve(int64_t num_records, absl::Time now)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+  int64_t RecordsPerSecond() const ABSL_LOCKS_EXCLUDED(mutex_);
+
+ private:
+  void MaybeAdjustRate(absl::Time now) ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  const Options options_;
+  const int64_t max_records_per_second_;
+  const int64_t min_records_per_second_;
+  mutable absl::Mutex mutex_;
+  int64_t records_per_second_ ABSL_GUARDED_BY(mutex_);
+  // Time from which the next records may be loaded.
+  absl::Time next_free_time_ ABSL_GUARDED_BY(mutex_) = absl::InfinitePast();
+  absl::Time last_adjustment_time_ ABSL_GUARDED_BY(mutex_) =
+      absl::InfinitePast();
+};
+
+}  // namespace kv_server
+
+#endif  // COMPONENTS_DATA_SERVER_DATA_LOADING_LOADING_THROTTLE_H_
@@ -0,0 +1,85 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/data_server/data_loading/loading_throttle.h"
+
+#include "gtest/gtest.h"
+
+namespace kv_server {
+namespace {
+
+const absl::Time kStart = absl::FromUnixSeconds(1000);
+
+TEST(LoadingThrottleTest, SpacesRecordsAtMaxRate) {
+  LoadingThrottle throttle({.max_records_per_second = 100});
+  EXPECT_EQ(throttle.Reserve(50, kStart), absl::ZeroDuration());
+  EXPECT_EQ(throttle.Reserve(50, kStart), absl::Milliseconds(500));
+  EXPECT_EQ(throttle.Reserve(10, kStart + absl::Milliseconds(200)),
+            absl::Milliseconds(800));
+}
+
+TEST(LoadingThrottleTest, DoesNotBurstAfterPause) {
+  LoadingThrottle throttle({.max_records_per_second = 100});
+  EXPECT_EQ(throttle.Reserve(100, kStart), absl::ZeroDuration());
+  const absl::Time later = kStart + absl::Seconds(10);
+  EXPECT_EQ(throttle.Reserve(100, later), absl::ZeroDuration());
+  EXPECT_EQ(throttle.Reserve(100, later), absl::Seconds(1));
+}
+
+TEST(LoadingThrottleTest, KeepsMaxRateWithoutLatencyTarget) {
+  int num_calls = 0;
+  LoadingThrottle throttle({.max_records_per_second = 100,
+                            .serving_latency = [&num_calls] {
+                              num_calls++;
+                              return absl::Seconds(1);
+                            }});
+  throttle.Reserve(1, kStart);
+  throttle.Reserve(1, kStart + absl::Seconds(2));
+  EXPECT_EQ(throttle.RecordsPerSecond(), 100);
+  EXPECT_EQ(num_calls, 0);
+}
+
+TEST(LoadingThrottleTest, AdaptsRateToServingLatency) {
+  absl::Duration serving_latency = absl::Milliseconds(50);
+  LoadingThrottle throttle({.max_records_per_second = 1000,
+                            .min_records_per_second = 200,
+                            .latency_target = absl::Milliseconds(20),
+                            .serving_latency = [&serving_latency] {
+                              return serving_latency;
+                            }});
+  absl::Time now = kStart;
+  throttle.Reserve(1, now);
+  EXPECT_EQ(throttle.RecordsPerSecond(), 500);
+  // Not adjusted again within the adjustment interval.
+  throttle.Reserve(1, now + absl::Milliseconds(500));
+  EXPECT_EQ(throttle.RecordsPerSecond(), 500);
+  now += absl::Seconds(1);
+  throttle.Reserve(1, now);
+  EXPECT_EQ(throttle.RecordsPerSecond(), 250);
+  now += absl::Seconds(1);
+  throttle.Reserve(1, now);
+  EXPECT_EQ(throttle.RecordsPerSecond(), 200);
+  serving_latency = absl::Milliseconds(10);
+  now += absl::Seconds(1);
+  throttle.Reserve(1, now);
+  EXPECT_EQ(throttle.RecordsPerSecond(), 300);
+  for (int i = 0; i < 10; i++) {
+    now += absl::Seconds(1);
+    throttle.Reserve(1, now);
+  }
+  EXPECT_EQ(throttle.RecordsPerSecond(), 1000);
+}
+
+}  // namespace
+}  // namespace kv_server
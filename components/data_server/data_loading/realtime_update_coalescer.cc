@@ -0,0 +1,144 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/data_server/data_loading/realtime_update_coalescer.h"
+
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "components/telemetry/server_definition.h"
+#include "components/util/lock_profiler.h"
+
+namespace kv_server {
+
+RealtimeUpdateCoalescer::RealtimeUpdateCoalescer(Cache& cache,
+                                                 absl::Duration window,
+                                                 int64_t max_pending_mutations)
+    : cache_(cache),
+      window_(window),
+      max_pending_mutations_(max_pending_mutations) {}
+
+RealtimeUpdateCoalescer::~RealtimeUpdateCoalescer() {
+  if (flush_closure_ != nullptr) {
+    flush_closure_->Stop();
+  }
+  Flush();
+}
+
+absl::Status RealtimeUpdateCoalescer::Start() {
+  if (flush_closure_ != nullptr) {
+    return absl::FailedPreconditionError("Already started");
+  }
+  flush_closure_ = PeriodicClosure::Create();
+  return flush_closure_->StartDelayed(window_, [this]() { Flush(); });
+}
+
+RealtimeUpdateCoalescer::PendingMutation RealtimeUpdateCoalescer::CopyMutation(
+    const CacheMutation& mutation) {
+  return {
+      .type = mutation.type,
+      .key = std::string(mutation.key),
+      .value = std::string(mutation.value),
+      .value_set = std::vector<std::string>(mutation.value_set.begin(),
+                                            mutation.value_set.end()),
+      .logical_commit_time = mutation.logical_commit_time,
+      .uint32_value_set = std::vector<uint32_t>(
+          mutation.uint32_value_set.begin(), mutation.uint32_value_set.end()),
+  };
+}
+
+void RealtimeUpdateCoalescer::Add(absl::Span<const CacheMutation> mutations,
+                                  std::string_view prefix) {
+  int64_t num_coalesced = 0;
+  bool should_flush;
+  {
+    ProfiledMutexLock lock(&mutex_, LockSite::kRealtimeCoalescer);
+    PrefixMutations& prefix_mutations = pending_[prefix];
+    for (const CacheMutation& mutation : mutations) {
+      if (mutation.type != CacheMutation::Type::kUpdateKeyValue &&
+          mutation.type != CacheMutation::Type::kDeleteKey) {
+        prefix_mutations.set_mutations.push_back(CopyMutation(mutation));
+        ++num_pending_;
+        continue;
+      }
+      auto [it, inserted] = prefix_mutations.key_value_mutations.try_emplace(
+          mutation.key);
+      if (inserted) {
+        it->second = CopyMutation(mutation);
+        ++num_pending_;
+        continue;
+      }
+      ++num_coalesced;
+      // Of mutations at the same time, the cache keeps the first one.
+      if (mutation.logical_commit_time > it->second.logical_commit_time) {
+        it->second.type = mutation.type;
+        it->second.value = mutation.value;
+        it->second.logical_commit_time = mutation.logical_commit_time;
+      }
+    }
+    should_flush = num_pending_ >= max_pending_mutations_;
+  }
+  if (num_coalesced > 0) {
+    LogIfError(KVServerContextMap()
+                   ->SafeMetric()
+                   .LogUpDownCounter<kRealtimeCoalescedMutationCount>(
+                       num_coalesced));
+  }
+  if (should_flush) {
+    Flush();
+  }
+}
+
+void RealtimeUpdateCoalescer::Flush() {
+  absl::flat_hash_map<std::string, PrefixMutations> pending;
+  {
+    ProfiledMutexLock lock(&mutex_, LockSite::kRealtimeCoalescer);
+    pending.swap(pending_);
+    num_pending_ = 0;
+  }
+  std::vector<CacheMutation> mutations;
+  std::vector<std::vector<std::string_view>> value_sets;
+  for (auto& [prefix, prefix_mutations] : pending) {
+    mutations.clear();
+    mutations.reserve(prefix_mutations.key_value_mutations.size() +
+                      prefix_mutations.set_mutations.size());
+    for (const auto& [key, mutation] : prefix_mutations.key_value_mutations) {
+      mutations.push_back({
+          .type = mutation.type,
+          .key = mutation.key,
+          .value = mutation.value,
+          .logical_commit_time = mutation.logical_commit_time,
+      });
+    }
+    value_sets.clear();
+    value_sets.reserve(prefix_mutations.set_mutations.size());
+    for (const PendingMutation& mutation : prefix_mutations.set_mutations) {
+      std::vector<std::string_view>& value_set =
+          value_sets.emplace_back(mutation.value_set.begin(),
+                                  mutation.value_set.end());
+      mutations.push_back({
+          .type = mutation.type,
+          .key = mutation.key,
+          .value_set = absl::MakeSpan(value_set),
+          .logical_commit_time = mutation.logical_commit_time,
+          .uint32_value_set = mutation.uint32_value_set,
+      });
+    }
+    cache_.ApplyBatch(mutations, prefix);
+  }
+}
+
+}  // namespace kv_server
@@ -0,0 +1,98 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef COMPONENTS_DATA_SERVER_DATA_LOADING_REALTIME_UPDATE_COALESCER_H_
+#define COMPONENTS_DATA_SERVER_DATA_LOADING_REALTIME_UPDATE_COALESCER_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/status.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+#include "components/data_server/cache/cache.h"
+#include "components/util/periodic_closure.h"
+
+namespace kv_server {
+
+// Holds the cache mutations of realtime updates for a short window and
+// applies them to the cache in one batch per prefix. Of the mutations of a
+// key with a single value, only the one with the latest logical commit time
+// is applied, as the cache would ignore the others. Mutations of key value
+// sets add or remove individual values, so they are all applied, in order.
+//
+// Thread safe.
+class RealtimeUpdateCoalescer {
+ public:
+  // Applies the pending mutations to `cache` every `window` once started, and
+  // right away once `max_pending_mutations` are pending.
+  RealtimeUpdateCoalescer(Cache& cache, absl::Duration window,
+                          int64_t max_pending_mutations = 10'000);
+
+  // Stops the periodic application and applies the pending mutations.
+  ~RealtimeUpdateCoalescer();
+
+  RealtimeUpdateCoalescer(const RealtimeUpdateCoalescer&) = delete;
+  RealtimeUpdateCoalescer& operator=(const RealtimeUpdateCoalescer&) = delete;
+
+  // Starts applying the pending mutations every `window`.
+  absl::Status Start();
+
+  // Adds copies of `mutations` of keys of `prefix` to the pending mutations.
+  void Add(absl::Span<const CacheMutation> mutations, std::string_view prefix);
+
+  // Applies the pending mutations.
+  void Flush();
+
+ private:
+  // A `CacheMutation` that owns its key and values.
+  struct PendingMutation {
+    CacheMutation::Type type;
+    std::string key;
+    std::string value;
+    std::vector<std::string> value_set;
+    int64_t logical_commit_time;
+    std::vector<uint32_t> uint32_value_set;
+  };
+
+  // The pending mutations of one prefix.
+  struct PrefixMutations {
+    // Latest mutation of every key with a single value.
+    absl::flat_hash_map<std::string, PendingMutation> key_value_mutations;
+    // Mutations of key value sets, in the order they were added.
+    std::vector<PendingMutation> set_mutations;
+  };
+
+  static PendingMutation CopyMutation(const CacheMutation& mutation);
+
+  Cache& cache_;
+  const absl::Duration window_;
+  const int64_t max_pending_mutations_;
+  absl::Mutex mutex_;
+  absl::flat_hash_map<std::string, PrefixMutations> pending_
+      ABSL_GUARDED_BY(mutex_);
+  int64_t num_pending_ ABSL_GUARDED_BY(mutex_) = 0;
+  std::unique_ptr<PeriodicClosure> flush_closure_;
+};
+
+}  // namespace kv_server
+
+#endif  // COMPONENTS_DATA_SERVER_DATA_LOADING_REALTIME_UPDATE_COALESCER_H_
@@ -0,0 +1,145 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/data_server/data_loading/realtime_update_coalescer.h"
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "absl/synchronization/notification.h"
+#include "absl/time/time.h"
+#include "components/data_server/cache/mocks.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace kv_server {
+namespace {
+
+using testing::_;
+using testing::ElementsAre;
+using testing::InSequence;
+
+class RealtimeUpdateCoalescerTest : public ::testing::Test {
+ protected:
+  RealtimeUpdateCoalescerTest() { InitMetricsContextMap(); }
+
+  MockCache cache_;
+};
+
+TEST_F(RealtimeUpdateCoalescerTest, KeepsLatestMutationOfEveryKey) {
+  EXPECT_CALL(cache_, UpdateKeyValue("key1", "value3", 3, "prefix")).Times(1);
+  EXPECT_CALL(cache_, DeleteKey("key2", 4, "prefix")).Times(1);
+  RealtimeUpdateCoalescer coalescer(cache_, absl::Hours(1));
+  coalescer.Add(
+      {
+          {.type = CacheMutation::Type::kUpdateKeyValue,
+           .key = "key1",
+           .value = "value1",
+           .logical_commit_time = 1},
+          {.type = CacheMutation::Type::kUpdateKeyValue,
+           .key = "key1",
+           .value = "value3",
+           .logical_commit_time = 3},
+          {.type = CacheMutation::Type::kUpdateKeyValue,
+           .key = "key2",
+           .value = "value2",
+           .logical_commit_time = 2},
+      },
+      "prefix");
+  coalescer.Add({{.type = CacheMutation::Type::kUpdateKeyValue,
+                  .key = "key1",
+                  .value = "value2",
+                  .logical_commit_time = 2},
+                 {.type = CacheMutation::Type::kDeleteKey,
+                  .key = "key2",
+                  .logical_commit_time = 4}},
+                "prefix");
+  coalescer.Flush();
+}
+
+TEST_F(RealtimeUpdateCoalescerTest, KeepsEverySetMutationInOrder) {
+  std::vector<std::string_view> values1 = {"v1", "v2"};
+  std::vector<std::string_view> values2 = {"v1"};
+  {
+    InSequence s;
+    EXPECT_CALL(cache_,
+                UpdateKeyValueSet("set", ElementsAre("v1", "v2"), 1, ""))
+        .Times(1);
+    EXPECT_CALL(cache_, DeleteValuesInSet("set", ElementsAre("v1"), 2, ""))
+        .Times(1);
+  }
+  RealtimeUpdateCoalescer coalescer(cache_, absl::Hours(1));
+  coalescer.Add({{.type = CacheMutation::Type::kUpdateKeyValueSet,
+                  .key = "set",
+                  .value_set = absl::MakeSpan(values1),
+                  .logical_commit_time = 1},
+                 {.type = CacheMutation::Type::kDeleteValuesInSet,
+                  .key = "set",
+                  .value_set = absl::MakeSpan(values2),
+                  .logical_commit_time = 2}},
+                "");
+  // The coalescer holds copies of the values.
+  values1 = {"other", "values"};
+  coalescer.Flush();
+}
+
+TEST_F(RealtimeUpdateCoalescerTest, AppliesOncePendingMutationsAreFull) {
+  testing::MockFunction<void()> check;
+  {
+    InSequence s;
+    EXPECT_CALL(check, Call);
+    EXPECT_CALL(cache_, UpdateKeyValue(_, "value", 1, "")).Times(2);
+  }
+  RealtimeUpdateCoalescer coalescer(cache_, absl::Hours(1),
+                                    /*max_pending_mutations=*/2);
+  coalescer.Add({{.type = CacheMutation::Type::kUpdateKeyValue,
+                  .key = "key1",
+                  .value = "value",
+                  .logical_commit_time = 1}},
+                "");
+  check.Call();
+  coalescer.Add({{.type = CacheMutation::Type::kUpdateKeyValue,
+                  .key = "key2",
+                  .value = "value",
+                  .logical_commit_time = 1}},
+                "");
+  testing::Mock::VerifyAndClearExpectations(&cache_);
+}
+
+TEST_F(RealtimeUpdateCoalescerTest, AppliesEveryWindowOnceStarted) {
+  absl::Notification applied;
+  EXPECT_CALL(cache_, UpdateKeyValue("key", "value", 1, ""))
+      .WillOnce([&applied]() { applied.Notify(); });
+  RealtimeUpdateCoalescer coalescer(cache_, absl::Milliseconds(1));
+  ASSERT_TRUE(coalescer.Start().ok());
+  coalescer.Add({{.type = CacheMutation::Type::kUpdateKeyValue,
+                  .key = "key",
+                  .value = "value",
+                  .logical_commit_time = 1}},
+                "");
+  EXPECT_TRUE(applied.WaitForNotificationWithTimeout(absl::Seconds(10)));
+}
+
+TEST_F(RealtimeUpdateCoalescerTest, AppliesPendingMutationsOnDestruction) {
+  EXPECT_CALL(cache_, DeleteKey("key", 1, "")).Times(1);
+  RealtimeUpdateCoalescer coalescer(cache_, absl::Hours(1));
+  coalescer.Add({{.type = CacheMutation::Type::kDeleteKey,
+                  .key = "key",
+                  .logical_commit_time = 1}},
+                "");
+}
+
+}  // namespace
+}  // namespace kv_server
@@ -13,8 +13,13 @@
 // limitations under the License.
 #include "components/data_server/request_handler/compression.h"
 
+#include <memory>
+#include <utility>
+
 #include "absl/log/log.h"
 #include "components/data_server/request_handler/compression_brotli.h"
+#include "components/data_server/request_handler/compression_gzip.h"
+#include "components/data_server/request_handler/compression_zstd.h"
 #include "components/data_server/request_handler/uncompressed.h"
 #include "quiche/common/quiche_data_writer.h"
 
@@ -27,21 +32,43 @@ void CompressionGroupConcatenator::AddCompressionGroup(
 }
 
 std::unique_ptr<CompressionGroupConcatenator>
-CompressionGroupConcatenator::Create(CompressionType type) {
-  if (type == CompressionType::kUncompressed) {
-    return std::make_unique<UncompressedConcatenator>();
-  } else {
-    return std::make_unique<BrotliCompressionGroupConcatenator>();
+CompressionGroupConcatenator::Create(
+    CompressionType type, CompressionOptions options,
+    std::shared_ptr<const CompressionDictionary> dictionary) {
+  switch (type) {
+    case CompressionType::kUncompressed:
+      return std::make_unique<UncompressedConcatenator>();
+    case CompressionType::kGzip:
+      return std::make_unique<GzipCompressionGroupConcatenator>(
+          options.gzip_level);
+    case CompressionType::kZstd:
+      return std::make_unique<ZstdCompressionGroupConcatenator>(
+          options.zstd_level);
+    case CompressionType::kBrotliDictionary:
+      return std::make_unique<BrotliCompressionGroupConcatenator>(
+          options.brotli_quality, options.brotli_window, std::move(dictionary));
+    default:
+      return std::make_unique<BrotliCompressionGroupConcatenator>(
+          options.brotli_quality, options.brotli_window);
   }
 }
 
 std::unique_ptr<CompressedBlobReader> CompressedBlobReader::Create(
     CompressionGroupConcatenator::CompressionType type,
-    std::string_view compressed) {
-  if (type == CompressionGroupConcatenator::CompressionType::kUncompressed) {
-    return std::make_unique<UncompressedBlobReader>(compressed);
-  } else {
-    return std::make_unique<BrotliCompressionBlobReader>(compressed);
+    std::string_view compressed,
+    std::shared_ptr<const CompressionDictionary> dictionary) {
+  switch (type) {
+    case CompressionGroupConcatenator::CompressionType::kUncompressed:
+      return std::make_unique<UncompressedBlobReader>(compressed);
+    case CompressionGroupConcatenator::CompressionType::kGzip:
+      return std::make_unique<GzipCompressionBlobReader>(compressed);
+    case CompressionGroupConcatenator::CompressionType::kZstd:
+      return std::make_unique<ZstdCompressionBlobReader>(compressed);
+    case CompressionGroupConcatenator::CompressionType::kBrotliDictionary:
+      return std::make_unique<BrotliCompressionBlobReader>(
+          compressed, std::move(dictionary));
+    default:
+      return std::make_unique<BrotliCompressionBlobReader>(compressed);
   }
 }
 
@@ -23,10 +23,23 @@
 #include <vector>
 
 #include "absl/status/statusor.h"
+#include "components/data_server/request_handler/compression_dictionary.h"
 #include "quiche/common/quiche_data_reader.h"
 
 namespace kv_server {
 
+// Trades compression speed for ratio. Out of range values are clamped.
+struct CompressionOptions {
+  // Brotli quality, from 0 to 11.
+  int brotli_quality = 11;
+  // Base 2 logarithm of the Brotli window size, from 10 to 24.
+  int brotli_window = 22;
+  // Gzip level, from 1 to 9.
+  int gzip_level = 6;
+  // Zstd level, from 1 to 22.
+  int zstd_level = 3;
+};
+
 // Responsible for concatenating compression groups according to the compression
 // specification
 // https://github.com/WICG/turtledove/blob/main/FLEDGE_Key_Value_Server_API.md#response-version-20
@@ -41,11 +54,22 @@ class CompressionGroupConcatenator {
  public:
   virtual ~CompressionGroupConcatenator() = default;
 
-  enum class CompressionType { kUncompressed = 0, kBrotli /* TODO: kGzip */ };
+  // kBrotliDictionary is Brotli with a shared dictionary.
+  enum class CompressionType {
+    kUncompressed = 0,
+    kBrotli,
+    kGzip,
+    kZstd,
+    kBrotliDictionary
+  };
 
+  // `dictionary` is required by kBrotliDictionary and ignored otherwise.
   static std::unique_ptr<CompressionGroupConcatenator> Create(
-      CompressionType type);
-  using FactoryFunctionType = decltype(Create);
+      CompressionType type, CompressionOptions options = CompressionOptions(),
+      std::shared_ptr<const CompressionDictionary> dictionary = nullptr);
+  using FactoryFunctionType = std::unique_ptr<CompressionGroupConcatenator>(
+      CompressionType type,
+      std::shared_ptr<const CompressionDictionary> dictionary);
 
   // Adds the JSON representation of plaintext (uncompressed) to be
   // concatenated.
@@ -70,9 +94,11 @@ class CompressedBlobReader {
   explicit CompressedBlobReader(std::string_view compressed)
       : data_reader_(compressed) {}
 
+  // `dictionary` is required by kBrotliDictionary and ignored otherwise.
   static std::unique_ptr<CompressedBlobReader> Create(
       CompressionGroupConcatenator::CompressionType type,
-      std::string_view compressed);
+      std::string_view compressed,
+      std::shared_ptr<const CompressionDictionary> dictionary = nullptr);
 
   virtual ~CompressedBlobReader() = default;
 
@@ -0,0 +1,114 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Compares the CPU time and the compression ratio of the compression group
+// concatenators at different levels.
+//
+// The compression groups look like the JSON partitions of V2 responses, with
+// random values, so that the ratios are close to the ones of real responses.
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_join.h"
+#include "benchmark/benchmark.h"
+#include "components/data_server/request_handler/compression.h"
+
+namespace kv_server {
+namespace {
+
+using CompressionType = CompressionGroupConcatenator::CompressionType;
+
+constexpr int kNumCompressionGroups = 4;
+constexpr int kNumKeysPerGroup = 100;
+
+// Returns a JSON array of one partition with `num_keys` key value pairs.
+std::string MakeCompressionGroup(int num_keys, std::mt19937& gen) {
+  std::uniform_int_distribution<uint32_t> dist;
+  std::vector<std::string> kv_pairs;
+  kv_pairs.reserve(num_keys);
+  for (int i = 0; i < num_keys; i++) {
+    kv_pairs.push_back(absl::StrCat(R"({"key":"key)", i,
+                                    R"(","value":{"stringValue":"value)",
+                                    dist(gen), dist(gen), R"("}})"));
+  }
+  return absl::StrCat(
+      R"([{"id":0,"keyGroupOutputs":[{"tags":["custom","keys"],)",
+      R"("keyValues":[)", absl::StrJoin(kv_pairs, ","), "]}]}]");
+}
+
+void RunCompression(benchmark::State& state, CompressionType type,
+                    const CompressionOptions& options) {
+  std::mt19937 gen(42);
+  std::vector<std::string> compression_groups;
+  int64_t input_size = 0;
+  for (int i = 0; i < kNumCompressionGroups; i++) {
+    input_size +=
+        compression_groups.emplace_back(MakeCompressionGroup(
+                                            state.range(0), gen))
+            .size();
+  }
+  int64_t output_size = 0;
+  for (auto _ : state) {
+    auto concatenator = CompressionGroupConcatenator::Create(type, options);
+    for (const std::string& compression_group : compression_groups) {
+      concatenator->AddCompressionGroup(compression_group);
+    }
+    auto output = concatenator->Build();
+    if (!output.ok()) {
+      state.SkipWithError(output.status().ToString().c_str());
+      return;
+    }
+    output_size = output->size();
+    benchmark::DoNotOptimize(output);
+  }
+  state.SetBytesProcessed(state.iterations() * input_size);
+  state.counters["ratio"] =
+      static_cast<double>(input_size) / static_cast<double>(output_size);
+}
+
+void BM_Uncompressed(benchmark::State& state) {
+  RunCompression(state, CompressionType::kUncompressed, CompressionOptions());
+}
+
+void BM_Brotli(benchmark::State& state) {
+  RunCompression(state, CompressionType::kBrotli,
+                 CompressionOptions{.brotli_quality =
+                                        static_cast<int>(state.range(1))});
+}
+
+void BM_Gzip(benchmark::State& state) {
+  RunCompression(
+      state, CompressionType::kGzip,
+      CompressionOptions{.gzip_level = static_cast<int>(state.range(1))});
+}
+
+void BM_Zstd(benchmark::State& state) {
+  RunCompression(
+      state, CompressionType::kZstd,
+      CompressionOptions{.zstd_level = static_cast<int>(state.range(1))});
+}
+
+BENCHMARK(BM_Uncompressed)->Arg(kNumKeysPerGroup);
+BENCHMARK(BM_Brotli)->ArgsProduct({{kNumKeysPerGroup}, {1, 4, 6, 9, 11}});
+BENCHMARK(BM_Gzip)->ArgsProduct({{kNumKeysPerGroup}, {1, 6, 9}});
+BENCHMARK(BM_Zstd)->ArgsProduct({{kNumKeysPerGroup}, {1, 3, 9, 19}});
+
+}  // namespace
+}  // namespace kv_server
+
+BENCHMARK_MAIN();
@@ -13,8 +13,10 @@
 // limitations under the License.
 #include "components/data_server/request_handler/compression_brotli.h"
 
+#include <algorithm>
 #include <memory>
 #include <string>
+#include <string_view>
 #include <utility>
 #include <vector>
 
@@ -28,46 +30,119 @@ namespace kv_server {
 
 namespace {
 
-// Responsible for compressing one compression group.
-absl::StatusOr<std::string> CompressOnePartition(std::string_view partition) {
+// Size of the buffer the encoder writes to before its output is appended to
+// the response.
+constexpr size_t kEncoderOutputBufferSize = 64 * 1024;
+
+// Starts the header of Dictionary-Compressed Brotli streams, followed by the
+// SHA-256 of the dictionary.
+constexpr std::string_view kDictionaryCompressedBrotliMagic =
+    "\xff\x44\x43\x42";
+
+// Owns the encoder memory
+class BrotliEncoder {
+ public:
+  explicit BrotliEncoder(BrotliEncoderState* encoder) : encoder_(encoder) {}
+  static absl::StatusOr<std::unique_ptr<BrotliEncoder>> Create(
+      int quality, int window, const CompressionDictionary* dictionary) {
+    BrotliEncoderState* encoder =
+        BrotliEncoderCreateInstance(/* alloc_func= */ nullptr,
+                                    /* free_func= */ nullptr,
+                                    /* opaque= */ nullptr);
+    if (!encoder) {
+      return absl::InternalError("Brotli encoder cannot be initialized");
+    }
+    BrotliEncoderSetParameter(
+        encoder, BROTLI_PARAM_QUALITY,
+        std::clamp(quality, BROTLI_MIN_QUALITY, BROTLI_MAX_QUALITY));
+    BrotliEncoderSetParameter(
+        encoder, BROTLI_PARAM_LGWIN,
+        std::clamp(window, BROTLI_MIN_WINDOW_BITS, BROTLI_MAX_WINDOW_BITS));
+    auto brotli_encoder = std::make_unique<BrotliEncoder>(encoder);
+    if (dictionary != nullptr &&
+        BrotliEncoderAttachPreparedDictionary(
+            encoder, dictionary->prepared_dictionary()) == BROTLI_FALSE) {
+      return absl::InternalError("Brotli dictionary cannot be attached");
+    }
+    return brotli_encoder;
+  }
+
+  BrotliEncoder(const BrotliEncoder&) = delete;
+  BrotliEncoder& operator=(const BrotliEncoder&) = delete;
+
+  ~BrotliEncoder() { BrotliEncoderDestroyInstance(encoder_); }
+
+  // Appends the compressed `partition` to `output`, `buffer.size()` bytes at a
+  // time, so that the compressed data is never held twice.
+  absl::Status Encode(std::string_view partition, std::string& buffer,
+                      std::string& output) {
+    size_t available_in = partition.size();
+    const uint8_t* next_in =
+        reinterpret_cast<const uint8_t*>(partition.data());
+    while (true) {
+      size_t available_out = buffer.size();
+      uint8_t* next_out = reinterpret_cast<uint8_t*>(buffer.data());
+      if (BrotliEncoderCompressStream(encoder_, BROTLI_OPERATION_FINISH,
+                                      &available_in, &next_in, &available_out,
+                                      &next_out,
+                                      /*total_out=*/nullptr) == BROTLI_FALSE) {
+        return absl::InternalError("Brotli failed to compress");
+      }
+      output.append(buffer.data(), buffer.size() - available_out);
+      if (BrotliEncoderIsFinished(encoder_) == BROTLI_TRUE) {
+        return absl::OkStatus();
+      }
+    }
+  }
+
+ private:
+  BrotliEncoderState* encoder_;
+};
+
+// Responsible for compressing one compression group and appending it to
+// `output`.
+absl::Status CompressOnePartition(std::string_view partition, int quality,
+                                  int window,
+                                  const CompressionDictionary* dictionary,
+                                  std::string& buffer, std::string& output) {
   VLOG(5) << "Compressing " << partition;
-  size_t buffer_size = BrotliEncoderMaxCompressedSize(partition.size());
+  auto maybe_brotli_encoder =
+      BrotliEncoder::Create(quality, window, dictionary);
+  if (!maybe_brotli_encoder.ok()) {
+    return maybe_brotli_encoder.status();
+  }
   // The output consists of the size of the compressed data and the compressed
   // data
-  std::string partition_output(sizeof(uint32_t) + buffer_size, '\0');
-
-  if (auto rc = BrotliEncoderCompress(
-          /*quality=*/BROTLI_DEFAULT_QUALITY,
-          /*lgwin=*/BROTLI_DEFAULT_WINDOW,
-          /*mode=*/BROTLI_DEFAULT_MODE,
-          /*input_size=*/partition.size(),
-          /*input_buffer=*/
-          reinterpret_cast<const uint8_t*>(partition.data()),
-          /*encoded_size=*/&buffer_size,
-          /*encoded_buffer=*/
-          reinterpret_cast<uint8_t*>(&partition_output.at(sizeof(uint32_t))));
-      rc == BROTLI_FALSE) {
-    return absl::InternalError(absl::StrCat("Brotli failed to compress"));
+  const size_t size_offset = output.size();
+  output.append(sizeof(uint32_t), '\0');
+  if (dictionary != nullptr) {
+    output.append(kDictionaryCompressedBrotliMagic);
+    output.append(dictionary->hash());
+  }
+  if (absl::Status status =
+          (*maybe_brotli_encoder)->Encode(partition, buffer, output);
+      !status.ok()) {
+    return status;
   }
-  // Shrink the output to only what's used by Brotli.
   // TODO(b/278269394): For compression groups, if the compressed value of one
   // group > original value, we should not do compression. But currently we
   // can only use one compression algo for all groups. So we can't simply stop
   // using the algo for one group in that case.
-  partition_output.resize(sizeof(uint32_t) + buffer_size);
+  const size_t compressed_size = output.size() - size_offset - sizeof(uint32_t);
   quiche::QuicheDataWriter data_writer(sizeof(uint32_t),
-                                       partition_output.data());
-  // Rewrite the data size to be the real encoded size
-  data_writer.WriteUInt32(buffer_size);
-  VLOG(5) << "partition output size: " << partition_output.size();
-  return partition_output;
+                                       output.data() + size_offset);
+  // Write the data size now that the encoded size is known
+  data_writer.WriteUInt32(compressed_size);
+  VLOG(5) << "partition output size: " << compressed_size + sizeof(uint32_t);
+  return absl::OkStatus();
 }
 
 class BrotliDecoder {
  public:
   // Owns the decoder memory
   explicit BrotliDecoder(BrotliDecoderState* decoder) : decoder_(decoder) {}
-  static absl::StatusOr<std::unique_ptr<BrotliDecoder>> Create() {
+  static absl::StatusOr<std::unique_ptr<BrotliDecoder>> Create(
+      const CompressionDictionary* dictionary) {
     BrotliDecoderState* decoder =
         BrotliDecoderCreateInstance(/* alloc_func= */ nullptr,
                                     /* free_func= */ nullptr,
@@ -78,7 +153,15 @@ class BrotliDecoder {
 
     BrotliDecoderSetParameter(
         decoder, BROTLI_DECODER_PARAM_DISABLE_RING_BUFFER_REALLOCATION, 1u);
-    return std::make_unique<BrotliDecoder>(decoder);
+    auto brotli_decoder = std::make_unique<BrotliDecoder>(decoder);
+    if (dictionary != nullptr &&
+        BrotliDecoderAttachDictionary(
+            decoder, BROTLI_SHARED_DICTIONARY_RAW, dictionary->data().size(),
+            reinterpret_cast<const uint8_t*>(dictionary->data().data())) ==
+            BROTLI_FALSE) {
+      return absl::InternalError("Brotli dictionary cannot be attached");
+    }
+    return brotli_decoder;
   }
 
   BrotliDecoder(const BrotliDecoder&) = delete;
@@ -166,17 +249,19 @@ class BrotliDecoder {
 }  // namespace
 
 absl::StatusOr<std::string> BrotliCompressionGroupConcatenator::Build() const {
-  std::vector<std::string> compression_groups;
+  std::string output;
+  // Reused by every partition.
+  std::string buffer(kEncoderOutputBufferSize, '\0');
   // Go through every partition to compress them one by one.
   for (const auto& partition : Partitions()) {
-    if (auto maybe_partition_output = CompressOnePartition(partition);
-        !maybe_partition_output.ok()) {
-      return maybe_partition_output.status();
-    } else {
-      compression_groups.push_back(std::move(maybe_partition_output).value());
+    if (absl::Status status =
+            CompressOnePartition(partition, quality_, window_,
+                                 dictionary_.get(), buffer, output);
+        !status.ok()) {
+      return status;
     }
   }
-  return absl::StrJoin(compression_groups, "");
+  return output;
 }
 
 absl::StatusOr<std::string>
@@ -192,8 +277,24 @@ BrotliCompressionBlobReader::ExtractOneCompressionGroup() {
   }
 
   quiche::QuicheDataReader compression_group_buffer_reader(compressed_data);
+  if (dictionary_ != nullptr) {
+    std::string_view magic;
+    std::string_view hash;
+    if (!compression_group_buffer_reader.ReadStringPiece(
+            &magic, kDictionaryCompressedBrotliMagic.size()) ||
+        magic != kDictionaryCompressedBrotliMagic ||
+        !compression_group_buffer_reader.ReadStringPiece(
+            &hash, kCompressionDictionaryHashSize)) {
+      return absl::InvalidArgumentError(
+          "Failed to read dictionary-compressed Brotli header");
+    }
+    if (hash != dictionary_->hash()) {
+      return absl::FailedPreconditionError(
+          "Compression group was compressed with another dictionary");
+    }
+  }
 
-  if (auto maybe_brotli_decoder = BrotliDecoder::Create();
+  if (auto maybe_brotli_decoder = BrotliDecoder::Create(dictionary_.get());
       !maybe_brotli_decoder.ok()) {
     return maybe_brotli_decoder.status();
   } else {
@@ -12,25 +12,51 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <memory>
 #include <string>
+#include <utility>
 
 #include "components/data_server/request_handler/compression.h"
+#include "components/data_server/request_handler/compression_dictionary.h"
 
 namespace kv_server {
 
 // Builds compression groups that are compressed by Brotli.
+//
+// With a `dictionary`, every compression group is a Dictionary-Compressed
+// Brotli stream: a header with the hash of the dictionary, followed by the
+// Brotli stream compressed with the dictionary.
 class BrotliCompressionGroupConcatenator : public CompressionGroupConcatenator {
  public:
+  explicit BrotliCompressionGroupConcatenator(
+      int quality = CompressionOptions().brotli_quality,
+      int window = CompressionOptions().brotli_window,
+      std::shared_ptr<const CompressionDictionary> dictionary = nullptr)
+      : quality_(quality),
+        window_(window),
+        dictionary_(std::move(dictionary)) {}
+
   absl::StatusOr<std::string> Build() const override;
+
+ private:
+  const int quality_;
+  const int window_;
+  const std::shared_ptr<const CompressionDictionary> dictionary_;
 };
 
 // Reads compression groups built with BrotliCompressionGroupConcatenator.
+// `dictionary` must be the one the compression groups were built with.
 class BrotliCompressionBlobReader : public CompressedBlobReader {
  public:
-  explicit BrotliCompressionBlobReader(std::string_view compressed)
-      : CompressedBlobReader(compressed) {}
+  explicit BrotliCompressionBlobReader(
+      std::string_view compressed,
+      std::shared_ptr<const CompressionDictionary> dictionary = nullptr)
+      : CompressedBlobReader(compressed), dictionary_(std::move(dictionary)) {}
 
   absl::StatusOr<std::string> ExtractOneCompressionGroup() override;
+
+ private:
+  const std::shared_ptr<const CompressionDictionary> dictionary_;
 };
 
 }  // namespace kv_server
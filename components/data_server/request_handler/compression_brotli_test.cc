@@ -14,8 +14,10 @@
 
 #include "components/data_server/request_handler/compression_brotli.h"
 
+#include <random>
 #include <string>
 #include <string_view>
+#include <vector>
 
 #include "absl/log/log.h"
 #include "components/data_server/request_handler/uncompressed.h"
@@ -91,5 +93,91 @@ TEST(CompressionGroupConcatenatorTest, Success) {
   EXPECT_TRUE(blob_reader.IsDoneReading());
 }
 
+TEST(CompressionGroupConcatenatorTest, LargeCompressionGroups) {
+  // Hardly compressible, so that the compressed groups are larger than the
+  // encoder output buffer.
+  std::mt19937 gen(42);
+  std::uniform_int_distribution<int> dist(0, 255);
+  std::vector<std::string> compression_groups(2);
+  for (std::string& compression_group : compression_groups) {
+    for (int i = 0; i < 1024 * 1024; i++) {
+      compression_group.push_back(static_cast<char>(dist(gen)));
+    }
+  }
+  BrotliCompressionGroupConcatenator concatenator(/*quality=*/1);
+  for (const std::string& compression_group : compression_groups) {
+    concatenator.AddCompressionGroup(compression_group);
+  }
+
+  auto maybe_output = concatenator.Build();
+  ASSERT_TRUE(maybe_output.ok()) << maybe_output.status();
+
+  BrotliCompressionBlobReader blob_reader(*maybe_output);
+  for (const std::string& compression_group : compression_groups) {
+    auto maybe_compression_group = blob_reader.ExtractOneCompressionGroup();
+    ASSERT_TRUE(maybe_compression_group.ok())
+        << maybe_compression_group.status();
+    EXPECT_EQ(*maybe_compression_group, compression_group);
+  }
+  EXPECT_TRUE(blob_reader.IsDoneReading());
+}
+
+constexpr std::string_view kDictionaryData =
+    R"({"key":"key","value":{"stringValue":"value"}})";
+
+TEST(CompressionGroupConcatenatorTest, SharedDictionary) {
+  auto dictionary = CompressionDictionary::Create(std::string(kDictionaryData),
+                                                  /*logical_commit_time=*/1,
+                                                  /*version=*/1);
+  ASSERT_TRUE(dictionary.ok()) << dictionary.status();
+  const std::string compression_group =
+      R"([{"key":"key","value":{"stringValue":"value1"}}])";
+  BrotliCompressionGroupConcatenator concatenator(
+      CompressionOptions().brotli_quality, CompressionOptions().brotli_window,
+      *dictionary);
+  concatenator.AddCompressionGroup(compression_group);
+  concatenator.AddCompressionGroup(compression_group);
+  auto maybe_output = concatenator.Build();
+  ASSERT_TRUE(maybe_output.ok()) << maybe_output.status();
+
+  BrotliCompressionGroupConcatenator no_dictionary_concatenator;
+  no_dictionary_concatenator.AddCompressionGroup(compression_group);
+  no_dictionary_concatenator.AddCompressionGroup(compression_group);
+  auto maybe_no_dictionary_output = no_dictionary_concatenator.Build();
+  ASSERT_TRUE(maybe_no_dictionary_output.ok())
+      << maybe_no_dictionary_output.status();
+  // Smaller even with the 36 byte header of every group.
+  EXPECT_LT(maybe_output->size(), maybe_no_dictionary_output->size());
+
+  BrotliCompressionBlobReader blob_reader(*maybe_output, *dictionary);
+  for (int i = 0; i < 2; i++) {
+    auto maybe_compression_group = blob_reader.ExtractOneCompressionGroup();
+    ASSERT_TRUE(maybe_compression_group.ok())
+        << maybe_compression_group.status();
+    EXPECT_EQ(*maybe_compression_group, compression_group);
+  }
+  EXPECT_TRUE(blob_reader.IsDoneReading());
+}
+
+TEST(CompressionBlobReaderTest, OtherSharedDictionaryFails) {
+  auto dictionary = CompressionDictionary::Create(std::string(kDictionaryData),
+                                                  /*logical_commit_time=*/1,
+                                                  /*version=*/1);
+  auto other_dictionary =
+      CompressionDictionary::Create("other", /*logical_commit_time=*/2,
+                                    /*version=*/2);
+  ASSERT_TRUE(dictionary.ok() && other_dictionary.ok());
+  BrotliCompressionGroupConcatenator concatenator(
+      CompressionOptions().brotli_quality, CompressionOptions().brotli_window,
+      *dictionary);
+  concatenator.AddCompressionGroup(std::string(kTestString));
+  auto maybe_output = concatenator.Build();
+  ASSERT_TRUE(maybe_output.ok()) << maybe_output.status();
+
+  BrotliCompressionBlobReader blob_reader(*maybe_output, *other_dictionary);
+  EXPECT_EQ(blob_reader.ExtractOneCompressionGroup().status().code(),
+            absl::StatusCode::kFailedPrecondition);
+}
+
 }  // namespace
 }  // namespace kv_server
@@ -0,0 +1,79 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/data_server/request_handler/compression_dictionary.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "absl/log/log.h"
+#include "openssl/sha.h"
+
+namespace kv_server {
+
+CompressionDictionary::~CompressionDictionary() {
+  if (prepared_dictionary_ != nullptr) {
+    BrotliEncoderDestroyPreparedDictionary(prepared_dictionary_);
+  }
+}
+
+absl::StatusOr<std::shared_ptr<const CompressionDictionary>>
+CompressionDictionary::Create(std::string data, int64_t logical_commit_time,
+                              int64_t version) {
+  if (data.empty()) {
+    return absl::InvalidArgumentError("Compression dictionary is empty");
+  }
+  std::string hash(kCompressionDictionaryHashSize, '\0');
+  SHA256(reinterpret_cast<const uint8_t*>(data.data()), data.size(),
+         reinterpret_cast<uint8_t*>(hash.data()));
+  // Not std::make_shared, the constructor is private.
+  std::shared_ptr<CompressionDictionary> dictionary(new CompressionDictionary(
+      std::move(data), std::move(hash), logical_commit_time, version));
+  dictionary->prepared_dictionary_ = BrotliEncoderPrepareDictionary(
+      BROTLI_SHARED_DICTIONARY_RAW, dictionary->data_.size(),
+      reinterpret_cast<const uint8_t*>(dictionary->data_.data()),
+      BROTLI_MAX_QUALITY, /* alloc_func= */ nullptr,
+      /* free_func= */ nullptr, /* opaque= */ nullptr);
+  if (dictionary->prepared_dictionary_ == nullptr) {
+    return absl::InternalError("Brotli dictionary cannot be prepared");
+  }
+  return dictionary;
+}
+
+bool CompressionDictionaryStore::Update(
+    std::shared_ptr<const CompressionDictionary> dictionary) {
+  absl::MutexLock lock(&mutex_);
+  if (dictionary_ != nullptr &&
+      dictionary->logical_commit_time() <= dictionary_->logical_commit_time()) {
+    VLOG(1) << "Ignoring compression dictionary version "
+            << dictionary->version() << ", logical commit time "
+            << dictionary->logical_commit_time()
+            << " is not newer than the one of version "
+            << dictionary_->version();
+    return false;
+  }
+  LOG(INFO) << "Using compression dictionary version " << dictionary->version()
+            << " of " << dictionary->data().size() << " bytes";
+  dictionary_ = std::move(dictionary);
+  return true;
+}
+
+std::shared_ptr<const CompressionDictionary> CompressionDictionaryStore::Get()
+    const {
+  absl::MutexLock lock(&mutex_);
+  return dictionary_;
+}
+
+}  // namespace kv_server
@@ -0,0 +1,100 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef COMPONENTS_DATA_SERVER_REQUEST_HANDLER_COMPRESSION_DICTIONARY_H_
+#define COMPONENTS_DATA_SERVER_REQUEST_HANDLER_COMPRESSION_DICTIONARY_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/status/statusor.h"
+#include "absl/synchronization/mutex.h"
+#include "brotli/encode.h"
+
+namespace kv_server {
+
+// Size of the SHA-256 hash that identifies a dictionary.
+inline constexpr size_t kCompressionDictionaryHashSize = 32;
+
+// Raw shared dictionary that Brotli compression groups can be compressed with,
+// as in
+// https://datatracker.ietf.org/doc/draft-ietf-httpbis-compression-dictionary/
+//
+// Immutable and thread-safe, so that requests can keep using a dictionary
+// after a newer one is loaded.
+class CompressionDictionary {
+ public:
+  ~CompressionDictionary();
+
+  CompressionDictionary(const CompressionDictionary&) = delete;
+  CompressionDictionary& operator=(const CompressionDictionary&) = delete;
+
+  static absl::StatusOr<std::shared_ptr<const CompressionDictionary>> Create(
+      std::string data, int64_t logical_commit_time, int64_t version);
+
+  std::string_view data() const { return data_; }
+  // SHA-256 of `data()`, which clients advertise and compressed groups refer
+  // to.
+  std::string_view hash() const { return hash_; }
+  int64_t logical_commit_time() const { return logical_commit_time_; }
+  int64_t version() const { return version_; }
+
+  // Dictionary prepared once for all the encoders that use it.
+  const BrotliEncoderPreparedDictionary* prepared_dictionary() const {
+    return prepared_dictionary_;
+  }
+
+ private:
+  CompressionDictionary(std::string data, std::string hash,
+                        int64_t logical_commit_time, int64_t version)
+      : data_(std::move(data)),
+        hash_(std::move(hash)),
+        logical_commit_time_(logical_commit_time),
+        version_(version) {}
+
+  const std::string data_;
+  const std::string hash_;
+  const int64_t logical_commit_time_;
+  const int64_t version_;
+  // References `data_`.
+  BrotliEncoderPreparedDictionary* prepared_dictionary_ = nullptr;
+};
+
+// Holds the newest loaded compression dictionary. Thread-safe.
+class CompressionDictionaryStore {
+ public:
+  // Replaces the current dictionary if `dictionary` has a larger logical
+  // commit time. Returns whether it was replaced.
+  bool Update(std::shared_ptr<const CompressionDictionary> dictionary)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Returns the current dictionary, or nullptr if none was loaded.
+  std::shared_ptr<const CompressionDictionary> Get() const
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+ private:
+  mutable absl::Mutex mutex_;
+  std::shared_ptr<const CompressionDictionary> dictionary_
+      ABSL_GUARDED_BY(mutex_);
+};
+
+}  // namespace kv_server
+
+#endif  // COMPONENTS_DATA_SERVER_REQUEST_HANDLER_COMPRESSION_DICTIONARY_H_
@@ -0,0 +1,79 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/data_server/request_handler/compression_dictionary.h"
+
+#include <memory>
+#include <string>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace kv_server {
+namespace {
+
+TEST(CompressionDictionaryTest, EmptyDictionaryFails) {
+  EXPECT_FALSE(CompressionDictionary::Create("", 1, 1).ok());
+}
+
+TEST(CompressionDictionaryTest, HashIdentifiesData) {
+  auto dictionary = CompressionDictionary::Create("dictionary", 1, 1);
+  ASSERT_TRUE(dictionary.ok()) << dictionary.status();
+  EXPECT_EQ((*dictionary)->data(), "dictionary");
+  EXPECT_EQ((*dictionary)->hash().size(), kCompressionDictionaryHashSize);
+  EXPECT_NE((*dictionary)->prepared_dictionary(), nullptr);
+
+  auto same_data = CompressionDictionary::Create("dictionary", 2, 2);
+  ASSERT_TRUE(same_data.ok()) << same_data.status();
+  EXPECT_EQ((*same_data)->hash(), (*dictionary)->hash());
+  auto other_data = CompressionDictionary::Create("dictionary2", 1, 1);
+  ASSERT_TRUE(other_data.ok()) << other_data.status();
+  EXPECT_NE((*other_data)->hash(), (*dictionary)->hash());
+}
+
+TEST(CompressionDictionaryStoreTest, EmptyStore) {
+  CompressionDictionaryStore store;
+  EXPECT_EQ(store.Get(), nullptr);
+}
+
+TEST(CompressionDictionaryStoreTest, KeepsNewestDictionary) {
+  CompressionDictionaryStore store;
+  auto first = CompressionDictionary::Create("first", 2, 1);
+  auto older = CompressionDictionary::Create("older", 1, 2);
+  auto newer = CompressionDictionary::Create("newer", 3, 3);
+  ASSERT_TRUE(first.ok() && older.ok() && newer.ok());
+
+  EXPECT_TRUE(store.Update(*first));
+  EXPECT_EQ(store.Get(), *first);
+  EXPECT_FALSE(store.Update(*older));
+  EXPECT_EQ(store.Get(), *first);
+  EXPECT_TRUE(store.Update(*newer));
+  EXPECT_EQ(store.Get(), *newer);
+}
+
+TEST(CompressionDictionaryStoreTest, SnapshotOutlivesUpdate) {
+  CompressionDictionaryStore store;
+  auto first = CompressionDictionary::Create("first", 1, 1);
+  auto second = CompressionDictionary::Create("second", 2, 2);
+  ASSERT_TRUE(first.ok() && second.ok());
+  ASSERT_TRUE(store.Update(*std::move(first)));
+  std::shared_ptr<const CompressionDictionary> snapshot = store.Get();
+
+  ASSERT_TRUE(store.Update(*std::move(second)));
+  EXPECT_EQ(snapshot->data(), "first");
+  EXPECT_EQ(store.Get()->data(), "second");
+}
+
+}  // namespace
+}  // namespace kv_server
@@ -0,0 +1,129 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/data_server/request_handler/compression_gzip.h"
+
+#include <algorithm>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/log/log.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_join.h"
+#include "quiche/common/quiche_data_writer.h"
+#include "zlib.h"
+
+namespace kv_server {
+
+namespace {
+
+// Window bits of zlib that select the gzip format with a 32KB window.
+constexpr int kGzipWindowBits = 15 + 16;
+constexpr int kMemLevel = 8;
+constexpr size_t kInflateChunkSize = 16 * 1024;
+
+// Responsible for compressing one compression group.
+absl::StatusOr<std::string> CompressOnePartition(std::string_view partition,
+                                                 int level) {
+  VLOG(5) << "Compressing " << partition;
+  z_stream stream = {};
+  if (deflateInit2(&stream, std::clamp(level, 1, 9), Z_DEFLATED,
+                   kGzipWindowBits, kMemLevel, Z_DEFAULT_STRATEGY) != Z_OK) {
+    return absl::InternalError("Gzip compressor cannot be initialized");
+  }
+  // The output consists of the size of the compressed data and the compressed
+  // data
+  std::string partition_output(
+      sizeof(uint32_t) + deflateBound(&stream, partition.size()), '\0');
+  stream.next_in =
+      reinterpret_cast<Bytef*>(const_cast<char*>(partition.data()));
+  stream.avail_in = partition.size();
+  stream.next_out =
+      reinterpret_cast<Bytef*>(&partition_output.at(sizeof(uint32_t)));
+  stream.avail_out = partition_output.size() - sizeof(uint32_t);
+  const int rc = deflate(&stream, Z_FINISH);
+  const size_t compressed_size = stream.total_out;
+  deflateEnd(&stream);
+  if (rc != Z_STREAM_END) {
+    return absl::InternalError(absl::StrCat("Gzip failed to compress: ", rc));
+  }
+  partition_output.resize(sizeof(uint32_t) + compressed_size);
+  quiche::QuicheDataWriter data_writer(sizeof(uint32_t),
+                                       partition_output.data());
+  data_writer.WriteUInt32(compressed_size);
+  VLOG(5) << "partition output size: " << partition_output.size();
+  return partition_output;
+}
+
+absl::StatusOr<std::string> Decompress(std::string_view compressed_data) {
+  z_stream stream = {};
+  if (inflateInit2(&stream, kGzipWindowBits) != Z_OK) {
+    return absl::InternalError("Gzip decompressor cannot be initialized");
+  }
+  stream.next_in =
+      reinterpret_cast<Bytef*>(const_cast<char*>(compressed_data.data()));
+  stream.avail_in = compressed_data.size();
+  std::vector<std::string> outputs;
+  int rc = Z_OK;
+  while (rc == Z_OK) {
+    std::string& output = outputs.emplace_back(kInflateChunkSize, '\0');
+    stream.next_out = reinterpret_cast<Bytef*>(output.data());
+    stream.avail_out = output.size();
+    rc = inflate(&stream, Z_NO_FLUSH);
+    output.resize(output.size() - stream.avail_out);
+  }
+  const bool exuberant = stream.avail_in != 0;
+  inflateEnd(&stream);
+  if (rc == Z_BUF_ERROR) {
+    return absl::DataLossError("corrupted (truncated) input");
+  }
+  if (rc != Z_STREAM_END) {
+    return absl::DataLossError(absl::StrCat("corrupted input: ", rc));
+  }
+  if (exuberant) {
+    return absl::DataLossError("corrupted (exuberant) input");
+  }
+  return absl::StrJoin(outputs, "");
+}
+
+}  // namespace
+
+absl::StatusOr<std::string> GzipCompressionGroupConcatenator::Build() const {
+  std::vector<std::string> compression_groups;
+  for (const auto& partition : Partitions()) {
+    auto maybe_partition_output = CompressOnePartition(partition, level_);
+    if (!maybe_partition_output.ok()) {
+      return maybe_partition_output.status();
+    }
+    compression_groups.push_back(std::move(maybe_partition_output).value());
+  }
+  return absl::StrJoin(compression_groups, "");
+}
+
+absl::StatusOr<std::string>
+GzipCompressionBlobReader::ExtractOneCompressionGroup() {
+  uint32_t compression_group_size = 0;
+  if (!data_reader_.ReadUInt32(&compression_group_size)) {
+    return absl::InvalidArgumentError("Failed to read compression group size");
+  }
+  VLOG(9) << "compression_group_size: " << compression_group_size;
+  std::string_view compressed_data;
+  if (!data_reader_.ReadStringPiece(&compressed_data, compression_group_size)) {
+    return absl::InvalidArgumentError("Failed to read compression group");
+  }
+  return Decompress(compressed_data);
+}
+
+}  // namespace kv_server
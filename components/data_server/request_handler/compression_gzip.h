@@ -0,0 +1,51 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef COMPONENTS_DATA_SERVER_REQUEST_HANDLER_COMPRESSION_GZIP_H_
+#define COMPONENTS_DATA_SERVER_REQUEST_HANDLER_COMPRESSION_GZIP_H_
+
+#include <string>
+#include <string_view>
+
+#include "components/data_server/request_handler/compression.h"
+
+namespace kv_server {
+
+// Builds compression groups that are compressed by Gzip.
+class GzipCompressionGroupConcatenator : public CompressionGroupConcatenator {
+ public:
+  explicit GzipCompressionGroupConcatenator(
+      int level = CompressionOptions().gzip_level)
+      : level_(level) {}
+
+  absl::StatusOr<std::string> Build() const override;
+
+ private:
+  const int level_;
+};
+
+// Reads compression groups built with GzipCompressionGroupConcatenator.
+class GzipCompressionBlobReader : public CompressedBlobReader {
+ public:
+  explicit GzipCompressionBlobReader(std::string_view compressed)
+      : CompressedBlobReader(compressed) {}
+
+  absl::StatusOr<std::string> ExtractOneCompressionGroup() override;
+};
+
+}  // namespace kv_server
+
+#endif  // COMPONENTS_DATA_SERVER_REQUEST_HANDLER_COMPRESSION_GZIP_H_
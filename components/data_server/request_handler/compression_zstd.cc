@@ -0,0 +1,104 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/data_server/request_handler/compression_zstd.h"
+
+#include <algorithm>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/log/log.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_join.h"
+#include "quiche/common/quiche_data_writer.h"
+#include "zstd.h"
+
+namespace kv_server {
+
+namespace {
+
+// Responsible for compressing one compression group.
+absl::StatusOr<std::string> CompressOnePartition(std::string_view partition,
+                                                 int level) {
+  VLOG(5) << "Compressing " << partition;
+  // The output consists of the size of the compressed data and the compressed
+  // data
+  std::string partition_output(
+      sizeof(uint32_t) + ZSTD_compressBound(partition.size()), '\0');
+  const size_t compressed_size = ZSTD_compress(
+      &partition_output.at(sizeof(uint32_t)),
+      partition_output.size() - sizeof(uint32_t), partition.data(),
+      partition.size(), std::clamp(level, 1, ZSTD_maxCLevel()));
+  if (ZSTD_isError(compressed_size)) {
+    return absl::InternalError(absl::StrCat("Zstd failed to compress: ",
+                                            ZSTD_getErrorName(compressed_size)));
+  }
+  partition_output.resize(sizeof(uint32_t) + compressed_size);
+  quiche::QuicheDataWriter data_writer(sizeof(uint32_t),
+                                       partition_output.data());
+  data_writer.WriteUInt32(compressed_size);
+  VLOG(5) << "partition output size: " << partition_output.size();
+  return partition_output;
+}
+
+absl::StatusOr<std::string> Decompress(std::string_view compressed_data) {
+  // Frames written by ZSTD_compress always hold their content size.
+  const unsigned long long content_size =  // NOLINT
+      ZSTD_getFrameContentSize(compressed_data.data(), compressed_data.size());
+  if (content_size == ZSTD_CONTENTSIZE_ERROR ||
+      content_size == ZSTD_CONTENTSIZE_UNKNOWN) {
+    return absl::DataLossError("corrupted input: invalid zstd frame header");
+  }
+  std::string output(content_size, '\0');
+  const size_t output_size =
+      ZSTD_decompress(output.data(), output.size(), compressed_data.data(),
+                      compressed_data.size());
+  if (ZSTD_isError(output_size)) {
+    return absl::DataLossError(
+        absl::StrCat("corrupted input: ", ZSTD_getErrorName(output_size)));
+  }
+  output.resize(output_size);
+  return output;
+}
+
+}  // namespace
+
+absl::StatusOr<std::string> ZstdCompressionGroupConcatenator::Build() const {
+  std::vector<std::string> compression_groups;
+  for (const auto& partition : Partitions()) {
+    auto maybe_partition_output = CompressOnePartition(partition, level_);
+    if (!maybe_partition_output.ok()) {
+      return maybe_partition_output.status();
+    }
+    compression_groups.push_back(std::move(maybe_partition_output).value());
+  }
+  return absl::StrJoin(compression_groups, "");
+}
+
+absl::StatusOr<std::string>
+ZstdCompressionBlobReader::ExtractOneCompressionGroup() {
+  uint32_t compression_group_size = 0;
+  if (!data_reader_.ReadUInt32(&compression_group_size)) {
+    return absl::InvalidArgumentError("Failed to read compression group size");
+  }
+  VLOG(9) << "compression_group_size: " << compression_group_size;
+  std::string_view compressed_data;
+  if (!data_reader_.ReadStringPiece(&compressed_data, compression_group_size)) {
+    return absl::InvalidArgumentError("Failed to read compression group");
+  }
+  return Decompress(compressed_data);
+}
+
+}  // namespace kv_server
@@ -0,0 +1,102 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/data_server/request_handler/compression_zstd.h"
+
+#include <string>
+#include <string_view>
+
+#include "components/data_server/request_handler/uncompressed.h"
+#include "gtest/gtest.h"
+
+namespace kv_server {
+namespace {
+
+const std::string_view kTestString = "large message";
+const std::string_view kTestString2 = "large message 2";
+
+TEST(ZstdCompressionGroupConcatenatorTest, Success) {
+  ZstdCompressionGroupConcatenator concatenator;
+  concatenator.AddCompressionGroup(std::string(kTestString));
+  concatenator.AddCompressionGroup(std::string(kTestString2));
+  const std::string large_message(500, 'a');
+  concatenator.AddCompressionGroup(large_message);
+
+  auto maybe_output = concatenator.Build();
+  ASSERT_TRUE(maybe_output.ok()) << maybe_output.status();
+  EXPECT_LT(maybe_output->size(), large_message.size());
+
+  ZstdCompressionBlobReader blob_reader(*maybe_output);
+  EXPECT_FALSE(blob_reader.IsDoneReading());
+
+  auto maybe_compression_group = blob_reader.ExtractOneCompressionGroup();
+  ASSERT_TRUE(maybe_compression_group.ok()) << maybe_compression_group.status();
+  EXPECT_EQ(*maybe_compression_group, kTestString);
+  EXPECT_FALSE(blob_reader.IsDoneReading());
+
+  maybe_compression_group = blob_reader.ExtractOneCompressionGroup();
+  ASSERT_TRUE(maybe_compression_group.ok()) << maybe_compression_group.status();
+  EXPECT_EQ(*maybe_compression_group, kTestString2);
+  EXPECT_FALSE(blob_reader.IsDoneReading());
+
+  maybe_compression_group = blob_reader.ExtractOneCompressionGroup();
+  ASSERT_TRUE(maybe_compression_group.ok()) << maybe_compression_group.status();
+  EXPECT_EQ(*maybe_compression_group, large_message);
+  EXPECT_TRUE(blob_reader.IsDoneReading());
+}
+
+TEST(ZstdCompressionGroupConcatenatorTest, ClampsOutOfRangeLevels) {
+  for (const int level : {-1, 0, 100}) {
+    ZstdCompressionGroupConcatenator concatenator(level);
+    concatenator.AddCompressionGroup(std::string(kTestString));
+    auto maybe_output = concatenator.Build();
+    ASSERT_TRUE(maybe_output.ok()) << maybe_output.status();
+    ZstdCompressionBlobReader blob_reader(*maybe_output);
+    auto maybe_compression_group = blob_reader.ExtractOneCompressionGroup();
+    ASSERT_TRUE(maybe_compression_group.ok())
+        << maybe_compression_group.status();
+    EXPECT_EQ(*maybe_compression_group, kTestString);
+  }
+}
+
+TEST(ZstdCompressionBlobReaderTest, FailsOnCorruptedInput) {
+  UncompressedConcatenator concatenator;
+  concatenator.AddCompressionGroup("not compressed");
+  auto maybe_blob = concatenator.Build();
+  ASSERT_TRUE(maybe_blob.ok());
+
+  ZstdCompressionBlobReader blob_reader(*maybe_blob);
+  EXPECT_EQ(blob_reader.ExtractOneCompressionGroup().status().code(),
+            absl::StatusCode::kDataLoss);
+}
+
+TEST(ZstdCompressionBlobReaderTest, FailsOnTruncatedInput) {
+  ZstdCompressionGroupConcatenator concatenator;
+  concatenator.AddCompressionGroup(std::string(kTestString));
+  auto maybe_output = concatenator.Build();
+  ASSERT_TRUE(maybe_output.ok()) << maybe_output.status();
+  // Drop the last byte of the only compression group.
+  std::string truncated = maybe_output->substr(sizeof(uint32_t));
+  truncated.pop_back();
+  UncompressedConcatenator truncated_concatenator;
+  truncated_concatenator.AddCompressionGroup(truncated);
+  auto maybe_blob = truncated_concatenator.Build();
+  ASSERT_TRUE(maybe_blob.ok());
+
+  ZstdCompressionBlobReader blob_reader(*maybe_blob);
+  EXPECT_FALSE(blob_reader.ExtractOneCompressionGroup().ok());
+}
+
+}  // namespace
+}  // namespace kv_server
@@ -58,8 +58,12 @@ UDFArgument BuildArgument(const RepeatedPtrField<std::string>& keys,
 
 v2::GetValuesRequest BuildV2Request(const v1::GetValuesRequest& v1_request) {
   v2::GetValuesRequest v2_request;
-  (*v2_request.mutable_metadata()->mutable_fields())["hostname"]
-      .set_string_value(v1_request.subkey());
+  auto& metadata = *v2_request.mutable_metadata()->mutable_fields();
+  metadata["hostname"].set_string_value(v1_request.subkey());
+  // UDFs that support it, like the native pass-through UDF, return the
+  // outputs as a proto, which is converted without JSON parsing.
+  metadata[std::string(application_pa::kAcceptsProtoOutputMetadataKey)]
+      .set_bool_value(true);
   auto* partition = v2_request.add_partitions();
 
   if (v1_request.keys_size() > 0) {
@@ -171,9 +175,10 @@ absl::Status ConvertToV1Response(const v2::GetValuesResponse& v2_response,
   }
   const std::string& string_output =
       v2_response.single_partition().string_output();
-  // string_output should be a JSON object
-  PS_ASSIGN_OR_RETURN(application_pa::KeyGroupOutputs outputs,
-                      application_pa::KeyGroupOutputsFromJson(string_output));
+  // string_output should be a JSON object, or the proto form of the outputs.
+  PS_ASSIGN_OR_RETURN(
+      application_pa::KeyGroupOutputs outputs,
+      application_pa::KeyGroupOutputsFromUdfOutput(string_output));
   for (const auto& key_group_output : outputs.key_group_outputs()) {
     ProcessKeyGroupOutput(key_group_output, v1_response);
   }
@@ -44,6 +44,12 @@ request_metadata {
       string_value: ""
     }
   }
+  fields {
+    key: "kvAcceptsProtoOutput"
+    value {
+      bool_value: true
+    }
+  }
 }
   )";
 
@@ -472,6 +478,55 @@ TEST_F(GetValuesAdapterTest, KeyGroupOutputHasDifferentValueTypesReturnsOk) {
   EXPECT_THAT(v1_response, EqualsProto(v1_expected));
 }
 
+TEST_F(GetValuesAdapterTest, ProtoOutputReturnsOk) {
+  application_pa::KeyGroupOutputs key_group_outputs;
+  TextFormat::ParseFromString(R"pb(
+                                key_group_outputs {
+                                  tags: "custom"
+                                  tags: "keys"
+                                  key_values {
+                                    key: "key1"
+                                    value { value { string_value: "[1, 2]" } }
+                                  }
+                                  key_values {
+                                    key: "key2"
+                                    value { value { string_value: "value2" } }
+                                  }
+                                }
+                                udf_output_api_version: 1
+                              )pb",
+                              &key_group_outputs);
+  EXPECT_CALL(mock_udf_client_, ExecuteCode(_, _, _))
+      .WillOnce(Return(
+          application_pa::KeyGroupOutputsToProtoOutput(key_group_outputs)));
+
+  v1::GetValuesRequest v1_request;
+  v1_request.add_keys("key1,key2");
+  v1::GetValuesResponse v1_response;
+  auto status = get_values_adapter_->CallV2Handler(v1_request, v1_response);
+  EXPECT_TRUE(status.ok()) << status.error_message();
+  v1::GetValuesResponse v1_expected;
+  TextFormat::ParseFromString(
+      R"pb(
+        keys {
+          key: "key1"
+          value {
+            value {
+              list_value {
+                values { number_value: 1 }
+                values { number_value: 2 }
+              }
+            }
+          }
+        }
+        keys {
+          key: "key2"
+          value { value { string_value: "value2" } }
+        })pb",
+      &v1_expected);
+  EXPECT_THAT(v1_response, EqualsProto(v1_expected));
+}
+
 TEST_F(GetValuesAdapterTest, ValueWithStatusSuccess) {
   nlohmann::json output = R"({
     "keyGroupOutputs": [{
@@ -14,18 +14,26 @@
 
 #include "components/data_server/request_handler/get_values_handler.h"
 
+#include <array>
 #include <iterator>
+#include <memory>
+#include <optional>
 #include <string>
+#include <string_view>
 #include <utility>
 #include <vector>
 
+#include "absl/functional/function_ref.h"
 #include "absl/log/log.h"
 #include "absl/strings/str_replace.h"
 #include "absl/strings/str_split.h"
+#include "absl/synchronization/blocking_counter.h"
 #include "components/data_server/request_handler/get_values_adapter.h"
 #include "grpcpp/grpcpp.h"
 #include "public/constants.h"
 #include "public/query/get_values.grpc.pb.h"
+#include "src/google/protobuf/io/coded_stream.h"
+#include "src/google/protobuf/io/zero_copy_stream_impl_lite.h"
 #include "src/google/protobuf/message.h"
 #include "src/google/protobuf/struct.pb.h"
 #include "src/telemetry/telemetry.h"
@@ -35,10 +43,20 @@ namespace {
 using google::protobuf::RepeatedPtrField;
 using google::protobuf::Struct;
 using google::protobuf::Value;
+using google::protobuf::io::CodedOutputStream;
+using google::protobuf::io::StringOutputStream;
 using grpc::StatusCode;
 using v1::GetValuesRequest;
 using v1::GetValuesResponse;
 using v1::KeyValueService;
+using v1::V1SingleLookupResult;
+using ResultMap = google::protobuf::Map<std::string, V1SingleLookupResult>;
+
+// Field numbers of the key and the value of map entries, fixed by the
+// protobuf encoding of maps.
+constexpr int kMapEntryKeyFieldNumber = 1;
+constexpr int kMapEntryValueFieldNumber = 2;
+constexpr std::string_view kKeyNotFoundMessage = "Key not found";
 
 absl::flat_hash_set<std::string_view> GetKeys(
     const RepeatedPtrField<std::string>& keys) {
@@ -52,43 +70,256 @@ absl::flat_hash_set<std::string_view> GetKeys(
   return key_list;
 }
 
-void ProcessKeys(
-    const RequestContext& request_context,
-    const RepeatedPtrField<std::string>& keys, const Cache& cache,
+// Adds the results of `keys` in `key_value_result` to `result_struct`.
+void AddResults(
+    const absl::flat_hash_set<std::string_view>& keys,
+    const GetKeyValueResult& key_value_result,
     google::protobuf::Map<std::string, v1::V1SingleLookupResult>& result_struct,
     bool add_missing_keys_v1) {
-  if (keys.empty()) return;
-  auto actual_keys = GetKeys(keys);
-  auto kv_pairs = cache.GetKeyValuePairs(request_context, actual_keys);
   // TODO(b/326118416): Record cache hit and miss metrics
-  for (const auto& key : actual_keys) {
+  for (const auto& key : keys) {
     v1::V1SingleLookupResult result;
-    const auto key_iter = kv_pairs.find(key);
-    if (key_iter == kv_pairs.end()) {
+    const auto value = key_value_result.GetValue(key);
+    if (!value.has_value()) {
       if (add_missing_keys_v1) {
         auto status = result.mutable_status();
         status->set_code(static_cast<int>(absl::StatusCode::kNotFound));
-        status->set_message("Key not found");
+        status->set_message(std::string(kKeyNotFoundMessage));
         result_struct[key] = std::move(result);
       }
+    } else if (const auto serialized_json =
+                   key_value_result.GetSerializedJsonValue(key);
+               serialized_json.has_value()) {
+      // The cache parsed the value when it was loaded, an empty form means
+      // that it is not JSON.
+      if (serialized_json->empty() ||
+          !result.mutable_value()->ParseFromArray(serialized_json->data(),
+                                                  serialized_json->size())) {
+        result.mutable_value()->set_string_value(std::string(*value));
+      }
+      result_struct[key] = std::move(result);
     } else {
       Value value_proto;
-      absl::Status status = google::protobuf::util::JsonStringToMessage(
-          key_iter->second, &value_proto);
+      absl::Status status =
+          google::protobuf::util::JsonStringToMessage(*value, &value_proto);
       if (status.ok()) {
-        *result.mutable_value() = value_proto;
+        *result.mutable_value() = std::move(value_proto);
       } else {
         // If string is not a Json string that can be parsed into Value
         // proto, simply set it as pure string value to the response.
-        google::protobuf::Value value;
-        value.set_string_value(std::move(key_iter->second));
-        *result.mutable_value() = std::move(value);
+        result.mutable_value()->set_string_value(std::string(*value));
       }
       result_struct[key] = std::move(result);
     }
   }
 }
 
+void ProcessKeys(
+    const RequestContext& request_context,
+    const RepeatedPtrField<std::string>& keys, const Cache& cache,
+    google::protobuf::Map<std::string, v1::V1SingleLookupResult>& result_struct,
+    bool add_missing_keys_v1) {
+  if (keys.empty()) return;
+  auto actual_keys = GetKeys(keys);
+  auto key_value_result = cache.GetKeyValues(request_context, actual_keys);
+  AddResults(actual_keys, *key_value_result, result_struct,
+             add_missing_keys_v1);
+}
+
+constexpr uint32_t VarintTag(int field_number) {
+  return static_cast<uint32_t>(field_number) << 3;
+}
+
+constexpr uint32_t LengthDelimitedTag(int field_number) {
+  return static_cast<uint32_t>(field_number) << 3 | 2;
+}
+
+// Returns the wire size of a length delimited field with `length` bytes.
+size_t LengthDelimitedSize(int field_number, size_t length) {
+  return CodedOutputStream::VarintSize32(LengthDelimitedTag(field_number)) +
+         CodedOutputStream::VarintSize64(length) + length;
+}
+
+void WriteLengthDelimitedHeader(int field_number, size_t length,
+                                CodedOutputStream& out) {
+  out.WriteTag(LengthDelimitedTag(field_number));
+  out.WriteVarint64(length);
+}
+
+// Writes the header of the entry of `key` in the map field `field_number`,
+// up to the point where `result_size` bytes of the serialized
+// `V1SingleLookupResult` follow.
+void WriteMapEntryHeader(int field_number, std::string_view key,
+                         size_t result_size, CodedOutputStream& out) {
+  WriteLengthDelimitedHeader(
+      field_number,
+      LengthDelimitedSize(kMapEntryKeyFieldNumber, key.size()) +
+          LengthDelimitedSize(kMapEntryValueFieldNumber, result_size),
+      out);
+  WriteLengthDelimitedHeader(kMapEntryKeyFieldNumber, key.size(), out);
+  out.WriteRaw(key.data(), key.size());
+  WriteLengthDelimitedHeader(kMapEntryValueFieldNumber, result_size, out);
+}
+
+// Writes an entry whose result is `value`. `serialized_json` is the
+// serialized `google.protobuf.Value` that `value` parses into, or empty if
+// `value` is not JSON, in which case it is written as a string value.
+void WriteValueEntry(int field_number, std::string_view key,
+                     std::string_view value, std::string_view serialized_json,
+                     CodedOutputStream& out) {
+  const size_t value_size =
+      serialized_json.empty()
+          ? LengthDelimitedSize(Value::kStringValueFieldNumber, value.size())
+          : serialized_json.size();
+  WriteMapEntryHeader(
+      field_number, key,
+      LengthDelimitedSize(V1SingleLookupResult::kValueFieldNumber, value_size),
+      out);
+  WriteLengthDelimitedHeader(V1SingleLookupResult::kValueFieldNumber,
+                             value_size, out);
+  if (serialized_json.empty()) {
+    WriteLengthDelimitedHeader(Value::kStringValueFieldNumber, value.size(),
+                               out);
+    out.WriteRaw(value.data(), value.size());
+  } else {
+    out.WriteRaw(serialized_json.data(), serialized_json.size());
+  }
+}
+
+void WriteKeyNotFoundEntry(int field_number, std::string_view key,
+                           CodedOutputStream& out) {
+  const int32_t code = static_cast<int32_t>(absl::StatusCode::kNotFound);
+  const size_t status_size =
+      CodedOutputStream::VarintSize32(
+          VarintTag(google::rpc::Status::kCodeFieldNumber)) +
+      CodedOutputStream::VarintSize32SignExtended(code) +
+      LengthDelimitedSize(google::rpc::Status::kMessageFieldNumber,
+                          kKeyNotFoundMessage.size());
+  WriteMapEntryHeader(
+      field_number, key,
+      LengthDelimitedSize(V1SingleLookupResult::kStatusFieldNumber,
+                          status_size),
+      out);
+  WriteLengthDelimitedHeader(V1SingleLookupResult::kStatusFieldNumber,
+                             status_size, out);
+  out.WriteTag(VarintTag(google::rpc::Status::kCodeFieldNumber));
+  out.WriteVarint32SignExtended(code);
+  WriteLengthDelimitedHeader(google::rpc::Status::kMessageFieldNumber,
+                             kKeyNotFoundMessage.size(), out);
+  out.WriteRaw(kKeyNotFoundMessage.data(), kKeyNotFoundMessage.size());
+}
+
+// Same as `AddResults`, but writes the results as the map field
+// `field_number` of a serialized `GetValuesResponse`, without building a
+// `V1SingleLookupResult` per key. Values that the cache precomputed as JSON
+// are copied as they are.
+void WriteResults(const absl::flat_hash_set<std::string_view>& keys,
+                  const GetKeyValueResult& key_value_result, int field_number,
+                  bool add_missing_keys_v1, CodedOutputStream& out) {
+  // Reused for the values that the cache did not precompute.
+  Value value_proto;
+  std::string parsed_json;
+  for (const auto& key : keys) {
+    const auto value = key_value_result.GetValue(key);
+    if (!value.has_value()) {
+      if (add_missing_keys_v1) {
+        WriteKeyNotFoundEntry(field_number, key, out);
+      }
+      continue;
+    }
+    std::optional<std::string_view> serialized_json =
+        key_value_result.GetSerializedJsonValue(key);
+    if (!serialized_json.has_value()) {
+      parsed_json.clear();
+      value_proto.Clear();
+      if (google::protobuf::util::JsonStringToMessage(*value, &value_proto)
+              .ok()) {
+        value_proto.AppendToString(&parsed_json);
+      }
+      serialized_json = parsed_json;
+    }
+    WriteValueEntry(field_number, key, *value, *serialized_json, out);
+  }
+}
+
+// Same as `ProcessKeys`, but writes the results with `WriteResults`.
+void SerializeKeys(const RequestContext& request_context,
+                   const RepeatedPtrField<std::string>& keys,
+                   const Cache& cache, int field_number,
+                   bool add_missing_keys_v1, CodedOutputStream& out) {
+  if (keys.empty()) return;
+  auto actual_keys = GetKeys(keys);
+  auto key_value_result = cache.GetKeyValues(request_context, actual_keys);
+  WriteResults(actual_keys, *key_value_result, field_number,
+               add_missing_keys_v1, out);
+}
+
+// The keys of the namespaces of a request, looked up at once.
+struct MergedLookup {
+  // The keys of every namespace, in the order of `NamespaceKeys`.
+  std::array<absl::flat_hash_set<std::string_view>, 4> keys;
+  size_t num_keys = 0;
+  std::unique_ptr<GetKeyValueResult> result;
+};
+
+// Returns the keys of the namespaces of `request`, in field number order of
+// the response.
+std::array<const RepeatedPtrField<std::string>*, 4> NamespaceKeys(
+    const GetValuesRequest& request) {
+  return {&request.keys(), &request.render_urls(),
+          &request.ad_component_render_urls(), &request.kv_internal()};
+}
+
+// Looks up the keys of every namespace of `request` with a single cache
+// lookup, so that the keys shared by namespaces are looked up once.
+MergedLookup LookUpNamespaces(const RequestContext& request_context,
+                              const GetValuesRequest& request,
+                              const Cache& cache) {
+  MergedLookup lookup;
+  absl::flat_hash_set<std::string_view> all_keys;
+  const auto namespaces = NamespaceKeys(request);
+  for (size_t i = 0; i < namespaces.size(); i++) {
+    lookup.keys[i] = GetKeys(*namespaces[i]);
+    lookup.num_keys += lookup.keys[i].size();
+    all_keys.insert(lookup.keys[i].begin(), lookup.keys[i].end());
+  }
+  if (!all_keys.empty()) {
+    lookup.result = cache.GetKeyValues(request_context, all_keys);
+  }
+  return lookup;
+}
+
+// Calls `fn` with the index of every namespace of `lookup` that has keys.
+// If `thread_pool` is not null and `lookup` has at least `min_parallel_keys`
+// keys, the namespaces are processed concurrently, the first one on the
+// calling thread.
+void ForEachNamespace(const MergedLookup& lookup, ThreadPool* thread_pool,
+                      size_t min_parallel_keys,
+                      absl::FunctionRef<void(size_t)> fn) {
+  std::vector<size_t> indices;
+  for (size_t i = 0; i < lookup.keys.size(); i++) {
+    if (!lookup.keys[i].empty()) {
+      indices.push_back(i);
+    }
+  }
+  if (thread_pool == nullptr || lookup.num_keys < min_parallel_keys ||
+      indices.size() < 2) {
+    for (size_t i : indices) {
+      fn(i);
+    }
+    return;
+  }
+  absl::BlockingCounter counter(indices.size() - 1);
+  for (size_t j = 1; j < indices.size(); j++) {
+    thread_pool->Schedule([&fn, &counter, i = indices[j]]() {
+      fn(i);
+      counter.DecrementCount();
+    });
+  }
+  fn(indices[0]);
+  counter.Wait();
+}
+
 }  // namespace
 
 grpc::Status GetValuesHandler::GetValues(const RequestContext& request_context,
@@ -98,6 +329,21 @@ grpc::Status GetValuesHandler::GetValues(const RequestContext& request_context,
     VLOG(5) << "Using V2 adapter for " << request.DebugString();
     return adapter_.CallV2Handler(request, *response);
   }
+  if (merge_namespace_lookups_) {
+    VLOG(5) << "Processing merged namespaces for " << request.DebugString();
+    const MergedLookup lookup =
+        LookUpNamespaces(request_context, request, cache_);
+    const std::array<ResultMap*, 4> results = {
+        response->mutable_keys(), response->mutable_render_urls(),
+        response->mutable_ad_component_render_urls(),
+        response->mutable_kv_internal()};
+    ForEachNamespace(lookup, thread_pool_, kMinParallelKeys,
+                     [this, &lookup, &results](size_t i) {
+                       AddResults(lookup.keys[i], *lookup.result, *results[i],
+                                  add_missing_keys_v1_);
+                     });
+    return grpc::Status::OK;
+  }
   if (!request.kv_internal().empty()) {
     VLOG(5) << "Processing kv_internal for " << request.DebugString();
     ProcessKeys(request_context, request.kv_internal(), cache_,
@@ -123,4 +369,60 @@ grpc::Status GetValuesHandler::GetValues(const RequestContext& request_context,
   return grpc::Status::OK;
 }
 
+grpc::Status GetValuesHandler::GetValuesSerialized(
+    const RequestContext& request_context, const GetValuesRequest& request,
+    std::string* serialized_response) const {
+  if (use_v2_) {
+    GetValuesResponse response;
+    grpc::Status status = GetValues(request_context, request, &response);
+    if (status.ok()) {
+      response.SerializeToString(serialized_response);
+    }
+    return status;
+  }
+  serialized_response->clear();
+  if (merge_namespace_lookups_) {
+    const MergedLookup lookup =
+        LookUpNamespaces(request_context, request, cache_);
+    constexpr std::array<int, 4> kFieldNumbers = {
+        GetValuesResponse::kKeysFieldNumber,
+        GetValuesResponse::kRenderUrlsFieldNumber,
+        GetValuesResponse::kAdComponentRenderUrlsFieldNumber,
+        GetValuesResponse::kKvInternalFieldNumber};
+    // Every namespace is written on its own, and the fields are concatenated
+    // in field number order.
+    std::array<std::string, 4> serialized_fields;
+    ForEachNamespace(
+        lookup, thread_pool_, kMinParallelKeys,
+        [this, &lookup, &kFieldNumbers, &serialized_fields](size_t i) {
+          StringOutputStream string_stream(&serialized_fields[i]);
+          CodedOutputStream out(&string_stream);
+          WriteResults(lookup.keys[i], *lookup.result, kFieldNumbers[i],
+                       add_missing_keys_v1_, out);
+          out.Trim();
+        });
+    for (const std::string& field : serialized_fields) {
+      serialized_response->append(field);
+    }
+    return grpc::Status::OK;
+  }
+  StringOutputStream string_stream(serialized_response);
+  CodedOutputStream out(&string_stream);
+  // Fields are written in field number order, like the generated serializer.
+  SerializeKeys(request_context, request.keys(), cache_,
+                GetValuesResponse::kKeysFieldNumber, add_missing_keys_v1_,
+                out);
+  SerializeKeys(request_context, request.render_urls(), cache_,
+                GetValuesResponse::kRenderUrlsFieldNumber,
+                add_missing_keys_v1_, out);
+  SerializeKeys(request_context, request.ad_component_render_urls(), cache_,
+                GetValuesResponse::kAdComponentRenderUrlsFieldNumber,
+                add_missing_keys_v1_, out);
+  SerializeKeys(request_context, request.kv_internal(), cache_,
+                GetValuesResponse::kKvInternalFieldNumber,
+                add_missing_keys_v1_, out);
+  out.Trim();
+  return grpc::Status::OK;
+}
+
 }  // namespace kv_server
@@ -22,6 +22,7 @@
 #include <utility>
 
 #include "components/data_server/request_handler/get_values_adapter.h"
+#include "components/util/thread_pool.h"
 #include "grpcpp/grpcpp.h"
 #include "public/query/get_values.grpc.pb.h"
 #include "src/google/protobuf/struct.pb.h"
@@ -32,24 +33,46 @@ namespace kv_server {
 // See the Service proto definition for details.
 class GetValuesHandler {
  public:
+  // Requests with at least this many keys have their namespaces processed
+  // concurrently, if they are looked up together and a thread pool is given.
+  static constexpr size_t kMinParallelKeys = 1000;
+
+  // If `merge_namespace_lookups`, the keys of all the namespaces of a request
+  // are looked up with a single cache lookup, rather than one per namespace,
+  // and the results of the namespaces of large requests are built on
+  // `thread_pool`, if not null.
   explicit GetValuesHandler(const Cache& cache, const GetValuesAdapter& adapter,
-                            bool use_v2, bool add_missing_keys_v1 = true)
+                            bool use_v2, bool add_missing_keys_v1 = true,
+                            bool merge_namespace_lookups = false,
+                            ThreadPool* thread_pool = nullptr)
       : cache_(std::move(cache)),
         adapter_(std::move(adapter)),
         use_v2_(use_v2),
-        add_missing_keys_v1_(add_missing_keys_v1) {}
+        add_missing_keys_v1_(add_missing_keys_v1),
+        merge_namespace_lookups_(merge_namespace_lookups),
+        thread_pool_(thread_pool) {}
 
   // TODO: Implement hostname, ad/render url lookups.
   grpc::Status GetValues(const RequestContext& request_context,
                          const v1::GetValuesRequest& request,
                          v1::GetValuesResponse* response) const;
 
+  // Same as `GetValues`, but writes the serialized `v1::GetValuesResponse`
+  // straight from the cache values into `serialized_response`, without
+  // building a result proto per key. Map entries may come in a different
+  // order than in `GetValues`.
+  grpc::Status GetValuesSerialized(const RequestContext& request_context,
+                                   const v1::GetValuesRequest& request,
+                                   std::string* serialized_response) const;
+
  private:
   const Cache& cache_;
   const GetValuesAdapter& adapter_;
   // If true, routes requests through V2 (UDF). Otherwise, calls cache.
   const bool use_v2_;
   const bool add_missing_keys_v1_;
+  const bool merge_namespace_lookups_;
+  ThreadPool* thread_pool_;
 };
 
 }  // namespace kv_server
@@ -0,0 +1,115 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Compares building V1 responses as protos, serialized afterwards like gRPC
+// does, with writing the serialized responses directly from the cache.
+//
+// Half of the values are JSON lists and half are plain strings. The second
+// argument selects whether the cache precomputes the JSON values.
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_join.h"
+#include "benchmark/benchmark.h"
+#include "components/data_server/cache/key_value_cache.h"
+#include "components/data_server/request_handler/get_values_handler.h"
+#include "components/telemetry/server_definition.h"
+
+namespace kv_server {
+namespace {
+
+using v1::GetValuesRequest;
+using v1::GetValuesResponse;
+
+// V1 requests are never routed to V2 here.
+class UnusedGetValuesAdapter : public GetValuesAdapter {
+ public:
+  grpc::Status CallV2Handler(const GetValuesRequest& v1_request,
+                             GetValuesResponse& v1_response) const override {
+    return grpc::Status(grpc::StatusCode::UNIMPLEMENTED, "Not used");
+  }
+};
+
+struct BenchmarkInput {
+  std::unique_ptr<Cache> cache;
+  GetValuesRequest request;
+};
+
+BenchmarkInput MakeInput(int num_keys, bool precompute_json_values) {
+  BenchmarkInput input{
+      .cache = KeyValueCache::Create(/*intern_set_values=*/false,
+                                     precompute_json_values),
+  };
+  std::vector<std::string> keys;
+  keys.reserve(num_keys);
+  for (int i = 0; i < num_keys; i++) {
+    std::string key = absl::StrCat("key", i);
+    input.cache->UpdateKeyValue(
+        key,
+        i % 2 == 0 ? absl::StrCat(R"json(["value", )json", i, "]")
+                   : absl::StrCat("value", i),
+        1);
+    keys.push_back(std::move(key));
+  }
+  input.request.add_keys(absl::StrJoin(keys, ","));
+  return input;
+}
+
+void BM_ProtoResponse(benchmark::State& state) {
+  const BenchmarkInput input = MakeInput(state.range(0), state.range(1));
+  UnusedGetValuesAdapter adapter;
+  GetValuesHandler handler(*input.cache, adapter, /*use_v2=*/false);
+  ScopeMetricsContext scope_metrics_context;
+  for (auto _ : state) {
+    RequestContext request_context(scope_metrics_context);
+    GetValuesResponse response;
+    handler.GetValues(request_context, input.request, &response);
+    std::string serialized_response = response.SerializeAsString();
+    benchmark::DoNotOptimize(serialized_response);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+void BM_SerializedResponse(benchmark::State& state) {
+  const BenchmarkInput input = MakeInput(state.range(0), state.range(1));
+  UnusedGetValuesAdapter adapter;
+  GetValuesHandler handler(*input.cache, adapter, /*use_v2=*/false);
+  ScopeMetricsContext scope_metrics_context;
+  for (auto _ : state) {
+    RequestContext request_context(scope_metrics_context);
+    std::string serialized_response;
+    handler.GetValuesSerialized(request_context, input.request,
+                                &serialized_response);
+    benchmark::DoNotOptimize(serialized_response);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+BENCHMARK(BM_ProtoResponse)->ArgsProduct({{10, 1000, 10000}, {0, 1}});
+BENCHMARK(BM_SerializedResponse)->ArgsProduct({{10, 1000, 10000}, {0, 1}});
+
+}  // namespace
+}  // namespace kv_server
+
+int main(int argc, char** argv) {
+  ::benchmark::Initialize(&argc, argv);
+  kv_server::InitMetricsContextMap();
+  ::benchmark::RunSpecifiedBenchmarks();
+  ::benchmark::Shutdown();
+  return 0;
+}
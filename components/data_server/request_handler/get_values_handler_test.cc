@@ -19,10 +19,12 @@
 #include <utility>
 #include <vector>
 
+#include "absl/strings/str_cat.h"
 #include "components/data_server/cache/cache.h"
 #include "components/data_server/cache/key_value_cache.h"
 #include "components/data_server/cache/mocks.h"
 #include "components/data_server/request_handler/mocks.h"
+#include "components/util/thread_pool.h"
 #include "gmock/gmock.h"
 #include "google/protobuf/text_format.h"
 #include "grpcpp/grpcpp.h"
@@ -59,10 +61,11 @@ class GetValuesHandlerTest : public ::testing::Test {
 };
 
 TEST_F(GetValuesHandlerTest, ReturnsExistingKeyTwice) {
-  EXPECT_CALL(mock_cache_, GetKeyValuePairs(_, UnorderedElementsAre("my_key")))
+  EXPECT_CALL(mock_cache_, GetKeyValues(_, UnorderedElementsAre("my_key")))
       .Times(2)
-      .WillRepeatedly(Return(absl::flat_hash_map<std::string, std::string>{
-          {"my_key", "my_value"}}));
+      .WillRepeatedly(
+          ReturnKeyValues(absl::flat_hash_map<std::string, std::string>{
+              {"my_key", "my_value"}}));
   GetValuesRequest request;
   request.add_keys("my_key");
   GetValuesResponse response;
@@ -88,9 +91,9 @@ TEST_F(GetValuesHandlerTest, ReturnsExistingKeyTwice) {
 
 TEST_F(GetValuesHandlerTest, RepeatedKeys) {
   EXPECT_CALL(mock_cache_,
-              GetKeyValuePairs(_, UnorderedElementsAre("key1", "key2", "key3")))
+              GetKeyValues(_, UnorderedElementsAre("key1", "key2", "key3")))
       .Times(1)
-      .WillRepeatedly(Return(
+      .WillRepeatedly(ReturnKeyValues(
           absl::flat_hash_map<std::string, std::string>{{"key1", "value1"}}));
   GetValuesRequest request;
   request.add_keys("key1,key2,key3");
@@ -121,9 +124,9 @@ TEST_F(GetValuesHandlerTest, RepeatedKeys) {
 
 TEST_F(GetValuesHandlerTest, RepeatedKeysSkipEmpty) {
   EXPECT_CALL(mock_cache_,
-              GetKeyValuePairs(_, UnorderedElementsAre("key1", "key2", "key3")))
+              GetKeyValues(_, UnorderedElementsAre("key1", "key2", "key3")))
       .Times(1)
-      .WillRepeatedly(Return(
+      .WillRepeatedly(ReturnKeyValues(
           absl::flat_hash_map<std::string, std::string>{{"key1", "value1"}}));
   GetValuesRequest request;
   request.add_keys("key1,key2,key3");
@@ -146,10 +149,11 @@ TEST_F(GetValuesHandlerTest, RepeatedKeysSkipEmpty) {
 
 TEST_F(GetValuesHandlerTest, ReturnsMultipleExistingKeysSameNamespace) {
   EXPECT_CALL(mock_cache_,
-              GetKeyValuePairs(_, UnorderedElementsAre("key1", "key2")))
+              GetKeyValues(_, UnorderedElementsAre("key1", "key2")))
       .Times(1)
-      .WillOnce(Return(absl::flat_hash_map<std::string, std::string>{
-          {"key1", "value1"}, {"key2", "value2"}}));
+      .WillOnce(
+          ReturnKeyValues(absl::flat_hash_map<std::string, std::string>{
+              {"key1", "value1"}, {"key2", "value2"}}));
   GetValuesRequest request;
   request.add_keys("key1");
   request.add_keys("key2");
@@ -173,13 +177,13 @@ TEST_F(GetValuesHandlerTest, ReturnsMultipleExistingKeysSameNamespace) {
 }
 
 TEST_F(GetValuesHandlerTest, ReturnsMultipleExistingKeysDifferentNamespace) {
-  EXPECT_CALL(mock_cache_, GetKeyValuePairs(_, UnorderedElementsAre("key1")))
+  EXPECT_CALL(mock_cache_, GetKeyValues(_, UnorderedElementsAre("key1")))
       .Times(1)
-      .WillOnce(Return(
+      .WillOnce(ReturnKeyValues(
           absl::flat_hash_map<std::string, std::string>{{"key1", "value1"}}));
-  EXPECT_CALL(mock_cache_, GetKeyValuePairs(_, UnorderedElementsAre("key2")))
+  EXPECT_CALL(mock_cache_, GetKeyValues(_, UnorderedElementsAre("key2")))
       .Times(1)
-      .WillOnce(Return(
+      .WillOnce(ReturnKeyValues(
           absl::flat_hash_map<std::string, std::string>{{"key2", "value2"}}));
   GetValuesRequest request;
   request.add_render_urls("key1");
@@ -279,10 +283,11 @@ TEST_F(GetValuesHandlerTest, TestResponseOnDifferentValueFormats) {
   })json";
 
   EXPECT_CALL(mock_cache_,
-              GetKeyValuePairs(_, UnorderedElementsAre("key1", "key2", "key3")))
+              GetKeyValues(_, UnorderedElementsAre("key1", "key2", "key3")))
       .Times(1)
-      .WillOnce(Return(absl::flat_hash_map<std::string, std::string>{
-          {"key1", value1}, {"key2", value2}, {"key3", value3}}));
+      .WillOnce(
+          ReturnKeyValues(absl::flat_hash_map<std::string, std::string>{
+              {"key1", value1}, {"key2", value2}, {"key3", value3}}));
 
   GetValuesRequest request;
   request.add_keys("key1");
@@ -301,6 +306,186 @@ TEST_F(GetValuesHandlerTest, TestResponseOnDifferentValueFormats) {
   EXPECT_THAT(response, EqualsProto(expected_from_json));
 }
 
+TEST_F(GetValuesHandlerTest, MergedNamespacesAreLookedUpOnce) {
+  EXPECT_CALL(mock_cache_,
+              GetKeyValues(_, UnorderedElementsAre("key1", "key2")))
+      .Times(1)
+      .WillOnce(ReturnKeyValues(absl::flat_hash_map<std::string, std::string>{
+          {"key1", "value1"}, {"key2", "value2"}}));
+  GetValuesRequest request;
+  request.add_render_urls("key1");
+  request.add_ad_component_render_urls("key1,key2");
+  GetValuesResponse response;
+  GetValuesHandler handler(mock_cache_, mock_get_values_adapter_,
+                           /*use_v2=*/false, /*add_missing_keys_v1=*/true,
+                           /*merge_namespace_lookups=*/true);
+  ASSERT_TRUE(handler.GetValues(GetRequestContext(), request, &response).ok());
+
+  GetValuesResponse expected;
+  TextFormat::ParseFromString(R"pb(render_urls {
+                                     key: "key1"
+                                     value { value { string_value: "value1" } }
+                                   }
+                                   ad_component_render_urls {
+                                     key: "key1"
+                                     value { value { string_value: "value1" } }
+                                   }
+                                   ad_component_render_urls {
+                                     key: "key2"
+                                     value { value { string_value: "value2" } }
+                                   })pb",
+                              &expected);
+  EXPECT_THAT(response, EqualsProto(expected));
+}
+
+TEST_F(GetValuesHandlerTest, MergedNamespacesGiveTheSameResponse) {
+  std::unique_ptr<Cache> cache = KeyValueCache::Create();
+  GetValuesRequest request;
+  // Enough keys for the namespaces to be processed concurrently.
+  for (size_t i = 0; i < GetValuesHandler::kMinParallelKeys; i++) {
+    const std::string key = absl::StrCat("key", i);
+    cache->UpdateKeyValue(key, i % 2 == 0 ? "[1, 2]" : "value", 1);
+    request.add_keys(key);
+    if (i % 3 == 0) {
+      request.add_render_urls(key);
+    }
+    if (i % 5 == 0) {
+      request.add_kv_internal(key);
+    }
+  }
+  request.add_ad_component_render_urls("key1,missing");
+  ThreadPool thread_pool(/*num_threads=*/2);
+
+  for (ThreadPool* pool : {static_cast<ThreadPool*>(nullptr), &thread_pool}) {
+    for (bool add_missing_keys_v1 : {true, false}) {
+      GetValuesHandler handler(*cache, mock_get_values_adapter_,
+                               /*use_v2=*/false, add_missing_keys_v1);
+      GetValuesHandler merging_handler(*cache, mock_get_values_adapter_,
+                                       /*use_v2=*/false, add_missing_keys_v1,
+                                       /*merge_namespace_lookups=*/true, pool);
+      GetValuesResponse expected;
+      ASSERT_TRUE(
+          handler.GetValues(GetRequestContext(), request, &expected).ok());
+      GetValuesResponse response;
+      ASSERT_TRUE(
+          merging_handler.GetValues(GetRequestContext(), request, &response)
+              .ok());
+      EXPECT_THAT(response, EqualsProto(expected));
+
+      std::string serialized_response;
+      ASSERT_TRUE(merging_handler
+                      .GetValuesSerialized(GetRequestContext(), request,
+                                           &serialized_response)
+                      .ok());
+      GetValuesResponse serialized;
+      ASSERT_TRUE(serialized.ParseFromString(serialized_response));
+      EXPECT_THAT(serialized, EqualsProto(expected));
+    }
+  }
+}
+
+TEST_F(GetValuesHandlerTest, PrecomputedJsonValuesGiveTheSameResponse) {
+  std::unique_ptr<Cache> cache = KeyValueCache::Create();
+  std::unique_ptr<Cache> precomputing_cache = KeyValueCache::Create(
+      /*intern_set_values=*/false, /*precompute_json_values=*/true);
+  for (Cache* c : {cache.get(), precomputing_cache.get()}) {
+    c->UpdateKeyValue("key1", R"json([[1, 2], null, {"k": "v"}])json", 1);
+    c->UpdateKeyValue("key2", R"json("quoted")json", 1);
+    c->UpdateKeyValue("key3", "v3", 1);
+  }
+  GetValuesRequest request;
+  request.add_keys("key1,key2,key3,missing");
+
+  GetValuesResponse expected;
+  GetValuesHandler handler(*cache, mock_get_values_adapter_,
+                           /*use_v2=*/false, /*add_missing_keys_v1=*/true);
+  ASSERT_TRUE(handler.GetValues(GetRequestContext(), request, &expected).ok());
+  GetValuesResponse response;
+  GetValuesHandler precomputing_handler(*precomputing_cache,
+                                        mock_get_values_adapter_,
+                                        /*use_v2=*/false,
+                                        /*add_missing_keys_v1=*/true);
+  ASSERT_TRUE(precomputing_handler
+                  .GetValues(GetRequestContext(), request, &response)
+                  .ok());
+  EXPECT_THAT(response, EqualsProto(expected));
+  EXPECT_EQ(response.keys().at("key2").value().string_value(), "quoted");
+  EXPECT_EQ(response.keys().at("key3").value().string_value(), "v3");
+  EXPECT_EQ(response.keys().at("missing").status().code(),
+            static_cast<int>(absl::StatusCode::kNotFound));
+}
+
+TEST_F(GetValuesHandlerTest, SerializedResponseMatchesProtoResponse) {
+  std::unique_ptr<Cache> cache = KeyValueCache::Create();
+  std::unique_ptr<Cache> precomputing_cache = KeyValueCache::Create(
+      /*intern_set_values=*/false, /*precompute_json_values=*/true);
+  for (Cache* c : {cache.get(), precomputing_cache.get()}) {
+    c->UpdateKeyValue("key1", R"json([[1, 2], null, {"k": "v"}])json", 1);
+    c->UpdateKeyValue("key2", R"json("quoted")json", 1);
+    c->UpdateKeyValue("key3", "v3", 1);
+    c->UpdateKeyValue("key4", "", 1);
+  }
+  GetValuesRequest request;
+  request.add_keys("key1,key2,missing");
+  request.add_render_urls("key3");
+  request.add_ad_component_render_urls("key4,missing");
+  request.add_kv_internal("key1");
+
+  for (Cache* c : {cache.get(), precomputing_cache.get()}) {
+    for (bool add_missing_keys_v1 : {true, false}) {
+      GetValuesHandler handler(*c, mock_get_values_adapter_,
+                               /*use_v2=*/false, add_missing_keys_v1);
+      GetValuesResponse expected;
+      ASSERT_TRUE(
+          handler.GetValues(GetRequestContext(), request, &expected).ok());
+      std::string serialized_response;
+      ASSERT_TRUE(handler
+                      .GetValuesSerialized(GetRequestContext(), request,
+                                           &serialized_response)
+                      .ok());
+      GetValuesResponse response;
+      ASSERT_TRUE(response.ParseFromString(serialized_response));
+      EXPECT_THAT(response, EqualsProto(expected));
+    }
+  }
+}
+
+TEST_F(GetValuesHandlerTest, SerializedResponseOfEmptyRequestIsEmpty) {
+  GetValuesHandler handler(mock_cache_, mock_get_values_adapter_,
+                           /*use_v2=*/false);
+  std::string serialized_response = "stale";
+  ASSERT_TRUE(handler
+                  .GetValuesSerialized(GetRequestContext(), GetValuesRequest(),
+                                       &serialized_response)
+                  .ok());
+  EXPECT_TRUE(serialized_response.empty());
+}
+
+TEST_F(GetValuesHandlerTest, SerializedResponseCallsV2Adapter) {
+  GetValuesResponse adapter_response;
+  TextFormat::ParseFromString(R"pb(keys {
+                                     key: "key1"
+                                     value { value { string_value: "value1" } }
+                                   })pb",
+                              &adapter_response);
+  EXPECT_CALL(mock_get_values_adapter_, CallV2Handler(_, _))
+      .WillOnce(DoAll(SetArgReferee<1>(adapter_response),
+                      Return(grpc::Status::OK)));
+
+  GetValuesRequest request;
+  request.add_keys("key1");
+  GetValuesHandler handler(mock_cache_, mock_get_values_adapter_,
+                           /*use_v2=*/true);
+  std::string serialized_response;
+  ASSERT_TRUE(handler
+                  .GetValuesSerialized(GetRequestContext(), request,
+                                       &serialized_response)
+                  .ok());
+  GetValuesResponse response;
+  ASSERT_TRUE(response.ParseFromString(serialized_response));
+  EXPECT_THAT(response, EqualsProto(adapter_response));
+}
+
 TEST_F(GetValuesHandlerTest, CallsV2Adapter) {
   GetValuesResponse adapter_response;
   TextFormat::ParseFromString(R"pb(keys {
@@ -14,6 +14,7 @@
 
 #include "components/data_server/request_handler/get_values_v2_handler.h"
 
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <string_view>
@@ -21,17 +22,29 @@
 #include <vector>
 
 #include "absl/algorithm/container.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/functional/function_ref.h"
 #include "absl/log/log.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/ascii.h"
+#include "absl/strings/escaping.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_join.h"
+#include "absl/strings/str_split.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/synchronization/notification.h"
 #include "components/data_server/request_handler/ohttp_server_encryptor.h"
+#include "components/telemetry/request_trace.h"
 #include "components/telemetry/server_definition.h"
+#include "google/protobuf/arena.h"
 #include "google/protobuf/util/json_util.h"
 #include "grpcpp/grpcpp.h"
 #include "public/base_types.pb.h"
 #include "public/constants.h"
 #include "public/query/v2/get_values_v2.grpc.pb.h"
 #include "quiche/binary_http/binary_http_message.h"
+#include "quiche/common/quiche_data_writer.h"
 #include "quiche/oblivious_http/common/oblivious_http_header_key_config.h"
 #include "quiche/oblivious_http/oblivious_http_gateway.h"
 #include "src/telemetry/telemetry.h"
@@ -43,6 +56,7 @@ using google::protobuf::util::JsonStringToMessage;
 using google::protobuf::util::MessageToJsonString;
 using grpc::StatusCode;
 using privacy_sandbox::server_common::FromAbslStatus;
+using privacy_sandbox::server_common::ToAbslStatus;
 using v2::GetValuesHttpRequest;
 using v2::KeyValueService;
 using v2::ObliviousGetValuesRequest;
@@ -51,64 +65,293 @@ const std::string_view kOHTTPResponseContentType = "message/ohttp-res";
 constexpr std::string_view kAcceptEncodingHeader = "accept-encoding";
 constexpr std::string_view kContentEncodingHeader = "content-encoding";
 constexpr std::string_view kBrotliAlgorithmHeader = "br";
+constexpr std::string_view kGzipAlgorithmHeader = "gzip";
+constexpr std::string_view kZstdAlgorithmHeader = "zstd";
+constexpr std::string_view kBrotliDictionaryAlgorithmHeader = "dcb";
+constexpr std::string_view kAvailableDictionaryHeader = "available-dictionary";
 
+// Returns whether `available_dictionary`, a structured field byte sequence
+// holding the SHA-256 of the dictionary of the client, names `dictionary`.
+bool IsAvailableDictionary(std::string_view available_dictionary,
+                           const CompressionDictionary& dictionary) {
+  return absl::StripAsciiWhitespace(available_dictionary) ==
+         absl::StrCat(":", absl::Base64Escape(dictionary.hash()), ":");
+}
+
+// Prefers Brotli with the shared `dictionary` if the client has it, then
+// Brotli, then Zstd, then Gzip among the accepted encodings. Quality values
+// are ignored.
 CompressionGroupConcatenator::CompressionType GetResponseCompressionType(
-    const std::vector<quiche::BinaryHttpMessage::Field>& headers) {
+    const std::vector<quiche::BinaryHttpMessage::Field>& headers,
+    const CompressionDictionary* dictionary) {
+  bool accepts_brotli = false;
+  bool accepts_brotli_dictionary = false;
+  bool accepts_gzip = false;
+  bool accepts_zstd = false;
+  bool has_dictionary = false;
   for (const quiche::BinaryHttpMessage::Field& header : headers) {
-    if (absl::AsciiStrToLower(header.name) != kAcceptEncodingHeader) continue;
-    // TODO(b/278271389): Right now for simplicity we support Accept-Encoding:
-    // br
-    if (absl::AsciiStrToLower(header.value) == kBrotliAlgorithmHeader) {
-      return CompressionGroupConcatenator::CompressionType::kBrotli;
+    const std::string header_name = absl::AsciiStrToLower(header.name);
+    if (header_name == kAvailableDictionaryHeader) {
+      has_dictionary |= dictionary != nullptr &&
+                        IsAvailableDictionary(header.value, *dictionary);
+      continue;
     }
+    if (header_name != kAcceptEncodingHeader) continue;
+    for (std::string_view coding : absl::StrSplit(header.value, ',')) {
+      const std::string name = absl::AsciiStrToLower(
+          absl::StripAsciiWhitespace(coding.substr(0, coding.find(';'))));
+      accepts_brotli |= name == kBrotliAlgorithmHeader;
+      accepts_brotli_dictionary |= name == kBrotliDictionaryAlgorithmHeader;
+      accepts_gzip |= name == kGzipAlgorithmHeader;
+      accepts_zstd |= name == kZstdAlgorithmHeader;
+    }
+  }
+  if (accepts_brotli_dictionary && has_dictionary) {
+    return CompressionGroupConcatenator::CompressionType::kBrotliDictionary;
+  }
+  if (accepts_brotli) {
+    return CompressionGroupConcatenator::CompressionType::kBrotli;
+  }
+  if (accepts_zstd) {
+    return CompressionGroupConcatenator::CompressionType::kZstd;
+  }
+  if (accepts_gzip) {
+    return CompressionGroupConcatenator::CompressionType::kGzip;
   }
   return CompressionGroupConcatenator::CompressionType::kUncompressed;
 }
+
+std::string_view GetContentEncoding(
+    CompressionGroupConcatenator::CompressionType compression_type) {
+  switch (compression_type) {
+    case CompressionGroupConcatenator::CompressionType::kBrotli:
+      return kBrotliAlgorithmHeader;
+    case CompressionGroupConcatenator::CompressionType::kGzip:
+      return kGzipAlgorithmHeader;
+    case CompressionGroupConcatenator::CompressionType::kZstd:
+      return kZstdAlgorithmHeader;
+    case CompressionGroupConcatenator::CompressionType::kBrotliDictionary:
+      return kBrotliDictionaryAlgorithmHeader;
+    default:
+      return "";
+  }
+}
+
+// Successful Binary HTTP responses are written as known-length messages
+// (RFC 9292) around a body that is appended to the same string in place,
+// instead of being copied into a `quiche::BinaryHttpResponse` and copied again
+// when that is serialized. The content length is only known once the body is
+// complete, so room is left for it as an 8 byte variable-length integer,
+// which does not need to be minimally encoded.
+constexpr auto kBhttpContentLengthLength =
+    quiche::VARIABLE_LENGTH_INTEGER_LENGTH_8;
+constexpr uint64_t kBhttpKnownLengthResponseFraming = 1;
+
+struct BhttpField {
+  std::string_view name;
+  std::string_view value;
+};
+
+// Appends the start of a successful response with `headers` to `buffer`, up
+// to the content length. Returns the offset of the content length.
+size_t StartBhttpResponse(const std::vector<BhttpField>& headers,
+                          std::string& buffer) {
+  uint64_t header_section_length = 0;
+  for (const BhttpField& header : headers) {
+    header_section_length +=
+        quiche::QuicheDataWriter::GetVarInt62Len(header.name.size()) +
+        header.name.size() +
+        quiche::QuicheDataWriter::GetVarInt62Len(header.value.size()) +
+        header.value.size();
+  }
+  const size_t start_length =
+      quiche::QuicheDataWriter::GetVarInt62Len(
+          kBhttpKnownLengthResponseFraming) +
+      quiche::QuicheDataWriter::GetVarInt62Len(200) +
+      quiche::QuicheDataWriter::GetVarInt62Len(header_section_length) +
+      header_section_length + kBhttpContentLengthLength;
+  const size_t offset = buffer.size();
+  buffer.resize(offset + start_length);
+  quiche::QuicheDataWriter writer(start_length, buffer.data() + offset);
+  writer.WriteVarInt62(kBhttpKnownLengthResponseFraming);
+  writer.WriteVarInt62(200);
+  writer.WriteVarInt62(header_section_length);
+  for (const BhttpField& header : headers) {
+    writer.WriteStringPieceVarInt62(header.name);
+    writer.WriteStringPieceVarInt62(header.value);
+  }
+  return buffer.size() - kBhttpContentLengthLength;
+}
+
+// Completes the response started by `StartBhttpResponse` once its body was
+// appended to `buffer`.
+void FinishBhttpResponse(size_t content_length_offset, std::string& buffer) {
+  const size_t content_length =
+      buffer.size() - content_length_offset - kBhttpContentLengthLength;
+  quiche::QuicheDataWriter writer(kBhttpContentLengthLength,
+                                  buffer.data() + content_length_offset);
+  writer.WriteVarInt62WithForcedLength(content_length,
+                                       kBhttpContentLengthLength);
+  // Empty trailer section.
+  buffer.push_back('\0');
+}
+
+// Returns the JSON array of the partitions of one compression group.
+absl::StatusOr<std::string> BuildCompressionGroup(
+    const std::vector<const v2::ResponsePartition*>& partitions) {
+  std::vector<std::string> json_partitions;
+  json_partitions.reserve(partitions.size());
+  for (const v2::ResponsePartition* partition : partitions) {
+    PS_RETURN_IF_ERROR(
+        MessageToJsonString(*partition, &json_partitions.emplace_back()));
+  }
+  return absl::StrCat("[", absl::StrJoin(json_partitions, ","), "]");
+}
+
+// State of a request with multiple partitions, shared by its partitions.
+struct PartitionsState {
+  std::unique_ptr<ScopeMetricsContext> scope_metrics_context;
+  std::vector<v2::ResponsePartition> resp_partitions;
+  // Partitions of every compression group, in the order of the request.
+  absl::flat_hash_map<int64_t, std::vector<const v2::ResponsePartition*>>
+      group_partitions;
+  absl::Mutex mutex;
+  absl::flat_hash_map<int64_t, size_t> group_num_done ABSL_GUARDED_BY(mutex);
+  int num_pending ABSL_GUARDED_BY(mutex);
+  absl::Status status ABSL_GUARDED_BY(mutex);
+  GetValuesV2Handler::DoneCallback done;
+};
+
+// Handles a request asynchronously and waits for it to finish.
+grpc::Status WaitForRequest(
+    absl::FunctionRef<void(GetValuesV2Handler::DoneCallback)> handle_request) {
+  absl::Notification finished;
+  grpc::Status status;
+  handle_request([&finished, &status](grpc::Status request_status) {
+    status = std::move(request_status);
+    finished.Notify();
+  });
+  finished.WaitForNotification();
+  return status;
+}
 }  // namespace
 
 grpc::Status GetValuesV2Handler::GetValuesHttp(
     const GetValuesHttpRequest& request,
     google::api::HttpBody* response) const {
-  return FromAbslStatus(
-      GetValuesHttp(request.raw_body().data(), *response->mutable_data()));
+  return WaitForRequest([&](DoneCallback done) {
+    GetValuesHttp(request, response, std::move(done));
+  });
+}
+
+void GetValuesV2Handler::GetValuesHttp(const GetValuesHttpRequest& request,
+                                       google::api::HttpBody* response,
+                                       DoneCallback done) const {
+  GetValuesHttp(request.raw_body().data(), *response->mutable_data(),
+                [done = std::move(done)](absl::Status status) mutable {
+                  std::move(done)(FromAbslStatus(status));
+                });
 }
 
-absl::Status GetValuesV2Handler::GetValuesHttp(std::string_view request,
-                                               std::string& response,
-                                               ContentType content_type) const {
-  v2::GetValuesRequest request_proto;
+void GetValuesV2Handler::GetValuesHttp(
+    std::string_view request, std::string& response, StatusCallback done,
+    ContentType content_type,
+    CompressionGroupConcatenator::CompressionType compression_type,
+    std::shared_ptr<const CompressionDictionary> dictionary) const {
+  std::string cache_key;
+  uint64_t cache_generation = 0;
+  if (response_cache_ != nullptr) {
+    cache_key = ResponseCache::KeyOf(
+        request,
+        absl::StrCat(static_cast<int>(content_type), ",",
+                     static_cast<int>(compression_type), ",",
+                     dictionary == nullptr ? "" : dictionary->hash()),
+        udf_client_.GetCodeObjectLogicalCommitTime());
+    if (response_cache_->Get(cache_key, response, cache_generation)) {
+      LogIfError(KVServerContextMap()
+                     ->SafeMetric()
+                     .LogUpDownCounter<kResponseCacheHitCount>(1));
+      std::move(done)(absl::OkStatus());
+      return;
+    }
+    LogIfError(KVServerContextMap()
+                   ->SafeMetric()
+                   .LogUpDownCounter<kResponseCacheMissCount>(1));
+  }
+  // The request and response protos, with all their partitions and fields,
+  // are allocated on an arena of the request, which frees them at once when
+  // the request is done.
+  auto arena = std::make_unique<google::protobuf::Arena>();
+  auto* request_proto =
+      google::protobuf::Arena::CreateMessage<v2::GetValuesRequest>(
+          arena.get());
   if (content_type == ContentType::kJson) {
-    PS_RETURN_IF_ERROR(
-        google::protobuf::util::JsonStringToMessage(request, &request_proto));
+    if (absl::Status status = google::protobuf::util::JsonStringToMessage(
+            request, request_proto);
+        !status.ok()) {
+      std::move(done)(std::move(status));
+      return;
+    }
   } else {  // proto
-    if (!request_proto.ParseFromString(request)) {
+    if (!request_proto->ParseFromString(request)) {
       auto error_message =
           "Cannot parse request as a valid serilized proto object.";
       VLOG(4) << error_message;
-      return absl::InvalidArgumentError(error_message);
+      std::move(done)(absl::InvalidArgumentError(error_message));
+      return;
     }
   }
   VLOG(9) << "Converted the http request to proto: "
-          << request_proto.DebugString();
-  v2::GetValuesResponse response_proto;
-  PS_RETURN_IF_ERROR(GetValues(request_proto, &response_proto));
-  if (content_type == ContentType::kJson) {
-    return MessageToJsonString(response_proto, &response);
-  }
-  // content_type == proto
-  if (!response_proto.SerializeToString(&response)) {
-    auto error_message = "Cannot serialize the response as a proto.";
-    VLOG(4) << error_message;
-    return absl::InvalidArgumentError(error_message);
-  }
-  return absl::OkStatus();
+          << request_proto->DebugString();
+  auto* response_proto =
+      google::protobuf::Arena::CreateMessage<v2::GetValuesResponse>(
+          arena.get());
+  GetValues(
+      *request_proto, response_proto, compression_type, std::move(dictionary),
+      [arena = std::move(arena), response_proto, &response, content_type,
+       response_cache = response_cache_, cache_key = std::move(cache_key),
+       cache_generation, response_offset = response.size(),
+       done = std::move(done)](grpc::Status get_values_status) mutable {
+        if (!get_values_status.ok()) {
+          std::move(done)(ToAbslStatus(get_values_status));
+          return;
+        }
+        absl::Status status;
+        if (content_type == ContentType::kJson) {
+          std::string json_response;
+          status = MessageToJsonString(*response_proto, &json_response);
+          response.append(json_response);
+        } else if (!response_proto->AppendToString(&response)) {  // proto
+          auto error_message = "Cannot serialize the response as a proto.";
+          VLOG(4) << error_message;
+          status = absl::InvalidArgumentError(error_message);
+        }
+        if (status.ok() && response_cache != nullptr) {
+          response_cache->Put(
+              std::move(cache_key),
+              std::string_view(response).substr(response_offset),
+              cache_generation);
+        }
+        std::move(done)(std::move(status));
+      });
 }
 
 grpc::Status GetValuesV2Handler::BinaryHttpGetValues(
     const v2::BinaryHttpGetValuesRequest& bhttp_request,
     google::api::HttpBody* response) const {
-  return FromAbslStatus(BinaryHttpGetValues(bhttp_request.raw_body().data(),
-                                            *response->mutable_data()));
+  return WaitForRequest([&](DoneCallback done) {
+    BinaryHttpGetValues(bhttp_request, response, std::move(done));
+  });
+}
+
+void GetValuesV2Handler::BinaryHttpGetValues(
+    const v2::BinaryHttpGetValuesRequest& bhttp_request,
+    google::api::HttpBody* response, DoneCallback done) const {
+  BinaryHttpGetValues(bhttp_request.raw_body().data(),
+                      *response->mutable_data(),
+                      [done = std::move(done)](absl::Status status) mutable {
+                        std::move(done)(FromAbslStatus(status));
+                      });
 }
 
 GetValuesV2Handler::ContentType GetValuesV2Handler::GetContentType(
@@ -123,113 +366,282 @@ GetValuesV2Handler::ContentType GetValuesV2Handler::GetContentType(
   return ContentType::kJson;
 }
 
-absl::StatusOr<quiche::BinaryHttpResponse>
-GetValuesV2Handler::BuildSuccessfulGetValuesBhttpResponse(
-    std::string_view bhttp_request_body) const {
+void GetValuesV2Handler::BuildSuccessfulGetValuesBhttpResponse(
+    std::string_view bhttp_request_body, std::string& response,
+    StatusCallback done) const {
   VLOG(9) << "Handling the binary http layer";
-  PS_ASSIGN_OR_RETURN(quiche::BinaryHttpRequest deserialized_req,
-                      quiche::BinaryHttpRequest::Create(bhttp_request_body),
-                      _ << "Failed to deserialize binary http request");
-  VLOG(3) << "BinaryHttpGetValues request: " << deserialized_req.DebugString();
-  std::string response;
-  auto content_type = GetContentType(deserialized_req);
-  PS_RETURN_IF_ERROR(
-      GetValuesHttp(deserialized_req.body(), response, content_type));
-  quiche::BinaryHttpResponse bhttp_response(200);
+  absl::StatusOr<quiche::BinaryHttpRequest> deserialized_req =
+      quiche::BinaryHttpRequest::Create(bhttp_request_body);
+  if (!deserialized_req.ok()) {
+    std::move(done)(absl::Status(
+        deserialized_req.status().code(),
+        absl::StrCat("Failed to deserialize binary http request: ",
+                     deserialized_req.status().message())));
+    return;
+  }
+  VLOG(3) << "BinaryHttpGetValues request: " << deserialized_req->DebugString();
+  auto content_type = GetContentType(*deserialized_req);
+  // Snapshot, so that the dictionary is the same for all compression groups.
+  std::shared_ptr<const CompressionDictionary> dictionary =
+      compression_dictionaries_ != nullptr ? compression_dictionaries_->Get()
+                                           : nullptr;
+  const auto compression_type = GetResponseCompressionType(
+      deserialized_req->GetHeaderFields(), dictionary.get());
+  if (compression_type !=
+      CompressionGroupConcatenator::CompressionType::kBrotliDictionary) {
+    dictionary = nullptr;
+  }
+  std::vector<BhttpField> headers;
   if (content_type == ContentType::kProto) {
-    bhttp_response.AddHeaderField({
-        .name = std::string(kContentTypeHeader),
-        .value = std::string(kContentEncodingProtoHeaderValue),
+    headers.push_back({
+        .name = kContentTypeHeader,
+        .value = kContentEncodingProtoHeaderValue,
     });
   }
-  bhttp_response.set_body(std::move(response));
-  return bhttp_response;
-}
-
-absl::Status GetValuesV2Handler::BinaryHttpGetValues(
-    std::string_view bhttp_request_body, std::string& response) const {
-  static quiche::BinaryHttpResponse const* kDefaultBhttpResponse =
-      new quiche::BinaryHttpResponse(500);
-  const quiche::BinaryHttpResponse* bhttp_response = kDefaultBhttpResponse;
-  absl::StatusOr<quiche::BinaryHttpResponse> maybe_successful_bhttp_response =
-      BuildSuccessfulGetValuesBhttpResponse(bhttp_request_body);
-  if (maybe_successful_bhttp_response.ok()) {
-    bhttp_response = &(maybe_successful_bhttp_response.value());
+  // Applies to the compression groups of multi-partition responses.
+  if (const std::string_view content_encoding =
+          GetContentEncoding(compression_type);
+      !content_encoding.empty()) {
+    headers.push_back({
+        .name = kContentEncodingHeader,
+        .value = content_encoding,
+    });
   }
-  PS_ASSIGN_OR_RETURN(auto serialized_bhttp_response,
-                      bhttp_response->Serialize());
+  response.clear();
+  const size_t content_length_offset = StartBhttpResponse(headers, response);
+  GetValuesHttp(
+      deserialized_req->body(), response,
+      [&response, content_length_offset,
+       done = std::move(done)](absl::Status status) mutable {
+        if (status.ok()) {
+          FinishBhttpResponse(content_length_offset, response);
+        }
+        std::move(done)(std::move(status));
+      },
+      content_type, compression_type, std::move(dictionary));
+}
 
-  response = std::move(serialized_bhttp_response);
-  VLOG(9) << "BinaryHttpGetValues finished successfully";
-  return absl::OkStatus();
+void GetValuesV2Handler::BinaryHttpGetValues(
+    std::string_view bhttp_request_body, std::string& response,
+    StatusCallback done) const {
+  BuildSuccessfulGetValuesBhttpResponse(
+      bhttp_request_body, response,
+      [&response, done = std::move(done)](absl::Status status) mutable {
+        if (!status.ok()) {
+          static quiche::BinaryHttpResponse const* kDefaultBhttpResponse =
+              new quiche::BinaryHttpResponse(500);
+          absl::StatusOr<std::string> serialized_bhttp_response =
+              kDefaultBhttpResponse->Serialize();
+          if (!serialized_bhttp_response.ok()) {
+            std::move(done)(serialized_bhttp_response.status());
+            return;
+          }
+          response = *std::move(serialized_bhttp_response);
+        }
+        VLOG(9) << "BinaryHttpGetValues finished successfully";
+        std::move(done)(absl::OkStatus());
+      });
 }
 
 grpc::Status GetValuesV2Handler::ObliviousGetValues(
     const ObliviousGetValuesRequest& oblivious_request,
     google::api::HttpBody* oblivious_response) const {
+  return WaitForRequest([&](DoneCallback done) {
+    ObliviousGetValues(oblivious_request, oblivious_response, std::move(done));
+  });
+}
+
+void GetValuesV2Handler::ObliviousGetValues(
+    const ObliviousGetValuesRequest& oblivious_request,
+    google::api::HttpBody* oblivious_response, DoneCallback done) const {
   VLOG(9) << "Received ObliviousGetValues request. ";
-  OhttpServerEncryptor encryptor(key_fetcher_manager_);
+  // Encrypts the response with the state of the decryption.
+  auto encryptor = std::make_unique<OhttpServerEncryptor>(key_fetcher_manager_);
   auto maybe_plain_text =
-      encryptor.DecryptRequest(oblivious_request.raw_body().data());
+      encryptor->DecryptRequest(oblivious_request.raw_body().data());
   if (!maybe_plain_text.ok()) {
-    return FromAbslStatus(maybe_plain_text.status());
+    std::move(done)(FromAbslStatus(maybe_plain_text.status()));
+    return;
   }
   // Now process the binary http request
-  std::string response;
-  if (const auto s = BinaryHttpGetValues(*maybe_plain_text, response);
-      !s.ok()) {
-    return FromAbslStatus(s);
-  }
-  auto encrypted_response = encryptor.EncryptResponse(std::move(response));
-  if (!encrypted_response.ok()) {
-    return grpc::Status(grpc::StatusCode::INTERNAL,
-                        absl::StrCat(encrypted_response.status().code(), " : ",
-                                     encrypted_response.status().message()));
-  }
-  oblivious_response->set_content_type(std::string(kOHTTPResponseContentType));
-  oblivious_response->set_data(*encrypted_response);
-  return grpc::Status::OK;
+  auto response = std::make_unique<std::string>();
+  std::string& response_ref = *response;
+  BinaryHttpGetValues(
+      *maybe_plain_text, response_ref,
+      [encryptor = std::move(encryptor), response = std::move(response),
+       oblivious_response,
+       done = std::move(done)](absl::Status status) mutable {
+        if (!status.ok()) {
+          std::move(done)(FromAbslStatus(status));
+          return;
+        }
+        auto encrypted_response =
+            encryptor->EncryptResponse(std::move(*response));
+        if (!encrypted_response.ok()) {
+          std::move(done)(grpc::Status(
+              grpc::StatusCode::INTERNAL,
+              absl::StrCat(encrypted_response.status().code(), " : ",
+                           encrypted_response.status().message())));
+          return;
+        }
+        oblivious_response->set_content_type(
+            std::string(kOHTTPResponseContentType));
+        oblivious_response->set_data(*std::move(encrypted_response));
+        std::move(done)(grpc::Status::OK);
+      });
 }
 
 void GetValuesV2Handler::ProcessOnePartition(
     RequestContext request_context,
     const google::protobuf::Struct& req_metadata,
     const v2::RequestPartition& req_partition,
-    v2::ResponsePartition& resp_partition) const {
+    v2::ResponsePartition& resp_partition,
+    absl::AnyInvocable<void() &&> done) const {
   resp_partition.set_id(req_partition.id());
   UDFExecutionMetadata udf_metadata;
   *udf_metadata.mutable_request_metadata() = req_metadata;
-  const auto maybe_output_string = udf_client_.ExecuteCode(
+  udf_client_.ExecuteCodeAsync(
       std::move(request_context), std::move(udf_metadata),
-      req_partition.arguments());
-  if (!maybe_output_string.ok()) {
-    resp_partition.mutable_status()->set_code(
-        static_cast<int>(maybe_output_string.status().code()));
-    resp_partition.mutable_status()->set_message(
-        maybe_output_string.status().message());
-  } else {
-    VLOG(5) << "UDF output: " << maybe_output_string.value();
-    resp_partition.set_string_output(std::move(maybe_output_string).value());
+      req_partition.arguments(),
+      [&resp_partition, done = std::move(done)](
+          absl::StatusOr<std::string> maybe_output_string) mutable {
+        if (!maybe_output_string.ok()) {
+          resp_partition.mutable_status()->set_code(
+              static_cast<int>(maybe_output_string.status().code()));
+          resp_partition.mutable_status()->set_message(
+              maybe_output_string.status().message());
+        } else {
+          VLOG(5) << "UDF output: " << maybe_output_string.value();
+          resp_partition.set_string_output(
+              std::move(maybe_output_string).value());
+        }
+        std::move(done)();
+      });
+}
+
+void GetValuesV2Handler::GetPartitionValues(
+    RequestContext request_context, const v2::GetValuesRequest& request,
+    int index, PartitionCallback done) const {
+  auto partition = std::make_unique<v2::ResponsePartition>();
+  v2::ResponsePartition& partition_ref = *partition;
+  ProcessOnePartition(
+      std::move(request_context), request.metadata(), request.partitions(index),
+      partition_ref,
+      [partition = std::move(partition), done = std::move(done)]() mutable {
+        std::move(done)(std::move(*partition));
+      });
+}
+
+void GetValuesV2Handler::ProcessMultiplePartitions(
+    std::unique_ptr<ScopeMetricsContext> scope_metrics_context,
+    const v2::GetValuesRequest& request,
+    CompressionGroupConcatenator::CompressionType compression_type,
+    std::shared_ptr<const CompressionDictionary> dictionary,
+    v2::GetValuesResponse& response, DoneCallback done) const {
+  const int num_partitions = request.partitions_size();
+  auto state = std::make_shared<PartitionsState>();
+  state->scope_metrics_context = std::move(scope_metrics_context);
+  state->resp_partitions.resize(num_partitions);
+  for (int i = 0; i < num_partitions; ++i) {
+    state->group_partitions[request.partitions(i).compression_group_id()]
+        .push_back(&state->resp_partitions[i]);
+  }
+  {
+    absl::MutexLock lock(&state->mutex);
+    state->num_pending = num_partitions;
+  }
+  state->done = std::move(done);
+  response.mutable_compressed_partition_groups();
+  RequestContext request_context(*state->scope_metrics_context);
+  request_context.SetTrace(RequestTrace::Active());
+  for (int i = 0; i < num_partitions; ++i) {
+    const int64_t group_id = request.partitions(i).compression_group_id();
+    ProcessOnePartition(
+        request_context, request.metadata(), request.partitions(i),
+        state->resp_partitions[i],
+        [this, state, group_id, compression_type, dictionary, &response]() {
+          const std::vector<const v2::ResponsePartition*>& partitions =
+              state->group_partitions.at(group_id);
+          bool group_done;
+          {
+            absl::MutexLock lock(&state->mutex);
+            group_done =
+                ++state->group_num_done[group_id] == partitions.size();
+          }
+          absl::StatusOr<std::string> group;
+          if (group_done) {
+            group = BuildCompressionGroup(partitions);
+            if (group.ok()) {
+              const std::unique_ptr<CompressionGroupConcatenator>
+                  concatenator = create_compression_group_concatenator_(
+                      compression_type, dictionary);
+              concatenator->AddCompressionGroup(*std::move(group));
+              group = concatenator->Build();
+            }
+          }
+          absl::Status status;
+          {
+            absl::MutexLock lock(&state->mutex);
+            if (group_done) {
+              if (group.ok()) {
+                response.mutable_compressed_partition_groups()
+                    ->add_compressed_partition_groups(*std::move(group));
+              } else {
+                state->status.Update(group.status());
+              }
+            }
+            if (--state->num_pending > 0) {
+              return;
+            }
+            status = state->status;
+          }
+          std::move(state->done)(FromAbslStatus(status));
+        });
   }
 }
 
 grpc::Status GetValuesV2Handler::GetValues(
     const v2::GetValuesRequest& request,
     v2::GetValuesResponse* response) const {
+  return WaitForRequest([&](DoneCallback done) {
+    GetValues(request, response, std::move(done));
+  });
+}
+
+void GetValuesV2Handler::GetValues(const v2::GetValuesRequest& request,
+                                   v2::GetValuesResponse* response,
+                                   DoneCallback done) const {
+  GetValues(request, response,
+            CompressionGroupConcatenator::CompressionType::kUncompressed,
+            /*dictionary=*/nullptr, std::move(done));
+}
+
+void GetValuesV2Handler::GetValues(
+    const v2::GetValuesRequest& request, v2::GetValuesResponse* response,
+    CompressionGroupConcatenator::CompressionType compression_type,
+    std::shared_ptr<const CompressionDictionary> dictionary,
+    DoneCallback done) const {
   auto scope_metrics_context = std::make_unique<ScopeMetricsContext>();
-  RequestContext request_context(*scope_metrics_context);
   if (request.partitions().size() == 1) {
-    ProcessOnePartition(std::move(request_context), request.metadata(),
-                        request.partitions(0),
-                        *response->mutable_single_partition());
-    return grpc::Status::OK;
+    RequestContext request_context(*scope_metrics_context);
+    request_context.SetTrace(RequestTrace::Active());
+    ProcessOnePartition(
+        std::move(request_context), request.metadata(), request.partitions(0),
+        *response->mutable_single_partition(),
+        [scope_metrics_context = std::move(scope_metrics_context),
+         done = std::move(done)]() mutable {
+          std::move(done)(grpc::Status::OK);
+        });
+    return;
   }
   if (request.partitions().empty()) {
-    return grpc::Status(StatusCode::INTERNAL,
-                        "At least 1 partition is required");
+    std::move(done)(grpc::Status(StatusCode::INTERNAL,
+                                 "At least 1 partition is required"));
+    return;
   }
-  return grpc::Status(StatusCode::UNIMPLEMENTED,
-                      "Multiple partition support is not implemented");
+  ProcessMultiplePartitions(std::move(scope_metrics_context), request,
+                            compression_type, std::move(dictionary), *response,
+                            std::move(done));
 }
 
 }  // namespace kv_server
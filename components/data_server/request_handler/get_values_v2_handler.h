@@ -17,15 +17,19 @@
 #ifndef COMPONENTS_DATA_SERVER_REQUEST_HANDLER_GET_VALUES_V2_HANDLER_H_
 #define COMPONENTS_DATA_SERVER_REQUEST_HANDLER_GET_VALUES_V2_HANDLER_H_
 
+#include <memory>
 #include <string>
 #include <string_view>
 #include <utility>
 #include <vector>
 
+#include "absl/functional/any_invocable.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/escaping.h"
 #include "components/data_server/cache/cache.h"
 #include "components/data_server/request_handler/compression.h"
+#include "components/data_server/request_handler/compression_dictionary.h"
+#include "components/data_server/request_handler/response_cache.h"
 #include "components/telemetry/server_definition.h"
 #include "components/udf/udf_client.h"
 #include "components/util/request_context.h"
@@ -48,30 +52,60 @@ inline constexpr std::string_view kContentEncodingJsonHeaderValue =
 
 // Handles the request family of *GetValues.
 // See the Service proto definition for details.
+//
+// Every request is handled either synchronously or asynchronously. The
+// asynchronous methods return once the UDFs of the request are dispatched and
+// call `done` from the UDF completion, so that no thread waits for the UDFs.
+// The request and response must outlive the call to `done`.
 class GetValuesV2Handler {
  public:
+  // Called once with the status of an asynchronously handled request.
+  using DoneCallback = absl::AnyInvocable<void(grpc::Status) &&>;
+  // Called once with the result of one partition of a streamed request.
+  using PartitionCallback =
+      absl::AnyInvocable<void(v2::ResponsePartition) &&>;
+
   // Accepts a functor to create compression blob builder for testing purposes.
+  // Responses are compressed with the current dictionary of
+  // `compression_dictionaries`, if any, for the clients that have it. If
+  // `response_cache` is set, the responses to HTTP, Binary HTTP and Oblivious
+  // HTTP requests are cached in it and served to identical requests.
   explicit GetValuesV2Handler(
       const UdfClient& udf_client,
       privacy_sandbox::server_common::KeyFetcherManagerInterface&
           key_fetcher_manager,
+      const CompressionDictionaryStore* compression_dictionaries = nullptr,
+      ResponseCache* response_cache = nullptr,
       std::function<CompressionGroupConcatenator::FactoryFunctionType>
           create_compression_group_concatenator =
-              &CompressionGroupConcatenator::Create)
+              [](CompressionGroupConcatenator::CompressionType type,
+                 std::shared_ptr<const CompressionDictionary> dictionary) {
+                return CompressionGroupConcatenator::Create(
+                    type, CompressionOptions(), std::move(dictionary));
+              })
       : udf_client_(udf_client),
+        compression_dictionaries_(compression_dictionaries),
+        response_cache_(response_cache),
         create_compression_group_concatenator_(
             std::move(create_compression_group_concatenator)),
         key_fetcher_manager_(key_fetcher_manager) {}
 
   grpc::Status GetValuesHttp(const v2::GetValuesHttpRequest& request,
                              google::api::HttpBody* response) const;
+  void GetValuesHttp(const v2::GetValuesHttpRequest& request,
+                     google::api::HttpBody* response, DoneCallback done) const;
 
   grpc::Status GetValues(const v2::GetValuesRequest& request,
                          v2::GetValuesResponse* response) const;
+  void GetValues(const v2::GetValuesRequest& request,
+                 v2::GetValuesResponse* response, DoneCallback done) const;
 
   grpc::Status BinaryHttpGetValues(
       const v2::BinaryHttpGetValuesRequest& request,
       google::api::HttpBody* response) const;
+  void BinaryHttpGetValues(const v2::BinaryHttpGetValuesRequest& request,
+                           google::api::HttpBody* response,
+                           DoneCallback done) const;
 
   // Supports requests encrypted with a fixed key for debugging/demoing.
   // X25519 Secret key (priv key).
@@ -88,6 +122,17 @@ class GetValuesV2Handler {
   // (https://github.com/WICG/turtledove/blob/main/FLEDGE_Key_Value_Server_API.md#encryption)
   grpc::Status ObliviousGetValues(const v2::ObliviousGetValuesRequest& request,
                                   google::api::HttpBody* response) const;
+  void ObliviousGetValues(const v2::ObliviousGetValuesRequest& request,
+                          google::api::HttpBody* response,
+                          DoneCallback done) const;
+
+  // Processes the partition at `index` of `request` alone, for requests whose
+  // partitions are streamed back as they complete rather than gathered into
+  // one response. The UDF failures are reported in the status of the
+  // partition. `request` must outlive the call to `done`.
+  void GetPartitionValues(RequestContext request_context,
+                          const v2::GetValuesRequest& request, int index,
+                          PartitionCallback done) const;
 
  private:
   enum class ContentType {
@@ -97,31 +142,67 @@ class GetValuesV2Handler {
   ContentType GetContentType(
       const quiche::BinaryHttpRequest& deserialized_req) const;
 
-  absl::Status GetValuesHttp(
-      std::string_view request, std::string& json_response,
-      ContentType content_type = ContentType::kJson) const;
-
-  // On success, returns a BinaryHttpResponse with a successful response. The
-  // reason that this is a separate function is so that the error status
-  // returned from here can be encoded as a BinaryHTTP response code. So even if
-  // this function fails, the final grpc code may still be ok.
-  absl::StatusOr<quiche::BinaryHttpResponse>
-  BuildSuccessfulGetValuesBhttpResponse(
-      std::string_view bhttp_request_body) const;
-
-  // Returns error only if the response cannot be serialized into Binary HTTP
-  // response. For all other failures, the error status will be inside the
-  // Binary HTTP message.
-  absl::Status BinaryHttpGetValues(std::string_view bhttp_request_body,
-                                   std::string& response) const;
-
-  // Invokes UDF to process one partition.
+  // Called once with the status of an asynchronous step of a request.
+  using StatusCallback = absl::AnyInvocable<void(absl::Status) &&>;
+
+  // Appends the response to `response`, from `response_cache_` if it has
+  // one for the same request, encoding and UDF code object. `request` only
+  // needs to outlive this call, `response` must outlive the call to `done`.
+  void GetValuesHttp(
+      std::string_view request, std::string& response,
+      StatusCallback done, ContentType content_type = ContentType::kJson,
+      CompressionGroupConcatenator::CompressionType compression_type =
+          CompressionGroupConcatenator::CompressionType::kUncompressed,
+      std::shared_ptr<const CompressionDictionary> dictionary = nullptr) const;
+
+  // Responses to requests with multiple partitions hold compression groups
+  // compressed with `compression_type`, and `dictionary` for
+  // kBrotliDictionary.
+  void GetValues(const v2::GetValuesRequest& request,
+                 v2::GetValuesResponse* response,
+                 CompressionGroupConcatenator::CompressionType compression_type,
+                 std::shared_ptr<const CompressionDictionary> dictionary,
+                 DoneCallback done) const;
+
+  // On success, `response` holds a serialized BinaryHttpResponse with a
+  // successful response when `done` is called. The body is written into
+  // `response` in place rather than copied into it. The reason that this is a
+  // separate function is so that the error status passed from here can be
+  // encoded as a BinaryHTTP response code. So even if this function fails,
+  // the final grpc code may still be ok. `response` must outlive the call to
+  // `done`.
+  void BuildSuccessfulGetValuesBhttpResponse(
+      std::string_view bhttp_request_body, std::string& response,
+      StatusCallback done) const;
+
+  // Calls `done` with an error only if the response cannot be serialized into
+  // Binary HTTP response. For all other failures, the error status will be
+  // inside the Binary HTTP message. `bhttp_request_body` only needs to
+  // outlive this call, `response` must outlive the call to `done`.
+  void BinaryHttpGetValues(std::string_view bhttp_request_body,
+                           std::string& response, StatusCallback done) const;
+
+  // Invokes UDF to process one partition, and calls `done` once
+  // `resp_partition` is filled in.
   void ProcessOnePartition(RequestContext request_context,
                            const google::protobuf::Struct& req_metadata,
                            const v2::RequestPartition& req_partition,
-                           v2::ResponsePartition& resp_partition) const;
+                           v2::ResponsePartition& resp_partition,
+                           absl::AnyInvocable<void() &&> done) const;
+
+  // Invokes UDF to process the partitions of `request` concurrently. Every
+  // compression group is added to the response, in the order they complete,
+  // once its partitions are done.
+  void ProcessMultiplePartitions(
+      std::unique_ptr<ScopeMetricsContext> scope_metrics_context,
+      const v2::GetValuesRequest& request,
+      CompressionGroupConcatenator::CompressionType compression_type,
+      std::shared_ptr<const CompressionDictionary> dictionary,
+      v2::GetValuesResponse& response, DoneCallback done) const;
 
   const UdfClient& udf_client_;
+  const CompressionDictionaryStore* compression_dictionaries_;
+  ResponseCache* response_cache_;
   std::function<CompressionGroupConcatenator::FactoryFunctionType>
       create_compression_group_concatenator_;
   privacy_sandbox::server_common::KeyFetcherManagerInterface&
@@ -20,11 +20,18 @@
 #include <vector>
 
 #include "absl/log/log.h"
+#include "absl/strings/escaping.h"
+#include "absl/strings/str_cat.h"
+#include "absl/synchronization/notification.h"
 #include "components/data_server/cache/cache.h"
 #include "components/data_server/cache/mocks.h"
+#include "components/data_server/request_handler/compression.h"
+#include "components/data_server/request_handler/compression_dictionary.h"
+#include "components/data_server/request_handler/response_cache.h"
 #include "components/udf/mocks.h"
 #include "gmock/gmock.h"
 #include "google/protobuf/text_format.h"
+#include "google/protobuf/util/json_util.h"
 #include "grpcpp/grpcpp.h"
 #include "gtest/gtest.h"
 #include "nlohmann/json.hpp"
@@ -575,5 +582,264 @@ TEST_F(GetValuesHandlerTest, PureGRPCTestFailure) {
   EXPECT_THAT(resp, EqualsProto(res));
 }
 
+TEST_F(GetValuesHandlerTest, MultiplePartitionsInCompressionGroups) {
+  v2::GetValuesRequest req;
+  TextFormat::ParseFromString(
+      R"pb(partitions {
+             id: 1
+             compression_group_id: 0
+             arguments { data { string_value: "a" } }
+           }
+           partitions {
+             id: 2
+             compression_group_id: 1
+             arguments { data { string_value: "b" } }
+           }
+           partitions {
+             id: 3
+             compression_group_id: 0
+             arguments { data { string_value: "c" } }
+           })pb",
+      &req);
+  GetValuesV2Handler handler(mock_udf_client_, fake_key_fetcher_manager_);
+  for (const auto& partition : req.partitions()) {
+    EXPECT_CALL(mock_udf_client_,
+                ExecuteCode(_, _,
+                            testing::ElementsAre(
+                                EqualsProto(partition.arguments(0)))))
+        .WillOnce(Return(partition.arguments(0).data().string_value()));
+  }
+  v2::GetValuesResponse resp;
+  const auto result = handler.GetValues(req, &resp);
+  ASSERT_TRUE(result.ok()) << "code: " << result.error_code()
+                           << ", msg: " << result.error_message();
+
+  std::vector<nlohmann::json> groups;
+  for (const std::string& compressed :
+       resp.compressed_partition_groups().compressed_partition_groups()) {
+    auto reader = CompressedBlobReader::Create(
+        CompressionGroupConcatenator::CompressionType::kUncompressed,
+        compressed);
+    const auto group = reader->ExtractOneCompressionGroup();
+    ASSERT_TRUE(group.ok()) << group.status();
+    EXPECT_TRUE(reader->IsDoneReading());
+    groups.push_back(nlohmann::json::parse(*group));
+  }
+  EXPECT_THAT(groups, UnorderedElementsAre(
+                          nlohmann::json::parse(R"([
+                              {"id": 1, "stringOutput": "a"},
+                              {"id": 3, "stringOutput": "c"}
+                          ])"),
+                          nlohmann::json::parse(R"([
+                              {"id": 2, "stringOutput": "b"}
+                          ])")));
+}
+
+// Holds the callbacks of asynchronous UDF executions until completed.
+class DeferredUdfClient : public MockUdfClient {
+ public:
+  void ExecuteCodeAsync(
+      RequestContext request_context, UDFExecutionMetadata&& execution_metadata,
+      const google::protobuf::RepeatedPtrField<UDFArgument>& arguments,
+      ExecuteCodeCallback callback) const override {
+    callbacks_.push_back(std::move(callback));
+  }
+
+  mutable std::vector<ExecuteCodeCallback> callbacks_;
+};
+
+TEST_F(GetValuesHandlerTest, FinishesOnceEveryPartitionIsDone) {
+  v2::GetValuesRequest req;
+  TextFormat::ParseFromString(
+      R"pb(partitions { id: 1 compression_group_id: 0 }
+           partitions { id: 2 compression_group_id: 1 })pb",
+      &req);
+  DeferredUdfClient udf_client;
+  GetValuesV2Handler handler(udf_client, fake_key_fetcher_manager_);
+  v2::GetValuesResponse resp;
+  absl::Notification finished;
+  handler.GetValues(req, &resp, [&finished](grpc::Status status) {
+    EXPECT_TRUE(status.ok()) << status.error_message();
+    finished.Notify();
+  });
+  // Every partition is dispatched before any of them is done.
+  ASSERT_EQ(udf_client.callbacks_.size(), 2);
+  std::move(udf_client.callbacks_[1])("b");
+  EXPECT_FALSE(finished.HasBeenNotified());
+  std::move(udf_client.callbacks_[0])("a");
+  ASSERT_TRUE(finished.HasBeenNotified());
+
+  std::vector<nlohmann::json> groups;
+  for (const std::string& compressed :
+       resp.compressed_partition_groups().compressed_partition_groups()) {
+    auto reader = CompressedBlobReader::Create(
+        CompressionGroupConcatenator::CompressionType::kUncompressed,
+        compressed);
+    const auto group = reader->ExtractOneCompressionGroup();
+    ASSERT_TRUE(group.ok()) << group.status();
+    groups.push_back(nlohmann::json::parse(*group));
+  }
+  // Groups are in the order they complete.
+  EXPECT_THAT(groups, testing::ElementsAre(
+                          nlohmann::json::parse(R"([
+                              {"id": 2, "stringOutput": "b"}
+                          ])"),
+                          nlohmann::json::parse(R"([
+                              {"id": 1, "stringOutput": "a"}
+                          ])")));
+}
+
+TEST_F(GetValuesHandlerTest, FinishesSinglePartitionFromUdfCompletion) {
+  v2::GetValuesRequest req;
+  TextFormat::ParseFromString(R"pb(partitions { id: 9 })pb", &req);
+  DeferredUdfClient udf_client;
+  GetValuesV2Handler handler(udf_client, fake_key_fetcher_manager_);
+  v2::GetValuesResponse resp;
+  absl::Notification finished;
+  handler.GetValues(req, &resp, [&finished](grpc::Status status) {
+    EXPECT_TRUE(status.ok()) << status.error_message();
+    finished.Notify();
+  });
+  ASSERT_EQ(udf_client.callbacks_.size(), 1);
+  EXPECT_FALSE(finished.HasBeenNotified());
+  std::move(udf_client.callbacks_[0])("ECHO");
+  ASSERT_TRUE(finished.HasBeenNotified());
+
+  v2::GetValuesResponse res;
+  TextFormat::ParseFromString(
+      R"pb(single_partition { id: 9 string_output: "ECHO" })pb", &res);
+  EXPECT_THAT(resp, EqualsProto(res));
+}
+
+TEST_F(GetValuesHandlerTest, GetPartitionValuesProcessesOnePartition) {
+  v2::GetValuesRequest req;
+  TextFormat::ParseFromString(
+      R"pb(partitions { id: 1 compression_group_id: 0 }
+           partitions { id: 2 compression_group_id: 0 })pb",
+      &req);
+  DeferredUdfClient udf_client;
+  GetValuesV2Handler handler(udf_client, fake_key_fetcher_manager_);
+  ScopeMetricsContext metrics_context;
+  std::vector<v2::ResponsePartition> partitions;
+  for (int index : {1, 0}) {
+    handler.GetPartitionValues(RequestContext(metrics_context), req, index,
+                               [&partitions](v2::ResponsePartition partition) {
+                                 partitions.push_back(std::move(partition));
+                               });
+  }
+  ASSERT_EQ(udf_client.callbacks_.size(), 2);
+  EXPECT_TRUE(partitions.empty());
+  std::move(udf_client.callbacks_[1])(absl::InternalError("UDF failed"));
+  std::move(udf_client.callbacks_[0])("b");
+
+  v2::ResponsePartition failed;
+  TextFormat::ParseFromString(
+      R"pb(id: 1 status { code: 13 message: "UDF failed" })pb", &failed);
+  v2::ResponsePartition succeeded;
+  TextFormat::ParseFromString(R"pb(id: 2 string_output: "b")pb", &succeeded);
+  EXPECT_THAT(partitions, testing::ElementsAre(EqualsProto(failed),
+                                               EqualsProto(succeeded)));
+}
+
+// Sends a Binary HTTP request with two partitions in one compression group,
+// and returns the response.
+quiche::BinaryHttpResponse BinaryHttpGetValuesWithHeaders(
+    const GetValuesV2Handler& handler,
+    std::vector<quiche::BinaryHttpMessage::Field> headers) {
+  quiche::BinaryHttpRequest request({});
+  for (auto& header : headers) {
+    request.AddHeaderField(std::move(header));
+  }
+  request.set_body(
+      R"({"partitions":[{"id":1,"compressionGroupId":0},)"
+      R"({"id":2,"compressionGroupId":0}]})");
+  BinaryHttpGetValuesRequest bhttp_request;
+  bhttp_request.mutable_raw_body()->set_data(*request.Serialize());
+  google::api::HttpBody response;
+  const auto result = handler.BinaryHttpGetValues(bhttp_request, &response);
+  EXPECT_TRUE(result.ok()) << result.error_message();
+  auto bhttp_response = quiche::BinaryHttpResponse::Create(response.data());
+  EXPECT_TRUE(bhttp_response.ok()) << bhttp_response.status();
+  return *std::move(bhttp_response);
+}
+
+std::string GetContentEncoding(const quiche::BinaryHttpResponse& response) {
+  for (const auto& header : response.GetHeaderFields()) {
+    if (header.name == "content-encoding") {
+      return header.value;
+    }
+  }
+  return "";
+}
+
+TEST_F(GetValuesHandlerTest, CompressesWithAvailableSharedDictionary) {
+  auto dictionary = CompressionDictionary::Create(
+      R"({"id":1,"stringOutput":"value"})", /*logical_commit_time=*/1,
+      /*version=*/1);
+  ASSERT_TRUE(dictionary.ok()) << dictionary.status();
+  CompressionDictionaryStore compression_dictionaries;
+  compression_dictionaries.Update(*dictionary);
+  GetValuesV2Handler handler(mock_udf_client_, fake_key_fetcher_manager_,
+                             &compression_dictionaries);
+  EXPECT_CALL(mock_udf_client_, ExecuteCode(_, _, _))
+      .Times(4)
+      .WillRepeatedly(Return("value"));
+
+  const std::string available_dictionary =
+      absl::StrCat(":", absl::Base64Escape((*dictionary)->hash()), ":");
+  const quiche::BinaryHttpResponse response = BinaryHttpGetValuesWithHeaders(
+      handler, {{.name = "accept-encoding", .value = "br, dcb"},
+                {.name = "available-dictionary",
+                 .value = available_dictionary}});
+  ASSERT_EQ(GetContentEncoding(response), "dcb");
+  v2::GetValuesResponse resp;
+  ASSERT_TRUE(google::protobuf::util::JsonStringToMessage(
+                  std::string(response.body()), &resp)
+                  .ok());
+  ASSERT_EQ(
+      resp.compressed_partition_groups().compressed_partition_groups_size(), 1);
+  auto reader = CompressedBlobReader::Create(
+      CompressionGroupConcatenator::CompressionType::kBrotliDictionary,
+      resp.compressed_partition_groups().compressed_partition_groups(0),
+      *dictionary);
+  const auto group = reader->ExtractOneCompressionGroup();
+  ASSERT_TRUE(group.ok()) << group.status();
+  EXPECT_EQ(nlohmann::json::parse(*group), nlohmann::json::parse(R"([
+                {"id": 1, "stringOutput": "value"},
+                {"id": 2, "stringOutput": "value"}
+            ])"));
+
+  // Falls back to Brotli without the dictionary when the client has another
+  // one.
+  EXPECT_EQ(GetContentEncoding(BinaryHttpGetValuesWithHeaders(
+                handler, {{.name = "accept-encoding", .value = "br, dcb"},
+                          {.name = "available-dictionary",
+                           .value = ":b3RoZXI=:"}})),
+            "br");
+}
+
+TEST_F(GetValuesHandlerTest, ServesIdenticalRequestsFromResponseCache) {
+  ResponseCache response_cache(ResponseCacheOptions{.max_entries = 10});
+  GetValuesV2Handler handler(mock_udf_client_, fake_key_fetcher_manager_,
+                             /*compression_dictionaries=*/nullptr,
+                             &response_cache);
+  EXPECT_CALL(mock_udf_client_, ExecuteCode(_, _, _))
+      .Times(6)
+      .WillRepeatedly(Return("value"));
+
+  const quiche::BinaryHttpResponse response =
+      BinaryHttpGetValuesWithHeaders(handler, {});
+  // Served from the cache, without executing the UDF.
+  EXPECT_EQ(BinaryHttpGetValuesWithHeaders(handler, {}).body(),
+            response.body());
+  // Responses are not shared between encodings.
+  EXPECT_EQ(GetContentEncoding(BinaryHttpGetValuesWithHeaders(
+                handler, {{.name = "accept-encoding", .value = "gzip"}})),
+            "gzip");
+  response_cache.Invalidate();
+  EXPECT_EQ(BinaryHttpGetValuesWithHeaders(handler, {}).body(),
+            response.body());
+}
+
 }  // namespace
 }  // namespace kv_server
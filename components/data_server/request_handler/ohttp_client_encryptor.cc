@@ -18,7 +18,7 @@
 
 #include "absl/log/log.h"
 #include "absl/strings/escaping.h"
-#include "quiche/oblivious_http/common/oblivious_http_header_key_config.h"
+#include "components/data_server/request_handler/ohttp_key_cache.h"
 
 namespace kv_server {
 namespace {
@@ -50,22 +50,13 @@ absl::StatusOr<std::string> OhttpClientEncryptor::EncryptRequest(
   if (!key_id.ok()) {
     return key_id.status();
   }
-  auto maybe_config = quiche::ObliviousHttpHeaderKeyConfig::Create(
-      *key_id, kKEMParameter, kKDFParameter, kAEADParameter);
-  if (!maybe_config.ok()) {
-    return absl::InternalError(std::string(maybe_config.status().message()));
-  }
-  std::string public_key;
   VLOG(9) << "Encrypting with public key id: " << key->key_id()
           << " uint8 key id " << *key_id << "public key " << key->public_key();
-  absl::Base64Unescape(key->public_key(), &public_key);
-  auto http_client_maybe =
-      quiche::ObliviousHttpClient::Create(public_key, *maybe_config);
+  auto http_client_maybe = GetOhttpClient(*key_id, key->public_key());
   if (!http_client_maybe.ok()) {
-    return absl::InternalError(
-        std::string(http_client_maybe.status().message()));
+    return http_client_maybe.status();
   }
-  http_client_ = std::move(*http_client_maybe);
+  http_client_ = *std::move(http_client_maybe);
   auto encrypted_req =
       http_client_->CreateObliviousHttpRequest(std::move(payload));
   if (!encrypted_req.ok()) {
@@ -79,7 +70,7 @@ absl::StatusOr<std::string> OhttpClientEncryptor::EncryptRequest(
 
 absl::StatusOr<std::string> OhttpClientEncryptor::DecryptResponse(
     std::string encrypted_payload) {
-  if (!http_client_.has_value() || !http_request_context_.has_value()) {
+  if (http_client_ == nullptr || !http_request_context_.has_value()) {
     return absl::InternalError(
         "Emtpy `http_client_` or `http_request_context_`. You should call "
         "`ClientEncryptRequest` first");
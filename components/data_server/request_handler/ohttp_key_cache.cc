@@ -0,0 +1,162 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/data_server/request_handler/ohttp_key_cache.h"
+
+#include <limits>
+#include <string>
+#include <utility>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/functional/function_ref.h"
+#include "absl/log/log.h"
+#include "absl/strings/escaping.h"
+#include "absl/strings/str_cat.h"
+#include "absl/synchronization/mutex.h"
+#include "public/constants.h"
+#include "quiche/oblivious_http/common/oblivious_http_header_key_config.h"
+
+namespace kv_server {
+namespace {
+
+// Objects of type `T` keyed by key id, each with the key it was set up from.
+template <typename T>
+class OhttpKeyCache {
+ public:
+  // Returns the object for `key_id` if it was set up from `key`, otherwise
+  // sets it up with `create` and replaces the previous one.
+  absl::StatusOr<std::shared_ptr<const T>> GetOrCreate(
+      uint8_t key_id, std::string_view key,
+      absl::FunctionRef<absl::StatusOr<T>()> create)
+      ABSL_LOCKS_EXCLUDED(mutex_) {
+    {
+      absl::ReaderMutexLock lock(&mutex_);
+      if (const auto it = entries_.find(key_id);
+          it != entries_.end() && it->second.key == key) {
+        return it->second.object;
+      }
+    }
+    // Set up outside of the lock, concurrent requests for a new key may set
+    // it up more than once, the last one wins.
+    absl::StatusOr<T> object = create();
+    if (!object.ok()) {
+      return object.status();
+    }
+    auto shared_object = std::make_shared<const T>(std::move(*object));
+    VLOG(9) << "Set up OHTTP object for key id " << static_cast<int>(key_id);
+    absl::MutexLock lock(&mutex_);
+    entries_.insert_or_assign(
+        key_id, Entry{.key = std::string(key), .object = shared_object});
+    return shared_object;
+  }
+
+ private:
+  struct Entry {
+    std::string key;
+    std::shared_ptr<const T> object;
+  };
+
+  absl::Mutex mutex_;
+  absl::flat_hash_map<uint8_t, Entry> entries_ ABSL_GUARDED_BY(mutex_);
+};
+
+absl::StatusOr<quiche::ObliviousHttpHeaderKeyConfig> CreateConfig(
+    uint8_t key_id) {
+  auto maybe_config = quiche::ObliviousHttpHeaderKeyConfig::Create(
+      key_id, kKEMParameter, kKDFParameter, kAEADParameter);
+  if (!maybe_config.ok()) {
+    return absl::InternalError(absl::StrCat(
+        "Unable to build OHTTP config: ", maybe_config.status().message()));
+  }
+  return maybe_config;
+}
+
+absl::StatusOr<std::shared_ptr<const quiche::ObliviousHttpGateway>>
+GetOrCreateGateway(uint8_t key_id, const std::string& private_key) {
+  static auto* const gateways =
+      new OhttpKeyCache<quiche::ObliviousHttpGateway>();
+  return gateways->GetOrCreate(
+      key_id, private_key,
+      [&]() -> absl::StatusOr<quiche::ObliviousHttpGateway> {
+        const auto config = CreateConfig(key_id);
+        if (!config.ok()) {
+          return config.status();
+        }
+        return quiche::ObliviousHttpGateway::Create(private_key, *config);
+      });
+}
+
+}  // namespace
+
+absl::StatusOr<std::shared_ptr<const quiche::ObliviousHttpGateway>>
+GetOhttpGateway(privacy_sandbox::server_common::KeyFetcherManagerInterface&
+                    key_fetcher_manager,
+                uint8_t key_id) {
+  auto private_key = key_fetcher_manager.GetPrivateKey(std::to_string(key_id));
+  if (!private_key.has_value()) {
+    const std::string error =
+        absl::StrCat("Unable to retrieve private key for key ID: ",
+                     static_cast<int>(key_id));
+    LOG(ERROR) << error;
+    return absl::InternalError(error);
+  }
+  return GetOrCreateGateway(key_id, private_key->private_key);
+}
+
+int PrepareOhttpGateways(
+    privacy_sandbox::server_common::KeyFetcherManagerInterface&
+        key_fetcher_manager) {
+  int num_keys = 0;
+  // OHTTP key ids are a single byte, so every one of them is looked up.
+  for (int key_id = 0; key_id <= std::numeric_limits<uint8_t>::max();
+       key_id++) {
+    auto private_key =
+        key_fetcher_manager.GetPrivateKey(std::to_string(key_id));
+    if (!private_key.has_value()) {
+      continue;
+    }
+    num_keys++;
+    if (auto gateway = GetOrCreateGateway(key_id, private_key->private_key);
+        !gateway.ok()) {
+      LOG(ERROR) << "Failed to set up the OHTTP gateway for key id " << key_id
+                 << ": " << gateway.status();
+    }
+  }
+  return num_keys;
+}
+
+absl::StatusOr<std::shared_ptr<const quiche::ObliviousHttpClient>>
+GetOhttpClient(uint8_t key_id, std::string_view public_key_base64) {
+  static auto* const clients = new OhttpKeyCache<quiche::ObliviousHttpClient>();
+  return clients->GetOrCreate(
+      key_id, public_key_base64,
+      [&]() -> absl::StatusOr<quiche::ObliviousHttpClient> {
+        const auto config = CreateConfig(key_id);
+        if (!config.ok()) {
+          return config.status();
+        }
+        std::string public_key;
+        absl::Base64Unescape(public_key_base64, &public_key);
+        auto http_client_maybe =
+            quiche::ObliviousHttpClient::Create(public_key, *config);
+        if (!http_client_maybe.ok()) {
+          return absl::InternalError(
+              std::string(http_client_maybe.status().message()));
+        }
+        return http_client_maybe;
+      });
+}
+
+}  // namespace kv_server
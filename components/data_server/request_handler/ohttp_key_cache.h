@@ -0,0 +1,60 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef COMPONENTS_DATA_SERVER_REQUEST_HANDLER_OHTTP_KEY_CACHE_H_
+#define COMPONENTS_DATA_SERVER_REQUEST_HANDLER_OHTTP_KEY_CACHE_H_
+
+#include <cstdint>
+#include <memory>
+#include <string_view>
+
+#include "absl/status/statusor.h"
+#include "quiche/oblivious_http/oblivious_http_client.h"
+#include "quiche/oblivious_http/oblivious_http_gateway.h"
+#include "src/encryption/key_fetcher/key_fetcher_manager.h"
+
+namespace kv_server {
+
+// Process-wide caches of the OHTTP objects set up from a key, so that
+// requests do not redo the HPKE key setup. Entries are keyed by key id and
+// remember the key they were set up from. When the key fetcher manager
+// returns a different key for an id, after a key rotation, the entry is set
+// up again. The returned objects are only used through const methods, which
+// are thread safe.
+
+// Returns the gateway that decrypts requests for `key_id`, set up from the
+// private key that `key_fetcher_manager` currently has for that id.
+absl::StatusOr<std::shared_ptr<const quiche::ObliviousHttpGateway>>
+GetOhttpGateway(privacy_sandbox::server_common::KeyFetcherManagerInterface&
+                    key_fetcher_manager,
+                uint8_t key_id);
+
+// Sets up the gateways of every key id that `key_fetcher_manager` has a
+// private key for, so that the first requests for a newly fetched key do not
+// set its gateway up. Returns the number of key ids with a private key.
+int PrepareOhttpGateways(
+    privacy_sandbox::server_common::KeyFetcherManagerInterface&
+        key_fetcher_manager);
+
+// Returns the client that encrypts requests for `key_id` with
+// `public_key_base64`, a base64 encoded public key.
+absl::StatusOr<std::shared_ptr<const quiche::ObliviousHttpClient>>
+GetOhttpClient(uint8_t key_id, std::string_view public_key_base64);
+
+}  // namespace kv_server
+
+#endif  // COMPONENTS_DATA_SERVER_REQUEST_HANDLER_OHTTP_KEY_CACHE_H_
@@ -0,0 +1,86 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/data_server/request_handler/ohttp_key_cache.h"
+
+#include <string>
+
+#include "absl/strings/escaping.h"
+#include "gtest/gtest.h"
+#include "src/encryption/key_fetcher/fake_key_fetcher_manager.h"
+
+namespace kv_server {
+namespace {
+
+TEST(OhttpKeyCacheTest, ReusesGatewayForTheSameKey) {
+  privacy_sandbox::server_common::FakeKeyFetcherManager
+      fake_key_fetcher_manager;
+  const auto public_key = fake_key_fetcher_manager.GetPublicKey(
+      privacy_sandbox::server_common::CloudPlatform::kLocal);
+  ASSERT_TRUE(public_key.ok());
+  const uint8_t key_id = std::stoi(public_key->key_id());
+  const auto gateway = GetOhttpGateway(fake_key_fetcher_manager, key_id);
+  ASSERT_TRUE(gateway.ok()) << gateway.status();
+  const auto same_gateway = GetOhttpGateway(fake_key_fetcher_manager, key_id);
+  ASSERT_TRUE(same_gateway.ok()) << same_gateway.status();
+  EXPECT_EQ(*gateway, *same_gateway);
+}
+
+TEST(OhttpKeyCacheTest, UnknownKeyIdFails) {
+  privacy_sandbox::server_common::FakeKeyFetcherManager
+      fake_key_fetcher_manager;
+  const auto public_key = fake_key_fetcher_manager.GetPublicKey(
+      privacy_sandbox::server_common::CloudPlatform::kLocal);
+  ASSERT_TRUE(public_key.ok());
+  const uint8_t unknown_key_id = std::stoi(public_key->key_id()) + 1;
+  EXPECT_FALSE(GetOhttpGateway(fake_key_fetcher_manager, unknown_key_id).ok());
+}
+
+TEST(OhttpKeyCacheTest, PreparesGatewaysOfEveryKey) {
+  privacy_sandbox::server_common::FakeKeyFetcherManager
+      fake_key_fetcher_manager;
+  const auto public_key = fake_key_fetcher_manager.GetPublicKey(
+      privacy_sandbox::server_common::CloudPlatform::kLocal);
+  ASSERT_TRUE(public_key.ok());
+  const uint8_t key_id = std::stoi(public_key->key_id());
+  EXPECT_EQ(PrepareOhttpGateways(fake_key_fetcher_manager), 1);
+  const auto gateway = GetOhttpGateway(fake_key_fetcher_manager, key_id);
+  ASSERT_TRUE(gateway.ok()) << gateway.status();
+  // Gateways already set up from the same key are kept.
+  EXPECT_EQ(PrepareOhttpGateways(fake_key_fetcher_manager), 1);
+  const auto same_gateway = GetOhttpGateway(fake_key_fetcher_manager, key_id);
+  ASSERT_TRUE(same_gateway.ok()) << same_gateway.status();
+  EXPECT_EQ(*gateway, *same_gateway);
+}
+
+TEST(OhttpKeyCacheTest, ReplacesClientWhenTheKeyChanges) {
+  const std::string public_key = absl::Base64Escape(std::string(32, '\x01'));
+  const std::string rotated_public_key =
+      absl::Base64Escape(std::string(32, '\x02'));
+  const auto client = GetOhttpClient(/*key_id=*/7, public_key);
+  ASSERT_TRUE(client.ok()) << client.status();
+  const auto same_client = GetOhttpClient(/*key_id=*/7, public_key);
+  ASSERT_TRUE(same_client.ok()) << same_client.status();
+  EXPECT_EQ(*client, *same_client);
+
+  const auto rotated_client = GetOhttpClient(/*key_id=*/7, rotated_public_key);
+  ASSERT_TRUE(rotated_client.ok()) << rotated_client.status();
+  EXPECT_NE(*client, *rotated_client);
+  const auto other_client = GetOhttpClient(/*key_id=*/8, rotated_public_key);
+  ASSERT_TRUE(other_client.ok()) << other_client.status();
+  EXPECT_NE(*rotated_client, *other_client);
+}
+
+}  // namespace
+}  // namespace kv_server
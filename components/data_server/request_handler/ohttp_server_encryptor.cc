@@ -17,6 +17,7 @@
 #include <utility>
 
 #include "absl/log/log.h"
+#include "components/data_server/request_handler/ohttp_key_cache.h"
 #include "quiche/oblivious_http/common/oblivious_http_header_key_config.h"
 
 namespace kv_server {
@@ -29,29 +30,14 @@ absl::StatusOr<absl::string_view> OhttpServerEncryptor::DecryptRequest(
     return absl::InternalError(absl::StrCat(
         "Unable to get OHTTP key id: ", maybe_req_key_id.status().message()));
   }
-  const auto maybe_config = quiche::ObliviousHttpHeaderKeyConfig::Create(
-      *maybe_req_key_id, kKEMParameter, kKDFParameter, kAEADParameter);
-  if (!maybe_config.ok()) {
-    return absl::InternalError(absl::StrCat(
-        "Unable to build OHTTP config: ", maybe_req_key_id.status().message()));
-  }
-  auto private_key_id = std::to_string(*maybe_req_key_id);
-
-  VLOG(9) << "Decrypting for the public key id: " << private_key_id;
-  auto private_key = key_fetcher_manager_.GetPrivateKey(private_key_id);
-  if (!private_key.has_value()) {
-    const std::string error = absl::StrCat(
-        "Unable to retrieve private key for key ID: ", *maybe_req_key_id);
-    LOG(ERROR) << error;
-    return absl::InternalError(error);
-  }
-
-  auto maybe_ohttp_gateway = quiche::ObliviousHttpGateway::Create(
-      private_key->private_key, *maybe_config);
+  VLOG(9) << "Decrypting for the public key id: "
+          << static_cast<int>(*maybe_req_key_id);
+  auto maybe_ohttp_gateway =
+      GetOhttpGateway(key_fetcher_manager_, *maybe_req_key_id);
   if (!maybe_ohttp_gateway.ok()) {
     return maybe_ohttp_gateway.status();
   }
-  ohttp_gateway_ = std::move(*maybe_ohttp_gateway);
+  ohttp_gateway_ = *std::move(maybe_ohttp_gateway);
   auto decrypted_request_maybe =
       ohttp_gateway_->DecryptObliviousHttpRequest(encrypted_payload);
   if (!decrypted_request_maybe.ok()) {
@@ -63,7 +49,7 @@ absl::StatusOr<absl::string_view> OhttpServerEncryptor::DecryptRequest(
 
 absl::StatusOr<std::string> OhttpServerEncryptor::EncryptResponse(
     std::string payload) {
-  if (!ohttp_gateway_.has_value() || !decrypted_request_.has_value()) {
+  if (ohttp_gateway_ == nullptr || !decrypted_request_.has_value()) {
     return absl::InternalError(
         "Emtpy `ohttp_gateway_` or `decrypted_request_`. You should call "
         "`ServerDecryptRequest` first");
@@ -15,6 +15,7 @@
 #ifndef COMPONENTS_DATA_SERVER_REQUEST_HANDLER_OHTTP_SERVER_ENCRYPTOR_H_
 #define COMPONENTS_DATA_SERVER_REQUEST_HANDLER_OHTTP_SERVER_ENCRYPTOR_H_
 
+#include <memory>
 #include <string>
 #include <string_view>
 
@@ -45,7 +46,8 @@ class OhttpServerEncryptor {
   absl::StatusOr<std::string> EncryptResponse(std::string payload);
 
  private:
-  std::optional<quiche::ObliviousHttpGateway> ohttp_gateway_;
+  // Shared with other requests for the same key.
+  std::shared_ptr<const quiche::ObliviousHttpGateway> ohttp_gateway_;
   std::optional<quiche::ObliviousHttpRequest> decrypted_request_;
   privacy_sandbox::server_common::KeyFetcherManagerInterface&
       key_fetcher_manager_;
@@ -0,0 +1,108 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/data_server/request_handler/response_cache.h"
+
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "openssl/sha.h"
+
+namespace kv_server {
+namespace {
+
+void HashUInt64(uint64_t value, SHA256_CTX& context) {
+  SHA256_Update(&context, &value, sizeof(value));
+}
+
+// Hashes the size first, so that the fields cannot run into each other.
+void HashString(std::string_view value, SHA256_CTX& context) {
+  HashUInt64(value.size(), context);
+  SHA256_Update(&context, value.data(), value.size());
+}
+
+}  // namespace
+
+std::string ResponseCache::KeyOf(std::string_view request,
+                                 std::string_view encoding,
+                                 int64_t udf_logical_commit_time) {
+  SHA256_CTX context;
+  SHA256_Init(&context);
+  HashUInt64(udf_logical_commit_time, context);
+  HashString(encoding, context);
+  HashString(request, context);
+  std::string key(SHA256_DIGEST_LENGTH, '\0');
+  SHA256_Final(reinterpret_cast<uint8_t*>(key.data()), &context);
+  return key;
+}
+
+bool ResponseCache::Get(std::string_view key, std::string& response,
+                        uint64_t& generation) {
+  const absl::Time now = absl::Now();
+  absl::MutexLock lock(&mutex_);
+  generation = generation_;
+  const auto it = entries_.find(key);
+  if (it == entries_.end()) {
+    return false;
+  }
+  if (it->second.expiry <= now) {
+    lru_.erase(it->second.lru_position);
+    entries_.erase(it);
+    return false;
+  }
+  lru_.splice(lru_.begin(), lru_, it->second.lru_position);
+  response.append(it->second.response);
+  return true;
+}
+
+void ResponseCache::Put(std::string key, std::string_view response,
+                        uint64_t generation) {
+  if (options_.max_entries <= 0) {
+    return;
+  }
+  const absl::Time expiry = absl::Now() + options_.ttl;
+  absl::MutexLock lock(&mutex_);
+  if (generation != generation_) {
+    return;
+  }
+  if (const auto it = entries_.find(key); it != entries_.end()) {
+    it->second.response = std::string(response);
+    it->second.expiry = expiry;
+    lru_.splice(lru_.begin(), lru_, it->second.lru_position);
+    return;
+  }
+  if (entries_.size() >= static_cast<size_t>(options_.max_entries)) {
+    entries_.erase(lru_.back());
+    lru_.pop_back();
+  }
+  lru_.push_front(key);
+  entries_.emplace(std::move(key), Entry{.response = std::string(response),
+                                         .expiry = expiry,
+                                         .lru_position = lru_.begin()});
+}
+
+void ResponseCache::Invalidate() {
+  absl::MutexLock lock(&mutex_);
+  ++generation_;
+  entries_.clear();
+  lru_.clear();
+}
+
+int64_t ResponseCache::size() const {
+  absl::MutexLock lock(&mutex_);
+  return entries_.size();
+}
+
+}  // namespace kv_server
@@ -0,0 +1,91 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef COMPONENTS_DATA_SERVER_REQUEST_HANDLER_RESPONSE_CACHE_H_
+#define COMPONENTS_DATA_SERVER_REQUEST_HANDLER_RESPONSE_CACHE_H_
+
+#include <cstdint>
+#include <list>
+#include <string>
+#include <string_view>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+
+namespace kv_server {
+
+struct ResponseCacheOptions {
+  // Most responses kept, evicting the least recently used. Zero disables
+  // caching.
+  int32_t max_entries = 0;
+  // Time a response is served for after it was computed.
+  absl::Duration ttl = absl::Seconds(1);
+};
+
+// Bounded cache of the responses to decrypted V2 requests, so that requests
+// identical to a recent one skip the UDF executions. Responses are dropped
+// once older than `ttl`, or when the data loading reports mutations, as UDFs
+// may read any key. Only the plaintext responses are cached, responses are
+// still encrypted per request. Thread-safe.
+class ResponseCache {
+ public:
+  explicit ResponseCache(ResponseCacheOptions options) : options_(options) {}
+
+  // Returns the key of the response to `request`, in the format `encoding`,
+  // computed by the UDF code object committed at `udf_logical_commit_time`.
+  // The key is a SHA-256 hash, the request is not kept.
+  static std::string KeyOf(std::string_view request, std::string_view encoding,
+                           int64_t udf_logical_commit_time);
+
+  // Appends the cached response of `key` to `response` and returns true if
+  // there is one. Otherwise returns false, and sets `generation` to pass to
+  // `Put` with the response.
+  bool Get(std::string_view key, std::string& response, uint64_t& generation)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Caches `response` as the response of `key`, unless the cache was
+  // invalidated since `generation` was set by `Get`, in which case the
+  // response may predate the invalidation.
+  void Put(std::string key, std::string_view response, uint64_t generation)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Drops every response.
+  void Invalidate() ABSL_LOCKS_EXCLUDED(mutex_);
+
+  int64_t size() const ABSL_LOCKS_EXCLUDED(mutex_);
+
+ private:
+  struct Entry {
+    std::string response;
+    absl::Time expiry;
+    // Position of the key in `lru_`.
+    std::list<std::string>::iterator lru_position;
+  };
+
+  const ResponseCacheOptions options_;
+  mutable absl::Mutex mutex_;
+  absl::flat_hash_map<std::string, Entry> entries_ ABSL_GUARDED_BY(mutex_);
+  // Keys of `entries_`, most recently used first.
+  std::list<std::string> lru_ ABSL_GUARDED_BY(mutex_);
+  // Incremented on every invalidation.
+  uint64_t generation_ ABSL_GUARDED_BY(mutex_) = 0;
+};
+
+}  // namespace kv_server
+
+#endif  // COMPONENTS_DATA_SERVER_REQUEST_HANDLER_RESPONSE_CACHE_H_
@@ -0,0 +1,98 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/data_server/request_handler/response_cache.h"
+
+#include <string>
+
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "gtest/gtest.h"
+
+namespace kv_server {
+namespace {
+
+TEST(ResponseCacheTest, KeysDependOnEveryField) {
+  const std::string key = ResponseCache::KeyOf("request", "json", 1);
+  EXPECT_EQ(key, ResponseCache::KeyOf("request", "json", 1));
+  EXPECT_NE(key, ResponseCache::KeyOf("request2", "json", 1));
+  EXPECT_NE(key, ResponseCache::KeyOf("request", "proto", 1));
+  EXPECT_NE(key, ResponseCache::KeyOf("request", "json", 2));
+  EXPECT_NE(ResponseCache::KeyOf("ab", "c", 1),
+            ResponseCache::KeyOf("b", "ca", 1));
+}
+
+TEST(ResponseCacheTest, AppendsCachedResponse) {
+  ResponseCache cache(ResponseCacheOptions{.max_entries = 10});
+  std::string response = "prefix";
+  uint64_t generation;
+  EXPECT_FALSE(cache.Get("key", response, generation));
+  cache.Put("key", "response", generation);
+  EXPECT_TRUE(cache.Get("key", response, generation));
+  EXPECT_EQ(response, "prefixresponse");
+}
+
+TEST(ResponseCacheTest, EvictsLeastRecentlyUsed) {
+  ResponseCache cache(ResponseCacheOptions{.max_entries = 2});
+  std::string response;
+  uint64_t generation;
+  cache.Get("key1", response, generation);
+  cache.Put("key1", "response1", generation);
+  cache.Put("key2", "response2", generation);
+  EXPECT_TRUE(cache.Get("key1", response, generation));
+  cache.Put("key3", "response3", generation);
+  EXPECT_EQ(cache.size(), 2);
+  EXPECT_TRUE(cache.Get("key1", response, generation));
+  EXPECT_FALSE(cache.Get("key2", response, generation));
+  EXPECT_TRUE(cache.Get("key3", response, generation));
+}
+
+TEST(ResponseCacheTest, ExpiresResponses) {
+  ResponseCache cache(ResponseCacheOptions{.max_entries = 10,
+                                           .ttl = absl::Milliseconds(10)});
+  std::string response;
+  uint64_t generation;
+  cache.Get("key", response, generation);
+  cache.Put("key", "response", generation);
+  absl::SleepFor(absl::Milliseconds(20));
+  EXPECT_FALSE(cache.Get("key", response, generation));
+  EXPECT_EQ(cache.size(), 0);
+}
+
+TEST(ResponseCacheTest, DropsResponsesOnInvalidation) {
+  ResponseCache cache(ResponseCacheOptions{.max_entries = 10});
+  std::string response;
+  uint64_t generation;
+  cache.Get("key1", response, generation);
+  cache.Put("key1", "response1", generation);
+  cache.Get("key2", response, generation);
+  cache.Invalidate();
+  EXPECT_FALSE(cache.Get("key1", response, generation));
+  // Computed before the invalidation.
+  cache.Put("key2", "response2", /*generation=*/0);
+  EXPECT_FALSE(cache.Get("key2", response, generation));
+  EXPECT_EQ(cache.size(), 0);
+}
+
+TEST(ResponseCacheTest, ZeroMaxEntriesDisablesCaching) {
+  ResponseCache cache(ResponseCacheOptions{});
+  std::string response;
+  uint64_t generation;
+  cache.Get("key", response, generation);
+  cache.Put("key", "response", generation);
+  EXPECT_FALSE(cache.Get("key", response, generation));
+}
+
+}  // namespace
+}  // namespace kv_server
@@ -0,0 +1,109 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/data_server/server/admission_controller.h"
+
+#include <algorithm>
+
+#include "absl/status/status.h"
+
+namespace kv_server {
+namespace {
+
+// Weight of every new latency in the moving average, as a power of two, so
+// that the average follows roughly the last 16 requests.
+constexpr int kLatencyAverageShift = 4;
+
+}  // namespace
+
+AdmissionController::Admission::Admission(Admission&& other) noexcept
+    : controller_(other.controller_), start_(other.start_) {
+  other.controller_ = nullptr;
+}
+
+AdmissionController::Admission::~Admission() {
+  if (controller_ != nullptr) {
+    controller_->Release(absl::Now() - start_);
+  }
+}
+
+AdmissionController::AdmissionController(Options options)
+    : options_(options),
+      default_max_in_flight_(std::max<int64_t>(
+          1, int64_t{options.max_in_flight} *
+                 (100 - std::clamp(options.critical_reserve_percent, 0, 100)) /
+                 100)) {}
+
+absl::StatusOr<AdmissionController::Admission> AdmissionController::Admit(
+    Priority priority) {
+  if (options_.max_in_flight <= 0) {
+    return Admission(nullptr, absl::InfinitePast());
+  }
+  const int64_t limit = priority == Priority::kCritical
+                            ? options_.max_in_flight
+                            : DefaultLimit();
+  if (in_flight_.fetch_add(1, std::memory_order_relaxed) >= limit) {
+    in_flight_.fetch_sub(1, std::memory_order_relaxed);
+    return absl::ResourceExhaustedError("Server overloaded, retry later");
+  }
+  return Admission(this, absl::Now());
+}
+
+AdmissionController::Priority AdmissionController::GetPriority(
+    const grpc::CallbackServerContext& context) {
+  const auto& metadata = context.client_metadata();
+  const auto it = metadata.find(grpc::string_ref(kPriorityMetadataKey.data(),
+                                                 kPriorityMetadataKey.size()));
+  if (it != metadata.end() &&
+      std::string_view(it->second.data(), it->second.size()) ==
+          kCriticalPriority) {
+    return Priority::kCritical;
+  }
+  return Priority::kDefault;
+}
+
+int64_t AdmissionController::InFlight() const {
+  return in_flight_.load(std::memory_order_relaxed);
+}
+
+int64_t AdmissionController::DefaultLimit() const {
+  if (options_.latency_target <= absl::ZeroDuration()) {
+    return default_max_in_flight_;
+  }
+  const int64_t average_latency_micros =
+      average_latency_micros_.load(std::memory_order_relaxed);
+  const int64_t latency_target_micros =
+      absl::ToInt64Microseconds(options_.latency_target);
+  if (average_latency_micros <= latency_target_micros) {
+    return default_max_in_flight_;
+  }
+  // Keeps one slot, so that the average keeps following the latencies.
+  return std::max<int64_t>(1, default_max_in_flight_ * latency_target_micros /
+                                  average_latency_micros);
+}
+
+void AdmissionController::Release(absl::Duration latency) {
+  in_flight_.fetch_sub(1, std::memory_order_relaxed);
+  if (options_.latency_target <= absl::ZeroDuration()) {
+    return;
+  }
+  const int64_t latency_micros = absl::ToInt64Microseconds(latency);
+  int64_t average = average_latency_micros_.load(std::memory_order_relaxed);
+  while (!average_latency_micros_.compare_exchange_weak(
+      average, average + ((latency_micros - average) >> kLatencyAverageShift),
+      std::memory_order_relaxed)) {
+  }
+}
+
+}  // namespace kv_server
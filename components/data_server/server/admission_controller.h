@@ -0,0 +1,101 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef COMPONENTS_DATA_SERVER_SERVER_ADMISSION_CONTROLLER_H_
+#define COMPONENTS_DATA_SERVER_SERVER_ADMISSION_CONTROLLER_H_
+
+#include <atomic>
+#include <cstdint>
+#include <string_view>
+
+#include "absl/status/statusor.h"
+#include "absl/time/time.h"
+#include "grpcpp/grpcpp.h"
+
+namespace kv_server {
+
+// Metadata key of the priority hint of a request. Requests whose value is
+// `kCriticalPriority` are critical, all others have the default priority.
+inline constexpr std::string_view kPriorityMetadataKey = "kv-priority";
+inline constexpr std::string_view kCriticalPriority = "critical";
+
+// Sheds requests when the server is overloaded, before any work is done for
+// them, so that the admitted requests keep their latency. A request is
+// admitted while fewer requests than its limit are in flight. Critical
+// requests may use all `max_in_flight` slots, other requests only those
+// outside of the share reserved to critical requests. When the average
+// latency of recent requests exceeds `latency_target`, the limit of other
+// requests shrinks in proportion, so that overload is detected before the
+// slots run out. Safe to use from multiple threads.
+class AdmissionController {
+ public:
+  enum class Priority {
+    kDefault = 0,
+    kCritical,
+  };
+
+  struct Options {
+    // 0 admits every request.
+    int32_t max_in_flight = 0;
+    // Percentage of `max_in_flight` that only critical requests may use.
+    int32_t critical_reserve_percent = 0;
+    // Zero ignores latencies.
+    absl::Duration latency_target = absl::ZeroDuration();
+  };
+
+  // Held while an admitted request is in flight. Records the latency of the
+  // request and frees its slot when destroyed.
+  class Admission {
+   public:
+    Admission(Admission&& other) noexcept;
+    Admission& operator=(Admission&&) = delete;
+    ~Admission();
+
+   private:
+    friend class AdmissionController;
+    Admission(AdmissionController* controller, absl::Time start)
+        : controller_(controller), start_(start) {}
+
+    AdmissionController* controller_;
+    absl::Time start_;
+  };
+
+  explicit AdmissionController(Options options);
+
+  // Returns an admission for a request with `priority`, or a
+  // ResourceExhausted error if the request is shed.
+  absl::StatusOr<Admission> Admit(Priority priority);
+
+  // Returns the priority hint of the call of `context`.
+  static Priority GetPriority(const grpc::CallbackServerContext& context);
+
+  int64_t InFlight() const;
+
+ private:
+  // Limit of the requests in flight for requests with the default priority.
+  int64_t DefaultLimit() const;
+  void Release(absl::Duration latency);
+
+  const Options options_;
+  const int64_t default_max_in_flight_;
+  std::atomic<int64_t> in_flight_ = 0;
+  // Exponentially weighted moving average of the latencies.
+  std::atomic<int64_t> average_latency_micros_ = 0;
+};
+
+}  // namespace kv_server
+
+#endif  // COMPONENTS_DATA_SERVER_SERVER_ADMISSION_CONTROLLER_H_
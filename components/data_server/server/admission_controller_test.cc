@@ -0,0 +1,102 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/data_server/server/admission_controller.h"
+
+#include <utility>
+#include <vector>
+
+#include "absl/time/clock.h"
+#include "gtest/gtest.h"
+
+namespace kv_server {
+namespace {
+
+using Priority = AdmissionController::Priority;
+
+TEST(AdmissionControllerTest, AdmitsAllWhenDisabled) {
+  AdmissionController controller(AdmissionController::Options{});
+  std::vector<AdmissionController::Admission> admissions;
+  for (int i = 0; i < 1000; i++) {
+    auto admission = controller.Admit(Priority::kDefault);
+    ASSERT_TRUE(admission.ok());
+    admissions.push_back(*std::move(admission));
+  }
+}
+
+TEST(AdmissionControllerTest, ShedsAboveMaxInFlight) {
+  AdmissionController controller({.max_in_flight = 2});
+  auto first = controller.Admit(Priority::kDefault);
+  auto second = controller.Admit(Priority::kDefault);
+  ASSERT_TRUE(first.ok());
+  ASSERT_TRUE(second.ok());
+  auto third = controller.Admit(Priority::kDefault);
+  EXPECT_EQ(third.status().code(), absl::StatusCode::kResourceExhausted);
+  EXPECT_EQ(controller.InFlight(), 2);
+}
+
+TEST(AdmissionControllerTest, ReleasesSlotWhenAdmissionIsDestroyed) {
+  AdmissionController controller({.max_in_flight = 1});
+  {
+    auto admission = controller.Admit(Priority::kDefault);
+    ASSERT_TRUE(admission.ok());
+    auto moved = *std::move(admission);
+    EXPECT_EQ(controller.InFlight(), 1);
+  }
+  EXPECT_EQ(controller.InFlight(), 0);
+  EXPECT_TRUE(controller.Admit(Priority::kDefault).ok());
+}
+
+TEST(AdmissionControllerTest, ReservesSlotsForCriticalRequests) {
+  AdmissionController controller(
+      {.max_in_flight = 4, .critical_reserve_percent = 50});
+  std::vector<AdmissionController::Admission> admissions;
+  for (int i = 0; i < 2; i++) {
+    auto admission = controller.Admit(Priority::kDefault);
+    ASSERT_TRUE(admission.ok());
+    admissions.push_back(*std::move(admission));
+  }
+  EXPECT_FALSE(controller.Admit(Priority::kDefault).ok());
+  for (int i = 0; i < 2; i++) {
+    auto admission = controller.Admit(Priority::kCritical);
+    ASSERT_TRUE(admission.ok());
+    admissions.push_back(*std::move(admission));
+  }
+  EXPECT_FALSE(controller.Admit(Priority::kCritical).ok());
+}
+
+TEST(AdmissionControllerTest, ShedsEarlierAboveLatencyTarget) {
+  AdmissionController controller(
+      {.max_in_flight = 10, .latency_target = absl::Milliseconds(1)});
+  {
+    auto slow = controller.Admit(Priority::kDefault);
+    ASSERT_TRUE(slow.ok());
+    absl::SleepFor(absl::Milliseconds(20));
+  }
+  std::vector<AdmissionController::Admission> admissions;
+  int admitted = 0;
+  for (int i = 0; i < 10; i++) {
+    auto admission = controller.Admit(Priority::kDefault);
+    if (admission.ok()) {
+      admitted++;
+      admissions.push_back(*std::move(admission));
+    }
+  }
+  EXPECT_LT(admitted, 10);
+  EXPECT_GE(admitted, 1);
+  EXPECT_TRUE(controller.Admit(Priority::kCritical).ok());
+}
+
+}  // namespace
+}  // namespace kv_server
@@ -0,0 +1,85 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/data_server/server/heap_allocator.h"
+
+#include <limits>
+#include <optional>
+#include <utility>
+
+#include "absl/log/log.h"
+#include "absl/time/clock.h"
+#include "tcmalloc/malloc_extension.h"
+
+namespace kv_server {
+namespace {
+
+// Numeric properties of tcmalloc by the name they are reported with.
+constexpr std::pair<std::string_view, std::string_view> kStatsProperties[] = {
+    {"allocated", "generic.current_allocated_bytes"},
+    {"heap_size", "generic.heap_size"},
+    {"cpu_cache_free", "tcmalloc.cpu_free"},
+    {"thread_cache_free", "tcmalloc.thread_cache_free"},
+    {"transfer_cache_free", "tcmalloc.transfer_cache_free"},
+    {"central_cache_free", "tcmalloc.central_cache_free"},
+    {"page_heap_free", "tcmalloc.pageheap_free_bytes"},
+    {"page_heap_unmapped", "tcmalloc.pageheap_unmapped_bytes"},
+};
+
+std::optional<size_t> GetProperty(std::string_view property) {
+  return tcmalloc::MallocExtension::GetNumericProperty(property);
+}
+
+}  // namespace
+
+void SetHeapAllocatorMaxPerCpuCacheBytes(int32_t max_per_cpu_cache_bytes) {
+  if (max_per_cpu_cache_bytes <= 0) {
+    return;
+  }
+  tcmalloc::MallocExtension::SetMaxPerCpuCacheSize(max_per_cpu_cache_bytes);
+  LOG(INFO) << "Set the per-CPU caches of the heap allocator to "
+            << max_per_cpu_cache_bytes << " bytes";
+}
+
+void ReleaseFreeHeapMemory(std::string_view reason) {
+  const std::optional<size_t> unmapped_before =
+      GetProperty("tcmalloc.pageheap_unmapped_bytes");
+  const absl::Time start = absl::Now();
+  // The free memory of the per-CPU caches stays cached, see
+  // `SetHeapAllocatorMaxPerCpuCacheBytes`.
+  tcmalloc::MallocExtension::ReleaseMemoryToSystem(
+      std::numeric_limits<size_t>::max());
+  const std::optional<size_t> unmapped_after =
+      GetProperty("tcmalloc.pageheap_unmapped_bytes");
+  if (unmapped_before.has_value() && unmapped_after.has_value()) {
+    LOG(INFO) << "Released "
+              << static_cast<int64_t>(*unmapped_after) -
+                     static_cast<int64_t>(*unmapped_before)
+              << " bytes of free heap memory after " << reason << " in "
+              << absl::Now() - start;
+  }
+}
+
+absl::flat_hash_map<std::string, int64_t> GetHeapAllocatorStats() {
+  absl::flat_hash_map<std::string, int64_t> stats;
+  for (const auto& [name, property] : kStatsProperties) {
+    if (std::optional<size_t> value = GetProperty(property);
+        value.has_value()) {
+      stats.emplace(name, static_cast<int64_t>(*value));
+    }
+  }
+  return stats;
+}
+
+}  // namespace kv_server
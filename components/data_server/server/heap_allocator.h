@@ -0,0 +1,48 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef COMPONENTS_DATA_SERVER_SERVER_HEAP_ALLOCATOR_H_
+#define COMPONENTS_DATA_SERVER_SERVER_HEAP_ALLOCATOR_H_
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "absl/container/flat_hash_map.h"
+
+namespace kv_server {
+
+// Helpers to tune tcmalloc, which the server is linked with. They do nothing
+// in binaries linked with another allocator.
+
+// Limits the free memory that tcmalloc caches for every CPU to
+// `max_per_cpu_cache_bytes`, so that memory freed by some threads is
+// available to the others rather than held per CPU. Keeps the default of
+// tcmalloc if not positive.
+void SetHeapAllocatorMaxPerCpuCacheBytes(int32_t max_per_cpu_cache_bytes);
+
+// Returns the free memory of the heap to the OS, e.g. the buffers freed after
+// loading data, rather than keeping the memory resident for later
+// allocations. `reason` is logged along with the number of bytes released.
+void ReleaseFreeHeapMemory(std::string_view reason);
+
+// Returns the bytes of the heap by use: allocated, free in the caches of
+// tcmalloc or its page heap, and returned to the OS. Empty without tcmalloc.
+absl::flat_hash_map<std::string, int64_t> GetHeapAllocatorStats();
+
+}  // namespace kv_server
+
+#endif  // COMPONENTS_DATA_SERVER_SERVER_HEAP_ALLOCATOR_H_
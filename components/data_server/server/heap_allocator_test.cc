@@ -0,0 +1,49 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/data_server/server/heap_allocator.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace kv_server {
+namespace {
+
+using testing::Contains;
+using testing::Key;
+
+TEST(HeapAllocatorTest, ReleasesFreedMemory) {
+  SetHeapAllocatorMaxPerCpuCacheBytes(1 << 20);
+  {
+    // Freed buffers, like the ones of loading data files.
+    std::vector<std::unique_ptr<std::string>> buffers;
+    for (int i = 0; i < 16; i++) {
+      buffers.push_back(std::make_unique<std::string>(8 << 20, 'x'));
+    }
+  }
+  const auto stats_before = GetHeapAllocatorStats();
+  ASSERT_THAT(stats_before, Contains(Key("page_heap_unmapped")));
+  ReleaseFreeHeapMemory("test");
+  const auto stats_after = GetHeapAllocatorStats();
+  EXPECT_GT(stats_after.at("page_heap_unmapped"),
+            stats_before.at("page_heap_unmapped"));
+  EXPECT_THAT(stats_after, Contains(Key("allocated")));
+}
+
+}  // namespace
+}  // namespace kv_server
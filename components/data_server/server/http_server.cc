@@ -0,0 +1,372 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/data_server/server/http_server.h"
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "absl/log/log.h"
+#include "absl/strings/ascii.h"
+#include "absl/strings/match.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_split.h"
+#include "absl/synchronization/notification.h"
+
+namespace kv_server {
+namespace {
+
+constexpr size_t kReadChunkBytes = 16 * 1024;
+constexpr int kListenBacklog = 128;
+
+std::string_view ReasonPhrase(int status_code) {
+  switch (status_code) {
+    case 200:
+      return "OK";
+    case 400:
+      return "Bad Request";
+    case 401:
+      return "Unauthorized";
+    case 403:
+      return "Forbidden";
+    case 404:
+      return "Not Found";
+    case 405:
+      return "Method Not Allowed";
+    case 409:
+      return "Conflict";
+    case 413:
+      return "Payload Too Large";
+    case 429:
+      return "Too Many Requests";
+    case 431:
+      return "Request Header Fields Too Large";
+    case 499:
+      return "Client Closed Request";
+    case 500:
+      return "Internal Server Error";
+    case 501:
+      return "Not Implemented";
+    case 503:
+      return "Service Unavailable";
+    case 504:
+      return "Gateway Timeout";
+    case 505:
+      return "HTTP Version Not Supported";
+    default:
+      return "Unknown";
+  }
+}
+
+HttpServer::Response ErrorResponse(int status_code) {
+  return HttpServer::Response{.status_code = status_code,
+                              .content_type = "text/plain",
+                              .body = std::string(ReasonPhrase(status_code))};
+}
+
+bool WriteAll(int fd, std::string_view data) {
+  while (!data.empty()) {
+    const ssize_t written = send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    data.remove_prefix(written);
+  }
+  return true;
+}
+
+bool WriteResponse(int fd, const HttpServer::Response& response,
+                   bool keep_alive) {
+  std::string head = absl::StrCat(
+      "HTTP/1.1 ", response.status_code, " ",
+      ReasonPhrase(response.status_code), "\r\nContent-Length: ",
+      response.body.size(), "\r\n");
+  if (!response.content_type.empty()) {
+    absl::StrAppend(&head, "Content-Type: ", response.content_type, "\r\n");
+  }
+  if (!keep_alive) {
+    absl::StrAppend(&head, "Connection: close\r\n");
+  }
+  absl::StrAppend(&head, "\r\n");
+  return WriteAll(fd, head) && WriteAll(fd, response.body);
+}
+
+// Appends what is available on `fd` to `buffer`. Returns false once the
+// connection is closed, fails or idles for longer than its receive timeout.
+bool ReadMore(int fd, std::string& buffer) {
+  const size_t size = buffer.size();
+  buffer.resize(size + kReadChunkBytes);
+  ssize_t read_bytes;
+  do {
+    read_bytes = recv(fd, buffer.data() + size, kReadChunkBytes, 0);
+  } while (read_bytes < 0 && errno == EINTR);
+  buffer.resize(size + std::max<ssize_t>(read_bytes, 0));
+  return read_bytes > 0;
+}
+
+}  // namespace
+
+HttpServer::~HttpServer() { Shutdown(); }
+
+void HttpServer::AddRoute(std::string method, std::string path,
+                          Handler handler) {
+  routes_.push_back(Route{.method = std::move(method),
+                          .path = std::move(path),
+                          .handler = std::move(handler)});
+}
+
+absl::Status HttpServer::Start(Options options) {
+  if (listen_fd_ >= 0) {
+    return absl::FailedPreconditionError("Already started");
+  }
+  options_ = options;
+  const int fd = socket(AF_INET6, SOCK_STREAM, 0);
+  if (fd < 0) {
+    return absl::InternalError(
+        absl::StrCat("Failed to create socket: ", std::strerror(errno)));
+  }
+  const int enable = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+  // Accepts IPv4 connections too.
+  const int disable = 0;
+  setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY, &disable, sizeof(disable));
+  sockaddr_in6 address = {};
+  address.sin6_family = AF_INET6;
+  address.sin6_addr = in6addr_any;
+  address.sin6_port = htons(options_.port);
+  if (bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 ||
+      listen(fd, kListenBacklog) < 0) {
+    const std::string error = std::strerror(errno);
+    close(fd);
+    return absl::UnavailableError(absl::StrCat(
+        "Failed to listen on port ", options_.port, ": ", error));
+  }
+  socklen_t address_size = sizeof(address);
+  getsockname(fd, reinterpret_cast<sockaddr*>(&address), &address_size);
+  port_ = ntohs(address.sin6_port);
+  listen_fd_ = fd;
+  accept_thread_ = std::thread(&HttpServer::AcceptLoop, this);
+  LOG(INFO) << "HTTP server listening on port " << port_;
+  return absl::OkStatus();
+}
+
+void HttpServer::Shutdown() {
+  {
+    absl::MutexLock lock(&mutex_);
+    if (stopping_ || listen_fd_ < 0) {
+      return;
+    }
+    stopping_ = true;
+    // Wakes up `accept`.
+    shutdown(listen_fd_, SHUT_RDWR);
+  }
+  accept_thread_.join();
+  close(listen_fd_);
+  absl::flat_hash_map<int64_t, std::thread> connection_threads;
+  {
+    absl::MutexLock lock(&mutex_);
+    // Wakes up the reads of the connections, while their responses can still
+    // be written.
+    for (const auto& [connection_id, fd] : connection_fds_) {
+      shutdown(fd, SHUT_RD);
+    }
+    connection_threads = std::move(connection_threads_);
+  }
+  for (auto& [connection_id, thread] : connection_threads) {
+    thread.join();
+  }
+}
+
+void HttpServer::AcceptLoop() {
+  while (true) {
+    const int fd = accept(listen_fd_, nullptr, nullptr);
+    const int accept_errno = errno;
+    JoinFinishedConnections();
+    absl::MutexLock lock(&mutex_);
+    if (stopping_) {
+      if (fd >= 0) {
+        close(fd);
+      }
+      return;
+    }
+    if (fd < 0) {
+      if (accept_errno != EINTR && accept_errno != ECONNABORTED) {
+        LOG(ERROR) << "Failed to accept HTTP connection: "
+                   << std::strerror(accept_errno);
+      }
+      continue;
+    }
+    if (static_cast<int64_t>(connection_fds_.size()) >=
+        options_.max_connections) {
+      LOG(WARNING) << "Closing HTTP connection over the limit of "
+                   << options_.max_connections;
+      close(fd);
+      continue;
+    }
+    const int64_t connection_id = next_connection_id_++;
+    connection_fds_[connection_id] = fd;
+    connection_threads_[connection_id] =
+        std::thread(&HttpServer::ServeConnection, this, connection_id, fd);
+  }
+}
+
+void HttpServer::JoinFinishedConnections() {
+  std::vector<std::thread> finished_threads;
+  {
+    absl::MutexLock lock(&mutex_);
+    for (const int64_t connection_id : finished_connections_) {
+      if (auto node = connection_threads_.extract(connection_id)) {
+        finished_threads.push_back(std::move(node.mapped()));
+      }
+    }
+    finished_connections_.clear();
+  }
+  for (auto& thread : finished_threads) {
+    thread.join();
+  }
+}
+
+void HttpServer::ServeConnection(int64_t connection_id, int fd) {
+  timeval timeout = absl::ToTimeval(options_.idle_timeout);
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  std::string buffer;
+  while (ServeRequest(fd, buffer)) {
+  }
+  absl::MutexLock lock(&mutex_);
+  connection_fds_.erase(connection_id);
+  finished_connections_.push_back(connection_id);
+  close(fd);
+}
+
+bool HttpServer::ServeRequest(int fd, std::string& buffer) {
+  size_t header_end;
+  while ((header_end = buffer.find("\r\n\r\n")) == std::string::npos) {
+    if (static_cast<int64_t>(buffer.size()) > options_.max_header_bytes) {
+      WriteResponse(fd, ErrorResponse(431), /*keep_alive=*/false);
+      return false;
+    }
+    if (!ReadMore(fd, buffer)) {
+      return false;
+    }
+  }
+  std::vector<std::string_view> lines =
+      absl::StrSplit(std::string_view(buffer.data(), header_end), "\r\n");
+  std::vector<std::string_view> request_line = absl::StrSplit(lines[0], ' ');
+  if (request_line.size() != 3) {
+    WriteResponse(fd, ErrorResponse(400), /*keep_alive=*/false);
+    return false;
+  }
+  if (!absl::StartsWith(request_line[2], "HTTP/1.")) {
+    WriteResponse(fd, ErrorResponse(505), /*keep_alive=*/false);
+    return false;
+  }
+  Request request;
+  request.method = std::string(request_line[0]);
+  request.path = std::string(
+      request_line[1].substr(0, request_line[1].find_first_of('?')));
+  for (size_t i = 1; i < lines.size(); i++) {
+    const size_t colon = lines[i].find(':');
+    if (colon == std::string_view::npos) {
+      WriteResponse(fd, ErrorResponse(400), /*keep_alive=*/false);
+      return false;
+    }
+    request.headers[absl::AsciiStrToLower(lines[i].substr(0, colon))] =
+        std::string(absl::StripAsciiWhitespace(lines[i].substr(colon + 1)));
+  }
+  // Connections of HTTP/1.1 are persistent by default, those of HTTP/1.0 are
+  // not.
+  bool keep_alive = request_line[2] == "HTTP/1.1";
+  if (const auto iter = request.headers.find("connection");
+      iter != request.headers.end()) {
+    if (absl::EqualsIgnoreCase(iter->second, "close")) {
+      keep_alive = false;
+    } else if (absl::EqualsIgnoreCase(iter->second, "keep-alive")) {
+      keep_alive = true;
+    }
+  }
+  if (request.headers.contains("transfer-encoding")) {
+    WriteResponse(fd, ErrorResponse(501), /*keep_alive=*/false);
+    return false;
+  }
+  int64_t content_length = 0;
+  if (const auto iter = request.headers.find("content-length");
+      iter != request.headers.end() &&
+      (!absl::SimpleAtoi(iter->second, &content_length) ||
+       content_length < 0)) {
+    WriteResponse(fd, ErrorResponse(400), /*keep_alive=*/false);
+    return false;
+  }
+  if (content_length > options_.max_body_bytes) {
+    WriteResponse(fd, ErrorResponse(413), /*keep_alive=*/false);
+    return false;
+  }
+  buffer.erase(0, header_end + 4);
+  if (const auto iter = request.headers.find("expect");
+      iter != request.headers.end() &&
+      absl::EqualsIgnoreCase(iter->second, "100-continue") &&
+      static_cast<int64_t>(buffer.size()) < content_length &&
+      !WriteAll(fd, "HTTP/1.1 100 Continue\r\n\r\n")) {
+    return false;
+  }
+  while (static_cast<int64_t>(buffer.size()) < content_length) {
+    if (!ReadMore(fd, buffer)) {
+      return false;
+    }
+  }
+  request.body = buffer.substr(0, content_length);
+  buffer.erase(0, content_length);
+  Response response;
+  bool path_found = false;
+  if (const Route* route = FindRoute(request, path_found); route == nullptr) {
+    response = ErrorResponse(path_found ? 405 : 404);
+  } else {
+    absl::Notification done;
+    route->handler(std::move(request), [&response, &done](Response result) {
+      response = std::move(result);
+      done.Notify();
+    });
+    done.WaitForNotification();
+  }
+  return WriteResponse(fd, response, keep_alive) && keep_alive;
+}
+
+const HttpServer::Route* HttpServer::FindRoute(const Request& request,
+                                               bool& path_found) const {
+  for (const Route& route : routes_) {
+    if (!absl::EndsWith(request.path, route.path)) {
+      continue;
+    }
+    path_found = true;
+    if (request.method == route.method) {
+      return &route;
+    }
+  }
+  return nullptr;
+}
+
+}  // namespace kv_server
@@ -0,0 +1,128 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef COMPONENTS_DATA_SERVER_SERVER_HTTP_SERVER_H_
+#define COMPONENTS_DATA_SERVER_SERVER_HTTP_SERVER_H_
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/functional/any_invocable.h"
+#include "absl/status/status.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+
+namespace kv_server {
+
+// Minimal HTTP/1.1 server, so that the HTTP endpoints of the server can be
+// served without a transcoding proxy in front of it. Every connection is
+// served by a thread of its own, one request at a time, and is kept alive
+// between requests unless the client asks to close it. Chunked request
+// bodies are not supported: requests must have a `Content-Length`.
+class HttpServer {
+ public:
+  struct Request {
+    std::string method;
+    // Without the query string.
+    std::string path;
+    // Keyed by lowercase name.
+    absl::flat_hash_map<std::string, std::string> headers;
+    std::string body;
+  };
+
+  struct Response {
+    int status_code = 200;
+    std::string content_type;
+    std::string body;
+  };
+
+  using DoneCallback = absl::AnyInvocable<void(Response) &&>;
+  // Calls `done` once, from any thread. The connection waits for it.
+  using Handler = std::function<void(Request request, DoneCallback done)>;
+
+  struct Options {
+    // 0 picks a free port, see `port`.
+    uint16_t port = 0;
+    // Further connections are closed as soon as they are accepted.
+    int32_t max_connections = 1024;
+    int64_t max_header_bytes = 64 * 1024;
+    int64_t max_body_bytes = 64 * 1024 * 1024;
+    // Connections idle for longer are closed.
+    absl::Duration idle_timeout = absl::Minutes(1);
+  };
+
+  HttpServer() = default;
+  // Calls `Shutdown`.
+  ~HttpServer();
+
+  HttpServer(const HttpServer&) = delete;
+  HttpServer& operator=(const HttpServer&) = delete;
+
+  // Serves requests with `method` whose path is `path`, or ends with it like
+  // the `/**/` bindings of the gRPC transcoder. `path` starts with a "/".
+  // Must be called before `Start`.
+  void AddRoute(std::string method, std::string path, Handler handler);
+
+  // Starts listening on all interfaces.
+  absl::Status Start(Options options);
+
+  // The port listened on, once started.
+  uint16_t port() const { return port_; }
+
+  // Stops accepting connections and closes the open ones once their request
+  // in progress, if any, is answered. Blocks until then.
+  void Shutdown() ABSL_LOCKS_EXCLUDED(mutex_);
+
+ private:
+  struct Route {
+    std::string method;
+    std::string path;
+    Handler handler;
+  };
+
+  void AcceptLoop() ABSL_LOCKS_EXCLUDED(mutex_);
+  void ServeConnection(int64_t connection_id, int fd)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+  // Returns false if the connection must be closed after the response.
+  bool ServeRequest(int fd, std::string& buffer);
+  const Route* FindRoute(const Request& request, bool& path_found) const;
+  // Joins the threads of the closed connections.
+  void JoinFinishedConnections() ABSL_LOCKS_EXCLUDED(mutex_);
+
+  std::vector<Route> routes_;
+  Options options_;
+  int listen_fd_ = -1;
+  uint16_t port_ = 0;
+  std::thread accept_thread_;
+
+  absl::Mutex mutex_;
+  bool stopping_ ABSL_GUARDED_BY(mutex_) = false;
+  int64_t next_connection_id_ ABSL_GUARDED_BY(mutex_) = 0;
+  // Open connections by id, with their socket.
+  absl::flat_hash_map<int64_t, int> connection_fds_ ABSL_GUARDED_BY(mutex_);
+  absl::flat_hash_map<int64_t, std::thread> connection_threads_
+      ABSL_GUARDED_BY(mutex_);
+  std::vector<int64_t> finished_connections_ ABSL_GUARDED_BY(mutex_);
+};
+
+}  // namespace kv_server
+
+#endif  // COMPONENTS_DATA_SERVER_SERVER_HTTP_SERVER_H_
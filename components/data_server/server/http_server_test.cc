@@ -0,0 +1,185 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/data_server/server/http_server.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <string>
+#include <string_view>
+#include <thread>
+
+#include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace kv_server {
+namespace {
+
+using testing::EndsWith;
+using testing::HasSubstr;
+using testing::StartsWith;
+
+// Connection to the server under test.
+class Client {
+ public:
+  explicit Client(uint16_t port) : fd_(socket(AF_INET, SOCK_STREAM, 0)) {
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    inet_pton(AF_INET, "127.0.0.1", &address.sin_addr);
+    connected_ = connect(fd_, reinterpret_cast<sockaddr*>(&address),
+                         sizeof(address)) == 0;
+  }
+  ~Client() { close(fd_); }
+
+  bool connected() const { return connected_; }
+
+  void Send(std::string_view data) {
+    ASSERT_EQ(send(fd_, data.data(), data.size(), 0), data.size());
+  }
+
+  // Reads until `size` bytes were read or the server closes the connection.
+  std::string Read(size_t size) {
+    std::string data;
+    char buffer[1024];
+    while (data.size() < size) {
+      const ssize_t read_bytes =
+          recv(fd_, buffer, std::min(sizeof(buffer), size - data.size()), 0);
+      if (read_bytes <= 0) {
+        break;
+      }
+      data.append(buffer, read_bytes);
+    }
+    return data;
+  }
+
+  std::string ReadUntilClosed() { return Read(std::string::npos); }
+
+ private:
+  int fd_;
+  bool connected_;
+};
+
+std::string EchoResponse(std::string_view body) {
+  return absl::StrCat(
+      "HTTP/1.1 200 OK\r\nContent-Length: ", body.size(),
+      "\r\nContent-Type: text/plain\r\n\r\n", body);
+}
+
+class HttpServerTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    // Answers with the request body from another thread.
+    server_.AddRoute(
+        "PUT", "/v2/echo",
+        [](HttpServer::Request request, HttpServer::DoneCallback done) {
+          std::thread([request = std::move(request),
+                       done = std::move(done)]() mutable {
+            std::move(done)(HttpServer::Response{
+                .content_type = "text/plain", .body = request.body});
+          }).detach();
+        });
+    ASSERT_TRUE(server_.Start(HttpServer::Options{}).ok());
+  }
+
+  HttpServer server_;
+};
+
+TEST_F(HttpServerTest, ServesRoute) {
+  Client client(server_.port());
+  ASSERT_TRUE(client.connected());
+  client.Send(
+      "PUT /v2/echo HTTP/1.1\r\nHost: localhost\r\nContent-Length: 5\r\n"
+      "Connection: close\r\n\r\nhello");
+  EXPECT_EQ(client.ReadUntilClosed(),
+            "HTTP/1.1 200 OK\r\nContent-Length: 5\r\nContent-Type: "
+            "text/plain\r\nConnection: close\r\n\r\nhello");
+}
+
+TEST_F(HttpServerTest, KeepsConnectionAlive) {
+  Client client(server_.port());
+  ASSERT_TRUE(client.connected());
+  // The second request is sent along with the first one.
+  client.Send(
+      "PUT /v2/echo HTTP/1.1\r\nContent-Length: 3\r\n\r\nonePUT /v2/echo "
+      "HTTP/1.1\r\nContent-Length: 3\r\n\r\ntwo");
+  EXPECT_EQ(client.Read(EchoResponse("one").size()), EchoResponse("one"));
+  EXPECT_EQ(client.Read(EchoResponse("two").size()), EchoResponse("two"));
+  client.Send("PUT /v2/echo HTTP/1.1\r\nContent-Length: 5\r\n\r\nthree");
+  EXPECT_EQ(client.Read(EchoResponse("three").size()), EchoResponse("three"));
+}
+
+TEST_F(HttpServerTest, MatchesPathSuffixAndIgnoresQuery) {
+  Client client(server_.port());
+  ASSERT_TRUE(client.connected());
+  client.Send(
+      "PUT /prefix/v2/echo?debug=1 HTTP/1.1\r\nContent-Length: 2\r\n"
+      "Connection: close\r\n\r\nhi");
+  EXPECT_THAT(client.ReadUntilClosed(),
+              AllOf(StartsWith("HTTP/1.1 200 OK\r\n"), EndsWith("\r\n\r\nhi")));
+}
+
+TEST_F(HttpServerTest, AnswersContinue) {
+  Client client(server_.port());
+  ASSERT_TRUE(client.connected());
+  client.Send(
+      "PUT /v2/echo HTTP/1.1\r\nContent-Length: 4\r\nExpect: 100-continue\r\n"
+      "Connection: close\r\n\r\n");
+  constexpr std::string_view kContinue = "HTTP/1.1 100 Continue\r\n\r\n";
+  EXPECT_EQ(client.Read(kContinue.size()), kContinue);
+  client.Send("body");
+  EXPECT_THAT(client.ReadUntilClosed(), EndsWith("\r\n\r\nbody"));
+}
+
+TEST_F(HttpServerTest, UnknownPathIsNotFound) {
+  Client client(server_.port());
+  ASSERT_TRUE(client.connected());
+  client.Send("GET /unknown HTTP/1.1\r\nConnection: close\r\n\r\n");
+  EXPECT_THAT(client.ReadUntilClosed(), StartsWith("HTTP/1.1 404 Not Found"));
+}
+
+TEST_F(HttpServerTest, OtherMethodIsNotAllowed) {
+  Client client(server_.port());
+  ASSERT_TRUE(client.connected());
+  client.Send("GET /v2/echo HTTP/1.1\r\nConnection: close\r\n\r\n");
+  EXPECT_THAT(client.ReadUntilClosed(),
+              StartsWith("HTTP/1.1 405 Method Not Allowed"));
+}
+
+TEST_F(HttpServerTest, ChunkedBodyIsNotImplemented) {
+  Client client(server_.port());
+  ASSERT_TRUE(client.connected());
+  client.Send(
+      "PUT /v2/echo HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n0\r\n\r\n");
+  const std::string response = client.ReadUntilClosed();
+  EXPECT_THAT(response, StartsWith("HTTP/1.1 501 Not Implemented"));
+  EXPECT_THAT(response, HasSubstr("Connection: close"));
+}
+
+TEST_F(HttpServerTest, ShutdownClosesIdleConnections) {
+  Client client(server_.port());
+  ASSERT_TRUE(client.connected());
+  client.Send("PUT /v2/echo HTTP/1.1\r\nContent-Length: 2\r\n\r\nhi");
+  EXPECT_EQ(client.Read(EchoResponse("hi").size()), EchoResponse("hi"));
+  server_.Shutdown();
+  EXPECT_EQ(client.ReadUntilClosed(), "");
+}
+
+}  // namespace
+}  // namespace kv_server
@@ -15,6 +15,7 @@
 #include "components/data_server/server/key_value_service_impl.h"
 
 #include <string>
+#include <utility>
 
 #include <grpcpp/grpcpp.h>
 
@@ -30,17 +31,79 @@ using v1::GetValuesRequest;
 using v1::GetValuesResponse;
 using v1::KeyValueService;
 
+namespace {
+
+// Stands in for the protos in the request metrics of
+// `KeyValueServiceSerializedImpl`, which only has serialized messages.
+struct SerializedMessage {
+  size_t ByteSizeLong() const { return size; }
+  size_t size;
+};
+
+}  // namespace
+
 grpc::ServerUnaryReactor* KeyValueServiceImpl::GetValues(
     CallbackServerContext* context, const GetValuesRequest* request,
     GetValuesResponse* response) {
   auto request_received_time = absl::Now();
-  auto scope_metrics_context = std::make_unique<ScopeMetricsContext>();
-  RequestContext request_context(*scope_metrics_context);
-  grpc::Status status = handler_.GetValues(request_context, *request, response);
+  const ScopeMetricsContext scope_metrics_context;
+  RequestContext request_context(scope_metrics_context);
   auto* reactor = context->DefaultReactor();
+  auto admission =
+      admission_controller_.Admit(AdmissionController::GetPriority(*context));
+  grpc::Status status =
+      admission.ok()
+          ? handler_.GetValues(request_context, *request, response)
+          : grpc::Status(grpc::StatusCode::RESOURCE_EXHAUSTED,
+                         std::string(admission.status().message()));
   reactor->Finish(status);
   LogRequestCommonSafeMetrics(request, response, status, request_received_time);
   return reactor;
 }
 
+grpc::ServerUnaryReactor* KeyValueServiceSerializedImpl::GetValues(
+    CallbackServerContext* context, const grpc::ByteBuffer* request,
+    grpc::ByteBuffer* response) {
+  auto request_received_time = absl::Now();
+  const ScopeMetricsContext scope_metrics_context;
+  RequestContext request_context(scope_metrics_context);
+  auto* reactor = context->DefaultReactor();
+  auto admission =
+      admission_controller_.Admit(AdmissionController::GetPriority(*context));
+  if (!admission.ok()) {
+    const grpc::Status status(grpc::StatusCode::RESOURCE_EXHAUSTED,
+                              std::string(admission.status().message()));
+    reactor->Finish(status);
+    const SerializedMessage request_size{.size = request->Length()};
+    const SerializedMessage response_size{.size = 0};
+    LogRequestCommonSafeMetrics(&request_size, &response_size, status,
+                                request_received_time);
+    return reactor;
+  }
+  // Deserializing consumes the buffer, the copy only references its slices.
+  grpc::ByteBuffer request_buffer(*request);
+  GetValuesRequest request_proto;
+  grpc::Status status =
+      grpc::GenericDeserialize<grpc::ProtoBufferReader, GetValuesRequest>(
+          &request_buffer, &request_proto);
+  std::string serialized_response;
+  if (status.ok()) {
+    status = handler_.GetValuesSerialized(request_context, request_proto,
+                                          &serialized_response);
+  }
+  const SerializedMessage response_size{.size = serialized_response.size()};
+  if (status.ok()) {
+    // Hands the string over to gRPC instead of copying it into a slice.
+    auto* owned_response = new std::string(std::move(serialized_response));
+    grpc::Slice slice(
+        owned_response->data(), owned_response->size(),
+        [](void* p) { delete static_cast<std::string*>(p); }, owned_response);
+    *response = grpc::ByteBuffer(&slice, 1);
+  }
+  reactor->Finish(status);
+  LogRequestCommonSafeMetrics(&request_proto, &response_size, status,
+                              request_received_time);
+  return reactor;
+}
+
 }  // namespace kv_server
@@ -21,6 +21,7 @@
 #include <utility>
 
 #include "components/data_server/cache/cache.h"
+#include "components/data_server/server/admission_controller.h"
 #include "components/data_server/request_handler/get_values_handler.h"
 #include "grpcpp/grpcpp.h"
 #include "public/query/get_values.grpc.pb.h"
@@ -31,8 +32,10 @@ namespace kv_server {
 class KeyValueServiceImpl final
     : public kv_server::v1::KeyValueService::CallbackService {
  public:
-  explicit KeyValueServiceImpl(GetValuesHandler handler)
-      : handler_(std::move(handler)) {}
+  KeyValueServiceImpl(GetValuesHandler handler,
+                      AdmissionController& admission_controller)
+      : handler_(std::move(handler)),
+        admission_controller_(admission_controller) {}
 
   grpc::ServerUnaryReactor* GetValues(
       grpc::CallbackServerContext* context,
@@ -41,6 +44,28 @@ class KeyValueServiceImpl final
 
  private:
   GetValuesHandler handler_;
+  AdmissionController& admission_controller_;
+};
+
+// Implements Key-Value service on raw byte buffers, so that responses are
+// written by `GetValuesHandler::GetValuesSerialized` instead of being built
+// as protos and serialized by gRPC.
+class KeyValueServiceSerializedImpl final
+    : public kv_server::v1::KeyValueService::WithRawCallbackMethod_GetValues<
+          kv_server::v1::KeyValueService::Service> {
+ public:
+  KeyValueServiceSerializedImpl(GetValuesHandler handler,
+                                AdmissionController& admission_controller)
+      : handler_(std::move(handler)),
+        admission_controller_(admission_controller) {}
+
+  grpc::ServerUnaryReactor* GetValues(grpc::CallbackServerContext* context,
+                                      const grpc::ByteBuffer* request,
+                                      grpc::ByteBuffer* response) override;
+
+ private:
+  GetValuesHandler handler_;
+  AdmissionController& admission_controller_;
 };
 
 }  // namespace kv_server
@@ -0,0 +1,163 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/data_server/server/key_value_service_v2_http.h"
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "absl/strings/match.h"
+#include "absl/time/clock.h"
+#include "components/telemetry/request_trace.h"
+#include "components/telemetry/server_definition.h"
+#include "public/query/v2/get_values_v2.grpc.pb.h"
+
+namespace kv_server {
+namespace {
+
+template <typename RequestT>
+using HandlerFunctionT = void (GetValuesV2Handler::*)(
+    const RequestT&, google::api::HttpBody*,
+    GetValuesV2Handler::DoneCallback) const;
+
+HttpServer::Response ErrorResponse(const grpc::Status& status) {
+  return HttpServer::Response{.status_code =
+                                  HttpStatusCodeOf(status.error_code()),
+                              .content_type = "text/plain",
+                              .body = status.error_message()};
+}
+
+// Like `HandleRequest` of `KeyValueServiceV2Impl`, with the request built from
+// the HTTP request rather than transcoded.
+template <typename RequestT>
+HttpServer::Handler CreateHandler(
+    std::string_view name, const GetValuesV2Handler& handler,
+    HandlerFunctionT<RequestT> handler_function,
+    AdmissionController& admission_controller,
+    int64_t trace_sampling_interval) {
+  return [name, &handler, handler_function, &admission_controller,
+          trace_sampling_interval](HttpServer::Request http_request,
+                                   HttpServer::DoneCallback done) {
+    const absl::Time request_received_time = absl::Now();
+    auto request = std::make_unique<RequestT>();
+    google::api::HttpBody* raw_body = request->mutable_raw_body();
+    if (const auto iter = http_request.headers.find("content-type");
+        iter != http_request.headers.end()) {
+      raw_body->set_content_type(iter->second);
+    }
+    raw_body->set_data(std::move(http_request.body));
+    auto response = std::make_unique<google::api::HttpBody>();
+    const auto priority_iter =
+        http_request.headers.find(std::string(kPriorityMetadataKey));
+    auto admission = admission_controller.Admit(
+        priority_iter != http_request.headers.end() &&
+                priority_iter->second == kCriticalPriority
+            ? AdmissionController::Priority::kCritical
+            : AdmissionController::Priority::kDefault);
+    if (!admission.ok()) {
+      const grpc::Status status(grpc::StatusCode::RESOURCE_EXHAUSTED,
+                                std::string(admission.status().message()));
+      LogRequestCommonSafeMetrics(request.get(), response.get(), status,
+                                  request_received_time);
+      std::move(done)(ErrorResponse(status));
+      return;
+    }
+    std::shared_ptr<RequestTrace> trace =
+        RequestTrace::MaybeStart(name, trace_sampling_interval);
+    RequestTrace::Activation activation(trace);
+    const RequestT& request_ref = *request;
+    google::api::HttpBody* response_ptr = response.get();
+    // The admission is held until the handler completes.
+    (handler.*handler_function)(
+        request_ref, response_ptr,
+        [request = std::move(request), response = std::move(response),
+         request_received_time, admission = *std::move(admission), trace,
+         done = std::move(done)](grpc::Status status) mutable {
+          LogRequestCommonSafeMetrics(request.get(), response.get(), status,
+                                      request_received_time);
+          if (trace != nullptr) {
+            trace->End();
+          }
+          if (!status.ok()) {
+            std::move(done)(ErrorResponse(status));
+            return;
+          }
+          std::move(done)(HttpServer::Response{
+              .content_type = response->content_type(),
+              .body = std::move(*response->mutable_data())});
+        });
+  };
+}
+
+}  // namespace
+
+int HttpStatusCodeOf(grpc::StatusCode code) {
+  switch (code) {
+    case grpc::StatusCode::OK:
+      return 200;
+    case grpc::StatusCode::CANCELLED:
+      return 499;
+    case grpc::StatusCode::INVALID_ARGUMENT:
+    case grpc::StatusCode::FAILED_PRECONDITION:
+    case grpc::StatusCode::OUT_OF_RANGE:
+      return 400;
+    case grpc::StatusCode::DEADLINE_EXCEEDED:
+      return 504;
+    case grpc::StatusCode::NOT_FOUND:
+      return 404;
+    case grpc::StatusCode::ALREADY_EXISTS:
+    case grpc::StatusCode::ABORTED:
+      return 409;
+    case grpc::StatusCode::PERMISSION_DENIED:
+      return 403;
+    case grpc::StatusCode::UNAUTHENTICATED:
+      return 401;
+    case grpc::StatusCode::RESOURCE_EXHAUSTED:
+      return 429;
+    case grpc::StatusCode::UNIMPLEMENTED:
+      return 501;
+    case grpc::StatusCode::UNAVAILABLE:
+      return 503;
+    default:
+      return 500;
+  }
+}
+
+void AddKeyValueServiceV2HttpRoutes(const GetValuesV2Handler& handler,
+                                    AdmissionController& admission_controller,
+                                    HttpServer& http_server,
+                                    int64_t trace_sampling_interval) {
+  http_server.AddRoute(
+      "PUT", "/v2/getvalues",
+      CreateHandler<v2::GetValuesHttpRequest>(
+          "KeyValueServiceV2/GetValuesHttp", handler,
+          &GetValuesV2Handler::GetValuesHttp, admission_controller,
+          trace_sampling_interval));
+  http_server.AddRoute(
+      "POST", "/v2/bhttp_getvalues",
+      CreateHandler<v2::BinaryHttpGetValuesRequest>(
+          "KeyValueServiceV2/BinaryHttpGetValues", handler,
+          &GetValuesV2Handler::BinaryHttpGetValues, admission_controller,
+          trace_sampling_interval));
+  http_server.AddRoute(
+      "POST", "/v2/oblivious_getvalues",
+      CreateHandler<v2::ObliviousGetValuesRequest>(
+          "KeyValueServiceV2/ObliviousGetValues", handler,
+          &GetValuesV2Handler::ObliviousGetValues, admission_controller,
+          trace_sampling_interval));
+}
+
+}  // namespace kv_server
@@ -0,0 +1,48 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef COMPONENTS_DATA_SERVER_SERVER_KEY_VALUE_SERVICE_V2_HTTP_H_
+#define COMPONENTS_DATA_SERVER_SERVER_KEY_VALUE_SERVICE_V2_HTTP_H_
+
+#include <cstdint>
+
+#include "components/data_server/request_handler/get_values_v2_handler.h"
+#include "components/data_server/server/admission_controller.h"
+#include "components/data_server/server/http_server.h"
+#include "components/data_server/server/key_value_service_v2_impl.h"
+#include "grpcpp/grpcpp.h"
+
+namespace kv_server {
+
+// Returns the HTTP status code of a response with `code`, as mapped by the
+// gRPC-JSON transcoder.
+int HttpStatusCodeOf(grpc::StatusCode code);
+
+// Serves the `google.api.HttpBody` endpoints of the V2 API on `http_server`,
+// at the paths of their `google.api.http` options in `get_values_v2.proto`,
+// the way `KeyValueServiceV2Impl` serves them behind the transcoder: the raw
+// body is passed to `handler`, admitted by `admission_controller` and traced
+// one in every `trace_sampling_interval` requests. `handler` and
+// `admission_controller` must outlive `http_server`.
+void AddKeyValueServiceV2HttpRoutes(
+    const GetValuesV2Handler& handler,
+    AdmissionController& admission_controller, HttpServer& http_server,
+    int64_t trace_sampling_interval =
+        KeyValueServiceV2Impl::kDefaultTraceSamplingInterval);
+
+}  // namespace kv_server
+
+#endif  // COMPONENTS_DATA_SERVER_SERVER_KEY_VALUE_SERVICE_V2_HTTP_H_
@@ -0,0 +1,131 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/data_server/server/key_value_service_v2_http.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <string>
+#include <string_view>
+
+#include "absl/strings/str_cat.h"
+#include "components/telemetry/server_definition.h"
+#include "components/udf/mocks.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "src/encryption/key_fetcher/fake_key_fetcher_manager.h"
+
+namespace kv_server {
+namespace {
+
+using testing::_;
+using testing::HasSubstr;
+using testing::Not;
+using testing::Return;
+using testing::StartsWith;
+
+// Sends `request` on a new connection and returns everything the server sends
+// back until it closes the connection.
+std::string SendRequest(uint16_t port, std::string_view request) {
+  const int fd = socket(AF_INET, SOCK_STREAM, 0);
+  sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_port = htons(port);
+  inet_pton(AF_INET, "127.0.0.1", &address.sin_addr);
+  std::string response;
+  if (connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) ==
+          0 &&
+      send(fd, request.data(), request.size(), 0) == request.size()) {
+    char buffer[1024];
+    ssize_t read_bytes;
+    while ((read_bytes = recv(fd, buffer, sizeof(buffer), 0)) > 0) {
+      response.append(buffer, read_bytes);
+    }
+  }
+  close(fd);
+  return response;
+}
+
+class KeyValueServiceV2HttpTest : public ::testing::Test {
+ protected:
+  KeyValueServiceV2HttpTest()
+      : handler_(mock_udf_client_, fake_key_fetcher_manager_),
+        admission_controller_(AdmissionController::Options{}) {
+    InitMetricsContextMap();
+  }
+
+  void SetUp() override {
+    AddKeyValueServiceV2HttpRoutes(handler_, admission_controller_,
+                                   http_server_);
+    ASSERT_TRUE(http_server_.Start(HttpServer::Options{}).ok());
+  }
+
+  MockUdfClient mock_udf_client_;
+  privacy_sandbox::server_common::FakeKeyFetcherManager
+      fake_key_fetcher_manager_;
+  GetValuesV2Handler handler_;
+  AdmissionController admission_controller_;
+  HttpServer http_server_;
+};
+
+TEST_F(KeyValueServiceV2HttpTest, ServesGetValuesHttp) {
+  EXPECT_CALL(mock_udf_client_, ExecuteCode(_, _, testing::IsEmpty()))
+      .WillOnce(Return(absl::InternalError("UDF execution error")));
+  const std::string body = R"({"partitions": [{"id": 0}]})";
+  const std::string response = SendRequest(
+      http_server_.port(),
+      absl::StrCat("PUT /v2/getvalues HTTP/1.1\r\nContent-Type: "
+                   "application/json\r\nContent-Length: ",
+                   body.size(), "\r\nConnection: close\r\n\r\n", body));
+  EXPECT_THAT(response, StartsWith("HTTP/1.1 200 OK\r\n"));
+  // Failures of partitions are returned in the response.
+  EXPECT_THAT(response, HasSubstr("UDF execution error"));
+}
+
+TEST_F(KeyValueServiceV2HttpTest, ServesGetValuesHttpUnderPrefix) {
+  EXPECT_CALL(mock_udf_client_, ExecuteCode(_, _, testing::IsEmpty()))
+      .WillOnce(Return(absl::InternalError("UDF execution error")));
+  const std::string body = R"({"partitions": [{"id": 0}]})";
+  const std::string response = SendRequest(
+      http_server_.port(),
+      absl::StrCat("PUT /prefix/v2/getvalues HTTP/1.1\r\nContent-Length: ",
+                   body.size(), "\r\nConnection: close\r\n\r\n", body));
+  EXPECT_THAT(response, StartsWith("HTTP/1.1 200 OK\r\n"));
+}
+
+TEST_F(KeyValueServiceV2HttpTest, InvalidObliviousRequestIsError) {
+  const std::string response = SendRequest(
+      http_server_.port(),
+      "POST /v2/oblivious_getvalues HTTP/1.1\r\nContent-Length: 7\r\n"
+      "Connection: close\r\n\r\ninvalid");
+  EXPECT_THAT(response, StartsWith("HTTP/1.1 "));
+  EXPECT_THAT(response, Not(StartsWith("HTTP/1.1 200")));
+}
+
+TEST(HttpStatusCodeOfTest, MapsLikeTranscoder) {
+  EXPECT_EQ(HttpStatusCodeOf(grpc::StatusCode::OK), 200);
+  EXPECT_EQ(HttpStatusCodeOf(grpc::StatusCode::INVALID_ARGUMENT), 400);
+  EXPECT_EQ(HttpStatusCodeOf(grpc::StatusCode::NOT_FOUND), 404);
+  EXPECT_EQ(HttpStatusCodeOf(grpc::StatusCode::RESOURCE_EXHAUSTED), 429);
+  EXPECT_EQ(HttpStatusCodeOf(grpc::StatusCode::UNIMPLEMENTED), 501);
+  EXPECT_EQ(HttpStatusCodeOf(grpc::StatusCode::UNAVAILABLE), 503);
+  EXPECT_EQ(HttpStatusCodeOf(grpc::StatusCode::INTERNAL), 500);
+  EXPECT_EQ(HttpStatusCodeOf(grpc::StatusCode::DATA_LOSS), 500);
+}
+
+}  // namespace
+}  // namespace kv_server
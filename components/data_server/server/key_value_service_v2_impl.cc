@@ -14,8 +14,19 @@
 
 #include "components/data_server/server/key_value_service_v2_impl.h"
 
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
 #include <grpcpp/grpcpp.h>
 
+#include "absl/synchronization/mutex.h"
+#include "components/telemetry/request_trace.h"
+#include "components/util/request_context.h"
 #include "public/query/v2/get_values_v2.grpc.pb.h"
 #include "src/telemetry/telemetry.h"
 
@@ -28,51 +39,268 @@ using v2::GetValuesHttpRequest;
 using v2::KeyValueService;
 
 template <typename RequestT, typename ResponseT>
-using HandlerFunctionT = grpc::Status (GetValuesV2Handler::*)(const RequestT&,
-                                                              ResponseT*) const;
+using HandlerFunctionT = void (GetValuesV2Handler::*)(
+    const RequestT&, ResponseT*, GetValuesV2Handler::DoneCallback) const;
 
+// Finishes the RPC from the completion of the handler, so that no thread
+// waits for the UDFs of the request. Sampled requests are traced with a root
+// span named `name`, which is active while the handler is called, so that the
+// handler can pick it up for the request context.
 template <typename RequestT, typename ResponseT>
 grpc::ServerUnaryReactor* HandleRequest(
-    CallbackServerContext* context, const RequestT* request,
-    ResponseT* response, const GetValuesV2Handler& handler,
-    HandlerFunctionT<RequestT, ResponseT> handler_function) {
+    std::string_view name, CallbackServerContext* context,
+    const RequestT* request, ResponseT* response,
+    const GetValuesV2Handler& handler,
+    HandlerFunctionT<RequestT, ResponseT> handler_function,
+    AdmissionController& admission_controller,
+    int64_t trace_sampling_interval) {
   auto request_received_time = absl::Now();
-  grpc::Status status = (handler.*handler_function)(*request, response);
   auto* reactor = context->DefaultReactor();
-  reactor->Finish(status);
-  LogRequestCommonSafeMetrics(request, response, status, request_received_time);
+  auto admission =
+      admission_controller.Admit(AdmissionController::GetPriority(*context));
+  if (!admission.ok()) {
+    const grpc::Status status(grpc::StatusCode::RESOURCE_EXHAUSTED,
+                              std::string(admission.status().message()));
+    LogRequestCommonSafeMetrics(request, response, status,
+                                request_received_time);
+    reactor->Finish(status);
+    return reactor;
+  }
+  std::shared_ptr<RequestTrace> trace =
+      RequestTrace::MaybeStart(name, trace_sampling_interval);
+  RequestTrace::Activation activation(trace);
+  // The admission is held until the handler completes.
+  (handler.*handler_function)(
+      *request, response,
+      [request, response, reactor, request_received_time,
+       admission = *std::move(admission), trace](grpc::Status status) {
+        LogRequestCommonSafeMetrics(request, response, status,
+                                    request_received_time);
+        if (trace != nullptr) {
+          trace->End();
+        }
+        reactor->Finish(status);
+      });
   return reactor;
 }
 
+// Streams the partitions of a request as they complete. At most
+// `kMaxPartitionsInFlight` partitions are processed or waiting to be written
+// at once, so that the memory held for a request with many partitions does
+// not grow with the number of partitions, even if the client reads slowly.
+class StreamGetValuesReactor
+    : public grpc::ServerWriteReactor<v2::GetValuesResponse> {
+ public:
+  static constexpr size_t kMaxPartitionsInFlight = 16;
+
+  StreamGetValuesReactor(
+      const v2::GetValuesRequest& request, const GetValuesV2Handler& handler,
+      absl::StatusOr<AdmissionController::Admission> admission,
+      std::shared_ptr<RequestTrace> trace, absl::Time request_received_time)
+      : request_(request),
+        handler_(handler),
+        admission_(std::move(admission)),
+        trace_(std::move(trace)),
+        request_received_time_(request_received_time),
+        request_context_(scope_metrics_context_) {
+    request_context_.SetTrace(trace_);
+  }
+
+  void Start() {
+    if (!admission_.ok()) {
+      status_ = grpc::Status(grpc::StatusCode::RESOURCE_EXHAUSTED,
+                             std::string(admission_.status().message()));
+    } else if (request_.partitions().empty()) {
+      status_ = grpc::Status(grpc::StatusCode::INTERNAL,
+                             "At least 1 partition is required");
+    } else {
+      StartPartitions();
+    }
+    Release();
+  }
+
+  void OnWriteDone(bool ok) override {
+    const v2::GetValuesResponse* response = nullptr;
+    {
+      absl::MutexLock lock(&mutex_);
+      bytes_written_ += pending_.front().ByteSizeLong();
+      pending_.pop_front();
+      if (!ok) {
+        cancelled_ = true;
+      }
+      if (cancelled_) {
+        pending_.clear();
+      }
+      if (pending_.empty()) {
+        writing_ = false;
+      } else {
+        response = &pending_.front();
+        ++holds_;
+      }
+    }
+    if (response != nullptr) {
+      StartWrite(response);
+    }
+    StartPartitions();
+    Release();
+  }
+
+  void OnCancel() override {
+    absl::MutexLock lock(&mutex_);
+    cancelled_ = true;
+  }
+
+  void OnDone() override { delete this; }
+
+ private:
+  // Only the size of the streamed responses is logged.
+  struct StreamedBytes {
+    size_t ByteSizeLong() const { return bytes; }
+    size_t bytes = 0;
+  };
+
+  // Starts partitions until `kMaxPartitionsInFlight` are in flight. The
+  // partitions are started without holding the mutex, since their UDFs may
+  // complete synchronously.
+  void StartPartitions() {
+    std::vector<int> indices;
+    {
+      absl::MutexLock lock(&mutex_);
+      while (!cancelled_ && next_partition_ < request_.partitions_size() &&
+             num_running_ + pending_.size() < kMaxPartitionsInFlight) {
+        indices.push_back(next_partition_++);
+        ++num_running_;
+        ++holds_;
+      }
+    }
+    for (int index : indices) {
+      handler_.GetPartitionValues(request_context_, request_, index,
+                                  [this](v2::ResponsePartition partition) {
+                                    OnPartitionDone(std::move(partition));
+                                  });
+    }
+  }
+
+  void OnPartitionDone(v2::ResponsePartition partition) {
+    const v2::GetValuesResponse* response = nullptr;
+    {
+      absl::MutexLock lock(&mutex_);
+      --num_running_;
+      if (!cancelled_) {
+        pending_.emplace_back();
+        *pending_.back().mutable_single_partition() = std::move(partition);
+        if (!writing_) {
+          writing_ = true;
+          response = &pending_.front();
+          ++holds_;
+        }
+      }
+    }
+    if (response != nullptr) {
+      StartWrite(response);
+    }
+    StartPartitions();
+    Release();
+  }
+
+  // Every running partition, write in progress and callback running on the
+  // reactor holds it. The RPC is finished once nothing holds it anymore, when
+  // every partition is written or the RPC is cancelled.
+  void Release() {
+    grpc::Status status;
+    StreamedBytes streamed_bytes;
+    {
+      absl::MutexLock lock(&mutex_);
+      if (--holds_ > 0) {
+        return;
+      }
+      status = cancelled_ ? grpc::Status::CANCELLED : status_;
+      streamed_bytes.bytes = bytes_written_;
+    }
+    LogRequestCommonSafeMetrics(&request_, &streamed_bytes, status,
+                                request_received_time_);
+    if (trace_ != nullptr) {
+      trace_->End();
+    }
+    Finish(status);
+  }
+
+  const v2::GetValuesRequest& request_;
+  const GetValuesV2Handler& handler_;
+  // Held until the RPC is finished.
+  const absl::StatusOr<AdmissionController::Admission> admission_;
+  const std::shared_ptr<RequestTrace> trace_;
+  const absl::Time request_received_time_;
+  ScopeMetricsContext scope_metrics_context_;
+  RequestContext request_context_;
+  grpc::Status status_;
+  absl::Mutex mutex_;
+  // Held by `Start` until the first partitions are started.
+  int holds_ ABSL_GUARDED_BY(mutex_) = 1;
+  int next_partition_ ABSL_GUARDED_BY(mutex_) = 0;
+  size_t num_running_ ABSL_GUARDED_BY(mutex_) = 0;
+  // Responses that are not written yet. The first one is being written, if
+  // `writing_`.
+  std::deque<v2::GetValuesResponse> pending_ ABSL_GUARDED_BY(mutex_);
+  bool writing_ ABSL_GUARDED_BY(mutex_) = false;
+  bool cancelled_ ABSL_GUARDED_BY(mutex_) = false;
+  size_t bytes_written_ ABSL_GUARDED_BY(mutex_) = 0;
+};
+
 }  // namespace
 
 grpc::ServerUnaryReactor* KeyValueServiceV2Impl::GetValuesHttp(
     CallbackServerContext* context, const GetValuesHttpRequest* request,
     google::api::HttpBody* response) {
-  return HandleRequest(context, request, response, handler_,
-                       &GetValuesV2Handler::GetValuesHttp);
+  return HandleRequest("KeyValueServiceV2/GetValuesHttp", context, request,
+                       response, handler_, &GetValuesV2Handler::GetValuesHttp,
+                       admission_controller_, trace_sampling_interval_);
 }
 grpc::ServerUnaryReactor* KeyValueServiceV2Impl::GetValues(
     grpc::CallbackServerContext* context, const v2::GetValuesRequest* request,
     v2::GetValuesResponse* response) {
-  return HandleRequest(context, request, response, handler_,
-                       &GetValuesV2Handler::GetValues);
+  return HandleRequest("KeyValueServiceV2/GetValues", context, request,
+                       response, handler_, &GetValuesV2Handler::GetValues,
+                       admission_controller_, trace_sampling_interval_);
+}
+
+grpc::ServerWriteReactor<v2::GetValuesResponse>*
+KeyValueServiceV2Impl::StreamGetValues(grpc::CallbackServerContext* context,
+                                       const v2::GetValuesRequest* request) {
+  auto request_received_time = absl::Now();
+  auto admission =
+      admission_controller_.Admit(AdmissionController::GetPriority(*context));
+  std::shared_ptr<RequestTrace> trace;
+  if (admission.ok()) {
+    trace = RequestTrace::MaybeStart("KeyValueServiceV2/StreamGetValues",
+                                     trace_sampling_interval_);
+  }
+  auto* reactor = new StreamGetValuesReactor(*request, handler_,
+                                             std::move(admission),
+                                             std::move(trace),
+                                             request_received_time);
+  reactor->Start();
+  return reactor;
 }
 
 grpc::ServerUnaryReactor* KeyValueServiceV2Impl::BinaryHttpGetValues(
     CallbackServerContext* context,
     const v2::BinaryHttpGetValuesRequest* request,
     google::api::HttpBody* response) {
-  return HandleRequest(context, request, response, handler_,
-                       &GetValuesV2Handler::BinaryHttpGetValues);
+  return HandleRequest("KeyValueServiceV2/BinaryHttpGetValues", context,
+                       request, response, handler_,
+                       &GetValuesV2Handler::BinaryHttpGetValues,
+                       admission_controller_, trace_sampling_interval_);
 }
 
 grpc::ServerUnaryReactor* KeyValueServiceV2Impl::ObliviousGetValues(
     CallbackServerContext* context,
     const v2::ObliviousGetValuesRequest* request,
     google::api::HttpBody* response) {
-  return HandleRequest(context, request, response, handler_,
-                       &GetValuesV2Handler::ObliviousGetValues);
+  return HandleRequest("KeyValueServiceV2/ObliviousGetValues", context,
+                       request, response, handler_,
+                       &GetValuesV2Handler::ObliviousGetValues,
+                       admission_controller_, trace_sampling_interval_);
 }
 
 }  // namespace kv_server
@@ -17,10 +17,12 @@
 #ifndef COMPONENTS_DATA_SERVER_SERVER_KEY_VALUE_SERVICE_V2_IMPL_H_
 #define COMPONENTS_DATA_SERVER_SERVER_KEY_VALUE_SERVICE_V2_IMPL_H_
 
+#include <cstdint>
 #include <memory>
 #include <utility>
 
 #include "components/data_server/cache/cache.h"
+#include "components/data_server/server/admission_controller.h"
 #include "components/data_server/request_handler/get_values_v2_handler.h"
 #include "grpcpp/grpcpp.h"
 #include "public/query/v2/get_values_v2.grpc.pb.h"
@@ -28,11 +30,21 @@
 namespace kv_server {
 
 // Implements Key-Value service Query V2 API.
+//
+// One in every `trace_sampling_interval` requests is traced, recording the
+// time spent in each stage of the request, such as UDF execution, hook calls
+// and lookups of remote shards. Not positive to trace no request.
 class KeyValueServiceV2Impl final
     : public v2::KeyValueService::CallbackService {
  public:
-  explicit KeyValueServiceV2Impl(GetValuesV2Handler handler)
-      : handler_(std::move(handler)) {}
+  static constexpr int64_t kDefaultTraceSamplingInterval = 10000;
+
+  KeyValueServiceV2Impl(
+      GetValuesV2Handler handler, AdmissionController& admission_controller,
+      int64_t trace_sampling_interval = kDefaultTraceSamplingInterval)
+      : handler_(std::move(handler)),
+        admission_controller_(admission_controller),
+        trace_sampling_interval_(trace_sampling_interval) {}
 
   grpc::ServerUnaryReactor* GetValuesHttp(
       grpc::CallbackServerContext* context,
@@ -43,6 +55,10 @@ class KeyValueServiceV2Impl final
                                       const v2::GetValuesRequest* request,
                                       v2::GetValuesResponse* response) override;
 
+  grpc::ServerWriteReactor<v2::GetValuesResponse>* StreamGetValues(
+      grpc::CallbackServerContext* context,
+      const v2::GetValuesRequest* request) override;
+
   grpc::ServerUnaryReactor* BinaryHttpGetValues(
       grpc::CallbackServerContext* context,
       const v2::BinaryHttpGetValuesRequest* request,
@@ -55,6 +71,8 @@ class KeyValueServiceV2Impl final
 
  private:
   const GetValuesV2Handler handler_;
+  AdmissionController& admission_controller_;
+  const int64_t trace_sampling_interval_;
 };
 
 }  // namespace kv_server
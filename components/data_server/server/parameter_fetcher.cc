@@ -18,7 +18,9 @@
 #include <utility>
 #include <vector>
 
+#include "absl/log/log.h"
 #include "absl/strings/str_join.h"
+#include "absl/time/time.h"
 #include "components/errors/retry.h"
 #include "public/constants.h"
 
@@ -63,6 +65,22 @@ bool ParameterFetcher::GetBoolParameter(
       "GetParameter", metrics_callback_, {{"param", param_name}});
 }
 
+void ParameterFetcher::PrefetchParameters(
+    absl::Span<const std::string_view> parameter_suffixes) const {
+  std::vector<std::string> param_names;
+  param_names.reserve(parameter_suffixes.size());
+  for (std::string_view parameter_suffix : parameter_suffixes) {
+    param_names.push_back(GetParamName(parameter_suffix));
+  }
+  const absl::Time start = absl::Now();
+  if (absl::Status status = parameter_client_.PrefetchParameters(param_names);
+      !status.ok()) {
+    LOG(WARNING) << "Failed to prefetch parameters: " << status;
+  }
+  LOG(INFO) << "Prefetched " << param_names.size() << " parameters in "
+            << absl::Now() - start;
+}
+
 std::string ParameterFetcher::GetParamName(
     std::string_view parameter_suffix) const {
   const std::vector<std::string_view> v = {kServiceName, environment_,
@@ -25,6 +25,7 @@
 #include <utility>
 
 #include "absl/status/statusor.h"
+#include "absl/types/span.h"
 #include "components/cloud_config/parameter_client.h"
 #include "components/data/blob_storage/blob_storage_change_notifier.h"
 #include "components/data/blob_storage/blob_storage_client.h"
@@ -53,6 +54,12 @@ class ParameterFetcher {
   // This function will retry any necessary requests until it succeeds.
   virtual bool GetBoolParameter(std::string_view parameter_suffix) const;
 
+  // Fetches the parameters with `parameter_suffixes` together ahead of
+  // getting them, see `ParameterClient::PrefetchParameters`. Failures are only
+  // logged, since the parameters are then fetched on their own.
+  virtual void PrefetchParameters(
+      absl::Span<const std::string_view> parameter_suffixes) const;
+
   virtual NotifierMetadata GetBlobStorageNotifierMetadata() const;
 
   virtual BlobStorageClient::ClientOptions GetBlobStorageClientOptions() const;
@@ -36,6 +36,19 @@ constexpr std::string_view kS3ClientMaxConnectionsParameterSuffix =
 constexpr std::string_view kS3ClientMaxRangeBytesParameterSuffix =
     "s3client-max-range-bytes";
 
+// Number of ranges read ahead by AWS's blob storage client
+constexpr std::string_view kBlobReadAheadChunksParameterSuffix =
+    "blob-read-ahead-chunks";
+
+// Number of threads applying realtime updates, 0 applies them on the thread
+// receiving them
+constexpr std::string_view kRealtimeApplierThreadsParameterSuffix =
+    "realtime-applier-threads";
+
+// Maximum number of threads receiving realtime updates for each notifier.
+constexpr std::string_view kRealtimeMaxReceiversParameterSuffix =
+    "realtime-max-receivers";
+
 NotifierMetadata ParameterFetcher::GetBlobStorageNotifierMetadata() const {
   std::string bucket_sns_arn =
       GetParameter(kDataLoadingFileChannelBucketSNSParameterSuffix);
@@ -55,6 +68,10 @@ BlobStorageClient::ClientOptions ParameterFetcher::GetBlobStorageClientOptions()
       GetInt32Parameter(kS3ClientMaxRangeBytesParameterSuffix);
   LOG(INFO) << "Retrieved " << kS3ClientMaxRangeBytesParameterSuffix
             << " parameter: " << client_options.max_range_bytes;
+  client_options.num_read_ahead_chunks =
+      GetInt32Parameter(kBlobReadAheadChunksParameterSuffix);
+  LOG(INFO) << "Retrieved " << kBlobReadAheadChunksParameterSuffix
+            << " parameter: " << client_options.num_read_ahead_chunks;
   return client_options;
 }
 
@@ -64,8 +81,20 @@ NotifierMetadata ParameterFetcher::GetRealtimeNotifierMetadata(
       GetParameter(kDataLoadingRealtimeChannelSNSParameterSuffix);
   LOG(INFO) << "Retrieved " << kDataLoadingRealtimeChannelSNSParameterSuffix
             << " parameter: " << realtime_sns_arn;
-  return AwsNotifierMetadata{"QueueNotifier_", std::move(realtime_sns_arn),
-                             .num_shards = num_shards, .shard_num = shard_num};
+  const int32_t num_applier_threads =
+      GetInt32Parameter(kRealtimeApplierThreadsParameterSuffix);
+  LOG(INFO) << "Retrieved " << kRealtimeApplierThreadsParameterSuffix
+            << " parameter: " << num_applier_threads;
+  const int32_t max_receivers =
+      GetInt32Parameter(kRealtimeMaxReceiversParameterSuffix);
+  LOG(INFO) << "Retrieved " << kRealtimeMaxReceiversParameterSuffix
+            << " parameter: " << max_receivers;
+  return AwsNotifierMetadata{"QueueNotifier_",
+                             std::move(realtime_sns_arn),
+                             .num_shards = num_shards,
+                             .shard_num = shard_num,
+                             .num_applier_threads = num_applier_threads,
+                             .max_receivers = max_receivers};
 }
 
 }  // namespace kv_server
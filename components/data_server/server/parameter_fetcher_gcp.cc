@@ -26,6 +26,14 @@ constexpr std::string_view kEnvironment = "environment";
 constexpr std::string_view kProjectId = "project-id";
 constexpr std::string_view kRealtimeUpdaterThreadNumberParameterSuffix =
     "realtime-updater-num-threads";
+constexpr std::string_view kRealtimeApplierThreadsParameterSuffix =
+    "realtime-applier-threads";
+constexpr std::string_view kRealtimeMaxOutstandingMessagesParameterSuffix =
+    "realtime-max-outstanding-messages";
+constexpr std::string_view kRealtimeMaxOutstandingMbParameterSuffix =
+    "realtime-max-outstanding-mb";
+constexpr std::string_view kBlobReadAheadChunksParameterSuffix =
+    "blob-read-ahead-chunks";
 NotifierMetadata ParameterFetcher::GetBlobStorageNotifierMetadata() const {
   // TODO: set to proper values. Waiting on the change notifier implementation.
   return GcpNotifierMetadata{};
@@ -33,7 +41,12 @@ NotifierMetadata ParameterFetcher::GetBlobStorageNotifierMetadata() const {
 
 BlobStorageClient::ClientOptions ParameterFetcher::GetBlobStorageClientOptions()
     const {
-  return BlobStorageClient::ClientOptions();
+  BlobStorageClient::ClientOptions client_options;
+  client_options.num_read_ahead_chunks =
+      GetInt32Parameter(kBlobReadAheadChunksParameterSuffix);
+  LOG(INFO) << "Retrieved " << kBlobReadAheadChunksParameterSuffix
+            << " parameter: " << client_options.num_read_ahead_chunks;
+  return client_options;
 }
 
 NotifierMetadata ParameterFetcher::GetRealtimeNotifierMetadata(
@@ -44,6 +57,18 @@ NotifierMetadata ParameterFetcher::GetRealtimeNotifierMetadata(
       GetInt32Parameter(kRealtimeUpdaterThreadNumberParameterSuffix);
   LOG(INFO) << "Retrieved " << kRealtimeUpdaterThreadNumberParameterSuffix
             << " parameter: " << realtime_thread_numbers;
+  const int32_t num_applier_threads =
+      GetInt32Parameter(kRealtimeApplierThreadsParameterSuffix);
+  LOG(INFO) << "Retrieved " << kRealtimeApplierThreadsParameterSuffix
+            << " parameter: " << num_applier_threads;
+  const int32_t max_outstanding_messages =
+      GetInt32Parameter(kRealtimeMaxOutstandingMessagesParameterSuffix);
+  LOG(INFO) << "Retrieved " << kRealtimeMaxOutstandingMessagesParameterSuffix
+            << " parameter: " << max_outstanding_messages;
+  const int32_t max_outstanding_mb =
+      GetInt32Parameter(kRealtimeMaxOutstandingMbParameterSuffix);
+  LOG(INFO) << "Retrieved " << kRealtimeMaxOutstandingMbParameterSuffix
+            << " parameter: " << max_outstanding_mb;
   std::string topic_id =
       absl::StrFormat("kv-server-%s-realtime-pubsub", environment);
   std::string project_id = GetParameter(kProjectId);
@@ -55,6 +80,9 @@ NotifierMetadata ParameterFetcher::GetRealtimeNotifierMetadata(
       .num_threads = realtime_thread_numbers,
       .num_shards = num_shards,
       .shard_num = shard_num,
+      .num_applier_threads = num_applier_threads,
+      .max_outstanding_messages = max_outstanding_messages,
+      .max_outstanding_bytes = int64_t{max_outstanding_mb} << 20,
   };
 }
 
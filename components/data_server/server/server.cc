@@ -14,35 +14,59 @@
 
 #include "components/data_server/server/server.h"
 
+#include <algorithm>
+#include <functional>
+#include <future>
 #include <optional>
+#include <thread>
 
+#include "absl/cleanup/cleanup.h"
+#include "absl/container/flat_hash_set.h"
 #include "absl/flags/flag.h"
 #include "absl/flags/parse.h"
 #include "absl/flags/usage.h"
 #include "absl/functional/bind_front.h"
+#include "absl/functional/function_ref.h"
 #include "absl/log/log.h"
 #include "absl/log/log_sink_registry.h"
 #include "absl/status/status.h"
+#include "absl/status/statusor.h"
 #include "absl/strings/str_cat.h"
+#include "absl/strings/str_split.h"
 #include "components/data/blob_storage/blob_prefix_allowlist.h"
+#include "components/data/blob_storage/caching_blob_storage_client.h"
+#include "components/data/blob_storage/manifest_blob_storage_client.h"
+#include "components/data_server/cache/cold_value_log.h"
+#include "components/data_server/cache/key_value_arena.h"
+#include "components/data_server/cache/prefixed_key_value_cache.h"
+#include "components/data_server/cache/sharded_key_value_cache.h"
+#include "components/data_server/request_handler/compression.h"
 #include "components/data_server/request_handler/get_values_adapter.h"
 #include "components/data_server/request_handler/get_values_handler.h"
 #include "components/data_server/request_handler/get_values_v2_handler.h"
+#include "components/data_server/request_handler/ohttp_key_cache.h"
+#include "components/data_server/server/heap_allocator.h"
 #include "components/data_server/server/key_fetcher_factory.h"
 #include "components/data_server/server/key_value_service_impl.h"
+#include "components/data_server/server/key_value_service_v2_http.h"
 #include "components/data_server/server/key_value_service_v2_impl.h"
 #include "components/errors/retry.h"
 #include "components/internal_server/constants.h"
 #include "components/internal_server/local_lookup.h"
 #include "components/internal_server/lookup_server_impl.h"
 #include "components/internal_server/sharded_lookup.h"
+#include "components/profiling/profiling_service_impl.h"
 #include "components/sharding/cluster_mappings_manager.h"
 #include "components/telemetry/kv_telemetry.h"
+#include "components/telemetry/request_counters.h"
 #include "components/telemetry/server_definition.h"
+#include "components/udf/hooks/get_keys_containing_hook.h"
 #include "components/udf/hooks/get_values_hook.h"
 #include "components/udf/hooks/run_query_hook.h"
 #include "components/udf/udf_config_builder.h"
 #include "components/util/build_info.h"
+#include "components/util/lock_profiler.h"
+#include "components/util/thread_placement.h"
 #include "google/protobuf/text_format.h"
 #include "grpcpp/ext/proto_server_reflection_plugin.h"
 #include "grpcpp/health_check_service_interface.h"
@@ -50,6 +74,7 @@
 #include "public/data_loading/readers/avro_stream_record_reader_factory.h"
 #include "public/data_loading/readers/riegeli_stream_record_reader_factory.h"
 #include "public/data_loading/readers/stream_record_reader_factory.h"
+#include "public/sharding/logical_shard_mapping.h"
 #include "public/udf/constants.h"
 #include "src/google/protobuf/struct.pb.h"
 #include "src/telemetry/init.h"
@@ -58,6 +83,19 @@
 
 ABSL_FLAG(uint16_t, port, 50051,
           "Port the server is listening on. Defaults to 50051.");
+ABSL_FLAG(uint16_t, http_port, 0,
+          "Port of the built-in HTTP/1.1 listener, which serves the HTTP "
+          "endpoints of the V2 API without the transcoding proxy. 0 to "
+          "disable it.");
+ABSL_FLAG(bool, profile_lock_contention, false,
+          "Whether to export how long the locks of the cache, the shard "
+          "manager and the data loaders wait and are held, for debugging.");
+ABSL_FLAG(bool, enable_profiling_service, false,
+          "Whether to serve the admin profiling service, which returns CPU "
+          "and heap profiles of the server on demand. Must not be enabled "
+          "on servers that are reachable by untrusted clients.");
+ABSL_FLAG(int32_t, max_profile_duration_seconds, 60,
+          "Longest profile that the profiling service takes.");
 
 namespace kv_server {
 namespace {
@@ -86,8 +124,12 @@ constexpr absl::string_view kRealtimeUpdaterThreadNumberParameterSuffix =
     "realtime-updater-num-threads";
 constexpr absl::string_view kDataLoadingNumThreadsParameterSuffix =
     "data-loading-num-threads";
+constexpr absl::string_view kReaderShardsPerThreadParameterSuffix =
+    "reader-shards-per-thread";
 constexpr absl::string_view kDataLoadingFileFormatSuffix =
     "data-loading-file-format";
+constexpr absl::string_view kDataLoadingConcurrencyParameterSuffix =
+    "data-loading-concurrency";
 constexpr absl::string_view kNumShardsParameterSuffix = "num-shards";
 constexpr absl::string_view kUdfNumWorkersParameterSuffix = "udf-num-workers";
 constexpr absl::string_view kLoggingVerbosityLevelParameterSuffix =
@@ -100,8 +142,30 @@ constexpr absl::string_view kUseShardingKeyRegexParameterSuffix =
     "use-sharding-key-regex";
 constexpr absl::string_view kShardingKeyRegexParameterSuffix =
     "sharding-key-regex";
+constexpr absl::string_view kShardingReplicatedKeysParameterSuffix =
+    "sharding-replicated-keys";
+constexpr absl::string_view kUseSiphashShardingParameterSuffix =
+    "use-siphash-sharding";
+constexpr absl::string_view kNumLogicalShardsParameterSuffix =
+    "num-logical-shards";
 constexpr absl::string_view kRouteV1ToV2Suffix = "route-v1-to-v2";
 constexpr absl::string_view kAddMissingKeysV1Suffix = "add-missing-keys-v1";
+constexpr absl::string_view kV1DirectSerializationSuffix =
+    "v1-direct-serialization";
+constexpr absl::string_view kV1MergeNamespaceLookupsSuffix =
+    "v1-merge-namespace-lookups";
+constexpr std::string_view kGrpcMaxConcurrentStreamsParameterSuffix =
+    "grpc-max-concurrent-streams";
+constexpr std::string_view kGrpcMaxThreadsPerCoreParameterSuffix =
+    "grpc-max-threads-per-core";
+constexpr std::string_view kGrpcMemoryQuotaMbParameterSuffix =
+    "grpc-memory-quota-mb";
+constexpr std::string_view kAdmissionMaxInFlightParameterSuffix =
+    "admission-max-in-flight";
+constexpr std::string_view kAdmissionCriticalReservePercentParameterSuffix =
+    "admission-critical-reserve-percent";
+constexpr std::string_view kAdmissionLatencyTargetMsParameterSuffix =
+    "admission-latency-target-ms";
 constexpr absl::string_view kAutoscalerHealthcheck = "autoscaler-healthcheck";
 constexpr absl::string_view kLoadbalancerHealthcheck =
     "loadbalancer-healthcheck";
@@ -109,7 +173,187 @@ constexpr absl::string_view kEnableOtelLoggerParameterSuffix =
     "enable-otel-logger";
 constexpr std::string_view kDataLoadingBlobPrefixAllowlistSuffix =
     "data-loading-blob-prefix-allowlist";
+constexpr std::string_view kDataLoadingPriorityPrefixesParameterSuffix =
+    "data-loading-priority-prefixes";
 constexpr std::string_view kTelemetryConfigSuffix = "telemetry-config";
+constexpr std::string_view kCacheNumSegmentsParameterSuffix =
+    "cache-num-segments";
+constexpr std::string_view kUseEpochBasedCacheParameterSuffix =
+    "use-epoch-based-cache";
+constexpr std::string_view kCacheInternSetValuesParameterSuffix =
+    "cache-intern-set-values";
+constexpr std::string_view kCachePrecomputeJsonValuesParameterSuffix =
+    "cache-precompute-json-values";
+constexpr std::string_view kCacheCompressValuesParameterSuffix =
+    "cache-compress-values";
+constexpr std::string_view kCacheDeduplicateValuesParameterSuffix =
+    "cache-deduplicate-values";
+constexpr std::string_view kCacheIsolatePrefixesParameterSuffix =
+    "cache-isolate-prefixes";
+constexpr std::string_view kCacheIndexSetValuesParameterSuffix =
+    "cache-index-set-values";
+constexpr std::string_view kCacheIndexKeysParameterSuffix = "cache-index-keys";
+constexpr std::string_view kCacheHotKeySampleRateParameterSuffix =
+    "cache-hot-key-sample-rate";
+constexpr std::string_view kCacheColdValueDirectoryParameterSuffix =
+    "cache-cold-value-directory";
+constexpr std::string_view kCacheMaxHotValueMbParameterSuffix =
+    "cache-max-hot-value-mb";
+constexpr std::string_view kCacheUseHugePagesParameterSuffix =
+    "cache-use-huge-pages";
+constexpr std::string_view kBlobCacheDirectoryParameterSuffix =
+    "blob-cache-directory";
+constexpr std::string_view kBlobCacheMaxSizeMbParameterSuffix =
+    "blob-cache-max-size-mb";
+constexpr std::string_view kUseDataFileManifestParameterSuffix =
+    "use-data-file-manifest";
+constexpr std::string_view kCacheCheckpointFileParameterSuffix =
+    "cache-checkpoint-file";
+constexpr std::string_view kCacheCheckpointMinsParameterSuffix =
+    "cache-checkpoint-mins";
+constexpr std::string_view kCacheCleanupMillisParameterSuffix =
+    "cache-cleanup-millis";
+constexpr std::string_view kCacheCleanupPauseMsParameterSuffix =
+    "cache-cleanup-pause-ms";
+constexpr std::string_view kSnapshotReloadMinsParameterSuffix =
+    "snapshot-reload-mins";
+constexpr std::string_view kReadinessMaxLagSecsParameterSuffix =
+    "readiness-max-lag-secs";
+constexpr std::string_view kRealtimeCoalesceMillisParameterSuffix =
+    "realtime-coalesce-millis";
+constexpr std::string_view kPushDeltaNotificationsParameterSuffix =
+    "push-delta-notifications";
+constexpr std::string_view kTrustDataFileRecordsParameterSuffix =
+    "trust-data-file-records";
+constexpr std::string_view kDeltaPrefetchMaxMbParameterSuffix =
+    "delta-prefetch-max-mb";
+constexpr std::string_view kUdfWarmUpInvocationsParameterSuffix =
+    "udf-warm-up-invocations";
+constexpr std::string_view kUdfBatchWindowUsParameterSuffix =
+    "udf-batch-window-us";
+constexpr std::string_view kUdfMaxBatchSizeParameterSuffix =
+    "udf-max-batch-size";
+constexpr std::string_view kUdfCacheMaxMbParameterSuffix = "udf-cache-max-mb";
+constexpr std::string_view kResponseBrotliQualityParameterSuffix =
+    "response-brotli-quality";
+constexpr std::string_view kResponseBrotliWindowParameterSuffix =
+    "response-brotli-window";
+constexpr std::string_view kLookupCacheMaxEntriesParameterSuffix =
+    "lookup-cache-max-entries";
+constexpr std::string_view kLookupCacheTtlMsParameterSuffix =
+    "lookup-cache-ttl-ms";
+constexpr std::string_view kResponseCacheMaxEntriesParameterSuffix =
+    "response-cache-max-entries";
+constexpr std::string_view kResponseCacheTtlMsParameterSuffix =
+    "response-cache-ttl-ms";
+constexpr std::string_view kQueryEvaluationThreadsParameterSuffix =
+    "query-evaluation-threads";
+constexpr std::string_view kDataLoadingMaxRecordsPerSecondParameterSuffix =
+    "data-loading-max-records-per-second";
+constexpr std::string_view kDataLoadingMinRecordsPerSecondParameterSuffix =
+    "data-loading-min-records-per-second";
+constexpr std::string_view kDataLoadingLatencyTargetMsParameterSuffix =
+    "data-loading-latency-target-ms";
+constexpr std::string_view kServingCpusParameterSuffix = "serving-cpus";
+constexpr std::string_view kServingMemoryPolicyParameterSuffix =
+    "serving-memory-policy";
+constexpr std::string_view kDataLoadingCpusParameterSuffix =
+    "data-loading-cpus";
+constexpr std::string_view kDataLoadingMemoryPolicyParameterSuffix =
+    "data-loading-memory-policy";
+constexpr std::string_view kLoadCompactedDeltaFilesParameterSuffix =
+    "load-compacted-delta-files";
+constexpr std::string_view kDataLoadingApplyThreadsParameterSuffix =
+    "data-loading-apply-threads";
+constexpr std::string_view kDownloadSnapshotFilesParameterSuffix =
+    "download-snapshot-files";
+constexpr std::string_view kBulkLoadSnapshotsParameterSuffix =
+    "bulk-load-snapshots";
+constexpr std::string_view kHeapAllocatorMaxPerCpuCacheBytesParameterSuffix =
+    "heap-allocator-max-per-cpu-cache-bytes";
+constexpr std::string_view kReleaseHeapMemoryAfterLoadingParameterSuffix =
+    "release-heap-memory-after-loading";
+
+// The parameters read on startup, fetched together ahead of reading them.
+// Parameters missing from here are still read, one request each.
+constexpr std::string_view kStartupParameterSuffixes[] = {
+    kDataBucketParameterSuffix, kBackupPollFrequencySecsParameterSuffix,
+    kUseExternalMetricsCollectorEndpointSuffix, kMetricsCollectorEndpointSuffix,
+    kMetricsExportIntervalMillisParameterSuffix,
+    kMetricsExportTimeoutMillisParameterSuffix,
+    kRealtimeUpdaterThreadNumberParameterSuffix,
+    kDataLoadingNumThreadsParameterSuffix,
+    kReaderShardsPerThreadParameterSuffix, kDataLoadingFileFormatSuffix,
+    kDataLoadingConcurrencyParameterSuffix, kNumShardsParameterSuffix,
+    kUdfNumWorkersParameterSuffix, kLoggingVerbosityLevelParameterSuffix,
+    kUdfTimeoutMillisParameterSuffix, kUdfMinLogLevelParameterSuffix,
+    kUseShardingKeyRegexParameterSuffix, kShardingKeyRegexParameterSuffix,
+    kShardingReplicatedKeysParameterSuffix, kUseSiphashShardingParameterSuffix,
+    kNumLogicalShardsParameterSuffix, kRouteV1ToV2Suffix,
+    kAddMissingKeysV1Suffix, kV1DirectSerializationSuffix,
+    kV1MergeNamespaceLookupsSuffix, kGrpcMaxConcurrentStreamsParameterSuffix,
+    kGrpcMaxThreadsPerCoreParameterSuffix, kGrpcMemoryQuotaMbParameterSuffix,
+    kAdmissionMaxInFlightParameterSuffix,
+    kAdmissionCriticalReservePercentParameterSuffix,
+    kAdmissionLatencyTargetMsParameterSuffix, kEnableOtelLoggerParameterSuffix,
+    kDataLoadingBlobPrefixAllowlistSuffix,
+    kDataLoadingPriorityPrefixesParameterSuffix, kTelemetryConfigSuffix,
+    kCacheNumSegmentsParameterSuffix, kUseEpochBasedCacheParameterSuffix,
+    kCacheInternSetValuesParameterSuffix,
+    kCachePrecomputeJsonValuesParameterSuffix,
+    kCacheCompressValuesParameterSuffix,
+    kCacheDeduplicateValuesParameterSuffix,
+    kCacheIsolatePrefixesParameterSuffix,
+    kCacheIndexSetValuesParameterSuffix,
+    kCacheIndexKeysParameterSuffix,
+    kCacheHotKeySampleRateParameterSuffix,
+    kCacheColdValueDirectoryParameterSuffix, kCacheMaxHotValueMbParameterSuffix,
+    kBlobCacheDirectoryParameterSuffix,
+    kBlobCacheMaxSizeMbParameterSuffix,
+    kUseDataFileManifestParameterSuffix, kCacheCheckpointFileParameterSuffix,
+    kCacheCheckpointMinsParameterSuffix, kCacheCleanupMillisParameterSuffix,
+    kCacheCleanupPauseMsParameterSuffix, kSnapshotReloadMinsParameterSuffix,
+    kReadinessMaxLagSecsParameterSuffix, kRealtimeCoalesceMillisParameterSuffix,
+    kPushDeltaNotificationsParameterSuffix,
+    kTrustDataFileRecordsParameterSuffix, kDeltaPrefetchMaxMbParameterSuffix,
+    kUdfWarmUpInvocationsParameterSuffix, kUdfBatchWindowUsParameterSuffix,
+    kUdfMaxBatchSizeParameterSuffix, kUdfCacheMaxMbParameterSuffix,
+    kResponseBrotliQualityParameterSuffix,
+    kResponseBrotliWindowParameterSuffix, kLookupCacheMaxEntriesParameterSuffix,
+    kLookupCacheTtlMsParameterSuffix, kQueryEvaluationThreadsParameterSuffix,
+    kDataLoadingMaxRecordsPerSecondParameterSuffix,
+    kDataLoadingMinRecordsPerSecondParameterSuffix,
+    kDataLoadingLatencyTargetMsParameterSuffix, kServingCpusParameterSuffix,
+    kServingMemoryPolicyParameterSuffix, kDataLoadingCpusParameterSuffix,
+    kDataLoadingMemoryPolicyParameterSuffix,
+    kLoadCompactedDeltaFilesParameterSuffix,
+    kDataLoadingApplyThreadsParameterSuffix,
+    kDownloadSnapshotFilesParameterSuffix,
+    kBulkLoadSnapshotsParameterSuffix,
+    kHeapAllocatorMaxPerCpuCacheBytesParameterSuffix,
+    kReleaseHeapMemoryAfterLoadingParameterSuffix,
+    kCacheUseHugePagesParameterSuffix,
+    kResponseCacheMaxEntriesParameterSuffix,
+    kResponseCacheTtlMsParameterSuffix};
+
+// How often the amount of data of every prefix of the cache is logged.
+constexpr absl::Duration kCachePrefixStatsLogInterval = absl::Minutes(1);
+// How often the requests counted on their hot path are logged.
+constexpr absl::Duration kRequestCountsLogInterval = absl::Seconds(1);
+// How often the freshness of the data of every prefix is logged and checked
+// for readiness.
+constexpr absl::Duration kDataFreshnessCheckInterval = absl::Seconds(1);
+// Threads of the executor of the periodic background tasks. They only log,
+// check or clean up briefly, so a few threads are shared by all of them.
+constexpr int kBackgroundExecutorThreads = 4;
+// How often the stats of the queues of the background executor are logged.
+constexpr absl::Duration kBackgroundExecutorStatsLogInterval =
+    absl::Minutes(5);
+// How often the stats of the heap allocator are logged.
+constexpr absl::Duration kHeapAllocatorStatsLogInterval = absl::Minutes(1);
+// How often the OHTTP gateways of the private keys fetched in the background
+// by the key fetcher manager are set up.
+constexpr absl::Duration kOhttpGatewaysPrepareInterval = absl::Minutes(1);
 
 opentelemetry::sdk::metrics::PeriodicExportingMetricReaderOptions
 GetMetricsOptions(const ParameterClient& parameter_client,
@@ -190,25 +434,413 @@ BlobPrefixAllowlist GetBlobPrefixAllowlist(
   return BlobPrefixAllowlist(prefix_allowlist);
 }
 
+// Returns the cache of the sharded lookups of the UDF hooks, or null if it is
+// disabled.
+std::unique_ptr<LookupCache> CreateLookupCache(
+    const ParameterFetcher& parameter_fetcher) {
+  LookupCacheOptions options;
+  options.max_entries = parameter_fetcher.GetInt32Parameter(
+      kLookupCacheMaxEntriesParameterSuffix);
+  LOG(INFO) << "Retrieved " << kLookupCacheMaxEntriesParameterSuffix
+            << " parameter: " << options.max_entries;
+  if (options.max_entries <= 0) {
+    return nullptr;
+  }
+  const int32_t ttl_ms =
+      parameter_fetcher.GetInt32Parameter(kLookupCacheTtlMsParameterSuffix);
+  LOG(INFO) << "Retrieved " << kLookupCacheTtlMsParameterSuffix
+            << " parameter: " << ttl_ms;
+  if (ttl_ms <= 0) {
+    LOG(ERROR) << kLookupCacheTtlMsParameterSuffix
+               << " must be > 0, disabling the lookup cache";
+    return nullptr;
+  }
+  options.ttl = absl::Milliseconds(ttl_ms);
+  return std::make_unique<LookupCache>(options);
+}
+
+// Returns the cache of the responses to V2 requests, or null if it is
+// disabled. It is disabled with more than one shard: the responses hold the
+// values of other shards, whose updates are not loaded by this server and so
+// would not invalidate them.
+std::unique_ptr<ResponseCache> CreateResponseCache(
+    const ParameterFetcher& parameter_fetcher, int32_t num_shards) {
+  ResponseCacheOptions options;
+  options.max_entries = parameter_fetcher.GetInt32Parameter(
+      kResponseCacheMaxEntriesParameterSuffix);
+  LOG(INFO) << "Retrieved " << kResponseCacheMaxEntriesParameterSuffix
+            << " parameter: " << options.max_entries;
+  if (options.max_entries <= 0) {
+    return nullptr;
+  }
+  if (num_shards > 1) {
+    LOG(WARNING) << "Disabling the response cache of " << num_shards
+                 << " shards, it only supports a single shard";
+    return nullptr;
+  }
+  const int32_t ttl_ms =
+      parameter_fetcher.GetInt32Parameter(kResponseCacheTtlMsParameterSuffix);
+  LOG(INFO) << "Retrieved " << kResponseCacheTtlMsParameterSuffix
+            << " parameter: " << ttl_ms;
+  if (ttl_ms <= 0) {
+    LOG(ERROR) << kResponseCacheTtlMsParameterSuffix
+               << " must be > 0, disabling the response cache";
+    return nullptr;
+  }
+  options.ttl = absl::Milliseconds(ttl_ms);
+  return std::make_unique<ResponseCache>(options);
+}
+
+// Returns the throttle of the loading of new data files, or null if it is
+// disabled.
+std::unique_ptr<LoadingThrottle> CreateLoadingThrottle(
+    const ParameterFetcher& parameter_fetcher) {
+  LoadingThrottle::Options options;
+  options.max_records_per_second = parameter_fetcher.GetInt32Parameter(
+      kDataLoadingMaxRecordsPerSecondParameterSuffix);
+  LOG(INFO) << "Retrieved " << kDataLoadingMaxRecordsPerSecondParameterSuffix
+            << " parameter: " << options.max_records_per_second;
+  if (options.max_records_per_second <= 0) {
+    return nullptr;
+  }
+  options.min_records_per_second = parameter_fetcher.GetInt32Parameter(
+      kDataLoadingMinRecordsPerSecondParameterSuffix);
+  LOG(INFO) << "Retrieved " << kDataLoadingMinRecordsPerSecondParameterSuffix
+            << " parameter: " << options.min_records_per_second;
+  const int32_t latency_target_ms = parameter_fetcher.GetInt32Parameter(
+      kDataLoadingLatencyTargetMsParameterSuffix);
+  LOG(INFO) << "Retrieved " << kDataLoadingLatencyTargetMsParameterSuffix
+            << " parameter: " << latency_target_ms;
+  options.latency_target = absl::Milliseconds(latency_target_ms);
+  // Averages the latencies of the requests since the previous call. Only
+  // called by the throttle, which serializes the calls.
+  options.serving_latency =
+      [previous = RequestCounters::Global().GetLatencyTotals()]() mutable {
+        const RequestCounters::LatencyTotals totals =
+            RequestCounters::Global().GetLatencyTotals();
+        const int64_t num_requests =
+            totals.num_requests - previous.num_requests;
+        const absl::Duration total_latency =
+            totals.total_latency - previous.total_latency;
+        previous = totals;
+        return num_requests > 0 ? total_latency / num_requests
+                                : absl::ZeroDuration();
+      };
+  return std::make_unique<LoadingThrottle>(std::move(options));
+}
+
+// Returns the placement of a group of threads, from the parameters with its
+// CPU list and memory policy.
+absl::StatusOr<ThreadPlacement> GetThreadPlacement(
+    const ParameterFetcher& parameter_fetcher, std::string_view cpus_suffix,
+    std::string_view memory_policy_suffix) {
+  const std::string cpu_list =
+      parameter_fetcher.GetParameter(cpus_suffix, /*default_value=*/"");
+  LOG(INFO) << "Retrieved " << cpus_suffix << " parameter: " << cpu_list;
+  const std::string memory_policy = parameter_fetcher.GetParameter(
+      memory_policy_suffix, /*default_value=*/"");
+  LOG(INFO) << "Retrieved " << memory_policy_suffix
+            << " parameter: " << memory_policy;
+  ThreadPlacement placement;
+  auto cpus = ParseCpuList(cpu_list);
+  if (!cpus.ok()) {
+    return cpus.status();
+  }
+  placement.cpus = *std::move(cpus);
+  auto policy = ParseMemoryPolicy(memory_policy);
+  if (!policy.ok()) {
+    return policy.status();
+  }
+  placement.memory_policy = *policy;
+  return placement;
+}
+
+bool IsDefaultPlacement(const ThreadPlacement& placement) {
+  return placement.cpus.empty() &&
+         placement.memory_policy == MemoryPolicy::kLocal;
+}
+
+// Places the calling thread, and with it the threads it creates afterwards.
+// Failures are only logged, e.g. in environments that forbid setting a memory
+// policy, since the server works the same without the placement.
+void PlaceCurrentThread(const ThreadPlacement& placement,
+                        std::string_view thread_group) {
+  if (absl::Status status = SetCurrentThreadPlacement(placement);
+      !status.ok()) {
+    LOG(ERROR) << "Failed to place the " << thread_group
+               << " threads: " << status;
+  }
+}
+
+// Logs `change` to the up-down counter `definition` of `prefix`, so that it
+// reads as a gauge.
+template <const auto& definition>
+void LogUpDownCounterChange(const std::string& prefix, double change) {
+  if (change == 0) {
+    return;
+  }
+  LogIfError(KVServerContextMap()->SafeMetric().LogUpDownCounter<definition>(
+      {{prefix, change}}));
+}
+
+// Runs the server initialization step `name` and logs how long it took.
+absl::Status RunInitStep(std::string_view name,
+                         absl::FunctionRef<absl::Status()> step) {
+  const absl::Time start = absl::Now();
+  absl::Status status = step();
+  LOG(INFO) << "Initialization step " << name << " took "
+            << absl::Now() - start << ": " << status;
+  return status;
+}
+
 }  // namespace
 
 Server::Server()
-    : string_get_values_hook_(
+    : background_executor_(
+          std::make_unique<Executor>(kBackgroundExecutorThreads)),
+      string_get_values_hook_(
           GetValuesHook::Create(GetValuesHook::OutputType::kString)),
       binary_get_values_hook_(
           GetValuesHook::Create(GetValuesHook::OutputType::kBinary)),
-      run_query_hook_(RunQueryHook::Create()) {}
+      run_query_hook_(RunQueryHook::Create(RunQueryHook::OutputType::kString)),
+      binary_run_query_hook_(
+          RunQueryHook::Create(RunQueryHook::OutputType::kBinary)),
+      uint32_run_query_hook_(
+          RunQueryHook::Create(RunQueryHook::OutputType::kUInt32)),
+      get_keys_containing_hook_(GetKeysContainingHook::Create()),
+      native_udfs_(NativeUdfRegistry::Create()),
+      compression_dictionaries_(
+          std::make_unique<CompressionDictionaryStore>()) {
+  background_executor_stats_closure_ =
+      PeriodicClosure::Create(*background_executor_, "executor_stats");
+  if (absl::Status status = background_executor_stats_closure_->StartDelayed(
+          kBackgroundExecutorStatsLogInterval,
+          [this]() { LogBackgroundExecutorStats(); });
+      !status.ok()) {
+    LOG(ERROR) << "Failed to start logging the background executor stats: "
+               << status;
+  }
+}
+
+void Server::StartHeapAllocatorManagement(
+    const ParameterFetcher& parameter_fetcher) {
+  const int32_t max_per_cpu_cache_bytes = parameter_fetcher.GetInt32Parameter(
+      kHeapAllocatorMaxPerCpuCacheBytesParameterSuffix);
+  LOG(INFO) << "Retrieved " << kHeapAllocatorMaxPerCpuCacheBytesParameterSuffix
+            << " parameter: " << max_per_cpu_cache_bytes;
+  SetHeapAllocatorMaxPerCpuCacheBytes(max_per_cpu_cache_bytes);
+  release_heap_memory_after_loading_ = parameter_fetcher.GetBoolParameter(
+      kReleaseHeapMemoryAfterLoadingParameterSuffix);
+  LOG(INFO) << "Retrieved " << kReleaseHeapMemoryAfterLoadingParameterSuffix
+            << " parameter: " << release_heap_memory_after_loading_;
+  heap_allocator_stats_closure_ =
+      PeriodicClosure::Create(*background_executor_, "heap_allocator_stats");
+  if (absl::Status status = heap_allocator_stats_closure_->StartNow(
+          kHeapAllocatorStatsLogInterval,
+          [this]() { LogHeapAllocatorStats(); });
+      !status.ok()) {
+    LOG(ERROR) << "Failed to start logging the heap allocator stats: "
+               << status;
+  }
+}
+
+void Server::LogHeapAllocatorStats() {
+  for (const auto& [use, bytes] : GetHeapAllocatorStats()) {
+    int64_t& logged_bytes = logged_heap_allocator_stats_[use];
+    LogUpDownCounterChange<kHeapAllocatorBytes>(use, bytes - logged_bytes);
+    logged_bytes = bytes;
+  }
+}
+
+void Server::LogBackgroundExecutorStats() const {
+  for (const auto& [queue, stats] : background_executor_->Stats()) {
+    LOG(INFO) << "Background executor queue " << queue << " ran "
+              << stats.tasks_run << " tasks for " << stats.run_time;
+  }
+}
 
 // Because the cache relies on telemetry, this function needs to be
 // called right after telemetry has been initialized but before anything that
 // requires the cache has been initialized.
 void Server::InitializeKeyValueCache() {
-  cache_ = KeyValueCache::Create();
-  cache_->UpdateKeyValue(
-      "hi",
-      "Hello, world! If you are seeing this, it means you can "
-      "query me successfully",
-      /*logical_commit_time = */ 1);
+  ParameterFetcher parameter_fetcher(environment_, *parameter_client_);
+  const bool use_epoch_based_cache =
+      parameter_fetcher.GetBoolParameter(kUseEpochBasedCacheParameterSuffix);
+  LOG(INFO) << "Retrieved " << kUseEpochBasedCacheParameterSuffix
+            << " parameter: " << use_epoch_based_cache;
+  const int32_t cache_num_segments =
+      parameter_fetcher.GetInt32Parameter(kCacheNumSegmentsParameterSuffix);
+  LOG(INFO) << "Retrieved " << kCacheNumSegmentsParameterSuffix
+            << " parameter: " << cache_num_segments;
+  const bool cache_intern_set_values =
+      parameter_fetcher.GetBoolParameter(kCacheInternSetValuesParameterSuffix);
+  LOG(INFO) << "Retrieved " << kCacheInternSetValuesParameterSuffix
+            << " parameter: " << cache_intern_set_values;
+  const bool cache_precompute_json_values = parameter_fetcher.GetBoolParameter(
+      kCachePrecomputeJsonValuesParameterSuffix);
+  LOG(INFO) << "Retrieved " << kCachePrecomputeJsonValuesParameterSuffix
+            << " parameter: " << cache_precompute_json_values;
+  const bool cache_compress_values =
+      parameter_fetcher.GetBoolParameter(kCacheCompressValuesParameterSuffix);
+  LOG(INFO) << "Retrieved " << kCacheCompressValuesParameterSuffix
+            << " parameter: " << cache_compress_values;
+  if (use_epoch_based_cache && cache_compress_values) {
+    LOG(WARNING) << "The epoch based cache does not compress values";
+  }
+  const bool cache_deduplicate_values = parameter_fetcher.GetBoolParameter(
+      kCacheDeduplicateValuesParameterSuffix);
+  LOG(INFO) << "Retrieved " << kCacheDeduplicateValuesParameterSuffix
+            << " parameter: " << cache_deduplicate_values;
+  if (use_epoch_based_cache && cache_deduplicate_values) {
+    LOG(WARNING) << "The epoch based cache does not deduplicate values";
+  }
+  const bool cache_isolate_prefixes =
+      parameter_fetcher.GetBoolParameter(kCacheIsolatePrefixesParameterSuffix);
+  LOG(INFO) << "Retrieved " << kCacheIsolatePrefixesParameterSuffix
+            << " parameter: " << cache_isolate_prefixes;
+  if (use_epoch_based_cache && cache_isolate_prefixes) {
+    LOG(WARNING) << "The epoch based cache does not isolate prefixes";
+  } else if (cache_isolate_prefixes && cache_num_segments > 1) {
+    LOG(WARNING) << "The cache is not segmented when it isolates prefixes";
+  }
+  const bool cache_index_set_values =
+      parameter_fetcher.GetBoolParameter(kCacheIndexSetValuesParameterSuffix);
+  LOG(INFO) << "Retrieved " << kCacheIndexSetValuesParameterSuffix
+            << " parameter: " << cache_index_set_values;
+  const bool cache_index_keys =
+      parameter_fetcher.GetBoolParameter(kCacheIndexKeysParameterSuffix);
+  LOG(INFO) << "Retrieved " << kCacheIndexKeysParameterSuffix
+            << " parameter: " << cache_index_keys;
+  const int32_t cache_hot_key_sample_rate = parameter_fetcher.GetInt32Parameter(
+      kCacheHotKeySampleRateParameterSuffix);
+  LOG(INFO) << "Retrieved " << kCacheHotKeySampleRateParameterSuffix
+            << " parameter: " << cache_hot_key_sample_rate;
+  std::optional<ColdValueLog::Options> cold_value_log_options;
+  if (std::string cold_value_directory = parameter_fetcher.GetParameter(
+          kCacheColdValueDirectoryParameterSuffix, /*default_value=*/"");
+      !cold_value_directory.empty()) {
+    LOG(INFO) << "Retrieved " << kCacheColdValueDirectoryParameterSuffix
+              << " parameter: " << cold_value_directory;
+    const int32_t cache_max_hot_value_mb = parameter_fetcher.GetInt32Parameter(
+        kCacheMaxHotValueMbParameterSuffix);
+    LOG(INFO) << "Retrieved " << kCacheMaxHotValueMbParameterSuffix
+              << " parameter: " << cache_max_hot_value_mb;
+    cold_value_log_options = ColdValueLog::Options{
+        .directory = std::move(cold_value_directory),
+        .max_hot_value_bytes = int64_t{cache_max_hot_value_mb} << 20,
+    };
+    if (use_epoch_based_cache || cache_isolate_prefixes) {
+      LOG(WARNING) << "The cache does not spill values to disk when it is "
+                      "epoch based or isolates prefixes";
+    }
+  }
+  const bool cache_use_huge_pages =
+      parameter_fetcher.GetBoolParameter(kCacheUseHugePagesParameterSuffix);
+  LOG(INFO) << "Retrieved " << kCacheUseHugePagesParameterSuffix
+            << " parameter: " << cache_use_huge_pages;
+  // Also applies to the caches that new snapshot files are reloaded into.
+  KeyValueArena::EnableHugePages(cache_use_huge_pages);
+  const int32_t cache_cleanup_millis =
+      parameter_fetcher.GetInt32Parameter(kCacheCleanupMillisParameterSuffix);
+  LOG(INFO) << "Retrieved " << kCacheCleanupMillisParameterSuffix
+            << " parameter: " << cache_cleanup_millis;
+  int32_t cache_cleanup_pause_ms = 0;
+  if (cache_cleanup_millis > 0) {
+    cache_cleanup_pause_ms = parameter_fetcher.GetInt32Parameter(
+        kCacheCleanupPauseMsParameterSuffix);
+    LOG(INFO) << "Retrieved " << kCacheCleanupPauseMsParameterSuffix
+              << " parameter: " << cache_cleanup_pause_ms;
+  }
+  if (cold_value_log_options.has_value() && cache_cleanup_millis <= 0) {
+    LOG(WARNING) << "Values are only spilled to disk by the background "
+                    "cleanup, which is disabled";
+  }
+  // Also creates the caches that new snapshot files are reloaded into.
+  create_cache_ = [use_epoch_based_cache, cache_num_segments,
+                   cache_intern_set_values, cache_precompute_json_values,
+                   cache_compress_values, cache_deduplicate_values,
+                   cache_isolate_prefixes, cache_index_set_values,
+                   cache_index_keys, cache_hot_key_sample_rate,
+                   cold_value_log_options, cache_cleanup_millis,
+                   cache_cleanup_pause_ms]() {
+    std::unique_ptr<Cache> cache;
+    if (use_epoch_based_cache) {
+      cache = EpochKeyValueCache::Create(cache_intern_set_values,
+                                         cache_precompute_json_values);
+    } else if (cache_isolate_prefixes) {
+      cache = PrefixedKeyValueCache::Create(
+          cache_intern_set_values, cache_precompute_json_values,
+          cache_compress_values, cache_deduplicate_values);
+    } else if (cache_num_segments > 1) {
+      cache = ShardedKeyValueCache::Create(
+          cache_num_segments, cache_intern_set_values,
+          cache_precompute_json_values, cache_compress_values,
+          cache_deduplicate_values, cold_value_log_options);
+    } else {
+      cache = KeyValueCache::Create(
+          cache_intern_set_values, cache_precompute_json_values,
+          cache_compress_values, cache_deduplicate_values,
+          cold_value_log_options);
+    }
+    if (cache_index_set_values) {
+      if (absl::Status status = cache->EnableSetValueIndex(); !status.ok()) {
+        LOG(ERROR) << "getKeysContaining will fail, the set values are not "
+                      "indexed: "
+                   << status;
+      }
+    }
+    if (cache_index_keys) {
+      if (absl::Status status = cache->EnableSortedKeyIndex(); !status.ok()) {
+        LOG(ERROR) << "getValuesByPrefix will fail, the keys are not "
+                      "indexed: "
+                   << status;
+      }
+    }
+    if (cache_hot_key_sample_rate > 0) {
+      if (absl::Status status =
+              cache->EnableHotKeyTracking(cache_hot_key_sample_rate);
+          !status.ok()) {
+        LOG(ERROR) << "Hot keys are not tracked: " << status;
+      }
+    }
+    cache->UpdateKeyValue(
+        "hi",
+        "Hello, world! If you are seeing this, it means you can "
+        "query me successfully",
+        /*logical_commit_time = */ 1);
+    if (cache_cleanup_millis > 0) {
+      if (absl::Status status = cache->StartBackgroundCleanup(
+              absl::Milliseconds(cache_cleanup_millis),
+              absl::Milliseconds(cache_cleanup_pause_ms));
+          !status.ok()) {
+        LOG(ERROR) << "Removing deleted keys after loading every file "
+                      "instead of in the background: "
+                   << status;
+      }
+    }
+    return cache;
+  };
+  snapshot_reload_mins_ =
+      parameter_fetcher.GetInt32Parameter(kSnapshotReloadMinsParameterSuffix);
+  LOG(INFO) << "Retrieved " << kSnapshotReloadMinsParameterSuffix
+            << " parameter: " << snapshot_reload_mins_;
+  if (snapshot_reload_mins_ > 0) {
+    auto swappable_cache = std::make_unique<SwappableCache>(create_cache_());
+    swappable_cache_ = swappable_cache.get();
+    cache_ = std::move(swappable_cache);
+  } else {
+    cache_ = create_cache_();
+  }
+  prefix_stats_logger_ = std::make_unique<PrefixStatsLogger>(*cache_);
+  prefix_stats_closure_ =
+      PeriodicClosure::Create(*background_executor_, "prefix_stats");
+  if (absl::Status status = prefix_stats_closure_->StartNow(
+          kCachePrefixStatsLogInterval,
+          [this]() { prefix_stats_logger_->Log(); });
+      !status.ok()) {
+    LOG(ERROR) << "Failed to start logging the cache size per prefix: "
+               << status;
+  }
 }
 
 void Server::InitOtelLogger(
@@ -272,6 +904,16 @@ void Server::InitializeTelemetry(const ParameterClient& parameter_client,
   InitOtelLogger(CreateKVAttributes(std::move(instance_id),
                                     std::to_string(shard_num_), environment_),
                  metrics_collector_endpoint, parameter_fetcher);
+  request_counts_closure_ =
+      PeriodicClosure::Create(*background_executor_, "request_counts");
+  if (absl::Status status = request_counts_closure_->StartNow(
+          kRequestCountsLogInterval, []() {
+            LogRequestCounts();
+            LogUdfUsage();
+          });
+      !status.ok()) {
+    LOG(ERROR) << "Failed to start logging the request counts: " << status;
+  }
   LOG(INFO) << "Done init telemetry";
 }
 
@@ -288,6 +930,7 @@ absl::Status Server::CreateDefaultInstancesIfNecessaryAndGetEnvironment(
       "GetEnvironment", LogMetricsNoOpCallback());
   LOG(INFO) << "Retrieved environment: " << environment_;
   ParameterFetcher parameter_fetcher(environment_, *parameter_client_);
+  parameter_fetcher.PrefetchParameters(kStartupParameterSuffixes);
 
   int32_t number_of_workers =
       parameter_fetcher.GetInt32Parameter(kUdfNumWorkersParameterSuffix);
@@ -300,10 +943,39 @@ absl::Status Server::CreateDefaultInstancesIfNecessaryAndGetEnvironment(
   // downstream.
   absl::SetGlobalVLogLevel(parameter_fetcher.GetInt32Parameter(
       kLoggingVerbosityLevelParameterSuffix));
+  // Threads created from here on inherit the serving placement of this
+  // thread, among them the gRPC threads and the UDF workers.
+  const auto serving_placement =
+      GetThreadPlacement(parameter_fetcher, kServingCpusParameterSuffix,
+                         kServingMemoryPolicyParameterSuffix);
+  if (!serving_placement.ok()) {
+    return serving_placement.status();
+  }
+  if (!IsDefaultPlacement(*serving_placement)) {
+    PlaceCurrentThread(*serving_placement, "serving");
+  }
   if (udf_client != nullptr) {
     udf_client_ = std::move(udf_client);
     return absl::OkStatus();
   }
+  const int32_t udf_warm_up_invocations = parameter_fetcher.GetInt32Parameter(
+      kUdfWarmUpInvocationsParameterSuffix);
+  LOG(INFO) << "Retrieved " << kUdfWarmUpInvocationsParameterSuffix
+            << " parameter: " << udf_warm_up_invocations;
+  const int32_t udf_batch_window_us =
+      parameter_fetcher.GetInt32Parameter(kUdfBatchWindowUsParameterSuffix);
+  LOG(INFO) << "Retrieved " << kUdfBatchWindowUsParameterSuffix
+            << " parameter: " << udf_batch_window_us;
+  const int32_t udf_max_batch_size =
+      parameter_fetcher.GetInt32Parameter(kUdfMaxBatchSizeParameterSuffix);
+  LOG(INFO) << "Retrieved " << kUdfMaxBatchSizeParameterSuffix
+            << " parameter: " << udf_max_batch_size;
+  const int32_t udf_cache_max_mb =
+      parameter_fetcher.GetInt32Parameter(kUdfCacheMaxMbParameterSuffix);
+  LOG(INFO) << "Retrieved " << kUdfCacheMaxMbParameterSuffix
+            << " parameter: " << udf_cache_max_mb;
+  udf_cache_hook_ =
+      UdfCacheHook::Create(static_cast<int64_t>(udf_cache_max_mb) << 20);
   UdfConfigBuilder config_builder;
   // TODO(b/289244673): Once roma interface is updated, internal lookup client
   // can be removed and we can own the unique ptr to the hooks.
@@ -312,11 +984,20 @@ absl::Status Server::CreateDefaultInstancesIfNecessaryAndGetEnvironment(
           std::move(config_builder
                         .RegisterStringGetValuesHook(*string_get_values_hook_)
                         .RegisterBinaryGetValuesHook(*binary_get_values_hook_)
+                        .RegisterGroupedGetValuesHook(*string_get_values_hook_)
+                        .RegisterPrefixGetValuesHook(*string_get_values_hook_)
                         .RegisterRunQueryHook(*run_query_hook_)
+                        .RegisterBinaryRunQueryHook(*binary_run_query_hook_)
+                        .RegisterUInt32RunQueryHook(*uint32_run_query_hook_)
+                        .RegisterGetKeysContainingHook(
+                            *get_keys_containing_hook_)
+                        .RegisterCacheHook(*udf_cache_hook_)
                         .RegisterLoggingFunction()
                         .SetNumberOfWorkers(number_of_workers)
                         .Config()),
-          absl::Milliseconds(udf_timeout_ms), udf_min_log_level);
+          absl::Milliseconds(udf_timeout_ms), udf_min_log_level,
+          udf_warm_up_invocations, native_udfs_.get(),
+          absl::Microseconds(udf_batch_window_us), udf_max_batch_size);
   if (udf_client_or_status.ok()) {
     udf_client_ = std::move(*udf_client_or_status);
   }
@@ -341,27 +1022,68 @@ absl::Status Server::Init(
   return InitOnceInstancesAreCreated();
 }
 
-KeySharder GetKeySharder(const ParameterFetcher& parameter_fetcher) {
+// Returns the mapping of the logical shards to the `num_shards` physical
+// shards, with the assignments of the latest logical sharding config file in
+// the data bucket, or nullopt without logical shards.
+absl::StatusOr<std::optional<LogicalShardMapping>> GetLogicalShardMapping(
+    const ParameterFetcher& parameter_fetcher, int32_t num_shards,
+    BlobStorageClient& blob_client) {
+  if (num_shards <= 1) {
+    return std::nullopt;
+  }
+  const int32_t num_logical_shards =
+      parameter_fetcher.GetInt32Parameter(kNumLogicalShardsParameterSuffix);
+  LOG(INFO) << "Retrieved " << kNumLogicalShardsParameterSuffix
+            << " parameter: " << num_logical_shards;
+  if (num_logical_shards <= 0) {
+    return std::nullopt;
+  }
+  const std::string data_bucket =
+      parameter_fetcher.GetParameter(kDataBucketParameterSuffix);
+  // Logical sharding config files are written in the Riegeli format.
+  RiegeliStreamRecordReaderFactory reader_factory;
+  auto physical_shards = DataOrchestrator::ReadLogicalShardMapping(
+      blob_client, reader_factory, data_bucket);
+  if (!physical_shards.ok()) {
+    return physical_shards.status();
+  }
+  LOG(INFO) << "Read " << physical_shards->size()
+            << " logical shard assignments from the data bucket";
+  return LogicalShardMapping::Create(num_logical_shards, num_shards,
+                                     *physical_shards);
+}
+
+KeySharder GetKeySharder(
+    const ParameterFetcher& parameter_fetcher,
+    std::optional<LogicalShardMapping> logical_shard_mapping) {
+  const bool use_siphash_sharding =
+      parameter_fetcher.GetBoolParameter(kUseSiphashShardingParameterSuffix);
+  LOG(INFO) << "Retrieved " << kUseSiphashShardingParameterSuffix
+            << " parameter: " << use_siphash_sharding;
+  ShardingFunction func(/*seed=*/"", use_siphash_sharding
+                                         ? ShardingHash::kSipHash
+                                         : ShardingHash::kSha256);
+  const std::string replicated_keys = parameter_fetcher.GetParameter(
+      kShardingReplicatedKeysParameterSuffix, /*default_value=*/"");
+  LOG(INFO) << "Retrieved " << kShardingReplicatedKeysParameterSuffix
+            << " parameter: " << replicated_keys;
+  absl::flat_hash_set<std::string> replicated_key_set =
+      absl::StrSplit(replicated_keys, ',', absl::SkipEmpty());
   const bool use_sharding_key_regex =
       parameter_fetcher.GetBoolParameter(kUseShardingKeyRegexParameterSuffix);
   LOG(INFO) << "Retrieved " << kUseShardingKeyRegexParameterSuffix
             << " parameter: " << use_sharding_key_regex;
-  ShardingFunction func(/*seed=*/"");
-  std::optional<std::regex> shard_key_regex;
-  if (use_sharding_key_regex) {
-    std::string sharding_key_regex_value =
-        parameter_fetcher.GetParameter(kShardingKeyRegexParameterSuffix);
-    LOG(INFO) << "Retrieved " << kShardingKeyRegexParameterSuffix
-              << " parameter: " << sharding_key_regex_value;
-    // https://en.cppreference.com/w/cpp/regex/syntax_option_type
-    // optimize -- "Instructs the regular expression engine to make matching
-    // faster, with the potential cost of making construction slower. For
-    // example, this might mean converting a non-deterministic FSA to a
-    // deterministic FSA." this matches our usecase.
-    shard_key_regex = std::regex(std::move(sharding_key_regex_value),
-                                 std::regex_constants::optimize);
-  }
-  return KeySharder(func, std::move(shard_key_regex));
+  if (!use_sharding_key_regex) {
+    return KeySharder(func, std::nullopt, std::move(replicated_key_set),
+                      std::move(logical_shard_mapping));
+  }
+  const std::string sharding_key_regex_value =
+      parameter_fetcher.GetParameter(kShardingKeyRegexParameterSuffix);
+  LOG(INFO) << "Retrieved " << kShardingKeyRegexParameterSuffix
+            << " parameter: " << sharding_key_regex_value;
+  return KeySharder(func, sharding_key_regex_value,
+                    std::move(replicated_key_set),
+                    std::move(logical_shard_mapping));
 }
 
 absl::Status Server::InitOnceInstancesAreCreated() {
@@ -378,12 +1100,15 @@ absl::Status Server::InitOnceInstancesAreCreated() {
   }
   LOG(INFO) << "Retrieved shard num: " << shard_num_;
   InitializeTelemetry(*parameter_client_, *instance_client_);
+  LockProfiler::SetEnabled(absl::GetFlag(FLAGS_profile_lock_contention));
   InitializeKeyValueCache();
   auto span = GetTracer()->StartSpan("InitServer");
   auto scope = opentelemetry::trace::Scope(span);
   LOG(INFO) << "Creating lifecycle heartbeat...";
   std::unique_ptr<LifecycleHeartbeat> lifecycle_heartbeat =
-      LifecycleHeartbeat::Create(*instance_client_);
+      LifecycleHeartbeat::Create(
+          PeriodicClosure::Create(*background_executor_, "heartbeat"),
+          *instance_client_);
   ParameterFetcher parameter_fetcher(
       environment_, *parameter_client_,
       std::move(LogStatusSafeMetricsFn<kGetParameterStatus>()));
@@ -392,22 +1117,66 @@ absl::Status Server::InitOnceInstancesAreCreated() {
     return status;
   }
 
-  if (absl::Status status = SetDefaultUdfCodeObject(); !status.ok()) {
-    return absl::InternalError(
-        "Error setting default UDF. Please contact Google to fix the default "
-        "UDF or retry starting the server.");
-  }
+  // The steps below that only wait on remote services or Roma run on their
+  // own threads while the following ones are run. Each is waited for before
+  // the first step that depends on it. Returning early waits for them too.
+  std::future<absl::Status> default_udf_set =
+      std::async(std::launch::async, [this] {
+        return RunInitStep("SetDefaultUdfCodeObject",
+                           [this] { return SetDefaultUdfCodeObject(); });
+      });
+  std::future<absl::Status> key_fetcher_manager_created =
+      std::async(std::launch::async, [this, &parameter_fetcher] {
+        return RunInitStep("CreateKeyFetcherManager", [&] {
+          key_fetcher_manager_ =
+              KeyFetcherFactory::Create()->CreateKeyFetcherManager(
+                  parameter_fetcher);
+          return absl::OkStatus();
+        });
+      });
 
   num_shards_ = parameter_fetcher.GetInt32Parameter(kNumShardsParameterSuffix);
   LOG(INFO) << "Retrieved " << kNumShardsParameterSuffix
             << " parameter: " << num_shards_;
 
-  blob_client_ = CreateBlobClient(parameter_fetcher);
-  delta_stream_reader_factory_ =
-      CreateStreamRecordReaderFactory(parameter_fetcher);
+  absl::StatusOr<std::optional<LogicalShardMapping>> logical_shard_mapping;
+  if (absl::Status status = RunInitStep("GetLogicalShardMapping", [&] {
+        blob_client_ = CreateBlobClient(parameter_fetcher);
+        logical_shard_mapping = GetLogicalShardMapping(
+            parameter_fetcher, num_shards_, *blob_client_);
+        return logical_shard_mapping.status();
+      });
+      !status.ok()) {
+    return status;
+  }
+  auto key_sharder =
+      GetKeySharder(parameter_fetcher, *std::move(logical_shard_mapping));
+  delta_stream_reader_factory_ = CreateStreamRecordReaderFactory(
+      parameter_fetcher, key_sharder.logical_shard_mapping());
   notifier_ = CreateDeltaFileNotifier(parameter_fetcher);
-  auto factory = KeyFetcherFactory::Create();
-  key_fetcher_manager_ = factory->CreateKeyFetcherManager(parameter_fetcher);
+  if (absl::Status status = key_fetcher_manager_created.get(); !status.ok()) {
+    return status;
+  }
+  ohttp_gateways_closure_ =
+      PeriodicClosure::Create(*background_executor_, "ohttp_gateways");
+  if (absl::Status status = ohttp_gateways_closure_->StartNow(
+          kOhttpGatewaysPrepareInterval,
+          [this]() {
+            VLOG(2) << "Prepared OHTTP gateways of "
+                    << PrepareOhttpGateways(*key_fetcher_manager_)
+                    << " private keys";
+          });
+      !status.ok()) {
+    LOG(ERROR) << "Failed to start preparing the OHTTP gateways: " << status;
+  }
+  // Also used by the V1 handler, so created before the gRPC services.
+  const int32_t query_evaluation_threads = parameter_fetcher.GetInt32Parameter(
+      kQueryEvaluationThreadsParameterSuffix);
+  LOG(INFO) << "Retrieved " << kQueryEvaluationThreadsParameterSuffix
+            << " parameter: " << query_evaluation_threads;
+  if (query_evaluation_threads > 0) {
+    query_thread_pool_ = std::make_unique<ThreadPool>(query_evaluation_threads);
+  }
   CreateGrpcServices(parameter_fetcher);
   auto metadata = parameter_fetcher.GetBlobStorageNotifierMetadata();
   auto message_service_status = MessageService::Create(metadata);
@@ -417,12 +1186,25 @@ absl::Status Server::InitOnceInstancesAreCreated() {
   message_service_blob_ = std::move(*message_service_status);
   SetQueueManager(metadata, message_service_blob_.get());
 
-  grpc_server_ = CreateAndStartGrpcServer();
-  local_lookup_ = CreateLocalLookup(*cache_);
-  auto key_sharder = GetKeySharder(parameter_fetcher);
+  grpc_server_ = CreateAndStartGrpcServer(parameter_fetcher);
+  if (http_v2_handler_ != nullptr) {
+    http_server_ = std::make_unique<HttpServer>();
+    AddKeyValueServiceV2HttpRoutes(*http_v2_handler_, *admission_controller_,
+                                   *http_server_);
+    if (absl::Status status = http_server_->Start(
+            HttpServer::Options{.port = absl::GetFlag(FLAGS_http_port)});
+        !status.ok()) {
+      return status;
+    }
+  }
+  local_lookup_ = CreateLocalLookup(*cache_, query_thread_pool_.get());
+  if (num_shards_ > 1) {
+    lookup_cache_ = CreateLookupCache(parameter_fetcher);
+  }
   auto server_initializer = GetServerInitializer(
       num_shards_, *key_fetcher_manager_, *local_lookup_, environment_,
-      shard_num_, *instance_client_, *cache_, parameter_fetcher, key_sharder);
+      shard_num_, *instance_client_, *cache_, parameter_fetcher, key_sharder,
+      lookup_cache_.get(), query_thread_pool_.get());
   remote_lookup_ = server_initializer->CreateAndStartRemoteLookupServer();
   {
     auto status_or_notifier =
@@ -443,6 +1225,31 @@ absl::Status Server::InitOnceInstancesAreCreated() {
   }
   message_service_realtime_ = std::move(*realtime_message_service_status);
   SetQueueManager(realtime_notifier_metadata, message_service_realtime_.get());
+  // The data loading threads, which write the cache, inherit the data loading
+  // placement of this thread while they are created: the realtime threads,
+  // and the reader threads of the initial and continuous loads. This thread
+  // gets the serving placement back once they are started.
+  const auto data_loading_placement =
+      GetThreadPlacement(parameter_fetcher, kDataLoadingCpusParameterSuffix,
+                         kDataLoadingMemoryPolicyParameterSuffix);
+  if (!data_loading_placement.ok()) {
+    return data_loading_placement.status();
+  }
+  std::optional<ThreadPlacement> serving_placement;
+  if (!IsDefaultPlacement(*data_loading_placement)) {
+    if (auto placement = GetCurrentThreadPlacement(); placement.ok()) {
+      serving_placement = *std::move(placement);
+      PlaceCurrentThread(*data_loading_placement, "data loading");
+    } else {
+      LOG(ERROR) << "Failed to place the data loading threads: "
+                 << placement.status();
+    }
+  }
+  absl::Cleanup restore_serving_placement = [&serving_placement] {
+    if (serving_placement.has_value()) {
+      PlaceCurrentThread(*serving_placement, "serving");
+    }
+  };
   uint32_t realtime_thread_numbers = parameter_fetcher.GetInt32Parameter(
       kRealtimeUpdaterThreadNumberParameterSuffix);
   LOG(INFO) << "Retrieved " << kRealtimeUpdaterThreadNumberParameterSuffix
@@ -454,10 +1261,25 @@ absl::Status Server::InitOnceInstancesAreCreated() {
   }
   realtime_thread_pool_manager_ =
       std::move(*maybe_realtime_thread_pool_manager);
-  data_orchestrator_ = CreateDataOrchestrator(parameter_fetcher, key_sharder);
+  // Data files may hold UDF code objects, which must override the default one.
+  if (absl::Status status = default_udf_set.get(); !status.ok()) {
+    return absl::InternalError(
+        "Error setting default UDF. Please contact Google to fix the default "
+        "UDF or retry starting the server.");
+  }
+  StartHeapAllocatorManagement(parameter_fetcher);
+  StartDataFreshnessChecks(parameter_fetcher);
+  RunInitStep("CreateDataOrchestrator", [&] {
+    data_orchestrator_ = CreateDataOrchestrator(parameter_fetcher, key_sharder);
+    return absl::OkStatus();
+  }).IgnoreError();
+  if (release_heap_memory_after_loading_) {
+    ReleaseFreeHeapMemory("the initial data load");
+  }
   TraceRetryUntilOk([this] { return data_orchestrator_->Start(); },
                     "StartDataOrchestrator",
                     LogStatusSafeMetricsFn<kStartDataOrchestratorStatus>());
+  std::move(restore_serving_placement).Invoke();
   if (num_shards_ > 1) {
     // At this point the server is healthy and the initialization is over.
     // The only missing piece is having a shard map, which is dependent on
@@ -466,17 +1288,70 @@ absl::Status Server::InitOnceInstancesAreCreated() {
     lifecycle_heartbeat->Finish();
   }
   auto maybe_shard_state = server_initializer->InitializeUdfHooks(
-      *string_get_values_hook_, *binary_get_values_hook_, *run_query_hook_);
+      *string_get_values_hook_, *binary_get_values_hook_, *run_query_hook_,
+      *binary_run_query_hook_, *uint32_run_query_hook_,
+      *get_keys_containing_hook_, *native_udfs_);
   if (!maybe_shard_state.ok()) {
     return maybe_shard_state.status();
   }
   shard_manager_state_ = *std::move(maybe_shard_state);
 
-  grpc_server_->GetHealthCheckService()->SetServingStatus(
-      std::string(kLoadbalancerHealthcheck), true);
+  if (readiness_max_lag_ > absl::ZeroDuration()) {
+    // `CheckDataFreshness` marks the server ready once the data is fresh.
+    initialized_ = true;
+  } else {
+    grpc_server_->GetHealthCheckService()->SetServingStatus(
+        std::string(kLoadbalancerHealthcheck), true);
+  }
   return absl::OkStatus();
 }
 
+void Server::StartDataFreshnessChecks(
+    const ParameterFetcher& parameter_fetcher) {
+  const int32_t readiness_max_lag_secs =
+      parameter_fetcher.GetInt32Parameter(kReadinessMaxLagSecsParameterSuffix);
+  LOG(INFO) << "Retrieved " << kReadinessMaxLagSecsParameterSuffix
+            << " parameter: " << readiness_max_lag_secs;
+  readiness_max_lag_ = absl::Seconds(std::max(readiness_max_lag_secs, 0));
+  freshness_tracker_ = std::make_unique<DataFreshnessTracker>();
+  freshness_closure_ =
+      PeriodicClosure::Create(*background_executor_, "data_freshness");
+  if (absl::Status status = freshness_closure_->StartNow(
+          kDataFreshnessCheckInterval, [this]() { CheckDataFreshness(); });
+      !status.ok()) {
+    LOG(ERROR) << "Failed to start checking the data freshness: " << status;
+  }
+}
+
+void Server::CheckDataFreshness() {
+  bool all_fresh = true;
+  for (const auto& [prefix, freshness] :
+       freshness_tracker_->Get(absl::Now())) {
+    DataFreshnessTracker::PrefixFreshness& logged = logged_freshness_[prefix];
+    LogUpDownCounterChange<kDataFreshnessLagSeconds>(
+        prefix, absl::ToDoubleSeconds(freshness.lag - logged.lag));
+    LogUpDownCounterChange<kDataPendingFileCount>(
+        prefix, freshness.num_pending_files - logged.num_pending_files);
+    logged = freshness;
+    if (readiness_max_lag_ <= absl::ZeroDuration()) {
+      continue;
+    }
+    const bool fresh =
+        freshness.caught_up && freshness.lag <= readiness_max_lag_;
+    all_fresh = all_fresh && fresh;
+    // Lets clients route the requests for a prefix to the servers with its
+    // data before the other prefixes are fresh too.
+    if (!prefix.empty()) {
+      grpc_server_->GetHealthCheckService()->SetServingStatus(
+          absl::StrCat(kLoadbalancerHealthcheck, ":", prefix), fresh);
+    }
+  }
+  if (readiness_max_lag_ > absl::ZeroDuration()) {
+    grpc_server_->GetHealthCheckService()->SetServingStatus(
+        std::string(kLoadbalancerHealthcheck), initialized_ && all_fresh);
+  }
+}
+
 void Server::Wait() {
   if (grpc_server_) {
     grpc_server_->Wait();
@@ -496,6 +1371,12 @@ absl::Status Server::MaybeShutdownNotifiers() {
 
 void Server::GracefulShutdown(absl::Duration timeout) {
   LOG(INFO) << "Graceful gRPC server shutdown requested, timeout: " << timeout;
+  if (freshness_closure_) {
+    freshness_closure_->Stop();
+  }
+  if (http_server_) {
+    http_server_->Shutdown();
+  }
   if (internal_lookup_server_) {
     internal_lookup_server_->Shutdown();
   }
@@ -529,6 +1410,12 @@ void Server::GracefulShutdown(absl::Duration timeout) {
 
 void Server::ForceShutdown() {
   LOG(WARNING) << "Immediate gRPC server shutdown requested";
+  if (freshness_closure_) {
+    freshness_closure_->Stop();
+  }
+  if (http_server_) {
+    http_server_->Shutdown();
+  }
   if (internal_lookup_server_) {
     internal_lookup_server_->Shutdown();
   }
@@ -566,15 +1453,51 @@ std::unique_ptr<BlobStorageClient> Server::CreateBlobClient(
       parameter_fetcher.GetBlobStorageClientOptions();
   std::unique_ptr<BlobStorageClientFactory> blob_storage_client_factory =
       BlobStorageClientFactory::Create();
-  return blob_storage_client_factory->CreateBlobStorageClient(
-      std::move(client_options));
+  std::unique_ptr<BlobStorageClient> client =
+      blob_storage_client_factory->CreateBlobStorageClient(
+          std::move(client_options));
+  const std::string cache_directory = parameter_fetcher.GetParameter(
+      kBlobCacheDirectoryParameterSuffix, /*default_value=*/"");
+  LOG(INFO) << "Retrieved " << kBlobCacheDirectoryParameterSuffix
+            << " parameter: " << cache_directory;
+  if (!cache_directory.empty()) {
+    const int32_t cache_max_size_mb = parameter_fetcher.GetInt32Parameter(
+        kBlobCacheMaxSizeMbParameterSuffix);
+    LOG(INFO) << "Retrieved " << kBlobCacheMaxSizeMbParameterSuffix
+              << " parameter: " << cache_max_size_mb;
+    client = std::make_unique<CachingBlobStorageClient>(
+        std::move(client),
+        CachingBlobStorageClient::Options{
+            .directory = cache_directory,
+            .max_size_bytes = int64_t{cache_max_size_mb} * 1024 * 1024,
+        });
+  }
+  const bool use_data_file_manifest =
+      parameter_fetcher.GetBoolParameter(kUseDataFileManifestParameterSuffix);
+  LOG(INFO) << "Retrieved " << kUseDataFileManifestParameterSuffix
+            << " parameter: " << use_data_file_manifest;
+  if (use_data_file_manifest) {
+    // The manifests are read through the blob cache, if enabled.
+    client = std::make_unique<ManifestBlobStorageClient>(std::move(client));
+  }
+  return client;
 }
 
 std::unique_ptr<StreamRecordReaderFactory>
 Server::CreateStreamRecordReaderFactory(
-    const ParameterFetcher& parameter_fetcher) {
+    const ParameterFetcher& parameter_fetcher,
+    std::shared_ptr<const LogicalShardMapping> logical_shard_mapping) {
   const int32_t data_loading_num_threads = parameter_fetcher.GetInt32Parameter(
       kDataLoadingNumThreadsParameterSuffix);
+  const int32_t reader_shards_per_thread = parameter_fetcher.GetInt32Parameter(
+      kReaderShardsPerThreadParameterSuffix);
+  LOG(INFO) << "Retrieved " << kReaderShardsPerThreadParameterSuffix
+            << " parameter: " << reader_shards_per_thread;
+  const int32_t data_loading_apply_threads =
+      parameter_fetcher.GetInt32Parameter(
+          kDataLoadingApplyThreadsParameterSuffix);
+  LOG(INFO) << "Retrieved " << kDataLoadingApplyThreadsParameterSuffix
+            << " parameter: " << data_loading_apply_threads;
   const std::string file_format = parameter_fetcher.GetParameter(
       kDataLoadingFileFormatSuffix,
       std::string(kFileFormats[static_cast<int>(FileFormat::kRiegeli)]));
@@ -582,11 +1505,20 @@ Server::CreateStreamRecordReaderFactory(
   if (file_format == kFileFormats[static_cast<int>(FileFormat::kAvro)]) {
     AvroConcurrentStreamRecordReader::Options options;
     options.num_worker_threads = data_loading_num_threads;
+    options.shards_per_worker = reader_shards_per_thread;
     return std::make_unique<AvroStreamRecordReaderFactory>(options);
   } else if (file_format ==
              kFileFormats[static_cast<int>(FileFormat::kRiegeli)]) {
     ConcurrentStreamRecordReader<std::string_view>::Options options;
     options.num_worker_threads = data_loading_num_threads;
+    options.shards_per_worker = reader_shards_per_thread;
+    options.num_apply_threads = data_loading_apply_threads;
+    if (num_shards_ > 1) {
+      // Skips the records of other shards in files with the records of all
+      // shards.
+      options.shard_num = shard_num_;
+      options.logical_shard_mapping = std::move(logical_shard_mapping);
+    }
     return std::make_unique<RiegeliStreamRecordReaderFactory>(options);
   }
 }
@@ -597,6 +1529,72 @@ std::unique_ptr<DataOrchestrator> Server::CreateDataOrchestrator(
       parameter_fetcher.GetParameter(kDataBucketParameterSuffix);
   LOG(INFO) << "Retrieved " << kDataBucketParameterSuffix
             << " parameter: " << data_bucket;
+  const int32_t data_loading_concurrency = parameter_fetcher.GetInt32Parameter(
+      kDataLoadingConcurrencyParameterSuffix);
+  LOG(INFO) << "Retrieved " << kDataLoadingConcurrencyParameterSuffix
+            << " parameter: " << data_loading_concurrency;
+  const std::string cache_checkpoint_file = parameter_fetcher.GetParameter(
+      kCacheCheckpointFileParameterSuffix, /*default_value=*/"");
+  LOG(INFO) << "Retrieved " << kCacheCheckpointFileParameterSuffix
+            << " parameter: " << cache_checkpoint_file;
+  int32_t cache_checkpoint_mins = 0;
+  if (!cache_checkpoint_file.empty()) {
+    cache_checkpoint_mins = parameter_fetcher.GetInt32Parameter(
+        kCacheCheckpointMinsParameterSuffix);
+    LOG(INFO) << "Retrieved " << kCacheCheckpointMinsParameterSuffix
+              << " parameter: " << cache_checkpoint_mins;
+  }
+  const int32_t realtime_coalesce_millis = parameter_fetcher.GetInt32Parameter(
+      kRealtimeCoalesceMillisParameterSuffix);
+  LOG(INFO) << "Retrieved " << kRealtimeCoalesceMillisParameterSuffix
+            << " parameter: " << realtime_coalesce_millis;
+  const int32_t delta_prefetch_max_mb =
+      parameter_fetcher.GetInt32Parameter(kDeltaPrefetchMaxMbParameterSuffix);
+  LOG(INFO) << "Retrieved " << kDeltaPrefetchMaxMbParameterSuffix
+            << " parameter: " << delta_prefetch_max_mb;
+  const bool trust_data_file_records =
+      parameter_fetcher.GetBoolParameter(kTrustDataFileRecordsParameterSuffix);
+  LOG(INFO) << "Retrieved " << kTrustDataFileRecordsParameterSuffix
+            << " parameter: " << trust_data_file_records;
+  const bool load_compacted_delta_files = parameter_fetcher.GetBoolParameter(
+      kLoadCompactedDeltaFilesParameterSuffix);
+  LOG(INFO) << "Retrieved " << kLoadCompactedDeltaFilesParameterSuffix
+            << " parameter: " << load_compacted_delta_files;
+  const bool download_snapshot_files = parameter_fetcher.GetBoolParameter(
+      kDownloadSnapshotFilesParameterSuffix);
+  LOG(INFO) << "Retrieved " << kDownloadSnapshotFilesParameterSuffix
+            << " parameter: " << download_snapshot_files;
+  const bool bulk_load_snapshots =
+      parameter_fetcher.GetBoolParameter(kBulkLoadSnapshotsParameterSuffix);
+  LOG(INFO) << "Retrieved " << kBulkLoadSnapshotsParameterSuffix
+            << " parameter: " << bulk_load_snapshots;
+  const std::string priority_prefixes = parameter_fetcher.GetParameter(
+      kDataLoadingPriorityPrefixesParameterSuffix, /*default_value=*/"");
+  LOG(INFO) << "Retrieved " << kDataLoadingPriorityPrefixesParameterSuffix
+            << " parameter: " << priority_prefixes;
+  loading_throttle_ = CreateLoadingThrottle(parameter_fetcher);
+  std::function<void()> snapshots_loaded_callback;
+  if (release_heap_memory_after_loading_) {
+    snapshots_loaded_callback = [] {
+      ReleaseFreeHeapMemory("loading snapshot files");
+    };
+  }
+  // Drops the cached lookup results of the keys loaded, of any shard, and
+  // all the cached responses, as UDFs may read any key.
+  std::function<void(absl::Span<const std::string_view>)> mutated_keys_callback;
+  if (lookup_cache_ != nullptr || response_cache_ != nullptr) {
+    mutated_keys_callback =
+        [lookup_cache = lookup_cache_.get(),
+         response_cache = response_cache_.get()](
+            absl::Span<const std::string_view> keys) {
+          if (lookup_cache != nullptr) {
+            lookup_cache->Invalidate(keys);
+          }
+          if (response_cache != nullptr) {
+            response_cache->Invalidate();
+          }
+        };
+  }
   auto metrics_callback =
       LogStatusSafeMetricsFn<kCreateDataOrchestratorStatus>();
   return TraceRetryUntilOk(
@@ -614,6 +1612,27 @@ std::unique_ptr<DataOrchestrator> Server::CreateDataOrchestrator(
             .num_shards = num_shards_,
             .key_sharder = std::move(key_sharder),
             .blob_prefix_allowlist = GetBlobPrefixAllowlist(parameter_fetcher),
+            .num_concurrent_files = data_loading_concurrency,
+            .priority_prefixes =
+                absl::StrSplit(priority_prefixes, ',', absl::SkipEmpty()),
+            .cache_checkpoint_path = cache_checkpoint_file,
+            .cache_checkpoint_interval = absl::Minutes(cache_checkpoint_mins),
+            .realtime_coalescing_window =
+                absl::Milliseconds(realtime_coalesce_millis),
+            .delta_prefetch_max_bytes =
+                int64_t{delta_prefetch_max_mb} * 1024 * 1024,
+            .compression_dictionaries = compression_dictionaries_.get(),
+            .trust_data_file_records = trust_data_file_records,
+            .mutated_keys_callback = mutated_keys_callback,
+            .loading_throttle = loading_throttle_.get(),
+            .swappable_cache = swappable_cache_,
+            .create_cache = create_cache_,
+            .snapshot_reload_interval = absl::Minutes(snapshot_reload_mins_),
+            .freshness_tracker = freshness_tracker_.get(),
+            .load_compacted_delta_files = load_compacted_delta_files,
+            .download_snapshot_files = download_snapshot_files,
+            .bulk_load_snapshots = bulk_load_snapshots,
+            .snapshots_loaded_callback = snapshots_loaded_callback,
         });
       },
       "CreateDataOrchestrator", metrics_callback);
@@ -624,19 +1643,98 @@ void Server::CreateGrpcServices(const ParameterFetcher& parameter_fetcher) {
   const bool add_missing_keys_v1 =
       parameter_fetcher.GetBoolParameter(kAddMissingKeysV1Suffix);
   LOG(INFO) << "Retrieved " << kRouteV1ToV2Suffix << " parameter: " << use_v2;
+  const bool v1_direct_serialization =
+      parameter_fetcher.GetBoolParameter(kV1DirectSerializationSuffix);
+  LOG(INFO) << "Retrieved " << kV1DirectSerializationSuffix
+            << " parameter: " << v1_direct_serialization;
+  const bool v1_merge_namespace_lookups =
+      parameter_fetcher.GetBoolParameter(kV1MergeNamespaceLookupsSuffix);
+  LOG(INFO) << "Retrieved " << kV1MergeNamespaceLookupsSuffix
+            << " parameter: " << v1_merge_namespace_lookups;
+  const AdmissionController::Options admission_options{
+      .max_in_flight = parameter_fetcher.GetInt32Parameter(
+          kAdmissionMaxInFlightParameterSuffix),
+      .critical_reserve_percent = parameter_fetcher.GetInt32Parameter(
+          kAdmissionCriticalReservePercentParameterSuffix),
+      .latency_target = absl::Milliseconds(parameter_fetcher.GetInt32Parameter(
+          kAdmissionLatencyTargetMsParameterSuffix)),
+  };
+  LOG(INFO) << "Retrieved " << kAdmissionMaxInFlightParameterSuffix
+            << " parameter: " << admission_options.max_in_flight;
+  LOG(INFO) << "Retrieved " << kAdmissionCriticalReservePercentParameterSuffix
+            << " parameter: " << admission_options.critical_reserve_percent;
+  LOG(INFO) << "Retrieved " << kAdmissionLatencyTargetMsParameterSuffix
+            << " parameter: " << admission_options.latency_target;
+  admission_controller_ =
+      std::make_unique<AdmissionController>(admission_options);
+  const CompressionOptions compression_options{
+      .brotli_quality = parameter_fetcher.GetInt32Parameter(
+          kResponseBrotliQualityParameterSuffix),
+      .brotli_window = parameter_fetcher.GetInt32Parameter(
+          kResponseBrotliWindowParameterSuffix),
+  };
+  LOG(INFO) << "Retrieved " << kResponseBrotliQualityParameterSuffix
+            << " parameter: " << compression_options.brotli_quality;
+  LOG(INFO) << "Retrieved " << kResponseBrotliWindowParameterSuffix
+            << " parameter: " << compression_options.brotli_window;
+  auto create_compression_group_concatenator =
+      [compression_options](
+          CompressionGroupConcatenator::CompressionType type,
+          std::shared_ptr<const CompressionDictionary> dictionary) {
+        return CompressionGroupConcatenator::Create(type, compression_options,
+                                                    std::move(dictionary));
+      };
+  response_cache_ = CreateResponseCache(parameter_fetcher, num_shards_);
   get_values_adapter_ =
       GetValuesAdapter::Create(std::make_unique<GetValuesV2Handler>(
-          *udf_client_, *key_fetcher_manager_));
+          *udf_client_, *key_fetcher_manager_, compression_dictionaries_.get(),
+          response_cache_.get(), create_compression_group_concatenator));
   GetValuesHandler handler(*cache_, *get_values_adapter_, use_v2,
-                           add_missing_keys_v1);
-  grpc_services_.push_back(
-      std::make_unique<KeyValueServiceImpl>(std::move(handler)));
-  GetValuesV2Handler v2handler(*udf_client_, *key_fetcher_manager_);
+                           add_missing_keys_v1, v1_merge_namespace_lookups,
+                           query_thread_pool_.get());
+  if (v1_direct_serialization) {
+    grpc_services_.push_back(
+        std::make_unique<KeyValueServiceSerializedImpl>(
+        std::move(handler), *admission_controller_));
+  } else {
+    grpc_services_.push_back(
+        std::make_unique<KeyValueServiceImpl>(std::move(handler),
+                                              *admission_controller_));
+  }
+  GetValuesV2Handler v2handler(*udf_client_, *key_fetcher_manager_,
+                               compression_dictionaries_.get(),
+                               response_cache_.get(),
+                               create_compression_group_concatenator);
   grpc_services_.push_back(
-      std::make_unique<KeyValueServiceV2Impl>(std::move(v2handler)));
+      std::make_unique<KeyValueServiceV2Impl>(std::move(v2handler),
+                                              *admission_controller_));
+  if (absl::GetFlag(FLAGS_http_port) > 0) {
+    http_v2_handler_ = std::make_unique<GetValuesV2Handler>(
+        *udf_client_, *key_fetcher_manager_, compression_dictionaries_.get(),
+        response_cache_.get(), create_compression_group_concatenator);
+  }
+  if (absl::GetFlag(FLAGS_enable_profiling_service)) {
+    LOG(INFO) << "Serving the profiling service";
+    profiler_ = Profiler::Create();
+    grpc_services_.push_back(std::make_unique<ProfilingServiceImpl>(
+        *profiler_,
+        absl::Seconds(absl::GetFlag(FLAGS_max_profile_duration_seconds)),
+        [this](int32_t num_keys_per_prefix, GetHotKeysResponse& response) {
+          for (auto& [prefix, hot_keys] :
+               cache_->GetHotKeys(num_keys_per_prefix)) {
+            auto& prefix_hot_keys = (*response.mutable_prefixes())[prefix];
+            for (HotKey& hot_key : hot_keys) {
+              auto* key = prefix_hot_keys.add_keys();
+              key->set_key(std::move(hot_key.key));
+              key->set_estimated_lookups(hot_key.estimated_lookups);
+            }
+          }
+        }));
+  }
 }
 
-std::unique_ptr<grpc::Server> Server::CreateAndStartGrpcServer() {
+std::unique_ptr<grpc::Server> Server::CreateAndStartGrpcServer(
+    const ParameterFetcher& parameter_fetcher) {
   grpc::EnableDefaultHealthCheckService(true);
   grpc::reflection::InitProtoReflectionServerBuilderPlugin();
   grpc::ServerBuilder builder;
@@ -653,6 +1751,41 @@ std::unique_ptr<grpc::Server> Server::CreateAndStartGrpcServer() {
                              32 * 1024);  // Set to 32KB
   builder.AddChannelArgument(GRPC_ARG_MAX_METADATA_SIZE,
                              32 * 1024);  // Set to 32KB
+  // All services use the callback API, whose calls run on gRPC's own event
+  // engine threads rather than on completion queues of the server, so the
+  // server is tuned through its streams and resource quota.
+  const int32_t max_concurrent_streams = parameter_fetcher.GetInt32Parameter(
+      kGrpcMaxConcurrentStreamsParameterSuffix);
+  LOG(INFO) << "Retrieved " << kGrpcMaxConcurrentStreamsParameterSuffix
+            << " parameter: " << max_concurrent_streams;
+  if (max_concurrent_streams > 0) {
+    builder.AddChannelArgument(GRPC_ARG_MAX_CONCURRENT_STREAMS,
+                               max_concurrent_streams);
+  }
+  const int32_t max_threads_per_core = parameter_fetcher.GetInt32Parameter(
+      kGrpcMaxThreadsPerCoreParameterSuffix);
+  LOG(INFO) << "Retrieved " << kGrpcMaxThreadsPerCoreParameterSuffix
+            << " parameter: " << max_threads_per_core;
+  const int32_t memory_quota_mb =
+      parameter_fetcher.GetInt32Parameter(kGrpcMemoryQuotaMbParameterSuffix);
+  LOG(INFO) << "Retrieved " << kGrpcMemoryQuotaMbParameterSuffix
+            << " parameter: " << memory_quota_mb;
+  if (max_threads_per_core > 0 || memory_quota_mb > 0) {
+    grpc::ResourceQuota resource_quota("kv-server");
+    if (max_threads_per_core > 0) {
+      const int max_threads =
+          max_threads_per_core *
+          std::max(1u, std::thread::hardware_concurrency());
+      LOG(INFO) << "Limiting the gRPC server to " << max_threads
+                << " threads";
+      resource_quota.SetMaxThreads(max_threads);
+    }
+    if (memory_quota_mb > 0) {
+      resource_quota.Resize(size_t{static_cast<uint32_t>(memory_quota_mb)} *
+                            1024 * 1024);
+    }
+    builder.SetResourceQuota(resource_quota);
+  }
   for (auto& service : grpc_services_) {
     builder.RegisterService(service.get());
   }
@@ -681,10 +1814,14 @@ std::unique_ptr<DeltaFileNotifier> Server::CreateDeltaFileNotifier(
       kBackupPollFrequencySecsParameterSuffix);
   LOG(INFO) << "Retrieved " << kBackupPollFrequencySecsParameterSuffix
             << " parameter: " << backup_poll_frequency_secs;
+  const bool push_delta_notifications = parameter_fetcher.GetBoolParameter(
+      kPushDeltaNotificationsParameterSuffix);
+  LOG(INFO) << "Retrieved " << kPushDeltaNotificationsParameterSuffix
+            << " parameter: " << push_delta_notifications;
 
-  return DeltaFileNotifier::Create(*blob_client_,
-                                   absl::Seconds(backup_poll_frequency_secs),
-                                   GetBlobPrefixAllowlist(parameter_fetcher));
+  return DeltaFileNotifier::Create(
+      *blob_client_, absl::Seconds(backup_poll_frequency_secs),
+      GetBlobPrefixAllowlist(parameter_fetcher), push_delta_notifications);
 }
 
 }  // namespace kv_server
@@ -15,12 +15,15 @@
 #ifndef COMPONENTS_DATA_SERVER_SERVER_SERVER_H_
 #define COMPONENTS_DATA_SERVER_SERVER_SERVER_H_
 
+#include <atomic>
+#include <functional>
 #include <iostream>
 #include <memory>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include "absl/container/flat_hash_map.h"
 #include "absl/time/time.h"
 #include "components/cloud_config/instance_client.h"
 #include "components/cloud_config/parameter_client.h"
@@ -29,23 +32,41 @@
 #include "components/data/realtime/realtime_thread_pool_manager.h"
 #include "components/data_server/cache/cache.h"
 #include "components/data_server/cache/key_value_cache.h"
+#include "components/data_server/cache/prefix_stats_logger.h"
+#include "components/data_server/cache/swappable_cache.h"
+#include "components/data_server/data_loading/data_freshness_tracker.h"
 #include "components/data_server/data_loading/data_orchestrator.h"
+#include "components/data_server/data_loading/loading_throttle.h"
+#include "components/data_server/request_handler/compression_dictionary.h"
 #include "components/data_server/request_handler/get_values_adapter.h"
+#include "components/data_server/request_handler/get_values_v2_handler.h"
+#include "components/data_server/request_handler/response_cache.h"
+#include "components/data_server/server/admission_controller.h"
+#include "components/data_server/server/http_server.h"
 #include "components/data_server/server/lifecycle_heartbeat.h"
 #include "components/data_server/server/parameter_fetcher.h"
 #include "components/data_server/server/server_initializer.h"
+#include "components/internal_server/caching_lookup.h"
 #include "components/internal_server/lookup.h"
+#include "components/profiling/profiler.h"
 #include "components/sharding/cluster_mappings_manager.h"
 #include "components/sharding/shard_manager.h"
 #include "components/telemetry/open_telemetry_sink.h"
+#include "components/udf/hooks/get_keys_containing_hook.h"
 #include "components/udf/hooks/get_values_hook.h"
 #include "components/udf/hooks/run_query_hook.h"
+#include "components/udf/hooks/udf_cache_hook.h"
+#include "components/udf/native_udf_registry.h"
 #include "components/udf/udf_client.h"
+#include "components/util/executor.h"
+#include "components/util/periodic_closure.h"
 #include "components/util/platform_initializer.h"
+#include "components/util/thread_pool.h"
 #include "grpcpp/grpcpp.h"
 #include "public/base_types.pb.h"
 #include "public/query/get_values.grpc.pb.h"
 #include "public/sharding/key_sharder.h"
+#include "public/sharding/logical_shard_mapping.h"
 #include "src/telemetry/telemetry.h"
 
 namespace kv_server {
@@ -79,18 +100,35 @@ class Server {
 
   absl::Status InitOnceInstancesAreCreated();
   void InitializeKeyValueCache();
+  // Starts checking the freshness of the data loaded periodically, see
+  // `CheckDataFreshness`.
+  void StartDataFreshnessChecks(const ParameterFetcher& parameter_fetcher);
+  // Logs how fresh the data of every prefix is. If `readiness_max_lag_` is
+  // positive, marks the server ready to the load balancer only once it is
+  // initialized and the data of every prefix was caught up and lags less than
+  // that, and every prefix ready on its own health check service.
+  void CheckDataFreshness();
+
+  // Logs how many tasks every queue of `background_executor_` ran and for how
+  // long.
+  void LogBackgroundExecutorStats() const;
+  // Tunes the heap allocator and starts logging its stats periodically.
+  void StartHeapAllocatorManagement(const ParameterFetcher& parameter_fetcher);
+  void LogHeapAllocatorStats();
 
   std::unique_ptr<BlobStorageClient> CreateBlobClient(
       const ParameterFetcher& parameter_fetcher);
   std::unique_ptr<StreamRecordReaderFactory> CreateStreamRecordReaderFactory(
-      const ParameterFetcher& parameter_fetcher);
+      const ParameterFetcher& parameter_fetcher,
+      std::shared_ptr<const LogicalShardMapping> logical_shard_mapping);
   std::unique_ptr<DataOrchestrator> CreateDataOrchestrator(
       const ParameterFetcher& parameter_fetcher, KeySharder key_sharder);
 
   void CreateGrpcServices(const ParameterFetcher& parameter_fetcher);
   absl::Status MaybeShutdownNotifiers();
 
-  std::unique_ptr<grpc::Server> CreateAndStartGrpcServer();
+  std::unique_ptr<grpc::Server> CreateAndStartGrpcServer(
+      const ParameterFetcher& parameter_fetcher);
 
   std::unique_ptr<DeltaFileNotifier> CreateDeltaFileNotifier(
       const ParameterFetcher& parameter_fetcher);
@@ -110,16 +148,55 @@ class Server {
   // This must be first, otherwise the AWS SDK will crash when it's called:
   PlatformInitializer platform_initializer_;
 
+  // Runs the periodic background tasks of the server, so must outlive their
+  // closures.
+  std::unique_ptr<Executor> background_executor_;
+  std::unique_ptr<PeriodicClosure> background_executor_stats_closure_;
+
   std::unique_ptr<const ParameterClient> parameter_client_;
   std::unique_ptr<InstanceClient> instance_client_;
   std::string environment_;
+  // Shared by the services, so must outlive them.
+  std::unique_ptr<AdmissionController> admission_controller_;
+  // Used by the profiling service, if enabled.
+  std::unique_ptr<Profiler> profiler_;
   std::vector<std::unique_ptr<grpc::Service>> grpc_services_;
   std::unique_ptr<grpc::Server> grpc_server_;
+  // Serves the HTTP endpoints of the V2 API directly, if enabled.
+  std::unique_ptr<GetValuesV2Handler> http_v2_handler_;
+  std::unique_ptr<HttpServer> http_server_;
   std::unique_ptr<Cache> cache_;
+  // Creates `cache_`, or the cache it forwards to if it is swapped.
+  std::function<std::unique_ptr<Cache>()> create_cache_;
+  // Set if `cache_` is reloaded from new snapshot files every
+  // `snapshot_reload_mins_`, in which case it is `cache_`.
+  SwappableCache* swappable_cache_ = nullptr;
+  int32_t snapshot_reload_mins_ = 0;
+  // Logs the amount of data of every prefix of `cache_` periodically.
+  std::unique_ptr<PrefixStatsLogger> prefix_stats_logger_;
+  std::unique_ptr<PeriodicClosure> prefix_stats_closure_;
+  // Logs the requests counted on their hot path periodically.
+  std::unique_ptr<PeriodicClosure> request_counts_closure_;
   std::unique_ptr<GetValuesAdapter> get_values_adapter_;
+  // Evaluates the operands of large queries concurrently. Declared before the
+  // hooks and lookups, so that it outlives them. Null unless enabled.
+  std::unique_ptr<ThreadPool> query_thread_pool_;
   std::unique_ptr<GetValuesHook> string_get_values_hook_;
   std::unique_ptr<GetValuesHook> binary_get_values_hook_;
   std::unique_ptr<RunQueryHook> run_query_hook_;
+  std::unique_ptr<RunQueryHook> binary_run_query_hook_;
+  std::unique_ptr<RunQueryHook> uint32_run_query_hook_;
+  std::unique_ptr<GetKeysContainingHook> get_keys_containing_hook_;
+  std::unique_ptr<UdfCacheHook> udf_cache_hook_;
+  std::unique_ptr<NativeUdfRegistry> native_udfs_;
+  // Loaded by the data orchestrator, read by the V2 handlers.
+  std::unique_ptr<CompressionDictionaryStore> compression_dictionaries_;
+  // Cache of the sharded lookups of the UDF hooks, invalidated by the data
+  // orchestrator. Null unless sharded and enabled.
+  std::unique_ptr<LookupCache> lookup_cache_;
+  // Cache of the responses of the V2 handlers, invalidated by the data
+  // orchestrator. Null unless enabled.
+  std::unique_ptr<ResponseCache> response_cache_;
 
   // BlobStorageClient must outlive DeltaFileNotifier
   std::unique_ptr<BlobStorageClient> blob_client_;
@@ -132,8 +209,27 @@ class Server {
   std::unique_ptr<BlobStorageChangeNotifier> change_notifier_;
   std::unique_ptr<RealtimeThreadPoolManager> realtime_thread_pool_manager_;
   std::unique_ptr<StreamRecordReaderFactory> delta_stream_reader_factory_;
+  // Throttles the loading of new data files. Null if disabled.
+  std::unique_ptr<LoadingThrottle> loading_throttle_;
+
+  // Fed by the data orchestrator, so must outlive it.
+  std::unique_ptr<DataFreshnessTracker> freshness_tracker_;
 
   std::unique_ptr<DataOrchestrator> data_orchestrator_;
+  // Reads `freshness_tracker_` and sets the health statuses of
+  // `grpc_server_`, so is stopped before them.
+  std::unique_ptr<PeriodicClosure> freshness_closure_;
+  // Only accessed by `freshness_closure_`.
+  absl::flat_hash_map<std::string, DataFreshnessTracker::PrefixFreshness>
+      logged_freshness_;
+  // Zero if readiness is not gated on the data freshness.
+  absl::Duration readiness_max_lag_ = absl::ZeroDuration();
+  // Whether free heap memory is released once snapshot files are loaded.
+  bool release_heap_memory_after_loading_ = false;
+  std::unique_ptr<PeriodicClosure> heap_allocator_stats_closure_;
+  // Only accessed by `heap_allocator_stats_closure_`.
+  absl::flat_hash_map<std::string, int64_t> logged_heap_allocator_stats_;
+  std::atomic<bool> initialized_ = false;
 
   // Helper for lookup.proto calls that reads from local cache only
   std::unique_ptr<Lookup> local_lookup_;
@@ -154,6 +250,9 @@ class Server {
 
   std::unique_ptr<privacy_sandbox::server_common::KeyFetcherManagerInterface>
       key_fetcher_manager_;
+  // Sets up the OHTTP gateways of the keys of `key_fetcher_manager_` ahead of
+  // the requests that use them, so is destroyed before it.
+  std::unique_ptr<PeriodicClosure> ohttp_gateways_closure_;
   std::unique_ptr<opentelemetry::logs::LoggerProvider> log_provider_;
   std::unique_ptr<OpenTelemetrySink> open_telemetry_sink_;
 };
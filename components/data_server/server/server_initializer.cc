@@ -16,9 +16,11 @@
 
 #include "components/data_server/server/server_initializer.h"
 
+#include <string_view>
 #include <utility>
 
 #include "absl/log/log.h"
+#include "components/internal_server/batching_lookup.h"
 #include "components/internal_server/constants.h"
 #include "components/internal_server/local_lookup.h"
 #include "components/internal_server/lookup_server_impl.h"
@@ -29,22 +31,63 @@ namespace kv_server {
 namespace {
 using privacy_sandbox::server_common::KeyFetcherManagerInterface;
 
+constexpr std::string_view kLookupHedgePercentileParameterSuffix =
+    "lookup-hedge-percentile";
+constexpr std::string_view kLookupSkipEmptyShardsParameterSuffix =
+    "lookup-skip-empty-shards";
+constexpr std::string_view kLookupPaddingBucketParameterSuffix =
+    "lookup-padding-bucket";
+constexpr std::string_view kLookupQueryPushdownParameterSuffix =
+    "lookup-query-pushdown";
+constexpr std::string_view kLookupPlanQueriesWithSetSizesParameterSuffix =
+    "lookup-plan-queries-with-set-sizes";
+constexpr std::string_view kLookupResponseCompressionMinBytesParameterSuffix =
+    "lookup-response-compression-min-bytes";
+constexpr std::string_view kLookupChannelsPerReplicaParameterSuffix =
+    "lookup-channels-per-replica";
+constexpr std::string_view kLookupKeepaliveMsParameterSuffix =
+    "lookup-keepalive-ms";
+constexpr std::string_view kLookupBatchWindowMicrosParameterSuffix =
+    "lookup-batch-window-micros";
+constexpr std::string_view kLookupBatchMaxKeysParameterSuffix =
+    "lookup-batch-max-keys";
+constexpr std::string_view kLookupKeyFilterIntervalMsParameterSuffix =
+    "lookup-key-filter-interval-ms";
+constexpr std::string_view kLookupKeyFilterBitsPerKeyParameterSuffix =
+    "lookup-key-filter-bits-per-key";
+
 absl::Status InitializeUdfHooksInternal(
     std::function<std::unique_ptr<Lookup>()> get_lookup,
     GetValuesHook& string_get_values_hook,
-    GetValuesHook& binary_get_values_hook, RunQueryHook& run_query_hook) {
+    GetValuesHook& binary_get_values_hook, RunQueryHook& run_query_hook,
+    RunQueryHook& binary_run_query_hook, RunQueryHook& uint32_run_query_hook,
+    GetKeysContainingHook& get_keys_containing_hook,
+    NativeUdfRegistry& native_udfs, const Cache* local_cache = nullptr) {
   VLOG(9) << "Finishing getValues init";
   string_get_values_hook.FinishInit(get_lookup());
   VLOG(9) << "Finishing getValuesBinary init";
-  binary_get_values_hook.FinishInit(get_lookup());
+  if (local_cache != nullptr) {
+    binary_get_values_hook.FinishInit(get_lookup(), *local_cache);
+  } else {
+    binary_get_values_hook.FinishInit(get_lookup());
+  }
   VLOG(9) << "Finishing runQuery init";
   run_query_hook.FinishInit(get_lookup());
+  VLOG(9) << "Finishing runQueryBinary init";
+  binary_run_query_hook.FinishInit(get_lookup());
+  VLOG(9) << "Finishing runSetQueryUInt32 init";
+  uint32_run_query_hook.FinishInit(get_lookup());
+  VLOG(9) << "Finishing getKeysContaining init";
+  get_keys_containing_hook.FinishInit(get_lookup());
+  VLOG(9) << "Finishing native UDFs init";
+  native_udfs.FinishInit(get_lookup());
   return absl::OkStatus();
 }
 
 class NonshardedServerInitializer : public ServerInitializer {
  public:
-  explicit NonshardedServerInitializer(Cache& cache) : cache_(cache) {}
+  NonshardedServerInitializer(Cache& cache, ThreadPool* query_thread_pool)
+      : cache_(cache), query_thread_pool_(query_thread_pool) {}
 
   RemoteLookup CreateAndStartRemoteLookupServer() override {
     RemoteLookup remote_lookup;
@@ -54,19 +97,26 @@ class NonshardedServerInitializer : public ServerInitializer {
   absl::StatusOr<ShardManagerState> InitializeUdfHooks(
       GetValuesHook& string_get_values_hook,
       GetValuesHook& binary_get_values_hook,
-      RunQueryHook& run_query_hook) override {
+      RunQueryHook& run_query_hook, RunQueryHook& binary_run_query_hook,
+      RunQueryHook& uint32_run_query_hook,
+      GetKeysContainingHook& get_keys_containing_hook,
+      NativeUdfRegistry& native_udfs) override {
     ShardManagerState shard_manager_state;
-    auto lookup_supplier = [&cache = cache_]() {
-      return CreateLocalLookup(cache);
+    auto lookup_supplier = [&cache = cache_,
+                            query_thread_pool = query_thread_pool_]() {
+      return CreateLocalLookup(cache, query_thread_pool);
     };
     InitializeUdfHooksInternal(std::move(lookup_supplier),
                                string_get_values_hook, binary_get_values_hook,
-                               run_query_hook);
+                               run_query_hook, binary_run_query_hook,
+                               uint32_run_query_hook, get_keys_containing_hook,
+                               native_udfs, &cache_);
     return shard_manager_state;
   }
 
  private:
   Cache& cache_;
+  ThreadPool* query_thread_pool_;
 };
 
 class ShardedServerInitializer : public ServerInitializer {
@@ -74,26 +124,55 @@ class ShardedServerInitializer : public ServerInitializer {
   explicit ShardedServerInitializer(
       KeyFetcherManagerInterface& key_fetcher_manager, Lookup& local_lookup,
       std::string environment, int32_t num_shards, int32_t current_shard_num,
-      InstanceClient& instance_client, ParameterFetcher& parameter_fetcher,
-      KeySharder key_sharder)
+      InstanceClient& instance_client, Cache& cache,
+      ParameterFetcher& parameter_fetcher, KeySharder key_sharder,
+      LookupCache* lookup_cache)
       : key_fetcher_manager_(key_fetcher_manager),
         local_lookup_(local_lookup),
         environment_(environment),
         num_shards_(num_shards),
         current_shard_num_(current_shard_num),
         instance_client_(instance_client),
+        cache_(cache),
         parameter_fetcher_(parameter_fetcher),
-        key_sharder_(std::move(key_sharder)) {}
+        key_sharder_(std::move(key_sharder)),
+        lookup_cache_(lookup_cache) {}
 
   RemoteLookup CreateAndStartRemoteLookupServer() override {
     RemoteLookup remote_lookup;
+    const Lookup* service_lookup = &local_lookup_;
+    if (const BatchingOptions batching_options = GetBatchingOptions();
+        batching_options.window > absl::ZeroDuration()) {
+      remote_lookup.batching_lookup =
+          CreateBatchingLookup(local_lookup_, batching_options);
+      service_lookup = remote_lookup.batching_lookup.get();
+    }
+    if (const absl::Duration interval = GetKeyFilterInterval();
+        interval > absl::ZeroDuration()) {
+      remote_lookup.key_filter_publisher = std::make_unique<KeyFilterPublisher>(
+          cache_, GetKeyFilterBitsPerKey());
+      if (const auto status =
+              remote_lookup.key_filter_publisher->Start(interval);
+          !status.ok()) {
+        LOG(ERROR) << "Failed to start the key filter publisher: " << status;
+      }
+    }
     remote_lookup.remote_lookup_service = std::make_unique<LookupServiceImpl>(
-        local_lookup_, key_fetcher_manager_);
+        *service_lookup, key_fetcher_manager_,
+        remote_lookup.key_filter_publisher.get());
     grpc::ServerBuilder remote_lookup_server_builder;
     auto remoteLookupServerAddress =
         absl::StrCat(kLocalIp, ":", kRemoteLookupServerPort);
     remote_lookup_server_builder.AddListeningPort(
         remoteLookupServerAddress, grpc::InsecureServerCredentials());
+    if (const int32_t keepalive_ms = GetKeepaliveMs(); keepalive_ms > 0) {
+      // Accepts the keepalive pings of the remote lookup clients of the
+      // other shards, which are sent also when no call is active.
+      remote_lookup_server_builder.AddChannelArgument(
+          GRPC_ARG_HTTP2_MIN_RECV_PING_INTERVAL_WITHOUT_DATA_MS, keepalive_ms);
+      remote_lookup_server_builder.AddChannelArgument(
+          GRPC_ARG_KEEPALIVE_PERMIT_WITHOUT_CALLS, 1);
+    }
     remote_lookup_server_builder.RegisterService(
         remote_lookup.remote_lookup_service.get());
     LOG(INFO) << "Remote lookup server listening on "
@@ -106,26 +185,174 @@ class ShardedServerInitializer : public ServerInitializer {
   absl::StatusOr<ShardManagerState> InitializeUdfHooks(
       GetValuesHook& string_get_values_hook,
       GetValuesHook& binary_get_values_hook,
-      RunQueryHook& run_query_hook) override {
+      RunQueryHook& run_query_hook, RunQueryHook& binary_run_query_hook,
+      RunQueryHook& uint32_run_query_hook,
+      GetKeysContainingHook& get_keys_containing_hook,
+      NativeUdfRegistry& native_udfs) override {
     auto maybe_shard_state = CreateShardManager();
     if (!maybe_shard_state.ok()) {
       return maybe_shard_state.status();
     }
+    HedgingOptions hedging_options;
+    hedging_options.delay_percentile = parameter_fetcher_.GetInt32Parameter(
+        kLookupHedgePercentileParameterSuffix);
+    LOG(INFO) << "Retrieved " << kLookupHedgePercentileParameterSuffix
+              << " parameter: " << hedging_options.delay_percentile;
+    if (hedging_options.delay_percentile < 0 ||
+        hedging_options.delay_percentile >= 100) {
+      LOG(ERROR) << kLookupHedgePercentileParameterSuffix
+                 << " must be in [0, 100), disabling hedged lookups";
+      hedging_options.delay_percentile = 0;
+    }
+    PaddingOptions padding_options;
+    padding_options.skip_empty_shards = parameter_fetcher_.GetBoolParameter(
+        kLookupSkipEmptyShardsParameterSuffix);
+    LOG(INFO) << "Retrieved " << kLookupSkipEmptyShardsParameterSuffix
+              << " parameter: " << padding_options.skip_empty_shards;
+    padding_options.bucket_size = parameter_fetcher_.GetInt32Parameter(
+        kLookupPaddingBucketParameterSuffix);
+    LOG(INFO) << "Retrieved " << kLookupPaddingBucketParameterSuffix
+              << " parameter: " << padding_options.bucket_size;
+    if (padding_options.bucket_size < 0) {
+      LOG(ERROR) << kLookupPaddingBucketParameterSuffix
+                 << " must be >= 0, padding to the longest request";
+      padding_options.bucket_size = 0;
+    }
+    const bool query_pushdown = parameter_fetcher_.GetBoolParameter(
+        kLookupQueryPushdownParameterSuffix);
+    LOG(INFO) << "Retrieved " << kLookupQueryPushdownParameterSuffix
+              << " parameter: " << query_pushdown;
+    const bool plan_queries_with_set_sizes =
+        parameter_fetcher_.GetBoolParameter(
+            kLookupPlanQueriesWithSetSizesParameterSuffix);
+    LOG(INFO) << "Retrieved " << kLookupPlanQueriesWithSetSizesParameterSuffix
+              << " parameter: " << plan_queries_with_set_sizes;
+    const int32_t compress_response_min_bytes =
+        parameter_fetcher_.GetInt32Parameter(
+            kLookupResponseCompressionMinBytesParameterSuffix);
+    LOG(INFO) << "Retrieved "
+              << kLookupResponseCompressionMinBytesParameterSuffix
+              << " parameter: " << compress_response_min_bytes;
+    if (const absl::Duration interval = GetKeyFilterInterval();
+        interval > absl::ZeroDuration()) {
+      maybe_shard_state->key_filters = std::make_unique<ShardKeyFilters>(
+          num_shards_, current_shard_num_, *maybe_shard_state->shard_manager);
+      if (const auto status = maybe_shard_state->key_filters->Start(interval);
+          !status.ok()) {
+        LOG(ERROR) << "Failed to start fetching the shard key filters: "
+                   << status;
+      }
+    }
+    // All hooks send their remote lookups to the same executor.
     auto lookup_supplier = [&local_lookup = local_lookup_,
                             num_shards = num_shards_,
                             current_shard_num = current_shard_num_,
                             &shard_manager = *maybe_shard_state->shard_manager,
-                            &key_sharder = key_sharder_]() {
-      return CreateShardedLookup(local_lookup, num_shards, current_shard_num,
-                                 shard_manager, key_sharder);
+                            &key_sharder = key_sharder_,
+                            executor = CreateShardedLookupExecutor(num_shards_),
+                            hedging_options, padding_options, query_pushdown,
+                            key_filters =
+                                maybe_shard_state->key_filters.get(),
+                            compress_response_min_bytes,
+                            plan_queries_with_set_sizes,
+                            lookup_cache = lookup_cache_]() {
+      auto lookup = CreateShardedLookup(
+          local_lookup, num_shards, current_shard_num, shard_manager,
+          key_sharder, executor, hedging_options, padding_options,
+          query_pushdown, key_filters, compress_response_min_bytes,
+          plan_queries_with_set_sizes);
+      if (lookup_cache == nullptr) {
+        return lookup;
+      }
+      return CreateCachingLookup(std::move(lookup), *lookup_cache);
     };
     InitializeUdfHooksInternal(std::move(lookup_supplier),
                                string_get_values_hook, binary_get_values_hook,
-                               run_query_hook);
+                               run_query_hook, binary_run_query_hook,
+                               uint32_run_query_hook, get_keys_containing_hook,
+                               native_udfs);
     return std::move(*maybe_shard_state);
   }
 
  private:
+  int32_t GetKeepaliveMs() {
+    int32_t keepalive_ms =
+        parameter_fetcher_.GetInt32Parameter(kLookupKeepaliveMsParameterSuffix);
+    LOG(INFO) << "Retrieved " << kLookupKeepaliveMsParameterSuffix
+              << " parameter: " << keepalive_ms;
+    if (keepalive_ms < 0) {
+      LOG(ERROR) << kLookupKeepaliveMsParameterSuffix
+                 << " must be >= 0, disabling keepalive pings";
+      keepalive_ms = 0;
+    }
+    return keepalive_ms;
+  }
+
+  BatchingOptions GetBatchingOptions() {
+    BatchingOptions batching_options;
+    int32_t window_micros = parameter_fetcher_.GetInt32Parameter(
+        kLookupBatchWindowMicrosParameterSuffix);
+    LOG(INFO) << "Retrieved " << kLookupBatchWindowMicrosParameterSuffix
+              << " parameter: " << window_micros;
+    if (window_micros < 0) {
+      LOG(ERROR) << kLookupBatchWindowMicrosParameterSuffix
+                 << " must be >= 0, disabling lookup batching";
+      window_micros = 0;
+    }
+    batching_options.window = absl::Microseconds(window_micros);
+    batching_options.max_keys = parameter_fetcher_.GetInt32Parameter(
+        kLookupBatchMaxKeysParameterSuffix);
+    LOG(INFO) << "Retrieved " << kLookupBatchMaxKeysParameterSuffix
+              << " parameter: " << batching_options.max_keys;
+    if (batching_options.max_keys < 1) {
+      LOG(ERROR) << kLookupBatchMaxKeysParameterSuffix
+                 << " must be >= 1, looking up batches of one request";
+      batching_options.max_keys = 1;
+    }
+    return batching_options;
+  }
+
+  absl::Duration GetKeyFilterInterval() {
+    int32_t interval_ms = parameter_fetcher_.GetInt32Parameter(
+        kLookupKeyFilterIntervalMsParameterSuffix);
+    LOG(INFO) << "Retrieved " << kLookupKeyFilterIntervalMsParameterSuffix
+              << " parameter: " << interval_ms;
+    if (interval_ms < 0) {
+      LOG(ERROR) << kLookupKeyFilterIntervalMsParameterSuffix
+                 << " must be >= 0, disabling key filters";
+      interval_ms = 0;
+    }
+    return absl::Milliseconds(interval_ms);
+  }
+
+  int32_t GetKeyFilterBitsPerKey() {
+    int32_t bits_per_key = parameter_fetcher_.GetInt32Parameter(
+        kLookupKeyFilterBitsPerKeyParameterSuffix);
+    LOG(INFO) << "Retrieved " << kLookupKeyFilterBitsPerKeyParameterSuffix
+              << " parameter: " << bits_per_key;
+    if (bits_per_key < 1) {
+      LOG(ERROR) << kLookupKeyFilterBitsPerKeyParameterSuffix
+                 << " must be >= 1, using 10 bits per key";
+      bits_per_key = 10;
+    }
+    return bits_per_key;
+  }
+
+  RemoteLookupChannelOptions GetChannelOptions() {
+    RemoteLookupChannelOptions channel_options;
+    channel_options.num_channels = parameter_fetcher_.GetInt32Parameter(
+        kLookupChannelsPerReplicaParameterSuffix);
+    LOG(INFO) << "Retrieved " << kLookupChannelsPerReplicaParameterSuffix
+              << " parameter: " << channel_options.num_channels;
+    if (channel_options.num_channels < 1) {
+      LOG(ERROR) << kLookupChannelsPerReplicaParameterSuffix
+                 << " must be >= 1, using one channel per replica";
+      channel_options.num_channels = 1;
+    }
+    channel_options.keepalive_time = absl::Milliseconds(GetKeepaliveMs());
+    return channel_options;
+  }
+
   absl::StatusOr<ShardManagerState> CreateShardManager() {
     ShardManagerState shard_manager_state;
     VLOG(10) << "Creating shard manager";
@@ -136,7 +363,8 @@ class ShardedServerInitializer : public ServerInitializer {
         [&cluster_mappings_manager =
              *shard_manager_state.cluster_mappings_manager,
          &num_shards = num_shards_,
-         &key_fetcher_manager = key_fetcher_manager_] {
+         &key_fetcher_manager = key_fetcher_manager_,
+         channel_options = GetChannelOptions()] {
           // It might be that the cluster mappings that are passed don't pass
           // validation. E.g. a particular cluster might not have any
           // replicas
@@ -145,7 +373,7 @@ class ShardedServerInitializer : public ServerInitializer {
           // at that point in time might have new replicas spun up.
           return ShardManager::Create(
               num_shards, key_fetcher_manager,
-              cluster_mappings_manager.GetClusterMappings());
+              cluster_mappings_manager.GetClusterMappings(), channel_options);
         },
         "GetShardManager", LogStatusSafeMetricsFn<kGetShardManagerStatus>());
     auto start_status = shard_manager_state.cluster_mappings_manager->Start(
@@ -161,8 +389,10 @@ class ShardedServerInitializer : public ServerInitializer {
   int32_t num_shards_;
   int32_t current_shard_num_;
   InstanceClient& instance_client_;
+  Cache& cache_;
   ParameterFetcher& parameter_fetcher_;
   KeySharder key_sharder_;
+  LookupCache* lookup_cache_;
 };
 
 }  // namespace
@@ -171,15 +401,17 @@ std::unique_ptr<ServerInitializer> GetServerInitializer(
     int64_t num_shards, KeyFetcherManagerInterface& key_fetcher_manager,
     Lookup& local_lookup, std::string environment, int32_t current_shard_num,
     InstanceClient& instance_client, Cache& cache,
-    ParameterFetcher& parameter_fetcher, KeySharder key_sharder) {
+    ParameterFetcher& parameter_fetcher, KeySharder key_sharder,
+    LookupCache* lookup_cache, ThreadPool* query_thread_pool) {
   CHECK_GT(num_shards, 0) << "num_shards must be greater than 0";
   if (num_shards == 1) {
-    return std::make_unique<NonshardedServerInitializer>(cache);
+    return std::make_unique<NonshardedServerInitializer>(cache,
+                                                         query_thread_pool);
   }
 
   return std::make_unique<ShardedServerInitializer>(
       key_fetcher_manager, local_lookup, environment, num_shards,
-      current_shard_num, instance_client, parameter_fetcher,
-      std::move(key_sharder));
+      current_shard_num, instance_client, cache, parameter_fetcher,
+      std::move(key_sharder), lookup_cache);
 }
 }  // namespace kv_server
@@ -23,10 +23,16 @@
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "components/data_server/server/parameter_fetcher.h"
+#include "components/internal_server/caching_lookup.h"
+#include "components/internal_server/key_filter_publisher.h"
 #include "components/internal_server/lookup.h"
+#include "components/internal_server/shard_key_filters.h"
 #include "components/sharding/cluster_mappings_manager.h"
+#include "components/udf/hooks/get_keys_containing_hook.h"
 #include "components/udf/hooks/get_values_hook.h"
 #include "components/udf/hooks/run_query_hook.h"
+#include "components/udf/native_udf_registry.h"
+#include "components/util/thread_pool.h"
 #include "grpcpp/grpcpp.h"
 #include "public/sharding/key_sharder.h"
 #include "src/encryption/key_fetcher/interface/key_fetcher_manager_interface.h"
@@ -39,6 +45,11 @@ namespace kv_server {
 // server at the start up. if `num_shards` == 1, then null, since no remote
 // lookups are necessray
 struct RemoteLookup {
+  // Batches the lookups of the service, if enabled. Must outlive the service.
+  std::unique_ptr<Lookup> batching_lookup;
+  // Publishes the key filter of the shard, if enabled. Must outlive the
+  // service.
+  std::unique_ptr<KeyFilterPublisher> key_filter_publisher;
   std::unique_ptr<grpc::Service> remote_lookup_service;
   std::unique_ptr<grpc::Server> remote_lookup_server;
 };
@@ -46,6 +57,9 @@ struct RemoteLookup {
 struct ShardManagerState {
   std::unique_ptr<ClusterMappingsManager> cluster_mappings_manager;
   std::unique_ptr<ShardManager> shard_manager;
+  // Key filters of the remote shards, if enabled. Declared after
+  // `shard_manager`, which they fetch the filters with.
+  std::unique_ptr<ShardKeyFilters> key_filters;
 };
 
 // Encapsulates logic that differs for sharded and non-sharded implementations.
@@ -54,16 +68,23 @@ class ServerInitializer {
   virtual RemoteLookup CreateAndStartRemoteLookupServer() = 0;
   virtual absl::StatusOr<ShardManagerState> InitializeUdfHooks(
       GetValuesHook& string_get_values_hook,
-      GetValuesHook& binary_get_values_hook, RunQueryHook& run_query_hook) = 0;
+      GetValuesHook& binary_get_values_hook, RunQueryHook& run_query_hook,
+      RunQueryHook& binary_run_query_hook, RunQueryHook& uint32_run_query_hook,
+      GetKeysContainingHook& get_keys_containing_hook,
+      NativeUdfRegistry& native_udfs) = 0;
 };
 
+// If `lookup_cache` is set, the sharded lookups of the UDF hooks are served
+// from it when possible. It must outlive the hooks.
 std::unique_ptr<ServerInitializer> GetServerInitializer(
     int64_t num_shards,
     privacy_sandbox::server_common::KeyFetcherManagerInterface&
         key_fetcher_manager,
     Lookup& local_lookup, std::string environment, int32_t current_shard_num,
     InstanceClient& instance_client, Cache& cache,
-    ParameterFetcher& parameter_fetcher, KeySharder key_sharder);
+    ParameterFetcher& parameter_fetcher, KeySharder key_sharder,
+    LookupCache* lookup_cache = nullptr,
+    ThreadPool* query_thread_pool = nullptr);
 
 }  // namespace kv_server
 #endif  // COMPONENTS_DATA_SERVER_SERVER_INITIALIZER_H_
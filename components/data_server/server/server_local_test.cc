@@ -59,6 +59,40 @@ void RegisterRequiredTelemetryExpectations(MockParameterClient& client) {
   EXPECT_CALL(client, GetParameter("kv-server-environment-telemetry-config",
                                    testing::Eq(std::nullopt)))
       .WillOnce(::testing::Return("mode: EXPERIMENT"));
+  EXPECT_CALL(client,
+              GetInt32Parameter("kv-server-environment-cache-num-segments"))
+      .WillOnce(::testing::Return(1));
+  EXPECT_CALL(client,
+              GetBoolParameter("kv-server-environment-use-epoch-based-cache"))
+      .WillOnce(::testing::Return(false));
+  EXPECT_CALL(client, GetBoolParameter(
+                          "kv-server-environment-cache-intern-set-values"))
+      .WillOnce(::testing::Return(false));
+  EXPECT_CALL(client, GetBoolParameter(
+                          "kv-server-environment-cache-precompute-json-values"))
+      .WillOnce(::testing::Return(false));
+  EXPECT_CALL(client, GetBoolParameter(
+                          "kv-server-environment-cache-compress-values"))
+      .WillOnce(::testing::Return(false));
+  EXPECT_CALL(client, GetBoolParameter(
+                          "kv-server-environment-cache-deduplicate-values"))
+      .WillOnce(::testing::Return(false));
+  EXPECT_CALL(client,
+              GetBoolParameter("kv-server-environment-cache-isolate-prefixes"))
+      .WillOnce(::testing::Return(false));
+  EXPECT_CALL(client,
+              GetBoolParameter("kv-server-environment-cache-index-set-values"))
+      .WillOnce(::testing::Return(false));
+  EXPECT_CALL(client,
+              GetBoolParameter("kv-server-environment-cache-index-keys"))
+      .WillOnce(::testing::Return(false));
+  EXPECT_CALL(client, GetInt32Parameter(
+                          "kv-server-environment-cache-hot-key-sample-rate"))
+      .WillOnce(::testing::Return(0));
+  EXPECT_CALL(client,
+              GetParameter("kv-server-environment-cache-cold-value-directory",
+                           testing::Optional(std::string(""))))
+      .WillOnce(::testing::Return(""));
 }
 
 void InitializeMetrics() {
@@ -124,6 +158,45 @@ TEST(ServerLocalTest, InitFailsWithNoDeltaDirectory) {
   EXPECT_CALL(*parameter_client,
               GetBoolParameter("kv-server-environment-add-missing-keys-v1"))
       .WillOnce(::testing::Return(false));
+  EXPECT_CALL(
+      *parameter_client,
+      GetBoolParameter("kv-server-environment-v1-direct-serialization"))
+      .WillOnce(::testing::Return(false));
+  EXPECT_CALL(
+      *parameter_client,
+      GetBoolParameter("kv-server-environment-v1-merge-namespace-lookups"))
+      .WillOnce(::testing::Return(false));
+  EXPECT_CALL(
+      *parameter_client,
+      GetInt32Parameter("kv-server-environment-grpc-max-concurrent-streams"))
+      .WillOnce(::testing::Return(0));
+  EXPECT_CALL(
+      *parameter_client,
+      GetInt32Parameter("kv-server-environment-grpc-max-threads-per-core"))
+      .WillOnce(::testing::Return(0));
+  EXPECT_CALL(*parameter_client,
+              GetInt32Parameter("kv-server-environment-grpc-memory-quota-mb"))
+      .WillOnce(::testing::Return(0));
+  EXPECT_CALL(
+      *parameter_client,
+      GetInt32Parameter("kv-server-environment-admission-max-in-flight"))
+      .WillOnce(::testing::Return(0));
+  EXPECT_CALL(*parameter_client,
+              GetInt32Parameter(
+                  "kv-server-environment-admission-critical-reserve-percent"))
+      .WillOnce(::testing::Return(20));
+  EXPECT_CALL(
+      *parameter_client,
+      GetInt32Parameter("kv-server-environment-admission-latency-target-ms"))
+      .WillOnce(::testing::Return(0));
+  EXPECT_CALL(
+      *parameter_client,
+      GetInt32Parameter("kv-server-environment-response-brotli-quality"))
+      .WillOnce(::testing::Return(11));
+  EXPECT_CALL(
+      *parameter_client,
+      GetInt32Parameter("kv-server-environment-response-brotli-window"))
+      .WillOnce(::testing::Return(22));
   EXPECT_CALL(
       *parameter_client,
       GetInt32Parameter("kv-server-environment-logging-verbosity-level"))
@@ -131,6 +204,21 @@ TEST(ServerLocalTest, InitFailsWithNoDeltaDirectory) {
   EXPECT_CALL(*parameter_client,
               GetBoolParameter("kv-server-environment-use-sharding-key-regex"))
       .WillOnce(::testing::Return(false));
+  EXPECT_CALL(*parameter_client,
+              GetBoolParameter("kv-server-environment-use-siphash-sharding"))
+      .WillOnce(::testing::Return(false));
+  EXPECT_CALL(*parameter_client,
+              GetParameter("kv-server-environment-sharding-replicated-keys",
+                           ::testing::Eq("")))
+      .WillOnce(::testing::Return(""));
+  EXPECT_CALL(*parameter_client,
+              GetParameter("kv-server-environment-serving-cpus",
+                           ::testing::Eq("")))
+      .WillOnce(::testing::Return(""));
+  EXPECT_CALL(*parameter_client,
+              GetParameter("kv-server-environment-serving-memory-policy",
+                           ::testing::Eq("")))
+      .WillOnce(::testing::Return(""));
   EXPECT_CALL(
       *parameter_client,
       GetParameter("kv-server-environment-data-loading-blob-prefix-allowlist",
@@ -193,6 +281,45 @@ TEST(ServerLocalTest, InitPassesWithDeltaDirectoryAndRealtimeDirectory) {
   EXPECT_CALL(*parameter_client,
               GetBoolParameter("kv-server-environment-add-missing-keys-v1"))
       .WillOnce(::testing::Return(false));
+  EXPECT_CALL(
+      *parameter_client,
+      GetBoolParameter("kv-server-environment-v1-direct-serialization"))
+      .WillOnce(::testing::Return(false));
+  EXPECT_CALL(
+      *parameter_client,
+      GetBoolParameter("kv-server-environment-v1-merge-namespace-lookups"))
+      .WillOnce(::testing::Return(false));
+  EXPECT_CALL(
+      *parameter_client,
+      GetInt32Parameter("kv-server-environment-grpc-max-concurrent-streams"))
+      .WillOnce(::testing::Return(0));
+  EXPECT_CALL(
+      *parameter_client,
+      GetInt32Parameter("kv-server-environment-grpc-max-threads-per-core"))
+      .WillOnce(::testing::Return(0));
+  EXPECT_CALL(*parameter_client,
+              GetInt32Parameter("kv-server-environment-grpc-memory-quota-mb"))
+      .WillOnce(::testing::Return(0));
+  EXPECT_CALL(
+      *parameter_client,
+      GetInt32Parameter("kv-server-environment-admission-max-in-flight"))
+      .WillOnce(::testing::Return(0));
+  EXPECT_CALL(*parameter_client,
+              GetInt32Parameter(
+                  "kv-server-environment-admission-critical-reserve-percent"))
+      .WillOnce(::testing::Return(20));
+  EXPECT_CALL(
+      *parameter_client,
+      GetInt32Parameter("kv-server-environment-admission-latency-target-ms"))
+      .WillOnce(::testing::Return(0));
+  EXPECT_CALL(
+      *parameter_client,
+      GetInt32Parameter("kv-server-environment-response-brotli-quality"))
+      .WillOnce(::testing::Return(11));
+  EXPECT_CALL(
+      *parameter_client,
+      GetInt32Parameter("kv-server-environment-response-brotli-window"))
+      .WillOnce(::testing::Return(22));
   EXPECT_CALL(
       *parameter_client,
       GetInt32Parameter("kv-server-environment-logging-verbosity-level"))
@@ -200,6 +327,29 @@ TEST(ServerLocalTest, InitPassesWithDeltaDirectoryAndRealtimeDirectory) {
   EXPECT_CALL(*parameter_client,
               GetBoolParameter("kv-server-environment-use-sharding-key-regex"))
       .WillOnce(::testing::Return(false));
+  EXPECT_CALL(*parameter_client,
+              GetBoolParameter("kv-server-environment-use-siphash-sharding"))
+      .WillOnce(::testing::Return(false));
+  EXPECT_CALL(*parameter_client,
+              GetParameter("kv-server-environment-sharding-replicated-keys",
+                           ::testing::Eq("")))
+      .WillOnce(::testing::Return(""));
+  EXPECT_CALL(*parameter_client,
+              GetParameter("kv-server-environment-serving-cpus",
+                           ::testing::Eq("")))
+      .WillOnce(::testing::Return(""));
+  EXPECT_CALL(*parameter_client,
+              GetParameter("kv-server-environment-serving-memory-policy",
+                           ::testing::Eq("")))
+      .WillOnce(::testing::Return(""));
+  EXPECT_CALL(*parameter_client,
+              GetParameter("kv-server-environment-data-loading-cpus",
+                           ::testing::Eq("")))
+      .WillOnce(::testing::Return(""));
+  EXPECT_CALL(*parameter_client,
+              GetParameter("kv-server-environment-data-loading-memory-policy",
+                           ::testing::Eq("")))
+      .WillOnce(::testing::Return(""));
   EXPECT_CALL(*mock_udf_client, SetCodeObject(_))
       .WillOnce(testing::Return(absl::OkStatus()));
   EXPECT_CALL(
@@ -268,9 +418,71 @@ TEST(ServerLocalTest, GracefulServerShutdown) {
   EXPECT_CALL(*parameter_client,
               GetBoolParameter("kv-server-environment-add-missing-keys-v1"))
       .WillOnce(::testing::Return(false));
+  EXPECT_CALL(
+      *parameter_client,
+      GetBoolParameter("kv-server-environment-v1-direct-serialization"))
+      .WillOnce(::testing::Return(false));
+  EXPECT_CALL(
+      *parameter_client,
+      GetBoolParameter("kv-server-environment-v1-merge-namespace-lookups"))
+      .WillOnce(::testing::Return(false));
+  EXPECT_CALL(
+      *parameter_client,
+      GetInt32Parameter("kv-server-environment-grpc-max-concurrent-streams"))
+      .WillOnce(::testing::Return(0));
+  EXPECT_CALL(
+      *parameter_client,
+      GetInt32Parameter("kv-server-environment-grpc-max-threads-per-core"))
+      .WillOnce(::testing::Return(0));
+  EXPECT_CALL(*parameter_client,
+              GetInt32Parameter("kv-server-environment-grpc-memory-quota-mb"))
+      .WillOnce(::testing::Return(0));
+  EXPECT_CALL(
+      *parameter_client,
+      GetInt32Parameter("kv-server-environment-admission-max-in-flight"))
+      .WillOnce(::testing::Return(0));
+  EXPECT_CALL(*parameter_client,
+              GetInt32Parameter(
+                  "kv-server-environment-admission-critical-reserve-percent"))
+      .WillOnce(::testing::Return(20));
+  EXPECT_CALL(
+      *parameter_client,
+      GetInt32Parameter("kv-server-environment-admission-latency-target-ms"))
+      .WillOnce(::testing::Return(0));
+  EXPECT_CALL(
+      *parameter_client,
+      GetInt32Parameter("kv-server-environment-response-brotli-quality"))
+      .WillOnce(::testing::Return(11));
+  EXPECT_CALL(
+      *parameter_client,
+      GetInt32Parameter("kv-server-environment-response-brotli-window"))
+      .WillOnce(::testing::Return(22));
   EXPECT_CALL(*parameter_client,
               GetBoolParameter("kv-server-environment-use-sharding-key-regex"))
       .WillOnce(::testing::Return(false));
+  EXPECT_CALL(*parameter_client,
+              GetBoolParameter("kv-server-environment-use-siphash-sharding"))
+      .WillOnce(::testing::Return(false));
+  EXPECT_CALL(*parameter_client,
+              GetParameter("kv-server-environment-sharding-replicated-keys",
+                           ::testing::Eq("")))
+      .WillOnce(::testing::Return(""));
+  EXPECT_CALL(*parameter_client,
+              GetParameter("kv-server-environment-serving-cpus",
+                           ::testing::Eq("")))
+      .WillOnce(::testing::Return(""));
+  EXPECT_CALL(*parameter_client,
+              GetParameter("kv-server-environment-serving-memory-policy",
+                           ::testing::Eq("")))
+      .WillOnce(::testing::Return(""));
+  EXPECT_CALL(*parameter_client,
+              GetParameter("kv-server-environment-data-loading-cpus",
+                           ::testing::Eq("")))
+      .WillOnce(::testing::Return(""));
+  EXPECT_CALL(*parameter_client,
+              GetParameter("kv-server-environment-data-loading-memory-policy",
+                           ::testing::Eq("")))
+      .WillOnce(::testing::Return(""));
   EXPECT_CALL(*mock_udf_client, SetCodeObject(_))
       .WillOnce(testing::Return(absl::OkStatus()));
   EXPECT_CALL(
@@ -339,6 +551,45 @@ TEST(ServerLocalTest, ForceServerShutdown) {
   EXPECT_CALL(*parameter_client,
               GetBoolParameter("kv-server-environment-add-missing-keys-v1"))
       .WillOnce(::testing::Return(false));
+  EXPECT_CALL(
+      *parameter_client,
+      GetBoolParameter("kv-server-environment-v1-direct-serialization"))
+      .WillOnce(::testing::Return(false));
+  EXPECT_CALL(
+      *parameter_client,
+      GetBoolParameter("kv-server-environment-v1-merge-namespace-lookups"))
+      .WillOnce(::testing::Return(false));
+  EXPECT_CALL(
+      *parameter_client,
+      GetInt32Parameter("kv-server-environment-grpc-max-concurrent-streams"))
+      .WillOnce(::testing::Return(0));
+  EXPECT_CALL(
+      *parameter_client,
+      GetInt32Parameter("kv-server-environment-grpc-max-threads-per-core"))
+      .WillOnce(::testing::Return(0));
+  EXPECT_CALL(*parameter_client,
+              GetInt32Parameter("kv-server-environment-grpc-memory-quota-mb"))
+      .WillOnce(::testing::Return(0));
+  EXPECT_CALL(
+      *parameter_client,
+      GetInt32Parameter("kv-server-environment-admission-max-in-flight"))
+      .WillOnce(::testing::Return(0));
+  EXPECT_CALL(*parameter_client,
+              GetInt32Parameter(
+                  "kv-server-environment-admission-critical-reserve-percent"))
+      .WillOnce(::testing::Return(20));
+  EXPECT_CALL(
+      *parameter_client,
+      GetInt32Parameter("kv-server-environment-admission-latency-target-ms"))
+      .WillOnce(::testing::Return(0));
+  EXPECT_CALL(
+      *parameter_client,
+      GetInt32Parameter("kv-server-environment-response-brotli-quality"))
+      .WillOnce(::testing::Return(11));
+  EXPECT_CALL(
+      *parameter_client,
+      GetInt32Parameter("kv-server-environment-response-brotli-window"))
+      .WillOnce(::testing::Return(22));
   EXPECT_CALL(
       *parameter_client,
       GetInt32Parameter("kv-server-environment-logging-verbosity-level"))
@@ -346,6 +597,29 @@ TEST(ServerLocalTest, ForceServerShutdown) {
   EXPECT_CALL(*parameter_client,
               GetBoolParameter("kv-server-environment-use-sharding-key-regex"))
       .WillOnce(::testing::Return(false));
+  EXPECT_CALL(*parameter_client,
+              GetBoolParameter("kv-server-environment-use-siphash-sharding"))
+      .WillOnce(::testing::Return(false));
+  EXPECT_CALL(*parameter_client,
+              GetParameter("kv-server-environment-sharding-replicated-keys",
+                           ::testing::Eq("")))
+      .WillOnce(::testing::Return(""));
+  EXPECT_CALL(*parameter_client,
+              GetParameter("kv-server-environment-serving-cpus",
+                           ::testing::Eq("")))
+      .WillOnce(::testing::Return(""));
+  EXPECT_CALL(*parameter_client,
+              GetParameter("kv-server-environment-serving-memory-policy",
+                           ::testing::Eq("")))
+      .WillOnce(::testing::Return(""));
+  EXPECT_CALL(*parameter_client,
+              GetParameter("kv-server-environment-data-loading-cpus",
+                           ::testing::Eq("")))
+      .WillOnce(::testing::Return(""));
+  EXPECT_CALL(*parameter_client,
+              GetParameter("kv-server-environment-data-loading-memory-policy",
+                           ::testing::Eq("")))
+      .WillOnce(::testing::Return(""));
   EXPECT_CALL(*mock_udf_client, SetCodeObject(_))
       .WillOnce(testing::Return(absl::OkStatus()));
   EXPECT_CALL(
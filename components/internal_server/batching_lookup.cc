@@ -0,0 +1,185 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/internal_server/batching_lookup.h"
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/synchronization/notification.h"
+#include "components/telemetry/server_definition.h"
+
+namespace kv_server {
+namespace {
+
+using LookupFunction = absl::StatusOr<InternalLookupResponse> (Lookup::*)(
+    const RequestContext&, const absl::flat_hash_set<std::string_view>&) const;
+
+// Key lookups merged into one call of the wrapped lookup. The keys are views
+// of the requests of the callers, which wait until the batch is done.
+struct Batch {
+  absl::flat_hash_set<std::string_view> keys;
+  int num_callers = 0;
+  bool full = false;
+  absl::Notification done;
+  absl::StatusOr<InternalLookupResponse> response;
+};
+
+// Batches the calls of one lookup function.
+class Batcher {
+ public:
+  Batcher(const Lookup& lookup, LookupFunction function,
+          BatchingOptions options)
+      : lookup_(lookup), function_(function), options_(options) {}
+
+  absl::StatusOr<InternalLookupResponse> Get(
+      const RequestContext& request_context,
+      const absl::flat_hash_set<std::string_view>& keys) {
+    if (keys.empty()) {
+      return InternalLookupResponse();
+    }
+    std::shared_ptr<Batch> batch;
+    bool first = false;
+    {
+      absl::MutexLock lock(&mutex_);
+      if (open_batch_ == nullptr) {
+        open_batch_ = std::make_shared<Batch>();
+        first = true;
+      }
+      batch = open_batch_;
+      batch->keys.insert(keys.begin(), keys.end());
+      batch->num_callers++;
+      if (batch->keys.size() >= static_cast<size_t>(options_.max_keys)) {
+        // Later callers start a new batch.
+        batch->full = true;
+        open_batch_ = nullptr;
+      }
+      if (first) {
+        mutex_.AwaitWithTimeout(absl::Condition(&batch->full),
+                                options_.window);
+        if (open_batch_ == batch) {
+          open_batch_ = nullptr;
+        }
+      }
+    }
+    if (first) {
+      // No caller joins the batch anymore, so it is read without the lock.
+      LogBatchMetrics(*batch);
+      batch->response = (lookup_.*function_)(request_context, batch->keys);
+      batch->done.Notify();
+    } else {
+      batch->done.WaitForNotification();
+    }
+    if (!batch->response.ok()) {
+      return batch->response.status();
+    }
+    if (batch->num_callers == 1) {
+      return std::move(batch->response);
+    }
+    InternalLookupResponse response;
+    const auto& kv_pairs = batch->response->kv_pairs();
+    for (std::string_view key : keys) {
+      if (const auto it = kv_pairs.find(std::string(key));
+          it != kv_pairs.end()) {
+        (*response.mutable_kv_pairs())[it->first] = it->second;
+      }
+    }
+    return response;
+  }
+
+ private:
+  static void LogBatchMetrics(const Batch& batch) {
+    LogIfError(KVServerContextMap()
+                   ->SafeMetric()
+                   .LogHistogram<kLookupBatchCallerCount>(
+                       static_cast<double>(batch.num_callers)));
+    LogIfError(KVServerContextMap()
+                   ->SafeMetric()
+                   .LogHistogram<kLookupBatchKeyCount>(
+                       static_cast<double>(batch.keys.size())));
+  }
+
+  const Lookup& lookup_;
+  const LookupFunction function_;
+  const BatchingOptions options_;
+  absl::Mutex mutex_;
+  // Batch that new callers join, if any.
+  std::shared_ptr<Batch> open_batch_ ABSL_GUARDED_BY(mutex_);
+};
+
+class BatchingLookup : public Lookup {
+ public:
+  BatchingLookup(const Lookup& lookup, BatchingOptions options)
+      : lookup_(lookup),
+        key_values_batcher_(lookup, &Lookup::GetKeyValues, options),
+        key_value_set_batcher_(lookup, &Lookup::GetKeyValueSet, options) {}
+
+  absl::StatusOr<InternalLookupResponse> GetKeyValues(
+      const RequestContext& request_context,
+      const absl::flat_hash_set<std::string_view>& keys) const override {
+    return key_values_batcher_.Get(request_context, keys);
+  }
+
+  absl::StatusOr<InternalLookupResponse> GetKeyValueSet(
+      const RequestContext& request_context,
+      const absl::flat_hash_set<std::string_view>& key_set) const override {
+    return key_value_set_batcher_.Get(request_context, key_set);
+  }
+
+  absl::StatusOr<InternalLookupResponse> GetKeyValueSetSizes(
+      const RequestContext& request_context,
+      const absl::flat_hash_set<std::string_view>& key_set) const override {
+    return lookup_.GetKeyValueSetSizes(request_context, key_set);
+  }
+
+  absl::StatusOr<InternalRunQueryResponse> RunQuery(
+      const RequestContext& request_context, std::string query) const override {
+    return lookup_.RunQuery(request_context, std::move(query));
+  }
+
+  absl::StatusOr<InternalRunSetQueryUInt32Response> RunSetQueryUInt32(
+      const RequestContext& request_context, std::string query) const override {
+    return lookup_.RunSetQueryUInt32(request_context, std::move(query));
+  }
+
+  absl::StatusOr<InternalGetKeysContainingResponse> GetKeysContaining(
+      const RequestContext& request_context, std::string value) const override {
+    return lookup_.GetKeysContaining(request_context, std::move(value));
+  }
+
+  absl::StatusOr<InternalLookupResponse> GetValuesByPrefix(
+      const RequestContext& request_context, std::string key_prefix,
+      int64_t limit) const override {
+    return lookup_.GetValuesByPrefix(request_context, std::move(key_prefix),
+                                     limit);
+  }
+
+ private:
+  const Lookup& lookup_;
+  mutable Batcher key_values_batcher_;
+  mutable Batcher key_value_set_batcher_;
+};
+
+}  // namespace
+
+std::unique_ptr<Lookup> CreateBatchingLookup(const Lookup& lookup,
+                                             BatchingOptions options) {
+  return std::make_unique<BatchingLookup>(lookup, options);
+}
+
+}  // namespace kv_server
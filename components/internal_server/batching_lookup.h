@@ -0,0 +1,48 @@
+/*
+ * Copyright 2023 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef COMPONENTS_INTERNAL_SERVER_BATCHING_LOOKUP_H_
+#define COMPONENTS_INTERNAL_SERVER_BATCHING_LOOKUP_H_
+
+#include <memory>
+
+#include "absl/time/time.h"
+#include "components/internal_server/lookup.h"
+
+namespace kv_server {
+
+struct BatchingOptions {
+  // Time the first key lookup of a batch waits for concurrent key lookups to
+  // join it. Zero disables batching.
+  absl::Duration window = absl::ZeroDuration();
+  // A batch is looked up without waiting for the end of its window once it
+  // has this many keys.
+  int32_t max_keys = 1000;
+};
+
+// Merges the `GetKeyValues` and `GetKeyValueSet` calls that arrive within
+// `options.window` of each other into one call of `lookup` with the union of
+// their keys, and hands every caller the results of its own keys. Meant for
+// the lookup server of a shard, where many servers send small lookups for the
+// same data at the same time. Queries are passed through. The batch is looked
+// up with the request context of its first caller. `lookup` must outlive the
+// returned lookup.
+std::unique_ptr<Lookup> CreateBatchingLookup(const Lookup& lookup,
+                                             BatchingOptions options);
+
+}  // namespace kv_server
+
+#endif  // COMPONENTS_INTERNAL_SERVER_BATCHING_LOOKUP_H_
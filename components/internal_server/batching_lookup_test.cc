@@ -0,0 +1,162 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/internal_server/batching_lookup.h"
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+
+#include "absl/time/time.h"
+#include "components/internal_server/mocks.h"
+#include "gmock/gmock.h"
+#include "google/protobuf/text_format.h"
+#include "gtest/gtest.h"
+#include "public/test_util/proto_matcher.h"
+
+namespace kv_server {
+namespace {
+
+using google::protobuf::TextFormat;
+using testing::_;
+using testing::Return;
+using testing::UnorderedElementsAre;
+
+class BatchingLookupTest : public ::testing::Test {
+ protected:
+  BatchingLookupTest() {
+    InitMetricsContextMap();
+    scope_metrics_context_ = std::make_unique<ScopeMetricsContext>();
+    request_context_ =
+        std::make_unique<RequestContext>(*scope_metrics_context_);
+  }
+  RequestContext& GetRequestContext() { return *request_context_; }
+  std::unique_ptr<ScopeMetricsContext> scope_metrics_context_;
+  std::unique_ptr<RequestContext> request_context_;
+  MockLookup mock_lookup_;
+};
+
+InternalLookupResponse ParseResponse(std::string_view text) {
+  InternalLookupResponse response;
+  TextFormat::ParseFromString(std::string(text), &response);
+  return response;
+}
+
+TEST_F(BatchingLookupTest, SingleCallerGetsResponseOfLookup) {
+  const auto response = ParseResponse(R"pb(kv_pairs {
+                                             key: "key1"
+                                             value { value: "value1" }
+                                           })pb");
+  EXPECT_CALL(mock_lookup_, GetKeyValues(_, UnorderedElementsAre("key1")))
+      .WillOnce(Return(response));
+  auto batching_lookup = CreateBatchingLookup(
+      mock_lookup_, {.window = absl::Microseconds(100)});
+  auto result = batching_lookup->GetKeyValues(GetRequestContext(), {"key1"});
+  ASSERT_TRUE(result.ok());
+  EXPECT_THAT(*result, EqualsProto(response));
+}
+
+TEST_F(BatchingLookupTest, ConcurrentCallersShareOneLookup) {
+  EXPECT_CALL(mock_lookup_,
+              GetKeyValueSet(_, UnorderedElementsAre("key1", "key2", "key3")))
+      .WillOnce(Return(ParseResponse(R"pb(
+        kv_pairs {
+          key: "key1"
+          value { keyset_values { values: "value1" } }
+        }
+        kv_pairs {
+          key: "key2"
+          value { keyset_values { values: "value2" } }
+        }
+        kv_pairs {
+          key: "key3"
+          value { status { code: 5 message: "Key not found: key3" } }
+        })pb")));
+  // Closes the batch only once it has the keys of both callers.
+  auto batching_lookup = CreateBatchingLookup(
+      mock_lookup_, {.window = absl::Hours(1), .max_keys = 3});
+  absl::StatusOr<InternalLookupResponse> other_result;
+  std::thread other_caller([&] {
+    RequestContext other_request_context(*scope_metrics_context_);
+    other_result = batching_lookup->GetKeyValueSet(other_request_context,
+                                                   {"key1", "key2"});
+  });
+  auto result =
+      batching_lookup->GetKeyValueSet(GetRequestContext(), {"key2", "key3"});
+  other_caller.join();
+  ASSERT_TRUE(result.ok());
+  EXPECT_THAT(*result, EqualsProto(ParseResponse(R"pb(
+                kv_pairs {
+                  key: "key2"
+                  value { keyset_values { values: "value2" } }
+                }
+                kv_pairs {
+                  key: "key3"
+                  value { status { code: 5 message: "Key not found: key3" } }
+                })pb")));
+  ASSERT_TRUE(other_result.ok());
+  EXPECT_THAT(*other_result, EqualsProto(ParseResponse(R"pb(
+                kv_pairs {
+                  key: "key1"
+                  value { keyset_values { values: "value1" } }
+                }
+                kv_pairs {
+                  key: "key2"
+                  value { keyset_values { values: "value2" } }
+                })pb")));
+}
+
+TEST_F(BatchingLookupTest, ConcurrentCallersShareError) {
+  EXPECT_CALL(mock_lookup_,
+              GetKeyValues(_, UnorderedElementsAre("key1", "key2")))
+      .WillOnce(Return(absl::UnavailableError("cache unavailable")));
+  auto batching_lookup = CreateBatchingLookup(
+      mock_lookup_, {.window = absl::Hours(1), .max_keys = 2});
+  absl::StatusOr<InternalLookupResponse> other_result;
+  std::thread other_caller([&] {
+    RequestContext other_request_context(*scope_metrics_context_);
+    other_result =
+        batching_lookup->GetKeyValues(other_request_context, {"key1"});
+  });
+  auto result = batching_lookup->GetKeyValues(GetRequestContext(), {"key2"});
+  other_caller.join();
+  EXPECT_EQ(result.status().code(), absl::StatusCode::kUnavailable);
+  EXPECT_EQ(other_result.status().code(), absl::StatusCode::kUnavailable);
+}
+
+TEST_F(BatchingLookupTest, EmptyKeysAreNotLookedUp) {
+  EXPECT_CALL(mock_lookup_, GetKeyValues).Times(0);
+  auto batching_lookup =
+      CreateBatchingLookup(mock_lookup_, {.window = absl::Hours(1)});
+  auto result = batching_lookup->GetKeyValues(GetRequestContext(), {});
+  ASSERT_TRUE(result.ok());
+  EXPECT_TRUE(result->kv_pairs().empty());
+}
+
+TEST_F(BatchingLookupTest, RunQueryIsPassedThrough) {
+  InternalRunQueryResponse response;
+  response.add_elements("value1");
+  EXPECT_CALL(mock_lookup_, RunQuery(_, "key1|key2"))
+      .WillOnce(Return(response));
+  auto batching_lookup =
+      CreateBatchingLookup(mock_lookup_, {.window = absl::Hours(1)});
+  auto result = batching_lookup->RunQuery(GetRequestContext(), "key1|key2");
+  ASSERT_TRUE(result.ok());
+  EXPECT_THAT(*result, EqualsProto(response));
+}
+
+}  // namespace
+}  // namespace kv_server
@@ -0,0 +1,185 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/internal_server/caching_lookup.h"
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "absl/status/status.h"
+#include "components/telemetry/server_definition.h"
+
+namespace kv_server {
+namespace {
+
+// Only values and not found results are cached, other errors are retried.
+bool IsCacheable(const SingleLookupResult& result) {
+  if (result.has_value()) {
+    return true;
+  }
+  constexpr int kNotFound = static_cast<int>(absl::StatusCode::kNotFound);
+  return result.has_status() && result.status().code() == kNotFound;
+}
+
+class CachingLookup : public Lookup {
+ public:
+  CachingLookup(std::unique_ptr<Lookup> lookup, LookupCache& cache)
+      : lookup_(std::move(lookup)), cache_(cache) {}
+
+  absl::StatusOr<InternalLookupResponse> GetKeyValues(
+      const RequestContext& request_context,
+      const absl::flat_hash_set<std::string_view>& keys) const override {
+    InternalLookupResponse response;
+    absl::flat_hash_set<std::string_view> misses;
+    const uint64_t generation = cache_.Get(keys, response, misses);
+    LogIfError(KVServerContextMap()
+                   ->SafeMetric()
+                   .LogUpDownCounter<kLookupCacheHitCount>(keys.size() -
+                                                           misses.size()));
+    if (misses.empty()) {
+      return response;
+    }
+    LogIfError(KVServerContextMap()
+                   ->SafeMetric()
+                   .LogUpDownCounter<kLookupCacheMissCount>(misses.size()));
+    auto lookup_response = lookup_->GetKeyValues(request_context, misses);
+    if (!lookup_response.ok()) {
+      return lookup_response;
+    }
+    cache_.Put(*lookup_response, generation);
+    for (auto& [key, result] : *lookup_response->mutable_kv_pairs()) {
+      (*response.mutable_kv_pairs())[key] = std::move(result);
+    }
+    return response;
+  }
+
+  absl::StatusOr<InternalLookupResponse> GetKeyValueSet(
+      const RequestContext& request_context,
+      const absl::flat_hash_set<std::string_view>& key_set) const override {
+    return lookup_->GetKeyValueSet(request_context, key_set);
+  }
+
+  absl::StatusOr<InternalLookupResponse> GetKeyValueSetSizes(
+      const RequestContext& request_context,
+      const absl::flat_hash_set<std::string_view>& key_set) const override {
+    return lookup_->GetKeyValueSetSizes(request_context, key_set);
+  }
+
+  absl::StatusOr<InternalRunQueryResponse> RunQuery(
+      const RequestContext& request_context, std::string query) const override {
+    return lookup_->RunQuery(request_context, std::move(query));
+  }
+
+  absl::StatusOr<InternalRunSetQueryUInt32Response> RunSetQueryUInt32(
+      const RequestContext& request_context, std::string query) const override {
+    return lookup_->RunSetQueryUInt32(request_context, std::move(query));
+  }
+
+  absl::StatusOr<InternalGetKeysContainingResponse> GetKeysContaining(
+      const RequestContext& request_context, std::string value) const override {
+    return lookup_->GetKeysContaining(request_context, std::move(value));
+  }
+
+  absl::StatusOr<InternalLookupResponse> GetValuesByPrefix(
+      const RequestContext& request_context, std::string key_prefix,
+      int64_t limit) const override {
+    return lookup_->GetValuesByPrefix(request_context, std::move(key_prefix),
+                                      limit);
+  }
+
+ private:
+  const std::unique_ptr<Lookup> lookup_;
+  LookupCache& cache_;
+};
+
+}  // namespace
+
+uint64_t LookupCache::Get(const absl::flat_hash_set<std::string_view>& keys,
+                          InternalLookupResponse& response,
+                          absl::flat_hash_set<std::string_view>& misses) {
+  const absl::Time now = absl::Now();
+  absl::MutexLock lock(&mutex_);
+  for (const std::string_view key : keys) {
+    const auto it = entries_.find(key);
+    if (it == entries_.end()) {
+      misses.insert(key);
+      continue;
+    }
+    if (it->second.expiry <= now) {
+      lru_.erase(it->second.lru_position);
+      entries_.erase(it);
+      misses.insert(key);
+      continue;
+    }
+    lru_.splice(lru_.begin(), lru_, it->second.lru_position);
+    (*response.mutable_kv_pairs())[std::string(key)] = it->second.result;
+  }
+  return generation_;
+}
+
+void LookupCache::Put(const InternalLookupResponse& response,
+                      uint64_t generation) {
+  if (options_.max_entries <= 0) {
+    return;
+  }
+  const absl::Time expiry = absl::Now() + options_.ttl;
+  absl::MutexLock lock(&mutex_);
+  if (generation != generation_) {
+    return;
+  }
+  for (const auto& [key, result] : response.kv_pairs()) {
+    if (!IsCacheable(result)) {
+      continue;
+    }
+    if (const auto it = entries_.find(key); it != entries_.end()) {
+      it->second.result = result;
+      it->second.expiry = expiry;
+      lru_.splice(lru_.begin(), lru_, it->second.lru_position);
+      continue;
+    }
+    if (entries_.size() >= static_cast<size_t>(options_.max_entries)) {
+      entries_.erase(lru_.back());
+      lru_.pop_back();
+    }
+    lru_.push_front(key);
+    entries_.emplace(key, Entry{.result = result,
+                                .expiry = expiry,
+                                .lru_position = lru_.begin()});
+  }
+}
+
+void LookupCache::Invalidate(absl::Span<const std::string_view> keys) {
+  absl::MutexLock lock(&mutex_);
+  ++generation_;
+  for (const std::string_view key : keys) {
+    if (const auto it = entries_.find(key); it != entries_.end()) {
+      lru_.erase(it->second.lru_position);
+      entries_.erase(it);
+    }
+  }
+}
+
+int64_t LookupCache::size() const {
+  absl::MutexLock lock(&mutex_);
+  return entries_.size();
+}
+
+std::unique_ptr<Lookup> CreateCachingLookup(std::unique_ptr<Lookup> lookup,
+                                            LookupCache& cache) {
+  return std::make_unique<CachingLookup>(std::move(lookup), cache);
+}
+
+}  // namespace kv_server
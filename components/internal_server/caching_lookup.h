@@ -0,0 +1,94 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef COMPONENTS_INTERNAL_SERVER_CACHING_LOOKUP_H_
+#define COMPONENTS_INTERNAL_SERVER_CACHING_LOOKUP_H_
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+#include "components/internal_server/lookup.h"
+
+namespace kv_server {
+
+struct LookupCacheOptions {
+  // Most keys kept, evicting the least recently used. Zero disables caching.
+  int32_t max_entries = 0;
+  // Time a result is served for after it was looked up.
+  absl::Duration ttl = absl::Seconds(1);
+};
+
+// Bounded cache of the results of key lookups, shared by the lookups of the
+// UDF hooks. Results are dropped once older than `ttl`, or when the data
+// loading reports a mutation of their key. Thread-safe.
+class LookupCache {
+ public:
+  explicit LookupCache(LookupCacheOptions options) : options_(options) {}
+
+  // Adds the cached result of every key of `keys` to `response`, and every
+  // other key to `misses`. Returns the generation to pass to `Put` with the
+  // results of the misses.
+  uint64_t Get(const absl::flat_hash_set<std::string_view>& keys,
+               InternalLookupResponse& response,
+               absl::flat_hash_set<std::string_view>& misses);
+
+  // Caches the values and the not found results of `response`, unless keys
+  // were invalidated since `generation` was returned by `Get`, in which case
+  // the results may predate the invalidation.
+  void Put(const InternalLookupResponse& response, uint64_t generation);
+
+  // Drops the results of `keys`.
+  void Invalidate(absl::Span<const std::string_view> keys);
+
+  int64_t size() const;
+
+ private:
+  struct Entry {
+    SingleLookupResult result;
+    absl::Time expiry;
+    // Position of the key in `lru_`.
+    std::list<std::string>::iterator lru_position;
+  };
+
+  const LookupCacheOptions options_;
+  mutable absl::Mutex mutex_;
+  absl::flat_hash_map<std::string, Entry> entries_ ABSL_GUARDED_BY(mutex_);
+  // Keys of `entries_`, most recently used first.
+  std::list<std::string> lru_ ABSL_GUARDED_BY(mutex_);
+  // Incremented on every invalidation.
+  uint64_t generation_ ABSL_GUARDED_BY(mutex_) = 0;
+};
+
+// Serves `GetKeyValues` calls from `cache`, and looks up the keys missing
+// from it with `lookup`. Meant to wrap the sharded lookup, so that frequently
+// requested keys of other shards are not sent to them on every request. Key
+// sets and queries are passed through. `cache` must outlive the returned
+// lookup.
+std::unique_ptr<Lookup> CreateCachingLookup(std::unique_ptr<Lookup> lookup,
+                                            LookupCache& cache);
+
+}  // namespace kv_server
+
+#endif  // COMPONENTS_INTERNAL_SERVER_CACHING_LOOKUP_H_
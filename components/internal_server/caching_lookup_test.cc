@@ -0,0 +1,226 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/internal_server/caching_lookup.h"
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "components/internal_server/mocks.h"
+#include "gmock/gmock.h"
+#include "google/protobuf/text_format.h"
+#include "gtest/gtest.h"
+#include "public/test_util/proto_matcher.h"
+
+namespace kv_server {
+namespace {
+
+using google::protobuf::TextFormat;
+using testing::_;
+using testing::Return;
+using testing::UnorderedElementsAre;
+
+InternalLookupResponse ParseResponse(std::string_view text) {
+  InternalLookupResponse response;
+  TextFormat::ParseFromString(std::string(text), &response);
+  return response;
+}
+
+class CachingLookupTest : public ::testing::Test {
+ protected:
+  CachingLookupTest() {
+    InitMetricsContextMap();
+    scope_metrics_context_ = std::make_unique<ScopeMetricsContext>();
+    request_context_ =
+        std::make_unique<RequestContext>(*scope_metrics_context_);
+  }
+
+  std::unique_ptr<Lookup> CreateLookup(LookupCache& cache) {
+    auto mock_lookup = std::make_unique<MockLookup>();
+    mock_lookup_ = mock_lookup.get();
+    return CreateCachingLookup(std::move(mock_lookup), cache);
+  }
+
+  RequestContext& GetRequestContext() { return *request_context_; }
+  std::unique_ptr<ScopeMetricsContext> scope_metrics_context_;
+  std::unique_ptr<RequestContext> request_context_;
+  MockLookup* mock_lookup_ = nullptr;
+};
+
+TEST_F(CachingLookupTest, CachesValuesAndNotFoundResults) {
+  LookupCache cache({.max_entries = 10, .ttl = absl::Hours(1)});
+  auto lookup = CreateLookup(cache);
+  const auto response = ParseResponse(R"pb(kv_pairs {
+                                             key: "key1"
+                                             value { value: "value1" }
+                                           }
+                                           kv_pairs {
+                                             key: "key2"
+                                             value { status { code: 5 } }
+                                           })pb");
+  EXPECT_CALL(*mock_lookup_,
+              GetKeyValues(_, UnorderedElementsAre("key1", "key2")))
+      .WillOnce(Return(response));
+
+  auto first = lookup->GetKeyValues(GetRequestContext(), {"key1", "key2"});
+  ASSERT_TRUE(first.ok()) << first.status();
+  EXPECT_THAT(*first, EqualsProto(response));
+  auto second = lookup->GetKeyValues(GetRequestContext(), {"key1", "key2"});
+  ASSERT_TRUE(second.ok()) << second.status();
+  EXPECT_THAT(*second, EqualsProto(response));
+  EXPECT_EQ(cache.size(), 2);
+}
+
+TEST_F(CachingLookupTest, LooksUpOnlyMissingKeys) {
+  LookupCache cache({.max_entries = 10, .ttl = absl::Hours(1)});
+  auto lookup = CreateLookup(cache);
+  EXPECT_CALL(*mock_lookup_, GetKeyValues(_, UnorderedElementsAre("key1")))
+      .WillOnce(Return(ParseResponse(
+          R"pb(kv_pairs {
+                 key: "key1"
+                 value { value: "value1" }
+               })pb")));
+  EXPECT_CALL(*mock_lookup_, GetKeyValues(_, UnorderedElementsAre("key2")))
+      .WillOnce(Return(ParseResponse(
+          R"pb(kv_pairs {
+                 key: "key2"
+                 value { value: "value2" }
+               })pb")));
+
+  ASSERT_TRUE(lookup->GetKeyValues(GetRequestContext(), {"key1"}).ok());
+  auto response = lookup->GetKeyValues(GetRequestContext(), {"key1", "key2"});
+  ASSERT_TRUE(response.ok()) << response.status();
+  EXPECT_THAT(*response, EqualsProto(ParseResponse(
+                             R"pb(kv_pairs {
+                                    key: "key1"
+                                    value { value: "value1" }
+                                  }
+                                  kv_pairs {
+                                    key: "key2"
+                                    value { value: "value2" }
+                                  })pb")));
+}
+
+TEST_F(CachingLookupTest, DoesNotCacheErrors) {
+  LookupCache cache({.max_entries = 10, .ttl = absl::Hours(1)});
+  auto lookup = CreateLookup(cache);
+  EXPECT_CALL(*mock_lookup_, GetKeyValues(_, UnorderedElementsAre("key1")))
+      .Times(2)
+      .WillRepeatedly(Return(ParseResponse(
+          R"pb(kv_pairs {
+                 key: "key1"
+                 value { status { code: 13 } }
+               })pb")));
+
+  ASSERT_TRUE(lookup->GetKeyValues(GetRequestContext(), {"key1"}).ok());
+  ASSERT_TRUE(lookup->GetKeyValues(GetRequestContext(), {"key1"}).ok());
+  EXPECT_EQ(cache.size(), 0);
+}
+
+TEST_F(CachingLookupTest, LooksUpInvalidatedKeysAgain) {
+  LookupCache cache({.max_entries = 10, .ttl = absl::Hours(1)});
+  auto lookup = CreateLookup(cache);
+  EXPECT_CALL(*mock_lookup_, GetKeyValues(_, UnorderedElementsAre("key1")))
+      .Times(2)
+      .WillRepeatedly(Return(ParseResponse(
+          R"pb(kv_pairs {
+                 key: "key1"
+                 value { value: "value1" }
+               })pb")));
+
+  ASSERT_TRUE(lookup->GetKeyValues(GetRequestContext(), {"key1"}).ok());
+  const std::string_view invalidated[] = {"key1"};
+  cache.Invalidate(invalidated);
+  ASSERT_TRUE(lookup->GetKeyValues(GetRequestContext(), {"key1"}).ok());
+}
+
+TEST_F(CachingLookupTest, LooksUpExpiredKeysAgain) {
+  LookupCache cache({.max_entries = 10, .ttl = absl::Milliseconds(1)});
+  auto lookup = CreateLookup(cache);
+  EXPECT_CALL(*mock_lookup_, GetKeyValues(_, UnorderedElementsAre("key1")))
+      .Times(2)
+      .WillRepeatedly(Return(ParseResponse(
+          R"pb(kv_pairs {
+                 key: "key1"
+                 value { value: "value1" }
+               })pb")));
+
+  ASSERT_TRUE(lookup->GetKeyValues(GetRequestContext(), {"key1"}).ok());
+  absl::SleepFor(absl::Milliseconds(10));
+  ASSERT_TRUE(lookup->GetKeyValues(GetRequestContext(), {"key1"}).ok());
+}
+
+TEST(LookupCacheTest, EvictsLeastRecentlyUsedKeys) {
+  LookupCache cache({.max_entries = 2, .ttl = absl::Hours(1)});
+  InternalLookupResponse response;
+  absl::flat_hash_set<std::string_view> misses;
+  const uint64_t generation = cache.Get({"key1"}, response, misses);
+  cache.Put(ParseResponse(R"pb(kv_pairs {
+                                 key: "key1"
+                                 value { value: "value1" }
+                               }
+                               kv_pairs {
+                                 key: "key2"
+                                 value { value: "value2" }
+                               })pb"),
+            generation);
+  // Uses key1, so that key2 is the least recently used.
+  cache.Get({"key1"}, response, misses);
+  cache.Put(ParseResponse(R"pb(kv_pairs {
+                                 key: "key3"
+                                 value { value: "value3" }
+                               })pb"),
+            generation);
+
+  response.Clear();
+  misses.clear();
+  cache.Get({"key1", "key2", "key3"}, response, misses);
+  EXPECT_EQ(cache.size(), 2);
+  EXPECT_THAT(misses, UnorderedElementsAre("key2"));
+}
+
+TEST(LookupCacheTest, DropsResultsLookedUpBeforeAnInvalidation) {
+  LookupCache cache({.max_entries = 10, .ttl = absl::Hours(1)});
+  InternalLookupResponse response;
+  absl::flat_hash_set<std::string_view> misses;
+  const uint64_t generation = cache.Get({"key1"}, response, misses);
+  const std::string_view invalidated[] = {"key1"};
+  cache.Invalidate(invalidated);
+  cache.Put(ParseResponse(R"pb(kv_pairs {
+                                 key: "key1"
+                                 value { value: "value1" }
+                               })pb"),
+            generation);
+  EXPECT_EQ(cache.size(), 0);
+}
+
+TEST(LookupCacheTest, ZeroMaxEntriesDisablesCaching) {
+  LookupCache cache({.max_entries = 0});
+  InternalLookupResponse response;
+  absl::flat_hash_set<std::string_view> misses;
+  const uint64_t generation = cache.Get({"key1"}, response, misses);
+  cache.Put(ParseResponse(R"pb(kv_pairs {
+                                 key: "key1"
+                                 value { value: "value1" }
+                               })pb"),
+            generation);
+  EXPECT_EQ(cache.size(), 0);
+}
+
+}  // namespace
+}  // namespace kv_server
@@ -0,0 +1,288 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/internal_server/compact_lookup_result.h"
+
+#include <algorithm>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/status/status.h"
+
+namespace kv_server {
+namespace {
+
+// Version and number of results. The offsets of a response are 32 bits, which
+// is far more than the size of the gRPC messages they are sent in.
+constexpr size_t kHeaderSize = 1 + sizeof(uint32_t);
+
+void AppendUInt32(uint32_t value, std::string& out) {
+  for (int i = 0; i < 4; i++) {
+    out.push_back(static_cast<char>((value >> (8 * i)) & 0xff));
+  }
+}
+
+uint32_t ReadUInt32(std::string_view data, size_t offset) {
+  uint32_t value = 0;
+  for (int i = 0; i < 4; i++) {
+    value |= static_cast<uint32_t>(static_cast<uint8_t>(data[offset + i]))
+             << (8 * i);
+  }
+  return value;
+}
+
+size_t BitmapSize(uint64_t num_results) { return (num_results + 7) / 8; }
+
+bool BitIsSet(std::string_view bitmap, size_t i) {
+  return (static_cast<uint8_t>(bitmap[i / 8]) >> (i % 8)) & 1;
+}
+
+// Returns whether `offsets`, which are `num_offsets` 32 bit offsets starting at
+// `start` of `data`, start at 0, never decrease and end at `end`.
+bool ValidOffsets(std::string_view data, size_t start, size_t num_offsets,
+                  uint64_t end) {
+  uint32_t previous = 0;
+  for (size_t i = 0; i < num_offsets; i++) {
+    const uint32_t offset = ReadUInt32(data, start + i * sizeof(uint32_t));
+    if ((i == 0 && offset != 0) || offset < previous) {
+      return false;
+    }
+    previous = offset;
+  }
+  return previous == end;
+}
+
+// Returns whether `result` holds a number of key set values, their offsets and
+// the values.
+bool ValidKeysetValues(std::string_view result) {
+  if (result.size() < sizeof(uint32_t)) {
+    return false;
+  }
+  const uint64_t num_values = ReadUInt32(result, 0);
+  const uint64_t values_start = (num_values + 2) * sizeof(uint32_t);
+  if (values_start > result.size()) {
+    return false;
+  }
+  return ValidOffsets(result, sizeof(uint32_t), num_values + 1,
+                      result.size() - values_start);
+}
+
+}  // namespace
+
+std::string CompactLookupResult::Encode(
+    const google::protobuf::Map<std::string, SingleLookupResult>& kv_pairs) {
+  std::vector<std::pair<std::string_view, const SingleLookupResult*>> sorted;
+  sorted.reserve(kv_pairs.size());
+  for (const auto& [key, result] : kv_pairs) {
+    sorted.emplace_back(key, &result);
+  }
+  std::sort(sorted.begin(), sorted.end(),
+            [](const auto& a, const auto& b) { return a.first < b.first; });
+  const size_t num_results = sorted.size();
+  std::string keys;
+  std::string results;
+  std::string key_offsets;
+  std::string result_offsets;
+  std::string status_bitmap(BitmapSize(num_results), '\0');
+  std::string keyset_bitmap(BitmapSize(num_results), '\0');
+  AppendUInt32(0, key_offsets);
+  AppendUInt32(0, result_offsets);
+  for (size_t i = 0; i < num_results; i++) {
+    const auto& [key, result] = sorted[i];
+    keys.append(key);
+    switch (result->single_lookup_result_case()) {
+      case SingleLookupResult::kValue:
+        results.append(result->value());
+        break;
+      case SingleLookupResult::kStatus:
+        status_bitmap[i / 8] |= 1 << (i % 8);
+        AppendUInt32(result->status().code(), results);
+        results.append(result->status().message());
+        break;
+      case SingleLookupResult::kKeysetValues: {
+        keyset_bitmap[i / 8] |= 1 << (i % 8);
+        const auto& values = result->keyset_values().values();
+        AppendUInt32(values.size(), results);
+        uint32_t offset = 0;
+        AppendUInt32(offset, results);
+        for (const auto& value : values) {
+          offset += value.size();
+          AppendUInt32(offset, results);
+        }
+        for (const auto& value : values) {
+          results.append(value);
+        }
+        break;
+      }
+      default:
+        // Results that are not set are encoded as empty values.
+        break;
+    }
+    AppendUInt32(keys.size(), key_offsets);
+    AppendUInt32(results.size(), result_offsets);
+  }
+  std::string data;
+  data.reserve(kHeaderSize + key_offsets.size() + result_offsets.size() +
+               2 * status_bitmap.size() + keys.size() + results.size());
+  data.push_back(static_cast<char>(kVersion));
+  AppendUInt32(num_results, data);
+  data.append(key_offsets);
+  data.append(result_offsets);
+  data.append(status_bitmap);
+  data.append(keyset_bitmap);
+  data.append(keys);
+  data.append(results);
+  return data;
+}
+
+absl::StatusOr<CompactLookupResult> CompactLookupResult::Parse(
+    std::string_view data) {
+  if (data.size() < kHeaderSize) {
+    return absl::InvalidArgumentError("Compact lookup result is truncated");
+  }
+  if (static_cast<uint8_t>(data[0]) != kVersion) {
+    return absl::InvalidArgumentError(
+        "Unsupported version of compact lookup result");
+  }
+  const uint32_t num_results = ReadUInt32(data, 1);
+  const uint64_t offsets_size =
+      (static_cast<uint64_t>(num_results) + 1) * sizeof(uint32_t);
+  const uint64_t fixed_size =
+      kHeaderSize + 2 * offsets_size + 2 * BitmapSize(num_results);
+  if (fixed_size > data.size()) {
+    return absl::InvalidArgumentError("Compact lookup result is truncated");
+  }
+  // The last offsets are the sizes of the keys and of the results.
+  const uint64_t keys_size =
+      ReadUInt32(data, kHeaderSize + offsets_size - sizeof(uint32_t));
+  const uint64_t results_size =
+      ReadUInt32(data, kHeaderSize + 2 * offsets_size - sizeof(uint32_t));
+  if (fixed_size + keys_size + results_size != data.size() ||
+      !ValidOffsets(data, kHeaderSize, num_results + 1, keys_size) ||
+      !ValidOffsets(data, kHeaderSize + offsets_size, num_results + 1,
+                    results_size)) {
+    return absl::InvalidArgumentError(
+        "Invalid offsets in compact lookup result");
+  }
+  CompactLookupResult result(data, num_results);
+  for (size_t i = 0; i < num_results; i++) {
+    if (i > 0 && result.key(i - 1) >= result.key(i)) {
+      return absl::InvalidArgumentError(
+          "Keys of compact lookup result are not sorted");
+    }
+    if (result.IsStatus(i) && result.IsKeysetValues(i)) {
+      return absl::InvalidArgumentError(
+          "Result of compact lookup result has several types");
+    }
+    if ((result.IsStatus(i) &&
+         result.RawResult(i).size() < sizeof(uint32_t)) ||
+        (result.IsKeysetValues(i) && !ValidKeysetValues(result.RawResult(i)))) {
+      return absl::InvalidArgumentError(
+          "Invalid result in compact lookup result");
+    }
+  }
+  return result;
+}
+
+std::string_view CompactLookupResult::key(size_t i) const {
+  return Keys().substr(KeyOffset(i), KeyOffset(i + 1) - KeyOffset(i));
+}
+
+std::optional<size_t> CompactLookupResult::Find(std::string_view key) const {
+  size_t low = 0;
+  size_t high = num_results_;
+  while (low < high) {
+    const size_t mid = low + (high - low) / 2;
+    if (this->key(mid) < key) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  if (low < num_results_ && this->key(low) == key) {
+    return low;
+  }
+  return std::nullopt;
+}
+
+bool CompactLookupResult::IsStatus(size_t i) const {
+  const size_t offset =
+      kHeaderSize + 2 * (num_results_ + 1) * sizeof(uint32_t);
+  return BitIsSet(data_.substr(offset), i);
+}
+
+bool CompactLookupResult::IsKeysetValues(size_t i) const {
+  const size_t offset = kHeaderSize +
+                        2 * (num_results_ + 1) * sizeof(uint32_t) +
+                        BitmapSize(num_results_);
+  return BitIsSet(data_.substr(offset), i);
+}
+
+SingleLookupResult CompactLookupResult::Result(size_t i) const {
+  SingleLookupResult result;
+  const std::string_view raw = RawResult(i);
+  if (IsStatus(i)) {
+    auto* status = result.mutable_status();
+    status->set_code(static_cast<int32_t>(ReadUInt32(raw, 0)));
+    status->set_message(std::string(raw.substr(sizeof(uint32_t))));
+  } else if (IsKeysetValues(i)) {
+    auto* values = result.mutable_keyset_values()->mutable_values();
+    values->Reserve(ReadUInt32(raw, 0));
+    ForEachKeysetValue(i, [values](std::string_view value) {
+      values->Add(std::string(value));
+    });
+  } else {
+    result.set_value(std::string(raw));
+  }
+  return result;
+}
+
+void CompactLookupResult::ForEachKeysetValue(
+    size_t i, absl::FunctionRef<void(std::string_view value)> fn) const {
+  const std::string_view raw = RawResult(i);
+  const uint32_t num_values = ReadUInt32(raw, 0);
+  const size_t values_start = (num_values + 2) * sizeof(uint32_t);
+  uint32_t start = 0;
+  for (uint32_t j = 1; j <= num_values; j++) {
+    const uint32_t end = ReadUInt32(raw, (j + 1) * sizeof(uint32_t));
+    fn(raw.substr(values_start + start, end - start));
+    start = end;
+  }
+}
+
+uint32_t CompactLookupResult::KeyOffset(size_t i) const {
+  return ReadUInt32(data_, kHeaderSize + i * sizeof(uint32_t));
+}
+
+uint32_t CompactLookupResult::ResultOffset(size_t i) const {
+  return ReadUInt32(
+      data_, kHeaderSize + (num_results_ + 1 + i) * sizeof(uint32_t));
+}
+
+std::string_view CompactLookupResult::RawResult(size_t i) const {
+  return Results().substr(ResultOffset(i),
+                          ResultOffset(i + 1) - ResultOffset(i));
+}
+
+std::string_view CompactLookupResult::Keys() const {
+  return data_.substr(kHeaderSize + 2 * (num_results_ + 1) * sizeof(uint32_t) +
+                      2 * BitmapSize(num_results_));
+}
+
+std::string_view CompactLookupResult::Results() const {
+  return Keys().substr(KeyOffset(num_results_));
+}
+
+}  // namespace kv_server
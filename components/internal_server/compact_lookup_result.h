@@ -0,0 +1,94 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef COMPONENTS_INTERNAL_SERVER_COMPACT_LOOKUP_RESULT_H_
+#define COMPONENTS_INTERNAL_SERVER_COMPACT_LOOKUP_RESULT_H_
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "absl/functional/function_ref.h"
+#include "absl/status/statusor.h"
+#include "components/internal_server/lookup.pb.h"
+#include "google/protobuf/map.h"
+
+namespace kv_server {
+
+// Results of the keys of a lookup in the layout of
+// `LOOKUP_RESULT_FORMAT_COMPACT_V1`, which shards send instead of the
+// `kv_pairs` map of `InternalLookupResponse` when the request asks for it.
+// Unlike the map, the layout is checked without allocating, and each result is
+// only decoded when it is read, with the values of key sets read as views of
+// the data.
+//
+// All integers are 32 bit little endian. The layout is
+//   version          1 byte, 1
+//   num_results
+//   key_offsets      num_results + 1 offsets of the keys in `keys`
+//   result_offsets   num_results + 1 offsets of the results in `results`
+//   status_bitmap    (num_results + 7) / 8 bytes, bit `i % 8` of byte `i / 8`
+//                    is set if result `i` is a status
+//   keyset_bitmap    same, for results that are key set values
+//   keys             the keys in ascending order, concatenated
+//   results          the results, concatenated
+// A value is stored as is, a status as its code followed by its message, and
+// key set values as their number, number + 1 offsets from the end of the
+// offsets, and the values concatenated.
+class CompactLookupResult {
+ public:
+  static constexpr uint8_t kVersion = 1;
+
+  // Encodes `kv_pairs`. Results that are statuses lose their details.
+  static std::string Encode(
+      const google::protobuf::Map<std::string, SingleLookupResult>& kv_pairs);
+
+  // Returns an error if `data` is not in the layout above. `data` must outlive
+  // the result.
+  static absl::StatusOr<CompactLookupResult> Parse(std::string_view data);
+
+  size_t size() const { return num_results_; }
+  std::string_view key(size_t i) const;
+  // Returns the index of the result of `key`, if any.
+  std::optional<size_t> Find(std::string_view key) const;
+
+  bool IsStatus(size_t i) const;
+  bool IsKeysetValues(size_t i) const;
+  // Decodes result `i`.
+  SingleLookupResult Result(size_t i) const;
+  // Calls `fn` with each value of result `i`, which must be key set values,
+  // as views of the data.
+  void ForEachKeysetValue(
+      size_t i, absl::FunctionRef<void(std::string_view value)> fn) const;
+
+ private:
+  CompactLookupResult(std::string_view data, uint32_t num_results)
+      : data_(data), num_results_(num_results) {}
+
+  uint32_t KeyOffset(size_t i) const;
+  uint32_t ResultOffset(size_t i) const;
+  std::string_view RawResult(size_t i) const;
+  std::string_view Keys() const;
+  std::string_view Results() const;
+
+  std::string_view data_;
+  uint32_t num_results_;
+};
+
+}  // namespace kv_server
+
+#endif  // COMPONENTS_INTERNAL_SERVER_COMPACT_LOOKUP_RESULT_H_
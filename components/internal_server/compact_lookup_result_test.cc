@@ -0,0 +1,163 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/internal_server/compact_lookup_result.h"
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "gmock/gmock.h"
+#include "google/protobuf/text_format.h"
+#include "gtest/gtest.h"
+#include "public/test_util/proto_matcher.h"
+
+namespace kv_server {
+namespace {
+
+using google::protobuf::TextFormat;
+
+InternalLookupResponse TestResponse() {
+  InternalLookupResponse response;
+  TextFormat::ParseFromString(
+      R"pb(kv_pairs {
+             key: "key2"
+             value { value: "value2" }
+           }
+           kv_pairs {
+             key: "key1"
+             value { status { code: 5 message: "Key not found" } }
+           }
+           kv_pairs {
+             key: "key3"
+             value { keyset_values { values: "a" values: "" values: "bc" } }
+           }
+           kv_pairs {
+             key: "key4"
+             value { keyset_values {} }
+           }
+           kv_pairs {
+             key: ""
+             value { value: "" }
+           })pb",
+      &response);
+  return response;
+}
+
+TEST(CompactLookupResultTest, RoundTrip) {
+  const InternalLookupResponse response = TestResponse();
+  const std::string data = CompactLookupResult::Encode(response.kv_pairs());
+  const auto result = CompactLookupResult::Parse(data);
+  ASSERT_TRUE(result.ok()) << result.status();
+  ASSERT_EQ(result->size(), response.kv_pairs().size());
+  for (size_t i = 0; i < result->size(); i++) {
+    const std::string key(result->key(i));
+    ASSERT_TRUE(response.kv_pairs().contains(key)) << key;
+    EXPECT_THAT(result->Result(i), EqualsProto(response.kv_pairs().at(key)));
+  }
+}
+
+TEST(CompactLookupResultTest, KeysAreSorted) {
+  const InternalLookupResponse response = TestResponse();
+  const std::string data = CompactLookupResult::Encode(response.kv_pairs());
+  const auto result = CompactLookupResult::Parse(data);
+  ASSERT_TRUE(result.ok()) << result.status();
+  std::vector<std::string_view> keys;
+  for (size_t i = 0; i < result->size(); i++) {
+    keys.push_back(result->key(i));
+  }
+  EXPECT_THAT(keys, testing::ElementsAre("", "key1", "key2", "key3", "key4"));
+}
+
+TEST(CompactLookupResultTest, Find) {
+  const InternalLookupResponse response = TestResponse();
+  const std::string data = CompactLookupResult::Encode(response.kv_pairs());
+  const auto result = CompactLookupResult::Parse(data);
+  ASSERT_TRUE(result.ok()) << result.status();
+  for (std::string_view key : {"", "key1", "key2", "key3", "key4"}) {
+    const auto i = result->Find(key);
+    ASSERT_TRUE(i.has_value()) << key;
+    EXPECT_EQ(result->key(*i), key);
+  }
+  EXPECT_FALSE(result->Find("key0").has_value());
+  EXPECT_FALSE(result->Find("key5").has_value());
+}
+
+TEST(CompactLookupResultTest, ResultTypes) {
+  const InternalLookupResponse response = TestResponse();
+  const std::string data = CompactLookupResult::Encode(response.kv_pairs());
+  const auto result = CompactLookupResult::Parse(data);
+  ASSERT_TRUE(result.ok()) << result.status();
+  const size_t status = *result->Find("key1");
+  EXPECT_TRUE(result->IsStatus(status));
+  EXPECT_FALSE(result->IsKeysetValues(status));
+  const size_t value = *result->Find("key2");
+  EXPECT_FALSE(result->IsStatus(value));
+  EXPECT_FALSE(result->IsKeysetValues(value));
+  const size_t keyset_values = *result->Find("key3");
+  EXPECT_FALSE(result->IsStatus(keyset_values));
+  EXPECT_TRUE(result->IsKeysetValues(keyset_values));
+  std::vector<std::string_view> values;
+  result->ForEachKeysetValue(keyset_values, [&values](std::string_view value) {
+    values.push_back(value);
+  });
+  EXPECT_THAT(values, testing::ElementsAre("a", "", "bc"));
+}
+
+TEST(CompactLookupResultTest, Empty) {
+  const std::string data = CompactLookupResult::Encode({});
+  const auto result = CompactLookupResult::Parse(data);
+  ASSERT_TRUE(result.ok()) << result.status();
+  EXPECT_EQ(result->size(), 0);
+  EXPECT_FALSE(result->Find("key").has_value());
+}
+
+TEST(CompactLookupResultTest, TruncatedDataIsInvalid) {
+  const InternalLookupResponse response = TestResponse();
+  const std::string data = CompactLookupResult::Encode(response.kv_pairs());
+  for (size_t size = 0; size < data.size(); size++) {
+    EXPECT_FALSE(
+        CompactLookupResult::Parse(std::string_view(data).substr(0, size))
+            .ok())
+        << size;
+  }
+}
+
+TEST(CompactLookupResultTest, CorruptedDataIsInvalidOrReadable) {
+  const InternalLookupResponse response = TestResponse();
+  const std::string data = CompactLookupResult::Encode(response.kv_pairs());
+  for (size_t i = 0; i < data.size(); i++) {
+    std::string corrupted = data;
+    corrupted[i] ^= 0x41;
+    const auto result = CompactLookupResult::Parse(corrupted);
+    if (!result.ok()) {
+      continue;
+    }
+    // Results that pass the checks are read without going out of bounds.
+    for (size_t j = 0; j < result->size(); j++) {
+      result->Result(j);
+    }
+  }
+}
+
+TEST(CompactLookupResultTest, UnknownVersionIsInvalid) {
+  std::string data = CompactLookupResult::Encode({});
+  data[0] = CompactLookupResult::kVersion + 1;
+  EXPECT_EQ(CompactLookupResult::Parse(data).status().code(),
+            absl::StatusCode::kInvalidArgument);
+}
+
+}  // namespace
+}  // namespace kv_server
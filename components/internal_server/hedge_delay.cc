@@ -0,0 +1,52 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/internal_server/hedge_delay.h"
+
+#include <algorithm>
+
+#include "absl/log/check.h"
+
+namespace kv_server {
+
+HedgeDelay::HedgeDelay(int32_t percentile, absl::Duration initial_delay,
+                       int64_t window_size)
+    : percentile_(percentile),
+      window_size_(window_size),
+      delay_micros_(absl::ToInt64Microseconds(initial_delay)) {
+  CHECK(percentile > 0 && percentile < 100)
+      << "Hedging percentile must be in (0, 100)";
+  CHECK_GT(window_size, 0);
+  latencies_micros_.reserve(window_size);
+}
+
+void HedgeDelay::Record(absl::Duration latency) {
+  absl::MutexLock lock(&mutex_);
+  latencies_micros_.push_back(absl::ToInt64Microseconds(latency));
+  if (static_cast<int64_t>(latencies_micros_.size()) < window_size_) {
+    return;
+  }
+  // Windows don't overlap, so that the selection takes amortized constant
+  // time per recorded latency.
+  auto nth = latencies_micros_.begin() + window_size_ * percentile_ / 100;
+  std::nth_element(latencies_micros_.begin(), nth, latencies_micros_.end());
+  delay_micros_.store(*nth, std::memory_order_relaxed);
+  latencies_micros_.clear();
+}
+
+absl::Duration HedgeDelay::Get() const {
+  return absl::Microseconds(delay_micros_.load(std::memory_order_relaxed));
+}
+
+}  // namespace kv_server
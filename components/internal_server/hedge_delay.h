@@ -0,0 +1,57 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef COMPONENTS_INTERNAL_SERVER_HEDGE_DELAY_H_
+#define COMPONENTS_INTERNAL_SERVER_HEDGE_DELAY_H_
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+
+namespace kv_server {
+
+// Tracks how long a remote lookup waits before it is hedged, i.e. also sent to
+// another replica of its shard. The delay is the `percentile` of the
+// latencies of the last `window_size` recorded lookups, so that only the
+// slowest lookups are hedged. Until `window_size` latencies are recorded, the
+// delay is `initial_delay`. Safe to use from multiple threads.
+class HedgeDelay {
+ public:
+  static constexpr int64_t kDefaultWindowSize = 1024;
+
+  // `percentile` must be in (0, 100).
+  HedgeDelay(int32_t percentile, absl::Duration initial_delay,
+             int64_t window_size = kDefaultWindowSize);
+
+  void Record(absl::Duration latency) ABSL_LOCKS_EXCLUDED(mutex_);
+
+  absl::Duration Get() const;
+
+ private:
+  const int32_t percentile_;
+  const int64_t window_size_;
+  std::atomic<int64_t> delay_micros_;
+  absl::Mutex mutex_;
+  std::vector<int64_t> latencies_micros_ ABSL_GUARDED_BY(mutex_);
+};
+
+}  // namespace kv_server
+
+#endif  // COMPONENTS_INTERNAL_SERVER_HEDGE_DELAY_H_
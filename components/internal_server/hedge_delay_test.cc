@@ -0,0 +1,52 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/internal_server/hedge_delay.h"
+
+#include "gtest/gtest.h"
+
+namespace kv_server {
+namespace {
+
+TEST(HedgeDelayTest, InitialDelay) {
+  HedgeDelay hedge_delay(95, absl::Milliseconds(10), 100);
+  EXPECT_EQ(hedge_delay.Get(), absl::Milliseconds(10));
+  for (int i = 0; i < 99; i++) {
+    hedge_delay.Record(absl::Milliseconds(1));
+  }
+  EXPECT_EQ(hedge_delay.Get(), absl::Milliseconds(10));
+}
+
+TEST(HedgeDelayTest, PercentileOfWindow) {
+  HedgeDelay hedge_delay(95, absl::Milliseconds(10), 100);
+  for (int i = 100; i > 0; i--) {
+    hedge_delay.Record(absl::Microseconds(i));
+  }
+  EXPECT_EQ(hedge_delay.Get(), absl::Microseconds(96));
+}
+
+TEST(HedgeDelayTest, UsesLatestWindow) {
+  HedgeDelay hedge_delay(50, absl::Milliseconds(10), 10);
+  for (int i = 0; i < 10; i++) {
+    hedge_delay.Record(absl::Milliseconds(100));
+  }
+  EXPECT_EQ(hedge_delay.Get(), absl::Milliseconds(100));
+  for (int i = 0; i < 10; i++) {
+    hedge_delay.Record(absl::Milliseconds(1));
+  }
+  EXPECT_EQ(hedge_delay.Get(), absl::Milliseconds(1));
+}
+
+}  // namespace
+}  // namespace kv_server
@@ -0,0 +1,92 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/internal_server/key_filter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <utility>
+
+#include "absl/status/status.h"
+
+namespace kv_server {
+namespace {
+
+// More probes per key cost more than they save in false positives.
+constexpr uint32_t kMaxNumHashes = 16;
+
+// Calls `f` with the `num_hashes` bit positions of the key with `hash`, by
+// double hashing. `num_bits` must be positive.
+template <typename F>
+void ForEachBit(uint64_t hash, uint32_t num_hashes, uint64_t num_bits, F f) {
+  const uint64_t delta = (hash >> 33) | (hash << 31) | 1;
+  for (uint32_t i = 0; i < num_hashes; i++) {
+    f(hash % num_bits);
+    hash += delta;
+  }
+}
+
+}  // namespace
+
+uint64_t KeyFilter::Hash(std::string_view key) {
+  // FNV-1a, followed by the finalizer of SplitMix64 to spread the bits.
+  uint64_t hash = 0xcbf29ce484222325;
+  for (const unsigned char c : key) {
+    hash = (hash ^ c) * 0x100000001b3;
+  }
+  hash = (hash ^ (hash >> 30)) * 0xbf58476d1ce4e5b9;
+  hash = (hash ^ (hash >> 27)) * 0x94d049bb133111eb;
+  return hash ^ (hash >> 31);
+}
+
+KeyFilter KeyFilter::Build(absl::Span<const uint64_t> key_hashes,
+                           int32_t bits_per_key) {
+  bits_per_key = std::max(bits_per_key, 1);
+  const uint64_t num_bytes =
+      std::max<uint64_t>(8, (key_hashes.size() * bits_per_key + 7) / 8);
+  ShardKeyFilter proto;
+  // ln(2) bits per key set per key minimize the false positives.
+  proto.set_num_hashes(std::clamp<uint32_t>(
+      static_cast<uint32_t>(std::lround(bits_per_key * 0.69)), 1,
+      kMaxNumHashes));
+  std::string& bits = *proto.mutable_bits();
+  bits.assign(num_bytes, '\0');
+  for (const uint64_t hash : key_hashes) {
+    ForEachBit(hash, proto.num_hashes(), num_bytes * 8, [&bits](uint64_t bit) {
+      bits[bit / 8] |= static_cast<char>(1 << (bit % 8));
+    });
+  }
+  return KeyFilter(std::move(proto));
+}
+
+absl::StatusOr<KeyFilter> KeyFilter::FromProto(ShardKeyFilter proto) {
+  if (proto.bits().empty() || proto.num_hashes() == 0 ||
+      proto.num_hashes() > kMaxNumHashes) {
+    return absl::InvalidArgumentError("Invalid key filter");
+  }
+  return KeyFilter(std::move(proto));
+}
+
+bool KeyFilter::MayContain(std::string_view key) const {
+  const std::string& bits = proto_.bits();
+  bool may_contain = true;
+  ForEachBit(Hash(key), proto_.num_hashes(), bits.size() * 8,
+             [&bits, &may_contain](uint64_t bit) {
+               may_contain &= ((bits[bit / 8] >> (bit % 8)) & 1) != 0;
+             });
+  return may_contain;
+}
+
+}  // namespace kv_server
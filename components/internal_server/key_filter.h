@@ -0,0 +1,62 @@
+/*
+ * Copyright 2023 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef COMPONENTS_INTERNAL_SERVER_KEY_FILTER_H_
+#define COMPONENTS_INTERNAL_SERVER_KEY_FILTER_H_
+
+#include <cstdint>
+#include <string_view>
+#include <utility>
+
+#include "absl/status/statusor.h"
+#include "absl/types/span.h"
+#include "components/internal_server/lookup.pb.h"
+
+namespace kv_server {
+
+// Bloom filter of the keys of a shard. `MayContain` is true for every key the
+// filter was built with, and false for most other keys: with 10 bits per key
+// about 1% of the other keys are false positives. Filters are sent between
+// servers as `ShardKeyFilter` protos.
+class KeyFilter {
+ public:
+  // Hash of `key` the filter is built from. Unlike `absl::Hash`, it is the
+  // same in every process, so that filters can be built on one server and
+  // used on another.
+  static uint64_t Hash(std::string_view key);
+
+  // Builds a filter of the keys with `key_hashes`, with `bits_per_key` bits
+  // for every key.
+  static KeyFilter Build(absl::Span<const uint64_t> key_hashes,
+                         int32_t bits_per_key);
+
+  // Returns an error if `proto` is not a valid filter.
+  static absl::StatusOr<KeyFilter> FromProto(ShardKeyFilter proto);
+
+  bool MayContain(std::string_view key) const;
+
+  const ShardKeyFilter& proto() const { return proto_; }
+
+ private:
+  explicit KeyFilter(ShardKeyFilter proto) : proto_(std::move(proto)) {}
+
+  // The bits are kept in the proto, so that it is sent without a copy.
+  ShardKeyFilter proto_;
+};
+
+}  // namespace kv_server
+
+#endif  // COMPONENTS_INTERNAL_SERVER_KEY_FILTER_H_
@@ -0,0 +1,58 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/internal_server/key_filter_publisher.h"
+
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "absl/log/log.h"
+
+namespace kv_server {
+
+absl::Status KeyFilterPublisher::Start(absl::Duration interval) {
+  if (absl::Status status = Rebuild(); !status.ok()) {
+    return status;
+  }
+  return periodic_closure_->StartDelayed(interval, [this] {
+    if (absl::Status status = Rebuild(); !status.ok()) {
+      LOG(ERROR) << "Failed to rebuild the key filter: " << status;
+    }
+  });
+}
+
+absl::Status KeyFilterPublisher::Rebuild() {
+  std::vector<uint64_t> key_hashes;
+  if (absl::Status status = cache_.ForEachKey(
+          [&key_hashes](std::string_view key) {
+            key_hashes.push_back(KeyFilter::Hash(key));
+          });
+      !status.ok()) {
+    return status;
+  }
+  auto filter = std::make_shared<const KeyFilter>(
+      KeyFilter::Build(key_hashes, bits_per_key_));
+  VLOG(2) << "Built key filter of " << key_hashes.size() << " keys";
+  absl::MutexLock lock(&mutex_);
+  filter_ = std::move(filter);
+  return absl::OkStatus();
+}
+
+std::shared_ptr<const KeyFilter> KeyFilterPublisher::Get() const {
+  absl::MutexLock lock(&mutex_);
+  return filter_;
+}
+
+}  // namespace kv_server
@@ -0,0 +1,63 @@
+/*
+ * Copyright 2023 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef COMPONENTS_INTERNAL_SERVER_KEY_FILTER_PUBLISHER_H_
+#define COMPONENTS_INTERNAL_SERVER_KEY_FILTER_PUBLISHER_H_
+
+#include <memory>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/status/status.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "components/data_server/cache/cache.h"
+#include "components/internal_server/key_filter.h"
+#include "components/util/periodic_closure.h"
+
+namespace kv_server {
+
+// Keeps a `KeyFilter` of the keys of the cache of a shard, for the lookup
+// server to send to the other shards. Keys added to the cache after the
+// latest filter was built are missing from it, so `interval` bounds how long
+// they may be reported as not found by the other shards.
+class KeyFilterPublisher {
+ public:
+  KeyFilterPublisher(const Cache& cache, int32_t bits_per_key)
+      : cache_(cache),
+        bits_per_key_(bits_per_key),
+        periodic_closure_(PeriodicClosure::Create()) {}
+
+  // Builds the filter now, and then again every `interval`.
+  absl::Status Start(absl::Duration interval);
+
+  // Builds the filter from the current keys of the cache.
+  absl::Status Rebuild();
+
+  // Returns the latest filter, or null if none was built yet.
+  std::shared_ptr<const KeyFilter> Get() const;
+
+ private:
+  const Cache& cache_;
+  const int32_t bits_per_key_;
+  mutable absl::Mutex mutex_;
+  std::shared_ptr<const KeyFilter> filter_ ABSL_GUARDED_BY(mutex_);
+  // Declared last, so that it is stopped before the other members go away.
+  std::unique_ptr<PeriodicClosure> periodic_closure_;
+};
+
+}  // namespace kv_server
+
+#endif  // COMPONENTS_INTERNAL_SERVER_KEY_FILTER_PUBLISHER_H_
@@ -0,0 +1,58 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/internal_server/key_filter_publisher.h"
+
+#include <memory>
+
+#include "components/data_server/cache/key_value_cache.h"
+#include "components/data_server/cache/mocks.h"
+#include "gtest/gtest.h"
+
+namespace kv_server {
+namespace {
+
+TEST(KeyFilterPublisherTest, NoFilterBeforeFirstBuild) {
+  std::unique_ptr<Cache> cache = KeyValueCache::Create();
+  KeyFilterPublisher publisher(*cache, 10);
+  EXPECT_EQ(publisher.Get(), nullptr);
+}
+
+TEST(KeyFilterPublisherTest, RebuildPicksUpNewKeys) {
+  std::unique_ptr<Cache> cache = KeyValueCache::Create();
+  cache->UpdateKeyValue("key1", "value1", 1);
+  KeyFilterPublisher publisher(*cache, 10);
+  ASSERT_TRUE(publisher.Rebuild().ok());
+  const auto first_filter = publisher.Get();
+  ASSERT_NE(first_filter, nullptr);
+  EXPECT_TRUE(first_filter->MayContain("key1"));
+  EXPECT_FALSE(first_filter->MayContain("key2"));
+
+  cache->UpdateKeyValue("key2", "value2", 1);
+  ASSERT_TRUE(publisher.Rebuild().ok());
+  EXPECT_TRUE(publisher.Get()->MayContain("key2"));
+  // Filters handed out before stay unchanged.
+  EXPECT_FALSE(first_filter->MayContain("key2"));
+}
+
+TEST(KeyFilterPublisherTest, StartFailsForCachesWithoutKeyIteration) {
+  MockCache cache;
+  KeyFilterPublisher publisher(cache, 10);
+  EXPECT_EQ(publisher.Start(absl::Minutes(1)).code(),
+            absl::StatusCode::kUnimplemented);
+  EXPECT_EQ(publisher.Get(), nullptr);
+}
+
+}  // namespace
+}  // namespace kv_server
@@ -0,0 +1,80 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/internal_server/key_filter.h"
+
+#include <string>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "gtest/gtest.h"
+
+namespace kv_server {
+namespace {
+
+KeyFilter BuildFilter(int num_keys, int32_t bits_per_key) {
+  std::vector<uint64_t> key_hashes;
+  for (int i = 0; i < num_keys; i++) {
+    key_hashes.push_back(KeyFilter::Hash(absl::StrCat("key", i)));
+  }
+  return KeyFilter::Build(key_hashes, bits_per_key);
+}
+
+TEST(KeyFilterTest, HashIsStable) {
+  EXPECT_EQ(KeyFilter::Hash(""), KeyFilter::Hash(""));
+  EXPECT_EQ(KeyFilter::Hash("key"), KeyFilter::Hash(std::string("key")));
+  EXPECT_NE(KeyFilter::Hash("key1"), KeyFilter::Hash("key2"));
+}
+
+TEST(KeyFilterTest, ContainsAllKeys) {
+  const KeyFilter filter = BuildFilter(10'000, 10);
+  for (int i = 0; i < 10'000; i++) {
+    EXPECT_TRUE(filter.MayContain(absl::StrCat("key", i))) << i;
+  }
+}
+
+TEST(KeyFilterTest, RejectsMostOtherKeys) {
+  const KeyFilter filter = BuildFilter(10'000, 10);
+  int false_positives = 0;
+  for (int i = 0; i < 10'000; i++) {
+    false_positives += filter.MayContain(absl::StrCat("other", i));
+  }
+  EXPECT_LT(false_positives, 300);
+}
+
+TEST(KeyFilterTest, EmptyFilterRejectsAllKeys) {
+  const KeyFilter filter = KeyFilter::Build({}, 10);
+  EXPECT_FALSE(filter.MayContain("key"));
+  EXPECT_FALSE(filter.MayContain(""));
+}
+
+TEST(KeyFilterTest, RoundTripsThroughProto) {
+  const KeyFilter filter = BuildFilter(1'000, 10);
+  const auto parsed = KeyFilter::FromProto(filter.proto());
+  ASSERT_TRUE(parsed.ok());
+  for (int i = 0; i < 1'000; i++) {
+    EXPECT_TRUE(parsed->MayContain(absl::StrCat("key", i))) << i;
+  }
+}
+
+TEST(KeyFilterTest, RejectsInvalidProto) {
+  EXPECT_FALSE(KeyFilter::FromProto(ShardKeyFilter()).ok());
+  ShardKeyFilter proto;
+  proto.set_num_hashes(1'000);
+  proto.set_bits("bits");
+  EXPECT_FALSE(KeyFilter::FromProto(proto).ok());
+}
+
+}  // namespace
+}  // namespace kv_server
@@ -14,6 +14,8 @@
 
 #include "components/internal_server/local_lookup.h"
 
+#include <cstdint>
+#include <iterator>
 #include <memory>
 #include <string>
 #include <string_view>
@@ -24,15 +26,22 @@
 #include "components/data_server/cache/cache.h"
 #include "components/internal_server/lookup.h"
 #include "components/internal_server/lookup.pb.h"
-#include "components/query/driver.h"
-#include "components/query/scanner.h"
+#include "components/internal_server/request_lookup_cache.h"
+#include "components/query/plan.h"
+#include "components/query/query_cache.h"
+#include "components/query/roaring_bitmap.h"
+#include "components/util/thread_pool.h"
 
 namespace kv_server {
 namespace {
 
 class LocalLookup : public Lookup {
  public:
-  explicit LocalLookup(const Cache& cache) : cache_(cache) {}
+  LocalLookup(const Cache& cache, ThreadPool* query_thread_pool,
+              size_t min_parallel_query_cardinality)
+      : cache_(cache),
+        query_thread_pool_(query_thread_pool),
+        min_parallel_query_cardinality_(min_parallel_query_cardinality) {}
 
   absl::StatusOr<InternalLookupResponse> GetKeyValues(
       const RequestContext& request_context,
@@ -46,11 +55,65 @@ class LocalLookup : public Lookup {
     return ProcessKeysetKeys(request_context, key_set);
   }
 
+  absl::StatusOr<InternalLookupResponse> GetKeyValueSetSizes(
+      const RequestContext& request_context,
+      const absl::flat_hash_set<std::string_view>& key_set) const override {
+    InternalLookupResponse response;
+    if (key_set.empty()) {
+      return response;
+    }
+    // The sizes are kept with the sets, so the values are not copied.
+    std::unique_ptr<GetKeyValueSetResult> key_value_set_result =
+        cache_.GetKeyValueSet(request_context, key_set);
+    for (const auto& key : key_set) {
+      SingleLookupResult& result = (*response.mutable_kv_pairs())[key];
+      const size_t set_size = key_value_set_result->GetValueSetSize(key);
+      if (set_size == 0) {
+        auto status = result.mutable_status();
+        status->set_code(static_cast<int>(absl::StatusCode::kNotFound));
+        status->set_message(absl::StrCat("Key not found: ", key));
+      } else {
+        result.set_set_size(set_size);
+      }
+    }
+    return response;
+  }
+
   absl::StatusOr<InternalRunQueryResponse> RunQuery(
       const RequestContext& request_context, std::string query) const override {
     return ProcessQuery(request_context, query);
   }
 
+  absl::StatusOr<InternalRunSetQueryUInt32Response> RunSetQueryUInt32(
+      const RequestContext& request_context, std::string query) const override {
+    return ProcessUInt32Query(request_context, query);
+  }
+
+  absl::StatusOr<InternalGetKeysContainingResponse> GetKeysContaining(
+      const RequestContext& request_context, std::string value) const override {
+    absl::StatusOr<std::vector<std::string>> keys =
+        cache_.GetKeysContaining(request_context, value);
+    if (!keys.ok()) {
+      return keys.status();
+    }
+    InternalGetKeysContainingResponse response;
+    response.mutable_keys()->Assign(std::make_move_iterator(keys->begin()),
+                                    std::make_move_iterator(keys->end()));
+    return response;
+  }
+
+  absl::StatusOr<InternalLookupResponse> GetValuesByPrefix(
+      const RequestContext& request_context, std::string key_prefix,
+      int64_t limit) const override {
+    absl::StatusOr<std::vector<std::string>> keys =
+        cache_.GetKeysWithPrefix(request_context, key_prefix, limit);
+    if (!keys.ok()) {
+      return keys.status();
+    }
+    return ProcessKeys(request_context, absl::flat_hash_set<std::string_view>(
+                                            keys->begin(), keys->end()));
+  }
+
  private:
   InternalLookupResponse ProcessKeys(
       const RequestContext& request_context,
@@ -62,20 +125,30 @@ class LocalLookup : public Lookup {
     if (keys.empty()) {
       return response;
     }
-    auto kv_pairs = cache_.GetKeyValuePairs(request_context, keys);
+    // Keys looked up earlier in the request get the same result, so that the
+    // hook calls of a request don't see the updates applied in between.
+    RequestLookupCache& lookup_cache = request_context.GetLookupCache();
+    const absl::flat_hash_set<std::string_view> missing_keys =
+        lookup_cache.GetValues(keys, response);
+    if (missing_keys.empty()) {
+      return response;
+    }
+    auto key_value_result = cache_.GetKeyValues(request_context, missing_keys);
 
-    for (const auto& key : keys) {
+    for (const auto& key : missing_keys) {
       SingleLookupResult result;
-      const auto key_iter = kv_pairs.find(key);
-      if (key_iter == kv_pairs.end()) {
+      const auto value = key_value_result->GetValue(key);
+      if (!value.has_value()) {
         auto status = result.mutable_status();
         status->set_code(static_cast<int>(absl::StatusCode::kNotFound));
         status->set_message(absl::StrCat("Key not found: ", key));
       } else {
-        result.set_value(std::move(key_iter->second));
+        // The only copy of the value, straight from the cache into the proto.
+        result.set_value(std::string(*value));
       }
       (*response.mutable_kv_pairs())[key] = std::move(result);
     }
+    lookup_cache.PutValues(missing_keys, response);
     return response;
   }
 
@@ -89,10 +162,17 @@ class LocalLookup : public Lookup {
     if (key_set.empty()) {
       return response;
     }
-    auto key_value_set_result = cache_.GetKeyValueSet(request_context, key_set);
-    for (const auto& key : key_set) {
+    RequestLookupCache& lookup_cache = request_context.GetLookupCache();
+    const absl::flat_hash_set<std::string_view> missing_keys =
+        lookup_cache.GetValueSets(key_set, response);
+    if (missing_keys.empty()) {
+      return response;
+    }
+    auto key_value_set_result =
+        cache_.GetKeyValueSet(request_context, missing_keys);
+    for (const auto& key : missing_keys) {
       SingleLookupResult result;
-      const auto value_set = key_value_set_result->GetValueSet(key);
+      const auto& value_set = key_value_set_result->GetValueSet(key);
       if (value_set.empty()) {
         auto status = result.mutable_status();
         status->set_code(static_cast<int>(absl::StatusCode::kNotFound));
@@ -104,6 +184,7 @@ class LocalLookup : public Lookup {
       }
       (*response.mutable_kv_pairs())[key] = std::move(result);
     }
+    lookup_cache.PutValueSets(missing_keys, response);
     return response;
   }
 
@@ -113,42 +194,137 @@ class LocalLookup : public Lookup {
                                 kInternalRunQueryLatencyInMicros>
         latency_recorder(request_context.GetInternalLookupMetricsContext());
     if (query.empty()) return absl::OkStatus();
-    std::unique_ptr<GetKeyValueSetResult> get_key_value_set_result;
-    kv_server::Driver driver([&get_key_value_set_result](std::string_view key) {
-      return get_key_value_set_result->GetValueSet(key);
-    });
-
-    std::istringstream stream(query);
-    kv_server::Scanner scanner(stream);
-    kv_server::Parser parse(driver, scanner);
-    int parse_result = parse();
-    if (parse_result) {
+    bool query_cache_hit;
+    auto compiled_query = query_cache_.Get(query, &query_cache_hit);
+    request_context.GetMetricsBatch().local_query_cache_access_events.Add(
+        query_cache_hit ? kQueryCacheHit : kQueryCacheMiss);
+    if (!compiled_query.ok()) {
       LogInternalLookupRequestErrorMetric(
           request_context.GetInternalLookupMetricsContext(),
           kLocalRunQueryParsingFailure);
-      return absl::InvalidArgumentError("Parsing failure.");
+      return compiled_query.status();
     }
-    get_key_value_set_result =
-        cache_.GetKeyValueSet(request_context, driver.GetRootNode()->Keys());
+    std::unique_ptr<GetKeyValueSetResult> get_key_value_set_result =
+        cache_.GetKeyValueSet(request_context, (*compiled_query)->Keys());
+    auto cardinality_fn = [&get_key_value_set_result](std::string_view key) {
+      return get_key_value_set_result->GetValueSetSize(key);
+    };
 
-    auto result = driver.GetResult();
-    if (!result.ok()) {
+    InternalRunQueryResponse response;
+    if ((*compiled_query)->IsApproxCount()) {
+      response.set_count((*compiled_query)->EstimateCount(cardinality_fn));
+      return response;
+    }
+    if (get_key_value_set_result->HasValueSetIds()) {
+      // Set operations run on the interned ids, only the ids of the final
+      // result are translated back to values.
+      const RoaringBitmap result = EvalIds(
+          **compiled_query,
+          [&get_key_value_set_result](std::string_view key) {
+            const RoaringBitmap* ids =
+                get_key_value_set_result->GetValueSetIds(key);
+            return ids == nullptr ? RoaringBitmap() : *ids;
+          },
+          cardinality_fn);
+      if ((*compiled_query)->IsCount()) {
+        response.set_count(result.Cardinality());
+        return response;
+      }
+      const auto values = get_key_value_set_result->GetValues(result);
+      response.mutable_elements()->Assign(values.begin(), values.end());
+      return response;
+    }
+    const KVSetView result = Eval(
+        **compiled_query,
+        [&get_key_value_set_result](std::string_view key) {
+          return get_key_value_set_result->GetValueSet(key);
+        },
+        cardinality_fn);
+    if ((*compiled_query)->IsCount()) {
+      response.set_count(result.size());
+      return response;
+    }
+    response.mutable_elements()->Assign(result.begin(), result.end());
+    return response;
+  }
+
+  absl::StatusOr<InternalRunSetQueryUInt32Response> ProcessUInt32Query(
+      const RequestContext& request_context, std::string query) const {
+    ScopeLatencyMetricsRecorder<InternalLookupMetricsContext,
+                                kInternalRunQueryLatencyInMicros>
+        latency_recorder(request_context.GetInternalLookupMetricsContext());
+    if (query.empty()) return absl::OkStatus();
+    bool query_cache_hit;
+    auto compiled_query = query_cache_.Get(query, &query_cache_hit);
+    request_context.GetMetricsBatch().local_query_cache_access_events.Add(
+        query_cache_hit ? kQueryCacheHit : kQueryCacheMiss);
+    if (!compiled_query.ok()) {
       LogInternalLookupRequestErrorMetric(
           request_context.GetInternalLookupMetricsContext(),
-          kLocalRunQueryFailure);
-      return result.status();
+          kLocalRunQueryParsingFailure);
+      return compiled_query.status();
     }
-    InternalRunQueryResponse response;
-    response.mutable_elements()->Assign(result->begin(), result->end());
+    std::unique_ptr<GetUInt32ValueSetResult> get_value_set_result =
+        cache_.GetUInt32ValueSet(request_context, (*compiled_query)->Keys());
+    auto cardinality_fn = [&get_value_set_result](std::string_view key) {
+      return get_value_set_result->GetValueSet(key).Cardinality();
+    };
+    InternalRunSetQueryUInt32Response response;
+    if ((*compiled_query)->IsApproxCount()) {
+      response.set_count((*compiled_query)->EstimateCount(cardinality_fn));
+      return response;
+    }
+    // The sets are bitmaps already, so the query runs on them directly.
+    const RoaringBitmap result = EvalIds(
+        **compiled_query,
+        [&get_value_set_result](std::string_view key) {
+          return get_value_set_result->GetValueSet(key);
+        },
+        cardinality_fn);
+    if ((*compiled_query)->IsCount()) {
+      response.set_count(result.Cardinality());
+      return response;
+    }
+    const std::vector<uint32_t> elements = result.ToVector();
+    response.mutable_elements()->Assign(elements.begin(), elements.end());
     return response;
   }
+
+  // Evaluates on `query_thread_pool_` if set.
+  KVSetView Eval(const CompiledQuery& compiled_query,
+                 QueryPlan::LookupFn lookup_fn,
+                 QueryPlan::CardinalityFn cardinality_fn) const {
+    if (query_thread_pool_ == nullptr) {
+      return compiled_query.Eval(lookup_fn, cardinality_fn);
+    }
+    return compiled_query.Eval(lookup_fn, cardinality_fn, *query_thread_pool_,
+                               min_parallel_query_cardinality_);
+  }
+  RoaringBitmap EvalIds(const CompiledQuery& compiled_query,
+                        QueryPlan::IdLookupFn id_lookup_fn,
+                        QueryPlan::CardinalityFn cardinality_fn) const {
+    if (query_thread_pool_ == nullptr) {
+      return compiled_query.EvalIds(id_lookup_fn, cardinality_fn);
+    }
+    return compiled_query.EvalIds(id_lookup_fn, cardinality_fn,
+                                  *query_thread_pool_,
+                                  min_parallel_query_cardinality_);
+  }
+
   const Cache& cache_;
+  ThreadPool* const query_thread_pool_;
+  const size_t min_parallel_query_cardinality_;
+  // Parsed queries shared by all requests.
+  mutable QueryCache query_cache_;
 };
 
 }  // namespace
 
-std::unique_ptr<Lookup> CreateLocalLookup(const Cache& cache) {
-  return std::make_unique<LocalLookup>(cache);
+std::unique_ptr<Lookup> CreateLocalLookup(
+    const Cache& cache, ThreadPool* query_thread_pool,
+    size_t min_parallel_query_cardinality) {
+  return std::make_unique<LocalLookup>(cache, query_thread_pool,
+                                       min_parallel_query_cardinality);
 }
 
 }  // namespace kv_server
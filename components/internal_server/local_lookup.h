@@ -21,10 +21,18 @@
 
 #include "components/data_server/cache/cache.h"
 #include "components/internal_server/lookup.h"
+#include "components/query/plan.h"
+#include "components/util/thread_pool.h"
 
 namespace kv_server {
 
-std::unique_ptr<Lookup> CreateLocalLookup(const Cache& cache);
+// If `query_thread_pool` is set, queries over sets with at least
+// `min_parallel_query_cardinality` values evaluate their independent operands
+// concurrently on it, see `QueryPlan::Eval`. The pool must outlive the lookup.
+std::unique_ptr<Lookup> CreateLocalLookup(
+    const Cache& cache, ThreadPool* query_thread_pool = nullptr,
+    size_t min_parallel_query_cardinality =
+        QueryPlan::kDefaultMinParallelCardinality);
 
 }  // namespace kv_server
 
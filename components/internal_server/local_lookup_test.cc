@@ -20,6 +20,7 @@
 #include <vector>
 
 #include "components/data_server/cache/mocks.h"
+#include "components/query/roaring_bitmap.h"
 #include "gmock/gmock.h"
 #include "google/protobuf/text_format.h"
 #include "gtest/gtest.h"
@@ -32,6 +33,7 @@ using google::protobuf::TextFormat;
 using testing::_;
 using testing::Return;
 using testing::ReturnRef;
+using testing::ReturnRefOfCopy;
 
 class LocalLookupTest : public ::testing::Test {
  protected:
@@ -48,9 +50,10 @@ class LocalLookupTest : public ::testing::Test {
 };
 
 TEST_F(LocalLookupTest, GetKeyValues_KeysFound_Success) {
-  EXPECT_CALL(mock_cache_, GetKeyValuePairs(_, _))
-      .WillOnce(Return(absl::flat_hash_map<std::string, std::string>{
-          {"key1", "value1"}, {"key2", "value2"}}));
+  EXPECT_CALL(mock_cache_, GetKeyValues(_, _))
+      .WillOnce(
+          ReturnKeyValues(absl::flat_hash_map<std::string, std::string>{
+              {"key1", "value1"}, {"key2", "value2"}}));
 
   auto local_lookup = CreateLocalLookup(mock_cache_);
   auto response =
@@ -72,9 +75,10 @@ TEST_F(LocalLookupTest, GetKeyValues_KeysFound_Success) {
 }
 
 TEST_F(LocalLookupTest, GetKeyValues_DuplicateKeys_Success) {
-  EXPECT_CALL(mock_cache_, GetKeyValuePairs(_, _))
-      .WillOnce(Return(absl::flat_hash_map<std::string, std::string>{
-          {"key1", "value1"}, {"key2", "value2"}}));
+  EXPECT_CALL(mock_cache_, GetKeyValues(_, _))
+      .WillOnce(
+          ReturnKeyValues(absl::flat_hash_map<std::string, std::string>{
+              {"key1", "value1"}, {"key2", "value2"}}));
 
   auto local_lookup = CreateLocalLookup(mock_cache_);
   auto response =
@@ -92,8 +96,8 @@ TEST_F(LocalLookupTest, GetKeyValues_DuplicateKeys_Success) {
 }
 
 TEST_F(LocalLookupTest, GetKeyValues_KeyMissing_ReturnsStatusForKey) {
-  EXPECT_CALL(mock_cache_, GetKeyValuePairs(_, _))
-      .WillOnce(Return(
+  EXPECT_CALL(mock_cache_, GetKeyValues(_, _))
+      .WillOnce(ReturnKeyValues(
           absl::flat_hash_map<std::string, std::string>{{"key1", "value1"}}));
 
   auto local_lookup = CreateLocalLookup(mock_cache_);
@@ -116,6 +120,38 @@ TEST_F(LocalLookupTest, GetKeyValues_KeyMissing_ReturnsStatusForKey) {
   EXPECT_THAT(response.value(), EqualsProto(expected));
 }
 
+TEST_F(LocalLookupTest, GetKeyValues_RepeatedKeys_ReturnFirstResult) {
+  EXPECT_CALL(mock_cache_,
+              GetKeyValues(_, absl::flat_hash_set<std::string_view>{"key1"}))
+      .WillOnce(ReturnKeyValues(
+          absl::flat_hash_map<std::string, std::string>{{"key1", "value1"}}));
+  // "key1" was updated after the first lookup of the request.
+  EXPECT_CALL(mock_cache_,
+              GetKeyValues(_, absl::flat_hash_set<std::string_view>{"key2"}))
+      .WillOnce(
+          ReturnKeyValues(absl::flat_hash_map<std::string, std::string>{
+              {"key1", "value1_updated"}, {"key2", "value2"}}));
+
+  auto local_lookup = CreateLocalLookup(mock_cache_);
+  ASSERT_TRUE(local_lookup->GetKeyValues(GetRequestContext(), {"key1"}).ok());
+  auto response =
+      local_lookup->GetKeyValues(GetRequestContext(), {"key1", "key2"});
+  EXPECT_TRUE(response.ok());
+
+  InternalLookupResponse expected;
+  TextFormat::ParseFromString(R"pb(kv_pairs {
+                                     key: "key1"
+                                     value { value: "value1" }
+                                   }
+                                   kv_pairs {
+                                     key: "key2"
+                                     value { value: "value2" }
+                                   }
+                              )pb",
+                              &expected);
+  EXPECT_THAT(response.value(), EqualsProto(expected));
+}
+
 TEST_F(LocalLookupTest, GetKeyValues_EmptyRequest_ReturnsEmptyResponse) {
   auto local_lookup = CreateLocalLookup(mock_cache_);
   auto response = local_lookup->GetKeyValues(GetRequestContext(), {});
@@ -129,8 +165,8 @@ TEST_F(LocalLookupTest, GetKeyValueSets_KeysFound_Success) {
   auto mock_get_key_value_set_result =
       std::make_unique<MockGetKeyValueSetResult>();
   EXPECT_CALL(*mock_get_key_value_set_result, GetValueSet("key1"))
-      .WillOnce(
-          Return(absl::flat_hash_set<std::string_view>{"value1", "value2"}));
+      .WillOnce(ReturnRefOfCopy(
+          absl::flat_hash_set<std::string_view>{"value1", "value2"}));
   EXPECT_CALL(mock_cache_, GetKeyValueSet(_, _))
       .WillOnce(Return(std::move(mock_get_key_value_set_result)));
 
@@ -147,7 +183,7 @@ TEST_F(LocalLookupTest, GetKeyValueSets_SetEmpty_Success) {
   auto mock_get_key_value_set_result =
       std::make_unique<MockGetKeyValueSetResult>();
   EXPECT_CALL(*mock_get_key_value_set_result, GetValueSet("key1"))
-      .WillOnce(Return(absl::flat_hash_set<std::string_view>{}));
+      .WillOnce(ReturnRefOfCopy(absl::flat_hash_set<std::string_view>{}));
   EXPECT_CALL(mock_cache_, GetKeyValueSet(_, _))
       .WillOnce(Return(std::move(mock_get_key_value_set_result)));
 
@@ -166,6 +202,24 @@ TEST_F(LocalLookupTest, GetKeyValueSets_SetEmpty_Success) {
   EXPECT_THAT(response.value(), EqualsProto(expected));
 }
 
+TEST_F(LocalLookupTest, GetKeyValueSet_RepeatedKeys_ReturnFirstResult) {
+  auto mock_get_key_value_set_result =
+      std::make_unique<MockGetKeyValueSetResult>();
+  EXPECT_CALL(*mock_get_key_value_set_result, GetValueSet("key1"))
+      .WillOnce(
+          ReturnRefOfCopy(absl::flat_hash_set<std::string_view>{"value1"}));
+  EXPECT_CALL(mock_cache_, GetKeyValueSet(_, _))
+      .WillOnce(Return(std::move(mock_get_key_value_set_result)));
+
+  auto local_lookup = CreateLocalLookup(mock_cache_);
+  ASSERT_TRUE(local_lookup->GetKeyValueSet(GetRequestContext(), {"key1"}).ok());
+  auto response = local_lookup->GetKeyValueSet(GetRequestContext(), {"key1"});
+  EXPECT_TRUE(response.ok());
+
+  EXPECT_THAT(response.value().kv_pairs().at("key1").keyset_values().values(),
+              testing::ElementsAre("value1"));
+}
+
 TEST_F(LocalLookupTest, GetKeyValueSet_EmptyRequest_ReturnsEmptyResponse) {
   auto local_lookup = CreateLocalLookup(mock_cache_);
   auto response = local_lookup->GetKeyValueSet(GetRequestContext(), {});
@@ -175,14 +229,45 @@ TEST_F(LocalLookupTest, GetKeyValueSet_EmptyRequest_ReturnsEmptyResponse) {
   EXPECT_THAT(response.value(), EqualsProto(expected));
 }
 
+TEST_F(LocalLookupTest, GetKeyValueSetSizes_Success) {
+  auto mock_get_key_value_set_result =
+      std::make_unique<MockGetKeyValueSetResult>();
+  EXPECT_CALL(*mock_get_key_value_set_result, GetValueSetSize("key1"))
+      .WillOnce(Return(2));
+  EXPECT_CALL(*mock_get_key_value_set_result, GetValueSetSize("key2"))
+      .WillOnce(Return(0));
+  EXPECT_CALL(*mock_get_key_value_set_result, GetValueSet(_)).Times(0);
+  EXPECT_CALL(mock_cache_, GetKeyValueSet(_, _))
+      .WillOnce(Return(std::move(mock_get_key_value_set_result)));
+
+  auto local_lookup = CreateLocalLookup(mock_cache_);
+  auto response =
+      local_lookup->GetKeyValueSetSizes(GetRequestContext(), {"key1", "key2"});
+  ASSERT_TRUE(response.ok()) << response.status();
+
+  InternalLookupResponse expected;
+  TextFormat::ParseFromString(
+      R"pb(kv_pairs {
+             key: "key1"
+             value { set_size: 2 }
+           }
+           kv_pairs {
+             key: "key2"
+             value { status { code: 5 message: "Key not found: key2" } }
+           }
+      )pb",
+      &expected);
+  EXPECT_THAT(response.value(), EqualsProto(expected));
+}
+
 TEST_F(LocalLookupTest, RunQuery_Success) {
   std::string query = "someset";
 
   auto mock_get_key_value_set_result =
       std::make_unique<MockGetKeyValueSetResult>();
   EXPECT_CALL(*mock_get_key_value_set_result, GetValueSet("someset"))
-      .WillOnce(
-          Return(absl::flat_hash_set<std::string_view>{"value1", "value2"}));
+      .WillOnce(ReturnRefOfCopy(
+          absl::flat_hash_set<std::string_view>{"value1", "value2"}));
   EXPECT_CALL(
       mock_cache_,
       GetKeyValueSet(_, absl::flat_hash_set<std::string_view>{"someset"}))
@@ -197,6 +282,234 @@ TEST_F(LocalLookupTest, RunQuery_Success) {
               testing::UnorderedElementsAreArray({"value1", "value2"}));
 }
 
+TEST_F(LocalLookupTest, RunQuery_Limit_ReturnsAtMostLimitValues) {
+  auto mock_get_key_value_set_result =
+      std::make_unique<MockGetKeyValueSetResult>();
+  EXPECT_CALL(*mock_get_key_value_set_result, GetValueSet("someset"))
+      .WillOnce(ReturnRefOfCopy(
+          absl::flat_hash_set<std::string_view>{"value1", "value2", "value3"}));
+  EXPECT_CALL(
+      mock_cache_,
+      GetKeyValueSet(_, absl::flat_hash_set<std::string_view>{"someset"}))
+      .WillOnce(Return(std::move(mock_get_key_value_set_result)));
+
+  auto local_lookup = CreateLocalLookup(mock_cache_);
+  auto response =
+      local_lookup->RunQuery(GetRequestContext(), "someset LIMIT 2");
+  ASSERT_TRUE(response.ok()) << response.status();
+  EXPECT_EQ(response.value().elements_size(), 2);
+  EXPECT_FALSE(response.value().has_count());
+}
+
+TEST_F(LocalLookupTest, RunQuery_Count_ReturnsNumberOfValues) {
+  auto mock_get_key_value_set_result =
+      std::make_unique<MockGetKeyValueSetResult>();
+  EXPECT_CALL(*mock_get_key_value_set_result, GetValueSet("set1"))
+      .WillOnce(ReturnRefOfCopy(
+          absl::flat_hash_set<std::string_view>{"value1", "value2"}));
+  EXPECT_CALL(*mock_get_key_value_set_result, GetValueSet("set2"))
+      .WillOnce(ReturnRefOfCopy(
+          absl::flat_hash_set<std::string_view>{"value2", "value3"}));
+  EXPECT_CALL(
+      mock_cache_,
+      GetKeyValueSet(_, absl::flat_hash_set<std::string_view>{"set1", "set2"}))
+      .WillOnce(Return(std::move(mock_get_key_value_set_result)));
+
+  auto local_lookup = CreateLocalLookup(mock_cache_);
+  auto response =
+      local_lookup->RunQuery(GetRequestContext(), "COUNT(set1 | set2)");
+  ASSERT_TRUE(response.ok()) << response.status();
+  EXPECT_EQ(response.value().count(), 3);
+  EXPECT_THAT(response.value().elements(), testing::IsEmpty());
+}
+
+TEST_F(LocalLookupTest, RunQuery_ApproxCount_DoesNotLookUpSets) {
+  auto mock_get_key_value_set_result =
+      std::make_unique<MockGetKeyValueSetResult>();
+  EXPECT_CALL(*mock_get_key_value_set_result, GetValueSetSize("set1"))
+      .WillOnce(Return(2));
+  EXPECT_CALL(*mock_get_key_value_set_result, GetValueSetSize("set2"))
+      .WillOnce(Return(3));
+  EXPECT_CALL(*mock_get_key_value_set_result, GetValueSet(_)).Times(0);
+  EXPECT_CALL(
+      mock_cache_,
+      GetKeyValueSet(_, absl::flat_hash_set<std::string_view>{"set1", "set2"}))
+      .WillOnce(Return(std::move(mock_get_key_value_set_result)));
+
+  auto local_lookup = CreateLocalLookup(mock_cache_);
+  auto response =
+      local_lookup->RunQuery(GetRequestContext(), "APPROX_COUNT(set1 | set2)");
+  ASSERT_TRUE(response.ok()) << response.status();
+  // An upper bound, the sets may share values.
+  EXPECT_EQ(response.value().count(), 5);
+  EXPECT_THAT(response.value().elements(), testing::IsEmpty());
+}
+
+TEST_F(LocalLookupTest, RunQuery_RepeatedQuery_Success) {
+  std::string query = "set1 | set2";
+
+  EXPECT_CALL(
+      mock_cache_,
+      GetKeyValueSet(_, absl::flat_hash_set<std::string_view>{"set1", "set2"}))
+      .Times(2)
+      .WillRepeatedly([](const RequestContext&,
+                         const absl::flat_hash_set<std::string_view>&)
+                          -> std::unique_ptr<GetKeyValueSetResult> {
+        auto mock_get_key_value_set_result =
+            std::make_unique<MockGetKeyValueSetResult>();
+        EXPECT_CALL(*mock_get_key_value_set_result, GetValueSet("set1"))
+            .WillOnce(ReturnRefOfCopy(
+                absl::flat_hash_set<std::string_view>{"value1"}));
+        EXPECT_CALL(*mock_get_key_value_set_result, GetValueSet("set2"))
+            .WillOnce(ReturnRefOfCopy(
+                absl::flat_hash_set<std::string_view>{"value2"}));
+        return mock_get_key_value_set_result;
+      });
+
+  auto local_lookup = CreateLocalLookup(mock_cache_);
+  // The second query is evaluated from the compiled query of the first one.
+  for (int i = 0; i < 2; i++) {
+    auto response = local_lookup->RunQuery(GetRequestContext(), query);
+    ASSERT_TRUE(response.ok());
+    EXPECT_THAT(response.value().elements(),
+                testing::UnorderedElementsAreArray({"value1", "value2"}));
+  }
+}
+
+TEST_F(LocalLookupTest, RunQuery_InternedValueSets_Success) {
+  std::string query = "set1 & set2";
+  const RoaringBitmap set1_ids = RoaringBitmap::FromIds({1, 2, 3});
+  const RoaringBitmap set2_ids = RoaringBitmap::FromIds({2, 3, 4});
+
+  auto mock_get_key_value_set_result =
+      std::make_unique<MockGetKeyValueSetResult>();
+  EXPECT_CALL(*mock_get_key_value_set_result, HasValueSetIds())
+      .WillOnce(Return(true));
+  EXPECT_CALL(*mock_get_key_value_set_result, GetValueSetIds("set1"))
+      .WillOnce(Return(&set1_ids));
+  EXPECT_CALL(*mock_get_key_value_set_result, GetValueSetIds("set2"))
+      .WillOnce(Return(&set2_ids));
+  EXPECT_CALL(*mock_get_key_value_set_result,
+              GetValues(RoaringBitmap::FromIds({2, 3})))
+      .WillOnce(Return(std::vector<std::string_view>{"value2", "value3"}));
+  EXPECT_CALL(mock_cache_,
+              GetKeyValueSet(_, absl::flat_hash_set<std::string_view>{
+                                    "set1", "set2"}))
+      .WillOnce(Return(std::move(mock_get_key_value_set_result)));
+
+  auto local_lookup = CreateLocalLookup(mock_cache_);
+  auto response = local_lookup->RunQuery(GetRequestContext(), query);
+  ASSERT_TRUE(response.ok());
+  EXPECT_THAT(response.value().elements(),
+              testing::UnorderedElementsAreArray({"value2", "value3"}));
+}
+
+TEST_F(LocalLookupTest, RunSetQueryUInt32_Success) {
+  std::string query = "set1 - set2";
+  const RoaringBitmap set1 = RoaringBitmap::FromIds({1, 2, 3});
+  const RoaringBitmap set2 = RoaringBitmap::FromIds({2, 4});
+
+  auto mock_get_value_set_result =
+      std::make_unique<MockGetUInt32ValueSetResult>();
+  EXPECT_CALL(*mock_get_value_set_result, GetValueSet("set1"))
+      .WillRepeatedly(ReturnRef(set1));
+  EXPECT_CALL(*mock_get_value_set_result, GetValueSet("set2"))
+      .WillRepeatedly(ReturnRef(set2));
+  EXPECT_CALL(mock_cache_,
+              GetUInt32ValueSet(_, absl::flat_hash_set<std::string_view>{
+                                       "set1", "set2"}))
+      .WillOnce(Return(std::move(mock_get_value_set_result)));
+
+  auto local_lookup = CreateLocalLookup(mock_cache_);
+  auto response = local_lookup->RunSetQueryUInt32(GetRequestContext(), query);
+  ASSERT_TRUE(response.ok());
+  EXPECT_THAT(response.value().elements(), testing::ElementsAre(1, 3));
+}
+
+TEST_F(LocalLookupTest, GetKeysContaining_Success) {
+  EXPECT_CALL(mock_cache_, GetKeysContaining(_, "value1"))
+      .WillOnce(Return(std::vector<std::string>{"set1", "set2"}));
+
+  auto local_lookup = CreateLocalLookup(mock_cache_);
+  auto response =
+      local_lookup->GetKeysContaining(GetRequestContext(), "value1");
+  ASSERT_TRUE(response.ok());
+  EXPECT_THAT(response.value().keys(),
+              testing::UnorderedElementsAre("set1", "set2"));
+}
+
+TEST_F(LocalLookupTest, GetKeysContaining_IndexDisabled_Error) {
+  EXPECT_CALL(mock_cache_, GetKeysContaining(_, "value1"))
+      .WillOnce(Return(absl::FailedPreconditionError("disabled")));
+
+  auto local_lookup = CreateLocalLookup(mock_cache_);
+  auto response =
+      local_lookup->GetKeysContaining(GetRequestContext(), "value1");
+  EXPECT_EQ(response.status().code(), absl::StatusCode::kFailedPrecondition);
+}
+
+TEST_F(LocalLookupTest, GetValuesByPrefix_Success) {
+  EXPECT_CALL(mock_cache_, GetKeysWithPrefix(_, "campaign1:", 10))
+      .WillOnce(Return(
+          std::vector<std::string>{"campaign1:ad1", "campaign1:ad2"}));
+  EXPECT_CALL(mock_cache_, GetKeyValues(_, _))
+      .WillOnce(
+          ReturnKeyValues(absl::flat_hash_map<std::string, std::string>{
+              {"campaign1:ad1", "value1"}, {"campaign1:ad2", "value2"}}));
+
+  auto local_lookup = CreateLocalLookup(mock_cache_);
+  auto response =
+      local_lookup->GetValuesByPrefix(GetRequestContext(), "campaign1:", 10);
+  ASSERT_TRUE(response.ok());
+
+  InternalLookupResponse expected;
+  TextFormat::ParseFromString(R"pb(kv_pairs {
+                                     key: "campaign1:ad1"
+                                     value { value: "value1" }
+                                   }
+                                   kv_pairs {
+                                     key: "campaign1:ad2"
+                                     value { value: "value2" }
+                                   }
+                              )pb",
+                              &expected);
+  EXPECT_THAT(response.value(), EqualsProto(expected));
+}
+
+TEST_F(LocalLookupTest, GetValuesByPrefix_IndexDisabled_Error) {
+  EXPECT_CALL(mock_cache_, GetKeysWithPrefix(_, "campaign1:", 10))
+      .WillOnce(Return(absl::FailedPreconditionError("disabled")));
+
+  auto local_lookup = CreateLocalLookup(mock_cache_);
+  auto response =
+      local_lookup->GetValuesByPrefix(GetRequestContext(), "campaign1:", 10);
+  EXPECT_EQ(response.status().code(), absl::StatusCode::kFailedPrecondition);
+}
+
+TEST_F(LocalLookupTest, RunQuery_EmptyIntersectionOperand_SkipsLookups) {
+  std::string query = "set1 & set2";
+
+  auto mock_get_key_value_set_result =
+      std::make_unique<MockGetKeyValueSetResult>();
+  EXPECT_CALL(*mock_get_key_value_set_result, GetValueSetSize("set1"))
+      .WillOnce(Return(2));
+  EXPECT_CALL(*mock_get_key_value_set_result, GetValueSetSize("set2"))
+      .WillOnce(Return(0));
+  // The smaller set is looked up first, which ends the intersection.
+  EXPECT_CALL(*mock_get_key_value_set_result, GetValueSet("set2"))
+      .WillOnce(ReturnRefOfCopy(absl::flat_hash_set<std::string_view>{}));
+  EXPECT_CALL(*mock_get_key_value_set_result, GetValueSet("set1")).Times(0);
+  EXPECT_CALL(mock_cache_,
+              GetKeyValueSet(_, absl::flat_hash_set<std::string_view>{
+                                    "set1", "set2"}))
+      .WillOnce(Return(std::move(mock_get_key_value_set_result)));
+
+  auto local_lookup = CreateLocalLookup(mock_cache_);
+  auto response = local_lookup->RunQuery(GetRequestContext(), query);
+  ASSERT_TRUE(response.ok());
+  EXPECT_TRUE(response.value().elements().empty());
+}
+
 TEST_F(LocalLookupTest, RunQuery_ParsingError_Error) {
   std::string query = "someset|(";
 
@@ -0,0 +1,39 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/internal_server/lookup.h"
+
+#include <string>
+#include <utility>
+
+#include "absl/status/status.h"
+
+namespace kv_server {
+
+void AddQueryResult(const Lookup& lookup, const RequestContext& request_context,
+                    std::string query, InternalLookupResponse& response) {
+  SingleLookupResult result;
+  auto run_query_response = lookup.RunQuery(request_context, query);
+  if (run_query_response.ok()) {
+    *result.mutable_keyset_values()->mutable_values() =
+        std::move(*run_query_response->mutable_elements());
+  } else {
+    auto* status = result.mutable_status();
+    status->set_code(static_cast<int>(run_query_response.status().code()));
+    status->set_message(std::string(run_query_response.status().message()));
+  }
+  (*response.mutable_query_results())[std::move(query)] = std::move(result);
+}
+
+}  // namespace kv_server
@@ -17,11 +17,13 @@
 #ifndef COMPONENTS_INTERNAL_SERVER_LOOKUP_H_
 #define COMPONENTS_INTERNAL_SERVER_LOOKUP_H_
 
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <vector>
 
 #include "absl/container/flat_hash_set.h"
+#include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "components/internal_server/lookup.pb.h"
 #include "components/util/request_context.h"
@@ -41,10 +43,53 @@ class Lookup {
       const RequestContext& request_context,
       const absl::flat_hash_set<std::string_view>& key_set) const = 0;
 
+  // Returns the number of values of each key set of `key_set` in
+  // `SingleLookupResult.set_size`, without the values, or `NotFound` for
+  // keys without a set. Lookups that do not support it return
+  // `UnimplementedError`.
+  virtual absl::StatusOr<InternalLookupResponse> GetKeyValueSetSizes(
+      const RequestContext& request_context,
+      const absl::flat_hash_set<std::string_view>& key_set) const {
+    return absl::UnimplementedError(
+        "GetKeyValueSetSizes is not supported by this lookup");
+  }
+
   virtual absl::StatusOr<InternalRunQueryResponse> RunQuery(
       const RequestContext& request_context, std::string query) const = 0;
+
+  // Runs `query` over the sets of 32-bit unsigned integers of the keys.
+  // Lookups that do not support them return `UnimplementedError`.
+  virtual absl::StatusOr<InternalRunSetQueryUInt32Response> RunSetQueryUInt32(
+      const RequestContext& request_context, std::string query) const {
+    return absl::UnimplementedError(
+        "RunSetQueryUInt32 is not supported by this lookup");
+  }
+
+  // Returns the keys whose key-value sets hold `value`, from the set value
+  // index of the cache. Lookups that do not support it return
+  // `UnimplementedError`.
+  virtual absl::StatusOr<InternalGetKeysContainingResponse> GetKeysContaining(
+      const RequestContext& request_context, std::string value) const {
+    return absl::UnimplementedError(
+        "GetKeysContaining is not supported by this lookup");
+  }
+
+  // Looks up the values of up to `limit` keys starting with `key_prefix`,
+  // the first ones in order, from the sorted key index of the cache. Lookups
+  // that do not support it return `UnimplementedError`.
+  virtual absl::StatusOr<InternalLookupResponse> GetValuesByPrefix(
+      const RequestContext& request_context, std::string key_prefix,
+      int64_t limit) const {
+    return absl::UnimplementedError(
+        "GetValuesByPrefix is not supported by this lookup");
+  }
 };
 
+// Runs `query` with `lookup` and adds its elements, or its error, to the
+// `query_results` of `response`.
+void AddQueryResult(const Lookup& lookup, const RequestContext& request_context,
+                    std::string query, InternalLookupResponse& response);
+
 }  // namespace kv_server
 
 #endif  // COMPONENTS_INTERNAL_SERVER_LOOKUP_H_
@@ -0,0 +1,110 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/internal_server/lookup_response_compression.h"
+
+#include <limits>
+#include <string>
+#include <utility>
+
+#include "absl/log/log.h"
+#include "absl/strings/str_cat.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "components/telemetry/server_definition.h"
+#include "zstd.h"
+
+namespace kv_server {
+namespace {
+
+// Responses are compressed on the request path, so the fastest level is used.
+// It already shrinks the repeated keys and values of key sets several times.
+constexpr int kCompressionLevel = 1;
+
+}  // namespace
+
+std::string CompressLookupResponse(std::string serialized_response,
+                                   int32_t min_bytes) {
+  if (min_bytes <= 0 ||
+      serialized_response.size() < static_cast<size_t>(min_bytes)) {
+    return serialized_response;
+  }
+  const absl::Time start = absl::Now();
+  std::string compressed(ZSTD_compressBound(serialized_response.size()), '\0');
+  const size_t compressed_size = ZSTD_compress(
+      compressed.data(), compressed.size(), serialized_response.data(),
+      serialized_response.size(), kCompressionLevel);
+  LogIfError(KVServerContextMap()
+                 ->SafeMetric()
+                 .LogHistogram<kLookupResponseCompressionLatency>(
+                     absl::ToDoubleMicroseconds(absl::Now() - start)));
+  if (ZSTD_isError(compressed_size)) {
+    LOG(ERROR) << "Failed to compress lookup response: "
+               << ZSTD_getErrorName(compressed_size);
+    return serialized_response;
+  }
+  compressed.resize(compressed_size);
+  InternalLookupResponse response;
+  response.set_zstd_response(std::move(compressed));
+  std::string serialized_compressed = response.SerializeAsString();
+  if (serialized_compressed.size() >= serialized_response.size()) {
+    return serialized_response;
+  }
+  LogIfError(KVServerContextMap()
+                 ->SafeMetric()
+                 .LogHistogram<kLookupResponseCompressionRatio>(
+                     static_cast<double>(serialized_response.size()) /
+                     serialized_compressed.size()));
+  return serialized_compressed;
+}
+
+absl::Status DecompressLookupResponse(InternalLookupResponse& response) {
+  if (response.zstd_response().empty()) {
+    return absl::OkStatus();
+  }
+  const absl::Time start = absl::Now();
+  const std::string& compressed = response.zstd_response();
+  // Frames written by ZSTD_compress always hold their content size.
+  const unsigned long long content_size =  // NOLINT
+      ZSTD_getFrameContentSize(compressed.data(), compressed.size());
+  if (content_size == ZSTD_CONTENTSIZE_ERROR ||
+      content_size == ZSTD_CONTENTSIZE_UNKNOWN) {
+    return absl::DataLossError("Invalid zstd frame header of lookup response");
+  }
+  // Larger messages can't be parsed anyway.
+  if (content_size > std::numeric_limits<int>::max()) {
+    return absl::DataLossError("Compressed lookup response is too large");
+  }
+  std::string serialized_response(content_size, '\0');
+  const size_t size =
+      ZSTD_decompress(serialized_response.data(), serialized_response.size(),
+                      compressed.data(), compressed.size());
+  if (ZSTD_isError(size) || size != content_size) {
+    return absl::DataLossError(
+        absl::StrCat("Failed to decompress lookup response: ",
+                     ZSTD_isError(size) ? ZSTD_getErrorName(size)
+                                        : "unexpected size"));
+  }
+  if (!response.ParseFromString(serialized_response)) {
+    return absl::InvalidArgumentError(
+        "Failed parsing the decompressed response.");
+  }
+  LogIfError(KVServerContextMap()
+                 ->SafeMetric()
+                 .LogHistogram<kLookupResponseDecompressionLatency>(
+                     absl::ToDoubleMicroseconds(absl::Now() - start)));
+  return absl::OkStatus();
+}
+
+}  // namespace kv_server
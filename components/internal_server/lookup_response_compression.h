@@ -0,0 +1,42 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef COMPONENTS_INTERNAL_SERVER_LOOKUP_RESPONSE_COMPRESSION_H_
+#define COMPONENTS_INTERNAL_SERVER_LOOKUP_RESPONSE_COMPRESSION_H_
+
+#include <cstdint>
+#include <string>
+
+#include "absl/status/status.h"
+#include "components/internal_server/lookup.pb.h"
+
+namespace kv_server {
+
+// Returns `serialized_response` if it is smaller than `min_bytes` or if
+// `min_bytes` is not positive. Otherwise returns the serialization of an
+// `InternalLookupResponse` that only holds `serialized_response` compressed
+// with zstd in `zstd_response`, unless compressing does not make it smaller.
+// Logs the compression ratio and latency as safe metrics.
+std::string CompressLookupResponse(std::string serialized_response,
+                                   int32_t min_bytes);
+
+// Replaces `response` with the response compressed in its `zstd_response`, if
+// any. Returns an error if it is not a valid compressed response.
+absl::Status DecompressLookupResponse(InternalLookupResponse& response);
+
+}  // namespace kv_server
+
+#endif  // COMPONENTS_INTERNAL_SERVER_LOOKUP_RESPONSE_COMPRESSION_H_
@@ -0,0 +1,92 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/internal_server/lookup_response_compression.h"
+
+#include <random>
+#include <string>
+
+#include "absl/strings/str_cat.h"
+#include "components/telemetry/server_definition.h"
+#include "gtest/gtest.h"
+#include "public/test_util/proto_matcher.h"
+
+namespace kv_server {
+namespace {
+
+class LookupResponseCompressionTest : public ::testing::Test {
+ protected:
+  LookupResponseCompressionTest() { InitMetricsContextMap(); }
+};
+
+InternalLookupResponse KeySetResponse(int num_values) {
+  InternalLookupResponse response;
+  auto* values = (*response.mutable_kv_pairs())["key"].mutable_keyset_values();
+  for (int i = 0; i < num_values; i++) {
+    values->add_values(absl::StrCat("value", i));
+  }
+  return response;
+}
+
+TEST_F(LookupResponseCompressionTest, CompressesLargeResponses) {
+  const InternalLookupResponse response = KeySetResponse(1000);
+  const std::string serialized = response.SerializeAsString();
+  const std::string compressed =
+      CompressLookupResponse(serialized, /*min_bytes=*/1024);
+  EXPECT_LT(compressed.size(), serialized.size());
+  InternalLookupResponse decompressed;
+  ASSERT_TRUE(decompressed.ParseFromString(compressed));
+  EXPECT_FALSE(decompressed.zstd_response().empty());
+  ASSERT_TRUE(DecompressLookupResponse(decompressed).ok());
+  EXPECT_THAT(decompressed, EqualsProto(response));
+}
+
+TEST_F(LookupResponseCompressionTest, DoesNotCompressSmallResponses) {
+  const std::string serialized = KeySetResponse(10).SerializeAsString();
+  EXPECT_EQ(CompressLookupResponse(serialized, serialized.size() + 1),
+            serialized);
+}
+
+TEST_F(LookupResponseCompressionTest, DoesNotCompressIfDisabled) {
+  const std::string serialized = KeySetResponse(1000).SerializeAsString();
+  EXPECT_EQ(CompressLookupResponse(serialized, /*min_bytes=*/0), serialized);
+}
+
+TEST_F(LookupResponseCompressionTest, DoesNotCompressIncompressibleResponses) {
+  std::mt19937 random(0);
+  std::string value(4096, '\0');
+  for (char& c : value) {
+    c = static_cast<char>(random());
+  }
+  InternalLookupResponse response;
+  (*response.mutable_kv_pairs())["key"].set_value(value);
+  const std::string serialized = response.SerializeAsString();
+  EXPECT_EQ(CompressLookupResponse(serialized, /*min_bytes=*/1), serialized);
+}
+
+TEST_F(LookupResponseCompressionTest, UncompressedResponseIsUnchanged) {
+  const InternalLookupResponse response = KeySetResponse(10);
+  InternalLookupResponse decompressed = response;
+  ASSERT_TRUE(DecompressLookupResponse(decompressed).ok());
+  EXPECT_THAT(decompressed, EqualsProto(response));
+}
+
+TEST_F(LookupResponseCompressionTest, InvalidCompressedResponseIsError) {
+  InternalLookupResponse response;
+  response.set_zstd_response("invalid");
+  EXPECT_FALSE(DecompressLookupResponse(response).ok());
+}
+
+}  // namespace
+}  // namespace kv_server
@@ -18,15 +18,19 @@
 #include <memory>
 #include <sstream>
 #include <string>
+#include <string_view>
 #include <utility>
 #include <vector>
 
 #include "absl/log/log.h"
 #include "absl/status/status.h"
 #include "components/data_server/request_handler/ohttp_server_encryptor.h"
+#include "components/internal_server/compact_lookup_result.h"
 #include "components/internal_server/lookup.grpc.pb.h"
 #include "components/internal_server/lookup.h"
+#include "components/internal_server/lookup_response_compression.h"
 #include "components/internal_server/string_padder.h"
+#include "components/telemetry/request_trace.h"
 #include "google/protobuf/message.h"
 #include "grpcpp/grpcpp.h"
 
@@ -73,11 +77,24 @@ void LookupServiceImpl::ProcessKeysetKeys(
   }
 }
 
+void LookupServiceImpl::ProcessKeysetSizeKeys(
+    const RequestContext& request_context,
+    const RepeatedPtrField<std::string>& keys,
+    InternalLookupResponse& response) const {
+  if (keys.empty()) return;
+  absl::flat_hash_set<std::string_view> key_list(keys.begin(), keys.end());
+  auto set_sizes_result =
+      lookup_.GetKeyValueSetSizes(request_context, key_list);
+  if (set_sizes_result.ok()) {
+    response = *std::move(set_sizes_result);
+  }
+}
+
 grpc::Status LookupServiceImpl::InternalLookup(
     grpc::ServerContext* context, const InternalLookupRequest* request,
     InternalLookupResponse* response) {
-  auto scope_metrics_context = std::make_unique<ScopeMetricsContext>();
-  RequestContext request_context(*scope_metrics_context);
+  const ScopeMetricsContext scope_metrics_context;
+  RequestContext request_context(scope_metrics_context);
   if (context->IsCancelled()) {
     return grpc::Status(grpc::StatusCode::CANCELLED,
                         "Deadline exceeded or client cancelled, abandoning.");
@@ -90,8 +107,15 @@ grpc::Status LookupServiceImpl::SecureLookup(
     grpc::ServerContext* context,
     const SecureLookupRequest* secure_lookup_request,
     SecureLookupResponse* secure_response) {
-  auto scope_metrics_context = std::make_unique<ScopeMetricsContext>();
-  RequestContext request_context(*scope_metrics_context);
+  const ScopeMetricsContext scope_metrics_context;
+  RequestContext request_context(scope_metrics_context);
+  if (const auto trace_parent = context->client_metadata().find(
+          std::string(RequestTrace::kTraceParentHeader));
+      trace_parent != context->client_metadata().end()) {
+    request_context.SetTrace(RequestTrace::ContinueRemote(
+        "SecureLookup", std::string_view(trace_parent->second.data(),
+                                         trace_parent->second.size())));
+  }
   LogIfError(request_context.GetInternalLookupMetricsContext()
                  .AccumulateMetric<kSecureLookupRequestCount>(1));
   ScopeLatencyMetricsRecorder<InternalLookupMetricsContext,
@@ -123,13 +147,15 @@ grpc::Status LookupServiceImpl::SecureLookup(
 
   VLOG(9) << "SecureLookup unpadded";
   InternalLookupRequest request;
-  if (!request.ParseFromString(*serialized_request_maybe)) {
+  if (!request.ParseFromArray(serialized_request_maybe->data(),
+                              serialized_request_maybe->size())) {
     return grpc::Status(grpc::StatusCode::INTERNAL,
                         "Failed parsing incoming request");
   }
 
-  auto payload_to_encrypt =
-      GetPayload(request_context, request.lookup_sets(), request.keys());
+  TraceSpan lookup_span(request_context.GetTrace(), "InternalLookup");
+  auto payload_to_encrypt = GetPayload(request_context, request);
+  lookup_span.End();
   if (payload_to_encrypt.empty()) {
     // we cannot encrypt an empty payload. Note, that soon we will add logic
     // to pad responses, so this branch will never be hit.
@@ -147,22 +173,35 @@ grpc::Status LookupServiceImpl::SecureLookup(
 }
 
 std::string LookupServiceImpl::GetPayload(
-    const RequestContext& request_context, const bool lookup_sets,
-    const RepeatedPtrField<std::string>& keys) const {
+    const RequestContext& request_context,
+    const InternalLookupRequest& request) const {
   InternalLookupResponse response;
-  if (lookup_sets) {
-    ProcessKeysetKeys(request_context, keys, response);
+  if (request.lookup_set_sizes()) {
+    ProcessKeysetSizeKeys(request_context, request.keys(), response);
+  } else if (request.lookup_sets()) {
+    ProcessKeysetKeys(request_context, request.keys(), response);
   } else {
-    ProcessKeys(request_context, keys, response);
+    ProcessKeys(request_context, request.keys(), response);
+  }
+  for (const auto& query : request.queries()) {
+    AddQueryResult(lookup_, request_context, query, response);
   }
-  return response.SerializeAsString();
+  // The compact format has no set sizes, which are small anyway.
+  if (request.result_format() == LOOKUP_RESULT_FORMAT_COMPACT_V1 &&
+      !request.lookup_set_sizes()) {
+    response.set_compact_kv_pairs(
+        CompactLookupResult::Encode(response.kv_pairs()));
+    response.clear_kv_pairs();
+  }
+  return CompressLookupResponse(response.SerializeAsString(),
+                                request.compress_response_min_bytes());
 }
 
 grpc::Status LookupServiceImpl::InternalRunQuery(
     grpc::ServerContext* context, const InternalRunQueryRequest* request,
     InternalRunQueryResponse* response) {
-  auto scope_metrics_context = std::make_unique<ScopeMetricsContext>();
-  RequestContext request_context(*scope_metrics_context);
+  const ScopeMetricsContext scope_metrics_context;
+  RequestContext request_context(scope_metrics_context);
   if (context->IsCancelled()) {
     return grpc::Status(grpc::StatusCode::CANCELLED,
                         "Deadline exceeded or client cancelled, abandoning.");
@@ -177,4 +216,20 @@ grpc::Status LookupServiceImpl::InternalRunQuery(
   return grpc::Status::OK;
 }
 
+grpc::Status LookupServiceImpl::GetKeyFilter(
+    grpc::ServerContext* context, const GetKeyFilterRequest* request,
+    GetKeyFilterResponse* response) {
+  if (key_filter_publisher_ == nullptr) {
+    return grpc::Status(grpc::StatusCode::UNIMPLEMENTED,
+                        "Key filters are disabled");
+  }
+  const std::shared_ptr<const KeyFilter> filter = key_filter_publisher_->Get();
+  if (filter == nullptr) {
+    return grpc::Status(grpc::StatusCode::UNAVAILABLE,
+                        "Key filter is not built yet");
+  }
+  *response->mutable_filter() = filter->proto();
+  return grpc::Status::OK;
+}
+
 }  // namespace kv_server
@@ -19,6 +19,7 @@
 
 #include <string>
 
+#include "components/internal_server/key_filter_publisher.h"
 #include "components/internal_server/lookup.grpc.pb.h"
 #include "components/internal_server/lookup.h"
 #include "components/util/request_context.h"
@@ -31,10 +32,15 @@ namespace kv_server {
 class LookupServiceImpl final
     : public kv_server::InternalLookupService::Service {
  public:
+  // `GetKeyFilter` returns the filters of `key_filter_publisher`, or fails if
+  // it is null.
   LookupServiceImpl(const Lookup& lookup,
                     privacy_sandbox::server_common::KeyFetcherManagerInterface&
-                        key_fetcher_manager)
-      : lookup_(lookup), key_fetcher_manager_(key_fetcher_manager) {}
+                        key_fetcher_manager,
+                    const KeyFilterPublisher* key_filter_publisher = nullptr)
+      : lookup_(lookup),
+        key_fetcher_manager_(key_fetcher_manager),
+        key_filter_publisher_(key_filter_publisher) {}
 
   ~LookupServiceImpl() override = default;
 
@@ -52,10 +58,13 @@ class LookupServiceImpl final
       const kv_server::InternalRunQueryRequest* request,
       kv_server::InternalRunQueryResponse* response) override;
 
+  grpc::Status GetKeyFilter(grpc::ServerContext* context,
+                            const kv_server::GetKeyFilterRequest* request,
+                            kv_server::GetKeyFilterResponse* response) override;
+
  private:
-  std::string GetPayload(
-      const RequestContext& request_context, const bool lookup_sets,
-      const google::protobuf::RepeatedPtrField<std::string>& keys) const;
+  std::string GetPayload(const RequestContext& request_context,
+                         const InternalLookupRequest& request) const;
   void ProcessKeys(const RequestContext& request_context,
                    const google::protobuf::RepeatedPtrField<std::string>& keys,
                    InternalLookupResponse& response) const;
@@ -63,12 +72,17 @@ class LookupServiceImpl final
       const RequestContext& request_context,
       const google::protobuf::RepeatedPtrField<std::string>& keys,
       InternalLookupResponse& response) const;
+  void ProcessKeysetSizeKeys(
+      const RequestContext& request_context,
+      const google::protobuf::RepeatedPtrField<std::string>& keys,
+      InternalLookupResponse& response) const;
   grpc::Status ToInternalGrpcStatus(const RequestContext& request_context,
                                     const absl::Status& status,
                                     std::string_view error_code) const;
   const Lookup& lookup_;
   privacy_sandbox::server_common::KeyFetcherManagerInterface&
       key_fetcher_manager_;
+  const KeyFilterPublisher* key_filter_publisher_;
 };
 
 }  // namespace kv_server
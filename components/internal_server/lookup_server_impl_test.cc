@@ -142,6 +142,37 @@ TEST_F(LookupServiceImplTest, SecureLookupFailure) {
   EXPECT_EQ(status.error_code(), grpc::StatusCode::INTERNAL);
 }
 
+TEST_F(LookupServiceImplTest, GetKeyFilter_Disabled_Failure) {
+  GetKeyFilterResponse response;
+  grpc::ClientContext context;
+  grpc::Status status =
+      stub_->GetKeyFilter(&context, GetKeyFilterRequest(), &response);
+  EXPECT_EQ(status.error_code(), grpc::StatusCode::UNIMPLEMENTED);
+}
+
+TEST(LookupServiceImplKeyFilterTest, GetKeyFilter_Success) {
+  std::unique_ptr<Cache> cache = KeyValueCache::Create();
+  cache->UpdateKeyValue("key1", "value1", 1);
+  KeyFilterPublisher key_filter_publisher(*cache, 10);
+  MockLookup mock_lookup;
+  privacy_sandbox::server_common::FakeKeyFetcherManager
+      fake_key_fetcher_manager;
+  LookupServiceImpl lookup_service(mock_lookup, fake_key_fetcher_manager,
+                                   &key_filter_publisher);
+  grpc::ServerContext context;
+  GetKeyFilterRequest request;
+  GetKeyFilterResponse response;
+  EXPECT_EQ(lookup_service.GetKeyFilter(&context, &request, &response)
+                .error_code(),
+            grpc::StatusCode::UNAVAILABLE);
+
+  ASSERT_TRUE(key_filter_publisher.Rebuild().ok());
+  ASSERT_TRUE(lookup_service.GetKeyFilter(&context, &request, &response).ok());
+  auto filter = KeyFilter::FromProto(response.filter());
+  ASSERT_TRUE(filter.ok());
+  EXPECT_TRUE(filter->MayContain("key1"));
+}
+
 }  // namespace
 
 }  // namespace kv_server
@@ -0,0 +1,84 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/internal_server/lookup.h"
+
+#include <memory>
+
+#include "absl/status/status.h"
+#include "components/internal_server/mocks.h"
+#include "gmock/gmock.h"
+#include "google/protobuf/text_format.h"
+#include "gtest/gtest.h"
+#include "public/test_util/proto_matcher.h"
+
+namespace kv_server {
+namespace {
+
+using google::protobuf::TextFormat;
+using testing::_;
+using testing::Return;
+
+class AddQueryResultTest : public ::testing::Test {
+ protected:
+  AddQueryResultTest() {
+    InitMetricsContextMap();
+    scope_metrics_context_ = std::make_unique<ScopeMetricsContext>();
+    request_context_ =
+        std::make_unique<RequestContext>(*scope_metrics_context_);
+  }
+  std::unique_ptr<ScopeMetricsContext> scope_metrics_context_;
+  std::unique_ptr<RequestContext> request_context_;
+  MockLookup mock_lookup_;
+};
+
+TEST_F(AddQueryResultTest, AddsElements) {
+  InternalRunQueryResponse run_query_response;
+  TextFormat::ParseFromString(R"pb(elements: "a" elements: "b")pb",
+                              &run_query_response);
+  EXPECT_CALL(mock_lookup_, RunQuery(_, "A & B"))
+      .WillOnce(Return(run_query_response));
+  InternalLookupResponse response;
+  AddQueryResult(mock_lookup_, *request_context_, "A & B", response);
+
+  InternalLookupResponse expected;
+  TextFormat::ParseFromString(
+      R"pb(query_results {
+             key: "A & B"
+             value { keyset_values { values: "a" values: "b" } }
+           }
+      )pb",
+      &expected);
+  EXPECT_THAT(response, EqualsProto(expected));
+}
+
+TEST_F(AddQueryResultTest, AddsStatusOnFailure) {
+  EXPECT_CALL(mock_lookup_, RunQuery(_, "A &"))
+      .WillOnce(Return(absl::InvalidArgumentError("Parsing failure.")));
+  InternalLookupResponse response;
+  AddQueryResult(mock_lookup_, *request_context_, "A &", response);
+
+  InternalLookupResponse expected;
+  TextFormat::ParseFromString(
+      R"pb(query_results {
+             key: "A &"
+             value { status { code: 3 message: "Parsing failure." } }
+           }
+      )pb",
+      &expected);
+  EXPECT_THAT(response, EqualsProto(expected));
+}
+
+}  // namespace
+}  // namespace kv_server
@@ -36,6 +36,8 @@ class MockRemoteLookupClient : public RemoteLookupClient {
               (const RequestContext& request_context,
                std::string_view serialized_message, int32_t padding_length),
               (const, override));
+  MOCK_METHOD(absl::StatusOr<ShardKeyFilter>, GetKeyFilter,
+              (absl::Duration timeout), (const, override));
   MOCK_METHOD(std::string_view, GetIpAddress, (), (const, override));
 };
 
@@ -49,8 +51,21 @@ class MockLookup : public Lookup {
               (const RequestContext&,
                const absl::flat_hash_set<std::string_view>&),
               (const, override));
+  MOCK_METHOD(absl::StatusOr<InternalLookupResponse>, GetKeyValueSetSizes,
+              (const RequestContext&,
+               const absl::flat_hash_set<std::string_view>&),
+              (const, override));
   MOCK_METHOD(absl::StatusOr<InternalRunQueryResponse>, RunQuery,
               (const RequestContext&, std::string query), (const, override));
+  MOCK_METHOD(absl::StatusOr<InternalRunSetQueryUInt32Response>,
+              RunSetQueryUInt32, (const RequestContext&, std::string query),
+              (const, override));
+  MOCK_METHOD(absl::StatusOr<InternalGetKeysContainingResponse>,
+              GetKeysContaining, (const RequestContext&, std::string value),
+              (const, override));
+  MOCK_METHOD(absl::StatusOr<InternalLookupResponse>, GetValuesByPrefix,
+              (const RequestContext&, std::string key_prefix, int64_t limit),
+              (const, override));
 };
 
 }  // namespace kv_server
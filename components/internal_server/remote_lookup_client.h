@@ -19,17 +19,36 @@
 
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
+#include "absl/functional/any_invocable.h"
 #include "absl/status/statusor.h"
+#include "absl/time/time.h"
 #include "components/internal_server/lookup.grpc.pb.h"
 #include "components/util/request_context.h"
+#include "grpcpp/client_context.h"
 #include "src/encryption/key_fetcher/interface/key_fetcher_manager_interface.h"
 
 namespace kv_server {
 
+// Options of the gRPC channels of a remote lookup client to one replica.
+struct RemoteLookupChannelOptions {
+  // Number of channels to the replica, each with its own HTTP/2 connection.
+  // Calls are spread over them round robin, so that they are not limited by
+  // the concurrent streams and the throughput of one connection.
+  int32_t num_channels = 1;
+  // Interval of the keepalive pings of the connections, also when they are
+  // idle. Zero disables keepalive pings. The remote lookup server must permit
+  // pings this frequent.
+  absl::Duration keepalive_time = absl::ZeroDuration();
+};
+
 class RemoteLookupClient {
  public:
+  using GetValuesCallback = absl::AnyInvocable<void(
+      absl::StatusOr<InternalLookupResponse>) &&>;
+
   virtual ~RemoteLookupClient() = default;
   // Calls the remote internal lookup server with the given keys.
   // Pads the request size with padding_length.
@@ -39,11 +58,40 @@ class RemoteLookupClient {
   virtual absl::StatusOr<InternalLookupResponse> GetValues(
       const RequestContext& request_context,
       std::string_view serialized_message, int32_t padding_length) const = 0;
+  // Same as above, making the call with `context`, which lets the caller
+  // cancel it from another thread with `grpc::ClientContext::TryCancel`.
+  // Implementations that don't make gRPC calls ignore `context`.
+  virtual absl::StatusOr<InternalLookupResponse> GetValues(
+      const RequestContext& request_context,
+      std::string_view serialized_message, int32_t padding_length,
+      grpc::ClientContext& context) const {
+    return GetValues(request_context, serialized_message, padding_length);
+  }
+  // Same as above, but returns once the call is sent and calls `done` with
+  // the response, on a gRPC thread, so that no thread waits for it.
+  // `serialized_message` is only used before returning, while
+  // `request_context` and `context` must stay valid until `done` is called.
+  // Implementations without asynchronous calls call `done` before returning.
+  virtual void GetValuesAsync(const RequestContext& request_context,
+                              std::string_view serialized_message,
+                              int32_t padding_length,
+                              grpc::ClientContext& context,
+                              GetValuesCallback done) const {
+    std::move(done)(GetValues(request_context, serialized_message,
+                              padding_length, context));
+  }
+  // Fetches the key filter of the remote server, see `KeyFilterPublisher`.
+  virtual absl::StatusOr<ShardKeyFilter> GetKeyFilter(
+      absl::Duration timeout) const {
+    return absl::UnimplementedError("Key filters are not supported");
+  }
   virtual std::string_view GetIpAddress() const = 0;
   static std::unique_ptr<RemoteLookupClient> Create(
       std::string ip_address,
       privacy_sandbox::server_common::KeyFetcherManagerInterface&
-          key_fetcher_manager);
+          key_fetcher_manager,
+      const RemoteLookupChannelOptions& channel_options =
+          RemoteLookupChannelOptions());
   static std::unique_ptr<RemoteLookupClient> Create(
       std::unique_ptr<InternalLookupService::Stub> stub,
       privacy_sandbox::server_common::KeyFetcherManagerInterface&
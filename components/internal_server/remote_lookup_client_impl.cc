@@ -11,18 +11,26 @@
 // WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
 // See the License for the specific language governing permissions and
 // limitations under the License.
+#include <algorithm>
+#include <atomic>
 #include <memory>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "absl/log/log.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/str_format.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
 #include "components/data_server/request_handler/ohttp_client_encryptor.h"
 #include "components/internal_server/constants.h"
 #include "components/internal_server/lookup.grpc.pb.h"
+#include "components/internal_server/lookup_response_compression.h"
 #include "components/internal_server/remote_lookup_client.h"
 #include "components/internal_server/string_padder.h"
+#include "components/telemetry/request_trace.h"
 #include "grpcpp/grpcpp.h"
 
 namespace kv_server {
@@ -36,41 +44,153 @@ class RemoteLookupClientImpl : public RemoteLookupClient {
   explicit RemoteLookupClientImpl(
       std::string ip_address,
       privacy_sandbox::server_common::KeyFetcherManagerInterface&
-          key_fetcher_manager)
+          key_fetcher_manager,
+      const RemoteLookupChannelOptions& channel_options)
       : ip_address_(
             absl::StrFormat("%s:%s", ip_address, kRemoteLookupServerPort)),
-        stub_(InternalLookupService::NewStub(grpc::CreateChannel(
-            ip_address_, grpc::InsecureChannelCredentials()))),
-        key_fetcher_manager_(key_fetcher_manager) {}
+        key_fetcher_manager_(key_fetcher_manager) {
+    for (int i = 0; i < std::max(1, channel_options.num_channels); i++) {
+      grpc::ChannelArguments args;
+      // Channels with the same arguments share their connections, unless
+      // each has its own subchannel pool.
+      args.SetInt(GRPC_ARG_USE_LOCAL_SUBCHANNEL_POOL, 1);
+      if (channel_options.keepalive_time > absl::ZeroDuration()) {
+        args.SetInt(GRPC_ARG_KEEPALIVE_TIME_MS,
+                    absl::ToInt64Milliseconds(channel_options.keepalive_time));
+        args.SetInt(GRPC_ARG_KEEPALIVE_PERMIT_WITHOUT_CALLS, 1);
+      }
+      stubs_.push_back(InternalLookupService::NewStub(grpc::CreateCustomChannel(
+          ip_address_, grpc::InsecureChannelCredentials(), args)));
+    }
+  }
 
   explicit RemoteLookupClientImpl(
       std::unique_ptr<InternalLookupService::Stub> stub,
       privacy_sandbox::server_common::KeyFetcherManagerInterface&
           key_fetcher_manager)
-      : stub_(std::move(stub)), key_fetcher_manager_(key_fetcher_manager) {}
+      : key_fetcher_manager_(key_fetcher_manager) {
+    stubs_.push_back(std::move(stub));
+  }
 
   absl::StatusOr<InternalLookupResponse> GetValues(
       const RequestContext& request_context,
       std::string_view serialized_message,
       int32_t padding_length) const override {
+    grpc::ClientContext context;
+    return GetValues(request_context, serialized_message, padding_length,
+                     context);
+  }
+
+  absl::StatusOr<InternalLookupResponse> GetValues(
+      const RequestContext& request_context,
+      std::string_view serialized_message, int32_t padding_length,
+      grpc::ClientContext& context) const override {
+    Call call(request_context, key_fetcher_manager_);
+    if (const absl::Status status = StartCall(
+            request_context, serialized_message, padding_length, context, call);
+        !status.ok()) {
+      return status;
+    }
+    const grpc::Status status =
+        NextStub().SecureLookup(&context, call.request, &call.response);
+    return FinishCall(request_context, status, call);
+  }
+
+  void GetValuesAsync(const RequestContext& request_context,
+                      std::string_view serialized_message,
+                      int32_t padding_length, grpc::ClientContext& context,
+                      GetValuesCallback done) const override {
+    auto call = std::make_unique<Call>(request_context, key_fetcher_manager_);
+    if (absl::Status status = StartCall(request_context, serialized_message,
+                                        padding_length, context, *call);
+        !status.ok()) {
+      call.reset();
+      std::move(done)(std::move(status));
+      return;
+    }
+    call->done = std::move(done);
+    // Owned by the callback, which gRPC requires to be copyable.
+    Call* call_ptr = call.release();
+    NextStub().async()->SecureLookup(
+        &context, &call_ptr->request, &call_ptr->response,
+        [this, &request_context, call_ptr](grpc::Status status) {
+          std::unique_ptr<Call> call(call_ptr);
+          absl::StatusOr<InternalLookupResponse> response =
+              FinishCall(request_context, status, *call);
+          GetValuesCallback done = std::move(call->done);
+          // Records the latency and ends the span before `done`.
+          call.reset();
+          std::move(done)(std::move(response));
+        });
+  }
+
+  absl::StatusOr<ShardKeyFilter> GetKeyFilter(
+      absl::Duration timeout) const override {
+    grpc::ClientContext context;
+    context.set_deadline(absl::ToChronoTime(absl::Now() + timeout));
+    GetKeyFilterResponse response;
+    grpc::Status status =
+        NextStub().GetKeyFilter(&context, GetKeyFilterRequest(), &response);
+    if (!status.ok()) {
+      return absl::Status((absl::StatusCode)status.error_code(),
+                          status.error_message());
+    }
+    return std::move(*response.mutable_filter());
+  }
+
+  std::string_view GetIpAddress() const override { return ip_address_; }
+
+ private:
+  // State of one lookup, from the encryption of the request to the decryption
+  // of the response.
+  struct Call {
+    Call(const RequestContext& request_context,
+         privacy_sandbox::server_common::KeyFetcherManagerInterface&
+             key_fetcher_manager)
+        : latency_recorder(request_context.GetUdfRequestMetricsContext()),
+          span(request_context.GetTrace(), "RemoteLookup"),
+          encryptor(key_fetcher_manager) {}
+
     ScopeLatencyMetricsRecorder<UdfRequestMetricsContext,
                                 kRemoteLookupGetValuesLatencyInMicros>
-        latency_recorder(request_context.GetUdfRequestMetricsContext());
-    OhttpClientEncryptor encryptor(key_fetcher_manager_);
+        latency_recorder;
+    TraceSpan span;
+    OhttpClientEncryptor encryptor;
+    SecureLookupRequest request;
+    SecureLookupResponse response;
+    GetValuesCallback done;
+  };
+
+  // Encrypts the padded request into `call` and sets up `context` for it.
+  absl::Status StartCall(const RequestContext& request_context,
+                         std::string_view serialized_message,
+                         int32_t padding_length, grpc::ClientContext& context,
+                         Call& call) const {
+    if (call.span.IsRecording()) {
+      call.span.SetAttribute("server", ip_address_.c_str());
+      // The remote server continues the trace of the request.
+      context.AddMetadata(std::string(RequestTrace::kTraceParentHeader),
+                          call.span.TraceParent());
+    }
     auto encrypted_padded_serialized_request_maybe =
-        encryptor.EncryptRequest(Pad(serialized_message, padding_length));
+        call.encryptor.EncryptRequest(Pad(serialized_message, padding_length));
     if (!encrypted_padded_serialized_request_maybe.ok()) {
       LogUdfRequestErrorMetric(request_context.GetUdfRequestMetricsContext(),
                                kRemoteRequestEncryptionFailure);
       return encrypted_padded_serialized_request_maybe.status();
     }
-    SecureLookupRequest secure_lookup_request;
-    secure_lookup_request.set_ohttp_request(
-        *encrypted_padded_serialized_request_maybe);
-    SecureLookupResponse secure_response;
-    grpc::ClientContext context;
-    grpc::Status status =
-        stub_->SecureLookup(&context, secure_lookup_request, &secure_response);
+    call.request.set_ohttp_request(
+        *std::move(encrypted_padded_serialized_request_maybe));
+    if (request_context.GetDeadline() != absl::InfiniteFuture()) {
+      context.set_deadline(absl::ToChronoTime(request_context.GetDeadline()));
+    }
+    return absl::OkStatus();
+  }
+
+  // Returns the decrypted response of `call`, which ended with `status`.
+  absl::StatusOr<InternalLookupResponse> FinishCall(
+      const RequestContext& request_context, const grpc::Status& status,
+      Call& call) const {
     if (!status.ok()) {
       LogUdfRequestErrorMetric(request_context.GetUdfRequestMetricsContext(),
                                kRemoteSecureLookupFailure);
@@ -79,13 +199,13 @@ class RemoteLookupClientImpl : public RemoteLookupClient {
                           status.error_message());
     }
     InternalLookupResponse response;
-    if (secure_response.ohttp_response().empty()) {
+    if (call.response.ohttp_response().empty()) {
       // we cannot decrypt an empty response. Note, that soon we will add logic
       // to pad responses, so this branch will never be hit.
       return response;
     }
-    auto decrypted_response_maybe =
-        encryptor.DecryptResponse(std::move(secure_response.ohttp_response()));
+    auto decrypted_response_maybe = call.encryptor.DecryptResponse(
+        std::move(*call.response.mutable_ohttp_response()));
     if (!decrypted_response_maybe.ok()) {
       LogUdfRequestErrorMetric(request_context.GetUdfRequestMetricsContext(),
                                kResponseEncryptionFailure);
@@ -94,14 +214,22 @@ class RemoteLookupClientImpl : public RemoteLookupClient {
     if (!response.ParseFromString(*decrypted_response_maybe)) {
       return absl::InvalidArgumentError("Failed parsing the response.");
     }
+    if (const absl::Status status = DecompressLookupResponse(response);
+        !status.ok()) {
+      return status;
+    }
     return response;
   }
 
-  std::string_view GetIpAddress() const override { return ip_address_; }
+  InternalLookupService::Stub& NextStub() const {
+    return *stubs_[next_stub_.fetch_add(1, std::memory_order_relaxed) %
+                   stubs_.size()];
+  }
 
- private:
   const std::string ip_address_;
-  std::unique_ptr<InternalLookupService::Stub> stub_;
+  // One stub per channel.
+  std::vector<std::unique_ptr<InternalLookupService::Stub>> stubs_;
+  mutable std::atomic<uint32_t> next_stub_{0};
   privacy_sandbox::server_common::KeyFetcherManagerInterface&
       key_fetcher_manager_;
 };
@@ -111,9 +239,10 @@ class RemoteLookupClientImpl : public RemoteLookupClient {
 std::unique_ptr<RemoteLookupClient> RemoteLookupClient::Create(
     std::string ip_address,
     privacy_sandbox::server_common::KeyFetcherManagerInterface&
-        key_fetcher_manager) {
-  return std::make_unique<RemoteLookupClientImpl>(std::move(ip_address),
-                                                  key_fetcher_manager);
+        key_fetcher_manager,
+    const RemoteLookupChannelOptions& channel_options) {
+  return std::make_unique<RemoteLookupClientImpl>(
+      std::move(ip_address), key_fetcher_manager, channel_options);
 }
 std::unique_ptr<RemoteLookupClient> RemoteLookupClient::Create(
     std::unique_ptr<InternalLookupService::Stub> stub,
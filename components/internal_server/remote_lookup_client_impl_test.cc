@@ -12,7 +12,10 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include "absl/strings/str_cat.h"
+#include "absl/synchronization/notification.h"
 #include "components/data_server/cache/cache.h"
+#include "components/internal_server/compact_lookup_result.h"
 #include "components/internal_server/lookup_server_impl.h"
 #include "components/internal_server/mocks.h"
 #include "components/internal_server/remote_lookup_client.h"
@@ -101,6 +104,83 @@ TEST_F(RemoteLookupClientImplTest, EncryptedPaddedSuccessfulCall) {
   EXPECT_THAT(response, EqualsProto(expected));
 }
 
+TEST_F(RemoteLookupClientImplTest, AsyncCall) {
+  InternalLookupRequest request;
+  request.add_keys("key1");
+  InternalLookupResponse local_lookup_response;
+  TextFormat::ParseFromString(R"pb(kv_pairs {
+                                     key: "key1"
+                                     value { value: "value1" }
+                                   }
+                              )pb",
+                              &local_lookup_response);
+  EXPECT_CALL(mock_lookup_, GetKeyValues(_, _))
+      .WillOnce(Return(local_lookup_response));
+  grpc::ClientContext context;
+  absl::Notification done;
+  absl::StatusOr<InternalLookupResponse> response_status;
+  remote_lookup_client_->GetValuesAsync(
+      GetRequestContext(), request.SerializeAsString(), /*padding_length=*/10,
+      context, [&](absl::StatusOr<InternalLookupResponse> response) {
+        response_status = std::move(response);
+        done.Notify();
+      });
+  done.WaitForNotification();
+  ASSERT_TRUE(response_status.ok()) << response_status.status();
+  EXPECT_THAT(*response_status, EqualsProto(local_lookup_response));
+}
+
+TEST_F(RemoteLookupClientImplTest, AsyncCallCancelled) {
+  InternalLookupRequest request;
+  request.add_keys("key1");
+  grpc::ClientContext context;
+  context.TryCancel();
+  absl::Notification done;
+  absl::StatusOr<InternalLookupResponse> response_status;
+  remote_lookup_client_->GetValuesAsync(
+      GetRequestContext(), request.SerializeAsString(), /*padding_length=*/10,
+      context, [&](absl::StatusOr<InternalLookupResponse> response) {
+        response_status = std::move(response);
+        done.Notify();
+      });
+  done.WaitForNotification();
+  EXPECT_EQ(response_status.status().code(), absl::StatusCode::kCancelled);
+}
+
+TEST_F(RemoteLookupClientImplTest, EncryptedPaddedCompactResultsCall) {
+  std::vector<std::string> keys = {"key1", "key2"};
+  InternalLookupRequest request;
+  request.mutable_keys()->Assign(keys.begin(), keys.end());
+  request.set_result_format(LOOKUP_RESULT_FORMAT_COMPACT_V1);
+  std::string serialized_message = request.SerializeAsString();
+  int32_t padding_length = 10;
+  InternalLookupResponse local_lookup_response;
+  TextFormat::ParseFromString(R"pb(kv_pairs {
+                                     key: "key1"
+                                     value { value: "value1" }
+                                   }
+                                   kv_pairs {
+                                     key: "key2"
+                                     value { status { code: 5 } }
+                                   }
+                              )pb",
+                              &local_lookup_response);
+  EXPECT_CALL(mock_lookup_, GetKeyValues(_, _))
+      .WillOnce(Return(local_lookup_response));
+  auto response_status = remote_lookup_client_->GetValues(
+      GetRequestContext(), serialized_message, padding_length);
+  ASSERT_TRUE(response_status.ok());
+  EXPECT_TRUE(response_status->kv_pairs().empty());
+  const auto results =
+      CompactLookupResult::Parse(response_status->compact_kv_pairs());
+  ASSERT_TRUE(results.ok()) << results.status();
+  ASSERT_EQ(results->size(), 2);
+  EXPECT_THAT(results->Result(*results->Find("key1")),
+              EqualsProto(local_lookup_response.kv_pairs().at("key1")));
+  EXPECT_THAT(results->Result(*results->Find("key2")),
+              EqualsProto(local_lookup_response.kv_pairs().at("key2")));
+}
+
 TEST_F(RemoteLookupClientImplTest, EncryptedPaddedEmptySuccessfulCall) {
   std::vector<std::string> keys = {};
   InternalLookupRequest request;
@@ -155,6 +235,30 @@ TEST_F(RemoteLookupClientImplTest, EncryptedPaddedSuccessfulKeysettLookup) {
               testing::UnorderedElementsAreArray(expected_resulting_set));
 }
 
+TEST_F(RemoteLookupClientImplTest, EncryptedPaddedCompressedKeysetLookup) {
+  std::vector<std::string> keys = {"key1"};
+  InternalLookupRequest request;
+  request.mutable_keys()->Assign(keys.begin(), keys.end());
+  request.set_lookup_sets(true);
+  request.set_compress_response_min_bytes(1024);
+  std::string serialized_message = request.SerializeAsString();
+  int32_t padding_length = 10;
+
+  InternalLookupResponse local_lookup_response;
+  auto* values = (*local_lookup_response.mutable_kv_pairs())["key1"]
+                     .mutable_keyset_values();
+  for (int i = 0; i < 1000; i++) {
+    values->add_values(absl::StrCat("value", i));
+  }
+  EXPECT_CALL(mock_lookup_, GetKeyValueSet(_, _))
+      .WillOnce(Return(local_lookup_response));
+
+  auto response_status = remote_lookup_client_->GetValues(
+      GetRequestContext(), serialized_message, padding_length);
+  ASSERT_TRUE(response_status.ok()) << response_status.status();
+  EXPECT_THAT(*response_status, EqualsProto(local_lookup_response));
+}
+
 TEST_F(RemoteLookupClientImplTest,
        EncryptedPaddedSuccessfulEmptyKeysettLookup) {
   std::vector<std::string> keys = {};
@@ -0,0 +1,196 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/internal_server/request_lookup_cache.h"
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "absl/status/status.h"
+
+namespace kv_server {
+namespace {
+
+bool IsCacheable(const SingleLookupResult& result) {
+  return !result.has_status() ||
+         result.status().code() ==
+             static_cast<int>(absl::StatusCode::kNotFound);
+}
+
+absl::flat_hash_set<std::string_view> GetResults(
+    const absl::flat_hash_map<std::string, SingleLookupResult>& results,
+    const absl::flat_hash_set<std::string_view>& keys,
+    InternalLookupResponse& response) {
+  absl::flat_hash_set<std::string_view> missing_keys;
+  for (std::string_view key : keys) {
+    if (const auto it = results.find(key); it != results.end()) {
+      (*response.mutable_kv_pairs())[key] = it->second;
+    } else {
+      missing_keys.insert(key);
+    }
+  }
+  return missing_keys;
+}
+
+void PutResults(const absl::flat_hash_set<std::string_view>& keys,
+                const InternalLookupResponse& response,
+                absl::flat_hash_map<std::string, SingleLookupResult>& results) {
+  for (std::string_view key : keys) {
+    const auto it = response.kv_pairs().find(key);
+    if (it != response.kv_pairs().end() && IsCacheable(it->second)) {
+      results.insert_or_assign(std::string(key), it->second);
+    }
+  }
+}
+
+// The pool of caches is split into stripes, which threads are assigned to in
+// turn, so that requests of different threads rarely contend for its locks.
+constexpr int kNumPoolStripes = 16;
+// Caches pooled per stripe. Caches released beyond are deleted.
+constexpr size_t kMaxPooledCachesPerStripe = 64;
+
+struct PoolStripe {
+  absl::Mutex mutex;
+  std::vector<std::unique_ptr<RequestLookupCache>> caches
+      ABSL_GUARDED_BY(mutex);
+};
+
+PoolStripe& ThreadPoolStripe() {
+  static auto* const stripes = new std::array<PoolStripe, kNumPoolStripes>();
+  static std::atomic<int> next_index = 0;
+  thread_local const int index =
+      next_index.fetch_add(1, std::memory_order_relaxed);
+  return (*stripes)[index % kNumPoolStripes];
+}
+
+}  // namespace
+
+std::shared_ptr<RequestLookupCache> RequestLookupCache::Acquire() {
+  std::unique_ptr<RequestLookupCache> cache;
+  {
+    PoolStripe& stripe = ThreadPoolStripe();
+    absl::MutexLock lock(&stripe.mutex);
+    if (!stripe.caches.empty()) {
+      cache = std::move(stripe.caches.back());
+      stripe.caches.pop_back();
+    }
+  }
+  if (cache == nullptr) {
+    cache = std::make_unique<RequestLookupCache>();
+  }
+  return std::shared_ptr<RequestLookupCache>(cache.release(), &Release);
+}
+
+void RequestLookupCache::Release(RequestLookupCache* cache) {
+  // Drops the shard responses and query results of the request right away,
+  // rather than when the cache is reused.
+  cache->Clear();
+  {
+    PoolStripe& stripe = ThreadPoolStripe();
+    absl::MutexLock lock(&stripe.mutex);
+    if (stripe.caches.size() < kMaxPooledCachesPerStripe) {
+      stripe.caches.emplace_back(cache);
+      return;
+    }
+  }
+  delete cache;
+}
+
+void RequestLookupCache::Clear() {
+  absl::MutexLock lock(&mutex_);
+  // Maps keep their memory across `clear` unless they grew large, so pooled
+  // caches don't hold on to the memory of the largest requests.
+  values_.clear();
+  value_sets_.clear();
+  key_sets_.clear();
+  query_results_.clear();
+}
+
+absl::flat_hash_set<std::string_view> RequestLookupCache::GetValues(
+    const absl::flat_hash_set<std::string_view>& keys,
+    InternalLookupResponse& response) const {
+  absl::MutexLock lock(&mutex_);
+  return GetResults(values_, keys, response);
+}
+
+void RequestLookupCache::PutValues(
+    const absl::flat_hash_set<std::string_view>& keys,
+    const InternalLookupResponse& response) {
+  absl::MutexLock lock(&mutex_);
+  PutResults(keys, response, values_);
+}
+
+absl::flat_hash_set<std::string_view> RequestLookupCache::GetValueSets(
+    const absl::flat_hash_set<std::string_view>& keys,
+    InternalLookupResponse& response) const {
+  absl::MutexLock lock(&mutex_);
+  return GetResults(value_sets_, keys, response);
+}
+
+void RequestLookupCache::PutValueSets(
+    const absl::flat_hash_set<std::string_view>& keys,
+    const InternalLookupResponse& response) {
+  absl::MutexLock lock(&mutex_);
+  PutResults(keys, response, value_sets_);
+}
+
+absl::flat_hash_set<std::string_view> RequestLookupCache::GetKeySets(
+    const absl::flat_hash_set<std::string_view>& keys,
+    ShardKeySets& key_sets) const {
+  absl::flat_hash_set<std::string_view> missing_keys;
+  absl::MutexLock lock(&mutex_);
+  for (std::string_view key : keys) {
+    const auto it = key_sets_.find(key);
+    if (it == key_sets_.end()) {
+      missing_keys.insert(key);
+    } else if (it->second.has_value()) {
+      key_sets.insert_or_assign(std::string(key), *it->second);
+    }
+  }
+  return missing_keys;
+}
+
+void RequestLookupCache::PutKeySets(
+    const absl::flat_hash_set<std::string_view>& keys,
+    const ShardKeySets& key_sets) {
+  absl::MutexLock lock(&mutex_);
+  for (std::string_view key : keys) {
+    if (const auto it = key_sets.find(key); it != key_sets.end()) {
+      key_sets_.insert_or_assign(std::string(key), it->second);
+    } else {
+      key_sets_.insert_or_assign(std::string(key), std::nullopt);
+    }
+  }
+}
+
+std::shared_ptr<const InternalRunQueryResponse>
+RequestLookupCache::GetQueryResult(std::string_view query) const {
+  absl::MutexLock lock(&mutex_);
+  const auto it = query_results_.find(query);
+  return it == query_results_.end() ? nullptr : it->second;
+}
+
+void RequestLookupCache::PutQueryResult(
+    std::string_view query,
+    std::shared_ptr<const InternalRunQueryResponse> response) {
+  absl::MutexLock lock(&mutex_);
+  query_results_.insert_or_assign(std::string(query), std::move(response));
+}
+
+}  // namespace kv_server
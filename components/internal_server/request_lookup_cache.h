@@ -0,0 +1,120 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef COMPONENTS_INTERNAL_SERVER_REQUEST_LOOKUP_CACHE_H_
+#define COMPONENTS_INTERNAL_SERVER_REQUEST_LOOKUP_CACHE_H_
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/synchronization/mutex.h"
+#include "components/internal_server/lookup.pb.h"
+
+namespace kv_server {
+
+// Values of a key set looked up from the shards. The values are views of the
+// decoded shard response, which the key set keeps alive, so merging shard
+// responses does not copy them.
+struct ShardKeySet {
+  std::shared_ptr<const InternalLookupResponse> response;
+  absl::flat_hash_set<std::string_view> values;
+};
+
+using ShardKeySets = absl::flat_hash_map<std::string, ShardKeySet>;
+
+// Results of the lookups made for one request, so that keys looked up again
+// by later UDF hook calls of the request are not sent to the shards again,
+// and of the queries run by the UDF hooks, so that identical queries are not
+// run again. Serving the earlier results also makes every hook call of the
+// request read the same value of a key, even if updates are applied in
+// between. Only found and not found results, and successful queries, are
+// cached, so failed lookups are retried. Safe to use from multiple threads.
+class RequestLookupCache {
+ public:
+  // Returns an empty cache for a request. Caches are pooled, so that later
+  // requests reuse them, and the memory of their maps, instead of allocating
+  // them again; the returned cache goes back to the pool once released.
+  static std::shared_ptr<RequestLookupCache> Acquire();
+
+  // Adds the cached results of `keys` to `response`, and returns the keys
+  // without a cached result.
+  absl::flat_hash_set<std::string_view> GetValues(
+      const absl::flat_hash_set<std::string_view>& keys,
+      InternalLookupResponse& response) const ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Caches the results of `keys` in `response`.
+  void PutValues(const absl::flat_hash_set<std::string_view>& keys,
+                 const InternalLookupResponse& response)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Like `GetValues` and `PutValues`, for the key-value set lookups of local
+  // lookups, whose results hold the values of the sets.
+  absl::flat_hash_set<std::string_view> GetValueSets(
+      const absl::flat_hash_set<std::string_view>& keys,
+      InternalLookupResponse& response) const ABSL_LOCKS_EXCLUDED(mutex_);
+  void PutValueSets(const absl::flat_hash_set<std::string_view>& keys,
+                    const InternalLookupResponse& response)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Adds the cached key sets of `keys` to `key_sets`, and returns the keys
+  // without a cached result. Keys cached as not found are not added.
+  absl::flat_hash_set<std::string_view> GetKeySets(
+      const absl::flat_hash_set<std::string_view>& keys,
+      ShardKeySets& key_sets) const ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Caches the key sets of `keys` in `key_sets`, which is the complete result
+  // of looking up `keys`, so keys missing from it are cached as not found.
+  void PutKeySets(const absl::flat_hash_set<std::string_view>& keys,
+                  const ShardKeySets& key_sets) ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Returns the cached result of `query`, or nullptr if there is none.
+  std::shared_ptr<const InternalRunQueryResponse> GetQueryResult(
+      std::string_view query) const ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Caches `response` as the result of `query`.
+  void PutQueryResult(std::string_view query,
+                      std::shared_ptr<const InternalRunQueryResponse> response)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+ private:
+  // Removes all the cached results, keeping the memory of small maps.
+  void Clear() ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Clears `cache` and returns it to the pool, or deletes it if the pool is
+  // full.
+  static void Release(RequestLookupCache* cache);
+
+  mutable absl::Mutex mutex_;
+  absl::flat_hash_map<std::string, SingleLookupResult> values_
+      ABSL_GUARDED_BY(mutex_);
+  absl::flat_hash_map<std::string, SingleLookupResult> value_sets_
+      ABSL_GUARDED_BY(mutex_);
+  // Not found key sets are empty optionals.
+  absl::flat_hash_map<std::string, std::optional<ShardKeySet>> key_sets_
+      ABSL_GUARDED_BY(mutex_);
+  absl::flat_hash_map<std::string,
+                      std::shared_ptr<const InternalRunQueryResponse>>
+      query_results_ ABSL_GUARDED_BY(mutex_);
+};
+
+}  // namespace kv_server
+
+#endif  // COMPONENTS_INTERNAL_SERVER_REQUEST_LOOKUP_CACHE_H_
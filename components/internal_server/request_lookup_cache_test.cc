@@ -0,0 +1,153 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/internal_server/request_lookup_cache.h"
+
+#include <memory>
+#include <string>
+
+#include "gmock/gmock.h"
+#include "google/protobuf/text_format.h"
+#include "gtest/gtest.h"
+#include "public/test_util/proto_matcher.h"
+
+namespace kv_server {
+namespace {
+
+using google::protobuf::TextFormat;
+using testing::Key;
+using testing::UnorderedElementsAre;
+
+TEST(RequestLookupCacheTest, GetValuesReturnsMissingKeys) {
+  RequestLookupCache cache;
+  InternalLookupResponse response;
+  EXPECT_THAT(cache.GetValues({"key1", "key2"}, response),
+              UnorderedElementsAre("key1", "key2"));
+  EXPECT_TRUE(response.kv_pairs().empty());
+}
+
+TEST(RequestLookupCacheTest, GetValuesReturnsCachedResults) {
+  RequestLookupCache cache;
+  InternalLookupResponse lookup_response;
+  TextFormat::ParseFromString(R"pb(kv_pairs {
+                                     key: "key1"
+                                     value { value: "value1" }
+                                   }
+                                   kv_pairs {
+                                     key: "key2"
+                                     value { status { code: 5 } }
+                                   }
+                                   kv_pairs {
+                                     key: "key3"
+                                     value { value: "value3" }
+                                   }
+                              )pb",
+                              &lookup_response);
+  cache.PutValues({"key1", "key2"}, lookup_response);
+  InternalLookupResponse response;
+  EXPECT_THAT(cache.GetValues({"key1", "key2", "key3"}, response),
+              UnorderedElementsAre("key3"));
+  InternalLookupResponse expected;
+  TextFormat::ParseFromString(R"pb(kv_pairs {
+                                     key: "key1"
+                                     value { value: "value1" }
+                                   }
+                                   kv_pairs {
+                                     key: "key2"
+                                     value { status { code: 5 } }
+                                   }
+                              )pb",
+                              &expected);
+  EXPECT_THAT(response, EqualsProto(expected));
+}
+
+TEST(RequestLookupCacheTest, FailedLookupsAreNotCached) {
+  RequestLookupCache cache;
+  InternalLookupResponse lookup_response;
+  TextFormat::ParseFromString(R"pb(kv_pairs {
+                                     key: "key1"
+                                     value {
+                                       status {
+                                         code: 13
+                                         message: "Data lookup failed"
+                                       }
+                                     }
+                                   }
+                              )pb",
+                              &lookup_response);
+  cache.PutValues({"key1"}, lookup_response);
+  InternalLookupResponse response;
+  EXPECT_THAT(cache.GetValues({"key1"}, response),
+              UnorderedElementsAre("key1"));
+}
+
+TEST(RequestLookupCacheTest, ValueSetsAreCachedApartFromValues) {
+  RequestLookupCache cache;
+  InternalLookupResponse lookup_response;
+  TextFormat::ParseFromString(R"pb(kv_pairs {
+                                     key: "key1"
+                                     value { keyset_values { values: "a" } }
+                                   }
+                              )pb",
+                              &lookup_response);
+  cache.PutValueSets({"key1"}, lookup_response);
+  InternalLookupResponse response;
+  EXPECT_THAT(cache.GetValues({"key1"}, response),
+              UnorderedElementsAre("key1"));
+  EXPECT_TRUE(cache.GetValueSets({"key1"}, response).empty());
+  EXPECT_THAT(response, EqualsProto(lookup_response));
+}
+
+TEST(RequestLookupCacheTest, GetKeySetsReturnsCachedResults) {
+  RequestLookupCache cache;
+  cache.PutKeySets({"key1", "key2"},
+                   {{"key1", ShardKeySet{.values = {"a", "b"}}}});
+  ShardKeySets key_sets;
+  EXPECT_THAT(cache.GetKeySets({"key1", "key2", "key3"}, key_sets),
+              UnorderedElementsAre("key3"));
+  // "key2" is cached as not found.
+  EXPECT_THAT(key_sets, UnorderedElementsAre(Key("key1")));
+  EXPECT_THAT(key_sets["key1"].values, UnorderedElementsAre("a", "b"));
+}
+
+TEST(RequestLookupCacheTest, GetQueryResultReturnsCachedResult) {
+  RequestLookupCache cache;
+  EXPECT_EQ(cache.GetQueryResult("A | B"), nullptr);
+  auto response = std::make_shared<InternalRunQueryResponse>();
+  response->add_elements("a");
+  cache.PutQueryResult("A | B", response);
+  EXPECT_EQ(cache.GetQueryResult("A | B"), response);
+  EXPECT_EQ(cache.GetQueryResult("A & B"), nullptr);
+}
+
+TEST(RequestLookupCacheTest, AcquireReusesReleasedCachesCleared) {
+  auto cache = RequestLookupCache::Acquire();
+  const RequestLookupCache* released = cache.get();
+  cache->PutKeySets({"key1"}, {{"key1", ShardKeySet{.values = {"a"}}}});
+  auto response = std::make_shared<InternalRunQueryResponse>();
+  cache->PutQueryResult("A", response);
+  cache.reset();
+  // The released cache no longer holds the query result.
+  EXPECT_EQ(response.use_count(), 1);
+
+  cache = RequestLookupCache::Acquire();
+  EXPECT_EQ(cache.get(), released);
+  ShardKeySets key_sets;
+  EXPECT_THAT(cache->GetKeySets({"key1"}, key_sets),
+              UnorderedElementsAre("key1"));
+  EXPECT_EQ(cache->GetQueryResult("A"), nullptr);
+}
+
+}  // namespace
+}  // namespace kv_server
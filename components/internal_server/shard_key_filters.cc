@@ -0,0 +1,67 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/internal_server/shard_key_filters.h"
+
+#include <utility>
+
+#include "absl/log/log.h"
+
+namespace kv_server {
+namespace {
+
+// Fetching a filter is not on the path of any request, so it may take a
+// while for large shards.
+constexpr absl::Duration kFetchTimeout = absl::Seconds(10);
+
+}  // namespace
+
+absl::Status ShardKeyFilters::Start(absl::Duration interval) {
+  return periodic_closure_->StartNow(interval,
+                                     [this] { Refresh(kFetchTimeout); });
+}
+
+void ShardKeyFilters::Refresh(absl::Duration timeout) {
+  for (int32_t shard_num = 0; shard_num < num_shards_; shard_num++) {
+    if (shard_num == current_shard_num_) {
+      continue;
+    }
+    RemoteLookupClient* client = shard_manager_.Get(shard_num);
+    if (client == nullptr) {
+      continue;
+    }
+    absl::StatusOr<ShardKeyFilter> proto = client->GetKeyFilter(timeout);
+    if (!proto.ok()) {
+      LOG(ERROR) << "Failed to fetch the key filter of shard " << shard_num
+                 << ": " << proto.status();
+      continue;
+    }
+    absl::StatusOr<KeyFilter> filter = KeyFilter::FromProto(*std::move(proto));
+    if (!filter.ok()) {
+      LOG(ERROR) << "Invalid key filter of shard " << shard_num << ": "
+                 << filter.status();
+      continue;
+    }
+    auto shared_filter = std::make_shared<const KeyFilter>(*std::move(filter));
+    absl::MutexLock lock(&mutex_);
+    filters_[shard_num] = std::move(shared_filter);
+  }
+}
+
+std::vector<std::shared_ptr<const KeyFilter>> ShardKeyFilters::Get() const {
+  absl::MutexLock lock(&mutex_);
+  return filters_;
+}
+
+}  // namespace kv_server
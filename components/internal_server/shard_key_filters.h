@@ -0,0 +1,71 @@
+/*
+ * Copyright 2023 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef COMPONENTS_INTERNAL_SERVER_SHARD_KEY_FILTERS_H_
+#define COMPONENTS_INTERNAL_SERVER_SHARD_KEY_FILTERS_H_
+
+#include <memory>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/status/status.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "components/internal_server/key_filter.h"
+#include "components/sharding/shard_manager.h"
+#include "components/util/periodic_closure.h"
+
+namespace kv_server {
+
+// Key filters of the remote shards, fetched from their lookup servers, with
+// which the sharded lookups skip keys that are definitely not on a shard.
+// Shards whose filter could not be fetched yet have no filter, and keep the
+// previous one if a later fetch fails.
+class ShardKeyFilters {
+ public:
+  ShardKeyFilters(int32_t num_shards, int32_t current_shard_num,
+                  const ShardManager& shard_manager)
+      : num_shards_(num_shards),
+        current_shard_num_(current_shard_num),
+        shard_manager_(shard_manager),
+        filters_(num_shards),
+        periodic_closure_(PeriodicClosure::Create()) {}
+
+  // Fetches the filters now, and then again every `interval`.
+  absl::Status Start(absl::Duration interval);
+
+  // Fetches the filter of every remote shard, waiting up to `timeout` for
+  // each of them.
+  void Refresh(absl::Duration timeout);
+
+  // Returns the filter of every shard, by shard number. Null for the current
+  // shard and for shards without a filter.
+  std::vector<std::shared_ptr<const KeyFilter>> Get() const;
+
+ private:
+  const int32_t num_shards_;
+  const int32_t current_shard_num_;
+  const ShardManager& shard_manager_;
+  mutable absl::Mutex mutex_;
+  std::vector<std::shared_ptr<const KeyFilter>> filters_
+      ABSL_GUARDED_BY(mutex_);
+  // Declared last, so that it is stopped before the other members go away.
+  std::unique_ptr<PeriodicClosure> periodic_closure_;
+};
+
+}  // namespace kv_server
+
+#endif  // COMPONENTS_INTERNAL_SERVER_SHARD_KEY_FILTERS_H_
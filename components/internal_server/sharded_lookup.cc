@@ -14,22 +14,38 @@
 #include "components/internal_server/sharded_lookup.h"
 
 #include <algorithm>
-#include <future>
+#include <list>
 #include <memory>
+#include <optional>
 #include <string>
 #include <string_view>
 #include <utility>
 #include <vector>
 
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/functional/function_ref.h"
 #include "absl/log/check.h"
 #include "absl/log/log.h"
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "components/internal_server/compact_lookup_result.h"
+#include "components/internal_server/hedge_delay.h"
+#include "components/internal_server/key_filter.h"
 #include "components/internal_server/lookup.h"
 #include "components/internal_server/lookup.pb.h"
 #include "components/internal_server/remote_lookup_client.h"
-#include "components/query/driver.h"
-#include "components/query/scanner.h"
+#include "components/internal_server/request_lookup_cache.h"
+#include "components/query/ast.h"
+#include "components/query/query_cache.h"
 #include "components/sharding/shard_manager.h"
+#include "components/telemetry/request_trace.h"
 #include "components/util/request_context.h"
+#include "google/protobuf/arena.h"
 #include "pir/hashing/sha256_hash_family.h"
 
 namespace kv_server {
@@ -37,6 +53,11 @@ namespace {
 
 using google::protobuf::RepeatedPtrField;
 
+// Remote lookups are asynchronous and their responses are decrypted on gRPC
+// threads, so executor threads are only held while a request is encrypted and
+// sent.
+constexpr int32_t kExecutorThreadsPerRemoteShard = 2;
+
 void UpdateResponse(
     const std::vector<std::string_view>& key_list,
     ::google::protobuf::Map<std::string, ::kv_server::SingleLookupResult>&
@@ -55,6 +76,55 @@ void UpdateResponse(
   }
 }
 
+// Same as above, for the results of a shard in the compact format.
+void UpdateResponse(const std::vector<std::string_view>& key_list,
+                    const CompactLookupResult& results,
+                    InternalLookupResponse& response) {
+  for (const auto& key : key_list) {
+    const std::optional<size_t> i = results.Find(key);
+    if (!i.has_value()) {
+      (*response.mutable_kv_pairs())[key].mutable_status()->set_code(
+          static_cast<int>(absl::StatusCode::kNotFound));
+    } else {
+      (*response.mutable_kv_pairs())[key] = results.Result(*i);
+    }
+  }
+}
+
+// Returns the number of values of the key set of `result`, which servers that
+// do not support `lookup_set_sizes` return as the values.
+size_t SetSize(const SingleLookupResult& result) {
+  switch (result.single_lookup_result_case()) {
+    case SingleLookupResult::kSetSize:
+      return result.set_size();
+    case SingleLookupResult::kKeysetValues:
+      return result.keyset_values().values_size();
+    default:
+      return 0;
+  }
+}
+
+void LogRequestLookupCacheAccesses(const RequestContext& request_context,
+                                   size_t num_keys, size_t num_missing_keys) {
+  auto& access_events =
+      request_context.GetMetricsBatch().request_lookup_cache_access_events;
+  if (num_keys > num_missing_keys) {
+    access_events.Add(kRequestLookupCacheHit,
+                      (int)(num_keys - num_missing_keys));
+  }
+  if (num_missing_keys > 0) {
+    access_events.Add(kRequestLookupCacheMiss, (int)num_missing_keys);
+  }
+}
+
+void SetNotFound(const std::vector<std::string_view>& key_list,
+                 InternalLookupResponse& response) {
+  for (const auto& key : key_list) {
+    (*response.mutable_kv_pairs())[key].mutable_status()->set_code(
+        static_cast<int>(absl::StatusCode::kNotFound));
+  }
+}
+
 void SetRequestFailed(const std::vector<std::string_view>& key_list,
                       InternalLookupResponse& response) {
   SingleLookupResult result;
@@ -72,13 +142,37 @@ class ShardedLookup : public Lookup {
   explicit ShardedLookup(const Lookup& local_lookup, const int32_t num_shards,
                          const int32_t current_shard_num,
                          const ShardManager& shard_manager,
-                         KeySharder key_sharder)
+                         KeySharder key_sharder,
+                         std::shared_ptr<ThreadPool> executor,
+                         const HedgingOptions& hedging_options,
+                         const PaddingOptions& padding_options,
+                         bool query_pushdown,
+                         const ShardKeyFilters* key_filters,
+                         int32_t compress_response_min_bytes,
+                         bool plan_queries_with_set_sizes)
       : local_lookup_(local_lookup),
         num_shards_(num_shards),
         current_shard_num_(current_shard_num),
         shard_manager_(shard_manager),
-        key_sharder_(std::move(key_sharder)) {
+        key_sharder_(std::move(key_sharder)),
+        executor_(std::move(executor)),
+        padding_options_(padding_options),
+        query_pushdown_(query_pushdown),
+        key_filters_(key_filters),
+        compress_response_min_bytes_(compress_response_min_bytes),
+        plan_queries_with_set_sizes_(plan_queries_with_set_sizes) {
     CHECK_GT(num_shards, 1) << "num_shards for ShardedLookup must be > 1";
+    CHECK(executor_ != nullptr) << "ShardedLookup needs an executor";
+    CHECK_GE(padding_options_.bucket_size, 0)
+        << "Padding bucket size must be >= 0";
+    shard_partitions_.reserve(num_shards);
+    for (int shard_num = 0; shard_num < num_shards; shard_num++) {
+      shard_partitions_.push_back(std::to_string(shard_num));
+    }
+    if (hedging_options.delay_percentile > 0) {
+      hedge_delay_ = std::make_unique<HedgeDelay>(
+          hedging_options.delay_percentile, hedging_options.initial_delay);
+    }
   }
 
   // Iterates over all keys specified in the `request` and assigns them to shard
@@ -108,7 +202,7 @@ class ShardedLookup : public Lookup {
     if (keys.empty()) {
       return response;
     }
-    absl::flat_hash_map<std::string, absl::flat_hash_set<std::string>> key_sets;
+    ShardKeySets key_sets;
     auto get_key_value_set_result_maybe =
         GetShardedKeyValueSet(request_context, keys);
     if (!get_key_value_set_result_maybe.ok()) {
@@ -128,14 +222,35 @@ class ShardedLookup : public Lookup {
                                  kShardedGetKeyValueSetKeySetNotFound);
       } else {
         auto keyset_values = result.mutable_keyset_values();
-        keyset_values->mutable_values()->Add(key_iter->second.begin(),
-                                             key_iter->second.end());
+        keyset_values->mutable_values()->Add(key_iter->second.values.begin(),
+                                             key_iter->second.values.end());
       }
       (*response.mutable_kv_pairs())[key] = std::move(result);
     }
     return response;
   }
 
+  absl::StatusOr<InternalLookupResponse> GetKeyValueSetSizes(
+      const RequestContext& request_context,
+      const absl::flat_hash_set<std::string_view>& key_set) const override {
+    auto set_sizes = GetShardedSetSizes(request_context, key_set);
+    if (!set_sizes.ok()) {
+      return set_sizes.status();
+    }
+    InternalLookupResponse response;
+    for (const auto& key : key_set) {
+      SingleLookupResult& result = (*response.mutable_kv_pairs())[key];
+      const auto it = set_sizes->find(key);
+      if (it == set_sizes->end() || it->second == 0) {
+        result.mutable_status()->set_code(
+            static_cast<int>(absl::StatusCode::kNotFound));
+      } else {
+        result.set_set_size(it->second);
+      }
+    }
+    return response;
+  }
+
   absl::StatusOr<InternalRunQueryResponse> RunQuery(
       const RequestContext& request_context, std::string query) const override {
     ScopeLatencyMetricsRecorder<UdfRequestMetricsContext,
@@ -148,51 +263,91 @@ class ShardedLookup : public Lookup {
       return response;
     }
 
-    absl::flat_hash_map<std::string, absl::flat_hash_set<std::string>> keysets;
-    kv_server::Driver driver([&keysets, this,
-                              &request_context](std::string_view key) {
-      const auto key_iter = keysets.find(key);
-      if (key_iter == keysets.end()) {
-        VLOG(8) << "Driver can't find " << key << "key_set. Returning empty.";
-        LogUdfRequestErrorMetric(request_context.GetUdfRequestMetricsContext(),
-                                 kShardedRunQueryMissingKeySet);
-        absl::flat_hash_set<std::string_view> set;
-        return set;
-      } else {
-        absl::flat_hash_set<std::string_view> set(key_iter->second.begin(),
-                                                  key_iter->second.end());
-        return set;
-      }
-    });
-    std::istringstream stream(query);
-    kv_server::Scanner scanner(stream);
-    kv_server::Parser parse(driver, scanner);
-    int parse_result = parse();
-    if (parse_result) {
+    bool query_cache_hit;
+    auto compiled_query = query_cache_.Get(query, &query_cache_hit);
+    request_context.GetMetricsBatch().sharded_query_cache_access_events.Add(
+        query_cache_hit ? kQueryCacheHit : kQueryCacheMiss);
+    if (!compiled_query.ok()) {
       LogUdfRequestErrorMetric(request_context.GetUdfRequestMetricsContext(),
                                kShardedRunQueryParsingFailure);
-      return absl::InvalidArgumentError("Parsing failure.");
+      return compiled_query.status();
+    }
+    if ((*compiled_query)->IsApproxCount()) {
+      // Only the sizes of the sets are sent back by the shards.
+      auto set_sizes =
+          GetShardedSetSizes(request_context, (*compiled_query)->Keys());
+      if (!set_sizes.ok()) {
+        LogUdfRequestErrorMetric(request_context.GetUdfRequestMetricsContext(),
+                                 kShardedRunQueryKeySetRetrievalFailure);
+        return set_sizes.status();
+      }
+      response.set_count((*compiled_query)->EstimateCount(
+          [&set_sizes](std::string_view key) {
+            return LookupSetSize(*set_sizes, key);
+          }));
+      return response;
+    }
+    if (query_pushdown_ && (*compiled_query)->Root() != nullptr) {
+      if (absl::Status status =
+              RunPushedDownQuery(request_context, **compiled_query, response);
+          !status.ok()) {
+        return status;
+      }
+      return response;
+    }
+    const absl::flat_hash_set<std::string_view>* keys =
+        &(*compiled_query)->Keys();
+    std::optional<SetSizes> set_sizes;
+    absl::flat_hash_set<std::string_view> keys_to_look_up;
+    if (plan_queries_with_set_sizes_) {
+      // The sizes of the sets order the plan and leave out the sets of
+      // intersections and differences that are known to be empty, before any
+      // set is fetched. Missing sets are not fetched either.
+      auto set_sizes_maybe = GetShardedSetSizes(request_context, *keys);
+      if (!set_sizes_maybe.ok()) {
+        LogUdfRequestErrorMetric(request_context.GetUdfRequestMetricsContext(),
+                                 kShardedRunQueryKeySetRetrievalFailure);
+        return set_sizes_maybe.status();
+      }
+      set_sizes = *std::move(set_sizes_maybe);
+      const auto set_size_fn = [&set_sizes](std::string_view key) {
+        return LookupSetSize(*set_sizes, key);
+      };
+      if ((*compiled_query)->EstimateCount(set_size_fn) == 0) {
+        SetResult(KVSetView(), **compiled_query, response);
+        return response;
+      }
+      keys_to_look_up = (*compiled_query)->KeysToLookUp(set_size_fn);
+      absl::erase_if(keys_to_look_up, [&set_size_fn](std::string_view key) {
+        return set_size_fn(key) == 0;
+      });
+      keys = &keys_to_look_up;
     }
     auto get_key_value_set_result_maybe =
-        GetShardedKeyValueSet(request_context, driver.GetRootNode()->Keys());
+        GetShardedKeyValueSet(request_context, *keys);
     if (!get_key_value_set_result_maybe.ok()) {
       LogUdfRequestErrorMetric(request_context.GetUdfRequestMetricsContext(),
                                kShardedRunQueryKeySetRetrievalFailure);
       return get_key_value_set_result_maybe.status();
     }
-    keysets = std::move(*get_key_value_set_result_maybe);
-    auto result = driver.GetResult();
-    if (!result.ok()) {
-      LogUdfRequestErrorMetric(request_context.GetUdfRequestMetricsContext(),
-                               kShardedRunQueryFailure);
-      return result.status();
-    }
+    const ShardKeySets keysets = *std::move(get_key_value_set_result_maybe);
+    const KVSetView result = (*compiled_query)->Eval(
+        [&keysets, &request_context](std::string_view key) {
+          return LookupKeySet(request_context, keysets, key);
+        },
+        [&keysets, &set_sizes](std::string_view key) -> size_t {
+          if (set_sizes.has_value()) {
+            return LookupSetSize(*set_sizes, key);
+          }
+          const auto key_iter = keysets.find(key);
+          return key_iter == keysets.end() ? 0 : key_iter->second.values.size();
+        });
     VLOG(8) << "Driver results for query " << query;
-    for (const auto& value : *result) {
+    for (const auto& value : result) {
       VLOG(8) << "Value: " << value << "\n";
     }
 
-    response.mutable_elements()->Assign(result->begin(), result->end());
+    SetResult(result, **compiled_query, response);
     return response;
   }
 
@@ -207,98 +362,472 @@ class ShardedLookup : public Lookup {
     // Identifies by how many chars `keys` should be padded, so that
     // all requests add up to the same length.
     int32_t padding;
+    // Queries pushed down to the shard, see `InternalLookupRequest.queries`.
+    std::vector<std::string> queries;
+    // Keys of the shard that its key filter does not have, which are not sent
+    // to the shard.
+    std::vector<std::string_view> skipped_keys;
   };
 
+  // Number of values of the sets of the keys of a request, by key.
+  using SetSizes = absl::flat_hash_map<std::string_view, size_t>;
+
+  // Sets the elements of `response` to at most the `LIMIT` of the query of
+  // `result`, or their number for a `COUNT(...)` query.
+  static void SetResult(const KVSetView& result,
+                        const CompiledQuery& compiled_query,
+                        InternalRunQueryResponse& response) {
+    if (compiled_query.IsCount()) {
+      response.set_count(result.size());
+      return;
+    }
+    size_t limit = compiled_query.Limit().value_or(result.size());
+    for (auto it = result.begin(); it != result.end() && limit > 0;
+         ++it, --limit) {
+      response.add_elements(std::string(*it));
+    }
+  }
+
+  static size_t LookupSetSize(const SetSizes& set_sizes,
+                              std::string_view key) {
+    const auto it = set_sizes.find(key);
+    return it == set_sizes.end() ? 0 : it->second;
+  }
+
+  static KVSetView LookupKeySet(const RequestContext& request_context,
+                                const ShardKeySets& keysets,
+                                std::string_view key) {
+    const auto key_iter = keysets.find(key);
+    if (key_iter == keysets.end()) {
+      VLOG(8) << "Driver can't find " << key << "key_set. Returning empty.";
+      LogUdfRequestErrorMetric(request_context.GetUdfRequestMetricsContext(),
+                               kShardedRunQueryMissingKeySet);
+      return KVSetView();
+    }
+    return key_iter->second.values;
+  }
+
+  // Returns the largest subtrees of `root` with an operation whose sets are
+  // all on one shard, with that shard, and adds the keys of the sets outside
+  // of these subtrees to `keys`. Sets can be placed on the same shard with a
+  // sharding regex in the `KeySharder`.
+  std::vector<std::pair<const Node*, int32_t>> FindPushdownSubtrees(
+      const Node& root, absl::flat_hash_set<std::string_view>& keys) const {
+    std::vector<const Node*> preorder;
+    std::vector<const Node*> stack = {&root};
+    while (!stack.empty()) {
+      const Node* node = stack.back();
+      stack.pop_back();
+      preorder.push_back(node);
+      if (node->Left() != nullptr) {
+        stack.push_back(node->Left());
+        stack.push_back(node->Right());
+      }
+    }
+    // Shard of all the sets of each subtree, or -1 if they are on several
+    // shards. Children are visited before their parents.
+    absl::flat_hash_map<const Node*, int32_t> shards;
+    for (auto it = preorder.rbegin(); it != preorder.rend(); ++it) {
+      const Node* node = *it;
+      if (node->Left() == nullptr) {
+        const std::string_view key = *node->Keys().begin();
+        shards[node] =
+            key_sharder_.IsReplicated(key)
+                ? current_shard_num_
+                : key_sharder_.GetShardNum(key, num_shards_);
+      } else {
+        const int32_t left = shards[node->Left()];
+        shards[node] = left == shards[node->Right()] ? left : -1;
+      }
+    }
+    std::vector<std::pair<const Node*, int32_t>> subtrees;
+    stack = {&root};
+    while (!stack.empty()) {
+      const Node* node = stack.back();
+      stack.pop_back();
+      if (node->Left() == nullptr) {
+        keys.merge(node->Keys());
+      } else if (shards[node] >= 0) {
+        subtrees.emplace_back(node, shards[node]);
+      } else {
+        stack.push_back(node->Left());
+        stack.push_back(node->Right());
+      }
+    }
+    return subtrees;
+  }
+
+  // Sends the subtrees found by `FindPushdownSubtrees` to their shards as
+  // queries, in the same lookups as the sets of the other keys, and evaluates
+  // the rest of the query over their results. Shards only return the result
+  // of their subtrees instead of all of their sets. If the whole query is
+  // pushed to one shard, its `LIMIT` is pushed along so that the shard stops
+  // once it found enough values.
+  absl::Status RunPushedDownQuery(const RequestContext& request_context,
+                                  const CompiledQuery& compiled_query,
+                                  InternalRunQueryResponse& response) const {
+    const Node& root = *compiled_query.Root();
+    absl::flat_hash_set<std::string_view> keys;
+    std::vector<std::pair<const Node*, std::string>> subtree_queries;
+    std::vector<std::vector<std::string>> shard_queries(num_shards_);
+    for (const auto& [subtree, shard_num] : FindPushdownSubtrees(root, keys)) {
+      std::string subtree_query = ToQueryString(*subtree);
+      if (subtree == &root && compiled_query.Limit().has_value()) {
+        absl::StrAppend(&subtree_query, " LIMIT ", *compiled_query.Limit());
+      }
+      subtree_queries.emplace_back(subtree, std::move(subtree_query));
+      shard_queries[shard_num].push_back(subtree_queries.back().second);
+    }
+    ShardKeySets query_sets;
+    auto keysets = GetShardedKeyValueSet(request_context, keys,
+                                         std::move(shard_queries), query_sets);
+    if (!keysets.ok()) {
+      LogUdfRequestErrorMetric(request_context.GetUdfRequestMetricsContext(),
+                               kShardedRunQueryKeySetRetrievalFailure);
+      return keysets.status();
+    }
+    absl::flat_hash_map<const Node*, KVSetView> subtree_sets;
+    for (const auto& [subtree, query] : subtree_queries) {
+      const auto it = query_sets.find(query);
+      if (it == query_sets.end()) {
+        LogUdfRequestErrorMetric(request_context.GetUdfRequestMetricsContext(),
+                                 kShardedRunQueryPushdownFailure);
+        return absl::InternalError(
+            absl::StrCat("Shard failed to run pushed down query: ", query));
+      }
+      subtree_sets.emplace(subtree, it->second.values);
+    }
+    const KVSetView result = Eval(
+        root,
+        [&keysets, &request_context](std::string_view key) {
+          return LookupKeySet(request_context, *keysets, key);
+        },
+        subtree_sets);
+    SetResult(result, compiled_query, response);
+    return absl::OkStatus();
+  }
+
   std::vector<ShardLookupInput> BucketKeys(
       const absl::flat_hash_set<std::string_view>& keys) const {
     ShardLookupInput sli;
     std::vector<ShardLookupInput> lookup_inputs(num_shards_, sli);
+    const std::vector<std::shared_ptr<const KeyFilter>> key_filters =
+        key_filters_ == nullptr
+            ? std::vector<std::shared_ptr<const KeyFilter>>()
+            : key_filters_->Get();
+    std::vector<std::string_view> sharded_keys;
+    sharded_keys.reserve(keys.size());
     for (const auto key : keys) {
-      auto sharding_result = key_sharder_.GetShardNumForKey(key, num_shards_);
-      VLOG(9) << "key: " << key
-              << ", shard number: " << sharding_result.shard_num
-              << ", sharding_key (if regex is present): "
-              << sharding_result.sharding_key;
-      lookup_inputs[sharding_result.shard_num].keys.emplace_back(key);
+      if (key_sharder_.IsReplicated(key)) {
+        // Every shard has replicated keys, so they are looked up locally.
+        lookup_inputs[current_shard_num_].keys.emplace_back(key);
+      } else {
+        sharded_keys.push_back(key);
+      }
+    }
+    const std::vector<int> shard_nums =
+        key_sharder_.GetShardNumsForKeys(sharded_keys, num_shards_);
+    for (size_t i = 0; i < sharded_keys.size(); ++i) {
+      const std::string_view key = sharded_keys[i];
+      const int shard_num = shard_nums[i];
+      VLOG(9) << "key: " << key << ", shard number: " << shard_num;
+      ShardLookupInput& lookup_input = lookup_inputs[shard_num];
+      if (!key_filters.empty() && key_filters[shard_num] != nullptr &&
+          !key_filters[shard_num]->MayContain(key)) {
+        lookup_input.skipped_keys.emplace_back(key);
+      } else {
+        lookup_input.keys.emplace_back(key);
+      }
     }
     return lookup_inputs;
   }
 
   void SerializeShardedRequests(std::vector<ShardLookupInput>& lookup_inputs,
-                                bool lookup_sets) const {
+                                bool lookup_sets, bool lookup_set_sizes) const {
+    // One request on an arena, cleared between shards, so that its keys
+    // reuse the same storage instead of allocating per shard.
+    google::protobuf::Arena arena;
+    auto* request =
+        google::protobuf::Arena::CreateMessage<InternalLookupRequest>(&arena);
+    request->set_lookup_sets(lookup_sets);
+    request->set_lookup_set_sizes(lookup_set_sizes);
+    // Servers that do not support the compact format ignore the field and
+    // return the results in `kv_pairs`.
+    request->set_result_format(LOOKUP_RESULT_FORMAT_COMPACT_V1);
+    request->set_compress_response_min_bytes(compress_response_min_bytes_);
     for (auto& lookup_input : lookup_inputs) {
-      InternalLookupRequest request;
-      request.mutable_keys()->Assign(lookup_input.keys.begin(),
-                                     lookup_input.keys.end());
-      request.set_lookup_sets(lookup_sets);
-      lookup_input.serialized_request = request.SerializeAsString();
+      request->mutable_keys()->Assign(lookup_input.keys.begin(),
+                                      lookup_input.keys.end());
+      request->mutable_queries()->Assign(lookup_input.queries.begin(),
+                                         lookup_input.queries.end());
+      request->SerializeToString(&lookup_input.serialized_request);
     }
   }
 
+  // Rounds `length` up to a multiple of the padding bucket size, if any.
+  int32_t RoundUpToPaddingBucket(int32_t length) const {
+    const int32_t bucket_size = padding_options_.bucket_size;
+    if (bucket_size == 0) {
+      return length;
+    }
+    return (length + bucket_size - 1) / bucket_size * bucket_size;
+  }
+
   void ComputePadding(std::vector<ShardLookupInput>& lookup_inputs) const {
     int32_t max_length = 0;
     for (const auto& lookup_input : lookup_inputs) {
       max_length =
           std::max(max_length, int32_t(lookup_input.serialized_request.size()));
     }
+    max_length = RoundUpToPaddingBucket(max_length);
+    // Requests only need the same length if all shards are sent one.
+    const bool pad_to_bucket = padding_options_.skip_empty_shards &&
+                               padding_options_.bucket_size > 0;
     for (auto& lookup_input : lookup_inputs) {
+      const int32_t length = lookup_input.serialized_request.size();
       lookup_input.padding =
-          max_length - lookup_input.serialized_request.size();
+          (pad_to_bucket ? RoundUpToPaddingBucket(length) : max_length) -
+          length;
     }
   }
 
+  // `shard_queries` are the queries pushed down to each shard, if any.
+  // `lookup_set_sizes` asks the shards for the sizes of the sets of `keys`
+  // instead of their values.
   std::vector<ShardLookupInput> ShardKeys(
-      const absl::flat_hash_set<std::string_view>& keys,
-      bool lookup_sets) const {
+      const absl::flat_hash_set<std::string_view>& keys, bool lookup_sets,
+      std::vector<std::vector<std::string>> shard_queries = {},
+      bool lookup_set_sizes = false) const {
     auto lookup_inputs = BucketKeys(keys);
-    SerializeShardedRequests(lookup_inputs, lookup_sets);
+    for (size_t shard_num = 0; shard_num < shard_queries.size(); shard_num++) {
+      lookup_inputs[shard_num].queries = std::move(shard_queries[shard_num]);
+    }
+    SerializeShardedRequests(lookup_inputs, lookup_sets, lookup_set_sizes);
     ComputePadding(lookup_inputs);
     return lookup_inputs;
   }
 
-  absl::StatusOr<
-      std::vector<std::future<absl::StatusOr<InternalLookupResponse>>>>
-  GetLookupFutures(const RequestContext& request_context,
-                   const std::vector<ShardLookupInput>& shard_lookup_inputs,
-                   std::function<absl::StatusOr<InternalLookupResponse>(
-                       const std::vector<std::string_view>& key_list)>
-                       get_local_future) const {
-    std::vector<std::future<absl::StatusOr<InternalLookupResponse>>> responses;
+  // State of the remote lookups of one request, shared with their tasks on
+  // the executor and their response callbacks. These only access the request
+  // while `running` counts them, and the request waits for `running` to drop
+  // to zero, so a task that runs after the request is over returns without
+  // touching it.
+  struct RemoteLookups {
+    explicit RemoteLookups(int32_t num_shards)
+        : responses(num_shards),
+          scheduled(num_shards, 0),
+          done(num_shards, false),
+          pending(num_shards - 1) {}
+
+    bool AllDone() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex) {
+      return pending == 0;
+    }
+    bool NoneRunning() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex) {
+      return running == 0;
+    }
+    // Sets the response of a shard that is not looked up remotely.
+    void SetDone(int shard_num,
+                 absl::StatusOr<InternalLookupResponse> response)
+        ABSL_LOCKS_EXCLUDED(mutex) {
+      absl::MutexLock lock(&mutex);
+      responses[shard_num] = std::move(response);
+      done[shard_num] = true;
+      pending--;
+    }
+
+    absl::Mutex mutex;
+    std::vector<absl::StatusOr<InternalLookupResponse>> responses
+        ABSL_GUARDED_BY(mutex);
+    // Number of lookups, including hedged ones, that haven't finished by shard.
+    std::vector<int> scheduled ABSL_GUARDED_BY(mutex);
+    std::vector<bool> done ABSL_GUARDED_BY(mutex);
+    // Number of remote shards that are not done.
+    int pending ABSL_GUARDED_BY(mutex);
+    // Number of lookups started but whose response hasn't been handled.
+    int running ABSL_GUARDED_BY(mutex) = 0;
+    // gRPC contexts of the started lookups, which are cancelled once all shards
+    // are done. A list, so that the contexts don't move.
+    std::list<grpc::ClientContext> contexts ABSL_GUARDED_BY(mutex);
+  };
+
+  // Schedules a lookup of `shard_lookup_input` with `client` on the executor.
+  // The first successful response for a shard is used, or the last failure
+  // if all lookups of the shard fail.
+  void ScheduleRemoteLookup(std::shared_ptr<RemoteLookups> lookups,
+                            int shard_num, const RemoteLookupClient& client,
+                            const RequestContext& request_context,
+                            const ShardLookupInput& shard_lookup_input) const {
+    {
+      absl::MutexLock lock(&lookups->mutex);
+      lookups->scheduled[shard_num]++;
+    }
+    executor_->Schedule([this, lookups = std::move(lookups), shard_num,
+                         &client, &request_context, &shard_lookup_input]() {
+      grpc::ClientContext* context;
+      {
+        absl::MutexLock lock(&lookups->mutex);
+        if (lookups->done[shard_num]) {
+          lookups->scheduled[shard_num]--;
+          return;
+        }
+        context = &lookups->contexts.emplace_back();
+        lookups->running++;
+      }
+      const absl::Time start = absl::Now();
+      // Returns once the call is sent, so the executor thread isn't held
+      // while the remote shard looks the keys up.
+      client.GetValuesAsync(
+          request_context, shard_lookup_input.serialized_request,
+          shard_lookup_input.padding, *context,
+          [this, lookups, shard_num,
+           start](absl::StatusOr<InternalLookupResponse> response) {
+            if (response.ok() && hedge_delay_ != nullptr) {
+              hedge_delay_->Record(absl::Now() - start);
+            }
+            absl::MutexLock lock(&lookups->mutex);
+            lookups->running--;
+            lookups->scheduled[shard_num]--;
+            if (!lookups->done[shard_num] &&
+                (response.ok() || lookups->scheduled[shard_num] == 0)) {
+              lookups->responses[shard_num] = std::move(response);
+              lookups->done[shard_num] = true;
+              lookups->pending--;
+            }
+          });
+    });
+  }
+
+  // Sends the lookups for remote shards to the executor, looks up the keys
+  // of the current shard with `get_local_response` on the calling thread, and
+  // returns the responses by shard number once all lookups are done or the
+  // request deadline has passed. Remote lookups that are still running after
+  // the hedge delay are also sent to another replica of their shard. Shards
+  // without a lookup client fail with `Internal`.
+  std::vector<absl::StatusOr<InternalLookupResponse>> GetLookupResponses(
+      const RequestContext& request_context,
+      const std::vector<ShardLookupInput>& shard_lookup_inputs,
+      absl::FunctionRef<absl::StatusOr<InternalLookupResponse>(
+          const ShardLookupInput& lookup_input)>
+          get_local_response) const {
+    TraceSpan span(request_context.GetTrace(), "ShardedLookupFanOut");
+    span.SetAttribute("num_shards", num_shards_);
+    std::vector<RemoteLookupClient*> clients(num_shards_, nullptr);
+    auto lookups = std::make_shared<RemoteLookups>(num_shards_);
     for (int shard_num = 0; shard_num < num_shards_; shard_num++) {
-      auto& shard_lookup_input = shard_lookup_inputs[shard_num];
       LogIfError(request_context.GetUdfRequestMetricsContext()
                      .AccumulateMetric<kShardedLookupKeyCountByShard>(
-                         (int)shard_lookup_input.keys.size(),
-                         std::to_string(shard_num)));
+                         (int)shard_lookup_inputs[shard_num].keys.size(),
+                         shard_partitions_[shard_num]));
       if (shard_num == current_shard_num_) {
-        // Eventually this whole branch will go away.
-        responses.push_back(std::async(std::launch::async, get_local_future,
-                                       std::ref(shard_lookup_input.keys)));
-      } else {
-        const auto client = shard_manager_.Get(shard_num);
-        if (client == nullptr) {
-          LogUdfRequestErrorMetric(
-              request_context.GetUdfRequestMetricsContext(),
-              kLookupClientMissing);
-          return absl::InternalError("Internal lookup client is unavailable.");
+        continue;
+      }
+      if (padding_options_.skip_empty_shards &&
+          shard_lookup_inputs[shard_num].keys.empty() &&
+          shard_lookup_inputs[shard_num].queries.empty()) {
+        lookups->SetDone(shard_num, InternalLookupResponse());
+        continue;
+      }
+      clients[shard_num] = shard_manager_.Get(shard_num);
+      if (clients[shard_num] == nullptr) {
+        LogUdfRequestErrorMetric(request_context.GetUdfRequestMetricsContext(),
+                                 kLookupClientMissing);
+        lookups->SetDone(
+            shard_num,
+            absl::InternalError("Internal lookup client is unavailable."));
+      }
+    }
+    const absl::Time start = absl::Now();
+    for (int shard_num = 0; shard_num < num_shards_; shard_num++) {
+      if (clients[shard_num] != nullptr) {
+        ScheduleRemoteLookup(lookups, shard_num, *clients[shard_num],
+                             request_context, shard_lookup_inputs[shard_num]);
+      }
+    }
+    // Eventually this will go away.
+    TraceSpan local_span(request_context.GetTrace(), "LocalShardLookup");
+    auto local_response =
+        get_local_response(shard_lookup_inputs[current_shard_num_]);
+    local_span.End();
+    if (hedge_delay_ != nullptr) {
+      HedgeRemoteLookups(lookups, clients, request_context, shard_lookup_inputs,
+                         std::min(start + hedge_delay_->Get(),
+                                  request_context.GetDeadline()));
+    }
+    std::vector<grpc::ClientContext*> contexts;
+    {
+      absl::MutexLock lock(&lookups->mutex);
+      lookups->mutex.AwaitWithDeadline(
+          absl::Condition(lookups.get(), &RemoteLookups::AllDone),
+          request_context.GetDeadline());
+      for (int shard_num = 0; shard_num < num_shards_; shard_num++) {
+        if (shard_num != current_shard_num_ && !lookups->done[shard_num]) {
+          lookups->responses[shard_num] =
+              absl::DeadlineExceededError("Remote lookup deadline exceeded.");
+          lookups->done[shard_num] = true;
+          lookups->pending--;
         }
-        responses.push_back(std::async(
-            std::launch::async,
-            [client, &request_context](std::string_view serialized_request,
-                                       int32_t padding) {
-              return client->GetValues(request_context, serialized_request,
-                                       padding);
-            },
-            shard_lookup_input.serialized_request, shard_lookup_input.padding));
+      }
+      // No lookups are started once all shards are done.
+      for (auto& context : lookups->contexts) {
+        contexts.push_back(&context);
       }
     }
+    // Without the lock, as cancelling may run the callbacks of the lookups.
+    for (grpc::ClientContext* context : contexts) {
+      context->TryCancel();
+    }
+    absl::MutexLock lock(&lookups->mutex);
+    lookups->mutex.Await(
+        absl::Condition(lookups.get(), &RemoteLookups::NoneRunning));
+    std::vector<absl::StatusOr<InternalLookupResponse>> responses =
+        std::move(lookups->responses);
+    responses[current_shard_num_] = std::move(local_response);
     return responses;
   }
 
+  // Waits until all remote lookups are done or `hedge_time`, and then sends the
+  // lookups that are not done to another replica of their shard.
+  void HedgeRemoteLookups(
+      const std::shared_ptr<RemoteLookups>& lookups,
+      const std::vector<RemoteLookupClient*>& clients,
+      const RequestContext& request_context,
+      const std::vector<ShardLookupInput>& shard_lookup_inputs,
+      absl::Time hedge_time) const {
+    std::vector<int> slow_shards;
+    {
+      absl::MutexLock lock(&lookups->mutex);
+      if (lookups->mutex.AwaitWithDeadline(
+              absl::Condition(lookups.get(), &RemoteLookups::AllDone),
+              hedge_time)) {
+        return;
+      }
+      for (int shard_num = 0; shard_num < num_shards_; shard_num++) {
+        if (shard_num != current_shard_num_ && !lookups->done[shard_num]) {
+          slow_shards.push_back(shard_num);
+        }
+      }
+    }
+    for (int shard_num : slow_shards) {
+      const RemoteLookupClient* other_client =
+          shard_manager_.GetOtherReplica(shard_num, *clients[shard_num]);
+      if (other_client == nullptr) {
+        continue;
+      }
+      LogIfError(KVServerContextMap()
+                     ->SafeMetric()
+                     .LogUpDownCounter<kShardedLookupHedgedLookupCount>(1));
+      ScheduleRemoteLookup(lookups, shard_num, *other_client, request_context,
+                           shard_lookup_inputs[shard_num]);
+    }
+  }
+
   absl::StatusOr<InternalLookupResponse> GetLocalValues(
       const RequestContext& request_context,
       const std::vector<std::string_view>& key_list) const {
-    InternalLookupResponse response;
+    if (key_list.empty()) {
+      InternalLookupResponse response;
+      return response;
+    }
     absl::flat_hash_set<std::string_view> keys(key_list.begin(),
                                                key_list.end());
     return local_lookup_.GetKeyValues(request_context, keys);
@@ -306,22 +835,48 @@ class ShardedLookup : public Lookup {
 
   absl::StatusOr<InternalLookupResponse> GetLocalKeyValuesSet(
       const RequestContext& request_context,
-      const std::vector<std::string_view>& key_list) const {
-    if (key_list.empty()) {
-      InternalLookupResponse response;
-      return response;
+      const ShardLookupInput& lookup_input) const {
+    InternalLookupResponse response;
+    if (!lookup_input.keys.empty()) {
+      auto key_value_set_result =
+          GetLocalKeyValuesSet(request_context, lookup_input.keys);
+      if (!key_value_set_result.ok()) {
+        return key_value_set_result.status();
+      }
+      response = *std::move(key_value_set_result);
+    }
+    for (const auto& query : lookup_input.queries) {
+      AddQueryResult(local_lookup_, request_context, query, response);
     }
+    return response;
+  }
 
-    // We have this conversion, because of the inconsistency how we look up
-    // keys in Cache -- GetKeyValuePairs vs GetKeyValueSet. GetKeyValuePairs
-    // should be refactored to flat_hash_set, and then this can be fixed.
-    // Additionally, this whole local branch will go away once we have a
-    // a sepration between UDF and Data servers.
+  absl::StatusOr<InternalLookupResponse> GetLocalKeyValuesSet(
+      const RequestContext& request_context,
+      const std::vector<std::string_view>& key_list) const {
+    // The keys of every shard are bucketed into vectors, which the remote
+    // shards serialize into their requests, while lookups take sets. The
+    // cache hashes the keys once more to probe its maps. This whole local
+    // branch will go away once the UDF and data servers are separated.
     absl::flat_hash_set<std::string_view> key_list_set(key_list.begin(),
                                                        key_list.end());
     return local_lookup_.GetKeyValueSet(request_context, key_list_set);
   }
 
+  absl::StatusOr<InternalLookupResponse> GetLocalKeyValueSetSizes(
+      const RequestContext& request_context,
+      const std::vector<std::string_view>& key_list) const {
+    if (key_list.empty()) {
+      InternalLookupResponse response;
+      return response;
+    }
+    absl::flat_hash_set<std::string_view> keys(key_list.begin(),
+                                               key_list.end());
+    return local_lookup_.GetKeyValueSetSizes(request_context, keys);
+  }
+
+  // Keys already looked up for the request are taken from its lookup cache,
+  // and only the other keys are sent to the shards.
   absl::StatusOr<InternalLookupResponse> ProcessShardedKeys(
       const RequestContext& request_context,
       const absl::flat_hash_set<std::string_view>& keys) const {
@@ -329,20 +884,24 @@ class ShardedLookup : public Lookup {
     if (keys.empty()) {
       return response;
     }
-    const auto shard_lookup_inputs = ShardKeys(keys, false);
-    auto responses =
-        GetLookupFutures(request_context, shard_lookup_inputs,
-                         [this, &request_context](
-                             const std::vector<std::string_view>& key_list) {
-                           return GetLocalValues(request_context, key_list);
-                         });
-    if (!responses.ok()) {
-      return responses.status();
+    RequestLookupCache& lookup_cache = request_context.GetLookupCache();
+    const absl::flat_hash_set<std::string_view> missing_keys =
+        lookup_cache.GetValues(keys, response);
+    LogRequestLookupCacheAccesses(request_context, keys.size(),
+                                  missing_keys.size());
+    if (missing_keys.empty()) {
+      return response;
     }
+    const auto shard_lookup_inputs = ShardKeys(missing_keys, false);
+    auto responses = GetLookupResponses(
+        request_context, shard_lookup_inputs,
+        [this, &request_context](const ShardLookupInput& lookup_input) {
+          return GetLocalValues(request_context, lookup_input.keys);
+        });
     // process responses
     for (int shard_num = 0; shard_num < num_shards_; shard_num++) {
       auto& shard_lookup_input = shard_lookup_inputs[shard_num];
-      auto result = (*responses)[shard_num].get();
+      auto& result = responses[shard_num];
       if (!result.ok()) {
         // mark all keys as internal failure
         LogUdfRequestErrorMetric(request_context.GetUdfRequestMetricsContext(),
@@ -350,93 +909,267 @@ class ShardedLookup : public Lookup {
         SetRequestFailed(shard_lookup_input.keys, response);
         continue;
       }
+      if (!result->compact_kv_pairs().empty()) {
+        const auto compact_results =
+            CompactLookupResult::Parse(result->compact_kv_pairs());
+        if (!compact_results.ok()) {
+          LOG(ERROR) << "Invalid response of shard " << shard_num << ": "
+                     << compact_results.status();
+          LogUdfRequestErrorMetric(
+              request_context.GetUdfRequestMetricsContext(),
+              kShardedKeyValueRequestFailure);
+          SetRequestFailed(shard_lookup_input.keys, response);
+          continue;
+        }
+        UpdateResponse(shard_lookup_input.keys, *compact_results, response);
+        continue;
+      }
       auto kv_pairs = result->mutable_kv_pairs();
       UpdateResponse(shard_lookup_input.keys, *kv_pairs, response);
     }
+    for (const auto& shard_lookup_input : shard_lookup_inputs) {
+      SetNotFound(shard_lookup_input.skipped_keys, response);
+    }
+    lookup_cache.PutValues(missing_keys, response);
     return response;
   }
 
-  void CollectKeySets(
-      const RequestContext& request_context,
-      absl::flat_hash_map<std::string, absl::flat_hash_set<std::string>>&
-          key_sets,
-      InternalLookupResponse& keysets_lookup_response) const {
-    for (auto& [key, keyset_lookup_result] :
-         (*(keysets_lookup_response.mutable_kv_pairs()))) {
+  // Takes ownership of `keysets_lookup_response`, so that the collected key
+  // sets are views of its values instead of copies. The results of pushed
+  // down queries go to `query_sets`, by query, unless the query failed.
+  // Results in the compact format are read in place, without decoding them
+  // into protos. Returns an error if they are invalid.
+  absl::Status CollectKeySets(
+      const RequestContext& request_context, ShardKeySets& key_sets,
+      ShardKeySets& query_sets,
+      InternalLookupResponse keysets_lookup_response) const {
+    auto response = std::make_shared<const InternalLookupResponse>(
+        std::move(keysets_lookup_response));
+    for (const auto& [query, query_result] : response->query_results()) {
+      if (query_result.has_keyset_values()) {
+        ShardKeySet& query_set = query_sets[query];
+        query_set.response = response;
+        query_set.values.insert(query_result.keyset_values().values().begin(),
+                                query_result.keyset_values().values().end());
+      }
+    }
+    if (!response->compact_kv_pairs().empty()) {
+      const auto compact_results =
+          CompactLookupResult::Parse(response->compact_kv_pairs());
+      if (!compact_results.ok()) {
+        return compact_results.status();
+      }
+      for (size_t i = 0; i < compact_results->size(); i++) {
+        if (!compact_results->IsKeysetValues(i)) {
+          continue;
+        }
+        ShardKeySet key_set{.response = response};
+        compact_results->ForEachKeysetValue(
+            i, [&key_set](std::string_view v) { key_set.values.emplace(v); });
+        AddKeySet(request_context, compact_results->key(i), std::move(key_set),
+                  key_sets);
+      }
+      return absl::OkStatus();
+    }
+    for (const auto& [key, keyset_lookup_result] : response->kv_pairs()) {
       switch (keyset_lookup_result.single_lookup_result_case()) {
         case SingleLookupResult::kStatusFieldNumber:
           // this means it wasn't found, no need to insert an empty set.
           break;
         case SingleLookupResult::kKeysetValuesFieldNumber:
-          absl::flat_hash_set<std::string> value_set;
-          for (auto& v : keyset_lookup_result.keyset_values().values()) {
+          ShardKeySet key_set{.response = response};
+          for (const auto& v : keyset_lookup_result.keyset_values().values()) {
             VLOG(8) << "keyset name: " << key << " value: " << v;
-            value_set.emplace(std::move(v));
-          }
-          auto [_, inserted] =
-              key_sets.insert_or_assign(key, std::move(value_set));
-          if (!inserted) {
-            LogUdfRequestErrorMetric(
-                request_context.GetUdfRequestMetricsContext(),
-                kShardedKeyCollisionOnKeySetCollection);
-            LOG(ERROR) << "Key collision, when collecting results from shards: "
-                       << key;
+            key_set.values.emplace(v);
           }
+          AddKeySet(request_context, key, std::move(key_set), key_sets);
           break;
       }
     }
+    return absl::OkStatus();
   }
 
-  absl::StatusOr<
-      absl::flat_hash_map<std::string, absl::flat_hash_set<std::string>>>
-  GetShardedKeyValueSet(
+  void AddKeySet(const RequestContext& request_context, std::string_view key,
+                 ShardKeySet key_set, ShardKeySets& key_sets) const {
+    auto [_, inserted] = key_sets.insert_or_assign(key, std::move(key_set));
+    if (!inserted) {
+      LogUdfRequestErrorMetric(request_context.GetUdfRequestMetricsContext(),
+                               kShardedKeyCollisionOnKeySetCollection);
+      LOG(ERROR) << "Key collision, when collecting results from shards: "
+                 << key;
+    }
+  }
+
+  absl::StatusOr<ShardKeySets> GetShardedKeyValueSet(
       const RequestContext& request_context,
       const absl::flat_hash_set<std::string_view>& key_set) const {
-    const auto shard_lookup_inputs = ShardKeys(key_set, true);
-    auto responses = GetLookupFutures(
+    ShardKeySets query_sets;
+    return GetShardedKeyValueSet(request_context, key_set, /*shard_queries=*/{},
+                                 query_sets);
+  }
+
+  // Same as above, also running `shard_queries[i]` on shard `i`, and adding
+  // their results to `query_sets`.
+  absl::StatusOr<ShardKeySets> GetShardedKeyValueSet(
+      const RequestContext& request_context,
+      const absl::flat_hash_set<std::string_view>& key_set,
+      std::vector<std::vector<std::string>> shard_queries,
+      ShardKeySets& query_sets) const {
+    ShardKeySets key_sets;
+    RequestLookupCache& lookup_cache = request_context.GetLookupCache();
+    const absl::flat_hash_set<std::string_view> missing_keys =
+        lookup_cache.GetKeySets(key_set, key_sets);
+    LogRequestLookupCacheAccesses(request_context, key_set.size(),
+                                  missing_keys.size());
+    const bool has_queries =
+        std::any_of(shard_queries.begin(), shard_queries.end(),
+                    [](const auto& queries) { return !queries.empty(); });
+    if (missing_keys.empty() && !has_queries) {
+      return key_sets;
+    }
+    const auto shard_lookup_inputs =
+        ShardKeys(missing_keys, true, std::move(shard_queries));
+    auto responses = GetLookupResponses(
         request_context, shard_lookup_inputs,
-        [this,
-         &request_context](const std::vector<std::string_view>& key_list) {
-          return GetLocalKeyValuesSet(request_context, key_list);
+        [this, &request_context](const ShardLookupInput& lookup_input) {
+          return GetLocalKeyValuesSet(request_context, lookup_input);
         });
-    if (!responses.ok()) {
-      LogUdfRequestErrorMetric(request_context.GetUdfRequestMetricsContext(),
-                               kLookupClientMissing);
-      return responses.status();
-    }
     // process responses
-    absl::flat_hash_map<std::string, absl::flat_hash_set<std::string>> key_sets;
     for (int shard_num = 0; shard_num < num_shards_; shard_num++) {
-      auto& shard_lookup_input = shard_lookup_inputs[shard_num];
-      auto result = (*responses)[shard_num].get();
+      auto& result = responses[shard_num];
       if (!result.ok()) {
         LogUdfRequestErrorMetric(request_context.GetUdfRequestMetricsContext(),
                                  kShardedKeyValueSetRequestFailure);
         return result.status();
       }
-      CollectKeySets(request_context, key_sets, *result);
+      if (const absl::Status status = CollectKeySets(
+              request_context, key_sets, query_sets, *std::move(result));
+          !status.ok()) {
+        LOG(ERROR) << "Invalid response of shard " << shard_num << ": "
+                   << status;
+        LogUdfRequestErrorMetric(request_context.GetUdfRequestMetricsContext(),
+                                 kShardedKeyValueSetRequestFailure);
+        return status;
+      }
     }
+    lookup_cache.PutKeySets(missing_keys, key_sets);
     return key_sets;
   }
 
+  // Returns the number of values of the sets of `keys`, which the shards send
+  // back instead of the values. Keys without a set are left out. Each set is
+  // on one shard, so the sizes are exact at the time of the lookup.
+  absl::StatusOr<SetSizes> GetShardedSetSizes(
+      const RequestContext& request_context,
+      const absl::flat_hash_set<std::string_view>& keys) const {
+    SetSizes set_sizes;
+    if (keys.empty()) {
+      return set_sizes;
+    }
+    const auto shard_lookup_inputs =
+        ShardKeys(keys, /*lookup_sets=*/true, /*shard_queries=*/{},
+                  /*lookup_set_sizes=*/true);
+    auto responses = GetLookupResponses(
+        request_context, shard_lookup_inputs,
+        [this, &request_context](const ShardLookupInput& lookup_input) {
+          return GetLocalKeyValueSetSizes(request_context, lookup_input.keys);
+        });
+    for (int shard_num = 0; shard_num < num_shards_; shard_num++) {
+      const auto& result = responses[shard_num];
+      if (!result.ok()) {
+        LogUdfRequestErrorMetric(request_context.GetUdfRequestMetricsContext(),
+                                 kShardedKeyValueSetRequestFailure);
+        return result.status();
+      }
+      const std::vector<std::string_view>& shard_keys =
+          shard_lookup_inputs[shard_num].keys;
+      // Servers that do not support set sizes send the sets, in the compact
+      // format if they support that.
+      if (!result->compact_kv_pairs().empty()) {
+        const auto compact_results =
+            CompactLookupResult::Parse(result->compact_kv_pairs());
+        if (!compact_results.ok()) {
+          LOG(ERROR) << "Invalid response of shard " << shard_num << ": "
+                     << compact_results.status();
+          LogUdfRequestErrorMetric(
+              request_context.GetUdfRequestMetricsContext(),
+              kShardedKeyValueSetRequestFailure);
+          return compact_results.status();
+        }
+        for (const std::string_view key : shard_keys) {
+          if (const std::optional<size_t> i = compact_results->Find(key);
+              i.has_value()) {
+            set_sizes.emplace(key, SetSize(compact_results->Result(*i)));
+          }
+        }
+        continue;
+      }
+      for (const std::string_view key : shard_keys) {
+        if (const auto it = result->kv_pairs().find(key);
+            it != result->kv_pairs().end()) {
+          set_sizes.emplace(key, SetSize(it->second));
+        }
+      }
+    }
+    return set_sizes;
+  }
+
   const Lookup& local_lookup_;
   const int32_t num_shards_;
   const int32_t current_shard_num_;
+  // Metric partitions of the shards, indexed by shard number, so that they are
+  // not formatted for every request.
+  std::vector<std::string> shard_partitions_;
   const std::string hashing_seed_;
   const ShardManager& shard_manager_;
+  // Parsed queries shared by all requests.
+  mutable QueryCache query_cache_;
   KeySharder key_sharder_;
+  // Shared with the other sharded lookups of the server.
+  std::shared_ptr<ThreadPool> executor_;
+  // Null if hedging is disabled.
+  std::unique_ptr<HedgeDelay> hedge_delay_;
+  const PaddingOptions padding_options_;
+  const bool query_pushdown_;
+  // Null if keys are sent to their shards without filtering.
+  const ShardKeyFilters* key_filters_;
+  const int32_t compress_response_min_bytes_;
+  const bool plan_queries_with_set_sizes_;
 };
 
 }  // namespace
 
-std::unique_ptr<Lookup> CreateShardedLookup(const Lookup& local_lookup,
-                                            const int32_t num_shards,
-                                            const int32_t current_shard_num,
-                                            const ShardManager& shard_manager,
-                                            KeySharder key_sharder) {
-  return std::make_unique<ShardedLookup>(local_lookup, num_shards,
-                                         current_shard_num, shard_manager,
-                                         std::move(key_sharder));
+std::shared_ptr<ThreadPool> CreateShardedLookupExecutor(int32_t num_shards) {
+  return std::make_shared<ThreadPool>(
+      std::max(1, kExecutorThreadsPerRemoteShard * (num_shards - 1)),
+      [](int64_t queue_depth, absl::Duration queue_wait) {
+        LogIfError(KVServerContextMap()
+                       ->SafeMetric()
+                       .LogHistogram<kShardedLookupExecutorQueueDepth>(
+                           static_cast<double>(queue_depth)));
+        LogIfError(
+            KVServerContextMap()
+                ->SafeMetric()
+                .LogHistogram<kShardedLookupExecutorQueueLatencyInMicros>(
+                    absl::ToDoubleMicroseconds(queue_wait)));
+      });
+}
+
+std::unique_ptr<Lookup> CreateShardedLookup(
+    const Lookup& local_lookup, const int32_t num_shards,
+    const int32_t current_shard_num, const ShardManager& shard_manager,
+    KeySharder key_sharder, std::shared_ptr<ThreadPool> executor,
+    HedgingOptions hedging_options, PaddingOptions padding_options,
+    bool query_pushdown, const ShardKeyFilters* key_filters,
+    int32_t compress_response_min_bytes, bool plan_queries_with_set_sizes) {
+  if (executor == nullptr) {
+    executor = CreateShardedLookupExecutor(num_shards);
+  }
+  return std::make_unique<ShardedLookup>(
+      local_lookup, num_shards, current_shard_num, shard_manager,
+      std::move(key_sharder), std::move(executor), hedging_options,
+      padding_options, query_pushdown, key_filters,
+      compress_response_min_bytes, plan_queries_with_set_sizes);
 }
 
 }  // namespace kv_server
@@ -20,17 +20,70 @@
 #include <memory>
 #include <string>
 
+#include "absl/time/time.h"
+
 #include "components/internal_server/lookup.h"
+#include "components/internal_server/shard_key_filters.h"
 #include "components/sharding/shard_manager.h"
+#include "components/util/thread_pool.h"
 #include "public/sharding/key_sharder.h"
 
 namespace kv_server {
 
-std::unique_ptr<Lookup> CreateShardedLookup(const Lookup& local_lookup,
-                                            const int32_t num_shards,
-                                            const int32_t current_shard_num,
-                                            const ShardManager& shard_manager,
-                                            KeySharder key_sharder);
+struct HedgingOptions {
+  // Percentile of recent remote lookup latencies after which a remote lookup
+  // that hasn't finished is also sent to another replica of its shard. The
+  // first successful response is used. 0 disables hedging.
+  int32_t delay_percentile = 0;
+  // Delay used until enough latencies are known.
+  absl::Duration initial_delay = absl::Milliseconds(10);
+};
+
+struct PaddingOptions {
+  // Whether shards that none of the keys of a lookup map to are not sent a
+  // request. This saves remote calls, but reveals to the network and to the
+  // remote shards which shards the keys of a request map to, so it should
+  // only be enabled for data that is not sensitive or in trusted deployments.
+  bool skip_empty_shards = false;
+  // If positive, the requests to remote shards are padded to a multiple of
+  // this many bytes. All requests are padded to the same length, unless empty
+  // shards are skipped, in which case each request is padded on its own. 0
+  // pads all requests to the length of the longest one.
+  int32_t bucket_size = 0;
+};
+
+// Creates the thread pool that sends the lookups to remote shards, sized for
+// `num_shards` and reporting its queue depth and queue latency as safe metrics.
+// One executor can be shared by all sharded lookups of a server.
+std::shared_ptr<ThreadPool> CreateShardedLookupExecutor(int32_t num_shards);
+
+// Lookups for remote shards run on `executor`, and the lookup for the current
+// shard runs on the calling thread. If `executor` is null, the sharded lookup
+// creates its own with `CreateShardedLookupExecutor`. Remote lookups that
+// haven't finished by the deadline of the request context fail with
+// `DeadlineExceeded`. If `query_pushdown` is true, `RunQuery` sends the parts
+// of a query whose sets are all on one shard to that shard, which returns
+// their result instead of the sets. All shards must support pushed down
+// queries. If `key_filters` is not null, keys that the filter of their shard
+// does not have are not sent to the shard and are not found. `key_filters`
+// must outlive the sharded lookup. If `compress_response_min_bytes` is
+// positive, remote shards compress their responses of at least that many
+// bytes, which trades their CPU for network bandwidth on large key sets. If
+// `plan_queries_with_set_sizes` is true, `RunQuery` first asks the shards for
+// the sizes of the sets of a query, which order its plan, and only fetches
+// the sets that intersections and differences with an empty operand still
+// need. This costs one more round trip per query, and saves fetching sets
+// that do not change the result. It does not apply to pushed down queries.
+// `APPROX_COUNT(...)` queries only fetch the sizes of the sets either way.
+std::unique_ptr<Lookup> CreateShardedLookup(
+    const Lookup& local_lookup, const int32_t num_shards,
+    const int32_t current_shard_num, const ShardManager& shard_manager,
+    KeySharder key_sharder, std::shared_ptr<ThreadPool> executor = nullptr,
+    HedgingOptions hedging_options = HedgingOptions(),
+    PaddingOptions padding_options = PaddingOptions(),
+    bool query_pushdown = false, const ShardKeyFilters* key_filters = nullptr,
+    int32_t compress_response_min_bytes = 0,
+    bool plan_queries_with_set_sizes = false);
 
 }  // namespace kv_server
 
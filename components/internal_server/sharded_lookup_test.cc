@@ -14,13 +14,20 @@
 
 #include "components/internal_server/sharded_lookup.h"
 
+#include <atomic>
 #include <memory>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
 #include "components/data_server/cache/mocks.h"
+#include "components/internal_server/compact_lookup_result.h"
+#include "components/internal_server/key_filter.h"
 #include "components/internal_server/mocks.h"
+#include "components/internal_server/shard_key_filters.h"
 #include "components/sharding/mocks.h"
 #include "gmock/gmock.h"
 #include "google/protobuf/text_format.h"
@@ -81,6 +88,7 @@ TEST_F(ShardedLookupTest, GetKeyValues_Success) {
         InternalLookupRequest request;
         request.mutable_keys()->Assign(key_list_remote.begin(),
                                        key_list_remote.end());
+        request.set_result_format(LOOKUP_RESULT_FORMAT_COMPACT_V1);
         const std::string serialized_request = request.SerializeAsString();
         EXPECT_CALL(*mock_remote_lookup_client_1,
                     GetValues(_, serialized_request, 0))
@@ -115,6 +123,326 @@ TEST_F(ShardedLookupTest, GetKeyValues_Success) {
   EXPECT_THAT(response.value(), EqualsProto(expected));
 }
 
+TEST_F(ShardedLookupTest, GetKeyValues_CompactResults_Success) {
+  InternalLookupResponse local_lookup_response;
+  TextFormat::ParseFromString(R"pb(kv_pairs {
+                                     key: "key4"
+                                     value { value: "value4" }
+                                   }
+                              )pb",
+                              &local_lookup_response);
+  EXPECT_CALL(mock_local_lookup_, GetKeyValues(_, _))
+      .WillOnce(Return(local_lookup_response));
+
+  std::vector<absl::flat_hash_set<std::string>> cluster_mappings;
+  for (int i = 0; i < 2; i++) {
+    cluster_mappings.push_back({std::to_string(i)});
+  }
+  auto shard_manager = ShardManager::Create(
+      num_shards_, std::move(cluster_mappings),
+      std::make_unique<MockRandomGenerator>(), [](const std::string& ip) {
+        if (ip != "1") {
+          return std::make_unique<MockRemoteLookupClient>();
+        }
+
+        auto mock_remote_lookup_client_1 =
+            std::make_unique<MockRemoteLookupClient>();
+        EXPECT_CALL(*mock_remote_lookup_client_1, GetValues(_, _, 0))
+            .WillOnce([&]() {
+              InternalLookupResponse remote_response;
+              (*remote_response.mutable_kv_pairs())["key1"].set_value(
+                  "value1");
+              InternalLookupResponse resp;
+              resp.set_compact_kv_pairs(
+                  CompactLookupResult::Encode(remote_response.kv_pairs()));
+              return resp;
+            });
+
+        return mock_remote_lookup_client_1;
+      });
+  auto sharded_lookup =
+      CreateShardedLookup(mock_local_lookup_, num_shards_, shard_num_,
+                          *(*shard_manager), key_sharder_);
+  auto response = sharded_lookup->GetKeyValues(GetRequestContext(),
+                                               {"key1", "key3", "key4"});
+  EXPECT_TRUE(response.ok());
+
+  InternalLookupResponse expected;
+  TextFormat::ParseFromString(R"pb(kv_pairs {
+                                     key: "key1"
+                                     value { value: "value1" }
+                                   }
+                                   kv_pairs {
+                                     key: "key3"
+                                     value { status { code: 5 } }
+                                   }
+                                   kv_pairs {
+                                     key: "key4"
+                                     value { value: "value4" }
+                                   }
+                              )pb",
+                              &expected);
+  EXPECT_THAT(response.value(), EqualsProto(expected));
+}
+
+TEST_F(ShardedLookupTest, GetKeyValues_CompressResponses_SetsMinBytes) {
+  EXPECT_CALL(mock_local_lookup_, GetKeyValues(_, _))
+      .WillOnce(Return(InternalLookupResponse()));
+
+  std::vector<absl::flat_hash_set<std::string>> cluster_mappings;
+  for (int i = 0; i < 2; i++) {
+    cluster_mappings.push_back({std::to_string(i)});
+  }
+  auto shard_manager = ShardManager::Create(
+      num_shards_, std::move(cluster_mappings),
+      std::make_unique<MockRandomGenerator>(), [](const std::string& ip) {
+        if (ip != "1") {
+          return std::make_unique<MockRemoteLookupClient>();
+        }
+
+        auto mock_remote_lookup_client_1 =
+            std::make_unique<MockRemoteLookupClient>();
+        InternalLookupRequest request;
+        request.add_keys("key1");
+        request.set_result_format(LOOKUP_RESULT_FORMAT_COMPACT_V1);
+        request.set_compress_response_min_bytes(1024);
+        const std::string serialized_request = request.SerializeAsString();
+        EXPECT_CALL(*mock_remote_lookup_client_1,
+                    GetValues(_, serialized_request, 0))
+            .WillOnce(Return(InternalLookupResponse()));
+
+        return mock_remote_lookup_client_1;
+      });
+  auto sharded_lookup = CreateShardedLookup(
+      mock_local_lookup_, num_shards_, shard_num_, *(*shard_manager),
+      key_sharder_, /*executor=*/nullptr, HedgingOptions(), PaddingOptions(),
+      /*query_pushdown=*/false, /*key_filters=*/nullptr,
+      /*compress_response_min_bytes=*/1024);
+  auto response =
+      sharded_lookup->GetKeyValues(GetRequestContext(), {"key1", "key4"});
+  EXPECT_TRUE(response.ok());
+}
+
+TEST_F(ShardedLookupTest, GetKeyValues_KeyFilterSkipsMissingKeys) {
+  InternalLookupResponse local_lookup_response;
+  TextFormat::ParseFromString(R"pb(kv_pairs {
+                                     key: "key4"
+                                     value { value: "value4" }
+                                   }
+                              )pb",
+                              &local_lookup_response);
+  EXPECT_CALL(mock_local_lookup_, GetKeyValues(_, _))
+      .WillOnce(Return(local_lookup_response));
+
+  std::vector<absl::flat_hash_set<std::string>> cluster_mappings;
+  for (int i = 0; i < 2; i++) {
+    cluster_mappings.push_back({std::to_string(i)});
+  }
+  auto shard_manager = ShardManager::Create(
+      num_shards_, std::move(cluster_mappings),
+      std::make_unique<MockRandomGenerator>(), [](const std::string& ip) {
+        auto mock_remote_lookup_client =
+            std::make_unique<MockRemoteLookupClient>();
+        if (ip != "1") {
+          return mock_remote_lookup_client;
+        }
+        // Shard 1 has no keys, so "key1" is not sent to it.
+        EXPECT_CALL(*mock_remote_lookup_client, GetKeyFilter(_))
+            .WillOnce(Return(KeyFilter::Build({}, 10).proto()));
+        InternalLookupRequest request;
+        request.set_result_format(LOOKUP_RESULT_FORMAT_COMPACT_V1);
+        EXPECT_CALL(*mock_remote_lookup_client,
+                    GetValues(_, request.SerializeAsString(), _))
+            .WillOnce(Return(InternalLookupResponse()));
+        return mock_remote_lookup_client;
+      });
+  ShardKeyFilters key_filters(num_shards_, shard_num_, **shard_manager);
+  key_filters.Refresh(absl::Seconds(1));
+  auto sharded_lookup = CreateShardedLookup(
+      mock_local_lookup_, num_shards_, shard_num_, **shard_manager,
+      key_sharder_, /*executor=*/nullptr, HedgingOptions(), PaddingOptions(),
+      /*query_pushdown=*/false, &key_filters);
+  auto response =
+      sharded_lookup->GetKeyValues(GetRequestContext(), {"key1", "key4"});
+  ASSERT_TRUE(response.ok());
+
+  InternalLookupResponse expected;
+  TextFormat::ParseFromString(R"pb(kv_pairs {
+                                     key: "key1"
+                                     value { status { code: 5 } }
+                                   }
+                                   kv_pairs {
+                                     key: "key4"
+                                     value { value: "value4" }
+                                   }
+                              )pb",
+                              &expected);
+  EXPECT_THAT(response.value(), EqualsProto(expected));
+}
+
+TEST_F(ShardedLookupTest, GetKeyValues_ReplicatedKeysAreLookedUpLocally) {
+  InternalLookupResponse local_lookup_response;
+  TextFormat::ParseFromString(R"pb(kv_pairs {
+                                     key: "key1"
+                                     value { value: "value1" }
+                                   }
+                                   kv_pairs {
+                                     key: "key4"
+                                     value { value: "value4" }
+                                   }
+                              )pb",
+                              &local_lookup_response);
+  EXPECT_CALL(mock_local_lookup_,
+              GetKeyValues(_, testing::UnorderedElementsAre("key1", "key4")))
+      .WillOnce(Return(local_lookup_response));
+
+  std::vector<absl::flat_hash_set<std::string>> cluster_mappings;
+  for (int i = 0; i < 2; i++) {
+    cluster_mappings.push_back({std::to_string(i)});
+  }
+  auto shard_manager = ShardManager::Create(
+      num_shards_, std::move(cluster_mappings),
+      std::make_unique<MockRandomGenerator>(), [](const std::string& ip) {
+        auto mock_remote_lookup_client =
+            std::make_unique<MockRemoteLookupClient>();
+        if (ip != "1") {
+          return mock_remote_lookup_client;
+        }
+        // "key1" belongs to shard 1, but is replicated.
+        InternalLookupRequest request;
+        request.set_result_format(LOOKUP_RESULT_FORMAT_COMPACT_V1);
+        EXPECT_CALL(*mock_remote_lookup_client,
+                    GetValues(_, request.SerializeAsString(), _))
+            .WillOnce(Return(InternalLookupResponse()));
+        return mock_remote_lookup_client;
+      });
+  auto sharded_lookup = CreateShardedLookup(
+      mock_local_lookup_, num_shards_, shard_num_, **shard_manager,
+      KeySharder(ShardingFunction{/*seed=*/""}, std::nullopt, {"key1"}));
+  auto response =
+      sharded_lookup->GetKeyValues(GetRequestContext(), {"key1", "key4"});
+  ASSERT_TRUE(response.ok());
+  EXPECT_THAT(response.value(), EqualsProto(local_lookup_response));
+}
+
+TEST_F(ShardedLookupTest, GetKeyValues_SharedExecutor_Success) {
+  std::thread::id local_thread;
+  std::thread::id remote_thread;
+  EXPECT_CALL(mock_local_lookup_, GetKeyValues(_, _))
+      .Times(2)
+      .WillRepeatedly([&local_thread]() {
+        local_thread = std::this_thread::get_id();
+        return InternalLookupResponse();
+      });
+
+  std::vector<absl::flat_hash_set<std::string>> cluster_mappings;
+  for (int i = 0; i < 2; i++) {
+    cluster_mappings.push_back({std::to_string(i)});
+  }
+  auto shard_manager = ShardManager::Create(
+      num_shards_, std::move(cluster_mappings),
+      std::make_unique<MockRandomGenerator>(),
+      [&remote_thread](const std::string& ip) {
+        auto mock_remote_lookup_client =
+            std::make_unique<MockRemoteLookupClient>();
+        if (ip == "1") {
+          EXPECT_CALL(*mock_remote_lookup_client, GetValues(_, _, _))
+              .Times(2)
+              .WillRepeatedly([&remote_thread]() {
+                remote_thread = std::this_thread::get_id();
+                return InternalLookupResponse();
+              });
+        }
+        return mock_remote_lookup_client;
+      });
+  auto executor = CreateShardedLookupExecutor(num_shards_);
+  auto sharded_lookup_1 =
+      CreateShardedLookup(mock_local_lookup_, num_shards_, shard_num_,
+                          *(*shard_manager), key_sharder_, executor);
+  auto sharded_lookup_2 =
+      CreateShardedLookup(mock_local_lookup_, num_shards_, shard_num_,
+                          *(*shard_manager), key_sharder_, executor);
+  EXPECT_TRUE(
+      sharded_lookup_1->GetKeyValues(GetRequestContext(), {"key1", "key4"})
+          .ok());
+  // Another request, so that the keys are looked up again.
+  RequestContext other_request_context(*scope_metrics_context_);
+  EXPECT_TRUE(
+      sharded_lookup_2->GetKeyValues(other_request_context, {"key1", "key4"})
+          .ok());
+  EXPECT_EQ(local_thread, std::this_thread::get_id());
+  EXPECT_NE(remote_thread, std::this_thread::get_id());
+  EXPECT_EQ(executor->QueueDepth(), 0);
+}
+
+TEST_F(ShardedLookupTest, GetKeyValues_SameRequest_LooksUpKeysOnce) {
+  InternalLookupResponse local_lookup_response;
+  TextFormat::ParseFromString(R"pb(kv_pairs {
+                                     key: "key4"
+                                     value { value: "value4" }
+                                   }
+                              )pb",
+                              &local_lookup_response);
+  EXPECT_CALL(mock_local_lookup_, GetKeyValues(_, _))
+      .WillOnce(Return(local_lookup_response));
+
+  std::vector<absl::flat_hash_set<std::string>> cluster_mappings;
+  for (int i = 0; i < 2; i++) {
+    cluster_mappings.push_back({std::to_string(i)});
+  }
+  auto shard_manager = ShardManager::Create(
+      num_shards_, std::move(cluster_mappings),
+      std::make_unique<MockRandomGenerator>(), [](const std::string& ip) {
+        auto mock_remote_lookup_client =
+            std::make_unique<MockRemoteLookupClient>();
+        if (ip != "1") {
+          return mock_remote_lookup_client;
+        }
+        for (const auto& [key, value] :
+             std::vector<std::pair<std::string, std::string>>{
+                 {"key1", "value1"}, {"key2", "value2"}}) {
+          InternalLookupRequest request;
+          request.add_keys(key);
+          request.set_result_format(LOOKUP_RESULT_FORMAT_COMPACT_V1);
+          EXPECT_CALL(*mock_remote_lookup_client,
+                      GetValues(_, request.SerializeAsString(), _))
+              .WillOnce([key = key, value = value]() {
+                InternalLookupResponse resp;
+                (*resp.mutable_kv_pairs())[key].set_value(value);
+                return resp;
+              });
+        }
+        return mock_remote_lookup_client;
+      });
+  auto sharded_lookup =
+      CreateShardedLookup(mock_local_lookup_, num_shards_, shard_num_,
+                          *(*shard_manager), key_sharder_);
+  auto response =
+      sharded_lookup->GetKeyValues(GetRequestContext(), {"key1", "key4"});
+  ASSERT_TRUE(response.ok());
+  // Only "key2" is sent to the shards.
+  response = sharded_lookup->GetKeyValues(GetRequestContext(),
+                                          {"key1", "key2", "key4"});
+  ASSERT_TRUE(response.ok());
+
+  InternalLookupResponse expected;
+  TextFormat::ParseFromString(R"pb(kv_pairs {
+                                     key: "key1"
+                                     value { value: "value1" }
+                                   }
+                                   kv_pairs {
+                                     key: "key2"
+                                     value { value: "value2" }
+                                   }
+                                   kv_pairs {
+                                     key: "key4"
+                                     value { value: "value4" }
+                                   }
+                              )pb",
+                              &expected);
+  EXPECT_THAT(response.value(), EqualsProto(expected));
+}
+
 TEST_F(ShardedLookupTest, GetKeyValues_KeyMissing_ReturnsStatus) {
   InternalLookupResponse local_lookup_response;
   TextFormat::ParseFromString(
@@ -144,6 +472,7 @@ TEST_F(ShardedLookupTest, GetKeyValues_KeyMissing_ReturnsStatus) {
         InternalLookupRequest request;
         request.mutable_keys()->Assign(key_list_remote.begin(),
                                        key_list_remote.end());
+        request.set_result_format(LOOKUP_RESULT_FORMAT_COMPACT_V1);
         const std::string serialized_request = request.SerializeAsString();
 
         EXPECT_CALL(*mock_remote_lookup_client_1, GetValues(_, _, 0))
@@ -203,29 +532,213 @@ TEST_F(ShardedLookupTest, GetKeyValues_EmptyRequest_ReturnsEmptyResponse) {
   auto shard_manager = ShardManager::Create(
       num_shards_, std::move(cluster_mappings),
       std::make_unique<MockRandomGenerator>(), [](const std::string& ip) {
-        return std::make_unique<MockRemoteLookupClient>();
+        return std::make_unique<MockRemoteLookupClient>();
+      });
+  auto sharded_lookup =
+      CreateShardedLookup(mock_local_lookup_, num_shards_, shard_num_,
+                          *(*shard_manager), key_sharder_);
+  auto response = sharded_lookup->GetKeyValues(GetRequestContext(), {});
+  EXPECT_TRUE(response.ok());
+
+  InternalLookupResponse expected;
+  EXPECT_THAT(response.value(), EqualsProto(expected));
+}
+
+TEST_F(ShardedLookupTest, GetKeyValues_FailedDownstreamRequest) {
+  InternalLookupResponse local_lookup_response;
+  TextFormat::ParseFromString(
+      R"pb(kv_pairs {
+             key: "key4"
+             value { value: "value4" }
+           }
+      )pb",
+      &local_lookup_response);
+  EXPECT_CALL(mock_local_lookup_, GetKeyValues(_, _))
+      .WillOnce(Return(local_lookup_response));
+
+  std::vector<absl::flat_hash_set<std::string>> cluster_mappings;
+  for (int i = 0; i < 2; i++) {
+    cluster_mappings.push_back({std::to_string(i)});
+  }
+  auto shard_manager = ShardManager::Create(
+      num_shards_, std::move(cluster_mappings),
+      std::make_unique<MockRandomGenerator>(), [](const std::string& ip) {
+        if (ip != "1") {
+          return std::make_unique<MockRemoteLookupClient>();
+        }
+        auto mock_remote_lookup_client_1 =
+            std::make_unique<MockRemoteLookupClient>();
+        const std::vector<std::string_view> key_list_remote = {"key1"};
+        InternalLookupRequest request;
+        request.mutable_keys()->Assign(key_list_remote.begin(),
+                                       key_list_remote.end());
+        request.set_result_format(LOOKUP_RESULT_FORMAT_COMPACT_V1);
+        const std::string serialized_request = request.SerializeAsString();
+        EXPECT_CALL(*mock_remote_lookup_client_1,
+                    GetValues(_, serialized_request, 0))
+            .WillOnce([]() { return absl::DeadlineExceededError("too long"); });
+
+        return mock_remote_lookup_client_1;
+      });
+
+  auto sharded_lookup =
+      CreateShardedLookup(mock_local_lookup_, num_shards_, shard_num_,
+                          *(*shard_manager), key_sharder_);
+  auto response =
+      sharded_lookup->GetKeyValues(GetRequestContext(), {"key1", "key4"});
+  EXPECT_TRUE(response.ok());
+
+  InternalLookupResponse expected;
+  TextFormat::ParseFromString(
+      R"pb(
+        kv_pairs {
+          key: "key1"
+          value { status { code: 13 message: "Data lookup failed" } }
+        }
+        kv_pairs {
+          key: "key4"
+          value { value: "value4" }
+        })pb",
+      &expected);
+  EXPECT_THAT(response.value(), EqualsProto(expected));
+}
+
+TEST_F(ShardedLookupTest, GetKeyValues_SlowReplica_UsesHedgedResponse) {
+  EXPECT_CALL(mock_local_lookup_, GetKeyValues(_, _))
+      .WillOnce(Return(InternalLookupResponse()));
+
+  std::vector<absl::flat_hash_set<std::string>> cluster_mappings;
+  cluster_mappings.push_back({"0"});
+  cluster_mappings.push_back({"1", "2"});
+  // The first lookup of key1 is slow, and the hedged one is fast.
+  std::atomic<int> remote_calls = 0;
+  auto shard_manager = ShardManager::Create(
+      num_shards_, std::move(cluster_mappings),
+      std::make_unique<MockRandomGenerator>(),
+      [&remote_calls](const std::string& ip) {
+        auto mock_remote_lookup_client =
+            std::make_unique<MockRemoteLookupClient>();
+        if (ip != "0") {
+          EXPECT_CALL(*mock_remote_lookup_client, GetValues(_, _, _))
+              .Times(testing::AtMost(1))
+              .WillRepeatedly([&remote_calls]() {
+                const bool slow = remote_calls++ == 0;
+                if (slow) {
+                  absl::SleepFor(absl::Milliseconds(200));
+                }
+                InternalLookupResponse resp;
+                SingleLookupResult result;
+                result.set_value(slow ? "slow" : "fast");
+                (*resp.mutable_kv_pairs())["key1"] = result;
+                return resp;
+              });
+        }
+        return mock_remote_lookup_client;
+      });
+  auto sharded_lookup = CreateShardedLookup(
+      mock_local_lookup_, num_shards_, shard_num_, *(*shard_manager),
+      key_sharder_, /*executor=*/nullptr,
+      HedgingOptions{.delay_percentile = 50,
+                     .initial_delay = absl::Milliseconds(1)});
+  auto response =
+      sharded_lookup->GetKeyValues(GetRequestContext(), {"key1", "key4"});
+  ASSERT_TRUE(response.ok());
+  EXPECT_EQ(remote_calls, 2);
+
+  InternalLookupResponse expected;
+  TextFormat::ParseFromString(R"pb(kv_pairs {
+                                     key: "key1"
+                                     value { value: "fast" }
+                                   }
+                                   kv_pairs {
+                                     key: "key4"
+                                     value { status { code: 5 } }
+                                   }
+                              )pb",
+                              &expected);
+  EXPECT_THAT(response.value(), EqualsProto(expected));
+}
+
+TEST_F(ShardedLookupTest, GetKeyValues_DeadlineExceeded_MarksKeysFailed) {
+  EXPECT_CALL(mock_local_lookup_, GetKeyValues(_, _))
+      .WillOnce(Return(InternalLookupResponse()));
+
+  std::vector<absl::flat_hash_set<std::string>> cluster_mappings;
+  for (int i = 0; i < 2; i++) {
+    cluster_mappings.push_back({std::to_string(i)});
+  }
+  auto shard_manager = ShardManager::Create(
+      num_shards_, std::move(cluster_mappings),
+      std::make_unique<MockRandomGenerator>(), [](const std::string& ip) {
+        auto mock_remote_lookup_client =
+            std::make_unique<MockRemoteLookupClient>();
+        if (ip == "1") {
+          EXPECT_CALL(*mock_remote_lookup_client, GetValues(_, _, _))
+              .WillOnce([]() {
+                absl::SleepFor(absl::Milliseconds(100));
+                return InternalLookupResponse();
+              });
+        }
+        return mock_remote_lookup_client;
+      });
+  auto sharded_lookup =
+      CreateShardedLookup(mock_local_lookup_, num_shards_, shard_num_,
+                          *(*shard_manager), key_sharder_);
+  GetRequestContext().SetDeadline(absl::Now() + absl::Milliseconds(10));
+  auto response =
+      sharded_lookup->GetKeyValues(GetRequestContext(), {"key1", "key4"});
+  ASSERT_TRUE(response.ok());
+
+  InternalLookupResponse expected;
+  TextFormat::ParseFromString(
+      R"pb(
+        kv_pairs {
+          key: "key1"
+          value { status { code: 13 message: "Data lookup failed" } }
+        }
+        kv_pairs {
+          key: "key4"
+          value { status { code: 5 } }
+        })pb",
+      &expected);
+  EXPECT_THAT(response.value(), EqualsProto(expected));
+}
+
+TEST_F(ShardedLookupTest, GetKeyValues_SkipEmptyShards_NoRemoteLookup) {
+  InternalLookupResponse local_lookup_response;
+  TextFormat::ParseFromString(R"pb(kv_pairs {
+                                     key: "key4"
+                                     value { value: "value4" }
+                                   }
+                              )pb",
+                              &local_lookup_response);
+  EXPECT_CALL(mock_local_lookup_, GetKeyValues(_, _))
+      .WillOnce(Return(local_lookup_response));
+
+  std::vector<absl::flat_hash_set<std::string>> cluster_mappings;
+  for (int i = 0; i < 2; i++) {
+    cluster_mappings.push_back({std::to_string(i)});
+  }
+  auto shard_manager = ShardManager::Create(
+      num_shards_, std::move(cluster_mappings),
+      std::make_unique<MockRandomGenerator>(), [](const std::string& ip) {
+        auto mock_remote_lookup_client =
+            std::make_unique<MockRemoteLookupClient>();
+        EXPECT_CALL(*mock_remote_lookup_client, GetValues(_, _, _)).Times(0);
+        return mock_remote_lookup_client;
       });
-  auto sharded_lookup =
-      CreateShardedLookup(mock_local_lookup_, num_shards_, shard_num_,
-                          *(*shard_manager), key_sharder_);
-  auto response = sharded_lookup->GetKeyValues(GetRequestContext(), {});
-  EXPECT_TRUE(response.ok());
-
-  InternalLookupResponse expected;
-  EXPECT_THAT(response.value(), EqualsProto(expected));
+  auto sharded_lookup = CreateShardedLookup(
+      mock_local_lookup_, num_shards_, shard_num_, *(*shard_manager),
+      key_sharder_, /*executor=*/nullptr, HedgingOptions(),
+      PaddingOptions{.skip_empty_shards = true});
+  auto response = sharded_lookup->GetKeyValues(GetRequestContext(), {"key4"});
+  ASSERT_TRUE(response.ok());
+  EXPECT_THAT(response.value(), EqualsProto(local_lookup_response));
 }
 
-TEST_F(ShardedLookupTest, GetKeyValues_FailedDownstreamRequest) {
-  InternalLookupResponse local_lookup_response;
-  TextFormat::ParseFromString(
-      R"pb(kv_pairs {
-             key: "key4"
-             value { value: "value4" }
-           }
-      )pb",
-      &local_lookup_response);
-  EXPECT_CALL(mock_local_lookup_, GetKeyValues(_, _))
-      .WillOnce(Return(local_lookup_response));
+TEST_F(ShardedLookupTest, GetKeyValues_PaddingBucket_PadsToBucketMultiple) {
+  constexpr int32_t kBucketSize = 64;
+  EXPECT_CALL(mock_local_lookup_, GetKeyValues(_, _)).Times(0);
 
   std::vector<absl::flat_hash_set<std::string>> cluster_mappings;
   for (int i = 0; i < 2; i++) {
@@ -234,42 +747,42 @@ TEST_F(ShardedLookupTest, GetKeyValues_FailedDownstreamRequest) {
   auto shard_manager = ShardManager::Create(
       num_shards_, std::move(cluster_mappings),
       std::make_unique<MockRandomGenerator>(), [](const std::string& ip) {
+        auto mock_remote_lookup_client =
+            std::make_unique<MockRemoteLookupClient>();
         if (ip != "1") {
-          return std::make_unique<MockRemoteLookupClient>();
+          return mock_remote_lookup_client;
         }
-        auto mock_remote_lookup_client_1 =
-            std::make_unique<MockRemoteLookupClient>();
-        const std::vector<std::string_view> key_list_remote = {"key1"};
         InternalLookupRequest request;
-        request.mutable_keys()->Assign(key_list_remote.begin(),
-                                       key_list_remote.end());
+        request.add_keys("key1");
+        request.set_result_format(LOOKUP_RESULT_FORMAT_COMPACT_V1);
         const std::string serialized_request = request.SerializeAsString();
-        EXPECT_CALL(*mock_remote_lookup_client_1,
-                    GetValues(_, serialized_request, 0))
-            .WillOnce([]() { return absl::DeadlineExceededError("too long"); });
-
-        return mock_remote_lookup_client_1;
+        const int32_t padding =
+            kBucketSize - serialized_request.size() % kBucketSize;
+        EXPECT_CALL(*mock_remote_lookup_client,
+                    GetValues(_, serialized_request, padding))
+            .WillOnce([]() {
+              InternalLookupResponse resp;
+              SingleLookupResult result;
+              result.set_value("value1");
+              (*resp.mutable_kv_pairs())["key1"] = result;
+              return resp;
+            });
+        return mock_remote_lookup_client;
       });
-
-  auto sharded_lookup =
-      CreateShardedLookup(mock_local_lookup_, num_shards_, shard_num_,
-                          *(*shard_manager), key_sharder_);
-  auto response =
-      sharded_lookup->GetKeyValues(GetRequestContext(), {"key1", "key4"});
-  EXPECT_TRUE(response.ok());
+  auto sharded_lookup = CreateShardedLookup(
+      mock_local_lookup_, num_shards_, shard_num_, *(*shard_manager),
+      key_sharder_, /*executor=*/nullptr, HedgingOptions(),
+      PaddingOptions{.skip_empty_shards = true, .bucket_size = kBucketSize});
+  auto response = sharded_lookup->GetKeyValues(GetRequestContext(), {"key1"});
+  ASSERT_TRUE(response.ok());
 
   InternalLookupResponse expected;
-  TextFormat::ParseFromString(
-      R"pb(
-        kv_pairs {
-          key: "key1"
-          value { status { code: 13 message: "Data lookup failed" } }
-        }
-        kv_pairs {
-          key: "key4"
-          value { value: "value4" }
-        })pb",
-      &expected);
+  TextFormat::ParseFromString(R"pb(kv_pairs {
+                                     key: "key1"
+                                     value { value: "value1" }
+                                   }
+                              )pb",
+                              &expected);
   EXPECT_THAT(response.value(), EqualsProto(expected));
 }
 
@@ -289,7 +802,7 @@ TEST_F(ShardedLookupTest, GetKeyValues_ReturnsKeysFromCachePadding) {
   keys.insert("longkey1");
   keys.insert("randomkey3");
 
-  int total_length = 22;
+  int total_length = 24;
 
   std::vector<std::string> key_list = {"key4", "verylongkey2"};
   InternalLookupResponse local_lookup_response;
@@ -329,6 +842,7 @@ TEST_F(ShardedLookupTest, GetKeyValues_ReturnsKeysFromCachePadding) {
           InternalLookupRequest request;
           request.mutable_keys()->Assign(key_list_remote.begin(),
                                          key_list_remote.end());
+          request.set_result_format(LOOKUP_RESULT_FORMAT_COMPACT_V1);
           const std::string serialized_request = request.SerializeAsString();
           EXPECT_CALL(*mock_remote_lookup_client_1, GetValues(_, _, _))
               .WillOnce([total_length, key_list_remote](
@@ -365,6 +879,7 @@ TEST_F(ShardedLookupTest, GetKeyValues_ReturnsKeysFromCachePadding) {
           InternalLookupRequest request;
           request.mutable_keys()->Assign(key_list_remote.begin(),
                                          key_list_remote.end());
+          request.set_result_format(LOOKUP_RESULT_FORMAT_COMPACT_V1);
           const std::string serialized_request = request.SerializeAsString();
           EXPECT_CALL(*mock_remote_lookup_client_1,
                       GetValues(_, serialized_request, _))
@@ -385,6 +900,7 @@ TEST_F(ShardedLookupTest, GetKeyValues_ReturnsKeysFromCachePadding) {
           InternalLookupRequest request;
           request.mutable_keys()->Assign(key_list_remote.begin(),
                                          key_list_remote.end());
+          request.set_result_format(LOOKUP_RESULT_FORMAT_COMPACT_V1);
           const std::string serialized_request = request.SerializeAsString();
           EXPECT_CALL(*mock_remote_lookup_client_1, GetValues(_, _, _))
               .WillOnce([=](const RequestContext& request_context,
@@ -411,55 +927,237 @@ TEST_F(ShardedLookupTest, GetKeyValues_ReturnsKeysFromCachePadding) {
 
           return mock_remote_lookup_client_1;
         }
-        // ip == "0"
-        return std::make_unique<MockRemoteLookupClient>();
+        // ip == "0"
+        return std::make_unique<MockRemoteLookupClient>();
+      });
+
+  auto sharded_lookup =
+      CreateShardedLookup(mock_local_lookup_, num_shards, shard_num_,
+                          *(*shard_manager), key_sharder_);
+  auto response = sharded_lookup->GetKeyValues(GetRequestContext(), keys);
+  EXPECT_TRUE(response.ok());
+
+  InternalLookupResponse expected;
+  TextFormat::ParseFromString(
+      R"pb(
+        kv_pairs {
+          key: "key1"
+          value { value: "value1" }
+        }
+        kv_pairs {
+          key: "key2"
+          value { value: "value2" }
+        }
+        kv_pairs {
+          key: "key3"
+          value { value: "value3" }
+        }
+        kv_pairs {
+          key: "key4"
+          value { value: "key4value" }
+        }
+        kv_pairs {
+          key: "longkey1"
+          value { value: "longkey1value" }
+        }
+        kv_pairs {
+          key: "randomkey3"
+          value { value: "randomkey3value" }
+        }
+        kv_pairs {
+          key: "randomkey5"
+          value { status { code: 5 message: "" } }
+        }
+        kv_pairs { key: "verylongkey2"
+                   value { value: "verylongkey2value" }
+      )pb",
+      &expected);
+  EXPECT_THAT(response.value(), EqualsProto(expected));
+}
+
+TEST_F(ShardedLookupTest, GetKeyValueSets_KeysFound_Success) {
+  InternalLookupResponse local_lookup_response;
+  TextFormat::ParseFromString(
+      R"pb(kv_pairs {
+             key: "key4"
+             value { keyset_values { values: "value4" } }
+           }
+      )pb",
+      &local_lookup_response);
+  EXPECT_CALL(mock_local_lookup_, GetKeyValueSet(_, _))
+      .WillOnce(Return(local_lookup_response));
+
+  std::vector<absl::flat_hash_set<std::string>> cluster_mappings;
+  for (int i = 0; i < 2; i++) {
+    cluster_mappings.push_back({std::to_string(i)});
+  }
+
+  auto shard_manager = ShardManager::Create(
+      num_shards_, std::move(cluster_mappings),
+      std::make_unique<MockRandomGenerator>(), [](const std::string& ip) {
+        if (ip != "1") {
+          return std::make_unique<MockRemoteLookupClient>();
+        }
+
+        auto mock_remote_lookup_client_1 =
+            std::make_unique<MockRemoteLookupClient>();
+        const std::vector<std::string_view> key_list_remote = {"key1"};
+        InternalLookupRequest request;
+        request.mutable_keys()->Assign(key_list_remote.begin(),
+                                       key_list_remote.end());
+        request.set_lookup_sets(true);
+        request.set_result_format(LOOKUP_RESULT_FORMAT_COMPACT_V1);
+        const std::string serialized_request = request.SerializeAsString();
+        EXPECT_CALL(*mock_remote_lookup_client_1, GetValues(_, _, 0))
+            .WillOnce([&]() {
+              InternalLookupResponse resp;
+              TextFormat::ParseFromString(
+                  R"pb(kv_pairs {
+                         key: "key1"
+                         value { keyset_values { values: "value1" } }
+                       }
+                  )pb",
+                  &resp);
+              return resp;
+            });
+
+        return mock_remote_lookup_client_1;
+      });
+
+  auto sharded_lookup =
+      CreateShardedLookup(mock_local_lookup_, num_shards_, shard_num_,
+                          *(*shard_manager), key_sharder_);
+  auto response =
+      sharded_lookup->GetKeyValueSet(GetRequestContext(), {"key1", "key4"});
+  EXPECT_TRUE(response.ok());
+
+  InternalLookupResponse expected;
+  TextFormat::ParseFromString(
+      R"pb(kv_pairs {
+             key: "key1"
+             value { keyset_values { values: "value1" } }
+           }
+           kv_pairs {
+             key: "key4"
+             value { keyset_values { values: "value4" } }
+           }
+      )pb",
+      &expected);
+  EXPECT_THAT(response.value(), EqualsProto(expected));
+}
+
+TEST_F(ShardedLookupTest, GetKeyValueSets_CompactResults_Success) {
+  InternalLookupResponse local_lookup_response;
+  TextFormat::ParseFromString(
+      R"pb(kv_pairs {
+             key: "key4"
+             value { keyset_values { values: "value4" } }
+           }
+      )pb",
+      &local_lookup_response);
+  EXPECT_CALL(mock_local_lookup_, GetKeyValueSet(_, _))
+      .WillOnce(Return(local_lookup_response));
+
+  std::vector<absl::flat_hash_set<std::string>> cluster_mappings;
+  for (int i = 0; i < 2; i++) {
+    cluster_mappings.push_back({std::to_string(i)});
+  }
+
+  auto shard_manager = ShardManager::Create(
+      num_shards_, std::move(cluster_mappings),
+      std::make_unique<MockRandomGenerator>(), [](const std::string& ip) {
+        if (ip != "1") {
+          return std::make_unique<MockRemoteLookupClient>();
+        }
+
+        auto mock_remote_lookup_client_1 =
+            std::make_unique<MockRemoteLookupClient>();
+        EXPECT_CALL(*mock_remote_lookup_client_1, GetValues(_, _, 0))
+            .WillOnce([&]() {
+              InternalLookupResponse remote_response;
+              TextFormat::ParseFromString(
+                  R"pb(kv_pairs {
+                         key: "key1"
+                         value { keyset_values { values: "value1" } }
+                       }
+                       kv_pairs {
+                         key: "key3"
+                         value { status { code: 5 } }
+                       }
+                  )pb",
+                  &remote_response);
+              InternalLookupResponse resp;
+              resp.set_compact_kv_pairs(
+                  CompactLookupResult::Encode(remote_response.kv_pairs()));
+              return resp;
+            });
+
+        return mock_remote_lookup_client_1;
+      });
+
+  auto sharded_lookup =
+      CreateShardedLookup(mock_local_lookup_, num_shards_, shard_num_,
+                          *(*shard_manager), key_sharder_);
+  auto response = sharded_lookup->GetKeyValueSet(GetRequestContext(),
+                                                 {"key1", "key3", "key4"});
+  EXPECT_TRUE(response.ok());
+
+  InternalLookupResponse expected;
+  TextFormat::ParseFromString(
+      R"pb(kv_pairs {
+             key: "key1"
+             value { keyset_values { values: "value1" } }
+           }
+           kv_pairs {
+             key: "key3"
+             value { status { code: 5 } }
+           }
+           kv_pairs {
+             key: "key4"
+             value { keyset_values { values: "value4" } }
+           }
+      )pb",
+      &expected);
+  EXPECT_THAT(response.value(), EqualsProto(expected));
+}
+
+TEST_F(ShardedLookupTest, GetKeyValueSets_InvalidCompactResults_ReturnsError) {
+  EXPECT_CALL(mock_local_lookup_, GetKeyValueSet(_, _))
+      .WillOnce(Return(InternalLookupResponse()));
+
+  std::vector<absl::flat_hash_set<std::string>> cluster_mappings;
+  for (int i = 0; i < 2; i++) {
+    cluster_mappings.push_back({std::to_string(i)});
+  }
+
+  auto shard_manager = ShardManager::Create(
+      num_shards_, std::move(cluster_mappings),
+      std::make_unique<MockRandomGenerator>(), [](const std::string& ip) {
+        if (ip != "1") {
+          return std::make_unique<MockRemoteLookupClient>();
+        }
+
+        auto mock_remote_lookup_client_1 =
+            std::make_unique<MockRemoteLookupClient>();
+        EXPECT_CALL(*mock_remote_lookup_client_1, GetValues(_, _, 0))
+            .WillOnce([&]() {
+              InternalLookupResponse resp;
+              resp.set_compact_kv_pairs("invalid");
+              return resp;
+            });
+
+        return mock_remote_lookup_client_1;
       });
 
   auto sharded_lookup =
-      CreateShardedLookup(mock_local_lookup_, num_shards, shard_num_,
+      CreateShardedLookup(mock_local_lookup_, num_shards_, shard_num_,
                           *(*shard_manager), key_sharder_);
-  auto response = sharded_lookup->GetKeyValues(GetRequestContext(), keys);
-  EXPECT_TRUE(response.ok());
-
-  InternalLookupResponse expected;
-  TextFormat::ParseFromString(
-      R"pb(
-        kv_pairs {
-          key: "key1"
-          value { value: "value1" }
-        }
-        kv_pairs {
-          key: "key2"
-          value { value: "value2" }
-        }
-        kv_pairs {
-          key: "key3"
-          value { value: "value3" }
-        }
-        kv_pairs {
-          key: "key4"
-          value { value: "key4value" }
-        }
-        kv_pairs {
-          key: "longkey1"
-          value { value: "longkey1value" }
-        }
-        kv_pairs {
-          key: "randomkey3"
-          value { value: "randomkey3value" }
-        }
-        kv_pairs {
-          key: "randomkey5"
-          value { status { code: 5 message: "" } }
-        }
-        kv_pairs { key: "verylongkey2"
-                   value { value: "verylongkey2value" }
-      )pb",
-      &expected);
-  EXPECT_THAT(response.value(), EqualsProto(expected));
+  auto response =
+      sharded_lookup->GetKeyValueSet(GetRequestContext(), {"key1", "key4"});
+  EXPECT_FALSE(response.ok());
 }
 
-TEST_F(ShardedLookupTest, GetKeyValueSets_KeysFound_Success) {
+TEST_F(ShardedLookupTest, GetKeyValueSets_SameRequest_LooksUpKeysOnce) {
   InternalLookupResponse local_lookup_response;
   TextFormat::ParseFromString(
       R"pb(kv_pairs {
@@ -475,24 +1173,16 @@ TEST_F(ShardedLookupTest, GetKeyValueSets_KeysFound_Success) {
   for (int i = 0; i < 2; i++) {
     cluster_mappings.push_back({std::to_string(i)});
   }
-
   auto shard_manager = ShardManager::Create(
       num_shards_, std::move(cluster_mappings),
       std::make_unique<MockRandomGenerator>(), [](const std::string& ip) {
+        auto mock_remote_lookup_client =
+            std::make_unique<MockRemoteLookupClient>();
         if (ip != "1") {
-          return std::make_unique<MockRemoteLookupClient>();
+          return mock_remote_lookup_client;
         }
-
-        auto mock_remote_lookup_client_1 =
-            std::make_unique<MockRemoteLookupClient>();
-        const std::vector<std::string_view> key_list_remote = {"key1"};
-        InternalLookupRequest request;
-        request.mutable_keys()->Assign(key_list_remote.begin(),
-                                       key_list_remote.end());
-        request.set_lookup_sets(true);
-        const std::string serialized_request = request.SerializeAsString();
-        EXPECT_CALL(*mock_remote_lookup_client_1, GetValues(_, _, 0))
-            .WillOnce([&]() {
+        EXPECT_CALL(*mock_remote_lookup_client, GetValues(_, _, _))
+            .WillOnce([]() {
               InternalLookupResponse resp;
               TextFormat::ParseFromString(
                   R"pb(kv_pairs {
@@ -503,17 +1193,17 @@ TEST_F(ShardedLookupTest, GetKeyValueSets_KeysFound_Success) {
                   &resp);
               return resp;
             });
-
-        return mock_remote_lookup_client_1;
+        return mock_remote_lookup_client;
       });
-
   auto sharded_lookup =
       CreateShardedLookup(mock_local_lookup_, num_shards_, shard_num_,
                           *(*shard_manager), key_sharder_);
+  EXPECT_TRUE(
+      sharded_lookup->GetKeyValueSet(GetRequestContext(), {"key1", "key4"})
+          .ok());
   auto response =
       sharded_lookup->GetKeyValueSet(GetRequestContext(), {"key1", "key4"});
-  EXPECT_TRUE(response.ok());
-
+  ASSERT_TRUE(response.ok());
   InternalLookupResponse expected;
   TextFormat::ParseFromString(
       R"pb(kv_pairs {
@@ -527,6 +1217,11 @@ TEST_F(ShardedLookupTest, GetKeyValueSets_KeysFound_Success) {
       )pb",
       &expected);
   EXPECT_THAT(response.value(), EqualsProto(expected));
+  auto query_response =
+      sharded_lookup->RunQuery(GetRequestContext(), "key1|key4");
+  ASSERT_TRUE(query_response.ok());
+  EXPECT_THAT(query_response->elements(),
+              testing::UnorderedElementsAre("value1", "value4"));
 }
 
 TEST_F(ShardedLookupTest, GetKeyValueSets_KeysMissing_ReturnsStatus) {
@@ -560,6 +1255,7 @@ TEST_F(ShardedLookupTest, GetKeyValueSets_KeysMissing_ReturnsStatus) {
         request.mutable_keys()->Assign(key_list_remote.begin(),
                                        key_list_remote.end());
         request.set_lookup_sets(true);
+        request.set_result_format(LOOKUP_RESULT_FORMAT_COMPACT_V1);
         const std::string serialized_request = request.SerializeAsString();
         EXPECT_CALL(*mock_remote_lookup_client_1, GetValues(_, _, 0))
             .WillOnce([=](const RequestContext& request_context,
@@ -659,6 +1355,7 @@ TEST_F(ShardedLookupTest, GetKeyValueSet_FailedDownstreamRequest) {
         request.mutable_keys()->Assign(key_list_remote.begin(),
                                        key_list_remote.end());
         request.set_lookup_sets(true);
+        request.set_result_format(LOOKUP_RESULT_FORMAT_COMPACT_V1);
         const std::string serialized_request = request.SerializeAsString();
         EXPECT_CALL(*mock_remote_lookup_client_1,
                     GetValues(_, serialized_request, 0))
@@ -706,6 +1403,7 @@ TEST_F(ShardedLookupTest, RunQuery_Success) {
         request.mutable_keys()->Assign(key_list_remote.begin(),
                                        key_list_remote.end());
         request.set_lookup_sets(true);
+        request.set_result_format(LOOKUP_RESULT_FORMAT_COMPACT_V1);
         const std::string serialized_request = request.SerializeAsString();
         EXPECT_CALL(*mock_remote_lookup_client_1,
                     GetValues(_, serialized_request, 0))
@@ -764,6 +1462,7 @@ TEST_F(ShardedLookupTest, RunQuery_MissingKeySet_IgnoresMissingSet_Success) {
         request.mutable_keys()->Assign(key_list_remote.begin(),
                                        key_list_remote.end());
         request.set_lookup_sets(true);
+        request.set_result_format(LOOKUP_RESULT_FORMAT_COMPACT_V1);
         const std::string serialized_request = request.SerializeAsString();
         EXPECT_CALL(*mock_remote_lookup_client_1,
                     GetValues(_, serialized_request, 0))
@@ -822,6 +1521,307 @@ TEST_F(ShardedLookupTest, RunQuery_ShardedLookupFails_Error) {
   EXPECT_THAT(response.status().code(), absl::StatusCode::kInternal);
 }
 
+TEST_F(ShardedLookupTest, RunQuery_ApproxCount_OnlyFetchesSetSizes) {
+  InternalLookupResponse local_lookup_response;
+  TextFormat::ParseFromString(
+      R"pb(kv_pairs {
+             key: "key4"
+             value { set_size: 2 }
+           }
+      )pb",
+      &local_lookup_response);
+  EXPECT_CALL(mock_local_lookup_, GetKeyValueSetSizes(_, _))
+      .WillOnce(Return(local_lookup_response));
+  EXPECT_CALL(mock_local_lookup_, GetKeyValueSet(_, _)).Times(0);
+
+  std::vector<absl::flat_hash_set<std::string>> cluster_mappings;
+  for (int i = 0; i < 2; i++) {
+    cluster_mappings.push_back({std::to_string(i)});
+  }
+  auto shard_manager = ShardManager::Create(
+      num_shards_, std::move(cluster_mappings),
+      std::make_unique<MockRandomGenerator>(), [](const std::string& ip) {
+        auto mock_remote_lookup_client =
+            std::make_unique<MockRemoteLookupClient>();
+        if (ip != "1") {
+          return mock_remote_lookup_client;
+        }
+        InternalLookupRequest request;
+        request.add_keys("key1");
+        request.set_lookup_sets(true);
+        request.set_lookup_set_sizes(true);
+        request.set_result_format(LOOKUP_RESULT_FORMAT_COMPACT_V1);
+        const std::string serialized_request = request.SerializeAsString();
+        EXPECT_CALL(*mock_remote_lookup_client,
+                    GetValues(_, serialized_request, _))
+            .WillOnce([]() {
+              InternalLookupResponse resp;
+              TextFormat::ParseFromString(
+                  R"pb(kv_pairs {
+                         key: "key1"
+                         value { set_size: 3 }
+                       }
+                  )pb",
+                  &resp);
+              return resp;
+            });
+        return mock_remote_lookup_client;
+      });
+
+  auto sharded_lookup =
+      CreateShardedLookup(mock_local_lookup_, num_shards_, shard_num_,
+                          *(*shard_manager), key_sharder_);
+  auto response = sharded_lookup->RunQuery(GetRequestContext(),
+                                           "APPROX_COUNT(key1 | key4)");
+  ASSERT_TRUE(response.ok()) << response.status();
+  EXPECT_EQ(response->count(), 5);
+  EXPECT_TRUE(response->elements().empty());
+}
+
+TEST_F(ShardedLookupTest, RunQuery_PlanWithSetSizes_SkipsEmptyIntersections) {
+  InternalLookupResponse local_set_sizes;
+  TextFormat::ParseFromString(
+      R"pb(kv_pairs {
+             key: "key4"
+             value { set_size: 2 }
+           }
+      )pb",
+      &local_set_sizes);
+  EXPECT_CALL(mock_local_lookup_, GetKeyValueSetSizes(_, _))
+      .WillRepeatedly(Return(local_set_sizes));
+  InternalLookupResponse local_lookup_response;
+  TextFormat::ParseFromString(
+      R"pb(kv_pairs {
+             key: "key4"
+             value { keyset_values { values: "a" values: "b" } }
+           }
+      )pb",
+      &local_lookup_response);
+  EXPECT_CALL(mock_local_lookup_, GetKeyValueSet(_, _))
+      .WillOnce(Return(local_lookup_response));
+
+  std::vector<absl::flat_hash_set<std::string>> cluster_mappings;
+  for (int i = 0; i < 2; i++) {
+    cluster_mappings.push_back({std::to_string(i)});
+  }
+  auto shard_manager = ShardManager::Create(
+      num_shards_, std::move(cluster_mappings),
+      std::make_unique<MockRandomGenerator>(), [](const std::string& ip) {
+        auto mock_remote_lookup_client =
+            std::make_unique<MockRemoteLookupClient>();
+        if (ip != "1") {
+          return mock_remote_lookup_client;
+        }
+        // Only the size of the set of "key1" is looked up, which is missing.
+        InternalLookupRequest request;
+        request.add_keys("key1");
+        request.set_lookup_sets(true);
+        request.set_lookup_set_sizes(true);
+        request.set_result_format(LOOKUP_RESULT_FORMAT_COMPACT_V1);
+        const std::string serialized_request = request.SerializeAsString();
+        EXPECT_CALL(*mock_remote_lookup_client,
+                    GetValues(_, serialized_request, _))
+            .Times(2)
+            .WillRepeatedly([]() {
+              InternalLookupResponse resp;
+              TextFormat::ParseFromString(
+                  R"pb(kv_pairs {
+                         key: "key1"
+                         value { status { code: 5 } }
+                       }
+                  )pb",
+                  &resp);
+              return resp;
+            });
+        return mock_remote_lookup_client;
+      });
+
+  auto sharded_lookup = CreateShardedLookup(
+      mock_local_lookup_, num_shards_, shard_num_, *(*shard_manager),
+      key_sharder_, /*executor=*/nullptr, HedgingOptions(),
+      PaddingOptions{.skip_empty_shards = true}, /*query_pushdown=*/false,
+      /*key_filters=*/nullptr, /*compress_response_min_bytes=*/0,
+      /*plan_queries_with_set_sizes=*/true);
+  auto response =
+      sharded_lookup->RunQuery(GetRequestContext(), "(key1 & key4) | key4");
+  ASSERT_TRUE(response.ok()) << response.status();
+  EXPECT_THAT(response->elements(), testing::UnorderedElementsAre("a", "b"));
+  // The result is known to be empty without fetching any set.
+  response = sharded_lookup->RunQuery(GetRequestContext(), "key1 & key4");
+  ASSERT_TRUE(response.ok()) << response.status();
+  EXPECT_TRUE(response->elements().empty());
+}
+
+TEST_F(ShardedLookupTest, RunQuery_Pushdown_RunsSubtreesOnShards) {
+  // "key1" and "key2" are on shard 1, "key4" and "key7" on shard 0.
+  InternalRunQueryResponse local_run_query_response;
+  local_run_query_response.add_elements("local");
+  EXPECT_CALL(mock_local_lookup_, RunQuery(_, R"(("key4" & "key7"))"))
+      .WillOnce(Return(local_run_query_response));
+
+  std::vector<absl::flat_hash_set<std::string>> cluster_mappings;
+  for (int i = 0; i < 2; i++) {
+    cluster_mappings.push_back({std::to_string(i)});
+  }
+  auto shard_manager = ShardManager::Create(
+      num_shards_, std::move(cluster_mappings),
+      std::make_unique<MockRandomGenerator>(), [](const std::string& ip) {
+        auto mock_remote_lookup_client =
+            std::make_unique<MockRemoteLookupClient>();
+        if (ip != "1") {
+          return mock_remote_lookup_client;
+        }
+        InternalLookupRequest request;
+        request.set_lookup_sets(true);
+        request.add_queries(R"(("key1" & "key2"))");
+        request.set_result_format(LOOKUP_RESULT_FORMAT_COMPACT_V1);
+        const std::string serialized_request = request.SerializeAsString();
+        EXPECT_CALL(*mock_remote_lookup_client,
+                    GetValues(_, serialized_request, _))
+            .WillOnce([]() {
+              InternalLookupResponse resp;
+              TextFormat::ParseFromString(
+                  R"pb(query_results {
+                         key: "(\"key1\" & \"key2\")"
+                         value { keyset_values { values: "remote" } }
+                       }
+                  )pb",
+                  &resp);
+              return resp;
+            });
+        return mock_remote_lookup_client;
+      });
+
+  auto sharded_lookup = CreateShardedLookup(
+      mock_local_lookup_, num_shards_, shard_num_, *(*shard_manager),
+      key_sharder_, /*executor=*/nullptr, HedgingOptions(), PaddingOptions(),
+      /*query_pushdown=*/true);
+  auto response = sharded_lookup->RunQuery(GetRequestContext(),
+                                           "(key1 & key2) | (key4 & key7)");
+  ASSERT_TRUE(response.ok()) << response.status();
+  EXPECT_THAT(response.value().elements(),
+              testing::UnorderedElementsAre("remote", "local"));
+}
+
+TEST_F(ShardedLookupTest, RunQuery_Pushdown_PushesLimitOfWholeQuery) {
+  // "key4" and "key7" are on shard 0, the local shard.
+  InternalRunQueryResponse local_run_query_response;
+  local_run_query_response.add_elements("local");
+  EXPECT_CALL(mock_local_lookup_,
+              RunQuery(_, R"(("key4" & "key7") LIMIT 1)"))
+      .WillOnce(Return(local_run_query_response));
+
+  std::vector<absl::flat_hash_set<std::string>> cluster_mappings;
+  for (int i = 0; i < 2; i++) {
+    cluster_mappings.push_back({std::to_string(i)});
+  }
+  auto shard_manager = ShardManager::Create(
+      num_shards_, std::move(cluster_mappings),
+      std::make_unique<MockRandomGenerator>(), [](const std::string& ip) {
+        return std::make_unique<MockRemoteLookupClient>();
+      });
+
+  auto sharded_lookup = CreateShardedLookup(
+      mock_local_lookup_, num_shards_, shard_num_, *(*shard_manager),
+      key_sharder_, /*executor=*/nullptr, HedgingOptions(),
+      PaddingOptions{.skip_empty_shards = true}, /*query_pushdown=*/true);
+  auto response =
+      sharded_lookup->RunQuery(GetRequestContext(), "key4 & key7 LIMIT 1");
+  ASSERT_TRUE(response.ok()) << response.status();
+  EXPECT_THAT(response.value().elements(), testing::ElementsAre("local"));
+}
+
+TEST_F(ShardedLookupTest, RunQuery_Pushdown_FetchesSetsAcrossShards) {
+  InternalLookupResponse local_lookup_response;
+  TextFormat::ParseFromString(
+      R"pb(kv_pairs {
+             key: "key4"
+             value { keyset_values { values: "a" values: "b" } }
+           }
+      )pb",
+      &local_lookup_response);
+  EXPECT_CALL(mock_local_lookup_, GetKeyValueSet(_, _))
+      .WillOnce(Return(local_lookup_response));
+  EXPECT_CALL(mock_local_lookup_, RunQuery(_, _)).Times(0);
+
+  std::vector<absl::flat_hash_set<std::string>> cluster_mappings;
+  for (int i = 0; i < 2; i++) {
+    cluster_mappings.push_back({std::to_string(i)});
+  }
+  auto shard_manager = ShardManager::Create(
+      num_shards_, std::move(cluster_mappings),
+      std::make_unique<MockRandomGenerator>(), [](const std::string& ip) {
+        auto mock_remote_lookup_client =
+            std::make_unique<MockRemoteLookupClient>();
+        if (ip != "1") {
+          return mock_remote_lookup_client;
+        }
+        InternalLookupRequest request;
+        request.add_keys("key1");
+        request.set_lookup_sets(true);
+        request.set_result_format(LOOKUP_RESULT_FORMAT_COMPACT_V1);
+        const std::string serialized_request = request.SerializeAsString();
+        EXPECT_CALL(*mock_remote_lookup_client,
+                    GetValues(_, serialized_request, _))
+            .WillOnce([]() {
+              InternalLookupResponse resp;
+              TextFormat::ParseFromString(
+                  R"pb(kv_pairs {
+                         key: "key1"
+                         value { keyset_values { values: "b" values: "c" } }
+                       }
+                  )pb",
+                  &resp);
+              return resp;
+            });
+        return mock_remote_lookup_client;
+      });
+
+  auto sharded_lookup = CreateShardedLookup(
+      mock_local_lookup_, num_shards_, shard_num_, *(*shard_manager),
+      key_sharder_, /*executor=*/nullptr, HedgingOptions(), PaddingOptions(),
+      /*query_pushdown=*/true);
+  auto response = sharded_lookup->RunQuery(GetRequestContext(), "key1 & key4");
+  ASSERT_TRUE(response.ok()) << response.status();
+  EXPECT_THAT(response.value().elements(), testing::ElementsAre("b"));
+}
+
+TEST_F(ShardedLookupTest, RunQuery_Pushdown_ShardFails_ReturnsStatus) {
+  std::vector<absl::flat_hash_set<std::string>> cluster_mappings;
+  for (int i = 0; i < 2; i++) {
+    cluster_mappings.push_back({std::to_string(i)});
+  }
+  auto shard_manager = ShardManager::Create(
+      num_shards_, std::move(cluster_mappings),
+      std::make_unique<MockRandomGenerator>(), [](const std::string& ip) {
+        auto mock_remote_lookup_client =
+            std::make_unique<MockRemoteLookupClient>();
+        if (ip != "1") {
+          return mock_remote_lookup_client;
+        }
+        EXPECT_CALL(*mock_remote_lookup_client, GetValues(_, _, _))
+            .WillOnce([]() {
+              InternalLookupResponse resp;
+              TextFormat::ParseFromString(
+                  R"pb(query_results {
+                         key: "(\"key1\" & \"key2\")"
+                         value { status { code: 13 } }
+                       }
+                  )pb",
+                  &resp);
+              return resp;
+            });
+        return mock_remote_lookup_client;
+      });
+
+  auto sharded_lookup = CreateShardedLookup(
+      mock_local_lookup_, num_shards_, shard_num_, *(*shard_manager),
+      key_sharder_, /*executor=*/nullptr, HedgingOptions(), PaddingOptions(),
+      /*query_pushdown=*/true);
+  auto response = sharded_lookup->RunQuery(GetRequestContext(), "key1 & key2");
+  EXPECT_EQ(response.status().code(), absl::StatusCode::kInternal);
+}
+
 TEST_F(ShardedLookupTest, RunQuery_ParseError_ReturnStatus) {
   std::vector<absl::flat_hash_set<std::string>> cluster_mappings;
   for (int i = 0; i < 2; i++) {
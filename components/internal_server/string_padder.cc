@@ -15,23 +15,45 @@
 
 #include <string>
 
+#include "absl/log/check.h"
 #include "absl/log/log.h"
 #include "quiche/common/quiche_data_reader.h"
 #include "quiche/common/quiche_data_writer.h"
 
 namespace kv_server {
 
+namespace {
+constexpr char kFiller = '0';
+}  // namespace
+
 std::string Pad(std::string_view string_to_pad, int32_t extra_padding) {
-  int output_size = sizeof(u_int32_t) + string_to_pad.size() + extra_padding;
-  std::string output(output_size, '0');
+  // Appended to rather than filled and overwritten, so that the request is
+  // only copied once.
+  char length[sizeof(uint32_t)];
+  quiche::QuicheDataWriter(sizeof(length), length)
+      .WriteUInt32(string_to_pad.size());
+  std::string output;
+  output.reserve(PaddedSize(string_to_pad, extra_padding));
+  output.append(length, sizeof(length));
+  output.append(string_to_pad);
+  output.append(extra_padding, kFiller);
+  return output;
+}
 
+size_t PaddedSize(std::string_view string_to_pad, int32_t extra_padding) {
+  return sizeof(uint32_t) + string_to_pad.size() + extra_padding;
+}
+
+void PadInto(std::string_view string_to_pad, int32_t extra_padding,
+             absl::Span<char> output) {
+  DCHECK_EQ(output.size(), PaddedSize(string_to_pad, extra_padding));
   quiche::QuicheDataWriter data_writer(output.size(), output.data());
   data_writer.WriteUInt32(string_to_pad.size());
   data_writer.WriteStringPiece(string_to_pad);
-  return output;
+  data_writer.WriteRepeatedByte(kFiller, extra_padding);
 }
 
-absl::StatusOr<std::string> Unpad(std::string_view padded_string) {
+absl::StatusOr<std::string_view> Unpad(std::string_view padded_string) {
   auto data_reader = quiche::QuicheDataReader(padded_string);
   uint32_t string_size = 0;
   if (!data_reader.ReadUInt32(&string_size)) {
@@ -43,7 +65,7 @@ absl::StatusOr<std::string> Unpad(std::string_view padded_string) {
     return absl::InvalidArgumentError("Failed to read a string");
   }
   VLOG(9) << "string: " << output;
-  return std::string(output);
+  return output;
 }
 
 }  // namespace kv_server
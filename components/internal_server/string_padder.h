@@ -18,9 +18,11 @@
 #define COMPONENTS_INTERNAL_SERVER_STRING_PADDER_H_
 
 #include <string>
+#include <string_view>
 
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/types/span.h"
 
 namespace kv_server {
 // Returns the string of the following format:
@@ -28,9 +30,15 @@ namespace kv_server {
 //  length               data           filler
 // filler.size() == extra_padding
 std::string Pad(std::string_view string_to_pad, int32_t extra_padding);
+// Returns the size of the string returned by `Pad`.
+size_t PaddedSize(std::string_view string_to_pad, int32_t extra_padding);
+// Writes the string returned by `Pad` into `output`, which must be
+// `PaddedSize` bytes long, for callers that pad into a buffer of their own.
+void PadInto(std::string_view string_to_pad, int32_t extra_padding,
+             absl::Span<char> output);
 // Takes the string padded with the method above OR in the same format
-// and returns the string.
-absl::StatusOr<std::string> Unpad(std::string_view padded_string);
+// and returns a view of the string inside `padded_string`.
+absl::StatusOr<std::string_view> Unpad(std::string_view padded_string);
 }  // namespace kv_server
 
 #endif  // COMPONENTS_INTERNAL_SERVER_STRING_PADDER_H_
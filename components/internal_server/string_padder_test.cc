@@ -14,6 +14,7 @@
 
 #include "components/internal_server/string_padder.h"
 
+#include <string>
 #include <string_view>
 
 #include "gtest/gtest.h"
@@ -57,6 +58,19 @@ TEST(PadUnpadEmtpyString, Success) {
   EXPECT_EQ(*original_string_status, kTestString);
 }
 
+TEST(PadInto, MatchesPad) {
+  const std::string_view kTestString = "string to pad";
+  const int32_t padding_size = 10;
+  std::string buffer(PaddedSize(kTestString, padding_size), 'x');
+  PadInto(kTestString, padding_size, absl::MakeSpan(buffer));
+  EXPECT_EQ(buffer, Pad(kTestString, padding_size));
+  auto original_string_status = Unpad(buffer);
+  ASSERT_TRUE(original_string_status.ok());
+  EXPECT_EQ(*original_string_status, kTestString);
+  // The unpadded string is a view into the padded one.
+  EXPECT_EQ(original_string_status->data(), buffer.data() + sizeof(uint32_t));
+}
+
 TEST(UnpadFailure, Success) {
   auto original_string_status = Unpad("garbage");
   ASSERT_FALSE(original_string_status.ok());
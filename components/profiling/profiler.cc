@@ -0,0 +1,104 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/profiling/profiler.h"
+
+#include <dlfcn.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <utility>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/time/clock.h"
+#include "tcmalloc/malloc_extension.h"
+#include "tcmalloc/profile_marshaler.h"
+
+namespace kv_server {
+namespace {
+
+// Entry points of the gperftools CPU profiler, which are looked up at runtime
+// so that the server only depends on `libprofiler.so` when it is preloaded.
+using ProfilerStartFn = int (*)(const char*);
+using ProfilerStopFn = void (*)();
+
+absl::StatusOr<std::string> ReadFile(const std::string& path) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    return absl::InternalError(absl::StrCat("Failed to open ", path));
+  }
+  std::stringstream contents;
+  contents << file.rdbuf();
+  return std::move(contents).str();
+}
+
+class ProfilerImpl : public Profiler {
+ public:
+  absl::StatusOr<std::string> ProfileCpu(absl::Duration duration) override {
+    auto start = reinterpret_cast<ProfilerStartFn>(
+        dlsym(RTLD_DEFAULT, "ProfilerStart"));
+    auto stop =
+        reinterpret_cast<ProfilerStopFn>(dlsym(RTLD_DEFAULT, "ProfilerStop"));
+    if (start == nullptr || stop == nullptr) {
+      return absl::UnimplementedError(
+          "CPU profiles require libprofiler.so to be preloaded");
+    }
+    std::string path =
+        (std::filesystem::temp_directory_path() / "kv_server.cpu.XXXXXX")
+            .string();
+    const int fd = mkstemp(path.data());
+    if (fd < 0) {
+      return absl::InternalError("Failed to create a CPU profile file");
+    }
+    close(fd);
+    if (!start(path.c_str())) {
+      std::filesystem::remove(path);
+      return absl::FailedPreconditionError(
+          "Failed to start the CPU profiler, which may already be running "
+          "because of CPUPROFILE");
+    }
+    absl::SleepFor(duration);
+    stop();
+    auto profile = ReadFile(path);
+    std::filesystem::remove(path);
+    return profile;
+  }
+
+  absl::StatusOr<std::string> ProfileHeap() override {
+    return tcmalloc::Marshal(tcmalloc::MallocExtension::SnapshotCurrent(
+        tcmalloc::ProfileType::kHeap));
+  }
+
+  absl::StatusOr<std::string> ProfileAllocations(
+      absl::Duration duration) override {
+    auto token = tcmalloc::MallocExtension::StartAllocationProfiling();
+    absl::SleepFor(duration);
+    return tcmalloc::Marshal(std::move(token).Stop());
+  }
+};
+
+}  // namespace
+
+std::unique_ptr<Profiler> Profiler::Create() {
+  return std::make_unique<ProfilerImpl>();
+}
+
+}  // namespace kv_server
@@ -0,0 +1,51 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef COMPONENTS_PROFILING_PROFILER_H_
+#define COMPONENTS_PROFILING_PROFILER_H_
+
+#include <memory>
+#include <string>
+
+#include "absl/status/statusor.h"
+#include "absl/time/time.h"
+
+namespace kv_server {
+
+// Profiles the running process. Profiles are returned serialized, in formats
+// read by pprof.
+class Profiler {
+ public:
+  virtual ~Profiler() = default;
+
+  // Profiles the CPU usage of the process over `duration`, with the
+  // gperftools CPU profiler. Returns `UNIMPLEMENTED` if `libprofiler.so` is
+  // not loaded into the process.
+  virtual absl::StatusOr<std::string> ProfileCpu(absl::Duration duration) = 0;
+
+  // Profiles the memory that is live in the heap, as sampled by tcmalloc.
+  virtual absl::StatusOr<std::string> ProfileHeap() = 0;
+
+  // Profiles the allocations made over `duration`, as sampled by tcmalloc.
+  virtual absl::StatusOr<std::string> ProfileAllocations(
+      absl::Duration duration) = 0;
+
+  static std::unique_ptr<Profiler> Create();
+};
+
+}  // namespace kv_server
+
+#endif  // COMPONENTS_PROFILING_PROFILER_H_
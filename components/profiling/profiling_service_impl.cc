@@ -0,0 +1,165 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/profiling/profiling_service_impl.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <thread>
+#include <utility>
+
+#include "absl/log/log.h"
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+
+namespace kv_server {
+namespace {
+
+using grpc::CallbackServerContext;
+
+grpc::Status ToGrpcStatus(const absl::Status& status) {
+  return grpc::Status(static_cast<grpc::StatusCode>(status.code()),
+                      std::string(status.message()));
+}
+
+// Duration of `seconds`, which must not exceed `max_duration`.
+absl::StatusOr<absl::Duration> ToDuration(int32_t seconds,
+                                          absl::Duration max_duration) {
+  const absl::Duration duration = absl::Seconds(seconds);
+  if (duration < absl::ZeroDuration() || duration > max_duration) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("Profile duration must be between 0 and ",
+                     absl::FormatDuration(max_duration)));
+  }
+  return duration;
+}
+
+}  // namespace
+
+ProfilingServiceImpl::~ProfilingServiceImpl() {
+  std::thread thread;
+  {
+    absl::MutexLock lock(&mutex_);
+    thread = std::move(thread_);
+  }
+  if (thread.joinable()) {
+    thread.join();
+  }
+}
+
+grpc::ServerUnaryReactor* ProfilingServiceImpl::ProfileCpu(
+    CallbackServerContext* context, const ProfileCpuRequest* request,
+    ProfileCpuResponse* response) {
+  auto duration = ToDuration(request->duration_seconds(), max_duration_);
+  if (!duration.ok()) {
+    auto* reactor = context->DefaultReactor();
+    reactor->Finish(ToGrpcStatus(duration.status()));
+    return reactor;
+  }
+  if (*duration == absl::ZeroDuration()) {
+    *duration = std::min(kDefaultCpuProfileDuration, max_duration_);
+  }
+  LOG(INFO) << "Profiling CPU for " << *duration;
+  return Run(
+      context,
+      [this, duration = *duration] { return profiler_.ProfileCpu(duration); },
+      response->mutable_profile());
+}
+
+grpc::ServerUnaryReactor* ProfilingServiceImpl::ProfileHeap(
+    CallbackServerContext* context, const ProfileHeapRequest* request,
+    ProfileHeapResponse* response) {
+  auto duration =
+      ToDuration(request->allocations_duration_seconds(), max_duration_);
+  if (!duration.ok()) {
+    auto* reactor = context->DefaultReactor();
+    reactor->Finish(ToGrpcStatus(duration.status()));
+    return reactor;
+  }
+  if (*duration == absl::ZeroDuration()) {
+    LOG(INFO) << "Profiling the heap";
+    return Run(
+        context, [this] { return profiler_.ProfileHeap(); },
+        response->mutable_profile());
+  }
+  LOG(INFO) << "Profiling allocations for " << *duration;
+  return Run(
+      context,
+      [this, duration = *duration] {
+        return profiler_.ProfileAllocations(duration);
+      },
+      response->mutable_profile());
+}
+
+grpc::ServerUnaryReactor* ProfilingServiceImpl::GetHotKeys(
+    CallbackServerContext* context, const GetHotKeysRequest* request,
+    GetHotKeysResponse* response) {
+  auto* reactor = context->DefaultReactor();
+  if (get_hot_keys_ == nullptr) {
+    reactor->Finish(grpc::Status(grpc::StatusCode::UNIMPLEMENTED,
+                                 "Hot key tracking is not enabled"));
+    return reactor;
+  }
+  if (request->num_keys_per_prefix() < 0) {
+    reactor->Finish(grpc::Status(grpc::StatusCode::INVALID_ARGUMENT,
+                                 "num_keys_per_prefix must not be negative"));
+    return reactor;
+  }
+  // Only reads the sketch of the cache, so it needs no profiling thread.
+  get_hot_keys_(request->num_keys_per_prefix() > 0
+                    ? request->num_keys_per_prefix()
+                    : kDefaultNumHotKeysPerPrefix,
+                *response);
+  reactor->Finish(grpc::Status::OK);
+  return reactor;
+}
+
+grpc::ServerUnaryReactor* ProfilingServiceImpl::Run(
+    CallbackServerContext* context,
+    std::function<absl::StatusOr<std::string>()> profile,
+    std::string* response_profile) {
+  auto* reactor = context->DefaultReactor();
+  absl::MutexLock lock(&mutex_);
+  if (running_) {
+    reactor->Finish(grpc::Status(grpc::StatusCode::RESOURCE_EXHAUSTED,
+                                 "Another profile is running"));
+    return reactor;
+  }
+  running_ = true;
+  // The thread of the previous profile is done, or about to be.
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+  thread_ = std::thread(
+      [this, reactor, profile = std::move(profile), response_profile] {
+        auto result = profile();
+        grpc::Status status;
+        if (result.ok()) {
+          *response_profile = *std::move(result);
+        } else {
+          LOG(ERROR) << "Failed to profile: " << result.status();
+          status = ToGrpcStatus(result.status());
+        }
+        {
+          absl::MutexLock lock(&mutex_);
+          running_ = false;
+        }
+        reactor->Finish(status);
+      });
+  return reactor;
+}
+
+}  // namespace kv_server
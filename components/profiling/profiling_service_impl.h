@@ -0,0 +1,88 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef COMPONENTS_PROFILING_PROFILING_SERVICE_IMPL_H_
+#define COMPONENTS_PROFILING_PROFILING_SERVICE_IMPL_H_
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <thread>
+#include <utility>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/status/statusor.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "components/profiling/profiler.h"
+#include "components/profiling/profiling.grpc.pb.h"
+#include "grpcpp/grpcpp.h"
+
+namespace kv_server {
+
+// Implements the admin profiling service. Profiles run on a thread of their
+// own, so that they don't hold a gRPC callback thread for their duration,
+// and one at a time, as the profilers are process wide.
+class ProfilingServiceImpl final : public ProfilingService::CallbackService {
+ public:
+  static constexpr absl::Duration kDefaultCpuProfileDuration =
+      absl::Seconds(10);
+  static constexpr int32_t kDefaultNumHotKeysPerPrefix = 10;
+
+  // Fills the response with the hot keys of every prefix, at most
+  // `num_keys_per_prefix` of them.
+  using GetHotKeysFn = std::function<void(int32_t num_keys_per_prefix,
+                                          GetHotKeysResponse& response)>;
+
+  // `GetHotKeys` calls are unimplemented without `get_hot_keys`.
+  ProfilingServiceImpl(Profiler& profiler, absl::Duration max_duration,
+                       GetHotKeysFn get_hot_keys = nullptr)
+      : profiler_(profiler),
+        max_duration_(max_duration),
+        get_hot_keys_(std::move(get_hot_keys)) {}
+  ~ProfilingServiceImpl() override;
+
+  grpc::ServerUnaryReactor* ProfileCpu(
+      grpc::CallbackServerContext* context, const ProfileCpuRequest* request,
+      ProfileCpuResponse* response) override;
+
+  grpc::ServerUnaryReactor* ProfileHeap(
+      grpc::CallbackServerContext* context, const ProfileHeapRequest* request,
+      ProfileHeapResponse* response) override;
+
+  grpc::ServerUnaryReactor* GetHotKeys(grpc::CallbackServerContext* context,
+                                       const GetHotKeysRequest* request,
+                                       GetHotKeysResponse* response) override;
+
+ private:
+  // Runs `profile` on the profiling thread and finishes the call with its
+  // result, unless a profile is already running.
+  grpc::ServerUnaryReactor* Run(
+      grpc::CallbackServerContext* context,
+      std::function<absl::StatusOr<std::string>()> profile,
+      std::string* response_profile) ABSL_LOCKS_EXCLUDED(mutex_);
+
+  Profiler& profiler_;
+  const absl::Duration max_duration_;
+  const GetHotKeysFn get_hot_keys_;
+  absl::Mutex mutex_;
+  bool running_ ABSL_GUARDED_BY(mutex_) = false;
+  std::thread thread_ ABSL_GUARDED_BY(mutex_);
+};
+
+}  // namespace kv_server
+
+#endif  // COMPONENTS_PROFILING_PROFILING_SERVICE_IMPL_H_
@@ -0,0 +1,184 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/profiling/profiling_service_impl.h"
+
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "absl/synchronization/notification.h"
+#include "gmock/gmock.h"
+#include "grpcpp/grpcpp.h"
+#include "gtest/gtest.h"
+
+namespace kv_server {
+namespace {
+
+using testing::_;
+using testing::Return;
+
+class MockProfiler : public Profiler {
+ public:
+  MOCK_METHOD(absl::StatusOr<std::string>, ProfileCpu, (absl::Duration),
+              (override));
+  MOCK_METHOD(absl::StatusOr<std::string>, ProfileHeap, (), (override));
+  MOCK_METHOD(absl::StatusOr<std::string>, ProfileAllocations,
+              (absl::Duration), (override));
+};
+
+class ProfilingServiceImplTest : public ::testing::Test {
+ protected:
+  ProfilingServiceImplTest() {
+    service_ = std::make_unique<ProfilingServiceImpl>(mock_profiler_,
+                                                      absl::Seconds(60));
+    grpc::ServerBuilder builder;
+    builder.RegisterService(service_.get());
+    server_ = builder.BuildAndStart();
+    stub_ = ProfilingService::NewStub(
+        server_->InProcessChannel(grpc::ChannelArguments()));
+  }
+  ~ProfilingServiceImplTest() {
+    server_->Shutdown();
+    server_->Wait();
+  }
+
+  MockProfiler mock_profiler_;
+  std::unique_ptr<ProfilingServiceImpl> service_;
+  std::unique_ptr<grpc::Server> server_;
+  std::unique_ptr<ProfilingService::Stub> stub_;
+};
+
+TEST_F(ProfilingServiceImplTest, ProfileCpu_DefaultDuration) {
+  EXPECT_CALL(mock_profiler_, ProfileCpu(absl::Seconds(10)))
+      .WillOnce(Return("cpu profile"));
+  grpc::ClientContext context;
+  ProfileCpuResponse response;
+  const grpc::Status status =
+      stub_->ProfileCpu(&context, ProfileCpuRequest(), &response);
+  ASSERT_TRUE(status.ok()) << status.error_message();
+  EXPECT_EQ(response.profile(), "cpu profile");
+}
+
+TEST_F(ProfilingServiceImplTest, ProfileCpu_ProfilerError) {
+  EXPECT_CALL(mock_profiler_, ProfileCpu(absl::Seconds(5)))
+      .WillOnce(Return(absl::UnimplementedError("no profiler")));
+  grpc::ClientContext context;
+  ProfileCpuRequest request;
+  request.set_duration_seconds(5);
+  ProfileCpuResponse response;
+  const grpc::Status status = stub_->ProfileCpu(&context, request, &response);
+  EXPECT_EQ(status.error_code(), grpc::StatusCode::UNIMPLEMENTED);
+}
+
+TEST_F(ProfilingServiceImplTest, ProfileCpu_RejectsDurationOverMax) {
+  EXPECT_CALL(mock_profiler_, ProfileCpu(_)).Times(0);
+  grpc::ClientContext context;
+  ProfileCpuRequest request;
+  request.set_duration_seconds(61);
+  ProfileCpuResponse response;
+  const grpc::Status status = stub_->ProfileCpu(&context, request, &response);
+  EXPECT_EQ(status.error_code(), grpc::StatusCode::INVALID_ARGUMENT);
+}
+
+TEST_F(ProfilingServiceImplTest, ProfileHeap_LiveHeap) {
+  EXPECT_CALL(mock_profiler_, ProfileHeap()).WillOnce(Return("heap profile"));
+  grpc::ClientContext context;
+  ProfileHeapResponse response;
+  const grpc::Status status =
+      stub_->ProfileHeap(&context, ProfileHeapRequest(), &response);
+  ASSERT_TRUE(status.ok()) << status.error_message();
+  EXPECT_EQ(response.profile(), "heap profile");
+}
+
+TEST_F(ProfilingServiceImplTest, ProfileHeap_Allocations) {
+  EXPECT_CALL(mock_profiler_, ProfileAllocations(absl::Seconds(3)))
+      .WillOnce(Return("allocation profile"));
+  grpc::ClientContext context;
+  ProfileHeapRequest request;
+  request.set_allocations_duration_seconds(3);
+  ProfileHeapResponse response;
+  const grpc::Status status = stub_->ProfileHeap(&context, request, &response);
+  ASSERT_TRUE(status.ok()) << status.error_message();
+  EXPECT_EQ(response.profile(), "allocation profile");
+}
+
+TEST_F(ProfilingServiceImplTest, RejectsConcurrentProfiles) {
+  absl::Notification started;
+  absl::Notification stop;
+  EXPECT_CALL(mock_profiler_, ProfileCpu(_))
+      .WillOnce([&](absl::Duration) -> absl::StatusOr<std::string> {
+        started.Notify();
+        stop.WaitForNotification();
+        return "cpu profile";
+      });
+  std::thread first([this] {
+    grpc::ClientContext context;
+    ProfileCpuResponse response;
+    EXPECT_TRUE(
+        stub_->ProfileCpu(&context, ProfileCpuRequest(), &response).ok());
+  });
+  started.WaitForNotification();
+  grpc::ClientContext context;
+  ProfileHeapResponse response;
+  const grpc::Status status =
+      stub_->ProfileHeap(&context, ProfileHeapRequest(), &response);
+  EXPECT_EQ(status.error_code(), grpc::StatusCode::RESOURCE_EXHAUSTED);
+  stop.Notify();
+  first.join();
+}
+
+TEST_F(ProfilingServiceImplTest, GetHotKeys_Unimplemented) {
+  grpc::ClientContext context;
+  GetHotKeysResponse response;
+  const grpc::Status status =
+      stub_->GetHotKeys(&context, GetHotKeysRequest(), &response);
+  EXPECT_EQ(status.error_code(), grpc::StatusCode::UNIMPLEMENTED);
+}
+
+TEST_F(ProfilingServiceImplTest, GetHotKeys) {
+  ProfilingServiceImpl service(
+      mock_profiler_, absl::Seconds(60),
+      [](int32_t num_keys_per_prefix, GetHotKeysResponse& response) {
+        auto* hot_key = (*response.mutable_prefixes())["prefix"].add_keys();
+        hot_key->set_key("key");
+        hot_key->set_estimated_lookups(num_keys_per_prefix);
+      });
+  grpc::ServerBuilder builder;
+  builder.RegisterService(&service);
+  std::unique_ptr<grpc::Server> server = builder.BuildAndStart();
+  auto stub = ProfilingService::NewStub(
+      server->InProcessChannel(grpc::ChannelArguments()));
+
+  grpc::ClientContext context;
+  GetHotKeysResponse response;
+  grpc::Status status =
+      stub->GetHotKeys(&context, GetHotKeysRequest(), &response);
+  ASSERT_TRUE(status.ok()) << status.error_message();
+  ASSERT_EQ(response.prefixes().at("prefix").keys_size(), 1);
+  EXPECT_EQ(response.prefixes().at("prefix").keys(0).key(), "key");
+  EXPECT_EQ(response.prefixes().at("prefix").keys(0).estimated_lookups(),
+            ProfilingServiceImpl::kDefaultNumHotKeysPerPrefix);
+
+  grpc::ClientContext negative_context;
+  GetHotKeysRequest request;
+  request.set_num_keys_per_prefix(-1);
+  status = stub->GetHotKeys(&negative_context, request, &response);
+  EXPECT_EQ(status.error_code(), grpc::StatusCode::INVALID_ARGUMENT);
+  server->Shutdown();
+  server->Wait();
+}
+
+}  // namespace
+}  // namespace kv_server
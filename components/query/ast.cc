@@ -16,10 +16,15 @@
 
 #include <algorithm>
 #include <string>
+#include <string_view>
 #include <utility>
 #include <vector>
 
+#include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
+#include "absl/functional/function_ref.h"
+#include "absl/strings/str_cat.h"
+#include "components/query/roaring_bitmap.h"
 #include "components/query/sets.h"
 
 namespace kv_server {
@@ -29,7 +34,10 @@ namespace {
 // Returns a vector of `Node`s in post order.
 // This is represents the infix input as postfix.
 // Postfix can then be more easily evaluated.
-std::vector<const Node*> PostOrderTraversal(const Node* root) {
+// The subtrees of `leaves` are not traversed below their roots.
+std::vector<const Node*> PostOrderTraversal(
+    const Node* root,
+    const absl::flat_hash_map<const Node*, KVSetView>* leaves = nullptr) {
   std::vector<const Node*> result;
   std::vector<const Node*> stack;
   stack.push_back(root);
@@ -37,6 +45,9 @@ std::vector<const Node*> PostOrderTraversal(const Node* root) {
     const Node* top = stack.back();
     stack.pop_back();
     result.push_back(top);
+    if (leaves != nullptr && leaves->contains(top)) {
+      continue;
+    }
     if (top->Left()) {
       stack.push_back(top->Left());
     }
@@ -48,34 +59,174 @@ std::vector<const Node*> PostOrderTraversal(const Node* root) {
   return result;
 }
 
+class QueryStringVisitor : public ASTStringVisitor {
+ public:
+  std::string Visit(const UnionNode& node) override {
+    return VisitOp(node, " | ");
+  }
+  std::string Visit(const DifferenceNode& node) override {
+    return VisitOp(node, " - ");
+  }
+  std::string Visit(const IntersectionNode& node) override {
+    return VisitOp(node, " & ");
+  }
+  std::string Visit(const ValueNode& node) override {
+    return absl::StrCat("\"", node.Key(), "\"");
+  }
+
+ private:
+  std::string VisitOp(const OpNode& node, const char* op) {
+    return absl::StrCat("(", node.Left()->Accept(*this), op,
+                        node.Right()->Accept(*this), ")");
+  }
+};
+
 }  // namespace
 
-void ASTStackVisitor::Visit(const OpNode& node, std::vector<KVSetView>& stack) {
-  KVSetView right = std::move(stack.back());
+template <typename SetT>
+void VisitOp(const OpNode& node, std::vector<SetT>& stack) {
+  SetT right = std::move(stack.back());
   stack.pop_back();
-  KVSetView left = std::move(stack.back());
+  SetT left = std::move(stack.back());
   stack.pop_back();
   stack.emplace_back(node.Op(std::move(left), std::move(right)));
 }
 
+void ASTStackVisitor::Visit(const OpNode& node, std::vector<KVSetView>& stack) {
+  VisitOp(node, stack);
+}
+
+void ASTStackVisitor::Visit(const OpNode& node,
+                            std::vector<RoaringBitmap>& stack) {
+  VisitOp(node, stack);
+}
+
+// Returns the set of `key` from `lookup`, or from `shared_sets` if the key is
+// one of `repeated_keys`, see `ASTStackVisitor::ShareRepeatedKeys`.
+template <typename SetT>
+SetT LookupShared(std::string_view key,
+                  absl::flat_hash_map<std::string_view, int>& repeated_keys,
+                  absl::flat_hash_map<std::string_view, SetT>& shared_sets,
+                  absl::FunctionRef<SetT()> lookup) {
+  const auto visits = repeated_keys.find(key);
+  if (visits == repeated_keys.end()) {
+    return lookup();
+  }
+  auto [it, inserted] = shared_sets.try_emplace(key);
+  if (inserted) {
+    it->second = lookup();
+  }
+  if (--visits->second > 0) {
+    return it->second;
+  }
+  SetT set = std::move(it->second);
+  shared_sets.erase(it);
+  repeated_keys.erase(visits);
+  return set;
+}
+
 void ASTStackVisitor::Visit(const ValueNode& node,
                             std::vector<KVSetView>& stack) {
-  stack.emplace_back(node.Lookup());
+  stack.emplace_back(LookupShared<KVSetView>(
+      node.Key(), repeated_keys_, shared_sets_, [this, &node]() {
+        return lookup_fn_.has_value() ? (*lookup_fn_)(node.Key())
+                                      : node.Lookup();
+      }));
 }
 
-KVSetView Compute(const std::vector<const Node*>& postorder) {
-  std::vector<KVSetView> stack;
-  ASTStackVisitor visitor;
+void ASTStackVisitor::Visit(const ValueNode& node,
+                            std::vector<RoaringBitmap>& stack) {
+  stack.emplace_back(LookupShared<RoaringBitmap>(
+      node.Key(), repeated_keys_, shared_ids_, [this, &node]() {
+        return id_lookup_fn_.has_value() ? (*id_lookup_fn_)(node.Key())
+                                         : node.LookupIds();
+      }));
+}
+
+void ASTStackVisitor::ShareRepeatedKeys(const std::vector<const Node*>& nodes) {
+  absl::flat_hash_map<std::string_view, int> visits;
+  for (const Node* node : nodes) {
+    if (node->Left() == nullptr && node->Right() == nullptr) {
+      // ValueNode
+      for (std::string_view key : node->Keys()) {
+        visits[key]++;
+      }
+    }
+  }
+  for (const auto& [key, count] : visits) {
+    if (count > 1) {
+      repeated_keys_[key] += count;
+    }
+  }
+}
+
+template <typename SetT>
+SetT Compute(const std::vector<const Node*>& postorder,
+             ASTStackVisitor& visitor) {
+  visitor.ShareRepeatedKeys(postorder);
+  std::vector<SetT> stack;
   // Apply the operations on the postorder stack
   for (const auto* node : postorder) {
     node->Accept(visitor, stack);
   }
-  return stack.back();
+  return std::move(stack.back());
 }
 
 KVSetView Eval(const Node& node) {
   std::vector<const Node*> postorder = PostOrderTraversal(&node);
-  return Compute(postorder);
+  ASTStackVisitor visitor;
+  return Compute<KVSetView>(postorder, visitor);
+}
+
+RoaringBitmap EvalIds(const Node& node) {
+  std::vector<const Node*> postorder = PostOrderTraversal(&node);
+  ASTStackVisitor visitor;
+  return Compute<RoaringBitmap>(postorder, visitor);
+}
+
+KVSetView Eval(const Node& node,
+               absl::FunctionRef<KVSetView(std::string_view key)> lookup_fn) {
+  std::vector<const Node*> postorder = PostOrderTraversal(&node);
+  ASTStackVisitor visitor(lookup_fn);
+  return Compute<KVSetView>(postorder, visitor);
+}
+
+RoaringBitmap EvalIds(
+    const Node& node,
+    absl::FunctionRef<RoaringBitmap(std::string_view key)> id_lookup_fn) {
+  std::vector<const Node*> postorder = PostOrderTraversal(&node);
+  ASTStackVisitor visitor(id_lookup_fn);
+  return Compute<RoaringBitmap>(postorder, visitor);
+}
+
+KVSetView Eval(
+    const Node& node,
+    absl::FunctionRef<KVSetView(std::string_view key)> lookup_fn,
+    const absl::flat_hash_map<const Node*, KVSetView>& subtree_sets) {
+  std::vector<const Node*> postorder =
+      PostOrderTraversal(&node, &subtree_sets);
+  ASTStackVisitor visitor(lookup_fn);
+  std::vector<const Node*> visited;
+  for (const auto* next : postorder) {
+    if (!subtree_sets.contains(next)) {
+      visited.push_back(next);
+    }
+  }
+  visitor.ShareRepeatedKeys(visited);
+  std::vector<KVSetView> stack;
+  for (const auto* next : postorder) {
+    if (const auto it = subtree_sets.find(next); it != subtree_sets.end()) {
+      stack.push_back(it->second);
+    } else {
+      next->Accept(visitor, stack);
+    }
+  }
+  return std::move(stack.back());
+}
+
+std::string ToQueryString(const Node& node) {
+  QueryStringVisitor visitor;
+  return node.Accept(visitor);
 }
 
 void OpNode::Accept(ASTStackVisitor& visitor,
@@ -83,6 +234,11 @@ void OpNode::Accept(ASTStackVisitor& visitor,
   visitor.Visit(*this, stack);
 }
 
+void OpNode::Accept(ASTStackVisitor& visitor,
+                    std::vector<RoaringBitmap>& stack) const {
+  visitor.Visit(*this, stack);
+}
+
 std::string UnionNode::Accept(ASTStringVisitor& visitor) const {
   return visitor.Visit(*this);
 }
@@ -93,6 +249,14 @@ std::string IntersectionNode::Accept(ASTStringVisitor& visitor) const {
   return visitor.Visit(*this);
 }
 
+void UnionNode::Accept(ASTVisitor& visitor) const { visitor.Visit(*this); }
+void DifferenceNode::Accept(ASTVisitor& visitor) const {
+  visitor.Visit(*this);
+}
+void IntersectionNode::Accept(ASTVisitor& visitor) const {
+  visitor.Visit(*this);
+}
+
 absl::flat_hash_set<std::string_view> OpNode::Keys() const {
   std::vector<const Node*> nodes;
   absl::flat_hash_set<std::string_view> key_set;
@@ -122,6 +286,15 @@ ValueNode::ValueNode(
     absl::AnyInvocable<KVSetView(std::string_view key) const> lookup_fn,
     std::string key)
     : lookup_fn_(absl::bind_front(std::move(lookup_fn), key)),
+      id_lookup_fn_([]() { return RoaringBitmap(); }),
+      key_(std::move(key)) {}
+
+ValueNode::ValueNode(
+    absl::AnyInvocable<KVSetView(std::string_view key) const> lookup_fn,
+    absl::AnyInvocable<RoaringBitmap(std::string_view key) const> id_lookup_fn,
+    std::string key)
+    : lookup_fn_(absl::bind_front(std::move(lookup_fn), key)),
+      id_lookup_fn_(absl::bind_front(std::move(id_lookup_fn), key)),
       key_(std::move(key)) {}
 
 void ValueNode::Accept(ASTStackVisitor& visitor,
@@ -129,10 +302,17 @@ void ValueNode::Accept(ASTStackVisitor& visitor,
   visitor.Visit(*this, stack);
 }
 
+void ValueNode::Accept(ASTStackVisitor& visitor,
+                       std::vector<RoaringBitmap>& stack) const {
+  visitor.Visit(*this, stack);
+}
+
 std::string ValueNode::Accept(ASTStringVisitor& visitor) const {
   return visitor.Visit(*this);
 }
 
+void ValueNode::Accept(ASTVisitor& visitor) const { visitor.Visit(*this); }
+
 absl::flat_hash_set<std::string_view> ValueNode::Keys() const {
   // Return a set containing a view into this instances, `key_`.
   // Be sure that the reference is not to any temp string.
@@ -143,4 +323,6 @@ absl::flat_hash_set<std::string_view> ValueNode::Keys() const {
 
 KVSetView ValueNode::Lookup() const { return lookup_fn_(); }
 
+RoaringBitmap ValueNode::LookupIds() const { return id_lookup_fn_(); }
+
 }  // namespace kv_server
@@ -17,19 +17,24 @@
 #ifndef COMPONENTS_QUERY_AST_H_
 #define COMPONENTS_QUERY_AST_H_
 #include <memory>
+#include <optional>
 #include <string>
 #include <string_view>
 #include <utility>
 #include <vector>
 
+#include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
 #include "absl/functional/any_invocable.h"
 #include "absl/functional/bind_front.h"
+#include "absl/functional/function_ref.h"
+#include "components/query/roaring_bitmap.h"
 #include "components/query/sets.h"
 
 namespace kv_server {
 class ASTStackVisitor;
 class ASTStringVisitor;
+class ASTVisitor;
 
 // All set operations operate on a reference to the data in the DB
 // This means that the data in the DB must be locked throughout the lifetime of
@@ -47,7 +52,11 @@ class Node {
   // to mutate the stack accordingly for `Eval` (ValueNode vs. OpNode)
   virtual void Accept(ASTStackVisitor& visitor,
                       std::vector<KVSetView>& stack) const = 0;
+  // Same as above, for evaluating over the ids of interned set values.
+  virtual void Accept(ASTStackVisitor& visitor,
+                      std::vector<RoaringBitmap>& stack) const = 0;
   virtual std::string Accept(ASTStringVisitor& visitor) const = 0;
+  virtual void Accept(ASTVisitor& visitor) const = 0;
 };
 
 // The value associated with a `ValueNode` is the set with its associated `key`.
@@ -55,14 +64,27 @@ class ValueNode : public Node {
  public:
   ValueNode(absl::AnyInvocable<KVSetView(std::string_view key) const> lookup_fn,
             std::string key);
+  // `id_lookup_fn` returns the ids of the values of the set, used by
+  // `EvalIds`.
+  ValueNode(
+      absl::AnyInvocable<KVSetView(std::string_view key) const> lookup_fn,
+      absl::AnyInvocable<RoaringBitmap(std::string_view key) const>
+          id_lookup_fn,
+      std::string key);
   absl::flat_hash_set<std::string_view> Keys() const override;
   KVSetView Lookup() const;
+  RoaringBitmap LookupIds() const;
   void Accept(ASTStackVisitor& visitor,
               std::vector<KVSetView>& stack) const override;
+  void Accept(ASTStackVisitor& visitor,
+              std::vector<RoaringBitmap>& stack) const override;
   std::string Accept(ASTStringVisitor& visitor) const override;
+  void Accept(ASTVisitor& visitor) const override;
+  const std::string& Key() const { return key_; }
 
  private:
   absl::AnyInvocable<KVSetView() const> lookup_fn_;
+  absl::AnyInvocable<RoaringBitmap() const> id_lookup_fn_;
   std::string key_;
 };
 
@@ -75,8 +97,11 @@ class OpNode : public Node {
   inline Node* Right() const override { return right_.get(); }
   // Computes the operation over the `left` and `right` nodes.
   virtual KVSetView Op(KVSetView left, KVSetView right) const = 0;
+  virtual RoaringBitmap Op(RoaringBitmap left, RoaringBitmap right) const = 0;
   void Accept(ASTStackVisitor& visitor,
               std::vector<KVSetView>& stack) const override;
+  void Accept(ASTStackVisitor& visitor,
+              std::vector<RoaringBitmap>& stack) const override;
 
  private:
   std::unique_ptr<Node> left_;
@@ -90,7 +115,12 @@ class UnionNode : public OpNode {
   inline KVSetView Op(KVSetView left, KVSetView right) const override {
     return Union(std::move(left), std::move(right));
   }
+  inline RoaringBitmap Op(RoaringBitmap left,
+                          RoaringBitmap right) const override {
+    return Union(std::move(left), std::move(right));
+  }
   std::string Accept(ASTStringVisitor& visitor) const override;
+  void Accept(ASTVisitor& visitor) const override;
 };
 
 class IntersectionNode : public OpNode {
@@ -100,7 +130,12 @@ class IntersectionNode : public OpNode {
   inline KVSetView Op(KVSetView left, KVSetView right) const override {
     return Intersection(std::move(left), std::move(right));
   }
+  inline RoaringBitmap Op(RoaringBitmap left,
+                          RoaringBitmap right) const override {
+    return Intersection(std::move(left), std::move(right));
+  }
   std::string Accept(ASTStringVisitor& visitor) const override;
+  void Accept(ASTVisitor& visitor) const override;
 };
 
 class DifferenceNode : public OpNode {
@@ -110,21 +145,78 @@ class DifferenceNode : public OpNode {
   inline KVSetView Op(KVSetView left, KVSetView right) const override {
     return Difference(std::move(left), std::move(right));
   }
+  inline RoaringBitmap Op(RoaringBitmap left,
+                          RoaringBitmap right) const override {
+    return Difference(std::move(left), std::move(right));
+  }
   std::string Accept(ASTStringVisitor& visitor) const override;
+  void Accept(ASTVisitor& visitor) const override;
 };
 
 // Creates execution plan and runs it.
 KVSetView Eval(const Node& node);
 
+// Same as `Eval`, over the ids of interned set values. Avoids hashing the
+// values, which only have to be looked up for the final result.
+RoaringBitmap EvalIds(const Node& node);
+
+// Same as above, looking up the sets of the `ValueNode`s by key with the given
+// function instead of their own lookups. Allows evaluating the same AST
+// concurrently with different lookups.
+KVSetView Eval(const Node& node,
+               absl::FunctionRef<KVSetView(std::string_view key)> lookup_fn);
+RoaringBitmap EvalIds(
+    const Node& node,
+    absl::FunctionRef<RoaringBitmap(std::string_view key)> id_lookup_fn);
+
+// Same as above, taking the sets of the subtrees in `subtree_sets` as they are
+// instead of evaluating them, for subtrees that were evaluated elsewhere.
+KVSetView Eval(
+    const Node& node,
+    absl::FunctionRef<KVSetView(std::string_view key)> lookup_fn,
+    const absl::flat_hash_map<const Node*, KVSetView>& subtree_sets);
+
+// Returns a query that parses to the same AST as `node`, with every key quoted
+// and every operation parenthesized.
+std::string ToQueryString(const Node& node);
+
 // Responsible for mutating the stack with the given `Node`.
 // Avoids downcasting for subclass specific behaviors.
 class ASTStackVisitor {
  public:
+  ASTStackVisitor() = default;
+  // Looks up the sets of `ValueNode`s with `lookup_fn`, or the ids with
+  // `id_lookup_fn`, instead of with `Lookup` and `LookupIds`.
+  explicit ASTStackVisitor(
+      absl::FunctionRef<KVSetView(std::string_view key)> lookup_fn)
+      : lookup_fn_(lookup_fn) {}
+  explicit ASTStackVisitor(
+      absl::FunctionRef<RoaringBitmap(std::string_view key)> id_lookup_fn)
+      : id_lookup_fn_(id_lookup_fn) {}
+
   // Applies the operation to the top two values on the stack.
   // Replaces the top two values with the result.
   void Visit(const OpNode& node, std::vector<KVSetView>& stack);
+  void Visit(const OpNode& node, std::vector<RoaringBitmap>& stack);
   // Pushes the result of `Lookup` to the stack.
   void Visit(const ValueNode& node, std::vector<KVSetView>& stack);
+  // Pushes the result of `LookupIds` to the stack.
+  void Visit(const ValueNode& node, std::vector<RoaringBitmap>& stack);
+
+  // Makes the visits of the `ValueNode`s in `nodes` look up the set of each
+  // key once. The set of a key that several nodes have is kept after its
+  // lookup and copied for the following visits, except for the last one,
+  // which takes it over.
+  void ShareRepeatedKeys(const std::vector<const Node*>& nodes);
+
+ private:
+  std::optional<absl::FunctionRef<KVSetView(std::string_view key)>> lookup_fn_;
+  std::optional<absl::FunctionRef<RoaringBitmap(std::string_view key)>>
+      id_lookup_fn_;
+  // Number of visits left of each key that several nodes have.
+  absl::flat_hash_map<std::string_view, int> repeated_keys_;
+  absl::flat_hash_map<std::string_view, KVSetView> shared_sets_;
+  absl::flat_hash_map<std::string_view, RoaringBitmap> shared_ids_;
 };
 
 // General purpose Vistor capable of returning a string representation of a Node
@@ -137,5 +229,15 @@ class ASTStringVisitor {
   virtual std::string Visit(const ValueNode&) = 0;
 };
 
+// General purpose Visitor of the concrete `Node` classes.
+class ASTVisitor {
+ public:
+  virtual ~ASTVisitor() = default;
+  virtual void Visit(const UnionNode&) = 0;
+  virtual void Visit(const DifferenceNode&) = 0;
+  virtual void Visit(const IntersectionNode&) = 0;
+  virtual void Visit(const ValueNode&) = 0;
+};
+
 }  // namespace kv_server
 #endif  // COMPONENTS_QUERY_AST_H_
@@ -38,6 +38,15 @@ absl::flat_hash_set<std::string_view> Lookup(std::string_view key) {
   return {};
 }
 
+// Ids of the values of `kDb`, where value "a" has id 0, "b" id 1 and so on.
+RoaringBitmap LookupIds(std::string_view key) {
+  RoaringBitmap ids;
+  for (std::string_view value : Lookup(key)) {
+    ids.Add(value[0] - 'a');
+  }
+  return ids;
+}
+
 TEST(AstTest, Value) {
   ValueNode value(Lookup, "A");
   EXPECT_EQ(Eval(value), Lookup("A"));
@@ -122,6 +131,59 @@ TEST(AstTest, All) {
   EXPECT_EQ(Eval(center), expected);
 }
 
+TEST(AstTest, EvalIds) {
+  // (A-B) | (C&D) =
+  // {a} | {d,e} =
+  // {a, d, e}
+  auto a = std::make_unique<ValueNode>(Lookup, LookupIds, "A");
+  auto b = std::make_unique<ValueNode>(Lookup, LookupIds, "B");
+  auto c = std::make_unique<ValueNode>(Lookup, LookupIds, "C");
+  auto d = std::make_unique<ValueNode>(Lookup, LookupIds, "D");
+  auto left = std::make_unique<DifferenceNode>(std::move(a), std::move(b));
+  auto right = std::make_unique<IntersectionNode>(std::move(c), std::move(d));
+  UnionNode center(std::move(left), std::move(right));
+  EXPECT_THAT(EvalIds(center).ToVector(), testing::ElementsAre(0, 3, 4));
+  EXPECT_THAT(Eval(center), testing::UnorderedElementsAre("a", "d", "e"));
+}
+
+TEST(AstTest, EvalWithLookupFn) {
+  // The nodes never look up their own sets.
+  auto never_used = [](std::string_view) -> KVSetView {
+    ADD_FAILURE();
+    return {};
+  };
+  auto a = std::make_unique<ValueNode>(never_used, "A");
+  auto b = std::make_unique<ValueNode>(never_used, "B");
+  DifferenceNode op(std::move(a), std::move(b));
+  EXPECT_THAT(Eval(op, Lookup), testing::UnorderedElementsAre("a"));
+  EXPECT_THAT(EvalIds(op, LookupIds).ToVector(), testing::ElementsAre(0));
+}
+
+TEST(AstTest, EvalLooksUpRepeatedKeysOnce) {
+  absl::flat_hash_map<std::string_view, int> lookups;
+  auto counting_lookup = [&lookups](std::string_view key) {
+    lookups[key]++;
+    return Lookup(key);
+  };
+  // (A | B) - (A & C)
+  DifferenceNode op(
+      std::make_unique<UnionNode>(std::make_unique<ValueNode>(Lookup, "A"),
+                                  std::make_unique<ValueNode>(Lookup, "B")),
+      std::make_unique<IntersectionNode>(
+          std::make_unique<ValueNode>(Lookup, "A"),
+          std::make_unique<ValueNode>(Lookup, "C")));
+  EXPECT_THAT(Eval(op, counting_lookup),
+              testing::UnorderedElementsAre("a", "b", "d"));
+  EXPECT_EQ(lookups["A"], 1);
+  EXPECT_EQ(lookups["B"], 1);
+  EXPECT_EQ(lookups["C"], 1);
+}
+
+TEST(AstTest, EvalIdsWithoutIdLookup) {
+  ValueNode value(Lookup, "A");
+  EXPECT_TRUE(EvalIds(value).IsEmpty());
+}
+
 TEST(AstTest, ValueNodeKeys) {
   ValueNode v(Lookup, "A");
   EXPECT_THAT(v.Keys(), testing::UnorderedElementsAre("A"));
@@ -147,5 +209,27 @@ TEST(AstTest, DupeNodeKeys) {
   EXPECT_THAT(center.Keys(), testing::UnorderedElementsAre("A", "B", "C"));
 }
 
+TEST(AstTest, EvalWithSubtreeSets) {
+  std::unique_ptr<ValueNode> a = std::make_unique<ValueNode>(Lookup, "A");
+  std::unique_ptr<ValueNode> b = std::make_unique<ValueNode>(Lookup, "B");
+  std::unique_ptr<ValueNode> c = std::make_unique<ValueNode>(Lookup, "C");
+  auto left = std::make_unique<IntersectionNode>(std::move(a), std::move(b));
+  const Node* subtree = left.get();
+  UnionNode op(std::move(left), std::move(c));
+  const absl::flat_hash_map<const Node*, KVSetView> subtree_sets = {
+      {subtree, {"x"}}};
+  absl::flat_hash_set<std::string_view> expected = {"x", "c", "d", "e"};
+  EXPECT_EQ(Eval(op, Lookup, subtree_sets), expected);
+}
+
+TEST(AstTest, ToQueryString) {
+  std::unique_ptr<ValueNode> a = std::make_unique<ValueNode>(Lookup, "A");
+  std::unique_ptr<ValueNode> b = std::make_unique<ValueNode>(Lookup, "B-1");
+  std::unique_ptr<ValueNode> c = std::make_unique<ValueNode>(Lookup, "C");
+  auto left = std::make_unique<DifferenceNode>(std::move(a), std::move(b));
+  IntersectionNode op(std::move(left), std::move(c));
+  EXPECT_EQ(ToQueryString(op), R"((("A" - "B-1") & "C"))");
+}
+
 }  // namespace
 }  // namespace kv_server
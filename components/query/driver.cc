@@ -14,12 +14,18 @@
 
 #include "components/query/driver.h"
 
+#include <algorithm>
+#include <string>
 #include <string_view>
 #include <utility>
 
 #include "absl/container/flat_hash_set.h"
 #include "absl/functional/bind_front.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
 #include "components/query/ast.h"
+#include "components/query/plan.h"
+#include "components/query/roaring_bitmap.h"
 
 namespace kv_server {
 
@@ -28,12 +34,56 @@ Driver::Driver(absl::AnyInvocable<absl::flat_hash_set<std::string_view>(
                    lookup_fn)
     : lookup_fn_(std::move(lookup_fn)) {}
 
+Driver::Driver(absl::AnyInvocable<absl::flat_hash_set<std::string_view>(
+                   std::string_view key) const>
+                   lookup_fn,
+               absl::AnyInvocable<RoaringBitmap(std::string_view key) const>
+                   id_lookup_fn,
+               absl::AnyInvocable<size_t(std::string_view key) const>
+                   cardinality_fn)
+    : lookup_fn_(std::move(lookup_fn)),
+      id_lookup_fn_(std::move(id_lookup_fn)),
+      cardinality_fn_(std::move(cardinality_fn)) {}
+
 absl::flat_hash_set<std::string_view> Driver::Lookup(
     std::string_view key) const {
   return lookup_fn_(key);
 }
 
-void Driver::SetAst(std::unique_ptr<Node> ast) { ast_ = std::move(ast); }
+RoaringBitmap Driver::LookupIds(std::string_view key) const {
+  if (!id_lookup_fn_) {
+    return RoaringBitmap();
+  }
+  return id_lookup_fn_(key);
+}
+
+size_t Driver::Cardinality(std::string_view key) const {
+  if (!cardinality_fn_) {
+    return 0;
+  }
+  return cardinality_fn_(key);
+}
+
+QueryPlan Driver::CreatePlan() const {
+  return QueryPlan::Create(*ast_, absl::bind_front(&Driver::Cardinality, this));
+}
+
+void Driver::SetAst(std::unique_ptr<Node> ast) {
+  ast_ = std::move(ast);
+  limit_.reset();
+  count_ = false;
+  approx_count_ = false;
+}
+
+bool Driver::SetLimit(std::string_view limit) {
+  size_t value;
+  if (!absl::SimpleAtoi(limit, &value)) {
+    SetError(absl::StrCat("Invalid limit: ", limit));
+    return false;
+  }
+  limit_ = value;
+  return true;
+}
 
 absl::StatusOr<absl::flat_hash_set<std::string_view>> Driver::GetResult()
     const {
@@ -43,7 +93,46 @@ absl::StatusOr<absl::flat_hash_set<std::string_view>> Driver::GetResult()
   if (ast_ == nullptr) {
     return absl::flat_hash_set<std::string_view>();
   }
-  return Eval(*ast_);
+  if (limit_.has_value()) {
+    return GetResult(*limit_);
+  }
+  return CreatePlan().Eval(absl::bind_front(&Driver::Lookup, this));
+}
+
+absl::StatusOr<RoaringBitmap> Driver::GetIdResult() const {
+  if (!status_.ok()) {
+    return status_;
+  }
+  if (ast_ == nullptr) {
+    return RoaringBitmap();
+  }
+  if (limit_.has_value()) {
+    return GetIdResult(*limit_);
+  }
+  return CreatePlan().EvalIds(absl::bind_front(&Driver::LookupIds, this));
+}
+
+absl::StatusOr<absl::flat_hash_set<std::string_view>> Driver::GetResult(
+    size_t limit) const {
+  if (!status_.ok()) {
+    return status_;
+  }
+  if (ast_ == nullptr) {
+    return absl::flat_hash_set<std::string_view>();
+  }
+  return CreatePlan().Eval(absl::bind_front(&Driver::Lookup, this),
+                           std::min(limit, limit_.value_or(limit)));
+}
+
+absl::StatusOr<RoaringBitmap> Driver::GetIdResult(size_t limit) const {
+  if (!status_.ok()) {
+    return status_;
+  }
+  if (ast_ == nullptr) {
+    return RoaringBitmap();
+  }
+  return CreatePlan().EvalIds(absl::bind_front(&Driver::LookupIds, this),
+                              std::min(limit, limit_.value_or(limit)));
 }
 
 void Driver::SetError(std::string error) {
@@ -18,6 +18,7 @@
 #define COMPONENTS_QUERY_DRIVER_H_
 
 #include <memory>
+#include <optional>
 #include <string>
 #include <string_view>
 
@@ -26,12 +27,14 @@
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "components/query/ast.h"
+#include "components/query/plan.h"
+#include "components/query/roaring_bitmap.h"
 
 namespace kv_server {
 
 // Driver is responsible for:
 //   * Gathering the AST from the parser
-//   * Creating the exeuction plan
+//   * Creating the exeuction plan, see `QueryPlan`
 //   * Executing the query
 //   * Storing the result
 // Typical usage:
@@ -49,27 +52,78 @@ class Driver {
   explicit Driver(absl::AnyInvocable<absl::flat_hash_set<std::string_view>(
                       std::string_view key) const>
                       lookup_fn);
+  // `id_lookup_fn` returns the ids of the interned values of the set
+  // associated with the provided key, for `GetIdResult`.
+  // `cardinality_fn` returns the number of values of the set associated with
+  // the provided key, which orders the operands of the `QueryPlan`. Without
+  // it, operands are evaluated in the order of the query.
+  Driver(absl::AnyInvocable<absl::flat_hash_set<std::string_view>(
+             std::string_view key) const>
+             lookup_fn,
+         absl::AnyInvocable<RoaringBitmap(std::string_view key) const>
+             id_lookup_fn,
+         absl::AnyInvocable<size_t(std::string_view key) const>
+             cardinality_fn = nullptr);
 
-  // The result contains views of the data within the DB.
+  // The result contains views of the data within the DB. Queries with a
+  // `LIMIT` return at most that many values, see `GetResult(size_t)`.
   absl::StatusOr<absl::flat_hash_set<std::string_view>> GetResult() const;
 
+  // Evaluates the query over the ids returned by `id_lookup_fn`. The caller
+  // translates the ids of the result back to values.
+  absl::StatusOr<RoaringBitmap> GetIdResult() const;
+
+  // Same as above, returning at most `limit` arbitrary values of the result,
+  // or fewer if the query has a lower `LIMIT`. Evaluates the query lazily and
+  // stops once `limit` values are found, see `QueryPlan::ForEach`.
+  absl::StatusOr<absl::flat_hash_set<std::string_view>> GetResult(
+      size_t limit) const;
+  absl::StatusOr<RoaringBitmap> GetIdResult(size_t limit) const;
+
   // Returns the the `Node` associated with `SetAst`
   // or nullptr if unset.
   const kv_server::Node* GetRootNode() const;
 
+  // Returns the `n` of a query ending with `LIMIT n`.
+  std::optional<size_t> GetLimit() const { return limit_; }
+  // Returns whether the query is wrapped in `COUNT(...)`, in which case the
+  // caller returns the number of values of the result instead of the values.
+  bool IsCount() const { return count_; }
+  // Returns whether the query is wrapped in `APPROX_COUNT(...)`, in which case
+  // the caller returns the estimated number of values of the result, see
+  // `QueryPlan::EstimatedCardinality`, without looking up the sets.
+  bool IsApproxCount() const { return approx_count_; }
+
   // Clients should not call these functions, they are called by the parser.
+  // `SetAst` clears the limit and counts of a previous query.
   void SetAst(std::unique_ptr<kv_server::Node>);
+  // Returns false and sets the error if `limit` is not a non-negative integer.
+  bool SetLimit(std::string_view limit);
+  void SetCount() { count_ = true; }
+  void SetApproxCount() { approx_count_ = true; }
   void SetError(std::string error);
   void ClearError() { status_ = absl::OkStatus(); }
 
   // Looks up the set which contains a view of the DB data.
   absl::flat_hash_set<std::string_view> Lookup(std::string_view key) const;
+  // Looks up the ids of the values of the set. Returns an empty set if the
+  // driver has no `id_lookup_fn`.
+  RoaringBitmap LookupIds(std::string_view key) const;
+  // Returns 0 if the driver has no `cardinality_fn`.
+  size_t Cardinality(std::string_view key) const;
 
  private:
+  QueryPlan CreatePlan() const;
+
   absl::AnyInvocable<absl::flat_hash_set<std::string_view>(std::string_view key)
                          const>
       lookup_fn_;
+  absl::AnyInvocable<RoaringBitmap(std::string_view key) const> id_lookup_fn_;
+  absl::AnyInvocable<size_t(std::string_view key) const> cardinality_fn_;
   std::unique_ptr<kv_server::Node> ast_;
+  std::optional<size_t> limit_;
+  bool count_ = false;
+  bool approx_count_ = false;
   absl::Status status_ = absl::OkStatus();
 };
 
@@ -14,6 +14,8 @@
 
 #include "components/query/driver.h"
 
+#include <optional>
+#include <string>
 #include <thread>
 #include <vector>
 
@@ -45,6 +47,15 @@ class DriverTest : public ::testing::Test {
     return {};
   }
 
+  // Ids of the values of `db_`, where value "a" has id 0, "b" id 1 and so on.
+  RoaringBitmap LookupIds(std::string_view key) {
+    RoaringBitmap ids;
+    for (std::string_view value : Lookup(key)) {
+      ids.Add(value[0] - 'a');
+    }
+    return ids;
+  }
+
   void Parse(const std::string& query) {
     std::istringstream stream(query);
     Scanner scanner(stream);
@@ -215,6 +226,134 @@ TEST_F(DriverTest, EmptyResults) {
   EXPECT_EQ(result->size(), 0);
 }
 
+TEST_F(DriverTest, Limit) {
+  Parse("(A | B) LIMIT 2");
+  ASSERT_NE(driver_->GetRootNode(), nullptr);
+  EXPECT_EQ(driver_->GetLimit(), 2u);
+  EXPECT_FALSE(driver_->IsCount());
+  auto result = driver_->GetResult();
+  ASSERT_TRUE(result.ok());
+  EXPECT_EQ(result->size(), 2);
+  // The lower of the two limits applies.
+  result = driver_->GetResult(1);
+  ASSERT_TRUE(result.ok());
+  EXPECT_EQ(result->size(), 1);
+
+  Parse("A limit 0");
+  result = driver_->GetResult();
+  ASSERT_TRUE(result.ok());
+  EXPECT_TRUE(result->empty());
+
+  Parse("A");
+  EXPECT_EQ(driver_->GetLimit(), std::nullopt);
+}
+
+TEST_F(DriverTest, InvalidLimit) {
+  Parse("A LIMIT B");
+  EXPECT_EQ(driver_->GetResult().status().code(),
+            absl::StatusCode::kInvalidArgument);
+  Parse("A LIMIT -1");
+  EXPECT_EQ(driver_->GetResult().status().code(),
+            absl::StatusCode::kInvalidArgument);
+  Parse("LIMIT 1");
+  EXPECT_EQ(driver_->GetResult().status().code(),
+            absl::StatusCode::kInvalidArgument);
+}
+
+TEST_F(DriverTest, Count) {
+  Parse("COUNT(A | B)");
+  ASSERT_NE(driver_->GetRootNode(), nullptr);
+  EXPECT_TRUE(driver_->IsCount());
+  auto result = driver_->GetResult();
+  ASSERT_TRUE(result.ok());
+  EXPECT_EQ(result->size(), 4);
+
+  Parse("A");
+  EXPECT_FALSE(driver_->IsCount());
+  Parse("COUNT(A) LIMIT 1");
+  EXPECT_EQ(driver_->GetResult().status().code(),
+            absl::StatusCode::kInvalidArgument);
+}
+
+TEST_F(DriverTest, ApproxCount) {
+  Parse("APPROX_COUNT(A & B)");
+  ASSERT_NE(driver_->GetRootNode(), nullptr);
+  EXPECT_TRUE(driver_->IsApproxCount());
+  EXPECT_FALSE(driver_->IsCount());
+
+  Parse("COUNT(A)");
+  EXPECT_FALSE(driver_->IsApproxCount());
+  Parse("APPROX_COUNT(A) LIMIT 1");
+  EXPECT_EQ(driver_->GetResult().status().code(),
+            absl::StatusCode::kInvalidArgument);
+}
+
+TEST_F(DriverTest, IdResult) {
+  Driver driver([this](std::string_view key) { return Lookup(key); },
+                [this](std::string_view key) { return LookupIds(key); });
+  std::istringstream stream("(A-B) | (C&D)");
+  Scanner scanner(stream);
+  Parser parse(driver, scanner);
+  parse();
+  auto result = driver.GetIdResult();
+  ASSERT_TRUE(result.ok());
+  EXPECT_THAT(result->ToVector(), testing::ElementsAre(0, 3, 4));
+  EXPECT_THAT(*driver.GetResult(),
+              testing::UnorderedElementsAre("a", "d", "e"));
+}
+
+TEST_F(DriverTest, IdResultWithoutIdLookup) {
+  Parse("A | B");
+  auto result = driver_->GetIdResult();
+  ASSERT_TRUE(result.ok());
+  EXPECT_TRUE(result->IsEmpty());
+  Parse("A |");
+  EXPECT_EQ(driver_->GetIdResult().status().code(),
+            absl::StatusCode::kInvalidArgument);
+}
+
+TEST_F(DriverTest, CardinalityOrdersIntersections) {
+  std::vector<std::string> lookups;
+  Driver driver(
+      [this, &lookups](std::string_view key) {
+        lookups.emplace_back(key);
+        return Lookup(key);
+      },
+      /*id_lookup_fn=*/nullptr,
+      [this](std::string_view key) -> size_t { return Lookup(key).size(); });
+  std::istringstream stream("A & B & E & C");
+  Scanner scanner(stream);
+  Parser parse(driver, scanner);
+  parse();
+  auto result = driver.GetResult();
+  ASSERT_TRUE(result.ok());
+  EXPECT_TRUE(result->empty());
+  // The missing key `E` is looked up first and ends the intersection.
+  EXPECT_THAT(lookups, testing::ElementsAre("E"));
+}
+
+TEST_F(DriverTest, ResultWithLimit) {
+  Driver driver([this](std::string_view key) { return Lookup(key); },
+                [this](std::string_view key) { return LookupIds(key); });
+  std::istringstream stream("(A | B | C) - D");
+  Scanner scanner(stream);
+  Parser parse(driver, scanner);
+  parse();
+  auto all = driver.GetResult();
+  ASSERT_TRUE(all.ok());
+  EXPECT_THAT(*all, testing::UnorderedElementsAre("a", "b", "c"));
+  auto result = driver.GetResult(2);
+  ASSERT_TRUE(result.ok());
+  EXPECT_EQ(result->size(), 2);
+  for (std::string_view value : *result) {
+    EXPECT_TRUE(all->contains(value)) << value;
+  }
+  EXPECT_EQ(*driver.GetResult(10), *all);
+  auto ids = driver.GetIdResult(2);
+  ASSERT_TRUE(ids.ok());
+  EXPECT_EQ(ids->Cardinality(), 2);
+}
+
 TEST_F(DriverTest, DriverErrorsClearedOnParse) {
   Parse("A &");
   auto result = driver_->GetResult();
@@ -48,7 +48,7 @@
 }
 
 /* declare tokens */
-%token UNION INTERSECTION DIFFERENCE LPAREN RPAREN
+%token UNION INTERSECTION DIFFERENCE LPAREN RPAREN COUNT APPROX_COUNT LIMIT
 %token <std::string> VAR ERROR
 %token YYEOF 0
 
@@ -74,6 +74,18 @@
 query:
   %empty
  | query exp YYEOF { driver.SetAst(std::move($2)); }
+ | query exp LIMIT VAR YYEOF {
+     driver.SetAst(std::move($2));
+     if (!driver.SetLimit($4)) { YYERROR; }
+   }
+ | query COUNT LPAREN exp RPAREN YYEOF {
+     driver.SetAst(std::move($4));
+     driver.SetCount();
+   }
+ | query APPROX_COUNT LPAREN exp RPAREN YYEOF {
+     driver.SetAst(std::move($4));
+     driver.SetApproxCount();
+   }
 
 exp: term {$$ = std::move($1);}
  | exp UNION exp { $$ = std::make_unique<UnionNode>(std::move($1), std::move($3)); }
@@ -83,7 +95,7 @@ exp: term {$$ = std::move($1);}
  | ERROR { driver.SetError("Invalid token: " + $1); YYERROR;}
  ;
 
-term: VAR { $$ = std::make_unique<ValueNode>(absl::bind_front(&Driver::Lookup, &driver), std::move($1)); }
+term: VAR { $$ = std::make_unique<ValueNode>(absl::bind_front(&Driver::Lookup, &driver), absl::bind_front(&Driver::LookupIds, &driver), std::move($1)); }
  ;
 
 %%
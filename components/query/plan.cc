@@ -0,0 +1,642 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/query/plan.h"
+
+#include <algorithm>
+#include <atomic>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/container/node_hash_map.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_join.h"
+#include "absl/synchronization/notification.h"
+#include "components/query/ast.h"
+#include "components/query/roaring_bitmap.h"
+#include "components/query/sets.h"
+#include "components/util/thread_pool.h"
+
+namespace kv_server {
+namespace {
+
+using Step = QueryPlan::Step;
+
+// Builds the steps of the plan while visiting the AST.
+class PlanBuilder : public ASTVisitor {
+ public:
+  explicit PlanBuilder(QueryPlan::CardinalityFn cardinality_fn)
+      : cardinality_fn_(cardinality_fn) {}
+
+  Step Build(const Node& node) {
+    if (depth_ >= QueryPlan::kMaxDepth) {
+      return BuildSubtree(node);
+    }
+    depth_++;
+    node.Accept(*this);
+    depth_--;
+    return std::move(step_);
+  }
+
+  void Visit(const ValueNode& node) override {
+    step_ = Step();
+    step_.value = &node;
+    step_.estimated_cardinality = cardinality_fn_(node.Key());
+  }
+
+  void Visit(const UnionNode& node) override {
+    Step step = BuildChain(Step::Kind::kUnion, node);
+    // Unions fold the smaller set into the larger one, so the result of the
+    // first operands is not copied again.
+    std::stable_sort(step.operands.begin(), step.operands.end(),
+                     [](const Step& a, const Step& b) {
+                       return a.estimated_cardinality >
+                              b.estimated_cardinality;
+                     });
+    for (const Step& operand : step.operands) {
+      step.estimated_cardinality += operand.estimated_cardinality;
+    }
+    step_ = std::move(step);
+  }
+
+  void Visit(const IntersectionNode& node) override {
+    Step step = BuildChain(Step::Kind::kIntersection, node);
+    // The intermediate results are at most as large as the smallest operand
+    // so far, and empty ones end the evaluation.
+    std::stable_sort(step.operands.begin(), step.operands.end(),
+                     [](const Step& a, const Step& b) {
+                       return a.estimated_cardinality <
+                              b.estimated_cardinality;
+                     });
+    step.estimated_cardinality = step.operands.front().estimated_cardinality;
+    step_ = std::move(step);
+  }
+
+  void Visit(const DifferenceNode& node) override {
+    Step left = Build(*node.Left());
+    Step right = Build(*node.Right());
+    Step step;
+    step.kind = Step::Kind::kDifference;
+    // `(A - B) - C` subtracts both `B` and `C` from `A`, unlike `A - (B - C)`.
+    if (left.kind == Step::Kind::kDifference) {
+      step = std::move(left);
+    } else {
+      step.operands.push_back(std::move(left));
+    }
+    step.operands.push_back(std::move(right));
+    // Subtracting the larger sets first is more likely to empty the result
+    // early.
+    std::stable_sort(step.operands.begin() + 1, step.operands.end(),
+                     [](const Step& a, const Step& b) {
+                       return a.estimated_cardinality >
+                              b.estimated_cardinality;
+                     });
+    step.estimated_cardinality = step.operands.front().estimated_cardinality;
+    step_ = std::move(step);
+  }
+
+ private:
+  // Returns a step with the operands of `node`, and those of its operands
+  // that are the same associative operation.
+  Step BuildChain(Step::Kind kind, const OpNode& node) {
+    Step step;
+    step.kind = kind;
+    for (const Node* child : {node.Left(), node.Right()}) {
+      Step operand = Build(*child);
+      if (operand.kind == kind) {
+        std::move(operand.operands.begin(), operand.operands.end(),
+                  std::back_inserter(step.operands));
+      } else {
+        step.operands.push_back(std::move(operand));
+      }
+    }
+    return step;
+  }
+
+  Step BuildSubtree(const Node& node) {
+    Step step;
+    step.kind = Step::Kind::kSubtree;
+    step.subtree = &node;
+    // The subtree has at most the values of all of its sets.
+    for (std::string_view key : node.Keys()) {
+      step.estimated_cardinality += cardinality_fn_(key);
+    }
+    return step;
+  }
+
+  QueryPlan::CardinalityFn cardinality_fn_;
+  int depth_ = 0;
+  Step step_;
+};
+
+KVSetView EvalSubtree(const Node& node, QueryPlan::LookupFn lookup_fn) {
+  return Eval(node, lookup_fn);
+}
+RoaringBitmap EvalSubtree(const Node& node,
+                          QueryPlan::IdLookupFn id_lookup_fn) {
+  return EvalIds(node, id_lookup_fn);
+}
+
+bool IsEmpty(const KVSetView& set) { return set.empty(); }
+bool IsEmpty(const RoaringBitmap& ids) { return ids.IsEmpty(); }
+
+// Marks the `kValue` steps of `root` whose key other `kValue` steps have too
+// as shared.
+void MarkSharedValues(Step& root) {
+  absl::flat_hash_map<std::string_view, std::vector<Step*>> value_steps;
+  std::vector<Step*> stack = {&root};
+  while (!stack.empty()) {
+    Step* step = stack.back();
+    stack.pop_back();
+    if (step->kind == Step::Kind::kValue) {
+      value_steps[step->value->Key()].push_back(step);
+    }
+    for (Step& operand : step->operands) {
+      stack.push_back(&operand);
+    }
+  }
+  for (auto& [key, steps] : value_steps) {
+    if (steps.size() > 1) {
+      for (Step* step : steps) {
+        step->shared = true;
+      }
+    }
+  }
+}
+
+// Looks up the sets of keys, and keeps those of the shared `kValue` steps of
+// a plan from their first lookup to the end of the evaluation.
+template <typename SetT>
+class SetLookup {
+ public:
+  explicit SetLookup(absl::FunctionRef<SetT(std::string_view key)> lookup_fn)
+      : lookup_fn_(lookup_fn) {}
+
+  SetT Lookup(std::string_view key) const { return lookup_fn_(key); }
+
+  const SetT& LookupShared(std::string_view key) {
+    auto [it, inserted] = shared_sets_.try_emplace(key);
+    if (inserted) {
+      it->second = lookup_fn_(key);
+    }
+    return it->second;
+  }
+
+  absl::FunctionRef<SetT(std::string_view key)> lookup_fn() const {
+    return lookup_fn_;
+  }
+
+ private:
+  absl::FunctionRef<SetT(std::string_view key)> lookup_fn_;
+  // Node based, so that references to the sets stay valid. Keyed by views of
+  // the keys in the AST.
+  absl::node_hash_map<std::string_view, SetT> shared_sets_;
+};
+
+// The set of an operand, which is either owned by the evaluation or the set
+// of a shared `kValue` step, which must not be modified.
+template <typename SetT>
+struct OperandSet {
+  SetT owned;
+  const SetT* shared = nullptr;
+
+  const SetT& Get() const { return shared == nullptr ? owned : *shared; }
+  // Returns the set, copying it if it is shared.
+  SetT Take() && { return shared == nullptr ? std::move(owned) : *shared; }
+};
+
+// Applies the operation of a `kind` step to its intermediate result `left`
+// and its next operand `right`. Owned sets are modified in place, shared ones
+// are only copied if neither set is owned.
+template <typename SetT>
+SetT Apply(Step::Kind kind, OperandSet<SetT> left, OperandSet<SetT> right) {
+  if (kind == Step::Kind::kDifference) {
+    if (left.shared != nullptr) {
+      return Difference(*left.shared, right.Get());
+    }
+    if (right.shared != nullptr) {
+      return Difference(std::move(left.owned), *right.shared);
+    }
+    return Difference(std::move(left.owned), std::move(right.owned));
+  }
+  // Unions and intersections are commutative, so whichever set is owned is
+  // the one modified.
+  if (left.shared != nullptr) {
+    std::swap(left, right);
+  }
+  if (left.shared != nullptr) {
+    left.owned = *left.shared;
+    left.shared = nullptr;
+  }
+  if (kind == Step::Kind::kUnion) {
+    if (right.shared != nullptr) {
+      return Union(std::move(left.owned), *right.shared);
+    }
+    return Union(std::move(left.owned), std::move(right.owned));
+  }
+  if (right.shared != nullptr) {
+    return Intersection(std::move(left.owned), *right.shared);
+  }
+  return Intersection(std::move(left.owned), std::move(right.owned));
+}
+
+template <typename SetT>
+SetT EvalStep(const Step& step, SetLookup<SetT>& lookup);
+
+template <typename SetT>
+OperandSet<SetT> EvalOperand(const Step& step, SetLookup<SetT>& lookup) {
+  if (step.shared) {
+    return {SetT(), &lookup.LookupShared(step.value->Key())};
+  }
+  return {EvalStep(step, lookup)};
+}
+
+template <typename SetT>
+SetT EvalStep(const Step& step, SetLookup<SetT>& lookup) {
+  switch (step.kind) {
+    case Step::Kind::kValue:
+      // Shared steps only share their set as operands of a step, see
+      // `EvalOperand`, not when they are evaluated on their own.
+      return lookup.Lookup(step.value->Key());
+    case Step::Kind::kSubtree:
+      return EvalSubtree(*step.subtree, lookup.lookup_fn());
+    default:
+      break;
+  }
+  OperandSet<SetT> result = EvalOperand(step.operands.front(), lookup);
+  for (size_t i = 1; i < step.operands.size(); i++) {
+    if (step.kind != Step::Kind::kUnion && IsEmpty(result.Get())) {
+      break;
+    }
+    result = {Apply(step.kind, std::move(result),
+                    EvalOperand(step.operands[i], lookup))};
+  }
+  return std::move(result).Take();
+}
+
+template <typename SetT>
+SetT EvalStep(const Step& step,
+              absl::FunctionRef<SetT(std::string_view key)> lookup_fn) {
+  SetLookup<SetT> lookup(lookup_fn);
+  return EvalStep(step, lookup);
+}
+
+// Evaluates the steps of a plan like `EvalStep`, with the operands of large
+// steps scheduled on a thread pool, see `QueryPlan::Eval`.
+template <typename SetT>
+class ParallelEvaluator {
+ public:
+  ParallelEvaluator(absl::FunctionRef<SetT(std::string_view key)> lookup_fn,
+                    ThreadPool& pool, size_t min_parallel_cardinality)
+      : lookup_fn_(lookup_fn),
+        pool_(pool),
+        min_parallel_cardinality_(min_parallel_cardinality) {}
+
+  SetT Eval(const Step& step) const {
+    if (step.operands.empty() ||
+        step.estimated_cardinality < min_parallel_cardinality_) {
+      return EvalStep(step, lookup_fn_);
+    }
+    // The first operand is evaluated by this thread while the workers
+    // evaluate the others.
+    std::vector<std::shared_ptr<Fork>> forks(step.operands.size());
+    for (size_t i = 1; i < step.operands.size(); i++) {
+      const Step& operand = step.operands[i];
+      if (operand.estimated_cardinality < min_parallel_cardinality_) {
+        continue;
+      }
+      forks[i] = std::make_shared<Fork>();
+      pool_.Schedule([this, &operand, fork = forks[i]]() {
+        if (!fork->claimed.exchange(true)) {
+          fork->result = Eval(operand);
+          fork->done.Notify();
+        }
+      });
+    }
+    SetT result = Eval(step.operands.front());
+    size_t i = 1;
+    for (; i < step.operands.size(); i++) {
+      if (step.kind != Step::Kind::kUnion && IsEmpty(result)) {
+        break;
+      }
+      SetT operand = Join(step.operands[i], forks[i].get());
+      switch (step.kind) {
+        case Step::Kind::kUnion:
+          result = Union(std::move(result), std::move(operand));
+          break;
+        case Step::Kind::kIntersection:
+          result = Intersection(std::move(result), std::move(operand));
+          break;
+        case Step::Kind::kDifference:
+          result = Difference(std::move(result), std::move(operand));
+          break;
+        default:
+          break;
+      }
+    }
+    // The tasks refer to the steps, so the ones that already started are
+    // waited for even though their results are not needed.
+    for (; i < forks.size(); i++) {
+      if (forks[i] != nullptr && forks[i]->claimed.exchange(true)) {
+        forks[i]->done.WaitForNotification();
+      }
+    }
+    return result;
+  }
+
+ private:
+  // An operand scheduled on the pool, which is evaluated by whichever of the
+  // worker and the thread that needs it first claims it.
+  struct Fork {
+    std::atomic<bool> claimed = false;
+    absl::Notification done;
+    SetT result;
+  };
+
+  SetT Join(const Step& operand, Fork* fork) const {
+    if (fork == nullptr || !fork->claimed.exchange(true)) {
+      return Eval(operand);
+    }
+    fork->done.WaitForNotification();
+    return std::move(fork->result);
+  }
+
+  absl::FunctionRef<SetT(std::string_view key)> lookup_fn_;
+  ThreadPool& pool_;
+  const size_t min_parallel_cardinality_;
+};
+
+bool Contains(const KVSetView& set, std::string_view value) {
+  return set.contains(value);
+}
+bool Contains(const RoaringBitmap& ids, uint32_t id) {
+  return ids.Contains(id);
+}
+
+bool ForEachWhile(const KVSetView& set,
+                  absl::FunctionRef<bool(std::string_view)> fn) {
+  for (std::string_view value : set) {
+    if (!fn(value)) {
+      return false;
+    }
+  }
+  return true;
+}
+bool ForEachWhile(const RoaringBitmap& ids,
+                  absl::FunctionRef<bool(uint32_t)> fn) {
+  return ids.ForEachWhile(fn);
+}
+
+// Evaluates the steps of a plan by pulling the values of the result one at a
+// time, see `QueryPlan::ForEach`.
+template <typename SetT, typename ValueT>
+class StreamingEvaluator {
+ public:
+  explicit StreamingEvaluator(
+      absl::FunctionRef<SetT(std::string_view key)> lookup_fn)
+      : lookup_fn_(lookup_fn) {}
+
+  // Calls `fn` with each value of `step` until it returns false. Returns
+  // whether all values were visited.
+  bool ForEach(const Step& step, absl::FunctionRef<bool(ValueT)> fn) {
+    switch (step.kind) {
+      case Step::Kind::kValue:
+      case Step::Kind::kSubtree:
+        return ForEachWhile(Leaf(step), fn);
+      case Step::Kind::kUnion:
+        for (size_t i = 0; i < step.operands.size(); i++) {
+          const bool done =
+              ForEach(step.operands[i], [this, &step, i, fn](ValueT value) {
+                for (size_t j = 0; j < i; j++) {
+                  if (Contains(step.operands[j], value)) {
+                    return true;
+                  }
+                }
+                return fn(value);
+              });
+          if (!done) {
+            return false;
+          }
+        }
+        return true;
+      case Step::Kind::kIntersection:
+        return ForEach(step.operands.front(), [this, &step, fn](ValueT value) {
+          for (size_t i = 1; i < step.operands.size(); i++) {
+            if (!Contains(step.operands[i], value)) {
+              return true;
+            }
+          }
+          return fn(value);
+        });
+      case Step::Kind::kDifference:
+        return ForEach(step.operands.front(), [this, &step, fn](ValueT value) {
+          for (size_t i = 1; i < step.operands.size(); i++) {
+            if (Contains(step.operands[i], value)) {
+              return true;
+            }
+          }
+          return fn(value);
+        });
+    }
+    return true;
+  }
+
+ private:
+  bool Contains(const Step& step, ValueT value) {
+    switch (step.kind) {
+      case Step::Kind::kValue:
+      case Step::Kind::kSubtree:
+        return kv_server::Contains(Leaf(step), value);
+      case Step::Kind::kUnion:
+        for (const Step& operand : step.operands) {
+          if (Contains(operand, value)) {
+            return true;
+          }
+        }
+        return false;
+      case Step::Kind::kIntersection:
+        for (const Step& operand : step.operands) {
+          if (!Contains(operand, value)) {
+            return false;
+          }
+        }
+        return true;
+      case Step::Kind::kDifference:
+        if (!Contains(step.operands.front(), value)) {
+          return false;
+        }
+        for (size_t i = 1; i < step.operands.size(); i++) {
+          if (Contains(step.operands[i], value)) {
+            return false;
+          }
+        }
+        return true;
+    }
+    return false;
+  }
+
+  // Returns the set of a `kValue` or `kSubtree` step, which is looked up or
+  // evaluated on first use.
+  const SetT& Leaf(const Step& step) {
+    if (step.kind == Step::Kind::kValue) {
+      auto [it, inserted] = values_.try_emplace(step.value->Key());
+      if (inserted) {
+        it->second = lookup_fn_(step.value->Key());
+      }
+      return it->second;
+    }
+    auto [it, inserted] = subtrees_.try_emplace(step.subtree);
+    if (inserted) {
+      it->second = EvalSubtree(*step.subtree, lookup_fn_);
+    }
+    return it->second;
+  }
+
+  absl::FunctionRef<SetT(std::string_view key)> lookup_fn_;
+  // Node based, so that references to the sets stay valid. Keyed by views of
+  // the keys in the AST.
+  absl::node_hash_map<std::string_view, SetT> values_;
+  absl::node_hash_map<const Node*, SetT> subtrees_;
+};
+
+std::string StepToString(const Step& step) {
+  const char* separator = "";
+  switch (step.kind) {
+    case Step::Kind::kValue:
+      return step.value->Key();
+    case Step::Kind::kSubtree:
+      return "[...]";
+    case Step::Kind::kUnion:
+      separator = " | ";
+      break;
+    case Step::Kind::kIntersection:
+      separator = " & ";
+      break;
+    case Step::Kind::kDifference:
+      separator = " - ";
+      break;
+  }
+  return absl::StrCat(
+      "(",
+      absl::StrJoin(step.operands, separator,
+                    [](std::string* out, const Step& operand) {
+                      absl::StrAppend(out, StepToString(operand));
+                    }),
+      ")");
+}
+
+void AddKeysToLookUp(const Step& step,
+                     absl::flat_hash_set<std::string_view>& keys) {
+  switch (step.kind) {
+    case Step::Kind::kValue:
+      keys.insert(step.value->Key());
+      return;
+    case Step::Kind::kSubtree:
+      keys.merge(step.subtree->Keys());
+      return;
+    case Step::Kind::kIntersection:
+    case Step::Kind::kDifference:
+      if (step.estimated_cardinality == 0) {
+        AddKeysToLookUp(step.operands.front(), keys);
+        return;
+      }
+      break;
+    case Step::Kind::kUnion:
+      break;
+  }
+  for (const Step& operand : step.operands) {
+    AddKeysToLookUp(operand, keys);
+  }
+}
+
+}  // namespace
+
+QueryPlan QueryPlan::Create(const Node& root, CardinalityFn cardinality_fn) {
+  Step step = PlanBuilder(cardinality_fn).Build(root);
+  MarkSharedValues(step);
+  return QueryPlan(std::move(step));
+}
+
+KVSetView QueryPlan::Eval(LookupFn lookup_fn) const {
+  return EvalStep(root_, lookup_fn);
+}
+
+RoaringBitmap QueryPlan::EvalIds(IdLookupFn id_lookup_fn) const {
+  return EvalStep(root_, id_lookup_fn);
+}
+
+void QueryPlan::ForEach(
+    LookupFn lookup_fn,
+    absl::FunctionRef<bool(std::string_view value)> fn) const {
+  StreamingEvaluator<KVSetView, std::string_view>(lookup_fn).ForEach(root_,
+                                                                     fn);
+}
+
+void QueryPlan::ForEachId(IdLookupFn id_lookup_fn,
+                          absl::FunctionRef<bool(uint32_t id)> fn) const {
+  StreamingEvaluator<RoaringBitmap, uint32_t>(id_lookup_fn).ForEach(root_, fn);
+}
+
+KVSetView QueryPlan::Eval(LookupFn lookup_fn, size_t limit) const {
+  KVSetView result;
+  if (limit == 0) {
+    return result;
+  }
+  ForEach(lookup_fn, [&result, limit](std::string_view value) {
+    result.insert(value);
+    return result.size() < limit;
+  });
+  return result;
+}
+
+RoaringBitmap QueryPlan::EvalIds(IdLookupFn id_lookup_fn, size_t limit) const {
+  std::vector<uint32_t> ids;
+  if (limit == 0) {
+    return RoaringBitmap();
+  }
+  ForEachId(id_lookup_fn, [&ids, limit](uint32_t id) {
+    ids.push_back(id);
+    return ids.size() < limit;
+  });
+  return RoaringBitmap::FromIds(ids);
+}
+
+KVSetView QueryPlan::Eval(LookupFn lookup_fn, ThreadPool& pool,
+                          size_t min_parallel_cardinality) const {
+  return ParallelEvaluator<KVSetView>(lookup_fn, pool, min_parallel_cardinality)
+      .Eval(root_);
+}
+
+RoaringBitmap QueryPlan::EvalIds(IdLookupFn id_lookup_fn, ThreadPool& pool,
+                                 size_t min_parallel_cardinality) const {
+  return ParallelEvaluator<RoaringBitmap>(id_lookup_fn, pool,
+                                          min_parallel_cardinality)
+      .Eval(root_);
+}
+
+absl::flat_hash_set<std::string_view> QueryPlan::KeysToLookUp() const {
+  absl::flat_hash_set<std::string_view> keys;
+  AddKeysToLookUp(root_, keys);
+  return keys;
+}
+
+std::string QueryPlan::ToString() const { return StepToString(root_); }
+
+}  // namespace kv_server
@@ -0,0 +1,147 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef COMPONENTS_QUERY_PLAN_H_
+#define COMPONENTS_QUERY_PLAN_H_
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_set.h"
+#include "absl/functional/function_ref.h"
+#include "components/query/ast.h"
+#include "components/query/roaring_bitmap.h"
+#include "components/util/thread_pool.h"
+
+namespace kv_server {
+
+// Execution plan of a query AST. Compared to evaluating the AST as parsed with
+// `Eval`, the plan
+//   * flattens chains of unions, intersections and differences, such as
+//     `A | B | C`, into one step with all of their operands,
+//   * intersects the operands in ascending order of their estimated
+//     cardinality and unions them in descending order,
+//   * stops evaluating an intersection or difference once its intermediate
+//     result is empty, without looking up the remaining operands,
+//   * looks up the set of a key that occurs several times in the query once,
+//     and only copies it for the operations that modify it.
+// The plan refers to the AST, which must outlive it. The sets are looked up by
+// key with the functions passed to `Eval` and `EvalIds`, so the same plan can
+// be evaluated concurrently for different requests.
+class QueryPlan {
+ public:
+  using LookupFn = absl::FunctionRef<KVSetView(std::string_view key)>;
+  using IdLookupFn = absl::FunctionRef<RoaringBitmap(std::string_view key)>;
+  // Returns the number of values in the set of `key`. It does not need to be
+  // exact, it only orders the operands.
+  using CardinalityFn = absl::FunctionRef<size_t(std::string_view key)>;
+
+  // ASTs nested deeper than this are evaluated as parsed below this depth.
+  static constexpr int kMaxDepth = 256;
+
+  static QueryPlan Create(const Node& root, CardinalityFn cardinality_fn);
+
+  KVSetView Eval(LookupFn lookup_fn) const;
+  // Same as `Eval`, over the ids of interned set values, see `EvalIds`.
+  RoaringBitmap EvalIds(IdLookupFn id_lookup_fn) const;
+
+  // Calls `fn` with each value of the result until it returns false, in no
+  // particular order. Unlike `Eval`, the values are pulled from the sets one
+  // at a time and checked against the other operands of each step, so only
+  // the looked up sets are held in memory and stopping early skips the rest
+  // of the work. Intersections and differences iterate their first operand,
+  // unions iterate each operand and skip the values of the previous ones.
+  // Every set is looked up at most once, when first needed.
+  void ForEach(LookupFn lookup_fn,
+               absl::FunctionRef<bool(std::string_view value)> fn) const;
+  void ForEachId(IdLookupFn id_lookup_fn,
+                 absl::FunctionRef<bool(uint32_t id)> fn) const;
+
+  // Returns at most `limit` values of the result, see `ForEach`.
+  KVSetView Eval(LookupFn lookup_fn, size_t limit) const;
+  RoaringBitmap EvalIds(IdLookupFn id_lookup_fn, size_t limit) const;
+
+  // Same as `Eval`, evaluating the operands of steps concurrently on `pool`.
+  // Steps and operands with an estimated cardinality below
+  // `min_parallel_cardinality` are evaluated on the calling thread, so small
+  // queries never pay for the hand off. A thread that needs the result of an
+  // operand no worker has started evaluates it itself, so nested steps do
+  // not wait for a busy pool, and operands that an empty intersection or
+  // difference no longer needs are dropped before they start. Sets of keys
+  // that occur several times are only shared within the steps evaluated on
+  // one thread. `lookup_fn` must be safe to call from several threads at
+  // once.
+  KVSetView Eval(LookupFn lookup_fn, ThreadPool& pool,
+                 size_t min_parallel_cardinality) const;
+  RoaringBitmap EvalIds(IdLookupFn id_lookup_fn, ThreadPool& pool,
+                        size_t min_parallel_cardinality) const;
+
+  // Below this many values, splitting the evaluation of a step costs more
+  // than it saves.
+  static constexpr size_t kDefaultMinParallelCardinality = 1 << 16;
+
+  // Returns the estimated number of values of the result, without looking up
+  // any set. Unions add up the estimates of their operands, intersections
+  // and differences take that of their first operand, so the estimate is an
+  // upper bound if `cardinality_fn` is.
+  size_t EstimatedCardinality() const { return root_.estimated_cardinality; }
+
+  // Returns the keys of the sets that evaluating the plan may look up. An
+  // intersection or difference with an estimated cardinality of 0 only looks
+  // up its first operand, which is empty if `cardinality_fn` is an upper
+  // bound, so the keys of its other operands are left out.
+  absl::flat_hash_set<std::string_view> KeysToLookUp() const;
+
+  // Returns the plan in infix notation, for example `(A & (B | C | D))`.
+  // Subtrees that are not planned are printed as `[...]`.
+  std::string ToString() const;
+
+  // Describes one step of the plan. Public for the implementation only.
+  struct Step {
+    enum class Kind {
+      kValue,
+      kUnion,
+      kIntersection,
+      kDifference,
+      // A subtree below `kMaxDepth`, which is evaluated as parsed.
+      kSubtree,
+    };
+    Kind kind = Kind::kValue;
+    // Set for `kValue` steps.
+    const ValueNode* value = nullptr;
+    // Whether other `kValue` steps of the plan have the same key, so that
+    // their set is looked up once and shared between them.
+    bool shared = false;
+    // Set for `kSubtree` steps.
+    const Node* subtree = nullptr;
+    // In the order of evaluation. The first operand of a difference is the
+    // set the others are subtracted from.
+    std::vector<Step> operands;
+    size_t estimated_cardinality = 0;
+  };
+
+ private:
+  explicit QueryPlan(Step root) : root_(std::move(root)) {}
+
+  Step root_;
+};
+
+}  // namespace kv_server
+
+#endif  // COMPONENTS_QUERY_PLAN_H_
@@ -0,0 +1,480 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/query/plan.h"
+
+#include <memory>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/synchronization/mutex.h"
+#include "components/query/ast.h"
+#include "components/util/thread_pool.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace kv_server {
+namespace {
+
+const absl::flat_hash_map<std::string, absl::flat_hash_set<std::string_view>>
+    kDb = {
+        {"A", {"a", "b", "c"}},
+        {"B", {"b", "c", "d"}},
+        {"C", {"c", "d", "e"}},
+        {"D", {"d", "e", "f"}},
+        {"E", {"a", "b", "c", "d", "e", "f"}},
+        {"F", {"f"}},
+};
+
+// Counts the lookups of each key.
+class Db {
+ public:
+  KVSetView Lookup(std::string_view key) const {
+    lookups_[key]++;
+    const auto it = kDb.find(key);
+    if (it != kDb.end()) {
+      return it->second;
+    }
+    return {};
+  }
+
+  // Ids of the values of `kDb`, where value "a" has id 0, "b" id 1 and so on.
+  RoaringBitmap LookupIds(std::string_view key) const {
+    RoaringBitmap ids;
+    for (std::string_view value : Lookup(key)) {
+      ids.Add(value[0] - 'a');
+    }
+    return ids;
+  }
+
+  size_t Cardinality(std::string_view key) const {
+    const auto it = kDb.find(key);
+    return it == kDb.end() ? 0 : it->second.size();
+  }
+
+  std::unique_ptr<Node> Value(std::string key) const {
+    return std::make_unique<ValueNode>(
+        [this](std::string_view key) { return Lookup(key); },
+        [this](std::string_view key) { return LookupIds(key); },
+        std::move(key));
+  }
+
+  int Lookups(std::string_view key) const {
+    const auto it = lookups_.find(key);
+    return it == lookups_.end() ? 0 : it->second;
+  }
+
+ private:
+  mutable absl::flat_hash_map<std::string, int> lookups_;
+};
+
+template <typename OpT>
+std::unique_ptr<Node> Op(std::unique_ptr<Node> left,
+                         std::unique_ptr<Node> right) {
+  return std::make_unique<OpT>(std::move(left), std::move(right));
+}
+
+QueryPlan CreatePlan(const Node& root, const Db& db) {
+  return QueryPlan::Create(
+      root, [&db](std::string_view key) { return db.Cardinality(key); });
+}
+
+size_t NoCardinality(std::string_view) { return 0; }
+
+KVSetView EvalPlan(const QueryPlan& plan, const Db& db) {
+  return plan.Eval([&db](std::string_view key) { return db.Lookup(key); });
+}
+
+RoaringBitmap EvalPlanIds(const QueryPlan& plan, const Db& db) {
+  return plan.EvalIds(
+      [&db](std::string_view key) { return db.LookupIds(key); });
+}
+
+TEST(QueryPlanTest, Value) {
+  Db db;
+  auto root = db.Value("A");
+  const QueryPlan plan = CreatePlan(*root, db);
+  EXPECT_EQ(plan.ToString(), "A");
+  EXPECT_EQ(EvalPlan(plan, db), kDb.at("A"));
+  EXPECT_EQ(EvalPlanIds(plan, db), RoaringBitmap::FromIds({0, 1, 2}));
+}
+
+TEST(QueryPlanTest, UsesLookupsOfEvaluation) {
+  Db db;
+  auto root = Op<UnionNode>(db.Value("A"), db.Value("B"));
+  const QueryPlan plan = CreatePlan(*root, db);
+  EXPECT_THAT(plan.Eval([](std::string_view key) {
+    return key == "A" ? KVSetView{"x"} : KVSetView{"y"};
+  }),
+              testing::UnorderedElementsAre("x", "y"));
+  EXPECT_EQ(db.Lookups("A"), 0);
+  EXPECT_EQ(db.Lookups("B"), 0);
+}
+
+TEST(QueryPlanTest, FlattensUnions) {
+  Db db;
+  auto root =
+      Op<UnionNode>(Op<UnionNode>(db.Value("A"), db.Value("B")),
+                    Op<UnionNode>(db.Value("C"),
+                                  Op<UnionNode>(db.Value("D"), db.Value("F"))));
+  const QueryPlan plan = QueryPlan::Create(*root, NoCardinality);
+  EXPECT_EQ(plan.ToString(), "(A | B | C | D | F)");
+  EXPECT_EQ(EvalPlan(plan, db), Eval(*root));
+}
+
+TEST(QueryPlanTest, FlattensIntersectionsInAscendingCardinality) {
+  Db db;
+  auto root = Op<IntersectionNode>(
+      Op<IntersectionNode>(db.Value("E"), db.Value("A")),
+      Op<IntersectionNode>(db.Value("B"), db.Value("F")));
+  const QueryPlan plan = CreatePlan(*root, db);
+  EXPECT_EQ(plan.ToString(), "(F & A & B & E)");
+  EXPECT_EQ(EvalPlan(plan, db), Eval(*root));
+}
+
+TEST(QueryPlanTest, KeepsQueryOrderWithoutCardinality) {
+  Db db;
+  auto root = Op<IntersectionNode>(
+      Op<IntersectionNode>(db.Value("E"), db.Value("A")),
+      Op<IntersectionNode>(db.Value("B"), db.Value("F")));
+  EXPECT_EQ(QueryPlan::Create(*root, NoCardinality).ToString(),
+            "(E & A & B & F)");
+}
+
+TEST(QueryPlanTest, DoesNotFlattenMixedOperations) {
+  Db db;
+  auto root = Op<IntersectionNode>(
+      Op<UnionNode>(db.Value("B"), db.Value("C")),
+      Op<IntersectionNode>(db.Value("E"), db.Value("A")));
+  const QueryPlan plan = CreatePlan(*root, db);
+  // The union is estimated to have the sum of its operands, 6 values.
+  EXPECT_EQ(plan.ToString(), "(A & (B | C) & E)");
+  EXPECT_EQ(EvalPlan(plan, db), Eval(*root));
+}
+
+TEST(QueryPlanTest, FlattensLeftNestedDifferences) {
+  Db db;
+  auto root = Op<DifferenceNode>(
+      Op<DifferenceNode>(Op<DifferenceNode>(db.Value("E"), db.Value("F")),
+                         db.Value("A")),
+      Op<DifferenceNode>(db.Value("B"), db.Value("C")));
+  const QueryPlan plan = CreatePlan(*root, db);
+  EXPECT_EQ(plan.ToString(), "(E - A - (B - C) - F)");
+  EXPECT_EQ(EvalPlan(plan, db), Eval(*root));
+  EXPECT_EQ(EvalPlanIds(plan, db), EvalIds(*root));
+}
+
+TEST(QueryPlanTest, EmptyIntersectionSkipsRemainingOperands) {
+  Db db;
+  auto root = Op<IntersectionNode>(
+      Op<IntersectionNode>(db.Value("A"), db.Value("F")),
+      Op<IntersectionNode>(db.Value("E"), db.Value("D")));
+  const QueryPlan plan = CreatePlan(*root, db);
+  EXPECT_EQ(plan.ToString(), "(F & A & D & E)");
+  EXPECT_TRUE(EvalPlan(plan, db).empty());
+  EXPECT_EQ(db.Lookups("F"), 1);
+  EXPECT_EQ(db.Lookups("A"), 1);
+  EXPECT_EQ(db.Lookups("D"), 0);
+  EXPECT_EQ(db.Lookups("E"), 0);
+  EXPECT_TRUE(EvalPlanIds(plan, db).IsEmpty());
+  EXPECT_EQ(db.Lookups("D"), 0);
+  EXPECT_EQ(db.Lookups("E"), 0);
+}
+
+TEST(QueryPlanTest, EmptyDifferenceSkipsRemainingOperands) {
+  Db db;
+  auto root = Op<DifferenceNode>(
+      Op<DifferenceNode>(db.Value("A"), db.Value("E")), db.Value("D"));
+  const QueryPlan plan = CreatePlan(*root, db);
+  EXPECT_EQ(plan.ToString(), "(A - E - D)");
+  EXPECT_TRUE(EvalPlan(plan, db).empty());
+  EXPECT_EQ(db.Lookups("D"), 0);
+}
+
+TEST(QueryPlanTest, MissingKeyEndsIntersection) {
+  Db db;
+  auto root = Op<IntersectionNode>(db.Value("A"), db.Value("missing"));
+  const QueryPlan plan = CreatePlan(*root, db);
+  EXPECT_EQ(plan.ToString(), "(missing & A)");
+  EXPECT_TRUE(EvalPlan(plan, db).empty());
+  EXPECT_EQ(db.Lookups("A"), 0);
+}
+
+TEST(QueryPlanTest, EstimatedCardinalityIsAnUpperBound) {
+  Db db;
+  // (A & E) | (D - B) | F
+  auto root = Op<UnionNode>(
+      Op<UnionNode>(Op<IntersectionNode>(db.Value("A"), db.Value("E")),
+                    Op<DifferenceNode>(db.Value("D"), db.Value("B"))),
+      db.Value("F"));
+  const QueryPlan plan = CreatePlan(*root, db);
+  EXPECT_EQ(plan.EstimatedCardinality(), 7);
+  EXPECT_GE(plan.EstimatedCardinality(), EvalPlan(plan, db).size());
+  EXPECT_EQ(db.Lookups("A"), 1);
+}
+
+TEST(QueryPlanTest, KeysToLookUpSkipOperandsOfEmptySteps) {
+  Db db;
+  // (A & missing & B) | ((missing - C) - D) | (E & F)
+  auto root = Op<UnionNode>(
+      Op<UnionNode>(
+          Op<IntersectionNode>(
+              Op<IntersectionNode>(db.Value("A"), db.Value("missing")),
+              db.Value("B")),
+          Op<DifferenceNode>(
+              Op<DifferenceNode>(db.Value("missing"), db.Value("C")),
+              db.Value("D"))),
+      Op<IntersectionNode>(db.Value("E"), db.Value("F")));
+  const QueryPlan plan = CreatePlan(*root, db);
+  EXPECT_THAT(plan.KeysToLookUp(),
+              testing::UnorderedElementsAre("missing", "E", "F"));
+  EXPECT_THAT(EvalPlan(plan, db), testing::UnorderedElementsAre("f"));
+  for (std::string_view key : {"A", "B", "C", "D"}) {
+    EXPECT_EQ(db.Lookups(key), 0) << key;
+  }
+  // Without sizes every set may hold values, so every key is looked up.
+  EXPECT_THAT(QueryPlan::Create(*root, [](std::string_view) { return 1; })
+                  .KeysToLookUp(),
+              testing::UnorderedElementsAre("A", "B", "C", "D", "E", "F",
+                                            "missing"));
+}
+
+TEST(QueryPlanTest, LooksUpRepeatedKeysOnce) {
+  Db db;
+  // ((A | B) & (A | C)) - (A & C)
+  auto root = Op<DifferenceNode>(
+      Op<IntersectionNode>(Op<UnionNode>(db.Value("A"), db.Value("B")),
+                           Op<UnionNode>(db.Value("A"), db.Value("C"))),
+      Op<IntersectionNode>(db.Value("A"), db.Value("C")));
+  const QueryPlan plan = CreatePlan(*root, db);
+  EXPECT_THAT(EvalPlan(plan, db), testing::UnorderedElementsAre("a", "b", "d"));
+  EXPECT_EQ(db.Lookups("A"), 1);
+  EXPECT_EQ(db.Lookups("C"), 1);
+  EXPECT_EQ(EvalPlanIds(plan, db), RoaringBitmap::FromIds({0, 1, 3}));
+  EXPECT_EQ(db.Lookups("A"), 2);
+}
+
+TEST(QueryPlanTest, DoesNotModifySharedSets) {
+  Db db;
+  // (A - B) | (A & C) | A
+  auto root = Op<UnionNode>(
+      Op<UnionNode>(Op<DifferenceNode>(db.Value("A"), db.Value("B")),
+                    Op<IntersectionNode>(db.Value("A"), db.Value("C"))),
+      db.Value("A"));
+  const QueryPlan plan = CreatePlan(*root, db);
+  EXPECT_EQ(EvalPlan(plan, db), kDb.at("A"));
+  EXPECT_EQ(EvalPlanIds(plan, db), RoaringBitmap::FromIds({0, 1, 2}));
+  EXPECT_EQ(db.Lookups("A"), 2);
+}
+
+// Returns a random AST of `num_values` values.
+std::unique_ptr<Node> RandomAst(const Db& db, std::mt19937& gen,
+                                int num_values) {
+  static constexpr std::string_view kKeys[] = {"A", "B", "C",      "D",
+                                               "E", "F", "missing"};
+  if (num_values == 1) {
+    return db.Value(std::string(
+        kKeys[std::uniform_int_distribution<>(0, std::size(kKeys) - 1)(gen)]));
+  }
+  const int left = std::uniform_int_distribution<>(1, num_values - 1)(gen);
+  auto left_node = RandomAst(db, gen, left);
+  auto right_node = RandomAst(db, gen, num_values - left);
+  switch (std::uniform_int_distribution<>(0, 2)(gen)) {
+    case 0:
+      return Op<UnionNode>(std::move(left_node), std::move(right_node));
+    case 1:
+      return Op<IntersectionNode>(std::move(left_node), std::move(right_node));
+    default:
+      return Op<DifferenceNode>(std::move(left_node), std::move(right_node));
+  }
+}
+
+TEST(QueryPlanTest, SameResultsAsAst) {
+  Db db;
+  std::mt19937 gen(42);
+  for (int i = 0; i < 500; i++) {
+    auto root = RandomAst(db, gen, std::uniform_int_distribution<>(1, 12)(gen));
+    const QueryPlan plan = CreatePlan(*root, db);
+    EXPECT_EQ(EvalPlan(plan, db), Eval(*root)) << plan.ToString();
+    EXPECT_EQ(EvalPlanIds(plan, db), EvalIds(*root)) << plan.ToString();
+  }
+}
+
+// Looks up `kDb` without counting the lookups, so that it can be called
+// concurrently.
+KVSetView ConcurrentLookup(std::string_view key) {
+  const auto it = kDb.find(key);
+  return it == kDb.end() ? KVSetView() : it->second;
+}
+
+RoaringBitmap ConcurrentLookupIds(std::string_view key) {
+  RoaringBitmap ids;
+  for (std::string_view value : ConcurrentLookup(key)) {
+    ids.Add(value[0] - 'a');
+  }
+  return ids;
+}
+
+TEST(QueryPlanTest, ParallelEvalSameResultsAsAst) {
+  Db db;
+  std::mt19937 gen(42);
+  // A single thread checks that nested steps do not wait for a busy pool.
+  for (const int num_threads : {1, 4}) {
+    ThreadPool pool(num_threads);
+    for (int i = 0; i < 200; i++) {
+      auto root =
+          RandomAst(db, gen, std::uniform_int_distribution<>(1, 12)(gen));
+      const QueryPlan plan = CreatePlan(*root, db);
+      EXPECT_EQ(plan.Eval(ConcurrentLookup, pool,
+                          /*min_parallel_cardinality=*/0),
+                Eval(*root))
+          << plan.ToString();
+      EXPECT_EQ(plan.EvalIds(ConcurrentLookupIds, pool,
+                             /*min_parallel_cardinality=*/0),
+                EvalIds(*root))
+          << plan.ToString();
+    }
+  }
+}
+
+TEST(QueryPlanTest, ParallelEvalOfSmallSetsStaysOnCallingThread) {
+  Db db;
+  auto root = Op<UnionNode>(Op<IntersectionNode>(db.Value("A"), db.Value("B")),
+                            Op<IntersectionNode>(db.Value("C"), db.Value("D")));
+  const QueryPlan plan = CreatePlan(*root, db);
+  ThreadPool pool(4);
+  absl::Mutex mutex;
+  absl::flat_hash_set<std::thread::id> threads;
+  auto lookup_fn = [&mutex, &threads](std::string_view key) {
+    absl::MutexLock lock(&mutex);
+    threads.insert(std::this_thread::get_id());
+    return ConcurrentLookup(key);
+  };
+  EXPECT_THAT(plan.Eval(lookup_fn, pool, /*min_parallel_cardinality=*/100),
+              testing::UnorderedElementsAre("b", "c", "d", "e"));
+  EXPECT_THAT(threads, testing::ElementsAre(std::this_thread::get_id()));
+}
+
+TEST(QueryPlanTest, DeepAstIsEvaluatedAsParsedBelowMaxDepth) {
+  Db db;
+  // `A - (B - (C - ...))` cannot be flattened.
+  auto root = db.Value("A");
+  for (int i = 0; i < 10 * QueryPlan::kMaxDepth; i++) {
+    root = Op<DifferenceNode>(db.Value(i % 2 == 0 ? "B" : "E"),
+                              std::move(root));
+  }
+  const QueryPlan plan = CreatePlan(*root, db);
+  EXPECT_THAT(plan.ToString(), testing::HasSubstr("[...]"));
+  EXPECT_EQ(EvalPlan(plan, db), Eval(*root));
+  EXPECT_EQ(EvalPlanIds(plan, db), EvalIds(*root));
+}
+
+TEST(QueryPlanTest, ForEachMatchesEval) {
+  Db db;
+  std::mt19937 gen(7);
+  for (int i = 0; i < 500; i++) {
+    auto root = RandomAst(db, gen, std::uniform_int_distribution<>(1, 12)(gen));
+    const QueryPlan plan = CreatePlan(*root, db);
+    std::vector<std::string_view> values;
+    plan.ForEach([&db](std::string_view key) { return db.Lookup(key); },
+                 [&values](std::string_view value) {
+                   values.push_back(value);
+                   return true;
+                 });
+    // Every value is visited exactly once.
+    EXPECT_THAT(values, testing::UnorderedElementsAreArray(Eval(*root)))
+        << plan.ToString();
+    std::vector<uint32_t> ids;
+    plan.ForEachId([&db](std::string_view key) { return db.LookupIds(key); },
+                   [&ids](uint32_t id) {
+                     ids.push_back(id);
+                     return true;
+                   });
+    EXPECT_THAT(ids,
+                testing::UnorderedElementsAreArray(EvalIds(*root).ToVector()))
+        << plan.ToString();
+  }
+}
+
+TEST(QueryPlanTest, ForEachStops) {
+  Db db;
+  auto root = Op<UnionNode>(db.Value("E"), db.Value("A"));
+  const QueryPlan plan = CreatePlan(*root, db);
+  int calls = 0;
+  plan.ForEach([&db](std::string_view key) { return db.Lookup(key); },
+               [&calls](std::string_view) { return ++calls < 2; });
+  EXPECT_EQ(calls, 2);
+  // All values come from `E`, the largest operand.
+  EXPECT_EQ(db.Lookups("A"), 0);
+}
+
+TEST(QueryPlanTest, EvalWithLimit) {
+  Db db;
+  auto root = Op<DifferenceNode>(
+      Op<UnionNode>(db.Value("A"), db.Value("D")), db.Value("F"));
+  const QueryPlan plan = CreatePlan(*root, db);
+  auto lookup_fn = [&db](std::string_view key) { return db.Lookup(key); };
+  const KVSetView all = EvalPlan(plan, db);
+  EXPECT_THAT(all, testing::UnorderedElementsAre("a", "b", "c", "d", "e"));
+  for (size_t limit = 0; limit <= 6; limit++) {
+    const KVSetView result = plan.Eval(lookup_fn, limit);
+    EXPECT_EQ(result.size(), std::min(limit, all.size()));
+    for (std::string_view value : result) {
+      EXPECT_TRUE(all.contains(value)) << value;
+    }
+  }
+  auto id_lookup_fn = [&db](std::string_view key) { return db.LookupIds(key); };
+  EXPECT_EQ(plan.EvalIds(id_lookup_fn, 3).Cardinality(), 3);
+  EXPECT_EQ(plan.EvalIds(id_lookup_fn, 10), EvalPlanIds(plan, db));
+}
+
+TEST(QueryPlanTest, ForEachLooksUpSetsOnce) {
+  Db db;
+  // "A" is looked up for both the union and the intersection.
+  auto root = Op<IntersectionNode>(Op<UnionNode>(db.Value("A"), db.Value("B")),
+                                   Op<UnionNode>(db.Value("A"), db.Value("C")));
+  const QueryPlan plan = CreatePlan(*root, db);
+  KVSetView values;
+  plan.ForEach([&db](std::string_view key) { return db.Lookup(key); },
+               [&values](std::string_view value) {
+                 values.insert(value);
+                 return true;
+               });
+  EXPECT_EQ(db.Lookups("A"), 1);
+  EXPECT_EQ(db.Lookups("B"), 1);
+  EXPECT_EQ(db.Lookups("C"), 1);
+  EXPECT_EQ(values, Eval(*root));
+}
+
+TEST(QueryPlanTest, ForEachOverDeepAst) {
+  Db db;
+  auto root = db.Value("A");
+  for (int i = 0; i < 10 * QueryPlan::kMaxDepth; i++) {
+    root = Op<DifferenceNode>(db.Value(i % 2 == 0 ? "B" : "E"),
+                              std::move(root));
+  }
+  const QueryPlan plan = CreatePlan(*root, db);
+  EXPECT_EQ(plan.Eval([&db](std::string_view key) { return db.Lookup(key); },
+                      100),
+            Eval(*root));
+}
+
+}  // namespace
+}  // namespace kv_server
@@ -0,0 +1,377 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Measures parsing and evaluating queries of different shapes, over sets of
+// values and over interned ids, as `runQuery` does.
+//
+//  bazel run -c opt //components/query:query_benchmark
+//
+// The arguments of the benchmarks are the size of each set, the percentage
+// of the values of each set that all sets share, and the number of sets of
+// the query. Besides timings, benchmarks report the number of allocations
+// and allocated bytes per query, measured on separate runs with every
+// allocation sampled. The parallel benchmarks take the number of threads of
+// the pool as a fourth argument, where 0 evaluates on the calling thread.
+
+#include <cstdint>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/functional/any_invocable.h"
+#include "absl/functional/bind_front.h"
+#include "absl/functional/function_ref.h"
+#include "absl/log/check.h"
+#include "absl/strings/str_cat.h"
+#include "benchmark/benchmark.h"
+#include "components/query/driver.h"
+#include "components/query/plan.h"
+#include "components/query/roaring_bitmap.h"
+#include "components/query/scanner.h"
+#include "components/util/thread_pool.h"
+#include "tcmalloc/malloc_extension.h"
+
+namespace kv_server {
+namespace {
+
+using StringSet = absl::flat_hash_set<std::string_view>;
+
+// Runs used to count the allocations of a query.
+constexpr int kNumAllocationRuns = 100;
+
+enum class QueryShape {
+  // A0 | A1 | ... | An
+  kWideUnion,
+  // A0 & (A1 & (... & An))
+  kDeepIntersection,
+  // (A0 | A1) & (A2 - A3) | (A4 | A5) & (A6 - A7) ...
+  kMixed,
+  // (A0 | ... | Ai) & (Ai+1 | ... | An)
+  kIntersectedUnions,
+};
+
+std::string SetName(int64_t index) { return absl::StrCat("A", index); }
+
+std::string BuildQuery(QueryShape shape, int64_t num_sets) {
+  std::string query;
+  switch (shape) {
+    case QueryShape::kWideUnion:
+      for (int64_t i = 0; i < num_sets; i++) {
+        absl::StrAppend(&query, i == 0 ? "" : " | ", SetName(i));
+      }
+      break;
+    case QueryShape::kDeepIntersection:
+      for (int64_t i = 0; i < num_sets; i++) {
+        absl::StrAppend(&query, i == 0 ? "" : " & (", SetName(i));
+      }
+      query.append(num_sets - 1, ')');
+      break;
+    case QueryShape::kMixed:
+      for (int64_t i = 0; i < num_sets; i++) {
+        // Cycles through "(Ai | Ai+1) & (Ai+2 - Ai+3)" groups joined by "|".
+        switch (i % 4) {
+          case 0:
+            absl::StrAppend(&query, i == 0 ? "(" : " | (", SetName(i));
+            break;
+          case 1:
+            absl::StrAppend(&query, " | ", SetName(i), ")");
+            break;
+          case 2:
+            absl::StrAppend(&query, " & (", SetName(i));
+            break;
+          case 3:
+            absl::StrAppend(&query, " - ", SetName(i), ")");
+            break;
+        }
+      }
+      if (num_sets % 4 == 1 || num_sets % 4 == 3) {
+        query.append(")");
+      }
+      break;
+    case QueryShape::kIntersectedUnions:
+      for (int64_t i = 0; i < num_sets; i++) {
+        const char* separator = i == 0               ? "("
+                                : i == num_sets / 2 ? ") & ("
+                                                     : " | ";
+        absl::StrAppend(&query, separator, SetName(i));
+      }
+      query.append(")");
+      break;
+  }
+  return query;
+}
+
+// Sets A0 to An of `set_size` values each, `overlap_percent` percent of which
+// are shared by all sets, the others belonging to one set only.
+class SetDb {
+ public:
+  SetDb(int64_t set_size, int64_t overlap_percent, int64_t num_sets) {
+    const int64_t num_shared = set_size * overlap_percent / 100;
+    const int64_t num_own = set_size - num_shared;
+    const int64_t num_values = num_shared + num_sets * num_own;
+    values_.reserve(num_values);
+    for (int64_t i = 0; i < num_values; i++) {
+      values_.push_back(absl::StrCat("value", i));
+    }
+    std::vector<uint32_t> ids;
+    for (int64_t set = 0; set < num_sets; set++) {
+      ids.clear();
+      for (int64_t i = 0; i < num_shared; i++) {
+        ids.push_back(i);
+      }
+      for (int64_t i = 0; i < num_own; i++) {
+        ids.push_back(num_shared + set * num_own + i);
+      }
+      StringSet& values = sets_[SetName(set)];
+      for (uint32_t id : ids) {
+        values.insert(values_[id]);
+      }
+      id_sets_[SetName(set)] = RoaringBitmap::FromIds(ids);
+    }
+  }
+
+  StringSet Lookup(std::string_view key) const {
+    const auto it = sets_.find(key);
+    return it == sets_.end() ? StringSet() : it->second;
+  }
+
+  RoaringBitmap LookupIds(std::string_view key) const {
+    const auto it = id_sets_.find(key);
+    return it == id_sets_.end() ? RoaringBitmap() : it->second;
+  }
+
+  size_t Cardinality(std::string_view key) const {
+    const auto it = sets_.find(key);
+    return it == sets_.end() ? 0 : it->second.size();
+  }
+
+  std::unique_ptr<Driver> CreateDriver() const {
+    return std::make_unique<Driver>(
+        absl::bind_front(&SetDb::Lookup, this),
+        absl::bind_front(&SetDb::LookupIds, this),
+        absl::bind_front(&SetDb::Cardinality, this));
+  }
+
+ private:
+  std::vector<std::string> values_;
+  absl::flat_hash_map<std::string, StringSet> sets_;
+  absl::flat_hash_map<std::string, RoaringBitmap> id_sets_;
+};
+
+void Parse(const std::string& query, Driver& driver) {
+  std::istringstream stream(query);
+  Scanner scanner(stream);
+  Parser parse(driver, scanner);
+  CHECK_EQ(parse(), 0) << "Failed to parse " << query;
+}
+
+// Reports the average number of allocations and allocated bytes of `fn` as
+// counters. Every allocation is sampled while `fn` runs, so this is only done
+// outside of the timed runs.
+void CountAllocations(benchmark::State& state, absl::AnyInvocable<void()> fn) {
+  const int64_t sampling_rate =
+      tcmalloc::MallocExtension::GetProfileSamplingRate();
+  tcmalloc::MallocExtension::SetProfileSamplingRate(1);
+  auto token = tcmalloc::MallocExtension::StartAllocationProfiling();
+  for (int i = 0; i < kNumAllocationRuns; i++) {
+    fn();
+  }
+  const tcmalloc::Profile profile = std::move(token).Stop();
+  tcmalloc::MallocExtension::SetProfileSamplingRate(sampling_rate);
+  int64_t num_allocations = 0;
+  int64_t allocated_bytes = 0;
+  profile.Iterate([&](const tcmalloc::Profile::Sample& sample) {
+    num_allocations += sample.count;
+    allocated_bytes += sample.sum;
+  });
+  state.counters["Allocs/query"] =
+      static_cast<double>(num_allocations) / kNumAllocationRuns;
+  state.counters["Bytes/query"] =
+      static_cast<double>(allocated_bytes) / kNumAllocationRuns;
+}
+
+void BM_Parse(benchmark::State& state, QueryShape shape) {
+  const SetDb db(/*set_size=*/1, /*overlap_percent=*/0, state.range(2));
+  const std::string query = BuildQuery(shape, state.range(2));
+  auto parse = [&db, &query] {
+    auto driver = db.CreateDriver();
+    Parse(query, *driver);
+    benchmark::DoNotOptimize(driver->GetRootNode());
+  };
+  for (auto _ : state) {
+    parse();
+  }
+  state.SetBytesProcessed(state.iterations() * query.size());
+  CountAllocations(state, parse);
+}
+
+void BM_Evaluate(benchmark::State& state, QueryShape shape) {
+  const SetDb db(state.range(0), state.range(1), state.range(2));
+  auto driver = db.CreateDriver();
+  Parse(BuildQuery(shape, state.range(2)), *driver);
+  auto evaluate = [&driver] {
+    auto result = driver->GetResult();
+    CHECK(result.ok()) << result.status();
+    benchmark::DoNotOptimize(result);
+  };
+  for (auto _ : state) {
+    evaluate();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0) *
+                          state.range(2));
+  CountAllocations(state, evaluate);
+}
+
+void BM_EvaluateIds(benchmark::State& state, QueryShape shape) {
+  const SetDb db(state.range(0), state.range(1), state.range(2));
+  auto driver = db.CreateDriver();
+  Parse(BuildQuery(shape, state.range(2)), *driver);
+  auto evaluate = [&driver] {
+    auto result = driver->GetIdResult();
+    CHECK(result.ok()) << result.status();
+    benchmark::DoNotOptimize(result);
+  };
+  for (auto _ : state) {
+    evaluate();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0) *
+                          state.range(2));
+  CountAllocations(state, evaluate);
+}
+
+// Evaluates the plan of the query on a pool of `state.range(3)` threads, like
+// `runQuery` does with a query thread pool.
+template <typename SetT>
+void EvaluateParallel(benchmark::State& state, QueryShape shape,
+                      const SetDb& db,
+                      absl::FunctionRef<SetT(std::string_view key)> lookup_fn) {
+  auto driver = db.CreateDriver();
+  Parse(BuildQuery(shape, state.range(2)), *driver);
+  const QueryPlan plan =
+      QueryPlan::Create(*driver->GetRootNode(),
+                        absl::bind_front(&SetDb::Cardinality, &db));
+  std::unique_ptr<ThreadPool> pool;
+  if (state.range(3) > 0) {
+    pool = std::make_unique<ThreadPool>(state.range(3));
+  }
+  for (auto _ : state) {
+    if constexpr (std::is_same_v<SetT, RoaringBitmap>) {
+      benchmark::DoNotOptimize(
+          pool == nullptr
+              ? plan.EvalIds(lookup_fn)
+              : plan.EvalIds(lookup_fn, *pool,
+                             QueryPlan::kDefaultMinParallelCardinality));
+    } else {
+      benchmark::DoNotOptimize(
+          pool == nullptr
+              ? plan.Eval(lookup_fn)
+              : plan.Eval(lookup_fn, *pool,
+                          QueryPlan::kDefaultMinParallelCardinality));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0) *
+                          state.range(2));
+}
+
+void BM_EvaluateParallel(benchmark::State& state, QueryShape shape) {
+  const SetDb db(state.range(0), state.range(1), state.range(2));
+  EvaluateParallel<StringSet>(state, shape, db,
+                              absl::bind_front(&SetDb::Lookup, &db));
+}
+
+void BM_EvaluateIdsParallel(benchmark::State& state, QueryShape shape) {
+  const SetDb db(state.range(0), state.range(1), state.range(2));
+  EvaluateParallel<RoaringBitmap>(state, shape, db,
+                                  absl::bind_front(&SetDb::LookupIds, &db));
+}
+
+void QuerySizes(benchmark::internal::Benchmark* b) {
+  b->ArgNames({"set_size", "overlap", "num_sets"});
+  for (const int64_t set_size : {100, 10000, 100000}) {
+    for (const int64_t overlap_percent : {0, 50, 90}) {
+      for (const int64_t num_sets : {2, 8, 32}) {
+        b->Args({set_size, overlap_percent, num_sets});
+      }
+    }
+  }
+}
+
+// Multi-million value queries, on which running the operands in parallel
+// pays off.
+void ParallelSizes(benchmark::internal::Benchmark* b) {
+  b->ArgNames({"set_size", "overlap", "num_sets", "threads"});
+  for (const int64_t set_size : {100000, 1000000}) {
+    for (const int64_t num_sets : {8, 16}) {
+      for (const int64_t num_threads : {0, 1, 2, 4, 8}) {
+        b->Args({set_size, 50, num_sets, num_threads});
+      }
+    }
+  }
+  b->UseRealTime();
+}
+
+// Ids are small enough to also measure sets of millions of values.
+void ParallelIdsSizes(benchmark::internal::Benchmark* b) {
+  ParallelSizes(b);
+  for (const int64_t num_threads : {0, 1, 2, 4, 8}) {
+    b->Args({4000000, 50, 8, num_threads});
+  }
+}
+
+void ParseSizes(benchmark::internal::Benchmark* b) {
+  b->ArgNames({"set_size", "overlap", "num_sets"});
+  for (const int64_t num_sets : {2, 8, 32, 128}) {
+    b->Args({1, 0, num_sets});
+  }
+}
+
+BENCHMARK_CAPTURE(BM_Parse, WideUnion, QueryShape::kWideUnion)
+    ->Apply(ParseSizes);
+BENCHMARK_CAPTURE(BM_Parse, DeepIntersection, QueryShape::kDeepIntersection)
+    ->Apply(ParseSizes);
+BENCHMARK_CAPTURE(BM_Parse, Mixed, QueryShape::kMixed)->Apply(ParseSizes);
+BENCHMARK_CAPTURE(BM_Evaluate, WideUnion, QueryShape::kWideUnion)
+    ->Apply(QuerySizes);
+BENCHMARK_CAPTURE(BM_Evaluate, DeepIntersection,
+                  QueryShape::kDeepIntersection)
+    ->Apply(QuerySizes);
+BENCHMARK_CAPTURE(BM_Evaluate, Mixed, QueryShape::kMixed)->Apply(QuerySizes);
+BENCHMARK_CAPTURE(BM_EvaluateIds, WideUnion, QueryShape::kWideUnion)
+    ->Apply(QuerySizes);
+BENCHMARK_CAPTURE(BM_EvaluateIds, DeepIntersection,
+                  QueryShape::kDeepIntersection)
+    ->Apply(QuerySizes);
+BENCHMARK_CAPTURE(BM_EvaluateIds, Mixed, QueryShape::kMixed)
+    ->Apply(QuerySizes);
+BENCHMARK_CAPTURE(BM_EvaluateParallel, WideUnion, QueryShape::kWideUnion)
+    ->Apply(ParallelSizes);
+BENCHMARK_CAPTURE(BM_EvaluateParallel, IntersectedUnions,
+                  QueryShape::kIntersectedUnions)
+    ->Apply(ParallelSizes);
+BENCHMARK_CAPTURE(BM_EvaluateIdsParallel, WideUnion, QueryShape::kWideUnion)
+    ->Apply(ParallelIdsSizes);
+BENCHMARK_CAPTURE(BM_EvaluateIdsParallel, IntersectedUnions,
+                  QueryShape::kIntersectedUnions)
+    ->Apply(ParallelIdsSizes);
+
+}  // namespace
+}  // namespace kv_server
+
+BENCHMARK_MAIN();
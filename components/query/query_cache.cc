@@ -0,0 +1,189 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/query/query_cache.h"
+
+#include <algorithm>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "components/query/scanner.h"
+
+namespace kv_server {
+
+CompiledQuery::CompiledQuery()
+    : driver_([](std::string_view key) { return KVSetView(); }) {}
+
+absl::StatusOr<std::unique_ptr<CompiledQuery>> CompiledQuery::Create(
+    std::string_view query) {
+  auto compiled_query = absl::WrapUnique(new CompiledQuery());
+  std::istringstream stream{std::string(query)};
+  Scanner scanner(stream);
+  Parser parse(compiled_query->driver_, scanner);
+  if (parse() != 0) {
+    return absl::InvalidArgumentError("Parsing failure.");
+  }
+  if (const Node* root = compiled_query->driver_.GetRootNode();
+      root != nullptr) {
+    compiled_query->keys_ = root->Keys();
+  }
+  return compiled_query;
+}
+
+size_t CompiledQuery::EstimateCount(
+    QueryPlan::CardinalityFn cardinality_fn) const {
+  const Node* root = driver_.GetRootNode();
+  if (root == nullptr) {
+    return 0;
+  }
+  return QueryPlan::Create(*root, cardinality_fn).EstimatedCardinality();
+}
+
+absl::flat_hash_set<std::string_view> CompiledQuery::KeysToLookUp(
+    QueryPlan::CardinalityFn cardinality_fn) const {
+  const Node* root = driver_.GetRootNode();
+  if (root == nullptr) {
+    return {};
+  }
+  return QueryPlan::Create(*root, cardinality_fn).KeysToLookUp();
+}
+
+KVSetView CompiledQuery::Eval(QueryPlan::LookupFn lookup_fn,
+                              QueryPlan::CardinalityFn cardinality_fn) const {
+  const Node* root = driver_.GetRootNode();
+  if (root == nullptr) {
+    return KVSetView();
+  }
+  if (const std::optional<size_t> limit = Limit(); limit.has_value()) {
+    return QueryPlan::Create(*root, cardinality_fn).Eval(lookup_fn, *limit);
+  }
+  return QueryPlan::Create(*root, cardinality_fn).Eval(lookup_fn);
+}
+
+RoaringBitmap CompiledQuery::EvalIds(
+    QueryPlan::IdLookupFn id_lookup_fn,
+    QueryPlan::CardinalityFn cardinality_fn) const {
+  const Node* root = driver_.GetRootNode();
+  if (root == nullptr) {
+    return RoaringBitmap();
+  }
+  if (const std::optional<size_t> limit = Limit(); limit.has_value()) {
+    return QueryPlan::Create(*root, cardinality_fn)
+        .EvalIds(id_lookup_fn, *limit);
+  }
+  return QueryPlan::Create(*root, cardinality_fn).EvalIds(id_lookup_fn);
+}
+
+KVSetView CompiledQuery::Eval(QueryPlan::LookupFn lookup_fn,
+                              QueryPlan::CardinalityFn cardinality_fn,
+                              size_t limit) const {
+  const Node* root = driver_.GetRootNode();
+  if (root == nullptr) {
+    return KVSetView();
+  }
+  return QueryPlan::Create(*root, cardinality_fn)
+      .Eval(lookup_fn, std::min(limit, Limit().value_or(limit)));
+}
+
+RoaringBitmap CompiledQuery::EvalIds(QueryPlan::IdLookupFn id_lookup_fn,
+                                     QueryPlan::CardinalityFn cardinality_fn,
+                                     size_t limit) const {
+  const Node* root = driver_.GetRootNode();
+  if (root == nullptr) {
+    return RoaringBitmap();
+  }
+  return QueryPlan::Create(*root, cardinality_fn)
+      .EvalIds(id_lookup_fn, std::min(limit, Limit().value_or(limit)));
+}
+
+KVSetView CompiledQuery::Eval(QueryPlan::LookupFn lookup_fn,
+                              QueryPlan::CardinalityFn cardinality_fn,
+                              ThreadPool& pool,
+                              size_t min_parallel_cardinality) const {
+  if (Limit().has_value()) {
+    return Eval(lookup_fn, cardinality_fn);
+  }
+  const Node* root = driver_.GetRootNode();
+  if (root == nullptr) {
+    return KVSetView();
+  }
+  return QueryPlan::Create(*root, cardinality_fn)
+      .Eval(lookup_fn, pool, min_parallel_cardinality);
+}
+
+RoaringBitmap CompiledQuery::EvalIds(QueryPlan::IdLookupFn id_lookup_fn,
+                                     QueryPlan::CardinalityFn cardinality_fn,
+                                     ThreadPool& pool,
+                                     size_t min_parallel_cardinality) const {
+  if (Limit().has_value()) {
+    return EvalIds(id_lookup_fn, cardinality_fn);
+  }
+  const Node* root = driver_.GetRootNode();
+  if (root == nullptr) {
+    return RoaringBitmap();
+  }
+  return QueryPlan::Create(*root, cardinality_fn)
+      .EvalIds(id_lookup_fn, pool, min_parallel_cardinality);
+}
+
+QueryCache::QueryCache(size_t capacity) : capacity_(capacity) {}
+
+absl::StatusOr<std::shared_ptr<const CompiledQuery>> QueryCache::Get(
+    std::string_view query, bool* cache_hit) {
+  {
+    absl::MutexLock lock(&mutex_);
+    if (auto it = index_.find(query); it != index_.end()) {
+      entries_.splice(entries_.begin(), entries_, it->second);
+      *cache_hit = true;
+      return it->second->compiled_query;
+    }
+  }
+  *cache_hit = false;
+  // Parses without holding the lock, so that a miss does not block the hits
+  // of other threads.
+  absl::StatusOr<std::unique_ptr<CompiledQuery>> compiled_query =
+      CompiledQuery::Create(query);
+  if (!compiled_query.ok()) {
+    return compiled_query.status();
+  }
+  std::shared_ptr<const CompiledQuery> result = *std::move(compiled_query);
+  if (capacity_ == 0) {
+    return result;
+  }
+  absl::MutexLock lock(&mutex_);
+  if (auto it = index_.find(query); it != index_.end()) {
+    // Another thread compiled the same query in the meantime.
+    entries_.splice(entries_.begin(), entries_, it->second);
+    return it->second->compiled_query;
+  }
+  if (entries_.size() >= capacity_) {
+    index_.erase(entries_.back().query);
+    entries_.pop_back();
+  }
+  entries_.push_front(Entry{std::string(query), result});
+  index_.emplace(entries_.front().query, entries_.begin());
+  return result;
+}
+
+size_t QueryCache::size() const {
+  absl::MutexLock lock(&mutex_);
+  return entries_.size();
+}
+
+}  // namespace kv_server
@@ -0,0 +1,142 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef COMPONENTS_QUERY_QUERY_CACHE_H_
+#define COMPONENTS_QUERY_QUERY_CACHE_H_
+
+#include <list>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/status/statusor.h"
+#include "absl/synchronization/mutex.h"
+#include "components/query/ast.h"
+#include "components/query/driver.h"
+#include "components/query/plan.h"
+#include "components/query/roaring_bitmap.h"
+#include "components/util/thread_pool.h"
+
+namespace kv_server {
+
+// A parsed query. The sets are looked up with the functions passed to `Eval`
+// and `EvalIds`, so one compiled query can be evaluated concurrently for
+// different requests.
+class CompiledQuery {
+ public:
+  // Returns `InvalidArgumentError` if `query` cannot be parsed.
+  static absl::StatusOr<std::unique_ptr<CompiledQuery>> Create(
+      std::string_view query);
+
+  CompiledQuery(const CompiledQuery&) = delete;
+  CompiledQuery& operator=(const CompiledQuery&) = delete;
+
+  // Returns the keys of the sets in the query.
+  const absl::flat_hash_set<std::string_view>& Keys() const { return keys_; }
+
+  // Returns the root of the AST, or null if the query is empty.
+  const Node* Root() const { return driver_.GetRootNode(); }
+
+  // Returns the `n` of a query ending with `LIMIT n`.
+  std::optional<size_t> Limit() const { return driver_.GetLimit(); }
+  // Returns whether the query is wrapped in `COUNT(...)`, see
+  // `Driver::IsCount`.
+  bool IsCount() const { return driver_.IsCount(); }
+  // Returns whether the query is wrapped in `APPROX_COUNT(...)`, see
+  // `Driver::IsApproxCount`.
+  bool IsApproxCount() const { return driver_.IsApproxCount(); }
+
+  // Returns the estimated number of values of the result from the
+  // cardinalities of its sets, see `QueryPlan::EstimatedCardinality`.
+  size_t EstimateCount(QueryPlan::CardinalityFn cardinality_fn) const;
+  // Returns the keys of the sets that evaluating the query with
+  // `cardinality_fn` may look up, see `QueryPlan::KeysToLookUp`.
+  absl::flat_hash_set<std::string_view> KeysToLookUp(
+      QueryPlan::CardinalityFn cardinality_fn) const;
+
+  // Evaluates the query with a `QueryPlan`, ordered with `cardinality_fn`.
+  // The result contains views of the data returned by `lookup_fn`. Queries
+  // with a `LIMIT` are evaluated like the overloads with a limit below.
+  KVSetView Eval(QueryPlan::LookupFn lookup_fn,
+                 QueryPlan::CardinalityFn cardinality_fn) const;
+  RoaringBitmap EvalIds(QueryPlan::IdLookupFn id_lookup_fn,
+                        QueryPlan::CardinalityFn cardinality_fn) const;
+
+  // Same as above, returning at most `limit` arbitrary values of the result,
+  // or fewer if the query has a lower `LIMIT`, see `QueryPlan::ForEach`.
+  KVSetView Eval(QueryPlan::LookupFn lookup_fn,
+                 QueryPlan::CardinalityFn cardinality_fn, size_t limit) const;
+  RoaringBitmap EvalIds(QueryPlan::IdLookupFn id_lookup_fn,
+                        QueryPlan::CardinalityFn cardinality_fn,
+                        size_t limit) const;
+
+  // Same as the overloads without a limit, evaluating the operands of large
+  // steps concurrently on `pool`, see `QueryPlan::Eval`. Queries with a
+  // `LIMIT` are evaluated lazily on the calling thread instead.
+  KVSetView Eval(QueryPlan::LookupFn lookup_fn,
+                 QueryPlan::CardinalityFn cardinality_fn, ThreadPool& pool,
+                 size_t min_parallel_cardinality) const;
+  RoaringBitmap EvalIds(QueryPlan::IdLookupFn id_lookup_fn,
+                        QueryPlan::CardinalityFn cardinality_fn,
+                        ThreadPool& pool,
+                        size_t min_parallel_cardinality) const;
+
+ private:
+  CompiledQuery();
+
+  // Owns the AST. Its lookups are never used.
+  Driver driver_;
+  absl::flat_hash_set<std::string_view> keys_;
+};
+
+// Bounded cache of compiled queries keyed by query text, which evicts the
+// least recently used query when full. Safe to use from multiple threads.
+class QueryCache {
+ public:
+  static constexpr size_t kDefaultCapacity = 1024;
+
+  explicit QueryCache(size_t capacity = kDefaultCapacity);
+
+  // Returns the compiled `query`, and compiles and caches it on a miss.
+  // `cache_hit` is set to whether the query was cached. Queries that cannot
+  // be parsed are not cached.
+  absl::StatusOr<std::shared_ptr<const CompiledQuery>> Get(
+      std::string_view query, bool* cache_hit) ABSL_LOCKS_EXCLUDED(mutex_);
+
+  size_t size() const ABSL_LOCKS_EXCLUDED(mutex_);
+
+ private:
+  struct Entry {
+    std::string query;
+    std::shared_ptr<const CompiledQuery> compiled_query;
+  };
+
+  const size_t capacity_;
+  mutable absl::Mutex mutex_;
+  // Most recently used first.
+  std::list<Entry> entries_ ABSL_GUARDED_BY(mutex_);
+  // Keys are views of `Entry::query`.
+  absl::flat_hash_map<std::string_view, std::list<Entry>::iterator> index_
+      ABSL_GUARDED_BY(mutex_);
+};
+
+}  // namespace kv_server
+
+#endif  // COMPONENTS_QUERY_QUERY_CACHE_H_
@@ -0,0 +1,193 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/query/query_cache.h"
+
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace kv_server {
+namespace {
+
+using testing::UnorderedElementsAre;
+
+const absl::flat_hash_map<std::string, absl::flat_hash_set<std::string_view>>
+    kDb = {
+        {"A", {"a", "b", "c"}},
+        {"B", {"b", "c", "d"}},
+        {"C", {"c", "d", "e"}},
+};
+
+KVSetView Lookup(std::string_view key) {
+  const auto it = kDb.find(key);
+  if (it != kDb.end()) {
+    return it->second;
+  }
+  return {};
+}
+
+// Ids of the values of `kDb`, where value "a" has id 0, "b" id 1 and so on.
+RoaringBitmap LookupIds(std::string_view key) {
+  RoaringBitmap ids;
+  for (std::string_view value : Lookup(key)) {
+    ids.Add(value[0] - 'a');
+  }
+  return ids;
+}
+
+size_t Cardinality(std::string_view key) { return Lookup(key).size(); }
+
+TEST(CompiledQueryTest, Eval) {
+  auto compiled_query = CompiledQuery::Create("(A - B) | C");
+  ASSERT_TRUE(compiled_query.ok()) << compiled_query.status();
+  EXPECT_THAT((*compiled_query)->Keys(), UnorderedElementsAre("A", "B", "C"));
+  EXPECT_THAT((*compiled_query)->Eval(Lookup, Cardinality),
+              UnorderedElementsAre("a", "c", "d", "e"));
+  EXPECT_THAT((*compiled_query)->EvalIds(LookupIds, Cardinality).ToVector(),
+              testing::ElementsAre(0, 2, 3, 4));
+}
+
+TEST(CompiledQueryTest, EvalWithLimit) {
+  auto compiled_query = CompiledQuery::Create("A | B | C");
+  ASSERT_TRUE(compiled_query.ok()) << compiled_query.status();
+  EXPECT_EQ((*compiled_query)->Eval(Lookup, Cardinality, 3).size(), 3);
+  const RoaringBitmap ids =
+      (*compiled_query)->EvalIds(LookupIds, Cardinality, 4);
+  EXPECT_EQ(ids.Cardinality(), 4);
+  EXPECT_THAT(ids.ToVector(), testing::Each(testing::Lt(5)));
+}
+
+TEST(CompiledQueryTest, ApproxCount) {
+  auto compiled_query = CompiledQuery::Create("APPROX_COUNT((A & B) | C)");
+  ASSERT_TRUE(compiled_query.ok()) << compiled_query.status();
+  EXPECT_TRUE((*compiled_query)->IsApproxCount());
+  EXPECT_FALSE((*compiled_query)->IsCount());
+  EXPECT_EQ((*compiled_query)->EstimateCount(Cardinality), 6);
+  EXPECT_THAT((*compiled_query)->KeysToLookUp(Cardinality),
+              UnorderedElementsAre("A", "B", "C"));
+}
+
+TEST(CompiledQueryTest, KeysToLookUpSkipsEmptyIntersections) {
+  auto compiled_query = CompiledQuery::Create("(A & missing) | (B - C)");
+  ASSERT_TRUE(compiled_query.ok()) << compiled_query.status();
+  EXPECT_EQ((*compiled_query)->EstimateCount(Cardinality), 3);
+  EXPECT_THAT((*compiled_query)->KeysToLookUp(Cardinality),
+              UnorderedElementsAre("missing", "B", "C"));
+}
+
+TEST(CompiledQueryTest, EmptyQuery) {
+  auto compiled_query = CompiledQuery::Create("");
+  ASSERT_TRUE(compiled_query.ok()) << compiled_query.status();
+  EXPECT_TRUE((*compiled_query)->Keys().empty());
+  EXPECT_TRUE((*compiled_query)->Eval(Lookup, Cardinality).empty());
+  EXPECT_EQ((*compiled_query)->EstimateCount(Cardinality), 0);
+  EXPECT_TRUE((*compiled_query)->KeysToLookUp(Cardinality).empty());
+}
+
+TEST(CompiledQueryTest, ParsingFailure) {
+  auto compiled_query = CompiledQuery::Create("A |");
+  EXPECT_EQ(compiled_query.status().code(),
+            absl::StatusCode::kInvalidArgument);
+}
+
+TEST(QueryCacheTest, HitsAfterMiss) {
+  QueryCache cache;
+  bool cache_hit = true;
+  auto first = cache.Get("A & B", &cache_hit);
+  ASSERT_TRUE(first.ok());
+  EXPECT_FALSE(cache_hit);
+  auto second = cache.Get("A & B", &cache_hit);
+  ASSERT_TRUE(second.ok());
+  EXPECT_TRUE(cache_hit);
+  EXPECT_EQ(*first, *second);
+  EXPECT_THAT((*second)->Eval(Lookup, Cardinality),
+              UnorderedElementsAre("b", "c"));
+}
+
+TEST(QueryCacheTest, ParsingFailuresAreNotCached) {
+  QueryCache cache;
+  bool cache_hit = true;
+  EXPECT_FALSE(cache.Get("A &", &cache_hit).ok());
+  EXPECT_FALSE(cache_hit);
+  EXPECT_FALSE(cache.Get("A &", &cache_hit).ok());
+  EXPECT_FALSE(cache_hit);
+  EXPECT_EQ(cache.size(), 0);
+}
+
+TEST(QueryCacheTest, EvictsLeastRecentlyUsed) {
+  QueryCache cache(2);
+  bool cache_hit;
+  ASSERT_TRUE(cache.Get("A", &cache_hit).ok());
+  ASSERT_TRUE(cache.Get("B", &cache_hit).ok());
+  // Makes "B" the least recently used.
+  ASSERT_TRUE(cache.Get("A", &cache_hit).ok());
+  EXPECT_TRUE(cache_hit);
+  ASSERT_TRUE(cache.Get("C", &cache_hit).ok());
+  EXPECT_EQ(cache.size(), 2);
+  ASSERT_TRUE(cache.Get("A", &cache_hit).ok());
+  EXPECT_TRUE(cache_hit);
+  ASSERT_TRUE(cache.Get("B", &cache_hit).ok());
+  EXPECT_FALSE(cache_hit);
+}
+
+TEST(QueryCacheTest, EvictedQueriesStayValid) {
+  QueryCache cache(1);
+  bool cache_hit;
+  auto compiled_query = cache.Get("A | B", &cache_hit);
+  ASSERT_TRUE(compiled_query.ok());
+  ASSERT_TRUE(cache.Get("C", &cache_hit).ok());
+  EXPECT_THAT((*compiled_query)->Eval(Lookup, Cardinality),
+              UnorderedElementsAre("a", "b", "c", "d"));
+}
+
+TEST(QueryCacheTest, ZeroCapacityCachesNothing) {
+  QueryCache cache(0);
+  bool cache_hit;
+  ASSERT_TRUE(cache.Get("A", &cache_hit).ok());
+  ASSERT_TRUE(cache.Get("A", &cache_hit).ok());
+  EXPECT_FALSE(cache_hit);
+  EXPECT_EQ(cache.size(), 0);
+}
+
+TEST(QueryCacheTest, MultipleThreads) {
+  QueryCache cache(4);
+  const std::vector<std::string> queries = {"A", "A & B", "A | B", "A - B",
+                                            "B & C", "(A | B) & C"};
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 8; i++) {
+    threads.emplace_back([&cache, &queries, i]() {
+      for (int j = 0; j < 1000; j++) {
+        bool cache_hit;
+        auto compiled_query =
+            cache.Get(queries[(i + j) % queries.size()], &cache_hit);
+        ASSERT_TRUE(compiled_query.ok());
+        (*compiled_query)->Eval(Lookup, Cardinality);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(cache.size(), 4);
+}
+
+}  // namespace
+}  // namespace kv_server
@@ -0,0 +1,368 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/query/roaring_bitmap.h"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "absl/numeric/bits.h"
+#include "absl/types/span.h"
+#include "components/query/sorted_arrays.h"
+
+namespace kv_server {
+namespace {
+
+constexpr size_t kBitmapWords = (1 << 16) / 64;
+
+bool TestBit(const std::vector<uint64_t>& bits, uint16_t low) {
+  return (bits[low >> 6] >> (low & 63)) & 1;
+}
+
+size_t CountBits(const std::vector<uint64_t>& bits) {
+  size_t count = 0;
+  for (const uint64_t word : bits) {
+    count += absl::popcount(word);
+  }
+  return count;
+}
+
+}  // namespace
+
+RoaringBitmap RoaringBitmap::FromIds(absl::Span<const uint32_t> ids) {
+  std::vector<uint32_t> sorted(ids.begin(), ids.end());
+  std::sort(sorted.begin(), sorted.end());
+  sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+  RoaringBitmap bitmap;
+  for (const uint32_t id : sorted) {
+    const uint16_t key = id >> 16;
+    if (bitmap.containers_.empty() || bitmap.containers_.back().key != key) {
+      bitmap.containers_.push_back({.key = key});
+    }
+    Container& container = bitmap.containers_.back();
+    if (container.bits.empty()) {
+      container.array.push_back(id & 0xFFFF);
+      if (container.array.size() > kMaxArraySize) {
+        ToBitmapContainer(container);
+      }
+    } else {
+      container.bits[(id & 0xFFFF) >> 6] |= uint64_t{1} << (id & 63);
+    }
+    container.cardinality++;
+  }
+  return bitmap;
+}
+
+bool RoaringBitmap::Add(uint32_t id) {
+  const uint16_t key = id >> 16;
+  const uint16_t low = id & 0xFFFF;
+  const size_t index = LowerBound(key);
+  if (index == containers_.size() || containers_[index].key != key) {
+    containers_.insert(containers_.begin() + index,
+                       {.key = key, .cardinality = 1, .array = {low}});
+    return true;
+  }
+  Container& container = containers_[index];
+  if (!container.bits.empty()) {
+    if (TestBit(container.bits, low)) {
+      return false;
+    }
+    container.bits[low >> 6] |= uint64_t{1} << (low & 63);
+    container.cardinality++;
+    return true;
+  }
+  auto it = std::lower_bound(container.array.begin(), container.array.end(),
+                             low);
+  if (it != container.array.end() && *it == low) {
+    return false;
+  }
+  container.array.insert(it, low);
+  container.cardinality++;
+  if (container.array.size() > kMaxArraySize) {
+    ToBitmapContainer(container);
+  }
+  return true;
+}
+
+bool RoaringBitmap::Remove(uint32_t id) {
+  const uint16_t key = id >> 16;
+  const uint16_t low = id & 0xFFFF;
+  const size_t index = LowerBound(key);
+  if (index == containers_.size() || containers_[index].key != key) {
+    return false;
+  }
+  Container& container = containers_[index];
+  if (!container.bits.empty()) {
+    if (!TestBit(container.bits, low)) {
+      return false;
+    }
+    container.bits[low >> 6] &= ~(uint64_t{1} << (low & 63));
+    container.cardinality--;
+    // Leaves some room so that alternating adds and removes of one id do not
+    // convert the container every time.
+    MaybeToArrayContainer(container, kMaxArraySize / 2);
+  } else {
+    auto it = std::lower_bound(container.array.begin(), container.array.end(),
+                               low);
+    if (it == container.array.end() || *it != low) {
+      return false;
+    }
+    container.array.erase(it);
+    container.cardinality--;
+  }
+  if (container.cardinality == 0) {
+    containers_.erase(containers_.begin() + index);
+  }
+  return true;
+}
+
+bool RoaringBitmap::Contains(uint32_t id) const {
+  const uint16_t key = id >> 16;
+  const uint16_t low = id & 0xFFFF;
+  const size_t index = LowerBound(key);
+  if (index == containers_.size() || containers_[index].key != key) {
+    return false;
+  }
+  const Container& container = containers_[index];
+  if (!container.bits.empty()) {
+    return TestBit(container.bits, low);
+  }
+  return std::binary_search(container.array.begin(), container.array.end(),
+                            low);
+}
+
+size_t RoaringBitmap::Cardinality() const {
+  size_t cardinality = 0;
+  for (const Container& container : containers_) {
+    cardinality += container.cardinality;
+  }
+  return cardinality;
+}
+
+void RoaringBitmap::UnionWith(const RoaringBitmap& other) {
+  std::vector<Container> result;
+  result.reserve(containers_.size() + other.containers_.size());
+  size_t i = 0;
+  size_t j = 0;
+  while (i < containers_.size() || j < other.containers_.size()) {
+    if (j == other.containers_.size() ||
+        (i < containers_.size() &&
+         containers_[i].key < other.containers_[j].key)) {
+      result.push_back(std::move(containers_[i++]));
+    } else if (i == containers_.size() ||
+               other.containers_[j].key < containers_[i].key) {
+      result.push_back(other.containers_[j++]);
+    } else {
+      UnionContainers(containers_[i], other.containers_[j++]);
+      result.push_back(std::move(containers_[i++]));
+    }
+  }
+  containers_ = std::move(result);
+}
+
+void RoaringBitmap::IntersectWith(const RoaringBitmap& other) {
+  size_t out = 0;
+  size_t j = 0;
+  for (size_t i = 0; i < containers_.size(); i++) {
+    while (j < other.containers_.size() &&
+           other.containers_[j].key < containers_[i].key) {
+      j++;
+    }
+    if (j == other.containers_.size()) {
+      break;
+    }
+    if (other.containers_[j].key != containers_[i].key) {
+      continue;
+    }
+    IntersectContainers(containers_[i], other.containers_[j]);
+    if (containers_[i].cardinality > 0) {
+      if (out != i) {
+        containers_[out] = std::move(containers_[i]);
+      }
+      out++;
+    }
+  }
+  containers_.resize(out);
+}
+
+void RoaringBitmap::DifferenceWith(const RoaringBitmap& other) {
+  size_t out = 0;
+  size_t j = 0;
+  for (size_t i = 0; i < containers_.size(); i++) {
+    while (j < other.containers_.size() &&
+           other.containers_[j].key < containers_[i].key) {
+      j++;
+    }
+    if (j < other.containers_.size() &&
+        other.containers_[j].key == containers_[i].key) {
+      SubtractContainers(containers_[i], other.containers_[j]);
+    }
+    if (containers_[i].cardinality > 0) {
+      if (out != i) {
+        containers_[out] = std::move(containers_[i]);
+      }
+      out++;
+    }
+  }
+  containers_.resize(out);
+}
+
+std::vector<uint32_t> RoaringBitmap::ToVector() const {
+  std::vector<uint32_t> ids;
+  ids.reserve(Cardinality());
+  ForEach([&ids](uint32_t id) { ids.push_back(id); });
+  return ids;
+}
+
+bool operator==(const RoaringBitmap& a, const RoaringBitmap& b) {
+  if (a.containers_.size() != b.containers_.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < a.containers_.size(); i++) {
+    const RoaringBitmap::Container& x = a.containers_[i];
+    const RoaringBitmap::Container& y = b.containers_[i];
+    if (x.key != y.key || x.cardinality != y.cardinality) {
+      return false;
+    }
+  }
+  // Containers of the same ids may use different representations.
+  return a.ToVector() == b.ToVector();
+}
+
+size_t RoaringBitmap::LowerBound(uint16_t key) const {
+  return std::lower_bound(containers_.begin(), containers_.end(), key,
+                          [](const Container& container, uint16_t key) {
+                            return container.key < key;
+                          }) -
+         containers_.begin();
+}
+
+void RoaringBitmap::ToBitmapContainer(Container& container) {
+  container.bits.assign(kBitmapWords, 0);
+  for (const uint16_t low : container.array) {
+    container.bits[low >> 6] |= uint64_t{1} << (low & 63);
+  }
+  container.array = std::vector<uint16_t>();
+}
+
+void RoaringBitmap::MaybeToArrayContainer(Container& container,
+                                          size_t max_array_size) {
+  if (container.bits.empty() || container.cardinality > max_array_size) {
+    return;
+  }
+  container.array.reserve(container.cardinality);
+  for (uint32_t word = 0; word < kBitmapWords; word++) {
+    uint64_t bits = container.bits[word];
+    while (bits != 0) {
+      container.array.push_back((word << 6) | absl::countr_zero(bits));
+      bits &= bits - 1;
+    }
+  }
+  container.bits = std::vector<uint64_t>();
+}
+
+void RoaringBitmap::UnionContainers(Container& container,
+                                    const Container& other) {
+  if (container.bits.empty() && other.bits.empty() &&
+      container.array.size() + other.array.size() <= kMaxArraySize) {
+    container.array = UnionSortedArrays(container.array, other.array);
+    container.cardinality = container.array.size();
+    return;
+  }
+  // Unions that may not fit an array are built as bitmaps.
+  if (container.bits.empty() && other.bits.empty()) {
+    ToBitmapContainer(container);
+    for (const uint16_t low : other.array) {
+      container.bits[low >> 6] |= uint64_t{1} << (low & 63);
+    }
+  } else if (container.bits.empty()) {
+    std::vector<uint16_t> array = std::move(container.array);
+    container.bits = other.bits;
+    for (const uint16_t low : array) {
+      container.bits[low >> 6] |= uint64_t{1} << (low & 63);
+    }
+  } else if (other.bits.empty()) {
+    for (const uint16_t low : other.array) {
+      container.bits[low >> 6] |= uint64_t{1} << (low & 63);
+    }
+  } else {
+    for (size_t word = 0; word < kBitmapWords; word++) {
+      container.bits[word] |= other.bits[word];
+    }
+  }
+  container.cardinality = CountBits(container.bits);
+  MaybeToArrayContainer(container);
+}
+
+void RoaringBitmap::IntersectContainers(Container& container,
+                                        const Container& other) {
+  if (container.bits.empty() && other.bits.empty()) {
+    container.array = IntersectSortedArrays(container.array, other.array);
+    container.cardinality = container.array.size();
+    return;
+  }
+  if (container.bits.empty() || other.bits.empty()) {
+    // The result is at most as large as the array.
+    const std::vector<uint64_t>& bits =
+        container.bits.empty() ? other.bits : container.bits;
+    std::vector<uint16_t> array =
+        container.bits.empty() ? std::move(container.array) : other.array;
+    array.erase(std::remove_if(array.begin(), array.end(),
+                               [&bits](uint16_t low) {
+                                 return !TestBit(bits, low);
+                               }),
+                array.end());
+    container.bits = std::vector<uint64_t>();
+    container.array = std::move(array);
+    container.cardinality = container.array.size();
+    return;
+  }
+  for (size_t word = 0; word < kBitmapWords; word++) {
+    container.bits[word] &= other.bits[word];
+  }
+  container.cardinality = CountBits(container.bits);
+  MaybeToArrayContainer(container);
+}
+
+void RoaringBitmap::SubtractContainers(Container& container,
+                                       const Container& other) {
+  if (container.bits.empty()) {
+    if (other.bits.empty()) {
+      container.array = SubtractSortedArrays(container.array, other.array);
+    } else {
+      container.array.erase(
+          std::remove_if(container.array.begin(), container.array.end(),
+                         [&other](uint16_t low) {
+                           return TestBit(other.bits, low);
+                         }),
+          container.array.end());
+    }
+    container.cardinality = container.array.size();
+    return;
+  }
+  if (other.bits.empty()) {
+    for (const uint16_t low : other.array) {
+      container.bits[low >> 6] &= ~(uint64_t{1} << (low & 63));
+    }
+  } else {
+    for (size_t word = 0; word < kBitmapWords; word++) {
+      container.bits[word] &= ~other.bits[word];
+    }
+  }
+  container.cardinality = CountBits(container.bits);
+  MaybeToArrayContainer(container);
+}
+
+}  // namespace kv_server
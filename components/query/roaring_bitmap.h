@@ -0,0 +1,134 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef COMPONENTS_QUERY_ROARING_BITMAP_H_
+#define COMPONENTS_QUERY_ROARING_BITMAP_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "absl/numeric/bits.h"
+#include "absl/types/span.h"
+
+namespace kv_server {
+
+// Compressed set of 32 bit ids, laid out like a Roaring bitmap
+// (https://roaringbitmap.org). Ids are grouped into containers by their upper
+// 16 bits. A container holds the lower 16 bits of its ids either as a sorted
+// array, while it has at most `kMaxArraySize` ids, or as a bitmap of all 2^16
+// possible ids.
+class RoaringBitmap {
+ public:
+  static constexpr size_t kMaxArraySize = 4096;
+
+  RoaringBitmap() = default;
+
+  // Creates a bitmap holding `ids`, which may be in any order.
+  static RoaringBitmap FromIds(absl::Span<const uint32_t> ids);
+
+  // Adds `id`. Returns whether it was not present before.
+  bool Add(uint32_t id);
+  // Removes `id`. Returns whether it was present.
+  bool Remove(uint32_t id);
+  bool Contains(uint32_t id) const;
+
+  // Number of ids in the bitmap.
+  size_t Cardinality() const;
+  bool IsEmpty() const { return containers_.empty(); }
+
+  // Set operations that replace this bitmap with the union, intersection or
+  // difference of this bitmap and `other`.
+  void UnionWith(const RoaringBitmap& other);
+  void IntersectWith(const RoaringBitmap& other);
+  void DifferenceWith(const RoaringBitmap& other);
+
+  // Calls `fn(id)` for every id in ascending order.
+  template <typename Fn>
+  void ForEach(Fn&& fn) const {
+    ForEachWhile([&fn](uint32_t id) {
+      fn(id);
+      return true;
+    });
+  }
+
+  // Same as `ForEach`, but stops once `fn(id)` returns false. Returns whether
+  // all ids were visited.
+  template <typename Fn>
+  bool ForEachWhile(Fn&& fn) const {
+    for (const Container& container : containers_) {
+      const uint32_t high = static_cast<uint32_t>(container.key) << 16;
+      if (container.bits.empty()) {
+        for (const uint16_t low : container.array) {
+          if (!fn(high | low)) {
+            return false;
+          }
+        }
+        continue;
+      }
+      for (uint32_t word = 0; word < container.bits.size(); word++) {
+        uint64_t bits = container.bits[word];
+        while (bits != 0) {
+          if (!fn(high | (word << 6) | absl::countr_zero(bits))) {
+            return false;
+          }
+          bits &= bits - 1;
+        }
+      }
+    }
+    return true;
+  }
+
+  // Returns the ids in ascending order.
+  std::vector<uint32_t> ToVector() const;
+
+  friend bool operator==(const RoaringBitmap& a, const RoaringBitmap& b);
+  friend bool operator!=(const RoaringBitmap& a, const RoaringBitmap& b) {
+    return !(a == b);
+  }
+
+ private:
+  struct Container {
+    // Upper 16 bits of the ids in this container.
+    uint16_t key = 0;
+    // Number of ids in this container, never 0.
+    uint32_t cardinality = 0;
+    // Exactly one of these is used. `array` holds the sorted lower 16 bits of
+    // the ids, `bits` has one bit for each of the 2^16 possible ids.
+    std::vector<uint16_t> array;
+    std::vector<uint64_t> bits;
+  };
+
+  // Returns the index of the first container whose key is not less than
+  // `key`.
+  size_t LowerBound(uint16_t key) const;
+
+  static void ToBitmapContainer(Container& container);
+  // Switches bitmap containers to arrays once they have at most
+  // `max_array_size` ids.
+  static void MaybeToArrayContainer(Container& container,
+                                    size_t max_array_size = kMaxArraySize);
+  static void UnionContainers(Container& container, const Container& other);
+  static void IntersectContainers(Container& container,
+                                  const Container& other);
+  static void SubtractContainers(Container& container, const Container& other);
+
+  // Sorted by key. Empty containers are removed.
+  std::vector<Container> containers_;
+};
+
+}  // namespace kv_server
+
+#endif  // COMPONENTS_QUERY_ROARING_BITMAP_H_
@@ -0,0 +1,185 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/query/roaring_bitmap.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <random>
+#include <set>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace kv_server {
+namespace {
+
+using testing::ElementsAre;
+using testing::IsEmpty;
+
+std::vector<uint32_t> RandomIds(std::mt19937& gen, size_t count,
+                                uint32_t max_id) {
+  std::uniform_int_distribution<uint32_t> dist(0, max_id);
+  std::vector<uint32_t> ids(count);
+  for (auto& id : ids) {
+    id = dist(gen);
+  }
+  return ids;
+}
+
+std::vector<uint32_t> Sorted(const std::vector<uint32_t>& ids) {
+  std::set<uint32_t> sorted(ids.begin(), ids.end());
+  return std::vector<uint32_t>(sorted.begin(), sorted.end());
+}
+
+TEST(RoaringBitmapTest, EmptyBitmap) {
+  RoaringBitmap bitmap;
+  EXPECT_TRUE(bitmap.IsEmpty());
+  EXPECT_EQ(bitmap.Cardinality(), 0);
+  EXPECT_FALSE(bitmap.Contains(0));
+  EXPECT_FALSE(bitmap.Remove(0));
+  EXPECT_THAT(bitmap.ToVector(), IsEmpty());
+}
+
+TEST(RoaringBitmapTest, AddContainsAndRemove) {
+  RoaringBitmap bitmap;
+  EXPECT_TRUE(bitmap.Add(70000));
+  EXPECT_TRUE(bitmap.Add(3));
+  EXPECT_FALSE(bitmap.Add(3));
+  EXPECT_TRUE(bitmap.Add(UINT32_MAX));
+  EXPECT_TRUE(bitmap.Contains(3));
+  EXPECT_TRUE(bitmap.Contains(70000));
+  EXPECT_FALSE(bitmap.Contains(4));
+  EXPECT_EQ(bitmap.Cardinality(), 3);
+  EXPECT_THAT(bitmap.ToVector(), ElementsAre(3, 70000, UINT32_MAX));
+  EXPECT_TRUE(bitmap.Remove(70000));
+  EXPECT_FALSE(bitmap.Remove(70000));
+  EXPECT_THAT(bitmap.ToVector(), ElementsAre(3, UINT32_MAX));
+}
+
+TEST(RoaringBitmapTest, ConvertsBetweenArrayAndBitmapContainers) {
+  RoaringBitmap bitmap;
+  std::vector<uint32_t> ids;
+  for (uint32_t id = 0; id < 3 * RoaringBitmap::kMaxArraySize; id += 2) {
+    EXPECT_TRUE(bitmap.Add(id));
+    ids.push_back(id);
+  }
+  EXPECT_EQ(bitmap.Cardinality(), ids.size());
+  EXPECT_EQ(bitmap.ToVector(), ids);
+  EXPECT_TRUE(bitmap.Contains(2 * RoaringBitmap::kMaxArraySize));
+  EXPECT_FALSE(bitmap.Contains(2 * RoaringBitmap::kMaxArraySize + 1));
+  for (uint32_t id : ids) {
+    EXPECT_TRUE(bitmap.Remove(id));
+  }
+  EXPECT_TRUE(bitmap.IsEmpty());
+}
+
+TEST(RoaringBitmapTest, FromIdsSortsAndDeduplicates) {
+  EXPECT_THAT(RoaringBitmap::FromIds({5, 1, 1 << 20, 5}).ToVector(),
+              ElementsAre(1, 5, 1 << 20));
+}
+
+TEST(RoaringBitmapTest, ForEachWhileStops) {
+  std::vector<uint32_t> ids;
+  for (uint32_t id = 0; id < 2 * RoaringBitmap::kMaxArraySize; id++) {
+    ids.push_back(id * 3);
+  }
+  // One bitmap container followed by an array container.
+  ids.push_back(1 << 20);
+  const RoaringBitmap bitmap = RoaringBitmap::FromIds(ids);
+  std::vector<uint32_t> visited;
+  EXPECT_FALSE(bitmap.ForEachWhile([&visited](uint32_t id) {
+    visited.push_back(id);
+    return visited.size() < 3;
+  }));
+  EXPECT_THAT(visited, ElementsAre(0, 3, 6));
+  visited.clear();
+  EXPECT_TRUE(bitmap.ForEachWhile([&visited](uint32_t id) {
+    visited.push_back(id);
+    return true;
+  }));
+  EXPECT_EQ(visited, ids);
+}
+
+TEST(RoaringBitmapTest, EqualityIgnoresContainerRepresentation) {
+  std::vector<uint32_t> ids;
+  for (uint32_t id = 0; id < 2 * RoaringBitmap::kMaxArraySize; id++) {
+    ids.push_back(id);
+  }
+  RoaringBitmap bitmap = RoaringBitmap::FromIds(ids);
+  for (uint32_t id = 100; id < 2 * RoaringBitmap::kMaxArraySize; id++) {
+    bitmap.Remove(id);
+  }
+  EXPECT_EQ(bitmap, RoaringBitmap::FromIds(
+                        std::vector<uint32_t>(ids.begin(), ids.begin() + 100)));
+  EXPECT_NE(bitmap, RoaringBitmap::FromIds({1, 2, 3}));
+}
+
+struct SetOpCase {
+  size_t left_size;
+  size_t right_size;
+  uint32_t max_id;
+};
+
+class RoaringBitmapSetOpTest : public testing::TestWithParam<SetOpCase> {};
+
+// Compares the set operations with std::set_* over containers of every
+// combination of representations.
+TEST_P(RoaringBitmapSetOpTest, MatchesSortedVectorSetOps) {
+  std::mt19937 gen(42);
+  const SetOpCase& param = GetParam();
+  const auto left = Sorted(RandomIds(gen, param.left_size, param.max_id));
+  const auto right = Sorted(RandomIds(gen, param.right_size, param.max_id));
+  const RoaringBitmap left_bitmap = RoaringBitmap::FromIds(left);
+  const RoaringBitmap right_bitmap = RoaringBitmap::FromIds(right);
+
+  std::vector<uint32_t> expected;
+  std::set_union(left.begin(), left.end(), right.begin(), right.end(),
+                 std::back_inserter(expected));
+  RoaringBitmap result = left_bitmap;
+  result.UnionWith(right_bitmap);
+  EXPECT_EQ(result.ToVector(), expected);
+  EXPECT_EQ(result.Cardinality(), expected.size());
+
+  expected.clear();
+  std::set_intersection(left.begin(), left.end(), right.begin(), right.end(),
+                        std::back_inserter(expected));
+  result = left_bitmap;
+  result.IntersectWith(right_bitmap);
+  EXPECT_EQ(result.ToVector(), expected);
+  EXPECT_EQ(result.Cardinality(), expected.size());
+
+  expected.clear();
+  std::set_difference(left.begin(), left.end(), right.begin(), right.end(),
+                      std::back_inserter(expected));
+  result = left_bitmap;
+  result.DifferenceWith(right_bitmap);
+  EXPECT_EQ(result.ToVector(), expected);
+  EXPECT_EQ(result.Cardinality(), expected.size());
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    Sizes, RoaringBitmapSetOpTest,
+    testing::Values(SetOpCase{0, 100, 1000}, SetOpCase{100, 0, 1000},
+                    SetOpCase{100, 200, 1000},
+                    SetOpCase{10, 3000, 1 << 17},
+                    SetOpCase{100, 50000, 1 << 17},
+                    SetOpCase{50000, 100, 1 << 17},
+                    SetOpCase{50000, 60000, 1 << 17},
+                    SetOpCase{20000, 20000, 1 << 24}));
+
+}  // namespace
+}  // namespace kv_server
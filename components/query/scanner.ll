@@ -49,6 +49,9 @@ OP_CHARS          [|&\-+=/]
 "&"                { return kv_server::Parser::make_INTERSECTION(); }
 (?i:DIFFERENCE)    { return kv_server::Parser::make_DIFFERENCE(); }
 "-"                { return kv_server::Parser::make_DIFFERENCE(); }
+(?i:COUNT)         { return kv_server::Parser::make_COUNT(); }
+(?i:APPROX_COUNT)  { return kv_server::Parser::make_APPROX_COUNT(); }
+(?i:LIMIT)         { return kv_server::Parser::make_LIMIT(); }
 {VAR_CHARS}+       { return kv_server::Parser::make_VAR(yytext); }
 "\""({VAR_CHARS}+|{OP_CHARS}+)+"\"" {
                      // Exclude the double quotes from the var name.
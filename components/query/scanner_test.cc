@@ -170,6 +170,38 @@ TEST(ScannerTest, Operators) {
   ASSERT_EQ(t7.token(), Parser::token::YYEOF);
 }
 
+TEST(ScannerTest, CountAndLimit) {
+  std::istringstream stream("COUNT count LIMIT limit limits \"limit\"");
+  Scanner scanner(stream);
+  Driver driver(NeverUsedLookup);
+
+  ASSERT_EQ(scanner.yylex(driver).token(), Parser::token::COUNT);
+  ASSERT_EQ(scanner.yylex(driver).token(), Parser::token::COUNT);
+  ASSERT_EQ(scanner.yylex(driver).token(), Parser::token::LIMIT);
+  ASSERT_EQ(scanner.yylex(driver).token(), Parser::token::LIMIT);
+  // Longer names and quoted names are keys.
+  auto t5 = scanner.yylex(driver);
+  ASSERT_EQ(t5.token(), Parser::token::VAR);
+  ASSERT_EQ(t5.value.as<std::string>(), "limits");
+  auto t6 = scanner.yylex(driver);
+  ASSERT_EQ(t6.token(), Parser::token::VAR);
+  ASSERT_EQ(t6.value.as<std::string>(), "limit");
+  ASSERT_EQ(scanner.yylex(driver).token(), Parser::token::YYEOF);
+}
+
+TEST(ScannerTest, ApproxCount) {
+  std::istringstream stream("APPROX_COUNT approx_count approx_counts");
+  Scanner scanner(stream);
+  Driver driver(NeverUsedLookup);
+
+  ASSERT_EQ(scanner.yylex(driver).token(), Parser::token::APPROX_COUNT);
+  ASSERT_EQ(scanner.yylex(driver).token(), Parser::token::APPROX_COUNT);
+  auto t3 = scanner.yylex(driver);
+  ASSERT_EQ(t3.token(), Parser::token::VAR);
+  ASSERT_EQ(t3.value.as<std::string>(), "approx_counts");
+  ASSERT_EQ(scanner.yylex(driver).token(), Parser::token::YYEOF);
+}
+
 TEST(ScannerTest, Error) {
   std::istringstream stream("!");
   Scanner scanner(stream);
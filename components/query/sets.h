@@ -20,6 +20,7 @@
 #include <utility>
 
 #include "absl/container/flat_hash_set.h"
+#include "components/query/roaring_bitmap.h"
 
 namespace kv_server {
 template <typename T>
@@ -51,5 +52,106 @@ absl::flat_hash_set<T> Difference(absl::flat_hash_set<T>&& left,
   return std::move(left);
 }
 
+// Same as above, for a `right` set that is shared and must not be modified.
+template <typename T>
+absl::flat_hash_set<T> Union(absl::flat_hash_set<T>&& left,
+                             const absl::flat_hash_set<T>& right) {
+  if (left.size() < right.size()) {
+    absl::flat_hash_set<T> result = right;
+    result.insert(left.begin(), left.end());
+    return result;
+  }
+  left.insert(right.begin(), right.end());
+  return std::move(left);
+}
+
+template <typename T>
+absl::flat_hash_set<T> Intersection(absl::flat_hash_set<T>&& left,
+                                    const absl::flat_hash_set<T>& right) {
+  if (left.size() <= right.size()) {
+    absl::erase_if(left,
+                   [&right](const T& elem) { return !right.contains(elem); });
+    return std::move(left);
+  }
+  absl::flat_hash_set<T> result;
+  for (const auto& element : right) {
+    if (left.contains(element)) {
+      result.insert(element);
+    }
+  }
+  return result;
+}
+
+template <typename T>
+absl::flat_hash_set<T> Difference(absl::flat_hash_set<T>&& left,
+                                  const absl::flat_hash_set<T>& right) {
+  for (const auto& element : right) {
+    left.erase(element);
+  }
+  return std::move(left);
+}
+
+// Same as above, for a `left` set that is shared.
+template <typename T>
+absl::flat_hash_set<T> Difference(const absl::flat_hash_set<T>& left,
+                                  const absl::flat_hash_set<T>& right) {
+  absl::flat_hash_set<T> result;
+  for (const auto& element : left) {
+    if (!right.contains(element)) {
+      result.insert(element);
+    }
+  }
+  return result;
+}
+
+// Set operations over interned ids, see `RoaringBitmap`.
+inline RoaringBitmap Union(RoaringBitmap&& left, RoaringBitmap&& right) {
+  const bool left_is_smaller = left.Cardinality() <= right.Cardinality();
+  auto& small = left_is_smaller ? left : right;
+  auto& big = left_is_smaller ? right : left;
+  big.UnionWith(small);
+  return std::move(big);
+}
+
+inline RoaringBitmap Intersection(RoaringBitmap&& left,
+                                  RoaringBitmap&& right) {
+  const bool left_is_smaller = left.Cardinality() <= right.Cardinality();
+  auto& small = left_is_smaller ? left : right;
+  const auto& big = left_is_smaller ? right : left;
+  small.IntersectWith(big);
+  return std::move(small);
+}
+
+inline RoaringBitmap Difference(RoaringBitmap&& left, RoaringBitmap&& right) {
+  left.DifferenceWith(right);
+  return std::move(left);
+}
+
+// Same as above, for a `right` set that is shared and must not be modified.
+inline RoaringBitmap Union(RoaringBitmap&& left, const RoaringBitmap& right) {
+  left.UnionWith(right);
+  return std::move(left);
+}
+
+inline RoaringBitmap Intersection(RoaringBitmap&& left,
+                                  const RoaringBitmap& right) {
+  left.IntersectWith(right);
+  return std::move(left);
+}
+
+inline RoaringBitmap Difference(RoaringBitmap&& left,
+                                const RoaringBitmap& right) {
+  left.DifferenceWith(right);
+  return std::move(left);
+}
+
+// Same as above, for a `left` set that is shared.
+inline RoaringBitmap Difference(const RoaringBitmap& left,
+                                const RoaringBitmap& right) {
+  RoaringBitmap result = left;
+  result.DifferenceWith(right);
+  return result;
+}
+
 }  // namespace kv_server
 #endif  // COMPONENTS_QUERY_SETS_H_
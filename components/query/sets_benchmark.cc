@@ -0,0 +1,214 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Compares the query set operations over hash sets of values with the same
+// operations over interned ids.
+//
+// Each set operation takes copies of its inputs, like the leaves of a query
+// do with the looked up sets, so the copies are included in the timings.
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <random>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_set.h"
+#include "absl/strings/str_cat.h"
+#include "benchmark/benchmark.h"
+#include "components/query/roaring_bitmap.h"
+#include "components/query/sets.h"
+#include "components/query/sorted_arrays.h"
+
+namespace kv_server {
+namespace {
+
+using StringSet = absl::flat_hash_set<std::string_view>;
+
+// Two random sets of `size` ids out of `2 * size`, so that about half of the
+// ids are in both.
+struct SetPair {
+  explicit SetPair(size_t size) {
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<uint32_t> dist(0, 2 * size - 1);
+    values.reserve(2 * size);
+    for (size_t i = 0; i < 2 * size; i++) {
+      values.push_back(absl::StrCat("value", i));
+    }
+    std::vector<uint32_t> left_ids;
+    std::vector<uint32_t> right_ids;
+    while (left.size() < size) {
+      const uint32_t id = dist(gen);
+      if (left.insert(values[id]).second) {
+        left_ids.push_back(id);
+      }
+    }
+    while (right.size() < size) {
+      const uint32_t id = dist(gen);
+      if (right.insert(values[id]).second) {
+        right_ids.push_back(id);
+      }
+    }
+    left_bitmap = RoaringBitmap::FromIds(left_ids);
+    right_bitmap = RoaringBitmap::FromIds(right_ids);
+  }
+
+  std::vector<std::string> values;
+  StringSet left;
+  StringSet right;
+  RoaringBitmap left_bitmap;
+  RoaringBitmap right_bitmap;
+};
+
+template <typename SetT, typename OpT>
+void RunSetOp(benchmark::State& state, const SetT& left, const SetT& right,
+              OpT op) {
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(op(SetT(left), SetT(right)));
+  }
+  state.SetItemsProcessed(state.iterations() * 2 * state.range(0));
+}
+
+void BM_HashSetUnion(benchmark::State& state) {
+  const SetPair sets(state.range(0));
+  RunSetOp(state, sets.left, sets.right, [](StringSet&& l, StringSet&& r) {
+    return Union(std::move(l), std::move(r));
+  });
+}
+
+void BM_HashSetIntersection(benchmark::State& state) {
+  const SetPair sets(state.range(0));
+  RunSetOp(state, sets.left, sets.right, [](StringSet&& l, StringSet&& r) {
+    return Intersection(std::move(l), std::move(r));
+  });
+}
+
+void BM_HashSetDifference(benchmark::State& state) {
+  const SetPair sets(state.range(0));
+  RunSetOp(state, sets.left, sets.right, [](StringSet&& l, StringSet&& r) {
+    return Difference(std::move(l), std::move(r));
+  });
+}
+
+void BM_BitmapUnion(benchmark::State& state) {
+  const SetPair sets(state.range(0));
+  RunSetOp(state, sets.left_bitmap, sets.right_bitmap,
+           [](RoaringBitmap&& l, RoaringBitmap&& r) {
+             return Union(std::move(l), std::move(r));
+           });
+}
+
+void BM_BitmapIntersection(benchmark::State& state) {
+  const SetPair sets(state.range(0));
+  RunSetOp(state, sets.left_bitmap, sets.right_bitmap,
+           [](RoaringBitmap&& l, RoaringBitmap&& r) {
+             return Intersection(std::move(l), std::move(r));
+           });
+}
+
+void BM_BitmapDifference(benchmark::State& state) {
+  const SetPair sets(state.range(0));
+  RunSetOp(state, sets.left_bitmap, sets.right_bitmap,
+           [](RoaringBitmap&& l, RoaringBitmap&& r) {
+             return Difference(std::move(l), std::move(r));
+           });
+}
+
+// Returns `size` distinct random ids below 2^16 in ascending order, like the
+// arrays of bitmap containers.
+std::vector<uint16_t> RandomSortedIds(size_t size, uint32_t seed) {
+  std::mt19937 gen(seed);
+  std::vector<uint16_t> ids(1 << 16);
+  for (size_t i = 0; i < ids.size(); i++) {
+    ids[i] = i;
+  }
+  std::shuffle(ids.begin(), ids.end(), gen);
+  ids.resize(size);
+  std::sort(ids.begin(), ids.end());
+  return ids;
+}
+
+void BM_StdSetIntersection(benchmark::State& state) {
+  const auto left = RandomSortedIds(state.range(0), 1);
+  const auto right = RandomSortedIds(state.range(1), 2);
+  for (auto _ : state) {
+    std::vector<uint16_t> result;
+    std::set_intersection(left.begin(), left.end(), right.begin(), right.end(),
+                          std::back_inserter(result));
+    benchmark::DoNotOptimize(result);
+  }
+  state.SetItemsProcessed(state.iterations() * (left.size() + right.size()));
+}
+
+void BM_IntersectSortedArrays(benchmark::State& state) {
+  const auto left = RandomSortedIds(state.range(0), 1);
+  const auto right = RandomSortedIds(state.range(1), 2);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(IntersectSortedArrays(left, right));
+  }
+  state.SetItemsProcessed(state.iterations() * (left.size() + right.size()));
+}
+
+void BM_StdSetDifference(benchmark::State& state) {
+  const auto left = RandomSortedIds(state.range(0), 1);
+  const auto right = RandomSortedIds(state.range(1), 2);
+  for (auto _ : state) {
+    std::vector<uint16_t> result;
+    std::set_difference(left.begin(), left.end(), right.begin(), right.end(),
+                        std::back_inserter(result));
+    benchmark::DoNotOptimize(result);
+  }
+  state.SetItemsProcessed(state.iterations() * (left.size() + right.size()));
+}
+
+void BM_SubtractSortedArrays(benchmark::State& state) {
+  const auto left = RandomSortedIds(state.range(0), 1);
+  const auto right = RandomSortedIds(state.range(1), 2);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(SubtractSortedArrays(left, right));
+  }
+  state.SetItemsProcessed(state.iterations() * (left.size() + right.size()));
+}
+
+void SetSizes(benchmark::internal::Benchmark* b) {
+  for (const int64_t size : {1000, 10000, 100000, 1000000}) {
+    b->Arg(size);
+  }
+}
+
+void ArraySizes(benchmark::internal::Benchmark* b) {
+  b->Args({64, 64});
+  b->Args({1024, 1024});
+  b->Args({4096, 4096});
+  b->Args({64, 4096});
+}
+
+BENCHMARK(BM_HashSetUnion)->Apply(SetSizes);
+BENCHMARK(BM_BitmapUnion)->Apply(SetSizes);
+BENCHMARK(BM_HashSetIntersection)->Apply(SetSizes);
+BENCHMARK(BM_BitmapIntersection)->Apply(SetSizes);
+BENCHMARK(BM_HashSetDifference)->Apply(SetSizes);
+BENCHMARK(BM_BitmapDifference)->Apply(SetSizes);
+BENCHMARK(BM_StdSetIntersection)->Apply(ArraySizes);
+BENCHMARK(BM_IntersectSortedArrays)->Apply(ArraySizes);
+BENCHMARK(BM_StdSetDifference)->Apply(ArraySizes);
+BENCHMARK(BM_SubtractSortedArrays)->Apply(ArraySizes);
+
+}  // namespace
+}  // namespace kv_server
+
+BENCHMARK_MAIN();
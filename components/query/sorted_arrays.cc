@@ -0,0 +1,217 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/query/sorted_arrays.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <vector>
+
+#include "absl/numeric/bits.h"
+#include "absl/types/span.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace kv_server {
+namespace {
+
+// Number of ids compared at once by `MatchMask`.
+constexpr size_t kBlockSize = 8;
+
+// Combining arrays of very different sizes is faster by galloping through the
+// larger one than with a merge.
+constexpr size_t kGallopingRatio = 32;
+
+// Returns a mask with bit `k` set if `left[k]` is one of `right[0..8)`.
+uint32_t MatchMask(const uint16_t* left, const uint16_t* right) {
+#if defined(__SSE2__)
+  const __m128i l = _mm_loadu_si128(reinterpret_cast<const __m128i*>(left));
+  __m128i r = _mm_loadu_si128(reinterpret_cast<const __m128i*>(right));
+  __m128i matches = _mm_cmpeq_epi16(l, r);
+  // Compares against every rotation of `r`.
+  for (size_t i = 1; i < kBlockSize; i++) {
+    r = _mm_or_si128(_mm_srli_si128(r, 2), _mm_slli_si128(r, 14));
+    matches = _mm_or_si128(matches, _mm_cmpeq_epi16(l, r));
+  }
+  return _mm_movemask_epi8(_mm_packs_epi16(matches, _mm_setzero_si128()));
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+  static constexpr uint16_t kLaneBits[kBlockSize] = {1,  2,  4,  8,
+                                                     16, 32, 64, 128};
+  const uint16x8_t l = vld1q_u16(left);
+  uint16x8_t r = vld1q_u16(right);
+  uint16x8_t matches = vceqq_u16(l, r);
+  for (size_t i = 1; i < kBlockSize; i++) {
+    r = vextq_u16(r, r, 1);
+    matches = vorrq_u16(matches, vceqq_u16(l, r));
+  }
+  return vaddvq_u16(vandq_u16(matches, vld1q_u16(kLaneBits)));
+#else
+  uint32_t mask = 0;
+  for (size_t i = 0; i < kBlockSize; i++) {
+    for (size_t j = 0; j < kBlockSize; j++) {
+      if (left[i] == right[j]) {
+        mask |= 1 << i;
+      }
+    }
+  }
+  return mask;
+#endif
+}
+
+// Returns the index of the first id at or after `from` that is not less than
+// `id`, probing at exponentially growing distances before a binary search.
+size_t Gallop(absl::Span<const uint16_t> ids, size_t from, uint16_t id) {
+  size_t end = from;
+  size_t step = 1;
+  while (end < ids.size() && ids[end] < id) {
+    from = end + 1;
+    end += step;
+    step *= 2;
+  }
+  end = std::min(end, ids.size());
+  return std::lower_bound(ids.begin() + from, ids.begin() + end, id) -
+         ids.begin();
+}
+
+std::vector<uint16_t> GallopingIntersect(absl::Span<const uint16_t> small,
+                                         absl::Span<const uint16_t> large) {
+  std::vector<uint16_t> result;
+  result.reserve(small.size());
+  size_t index = 0;
+  for (const uint16_t id : small) {
+    index = Gallop(large, index, id);
+    if (index == large.size()) {
+      break;
+    }
+    if (large[index] == id) {
+      result.push_back(id);
+    }
+  }
+  return result;
+}
+
+}  // namespace
+
+std::vector<uint16_t> IntersectSortedArrays(absl::Span<const uint16_t> left,
+                                            absl::Span<const uint16_t> right) {
+  if (left.size() * kGallopingRatio < right.size()) {
+    return GallopingIntersect(left, right);
+  }
+  if (right.size() * kGallopingRatio < left.size()) {
+    return GallopingIntersect(right, left);
+  }
+  // Sized for the largest result and shrunk at the end, so that ids are
+  // written without checking the capacity.
+  std::vector<uint16_t> result(std::min(left.size(), right.size()));
+  size_t size = 0;
+  size_t i = 0;
+  size_t j = 0;
+  while (i + kBlockSize <= left.size() && j + kBlockSize <= right.size()) {
+    // Ids are distinct, so every id of the left block matches at most once
+    // over all right blocks, which come in ascending order.
+    for (uint32_t mask = MatchMask(&left[i], &right[j]); mask != 0;
+         mask &= mask - 1) {
+      result[size++] = left[i + absl::countr_zero(mask)];
+    }
+    const uint16_t left_max = left[i + kBlockSize - 1];
+    const uint16_t right_max = right[j + kBlockSize - 1];
+    if (left_max <= right_max) {
+      i += kBlockSize;
+    }
+    if (right_max <= left_max) {
+      j += kBlockSize;
+    }
+  }
+  while (i < left.size() && j < right.size()) {
+    if (left[i] < right[j]) {
+      i++;
+    } else if (right[j] < left[i]) {
+      j++;
+    } else {
+      result[size++] = left[i];
+      i++;
+      j++;
+    }
+  }
+  result.resize(size);
+  return result;
+}
+
+std::vector<uint16_t> UnionSortedArrays(absl::Span<const uint16_t> left,
+                                        absl::Span<const uint16_t> right) {
+  std::vector<uint16_t> result;
+  result.reserve(left.size() + right.size());
+  if (left.size() * kGallopingRatio < right.size() ||
+      right.size() * kGallopingRatio < left.size()) {
+    const auto small = left.size() < right.size() ? left : right;
+    const auto large = left.size() < right.size() ? right : left;
+    // Copies the runs of `large` between the ids of `small`.
+    size_t begin = 0;
+    for (const uint16_t id : small) {
+      size_t end = Gallop(large, begin, id);
+      result.insert(result.end(), large.begin() + begin, large.begin() + end);
+      result.push_back(id);
+      if (end < large.size() && large[end] == id) {
+        end++;
+      }
+      begin = end;
+    }
+    result.insert(result.end(), large.begin() + begin, large.end());
+    return result;
+  }
+  // Merging into a sorted output does not vectorize well without a sorting
+  // network, and large unions become bitmap containers instead.
+  std::set_union(left.begin(), left.end(), right.begin(), right.end(),
+                 std::back_inserter(result));
+  return result;
+}
+
+std::vector<uint16_t> SubtractSortedArrays(absl::Span<const uint16_t> left,
+                                           absl::Span<const uint16_t> right) {
+  std::vector<uint16_t> result;
+  result.reserve(left.size());
+  if (left.size() * kGallopingRatio < right.size()) {
+    size_t index = 0;
+    for (const uint16_t id : left) {
+      index = Gallop(right, index, id);
+      if (index == right.size() || right[index] != id) {
+        result.push_back(id);
+      }
+    }
+    return result;
+  }
+  if (right.size() * kGallopingRatio < left.size()) {
+    // Copies the runs of `left` between the removed ids.
+    size_t begin = 0;
+    for (const uint16_t id : right) {
+      const size_t end = Gallop(left, begin, id);
+      result.insert(result.end(), left.begin() + begin, left.begin() + end);
+      begin = end < left.size() && left[end] == id ? end + 1 : end;
+    }
+    result.insert(result.end(), left.begin() + begin, left.end());
+    return result;
+  }
+  // Comparing blocks is slower here than a merge, which needs to look at
+  // every id of `left` anyway.
+  std::set_difference(left.begin(), left.end(), right.begin(), right.end(),
+                      std::back_inserter(result));
+  return result;
+}
+
+}  // namespace kv_server
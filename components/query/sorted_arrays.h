@@ -0,0 +1,43 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef COMPONENTS_QUERY_SORTED_ARRAYS_H_
+#define COMPONENTS_QUERY_SORTED_ARRAYS_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "absl/types/span.h"
+
+namespace kv_server {
+
+// Set operations over sorted arrays of distinct 16 bit ids, as held by the
+// array containers of `RoaringBitmap`. The results are sorted too.
+//
+// Arrays of very different sizes are combined by galloping through the larger
+// one. Otherwise intersections compare blocks of 8 ids of each array at once,
+// with SSE2 on x86-64 and NEON on AArch64.
+std::vector<uint16_t> IntersectSortedArrays(absl::Span<const uint16_t> left,
+                                            absl::Span<const uint16_t> right);
+std::vector<uint16_t> UnionSortedArrays(absl::Span<const uint16_t> left,
+                                        absl::Span<const uint16_t> right);
+// Returns the ids of `left` that are not in `right`.
+std::vector<uint16_t> SubtractSortedArrays(absl::Span<const uint16_t> left,
+                                           absl::Span<const uint16_t> right);
+
+}  // namespace kv_server
+
+#endif  // COMPONENTS_QUERY_SORTED_ARRAYS_H_
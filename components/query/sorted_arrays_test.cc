@@ -0,0 +1,118 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/query/sorted_arrays.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <random>
+#include <set>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace kv_server {
+namespace {
+
+using testing::ElementsAre;
+using testing::IsEmpty;
+
+std::vector<uint16_t> RandomSortedIds(std::mt19937& gen, size_t count,
+                                      uint16_t max_id) {
+  std::uniform_int_distribution<uint16_t> dist(0, max_id);
+  std::set<uint16_t> ids;
+  while (ids.size() < count) {
+    ids.insert(dist(gen));
+  }
+  return std::vector<uint16_t>(ids.begin(), ids.end());
+}
+
+TEST(SortedArraysTest, EmptyArrays) {
+  const std::vector<uint16_t> empty;
+  const std::vector<uint16_t> ids = {1, 2, 3};
+  EXPECT_THAT(IntersectSortedArrays(empty, ids), IsEmpty());
+  EXPECT_THAT(IntersectSortedArrays(ids, empty), IsEmpty());
+  EXPECT_THAT(UnionSortedArrays(empty, ids), ElementsAre(1, 2, 3));
+  EXPECT_THAT(SubtractSortedArrays(ids, empty), ElementsAre(1, 2, 3));
+  EXPECT_THAT(SubtractSortedArrays(empty, ids), IsEmpty());
+}
+
+TEST(SortedArraysTest, MatchesAcrossBlocks) {
+  // 0 matches in the first pair of blocks, 17 and 18 only against the second
+  // right block, which both left blocks are compared with.
+  const std::vector<uint16_t> left = {0,  9,  10, 11, 12, 13, 14, 17,
+                                      18, 30, 31, 32, 33, 34, 35, 36};
+  const std::vector<uint16_t> right = {0,  1,  2,  3,  4,  5,  6,  7,
+                                       15, 16, 17, 18, 19, 20, 21, 22};
+  EXPECT_THAT(IntersectSortedArrays(left, right), ElementsAre(0, 17, 18));
+  EXPECT_THAT(
+      SubtractSortedArrays(left, right),
+      ElementsAre(9, 10, 11, 12, 13, 14, 30, 31, 32, 33, 34, 35, 36));
+}
+
+TEST(SortedArraysTest, LargestIds) {
+  const std::vector<uint16_t> left = {65528, 65529, 65530, 65531,
+                                      65532, 65533, 65534, 65535};
+  const std::vector<uint16_t> right = {1,     2,     3,     4,
+                                       65530, 65532, 65534, 65535};
+  EXPECT_THAT(IntersectSortedArrays(left, right),
+              ElementsAre(65530, 65532, 65534, 65535));
+  EXPECT_THAT(SubtractSortedArrays(left, right),
+              ElementsAre(65528, 65529, 65531, 65533));
+}
+
+struct SetOpCase {
+  size_t left_size;
+  size_t right_size;
+  uint16_t max_id;
+};
+
+class SortedArraysSetOpTest : public testing::TestWithParam<SetOpCase> {};
+
+TEST_P(SortedArraysSetOpTest, MatchesStdSetOps) {
+  std::mt19937 gen(42);
+  const SetOpCase& param = GetParam();
+  for (int round = 0; round < 20; round++) {
+    const auto left = RandomSortedIds(gen, param.left_size, param.max_id);
+    const auto right = RandomSortedIds(gen, param.right_size, param.max_id);
+
+    std::vector<uint16_t> expected;
+    std::set_intersection(left.begin(), left.end(), right.begin(),
+                          right.end(), std::back_inserter(expected));
+    EXPECT_EQ(IntersectSortedArrays(left, right), expected);
+
+    expected.clear();
+    std::set_union(left.begin(), left.end(), right.begin(), right.end(),
+                   std::back_inserter(expected));
+    EXPECT_EQ(UnionSortedArrays(left, right), expected);
+
+    expected.clear();
+    std::set_difference(left.begin(), left.end(), right.begin(), right.end(),
+                        std::back_inserter(expected));
+    EXPECT_EQ(SubtractSortedArrays(left, right), expected);
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    Sizes, SortedArraysSetOpTest,
+    testing::Values(SetOpCase{1, 1, 4}, SetOpCase{7, 9, 20},
+                    SetOpCase{13, 13, 30}, SetOpCase{100, 117, 300},
+                    SetOpCase{1000, 1200, 2500}, SetOpCase{500, 400, 60000},
+                    SetOpCase{3, 4000, 8000}, SetOpCase{4000, 3, 8000},
+                    SetOpCase{100, 3300, 65535}));
+
+}  // namespace
+}  // namespace kv_server
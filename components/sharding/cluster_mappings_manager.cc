@@ -19,6 +19,14 @@
 #include "components/errors/retry.h"
 
 namespace kv_server {
+namespace {
+// Least time between two updates. Calls to a replica that was replaced fail
+// until it is removed, and its instance may still be listed for a little
+// while, so the requested updates are throttled to not query the instance
+// metadata for each failed call.
+constexpr absl::Duration kMinTimeBetweenUpdates = absl::Milliseconds(200);
+}  // namespace
+
 ClusterMappingsManager::ClusterMappingsManager(
     std::string environment, int32_t num_shards,
     InstanceClient& instance_client, std::unique_ptr<SleepFor> sleep_for,
@@ -33,11 +41,16 @@ ClusterMappingsManager::ClusterMappingsManager(
 }
 
 absl::Status ClusterMappingsManager::Start(ShardManager& shard_manager) {
+  shard_manager.SetReplicaUnavailableCallback([this]() { RequestUpdate(); });
   return thread_manager_->Start(
       [this, &shard_manager]() { Watch(shard_manager); });
 }
 
 absl::Status ClusterMappingsManager::Stop() {
+  {
+    absl::MutexLock lock(&mutex_);
+    stopping_ = true;
+  }
   absl::Status status = sleep_for_->Stop();
   status.Update(thread_manager_->Stop());
   return status;
@@ -47,10 +60,25 @@ bool ClusterMappingsManager::IsRunning() const {
   return thread_manager_->IsRunning();
 }
 
+void ClusterMappingsManager::RequestUpdate() {
+  absl::MutexLock lock(&mutex_);
+  update_requested_ = true;
+}
+
+bool ClusterMappingsManager::WaitForUpdate() {
+  absl::MutexLock lock(&mutex_);
+  mutex_.AwaitWithTimeout(
+      absl::Condition(this, &ClusterMappingsManager::UpdateRequestedOrStopping),
+      absl::Milliseconds(update_interval_millis_));
+  update_requested_ = false;
+  return !stopping_;
+}
+
 void ClusterMappingsManager::Watch(ShardManager& shard_manager) {
-  while (!thread_manager_->ShouldStop()) {
-    sleep_for_->Duration(absl::Milliseconds(update_interval_millis_));
+  while (!thread_manager_->ShouldStop() && WaitForUpdate()) {
     shard_manager.InsertBatch(GetClusterMappings());
+    sleep_for_->Duration(kMinTimeBetweenUpdates);
   }
+  shard_manager.SetReplicaUnavailableCallback(nullptr);
 }
 }  // namespace kv_server
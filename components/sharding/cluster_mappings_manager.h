@@ -24,8 +24,10 @@
 #include <vector>
 
 #include "absl/container/flat_hash_map.h"
+#include "absl/base/thread_annotations.h"
 #include "absl/container/flat_hash_set.h"
 #include "absl/strings/str_format.h"
+#include "absl/synchronization/mutex.h"
 #include "components/cloud_config/instance_client.h"
 #include "components/data/common/thread_manager.h"
 #include "components/data_server/server/parameter_fetcher.h"
@@ -55,15 +57,28 @@ class ClusterMappingsManager {
   // {{0 -> {ip1, ip2}}, ....{num_shards-1}-> {ipN, ipN+1}}
   virtual std::vector<absl::flat_hash_set<std::string>>
   GetClusterMappings() = 0;
+  // Updates the mappings of the `shard_manager` every
+  // `update_interval_millis`, and right away when a call to one of its
+  // replicas fails as unavailable or `RequestUpdate` is called.
   absl::Status Start(ShardManager& shard_manager);
   absl::Status Stop();
   bool IsRunning() const;
+  // Wakes up the updater to refresh the mappings without waiting for the rest
+  // of the update interval, e.g. on an instance group change event. Requests
+  // made while an update is running are coalesced into the next one.
+  void RequestUpdate() ABSL_LOCKS_EXCLUDED(mutex_);
   static std::unique_ptr<ClusterMappingsManager> Create(
       std::string environment, int32_t num_shards,
       InstanceClient& instance_client, ParameterFetcher& parameter_fetcher);
 
  protected:
   void Watch(ShardManager& shard_manager);
+  // Waits until the update interval elapses, an update is requested or the
+  // updater is stopped. Returns false if it is stopped.
+  bool WaitForUpdate() ABSL_LOCKS_EXCLUDED(mutex_);
+  bool UpdateRequestedOrStopping() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+    return update_requested_ || stopping_;
+  }
 
   std::string environment_;
   int32_t num_shards_;
@@ -71,6 +86,9 @@ class ClusterMappingsManager {
   std::unique_ptr<ThreadManager> thread_manager_;
   std::unique_ptr<SleepFor> sleep_for_;
   int32_t update_interval_millis_;
+  mutable absl::Mutex mutex_;
+  bool update_requested_ ABSL_GUARDED_BY(mutex_) = false;
+  bool stopping_ ABSL_GUARDED_BY(mutex_) = false;
 };
 
 }  // namespace kv_server
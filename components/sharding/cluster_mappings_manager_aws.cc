@@ -26,7 +26,8 @@ class AwsClusterMappingsManager : public ClusterMappingsManager {
       std::unique_ptr<SleepFor> sleep_for = std::make_unique<SleepFor>(),
       int32_t update_interval_millis = 1000)
       : ClusterMappingsManager(std::move(environment), num_shards,
-                               instance_client),
+                               instance_client, std::move(sleep_for),
+                               update_interval_millis),
         asg_regex_{std::regex(absl::StrCat("kv-server-", environment_,
                                            R"(-(\d+)-instance-asg)"))} {}
 
@@ -0,0 +1,119 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "components/sharding/cluster_mappings_manager.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/synchronization/notification.h"
+#include "components/data_server/server/mocks.h"
+#include "components/internal_server/mocks.h"
+#include "components/sharding/mocks.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace kv_server {
+namespace {
+
+using testing::Return;
+
+// Long enough for the tests to only see the updates they request.
+constexpr int32_t kUpdateIntervalMillis = 60 * 60 * 1000;
+
+class FakeClusterMappingsManager : public ClusterMappingsManager {
+ public:
+  explicit FakeClusterMappingsManager(InstanceClient& instance_client)
+      : ClusterMappingsManager("testenv", /*num_shards=*/2, instance_client,
+                               std::make_unique<SleepFor>(),
+                               kUpdateIntervalMillis) {}
+
+  std::vector<absl::flat_hash_set<std::string>> GetClusterMappings() override {
+    updated_.Notify();
+    return {{"new_ip"}, {"some_ip"}};
+  }
+
+  absl::Notification& updated() { return updated_; }
+
+ private:
+  absl::Notification updated_;
+};
+
+class ClusterMappingsManagerTest : public ::testing::Test {
+ protected:
+  ClusterMappingsManagerTest() {
+    InitMetricsContextMap();
+    scope_metrics_context_ = std::make_unique<ScopeMetricsContext>();
+    request_context_ =
+        std::make_unique<RequestContext>(*scope_metrics_context_);
+  }
+
+  void SetUp() override {
+    auto shard_manager = ShardManager::Create(
+        /*num_shards=*/2, {{"old_ip"}, {"some_ip"}},
+        std::make_unique<testing::NiceMock<MockRandomGenerator>>(),
+        [](const std::string& ip) {
+          auto client =
+              std::make_unique<testing::NiceMock<MockRemoteLookupClient>>();
+          ON_CALL(*client, GetIpAddress).WillByDefault(Return(ip));
+          if (ip == "old_ip") {
+            ON_CALL(*client, GetValues)
+                .WillByDefault(Return(absl::UnavailableError("Unavailable")));
+          }
+          return client;
+        });
+    ASSERT_TRUE(shard_manager.ok());
+    shard_manager_ = std::move(*shard_manager);
+  }
+
+  MockInstanceClient instance_client_;
+  std::unique_ptr<ScopeMetricsContext> scope_metrics_context_;
+  std::unique_ptr<RequestContext> request_context_;
+  std::unique_ptr<ShardManager> shard_manager_;
+};
+
+TEST_F(ClusterMappingsManagerTest, UpdatesMappingsOnRequest) {
+  FakeClusterMappingsManager mgr(instance_client_);
+  ASSERT_TRUE(mgr.Start(*shard_manager_).ok());
+  mgr.RequestUpdate();
+  mgr.updated().WaitForNotification();
+  ASSERT_TRUE(mgr.Stop().ok());
+  EXPECT_EQ(shard_manager_->Get(0)->GetIpAddress(), "new_ip");
+}
+
+TEST_F(ClusterMappingsManagerTest, UpdatesMappingsWhenReplicaIsUnavailable) {
+  FakeClusterMappingsManager mgr(instance_client_);
+  ASSERT_TRUE(mgr.Start(*shard_manager_).ok());
+  RemoteLookupClient* client = shard_manager_->Get(0);
+  ASSERT_NE(client, nullptr);
+  EXPECT_FALSE(client->GetValues(*request_context_, "", 0).ok());
+  mgr.updated().WaitForNotification();
+  ASSERT_TRUE(mgr.Stop().ok());
+  EXPECT_EQ(shard_manager_->Get(0)->GetIpAddress(), "new_ip");
+}
+
+TEST_F(ClusterMappingsManagerTest, StopsWithoutUpdating) {
+  FakeClusterMappingsManager mgr(instance_client_);
+  ASSERT_TRUE(mgr.Start(*shard_manager_).ok());
+  ASSERT_TRUE(mgr.Stop().ok());
+  EXPECT_FALSE(mgr.IsRunning());
+  EXPECT_FALSE(mgr.updated().HasBeenNotified());
+  EXPECT_EQ(shard_manager_->Get(0)->GetIpAddress(), "old_ip");
+}
+
+}  // namespace
+}  // namespace kv_server
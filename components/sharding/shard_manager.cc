@@ -13,19 +13,28 @@
 // limitations under the License.
 #include "components/sharding/shard_manager.h"
 
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <functional>
 #include <iterator>
 #include <map>
 #include <memory>
 #include <optional>
 #include <random>
 #include <set>
+#include <string_view>
 #include <utility>
 #include <vector>
 
 #include "absl/base/thread_annotations.h"
 #include "absl/container/flat_hash_map.h"
+#include "absl/status/status.h"
 #include "absl/strings/str_format.h"
 #include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "components/util/lock_profiler.h"
 
 namespace kv_server {
 namespace {
@@ -44,6 +53,143 @@ class RandomGeneratorImpl : public RandomGenerator {
   std::mt19937 generator_;
 };
 
+// Time constant of the decay of the latency average of a replica.
+constexpr absl::Duration kLatencyDecayTime = absl::Seconds(10);
+// Latency recorded for failed calls, so that replicas that fail fast are
+// avoided rather than preferred.
+constexpr absl::Duration kFailureLatencyPenalty = absl::Seconds(1);
+
+// Wraps the client of a replica to track its load: the number of in-flight
+// calls and a moving average of the call latency. The average follows
+// latency spikes right away and otherwise decays exponentially with time, so
+// that a replica that stopped getting calls because it was slow is
+// eventually tried again.
+class LoadTrackingRemoteLookupClient : public RemoteLookupClient {
+ public:
+  LoadTrackingRemoteLookupClient(std::unique_ptr<RemoteLookupClient> client,
+                                 std::function<void()> on_unavailable)
+      : client_(std::move(client)),
+        on_unavailable_(std::move(on_unavailable)) {}
+
+  absl::StatusOr<InternalLookupResponse> GetValues(
+      const RequestContext& request_context,
+      std::string_view serialized_message,
+      int32_t padding_length) const override {
+    return Track([&]() {
+      return client_->GetValues(request_context, serialized_message,
+                                padding_length);
+    });
+  }
+
+  absl::StatusOr<InternalLookupResponse> GetValues(
+      const RequestContext& request_context,
+      std::string_view serialized_message, int32_t padding_length,
+      grpc::ClientContext& context) const override {
+    return Track([&]() {
+      return client_->GetValues(request_context, serialized_message,
+                                padding_length, context);
+    });
+  }
+
+  void GetValuesAsync(const RequestContext& request_context,
+                      std::string_view serialized_message,
+                      int32_t padding_length, grpc::ClientContext& context,
+                      GetValuesCallback done) const override {
+    in_flight_.fetch_add(1, std::memory_order_relaxed);
+    const absl::Time start = absl::Now();
+    client_->GetValuesAsync(
+        request_context, serialized_message, padding_length, context,
+        [this, start, done = std::move(done)](
+            absl::StatusOr<InternalLookupResponse> response) mutable {
+          Finish(start, response);
+          std::move(done)(std::move(response));
+        });
+  }
+
+  absl::StatusOr<ShardKeyFilter> GetKeyFilter(
+      absl::Duration timeout) const override {
+    return client_->GetKeyFilter(timeout);
+  }
+
+  std::string_view GetIpAddress() const override {
+    return client_->GetIpAddress();
+  }
+
+  // Returns the expected latency of a new call in microseconds, scaled by the
+  // number of calls it would queue behind, and then the number of in-flight
+  // calls to break ties between replicas without latency samples.
+  std::pair<double, int64_t> Load(absl::Time now) const
+      ABSL_LOCKS_EXCLUDED(mutex_) {
+    const int64_t in_flight = in_flight_.load(std::memory_order_relaxed);
+    ProfiledMutexLock lock(&mutex_, LockSite::kShardManager);
+    return {DecayedLatency(now) * (in_flight + 1), in_flight};
+  }
+
+ private:
+  template <typename Call>
+  absl::StatusOr<InternalLookupResponse> Track(Call call) const {
+    in_flight_.fetch_add(1, std::memory_order_relaxed);
+    const absl::Time start = absl::Now();
+    absl::StatusOr<InternalLookupResponse> response = call();
+    Finish(start, response);
+    return response;
+  }
+
+  void Finish(absl::Time start,
+              const absl::StatusOr<InternalLookupResponse>& response) const {
+    const absl::Time end = absl::Now();
+    in_flight_.fetch_sub(1, std::memory_order_relaxed);
+    absl::Duration latency = end - start;
+    // Cancelled calls are the losers of hedged lookups, which were slow but
+    // not failing.
+    if (!response.ok() && !absl::IsCancelled(response.status())) {
+      latency = std::max(latency, kFailureLatencyPenalty);
+    }
+    Record(end, absl::ToDoubleMicroseconds(latency));
+    if (absl::IsUnavailable(response.status())) {
+      on_unavailable_();
+    }
+  }
+
+  void Record(absl::Time now, double latency) const
+      ABSL_LOCKS_EXCLUDED(mutex_) {
+    ProfiledMutexLock lock(&mutex_, LockSite::kShardManager);
+    const double decayed_latency = DecayedLatency(now);
+    if (latency > decayed_latency) {
+      average_latency_ = latency;
+    } else {
+      // Weighs the sample by the time since the previous one, as in
+      // `DecayedLatency`.
+      average_latency_ = decayed_latency + latency * (1 - Decay(now));
+    }
+    last_update_ = std::max(last_update_, now);
+  }
+
+  double Decay(absl::Time now) const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+    const absl::Duration elapsed =
+        std::max(now - last_update_, absl::ZeroDuration());
+    return std::exp(-absl::FDivDuration(elapsed, kLatencyDecayTime));
+  }
+
+  double DecayedLatency(absl::Time now) const
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+    return average_latency_ * Decay(now);
+  }
+
+  std::unique_ptr<RemoteLookupClient> client_;
+  std::function<void()> on_unavailable_;
+  mutable std::atomic<int64_t> in_flight_ = 0;
+  mutable absl::Mutex mutex_;
+  // In microseconds.
+  mutable double average_latency_ ABSL_GUARDED_BY(mutex_) = 0;
+  mutable absl::Time last_update_ ABSL_GUARDED_BY(mutex_) =
+      absl::InfinitePast();
+};
+
+// Clients of removed replicas are destroyed after this long, so that the
+// lookups that got them from `Get` before the removal can finish.
+constexpr absl::Duration kRemovedClientGracePeriod = absl::Minutes(1);
+
 class ShardManagerImpl : public ShardManager {
  public:
   ShardManagerImpl(
@@ -55,56 +201,158 @@ class ShardManagerImpl : public ShardManager {
         client_factory_{client_factory},
         random_generator_{std::move(random_generator)} {}
 
-  // taking in a set to exclude duplicates.
-  // set doesn't have an O(1) lookup --> converting to vector.
+  // Only creates clients for the replicas that were added, or whose client
+  // could not be created before, and keeps the clients, and so the
+  // connections, of the others. The new mapping is swapped in at once, so
+  // `Get` never waits for it.
   void InsertBatch(const std::vector<absl::flat_hash_set<std::string>>&
                        cluster_mappings) override {
     if (cluster_mappings.size() != num_shards_) {
       return;
     }
-    std::vector<std::vector<std::string>> cluster_mappings_vector;
-    absl::MutexLock lock(&mutex_);
-    for (const auto& si : cluster_mappings) {
-      std::vector<std::string> vc(si.begin(), si.end());
-      for (const auto& ip : vc) {
-        const auto key_iter = remote_lookup_clients_.find(ip);
-        if (key_iter != remote_lookup_clients_.end()) {
-          continue;
+    absl::MutexLock lock(&insert_mutex_);
+    const std::shared_ptr<const Replicas> current =
+        std::atomic_load(&replicas_);
+    auto next = std::make_shared<Replicas>();
+    bool changed = current == nullptr;
+    for (const auto& shard_ips : cluster_mappings) {
+      std::vector<LoadTrackingRemoteLookupClient*>& shard_clients =
+          next->shards.emplace_back();
+      for (const auto& ip : shard_ips) {
+        std::shared_ptr<LoadTrackingRemoteLookupClient>& client =
+            next->clients[ip];
+        if (client == nullptr && current != nullptr) {
+          if (const auto it = current->clients.find(ip);
+              it != current->clients.end()) {
+            client = it->second;
+          }
+        }
+        if (client == nullptr) {
+          std::unique_ptr<RemoteLookupClient> remote_client =
+              client_factory_(ip);
+          if (remote_client != nullptr) {
+            client = std::make_shared<LoadTrackingRemoteLookupClient>(
+                std::move(remote_client),
+                [this]() { OnReplicaUnavailable(); });
+            changed = true;
+          }
+        }
+        shard_clients.push_back(client.get());
+      }
+    }
+    const absl::Time now = absl::Now();
+    if (current != nullptr) {
+      changed = changed || current->shards != next->shards;
+      for (const auto& [ip, client] : current->clients) {
+        if (client != nullptr && !next->clients.contains(ip)) {
+          removed_clients_.push_back({now, client});
+          changed = true;
         }
-        remote_lookup_clients_.insert({ip, client_factory_(ip)});
       }
-      cluster_mappings_vector.emplace_back(std::move(vc));
     }
-    cluster_mappings_ = cluster_mappings_vector;
+    removed_clients_.erase(
+        std::remove_if(removed_clients_.begin(), removed_clients_.end(),
+                       [now](const RemovedClient& removed) {
+                         return now - removed.removal_time >=
+                                kRemovedClientGracePeriod;
+                       }),
+        removed_clients_.end());
+    if (changed) {
+      std::atomic_store(&replicas_,
+                        std::shared_ptr<const Replicas>(std::move(next)));
+    }
   }
 
   RemoteLookupClient* Get(int64_t shard_num) const override {
-    absl::ReaderMutexLock lock(&mutex_);
-    if (shard_num < 0 || shard_num >= num_shards_ ||
-        cluster_mappings_.size() != num_shards_) {
+    const std::shared_ptr<const Replicas> replicas =
+        std::atomic_load(&replicas_);
+    if (shard_num < 0 || shard_num >= num_shards_ || replicas == nullptr) {
       return nullptr;
     }
-    const auto& shard_replicas = cluster_mappings_[shard_num];
+    const auto& shard_replicas = replicas->shards[shard_num];
     if (shard_replicas.size() == 0) {
       return nullptr;
     }
     const auto replica_idx = random_generator_->Get(shard_replicas.size());
-    const auto& ip_address = shard_replicas[replica_idx];
-    const auto key_iter = remote_lookup_clients_.find(ip_address);
-    if (key_iter == remote_lookup_clients_.end()) {
+    LoadTrackingRemoteLookupClient* client = shard_replicas[replica_idx];
+    if (client == nullptr || shard_replicas.size() == 1) {
+      return client;
+    }
+    // Power of two choices: picks the less loaded of two random replicas,
+    // which avoids slow or failing replicas without sending all the calls to
+    // the least loaded one. Keeps the first, random, replica if they are
+    // equally loaded, e.g. when neither has been called yet.
+    int64_t other_idx = 1 - replica_idx;
+    if (shard_replicas.size() > 2) {
+      other_idx = random_generator_->Get(shard_replicas.size() - 1);
+      if (other_idx >= replica_idx) {
+        other_idx++;
+      }
+    }
+    LoadTrackingRemoteLookupClient* other = shard_replicas[other_idx];
+    if (other == nullptr) {
+      return client;
+    }
+    const absl::Time now = absl::Now();
+    return other->Load(now) < client->Load(now) ? other : client;
+  }
+
+  RemoteLookupClient* GetOtherReplica(
+      int64_t shard_num, const RemoteLookupClient& excluded) const override {
+    const std::shared_ptr<const Replicas> replicas =
+        std::atomic_load(&replicas_);
+    if (shard_num < 0 || shard_num >= num_shards_ || replicas == nullptr) {
+      return nullptr;
+    }
+    std::vector<RemoteLookupClient*> other_replicas;
+    for (LoadTrackingRemoteLookupClient* client : replicas->shards[shard_num]) {
+      if (client != nullptr && client != &excluded) {
+        other_replicas.push_back(client);
+      }
+    }
+    if (other_replicas.empty()) {
       return nullptr;
-    } else {
-      return key_iter->second.get();
     }
+    return other_replicas[random_generator_->Get(other_replicas.size())];
+  }
+
+  void SetReplicaUnavailableCallback(std::function<void()> callback) override {
+    absl::MutexLock lock(&callback_mutex_);
+    replica_unavailable_callback_ = std::move(callback);
   }
 
  private:
-  mutable absl::Mutex mutex_;
-  // (idx) shard id -> set of ip_addresses
-  std::vector<std::vector<std::string>> cluster_mappings_
-      ABSL_GUARDED_BY(mutex_);
-  absl::flat_hash_map<std::string, std::unique_ptr<RemoteLookupClient>>
-      remote_lookup_clients_ ABSL_GUARDED_BY(mutex_);
+  void OnReplicaUnavailable() const {
+    absl::MutexLock lock(&callback_mutex_);
+    if (replica_unavailable_callback_) {
+      replica_unavailable_callback_();
+    }
+  }
+
+  // Immutable snapshot of the replicas of the shards.
+  struct Replicas {
+    // (idx) shard id -> clients of the replicas, null if their client could
+    // not be created.
+    std::vector<std::vector<LoadTrackingRemoteLookupClient*>> shards;
+    // ip address -> client.
+    absl::flat_hash_map<std::string,
+                        std::shared_ptr<LoadTrackingRemoteLookupClient>>
+        clients;
+  };
+
+  struct RemovedClient {
+    absl::Time removal_time;
+    std::shared_ptr<LoadTrackingRemoteLookupClient> client;
+  };
+
+  // Serializes `InsertBatch` calls.
+  absl::Mutex insert_mutex_;
+  // Only accessed with `std::atomic_load` and `std::atomic_store`.
+  std::shared_ptr<const Replicas> replicas_;
+  std::vector<RemovedClient> removed_clients_ ABSL_GUARDED_BY(insert_mutex_);
+  mutable absl::Mutex callback_mutex_;
+  std::function<void()> replica_unavailable_callback_
+      ABSL_GUARDED_BY(callback_mutex_);
   int32_t num_shards_;
   std::function<std::unique_ptr<RemoteLookupClient>(const std::string& ip)>
       client_factory_;
@@ -140,15 +388,17 @@ absl::StatusOr<std::unique_ptr<ShardManager>> ShardManager::Create(
     int32_t num_shards,
     privacy_sandbox::server_common::KeyFetcherManagerInterface&
         key_fetcher_manager,
-    const std::vector<absl::flat_hash_set<std::string>>& cluster_mappings) {
+    const std::vector<absl::flat_hash_set<std::string>>& cluster_mappings,
+    const RemoteLookupChannelOptions& channel_options) {
   auto validationStatus = ValidateMapping(num_shards, cluster_mappings);
   if (!validationStatus.ok()) {
     return validationStatus;
   }
   auto shard_manager = std::make_unique<ShardManagerImpl>(
       cluster_mappings.size(),
-      [&key_fetcher_manager](const std::string& ip) {
-        return RemoteLookupClient::Create(ip, key_fetcher_manager);
+      [&key_fetcher_manager, channel_options](const std::string& ip) {
+        return RemoteLookupClient::Create(ip, key_fetcher_manager,
+                                          channel_options);
       },
       std::make_unique<RandomGeneratorImpl>());
   shard_manager->InsertBatch(std::move(cluster_mappings));
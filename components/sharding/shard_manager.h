@@ -17,6 +17,7 @@
 #ifndef COMPONENTS_SHARDING_SHARD_MANAGER_H_
 #define COMPONENTS_SHARDING_SHARD_MANAGER_H_
 
+#include <functional>
 #include <memory>
 #include <optional>
 #include <set>
@@ -37,24 +38,41 @@ class RandomGenerator {
 
 // This class allows communication between a UDF server and data servers.
 // A mapping from a shard number to a set of ip addresses should be inserted
-// periodically. The class allows to retreive a RemoteLookupClient assigned to a
-// random ip address from the provided pool. ShardManager is thread safe.
+// periodically. The class allows to retreive a RemoteLookupClient assigned to an
+// ip address from the provided pool. `Get` picks the less loaded of two random
+// replicas, based on the latency and the number of in-flight calls of the
+// clients it returned. ShardManager is thread safe.
 class ShardManager {
  public:
   virtual ~ShardManager() = default;
   // Insert the mapping of { shard number -> corresponding replicas' ip
   // adresseses }. An index of the vector is the shard number. The length of the
-  // vector must be equal to the `num_shards`.
+  // vector must be equal to the `num_shards`. Clients of replicas that are in
+  // the current mapping are kept; clients of removed replicas stay valid for a
+  // grace period, so that callers of `Get` can finish their calls.
   virtual void InsertBatch(const std::vector<absl::flat_hash_set<std::string>>&
                                cluster_mappings) = 0;
   // Given the shard number, get a remote lookup client for one of the replicas
-  // in the pool.
+  // in the pool, preferring replicas that are fast and not busy.
   virtual RemoteLookupClient* Get(int64_t shard_num) const = 0;
+  // Given the shard number, get a remote lookup client for one of the replicas
+  // in the pool other than the one of `excluded`. Returns nullptr if the shard
+  // has no other replica.
+  virtual RemoteLookupClient* GetOtherReplica(
+      int64_t shard_num, const RemoteLookupClient& excluded) const = 0;
+  // Sets the function called when a call to a replica fails as unavailable,
+  // e.g. because the replica was replaced, so that the mapping can be
+  // refreshed right away. Replaces the previous one; an empty function
+  // removes it. Once this returns, the previous function is no longer called.
+  virtual void SetReplicaUnavailableCallback(
+      std::function<void()> callback) = 0;
   static absl::StatusOr<std::unique_ptr<ShardManager>> Create(
       int32_t num_shards,
       privacy_sandbox::server_common::KeyFetcherManagerInterface&
           key_fetcher_manager,
-      const std::vector<absl::flat_hash_set<std::string>>& cluster_mappings);
+      const std::vector<absl::flat_hash_set<std::string>>& cluster_mappings,
+      const RemoteLookupChannelOptions& channel_options =
+          RemoteLookupChannelOptions());
   static absl::StatusOr<std::unique_ptr<ShardManager>> Create(
       int32_t num_shards,
       const std::vector<absl::flat_hash_set<std::string>>& cluster_mappings,
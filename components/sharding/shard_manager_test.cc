@@ -14,11 +14,15 @@
 
 #include "components/sharding/shard_manager.h"
 
+#include <memory>
+#include <optional>
 #include <string>
+#include <string_view>
 #include <utility>
 #include <vector>
 
 #include "components/internal_server/constants.h"
+#include "components/internal_server/mocks.h"
 #include "components/sharding/mocks.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
@@ -28,10 +32,42 @@ namespace kv_server {
 namespace {
 
 using privacy_sandbox::server_common::FakeKeyFetcherManager;
+using testing::Return;
+
+constexpr std::string_view kGoodIp = "good_ip";
+constexpr std::string_view kFailingIp = "failing_ip";
+
+// Completes asynchronous calls only when the test runs their callbacks.
+class DeferredRemoteLookupClient : public RemoteLookupClient {
+ public:
+  absl::StatusOr<InternalLookupResponse> GetValues(
+      const RequestContext& request_context,
+      std::string_view serialized_message,
+      int32_t padding_length) const override {
+    return absl::InternalError("Unexpected synchronous call");
+  }
+  void GetValuesAsync(const RequestContext& request_context,
+                      std::string_view serialized_message,
+                      int32_t padding_length, grpc::ClientContext& context,
+                      GetValuesCallback done) const override {
+    pending_calls.push_back(std::move(done));
+  }
+  std::string_view GetIpAddress() const override { return kGoodIp; }
+
+  mutable std::vector<GetValuesCallback> pending_calls;
+};
 
 class ShardManagerTest : public ::testing::Test {
  protected:
+  ShardManagerTest() {
+    InitMetricsContextMap();
+    scope_metrics_context_ = std::make_unique<ScopeMetricsContext>();
+    request_context_ =
+        std::make_unique<RequestContext>(*scope_metrics_context_);
+  }
   FakeKeyFetcherManager fake_key_fetcher_manager_;
+  std::unique_ptr<ScopeMetricsContext> scope_metrics_context_;
+  std::unique_ptr<RequestContext> request_context_;
 };
 
 TEST_F(ShardManagerTest, CreationNotInitialized) {
@@ -134,5 +170,232 @@ TEST_F(ShardManagerTest, InsertRetrieveTwoVersions) {
   EXPECT_EQ(etalon, result);
 }
 
+TEST_F(ShardManagerTest, GetOtherReplica) {
+  std::vector<absl::flat_hash_set<std::string>> cluster_mappings;
+  cluster_mappings.push_back({"some_ip_1", "some_ip_2"});
+  for (int i = 0; i < 3; i++) {
+    cluster_mappings.push_back({"some_ip_3"});
+  }
+  auto shard_manager = ShardManager::Create(4, fake_key_fetcher_manager_,
+                                            std::move(cluster_mappings));
+  ASSERT_TRUE(shard_manager.ok());
+  for (int i = 0; i < 10; i++) {
+    RemoteLookupClient* client = (*shard_manager)->Get(0);
+    ASSERT_NE(client, nullptr);
+    RemoteLookupClient* other = (*shard_manager)->GetOtherReplica(0, *client);
+    ASSERT_NE(other, nullptr);
+    EXPECT_NE(client->GetIpAddress(), other->GetIpAddress());
+  }
+  RemoteLookupClient* client = (*shard_manager)->Get(1);
+  ASSERT_NE(client, nullptr);
+  EXPECT_EQ((*shard_manager)->GetOtherReplica(1, *client), nullptr);
+}
+
+TEST_F(ShardManagerTest, GetAvoidsFailingReplica) {
+  std::vector<absl::flat_hash_set<std::string>> cluster_mappings;
+  cluster_mappings.push_back({std::string(kGoodIp), std::string(kFailingIp)});
+  for (int i = 0; i < 3; i++) {
+    cluster_mappings.push_back({"some_ip"});
+  }
+  auto random_generator =
+      std::make_unique<testing::NiceMock<MockRandomGenerator>>();
+  ON_CALL(*random_generator, Get).WillByDefault(Return(0));
+  auto client_factory = [](const std::string& ip) {
+    auto client =
+        std::make_unique<testing::NiceMock<MockRemoteLookupClient>>();
+    if (ip == kFailingIp) {
+      ON_CALL(*client, GetIpAddress).WillByDefault(Return(kFailingIp));
+      ON_CALL(*client, GetValues)
+          .WillByDefault(Return(absl::UnavailableError("Unavailable")));
+    } else {
+      ON_CALL(*client, GetIpAddress).WillByDefault(Return(kGoodIp));
+      ON_CALL(*client, GetValues)
+          .WillByDefault(Return(InternalLookupResponse()));
+    }
+    return client;
+  };
+  auto shard_manager =
+      ShardManager::Create(4, std::move(cluster_mappings),
+                           std::move(random_generator), client_factory);
+  ASSERT_TRUE(shard_manager.ok());
+  // Replicas that have not been called yet are preferred, so both get
+  // called once.
+  for (int i = 0; i < 2; i++) {
+    (*shard_manager)->Get(0)->GetValues(*request_context_, "", 0).IgnoreError();
+  }
+  for (int i = 0; i < 10; i++) {
+    RemoteLookupClient* client = (*shard_manager)->Get(0);
+    ASSERT_NE(client, nullptr);
+    EXPECT_EQ(client->GetIpAddress(), kGoodIp);
+    EXPECT_TRUE(client->GetValues(*request_context_, "", 0).ok());
+  }
+}
+
+TEST_F(ShardManagerTest, CallsReplicaUnavailableCallback) {
+  std::vector<absl::flat_hash_set<std::string>> cluster_mappings;
+  cluster_mappings.push_back({std::string(kFailingIp)});
+  cluster_mappings.push_back({std::string(kGoodIp)});
+  auto random_generator =
+      std::make_unique<testing::NiceMock<MockRandomGenerator>>();
+  auto client_factory = [](const std::string& ip) {
+    auto client =
+        std::make_unique<testing::NiceMock<MockRemoteLookupClient>>();
+    if (ip == kFailingIp) {
+      ON_CALL(*client, GetValues)
+          .WillByDefault(Return(absl::UnavailableError("Unavailable")));
+    } else {
+      ON_CALL(*client, GetValues)
+          .WillByDefault(Return(absl::InvalidArgumentError("Invalid")));
+    }
+    return client;
+  };
+  auto shard_manager =
+      ShardManager::Create(2, std::move(cluster_mappings),
+                           std::move(random_generator), client_factory);
+  ASSERT_TRUE(shard_manager.ok());
+  int unavailable_calls = 0;
+  (*shard_manager)->SetReplicaUnavailableCallback([&unavailable_calls]() {
+    unavailable_calls++;
+  });
+  EXPECT_FALSE(
+      (*shard_manager)->Get(1)->GetValues(*request_context_, "", 0).ok());
+  EXPECT_EQ(unavailable_calls, 0);
+  EXPECT_FALSE(
+      (*shard_manager)->Get(0)->GetValues(*request_context_, "", 0).ok());
+  EXPECT_EQ(unavailable_calls, 1);
+  (*shard_manager)->SetReplicaUnavailableCallback(nullptr);
+  EXPECT_FALSE(
+      (*shard_manager)->Get(0)->GetValues(*request_context_, "", 0).ok());
+  EXPECT_EQ(unavailable_calls, 1);
+}
+
+TEST_F(ShardManagerTest, InsertBatchKeepsClientsOfUnchangedReplicas) {
+  std::vector<absl::flat_hash_set<std::string>> cluster_mappings;
+  cluster_mappings.push_back({"some_ip_1"});
+  cluster_mappings.push_back({"some_ip_2"});
+  std::vector<std::string> created_clients;
+  auto client_factory = [&created_clients](const std::string& ip) {
+    created_clients.push_back(ip);
+    auto client =
+        std::make_unique<testing::NiceMock<MockRemoteLookupClient>>();
+    ON_CALL(*client, GetIpAddress).WillByDefault(Return(ip));
+    return client;
+  };
+  auto shard_manager = ShardManager::Create(
+      2, cluster_mappings,
+      std::make_unique<testing::NiceMock<MockRandomGenerator>>(),
+      client_factory);
+  ASSERT_TRUE(shard_manager.ok());
+  RemoteLookupClient* client = (*shard_manager)->Get(0);
+  ASSERT_NE(client, nullptr);
+  (*shard_manager)->InsertBatch(cluster_mappings);
+  EXPECT_EQ((*shard_manager)->Get(0), client);
+  // Replaces the replica of shard 1 only.
+  cluster_mappings[1] = {"some_ip_3"};
+  (*shard_manager)->InsertBatch(cluster_mappings);
+  EXPECT_EQ((*shard_manager)->Get(0), client);
+  ASSERT_NE((*shard_manager)->Get(1), nullptr);
+  EXPECT_EQ((*shard_manager)->Get(1)->GetIpAddress(), "some_ip_3");
+  EXPECT_THAT(created_clients,
+              testing::ElementsAre("some_ip_1", "some_ip_2", "some_ip_3"));
+}
+
+TEST_F(ShardManagerTest, InsertBatchRetriesFailedClients) {
+  std::vector<absl::flat_hash_set<std::string>> cluster_mappings;
+  cluster_mappings.push_back({"some_ip_1"});
+  cluster_mappings.push_back({"some_ip_2"});
+  bool fail = true;
+  auto client_factory =
+      [&fail](const std::string& ip) -> std::unique_ptr<RemoteLookupClient> {
+    if (fail) {
+      return nullptr;
+    }
+    return std::make_unique<testing::NiceMock<MockRemoteLookupClient>>();
+  };
+  auto shard_manager = ShardManager::Create(
+      2, cluster_mappings,
+      std::make_unique<testing::NiceMock<MockRandomGenerator>>(),
+      client_factory);
+  ASSERT_TRUE(shard_manager.ok());
+  EXPECT_EQ((*shard_manager)->Get(0), nullptr);
+  fail = false;
+  (*shard_manager)->InsertBatch(cluster_mappings);
+  EXPECT_NE((*shard_manager)->Get(0), nullptr);
+}
+
+TEST_F(ShardManagerTest, ReplicasWithoutClientAreUnavailable) {
+  std::vector<absl::flat_hash_set<std::string>> cluster_mappings;
+  cluster_mappings.push_back({std::string(kGoodIp), std::string(kFailingIp)});
+  cluster_mappings.push_back({std::string(kFailingIp)});
+  auto random_generator =
+      std::make_unique<testing::NiceMock<MockRandomGenerator>>();
+  MockRandomGenerator* random_generator_ptr = random_generator.get();
+  auto client_factory =
+      [](const std::string& ip) -> std::unique_ptr<RemoteLookupClient> {
+    if (ip == kFailingIp) {
+      return nullptr;
+    }
+    auto client =
+        std::make_unique<testing::NiceMock<MockRemoteLookupClient>>();
+    ON_CALL(*client, GetIpAddress).WillByDefault(Return(kGoodIp));
+    ON_CALL(*client, GetValues).WillByDefault(Return(InternalLookupResponse()));
+    return client;
+  };
+  auto shard_manager =
+      ShardManager::Create(2, std::move(cluster_mappings),
+                           std::move(random_generator), client_factory);
+  ASSERT_TRUE(shard_manager.ok());
+  EXPECT_EQ((*shard_manager)->Get(1), nullptr);
+  // Whichever replica is drawn first, a null client is returned as null and
+  // never wrapped.
+  int good_replica_picks = 0;
+  for (int64_t replica = 0; replica < 2; replica++) {
+    ON_CALL(*random_generator_ptr, Get).WillByDefault(Return(replica));
+    RemoteLookupClient* client = (*shard_manager)->Get(0);
+    if (client == nullptr) {
+      continue;
+    }
+    EXPECT_EQ(client->GetIpAddress(), kGoodIp);
+    EXPECT_TRUE(client->GetValues(*request_context_, "", 0).ok());
+    good_replica_picks++;
+  }
+  EXPECT_GT(good_replica_picks, 0);
+}
+
+TEST_F(ShardManagerTest, GetValuesAsyncDoesNotWaitForTheReplica) {
+  std::vector<absl::flat_hash_set<std::string>> cluster_mappings;
+  cluster_mappings.push_back({std::string(kGoodIp)});
+  cluster_mappings.push_back({"some_ip"});
+  DeferredRemoteLookupClient* deferred_client = nullptr;
+  auto client_factory = [&deferred_client](const std::string& ip)
+      -> std::unique_ptr<RemoteLookupClient> {
+    auto client = std::make_unique<DeferredRemoteLookupClient>();
+    if (ip == kGoodIp) {
+      deferred_client = client.get();
+    }
+    return client;
+  };
+  auto shard_manager = ShardManager::Create(
+      2, std::move(cluster_mappings),
+      std::make_unique<testing::NiceMock<MockRandomGenerator>>(),
+      client_factory);
+  ASSERT_TRUE(shard_manager.ok());
+  ASSERT_NE(deferred_client, nullptr);
+  grpc::ClientContext context;
+  std::optional<absl::StatusOr<InternalLookupResponse>> result;
+  (*shard_manager)
+      ->Get(0)
+      ->GetValuesAsync(
+          *request_context_, "", 0, context,
+          [&result](absl::StatusOr<InternalLookupResponse> response) {
+            result = std::move(response);
+          });
+  EXPECT_FALSE(result.has_value());
+  ASSERT_EQ(deferred_client->pending_calls.size(), 1);
+  std::move(deferred_client->pending_calls[0])(InternalLookupResponse());
+  ASSERT_TRUE(result.has_value());
+  EXPECT_TRUE(result->ok());
+}
+
 }  // namespace
 }  // namespace kv_server
@@ -119,6 +119,9 @@ inline constexpr std::string_view kShardedRunQueryMissingKeySet =
 // Query parsing failure in the run query in sharded lookup
 inline constexpr std::string_view kShardedRunQueryParsingFailure =
     "ShardedRunQueryParsingFailure";
+// Failure of a shard in running a pushed down query in sharded lookup
+inline constexpr std::string_view kShardedRunQueryPushdownFailure =
+    "ShardedRunQueryPushdownFailure";
 
 // Strings must be sorted, this is required by the API of partitioned metrics
 inline constexpr absl::string_view kKVUdfRequestErrorCode[] = {
@@ -137,6 +140,7 @@ inline constexpr absl::string_view kKVUdfRequestErrorCode[] = {
     kShardedRunQueryKeySetRetrievalFailure,
     kShardedRunQueryMissingKeySet,
     kShardedRunQueryParsingFailure,
+    kShardedRunQueryPushdownFailure,
 };
 
 // Non request related server error
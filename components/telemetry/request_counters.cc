@@ -0,0 +1,82 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/telemetry/request_counters.h"
+
+#include <atomic>
+#include <cstdint>
+
+namespace kv_server {
+namespace {
+
+// Index of the stripe of the calling thread. Threads are assigned stripes in
+// turn, so that they only share them when there are more threads than
+// stripes.
+int StripeIndex(int num_stripes) {
+  static std::atomic<int> next_index = 0;
+  thread_local const int index =
+      next_index.fetch_add(1, std::memory_order_relaxed);
+  return index % num_stripes;
+}
+
+}  // namespace
+
+void RequestCounters::Add(absl::StatusCode code, absl::Duration latency) {
+  Stripe& stripe = stripes_[StripeIndex(kNumStripes)];
+  stripe.num_requests.fetch_add(1, std::memory_order_relaxed);
+  stripe.total_requests.fetch_add(1, std::memory_order_relaxed);
+  stripe.total_latency_micros.fetch_add(absl::ToInt64Microseconds(latency),
+                                        std::memory_order_relaxed);
+  if (code == absl::StatusCode::kOk) {
+    return;
+  }
+  int index = static_cast<int>(code);
+  if (index < 0 || index >= kNumStatusCodes) {
+    index = static_cast<int>(absl::StatusCode::kUnknown);
+  }
+  stripe.num_failed_requests[index].fetch_add(1, std::memory_order_relaxed);
+}
+
+RequestCounters::Counts RequestCounters::Take() {
+  Counts counts;
+  for (Stripe& stripe : stripes_) {
+    counts.num_requests +=
+        stripe.num_requests.exchange(0, std::memory_order_relaxed);
+    for (int i = 0; i < kNumStatusCodes; i++) {
+      counts.num_failed_requests[i] += stripe.num_failed_requests[i].exchange(
+          0, std::memory_order_relaxed);
+    }
+  }
+  return counts;
+}
+
+RequestCounters::LatencyTotals RequestCounters::GetLatencyTotals() const {
+  LatencyTotals totals;
+  int64_t total_latency_micros = 0;
+  for (const Stripe& stripe : stripes_) {
+    totals.num_requests +=
+        stripe.total_requests.load(std::memory_order_relaxed);
+    total_latency_micros +=
+        stripe.total_latency_micros.load(std::memory_order_relaxed);
+  }
+  totals.total_latency = absl::Microseconds(total_latency_micros);
+  return totals;
+}
+
+RequestCounters& RequestCounters::Global() {
+  static auto* const counters = new RequestCounters();
+  return *counters;
+}
+
+}  // namespace kv_server
@@ -0,0 +1,87 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef COMPONENTS_TELEMETRY_REQUEST_COUNTERS_H_
+#define COMPONENTS_TELEMETRY_REQUEST_COUNTERS_H_
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+#include "absl/base/config.h"
+#include "absl/status/status.h"
+#include "absl/time/time.h"
+
+namespace kv_server {
+
+// Counts the requests served, and the failed ones by status code, on the hot
+// path of requests. Requests are counted without locks, in stripes of
+// counters that threads mostly have to themselves, and the counts are taken
+// by the periodic export of the metrics instead of being recorded by every
+// request.
+//
+// Thread safe.
+class RequestCounters {
+ public:
+  // Number of `absl::StatusCode` values.
+  static constexpr int kNumStatusCodes =
+      static_cast<int>(absl::StatusCode::kUnauthenticated) + 1;
+
+  struct Counts {
+    int64_t num_requests = 0;
+    // Indexed by status code. Always 0 for `absl::StatusCode::kOk`.
+    std::array<int64_t, kNumStatusCodes> num_failed_requests = {};
+  };
+
+  struct LatencyTotals {
+    int64_t num_requests = 0;
+    absl::Duration total_latency;
+  };
+
+  RequestCounters() = default;
+  RequestCounters(const RequestCounters&) = delete;
+  RequestCounters& operator=(const RequestCounters&) = delete;
+
+  // Counts a request that finished with `code` after `latency`.
+  void Add(absl::StatusCode code, absl::Duration latency);
+
+  // Returns the counts since the previous call, and resets them.
+  Counts Take();
+
+  // Returns the number of requests and the sum of their latencies since the
+  // counters were created. Not reset by `Take`, so that every reader can
+  // average the latencies over its own intervals.
+  LatencyTotals GetLatencyTotals() const;
+
+  // Counters of the requests of the server.
+  static RequestCounters& Global();
+
+ private:
+  static constexpr int kNumStripes = 32;
+
+  struct alignas(ABSL_CACHELINE_SIZE) Stripe {
+    std::atomic<int64_t> num_requests = 0;
+    std::array<std::atomic<int64_t>, kNumStatusCodes> num_failed_requests = {};
+    std::atomic<int64_t> total_requests = 0;
+    std::atomic<int64_t> total_latency_micros = 0;
+  };
+
+  std::array<Stripe, kNumStripes> stripes_;
+};
+
+}  // namespace kv_server
+
+#endif  // COMPONENTS_TELEMETRY_REQUEST_COUNTERS_H_
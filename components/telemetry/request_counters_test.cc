@@ -0,0 +1,89 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/telemetry/request_counters.h"
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace kv_server {
+namespace {
+
+TEST(RequestCountersTest, CountsRequestsAndFailures) {
+  RequestCounters counters;
+  counters.Add(absl::StatusCode::kOk, absl::Milliseconds(1));
+  counters.Add(absl::StatusCode::kOk, absl::Milliseconds(1));
+  counters.Add(absl::StatusCode::kNotFound, absl::Milliseconds(1));
+  counters.Add(static_cast<absl::StatusCode>(100), absl::Milliseconds(1));
+  const RequestCounters::Counts counts = counters.Take();
+  EXPECT_EQ(counts.num_requests, 4);
+  EXPECT_EQ(counts.num_failed_requests[static_cast<int>(
+                absl::StatusCode::kOk)],
+            0);
+  EXPECT_EQ(counts.num_failed_requests[static_cast<int>(
+                absl::StatusCode::kNotFound)],
+            1);
+  EXPECT_EQ(counts.num_failed_requests[static_cast<int>(
+                absl::StatusCode::kUnknown)],
+            1);
+}
+
+TEST(RequestCountersTest, TakeResetsCounts) {
+  RequestCounters counters;
+  counters.Add(absl::StatusCode::kInternal, absl::Milliseconds(1));
+  counters.Take();
+  const RequestCounters::Counts counts = counters.Take();
+  EXPECT_EQ(counts.num_requests, 0);
+  EXPECT_EQ(counts.num_failed_requests[static_cast<int>(
+                absl::StatusCode::kInternal)],
+            0);
+}
+
+TEST(RequestCountersTest, LatencyTotalsAreNotResetByTake) {
+  RequestCounters counters;
+  counters.Add(absl::StatusCode::kOk, absl::Milliseconds(3));
+  counters.Take();
+  counters.Add(absl::StatusCode::kInternal, absl::Milliseconds(5));
+  const RequestCounters::LatencyTotals totals = counters.GetLatencyTotals();
+  EXPECT_EQ(totals.num_requests, 2);
+  EXPECT_EQ(totals.total_latency, absl::Milliseconds(8));
+}
+
+TEST(RequestCountersTest, AddsUpThreads) {
+  constexpr int kNumThreads = 40;
+  constexpr int kNumRequests = 1000;
+  auto counters = std::make_unique<RequestCounters>();
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kNumThreads; i++) {
+    threads.emplace_back([&counters] {
+      for (int j = 0; j < kNumRequests; j++) {
+        counters->Add(absl::StatusCode::kCancelled, absl::Milliseconds(1));
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  const RequestCounters::Counts counts = counters->Take();
+  EXPECT_EQ(counts.num_requests, kNumThreads * kNumRequests);
+  EXPECT_EQ(counts.num_failed_requests[static_cast<int>(
+                absl::StatusCode::kCancelled)],
+            kNumThreads * kNumRequests);
+}
+
+}  // namespace
+}  // namespace kv_server
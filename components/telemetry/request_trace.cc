@@ -0,0 +1,142 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/telemetry/request_trace.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "absl/random/random.h"
+#include "opentelemetry/context/context.h"
+#include "opentelemetry/context/propagation/text_map_propagator.h"
+#include "opentelemetry/trace/context.h"
+#include "opentelemetry/trace/propagation/http_trace_context.h"
+#include "src/telemetry/tracing.h"
+
+namespace kv_server {
+namespace {
+
+using opentelemetry::context::Context;
+using opentelemetry::nostd::string_view;
+using opentelemetry::trace::SpanContext;
+using opentelemetry::trace::StartSpanOptions;
+using opentelemetry::trace::propagation::HttpTraceContext;
+using privacy_sandbox::server_common::GetTracer;
+
+// Holds the trace parent entry of a single span.
+class TraceParentCarrier
+    : public opentelemetry::context::propagation::TextMapCarrier {
+ public:
+  TraceParentCarrier() = default;
+  explicit TraceParentCarrier(std::string_view trace_parent)
+      : trace_parent_(trace_parent) {}
+
+  string_view Get(string_view key) const noexcept override {
+    if (IsTraceParent(key)) {
+      return trace_parent_;
+    }
+    return "";
+  }
+
+  void Set(string_view key, string_view value) noexcept override {
+    if (IsTraceParent(key)) {
+      trace_parent_ = std::string(value.data(), value.size());
+    }
+  }
+
+  std::string& trace_parent() { return trace_parent_; }
+
+ private:
+  static bool IsTraceParent(string_view key) {
+    return std::string_view(key.data(), key.size()) ==
+           RequestTrace::kTraceParentHeader;
+  }
+
+  std::string trace_parent_;
+};
+
+// Whether to sample the next request started on the calling thread, which is
+// the case for one in every `sampling_interval` requests. Every thread starts
+// at a random point of the interval, so that threads don't sample in
+// lockstep.
+bool Sample(int64_t sampling_interval) {
+  thread_local int64_t countdown = 0;
+  if (countdown <= 0 || countdown > sampling_interval) {
+    thread_local absl::InsecureBitGen bitgen;
+    countdown = absl::Uniform<int64_t>(absl::IntervalClosed, bitgen, 1,
+                                       sampling_interval);
+  }
+  if (--countdown > 0) {
+    return false;
+  }
+  countdown = sampling_interval;
+  return true;
+}
+
+}  // namespace
+
+thread_local const std::shared_ptr<RequestTrace>* RequestTrace::active_ =
+    nullptr;
+
+std::shared_ptr<RequestTrace> RequestTrace::MaybeStart(
+    std::string_view name, int64_t sampling_interval) {
+  if (sampling_interval <= 0 || !Sample(sampling_interval)) {
+    return nullptr;
+  }
+  return std::shared_ptr<RequestTrace>(
+      new RequestTrace(GetTracer()->StartSpan({name.data(), name.size()})));
+}
+
+std::shared_ptr<RequestTrace> RequestTrace::ContinueRemote(
+    std::string_view name, std::string_view trace_parent) {
+  if (trace_parent.empty()) {
+    return nullptr;
+  }
+  const TraceParentCarrier carrier(trace_parent);
+  Context context;
+  context = HttpTraceContext().Extract(carrier, context);
+  const SpanContext parent =
+      opentelemetry::trace::GetSpan(context)->GetContext();
+  if (!parent.IsValid() || !parent.IsSampled()) {
+    return nullptr;
+  }
+  StartSpanOptions options;
+  options.kind = opentelemetry::trace::SpanKind::kServer;
+  options.parent = parent;
+  return std::shared_ptr<RequestTrace>(
+      new RequestTrace(
+          GetTracer()->StartSpan({name.data(), name.size()}, options)));
+}
+
+SpanPtr RequestTrace::StartSpan(std::string_view name) const {
+  StartSpanOptions options;
+  options.parent = root_->GetContext();
+  return GetTracer()->StartSpan({name.data(), name.size()}, options);
+}
+
+std::string TraceSpan::TraceParent() const {
+  if (span_ == nullptr) {
+    return "";
+  }
+  TraceParentCarrier carrier;
+  Context context;
+  HttpTraceContext().Inject(carrier,
+                            opentelemetry::trace::SetSpan(context, span_));
+  return std::move(carrier.trace_parent());
+}
+
+}  // namespace kv_server
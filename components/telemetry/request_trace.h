@@ -0,0 +1,138 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef COMPONENTS_TELEMETRY_REQUEST_TRACE_H_
+#define COMPONENTS_TELEMETRY_REQUEST_TRACE_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "opentelemetry/common/attribute_value.h"
+#include "opentelemetry/trace/span.h"
+
+namespace kv_server {
+
+using SpanPtr = opentelemetry::nostd::shared_ptr<opentelemetry::trace::Span>;
+
+// Trace of a single sampled request, recorded with the OpenTelemetry tracer
+// of the server. The stages of the request are recorded as child spans of the
+// root span of the request with `TraceSpan`.
+//
+// Requests that are not sampled have no trace, so that tracing them costs no
+// more than a null check per stage.
+class RequestTrace {
+ public:
+  // Name of the gRPC metadata entry that propagates the trace to remote
+  // lookups, in the W3C trace context format.
+  static constexpr std::string_view kTraceParentHeader = "traceparent";
+
+  // Starts the trace of one in every `sampling_interval` requests started on
+  // the calling thread, with a root span named `name`. Returns nullptr for
+  // the other requests, or for all of them if `sampling_interval` is not
+  // positive.
+  static std::shared_ptr<RequestTrace> MaybeStart(std::string_view name,
+                                                  int64_t sampling_interval);
+
+  // Continues the trace of a remote request whose span is given by
+  // `trace_parent`, the value of a `kTraceParentHeader` entry, with a root
+  // span named `name`. Returns nullptr if the remote request is not sampled.
+  static std::shared_ptr<RequestTrace> ContinueRemote(
+      std::string_view name, std::string_view trace_parent);
+
+  // The trace that is active on the calling thread within an `Activation`,
+  // or nullptr.
+  static std::shared_ptr<RequestTrace> Active() {
+    return active_ == nullptr ? nullptr : *active_;
+  }
+
+  // Makes `trace` the active trace of the calling thread for its lifetime,
+  // so that it can be picked up by code that doesn't take it as an argument.
+  class Activation {
+   public:
+    explicit Activation(const std::shared_ptr<RequestTrace>& trace)
+        : previous_(active_) {
+      active_ = &trace;
+    }
+    ~Activation() { active_ = previous_; }
+    Activation(const Activation&) = delete;
+    Activation& operator=(const Activation&) = delete;
+
+   private:
+    const std::shared_ptr<RequestTrace>* previous_;
+  };
+
+  ~RequestTrace() { End(); }
+  RequestTrace(const RequestTrace&) = delete;
+  RequestTrace& operator=(const RequestTrace&) = delete;
+
+  // Starts a child span of the root span.
+  SpanPtr StartSpan(std::string_view name) const;
+
+  // Ends the root span. Called on destruction, if not before.
+  void End() { root_->End(); }
+
+ private:
+  explicit RequestTrace(SpanPtr root) : root_(std::move(root)) {}
+
+  static thread_local const std::shared_ptr<RequestTrace>* active_;
+
+  SpanPtr root_;
+};
+
+// Records the scope of a stage of a request as a span of `trace`, until
+// destroyed or ended. Does nothing if `trace` is null, which is the case for
+// requests that are not sampled.
+class TraceSpan {
+ public:
+  TraceSpan(const RequestTrace* trace, std::string_view name) {
+    if (trace != nullptr) {
+      span_ = trace->StartSpan(name);
+    }
+  }
+  ~TraceSpan() { End(); }
+  TraceSpan(TraceSpan&&) = default;
+
+  // Whether the span is recorded.
+  bool IsRecording() const { return span_ != nullptr; }
+
+  void SetAttribute(std::string_view key,
+                    const opentelemetry::common::AttributeValue& value) {
+    if (span_ != nullptr) {
+      span_->SetAttribute({key.data(), key.size()}, value);
+    }
+  }
+
+  // Value of a `RequestTrace::kTraceParentHeader` entry that makes this span
+  // the parent of the trace of a remote request. Empty if not recorded.
+  std::string TraceParent() const;
+
+  void End() {
+    if (span_ != nullptr) {
+      span_->End();
+      span_ = SpanPtr();
+    }
+  }
+
+ private:
+  SpanPtr span_;
+};
+
+}  // namespace kv_server
+
+#endif  // COMPONENTS_TELEMETRY_REQUEST_TRACE_H_
@@ -0,0 +1,90 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/telemetry/request_trace.h"
+
+#include <memory>
+
+#include "gtest/gtest.h"
+
+namespace kv_server {
+namespace {
+
+TEST(RequestTraceTest, SamplesOneInEveryInterval) {
+  int num_sampled = 0;
+  for (int i = 0; i < 1000; i++) {
+    if (RequestTrace::MaybeStart("request", 10) != nullptr) {
+      num_sampled++;
+    }
+  }
+  EXPECT_EQ(num_sampled, 100);
+}
+
+TEST(RequestTraceTest, SamplesNothingWithoutInterval) {
+  for (int i = 0; i < 100; i++) {
+    EXPECT_EQ(RequestTrace::MaybeStart("request", 0), nullptr);
+  }
+}
+
+TEST(RequestTraceTest, ActivationSetsActiveTrace) {
+  EXPECT_EQ(RequestTrace::Active(), nullptr);
+  const std::shared_ptr<RequestTrace> trace =
+      RequestTrace::MaybeStart("request", 1);
+  ASSERT_NE(trace, nullptr);
+  {
+    RequestTrace::Activation activation(trace);
+    EXPECT_EQ(RequestTrace::Active(), trace);
+    {
+      const std::shared_ptr<RequestTrace> no_trace;
+      RequestTrace::Activation inner_activation(no_trace);
+      EXPECT_EQ(RequestTrace::Active(), nullptr);
+    }
+    EXPECT_EQ(RequestTrace::Active(), trace);
+  }
+  EXPECT_EQ(RequestTrace::Active(), nullptr);
+}
+
+TEST(RequestTraceTest, ContinuesSampledRemoteTrace) {
+  EXPECT_NE(RequestTrace::ContinueRemote(
+                "request",
+                "00-0af7651916cd43dd8448eb211c80319c-b7ad6b7169203331-01"),
+            nullptr);
+  EXPECT_EQ(RequestTrace::ContinueRemote(
+                "request",
+                "00-0af7651916cd43dd8448eb211c80319c-b7ad6b7169203331-00"),
+            nullptr);
+  EXPECT_EQ(RequestTrace::ContinueRemote("request", "invalid"), nullptr);
+  EXPECT_EQ(RequestTrace::ContinueRemote("request", ""), nullptr);
+}
+
+TEST(TraceSpanTest, DoesNothingWithoutTrace) {
+  TraceSpan span(nullptr, "stage");
+  EXPECT_FALSE(span.IsRecording());
+  span.SetAttribute("key", "value");
+  EXPECT_EQ(span.TraceParent(), "");
+  span.End();
+}
+
+TEST(TraceSpanTest, RecordsSpanOfTrace) {
+  const std::shared_ptr<RequestTrace> trace =
+      RequestTrace::MaybeStart("request", 1);
+  ASSERT_NE(trace, nullptr);
+  TraceSpan span(trace.get(), "stage");
+  EXPECT_TRUE(span.IsRecording());
+  span.End();
+  EXPECT_FALSE(span.IsRecording());
+}
+
+}  // namespace
+}  // namespace kv_server
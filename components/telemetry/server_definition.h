@@ -17,13 +17,19 @@
 #ifndef COMPONENTS_TELEMETRY_SERVER_DEFINITION_H_
 #define COMPONENTS_TELEMETRY_SERVER_DEFINITION_H_
 
+#include <array>
+#include <atomic>
+#include <iterator>
 #include <memory>
 #include <string>
+#include <string_view>
 #include <utility>
 
+#include "absl/strings/str_cat.h"
 #include "absl/time/time.h"
 #include "components/telemetry/error_code.h"
-#include "src/core/common/uuid/uuid.h"
+#include "components/telemetry/request_counters.h"
+#include "components/telemetry/udf_usage_counters.h"
 #include "src/metric/context_map.h"
 #include "src/util/duration.h"
 #include "src/util/read_system.h"
@@ -80,6 +86,19 @@ inline constexpr absl::string_view kAbslStatusStrings[] = {
     "UNIMPLEMENTED",
     "UNKNOWN"};
 
+inline constexpr double kQueueDepthBoundaries[] = {
+    1, 2, 4, 8, 16, 32, 64, 128, 256, 512, 1'024, 2'048, 4'096, 8'192};
+
+inline constexpr double kLockTimeInMicroSecondsBoundaries[] = {
+    1,     2,     5,     10,    20,      50,      100,       200,      500,
+    1'000, 2'000, 5'000, 10'000, 50'000, 100'000, 1'000'000, 10'000'000};
+
+inline constexpr double kCountBoundaries[] = {
+    1, 10, 100, 1'000, 10'000, 100'000, 1'000'000, 10'000'000, 100'000'000};
+
+inline constexpr double kCompressionRatioBoundaries[] = {
+    1, 1.25, 1.5, 2, 3, 4, 6, 8, 12, 16, 32};
+
 inline constexpr std::string_view kKeyValueCacheHit = "KeyValueCacheHit";
 inline constexpr std::string_view kKeyValueCacheMiss = "KeyValueCacheMiss";
 inline constexpr std::string_view kKeyValueSetCacheHit = "KeyValueSetCacheHit";
@@ -89,6 +108,29 @@ inline constexpr std::string_view kCacheAccessEvents[] = {
     kKeyValueCacheHit, kKeyValueCacheMiss, kKeyValueSetCacheHit,
     kKeyValueSetCacheMiss};
 
+inline constexpr std::string_view kQueryCacheHit = "QueryCacheHit";
+inline constexpr std::string_view kQueryCacheMiss = "QueryCacheMiss";
+inline constexpr std::string_view kQueryCacheAccessEvents[] = {
+    kQueryCacheHit, kQueryCacheMiss};
+
+inline constexpr std::string_view kRequestLookupCacheHit =
+    "RequestLookupCacheHit";
+inline constexpr std::string_view kRequestLookupCacheMiss =
+    "RequestLookupCacheMiss";
+inline constexpr std::string_view kRequestLookupCacheAccessEvents[] = {
+    kRequestLookupCacheHit, kRequestLookupCacheMiss};
+
+// Stages of loading a data file, see `DataLoadingProfile`.
+inline constexpr std::string_view kDataLoadingStageOpen = "open";
+inline constexpr std::string_view kDataLoadingStageThrottle = "throttle";
+inline constexpr std::string_view kDataLoadingStageDecode = "decode";
+inline constexpr std::string_view kDataLoadingStageApply = "apply";
+inline constexpr std::string_view kDataLoadingStageNotify = "notify";
+inline constexpr std::string_view kDataLoadingStageCleanup = "cleanup";
+inline constexpr std::string_view kDataLoadingStages[] = {
+    kDataLoadingStageOpen, kDataLoadingStageThrottle, kDataLoadingStageDecode,
+    kDataLoadingStageApply, kDataLoadingStageNotify, kDataLoadingStageCleanup};
+
 inline constexpr privacy_sandbox::server_common::metrics::PrivacyBudget
     privacy_total_budget{/*epsilon*/ 5};
 
@@ -224,6 +266,26 @@ inline constexpr privacy_sandbox::server_common::metrics::Definition<
                            kCacheAccessEvents, kCounterDPUpperBound,
                            kCounterDPLowerBound);
 
+inline constexpr privacy_sandbox::server_common::metrics::Definition<
+    int, privacy_sandbox::server_common::metrics::Privacy::kImpacting,
+    privacy_sandbox::server_common::metrics::Instrument::kPartitionedCounter>
+    kQueryCacheAccessEventCount(
+        "QueryCacheAccessEventCount",
+        "Count of compiled query cache hit or miss events by request",
+        "cache_access", 1 /*max_partitions_contributed*/,
+        kQueryCacheAccessEvents, kCounterDPUpperBound, kCounterDPLowerBound);
+
+inline constexpr privacy_sandbox::server_common::metrics::Definition<
+    int, privacy_sandbox::server_common::metrics::Privacy::kImpacting,
+    privacy_sandbox::server_common::metrics::Instrument::kPartitionedCounter>
+    kRequestLookupCacheAccessEventCount(
+        "RequestLookupCacheAccessEventCount",
+        "Count of sharded lookup keys found or not found in the results of "
+        "earlier lookups of the same request",
+        "cache_access", 2 /*max_partitions_contributed*/,
+        kRequestLookupCacheAccessEvents, kCounterDPUpperBound,
+        kCounterDPLowerBound);
+
 // Metric definitions for safe metrics that are not privacy impacting
 inline constexpr privacy_sandbox::server_common::metrics::Definition<
     int, privacy_sandbox::server_common::metrics::Privacy::kNonImpacting,
@@ -314,6 +376,22 @@ inline constexpr privacy_sandbox::server_common::metrics::Definition<
         "notification messages",
         kLatencyInMicroSecondsBoundaries);
 
+inline constexpr privacy_sandbox::server_common::metrics::Definition<
+    double, privacy_sandbox::server_common::metrics::Privacy::kNonImpacting,
+    privacy_sandbox::server_common::metrics::Instrument::kHistogram>
+    kRealtimeApplyQueueDepth(
+        "RealtimeApplyQueueDepth",
+        "Number of received realtime messages waiting for an applier thread",
+        kQueueDepthBoundaries);
+
+inline constexpr privacy_sandbox::server_common::metrics::Definition<
+    double, privacy_sandbox::server_common::metrics::Privacy::kNonImpacting,
+    privacy_sandbox::server_common::metrics::Instrument::kHistogram>
+    kRealtimeApplyLag(
+        "RealtimeApplyLag",
+        "Latency from receiving a realtime message until it is applied",
+        kLatencyInMicroSecondsBoundaries);
+
 inline constexpr privacy_sandbox::server_common::metrics::Definition<
     double, privacy_sandbox::server_common::metrics::Privacy::kNonImpacting,
     privacy_sandbox::server_common::metrics::Instrument::kHistogram>
@@ -380,6 +458,24 @@ inline constexpr privacy_sandbox::server_common::metrics::Definition<
         "data_source",
         privacy_sandbox::server_common::metrics::kEmptyPublicPartition);
 
+inline constexpr privacy_sandbox::server_common::metrics::Definition<
+    double, privacy_sandbox::server_common::metrics::Privacy::kNonImpacting,
+    privacy_sandbox::server_common::metrics::Instrument::kPartitionedCounter>
+    kDataLoadingStageTimeMicros(
+        "DataLoadingStageTimeMicros",
+        "Time spent loading data files by stage, summed over the threads "
+        "reading the records of the files",
+        "data_loading_stage", kDataLoadingStages);
+
+inline constexpr privacy_sandbox::server_common::metrics::Definition<
+    double, privacy_sandbox::server_common::metrics::Privacy::kNonImpacting,
+    privacy_sandbox::server_common::metrics::Instrument::kPartitionedCounter>
+    kDataLoadingRecordBytes(
+        "DataLoadingRecordBytes",
+        "Bytes of the records loaded from data files, by data file",
+        "data_source",
+        privacy_sandbox::server_common::metrics::kEmptyPublicPartition);
+
 inline constexpr privacy_sandbox::server_common::metrics::Definition<
     double, privacy_sandbox::server_common::metrics::Privacy::kNonImpacting,
     privacy_sandbox::server_common::metrics::Instrument::kHistogram>
@@ -396,6 +492,15 @@ inline constexpr privacy_sandbox::server_common::metrics::Definition<
         "Latency in ConcurrentStreamRecordReader reading stream records",
         kLatencyInMicroSecondsBoundaries);
 
+inline constexpr privacy_sandbox::server_common::metrics::Definition<
+    double, privacy_sandbox::server_common::metrics::Privacy::kNonImpacting,
+    privacy_sandbox::server_common::metrics::Instrument::kHistogram>
+    kConcurrentStreamRecordReaderShardQueueLatency(
+        "ConcurrentStreamRecordReaderShardQueueLatency",
+        "Latency in ConcurrentStreamRecordReader from starting to read a "
+        "stream until a worker starts reading a shard",
+        kLatencyInMicroSecondsBoundaries);
+
 inline constexpr privacy_sandbox::server_common::metrics::Definition<
     double, privacy_sandbox::server_common::metrics::Privacy::kNonImpacting,
     privacy_sandbox::server_common::metrics::Instrument::kHistogram>
@@ -404,6 +509,30 @@ inline constexpr privacy_sandbox::server_common::metrics::Definition<
         "Latency in ConcurrentStreamRecordReader reading byte range",
         kLatencyInMicroSecondsBoundaries);
 
+inline constexpr privacy_sandbox::server_common::metrics::Definition<
+    double, privacy_sandbox::server_common::metrics::Privacy::kNonImpacting,
+    privacy_sandbox::server_common::metrics::Instrument::kHistogram>
+    kInitSnapshotFilesLoadingLatency(
+        "InitSnapshotFilesLoadingLatency",
+        "Latency in loading the snapshot files when initializing the cache",
+        kLatencyInMicroSecondsBoundaries);
+
+inline constexpr privacy_sandbox::server_common::metrics::Definition<
+    double, privacy_sandbox::server_common::metrics::Privacy::kNonImpacting,
+    privacy_sandbox::server_common::metrics::Instrument::kHistogram>
+    kInitDeltaFilesLoadingLatency(
+        "InitDeltaFilesLoadingLatency",
+        "Latency in loading the delta files when initializing the cache",
+        kLatencyInMicroSecondsBoundaries);
+
+inline constexpr privacy_sandbox::server_common::metrics::Definition<
+    double, privacy_sandbox::server_common::metrics::Privacy::kNonImpacting,
+    privacy_sandbox::server_common::metrics::Instrument::kHistogram>
+    kDeltaFileNotificationToLoadLatency(
+        "DeltaFileNotificationToLoadLatency",
+        "Latency from a new delta file being reported until it is loaded",
+        kLatencyInMicroSecondsBoundaries);
+
 inline constexpr privacy_sandbox::server_common::metrics::Definition<
     double, privacy_sandbox::server_common::metrics::Privacy::kNonImpacting,
     privacy_sandbox::server_common::metrics::Instrument::kHistogram>
@@ -431,6 +560,14 @@ inline constexpr privacy_sandbox::server_common::metrics::Definition<
                               "Latency in deleting values in set",
                               kLatencyInMicroSecondsBoundaries);
 
+inline constexpr privacy_sandbox::server_common::metrics::Definition<
+    double, privacy_sandbox::server_common::metrics::Privacy::kNonImpacting,
+    privacy_sandbox::server_common::metrics::Instrument::kHistogram>
+    kApplyCacheMutationBatchLatency(
+        "ApplyCacheMutationBatchLatency",
+        "Latency in applying a batch of cache mutations",
+        kLatencyInMicroSecondsBoundaries);
+
 inline constexpr privacy_sandbox::server_common::metrics::Definition<
     double, privacy_sandbox::server_common::metrics::Privacy::kNonImpacting,
     privacy_sandbox::server_common::metrics::Instrument::kHistogram>
@@ -453,6 +590,184 @@ inline constexpr privacy_sandbox::server_common::metrics::Definition<
                                   "Latency in cleaning up key value set map",
                                   kLatencyInMicroSecondsBoundaries);
 
+inline constexpr privacy_sandbox::server_common::metrics::Definition<
+    double, privacy_sandbox::server_common::metrics::Privacy::kNonImpacting,
+    privacy_sandbox::server_common::metrics::Instrument::kHistogram>
+    kBackgroundCleanUpPauseLatency(
+        "BackgroundCleanUpPauseLatency",
+        "Time a cache map stays locked by one slice of the background clean up",
+        kLatencyInMicroSecondsBoundaries);
+
+inline constexpr privacy_sandbox::server_common::metrics::Definition<
+    double, privacy_sandbox::server_common::metrics::Privacy::kNonImpacting,
+    privacy_sandbox::server_common::metrics::Instrument::kHistogram>
+    kCacheTombstoneCount(
+        "CacheTombstoneCount",
+        "Number of deleted keys and set values left in the cache after a "
+        "background clean up",
+        kCountBoundaries);
+
+inline constexpr privacy_sandbox::server_common::metrics::Definition<
+    double, privacy_sandbox::server_common::metrics::Privacy::kNonImpacting,
+    privacy_sandbox::server_common::metrics::Instrument::kPartitionedCounter>
+    kCachePrefixKeyCount(
+        "CachePrefixKeyCount",
+        "Number of keys with a value in the cache, by prefix",
+        "prefix",
+        privacy_sandbox::server_common::metrics::kEmptyPublicPartition);
+
+inline constexpr privacy_sandbox::server_common::metrics::Definition<
+    double, privacy_sandbox::server_common::metrics::Privacy::kNonImpacting,
+    privacy_sandbox::server_common::metrics::Instrument::kPartitionedCounter>
+    kCachePrefixValueBytes(
+        "CachePrefixValueBytes",
+        "Bytes of the keys and values in the cache, by prefix",
+        "prefix",
+        privacy_sandbox::server_common::metrics::kEmptyPublicPartition);
+
+inline constexpr privacy_sandbox::server_common::metrics::Definition<
+    double, privacy_sandbox::server_common::metrics::Privacy::kNonImpacting,
+    privacy_sandbox::server_common::metrics::Instrument::kPartitionedCounter>
+    kCachePrefixSetValueCount(
+        "CachePrefixSetValueCount",
+        "Number of values of key-value sets in the cache, by prefix",
+        "prefix",
+        privacy_sandbox::server_common::metrics::kEmptyPublicPartition);
+
+inline constexpr privacy_sandbox::server_common::metrics::Definition<
+    double, privacy_sandbox::server_common::metrics::Privacy::kNonImpacting,
+    privacy_sandbox::server_common::metrics::Instrument::kPartitionedCounter>
+    kCachePrefixTombstoneCount(
+        "CachePrefixTombstoneCount",
+        "Number of deleted keys and set values waiting for clean up in the "
+        "cache, by prefix",
+        "prefix",
+        privacy_sandbox::server_common::metrics::kEmptyPublicPartition);
+
+inline constexpr privacy_sandbox::server_common::metrics::Definition<
+    double, privacy_sandbox::server_common::metrics::Privacy::kNonImpacting,
+    privacy_sandbox::server_common::metrics::Instrument::kPartitionedCounter>
+    kDataFreshnessLagSeconds(
+        "DataFreshnessLagSeconds",
+        "Seconds since the oldest data file not loaded yet became available, "
+        "by prefix",
+        "prefix",
+        privacy_sandbox::server_common::metrics::kEmptyPublicPartition);
+
+inline constexpr privacy_sandbox::server_common::metrics::Definition<
+    double, privacy_sandbox::server_common::metrics::Privacy::kNonImpacting,
+    privacy_sandbox::server_common::metrics::Instrument::kPartitionedCounter>
+    kDataPendingFileCount(
+        "DataPendingFileCount",
+        "Number of data files available but not loaded yet, by prefix",
+        "prefix",
+        privacy_sandbox::server_common::metrics::kEmptyPublicPartition);
+
+inline constexpr privacy_sandbox::server_common::metrics::Definition<
+    double, privacy_sandbox::server_common::metrics::Privacy::kNonImpacting,
+    privacy_sandbox::server_common::metrics::Instrument::kPartitionedCounter>
+    kHeapAllocatorBytes(
+        "HeapAllocatorBytes",
+        "Bytes of the heap allocated, free in the allocator caches or "
+        "returned to the OS, by use",
+        "use", privacy_sandbox::server_common::metrics::kEmptyPublicPartition);
+
+inline constexpr privacy_sandbox::server_common::metrics::Definition<
+    double, privacy_sandbox::server_common::metrics::Privacy::kNonImpacting,
+    privacy_sandbox::server_common::metrics::Instrument::kHistogram>
+    kCacheKeyMapLockWaitTime(
+        "CacheKeyMapLockWaitTime",
+        "Microseconds waiting for a cache key value map lock",
+        kLockTimeInMicroSecondsBoundaries);
+
+inline constexpr privacy_sandbox::server_common::metrics::Definition<
+    double, privacy_sandbox::server_common::metrics::Privacy::kNonImpacting,
+    privacy_sandbox::server_common::metrics::Instrument::kHistogram>
+    kCacheKeyMapLockHoldTime(
+        "CacheKeyMapLockHoldTime",
+        "Microseconds holding a cache key value map lock",
+        kLockTimeInMicroSecondsBoundaries);
+
+inline constexpr privacy_sandbox::server_common::metrics::Definition<
+    double, privacy_sandbox::server_common::metrics::Privacy::kNonImpacting,
+    privacy_sandbox::server_common::metrics::Instrument::kHistogram>
+    kCacheSetMapLockWaitTime(
+        "CacheSetMapLockWaitTime",
+        "Microseconds waiting for a cache key value set map lock",
+        kLockTimeInMicroSecondsBoundaries);
+
+inline constexpr privacy_sandbox::server_common::metrics::Definition<
+    double, privacy_sandbox::server_common::metrics::Privacy::kNonImpacting,
+    privacy_sandbox::server_common::metrics::Instrument::kHistogram>
+    kCacheSetMapLockHoldTime(
+        "CacheSetMapLockHoldTime",
+        "Microseconds holding a cache key value set map lock",
+        kLockTimeInMicroSecondsBoundaries);
+
+inline constexpr privacy_sandbox::server_common::metrics::Definition<
+    double, privacy_sandbox::server_common::metrics::Privacy::kNonImpacting,
+    privacy_sandbox::server_common::metrics::Instrument::kHistogram>
+    kCacheValueSetLockWaitTime(
+        "CacheValueSetLockWaitTime",
+        "Microseconds waiting for a cache value set lock",
+        kLockTimeInMicroSecondsBoundaries);
+
+inline constexpr privacy_sandbox::server_common::metrics::Definition<
+    double, privacy_sandbox::server_common::metrics::Privacy::kNonImpacting,
+    privacy_sandbox::server_common::metrics::Instrument::kHistogram>
+    kCacheValueSetLockHoldTime(
+        "CacheValueSetLockHoldTime",
+        "Microseconds holding a cache value set lock",
+        kLockTimeInMicroSecondsBoundaries);
+
+inline constexpr privacy_sandbox::server_common::metrics::Definition<
+    double, privacy_sandbox::server_common::metrics::Privacy::kNonImpacting,
+    privacy_sandbox::server_common::metrics::Instrument::kHistogram>
+    kShardManagerLockWaitTime(
+        "ShardManagerLockWaitTime",
+        "Microseconds waiting for a shard manager client lock",
+        kLockTimeInMicroSecondsBoundaries);
+
+inline constexpr privacy_sandbox::server_common::metrics::Definition<
+    double, privacy_sandbox::server_common::metrics::Privacy::kNonImpacting,
+    privacy_sandbox::server_common::metrics::Instrument::kHistogram>
+    kShardManagerLockHoldTime(
+        "ShardManagerLockHoldTime",
+        "Microseconds holding a shard manager client lock",
+        kLockTimeInMicroSecondsBoundaries);
+
+inline constexpr privacy_sandbox::server_common::metrics::Definition<
+    double, privacy_sandbox::server_common::metrics::Privacy::kNonImpacting,
+    privacy_sandbox::server_common::metrics::Instrument::kHistogram>
+    kDeltaFileQueueLockWaitTime(
+        "DeltaFileQueueLockWaitTime",
+        "Microseconds waiting for a delta file queue lock",
+        kLockTimeInMicroSecondsBoundaries);
+
+inline constexpr privacy_sandbox::server_common::metrics::Definition<
+    double, privacy_sandbox::server_common::metrics::Privacy::kNonImpacting,
+    privacy_sandbox::server_common::metrics::Instrument::kHistogram>
+    kDeltaFileQueueLockHoldTime(
+        "DeltaFileQueueLockHoldTime",
+        "Microseconds holding a delta file queue lock",
+        kLockTimeInMicroSecondsBoundaries);
+
+inline constexpr privacy_sandbox::server_common::metrics::Definition<
+    double, privacy_sandbox::server_common::metrics::Privacy::kNonImpacting,
+    privacy_sandbox::server_common::metrics::Instrument::kHistogram>
+    kRealtimeCoalescerLockWaitTime(
+        "RealtimeCoalescerLockWaitTime",
+        "Microseconds waiting for a realtime update coalescer lock",
+        kLockTimeInMicroSecondsBoundaries);
+
+inline constexpr privacy_sandbox::server_common::metrics::Definition<
+    double, privacy_sandbox::server_common::metrics::Privacy::kNonImpacting,
+    privacy_sandbox::server_common::metrics::Instrument::kHistogram>
+    kRealtimeCoalescerLockHoldTime(
+        "RealtimeCoalescerLockHoldTime",
+        "Microseconds holding a realtime update coalescer lock",
+        kLockTimeInMicroSecondsBoundaries);
+
 inline constexpr privacy_sandbox::server_common::metrics::Definition<
     int, privacy_sandbox::server_common::metrics::Privacy::kNonImpacting,
     privacy_sandbox::server_common::metrics::Instrument::kUpDownCounter>
@@ -460,6 +775,197 @@ inline constexpr privacy_sandbox::server_common::metrics::Definition<
         "SecureLookupRequestCount",
         "Number of secure lookup requests received from remote server");
 
+inline constexpr privacy_sandbox::server_common::metrics::Definition<
+    double, privacy_sandbox::server_common::metrics::Privacy::kNonImpacting,
+    privacy_sandbox::server_common::metrics::Instrument::kHistogram>
+    kShardedLookupExecutorQueueDepth(
+        "ShardedLookupExecutorQueueDepth",
+        "Number of shard lookups waiting for a sharded lookup executor thread",
+        kQueueDepthBoundaries);
+
+inline constexpr privacy_sandbox::server_common::metrics::Definition<
+    double, privacy_sandbox::server_common::metrics::Privacy::kNonImpacting,
+    privacy_sandbox::server_common::metrics::Instrument::kHistogram>
+    kShardedLookupExecutorQueueLatencyInMicros(
+        "ShardedLookupExecutorQueueLatencyInMicros",
+        "Time a shard lookup waited for a sharded lookup executor thread",
+        kLatencyInMicroSecondsBoundaries);
+
+inline constexpr privacy_sandbox::server_common::metrics::Definition<
+    int, privacy_sandbox::server_common::metrics::Privacy::kNonImpacting,
+    privacy_sandbox::server_common::metrics::Instrument::kUpDownCounter>
+    kShardedLookupHedgedLookupCount(
+        "ShardedLookupHedgedLookupCount",
+        "Number of remote shard lookups also sent to another replica");
+
+inline constexpr privacy_sandbox::server_common::metrics::Definition<
+    int, privacy_sandbox::server_common::metrics::Privacy::kNonImpacting,
+    privacy_sandbox::server_common::metrics::Instrument::kUpDownCounter>
+    kRealtimeCoalescedMutationCount(
+        "RealtimeCoalescedMutationCount",
+        "Number of realtime mutations dropped because a later mutation of the "
+        "same key arrived within the coalescing window");
+
+inline constexpr privacy_sandbox::server_common::metrics::Definition<
+    double, privacy_sandbox::server_common::metrics::Privacy::kNonImpacting,
+    privacy_sandbox::server_common::metrics::Instrument::kHistogram>
+    kUdfExecutionQueueDepth(
+        "UdfExecutionQueueDepth",
+        "Number of admitted UDF executions waiting for a Roma worker",
+        kQueueDepthBoundaries);
+
+inline constexpr privacy_sandbox::server_common::metrics::Definition<
+    int, privacy_sandbox::server_common::metrics::Privacy::kNonImpacting,
+    privacy_sandbox::server_common::metrics::Instrument::kUpDownCounter>
+    kUdfExecutionRejectedCount(
+        "UdfExecutionRejectedCount",
+        "Number of UDF executions rejected because they would have waited for "
+        "a Roma worker past their deadline");
+
+inline constexpr privacy_sandbox::server_common::metrics::Definition<
+    double, privacy_sandbox::server_common::metrics::Privacy::kNonImpacting,
+    privacy_sandbox::server_common::metrics::Instrument::kHistogram>
+    kLookupBatchCallerCount(
+        "LookupBatchCallerCount",
+        "Number of shard lookups merged into one batched cache lookup",
+        kQueueDepthBoundaries);
+
+inline constexpr privacy_sandbox::server_common::metrics::Definition<
+    double, privacy_sandbox::server_common::metrics::Privacy::kNonImpacting,
+    privacy_sandbox::server_common::metrics::Instrument::kHistogram>
+    kLookupBatchKeyCount("LookupBatchKeyCount",
+                         "Number of distinct keys of a batched cache lookup",
+                         kCountBoundaries);
+
+inline constexpr privacy_sandbox::server_common::metrics::Definition<
+    int, privacy_sandbox::server_common::metrics::Privacy::kNonImpacting,
+    privacy_sandbox::server_common::metrics::Instrument::kUpDownCounter>
+    kLookupCacheHitCount("LookupCacheHitCount",
+                         "Number of keys served from the lookup cache");
+
+inline constexpr privacy_sandbox::server_common::metrics::Definition<
+    int, privacy_sandbox::server_common::metrics::Privacy::kNonImpacting,
+    privacy_sandbox::server_common::metrics::Instrument::kUpDownCounter>
+    kLookupCacheMissCount(
+        "LookupCacheMissCount",
+        "Number of keys missing from the lookup cache and looked up");
+
+inline constexpr privacy_sandbox::server_common::metrics::Definition<
+    int, privacy_sandbox::server_common::metrics::Privacy::kNonImpacting,
+    privacy_sandbox::server_common::metrics::Instrument::kUpDownCounter>
+    kResponseCacheHitCount("ResponseCacheHitCount",
+                           "Number of V2 requests served from the response "
+                           "cache");
+
+inline constexpr privacy_sandbox::server_common::metrics::Definition<
+    int, privacy_sandbox::server_common::metrics::Privacy::kNonImpacting,
+    privacy_sandbox::server_common::metrics::Instrument::kUpDownCounter>
+    kResponseCacheMissCount(
+        "ResponseCacheMissCount",
+        "Number of V2 requests missing from the response cache and processed");
+
+inline constexpr privacy_sandbox::server_common::metrics::Definition<
+    double, privacy_sandbox::server_common::metrics::Privacy::kNonImpacting,
+    privacy_sandbox::server_common::metrics::Instrument::kHistogram>
+    kLookupResponseCompressionRatio(
+        "LookupResponseCompressionRatio",
+        "Uncompressed size of a compressed internal lookup response divided "
+        "by its compressed size",
+        kCompressionRatioBoundaries);
+
+inline constexpr privacy_sandbox::server_common::metrics::Definition<
+    double, privacy_sandbox::server_common::metrics::Privacy::kNonImpacting,
+    privacy_sandbox::server_common::metrics::Instrument::kHistogram>
+    kLookupResponseCompressionLatency(
+        "LookupResponseCompressionLatency",
+        "Latency in compressing an internal lookup response",
+        kLatencyInMicroSecondsBoundaries);
+
+inline constexpr privacy_sandbox::server_common::metrics::Definition<
+    double, privacy_sandbox::server_common::metrics::Privacy::kNonImpacting,
+    privacy_sandbox::server_common::metrics::Instrument::kHistogram>
+    kLookupResponseDecompressionLatency(
+        "LookupResponseDecompressionLatency",
+        "Latency in decompressing an internal lookup response",
+        kLatencyInMicroSecondsBoundaries);
+
+inline constexpr privacy_sandbox::server_common::metrics::Definition<
+    double, privacy_sandbox::server_common::metrics::Privacy::kNonImpacting,
+    privacy_sandbox::server_common::metrics::Instrument::kPartitionedCounter>
+    kUdfExecutionCount(
+        "UdfExecutionCount",
+        "Number of UDF executions, by UDF version",
+        "udf_version",
+        privacy_sandbox::server_common::metrics::kEmptyPublicPartition);
+
+inline constexpr privacy_sandbox::server_common::metrics::Definition<
+    double, privacy_sandbox::server_common::metrics::Privacy::kNonImpacting,
+    privacy_sandbox::server_common::metrics::Instrument::kPartitionedCounter>
+    kUdfExecutionWallTimeMicros(
+        "UdfExecutionWallTimeMicros",
+        "Microseconds from sending UDF executions to their results, by UDF "
+        "version",
+        "udf_version",
+        privacy_sandbox::server_common::metrics::kEmptyPublicPartition);
+
+inline constexpr privacy_sandbox::server_common::metrics::Definition<
+    double, privacy_sandbox::server_common::metrics::Privacy::kNonImpacting,
+    privacy_sandbox::server_common::metrics::Instrument::kPartitionedCounter>
+    kUdfExecutionCpuTimeMicros(
+        "UdfExecutionCpuTimeMicros",
+        "Microseconds of server CPU time converting the inputs of UDF "
+        "executions or running native UDFs, by UDF version",
+        "udf_version",
+        privacy_sandbox::server_common::metrics::kEmptyPublicPartition);
+
+inline constexpr privacy_sandbox::server_common::metrics::Definition<
+    double, privacy_sandbox::server_common::metrics::Privacy::kNonImpacting,
+    privacy_sandbox::server_common::metrics::Instrument::kPartitionedCounter>
+    kUdfExecutionMarshalledBytes(
+        "UdfExecutionMarshalledBytes",
+        "Bytes of the inputs and outputs of UDF executions, by UDF version",
+        "udf_version",
+        privacy_sandbox::server_common::metrics::kEmptyPublicPartition);
+
+inline constexpr privacy_sandbox::server_common::metrics::Definition<
+    double, privacy_sandbox::server_common::metrics::Privacy::kNonImpacting,
+    privacy_sandbox::server_common::metrics::Instrument::kPartitionedCounter>
+    kUdfHookCallCount(
+        "UdfHookCallCount",
+        "Number of hook calls made by UDF executions, by UDF version and hook",
+        "udf_version_hook",
+        privacy_sandbox::server_common::metrics::kEmptyPublicPartition);
+
+inline constexpr privacy_sandbox::server_common::metrics::Definition<
+    double, privacy_sandbox::server_common::metrics::Privacy::kNonImpacting,
+    privacy_sandbox::server_common::metrics::Instrument::kPartitionedCounter>
+    kUdfHookWallTimeMicros(
+        "UdfHookWallTimeMicros",
+        "Microseconds in hook calls made by UDF executions, by UDF version "
+        "and hook",
+        "udf_version_hook",
+        privacy_sandbox::server_common::metrics::kEmptyPublicPartition);
+
+inline constexpr privacy_sandbox::server_common::metrics::Definition<
+    double, privacy_sandbox::server_common::metrics::Privacy::kNonImpacting,
+    privacy_sandbox::server_common::metrics::Instrument::kPartitionedCounter>
+    kUdfHookCpuTimeMicros(
+        "UdfHookCpuTimeMicros",
+        "Microseconds of CPU time of hook calls made by UDF executions, by "
+        "UDF version and hook",
+        "udf_version_hook",
+        privacy_sandbox::server_common::metrics::kEmptyPublicPartition);
+
+inline constexpr privacy_sandbox::server_common::metrics::Definition<
+    double, privacy_sandbox::server_common::metrics::Privacy::kNonImpacting,
+    privacy_sandbox::server_common::metrics::Instrument::kPartitionedCounter>
+    kUdfHookMarshalledBytes(
+        "UdfHookMarshalledBytes",
+        "Bytes of the inputs and outputs of hook calls made by UDF "
+        "executions, by UDF version and hook",
+        "udf_version_hook",
+        privacy_sandbox::server_common::metrics::kEmptyPublicPartition);
+
 // KV server metrics list contains contains non request related safe metrics
 // and request metrics collected before stage of internal lookups
 inline constexpr const privacy_sandbox::server_common::metrics::DefinitionName*
@@ -469,7 +975,8 @@ inline constexpr const privacy_sandbox::server_common::metrics::DefinitionName*
         &kShardedLookupGetKeyValuesLatencyInMicros,
         &kShardedLookupGetKeyValueSetLatencyInMicros,
         &kShardedLookupRunQueryLatencyInMicros,
-        &kRemoteLookupGetValuesLatencyInMicros,
+        &kRemoteLookupGetValuesLatencyInMicros, &kQueryCacheAccessEventCount,
+        &kRequestLookupCacheAccessEventCount,
         // Safe metrics
         &kKVServerError,
         &privacy_sandbox::server_common::metrics::kTotalRequestCount,
@@ -483,17 +990,58 @@ inline constexpr const privacy_sandbox::server_common::metrics::DefinitionName*
         &kDescribeInstancesStatus,
         &kReceivedLowLatencyNotificationsE2ECloudProvided,
         &kReceivedLowLatencyNotificationsE2E, &kReceivedLowLatencyNotifications,
+        &kRealtimeApplyQueueDepth, &kRealtimeApplyLag,
         &kAwsSqsReceiveMessageLatency, &kSeekingInputStreambufSeekoffLatency,
         &kSeekingInputStreambufSizeLatency,
         &kSeekingInputStreambufUnderflowLatency,
         &kTotalRowsDroppedInDataLoading, &kTotalRowsUpdatedInDataLoading,
         &kTotalRowsDeletedInDataLoading,
+        &kDataLoadingStageTimeMicros, &kDataLoadingRecordBytes,
         &kConcurrentStreamRecordReaderReadShardRecordsLatency,
         &kConcurrentStreamRecordReaderReadStreamRecordsLatency,
+        &kConcurrentStreamRecordReaderShardQueueLatency,
         &kConcurrentStreamRecordReaderReadByteRangeLatency,
+        &kInitSnapshotFilesLoadingLatency, &kInitDeltaFilesLoadingLatency,
+        &kDeltaFileNotificationToLoadLatency,
         &kUpdateKeyValueLatency, &kUpdateKeyValueSetLatency, &kDeleteKeyLatency,
-        &kDeleteValuesInSetLatency, &kRemoveDeletedKeyLatency,
-        &kCleanUpKeyValueMapLatency, &kCleanUpKeyValueSetMapLatency};
+        &kDeleteValuesInSetLatency, &kApplyCacheMutationBatchLatency,
+        &kRemoveDeletedKeyLatency, &kCleanUpKeyValueMapLatency,
+        &kCleanUpKeyValueSetMapLatency,
+        &kBackgroundCleanUpPauseLatency,
+        &kCacheTombstoneCount,
+        &kCachePrefixKeyCount, &kCachePrefixValueBytes,
+        &kCachePrefixSetValueCount, &kCachePrefixTombstoneCount,
+        &kDataFreshnessLagSeconds, &kDataPendingFileCount,
+        &kHeapAllocatorBytes,
+        &kCacheKeyMapLockWaitTime, &kCacheKeyMapLockHoldTime,
+        &kCacheSetMapLockWaitTime, &kCacheSetMapLockHoldTime,
+        &kCacheValueSetLockWaitTime, &kCacheValueSetLockHoldTime,
+        &kShardManagerLockWaitTime, &kShardManagerLockHoldTime,
+        &kDeltaFileQueueLockWaitTime, &kDeltaFileQueueLockHoldTime,
+        &kRealtimeCoalescerLockWaitTime, &kRealtimeCoalescerLockHoldTime,
+        &kShardedLookupExecutorQueueDepth,
+        &kShardedLookupExecutorQueueLatencyInMicros,
+        &kShardedLookupHedgedLookupCount,
+        &kRealtimeCoalescedMutationCount,
+        &kUdfExecutionQueueDepth,
+        &kUdfExecutionRejectedCount,
+        &kLookupBatchCallerCount,
+        &kLookupBatchKeyCount,
+        &kLookupCacheHitCount,
+        &kLookupCacheMissCount,
+        &kResponseCacheHitCount,
+        &kResponseCacheMissCount,
+        &kLookupResponseCompressionRatio,
+        &kLookupResponseCompressionLatency,
+        &kLookupResponseDecompressionLatency,
+        &kUdfExecutionCount,
+        &kUdfExecutionWallTimeMicros,
+        &kUdfExecutionCpuTimeMicros,
+        &kUdfExecutionMarshalledBytes,
+        &kUdfHookCallCount,
+        &kUdfHookWallTimeMicros,
+        &kUdfHookCpuTimeMicros,
+        &kUdfHookMarshalledBytes};
 
 // Internal lookup service metrics list contains metrics collected in the
 // internal lookup server. This separation from KV metrics list allows all
@@ -510,7 +1058,8 @@ inline constexpr const privacy_sandbox::server_common::metrics::DefinitionName*
         &kInternalGetKeyValuesLatencyInMicros,
         &kInternalGetKeyValueSetLatencyInMicros,
         &kInternalSecureLookupLatencyInMicros, &kGetValuePairsLatencyInMicros,
-        &kGetKeyValueSetLatencyInMicros, &kCacheAccessEventCount};
+        &kGetKeyValueSetLatencyInMicros, &kCacheAccessEventCount,
+        &kQueryCacheAccessEventCount};
 
 inline constexpr absl::Span<
     const privacy_sandbox::server_common::metrics::DefinitionName* const>
@@ -629,19 +1178,10 @@ inline void LogRequestCommonSafeMetrics(
     const RequestT* request, const ResponseT* response,
     const grpc::Status& grpc_request_status,
     const absl::Time& request_received_time) {
-  LogIfError(
-      KVServerContextMap()
-          ->SafeMetric()
-          .LogUpDownCounter<
-              privacy_sandbox::server_common::metrics::kTotalRequestCount>(1));
-  if (auto request_status =
-          privacy_sandbox::server_common::ToAbslStatus(grpc_request_status);
-      !request_status.ok()) {
-    LogIfError(KVServerContextMap()
-                   ->SafeMetric()
-                   .LogUpDownCounter<kRequestFailedCountByStatus>(
-                       {{absl::StatusCodeToString(request_status.code()), 1}}));
-  }
+  const absl::Duration latency = absl::Now() - request_received_time;
+  // Exported by `LogRequestCounts`.
+  RequestCounters::Global().Add(
+      static_cast<absl::StatusCode>(grpc_request_status.error_code()), latency);
   LogIfError(KVServerContextMap()
                  ->SafeMetric()
                  .template LogHistogram<
@@ -652,8 +1192,7 @@ inline void LogRequestCommonSafeMetrics(
                  .template LogHistogram<
                      privacy_sandbox::server_common::metrics::kResponseByte>(
                      (int)response->ByteSizeLong()));
-  int duration_ms =
-      (absl::Now() - request_received_time) / absl::Milliseconds(1);
+  int duration_ms = latency / absl::Milliseconds(1);
   LogIfError(
       KVServerContextMap()
           ->SafeMetric()
@@ -662,16 +1201,145 @@ inline void LogRequestCommonSafeMetrics(
               duration_ms));
 }
 
+// Logs the requests counted by `LogRequestCommonSafeMetrics` since the
+// previous call. Called periodically by the server.
+inline void LogRequestCounts() {
+  const RequestCounters::Counts counts = RequestCounters::Global().Take();
+  if (counts.num_requests > 0) {
+    LogIfError(
+        KVServerContextMap()
+            ->SafeMetric()
+            .LogUpDownCounter<
+                privacy_sandbox::server_common::metrics::kTotalRequestCount>(
+                static_cast<int>(counts.num_requests)));
+  }
+  for (int code = 0; code < RequestCounters::kNumStatusCodes; code++) {
+    if (counts.num_failed_requests[code] == 0) {
+      continue;
+    }
+    LogIfError(KVServerContextMap()
+                   ->SafeMetric()
+                   .LogUpDownCounter<kRequestFailedCountByStatus>(
+                       {{absl::StatusCodeToString(
+                             static_cast<absl::StatusCode>(code)),
+                         static_cast<int>(counts.num_failed_requests[code])}}));
+  }
+}
+
+template <const auto& definition>
+inline void LogUdfUsageCounter(const std::string& partition, double value) {
+  if (value == 0) {
+    return;
+  }
+  LogIfError(KVServerContextMap()->SafeMetric().LogUpDownCounter<definition>(
+      {{partition, value}}));
+}
+
+// Logs the UDF usage accounted by `UdfUsageCounters::Global()` since the
+// previous call, partitioned by UDF version, e.g. "v3", and by UDF version
+// and hook, e.g. "v3/getValues". Called periodically by the server.
+inline void LogUdfUsage() {
+  for (const auto& [udf_version, usage] : UdfUsageCounters::Global().Take()) {
+    const std::string version = absl::StrCat("v", udf_version);
+    LogUdfUsageCounter<kUdfExecutionCount>(version, usage.num_executions);
+    LogUdfUsageCounter<kUdfExecutionWallTimeMicros>(
+        version, absl::ToDoubleMicroseconds(usage.wall_time));
+    LogUdfUsageCounter<kUdfExecutionCpuTimeMicros>(
+        version, absl::ToDoubleMicroseconds(usage.cpu_time));
+    LogUdfUsageCounter<kUdfExecutionMarshalledBytes>(version,
+                                                     usage.marshalled_bytes);
+    for (int i = 0; i < UdfUsageCounters::kNumHooks; i++) {
+      const UdfUsageCounters::HookUsage& hook_usage = usage.hooks[i];
+      const std::string version_hook = absl::StrCat(
+          version, "/",
+          UdfUsageCounters::HookName(static_cast<UdfUsageCounters::Hook>(i)));
+      LogUdfUsageCounter<kUdfHookCallCount>(version_hook,
+                                            hook_usage.num_calls);
+      LogUdfUsageCounter<kUdfHookWallTimeMicros>(
+          version_hook, absl::ToDoubleMicroseconds(hook_usage.wall_time));
+      LogUdfUsageCounter<kUdfHookCpuTimeMicros>(
+          version_hook, absl::ToDoubleMicroseconds(hook_usage.cpu_time));
+      LogUdfUsageCounter<kUdfHookMarshalledBytes>(version_hook,
+                                                  hook_usage.marshalled_bytes);
+    }
+  }
+}
+
+// Partitioned counter of a request, counted without locks and added to the
+// metrics context of the request once, when the request ends. Accumulating a
+// privacy impacting metric takes the lock of the context, which lookups would
+// otherwise take on every access. `partitions` must be the partitions of
+// `definition`.
+template <const auto& definition, const auto& partitions>
+class BatchedPartitionedCounter {
+ public:
+  void Add(std::string_view partition, int count = 1) {
+    for (size_t i = 0; i < counts_.size(); i++) {
+      if (partitions[i] == partition) {
+        counts_[i].fetch_add(count, std::memory_order_relaxed);
+        return;
+      }
+    }
+  }
+
+  // Accumulates the counts into `metrics_context`, and resets them.
+  template <typename ContextT>
+  void Flush(ContextT& metrics_context) {
+    for (size_t i = 0; i < counts_.size(); i++) {
+      if (const int count = counts_[i].exchange(0, std::memory_order_relaxed);
+          count != 0) {
+        LogIfError(metrics_context.template AccumulateMetric<definition>(
+            count, partitions[i]));
+      }
+    }
+  }
+
+ private:
+  std::array<std::atomic<int>, std::size(partitions)> counts_ = {};
+};
+
+// Counters of a request that lookups update many times per request. They are
+// noised and published with the rest of the metrics of the request, once the
+// counts are flushed into its metrics contexts.
+struct RequestMetricsBatch {
+  // Of the UDF request metrics context.
+  BatchedPartitionedCounter<kRequestLookupCacheAccessEventCount,
+                            kRequestLookupCacheAccessEvents>
+      request_lookup_cache_access_events;
+  BatchedPartitionedCounter<kQueryCacheAccessEventCount,
+                            kQueryCacheAccessEvents>
+      sharded_query_cache_access_events;
+  // Of the internal lookup metrics context.
+  BatchedPartitionedCounter<kCacheAccessEventCount, kCacheAccessEvents>
+      cache_access_events;
+  BatchedPartitionedCounter<kQueryCacheAccessEventCount,
+                            kQueryCacheAccessEvents>
+      local_query_cache_access_events;
+
+  // Accumulates the counts into the metrics contexts of the request, and
+  // resets them.
+  template <typename UdfContextT, typename InternalLookupContextT>
+  void Flush(UdfContextT& udf_request_metrics_context,
+             InternalLookupContextT& internal_lookup_metrics_context) {
+    request_lookup_cache_access_events.Flush(udf_request_metrics_context);
+    sharded_query_cache_access_events.Flush(udf_request_metrics_context);
+    cache_access_events.Flush(internal_lookup_metrics_context);
+    local_query_cache_access_events.Flush(internal_lookup_metrics_context);
+  }
+};
+
 // ScopeMetricsContext provides metrics context ties to the request and
 // should have the same lifetime of the request.
 // The purpose of this class is to avoid explicit creating and deleting metrics
 // context from context map. The metrics context associated with the request
 // will be destroyed after ScopeMetricsContext goes out of scope.
+//
+// The context maps key the metrics contexts by the address of the request id
+// rather than its value, so the request id is optional, and none is generated
+// for every request.
 class ScopeMetricsContext {
  public:
-  explicit ScopeMetricsContext(
-      std::string request_id = google::scp::core::common::ToString(
-          google::scp::core::common::Uuid::GenerateUuid()))
+  explicit ScopeMetricsContext(std::string request_id = "")
       : request_id_(std::move(request_id)) {
     // Create a metrics context in the context map and
     // associated it with request id
@@ -697,12 +1365,20 @@ class ScopeMetricsContext {
       return absl::OkStatus();
     }()) << "Internal lookup metrics context is not initialized";
   }
+  ScopeMetricsContext(const ScopeMetricsContext&) = delete;
+  ScopeMetricsContext& operator=(const ScopeMetricsContext&) = delete;
+  ~ScopeMetricsContext() {
+    metrics_batch_.Flush(*udf_request_metrics_context_,
+                         *internal_lookup_metrics_context_);
+  }
   UdfRequestMetricsContext& GetUdfRequestMetricsContext() const {
     return *udf_request_metrics_context_;
   }
   InternalLookupMetricsContext& GetInternalLookupMetricsContext() const {
     return *internal_lookup_metrics_context_;
   }
+  // Added to the metrics contexts when the request ends.
+  RequestMetricsBatch& GetMetricsBatch() const { return metrics_batch_; }
 
  private:
   const std::string request_id_;
@@ -710,6 +1386,7 @@ class ScopeMetricsContext {
   std::unique_ptr<UdfRequestMetricsContext> udf_request_metrics_context_;
   std::unique_ptr<InternalLookupMetricsContext>
       internal_lookup_metrics_context_;
+  mutable RequestMetricsBatch metrics_batch_;
 };
 
 // Measures the latency of a block of code. The latency is recorded in
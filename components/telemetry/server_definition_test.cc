@@ -0,0 +1,142 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/telemetry/server_definition.h"
+
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace kv_server {
+namespace {
+
+using testing::IsEmpty;
+using testing::UnorderedElementsAre;
+
+// The definition, partition and count of an accumulated metric.
+using Accumulated = std::tuple<const void*, std::string, int>;
+
+// Records the metrics accumulated into it.
+struct FakeMetricsContext {
+  template <const auto& definition>
+  absl::Status AccumulateMetric(int count, std::string_view partition) {
+    accumulated.emplace_back(&definition, std::string(partition), count);
+    return absl::OkStatus();
+  }
+
+  std::vector<Accumulated> accumulated;
+};
+
+using CacheAccessEventsCounter =
+    BatchedPartitionedCounter<kCacheAccessEventCount, kCacheAccessEvents>;
+
+TEST(BatchedPartitionedCounterTest, SumsCountsOfPartitions) {
+  CacheAccessEventsCounter counter;
+  counter.Add(kKeyValueCacheHit);
+  counter.Add(kKeyValueCacheHit, 2);
+  counter.Add(kKeyValueSetCacheMiss);
+  FakeMetricsContext context;
+  counter.Flush(context);
+  EXPECT_THAT(context.accumulated,
+              UnorderedElementsAre(
+                  Accumulated(&kCacheAccessEventCount,
+                              std::string(kKeyValueCacheHit), 3),
+                  Accumulated(&kCacheAccessEventCount,
+                              std::string(kKeyValueSetCacheMiss), 1)));
+}
+
+TEST(BatchedPartitionedCounterTest, DropsUnknownPartitions) {
+  CacheAccessEventsCounter counter;
+  counter.Add("UnknownPartition");
+  counter.Add(kQueryCacheHit);
+  FakeMetricsContext context;
+  counter.Flush(context);
+  EXPECT_THAT(context.accumulated, IsEmpty());
+}
+
+TEST(BatchedPartitionedCounterTest, FlushResetsCounts) {
+  CacheAccessEventsCounter counter;
+  counter.Add(kKeyValueCacheMiss, 5);
+  FakeMetricsContext context;
+  counter.Flush(context);
+  FakeMetricsContext flushed_again_context;
+  counter.Flush(flushed_again_context);
+  EXPECT_THAT(flushed_again_context.accumulated, IsEmpty());
+  counter.Add(kKeyValueCacheMiss);
+  FakeMetricsContext later_context;
+  counter.Flush(later_context);
+  EXPECT_THAT(later_context.accumulated,
+              UnorderedElementsAre(Accumulated(
+                  &kCacheAccessEventCount, std::string(kKeyValueCacheMiss),
+                  1)));
+}
+
+TEST(BatchedPartitionedCounterTest, AddsUpThreads) {
+  constexpr int kNumThreads = 8;
+  constexpr int kNumAdds = 1000;
+  CacheAccessEventsCounter counter;
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kNumThreads; i++) {
+    threads.emplace_back([&counter] {
+      for (int j = 0; j < kNumAdds; j++) {
+        counter.Add(kKeyValueSetCacheHit);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  FakeMetricsContext context;
+  counter.Flush(context);
+  EXPECT_THAT(context.accumulated,
+              UnorderedElementsAre(Accumulated(
+                  &kCacheAccessEventCount, std::string(kKeyValueSetCacheHit),
+                  kNumThreads * kNumAdds)));
+}
+
+TEST(RequestMetricsBatchTest, FlushesEachCounterIntoItsContextOnce) {
+  RequestMetricsBatch batch;
+  batch.request_lookup_cache_access_events.Add(kRequestLookupCacheHit);
+  batch.sharded_query_cache_access_events.Add(kQueryCacheMiss, 2);
+  batch.cache_access_events.Add(kKeyValueCacheHit, 3);
+  batch.local_query_cache_access_events.Add(kQueryCacheHit, 4);
+  FakeMetricsContext udf_request_context;
+  FakeMetricsContext internal_lookup_context;
+  batch.Flush(udf_request_context, internal_lookup_context);
+  EXPECT_THAT(udf_request_context.accumulated,
+              UnorderedElementsAre(
+                  Accumulated(&kRequestLookupCacheAccessEventCount,
+                              std::string(kRequestLookupCacheHit), 1),
+                  Accumulated(&kQueryCacheAccessEventCount,
+                              std::string(kQueryCacheMiss), 2)));
+  EXPECT_THAT(internal_lookup_context.accumulated,
+              UnorderedElementsAre(
+                  Accumulated(&kCacheAccessEventCount,
+                              std::string(kKeyValueCacheHit), 3),
+                  Accumulated(&kQueryCacheAccessEventCount,
+                              std::string(kQueryCacheHit), 4)));
+  // A request flushes its batch once, a later flush would add nothing.
+  FakeMetricsContext udf_request_context_again;
+  FakeMetricsContext internal_lookup_context_again;
+  batch.Flush(udf_request_context_again, internal_lookup_context_again);
+  EXPECT_THAT(udf_request_context_again.accumulated, IsEmpty());
+  EXPECT_THAT(internal_lookup_context_again.accumulated, IsEmpty());
+}
+
+}  // namespace
+}  // namespace kv_server
@@ -0,0 +1,114 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Measures the overhead of the telemetry of a request: creating its metrics
+// contexts, which noise and publish its privacy impacting metrics when
+// destroyed, counting its lookups, and recording latencies and safe metrics.
+//
+//  bazel run -c opt //components/telemetry:telemetry_benchmark \
+//    --//:instance=local --//:platform=local
+
+#include "absl/status/status.h"
+#include "absl/time/time.h"
+#include "benchmark/benchmark.h"
+#include "components/telemetry/request_counters.h"
+#include "components/telemetry/server_definition.h"
+
+namespace kv_server {
+namespace {
+
+void BM_ScopeMetricsContext(benchmark::State& state) {
+  for (auto _ : state) {
+    ScopeMetricsContext metrics_context;
+    benchmark::DoNotOptimize(metrics_context);
+  }
+}
+
+// Requests counting `state.range(0)` cache accesses on their metrics context.
+void BM_AccumulatePerAccess(benchmark::State& state) {
+  const int64_t num_accesses = state.range(0);
+  for (auto _ : state) {
+    ScopeMetricsContext metrics_context;
+    for (int64_t i = 0; i < num_accesses; i++) {
+      LogIfError(
+          metrics_context.GetInternalLookupMetricsContext()
+              .AccumulateMetric<kCacheAccessEventCount>(
+                  1, i % 2 == 0 ? kKeyValueCacheHit : kKeyValueCacheMiss));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * num_accesses);
+}
+
+// Requests counting `state.range(0)` cache accesses in their metrics batch,
+// flushed into the metrics context when the request ends.
+void BM_BatchedPerAccess(benchmark::State& state) {
+  const int64_t num_accesses = state.range(0);
+  for (auto _ : state) {
+    ScopeMetricsContext metrics_context;
+    for (int64_t i = 0; i < num_accesses; i++) {
+      metrics_context.GetMetricsBatch().cache_access_events.Add(
+          i % 2 == 0 ? kKeyValueCacheHit : kKeyValueCacheMiss);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * num_accesses);
+}
+
+// Requests recording `state.range(0)` lookup latencies.
+void BM_LatencyRecorder(benchmark::State& state) {
+  const int64_t num_lookups = state.range(0);
+  for (auto _ : state) {
+    ScopeMetricsContext metrics_context;
+    for (int64_t i = 0; i < num_lookups; i++) {
+      ScopeLatencyMetricsRecorder<InternalLookupMetricsContext,
+                                  kGetValuePairsLatencyInMicros>
+          latency_recorder(metrics_context.GetInternalLookupMetricsContext());
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * num_lookups);
+}
+
+// Safe counters logged by every request, from concurrent threads.
+void BM_SafeUpDownCounter(benchmark::State& state) {
+  for (auto _ : state) {
+    LogIfError(KVServerContextMap()
+                   ->SafeMetric()
+                   .LogUpDownCounter<kLookupCacheHitCount>(1));
+  }
+}
+
+// Request counters, which are exported once per interval instead.
+void BM_RequestCounters(benchmark::State& state) {
+  for (auto _ : state) {
+    RequestCounters::Global().Add(absl::StatusCode::kOk,
+                                  absl::Microseconds(100));
+  }
+}
+
+BENCHMARK(BM_ScopeMetricsContext);
+BENCHMARK(BM_AccumulatePerAccess)->Range(1, 1024);
+BENCHMARK(BM_BatchedPerAccess)->Range(1, 1024);
+BENCHMARK(BM_LatencyRecorder)->Range(1, 1024);
+BENCHMARK(BM_SafeUpDownCounter)->ThreadRange(1, 16);
+BENCHMARK(BM_RequestCounters)->ThreadRange(1, 16);
+
+}  // namespace
+}  // namespace kv_server
+
+int main(int argc, char** argv) {
+  ::benchmark::Initialize(&argc, argv);
+  kv_server::InitMetricsContextMap();
+  ::benchmark::RunSpecifiedBenchmarks();
+  ::benchmark::Shutdown();
+  return 0;
+}
@@ -0,0 +1,119 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/telemetry/udf_usage_counters.h"
+
+#include <time.h>
+
+#include <atomic>
+#include <utility>
+
+namespace kv_server {
+namespace {
+
+// Index of the stripe of the calling thread, assigned in turn like the
+// stripes of `RequestCounters`.
+int StripeIndex(int num_stripes) {
+  static std::atomic<int> next_index = 0;
+  thread_local const int index =
+      next_index.fetch_add(1, std::memory_order_relaxed);
+  return index % num_stripes;
+}
+
+void AddHookUsage(const UdfUsageCounters::HookUsage& from,
+                  UdfUsageCounters::HookUsage& to) {
+  to.num_calls += from.num_calls;
+  to.wall_time += from.wall_time;
+  to.cpu_time += from.cpu_time;
+  to.marshalled_bytes += from.marshalled_bytes;
+}
+
+}  // namespace
+
+void UdfUsageCounters::AddExecutions(int64_t udf_version,
+                                     int64_t num_executions,
+                                     absl::Duration wall_time,
+                                     absl::Duration cpu_time,
+                                     int64_t marshalled_bytes) {
+  Stripe& stripe = stripes_[StripeIndex(kNumStripes)];
+  absl::MutexLock lock(&stripe.mutex);
+  Usage& usage = stripe.usage[udf_version];
+  usage.num_executions += num_executions;
+  usage.wall_time += wall_time;
+  usage.cpu_time += cpu_time;
+  usage.marshalled_bytes += marshalled_bytes;
+}
+
+void UdfUsageCounters::AddHookCall(int64_t udf_version, Hook hook,
+                                   absl::Duration wall_time,
+                                   absl::Duration cpu_time,
+                                   int64_t marshalled_bytes) {
+  Stripe& stripe = stripes_[StripeIndex(kNumStripes)];
+  absl::MutexLock lock(&stripe.mutex);
+  AddHookUsage({.num_calls = 1,
+                .wall_time = wall_time,
+                .cpu_time = cpu_time,
+                .marshalled_bytes = marshalled_bytes},
+               stripe.usage[udf_version].hooks[static_cast<int>(hook)]);
+}
+
+absl::flat_hash_map<int64_t, UdfUsageCounters::Usage>
+UdfUsageCounters::Take() {
+  absl::flat_hash_map<int64_t, Usage> total_usage;
+  for (Stripe& stripe : stripes_) {
+    absl::flat_hash_map<int64_t, Usage> usage;
+    {
+      absl::MutexLock lock(&stripe.mutex);
+      usage = std::exchange(stripe.usage, {});
+    }
+    for (const auto& [udf_version, version_usage] : usage) {
+      Usage& total = total_usage[udf_version];
+      total.num_executions += version_usage.num_executions;
+      total.wall_time += version_usage.wall_time;
+      total.cpu_time += version_usage.cpu_time;
+      total.marshalled_bytes += version_usage.marshalled_bytes;
+      for (int i = 0; i < kNumHooks; i++) {
+        AddHookUsage(version_usage.hooks[i], total.hooks[i]);
+      }
+    }
+  }
+  return total_usage;
+}
+
+UdfUsageCounters& UdfUsageCounters::Global() {
+  static auto* const counters = new UdfUsageCounters();
+  return *counters;
+}
+
+absl::Duration UdfUsageCounters::ThreadCpuTime() {
+  timespec cpu_time;
+  if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu_time) != 0) {
+    return absl::ZeroDuration();
+  }
+  return absl::DurationFromTimespec(cpu_time);
+}
+
+std::string_view UdfUsageCounters::HookName(Hook hook) {
+  switch (hook) {
+    case Hook::kGetValues:
+      return "getValues";
+    case Hook::kRunQuery:
+      return "runQuery";
+    case Hook::kLogging:
+      return "logging";
+  }
+  return "unknown";
+}
+
+}  // namespace kv_server
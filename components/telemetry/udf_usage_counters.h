@@ -0,0 +1,137 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef COMPONENTS_TELEMETRY_UDF_USAGE_COUNTERS_H_
+#define COMPONENTS_TELEMETRY_UDF_USAGE_COUNTERS_H_
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+
+#include "absl/base/config.h"
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+
+namespace kv_server {
+
+// Accounts the time and the bytes spent on UDF executions and on the hooks
+// they call, by UDF code version, so that the cost of a new version can be
+// compared with the previous one during a rollout. Like `RequestCounters`,
+// usage is added in stripes that threads mostly have to themselves, and taken
+// by the periodic export of the metrics.
+//
+// Thread safe.
+class UdfUsageCounters {
+ public:
+  enum class Hook { kGetValues, kRunQuery, kLogging };
+  static constexpr int kNumHooks = 3;
+
+  struct HookUsage {
+    int64_t num_calls = 0;
+    absl::Duration wall_time;
+    // CPU time of the threads running the hook.
+    absl::Duration cpu_time;
+    // Bytes of the inputs and outputs passed between the UDF and the hook.
+    int64_t marshalled_bytes = 0;
+  };
+
+  struct Usage {
+    int64_t num_executions = 0;
+    // From sending an execution to Roma to its result.
+    absl::Duration wall_time;
+    // CPU time of the server threads converting the inputs, or running native
+    // UDFs. Roma runs JavaScript and WASM UDFs on its own workers, whose CPU
+    // time is the difference between the wall time and the time in hooks.
+    absl::Duration cpu_time;
+    // Bytes of the inputs and outputs of the executions.
+    int64_t marshalled_bytes = 0;
+    // Indexed by `Hook`.
+    std::array<HookUsage, kNumHooks> hooks;
+  };
+
+  UdfUsageCounters() = default;
+  UdfUsageCounters(const UdfUsageCounters&) = delete;
+  UdfUsageCounters& operator=(const UdfUsageCounters&) = delete;
+
+  // Adds `num_executions` executions of `udf_version`, e.g. the executions of
+  // one batch.
+  void AddExecutions(int64_t udf_version, int64_t num_executions,
+                     absl::Duration wall_time, absl::Duration cpu_time,
+                     int64_t marshalled_bytes);
+
+  // Adds a call of `hook` by an execution of `udf_version`.
+  void AddHookCall(int64_t udf_version, Hook hook, absl::Duration wall_time,
+                   absl::Duration cpu_time, int64_t marshalled_bytes);
+
+  // Returns the usage of each UDF version since the previous call, and resets
+  // it.
+  absl::flat_hash_map<int64_t, Usage> Take();
+
+  // Counters of the UDF executions of the server.
+  static UdfUsageCounters& Global();
+
+  // Returns the CPU time of the calling thread.
+  static absl::Duration ThreadCpuTime();
+
+  // Returns the name of `hook` in the metrics, e.g. "getValues".
+  static std::string_view HookName(Hook hook);
+
+ private:
+  static constexpr int kNumStripes = 16;
+
+  struct alignas(ABSL_CACHELINE_SIZE) Stripe {
+    absl::Mutex mutex;
+    absl::flat_hash_map<int64_t, Usage> usage ABSL_GUARDED_BY(mutex);
+  };
+
+  std::array<Stripe, kNumStripes> stripes_;
+};
+
+// Measures the wall and thread CPU time of a hook call, and adds them to
+// `UdfUsageCounters::Global()` when going out of scope.
+class ScopeUdfHookUsageRecorder {
+ public:
+  ScopeUdfHookUsageRecorder(int64_t udf_version, UdfUsageCounters::Hook hook)
+      : udf_version_(udf_version),
+        hook_(hook),
+        start_(absl::Now()),
+        start_cpu_time_(UdfUsageCounters::ThreadCpuTime()) {}
+  ScopeUdfHookUsageRecorder(const ScopeUdfHookUsageRecorder&) = delete;
+  ScopeUdfHookUsageRecorder& operator=(const ScopeUdfHookUsageRecorder&) =
+      delete;
+
+  ~ScopeUdfHookUsageRecorder() {
+    UdfUsageCounters::Global().AddHookCall(
+        udf_version_, hook_, absl::Now() - start_,
+        UdfUsageCounters::ThreadCpuTime() - start_cpu_time_,
+        marshalled_bytes_);
+  }
+
+  void AddMarshalledBytes(int64_t bytes) { marshalled_bytes_ += bytes; }
+
+ private:
+  const int64_t udf_version_;
+  const UdfUsageCounters::Hook hook_;
+  const absl::Time start_;
+  const absl::Duration start_cpu_time_;
+  int64_t marshalled_bytes_ = 0;
+};
+
+}  // namespace kv_server
+
+#endif  // COMPONENTS_TELEMETRY_UDF_USAGE_COUNTERS_H_
@@ -0,0 +1,102 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/telemetry/udf_usage_counters.h"
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace kv_server {
+namespace {
+
+using Hook = UdfUsageCounters::Hook;
+
+int HookIndex(Hook hook) { return static_cast<int>(hook); }
+
+TEST(UdfUsageCountersTest, AddsUsageByVersion) {
+  UdfUsageCounters counters;
+  counters.AddExecutions(1, 1, absl::Milliseconds(3), absl::Milliseconds(1),
+                         100);
+  counters.AddExecutions(1, 4, absl::Milliseconds(5), absl::Milliseconds(2),
+                         50);
+  counters.AddExecutions(2, 1, absl::Milliseconds(7), absl::Milliseconds(3),
+                         10);
+  counters.AddHookCall(2, Hook::kRunQuery, absl::Milliseconds(2),
+                       absl::Milliseconds(1), 20);
+  counters.AddHookCall(2, Hook::kRunQuery, absl::Milliseconds(2),
+                       absl::Milliseconds(1), 30);
+  const auto usage = counters.Take();
+  ASSERT_EQ(usage.size(), 2);
+  const UdfUsageCounters::Usage& v1 = usage.at(1);
+  EXPECT_EQ(v1.num_executions, 5);
+  EXPECT_EQ(v1.wall_time, absl::Milliseconds(8));
+  EXPECT_EQ(v1.cpu_time, absl::Milliseconds(3));
+  EXPECT_EQ(v1.marshalled_bytes, 150);
+  EXPECT_EQ(v1.hooks[HookIndex(Hook::kRunQuery)].num_calls, 0);
+  const UdfUsageCounters::Usage& v2 = usage.at(2);
+  EXPECT_EQ(v2.num_executions, 1);
+  const UdfUsageCounters::HookUsage& run_query =
+      v2.hooks[HookIndex(Hook::kRunQuery)];
+  EXPECT_EQ(run_query.num_calls, 2);
+  EXPECT_EQ(run_query.wall_time, absl::Milliseconds(4));
+  EXPECT_EQ(run_query.cpu_time, absl::Milliseconds(2));
+  EXPECT_EQ(run_query.marshalled_bytes, 50);
+  EXPECT_EQ(v2.hooks[HookIndex(Hook::kGetValues)].num_calls, 0);
+}
+
+TEST(UdfUsageCountersTest, TakeResetsUsage) {
+  UdfUsageCounters counters;
+  counters.AddExecutions(1, 1, absl::Milliseconds(1), absl::Milliseconds(1),
+                         1);
+  counters.Take();
+  EXPECT_TRUE(counters.Take().empty());
+}
+
+TEST(UdfUsageCountersTest, AddsUpThreads) {
+  constexpr int kNumThreads = 40;
+  constexpr int kNumCalls = 1000;
+  auto counters = std::make_unique<UdfUsageCounters>();
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kNumThreads; i++) {
+    threads.emplace_back([&counters] {
+      for (int j = 0; j < kNumCalls; j++) {
+        counters->AddHookCall(3, Hook::kGetValues, absl::Microseconds(1),
+                              absl::Microseconds(1), 1);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  const auto usage = counters->Take();
+  const UdfUsageCounters::HookUsage& get_values =
+      usage.at(3).hooks[HookIndex(Hook::kGetValues)];
+  EXPECT_EQ(get_values.num_calls, kNumThreads * kNumCalls);
+  EXPECT_EQ(get_values.marshalled_bytes, kNumThreads * kNumCalls);
+}
+
+TEST(UdfUsageCountersTest, ThreadCpuTimeIncreases) {
+  const absl::Duration start = UdfUsageCounters::ThreadCpuTime();
+  volatile int64_t sum = 0;
+  for (int i = 0; i < 10'000'000; i++) {
+    sum = sum + i;
+  }
+  EXPECT_GT(UdfUsageCounters::ThreadCpuTime(), start);
+}
+
+}  // namespace
+}  // namespace kv_server
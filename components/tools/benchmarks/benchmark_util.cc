@@ -16,6 +16,8 @@
 
 #include "components/tools/benchmarks/benchmark_util.h"
 
+#include <algorithm>
+#include <cmath>
 #include <string>
 #include <utility>
 #include <vector>
@@ -68,6 +70,11 @@ absl::Status WriteRecords(int64_t num_records, const int64_t record_size,
   if (!record_writer.ok()) {
     return record_writer.status();
   }
+  return WriteRecords(num_records, record_size, **record_writer);
+}
+
+absl::Status WriteRecords(int64_t num_records, const int64_t record_size,
+                          DeltaRecordWriter& record_writer) {
   while (num_records > 0) {
     const std::string key = absl::StrCat("foo", num_records);
     const std::string value = GenerateRandomString(record_size);
@@ -77,9 +84,8 @@ absl::Status WriteRecords(int64_t num_records, const int64_t record_size,
         .key = key,
         .value = value,
     };
-    auto status = (*record_writer)
-                      ->WriteRecord(DataRecordStruct{
-                          .record = std::move(kv_mutation_record)});
+    auto status = record_writer.WriteRecord(
+        DataRecordStruct{.record = std::move(kv_mutation_record)});
     if (!status.ok()) {
       return status;
     }
@@ -101,4 +107,41 @@ absl::StatusOr<std::vector<int64_t>> ParseInt64List(
   return result;
 }
 
+absl::StatusOr<std::vector<double>> ParseDoubleList(
+    const std::vector<std::string>& num_list) {
+  std::vector<double> result;
+  for (std::string_view num_string : num_list) {
+    double num;
+    if (!absl::SimpleAtod(num_string, &num)) {
+      return absl::InvalidArgumentError("Failed to parse list into numbers.");
+    }
+    result.push_back(num);
+  }
+  return result;
+}
+
+ZipfianGenerator::ZipfianGenerator(int64_t num_keys, double exponent)
+    : num_keys_(std::max<int64_t>(num_keys, 1)) {
+  if (exponent == 0) {
+    return;
+  }
+  cumulative_weights_.reserve(num_keys_);
+  double total = 0;
+  for (int64_t i = 0; i < num_keys_; i++) {
+    total += 1 / std::pow(i + 1, exponent);
+    cumulative_weights_.push_back(total);
+  }
+}
+
+int64_t ZipfianGenerator::Next(std::mt19937_64& generator) const {
+  if (cumulative_weights_.empty()) {
+    return std::uniform_int_distribution<int64_t>(0, num_keys_ - 1)(generator);
+  }
+  const double weight = std::uniform_real_distribution<double>(
+      0, cumulative_weights_.back())(generator);
+  const auto it = std::upper_bound(cumulative_weights_.begin(),
+                                   cumulative_weights_.end(), weight);
+  return std::min<int64_t>(it - cumulative_weights_.begin(), num_keys_ - 1);
+}
+
 }  // namespace kv_server::benchmark
@@ -18,12 +18,14 @@
 #define COMPONENTS_TOOLS_BENCHMARKS_BENCHMARK_UTIL_H_
 
 #include <iostream>
+#include <random>
 #include <string>
 #include <thread>
 #include <vector>
 
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "public/data_loading/writers/delta_record_writer.h"
 
 namespace kv_server::benchmark {
 
@@ -52,10 +54,34 @@ std::string GenerateRandomString(const int64_t char_count);
 absl::Status WriteRecords(int64_t num_records, int64_t record_size,
                           std::iostream& output_stream);
 
+// Same as above, but writes the records with `record_writer`, e.g., to write
+// them in another file format.
+absl::Status WriteRecords(int64_t num_records, int64_t record_size,
+                          DeltaRecordWriter& record_writer);
+
 // Parses a numeric string list into a vector of int64 elements.
 absl::StatusOr<std::vector<int64_t>> ParseInt64List(
     const std::vector<std::string>& num_list);
 
+// Parses a numeric string list into a vector of double elements.
+absl::StatusOr<std::vector<double>> ParseDoubleList(
+    const std::vector<std::string>& num_list);
+
+// Draws indices in [0, num_keys) with probabilities proportional to
+// 1 / (index + 1)^exponent, so that the lowest indices are the hottest keys.
+// An exponent of 0 draws uniformly.
+class ZipfianGenerator {
+ public:
+  ZipfianGenerator(int64_t num_keys, double exponent);
+
+  int64_t Next(std::mt19937_64& generator) const;
+
+ private:
+  const int64_t num_keys_;
+  // Cumulative weights of the indices, empty when drawing uniformly.
+  std::vector<double> cumulative_weights_;
+};
+
 }  // namespace kv_server::benchmark
 
 #endif  // COMPONENTS_TOOLS_BENCHMARKS_BENCHMARK_UTIL_H_
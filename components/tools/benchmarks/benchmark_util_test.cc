@@ -17,6 +17,7 @@
 #include "components/tools/benchmarks/benchmark_util.h"
 
 #include <sstream>
+#include <vector>
 
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
@@ -45,6 +46,45 @@ TEST(BenchmarkUtilTest, VerifyParseInt64ListFailsWithInvalidList) {
   EXPECT_THAT(num_list.status().code(), absl::StatusCode::kInvalidArgument);
 }
 
+TEST(BenchmarkUtilTest, VerifyParseDoubleList) {
+  auto num_list = ParseDoubleList({"0", "0.99", "1.5"});
+  ASSERT_TRUE(num_list.ok()) << num_list.status();
+  EXPECT_THAT(*num_list, testing::ElementsAre(0, 0.99, 1.5));
+  EXPECT_EQ(ParseDoubleList({"zipf"}).status().code(),
+            absl::StatusCode::kInvalidArgument);
+}
+
+TEST(BenchmarkUtilTest, ZipfianGeneratorDrawsUniformlyWithZeroExponent) {
+  ZipfianGenerator zipfian(/*num_keys=*/10, /*exponent=*/0);
+  std::mt19937_64 generator(1);
+  std::vector<int> counts(10);
+  for (int i = 0; i < 10000; i++) {
+    const int64_t index = zipfian.Next(generator);
+    ASSERT_GE(index, 0);
+    ASSERT_LT(index, 10);
+    counts[index]++;
+  }
+  for (int count : counts) {
+    EXPECT_GT(count, 800);
+    EXPECT_LT(count, 1200);
+  }
+}
+
+TEST(BenchmarkUtilTest, ZipfianGeneratorFavorsLowIndices) {
+  ZipfianGenerator zipfian(/*num_keys=*/100, /*exponent=*/1);
+  std::mt19937_64 generator(1);
+  std::vector<int> counts(100);
+  for (int i = 0; i < 100000; i++) {
+    const int64_t index = zipfian.Next(generator);
+    ASSERT_GE(index, 0);
+    ASSERT_LT(index, 100);
+    counts[index]++;
+  }
+  // Index 0 is 10 times as likely as index 9.
+  EXPECT_GT(counts[0], 5 * counts[9]);
+  EXPECT_GT(counts[9], counts[99]);
+}
+
 TEST(BenchmarkUtilTest, VerifyWriteRecords) {
   std::stringstream data_stream;
   int64_t num_records = 1000;
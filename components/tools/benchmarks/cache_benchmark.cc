@@ -13,12 +13,19 @@
  * See the License for the specific language governing permissions and
  * limitations under the License.
  */
+#include <algorithm>
 #include <array>
+#include <atomic>
 #include <chrono>
+#include <cstdlib>
+#include <functional>
 #include <future>
 #include <memory>
+#include <mutex>
+#include <random>
 #include <sstream>
 #include <thread>
+#include <vector>
 
 #include "absl/container/flat_hash_map.h"
 #include "absl/flags/flag.h"
@@ -29,12 +36,17 @@
 #include "absl/status/status.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_format.h"
+#include "absl/synchronization/mutex.h"
 #include "absl/time/time.h"
 #include "benchmark/benchmark.h"
 #include "components/data_server/cache/cache.h"
+#include "components/data_server/cache/epoch_key_value_cache.h"
+#include "components/data_server/cache/key_value_arena.h"
 #include "components/data_server/cache/key_value_cache.h"
 #include "components/data_server/cache/noop_key_value_cache.h"
+#include "components/data_server/cache/sharded_key_value_cache.h"
 #include "components/tools/benchmarks/benchmark_util.h"
+#include "tcmalloc/malloc_extension.h"
 
 ABSL_FLAG(std::vector<std::string>, record_size,
           std::vector<std::string>({"1"}),
@@ -62,13 +74,35 @@ ABSL_FLAG(int64_t, min_threads, 1,
           "Minimum number of threads for benchmarking reading keys.");
 ABSL_FLAG(int64_t, max_threads, 1,
           "Maximum number of threads for benchmarking reading keys.");
+ABSL_FLAG(int64_t, num_segments, 16,
+          "Number of segments used by the sharded cache implementation.");
+ABSL_FLAG(bool, use_huge_pages, false,
+          "Whether the caches store keys and values in slabs backed by "
+          "transparent huge pages.");
+ABSL_FLAG(std::vector<std::string>, read_percent,
+          std::vector<std::string>({"90"}),
+          "Percentages of the operations of scenario benchmarks that are "
+          "reads, the others are writes.");
+ABSL_FLAG(std::vector<std::string>, delete_percent,
+          std::vector<std::string>({"10"}),
+          "Percentages of the writes of scenario benchmarks that are "
+          "deletions.");
+ABSL_FLAG(std::vector<std::string>, zipf_exponent,
+          std::vector<std::string>({"0", "0.99"}),
+          "Exponents of the Zipfian distributions of the keys of scenario "
+          "benchmarks. 0 draws keys uniformly.");
+ABSL_FLAG(int64_t, cleanup_interval, 1000,
+          "Number of operations of scenario benchmarks between calls to "
+          "RemoveDeletedKeys. 0 disables cleanups.");
 
 namespace kv_server {
 namespace {
 
 using kv_server::benchmark::AsyncTask;
 using kv_server::benchmark::GenerateRandomString;
+using kv_server::benchmark::ParseDoubleList;
 using kv_server::benchmark::ParseInt64List;
+using kv_server::benchmark::ZipfianGenerator;
 
 // Format variables used to generate benchmark names.
 //
@@ -80,22 +114,71 @@ constexpr std::string_view kNoOpCacheGetKeyValuePairsFmt =
     "BM_NoOpCache_GetKeyValuePairs/qz:%d/rz:%d/cw:%d";
 constexpr std::string_view kLockBasedCacheGetKeyValuePairsFmt =
     "BM_LockBasedCache_GetKeyValuePairs/qz:%d/rz:%d/cw:%d";
+constexpr std::string_view kShardedCacheGetKeyValuePairsFmt =
+    "BM_ShardedCache_GetKeyValuePairs/qz:%d/rz:%d/cw:%d";
+constexpr std::string_view kEpochCacheGetKeyValuePairsFmt =
+    "BM_EpochCache_GetKeyValuePairs/qz:%d/rz:%d/cw:%d";
+constexpr std::string_view kLockBasedCacheGetKeyValuesFmt =
+    "BM_LockBasedCache_GetKeyValues/qz:%d/rz:%d/cw:%d";
+constexpr std::string_view kEpochCacheGetKeyValuesFmt =
+    "BM_EpochCache_GetKeyValues/qz:%d/rz:%d/cw:%d";
 constexpr std::string_view kNoOpCacheGetKeyValueSetFmt =
     "BM_NoOpCache_GetKeyValueSet/qz:%d/sqz:%d/rz:%d/cw:%d";
 constexpr std::string_view kLockBasedCacheGetKeyValueSetFmt =
     "BM_LockBasedCache_GetKeyValueSet/qz:%d/sqz:%d/rz:%d/cw:%d";
+constexpr std::string_view kShardedCacheGetKeyValueSetFmt =
+    "BM_ShardedCache_GetKeyValueSet/qz:%d/sqz:%d/rz:%d/cw:%d";
+constexpr std::string_view kEpochCacheGetKeyValueSetFmt =
+    "BM_EpochCache_GetKeyValueSet/qz:%d/sqz:%d/rz:%d/cw:%d";
 
 constexpr std::string_view kNoOpCacheUpdateKeyValueFmt =
     "BM_NoOpCache_UpdateKeyValue/ksz:%d/rz:%d/cr:%d";
 constexpr std::string_view kLockBasedCacheUpdateKeyValueFmt =
     "BM_LockBasedCache_UpdateKeyValue/ksz:%d/rz:%d/cr:%d";
+constexpr std::string_view kShardedCacheUpdateKeyValueFmt =
+    "BM_ShardedCache_UpdateKeyValue/ksz:%d/rz:%d/cr:%d";
+constexpr std::string_view kEpochCacheUpdateKeyValueFmt =
+    "BM_EpochCache_UpdateKeyValue/ksz:%d/rz:%d/cr:%d";
 constexpr std::string_view kNoOpCacheUpdateKeyValueSetFmt =
     "BM_NoOpCache_UpdateKeyValueSet/ksz:%d/sqz:%d/rz:%d/cr:%d";
 constexpr std::string_view kLockBasedCacheUpdateKeyValueSetFmt =
     "BM_LockBasedCache_UpdateKeyValueSet/ksz:%d/sqz:%d/rz:%d/cr:%d";
+constexpr std::string_view kShardedCacheUpdateKeyValueSetFmt =
+    "BM_ShardedCache_UpdateKeyValueSet/ksz:%d/sqz:%d/rz:%d/cr:%d";
+constexpr std::string_view kEpochCacheUpdateKeyValueSetFmt =
+    "BM_EpochCache_UpdateKeyValueSet/ksz:%d/sqz:%d/rz:%d/cr:%d";
+
+constexpr std::string_view kLockBasedCacheMemoryFmt =
+    "BM_LockBasedCache_Memory/ksz:%d/rz:%d";
+constexpr std::string_view kShardedCacheMemoryFmt =
+    "BM_ShardedCache_Memory/ksz:%d/rz:%d";
+constexpr std::string_view kEpochCacheMemoryFmt =
+    "BM_EpochCache_Memory/ksz:%d/rz:%d";
+constexpr std::string_view kLockBasedCacheSetMemoryFmt =
+    "BM_LockBasedCache_SetMemory/ksz:%d/sqz:%d/rz:%d";
+constexpr std::string_view kShardedCacheSetMemoryFmt =
+    "BM_ShardedCache_SetMemory/ksz:%d/sqz:%d/rz:%d";
+constexpr std::string_view kEpochCacheSetMemoryFmt =
+    "BM_EpochCache_SetMemory/ksz:%d/sqz:%d/rz:%d";
+constexpr std::string_view kLockBasedCacheJsonFmt =
+    "BM_LockBasedCache_Json/ksz:%d/qz:%d/rz:%d";
+constexpr std::string_view kCompressedCacheJsonFmt =
+    "BM_CompressedCache_Json/ksz:%d/qz:%d/rz:%d";
+constexpr std::string_view kLockBasedCacheLargeGetKeyValuePairsFmt =
+    "BM_LockBasedCache_LargeGetKeyValuePairs/ksz:%d/qz:%d/rz:%d";
+constexpr std::string_view kLockBasedCacheLargeGetKeyValueSetFmt =
+    "BM_LockBasedCache_LargeGetKeyValueSet/ksz:%d/qz:%d/sqz:%d/rz:%d";
+// => rp - read percent, dp - delete percent of writes, zipf - exponent of
+// the Zipfian key distribution.
+constexpr std::string_view kKeyValueScenarioFmt =
+    "BM_%sCache_KeyValueScenario/ksz:%d/qz:%d/rz:%d/rp:%d/dp:%d/zipf:%g";
+constexpr std::string_view kSetScenarioFmt =
+    "BM_%sCache_SetScenario/ksz:%d/qz:%d/sqz:%d/rz:%d/rp:%d/dp:%d/zipf:%g";
 
 constexpr std::string_view kReadsPerSec = "Reads/s";
 constexpr std::string_view kWritesPerSec = "Writes/s";
+constexpr std::string_view kBytesPerEntry = "Bytes/entry";
+constexpr std::string_view kCleanups = "Cleanups";
 
 Cache* GetNoOpCache() {
   static auto* const cache = NoOpKeyValueCache::Create().release();
@@ -107,6 +190,18 @@ Cache* GetLockBasedCache() {
   return cache;
 }
 
+Cache* GetEpochCache() {
+  static auto* const cache = EpochKeyValueCache::Create().release();
+  return cache;
+}
+
+Cache* GetShardedCache() {
+  static auto* const cache =
+      ShardedKeyValueCache::Create(absl::GetFlag(FLAGS_num_segments))
+          .release();
+  return cache;
+}
+
 std::atomic<int64_t>& GetLogicalTimestamp() {
   static auto* const timestamp = new std::atomic<int64_t>(0);
   return *timestamp;
@@ -130,6 +225,19 @@ std::vector<std::string> GetSetQuery(int64_t num_elems, int64_t elem_size) {
   return set_query;
 }
 
+// Returns a JSON object of about `size` bytes with the same fields as the
+// values of other ids, and random contents.
+std::string GenerateJsonValue(int64_t size, int64_t id) {
+  std::string value = absl::StrCat(R"({"id":)", id, R"(,"fields":{)");
+  for (int64_t field = 0; static_cast<int64_t>(value.size()) < size;
+       field++) {
+    absl::StrAppend(&value, field == 0 ? "" : ",", R"("field_)", field,
+                    R"(":{"type":"number","value":)", std::rand(), "}");
+  }
+  absl::StrAppend(&value, "}}");
+  return value;
+}
+
 template <typename ContainerT>
 ContainerT ToContainerView(const std::vector<std::string>& list) {
   ContainerT container;
@@ -146,6 +254,24 @@ ContainerT ToContainerView(const std::vector<std::string>& list) {
   return container;
 }
 
+// State shared by the threads and the runs of a scenario benchmark.
+struct Scenario {
+  std::once_flag fill_once;
+  std::unique_ptr<Cache> cache;
+  std::vector<std::string> keys;
+  std::unique_ptr<ZipfianGenerator> key_distribution;
+  std::string value;
+  // Set writes add and delete windows of `set_query_size` values of twice as
+  // many, so that they both add new values and update existing ones.
+  std::vector<std::string> set_value_pool;
+  std::atomic<int64_t> num_operations = 0;
+  absl::Mutex mutex;
+  // Latencies of the operations of the threads that finished the current run.
+  std::vector<int64_t> read_latencies_ns ABSL_GUARDED_BY(mutex);
+  std::vector<int64_t> write_latencies_ns ABSL_GUARDED_BY(mutex);
+  int num_finished_threads ABSL_GUARDED_BY(mutex) = 0;
+};
+
 struct BenchmarkArgs {
   int64_t record_size = 1;
   int64_t query_size = 1;
@@ -153,8 +279,22 @@ struct BenchmarkArgs {
   int64_t keyspace_size = 1;
   int64_t concurrent_tasks = 1;
   Cache* cache = GetNoOpCache();
+  // Creates an empty cache, for benchmarks that cannot share one.
+  std::function<std::unique_ptr<Cache>()> create_cache;
+  // Scenario benchmarks only.
+  int64_t read_percent = 100;
+  int64_t delete_percent = 0;
+  double zipf_exponent = 0;
+  bool set_values = false;
+  std::shared_ptr<Scenario> scenario;
 };
 
+int64_t GetAllocatedBytes() {
+  return tcmalloc::MallocExtension::GetNumericProperty(
+             "generic.current_allocated_bytes")
+      .value_or(0);
+}
+
 void BM_GetKeyValuePairs(::benchmark::State& state, BenchmarkArgs args) {
   uint seed = args.concurrent_tasks;
   std::vector<AsyncTask> writer_tasks;
@@ -181,6 +321,32 @@ void BM_GetKeyValuePairs(::benchmark::State& state, BenchmarkArgs args) {
       ::benchmark::Counter(state.iterations(), ::benchmark::Counter::kIsRate);
 }
 
+void BM_GetKeyValues(::benchmark::State& state, BenchmarkArgs args) {
+  uint seed = args.concurrent_tasks;
+  std::vector<AsyncTask> writer_tasks;
+  if (state.thread_index() == 0 && args.concurrent_tasks > 0) {
+    auto num_writers = args.concurrent_tasks;
+    writer_tasks.reserve(num_writers);
+    while (num_writers-- > 0) {
+      writer_tasks.emplace_back(
+          [args, &seed, value = GenerateRandomString(args.record_size)]() {
+            auto key = std::to_string(rand_r(&seed) % args.query_size);
+            args.cache->UpdateKeyValue(key, value, ++GetLogicalTimestamp());
+          });
+    }
+  }
+  auto keys = GetKeys(args.query_size);
+  auto keys_view = ToContainerView<absl::flat_hash_set<std::string_view>>(keys);
+  auto scope_metrics_context = std::make_unique<ScopeMetricsContext>();
+  RequestContext request_context(*scope_metrics_context);
+  for (auto _ : state) {
+    ::benchmark::DoNotOptimize(
+        args.cache->GetKeyValues(request_context, keys_view));
+  }
+  state.counters[std::string(kReadsPerSec)] =
+      ::benchmark::Counter(state.iterations(), ::benchmark::Counter::kIsRate);
+}
+
 void BM_GetKeyValueSet(::benchmark::State& state, BenchmarkArgs args) {
   uint seed = args.concurrent_tasks;
   std::vector<AsyncTask> writer_tasks;
@@ -261,6 +427,286 @@ void BM_UpdateKeyValueSet(::benchmark::State& state, BenchmarkArgs args) {
       ::benchmark::Counter(state.iterations(), ::benchmark::Counter::kIsRate);
 }
 
+// Fills a new cache with `keyspace_size` keys and reports the heap bytes
+// allocated per key-value pair.
+void BM_BytesPerEntry(::benchmark::State& state, BenchmarkArgs args) {
+  auto keys = GetKeys(args.keyspace_size);
+  auto value = GenerateRandomString(args.record_size);
+  int64_t allocated_bytes = 0;
+  for (auto _ : state) {
+    const int64_t allocated_bytes_before = GetAllocatedBytes();
+    auto cache = args.create_cache();
+    for (const auto& key : keys) {
+      cache->UpdateKeyValue(key, value, 1);
+    }
+    allocated_bytes = GetAllocatedBytes() - allocated_bytes_before;
+    state.PauseTiming();
+    cache.reset();
+    state.ResumeTiming();
+  }
+  state.counters[std::string(kBytesPerEntry)] =
+      ::benchmark::Counter(static_cast<double>(allocated_bytes) / keys.size());
+  state.counters[std::string(kWritesPerSec)] = ::benchmark::Counter(
+      state.iterations() * keys.size(), ::benchmark::Counter::kIsRate);
+}
+
+// Fills a new cache with `keyspace_size` keys, each with a set of
+// `set_query_size` distinct values, and reports the heap bytes allocated per
+// key.
+void BM_SetBytesPerEntry(::benchmark::State& state, BenchmarkArgs args) {
+  auto keys = GetKeys(args.keyspace_size);
+  std::vector<std::string> set_values;
+  set_values.reserve(args.set_query_size);
+  for (int64_t i = 0; i < args.set_query_size; i++) {
+    set_values.push_back(
+        absl::StrCat(GenerateRandomString(args.record_size), i));
+  }
+  auto set_view = ToContainerView<std::vector<std::string_view>>(set_values);
+  int64_t allocated_bytes = 0;
+  for (auto _ : state) {
+    const int64_t allocated_bytes_before = GetAllocatedBytes();
+    auto cache = args.create_cache();
+    for (const auto& key : keys) {
+      cache->UpdateKeyValueSet(key, absl::MakeSpan(set_view), 1);
+    }
+    allocated_bytes = GetAllocatedBytes() - allocated_bytes_before;
+    state.PauseTiming();
+    cache.reset();
+    state.ResumeTiming();
+  }
+  state.counters[std::string(kBytesPerEntry)] =
+      ::benchmark::Counter(static_cast<double>(allocated_bytes) / keys.size());
+  state.counters[std::string(kWritesPerSec)] = ::benchmark::Counter(
+      state.iterations() * keys.size(), ::benchmark::Counter::kIsRate);
+}
+
+// Fills a new cache with `keyspace_size` JSON values of about `record_size`
+// bytes, then looks up the last `query_size` keys in every iteration. Reports
+// the heap bytes allocated per key-value pair too, so that caches can be
+// compared on both.
+void BM_JsonGetKeyValues(::benchmark::State& state, BenchmarkArgs args) {
+  const int64_t allocated_bytes_before = GetAllocatedBytes();
+  auto cache = args.create_cache();
+  for (int64_t i = 0; i < args.keyspace_size; i++) {
+    cache->UpdateKeyValue(std::to_string(i),
+                          GenerateJsonValue(args.record_size, i), 1);
+  }
+  const int64_t allocated_bytes = GetAllocatedBytes() - allocated_bytes_before;
+  // The first values of a compressed cache are stored uncompressed.
+  std::vector<std::string> keys;
+  for (int64_t i = std::max<int64_t>(args.keyspace_size - args.query_size, 0);
+       i < args.keyspace_size; i++) {
+    keys.push_back(std::to_string(i));
+  }
+  auto keys_view = ToContainerView<absl::flat_hash_set<std::string_view>>(keys);
+  auto scope_metrics_context = std::make_unique<ScopeMetricsContext>();
+  RequestContext request_context(*scope_metrics_context);
+  for (auto _ : state) {
+    ::benchmark::DoNotOptimize(cache->GetKeyValues(request_context, keys_view));
+  }
+  state.counters[std::string(kBytesPerEntry)] = ::benchmark::Counter(
+      static_cast<double>(allocated_bytes) / args.keyspace_size);
+  state.counters[std::string(kReadsPerSec)] =
+      ::benchmark::Counter(state.iterations(), ::benchmark::Counter::kIsRate);
+}
+
+// Returns `query_size` keys of a cache with `keyspace_size` keys, spread
+// evenly over the keyspace.
+std::vector<std::string> GetSpreadKeys(int64_t keyspace_size,
+                                       int64_t query_size) {
+  std::vector<std::string> keys;
+  const int64_t stride = std::max<int64_t>(keyspace_size / query_size, 1);
+  for (int64_t i = 0;
+       i < keyspace_size && static_cast<int64_t>(keys.size()) < query_size;
+       i += stride) {
+    keys.push_back(std::to_string(i));
+  }
+  return keys;
+}
+
+// Fills a new cache with `keyspace_size` values of `record_size` bytes, then
+// looks up `query_size` keys spread over the keyspace in every iteration.
+// Lookups in caches much larger than the CPU caches take a cache miss per
+// key.
+void BM_LargeGetKeyValuePairs(::benchmark::State& state, BenchmarkArgs args) {
+  auto cache = args.create_cache();
+  const std::string value = GenerateRandomString(args.record_size);
+  for (int64_t i = 0; i < args.keyspace_size; i++) {
+    cache->UpdateKeyValue(std::to_string(i), value, 1);
+  }
+  auto keys = GetSpreadKeys(args.keyspace_size, args.query_size);
+  auto keys_view = ToContainerView<absl::flat_hash_set<std::string_view>>(keys);
+  auto scope_metrics_context = std::make_unique<ScopeMetricsContext>();
+  RequestContext request_context(*scope_metrics_context);
+  for (auto _ : state) {
+    ::benchmark::DoNotOptimize(
+        cache->GetKeyValuePairs(request_context, keys_view));
+  }
+  state.counters[std::string(kReadsPerSec)] = ::benchmark::Counter(
+      state.iterations() * keys.size(), ::benchmark::Counter::kIsRate);
+}
+
+// Same as `BM_LargeGetKeyValuePairs` for value sets of `set_query_size`
+// values of `record_size` bytes.
+void BM_LargeGetKeyValueSet(::benchmark::State& state, BenchmarkArgs args) {
+  auto cache = args.create_cache();
+  const auto set_query = GetSetQuery(args.set_query_size, args.record_size);
+  auto set_view = ToContainerView<std::vector<std::string_view>>(set_query);
+  for (int64_t i = 0; i < args.keyspace_size; i++) {
+    cache->UpdateKeyValueSet(std::to_string(i), absl::MakeSpan(set_view), 1);
+  }
+  auto keys = GetSpreadKeys(args.keyspace_size, args.query_size);
+  auto keys_view = ToContainerView<absl::flat_hash_set<std::string_view>>(keys);
+  auto scope_metrics_context = std::make_unique<ScopeMetricsContext>();
+  RequestContext request_context(*scope_metrics_context);
+  for (auto _ : state) {
+    ::benchmark::DoNotOptimize(
+        cache->GetKeyValueSet(request_context, keys_view));
+  }
+  state.counters[std::string(kReadsPerSec)] = ::benchmark::Counter(
+      state.iterations() * keys.size(), ::benchmark::Counter::kIsRate);
+}
+
+// Fills a new cache for the scenario with `keyspace_size` keys, each with a
+// value of `record_size` bytes or a set of `set_query_size` such values.
+void FillScenarioCache(const BenchmarkArgs& args) {
+  Scenario& scenario = *args.scenario;
+  scenario.cache = args.create_cache();
+  scenario.keys = GetKeys(args.keyspace_size);
+  scenario.key_distribution = std::make_unique<ZipfianGenerator>(
+      args.keyspace_size, args.zipf_exponent);
+  scenario.value = GenerateRandomString(args.record_size);
+  for (int64_t i = 0; i < 2 * args.set_query_size; i++) {
+    scenario.set_value_pool.push_back(
+        absl::StrCat(GenerateRandomString(args.record_size), i));
+  }
+  auto set_view =
+      ToContainerView<std::vector<std::string_view>>(scenario.set_value_pool);
+  for (const auto& key : scenario.keys) {
+    if (args.set_values) {
+      scenario.cache->UpdateKeyValueSet(
+          key, absl::MakeSpan(set_view).subspan(0, args.set_query_size),
+          ++GetLogicalTimestamp());
+    } else {
+      scenario.cache->UpdateKeyValue(key, scenario.value,
+                                     ++GetLogicalTimestamp());
+    }
+  }
+}
+
+void SetLatencyPercentileCounters(::benchmark::State& state,
+                                  std::string_view operation,
+                                  std::vector<int64_t>& latencies_ns) {
+  if (latencies_ns.empty()) {
+    return;
+  }
+  constexpr std::array<std::pair<std::string_view, double>, 3> kPercentiles =
+      {{{"P50", 0.5}, {"P99", 0.99}, {"P999", 0.999}}};
+  std::sort(latencies_ns.begin(), latencies_ns.end());
+  for (const auto& [name, percentile] : kPercentiles) {
+    const size_t index = std::min(
+        latencies_ns.size() - 1,
+        static_cast<size_t>(percentile * latencies_ns.size()));
+    state.counters[absl::StrCat(operation, name, "(ns)")] =
+        ::benchmark::Counter(latencies_ns[index]);
+  }
+}
+
+// Merges the latencies of the threads of a run, and reports their
+// percentiles from the last thread to finish. Counters are summed over
+// threads, so that the other threads report none.
+void ReportLatencyPercentiles(::benchmark::State& state, Scenario& scenario,
+                              const std::vector<int64_t>& read_latencies_ns,
+                              const std::vector<int64_t>& write_latencies_ns) {
+  absl::MutexLock lock(&scenario.mutex);
+  scenario.read_latencies_ns.insert(scenario.read_latencies_ns.end(),
+                                    read_latencies_ns.begin(),
+                                    read_latencies_ns.end());
+  scenario.write_latencies_ns.insert(scenario.write_latencies_ns.end(),
+                                     write_latencies_ns.begin(),
+                                     write_latencies_ns.end());
+  if (++scenario.num_finished_threads < state.threads()) {
+    return;
+  }
+  SetLatencyPercentileCounters(state, "Read", scenario.read_latencies_ns);
+  SetLatencyPercentileCounters(state, "Write", scenario.write_latencies_ns);
+  scenario.read_latencies_ns.clear();
+  scenario.write_latencies_ns.clear();
+  scenario.num_finished_threads = 0;
+}
+
+// Mixes reads of `query_size` keys, updates and deletions of single keys, and
+// cleanups of the deleted keys every `cleanup_interval` operations of all
+// threads. Keys follow a Zipfian distribution. Reports throughputs and the
+// latency percentiles of reads and writes, which include the contention with
+// cleanups. Cleanups themselves are not timed.
+void BM_Scenario(::benchmark::State& state, BenchmarkArgs args) {
+  Scenario& scenario = *args.scenario;
+  std::call_once(scenario.fill_once, [&args] { FillScenarioCache(args); });
+  const int64_t cleanup_interval = absl::GetFlag(FLAGS_cleanup_interval);
+  std::mt19937_64 generator(state.thread_index() + 1);
+  std::uniform_int_distribution<int64_t> percent(0, 99);
+  std::uniform_int_distribution<int64_t> set_offset(0, args.set_query_size);
+  auto set_view =
+      ToContainerView<std::vector<std::string_view>>(scenario.set_value_pool);
+  auto scope_metrics_context = std::make_unique<ScopeMetricsContext>();
+  RequestContext request_context(*scope_metrics_context);
+  absl::flat_hash_set<std::string_view> query;
+  std::vector<int64_t> read_latencies_ns;
+  std::vector<int64_t> write_latencies_ns;
+  int64_t num_cleanups = 0;
+  for (auto _ : state) {
+    const bool is_read = percent(generator) < args.read_percent;
+    const bool is_delete = !is_read && percent(generator) < args.delete_percent;
+    const std::string_view key =
+        scenario.keys[scenario.key_distribution->Next(generator)];
+    query.clear();
+    if (is_read) {
+      query.insert(key);
+      for (int64_t i = 1; i < args.query_size; i++) {
+        query.insert(scenario.keys[scenario.key_distribution->Next(generator)]);
+      }
+    }
+    auto set_values = absl::MakeSpan(set_view).subspan(set_offset(generator),
+                                                       args.set_query_size);
+    const auto start = std::chrono::steady_clock::now();
+    if (is_read && args.set_values) {
+      ::benchmark::DoNotOptimize(
+          scenario.cache->GetKeyValueSet(request_context, query));
+    } else if (is_read) {
+      ::benchmark::DoNotOptimize(
+          scenario.cache->GetKeyValuePairs(request_context, query));
+    } else if (is_delete && args.set_values) {
+      scenario.cache->DeleteValuesInSet(key, set_values,
+                                        ++GetLogicalTimestamp());
+    } else if (is_delete) {
+      scenario.cache->DeleteKey(key, ++GetLogicalTimestamp());
+    } else if (args.set_values) {
+      scenario.cache->UpdateKeyValueSet(key, set_values,
+                                        ++GetLogicalTimestamp());
+    } else {
+      scenario.cache->UpdateKeyValue(key, scenario.value,
+                                     ++GetLogicalTimestamp());
+    }
+    (is_read ? read_latencies_ns : write_latencies_ns)
+        .push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                       std::chrono::steady_clock::now() - start)
+                       .count());
+    if (cleanup_interval > 0 &&
+        ++scenario.num_operations % cleanup_interval == 0) {
+      scenario.cache->RemoveDeletedKeys(GetLogicalTimestamp());
+      num_cleanups++;
+    }
+  }
+  state.counters[std::string(kReadsPerSec)] = ::benchmark::Counter(
+      read_latencies_ns.size(), ::benchmark::Counter::kIsRate);
+  state.counters[std::string(kWritesPerSec)] = ::benchmark::Counter(
+      write_latencies_ns.size(), ::benchmark::Counter::kIsRate);
+  state.counters[std::string(kCleanups)] = ::benchmark::Counter(num_cleanups);
+  ReportLatencyPercentiles(state, scenario, read_latencies_ns,
+                           write_latencies_ns);
+}
+
 // Registers a function to benchmark.
 void RegisterBenchmark(
     std::string name, BenchmarkArgs args,
@@ -299,6 +745,26 @@ void RegisterReadBenchmarks() {
             absl::StrFormat(kLockBasedCacheGetKeyValuePairsFmt, query_size,
                             record_size, num_writers),
             args, BM_GetKeyValuePairs);
+        args.cache = GetShardedCache();
+        ::kv_server::RegisterBenchmark(
+            absl::StrFormat(kShardedCacheGetKeyValuePairsFmt, query_size,
+                            record_size, num_writers),
+            args, BM_GetKeyValuePairs);
+        args.cache = GetEpochCache();
+        ::kv_server::RegisterBenchmark(
+            absl::StrFormat(kEpochCacheGetKeyValuePairsFmt, query_size,
+                            record_size, num_writers),
+            args, BM_GetKeyValuePairs);
+        args.cache = GetLockBasedCache();
+        ::kv_server::RegisterBenchmark(
+            absl::StrFormat(kLockBasedCacheGetKeyValuesFmt, query_size,
+                            record_size, num_writers),
+            args, BM_GetKeyValues);
+        args.cache = GetEpochCache();
+        ::kv_server::RegisterBenchmark(
+            absl::StrFormat(kEpochCacheGetKeyValuesFmt, query_size,
+                            record_size, num_writers),
+            args, BM_GetKeyValues);
         for (auto set_query_size : set_query_sizes.value()) {
           args.set_query_size = set_query_size;
           args.cache = GetNoOpCache();
@@ -311,6 +777,16 @@ void RegisterReadBenchmarks() {
               absl::StrFormat(kLockBasedCacheGetKeyValueSetFmt, query_size,
                               set_query_size, record_size, num_writers),
               args, BM_GetKeyValueSet);
+          args.cache = GetShardedCache();
+          ::kv_server::RegisterBenchmark(
+              absl::StrFormat(kShardedCacheGetKeyValueSetFmt, query_size,
+                              set_query_size, record_size, num_writers),
+              args, BM_GetKeyValueSet);
+          args.cache = GetEpochCache();
+          ::kv_server::RegisterBenchmark(
+              absl::StrFormat(kEpochCacheGetKeyValueSetFmt, query_size,
+                              set_query_size, record_size, num_writers),
+              args, BM_GetKeyValueSet);
         }
       }
     }
@@ -341,6 +817,16 @@ void RegisterWriteBenchmarks() {
             absl::StrFormat(kLockBasedCacheUpdateKeyValueFmt, keyspace_size,
                             record_size, num_readers),
             args, BM_UpdateKeyValue);
+        args.cache = GetShardedCache();
+        ::kv_server::RegisterBenchmark(
+            absl::StrFormat(kShardedCacheUpdateKeyValueFmt, keyspace_size,
+                            record_size, num_readers),
+            args, BM_UpdateKeyValue);
+        args.cache = GetEpochCache();
+        ::kv_server::RegisterBenchmark(
+            absl::StrFormat(kEpochCacheUpdateKeyValueFmt, keyspace_size,
+                            record_size, num_readers),
+            args, BM_UpdateKeyValue);
         for (auto set_query_size : set_query_sizes.value()) {
           args.set_query_size = set_query_size;
           args.cache = GetNoOpCache();
@@ -354,6 +840,198 @@ void RegisterWriteBenchmarks() {
                               keyspace_size, set_query_size, record_size,
                               num_readers),
               args, BM_UpdateKeyValueSet);
+          args.cache = GetShardedCache();
+          ::kv_server::RegisterBenchmark(
+              absl::StrFormat(kShardedCacheUpdateKeyValueSetFmt, keyspace_size,
+                              set_query_size, record_size, num_readers),
+              args, BM_UpdateKeyValueSet);
+          args.cache = GetEpochCache();
+          ::kv_server::RegisterBenchmark(
+              absl::StrFormat(kEpochCacheUpdateKeyValueSetFmt, keyspace_size,
+                              set_query_size, record_size, num_readers),
+              args, BM_UpdateKeyValueSet);
+        }
+      }
+    }
+  }
+}
+
+// Memory benchmarks are single threaded since they measure process wide heap
+// usage.
+void RegisterMemoryBenchmarks() {
+  auto keyspace_sizes = ParseInt64List(absl::GetFlag(FLAGS_keyspace_size));
+  auto record_sizes = ParseInt64List(absl::GetFlag(FLAGS_record_size));
+  auto set_query_sizes = ParseInt64List(absl::GetFlag(FLAGS_set_query_size));
+  auto query_sizes = ParseInt64List(absl::GetFlag(FLAGS_query_size));
+  const int64_t iterations = std::max(absl::GetFlag(FLAGS_iterations), 1L);
+  for (auto keyspace_size : keyspace_sizes.value()) {
+    for (auto record_size : record_sizes.value()) {
+      auto args = BenchmarkArgs{
+          .record_size = record_size,
+          .keyspace_size = keyspace_size,
+          .create_cache = [] { return KeyValueCache::Create(); },
+      };
+      ::benchmark::RegisterBenchmark(
+          absl::StrFormat(kLockBasedCacheMemoryFmt, keyspace_size, record_size)
+              .c_str(),
+          BM_BytesPerEntry, args)
+          ->Iterations(iterations);
+      args.create_cache = [] {
+        return ShardedKeyValueCache::Create(absl::GetFlag(FLAGS_num_segments));
+      };
+      ::benchmark::RegisterBenchmark(
+          absl::StrFormat(kShardedCacheMemoryFmt, keyspace_size, record_size)
+              .c_str(),
+          BM_BytesPerEntry, args)
+          ->Iterations(iterations);
+      args.create_cache = [] { return EpochKeyValueCache::Create(); };
+      ::benchmark::RegisterBenchmark(
+          absl::StrFormat(kEpochCacheMemoryFmt, keyspace_size, record_size)
+              .c_str(),
+          BM_BytesPerEntry, args)
+          ->Iterations(iterations);
+      for (auto set_query_size : set_query_sizes.value()) {
+        args.set_query_size = set_query_size;
+        args.create_cache = [] { return KeyValueCache::Create(); };
+        ::benchmark::RegisterBenchmark(
+            absl::StrFormat(kLockBasedCacheSetMemoryFmt, keyspace_size,
+                            set_query_size, record_size)
+                .c_str(),
+            BM_SetBytesPerEntry, args)
+            ->Iterations(iterations);
+        args.create_cache = [] {
+          return ShardedKeyValueCache::Create(
+              absl::GetFlag(FLAGS_num_segments));
+        };
+        ::benchmark::RegisterBenchmark(
+            absl::StrFormat(kShardedCacheSetMemoryFmt, keyspace_size,
+                            set_query_size, record_size)
+                .c_str(),
+            BM_SetBytesPerEntry, args)
+            ->Iterations(iterations);
+        args.create_cache = [] { return EpochKeyValueCache::Create(); };
+        ::benchmark::RegisterBenchmark(
+            absl::StrFormat(kEpochCacheSetMemoryFmt, keyspace_size,
+                            set_query_size, record_size)
+                .c_str(),
+            BM_SetBytesPerEntry, args)
+            ->Iterations(iterations);
+      }
+      for (auto query_size : query_sizes.value()) {
+        args.query_size = query_size;
+        args.create_cache = [] { return KeyValueCache::Create(); };
+        ::benchmark::RegisterBenchmark(
+            absl::StrFormat(kLockBasedCacheJsonFmt, keyspace_size, query_size,
+                            record_size)
+                .c_str(),
+            BM_JsonGetKeyValues, args);
+        args.create_cache = [] {
+          return KeyValueCache::Create(/*intern_set_values=*/false,
+                                       /*precompute_json_values=*/false,
+                                       /*compress_values=*/true);
+        };
+        ::benchmark::RegisterBenchmark(
+            absl::StrFormat(kCompressedCacheJsonFmt, keyspace_size, query_size,
+                            record_size)
+                .c_str(),
+            BM_JsonGetKeyValues, args);
+      }
+    }
+  }
+}
+
+// Lookups of many keys in caches too large for the CPU caches. Single
+// threaded since every benchmark fills a cache of its own.
+void RegisterLargeCacheBenchmarks() {
+  auto keyspace_sizes = ParseInt64List(absl::GetFlag(FLAGS_keyspace_size));
+  auto record_sizes = ParseInt64List(absl::GetFlag(FLAGS_record_size));
+  auto set_query_sizes = ParseInt64List(absl::GetFlag(FLAGS_set_query_size));
+  auto query_sizes = ParseInt64List(absl::GetFlag(FLAGS_query_size));
+  for (auto keyspace_size : keyspace_sizes.value()) {
+    for (auto query_size : query_sizes.value()) {
+      for (auto record_size : record_sizes.value()) {
+        auto args = BenchmarkArgs{
+            .record_size = record_size,
+            .query_size = query_size,
+            .keyspace_size = keyspace_size,
+            .create_cache = [] { return KeyValueCache::Create(); },
+        };
+        ::benchmark::RegisterBenchmark(
+            absl::StrFormat(kLockBasedCacheLargeGetKeyValuePairsFmt,
+                            keyspace_size, query_size, record_size)
+                .c_str(),
+            BM_LargeGetKeyValuePairs, args);
+        for (auto set_query_size : set_query_sizes.value()) {
+          args.set_query_size = set_query_size;
+          ::benchmark::RegisterBenchmark(
+              absl::StrFormat(kLockBasedCacheLargeGetKeyValueSetFmt,
+                              keyspace_size, query_size, set_query_size,
+                              record_size)
+                  .c_str(),
+              BM_LargeGetKeyValueSet, args);
+        }
+      }
+    }
+  }
+}
+
+// Mixed workloads on the caches that support concurrent reads and writes.
+void RegisterScenarioBenchmarks() {
+  auto keyspace_sizes = ParseInt64List(absl::GetFlag(FLAGS_keyspace_size));
+  auto query_sizes = ParseInt64List(absl::GetFlag(FLAGS_query_size));
+  auto set_query_sizes = ParseInt64List(absl::GetFlag(FLAGS_set_query_size));
+  auto record_sizes = ParseInt64List(absl::GetFlag(FLAGS_record_size));
+  auto read_percents = ParseInt64List(absl::GetFlag(FLAGS_read_percent));
+  auto delete_percents = ParseInt64List(absl::GetFlag(FLAGS_delete_percent));
+  auto zipf_exponents = ParseDoubleList(absl::GetFlag(FLAGS_zipf_exponent));
+  const std::vector<
+      std::pair<std::string_view, std::function<std::unique_ptr<Cache>()>>>
+      caches = {
+          {"LockBased", [] { return KeyValueCache::Create(); }},
+          {"Sharded",
+           [] {
+             return ShardedKeyValueCache::Create(
+                 absl::GetFlag(FLAGS_num_segments));
+           }},
+          {"Epoch", [] { return EpochKeyValueCache::Create(); }},
+      };
+  for (auto keyspace_size : keyspace_sizes.value()) {
+    for (auto query_size : query_sizes.value()) {
+      for (auto record_size : record_sizes.value()) {
+        for (auto read_percent : read_percents.value()) {
+          for (auto delete_percent : delete_percents.value()) {
+            for (auto zipf_exponent : zipf_exponents.value()) {
+              for (const auto& [cache_name, create_cache] : caches) {
+                auto args = BenchmarkArgs{
+                    .record_size = record_size,
+                    .query_size = query_size,
+                    .keyspace_size = keyspace_size,
+                    .create_cache = create_cache,
+                    .read_percent = read_percent,
+                    .delete_percent = delete_percent,
+                    .zipf_exponent = zipf_exponent,
+                    .scenario = std::make_shared<Scenario>(),
+                };
+                ::kv_server::RegisterBenchmark(
+                    absl::StrFormat(kKeyValueScenarioFmt, cache_name,
+                                    keyspace_size, query_size, record_size,
+                                    read_percent, delete_percent,
+                                    zipf_exponent),
+                    args, BM_Scenario);
+                for (auto set_query_size : set_query_sizes.value()) {
+                  args.set_query_size = set_query_size;
+                  args.set_values = true;
+                  args.scenario = std::make_shared<Scenario>();
+                  ::kv_server::RegisterBenchmark(
+                      absl::StrFormat(kSetScenarioFmt, cache_name,
+                                      keyspace_size, query_size,
+                                      set_query_size, record_size, read_percent,
+                                      delete_percent, zipf_exponent),
+                      args, BM_Scenario);
+                }
+              }
+            }
+          }
         }
       }
     }
@@ -370,13 +1048,42 @@ void RegisterWriteBenchmarks() {
 //    --//:instance=local \
 //    --//:platform=local -- \
 //    --benchmark_counters_tabular=true --stderrthreshold=0
+//
+// Memory usage per key-value pair, and per key with a value set, can be
+// measured with, e.g.,
+// --benchmark_filter=Memory --keyspace_size=1000000 --record_size=30
+// --set_query_size=3
+//
+// Memory usage and lookup latency of JSON values stored as is and compressed
+// can be compared with, e.g.,
+// --benchmark_filter=Json --keyspace_size=100000 --record_size=2000
+// --query_size=10
+//
+// Lookups of many keys in large caches, which are bound by cache misses, can
+// be measured with, e.g.,
+// --benchmark_filter=Large --keyspace_size=10000000 --query_size=1000
+// --record_size=10
+//
+// The TLB misses that huge pages save on such lookups can be measured by
+// comparing the above with and without --use_huge_pages.
+//
+// Mixed workloads with skewed keys, deletions and periodic cleanups, with
+// their tail latencies, can be measured with, e.g.,
+// --benchmark_filter=Scenario --keyspace_size=100000 --query_size=10
+// --read_percent=50,90,99 --delete_percent=10 --zipf_exponent=0,0.99
+// --cleanup_interval=10000 --min_threads=1 --max_threads=16
 int main(int argc, char** argv) {
   absl::InitializeLog();
   ::benchmark::Initialize(&argc, argv);
   absl::ParseCommandLine(argc, argv);
   kv_server::InitMetricsContextMap();
+  kv_server::KeyValueArena::EnableHugePages(
+      absl::GetFlag(FLAGS_use_huge_pages));
   ::kv_server::RegisterReadBenchmarks();
   ::kv_server::RegisterWriteBenchmarks();
+  ::kv_server::RegisterMemoryBenchmarks();
+  ::kv_server::RegisterLargeCacheBenchmarks();
+  ::kv_server::RegisterScenarioBenchmarks();
   ::benchmark::RunSpecifiedBenchmarks();
   ::benchmark::Shutdown();
   return 0;
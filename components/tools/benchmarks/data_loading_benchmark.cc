@@ -17,7 +17,9 @@
 #include <array>
 #include <chrono>
 #include <memory>
+#include <optional>
 #include <sstream>
+#include <string_view>
 #include <thread>
 
 #include "absl/container/flat_hash_map.h"
@@ -31,14 +33,17 @@
 #include "absl/time/time.h"
 #include "benchmark/benchmark.h"
 #include "components/data/blob_storage/blob_storage_client.h"
+#include "components/data/blob_storage/latency_emulating_blob_storage_client.h"
 #include "components/data_server/cache/cache.h"
 #include "components/data_server/cache/key_value_cache.h"
 #include "components/data_server/cache/noop_key_value_cache.h"
 #include "components/tools/benchmarks/benchmark_util.h"
 #include "components/util/platform_initializer.h"
 #include "public/data_loading/data_loading_generated.h"
+#include "public/data_loading/readers/avro_stream_io.h"
 #include "public/data_loading/readers/riegeli_stream_io.h"
 #include "public/data_loading/records_utils.h"
+#include "public/data_loading/writers/avro_delta_record_stream_writer.h"
 
 ABSL_FLAG(std::string, data_directory, "",
           "Data directory or bucket to store benchmark input data files in.");
@@ -53,6 +58,10 @@ ABSL_FLAG(int64_t, num_records, 100'000,
 ABSL_FLAG(int64_t, record_size, 10 * 1024,
           "Size of reach record in data file when '--create_input_file' "
           "is true.");
+ABSL_FLAG(std::vector<std::string>, args_file_formats,
+          std::vector<std::string>({"riegeli"}),
+          "A list of data file formats to benchmark, 'riegeli' and/or 'avro'. "
+          "Avro data is read from '<filename>.avro'.");
 ABSL_FLAG(std::vector<std::string>, args_reader_worker_threads,
           std::vector<std::string>({"16"}),
           "A list of num of worker threads to use for concurrent reading.");
@@ -64,37 +73,69 @@ ABSL_FLAG(
     std::vector<std::string>, args_client_max_range_mb,
     std::vector<std::string>({"8"}),
     "Chunk size to use when reading blobs in mbs. Ignored for local platform.");
+ABSL_FLAG(std::vector<std::string>, args_read_ahead_chunks,
+          std::vector<std::string>({"0"}),
+          "A list of numbers of blob ranges to read ahead of the one being "
+          "read.");
+ABSL_FLAG(std::vector<std::string>, args_min_shard_size_mb,
+          std::vector<std::string>({"8"}),
+          "A list of minimum sizes in mbs of the shards of the file that "
+          "worker threads read.");
 ABSL_FLAG(int64_t, args_benchmark_iterations, -1,
           "Number of iterations to run each benchmark.");
+ABSL_FLAG(int64_t, emulated_request_latency_ms, 0,
+          "If positive, blob storage requests take this much longer, e.g., "
+          "to emulate cloud storage with local files.");
+ABSL_FLAG(int64_t, emulated_max_jitter_ms, 0,
+          "Blob storage requests take up to this much longer, drawn "
+          "uniformly.");
+ABSL_FLAG(int64_t, emulated_request_bandwidth_mb_per_second, 0,
+          "If positive, the most mbs per second transferred by each blob "
+          "storage request.");
+ABSL_FLAG(int64_t, emulated_total_bandwidth_mb_per_second, 0,
+          "If positive, the most mbs per second transferred by all blob "
+          "storage requests.");
 
+using kv_server::AvroConcurrentStreamRecordReader;
+using kv_server::AvroDeltaRecordStreamWriter;
 using kv_server::BlobReader;
 using kv_server::BlobStorageClient;
 using kv_server::BlobStorageClientFactory;
 using kv_server::Cache;
 using kv_server::ConcurrentStreamRecordReader;
 using kv_server::DataRecord;
+using kv_server::DeltaRecordWriter;
 using kv_server::DeserializeDataRecord;
 using kv_server::GetRecordValue;
 using kv_server::KeyValueCache;
 using kv_server::KeyValueMutationRecord;
 using kv_server::KeyValueMutationType;
+using kv_server::LatencyEmulatingBlobStorageClient;
 using kv_server::NoOpKeyValueCache;
 using kv_server::Record;
 using kv_server::RecordStream;
+using kv_server::StreamRecordReader;
 using kv_server::Value;
 using kv_server::benchmark::ParseInt64List;
 using kv_server::benchmark::WriteRecords;
 
+// => ra - ranges read ahead, shard - minimum shard size in mbs.
 constexpr std::string_view kNoOpCacheNameFormat =
-    "BM_DataLoading_NoOpCache/tds:%d/conns:%d/buf:%d";
+    "BM_DataLoading_NoOpCache/fmt:%s/tds:%d/conns:%d/buf:%d/ra:%d/shard:%d";
 constexpr std::string_view kMutexCacheNameFormat =
-    "BM_DataLoading_MutexCache/tds:%d/conns:%d/buf:%d";
+    "BM_DataLoading_MutexCache/fmt:%s/tds:%d/conns:%d/buf:%d/ra:%d/shard:%d";
+constexpr int64_t kBytesPerMb = 1024 * 1024;
+constexpr std::string_view kRiegeliFormat = "riegeli";
+constexpr std::string_view kAvroFormat = "avro";
 
 // Args config for benchmarks.
 struct BenchmarkArgs {
+  std::string file_format;
   int64_t reader_worker_threads;
   int64_t client_max_connections;
   int64_t client_max_range_mb;
+  int64_t num_read_ahead_chunks;
+  int64_t min_shard_size_mb;
   std::function<std::unique_ptr<Cache>()> create_cache_fn;
 };
 
@@ -116,15 +157,23 @@ class BlobRecordStream : public RecordStream {
   explicit BlobRecordStream(std::unique_ptr<BlobReader> blob_reader)
       : blob_reader_(std::move(blob_reader)) {}
   std::istream& Stream() { return blob_reader_->Stream(); }
+  std::optional<std::string_view> Contents() override {
+    return blob_reader_->Contents();
+  }
 
  private:
   std::unique_ptr<BlobReader> blob_reader_;
 };
 
-BlobStorageClient::DataLocation GetBlobLocation() {
+BlobStorageClient::DataLocation GetBlobLocation(
+    std::string_view file_format) {
+  std::string key = absl::GetFlag(FLAGS_filename);
+  if (file_format == kAvroFormat) {
+    absl::StrAppend(&key, ".", kAvroFormat);
+  }
   return BlobStorageClient::DataLocation{
       .bucket = absl::GetFlag(FLAGS_data_directory),
-      .key = absl::GetFlag(FLAGS_filename),
+      .key = std::move(key),
   };
 }
 
@@ -136,6 +185,28 @@ int64_t GetBlobSize(BlobStorageClient& blob_client,
   return stream.tellg();
 }
 
+// Writes the benchmark records to `data_stream` in `file_format`.
+absl::Status WriteInputRecords(std::string_view file_format,
+                               std::stringstream& data_stream) {
+  const int64_t num_records = absl::GetFlag(FLAGS_num_records);
+  const int64_t record_size = absl::GetFlag(FLAGS_record_size);
+  if (file_format == kRiegeliFormat) {
+    return WriteRecords(num_records, record_size, data_stream);
+  }
+  if (file_format == kAvroFormat) {
+    auto record_writer = AvroDeltaRecordStreamWriter::Create(
+        data_stream, DeltaRecordWriter::Options{});
+    if (!record_writer.ok()) {
+      return record_writer.status();
+    }
+    auto status = WriteRecords(num_records, record_size, **record_writer);
+    (*record_writer)->Close();
+    return status;
+  }
+  return absl::InvalidArgumentError(
+      absl::StrCat("Unsupported file format: ", file_format));
+}
+
 void BM_LoadDataIntoCache(benchmark::State& state, BenchmarkArgs args);
 
 void RegisterBenchmark(std::string_view benchmark_name, BenchmarkArgs args) {
@@ -156,27 +227,80 @@ void RegisterBenchmarks() {
       ParseInt64List(absl::GetFlag(FLAGS_args_client_max_connections));
   auto client_max_range_mb =
       ParseInt64List(absl::GetFlag(FLAGS_args_client_max_range_mb));
-  for (const int64_t byte_range_mb : client_max_range_mb.value()) {
-    for (const int64_t num_connections : client_max_conns.value()) {
-      for (const int64_t num_threads : num_worker_threads.value()) {
-        auto args = BenchmarkArgs{
-            .reader_worker_threads = num_threads,
-            .client_max_connections = num_connections,
-            .client_max_range_mb = byte_range_mb,
-            .create_cache_fn = []() { return NoOpKeyValueCache::Create(); },
-        };
-        RegisterBenchmark(absl::StrFormat(kNoOpCacheNameFormat, num_threads,
-                                          num_connections, byte_range_mb),
-                          args);
-        args.create_cache_fn = []() { return KeyValueCache::Create(); };
-        RegisterBenchmark(absl::StrFormat(kMutexCacheNameFormat, num_threads,
-                                          num_connections, byte_range_mb),
-                          args);
+  auto read_ahead_chunks =
+      ParseInt64List(absl::GetFlag(FLAGS_args_read_ahead_chunks));
+  auto min_shard_size_mb =
+      ParseInt64List(absl::GetFlag(FLAGS_args_min_shard_size_mb));
+  const auto file_formats = absl::GetFlag(FLAGS_args_file_formats);
+  for (const std::string& file_format : file_formats) {
+    for (const int64_t byte_range_mb : client_max_range_mb.value()) {
+      for (const int64_t num_connections : client_max_conns.value()) {
+        for (const int64_t num_threads : num_worker_threads.value()) {
+          for (const int64_t num_chunks : read_ahead_chunks.value()) {
+            for (const int64_t shard_size_mb : min_shard_size_mb.value()) {
+              auto args = BenchmarkArgs{
+                  .file_format = file_format,
+                  .reader_worker_threads = num_threads,
+                  .client_max_connections = num_connections,
+                  .client_max_range_mb = byte_range_mb,
+                  .num_read_ahead_chunks = num_chunks,
+                  .min_shard_size_mb = shard_size_mb,
+                  .create_cache_fn =
+                      []() { return NoOpKeyValueCache::Create(); },
+              };
+              RegisterBenchmark(
+                  absl::StrFormat(kNoOpCacheNameFormat, file_format,
+                                  num_threads, num_connections, byte_range_mb,
+                                  num_chunks, shard_size_mb),
+                  args);
+              args.create_cache_fn = []() { return KeyValueCache::Create(); };
+              RegisterBenchmark(
+                  absl::StrFormat(kMutexCacheNameFormat, file_format,
+                                  num_threads, num_connections, byte_range_mb,
+                                  num_chunks, shard_size_mb),
+                  args);
+            }
+          }
+        }
       }
     }
   }
 }
 
+bool IsLatencyEmulated() {
+  return absl::GetFlag(FLAGS_emulated_request_latency_ms) > 0 ||
+         absl::GetFlag(FLAGS_emulated_max_jitter_ms) > 0 ||
+         absl::GetFlag(FLAGS_emulated_request_bandwidth_mb_per_second) > 0 ||
+         absl::GetFlag(FLAGS_emulated_total_bandwidth_mb_per_second) > 0;
+}
+
+// Wraps `blob_client` so that its requests take as long as requests to cloud
+// storage, if any latency is emulated. Blob readers then read ranges of the
+// client options.
+std::unique_ptr<BlobStorageClient> MaybeEmulateLatency(
+    std::unique_ptr<BlobStorageClient> blob_client,
+    const BlobStorageClient::ClientOptions& client_options) {
+  if (!IsLatencyEmulated()) {
+    return blob_client;
+  }
+  return std::make_unique<LatencyEmulatingBlobStorageClient>(
+      std::move(blob_client),
+      LatencyEmulatingBlobStorageClient::Options{
+          .request_latency = absl::Milliseconds(
+              absl::GetFlag(FLAGS_emulated_request_latency_ms)),
+          .max_jitter =
+              absl::Milliseconds(absl::GetFlag(FLAGS_emulated_max_jitter_ms)),
+          .request_bandwidth_bytes_per_second =
+              absl::GetFlag(FLAGS_emulated_request_bandwidth_mb_per_second) *
+              kBytesPerMb,
+          .total_bandwidth_bytes_per_second =
+              absl::GetFlag(FLAGS_emulated_total_bandwidth_mb_per_second) *
+              kBytesPerMb,
+          .max_range_bytes = client_options.max_range_bytes,
+          .num_read_ahead_chunks = client_options.num_read_ahead_chunks,
+      });
+}
+
 absl::Status ApplyUpdateMutation(const KeyValueMutationRecord& record,
                                  Cache& cache) {
   if (record.value_type() == Value::StringValue) {
@@ -215,30 +339,42 @@ absl::Status ApplyDeleteMutation(const KeyValueMutationRecord& record,
 
 void BM_LoadDataIntoCache(benchmark::State& state, BenchmarkArgs args) {
   BlobStorageClient::ClientOptions options;
-  options.max_range_bytes = args.client_max_range_mb * 1024 * 1024;
+  options.max_range_bytes = args.client_max_range_mb * kBytesPerMb;
   options.max_connections = args.client_max_connections;
+  options.num_read_ahead_chunks = args.num_read_ahead_chunks;
 
   std::unique_ptr<BlobStorageClientFactory> blob_storage_client_factory =
       BlobStorageClientFactory::Create();
-  std::unique_ptr<BlobStorageClient> blob_client =
-      blob_storage_client_factory->CreateBlobStorageClient(options);
-  ConcurrentStreamRecordReader<std::string_view> record_reader(
-      /*stream_factory=*/
-      [blob_client = blob_client.get()]() {
-        return std::make_unique<BlobRecordStream>(
-            blob_client->GetBlobReader(GetBlobLocation()));
-      },
-      /*options=*/
-      {
-          .num_worker_threads = args.reader_worker_threads,
-      });
-  auto stream_size = GetBlobSize(*blob_client, GetBlobLocation());
+  std::unique_ptr<BlobStorageClient> blob_client = MaybeEmulateLatency(
+      blob_storage_client_factory->CreateBlobStorageClient(options), options);
+  const auto blob_location = GetBlobLocation(args.file_format);
+  auto stream_factory = [blob_client = blob_client.get(), blob_location]() {
+    return std::make_unique<BlobRecordStream>(
+        blob_client->GetBlobReader(blob_location));
+  };
+  std::unique_ptr<StreamRecordReader> record_reader;
+  if (args.file_format == kAvroFormat) {
+    AvroConcurrentStreamRecordReader::Options options;
+    options.num_worker_threads = args.reader_worker_threads;
+    options.min_byte_range_size_bytes = args.min_shard_size_mb * kBytesPerMb;
+    record_reader = std::make_unique<AvroConcurrentStreamRecordReader>(
+        std::move(stream_factory), std::move(options));
+  } else {
+    record_reader =
+        std::make_unique<ConcurrentStreamRecordReader<std::string_view>>(
+            std::move(stream_factory),
+            ConcurrentStreamRecordReader<std::string_view>::Options{
+                .num_worker_threads = args.reader_worker_threads,
+                .min_shard_size_bytes = args.min_shard_size_mb * kBytesPerMb,
+            });
+  }
+  auto stream_size = GetBlobSize(*blob_client, blob_location);
   std::atomic<int64_t> num_records_read{0};
   for (auto _ : state) {
     state.PauseTiming();
     auto cache = args.create_cache_fn();
     state.ResumeTiming();
-    auto status = record_reader.ReadStreamRecords([&num_records_read,
+    auto status = record_reader->ReadStreamRecords([&num_records_read,
                                                    cache = cache.get()](
                                                       std::string_view raw) {
       num_records_read++;
@@ -290,7 +426,17 @@ void BM_LoadDataIntoCache(benchmark::State& state, BenchmarkArgs args) {
 //    --record_size=1000 \
 //    --args_client_max_range_mb=8 \
 //    --args_client_max_connections=64 \
+//    --args_file_formats=riegeli,avro \
 //    --args_reader_worker_threads=16,32,64 --stderrthreshold=0
+//
+// Loading from cloud storage can be emulated with local files by adding,
+// e.g., the following flags, which make every blob request take 30ms more
+// and transfer at most 50MB/s, sharing 1000MB/s with the other requests:
+//
+//    --emulated_request_latency_ms=30 --emulated_max_jitter_ms=20 \
+//    --emulated_request_bandwidth_mb_per_second=50 \
+//    --emulated_total_bandwidth_mb_per_second=1000 \
+//    --args_read_ahead_chunks=0,2,8 --args_min_shard_size_mb=1,8,32
 int main(int argc, char** argv) {
   ::kv_server::PlatformInitializer platform_initializer;
   absl::InitializeLog();
@@ -309,35 +455,39 @@ int main(int argc, char** argv) {
       BlobStorageClientFactory::Create();
   std::unique_ptr<BlobStorageClient> blob_client =
       blob_storage_client_factory->CreateBlobStorageClient();
+  const auto file_formats = absl::GetFlag(FLAGS_args_file_formats);
   if (absl::GetFlag(FLAGS_create_input_file)) {
-    LOG(INFO) << "Creating input file: " << GetBlobLocation();
-    std::stringstream data_stream;
-    if (auto status =
-            WriteRecords(absl::GetFlag(FLAGS_num_records),
-                         absl::GetFlag(FLAGS_record_size), data_stream);
-        !status.ok()) {
-      LOG(ERROR) << "Failed to write records for data file. " << status;
-      return -1;
-    }
-    StreamBlobReader blob_reader(data_stream);
-    if (auto status = blob_client->PutBlob(blob_reader, GetBlobLocation());
-        !status.ok()) {
-      LOG(ERROR) << "Failed to write data file. " << status;
-      return -1;
+    for (const std::string& file_format : file_formats) {
+      const auto blob_location = GetBlobLocation(file_format);
+      LOG(INFO) << "Creating input file: " << blob_location;
+      std::stringstream data_stream;
+      if (auto status = WriteInputRecords(file_format, data_stream);
+          !status.ok()) {
+        LOG(ERROR) << "Failed to write records for data file. " << status;
+        return -1;
+      }
+      StreamBlobReader blob_reader(data_stream);
+      if (auto status = blob_client->PutBlob(blob_reader, blob_location);
+          !status.ok()) {
+        LOG(ERROR) << "Failed to write data file. " << status;
+        return -1;
+      }
+      LOG(INFO) << "Done creating input file: " << blob_location;
     }
-    LOG(INFO) << "Done creating input file: " << GetBlobLocation();
   }
   RegisterBenchmarks();
   ::benchmark::RunSpecifiedBenchmarks();
   ::benchmark::Shutdown();
   if (absl::GetFlag(FLAGS_create_input_file)) {
-    LOG(INFO) << "Deleting input file: " << GetBlobLocation();
-    if (auto status = blob_client->DeleteBlob(GetBlobLocation());
-        !status.ok()) {
-      LOG(ERROR) << "Failed to write data file. " << status;
-      return -1;
+    for (const std::string& file_format : file_formats) {
+      const auto blob_location = GetBlobLocation(file_format);
+      LOG(INFO) << "Deleting input file: " << blob_location;
+      if (auto status = blob_client->DeleteBlob(blob_location); !status.ok()) {
+        LOG(ERROR) << "Failed to write data file. " << status;
+        return -1;
+      }
+      LOG(INFO) << "Done deleting input file: " << blob_location;
     }
-    LOG(INFO) << "Done deleting input file: " << GetBlobLocation();
   }
   return 0;
 }
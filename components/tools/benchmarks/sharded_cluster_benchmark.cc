@@ -0,0 +1,450 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Runs a sharded cluster in process and measures the getValues lookups of
+// UDFs end to end, broken down by stage. Every shard is an internal lookup
+// server on loopback over its own cache, loaded with the synthetic keys that
+// map to it. Shard 0 is also the UDF server: its getValues hook looks the keys
+// up through a sharded lookup, which sends the keys of the other shards to
+// them through the shard manager.
+//
+//  bazel run -c opt \
+//    //components/tools/benchmarks:sharded_cluster_benchmark \
+//    --//:instance=local \
+//    --//:platform=local -- \
+//    --num_shards=1,2,4 --query_size=10,100 \
+//    --benchmark_counters_tabular=true --stderrthreshold=0
+//
+// Each stage reports the average latency of its calls in microseconds:
+// => hook_us - getValues hook, from the keys of the UDF to its output.
+// => fanout_us - sharded lookup of the keys of all shards.
+// => remote_us - remote lookup of one shard, including encryption, gRPC and
+// the decryption and lookup on the remote shard.
+// => remote_cache_us - lookup in the cache of a remote shard.
+// => local_cache_us - lookup in the cache of the UDF server's shard.
+// The difference of remote_us and remote_cache_us is the cost of a remote
+// call.
+
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_set.h"
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "absl/log/check.h"
+#include "absl/log/flags.h"
+#include "absl/log/initialize.h"
+#include "absl/log/log.h"
+#include "absl/memory/memory.h"
+#include "absl/random/random.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "benchmark/benchmark.h"
+#include "components/data_server/cache/cache.h"
+#include "components/data_server/cache/key_value_cache.h"
+#include "components/internal_server/local_lookup.h"
+#include "components/internal_server/lookup.grpc.pb.h"
+#include "components/internal_server/lookup.h"
+#include "components/internal_server/lookup_server_impl.h"
+#include "components/internal_server/remote_lookup_client.h"
+#include "components/internal_server/sharded_lookup.h"
+#include "components/sharding/shard_manager.h"
+#include "components/telemetry/server_definition.h"
+#include "components/tools/benchmarks/benchmark_util.h"
+#include "components/udf/hooks/get_values_hook.h"
+#include "grpcpp/grpcpp.h"
+#include "public/sharding/key_sharder.h"
+#include "public/sharding/sharding_function.h"
+#include "src/encryption/key_fetcher/fake_key_fetcher_manager.h"
+
+ABSL_FLAG(std::vector<std::string>, num_shards, std::vector<std::string>({"2"}),
+          "Numbers of shards of the clusters to benchmark.");
+ABSL_FLAG(std::vector<std::string>, record_size,
+          std::vector<std::string>({"100"}),
+          "Sizes of the values of the keys loaded into the cluster.");
+ABSL_FLAG(std::vector<std::string>, query_size,
+          std::vector<std::string>({"10"}),
+          "Numbers of keys looked up by each getValues call.");
+ABSL_FLAG(int64_t, keyspace_size, 100000,
+          "Number of keys loaded into the cluster, across all shards.");
+ABSL_FLAG(int64_t, iterations, -1,
+          "Number of iterations to run each benchmark.");
+ABSL_FLAG(int64_t, min_threads, 1,
+          "Minimum number of threads calling the getValues hook.");
+ABSL_FLAG(int64_t, max_threads, 1,
+          "Maximum number of threads calling the getValues hook.");
+
+namespace kv_server {
+namespace {
+
+using google::scp::roma::FunctionBindingPayload;
+using google::scp::roma::proto::FunctionBindingIoProto;
+using kv_server::benchmark::GenerateRandomString;
+using kv_server::benchmark::ParseInt64List;
+using privacy_sandbox::server_common::FakeKeyFetcherManager;
+
+// Format variables used to generate benchmark names.
+//
+// => sh - number of shards of the cluster.
+// => qz - query size, i.e., number of keys looked up by each getValues call.
+// => rz - record size, i.e., size of the value of each key.
+constexpr std::string_view kGetValuesFmt =
+    "BM_ShardedCluster_GetValues/sh:%d/qz:%d/rz:%d";
+
+// Number of distinct requests each benchmark thread cycles through.
+constexpr int kNumRequestsPerThread = 1000;
+
+// Latency of the calls of one stage of a lookup.
+class StageLatency {
+ public:
+  void Add(absl::Duration latency) {
+    total_nanos_.fetch_add(absl::ToInt64Nanoseconds(latency),
+                           std::memory_order_relaxed);
+    num_calls_.fetch_add(1, std::memory_order_relaxed);
+  }
+  // Returns the average latency of the calls in microseconds.
+  double AverageMicros() const {
+    const int64_t num_calls = num_calls_.load(std::memory_order_relaxed);
+    if (num_calls == 0) {
+      return 0;
+    }
+    return total_nanos_.load(std::memory_order_relaxed) / 1000.0 / num_calls;
+  }
+  void Reset() {
+    total_nanos_.store(0, std::memory_order_relaxed);
+    num_calls_.store(0, std::memory_order_relaxed);
+  }
+
+ private:
+  std::atomic<int64_t> total_nanos_ = 0;
+  std::atomic<int64_t> num_calls_ = 0;
+};
+
+struct StageLatencies {
+  StageLatency hook;
+  StageLatency fanout;
+  StageLatency remote;
+  StageLatency remote_cache;
+  StageLatency local_cache;
+};
+
+// Adds the latency of the calls of `lookup` to `latency`.
+class TimedLookup : public Lookup {
+ public:
+  TimedLookup(const Lookup& lookup, StageLatency& latency)
+      : lookup_(lookup), latency_(latency) {}
+
+  absl::StatusOr<InternalLookupResponse> GetKeyValues(
+      const RequestContext& request_context,
+      const absl::flat_hash_set<std::string_view>& keys) const override {
+    const absl::Time start = absl::Now();
+    auto response = lookup_.GetKeyValues(request_context, keys);
+    latency_.Add(absl::Now() - start);
+    return response;
+  }
+
+  absl::StatusOr<InternalLookupResponse> GetKeyValueSet(
+      const RequestContext& request_context,
+      const absl::flat_hash_set<std::string_view>& key_set) const override {
+    const absl::Time start = absl::Now();
+    auto response = lookup_.GetKeyValueSet(request_context, key_set);
+    latency_.Add(absl::Now() - start);
+    return response;
+  }
+
+  absl::StatusOr<InternalRunQueryResponse> RunQuery(
+      const RequestContext& request_context, std::string query) const override {
+    const absl::Time start = absl::Now();
+    auto response = lookup_.RunQuery(request_context, std::move(query));
+    latency_.Add(absl::Now() - start);
+    return response;
+  }
+
+ private:
+  const Lookup& lookup_;
+  StageLatency& latency_;
+};
+
+// Adds the latency of the calls of `client` to `latency`.
+class TimedRemoteLookupClient : public RemoteLookupClient {
+ public:
+  TimedRemoteLookupClient(std::unique_ptr<RemoteLookupClient> client,
+                          StageLatency& latency)
+      : client_(std::move(client)), latency_(latency) {}
+
+  absl::StatusOr<InternalLookupResponse> GetValues(
+      const RequestContext& request_context,
+      std::string_view serialized_message,
+      int32_t padding_length) const override {
+    const absl::Time start = absl::Now();
+    auto response =
+        client_->GetValues(request_context, serialized_message, padding_length);
+    latency_.Add(absl::Now() - start);
+    return response;
+  }
+
+  absl::StatusOr<InternalLookupResponse> GetValues(
+      const RequestContext& request_context,
+      std::string_view serialized_message, int32_t padding_length,
+      grpc::ClientContext& context) const override {
+    const absl::Time start = absl::Now();
+    auto response = client_->GetValues(request_context, serialized_message,
+                                       padding_length, context);
+    latency_.Add(absl::Now() - start);
+    return response;
+  }
+
+  std::string_view GetIpAddress() const override {
+    return client_->GetIpAddress();
+  }
+
+ private:
+  std::unique_ptr<RemoteLookupClient> client_;
+  StageLatency& latency_;
+};
+
+class BitGenRandomGenerator : public RandomGenerator {
+ public:
+  int64_t Get(int64_t upper_bound) override {
+    return absl::Uniform<int64_t>(bitgen_, 0, upper_bound);
+  }
+
+ private:
+  absl::BitGen bitgen_;
+};
+
+KeySharder GetKeySharder() { return KeySharder(ShardingFunction(/*seed=*/"")); }
+
+std::string GetKey(int64_t index) { return absl::StrCat("key", index); }
+
+// One data server of the cluster, serving the internal lookups of its keys on
+// a loopback port.
+struct DataShard {
+  std::unique_ptr<Cache> cache;
+  std::unique_ptr<Lookup> local_lookup;
+  std::unique_ptr<Lookup> timed_lookup;
+  std::unique_ptr<LookupServiceImpl> lookup_service;
+  std::unique_ptr<grpc::Server> server;
+  std::string address;
+};
+
+// A cluster of data servers, the first of which also runs the getValues hook
+// of UDFs.
+class Cluster {
+ public:
+  static std::unique_ptr<Cluster> Create(int32_t num_shards,
+                                         int64_t keyspace_size,
+                                         int64_t record_size) {
+    auto cluster = absl::WrapUnique(new Cluster());
+    const KeySharder key_sharder = GetKeySharder();
+    std::vector<absl::flat_hash_set<std::string>> cluster_mappings;
+    for (int32_t shard_num = 0; shard_num < num_shards; shard_num++) {
+      auto shard = std::make_unique<DataShard>();
+      shard->cache = KeyValueCache::Create();
+      shard->local_lookup = CreateLocalLookup(*shard->cache);
+      shard->timed_lookup = std::make_unique<TimedLookup>(
+          *shard->local_lookup, shard_num == 0
+                                    ? cluster->latencies_.local_cache
+                                    : cluster->latencies_.remote_cache);
+      shard->lookup_service = std::make_unique<LookupServiceImpl>(
+          *shard->timed_lookup, cluster->key_fetcher_manager_);
+      int port = 0;
+      grpc::ServerBuilder builder;
+      builder.AddListeningPort("127.0.0.1:0",
+                               grpc::InsecureServerCredentials(), &port);
+      builder.RegisterService(shard->lookup_service.get());
+      shard->server = builder.BuildAndStart();
+      CHECK(shard->server != nullptr && port > 0)
+          << "Failed to start shard " << shard_num;
+      shard->address = absl::StrCat("127.0.0.1:", port);
+      cluster_mappings.push_back({shard->address});
+      cluster->shards_.push_back(std::move(shard));
+    }
+    const std::string value = GenerateRandomString(record_size);
+    for (int64_t i = 0; i < keyspace_size; i++) {
+      const std::string key = GetKey(i);
+      const int shard_num = key_sharder.GetShardNum(key, num_shards);
+      cluster->shards_[shard_num]->cache->UpdateKeyValue(key, value, 1);
+    }
+    auto shard_manager = ShardManager::Create(
+        num_shards, cluster_mappings, std::make_unique<BitGenRandomGenerator>(),
+        [cluster = cluster.get()](const std::string& address) {
+          return std::make_unique<TimedRemoteLookupClient>(
+              RemoteLookupClient::Create(
+                  InternalLookupService::NewStub(grpc::CreateChannel(
+                      address, grpc::InsecureChannelCredentials())),
+                  cluster->key_fetcher_manager_),
+              cluster->latencies_.remote);
+        });
+    CHECK(shard_manager.ok()) << shard_manager.status();
+    cluster->shard_manager_ = *std::move(shard_manager);
+    cluster->sharded_lookup_ = CreateShardedLookup(
+        *cluster->shards_[0]->timed_lookup, num_shards, /*current_shard_num=*/0,
+        *cluster->shard_manager_, key_sharder);
+    cluster->hook_ = GetValuesHook::Create(GetValuesHook::OutputType::kString);
+    cluster->hook_->FinishInit(std::make_unique<TimedLookup>(
+        *cluster->sharded_lookup_, cluster->latencies_.fanout));
+    return cluster;
+  }
+
+  ~Cluster() {
+    for (auto& shard : shards_) {
+      shard->server->Shutdown();
+      shard->server->Wait();
+    }
+  }
+
+  // Calls the getValues hook as a UDF would.
+  void GetValues(FunctionBindingIoProto& io, RequestContext request_context) {
+    FunctionBindingPayload<RequestContext> payload{io,
+                                                   std::move(request_context)};
+    const absl::Time start = absl::Now();
+    (*hook_)(payload);
+    latencies_.hook.Add(absl::Now() - start);
+  }
+
+  StageLatencies& latencies() { return latencies_; }
+
+ private:
+  Cluster() = default;
+
+  FakeKeyFetcherManager key_fetcher_manager_;
+  StageLatencies latencies_;
+  std::vector<std::unique_ptr<DataShard>> shards_;
+  std::unique_ptr<ShardManager> shard_manager_;
+  std::unique_ptr<Lookup> sharded_lookup_;
+  std::unique_ptr<GetValuesHook> hook_;
+};
+
+// Returns the cluster of `num_shards` shards with values of `record_size`
+// bytes, which is created the first time. Clusters are kept for the following
+// benchmarks since loading them takes a while. Only called by the first
+// benchmark thread.
+Cluster& GetCluster(int32_t num_shards, int64_t record_size) {
+  static auto* const clusters =
+      new std::map<std::pair<int32_t, int64_t>, std::unique_ptr<Cluster>>();
+  auto& cluster = (*clusters)[{num_shards, record_size}];
+  if (cluster == nullptr) {
+    cluster = Cluster::Create(num_shards, absl::GetFlag(FLAGS_keyspace_size),
+                              record_size);
+  }
+  return *cluster;
+}
+
+struct BenchmarkArgs {
+  int32_t num_shards = 1;
+  int64_t record_size = 1;
+  int64_t query_size = 1;
+};
+
+// Cluster of the running benchmark, set by the first benchmark thread before
+// the benchmark loop, which the other threads only enter once it is set.
+std::atomic<Cluster*> current_cluster = nullptr;
+
+void BM_GetValues(::benchmark::State& state, BenchmarkArgs args) {
+  if (state.thread_index() == 0) {
+    Cluster& cluster = GetCluster(args.num_shards, args.record_size);
+    StageLatencies& latencies = cluster.latencies();
+    latencies.hook.Reset();
+    latencies.fanout.Reset();
+    latencies.remote.Reset();
+    latencies.remote_cache.Reset();
+    latencies.local_cache.Reset();
+    current_cluster.store(&cluster);
+  }
+  absl::BitGen bitgen;
+  const int64_t keyspace_size = absl::GetFlag(FLAGS_keyspace_size);
+  std::vector<FunctionBindingIoProto> requests(kNumRequestsPerThread);
+  for (auto& request : requests) {
+    for (int64_t i = 0; i < args.query_size; i++) {
+      request.mutable_input_list_of_string()->add_data(
+          GetKey(absl::Uniform<int64_t>(bitgen, 0, keyspace_size)));
+    }
+  }
+  ScopeMetricsContext metrics_context;
+  int request_index = 0;
+  for (auto _ : state) {
+    FunctionBindingIoProto io = requests[request_index];
+    request_index = (request_index + 1) % kNumRequestsPerThread;
+    current_cluster.load()->GetValues(io, RequestContext(metrics_context));
+    ::benchmark::DoNotOptimize(io);
+  }
+  state.SetItemsProcessed(state.iterations() * args.query_size);
+  if (state.thread_index() == 0) {
+    // The benchmark loop ends once every thread is done, so the latencies are
+    // final.
+    const StageLatencies& latencies = current_cluster.load()->latencies();
+    state.counters["hook_us"] = latencies.hook.AverageMicros();
+    state.counters["fanout_us"] = latencies.fanout.AverageMicros();
+    state.counters["remote_us"] = latencies.remote.AverageMicros();
+    state.counters["remote_cache_us"] = latencies.remote_cache.AverageMicros();
+    state.counters["local_cache_us"] = latencies.local_cache.AverageMicros();
+  }
+}
+
+void RegisterBenchmarks() {
+  auto num_shards_list = ParseInt64List(absl::GetFlag(FLAGS_num_shards));
+  auto record_sizes = ParseInt64List(absl::GetFlag(FLAGS_record_size));
+  auto query_sizes = ParseInt64List(absl::GetFlag(FLAGS_query_size));
+  CHECK(num_shards_list.ok()) << num_shards_list.status();
+  CHECK(record_sizes.ok()) << record_sizes.status();
+  CHECK(query_sizes.ok()) << query_sizes.status();
+  const int64_t min_threads = std::max(absl::GetFlag(FLAGS_min_threads), 1L);
+  const int64_t max_threads =
+      std::max(absl::GetFlag(FLAGS_max_threads), min_threads);
+  for (auto num_shards : *num_shards_list) {
+    for (auto record_size : *record_sizes) {
+      for (auto query_size : *query_sizes) {
+        auto args = BenchmarkArgs{
+            .num_shards = static_cast<int32_t>(num_shards),
+            .record_size = record_size,
+            .query_size = query_size,
+        };
+        auto b = ::benchmark::RegisterBenchmark(
+            absl::StrFormat(kGetValuesFmt, num_shards, query_size, record_size)
+                .c_str(),
+            BM_GetValues, args);
+        b->ThreadRange(min_threads, max_threads)->UseRealTime();
+        if (absl::GetFlag(FLAGS_iterations) > 0) {
+          b->Iterations(absl::GetFlag(FLAGS_iterations));
+        }
+      }
+    }
+  }
+}
+
+}  // namespace
+}  // namespace kv_server
+
+int main(int argc, char** argv) {
+  absl::InitializeLog();
+  ::benchmark::Initialize(&argc, argv);
+  absl::ParseCommandLine(argc, argv);
+  kv_server::InitMetricsContextMap();
+  ::kv_server::RegisterBenchmarks();
+  ::benchmark::RunSpecifiedBenchmarks();
+  ::benchmark::Shutdown();
+  return 0;
+}
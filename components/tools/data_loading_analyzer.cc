@@ -12,15 +12,20 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
 #include <fstream>
 #include <iostream>
 #include <memory>
+#include <optional>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include "absl/flags/flag.h"
 #include "absl/flags/parse.h"
 #include "absl/log/log.h"
 #include "absl/strings/str_cat.h"
+#include "absl/synchronization/mutex.h"
 #include "components/data/blob_storage/blob_storage_client.h"
 #include "components/data/blob_storage/delta_file_notifier.h"
 #include "components/data_server/cache/cache.h"
@@ -32,6 +37,7 @@
 #include "public/data_loading/data_loading_generated.h"
 #include "public/data_loading/readers/riegeli_stream_io.h"
 #include "public/data_loading/readers/riegeli_stream_record_reader_factory.h"
+#include "public/data_loading/readers/sorted_snapshot_record_reader.h"
 #include "public/sharding/key_sharder.h"
 
 ABSL_FLAG(std::vector<std::string>, operations,
@@ -39,6 +45,17 @@ ABSL_FLAG(std::vector<std::string>, operations,
           "operations to test");
 ABSL_FLAG(std::string, bucket, "performance-test-data-bucket",
           "Bucket to read files from");
+ABSL_FLAG(std::vector<std::string>, verify_keys, std::vector<std::string>(),
+          "If set, instead of running the operations, looks up these keys in "
+          "the key index of snapshot_file and reports whether it holds them");
+ABSL_FLAG(std::string, snapshot_file, "",
+          "Snapshot file of bucket, written with a key index, to verify "
+          "verify_keys in");
+ABSL_FLAG(int32_t, num_threads, std::thread::hardware_concurrency(),
+          "Threads reading each file in the READ_ONLY and CACHE operations, "
+          "and looking up verify_keys");
+ABSL_FLAG(int32_t, num_concurrent_files, 1,
+          "Files loaded concurrently in the operations");
 
 namespace kv_server {
 namespace {
@@ -62,6 +79,20 @@ class NoopRealtimeThreadPoolManager : public RealtimeThreadPoolManager {
   absl::Status Stop() override { return absl::OkStatus(); }
 };
 
+// Holds an input stream pointing to a blob of Riegeli records.
+class BlobRecordStream : public RecordStream {
+ public:
+  explicit BlobRecordStream(std::unique_ptr<BlobReader> blob_reader)
+      : blob_reader_(std::move(blob_reader)) {}
+  std::istream& Stream() override { return blob_reader_->Stream(); }
+  std::optional<std::string_view> Contents() override {
+    return blob_reader_->Contents();
+  }
+
+ private:
+  std::unique_ptr<BlobReader> blob_reader_;
+};
+
 class NoopReader : public StreamRecordReader {
   absl::StatusOr<KVFileMetadata> GetKVFileMetadata() override {
     return KVFileMetadata();
@@ -73,21 +104,87 @@ class NoopReader : public StreamRecordReader {
   }
 };
 
+void PassThrough(std::istream& data_input) {
+  std::ofstream devnull("/dev/null");
+  devnull << data_input.rdbuf();
+  devnull.close();
+}
+
+// Only reads the records, so that every record is visited without being
+// processed.
+void ReadRecord(std::string_view raw) {
+  auto record = flatbuffers::GetRoot<KeyValueMutationRecord>(raw.data());
+  if (record->logical_commit_time() == 0) {
+    LOG(INFO) << "This is a dummy log line (that should not be called) in "
+                 "order to read the record. A logical commit time of 0 is "
+                 "not expected.";
+  }
+}
+
+ConcurrentStreamRecordReader<std::string_view>::Options
+ReaderOptionsFromFlags() {
+  ConcurrentStreamRecordReader<std::string_view>::Options options;
+  options.num_worker_threads = std::max(absl::GetFlag(FLAGS_num_threads), 1);
+  return options;
+}
+
+// Passes the stream of `stream_factory` through once its records are read,
+// rather than the records to the callback.
+class PassThroughReader : public StreamRecordReader {
+ public:
+  explicit PassThroughReader(
+      std::function<std::unique_ptr<RecordStream>()> stream_factory)
+      : stream_factory_(std::move(stream_factory)) {}
+  absl::StatusOr<KVFileMetadata> GetKVFileMetadata() override {
+    return KVFileMetadata();
+  }
+  absl::Status ReadStreamRecords(
+      const std::function<absl::Status(const std::string_view&)>& callback)
+      override {
+    PassThrough(stream_factory_()->Stream());
+    return absl::OkStatus();
+  }
+
+ private:
+  std::function<std::unique_ptr<RecordStream>()> stream_factory_;
+};
+
+// Reads the records of a stream with the worker threads of a
+// `ConcurrentStreamRecordReader`, without passing them to the callback.
+class ConcurrentReadOnlyReader : public StreamRecordReader {
+ public:
+  explicit ConcurrentReadOnlyReader(
+      std::function<std::unique_ptr<RecordStream>()> stream_factory)
+      : reader_(std::move(stream_factory), ReaderOptionsFromFlags()) {}
+  absl::StatusOr<KVFileMetadata> GetKVFileMetadata() override {
+    return reader_.GetKVFileMetadata();
+  }
+  absl::Status ReadStreamRecords(
+      const std::function<absl::Status(const std::string_view&)>& callback)
+      override {
+    return reader_.ReadStreamRecords([](const std::string_view& raw) {
+      ReadRecord(raw);
+      return absl::OkStatus();
+    });
+  }
+
+ private:
+  ConcurrentStreamRecordReader<std::string_view> reader_;
+};
+
 // Reader that only reads the stream.
 // Stateless and thread-safe.
 class PassThroughStreamReaderFactory : public StreamRecordReaderFactory {
  public:
   std::unique_ptr<StreamRecordReader> CreateReader(
       std::istream& data_input) const override {
-    std::ofstream devnull("/dev/null");
-    devnull << data_input.rdbuf();
-    devnull.close();
+    PassThrough(data_input);
     return std::make_unique<NoopReader>();
   }
   std::unique_ptr<StreamRecordReader> CreateConcurrentReader(
       std::function<std::unique_ptr<RecordStream>()> stream_factory)
       const override {
-    return nullptr;
+    return std::make_unique<PassThroughReader>(std::move(stream_factory));
   }
 };
 
@@ -99,19 +196,15 @@ class ReadonlyStreamReaderFactory : public StreamRecordReaderFactory {
     absl::Cleanup reader_closer([&reader] { reader.Close(); });
     std::string_view raw;
     while (reader.ReadRecord(raw)) {
-      auto record = flatbuffers::GetRoot<KeyValueMutationRecord>(raw.data());
-      if (record->logical_commit_time() == 0) {
-        LOG(INFO) << "This is a dummy log line (that should not be called) in "
-                     "order to read the record. A logical commit time of 0 is "
-                     "not expected.";
-      }
+      ReadRecord(raw);
     }
     return std::make_unique<NoopReader>();
   }
   std::unique_ptr<StreamRecordReader> CreateConcurrentReader(
       std::function<std::unique_ptr<RecordStream>()> stream_factory)
       const override {
-    return nullptr;
+    return std::make_unique<ConcurrentReadOnlyReader>(
+        std::move(stream_factory));
   }
 };
 
@@ -166,7 +259,8 @@ absl::Status InitOnce(Operation operation) {
     default:
       LOG(INFO) << "Initializing fully";
       delta_stream_reader_factory =
-          std::make_unique<RiegeliStreamRecordReaderFactory>();
+          std::make_unique<RiegeliStreamRecordReaderFactory>(
+              ReaderOptionsFromFlags());
       break;
   }
   NoopBlobStorageChangeNotifier change_notifier;
@@ -184,15 +278,76 @@ absl::Status InitOnce(Operation operation) {
       .realtime_thread_pool_manager = realtime_thread_pool_manager,
       .udf_client = *noop_udf_client,
       .key_sharder = KeySharder(ShardingFunction{/*seed=*/""}),
+      .num_concurrent_files =
+          std::max(absl::GetFlag(FLAGS_num_concurrent_files), 1),
   });
   absl::Time end_time = absl::Now();
   LOG(INFO) << "Init used " << (end_time - start_time);
   return maybe_data_orchestrator.status();
 }
+
+// Looks up `verify_keys` in the key index of `snapshot_file`, which only reads
+// the blocks of records that may hold them. The keys are split between
+// `num_threads` threads, each with a reader of its own.
+absl::Status VerifyKeys() {
+  const std::string snapshot_file = absl::GetFlag(FLAGS_snapshot_file);
+  if (snapshot_file.empty()) {
+    return absl::InvalidArgumentError(
+        "snapshot_file is required to verify keys.");
+  }
+  std::unique_ptr<BlobStorageClient> blob_client =
+      BlobStorageClientFactory::Create()->CreateBlobStorageClient();
+  const std::vector<std::string> keys = absl::GetFlag(FLAGS_verify_keys);
+  const int num_threads = std::clamp<int>(absl::GetFlag(FLAGS_num_threads), 1,
+                                          static_cast<int>(keys.size()));
+  const absl::Time start_time = absl::Now();
+  absl::Mutex mutex;
+  int64_t num_missing_keys = 0;
+  absl::Status status;
+  std::vector<std::thread> threads;
+  threads.reserve(num_threads);
+  for (int thread_index = 0; thread_index < num_threads; thread_index++) {
+    threads.emplace_back([&, thread_index]() {
+      SortedSnapshotRecordReader reader([&blob_client, &snapshot_file]() {
+        return std::make_unique<BlobRecordStream>(blob_client->GetBlobReader(
+            {.bucket = absl::GetFlag(FLAGS_bucket), .key = snapshot_file}));
+      });
+      for (size_t i = thread_index; i < keys.size(); i += num_threads) {
+        absl::StatusOr<bool> contains_key = reader.ContainsKey(keys[i]);
+        absl::MutexLock lock(&mutex);
+        if (!contains_key.ok()) {
+          status.Update(contains_key.status());
+          return;
+        }
+        LOG(INFO) << "Key " << keys[i]
+                  << (*contains_key ? " found" : " not found") << " in "
+                  << snapshot_file;
+        num_missing_keys += !*contains_key;
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  LOG(INFO) << "Verifying keys used " << (absl::Now() - start_time);
+  if (!status.ok()) {
+    return status;
+  }
+  if (num_missing_keys > 0) {
+    return absl::NotFoundError(absl::StrCat(
+        num_missing_keys, " keys are not in ", snapshot_file));
+  }
+  return absl::OkStatus();
+}
+
 }  // namespace
 absl::Status Run() {
   kv_server::PlatformInitializer initializer;
 
+  if (!absl::GetFlag(FLAGS_verify_keys).empty()) {
+    return VerifyKeys();
+  }
+
   const std::vector<Operation> operations = OperationsFromFlag();
   LOG(INFO) << "Performing " << operations.size() << " operations";
   for (const auto op : operations) {
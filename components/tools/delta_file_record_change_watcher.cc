@@ -11,6 +11,7 @@
 // WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
 // See the License for the specific language governing permissions and
 // limitations under the License.
+#include <cstdint>
 #include <future>
 #include <iostream>
 
@@ -74,6 +75,14 @@ void Print(std::string string_decoded) {
         return absl::StrJoin(
             GetRecordValue<std::vector<std::string_view>>(record), ",");
       }
+      if (record.value_type() == Value::UInt32Set) {
+        return absl::StrJoin(
+            GetRecordValue<std::vector<uint32_t>>(record), ",");
+      }
+      if (record.value_type() == Value::UInt64Set) {
+        return absl::StrJoin(
+            GetRecordValue<std::vector<uint64_t>>(record), ",");
+      }
       return "";
     };
     std::cout << "key: " << record->key()->string_view() << std::endl;
@@ -14,6 +14,7 @@
 
 #include "components/data/realtime/realtime_notifier.h"
 
+#include <cstdint>
 #include <iostream>
 
 #include "absl/flags/flag.h"
@@ -70,6 +71,14 @@ void Print(std::string string_decoded) {
             return absl::StrJoin(
                 GetRecordValue<std::vector<std::string_view>>(record), ",");
           }
+          if (record.value_type() == Value::UInt32Set) {
+            return absl::StrJoin(
+                GetRecordValue<std::vector<uint32_t>>(record), ",");
+          }
+          if (record.value_type() == Value::UInt64Set) {
+            return absl::StrJoin(
+                GetRecordValue<std::vector<uint64_t>>(record), ",");
+          }
           return "";
         };
         LOG(INFO) << "key: " << record->key()->string_view();
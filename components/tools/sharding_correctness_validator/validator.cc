@@ -12,6 +12,8 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
+#include <atomic>
 #include <vector>
 
 #include "absl/flags/flag.h"
@@ -22,8 +24,9 @@
 #include "absl/random/random.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_format.h"
+#include "absl/synchronization/mutex.h"
 #include "public/applications/pa/response_utils.h"
-#include "public/query/cpp/grpc_client.h"
+#include "public/query/cpp/async_grpc_client.h"
 
 ABSL_FLAG(std::string, kv_endpoint, "<ip>:50051", "KV grpc endpoint");
 ABSL_FLAG(int, inclusive_upper_bound, 999999999, "Inclusive upper bound");
@@ -33,12 +36,19 @@ ABSL_FLAG(int, value_size, 10000, "Specify the size of value for the key");
 ABSL_FLAG(int, batch_size, 10, "Batch size");
 ABSL_FLAG(std::string, key_prefix, "foo", "Key prefix");
 ABSL_FLAG(bool, use_tls, false, "Whether to use TLS for grpc calls.");
+ABSL_FLAG(int, num_concurrent_requests, 1,
+          "Most requests in flight at once, still at most qps per second");
+ABSL_FLAG(int, num_channels, 1, "Channels the requests are spread over");
+ABSL_FLAG(std::string, sampling_mode, "random",
+          "Keys validated. random: batches starting at random keys. stride: "
+          "batches spread evenly over the key space. all: every key, "
+          "ignoring number_of_requests_to_make");
 
 namespace kv_server {
 namespace {
 absl::BitGen bitgen;
-int total_failures = 0;
-int total_mismatches = 0;
+std::atomic<int64_t> total_failures = 0;
+std::atomic<int64_t> total_mismatches = 0;
 
 int64_t Get(int64_t upper_bound) {
   return absl::Uniform(bitgen, 0, upper_bound);
@@ -82,21 +92,94 @@ absl::StatusOr<std::string> GetValueFromResponse(
   }
 }
 
-std::vector<std::string> GetKeys(int start_index, int batch_size) {
+std::vector<std::string> GetKeys(int64_t start_index, int batch_size) {
   const std::string key_prefix = absl::GetFlag(FLAGS_key_prefix);
   std::vector<std::string> res;
   auto idx = start_index;
   while (idx < start_index + batch_size) {
     const std::string key = absl::StrCat(key_prefix, idx);
-    LOG(INFO) << "Reading key: " << key;
+    VLOG(1) << "Reading key: " << key;
     res.emplace_back(key);
     idx++;
   }
   return res;
 }
 
+// Keys validated by the requests, see the `sampling_mode` flag.
+class KeySampler {
+ public:
+  KeySampler(std::string_view sampling_mode, int64_t inclusive_upper_bound,
+             int batch_size, int64_t number_of_requests_to_make)
+      : sampling_mode_(sampling_mode),
+        inclusive_upper_bound_(inclusive_upper_bound),
+        batch_size_(batch_size),
+        num_requests_(sampling_mode == "all"
+                          ? (inclusive_upper_bound + batch_size) / batch_size
+                          : number_of_requests_to_make) {}
+
+  int64_t num_requests() const { return num_requests_; }
+
+  // Returns the keys of the request `request_index`.
+  std::vector<std::string> KeysOf(int64_t request_index) {
+    const int64_t num_batches = inclusive_upper_bound_ / batch_size_;
+    if (sampling_mode_ == "all") {
+      const int64_t start = request_index * batch_size_;
+      return GetKeys(start, std::min<int64_t>(batch_size_,
+                                              inclusive_upper_bound_ + 1 -
+                                                  start));
+    }
+    if (sampling_mode_ == "stride") {
+      return GetKeys(request_index * num_batches / num_requests_ * batch_size_,
+                     batch_size_);
+    }
+    return GetKeys(Get(num_batches) * batch_size_, batch_size_);
+  }
+
+ private:
+  const std::string sampling_mode_;
+  const int64_t inclusive_upper_bound_;
+  const int batch_size_;
+  const int64_t num_requests_;
+};
+
+// Bounds the requests in flight.
+class RequestsInFlight {
+ public:
+  explicit RequestsInFlight(int max_requests) : max_requests_(max_requests) {}
+
+  // Waits until there are less than `max_requests` in flight, and adds one.
+  void Add() ABSL_LOCKS_EXCLUDED(mutex_) {
+    absl::MutexLock lock(&mutex_);
+    mutex_.Await(absl::Condition(
+        +[](RequestsInFlight* requests)
+             ABSL_EXCLUSIVE_LOCKS_REQUIRED(requests->mutex_) {
+               return requests->num_requests_ < requests->max_requests_;
+             },
+        this));
+    num_requests_++;
+  }
+
+  void Remove() ABSL_LOCKS_EXCLUDED(mutex_) {
+    absl::MutexLock lock(&mutex_);
+    num_requests_--;
+  }
+
+  // Waits for the requests in flight.
+  void WaitForAll() ABSL_LOCKS_EXCLUDED(mutex_) {
+    absl::MutexLock lock(&mutex_);
+    mutex_.Await(absl::Condition(
+        +[](int* num_requests) { return *num_requests == 0; },
+        &num_requests_));
+  }
+
+ private:
+  const int max_requests_;
+  absl::Mutex mutex_;
+  int num_requests_ ABSL_GUARDED_BY(mutex_) = 0;
+};
+
 void ValidateResponse(absl::StatusOr<v2::GetValuesResponse> maybe_response,
-                      std::vector<std::string>& keys) {
+                      const std::vector<std::string>& keys) {
   const int value_size = absl::GetFlag(FLAGS_value_size);
   for (const auto& key : keys) {
     auto maybe_response_value = GetValueFromResponse(maybe_response, key);
@@ -112,7 +195,7 @@ void ValidateResponse(absl::StatusOr<v2::GetValuesResponse> maybe_response,
       LOG(ERROR) << "Expected value: " << expected_value
                  << " Actual value: " << response_value;
     } else {
-      LOG(INFO) << "matches";
+      VLOG(1) << "matches";
     }
   }
 }
@@ -122,27 +205,32 @@ void Validate() {
   const int inclusive_upper_bound = absl::GetFlag(FLAGS_inclusive_upper_bound);
   const int batch_size = absl::GetFlag(FLAGS_batch_size);
   const int qps = absl::GetFlag(FLAGS_qps);
-  const int number_of_requests_to_make =
-      absl::GetFlag(FLAGS_number_of_requests_to_make);
   const bool use_tls = absl::GetFlag(FLAGS_use_tls);
+  KeySampler sampler(absl::GetFlag(FLAGS_sampling_mode), inclusive_upper_bound,
+                     batch_size,
+                     absl::GetFlag(FLAGS_number_of_requests_to_make));
   int requests_made_this_second = 0;
-  int total_requests_made = 0;
+  int64_t total_requests_made = 0;
   auto batch_end = absl::Now() + absl::Seconds(1);
-  std::unique_ptr<v2::KeyValueService::Stub> stub;
-  if (use_tls) {
-    stub = GrpcClient::CreateStub(
-        kv_endpoint, grpc::SslCredentials(grpc::SslCredentialsOptions()));
-  } else {
-    stub =
-        GrpcClient::CreateStub(kv_endpoint, grpc::InsecureChannelCredentials());
-  }
-  GrpcClient client(*stub);
-  while (total_requests_made < number_of_requests_to_make) {
-    auto random_index = Get(inclusive_upper_bound / batch_size);
-    random_index *= batch_size;
-    std::vector<std::string> keys = GetKeys(random_index, batch_size);
+  AsyncGrpcClient client(AsyncGrpcClient::CreateStubs(
+      kv_endpoint,
+      use_tls ? grpc::SslCredentials(grpc::SslCredentialsOptions())
+              : grpc::InsecureChannelCredentials(),
+      std::max(absl::GetFlag(FLAGS_num_channels), 1)));
+  RequestsInFlight requests_in_flight(
+      std::max(absl::GetFlag(FLAGS_num_concurrent_requests), 1));
+  while (total_requests_made < sampler.num_requests()) {
+    std::vector<std::string> keys = sampler.KeysOf(total_requests_made);
     auto req = GetRequest(keys);
-    ValidateResponse(client.GetValues(req), keys);
+    requests_in_flight.Add();
+    // Responses are validated on the gRPC threads, while the next requests
+    // are sent.
+    client.GetValues(
+        req, [&requests_in_flight, keys = std::move(keys)](
+                 absl::StatusOr<v2::GetValuesResponse> response) {
+          ValidateResponse(std::move(response), keys);
+          requests_in_flight.Remove();
+        });
     requests_made_this_second++;
     // rate limit to N files per second
     if (requests_made_this_second % qps == 0) {
@@ -154,6 +242,7 @@ void Validate() {
     }
     total_requests_made++;
   }
+  requests_in_flight.WaitForAll();
 
   LOG(INFO) << "Validated " << batch_size * total_requests_made
             << " key-value pairs \n";
@@ -170,7 +259,9 @@ void Validate() {
 // is deterministiclly mapped from the key -- const std::string
 // expected_value(value_size, key[key.size() - 1]); For each request a random
 // key from the key space is selected. And the request look up that key and
-// _batch_size_ of the sequential keys.
+// _batch_size_ of the sequential keys. With _sampling_mode_ stride the keys
+// are spread evenly over the key space instead, and with all every key is
+// looked up. Up to _num_concurrent_requests_ requests are in flight at once.
 // Sample command:
 // bazel run //components/tools/sharding_correctness_validator:validator --
 // --qps=5 --number_of_requests_to_make=300 --batch_size=5
@@ -20,7 +20,10 @@ bool operator==(const CodeConfig& lhs_config, const CodeConfig& rhs_config) {
   return lhs_config.logical_commit_time == rhs_config.logical_commit_time &&
          lhs_config.version == rhs_config.version &&
          lhs_config.udf_handler_name == rhs_config.udf_handler_name &&
-         lhs_config.js == rhs_config.js && lhs_config.wasm == rhs_config.wasm;
+         lhs_config.js == rhs_config.js && lhs_config.wasm == rhs_config.wasm &&
+         lhs_config.input_format == rhs_config.input_format &&
+         lhs_config.batch_handler_name == rhs_config.batch_handler_name &&
+         lhs_config.canary_percent == rhs_config.canary_percent;
 }
 
 bool operator!=(const CodeConfig& lhs_config, const CodeConfig& rhs_config) {
@@ -21,6 +21,15 @@
 
 namespace kv_server {
 
+// Format of the arguments passed to a UDF.
+enum class UdfInputFormat {
+  // Metadata and arguments are passed as JSON.
+  kJson = 0,
+  // Metadata and arguments are passed as base64 strings of serialized protos,
+  // which skips the conversion of large arguments to and from JSON.
+  kProto,
+};
+
 // Adtech configurable properties of a UDF code object.
 struct CodeConfig {
   // Only one of js or wasm needs to be set.
@@ -30,6 +39,12 @@ struct CodeConfig {
   std::string udf_handler_name;
   int64_t logical_commit_time;
   int64_t version;
+  UdfInputFormat input_format = UdfInputFormat::kJson;
+  // Optional handler that executes a batch of requests at once.
+  std::string batch_handler_name;
+  // Percentage of executions that run this code object as a canary, if
+  // between 1 and 99.
+  int32_t canary_percent = 0;
 };
 
 bool operator==(const CodeConfig& lhs_config, const CodeConfig& rhs_config);
@@ -0,0 +1,100 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/udf/hooks/get_keys_containing_hook.h"
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "absl/log/log.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "components/internal_server/lookup.h"
+#include "components/telemetry/request_trace.h"
+#include "nlohmann/json.hpp"
+
+namespace kv_server {
+namespace {
+
+using google::scp::roma::FunctionBindingPayload;
+using google::scp::roma::proto::FunctionBindingIoProto;
+
+void SetStatus(absl::StatusCode code, std::string_view message,
+               FunctionBindingIoProto& io) {
+  nlohmann::json status;
+  status["code"] = code;
+  status["message"] = std::string(message);
+  io.mutable_output_list_of_string()->add_data(status.dump());
+}
+
+class GetKeysContainingHookImpl : public GetKeysContainingHook {
+ public:
+  void FinishInit(std::unique_ptr<Lookup> lookup) {
+    if (lookup_ == nullptr) {
+      lookup_ = std::move(lookup);
+    }
+  }
+
+  void operator()(FunctionBindingPayload<RequestContext>& payload) {
+    TraceSpan span(payload.metadata.GetTrace(), "GetKeysContainingHook");
+    if (lookup_ == nullptr) {
+      SetStatus(absl::StatusCode::kInternal,
+                "getKeysContaining has not been initialized yet",
+                payload.io_proto);
+      LOG(ERROR) << "getKeysContaining hook is not initialized properly: "
+                    "lookup is nullptr";
+      return;
+    }
+
+    VLOG(9) << "getKeysContaining request: " << payload.io_proto.DebugString();
+    if (!payload.io_proto.has_input_string()) {
+      SetStatus(absl::StatusCode::kInvalidArgument,
+                "getKeysContaining input must be a string", payload.io_proto);
+      VLOG(1) << "getKeysContaining result: "
+              << payload.io_proto.DebugString();
+      return;
+    }
+
+    absl::StatusOr<InternalGetKeysContainingResponse> response =
+        lookup_->GetKeysContaining(payload.metadata,
+                                   payload.io_proto.input_string());
+    if (!response.ok()) {
+      LOG(ERROR) << "Internal get keys containing returned error: "
+                 << response.status();
+      SetStatus(response.status().code(), response.status().message(),
+                payload.io_proto);
+      VLOG(1) << "getKeysContaining result: "
+              << payload.io_proto.DebugString();
+      return;
+    }
+    *payload.io_proto.mutable_output_list_of_string()->mutable_data() =
+        std::move(*response->mutable_keys());
+    VLOG(9) << "getKeysContaining result: " << payload.io_proto.DebugString();
+  }
+
+ private:
+  // `lookup_` is initialized separately, since its dependencies create threads.
+  // Lazy load is used to ensure that it only happens after Roma forks.
+  std::unique_ptr<Lookup> lookup_;
+};
+
+}  // namespace
+
+std::unique_ptr<GetKeysContainingHook> GetKeysContainingHook::Create() {
+  return std::make_unique<GetKeysContainingHookImpl>();
+}
+
+}  // namespace kv_server
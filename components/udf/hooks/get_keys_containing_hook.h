@@ -0,0 +1,47 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef COMPONENTS_UDF_GET_KEYS_CONTAINING_HOOK_H_
+#define COMPONENTS_UDF_GET_KEYS_CONTAINING_HOOK_H_
+
+#include <memory>
+
+#include "components/internal_server/lookup.h"
+#include "components/util/request_context.h"
+#include "src/roma/config/function_binding_object_v2.h"
+
+namespace kv_server {
+
+// Functor that returns the keys whose key-value sets hold the value given as
+// input, from the set value index of the cache. Returns the keys as a list of
+// strings, or a status as a JSON string if the call fails.
+class GetKeysContainingHook {
+ public:
+  virtual ~GetKeysContainingHook() = default;
+
+  // Completes the init once the cache is loaded, see `RunQueryHook`.
+  virtual void FinishInit(std::unique_ptr<Lookup> lookup) = 0;
+
+  // This is registered with v8 and is exposed to the UDF.
+  virtual void operator()(
+      google::scp::roma::FunctionBindingPayload<RequestContext>& payload) = 0;
+
+  static std::unique_ptr<GetKeysContainingHook> Create();
+};
+
+}  // namespace kv_server
+
+#endif  // COMPONENTS_UDF_GET_KEYS_CONTAINING_HOOK_H_
@@ -0,0 +1,94 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/udf/hooks/get_keys_containing_hook.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "absl/status/status.h"
+#include "components/internal_server/mocks.h"
+#include "gmock/gmock.h"
+#include "google/protobuf/text_format.h"
+#include "gtest/gtest.h"
+
+namespace kv_server {
+namespace {
+
+using google::protobuf::TextFormat;
+using google::scp::roma::FunctionBindingPayload;
+using google::scp::roma::proto::FunctionBindingIoProto;
+using testing::_;
+using testing::ElementsAre;
+using testing::Return;
+using testing::UnorderedElementsAre;
+
+class GetKeysContainingHookTest : public ::testing::Test {
+ protected:
+  void SetUp() override { InitMetricsContextMap(); }
+};
+
+TEST_F(GetKeysContainingHookTest, ReturnsKeysOfValue) {
+  InternalGetKeysContainingResponse response;
+  TextFormat::ParseFromString(R"pb(keys: "set1" keys: "set2")pb", &response);
+  auto mock_lookup = std::make_unique<MockLookup>();
+  EXPECT_CALL(*mock_lookup, GetKeysContaining(_, "v1"))
+      .WillOnce(Return(response));
+
+  FunctionBindingIoProto io;
+  TextFormat::ParseFromString(R"pb(input_string: "v1")pb", &io);
+  auto hook = GetKeysContainingHook::Create();
+  hook->FinishInit(std::move(mock_lookup));
+  ScopeMetricsContext metrics_context;
+  RequestContext request_context(metrics_context);
+  FunctionBindingPayload<RequestContext> payload{io, request_context};
+  (*hook)(payload);
+  EXPECT_THAT(io.output_list_of_string().data(),
+              UnorderedElementsAre("set1", "set2"));
+}
+
+TEST_F(GetKeysContainingHookTest, ReturnsStatusOfLookupError) {
+  auto mock_lookup = std::make_unique<MockLookup>();
+  EXPECT_CALL(*mock_lookup, GetKeysContaining(_, "v1"))
+      .WillOnce(Return(absl::FailedPreconditionError("Not enabled")));
+
+  FunctionBindingIoProto io;
+  TextFormat::ParseFromString(R"pb(input_string: "v1")pb", &io);
+  auto hook = GetKeysContainingHook::Create();
+  hook->FinishInit(std::move(mock_lookup));
+  ScopeMetricsContext metrics_context;
+  RequestContext request_context(metrics_context);
+  FunctionBindingPayload<RequestContext> payload{io, request_context};
+  (*hook)(payload);
+  EXPECT_THAT(io.output_list_of_string().data(),
+              ElementsAre(R"({"code":9,"message":"Not enabled"})"));
+}
+
+TEST_F(GetKeysContainingHookTest, RejectsNonStringInput) {
+  FunctionBindingIoProto io;
+  TextFormat::ParseFromString(R"pb(input_list_of_string { data: "v1" })pb",
+                              &io);
+  auto hook = GetKeysContainingHook::Create();
+  hook->FinishInit(std::make_unique<MockLookup>());
+  ScopeMetricsContext metrics_context;
+  RequestContext request_context(metrics_context);
+  FunctionBindingPayload<RequestContext> payload{io, request_context};
+  (*hook)(payload);
+  EXPECT_THAT(io.output_list_of_string().data(),
+              ElementsAre(R"({"code":3,"message":"getKeysContaining input must be a string"})"));
+}
+
+}  // namespace
+}  // namespace kv_server
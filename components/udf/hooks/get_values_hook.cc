@@ -14,28 +14,35 @@
 
 #include "components/udf/hooks/get_values_hook.h"
 
+#include <cstdint>
 #include <memory>
 #include <string>
+#include <string_view>
 #include <tuple>
 #include <utility>
 #include <vector>
 
+#include "absl/cleanup/cleanup.h"
 #include "absl/functional/any_invocable.h"
 #include "absl/log/log.h"
 #include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
 #include "absl/strings/str_join.h"
 #include "components/data_server/cache/cache.h"
 #include "components/internal_server/local_lookup.h"
 #include "components/internal_server/lookup.pb.h"
+#include "components/internal_server/request_lookup_cache.h"
+#include "components/telemetry/request_trace.h"
 #include "components/telemetry/server_definition.h"
-#include "google/protobuf/util/json_util.h"
+#include "components/telemetry/udf_usage_counters.h"
+#include "google/protobuf/arena.h"
+#include "google/protobuf/map.h"
 #include "nlohmann/json.hpp"
 #include "public/udf/binary_get_values.pb.h"
 
 namespace kv_server {
 namespace {
 
-using google::protobuf::json::MessageToJsonString;
 using google::scp::roma::FunctionBindingPayload;
 using google::scp::roma::proto::FunctionBindingIoProto;
 
@@ -49,37 +56,96 @@ void SetBinaryGetValuesAsBytes(const BinaryGetValuesResponse& binary_response,
   binary_response.SerializeToArray(&buffer[0], size);
 }
 
-Status GetStatus(int code, std::string_view message) {
-  Status status;
+void FillStatus(int code, std::string_view message, Status& status) {
   status.set_code(code);
   status.set_message(message);
-  return status;
+}
+
+// Binary responses are built on an arena of the hook call, so that their
+// entries, one per key, are allocated from a few blocks and freed at once
+// after being serialized.
+BinaryGetValuesResponse* CreateBinaryResponse(google::protobuf::Arena& arena) {
+  return google::protobuf::Arena::CreateMessage<BinaryGetValuesResponse>(
+      &arena);
 }
 
 void SetStatusAsBytes(absl::StatusCode code, std::string_view message,
                       FunctionBindingIoProto& io) {
-  BinaryGetValuesResponse binary_response;
-  *binary_response.mutable_status() =
-      GetStatus(static_cast<int>(code), message);
-  SetBinaryGetValuesAsBytes(binary_response, io);
+  google::protobuf::Arena arena;
+  BinaryGetValuesResponse* binary_response = CreateBinaryResponse(arena);
+  FillStatus(static_cast<int>(code), message,
+             *binary_response->mutable_status());
+  SetBinaryGetValuesAsBytes(*binary_response, io);
 }
 
 void SetOutputAsBytes(const InternalLookupResponse& response,
                       FunctionBindingIoProto& io) {
-  BinaryGetValuesResponse binary_response;
+  google::protobuf::Arena arena;
+  BinaryGetValuesResponse* binary_response = CreateBinaryResponse(arena);
   for (auto&& [k, v] : response.kv_pairs()) {
-    Value value;
+    Value& value = (*binary_response->mutable_kv_pairs())[k];
     if (v.has_status()) {
-      *value.mutable_status() =
-          GetStatus(v.status().code(), v.status().message());
+      FillStatus(v.status().code(), v.status().message(),
+                 *value.mutable_status());
     }
     if (v.has_value()) {
       value.set_data(v.value());
     }
-    (*binary_response.mutable_kv_pairs())[k] = std::move(value);
   }
-  *binary_response.mutable_status() = GetStatus(0, kOkStatusMessage);
-  SetBinaryGetValuesAsBytes(binary_response, io);
+  FillStatus(0, kOkStatusMessage, *binary_response->mutable_status());
+  SetBinaryGetValuesAsBytes(*binary_response, io);
+}
+
+// Looks up `keys` in `cache` and writes the values straight into the binary
+// response. Keys looked up earlier in the request get the same result, like
+// with local lookups, so the values of the other keys are also kept in the
+// request lookup cache.
+void SetCacheValuesAsBytes(const RequestContext& request_context,
+                           const Cache& cache,
+                           const absl::flat_hash_set<std::string_view>& keys,
+                           FunctionBindingIoProto& io) {
+  ScopeLatencyMetricsRecorder<InternalLookupMetricsContext,
+                              kInternalGetKeyValuesLatencyInMicros>
+      latency_recorder(request_context.GetInternalLookupMetricsContext());
+  google::protobuf::Arena arena;
+  BinaryGetValuesResponse* binary_response = CreateBinaryResponse(arena);
+  if (!keys.empty()) {
+    RequestLookupCache& lookup_cache = request_context.GetLookupCache();
+    InternalLookupResponse response;
+    const absl::flat_hash_set<std::string_view> missing_keys =
+        lookup_cache.GetValues(keys, response);
+    for (auto& [key, result] : *response.mutable_kv_pairs()) {
+      Value& value = (*binary_response->mutable_kv_pairs())[key];
+      if (result.has_status()) {
+        FillStatus(result.status().code(), result.status().message(),
+                   *value.mutable_status());
+      } else {
+        value.set_data(std::move(*result.mutable_value()));
+      }
+    }
+    response.Clear();
+    if (!missing_keys.empty()) {
+      const std::unique_ptr<GetKeyValueResult> result =
+          cache.GetKeyValues(request_context, missing_keys);
+      for (const std::string_view key : missing_keys) {
+        Value& value = (*binary_response->mutable_kv_pairs())[key];
+        SingleLookupResult& cached = (*response.mutable_kv_pairs())[key];
+        if (const auto data = result->GetValue(key); data.has_value()) {
+          value.set_data(data->data(), data->size());
+          cached.set_value(data->data(), data->size());
+        } else {
+          FillStatus(static_cast<int>(absl::StatusCode::kNotFound),
+                     absl::StrCat("Key not found: ", key),
+                     *value.mutable_status());
+          cached.mutable_status()->set_code(value.status().code());
+          cached.mutable_status()->set_message(value.status().message());
+        }
+      }
+      lookup_cache.PutValues(missing_keys, response);
+    }
+  }
+  FillStatus(0, kOkStatusMessage, *binary_response->mutable_status());
+  SetBinaryGetValuesAsBytes(*binary_response, io);
 }
 
 void SetStatusAsString(absl::StatusCode code, std::string_view message,
@@ -90,31 +156,193 @@ void SetStatusAsString(absl::StatusCode code, std::string_view message,
   io.set_output_string(status.dump());
 }
 
+// Appends `value` to `out` as a JSON string.
+void AppendJsonString(std::string_view value, std::string& out) {
+  constexpr char kHexDigits[] = "0123456789abcdef";
+  out.push_back('"');
+  for (const char c : value) {
+    switch (c) {
+      case '"':
+        out.append("\\\"");
+        break;
+      case '\\':
+        out.append("\\\\");
+        break;
+      case '\b':
+        out.append("\\b");
+        break;
+      case '\f':
+        out.append("\\f");
+        break;
+      case '\n':
+        out.append("\\n");
+        break;
+      case '\r':
+        out.append("\\r");
+        break;
+      case '\t':
+        out.append("\\t");
+        break;
+      default:
+        if (static_cast<unsigned char>(c) < 0x20) {
+          out.append("\\u00");
+          out.push_back(kHexDigits[(c >> 4) & 0xf]);
+          out.push_back(kHexDigits[c & 0xf]);
+        } else {
+          out.push_back(c);
+        }
+    }
+  }
+  out.push_back('"');
+}
+
+// Appends `status` to `out` in the proto3 JSON mapping, which leaves out the
+// code and the message when they are not set. Lookups don't set details.
+void AppendJsonStatus(int code, std::string_view message, std::string& out) {
+  out.push_back('{');
+  if (code != 0) {
+    absl::StrAppend(&out, "\"code\":", code);
+  }
+  if (!message.empty()) {
+    if (code != 0) {
+      out.push_back(',');
+    }
+    out.append("\"message\":");
+    AppendJsonString(message, out);
+  }
+  out.push_back('}');
+}
+
+// Appends `result` to `out` in the proto3 JSON mapping.
+void AppendJsonResult(const SingleLookupResult& result, std::string& out) {
+  switch (result.single_lookup_result_case()) {
+    case SingleLookupResult::kValue:
+      out.append("{\"value\":");
+      AppendJsonString(result.value(), out);
+      out.push_back('}');
+      break;
+    case SingleLookupResult::kStatus:
+      out.append("{\"status\":");
+      AppendJsonStatus(result.status().code(), result.status().message(), out);
+      out.push_back('}');
+      break;
+    case SingleLookupResult::kKeysetValues:
+      if (result.keyset_values().values().empty()) {
+        out.append("{\"keysetValues\":{}}");
+        break;
+      }
+      out.append("{\"keysetValues\":{\"values\":[");
+      for (int i = 0; i < result.keyset_values().values_size(); i++) {
+        if (i > 0) {
+          out.push_back(',');
+        }
+        AppendJsonString(result.keyset_values().values(i), out);
+      }
+      out.append("]}}");
+      break;
+    default:
+      out.append("{}");
+  }
+}
+
+// Appends the `name` field with the `results` map to `out`, unless the map is
+// empty, like the proto3 JSON mapping does.
+void AppendJsonResults(
+    std::string_view name,
+    const google::protobuf::Map<std::string, SingleLookupResult>& results,
+    std::string& out) {
+  if (results.empty()) {
+    return;
+  }
+  AppendJsonString(name, out);
+  out.append(":{");
+  bool first = true;
+  for (const auto& [key, result] : results) {
+    if (!first) {
+      out.push_back(',');
+    }
+    first = false;
+    AppendJsonString(key, out);
+    out.push_back(':');
+    AppendJsonResult(result, out);
+  }
+  out.append("},");
+}
+
+// Writes `response` in the proto3 JSON mapping, with an ok `status` added, in
+// one pass over the response.
 void SetOutputAsString(const InternalLookupResponse& response,
                        FunctionBindingIoProto& io) {
   VLOG(9) << "Processing internal lookup response";
-  std::string kv_pairs_json;
-  if (const auto json_status = MessageToJsonString(response, &kv_pairs_json);
-      !json_status.ok()) {
-    SetStatusAsString(json_status.code(), json_status.message(), io);
-    LOG(ERROR) << "MessageToJsonString failed with " << json_status;
-    VLOG(1) << "getValues result: " << io.DebugString();
-    return;
-  }
+  std::string& out = *io.mutable_output_string();
+  out.clear();
+  out.push_back('{');
+  AppendJsonResults("kvPairs", response.kv_pairs(), out);
+  AppendJsonResults("queryResults", response.query_results(), out);
+  out.append("\"status\":{\"code\":0,\"message\":");
+  AppendJsonString(kOkStatusMessage, out);
+  out.append("}}");
+}
 
-  auto kv_pairs_json_object = nlohmann::json::parse(kv_pairs_json, nullptr,
-                                                    /*allow_exceptions=*/false,
-                                                    /*ignore_comments=*/true);
-  if (kv_pairs_json_object.is_discarded()) {
-    SetStatusAsString(absl::StatusCode::kInvalidArgument,
-                      "Error while parsing JSON string.", io);
-    LOG(ERROR) << "json parse failed for " << kv_pairs_json;
+// Inserts the keys of every group of `groups` into `keys`, which point into
+// `groups`. Returns false unless `groups` is a JSON object of lists of
+// strings.
+bool CollectGroupedKeys(const nlohmann::json& groups,
+                        absl::flat_hash_set<std::string_view>& keys) {
+  if (!groups.is_object()) {
+    return false;
+  }
+  for (const auto& group : groups.items()) {
+    if (!group.value().is_array()) {
+      return false;
+    }
+    for (const auto& key : group.value()) {
+      if (!key.is_string()) {
+        return false;
+      }
+      keys.insert(key.get_ref<const std::string&>());
+    }
+  }
+  return true;
+}
 
-    return;
+// Writes the results of the keys of every group of `groups`, a JSON object of
+// lists of keys, in the format of `SetOutputAsString`, under "groups".
+// `response` holds the results of the keys of all the groups.
+void SetGroupedOutputAsString(const nlohmann::json& groups,
+                              const InternalLookupResponse& response,
+                              FunctionBindingIoProto& io) {
+  std::string& out = *io.mutable_output_string();
+  out.clear();
+  out.append("{\"groups\":{");
+  bool first_group = true;
+  for (const auto& group : groups.items()) {
+    if (!first_group) {
+      out.push_back(',');
+    }
+    first_group = false;
+    AppendJsonString(group.key(), out);
+    out.append(":{\"kvPairs\":{");
+    absl::flat_hash_set<std::string_view> written_keys;
+    for (const auto& key_json : group.value()) {
+      const std::string& key = key_json.get_ref<const std::string&>();
+      const auto it = response.kv_pairs().find(key);
+      if (it == response.kv_pairs().end() ||
+          !written_keys.insert(key).second) {
+        continue;
+      }
+      if (written_keys.size() > 1) {
+        out.push_back(',');
+      }
+      AppendJsonString(key, out);
+      out.push_back(':');
+      AppendJsonResult(it->second, out);
+    }
+    out.append("}}");
   }
-  kv_pairs_json_object["status"]["code"] = 0;
-  kv_pairs_json_object["status"]["message"] = kOkStatusMessage;
-  io.set_output_string(kv_pairs_json_object.dump());
+  out.append("},\"status\":{\"code\":0,\"message\":");
+  AppendJsonString(kOkStatusMessage, out);
+  out.append("}}");
 }
 
 class GetValuesHookImpl : public GetValuesHook {
@@ -128,7 +356,21 @@ class GetValuesHookImpl : public GetValuesHook {
     }
   }
 
+  void FinishInit(std::unique_ptr<Lookup> lookup, const Cache& local_cache) {
+    if (lookup_ == nullptr) {
+      lookup_ = std::move(lookup);
+      local_cache_ = &local_cache;
+    }
+  }
+
   void operator()(FunctionBindingPayload<RequestContext>& payload) {
+    TraceSpan span(payload.metadata.GetTrace(), "GetValuesHook");
+    ScopeUdfHookUsageRecorder usage(payload.metadata.GetUdfCodeVersion(),
+                                    UdfUsageCounters::Hook::kGetValues);
+    // Counts the keys and the output once the output is set.
+    absl::Cleanup count_marshalled_bytes = [&usage, &payload] {
+      usage.AddMarshalledBytes(payload.io_proto.ByteSizeLong());
+    };
     VLOG(9) << "Called getValues hook";
     if (lookup_ == nullptr) {
       SetStatus(absl::StatusCode::kInternal,
@@ -150,6 +392,15 @@ class GetValuesHookImpl : public GetValuesHook {
     for (const auto& key : payload.io_proto.input_list_of_string().data()) {
       keys.insert(key);
     }
+    span.SetAttribute("num_keys", static_cast<int64_t>(keys.size()));
+
+    if (local_cache_ != nullptr && output_type_ == OutputType::kBinary) {
+      VLOG(9) << "Reading values from the local cache";
+      SetCacheValuesAsBytes(payload.metadata, *local_cache_, keys,
+                            payload.io_proto);
+      VLOG(9) << "getValues result: " << payload.io_proto.DebugString();
+      return;
+    }
 
     VLOG(9) << "Calling internal lookup client";
     absl::StatusOr<InternalLookupResponse> response_or_status =
@@ -165,6 +416,110 @@ class GetValuesHookImpl : public GetValuesHook {
     VLOG(9) << "getValues result: " << payload.io_proto.DebugString();
   }
 
+  void GetGroupedValues(FunctionBindingPayload<RequestContext>& payload) {
+    TraceSpan span(payload.metadata.GetTrace(), "GetGroupedValuesHook");
+    ScopeUdfHookUsageRecorder usage(payload.metadata.GetUdfCodeVersion(),
+                                    UdfUsageCounters::Hook::kGetValues);
+    absl::Cleanup count_marshalled_bytes = [&usage, &payload] {
+      usage.AddMarshalledBytes(payload.io_proto.ByteSizeLong());
+    };
+    VLOG(9) << "Called getValuesGrouped hook";
+    if (lookup_ == nullptr) {
+      SetStatusAsString(absl::StatusCode::kInternal,
+                        "getValuesGrouped has not been initialized yet",
+                        payload.io_proto);
+      LOG(ERROR) << "getValuesGrouped hook is not initialized properly: "
+                    "lookup is nullptr";
+      return;
+    }
+
+    VLOG(9) << "getValuesGrouped request: " << payload.io_proto.DebugString();
+    const nlohmann::json groups =
+        payload.io_proto.has_input_string()
+            ? nlohmann::json::parse(payload.io_proto.input_string(), nullptr,
+                                    /*allow_exceptions=*/false)
+            : nlohmann::json();
+    absl::flat_hash_set<std::string_view> keys;
+    if (!CollectGroupedKeys(groups, keys)) {
+      SetStatusAsString(
+          absl::StatusCode::kInvalidArgument,
+          "getValuesGrouped input must be a JSON object of lists of strings",
+          payload.io_proto);
+      VLOG(1) << "getValuesGrouped result: " << payload.io_proto.DebugString();
+      return;
+    }
+    span.SetAttribute("num_groups", static_cast<int64_t>(groups.size()));
+    span.SetAttribute("num_keys", static_cast<int64_t>(keys.size()));
+
+    absl::StatusOr<InternalLookupResponse> response_or_status =
+        lookup_->GetKeyValues(payload.metadata, keys);
+    if (!response_or_status.ok()) {
+      SetStatusAsString(response_or_status.status().code(),
+                        response_or_status.status().message(),
+                        payload.io_proto);
+      VLOG(1) << "getValuesGrouped result: " << payload.io_proto.DebugString();
+      return;
+    }
+
+    SetGroupedOutputAsString(groups, *response_or_status, payload.io_proto);
+    VLOG(9) << "getValuesGrouped result: " << payload.io_proto.DebugString();
+  }
+
+  void GetValuesByPrefix(FunctionBindingPayload<RequestContext>& payload) {
+    TraceSpan span(payload.metadata.GetTrace(), "GetValuesByPrefixHook");
+    ScopeUdfHookUsageRecorder usage(payload.metadata.GetUdfCodeVersion(),
+                                    UdfUsageCounters::Hook::kGetValues);
+    absl::Cleanup count_marshalled_bytes = [&usage, &payload] {
+      usage.AddMarshalledBytes(payload.io_proto.ByteSizeLong());
+    };
+    VLOG(9) << "Called getValuesByPrefix hook";
+    if (lookup_ == nullptr) {
+      SetStatus(absl::StatusCode::kInternal,
+                "getValuesByPrefix has not been initialized yet",
+                payload.io_proto);
+      LOG(ERROR) << "getValuesByPrefix hook is not initialized properly: "
+                    "lookup is nullptr";
+      return;
+    }
+
+    VLOG(9) << "getValuesByPrefix request: " << payload.io_proto.DebugString();
+    const nlohmann::json input =
+        payload.io_proto.has_input_string()
+            ? nlohmann::json::parse(payload.io_proto.input_string(), nullptr,
+                                    /*allow_exceptions=*/false)
+            : nlohmann::json();
+    if (!input.is_object() || !input.contains("prefix") ||
+        !input["prefix"].is_string() || !input.contains("limit") ||
+        !input["limit"].is_number_integer() ||
+        input["limit"].get<int64_t>() <= 0) {
+      SetStatus(absl::StatusCode::kInvalidArgument,
+                "getValuesByPrefix input must be a JSON object with a "
+                "\"prefix\" string and a positive \"limit\"",
+                payload.io_proto);
+      VLOG(1) << "getValuesByPrefix result: "
+              << payload.io_proto.DebugString();
+      return;
+    }
+    const int64_t limit = input["limit"].get<int64_t>();
+    span.SetAttribute("limit", limit);
+
+    absl::StatusOr<InternalLookupResponse> response_or_status =
+        lookup_->GetValuesByPrefix(payload.metadata,
+                                   input["prefix"].get<std::string>(), limit);
+    if (!response_or_status.ok()) {
+      SetStatus(response_or_status.status().code(),
+                response_or_status.status().message(), payload.io_proto);
+      VLOG(1) << "getValuesByPrefix result: "
+              << payload.io_proto.DebugString();
+      return;
+    }
+    const int64_t num_keys = response_or_status->kv_pairs_size();
+    span.SetAttribute("num_keys", num_keys);
+
+    SetOutput(*response_or_status, payload.io_proto);
+    VLOG(9) << "getValuesByPrefix result: " << payload.io_proto.DebugString();
+  }
+
  private:
   void SetStatus(absl::StatusCode code, std::string_view message,
                  FunctionBindingIoProto& io) {
@@ -187,6 +542,8 @@ class GetValuesHookImpl : public GetValuesHook {
   // `lookup_` is initialized separately, since its dependencies create threads.
   // Lazy load is used to ensure that it only happens after Roma forks.
   std::unique_ptr<Lookup> lookup_;
+  // Holds every key when set, so binary lookups skip `lookup_`.
+  const Cache* local_cache_ = nullptr;
   OutputType output_type_;
 };
 }  // namespace
@@ -43,11 +43,35 @@ class GetValuesHook {
   // init can only be completed after UdfClient and cache init.
   virtual void FinishInit(std::unique_ptr<Lookup> lookup) = 0;
 
+  // Like above, for servers where `local_cache` holds every key. Binary
+  // lookups then read the values from `local_cache` straight into the output,
+  // without building an `InternalLookupResponse`.
+  virtual void FinishInit(std::unique_ptr<Lookup> lookup,
+                          const Cache& local_cache) = 0;
+
   // This is registered with v8 and is exposed to the UDF. Internally, it calls
   // the internal lookup client.
   virtual void operator()(
       google::scp::roma::FunctionBindingPayload<RequestContext>& payload) = 0;
 
+  // Like above, for several groups of keys at once, e.g. the keys, render
+  // URLs and ad component URLs of a request. The input is a JSON object of
+  // lists of keys, by group tag. The keys of all the groups are looked up
+  // together, with a single internal lookup, so sharded servers send one
+  // padded request per shard rather than one per group. The output is a
+  // JSON string with the "kvPairs" of every group under "groups", whatever
+  // the output type.
+  virtual void GetGroupedValues(
+      google::scp::roma::FunctionBindingPayload<RequestContext>& payload) = 0;
+
+  // Like `operator()`, for the keys starting with a prefix, e.g. every
+  // "campaign123:" key, from the sorted key index of the cache. The input is
+  // a JSON object with the "prefix" string and the "limit" on the number of
+  // keys, which are the first ones in order. The output is like the output of
+  // `operator()`.
+  virtual void GetValuesByPrefix(
+      google::scp::roma::FunctionBindingPayload<RequestContext>& payload) = 0;
+
   static std::unique_ptr<GetValuesHook> Create(OutputType output_type);
 };
 
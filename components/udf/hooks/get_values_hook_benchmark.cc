@@ -0,0 +1,125 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Measures the getValues hook writing lookup responses for UDFs, from the
+// keys passed by the UDF to the string or bytes output.
+//
+//  bazel run -c opt //components/udf/hooks:get_values_hook_benchmark \
+//    --//:instance=local --//:platform=local
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "absl/container/flat_hash_set.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "benchmark/benchmark.h"
+#include "components/internal_server/lookup.h"
+#include "components/telemetry/server_definition.h"
+#include "components/udf/hooks/get_values_hook.h"
+
+namespace kv_server {
+namespace {
+
+using google::scp::roma::FunctionBindingPayload;
+using google::scp::roma::proto::FunctionBindingIoProto;
+
+// Returns the same response to every lookup.
+class FixedLookup : public Lookup {
+ public:
+  explicit FixedLookup(InternalLookupResponse response)
+      : response_(std::move(response)) {}
+
+  absl::StatusOr<InternalLookupResponse> GetKeyValues(
+      const RequestContext& request_context,
+      const absl::flat_hash_set<std::string_view>& keys) const override {
+    return response_;
+  }
+
+  absl::StatusOr<InternalLookupResponse> GetKeyValueSet(
+      const RequestContext& request_context,
+      const absl::flat_hash_set<std::string_view>& key_set) const override {
+    return response_;
+  }
+
+  absl::StatusOr<InternalRunQueryResponse> RunQuery(
+      const RequestContext& request_context, std::string query) const override {
+    return InternalRunQueryResponse();
+  }
+
+ private:
+  const InternalLookupResponse response_;
+};
+
+// Looks up `state.range(0)` keys with values of `state.range(1)` bytes, one
+// in ten of which are missing.
+void BM_GetValues(benchmark::State& state, GetValuesHook::OutputType type) {
+  const int64_t num_keys = state.range(0);
+  const std::string value(state.range(1), 'v');
+  InternalLookupResponse response;
+  FunctionBindingIoProto io;
+  for (int64_t i = 0; i < num_keys; i++) {
+    std::string key = absl::StrCat("key", i);
+    SingleLookupResult& result = (*response.mutable_kv_pairs())[key];
+    if (i % 10 == 0) {
+      result.mutable_status()->set_code(5);
+      result.mutable_status()->set_message("Key not found");
+    } else {
+      result.set_value(value);
+    }
+    io.mutable_input_list_of_string()->add_data(std::move(key));
+  }
+  auto hook = GetValuesHook::Create(type);
+  hook->FinishInit(std::make_unique<FixedLookup>(std::move(response)));
+  ScopeMetricsContext metrics_context;
+  for (auto _ : state) {
+    FunctionBindingPayload<RequestContext> payload{
+        io, RequestContext(metrics_context)};
+    (*hook)(payload);
+    benchmark::DoNotOptimize(payload.io_proto);
+  }
+  state.SetItemsProcessed(state.iterations() * num_keys);
+}
+
+void BM_GetValuesString(benchmark::State& state) {
+  BM_GetValues(state, GetValuesHook::OutputType::kString);
+}
+
+void BM_GetValuesBinary(benchmark::State& state) {
+  BM_GetValues(state, GetValuesHook::OutputType::kBinary);
+}
+
+void KeysAndValueSizes(benchmark::internal::Benchmark* b) {
+  for (const int64_t num_keys : {10, 100, 1000, 10000}) {
+    for (const int64_t value_size : {32, 1024}) {
+      b->Args({num_keys, value_size});
+    }
+  }
+}
+
+BENCHMARK(BM_GetValuesString)->Apply(KeysAndValueSizes);
+BENCHMARK(BM_GetValuesBinary)->Apply(KeysAndValueSizes);
+
+}  // namespace
+}  // namespace kv_server
+
+int main(int argc, char** argv) {
+  ::benchmark::Initialize(&argc, argv);
+  kv_server::InitMetricsContextMap();
+  ::benchmark::RunSpecifiedBenchmarks();
+  ::benchmark::Shutdown();
+  return 0;
+}
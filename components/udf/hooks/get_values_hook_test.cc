@@ -20,6 +20,7 @@
 
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "components/data_server/cache/mocks.h"
 #include "components/internal_server/mocks.h"
 #include "gmock/gmock.h"
 #include "google/protobuf/message_lite.h"
@@ -114,6 +115,44 @@ TEST_F(GetValuesHookTest, StringOutput_SuccessfullyProcessesResultsWithStatus) {
   EXPECT_EQ(io.output_string(), expected.dump());
 }
 
+TEST_F(GetValuesHookTest, StringOutput_EscapesStringsAndWritesAllResults) {
+  absl::flat_hash_set<std::string_view> keys = {"key\"1"};
+  InternalLookupResponse lookup_response;
+  TextFormat::ParseFromString(
+      R"pb(kv_pairs {
+             key: "key\"1"
+             value { value: "line\nbreak\\ \x01" }
+           }
+           query_results {
+             key: "query"
+             value { keyset_values { values: "a" values: "b" } }
+           })pb",
+      &lookup_response);
+
+  auto mock_lookup = std::make_unique<MockLookup>();
+  EXPECT_CALL(*mock_lookup, GetKeyValues(_, keys))
+      .WillOnce(Return(lookup_response));
+
+  FunctionBindingIoProto io;
+  TextFormat::ParseFromString(R"pb(input_list_of_string { data: "key\"1" })pb",
+                              &io);
+  auto get_values_hook =
+      GetValuesHook::Create(GetValuesHook::OutputType::kString);
+  get_values_hook->FinishInit(std::move(mock_lookup));
+  ScopeMetricsContext metrics_context;
+  FunctionBindingPayload<RequestContext> payload{
+      io, RequestContext(metrics_context)};
+  (*get_values_hook)(payload);
+
+  nlohmann::json result_json =
+      nlohmann::json::parse(io.output_string(), nullptr,
+                            /*allow_exceptions=*/false,
+                            /*ignore_comments=*/true);
+  nlohmann::json expected =
+      R"({"kvPairs":{"key\"1":{"value":"line\nbreak\\ \u0001"}},"queryResults":{"query":{"keysetValues":{"values":["a","b"]}}},"status":{"code":0,"message":"ok"}})"_json;
+  EXPECT_EQ(result_json, expected);
+}
+
 TEST_F(GetValuesHookTest, StringOutput_LookupReturnsError) {
   absl::flat_hash_set<std::string_view> keys = {"key1"};
   auto mock_lookup = std::make_unique<MockLookup>();
@@ -202,6 +241,116 @@ TEST_F(GetValuesHookTest, BinaryOutput_SuccessfullyProcessesValue) {
   EXPECT_THAT(response.kv_pairs().at("key2"), EqualsProto(value_with_status));
 }
 
+TEST_F(GetValuesHookTest, BinaryOutput_ReadsValuesFromLocalCache) {
+  absl::flat_hash_set<std::string_view> keys = {"key1", "key2"};
+  MockCache cache;
+  EXPECT_CALL(cache, GetKeyValues(_, keys))
+      .WillOnce(ReturnKeyValues({{"key1", "value1"}}));
+  auto mock_lookup = std::make_unique<MockLookup>();
+  EXPECT_CALL(*mock_lookup, GetKeyValues).Times(0);
+
+  FunctionBindingIoProto io;
+  TextFormat::ParseFromString(
+      R"pb(input_list_of_string { data: "key1" data: "key2" })pb", &io);
+  auto get_values_hook =
+      GetValuesHook::Create(GetValuesHook::OutputType::kBinary);
+  get_values_hook->FinishInit(std::move(mock_lookup), cache);
+  ScopeMetricsContext metrics_context;
+  FunctionBindingPayload<RequestContext> payload{
+      io, RequestContext(metrics_context)};
+  (*get_values_hook)(payload);
+
+  BinaryGetValuesResponse response;
+  ASSERT_TRUE(response.ParseFromString(io.output_bytes()));
+  BinaryGetValuesResponse expected;
+  TextFormat::ParseFromString(
+      R"pb(status { code: 0 message: "ok" }
+           kv_pairs {
+             key: "key1"
+             value { data: "value1" }
+           }
+           kv_pairs {
+             key: "key2"
+             value { status { code: 5 message: "Key not found: key2" } }
+           })pb",
+      &expected);
+  EXPECT_THAT(response, EqualsProto(expected));
+}
+
+TEST_F(GetValuesHookTest, BinaryOutput_LocalCacheRepeatedKeysReadOnce) {
+  MockCache cache;
+  EXPECT_CALL(cache,
+              GetKeyValues(_, absl::flat_hash_set<std::string_view>{"key1"}))
+      .WillOnce(ReturnKeyValues({{"key1", "value1"}}));
+  // "key1" was updated after the first call of the request.
+  EXPECT_CALL(cache,
+              GetKeyValues(_, absl::flat_hash_set<std::string_view>{"key2"}))
+      .WillOnce(ReturnKeyValues({{"key1", "value1_updated"}}));
+
+  auto get_values_hook =
+      GetValuesHook::Create(GetValuesHook::OutputType::kBinary);
+  get_values_hook->FinishInit(std::make_unique<MockLookup>(), cache);
+  ScopeMetricsContext metrics_context;
+  RequestContext request_context(metrics_context);
+  FunctionBindingIoProto first_io;
+  TextFormat::ParseFromString(R"pb(input_list_of_string { data: "key1" })pb",
+                              &first_io);
+  FunctionBindingPayload<RequestContext> first_payload{first_io,
+                                                       request_context};
+  (*get_values_hook)(first_payload);
+  FunctionBindingIoProto io;
+  TextFormat::ParseFromString(
+      R"pb(input_list_of_string { data: "key1" data: "key2" })pb", &io);
+  FunctionBindingPayload<RequestContext> payload{io, request_context};
+  (*get_values_hook)(payload);
+
+  BinaryGetValuesResponse response;
+  ASSERT_TRUE(response.ParseFromString(io.output_bytes()));
+  BinaryGetValuesResponse expected;
+  TextFormat::ParseFromString(
+      R"pb(status { code: 0 message: "ok" }
+           kv_pairs {
+             key: "key1"
+             value { data: "value1" }
+           }
+           kv_pairs {
+             key: "key2"
+             value { status { code: 5 message: "Key not found: key2" } }
+           })pb",
+      &expected);
+  EXPECT_THAT(response, EqualsProto(expected));
+}
+
+TEST_F(GetValuesHookTest, StringOutput_IgnoresLocalCache) {
+  absl::flat_hash_set<std::string_view> keys = {"key1"};
+  MockCache cache;
+  EXPECT_CALL(cache, GetKeyValues).Times(0);
+  InternalLookupResponse lookup_response;
+  TextFormat::ParseFromString(R"pb(kv_pairs {
+                                     key: "key1"
+                                     value { value: "value1" }
+                                   })pb",
+                              &lookup_response);
+  auto mock_lookup = std::make_unique<MockLookup>();
+  EXPECT_CALL(*mock_lookup, GetKeyValues(_, keys))
+      .WillOnce(Return(lookup_response));
+
+  FunctionBindingIoProto io;
+  TextFormat::ParseFromString(R"pb(input_list_of_string { data: "key1" })pb",
+                              &io);
+  auto get_values_hook =
+      GetValuesHook::Create(GetValuesHook::OutputType::kString);
+  get_values_hook->FinishInit(std::move(mock_lookup), cache);
+  ScopeMetricsContext metrics_context;
+  FunctionBindingPayload<RequestContext> payload{
+      io, RequestContext(metrics_context)};
+  (*get_values_hook)(payload);
+
+  nlohmann::json expected =
+      R"({"kvPairs":{"key1":{"value":"value1"}},"status":{"code":0,"message":"ok"}})"_json;
+  EXPECT_EQ(io.output_string(), expected.dump());
+}
+
 TEST_F(GetValuesHookTest, BinaryOutput_LookupReturnsError) {
   absl::flat_hash_set<std::string_view> keys = {"key1"};
   auto mock_lookup = std::make_unique<MockLookup>();
@@ -228,5 +377,172 @@ TEST_F(GetValuesHookTest, BinaryOutput_LookupReturnsError) {
   EXPECT_EQ(response.status().message(), "Some error");
 }
 
+TEST_F(GetValuesHookTest, GroupedOutput_LooksUpAllGroupsAtOnce) {
+  absl::flat_hash_set<std::string_view> keys = {"key1", "key2", "url1"};
+  InternalLookupResponse lookup_response;
+  TextFormat::ParseFromString(R"pb(kv_pairs {
+                                     key: "key1"
+                                     value { value: "value1" }
+                                   }
+                                   kv_pairs {
+                                     key: "key2"
+                                     value { status { code: 5 } }
+                                   }
+                                   kv_pairs {
+                                     key: "url1"
+                                     value { value: "value3" }
+                                   })pb",
+                              &lookup_response);
+  auto mock_lookup = std::make_unique<MockLookup>();
+  EXPECT_CALL(*mock_lookup, GetKeyValues(_, keys))
+      .WillOnce(Return(lookup_response));
+
+  FunctionBindingIoProto io;
+  io.set_input_string(
+      R"({"keys":["key1","key2"],"renderUrls":["url1","key1","url1"],)"
+      R"("adComponentRenderUrls":[]})");
+  auto get_values_hook =
+      GetValuesHook::Create(GetValuesHook::OutputType::kString);
+  get_values_hook->FinishInit(std::move(mock_lookup));
+  ScopeMetricsContext metrics_context;
+  FunctionBindingPayload<RequestContext> payload{
+      io, RequestContext(metrics_context)};
+  get_values_hook->GetGroupedValues(payload);
+
+  nlohmann::json result_json =
+      nlohmann::json::parse(io.output_string(), nullptr,
+                            /*allow_exceptions=*/false);
+  EXPECT_FALSE(result_json.is_discarded());
+  nlohmann::json expected = R"({
+    "groups": {
+      "keys": {
+        "kvPairs": {
+          "key1": {"value": "value1"},
+          "key2": {"status": {"code": 5}}
+        }
+      },
+      "renderUrls": {
+        "kvPairs": {
+          "url1": {"value": "value3"},
+          "key1": {"value": "value1"}
+        }
+      },
+      "adComponentRenderUrls": {"kvPairs": {}}
+    },
+    "status": {"code": 0, "message": "ok"}
+  })"_json;
+  EXPECT_EQ(result_json, expected);
+}
+
+TEST_F(GetValuesHookTest, GroupedOutput_InputIsNotObjectOfLists) {
+  auto get_values_hook =
+      GetValuesHook::Create(GetValuesHook::OutputType::kBinary);
+  get_values_hook->FinishInit(std::make_unique<MockLookup>());
+  for (const std::string_view input :
+       {R"(["key1"])", R"({"keys":"key1"})", R"({"keys":[1]})", "{"}) {
+    FunctionBindingIoProto io;
+    io.set_input_string(input);
+    ScopeMetricsContext metrics_context;
+    FunctionBindingPayload<RequestContext> payload{
+        io, RequestContext(metrics_context)};
+    get_values_hook->GetGroupedValues(payload);
+
+    nlohmann::json expected =
+        R"({"code":3,"message":"getValuesGrouped input must be a JSON object of lists of strings"})"_json;
+    EXPECT_EQ(io.output_string(), expected.dump()) << input;
+  }
+}
+
+TEST_F(GetValuesHookTest, GroupedOutput_LookupReturnsError) {
+  auto mock_lookup = std::make_unique<MockLookup>();
+  EXPECT_CALL(*mock_lookup, GetKeyValues(_, _))
+      .WillOnce(Return(absl::UnknownError("Some error")));
+
+  FunctionBindingIoProto io;
+  io.set_input_string(R"({"keys":["key1"]})");
+  auto get_values_hook =
+      GetValuesHook::Create(GetValuesHook::OutputType::kString);
+  get_values_hook->FinishInit(std::move(mock_lookup));
+  ScopeMetricsContext metrics_context;
+  FunctionBindingPayload<RequestContext> payload{
+      io, RequestContext(metrics_context)};
+  get_values_hook->GetGroupedValues(payload);
+
+  nlohmann::json expected = R"({"code":2,"message":"Some error"})"_json;
+  EXPECT_EQ(io.output_string(), expected.dump());
+}
+
+TEST_F(GetValuesHookTest, PrefixOutput_LooksUpKeysWithPrefix) {
+  InternalLookupResponse lookup_response;
+  TextFormat::ParseFromString(R"pb(kv_pairs {
+                                     key: "campaign1:ad1"
+                                     value { value: "value1" }
+                                   })pb",
+                              &lookup_response);
+  auto mock_lookup = std::make_unique<MockLookup>();
+  EXPECT_CALL(*mock_lookup, GetValuesByPrefix(_, "campaign1:", 10))
+      .WillOnce(Return(lookup_response));
+
+  FunctionBindingIoProto io;
+  io.set_input_string(R"({"prefix":"campaign1:","limit":10})");
+  auto get_values_hook =
+      GetValuesHook::Create(GetValuesHook::OutputType::kString);
+  get_values_hook->FinishInit(std::move(mock_lookup));
+  ScopeMetricsContext metrics_context;
+  FunctionBindingPayload<RequestContext> payload{
+      io, RequestContext(metrics_context)};
+  get_values_hook->GetValuesByPrefix(payload);
+
+  nlohmann::json result_json =
+      nlohmann::json::parse(io.output_string(), nullptr,
+                            /*allow_exceptions=*/false);
+  EXPECT_FALSE(result_json.is_discarded());
+  nlohmann::json expected = R"({
+    "kvPairs": {"campaign1:ad1": {"value": "value1"}},
+    "status": {"code": 0, "message": "ok"}
+  })"_json;
+  EXPECT_EQ(result_json, expected);
+}
+
+TEST_F(GetValuesHookTest, PrefixOutput_InputIsNotPrefixAndLimit) {
+  auto get_values_hook =
+      GetValuesHook::Create(GetValuesHook::OutputType::kString);
+  get_values_hook->FinishInit(std::make_unique<MockLookup>());
+  for (const std::string_view input :
+       {R"("campaign1:")", R"({"prefix":"campaign1:"})",
+        R"({"prefix":1,"limit":10})", R"({"prefix":"campaign1:","limit":0})",
+        R"({"prefix":"campaign1:","limit":1.5})", "{"}) {
+    FunctionBindingIoProto io;
+    io.set_input_string(input);
+    ScopeMetricsContext metrics_context;
+    FunctionBindingPayload<RequestContext> payload{
+        io, RequestContext(metrics_context)};
+    get_values_hook->GetValuesByPrefix(payload);
+
+    nlohmann::json expected =
+        R"({"code":3,"message":"getValuesByPrefix input must be a JSON object with a \"prefix\" string and a positive \"limit\""})"_json;
+    EXPECT_EQ(io.output_string(), expected.dump()) << input;
+  }
+}
+
+TEST_F(GetValuesHookTest, PrefixOutput_LookupReturnsError) {
+  auto mock_lookup = std::make_unique<MockLookup>();
+  EXPECT_CALL(*mock_lookup, GetValuesByPrefix(_, _, _))
+      .WillOnce(Return(absl::FailedPreconditionError("Not enabled")));
+
+  FunctionBindingIoProto io;
+  io.set_input_string(R"({"prefix":"campaign1:","limit":10})");
+  auto get_values_hook =
+      GetValuesHook::Create(GetValuesHook::OutputType::kString);
+  get_values_hook->FinishInit(std::move(mock_lookup));
+  ScopeMetricsContext metrics_context;
+  FunctionBindingPayload<RequestContext> payload{
+      io, RequestContext(metrics_context)};
+  get_values_hook->GetValuesByPrefix(payload);
+
+  nlohmann::json expected = R"({"code":9,"message":"Not enabled"})"_json;
+  EXPECT_EQ(io.output_string(), expected.dump());
+}
+
 }  // namespace
 }  // namespace kv_server
@@ -21,6 +21,7 @@
 #include <tuple>
 
 #include "absl/log/log.h"
+#include "components/telemetry/udf_usage_counters.h"
 #include "components/util/request_context.h"
 
 namespace kv_server {
@@ -29,6 +30,9 @@ namespace kv_server {
 inline void LoggingFunction(absl::LogSeverity severity,
                             const RequestContext& context,
                             std::string_view msg) {
+  ScopeUdfHookUsageRecorder usage(context.GetUdfCodeVersion(),
+                                  UdfUsageCounters::Hook::kLogging);
+  usage.AddMarshalledBytes(msg.size());
   LOG(LEVEL(severity)) << msg;
 }
 
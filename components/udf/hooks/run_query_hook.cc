@@ -14,25 +14,76 @@
 
 #include "components/udf/hooks/run_query_hook.h"
 
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <limits>
 #include <memory>
 #include <string>
+#include <string_view>
 #include <tuple>
 #include <utility>
 #include <vector>
 
+#include "absl/cleanup/cleanup.h"
 #include "absl/functional/any_invocable.h"
 #include "absl/log/log.h"
 #include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
 #include "components/internal_server/lookup.h"
+#include "components/internal_server/request_lookup_cache.h"
+#include "components/telemetry/request_trace.h"
+#include "components/telemetry/udf_usage_counters.h"
 #include "nlohmann/json.hpp"
 
 namespace kv_server {
 namespace {
 
 using google::scp::roma::FunctionBindingPayload;
+using google::scp::roma::proto::FunctionBindingIoProto;
+
+// Sets the output of binary runQuery calls to `elements`, each preceded by its
+// size as a 32 bit little endian integer.
+void SetElementsAsBytes(
+    const google::protobuf::RepeatedPtrField<std::string>& elements,
+    FunctionBindingIoProto& io) {
+  size_t size = 0;
+  for (const std::string& element : elements) {
+    size += sizeof(uint32_t) + element.size();
+  }
+  std::string& buffer = *io.mutable_output_bytes();
+  buffer.resize(size);
+  char* out = buffer.data();
+  for (const std::string& element : elements) {
+    const uint32_t element_size = element.size();
+    for (int i = 0; i < 4; i++) {
+      *out++ = static_cast<char>((element_size >> (8 * i)) & 0xff);
+    }
+    std::memcpy(out, element.data(), element.size());
+    out += element.size();
+  }
+}
+
+// Sets the output of uint32 runQuery calls to `elements` as consecutive 32 bit
+// little endian integers.
+void SetElementsAsUInt32Bytes(
+    const google::protobuf::RepeatedField<uint32_t>& elements,
+    FunctionBindingIoProto& io) {
+  std::string& buffer = *io.mutable_output_bytes();
+  buffer.resize(elements.size() * sizeof(uint32_t));
+  char* out = buffer.data();
+  for (const uint32_t element : elements) {
+    for (int i = 0; i < 4; i++) {
+      *out++ = static_cast<char>((element >> (8 * i)) & 0xff);
+    }
+  }
+}
 
 class RunQueryHookImpl : public RunQueryHook {
  public:
+  explicit RunQueryHookImpl(OutputType output_type)
+      : output_type_(output_type) {}
+
   void FinishInit(std::unique_ptr<Lookup> lookup) {
     if (lookup_ == nullptr) {
       lookup_ = std::move(lookup);
@@ -40,11 +91,16 @@ class RunQueryHookImpl : public RunQueryHook {
   }
 
   void operator()(FunctionBindingPayload<RequestContext>& payload) {
+    TraceSpan span(payload.metadata.GetTrace(), "RunQueryHook");
+    ScopeUdfHookUsageRecorder usage(payload.metadata.GetUdfCodeVersion(),
+                                    UdfUsageCounters::Hook::kRunQuery);
+    // Counts the query and the output once the output is set.
+    absl::Cleanup count_marshalled_bytes = [&usage, &payload] {
+      usage.AddMarshalledBytes(payload.io_proto.ByteSizeLong());
+    };
     if (lookup_ == nullptr) {
-      nlohmann::json status;
-      status["code"] = absl::StatusCode::kInternal;
-      status["message"] = "runQuery has not been initialized yet";
-      payload.io_proto.mutable_output_list_of_string()->add_data(status.dump());
+      SetStatus(absl::StatusCode::kInternal,
+                "runQuery has not been initialized yet", payload.io_proto);
       LOG(ERROR)
           << "runQuery hook is not initialized properly: lookup is nullptr";
       return;
@@ -52,41 +108,109 @@ class RunQueryHookImpl : public RunQueryHook {
 
     VLOG(9) << "runQuery request: " << payload.io_proto.DebugString();
     if (!payload.io_proto.has_input_string()) {
-      nlohmann::json status;
-      status["code"] = absl::StatusCode::kInvalidArgument;
-      status["message"] = "runQuery input must be a string";
-      payload.io_proto.mutable_output_list_of_string()->add_data(status.dump());
+      SetStatus(absl::StatusCode::kInvalidArgument,
+                "runQuery input must be a string", payload.io_proto);
       VLOG(1) << "runQuery result: " << payload.io_proto.DebugString();
       return;
     }
 
-    VLOG(9) << "Calling internal run query client";
-    absl::StatusOr<InternalRunQueryResponse> response_or_status =
-        lookup_->RunQuery(payload.metadata, payload.io_proto.input_string());
-
-    if (!response_or_status.ok()) {
-      LOG(ERROR) << "Internal run query returned error: "
-                 << response_or_status.status();
-      payload.io_proto.mutable_output_list_of_string()->mutable_data();
-      VLOG(1) << "runQuery result: " << payload.io_proto.DebugString();
+    if (output_type_ == OutputType::kUInt32) {
+      RunUInt32Query(payload);
       return;
     }
 
+    // UDFs often run the same query for many of the arguments of a request.
+    RequestLookupCache& lookup_cache = payload.metadata.GetLookupCache();
+    const std::string& query = payload.io_proto.input_string();
+    std::shared_ptr<const InternalRunQueryResponse> response =
+        lookup_cache.GetQueryResult(query);
+    span.SetAttribute("cached", response != nullptr);
+    if (response == nullptr) {
+      VLOG(9) << "Calling internal run query client";
+      absl::StatusOr<InternalRunQueryResponse> response_or_status =
+          lookup_->RunQuery(payload.metadata, query);
+      if (!response_or_status.ok()) {
+        LOG(ERROR) << "Internal run query returned error: "
+                   << response_or_status.status();
+        if (output_type_ == OutputType::kString) {
+          payload.io_proto.mutable_output_list_of_string()->mutable_data();
+        } else {
+          payload.io_proto.mutable_output_bytes();
+        }
+        VLOG(1) << "runQuery result: " << payload.io_proto.DebugString();
+        return;
+      }
+      response = std::make_shared<const InternalRunQueryResponse>(
+          *std::move(response_or_status));
+      lookup_cache.PutQueryResult(query, response);
+    }
+
     VLOG(9) << "Processing internal run query response";
-    *payload.io_proto.mutable_output_list_of_string()->mutable_data() =
-        *std::move(response_or_status.value().mutable_elements());
+    // `COUNT(...)` queries return their count in decimal as the only element.
+    google::protobuf::RepeatedPtrField<std::string> count;
+    if (response->has_count()) {
+      count.Add(absl::StrCat(response->count()));
+    }
+    const google::protobuf::RepeatedPtrField<std::string>& elements =
+        response->has_count() ? count : response->elements();
+    if (output_type_ == OutputType::kString) {
+      *payload.io_proto.mutable_output_list_of_string()->mutable_data() =
+          elements;
+    } else {
+      SetElementsAsBytes(elements, payload.io_proto);
+    }
     VLOG(9) << "runQuery result: " << payload.io_proto.DebugString();
   }
 
  private:
+  // The request lookup cache only holds string results, so uint32 queries
+  // always go to the lookup.
+  void RunUInt32Query(FunctionBindingPayload<RequestContext>& payload) {
+    VLOG(9) << "Calling internal run uint32 set query client";
+    absl::StatusOr<InternalRunSetQueryUInt32Response> response =
+        lookup_->RunSetQueryUInt32(payload.metadata,
+                                   payload.io_proto.input_string());
+    if (!response.ok()) {
+      LOG(ERROR) << "Internal run uint32 set query returned error: "
+                 << response.status();
+      payload.io_proto.mutable_output_bytes();
+      VLOG(1) << "runQuery result: " << payload.io_proto.DebugString();
+      return;
+    }
+    if (response->has_count()) {
+      // Returns the count as the only element, saturated to 32 bits.
+      google::protobuf::RepeatedField<uint32_t> count;
+      count.Add(static_cast<uint32_t>(std::min<uint64_t>(
+          response->count(), std::numeric_limits<uint32_t>::max())));
+      SetElementsAsUInt32Bytes(count, payload.io_proto);
+    } else {
+      SetElementsAsUInt32Bytes(response->elements(), payload.io_proto);
+    }
+    VLOG(9) << "runQuery result: " << payload.io_proto.DebugString();
+  }
+
+  // Binary calls have no way to return an error, so they return no elements.
+  void SetStatus(absl::StatusCode code, std::string_view message,
+                 FunctionBindingIoProto& io) {
+    if (output_type_ != OutputType::kString) {
+      io.mutable_output_bytes();
+      return;
+    }
+    nlohmann::json status;
+    status["code"] = code;
+    status["message"] = std::string(message);
+    io.mutable_output_list_of_string()->add_data(status.dump());
+  }
+
   // `lookup_` is initialized separately, since its dependencies create threads.
   // Lazy load is used to ensure that it only happens after Roma forks.
   std::unique_ptr<Lookup> lookup_;
+  OutputType output_type_;
 };
 }  // namespace
 
-std::unique_ptr<RunQueryHook> RunQueryHook::Create() {
-  return std::make_unique<RunQueryHookImpl>();
+std::unique_ptr<RunQueryHook> RunQueryHook::Create(OutputType output_type) {
+  return std::make_unique<RunQueryHookImpl>(output_type);
 }
 
 }  // namespace kv_server
@@ -32,6 +32,14 @@ namespace kv_server {
 // Functor that acts as a wrapper for the internal query client call.
 class RunQueryHook {
  public:
+  // `kString` returns the elements as a list of strings. `kBinary` returns
+  // them as bytes, each element preceded by its size as a 32 bit little endian
+  // integer, which UDFs decode with `public/udf/run_query_binary.js`.
+  // `kUInt32` runs the query over the sets of 32-bit unsigned integers and
+  // returns the elements as bytes of consecutive 32 bit little endian
+  // integers, which UDFs read with a `Uint32Array`.
+  enum class OutputType { kString = 0, kBinary, kUInt32 };
+
   virtual ~RunQueryHook() = default;
 
   // We need to split the hook init, since lookup depends on the cache.
@@ -45,7 +53,8 @@ class RunQueryHook {
   virtual void operator()(
       google::scp::roma::FunctionBindingPayload<RequestContext>& payload) = 0;
 
-  static std::unique_ptr<RunQueryHook> Create();
+  static std::unique_ptr<RunQueryHook> Create(
+      OutputType output_type = OutputType::kString);
 };
 
 }  // namespace kv_server
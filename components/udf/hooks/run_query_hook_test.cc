@@ -22,6 +22,7 @@
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "components/internal_server/mocks.h"
+#include "components/telemetry/udf_usage_counters.h"
 #include "gmock/gmock.h"
 #include "google/protobuf/text_format.h"
 #include "gtest/gtest.h"
@@ -62,6 +63,75 @@ TEST_F(RunQueryHookTest, SuccessfullyProcessesValue) {
               UnorderedElementsAreArray({"a", "b"}));
 }
 
+TEST_F(RunQueryHookTest, ReturnsCountAsOnlyElement) {
+  std::string query = "COUNT(Q)";
+  InternalRunQueryResponse run_query_response;
+  TextFormat::ParseFromString(R"pb(count: 42)pb", &run_query_response);
+  auto mock_lookup = std::make_unique<MockLookup>();
+  EXPECT_CALL(*mock_lookup, RunQuery(_, query))
+      .WillOnce(Return(run_query_response));
+
+  FunctionBindingIoProto io;
+  TextFormat::ParseFromString(R"pb(input_string: "COUNT(Q)")pb", &io);
+  auto run_query_hook = RunQueryHook::Create();
+  run_query_hook->FinishInit(std::move(mock_lookup));
+  ScopeMetricsContext metrics_context;
+  RequestContext request_context(metrics_context);
+  FunctionBindingPayload<RequestContext> payload{io, request_context};
+  (*run_query_hook)(payload);
+  EXPECT_THAT(io.output_list_of_string().data(),
+              UnorderedElementsAreArray({"42"}));
+}
+
+TEST_F(RunQueryHookTest, RunsIdenticalQueriesOfRequestOnce) {
+  InternalRunQueryResponse run_query_response;
+  TextFormat::ParseFromString(R"pb(elements: "a")pb", &run_query_response);
+  auto mock_lookup = std::make_unique<MockLookup>();
+  EXPECT_CALL(*mock_lookup, RunQuery(_, "Q1"))
+      .WillOnce(Return(run_query_response));
+  EXPECT_CALL(*mock_lookup, RunQuery(_, "Q2"))
+      .WillOnce(Return(absl::UnknownError("Some error")))
+      .WillOnce(Return(run_query_response));
+
+  auto run_query_hook = RunQueryHook::Create();
+  run_query_hook->FinishInit(std::move(mock_lookup));
+  ScopeMetricsContext metrics_context;
+  RequestContext request_context(metrics_context);
+  // Failed queries are run again.
+  for (const std::string query : {"Q1", "Q2", "Q1", "Q2", "Q2"}) {
+    FunctionBindingIoProto io;
+    io.set_input_string(query);
+    FunctionBindingPayload<RequestContext> payload{io, request_context};
+    (*run_query_hook)(payload);
+  }
+}
+
+TEST_F(RunQueryHookTest, AccountsCallsToUdfVersion) {
+  InternalRunQueryResponse run_query_response;
+  TextFormat::ParseFromString(R"pb(elements: "a")pb", &run_query_response);
+  auto mock_lookup = std::make_unique<MockLookup>();
+  EXPECT_CALL(*mock_lookup, RunQuery(_, "Q"))
+      .WillOnce(Return(run_query_response));
+
+  FunctionBindingIoProto io;
+  io.set_input_string("Q");
+  auto run_query_hook = RunQueryHook::Create();
+  run_query_hook->FinishInit(std::move(mock_lookup));
+  ScopeMetricsContext metrics_context;
+  RequestContext request_context(metrics_context);
+  request_context.SetUdfCodeVersion(7);
+  FunctionBindingPayload<RequestContext> payload{io, request_context};
+  UdfUsageCounters::Global().Take();
+  (*run_query_hook)(payload);
+  const auto usage = UdfUsageCounters::Global().Take();
+  ASSERT_TRUE(usage.contains(7));
+  const UdfUsageCounters::HookUsage& run_query =
+      usage.at(7).hooks[static_cast<int>(UdfUsageCounters::Hook::kRunQuery)];
+  EXPECT_EQ(run_query.num_calls, 1);
+  EXPECT_EQ(run_query.marshalled_bytes, io.ByteSizeLong());
+  EXPECT_GT(run_query.wall_time, absl::ZeroDuration());
+}
+
 TEST_F(RunQueryHookTest, RunQueryClientReturnsError) {
   std::string query = "Q";
   auto mock_lookup = std::make_unique<MockLookup>();
@@ -98,5 +168,71 @@ TEST_F(RunQueryHookTest, InputIsNotString) {
           {R"({"code":3,"message":"runQuery input must be a string"})"}));
 }
 
+TEST_F(RunQueryHookTest, BinaryOutput_SuccessfullyProcessesValue) {
+  std::string query = "Q";
+  InternalRunQueryResponse run_query_response;
+  TextFormat::ParseFromString(
+      R"pb(elements: "a" elements: "" elements: "bc")pb", &run_query_response);
+  auto mock_lookup = std::make_unique<MockLookup>();
+  EXPECT_CALL(*mock_lookup, RunQuery(_, query))
+      .WillOnce(Return(run_query_response));
+
+  FunctionBindingIoProto io;
+  TextFormat::ParseFromString(R"pb(input_string: "Q")pb", &io);
+  auto run_query_hook =
+      RunQueryHook::Create(RunQueryHook::OutputType::kBinary);
+  run_query_hook->FinishInit(std::move(mock_lookup));
+  ScopeMetricsContext metrics_context;
+  RequestContext request_context(metrics_context);
+  FunctionBindingPayload<RequestContext> payload{io, request_context};
+  (*run_query_hook)(payload);
+  EXPECT_EQ(io.output_bytes(), std::string("\x01\0\0\0a"
+                                           "\0\0\0\0"
+                                           "\x02\0\0\0bc",
+                                           15));
+}
+
+TEST_F(RunQueryHookTest, BinaryOutput_RunQueryClientReturnsError) {
+  std::string query = "Q";
+  auto mock_lookup = std::make_unique<MockLookup>();
+  EXPECT_CALL(*mock_lookup, RunQuery(_, query))
+      .WillOnce(Return(absl::UnknownError("Some error")));
+
+  FunctionBindingIoProto io;
+  TextFormat::ParseFromString(R"pb(input_string: "Q")pb", &io);
+  auto run_query_hook =
+      RunQueryHook::Create(RunQueryHook::OutputType::kBinary);
+  run_query_hook->FinishInit(std::move(mock_lookup));
+  ScopeMetricsContext metrics_context;
+  RequestContext request_context(metrics_context);
+  FunctionBindingPayload<RequestContext> payload{io, request_context};
+  (*run_query_hook)(payload);
+  EXPECT_TRUE(io.has_output_bytes());
+  EXPECT_TRUE(io.output_bytes().empty());
+}
+
+TEST_F(RunQueryHookTest, UInt32Output_SuccessfullyProcessesValue) {
+  std::string query = "Q";
+  InternalRunSetQueryUInt32Response run_query_response;
+  TextFormat::ParseFromString(R"pb(elements: 1 elements: 258)pb",
+                              &run_query_response);
+  auto mock_lookup = std::make_unique<MockLookup>();
+  EXPECT_CALL(*mock_lookup, RunSetQueryUInt32(_, query))
+      .WillOnce(Return(run_query_response));
+
+  FunctionBindingIoProto io;
+  TextFormat::ParseFromString(R"pb(input_string: "Q")pb", &io);
+  auto run_query_hook =
+      RunQueryHook::Create(RunQueryHook::OutputType::kUInt32);
+  run_query_hook->FinishInit(std::move(mock_lookup));
+  ScopeMetricsContext metrics_context;
+  RequestContext request_context(metrics_context);
+  FunctionBindingPayload<RequestContext> payload{io, request_context};
+  (*run_query_hook)(payload);
+  EXPECT_EQ(io.output_bytes(), std::string("\x01\0\0\0"
+                                           "\x02\x01\0\0",
+                                           8));
+}
+
 }  // namespace
 }  // namespace kv_server
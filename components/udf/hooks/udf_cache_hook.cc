@@ -0,0 +1,142 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/udf/hooks/udf_cache_hook.h"
+
+#include <list>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/log/log.h"
+#include "absl/synchronization/mutex.h"
+
+namespace kv_server {
+namespace {
+
+using google::scp::roma::FunctionBindingPayload;
+
+// Approximate memory used by an entry besides its key and value.
+constexpr int64_t kEntryOverheadBytes = 64;
+
+class UdfCacheHookImpl : public UdfCacheHook {
+ public:
+  explicit UdfCacheHookImpl(int64_t max_bytes) : max_bytes_(max_bytes) {}
+
+  void Get(FunctionBindingPayload<RequestContext>& payload) {
+    payload.io_proto.set_output_string("");
+    if (!payload.io_proto.has_input_string()) {
+      VLOG(1) << "cacheGet input must be a string";
+      return;
+    }
+    const std::string& key = payload.io_proto.input_string();
+    absl::MutexLock lock(&mutex_);
+    if (!UseCodeCommitTime(payload.metadata.GetUdfCodeCommitTime())) {
+      return;
+    }
+    const auto it = entries_.find(key);
+    if (it == entries_.end()) {
+      return;
+    }
+    lru_.splice(lru_.begin(), lru_, it->second.lru_position);
+    payload.io_proto.set_output_string(it->second.value);
+  }
+
+  void Put(FunctionBindingPayload<RequestContext>& payload) {
+    if (!payload.io_proto.has_input_list_of_string() ||
+        payload.io_proto.input_list_of_string().data_size() != 2) {
+      VLOG(1) << "cachePut input must be a list of a key and a value";
+      return;
+    }
+    auto& input = *payload.io_proto.mutable_input_list_of_string()
+                       ->mutable_data();
+    std::string& key = input[0];
+    std::string& value = input[1];
+    const int64_t bytes = EntryBytes(key, value);
+    if (value.empty() || bytes > max_bytes_) {
+      return;
+    }
+    absl::MutexLock lock(&mutex_);
+    if (!UseCodeCommitTime(payload.metadata.GetUdfCodeCommitTime())) {
+      return;
+    }
+    if (const auto it = entries_.find(key); it != entries_.end()) {
+      Erase(it);
+    }
+    lru_.push_front(key);
+    bytes_ += bytes;
+    entries_.emplace(std::move(key), Entry{.value = std::move(value),
+                                           .lru_position = lru_.begin()});
+    while (bytes_ > max_bytes_) {
+      Erase(entries_.find(lru_.back()));
+    }
+  }
+
+ private:
+  struct Entry {
+    std::string value;
+    // Position of the key in `lru_`.
+    std::list<std::string>::iterator lru_position;
+  };
+
+  static int64_t EntryBytes(const std::string& key, const std::string& value) {
+    // The key is stored twice, in `entries_` and in `lru_`.
+    return 2 * key.size() + value.size() + kEntryOverheadBytes;
+  }
+
+  // Clears the cache if `commit_time` is of a newer code object than the
+  // entries. Returns false if it is of an older code object, whose executions
+  // neither read nor write the entries of the newer one.
+  bool UseCodeCommitTime(int64_t commit_time)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+    if (commit_time < code_commit_time_) {
+      return false;
+    }
+    if (commit_time > code_commit_time_) {
+      VLOG(2) << "Clearing the UDF cache of " << entries_.size()
+              << " entries for code committed at " << commit_time;
+      entries_.clear();
+      lru_.clear();
+      bytes_ = 0;
+      code_commit_time_ = commit_time;
+    }
+    return true;
+  }
+
+  void Erase(absl::flat_hash_map<std::string, Entry>::iterator it)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+    bytes_ -= EntryBytes(it->first, it->second.value);
+    lru_.erase(it->second.lru_position);
+    entries_.erase(it);
+  }
+
+  const int64_t max_bytes_;
+  absl::Mutex mutex_;
+  absl::flat_hash_map<std::string, Entry> entries_ ABSL_GUARDED_BY(mutex_);
+  // Keys of `entries_`, most recently used first.
+  std::list<std::string> lru_ ABSL_GUARDED_BY(mutex_);
+  int64_t bytes_ ABSL_GUARDED_BY(mutex_) = 0;
+  // Logical commit time of the code object that wrote the entries.
+  int64_t code_commit_time_ ABSL_GUARDED_BY(mutex_) = -1;
+};
+
+}  // namespace
+
+std::unique_ptr<UdfCacheHook> UdfCacheHook::Create(int64_t max_bytes) {
+  return std::make_unique<UdfCacheHookImpl>(max_bytes);
+}
+
+}  // namespace kv_server
@@ -0,0 +1,52 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef COMPONENTS_UDF_UDF_CACHE_HOOK_H_
+#define COMPONENTS_UDF_UDF_CACHE_HOOK_H_
+
+#include <cstdint>
+#include <memory>
+
+#include "components/util/request_context.h"
+#include "src/roma/config/function_binding_object_v2.h"
+
+namespace kv_server {
+
+// Functors of a string cache that UDFs use to keep values they derive, such as
+// parsed hot values, across executions. The cache is shared by the Roma
+// workers, bounded by `max_bytes`, evicting the least recently used entries,
+// and cleared when the UDF code object changes. Thread-safe.
+class UdfCacheHook {
+ public:
+  virtual ~UdfCacheHook() = default;
+
+  // Registered as `cacheGet(key)`. Returns the cached value of the key, or an
+  // empty string if it is not cached.
+  virtual void Get(
+      google::scp::roma::FunctionBindingPayload<RequestContext>& payload) = 0;
+
+  // Registered as `cachePut([key, value])`. Caches the value of the key.
+  // Empty values are not cached.
+  virtual void Put(
+      google::scp::roma::FunctionBindingPayload<RequestContext>& payload) = 0;
+
+  // A cache with a non-positive `max_bytes` caches nothing.
+  static std::unique_ptr<UdfCacheHook> Create(int64_t max_bytes);
+};
+
+}  // namespace kv_server
+
+#endif  // COMPONENTS_UDF_UDF_CACHE_HOOK_H_
@@ -0,0 +1,107 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/udf/hooks/udf_cache_hook.h"
+
+#include <memory>
+#include <string>
+
+#include "gtest/gtest.h"
+
+namespace kv_server {
+namespace {
+
+using google::scp::roma::FunctionBindingPayload;
+using google::scp::roma::proto::FunctionBindingIoProto;
+
+class UdfCacheHookTest : public ::testing::Test {
+ protected:
+  void SetUp() override { InitMetricsContextMap(); }
+
+  std::string Get(UdfCacheHook& hook, std::string key,
+                  int64_t code_commit_time = 1) {
+    FunctionBindingIoProto io;
+    io.set_input_string(std::move(key));
+    RequestContext request_context(metrics_context_);
+    request_context.SetUdfCodeCommitTime(code_commit_time);
+    FunctionBindingPayload<RequestContext> payload{io, request_context};
+    hook.Get(payload);
+    return io.output_string();
+  }
+
+  void Put(UdfCacheHook& hook, std::string key, std::string value,
+           int64_t code_commit_time = 1) {
+    FunctionBindingIoProto io;
+    io.mutable_input_list_of_string()->add_data(std::move(key));
+    io.mutable_input_list_of_string()->add_data(std::move(value));
+    RequestContext request_context(metrics_context_);
+    request_context.SetUdfCodeCommitTime(code_commit_time);
+    FunctionBindingPayload<RequestContext> payload{io, request_context};
+    hook.Put(payload);
+  }
+
+  ScopeMetricsContext metrics_context_;
+};
+
+TEST_F(UdfCacheHookTest, ReturnsPutValues) {
+  auto hook = UdfCacheHook::Create(/*max_bytes=*/1024);
+  EXPECT_EQ(Get(*hook, "key"), "");
+  Put(*hook, "key", "value");
+  EXPECT_EQ(Get(*hook, "key"), "value");
+  Put(*hook, "key", "new value");
+  EXPECT_EQ(Get(*hook, "key"), "new value");
+}
+
+TEST_F(UdfCacheHookTest, EvictsLeastRecentlyUsedValues) {
+  // Fits two entries.
+  auto hook = UdfCacheHook::Create(/*max_bytes=*/200);
+  Put(*hook, "key1", "value1");
+  Put(*hook, "key2", "value2");
+  EXPECT_EQ(Get(*hook, "key1"), "value1");
+  Put(*hook, "key3", "value3");
+  EXPECT_EQ(Get(*hook, "key1"), "value1");
+  EXPECT_EQ(Get(*hook, "key2"), "");
+  EXPECT_EQ(Get(*hook, "key3"), "value3");
+}
+
+TEST_F(UdfCacheHookTest, ClearsValuesOfOlderCode) {
+  auto hook = UdfCacheHook::Create(/*max_bytes=*/1024);
+  Put(*hook, "key", "value", /*code_commit_time=*/1);
+  EXPECT_EQ(Get(*hook, "key", /*code_commit_time=*/2), "");
+  Put(*hook, "key", "value", /*code_commit_time=*/1);
+  EXPECT_EQ(Get(*hook, "key", /*code_commit_time=*/2), "");
+  Put(*hook, "key", "value2", /*code_commit_time=*/2);
+  EXPECT_EQ(Get(*hook, "key", /*code_commit_time=*/1), "");
+  EXPECT_EQ(Get(*hook, "key", /*code_commit_time=*/2), "value2");
+}
+
+TEST_F(UdfCacheHookTest, CachesNothingIfDisabled) {
+  auto hook = UdfCacheHook::Create(/*max_bytes=*/0);
+  Put(*hook, "key", "value");
+  EXPECT_EQ(Get(*hook, "key"), "");
+}
+
+TEST_F(UdfCacheHookTest, IgnoresInvalidInput) {
+  auto hook = UdfCacheHook::Create(/*max_bytes=*/1024);
+  FunctionBindingIoProto io;
+  io.mutable_input_list_of_string()->add_data("key");
+  RequestContext request_context(metrics_context_);
+  FunctionBindingPayload<RequestContext> payload{io, request_context};
+  hook->Put(payload);
+  hook->Get(payload);
+  EXPECT_EQ(io.output_string(), "");
+}
+
+}  // namespace
+}  // namespace kv_server
@@ -0,0 +1,285 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/udf/native_udf_registry.h"
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "absl/container/flat_hash_set.h"
+#include "absl/log/log.h"
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "google/protobuf/util/json_util.h"
+#include "nlohmann/json.hpp"
+#include "public/applications/pa/api_overlay.pb.h"
+#include "public/applications/pa/response_utils.h"
+
+namespace kv_server {
+namespace {
+
+using google::protobuf::ListValue;
+using google::protobuf::Value;
+using google::protobuf::json::MessageToJsonString;
+
+// Whether `value` converts to true in JS.
+bool IsTruthy(const Value& value) {
+  switch (value.kind_case()) {
+    case Value::kBoolValue:
+      return value.bool_value();
+    case Value::kNumberValue:
+      return value.number_value() != 0;
+    case Value::kStringValue:
+      return !value.string_value().empty();
+    case Value::kStructValue:
+    case Value::kListValue:
+      return true;
+    default:
+      return false;
+  }
+}
+
+// Looks up the keys of `data` like the getValues hook. Fails when the hook
+// output would have no "kvPairs", including when no key is found.
+absl::StatusOr<InternalLookupResponse> GetValues(
+    const Lookup& lookup, const RequestContext& request_context,
+    const Value& data) {
+  if (!data.has_list_value()) {
+    return absl::InvalidArgumentError(
+        "getValues input must be list of strings");
+  }
+  absl::flat_hash_set<std::string_view> keys;
+  for (const Value& key : data.list_value().values()) {
+    if (!key.has_string_value()) {
+      return absl::InvalidArgumentError(
+          "getValues input must be list of strings");
+    }
+    keys.insert(key.string_value());
+  }
+  absl::StatusOr<InternalLookupResponse> response =
+      lookup.GetKeyValues(request_context, keys);
+  if (response.ok() && response->kv_pairs().empty()) {
+    return absl::NotFoundError("getValues returned no key value pairs");
+  }
+  return response;
+}
+
+// Same as the "kvPairs" of the getValues hook. Key sets are never returned
+// by key value lookups.
+nlohmann::json ToJsonKvPairs(const InternalLookupResponse& response) {
+  nlohmann::json kv_pairs = nlohmann::json::object();
+  for (const auto& [key, result] : response.kv_pairs()) {
+    nlohmann::json& json_result = kv_pairs[key] = nlohmann::json::object();
+    if (result.has_value()) {
+      json_result["value"] = result.value();
+    } else if (result.has_status()) {
+      // The getValues hook leaves out default values, like the JSON mapping
+      // of protos.
+      nlohmann::json status = nlohmann::json::object();
+      if (result.status().code() != 0) {
+        status["code"] = result.status().code();
+      }
+      if (!result.status().message().empty()) {
+        status["message"] = result.status().message();
+      }
+      json_result["status"] = std::move(status);
+    }
+  }
+  return kv_pairs;
+}
+
+absl::StatusOr<nlohmann::json> ToJson(const ListValue& list) {
+  std::string json;
+  if (const auto status = MessageToJsonString(list, &json); !status.ok()) {
+    return status;
+  }
+  return nlohmann::json::parse(json);
+}
+
+// `handlePas` of the default UDF.
+absl::StatusOr<nlohmann::json> HandlePas(
+    const Lookup& lookup, const RequestContext& request_context,
+    const google::protobuf::RepeatedPtrField<UDFArgument>& arguments) {
+  if (arguments.size() != 1) {
+    return absl::InvalidArgumentError(absl::StrCat(
+        "For PAS default UDF exactly one argument should be provided, but was "
+        "provided ",
+        arguments.size()));
+  }
+  // Arguments with tags are passed as objects, which getValues rejects.
+  if (!arguments[0].tags().values().empty()) {
+    return absl::InvalidArgumentError(
+        "Error executing handle PAS: getValues input must be list of strings");
+  }
+  absl::StatusOr<InternalLookupResponse> response =
+      GetValues(lookup, request_context, arguments[0].data());
+  if (!response.ok()) {
+    return absl::Status(response.status().code(),
+                        absl::StrCat("Error executing handle PAS: ",
+                                     response.status().message()));
+  }
+  return ToJsonKvPairs(*response);
+}
+
+// `handlePA` of the default UDF.
+absl::StatusOr<nlohmann::json> HandlePa(
+    const Lookup& lookup, const RequestContext& request_context,
+    const google::protobuf::RepeatedPtrField<UDFArgument>& arguments) {
+  nlohmann::json key_group_outputs = nlohmann::json::array();
+  for (const UDFArgument& argument : arguments) {
+    nlohmann::json key_group_output = nlohmann::json::object();
+    if (!argument.tags().values().empty()) {
+      absl::StatusOr<nlohmann::json> tags = ToJson(argument.tags());
+      if (!tags.ok()) {
+        return tags.status();
+      }
+      key_group_output["tags"] = *std::move(tags);
+      if (!argument.has_data()) {
+        continue;
+      }
+    }
+    // Failed lookups are left out of the output.
+    absl::StatusOr<InternalLookupResponse> response =
+        GetValues(lookup, request_context, argument.data());
+    if (!response.ok()) {
+      VLOG(5) << "Skipping failed lookup: " << response.status();
+      continue;
+    }
+    nlohmann::json key_values = nlohmann::json::object();
+    for (const auto& [key, result] : response->kv_pairs()) {
+      if (result.has_value()) {
+        key_values[key] = {{"value", result.value()}};
+      }
+    }
+    key_group_output["keyValues"] = std::move(key_values);
+    key_group_outputs.push_back(std::move(key_group_output));
+  }
+  return nlohmann::json{{"keyGroupOutputs", std::move(key_group_outputs)},
+                        {"udfOutputApiVersion", 1}};
+}
+
+// Same as `HandlePa`, but returns the outputs as a proto, for callers that
+// accept it, so that they are neither serialized to nor parsed from JSON.
+absl::StatusOr<application_pa::KeyGroupOutputs> HandlePaProto(
+    const Lookup& lookup, const RequestContext& request_context,
+    const google::protobuf::RepeatedPtrField<UDFArgument>& arguments) {
+  application_pa::KeyGroupOutputs outputs;
+  for (const UDFArgument& argument : arguments) {
+    if (!argument.tags().values().empty() && !argument.has_data()) {
+      continue;
+    }
+    // Failed lookups are left out of the output.
+    absl::StatusOr<InternalLookupResponse> response =
+        GetValues(lookup, request_context, argument.data());
+    if (!response.ok()) {
+      VLOG(5) << "Skipping failed lookup: " << response.status();
+      continue;
+    }
+    application_pa::KeyGroupOutput& output = *outputs.add_key_group_outputs();
+    for (const Value& tag : argument.tags().values()) {
+      // Like the parsing of JSON outputs, which only has string tags.
+      if (!tag.has_string_value()) {
+        return absl::InvalidArgumentError("Tags must be strings");
+      }
+      output.add_tags(tag.string_value());
+    }
+    for (auto& [key, result] : *response->mutable_kv_pairs()) {
+      if (result.has_value()) {
+        (*output.mutable_key_values())[key].mutable_value()->set_string_value(
+            std::move(*result.mutable_value()));
+      }
+    }
+  }
+  outputs.set_udf_output_api_version(1);
+  return outputs;
+}
+
+// Whether the request metadata field `key` is set and true in JS.
+bool IsMetadataTruthy(const UDFExecutionMetadata& execution_metadata,
+                      std::string_view key) {
+  const auto& request_metadata = execution_metadata.request_metadata().fields();
+  const auto it = request_metadata.find(std::string(key));
+  return it != request_metadata.end() && IsTruthy(it->second);
+}
+
+// `HandleRequest` of the default UDF.
+absl::StatusOr<nlohmann::json> HandleRequest(
+    const Lookup& lookup, const RequestContext& request_context,
+    const UDFExecutionMetadata& execution_metadata,
+    const google::protobuf::RepeatedPtrField<UDFArgument>& arguments) {
+  if (IsMetadataTruthy(execution_metadata, "is_pas")) {
+    return HandlePas(lookup, request_context, arguments);
+  }
+  return HandlePa(lookup, request_context, arguments);
+}
+
+class NativeUdfRegistryImpl : public NativeUdfRegistry {
+ public:
+  void FinishInit(std::unique_ptr<Lookup> lookup) override {
+    if (lookup_ == nullptr) {
+      lookup_ = std::move(lookup);
+    }
+  }
+
+  bool Contains(std::string_view handler_name) const override {
+    return handler_name == kNativePassThroughUdfHandlerName;
+  }
+
+  absl::StatusOr<std::string> Execute(
+      std::string_view handler_name, const RequestContext& request_context,
+      const UDFExecutionMetadata& execution_metadata,
+      const google::protobuf::RepeatedPtrField<UDFArgument>& arguments)
+      const override {
+    if (lookup_ == nullptr) {
+      return absl::InternalError("Native UDFs have not been initialized yet");
+    }
+    if (!Contains(handler_name)) {
+      return absl::NotFoundError(
+          absl::StrCat("No native UDF named ", handler_name));
+    }
+    if (IsMetadataTruthy(execution_metadata,
+                         application_pa::kAcceptsProtoOutputMetadataKey) &&
+        !IsMetadataTruthy(execution_metadata, "is_pas")) {
+      absl::StatusOr<application_pa::KeyGroupOutputs> outputs =
+          HandlePaProto(*lookup_, request_context, arguments);
+      if (!outputs.ok()) {
+        return outputs.status();
+      }
+      return application_pa::KeyGroupOutputsToProtoOutput(*outputs);
+    }
+    absl::StatusOr<nlohmann::json> output = HandleRequest(
+        *lookup_, request_context, execution_metadata, arguments);
+    if (!output.ok()) {
+      return output.status();
+    }
+    // Invalid UTF-8 is replaced, like JS strings replace it.
+    return output->dump(/*indent=*/-1, /*indent_char=*/' ',
+                        /*ensure_ascii=*/false,
+                        nlohmann::json::error_handler_t::replace);
+  }
+
+ private:
+  // Set after the UDF client forks, like the lookups of the hooks.
+  std::unique_ptr<Lookup> lookup_;
+};
+
+}  // namespace
+
+std::unique_ptr<NativeUdfRegistry> NativeUdfRegistry::Create() {
+  return std::make_unique<NativeUdfRegistryImpl>();
+}
+
+}  // namespace kv_server
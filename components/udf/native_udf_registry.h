@@ -0,0 +1,62 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef COMPONENTS_UDF_NATIVE_UDF_REGISTRY_H_
+#define COMPONENTS_UDF_NATIVE_UDF_REGISTRY_H_
+
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "absl/status/statusor.h"
+#include "components/internal_server/lookup.h"
+#include "components/util/request_context.h"
+#include "google/protobuf/repeated_ptr_field.h"
+#include "public/api_schema.pb.h"
+
+namespace kv_server {
+
+// Handler name of the native UDF that returns the same output as the default
+// JS UDF, `kDefaultUdfCodeSnippet`, up to the order of JSON object keys.
+inline constexpr std::string_view kNativePassThroughUdfHandlerName =
+    "native:HandleRequest";
+
+// Built-in UDFs implemented in C++. They run in-process against a `Lookup`
+// instead of in Roma, and are selected by the handler name of the UDF config.
+class NativeUdfRegistry {
+ public:
+  virtual ~NativeUdfRegistry() = default;
+
+  // Like the UDF hooks, the lookup can only be created after the UDF client.
+  virtual void FinishInit(std::unique_ptr<Lookup> lookup) = 0;
+
+  // Whether `handler_name` is the name of a native UDF.
+  virtual bool Contains(std::string_view handler_name) const = 0;
+
+  // Runs the native UDF `handler_name` and returns its output as JSON, like
+  // Roma returns the output of JS UDFs.
+  virtual absl::StatusOr<std::string> Execute(
+      std::string_view handler_name, const RequestContext& request_context,
+      const UDFExecutionMetadata& execution_metadata,
+      const google::protobuf::RepeatedPtrField<UDFArgument>& arguments)
+      const = 0;
+
+  static std::unique_ptr<NativeUdfRegistry> Create();
+};
+
+}  // namespace kv_server
+
+#endif  // COMPONENTS_UDF_NATIVE_UDF_REGISTRY_H_
@@ -0,0 +1,180 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/udf/native_udf_registry.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "components/internal_server/mocks.h"
+#include "gmock/gmock.h"
+#include "google/protobuf/text_format.h"
+#include "gtest/gtest.h"
+#include "public/applications/pa/response_utils.h"
+#include "public/test_util/proto_matcher.h"
+
+namespace kv_server {
+namespace {
+
+using google::protobuf::TextFormat;
+using testing::_;
+using testing::Return;
+using testing::UnorderedElementsAre;
+
+UDFArgument ParseArgument(const std::string& text) {
+  UDFArgument argument;
+  TextFormat::ParseFromString(text, &argument);
+  return argument;
+}
+
+class NativeUdfRegistryTest : public ::testing::Test {
+ protected:
+  NativeUdfRegistryTest() {
+    InitMetricsContextMap();
+    auto lookup = std::make_unique<MockLookup>();
+    lookup_ = lookup.get();
+    registry_->FinishInit(std::move(lookup));
+    InternalLookupResponse response;
+    TextFormat::ParseFromString(R"pb(
+                                  kv_pairs {
+                                    key: "key1"
+                                    value { value: "value1" }
+                                  }
+                                  kv_pairs {
+                                    key: "key2"
+                                    value { status { code: 5 message: "x" } }
+                                  })pb",
+                                &response);
+    ON_CALL(*lookup_, GetKeyValues(_, _)).WillByDefault(Return(response));
+  }
+
+  absl::StatusOr<std::string> Execute(const UDFExecutionMetadata& metadata) {
+    ScopeMetricsContext metrics_context;
+    return registry_->Execute(kNativePassThroughUdfHandlerName,
+                              RequestContext(metrics_context), metadata,
+                              arguments_);
+  }
+
+  std::unique_ptr<NativeUdfRegistry> registry_ = NativeUdfRegistry::Create();
+  MockLookup* lookup_;
+  google::protobuf::RepeatedPtrField<UDFArgument> arguments_;
+};
+
+TEST_F(NativeUdfRegistryTest, ContainsOnlyNativeUdfs) {
+  EXPECT_TRUE(registry_->Contains(kNativePassThroughUdfHandlerName));
+  EXPECT_FALSE(registry_->Contains("HandleRequest"));
+}
+
+TEST_F(NativeUdfRegistryTest, ReturnsValuesOfEveryKeyGroup) {
+  EXPECT_CALL(*lookup_,
+              GetKeyValues(_, UnorderedElementsAre("key1", "key2")))
+      .Times(1);
+  *arguments_.Add() = ParseArgument(R"pb(
+    tags { values { string_value: "custom" } }
+    data {
+      list_value {
+        values { string_value: "key1" }
+        values { string_value: "key2" }
+      }
+    })pb");
+  // Arguments with tags but no data are skipped.
+  *arguments_.Add() =
+      ParseArgument(R"pb(tags { values { string_value: "custom" } })pb");
+  absl::StatusOr<std::string> output = Execute(UDFExecutionMetadata());
+  ASSERT_TRUE(output.ok()) << output.status();
+  EXPECT_EQ(*output,
+            R"({"keyGroupOutputs":[{"keyValues":{"key1":{"value":"value1"}},)"
+            R"("tags":["custom"]}],"udfOutputApiVersion":1})");
+}
+
+TEST_F(NativeUdfRegistryTest, ReturnsProtoOutputIfAccepted) {
+  *arguments_.Add() = ParseArgument(R"pb(
+    tags { values { string_value: "custom" } }
+    tags { values { string_value: "keys" } }
+    data {
+      list_value {
+        values { string_value: "key1" }
+        values { string_value: "key2" }
+      }
+    })pb");
+  *arguments_.Add() =
+      ParseArgument(R"pb(tags { values { string_value: "custom" } })pb");
+  absl::StatusOr<std::string> json_output = Execute(UDFExecutionMetadata());
+  ASSERT_TRUE(json_output.ok()) << json_output.status();
+  UDFExecutionMetadata metadata;
+  (*metadata.mutable_request_metadata()->mutable_fields())
+      [std::string(application_pa::kAcceptsProtoOutputMetadataKey)]
+          .set_bool_value(true);
+  absl::StatusOr<std::string> proto_output = Execute(metadata);
+  ASSERT_TRUE(proto_output.ok()) << proto_output.status();
+  EXPECT_NE(*proto_output, *json_output);
+
+  const auto from_json =
+      application_pa::KeyGroupOutputsFromUdfOutput(*json_output);
+  ASSERT_TRUE(from_json.ok()) << from_json.status();
+  const auto from_proto =
+      application_pa::KeyGroupOutputsFromUdfOutput(*proto_output);
+  ASSERT_TRUE(from_proto.ok()) << from_proto.status();
+  EXPECT_THAT(*from_proto, EqualsProto(*from_json));
+}
+
+TEST_F(NativeUdfRegistryTest, SkipsFailedLookups) {
+  EXPECT_CALL(*lookup_, GetKeyValues(_, _))
+      .WillOnce(Return(absl::UnavailableError("down")));
+  *arguments_.Add() = ParseArgument(R"pb(
+    data { list_value { values { string_value: "key1" } } })pb");
+  // Not a list of keys.
+  *arguments_.Add() = ParseArgument(R"pb(data { string_value: "key1" })pb");
+  absl::StatusOr<std::string> output = Execute(UDFExecutionMetadata());
+  ASSERT_TRUE(output.ok()) << output.status();
+  EXPECT_EQ(*output, R"({"keyGroupOutputs":[],"udfOutputApiVersion":1})");
+}
+
+TEST_F(NativeUdfRegistryTest, ReturnsKvPairsForPas) {
+  *arguments_.Add() = ParseArgument(R"pb(
+    data {
+      list_value {
+        values { string_value: "key1" }
+        values { string_value: "key2" }
+      }
+    })pb");
+  UDFExecutionMetadata metadata;
+  (*metadata.mutable_request_metadata()->mutable_fields())["is_pas"]
+      .set_string_value("true");
+  absl::StatusOr<std::string> output = Execute(metadata);
+  ASSERT_TRUE(output.ok()) << output.status();
+  EXPECT_EQ(*output, R"({"key1":{"value":"value1"},)"
+                     R"("key2":{"status":{"code":5,"message":"x"}}})");
+}
+
+TEST_F(NativeUdfRegistryTest, RequiresOneArgumentForPas) {
+  UDFExecutionMetadata metadata;
+  (*metadata.mutable_request_metadata()->mutable_fields())["is_pas"]
+      .set_bool_value(true);
+  absl::StatusOr<std::string> output = Execute(metadata);
+  EXPECT_EQ(output.status().code(), absl::StatusCode::kInvalidArgument);
+}
+
+TEST_F(NativeUdfRegistryTest, FailsBeforeInit) {
+  auto registry = NativeUdfRegistry::Create();
+  ScopeMetricsContext metrics_context;
+  absl::StatusOr<std::string> output = registry->Execute(
+      kNativePassThroughUdfHandlerName, RequestContext(metrics_context),
+      UDFExecutionMetadata(), arguments_);
+  EXPECT_EQ(output.status().code(), absl::StatusCode::kInternal);
+}
+
+}  // namespace
+}  // namespace kv_server
@@ -0,0 +1,83 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/udf/udf_admission_controller.h"
+
+#include <algorithm>
+
+#include "absl/strings/str_cat.h"
+#include "components/telemetry/server_definition.h"
+
+namespace kv_server {
+namespace {
+
+// Weight of the latest interval in the moving average of intervals.
+constexpr double kIntervalWeight = 0.1;
+
+}  // namespace
+
+UdfAdmissionController::UdfAdmissionController(int num_workers)
+    : num_workers_(std::max(num_workers, 1)) {}
+
+absl::Status UdfAdmissionController::Admit(absl::Time now,
+                                           absl::Time deadline) {
+  int64_t num_pending;
+  {
+    absl::MutexLock lock(&mutex_);
+    // Executions that have to finish before a worker is free for this one.
+    const int64_t num_ahead = num_pending_ - num_workers_ + 1;
+    const absl::Duration expected_wait =
+        num_ahead > 0 ? num_ahead * completion_interval_
+                      : absl::ZeroDuration();
+    if (now + expected_wait > deadline) {
+      LogIfError(KVServerContextMap()
+                     ->SafeMetric()
+                     .LogUpDownCounter<kUdfExecutionRejectedCount>(1));
+      return absl::ResourceExhaustedError(
+          absl::StrCat("UDF execution would wait ",
+                       absl::FormatDuration(expected_wait),
+                       " for a worker, past its deadline"));
+    }
+    num_pending = num_pending_++;
+  }
+  LogIfError(KVServerContextMap()
+                 ->SafeMetric()
+                 .LogHistogram<kUdfExecutionQueueDepth>(
+                     static_cast<double>(std::max<int64_t>(
+                         num_pending - num_workers_ + 1, 0))));
+  return absl::OkStatus();
+}
+
+void UdfAdmissionController::Finish(absl::Time now) {
+  absl::MutexLock lock(&mutex_);
+  if (last_busy_completion_ != absl::InfinitePast()) {
+    const absl::Duration interval = now - last_busy_completion_;
+    completion_interval_ =
+        completion_interval_ == absl::ZeroDuration()
+            ? interval
+            : (1 - kIntervalWeight) * completion_interval_ +
+                  kIntervalWeight * interval;
+  }
+  --num_pending_;
+  // Only intervals during which every worker stays busy are measured.
+  last_busy_completion_ =
+      num_pending_ >= num_workers_ ? now : absl::InfinitePast();
+}
+
+int64_t UdfAdmissionController::NumPending() const {
+  absl::MutexLock lock(&mutex_);
+  return num_pending_;
+}
+
+}  // namespace kv_server
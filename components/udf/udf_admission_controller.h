@@ -0,0 +1,72 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef COMPONENTS_UDF_UDF_ADMISSION_CONTROLLER_H_
+#define COMPONENTS_UDF_UDF_ADMISSION_CONTROLLER_H_
+
+#include <cstdint>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/status/status.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+
+namespace kv_server {
+
+// Rejects UDF executions that would wait for a Roma worker past their
+// deadline, so that an overloaded server fails them right away instead of
+// letting them all time out.
+//
+// The expected wait is the number of executions ahead of the new one, beyond
+// those the workers run, times the average interval between completions while
+// every worker is busy. Executions are admitted until there is such an
+// interval to go by.
+//
+// Thread safe.
+class UdfAdmissionController {
+ public:
+  // Controls the executions of `num_workers` Roma workers.
+  explicit UdfAdmissionController(int num_workers);
+
+  UdfAdmissionController(const UdfAdmissionController&) = delete;
+  UdfAdmissionController& operator=(const UdfAdmissionController&) = delete;
+
+  // Admits an execution that must have finished by `deadline`, unless it is
+  // expected to wait past it. Every admitted execution must be finished.
+  absl::Status Admit(absl::Time now, absl::Time deadline)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Records the completion of an admitted execution.
+  void Finish(absl::Time now) ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Number of admitted executions that have not finished.
+  int64_t NumPending() const ABSL_LOCKS_EXCLUDED(mutex_);
+
+ private:
+  const int num_workers_;
+  mutable absl::Mutex mutex_;
+  int64_t num_pending_ ABSL_GUARDED_BY(mutex_) = 0;
+  // Moving average of the interval between completions of busy workers, zero
+  // until one has been seen.
+  absl::Duration completion_interval_ ABSL_GUARDED_BY(mutex_);
+  // Completion time of the last execution, if every worker stayed busy.
+  absl::Time last_busy_completion_ ABSL_GUARDED_BY(mutex_) =
+      absl::InfinitePast();
+};
+
+}  // namespace kv_server
+
+#endif  // COMPONENTS_UDF_UDF_ADMISSION_CONTROLLER_H_
@@ -0,0 +1,88 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/udf/udf_admission_controller.h"
+
+#include "absl/status/status.h"
+#include "absl/time/time.h"
+#include "components/telemetry/server_definition.h"
+#include "gtest/gtest.h"
+
+namespace kv_server {
+namespace {
+
+class UdfAdmissionControllerTest : public ::testing::Test {
+ protected:
+  UdfAdmissionControllerTest() { InitMetricsContextMap(); }
+
+  const absl::Time start_ = absl::FromUnixSeconds(1000);
+};
+
+TEST_F(UdfAdmissionControllerTest, AdmitsUntilCompletionIntervalIsKnown) {
+  UdfAdmissionController controller(/*num_workers=*/1);
+  for (int i = 0; i < 10; i++) {
+    EXPECT_TRUE(controller.Admit(start_, start_).ok());
+  }
+  EXPECT_EQ(controller.NumPending(), 10);
+}
+
+TEST_F(UdfAdmissionControllerTest, RejectsExecutionsThatWouldWaitPastDeadline) {
+  UdfAdmissionController controller(/*num_workers=*/2);
+  for (int i = 0; i < 4; i++) {
+    ASSERT_TRUE(controller.Admit(start_, absl::InfiniteFuture()).ok());
+  }
+  // Busy workers complete an execution every 10ms.
+  controller.Finish(start_ + absl::Milliseconds(10));
+  controller.Finish(start_ + absl::Milliseconds(20));
+  EXPECT_EQ(controller.NumPending(), 2);
+
+  const absl::Time now = start_ + absl::Milliseconds(20);
+  // One execution has to finish before a worker is free.
+  EXPECT_TRUE(controller.Admit(now, now + absl::Milliseconds(15)).ok());
+  // Two executions have to finish now.
+  EXPECT_EQ(controller.Admit(now, now + absl::Milliseconds(15)).code(),
+            absl::StatusCode::kResourceExhausted);
+  EXPECT_TRUE(controller.Admit(now, now + absl::Milliseconds(25)).ok());
+  EXPECT_EQ(controller.NumPending(), 4);
+}
+
+TEST_F(UdfAdmissionControllerTest, AdmitsWhileWorkersAreFree) {
+  UdfAdmissionController controller(/*num_workers=*/2);
+  for (int i = 0; i < 3; i++) {
+    ASSERT_TRUE(controller.Admit(start_, absl::InfiniteFuture()).ok());
+  }
+  controller.Finish(start_ + absl::Seconds(1));
+  controller.Finish(start_ + absl::Seconds(2));
+  // A worker is free, so no wait is expected.
+  EXPECT_TRUE(controller.Admit(start_ + absl::Seconds(2),
+                               start_ + absl::Seconds(2))
+                  .ok());
+}
+
+TEST_F(UdfAdmissionControllerTest, IgnoresIntervalsOfIdleWorkers) {
+  UdfAdmissionController controller(/*num_workers=*/1);
+  ASSERT_TRUE(controller.Admit(start_, absl::InfiniteFuture()).ok());
+  controller.Finish(start_ + absl::Milliseconds(1));
+  ASSERT_TRUE(controller.Admit(start_ + absl::Hours(1),
+                               absl::InfiniteFuture())
+                  .ok());
+  controller.Finish(start_ + absl::Hours(1) + absl::Milliseconds(1));
+  // No interval was observed with busy workers.
+  const absl::Time now = start_ + absl::Hours(2);
+  ASSERT_TRUE(controller.Admit(now, now).ok());
+  EXPECT_TRUE(controller.Admit(now, now).ok());
+}
+
+}  // namespace
+}  // namespace kv_server
@@ -14,20 +14,35 @@
 
 #include "components/udf/udf_client.h"
 
+#include <algorithm>
 #include <functional>
 #include <memory>
+#include <optional>
 #include <string>
+#include <thread>
 #include <tuple>
 #include <utility>
 #include <vector>
 
+#include "absl/container/flat_hash_map.h"
 #include "absl/flags/flag.h"
 #include "absl/log/log.h"
 #include "absl/status/statusor.h"
+#include "absl/strings/escaping.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_join.h"
 #include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
 #include "absl/synchronization/notification.h"
+#include "absl/time/clock.h"
 #include "absl/time/time.h"
+#include "components/telemetry/request_trace.h"
+#include "components/telemetry/udf_usage_counters.h"
+#include "components/udf/native_udf_registry.h"
+#include "components/udf/udf_admission_controller.h"
 #include "google/protobuf/util/json_util.h"
+#include "nlohmann/json.hpp"
 #include "src/roma/config/config.h"
 #include "src/roma/interface/roma.h"
 #include "src/roma/roma_service/roma_service.h"
@@ -52,90 +67,154 @@ constexpr char kCodeObjectId[] = "id";
 constexpr char kInvocationRequestId[] = "id";
 constexpr int kUdfInterfaceVersion = 1;
 
+// Code versions kept loaded and warm, so that setting one of them again, to
+// roll back or to promote a canary, needs no load or warm-up.
+constexpr int kMaxResidentCodeVersions = 4;
+// Field of the request metadata that pins the code version of a request, if
+// it is resident.
+constexpr char kUdfVersionMetadataField[] = "udf_version";
+
 class UdfClientImpl : public UdfClient {
  public:
   explicit UdfClientImpl(
       Config<RequestContext>&& config = Config<RequestContext>(),
-      absl::Duration udf_timeout = absl::Seconds(5), int udf_min_log_level = 0)
+      absl::Duration udf_timeout = absl::Seconds(5), int udf_min_log_level = 0,
+      int warm_up_invocations = 0,
+      const NativeUdfRegistry* native_udfs = nullptr,
+      absl::Duration batch_window = absl::ZeroDuration(),
+      int max_batch_size = 16)
       : udf_timeout_(udf_timeout),
-        roma_service_(std::move(config)),
-        udf_min_log_level_(udf_min_log_level) {}
+        udf_min_log_level_(udf_min_log_level),
+        warm_up_invocations_(warm_up_invocations),
+        // Roma starts a worker per core when the number is not set.
+        num_workers_(config.number_of_workers > 0
+                         ? config.number_of_workers
+                         : std::thread::hardware_concurrency()),
+        admission_controller_(num_workers_),
+        native_udfs_(native_udfs),
+        batch_window_(batch_window),
+        max_batch_size_(std::max(max_batch_size, 1)),
+        roma_service_(std::move(config)) {
+    if (batch_window_ > absl::ZeroDuration()) {
+      batch_flusher_ = std::thread([this] { FlushBatches(); });
+    }
+  }
+
+  ~UdfClientImpl() override { StopBatching(); }
 
   // Converts the arguments into plain JSON strings to pass to Roma.
   absl::StatusOr<std::string> ExecuteCode(
       RequestContext request_context, UDFExecutionMetadata&& execution_metadata,
       const google::protobuf::RepeatedPtrField<UDFArgument>& arguments) const {
-    execution_metadata.set_udf_interface_version(kUdfInterfaceVersion);
-    std::vector<std::string> string_args;
-    string_args.reserve(arguments.size() + 1);
-    std::string json_metadata;
-    if (const auto json_status =
-            MessageToJsonString(execution_metadata, &json_metadata);
-        !json_status.ok()) {
-      return json_status;
+    const std::shared_ptr<const ActiveCode> code =
+        RouteCode(execution_metadata);
+    if (code->native) {
+      return ExecuteNative(*code, std::move(request_context),
+                           execution_metadata, arguments);
     }
-    string_args.push_back(json_metadata);
-
-    for (int i = 0; i < arguments.size(); ++i) {
-      const auto& arg = arguments[i];
-      const google::protobuf::Message* arg_data;
-      if (arg.tags().values().empty()) {
-        arg_data = &arg.data();
-      } else {
-        arg_data = &arg;
-      }
-      std::string json_arg;
-      if (const auto json_status = MessageToJsonString(*arg_data, &json_arg);
-          !json_status.ok()) {
-        return json_status;
-      }
-      string_args.push_back(json_arg);
+    ExecutionUsage usage(code->version);
+    absl::StatusOr<std::vector<std::string>> string_args =
+        BuildInput(*code, std::move(execution_metadata), arguments);
+    if (!string_args.ok()) {
+      return string_args.status();
     }
-    return ExecuteCode(std::move(request_context), std::move(string_args));
+    return ExecuteCode(*code, std::move(request_context),
+                       *std::move(string_args), std::move(usage));
   }
 
-  absl::StatusOr<std::string> ExecuteCode(
-      RequestContext request_context, std::vector<std::string> input) const {
-    std::shared_ptr<absl::Status> response_status =
-        std::make_shared<absl::Status>();
-    std::shared_ptr<std::string> result = std::make_shared<std::string>();
-    std::shared_ptr<absl::Notification> notification =
-        std::make_shared<absl::Notification>();
-    auto invocation_request =
-        BuildInvocationRequest(std::move(request_context), std::move(input));
-    VLOG(9) << "Executing UDF with input arg(s): "
+  // Relies on Roma to time out the UDF, so that `callback` is always called.
+  void ExecuteCodeAsync(
+      RequestContext request_context, UDFExecutionMetadata&& execution_metadata,
+      const google::protobuf::RepeatedPtrField<UDFArgument>& arguments,
+      ExecuteCodeCallback callback) const {
+    // Spans the execution of sampled requests until the callback is called.
+    if (TraceSpan span(request_context.GetTrace(), "UdfExecution");
+        span.IsRecording()) {
+      callback = [span = std::move(span), callback = std::move(callback)](
+                     absl::StatusOr<std::string> result) mutable {
+        span.End();
+        std::move(callback)(std::move(result));
+      };
+    }
+    const std::shared_ptr<const ActiveCode> code =
+        RouteCode(execution_metadata);
+    if (code->native) {
+      std::move(callback)(ExecuteNative(*code, std::move(request_context),
+                                        execution_metadata, arguments));
+      return;
+    }
+    ExecutionUsage usage(code->version);
+    absl::StatusOr<std::vector<std::string>> string_args =
+        BuildInput(*code, std::move(execution_metadata), arguments);
+    if (!string_args.ok()) {
+      std::move(callback)(string_args.status());
+      return;
+    }
+    if (batch_window_ > absl::ZeroDuration() &&
+        !code->batch_handler_name.empty()) {
+      // The execution is counted with its batch, which accounts the bytes of
+      // the inputs, but only the CPU time of joining them.
+      usage.InputBuilt({});
+      UdfUsageCounters::Global().AddExecutions(
+          code->version, /*num_executions=*/0, absl::ZeroDuration(),
+          usage.cpu_time, /*marshalled_bytes=*/0);
+      AddToBatch(code, std::move(request_context),
+                 absl::StrCat("[", absl::StrJoin(*string_args, ","), "]"),
+                 std::move(callback));
+      return;
+    }
+    if (const absl::Status admission_status = Admit(request_context);
+        !admission_status.ok()) {
+      std::move(callback)(admission_status);
+      return;
+    }
+    auto invocation_request = BuildInvocationRequest(
+        *code, std::move(request_context), *std::move(string_args));
+    VLOG(9) << "Executing UDF asynchronously with input arg(s): "
             << absl::StrJoin(invocation_request.input, ",");
+    usage.InputBuilt(invocation_request.input);
+    auto shared_callback =
+        std::make_shared<ExecuteCodeCallback>(std::move(callback));
     const auto status = roma_service_.Execute(
         std::make_unique<InvocationStrRequest<RequestContext>>(
             std::move(invocation_request)),
-        [notification, response_status,
-         result](absl::StatusOr<ResponseObject> response) {
-          if (response.ok()) {
-            *result = std::move(response->resp);
-          } else {
-            response_status->Update(std::move(response.status()));
+        [shared_callback, usage, &admission_controller = admission_controller_](
+            absl::StatusOr<ResponseObject> response) {
+          admission_controller.Finish(absl::Now());
+          if (!response.ok()) {
+            LOG(ERROR) << "Error executing UDF: " << response.status();
+            usage.Finished(/*num_executions=*/1, /*output_bytes=*/0);
+            std::move(*shared_callback)(std::move(response).status());
+            return;
           }
-          notification->Notify();
+          usage.Finished(/*num_executions=*/1, response->resp.size());
+          std::move(*shared_callback)(std::move(response->resp));
         });
     if (!status.ok()) {
       LOG(ERROR) << "Error sending UDF for execution: " << status;
-      return status;
+      admission_controller_.Finish(absl::Now());
+      std::move(*shared_callback)(status);
     }
+  }
 
-    notification->WaitForNotificationWithTimeout(udf_timeout_);
-    if (!notification->HasBeenNotified()) {
-      return absl::InternalError("Timed out waiting for UDF result.");
-    }
-    if (!response_status->ok()) {
-      LOG(ERROR) << "Error executing UDF: " << *response_status;
-      return *response_status;
-    }
-    return *result;
+  absl::StatusOr<std::string> ExecuteCode(
+      RequestContext request_context, std::vector<std::string> input) const {
+    const std::shared_ptr<const ActiveCode> code = GetActiveCode();
+    return ExecuteCode(*code, std::move(request_context), std::move(input),
+                       ExecutionUsage(code->version));
   }
+
   absl::Status Init() { return roma_service_.Init(); }
 
-  absl::Status Stop() { return roma_service_.Stop(); }
+  absl::Status Stop() {
+    StopBatching();
+    return roma_service_.Stop();
+  }
 
+  // A code object whose version is resident with the same code is switched
+  // to without being loaded again. A canary code object runs its percentage
+  // of the requests, and the code object set before keeps running the
+  // others, until the next code object is set.
   absl::Status SetCodeObject(CodeConfig code_config) {
     // Only update code if logical commit time is larger.
     if (logical_commit_time_ >= code_config.logical_commit_time) {
@@ -144,14 +223,214 @@ class UdfClientImpl : public UdfClient {
               << " too small, should be greater than " << logical_commit_time_;
       return absl::OkStatus();
     }
+    std::shared_ptr<const ActiveCode> code = GetResidentCode(code_config);
+    if (code != nullptr) {
+      VLOG(5) << "Switching to resident UDF version " << code->version;
+    } else {
+      absl::StatusOr<std::shared_ptr<const ActiveCode>> loaded_code =
+          LoadCode(code_config);
+      if (!loaded_code.ok()) {
+        return loaded_code.status();
+      }
+      code = *std::move(loaded_code);
+    }
+    logical_commit_time_ = code_config.logical_commit_time;
+    absl::MutexLock lock(&code_mutex_);
+    resident_codes_.insert_or_assign(
+        code->version, ResidentCode{.js = std::move(code_config.js),
+                                    .wasm = std::move(code_config.wasm),
+                                    .code = code});
+    if (code_config.canary_percent > 0 && code_config.canary_percent < 100 &&
+        code_->logical_commit_time >= 0 && code_->version != code->version) {
+      VLOG(5) << "Running UDF version " << code->version << " as a canary of "
+              << code_config.canary_percent << "% of requests";
+      canary_code_ = std::move(code);
+      canary_percent_ = code_config.canary_percent;
+    } else {
+      code_ = std::move(code);
+      canary_code_ = nullptr;
+      canary_percent_ = 0;
+    }
+    EvictResidentCodes();
+    return absl::OkStatus();
+  }
+
+  absl::Status SetWasmCodeObject(CodeConfig code_config) {
+    const auto code_object_status = SetCodeObject(std::move(code_config));
+    if (!code_object_status.ok()) {
+      return code_object_status;
+    }
+    return absl::OkStatus();
+  }
+
+  // Changes when a canary is set too, since requests then run either code
+  // object.
+  int64_t GetCodeObjectLogicalCommitTime() const {
+    absl::MutexLock lock(&code_mutex_);
+    return canary_code_ == nullptr ? code_->logical_commit_time
+                                   : canary_code_->logical_commit_time;
+  }
+
+ private:
+  // The code object that requests run.
+  struct ActiveCode {
+    std::string handler_name;
+    int64_t version = 1;
+    int64_t logical_commit_time = -1;
+    UdfInputFormat input_format = UdfInputFormat::kJson;
+    // Whether `handler_name` is a native UDF of `native_udfs_`.
+    bool native = false;
+    // Handler that runs a list of inputs at once, if any.
+    std::string batch_handler_name;
+  };
+
+  // A code version kept loaded, with the code it was loaded from.
+  struct ResidentCode {
+    std::string js;
+    std::string wasm;
+    std::shared_ptr<const ActiveCode> code;
+  };
+
+  // Accounts UDF executions to `UdfUsageCounters`: the CPU time of building
+  // their input on the calling thread, and the time until their result.
+  struct ExecutionUsage {
+    explicit ExecutionUsage(int64_t udf_version)
+        : udf_version(udf_version),
+          start_cpu_time(UdfUsageCounters::ThreadCpuTime()) {}
+
+    // Ends the CPU time of building `input`, which is sent right after.
+    void InputBuilt(const std::vector<std::string>& input) {
+      cpu_time = UdfUsageCounters::ThreadCpuTime() - start_cpu_time;
+      for (const std::string& arg : input) {
+        marshalled_bytes += arg.size();
+      }
+      send_time = absl::Now();
+    }
+
+    void Finished(int64_t num_executions, int64_t output_bytes) const {
+      UdfUsageCounters::Global().AddExecutions(
+          udf_version, num_executions, absl::Now() - send_time, cpu_time,
+          marshalled_bytes + output_bytes);
+    }
+
+    int64_t udf_version;
+    absl::Duration start_cpu_time;
+    absl::Duration cpu_time;
+    int64_t marshalled_bytes = 0;
+    absl::Time send_time;
+  };
+
+  // An execution waiting for its batch to run.
+  struct BatchedExecution {
+    RequestContext request_context;
+    // JSON list of the metadata and every argument.
+    std::string input;
+    ExecuteCodeCallback callback;
+  };
+
+  // Executions of one code object that run in one invocation of its batch
+  // handler.
+  struct Batch {
+    int64_t id;
+    std::shared_ptr<const ActiveCode> code;
+    // When the batch runs if it is not full before.
+    absl::Time flush_time;
+    std::vector<BatchedExecution> executions;
+  };
+
+  std::shared_ptr<const ActiveCode> GetActiveCode() const {
+    absl::MutexLock lock(&code_mutex_);
+    return code_;
+  }
+
+  // Returns the resident code version pinned by the request metadata, if any,
+  // otherwise the canary for its percentage of the requests, otherwise the
+  // active code object.
+  std::shared_ptr<const ActiveCode> RouteCode(
+      const UDFExecutionMetadata& execution_metadata) const {
+    const std::optional<int64_t> pinned_version =
+        GetPinnedVersion(execution_metadata);
+    absl::MutexLock lock(&code_mutex_);
+    if (pinned_version.has_value()) {
+      if (const auto it = resident_codes_.find(*pinned_version);
+          it != resident_codes_.end()) {
+        return it->second.code;
+      }
+    }
+    if (canary_code_ != nullptr) {
+      // Spreads the canary requests evenly, `canary_percent_` in every 100.
+      const int64_t n = num_routed_requests_++;
+      if ((n + 1) * canary_percent_ / 100 > n * canary_percent_ / 100) {
+        return canary_code_;
+      }
+    }
+    return code_;
+  }
+
+  static std::optional<int64_t> GetPinnedVersion(
+      const UDFExecutionMetadata& execution_metadata) {
+    const auto& fields = execution_metadata.request_metadata().fields();
+    const auto it = fields.find(kUdfVersionMetadataField);
+    if (it == fields.end()) {
+      return std::nullopt;
+    }
+    if (it->second.has_number_value()) {
+      return static_cast<int64_t>(it->second.number_value());
+    }
+    int64_t version;
+    if (it->second.has_string_value() &&
+        absl::SimpleAtoi(it->second.string_value(), &version)) {
+      return version;
+    }
+    return std::nullopt;
+  }
+
+  // Returns the code of the resident version of `code_config`, set up with
+  // its logical commit time, if it was loaded from the same code.
+  std::shared_ptr<const ActiveCode> GetResidentCode(
+      const CodeConfig& code_config) const {
+    absl::MutexLock lock(&code_mutex_);
+    const auto it = resident_codes_.find(code_config.version);
+    if (it == resident_codes_.end()) {
+      return nullptr;
+    }
+    const ResidentCode& resident = it->second;
+    if (resident.js != code_config.js || resident.wasm != code_config.wasm ||
+        resident.code->handler_name != code_config.udf_handler_name ||
+        resident.code->input_format != code_config.input_format ||
+        resident.code->batch_handler_name != code_config.batch_handler_name) {
+      return nullptr;
+    }
+    auto code = std::make_shared<ActiveCode>(*resident.code);
+    code->logical_commit_time = code_config.logical_commit_time;
+    return code;
+  }
+
+  // Loads `code_config` into Roma, unless it is a native UDF, and warms it
+  // up. Requests keep running the previous versions meanwhile.
+  absl::StatusOr<std::shared_ptr<const ActiveCode>> LoadCode(
+      const CodeConfig& code_config) {
+    auto code = std::make_shared<ActiveCode>();
+    code->handler_name = code_config.udf_handler_name;
+    code->version = code_config.version;
+    code->logical_commit_time = code_config.logical_commit_time;
+    code->input_format = code_config.input_format;
+    code->batch_handler_name = code_config.batch_handler_name;
+    if (native_udfs_ != nullptr &&
+        native_udfs_->Contains(code_config.udf_handler_name)) {
+      // Native UDFs run in-process, so the code is neither loaded into Roma
+      // nor warmed up.
+      code->native = true;
+      VLOG(5) << "Successfully set native UDF " << code->handler_name;
+      return code;
+    }
     std::shared_ptr<absl::Status> response_status =
         std::make_shared<absl::Status>();
     std::shared_ptr<absl::Notification> notification =
         std::make_shared<absl::Notification>();
     VLOG(9) << "Setting UDF: " << code_config.js;
-    CodeObject code_object =
-        BuildCodeObject(std::move(code_config.js), std::move(code_config.wasm),
-                        code_config.version);
+    CodeObject code_object = BuildCodeObject(code_config.js, code_config.wasm,
+                                             code_config.version);
     absl::Status load_status = roma_service_.LoadCodeObj(
         std::make_unique<CodeObject>(code_object),
         [notification, response_status](absl::StatusOr<ResponseObject> resp) {
@@ -173,28 +452,412 @@ class UdfClientImpl : public UdfClient {
       LOG(ERROR) << "Error compiling UDF code object. " << *response_status;
       return *response_status;
     }
-    handler_name_ = std::move(code_config.udf_handler_name);
-    logical_commit_time_ = code_config.logical_commit_time;
-    version_ = code_config.version;
+    // Requests keep running the previous version until the new one is warm.
+    WarmUp(*code);
     VLOG(5) << "Successfully set UDF code object with handler_name "
-            << handler_name_;
-    return absl::OkStatus();
+            << code->handler_name;
+    return code;
   }
 
-  absl::Status SetWasmCodeObject(CodeConfig code_config) {
-    const auto code_object_status = SetCodeObject(std::move(code_config));
-    if (!code_object_status.ok()) {
-      return code_object_status;
+  // Forgets the least recently set versions beyond
+  // `kMaxResidentCodeVersions`, other than the active and canary ones.
+  void EvictResidentCodes() ABSL_EXCLUSIVE_LOCKS_REQUIRED(code_mutex_) {
+    while (resident_codes_.size() > kMaxResidentCodeVersions) {
+      auto evicted = resident_codes_.end();
+      for (auto it = resident_codes_.begin(); it != resident_codes_.end();
+           ++it) {
+        if (it->first == code_->version ||
+            (canary_code_ != nullptr && it->first == canary_code_->version)) {
+          continue;
+        }
+        if (evicted == resident_codes_.end() ||
+            it->second.code->logical_commit_time <
+                evicted->second.code->logical_commit_time) {
+          evicted = it;
+        }
+      }
+      VLOG(5) << "Evicting resident UDF version " << evicted->first;
+      resident_codes_.erase(evicted);
     }
-    return absl::OkStatus();
   }
 
- private:
+  // Runs `warm_up_invocations_` executions of `code` per worker without
+  // arguments, so that requests don't wait for the code to be compiled and
+  // optimized. Failures are only logged, since UDFs may not expect missing
+  // arguments.
+  void WarmUp(const ActiveCode& code) const {
+    const int num_executions = warm_up_invocations_ * num_workers_;
+    if (num_executions <= 0) {
+      return;
+    }
+    absl::StatusOr<std::vector<std::string>> input =
+        BuildInput(code, UDFExecutionMetadata(),
+                   google::protobuf::RepeatedPtrField<UDFArgument>());
+    if (!input.ok()) {
+      LOG(ERROR) << "Error building UDF warm-up input: " << input.status();
+      return;
+    }
+    // Outlives `WarmUp` if the executions time out.
+    struct WarmUpState {
+      bool Done() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex) {
+        return num_pending == 0;
+      }
+
+      ScopeMetricsContext metrics_context;
+      absl::Mutex mutex;
+      int num_pending ABSL_GUARDED_BY(mutex) = 0;
+      int num_failed ABSL_GUARDED_BY(mutex) = 0;
+    };
+    auto state = std::make_shared<WarmUpState>();
+    {
+      absl::MutexLock lock(&state->mutex);
+      state->num_pending = num_executions;
+    }
+    const absl::Duration timeout = warm_up_invocations_ * udf_timeout_;
+    const absl::Time start = absl::Now();
+    for (int i = 0; i < num_executions; ++i) {
+      RequestContext request_context(state->metrics_context);
+      request_context.SetDeadline(start + timeout);
+      const absl::Status status = roma_service_.Execute(
+          std::make_unique<InvocationStrRequest<RequestContext>>(
+              BuildInvocationRequest(code, std::move(request_context),
+                                     *input)),
+          [state](absl::StatusOr<ResponseObject> response) {
+            absl::MutexLock lock(&state->mutex);
+            if (!response.ok()) {
+              ++state->num_failed;
+            }
+            --state->num_pending;
+          });
+      if (!status.ok()) {
+        absl::MutexLock lock(&state->mutex);
+        ++state->num_failed;
+        --state->num_pending;
+      }
+    }
+    absl::MutexLock lock(&state->mutex);
+    if (!state->mutex.AwaitWithTimeout(
+            absl::Condition(state.get(), &WarmUpState::Done), timeout)) {
+      LOG(WARNING) << "Timed out warming up UDF version " << code.version
+                   << " after " << timeout << ", "
+                   << num_executions - state->num_pending << " of "
+                   << num_executions << " executions finished";
+    }
+    if (state->num_failed > 0) {
+      LOG(WARNING) << state->num_failed << " of " << num_executions
+                   << " warm-up executions of UDF version " << code.version
+                   << " failed";
+    }
+    VLOG(5) << "Warmed up UDF version " << code.version << " in "
+            << absl::Now() - start;
+  }
+
+  absl::StatusOr<std::string> ExecuteNative(
+      const ActiveCode& code, RequestContext request_context,
+      const UDFExecutionMetadata& execution_metadata,
+      const google::protobuf::RepeatedPtrField<UDFArgument>& arguments) const {
+    // Lookups made by the UDF are pointless once the UDF has timed out.
+    request_context.SetDeadline(std::min(request_context.GetDeadline(),
+                                         absl::Now() + udf_timeout_));
+    // Native UDFs run on the calling thread, so their CPU time is measured.
+    const absl::Time start = absl::Now();
+    const absl::Duration start_cpu_time = UdfUsageCounters::ThreadCpuTime();
+    absl::StatusOr<std::string> result = native_udfs_->Execute(
+        code.handler_name, request_context, execution_metadata, arguments);
+    UdfUsageCounters::Global().AddExecutions(
+        code.version, /*num_executions=*/1, absl::Now() - start,
+        UdfUsageCounters::ThreadCpuTime() - start_cpu_time,
+        result.ok() ? result->size() : 0);
+    return result;
+  }
+
+  absl::StatusOr<std::string> ExecuteCode(const ActiveCode& code,
+                                          RequestContext request_context,
+                                          std::vector<std::string> input,
+                                          ExecutionUsage usage) const {
+    if (code.native) {
+      return absl::InvalidArgumentError(
+          "Native UDFs only take UDFArgument inputs");
+    }
+    std::shared_ptr<absl::Status> response_status =
+        std::make_shared<absl::Status>();
+    std::shared_ptr<std::string> result = std::make_shared<std::string>();
+    std::shared_ptr<absl::Notification> notification =
+        std::make_shared<absl::Notification>();
+    if (const absl::Status admission_status = Admit(request_context);
+        !admission_status.ok()) {
+      return admission_status;
+    }
+    auto invocation_request = BuildInvocationRequest(
+        code, std::move(request_context), std::move(input));
+    VLOG(9) << "Executing UDF with input arg(s): "
+            << absl::StrJoin(invocation_request.input, ",");
+    usage.InputBuilt(invocation_request.input);
+    const auto status = roma_service_.Execute(
+        std::make_unique<InvocationStrRequest<RequestContext>>(
+            std::move(invocation_request)),
+        [notification, response_status, result, usage,
+         &admission_controller = admission_controller_](
+            absl::StatusOr<ResponseObject> response) {
+          admission_controller.Finish(absl::Now());
+          if (response.ok()) {
+            *result = std::move(response->resp);
+          } else {
+            response_status->Update(std::move(response.status()));
+          }
+          usage.Finished(/*num_executions=*/1, result->size());
+          notification->Notify();
+        });
+    if (!status.ok()) {
+      LOG(ERROR) << "Error sending UDF for execution: " << status;
+      admission_controller_.Finish(absl::Now());
+      return status;
+    }
+
+    notification->WaitForNotificationWithTimeout(udf_timeout_);
+    if (!notification->HasBeenNotified()) {
+      return absl::InternalError("Timed out waiting for UDF result.");
+    }
+    if (!response_status->ok()) {
+      LOG(ERROR) << "Error executing UDF: " << *response_status;
+      return *response_status;
+    }
+    return *result;
+  }
+
+  // Adds the execution to the open batch, which is run right away once full.
+  // Batches only hold executions of one code object, so the open batch is
+  // also run if `code` replaced its code object.
+  void AddToBatch(std::shared_ptr<const ActiveCode> code,
+                  RequestContext request_context, std::string input,
+                  ExecuteCodeCallback callback) const {
+    std::optional<Batch> stale_batch;
+    std::optional<Batch> full_batch;
+    {
+      absl::MutexLock lock(&batch_mutex_);
+      if (batch_.has_value() && batch_->code != code) {
+        stale_batch = std::exchange(batch_, std::nullopt);
+      }
+      if (!batch_.has_value()) {
+        batch_.emplace(Batch{.id = next_batch_id_++,
+                             .code = std::move(code),
+                             .flush_time = absl::Now() + batch_window_});
+      }
+      batch_->executions.push_back(
+          {.request_context = std::move(request_context),
+           .input = std::move(input),
+           .callback = std::move(callback)});
+      // Nothing flushes batches once stopping.
+      if (batch_->executions.size() >= static_cast<size_t>(max_batch_size_) ||
+          stopping_) {
+        full_batch = std::exchange(batch_, std::nullopt);
+      }
+    }
+    if (stale_batch.has_value()) {
+      ExecuteBatch(*std::move(stale_batch));
+    }
+    if (full_batch.has_value()) {
+      ExecuteBatch(*std::move(full_batch));
+    }
+  }
+
+  bool HasBatchOrStopping() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(batch_mutex_) {
+    return stopping_ || batch_.has_value();
+  }
+
+  // Runs every batch that is not full by its flush time. Runs the open batch
+  // and returns once stopping.
+  void FlushBatches() {
+    while (true) {
+      std::optional<Batch> batch;
+      {
+        absl::MutexLock lock(&batch_mutex_);
+        batch_mutex_.Await(
+            absl::Condition(this, &UdfClientImpl::HasBatchOrStopping));
+        if (!batch_.has_value()) {
+          return;
+        }
+        const int64_t id = batch_->id;
+        auto is_gone_or_stopping =
+            [this, id]() ABSL_EXCLUSIVE_LOCKS_REQUIRED(batch_mutex_) {
+              return stopping_ || !batch_.has_value() || batch_->id != id;
+            };
+        batch_mutex_.AwaitWithDeadline(absl::Condition(&is_gone_or_stopping),
+                                       batch_->flush_time);
+        // Batches that filled up ran already, and their successor has its
+        // own flush time.
+        if (batch_.has_value() && (batch_->id == id || stopping_)) {
+          batch = std::exchange(batch_, std::nullopt);
+        }
+      }
+      if (batch.has_value()) {
+        ExecuteBatch(*std::move(batch));
+      }
+    }
+  }
+
+  void StopBatching() {
+    {
+      absl::MutexLock lock(&batch_mutex_);
+      stopping_ = true;
+    }
+    if (batch_flusher_.joinable()) {
+      batch_flusher_.join();
+    }
+  }
+
+  // Runs the executions of `batch` in one invocation of the batch handler,
+  // with a JSON list of their inputs. Lookups of the handler use the request
+  // context of the first execution, with the earliest deadline of the batch.
+  void ExecuteBatch(Batch batch) const {
+    ExecutionUsage usage(batch.code->version);
+    absl::Time deadline = absl::InfiniteFuture();
+    for (const BatchedExecution& execution : batch.executions) {
+      deadline = std::min(deadline, execution.request_context.GetDeadline());
+    }
+    RequestContext request_context =
+        std::move(batch.executions.front().request_context);
+    request_context.SetDeadline(deadline);
+    std::string input = absl::StrCat(
+        "[",
+        absl::StrJoin(batch.executions, ",",
+                      [](std::string* out, const BatchedExecution& execution) {
+                        out->append(execution.input);
+                      }),
+        "]");
+    auto callbacks = std::make_shared<std::vector<ExecuteCodeCallback>>();
+    callbacks->reserve(batch.executions.size());
+    for (BatchedExecution& execution : batch.executions) {
+      callbacks->push_back(std::move(execution.callback));
+    }
+    if (const absl::Status admission_status = Admit(request_context);
+        !admission_status.ok()) {
+      SplitBatchOutput(admission_status, *callbacks);
+      return;
+    }
+    auto invocation_request = BuildInvocationRequest(
+        *batch.code, std::move(request_context), {std::move(input)});
+    invocation_request.handler_name = batch.code->batch_handler_name;
+    VLOG(9) << "Executing UDF batch of " << callbacks->size()
+            << " executions with input: " << invocation_request.input[0];
+    usage.InputBuilt(invocation_request.input);
+    const auto status = roma_service_.Execute(
+        std::make_unique<InvocationStrRequest<RequestContext>>(
+            std::move(invocation_request)),
+        [callbacks, usage, &admission_controller = admission_controller_](
+            absl::StatusOr<ResponseObject> response) {
+          admission_controller.Finish(absl::Now());
+          if (!response.ok()) {
+            LOG(ERROR) << "Error executing UDF batch: " << response.status();
+            usage.Finished(callbacks->size(), /*output_bytes=*/0);
+            SplitBatchOutput(std::move(response).status(), *callbacks);
+            return;
+          }
+          usage.Finished(callbacks->size(), response->resp.size());
+          SplitBatchOutput(std::move(response->resp), *callbacks);
+        });
+    if (!status.ok()) {
+      LOG(ERROR) << "Error sending UDF batch for execution: " << status;
+      admission_controller_.Finish(absl::Now());
+      SplitBatchOutput(status, *callbacks);
+    }
+  }
+
+  // Calls every callback with its element of `output`, the JSON list returned
+  // by a batch handler, or with the error of the batch.
+  static void SplitBatchOutput(absl::StatusOr<std::string> output,
+                               std::vector<ExecuteCodeCallback>& callbacks) {
+    if (!output.ok()) {
+      for (ExecuteCodeCallback& callback : callbacks) {
+        std::move(callback)(output.status());
+      }
+      return;
+    }
+    const nlohmann::json outputs =
+        nlohmann::json::parse(*output, nullptr, /*allow_exceptions=*/false);
+    if (!outputs.is_array() || outputs.size() != callbacks.size()) {
+      const absl::Status status = absl::InternalError(
+          absl::StrCat("UDF batch handler did not return a list of ",
+                       callbacks.size(), " outputs"));
+      for (ExecuteCodeCallback& callback : callbacks) {
+        std::move(callback)(status);
+      }
+      return;
+    }
+    for (size_t i = 0; i < callbacks.size(); ++i) {
+      // Serialized like Roma serializes the output of a single execution.
+      std::move(callbacks[i])(outputs[i].dump(
+          -1, ' ', false, nlohmann::json::error_handler_t::replace));
+    }
+  }
+
+  // Sets the deadline of `request_context` to when the UDF times out, if
+  // earlier, and admits the execution if it can start before then.
+  absl::Status Admit(RequestContext& request_context) const {
+    const absl::Time now = absl::Now();
+    // Lookups made by the UDF are pointless once the UDF has timed out.
+    request_context.SetDeadline(
+        std::min(request_context.GetDeadline(), now + udf_timeout_));
+    return admission_controller_.Admit(now, request_context.GetDeadline());
+  }
+
+  // Returns the metadata followed by every argument, in the input format of
+  // the code object.
+  absl::StatusOr<std::vector<std::string>> BuildInput(
+      const ActiveCode& code, UDFExecutionMetadata&& execution_metadata,
+      const google::protobuf::RepeatedPtrField<UDFArgument>& arguments) const {
+    execution_metadata.set_udf_interface_version(kUdfInterfaceVersion);
+    std::vector<std::string> string_args;
+    string_args.reserve(arguments.size() + 1);
+    if (code.input_format == UdfInputFormat::kProto) {
+      string_args.push_back(ToProtoInput(execution_metadata));
+      for (const UDFArgument& arg : arguments) {
+        string_args.push_back(ToProtoInput(arg));
+      }
+      return string_args;
+    }
+    std::string json_metadata;
+    if (const auto json_status =
+            MessageToJsonString(execution_metadata, &json_metadata);
+        !json_status.ok()) {
+      return json_status;
+    }
+    string_args.push_back(json_metadata);
+
+    for (int i = 0; i < arguments.size(); ++i) {
+      const auto& arg = arguments[i];
+      const google::protobuf::Message* arg_data;
+      if (arg.tags().values().empty()) {
+        arg_data = &arg.data();
+      } else {
+        arg_data = &arg;
+      }
+      std::string json_arg;
+      if (const auto json_status = MessageToJsonString(*arg_data, &json_arg);
+          !json_status.ok()) {
+        return json_status;
+      }
+      string_args.push_back(json_arg);
+    }
+    return string_args;
+  }
+
+  // Returns the JSON string of the base64 encoded serialized `message`. Base64
+  // strings need no JSON escaping.
+  static std::string ToProtoInput(const google::protobuf::Message& message) {
+    return absl::StrCat("\"", absl::Base64Escape(message.SerializeAsString()),
+                        "\"");
+  }
+
   InvocationStrRequest<RequestContext> BuildInvocationRequest(
-      RequestContext request_context, std::vector<std::string> input) const {
+      const ActiveCode& code, RequestContext request_context,
+      std::vector<std::string> input) const {
+    // Lets the hooks tell executions of different code objects apart.
+    request_context.SetUdfCodeCommitTime(code.logical_commit_time);
+    request_context.SetUdfCodeVersion(code.version);
     return {.id = kInvocationRequestId,
-            .version_string = absl::StrCat("v", version_),
-            .handler_name = handler_name_,
+            .version_string = absl::StrCat("v", code.version),
+            .handler_name = code.handler_name,
             .tags = {{std::string(kTimeoutDurationTag),
                       FormatDuration(udf_timeout_)}},
             .input = std::move(input),
@@ -210,11 +873,34 @@ class UdfClientImpl : public UdfClient {
             .wasm = std::move(wasm)};
   }
 
-  std::string handler_name_;
+  mutable absl::Mutex code_mutex_;
+  std::shared_ptr<const ActiveCode> code_ ABSL_GUARDED_BY(code_mutex_) =
+      std::make_shared<ActiveCode>();
+  // Runs `canary_percent_` of the requests instead of `code_`, if set.
+  std::shared_ptr<const ActiveCode> canary_code_ ABSL_GUARDED_BY(code_mutex_);
+  int32_t canary_percent_ ABSL_GUARDED_BY(code_mutex_) = 0;
+  mutable int64_t num_routed_requests_ ABSL_GUARDED_BY(code_mutex_) = 0;
+  // By version, including the ones of `code_` and `canary_code_`.
+  absl::flat_hash_map<int64_t, ResidentCode> resident_codes_
+      ABSL_GUARDED_BY(code_mutex_);
   int64_t logical_commit_time_ = -1;
-  int64_t version_ = 1;
   const absl::Duration udf_timeout_;
   int udf_min_log_level_;
+  const int warm_up_invocations_;
+  const int num_workers_;
+  // Executions are admitted and finished from const methods, like Roma runs
+  // them.
+  mutable UdfAdmissionController admission_controller_;
+  const NativeUdfRegistry* native_udfs_;
+  const absl::Duration batch_window_;
+  const int max_batch_size_;
+  // Executions are batched from const methods too.
+  mutable absl::Mutex batch_mutex_;
+  mutable std::optional<Batch> batch_ ABSL_GUARDED_BY(batch_mutex_);
+  mutable int64_t next_batch_id_ ABSL_GUARDED_BY(batch_mutex_) = 0;
+  bool stopping_ ABSL_GUARDED_BY(batch_mutex_) = false;
+  // Runs batches that don't fill up within `batch_window_`.
+  std::thread batch_flusher_;
   // Per b/299667930, RomaService has been extended to support metadata storage
   // as a side effect of RomaService::Execute(), making it no longer const.
   // However, UDFClient::ExecuteCode() remains logically const, so RomaService
@@ -227,11 +913,22 @@ class UdfClientImpl : public UdfClient {
 
 }  // namespace
 
+void UdfClient::ExecuteCodeAsync(
+    RequestContext request_context, UDFExecutionMetadata&& execution_metadata,
+    const google::protobuf::RepeatedPtrField<UDFArgument>& arguments,
+    ExecuteCodeCallback callback) const {
+  std::move(callback)(ExecuteCode(std::move(request_context),
+                                  std::move(execution_metadata), arguments));
+}
+
 absl::StatusOr<std::unique_ptr<UdfClient>> UdfClient::Create(
     Config<RequestContext>&& config, absl::Duration udf_timeout,
-    int udf_min_log_level) {
+    int udf_min_log_level, int warm_up_invocations,
+    const NativeUdfRegistry* native_udfs, absl::Duration batch_window,
+    int max_batch_size) {
   auto udf_client = std::make_unique<UdfClientImpl>(
-      std::move(config), udf_timeout, udf_min_log_level);
+      std::move(config), udf_timeout, udf_min_log_level, warm_up_invocations,
+      native_udfs, batch_window, max_batch_size);
   const auto init_status = udf_client->Init();
   if (!init_status.ok()) {
     return init_status;
@@ -17,14 +17,18 @@
 #ifndef COMPONENTS_UDF_UDF_CLIENT_H_
 #define COMPONENTS_UDF_UDF_CLIENT_H_
 
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <vector>
 
+#include "absl/functional/any_invocable.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/time/time.h"
 #include "components/telemetry/server_definition.h"
 #include "components/udf/code_config.h"
+#include "components/udf/native_udf_registry.h"
 #include "components/util/request_context.h"
 #include "google/protobuf/message.h"
 #include "public/api_schema.pb.h"
@@ -52,19 +56,52 @@ class UdfClient {
       const google::protobuf::RepeatedPtrField<UDFArgument>& arguments)
       const = 0;
 
+  // Called with the output of an asynchronous UDF execution.
+  using ExecuteCodeCallback =
+      absl::AnyInvocable<void(absl::StatusOr<std::string>) &&>;
+
+  // Executes the UDF without blocking the calling thread for the duration of
+  // the UDF. `callback` is called exactly once, possibly before this returns
+  // and possibly on another thread. Code object must be set before making
+  // this call. By default, runs the blocking `ExecuteCode` and then calls
+  // `callback`.
+  virtual void ExecuteCodeAsync(
+      RequestContext request_context, UDFExecutionMetadata&& execution_metadata,
+      const google::protobuf::RepeatedPtrField<UDFArgument>& arguments,
+      ExecuteCodeCallback callback) const;
+
   virtual absl::Status Stop() = 0;
 
-  // Sets the code object that will be used for UDF execution
+  // Sets the code object that will be used for UDF execution. Code objects
+  // with a `canary_percent` run that percentage of the executions while the
+  // code object set before them runs the others. The last few code versions
+  // set stay loaded, so setting one of them again switches to it right away,
+  // and executions whose request metadata has a `udf_version` run that
+  // version if it is loaded.
   virtual absl::Status SetCodeObject(CodeConfig code_config) = 0;
 
   // Sets the WASM code object that will be used for UDF execution
   virtual absl::Status SetWasmCodeObject(CodeConfig code_config) = 0;
 
-  // Creates a UDF executor. This calls Roma::Init, which forks.
+  // Returns the logical commit time of the code object that executions run,
+  // which changes with every code object set, or -1 if none is set.
+  virtual int64_t GetCodeObjectLogicalCommitTime() const { return -1; }
+
+  // Creates a UDF executor. This calls Roma::Init, which forks. Every new code
+  // object is executed `warm_up_invocations` times per worker before requests
+  // use it. Code objects whose handler is in `native_udfs` run in-process
+  // instead of in Roma. If `batch_window` is positive, asynchronous executions
+  // of code objects with a batch handler wait up to `batch_window` for up to
+  // `max_batch_size` concurrent executions, and run together with them in one
+  // invocation of the batch handler.
   static absl::StatusOr<std::unique_ptr<UdfClient>> Create(
       google::scp::roma::Config<RequestContext>&& config =
           google::scp::roma::Config<RequestContext>(),
-      absl::Duration udf_timeout = absl::Seconds(5), int udf_min_log_level = 0);
+      absl::Duration udf_timeout = absl::Seconds(5), int udf_min_log_level = 0,
+      int warm_up_invocations = 0,
+      const NativeUdfRegistry* native_udfs = nullptr,
+      absl::Duration batch_window = absl::ZeroDuration(),
+      int max_batch_size = 16);
 };
 
 }  // namespace kv_server
@@ -0,0 +1,352 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Measures the stages of a UDF execution:
+// => BM_ArgumentsToJson, BM_ArgumentsToProto - converting the arguments of a
+// request into the input of the UDF, in the JSON and the proto input formats.
+// => BM_RunQueryHook - the runQuery hook writing a query result for UDFs,
+// see `get_values_hook_benchmark` for the getValues hook.
+// => BM_ExecuteCode - executing a UDF in Roma with the keys of a request,
+// either returning right away, which measures the dispatch to and from the
+// Roma workers, or calling a hook and decoding its output. The noop UDF
+// client is the baseline.
+//
+//  bazel run -c opt //components/udf:udf_client_benchmark \
+//    --//:instance=local --//:platform=local
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "absl/container/flat_hash_set.h"
+#include "absl/log/check.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/escaping.h"
+#include "absl/strings/str_cat.h"
+#include "benchmark/benchmark.h"
+#include "components/internal_server/lookup.h"
+#include "components/telemetry/server_definition.h"
+#include "components/udf/code_config.h"
+#include "components/udf/hooks/get_values_hook.h"
+#include "components/udf/hooks/run_query_hook.h"
+#include "components/udf/noop_udf_client.h"
+#include "components/udf/udf_client.h"
+#include "components/udf/udf_config_builder.h"
+#include "google/protobuf/util/json_util.h"
+#include "public/api_schema.pb.h"
+
+namespace kv_server {
+namespace {
+
+using google::protobuf::RepeatedPtrField;
+using google::protobuf::util::MessageToJsonString;
+using google::scp::roma::FunctionBindingPayload;
+using google::scp::roma::proto::FunctionBindingIoProto;
+
+// Handlers of the UDF code object, one per `BM_ExecuteCode` variant. Keys are
+// passed as the list of the first argument.
+constexpr std::string_view kUdfJs = R"(
+  function echo(metadata, keys) {
+    return keys.length;
+  }
+  function callGetValues(metadata, keys) {
+    const kvPairs = JSON.parse(getValues(keys)).kvPairs;
+    return Object.keys(kvPairs).length;
+  }
+  function callGetValuesBinary(metadata, keys) {
+    return getValuesBinary(keys).length;
+  }
+  function callRunQuery(metadata, keys) {
+    return runQuery(keys[0]).length;
+  }
+  function callRunQueryBinary(metadata, keys) {
+    return runQueryBinary(keys[0]).length;
+  }
+)";
+
+// Returns the responses last set with `SetResponses` to every lookup, so that
+// the hooks of the shared UDF client can be benchmarked with different sizes.
+class FixedLookup : public Lookup {
+ public:
+  void SetResponses(InternalLookupResponse lookup_response,
+                    InternalRunQueryResponse query_response) {
+    lookup_response_ = std::move(lookup_response);
+    query_response_ = std::move(query_response);
+  }
+
+  absl::StatusOr<InternalLookupResponse> GetKeyValues(
+      const RequestContext& request_context,
+      const absl::flat_hash_set<std::string_view>& keys) const override {
+    return lookup_response_;
+  }
+
+  absl::StatusOr<InternalLookupResponse> GetKeyValueSet(
+      const RequestContext& request_context,
+      const absl::flat_hash_set<std::string_view>& key_set) const override {
+    return lookup_response_;
+  }
+
+  absl::StatusOr<InternalRunQueryResponse> RunQuery(
+      const RequestContext& request_context, std::string query) const override {
+    return query_response_;
+  }
+
+ private:
+  InternalLookupResponse lookup_response_;
+  InternalRunQueryResponse query_response_;
+};
+
+// Forwards to `lookup`, so that hooks, which own their lookup, can share one.
+class ForwardingLookup : public Lookup {
+ public:
+  explicit ForwardingLookup(const Lookup& lookup) : lookup_(lookup) {}
+
+  absl::StatusOr<InternalLookupResponse> GetKeyValues(
+      const RequestContext& request_context,
+      const absl::flat_hash_set<std::string_view>& keys) const override {
+    return lookup_.GetKeyValues(request_context, keys);
+  }
+
+  absl::StatusOr<InternalLookupResponse> GetKeyValueSet(
+      const RequestContext& request_context,
+      const absl::flat_hash_set<std::string_view>& key_set) const override {
+    return lookup_.GetKeyValueSet(request_context, key_set);
+  }
+
+  absl::StatusOr<InternalRunQueryResponse> RunQuery(
+      const RequestContext& request_context, std::string query) const override {
+    return lookup_.RunQuery(request_context, std::move(query));
+  }
+
+ private:
+  const Lookup& lookup_;
+};
+
+std::string GetKey(int64_t index) { return absl::StrCat("key", index); }
+
+// Returns `num_keys` keys with values of `value_size` bytes, and as many
+// query result elements of `value_size` bytes.
+std::pair<InternalLookupResponse, InternalRunQueryResponse> BuildResponses(
+    int64_t num_keys, int64_t value_size) {
+  const std::string value(value_size, 'v');
+  InternalLookupResponse lookup_response;
+  InternalRunQueryResponse query_response;
+  for (int64_t i = 0; i < num_keys; i++) {
+    (*lookup_response.mutable_kv_pairs())[GetKey(i)].set_value(value);
+    query_response.add_elements(absl::StrCat(i, value));
+  }
+  return {std::move(lookup_response), std::move(query_response)};
+}
+
+// Returns the arguments of a request for `num_keys` keys, as a list.
+RepeatedPtrField<UDFArgument> BuildArguments(int64_t num_keys) {
+  RepeatedPtrField<UDFArgument> arguments;
+  auto* keys = arguments.Add()->mutable_data()->mutable_list_value();
+  for (int64_t i = 0; i < num_keys; i++) {
+    keys->add_values()->set_string_value(GetKey(i));
+  }
+  return arguments;
+}
+
+// A UDF client with every hook, shared by the benchmarks since creating one
+// starts the Roma workers.
+struct SharedUdfClient {
+  SharedUdfClient()
+      : get_values_string_hook(
+            GetValuesHook::Create(GetValuesHook::OutputType::kString)),
+        get_values_binary_hook(
+            GetValuesHook::Create(GetValuesHook::OutputType::kBinary)),
+        run_query_string_hook(
+            RunQueryHook::Create(RunQueryHook::OutputType::kString)),
+        run_query_binary_hook(
+            RunQueryHook::Create(RunQueryHook::OutputType::kBinary)) {
+    get_values_string_hook->FinishInit(
+        std::make_unique<ForwardingLookup>(lookup));
+    get_values_binary_hook->FinishInit(
+        std::make_unique<ForwardingLookup>(lookup));
+    run_query_string_hook->FinishInit(
+        std::make_unique<ForwardingLookup>(lookup));
+    run_query_binary_hook->FinishInit(
+        std::make_unique<ForwardingLookup>(lookup));
+    UdfConfigBuilder config_builder;
+    auto udf_client = UdfClient::Create(std::move(
+        config_builder.RegisterStringGetValuesHook(*get_values_string_hook)
+            .RegisterBinaryGetValuesHook(*get_values_binary_hook)
+            .RegisterRunQueryHook(*run_query_string_hook)
+            .RegisterBinaryRunQueryHook(*run_query_binary_hook)
+            .SetNumberOfWorkers(1)
+            .Config()));
+    CHECK(udf_client.ok()) << udf_client.status();
+    client = *std::move(udf_client);
+  }
+
+  // Makes `handler_name` the handler of the UDF.
+  void SetHandler(std::string handler_name) {
+    version++;
+    const absl::Status status = client->SetCodeObject(CodeConfig{
+        .js = std::string(kUdfJs),
+        .udf_handler_name = std::move(handler_name),
+        .logical_commit_time = version,
+        .version = version,
+    });
+    CHECK(status.ok()) << status;
+  }
+
+  FixedLookup lookup;
+  std::unique_ptr<GetValuesHook> get_values_string_hook;
+  std::unique_ptr<GetValuesHook> get_values_binary_hook;
+  std::unique_ptr<RunQueryHook> run_query_string_hook;
+  std::unique_ptr<RunQueryHook> run_query_binary_hook;
+  std::unique_ptr<UdfClient> client;
+  int64_t version = 0;
+};
+
+SharedUdfClient& GetSharedUdfClient() {
+  static auto* const udf_client = new SharedUdfClient();
+  return *udf_client;
+}
+
+void BM_ArgumentsToJson(benchmark::State& state) {
+  const RepeatedPtrField<UDFArgument> arguments =
+      BuildArguments(state.range(0));
+  for (auto _ : state) {
+    for (const UDFArgument& argument : arguments) {
+      std::string json;
+      CHECK(MessageToJsonString(argument.data(), &json).ok());
+      benchmark::DoNotOptimize(json);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+void BM_ArgumentsToProto(benchmark::State& state) {
+  const RepeatedPtrField<UDFArgument> arguments =
+      BuildArguments(state.range(0));
+  for (auto _ : state) {
+    for (const UDFArgument& argument : arguments) {
+      std::string input = absl::StrCat(
+          "\"", absl::Base64Escape(argument.SerializeAsString()), "\"");
+      benchmark::DoNotOptimize(input);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+void BM_RunQueryHook(benchmark::State& state, RunQueryHook::OutputType type) {
+  auto lookup = std::make_unique<FixedLookup>();
+  auto [lookup_response, query_response] =
+      BuildResponses(state.range(0), state.range(1));
+  lookup->SetResponses(std::move(lookup_response), std::move(query_response));
+  auto hook = RunQueryHook::Create(type);
+  hook->FinishInit(std::move(lookup));
+  FunctionBindingIoProto io;
+  io.set_input_string("A");
+  ScopeMetricsContext metrics_context;
+  for (auto _ : state) {
+    // A new request context for every call, since query results are cached
+    // per request.
+    FunctionBindingPayload<RequestContext> payload{
+        io, RequestContext(metrics_context)};
+    (*hook)(payload);
+    benchmark::DoNotOptimize(payload.io_proto);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+void RunExecuteCode(benchmark::State& state, const UdfClient& client) {
+  const RepeatedPtrField<UDFArgument> arguments =
+      BuildArguments(state.range(0));
+  ScopeMetricsContext metrics_context;
+  for (auto _ : state) {
+    auto result = client.ExecuteCode(RequestContext(metrics_context),
+                                     UDFExecutionMetadata(), arguments);
+    CHECK(result.ok()) << result.status();
+    benchmark::DoNotOptimize(result);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+void BM_ExecuteCodeNoop(benchmark::State& state) {
+  const auto client = NewNoopUdfClient();
+  RunExecuteCode(state, *client);
+}
+
+void BM_ExecuteCodeEcho(benchmark::State& state) {
+  SharedUdfClient& shared_client = GetSharedUdfClient();
+  shared_client.SetHandler("echo");
+  RunExecuteCode(state, *shared_client.client);
+}
+
+// Runs a UDF that calls a hook with `state.range(0)` keys, which returns as
+// many values of `state.range(1)` bytes.
+void BM_ExecuteCode(benchmark::State& state, std::string handler_name) {
+  SharedUdfClient& shared_client = GetSharedUdfClient();
+  auto [lookup_response, query_response] =
+      BuildResponses(state.range(0), state.range(1));
+  shared_client.lookup.SetResponses(std::move(lookup_response),
+                                    std::move(query_response));
+  shared_client.SetHandler(std::move(handler_name));
+  RunExecuteCode(state, *shared_client.client);
+}
+
+void KeysAndValueSizes(benchmark::internal::Benchmark* b) {
+  b->ArgNames({"keys", "value_size"});
+  for (const int64_t num_keys : {1, 10, 100, 1000}) {
+    for (const int64_t value_size : {32, 1024}) {
+      b->Args({num_keys, value_size});
+    }
+  }
+}
+
+void KeySizes(benchmark::internal::Benchmark* b) {
+  b->ArgNames({"keys"});
+  for (const int64_t num_keys : {1, 10, 100, 1000}) {
+    b->Arg(num_keys);
+  }
+}
+
+BENCHMARK(BM_ArgumentsToJson)->Apply(KeySizes);
+BENCHMARK(BM_ArgumentsToProto)->Apply(KeySizes);
+BENCHMARK_CAPTURE(BM_RunQueryHook, String, RunQueryHook::OutputType::kString)
+    ->Apply(KeysAndValueSizes);
+BENCHMARK_CAPTURE(BM_RunQueryHook, Binary, RunQueryHook::OutputType::kBinary)
+    ->Apply(KeysAndValueSizes);
+// UDFs run on the Roma workers, so the benchmarks of UDF executions use the
+// real time.
+BENCHMARK(BM_ExecuteCodeNoop)->Apply(KeySizes)->UseRealTime();
+BENCHMARK(BM_ExecuteCodeEcho)->Apply(KeySizes)->UseRealTime();
+BENCHMARK_CAPTURE(BM_ExecuteCode, GetValuesString, "callGetValues")
+    ->Apply(KeysAndValueSizes)
+    ->UseRealTime();
+BENCHMARK_CAPTURE(BM_ExecuteCode, GetValuesBinary, "callGetValuesBinary")
+    ->Apply(KeysAndValueSizes)
+    ->UseRealTime();
+BENCHMARK_CAPTURE(BM_ExecuteCode, RunQueryString, "callRunQuery")
+    ->Apply(KeysAndValueSizes)
+    ->UseRealTime();
+BENCHMARK_CAPTURE(BM_ExecuteCode, RunQueryBinary, "callRunQueryBinary")
+    ->Apply(KeysAndValueSizes)
+    ->UseRealTime();
+
+}  // namespace
+}  // namespace kv_server
+
+int main(int argc, char** argv) {
+  ::benchmark::Initialize(&argc, argv);
+  kv_server::InitMetricsContextMap();
+  ::benchmark::RunSpecifiedBenchmarks();
+  ::benchmark::Shutdown();
+  return 0;
+}
@@ -14,6 +14,7 @@
 
 #include "components/udf/udf_client.h"
 
+#include <atomic>
 #include <fstream>
 #include <string>
 #include <tuple>
@@ -22,6 +23,9 @@
 
 #include "absl/log/scoped_mock_log.h"
 #include "absl/status/statusor.h"
+#include "absl/strings/escaping.h"
+#include "absl/strings/str_cat.h"
+#include "absl/synchronization/blocking_counter.h"
 #include "components/internal_server/mocks.h"
 #include "components/udf/code_config.h"
 #include "components/udf/hooks/get_values_hook.h"
@@ -161,6 +165,39 @@ TEST_F(UdfClientTest, JsEchoCallSucceeds_SimpleUDFArg_string) {
   EXPECT_TRUE(stop.ok());
 }
 
+TEST_F(UdfClientTest, JsEchoCallSucceeds_ProtoInput) {
+  auto udf_client = CreateUdfClient();
+  EXPECT_TRUE(udf_client.ok());
+
+  absl::Status code_obj_status = udf_client.value()->SetCodeObject(CodeConfig{
+      .js = "hello = (metadata, input) => JSON.stringify([metadata, input]);",
+      .udf_handler_name = "hello",
+      .logical_commit_time = 1,
+      .version = 1,
+      .input_format = UdfInputFormat::kProto,
+  });
+  EXPECT_TRUE(code_obj_status.ok());
+
+  google::protobuf::RepeatedPtrField<UDFArgument> args;
+  UDFArgument& arg = *args.Add();
+  arg.mutable_tags()->add_values()->set_string_value("tag1");
+  arg.mutable_data()->set_string_value("ECHO");
+  UDFExecutionMetadata metadata;
+  metadata.set_udf_interface_version(1);
+  ScopeMetricsContext metrics_context;
+  absl::StatusOr<std::string> result = udf_client.value()->ExecuteCode(
+      RequestContext(metrics_context), {}, args);
+  ASSERT_TRUE(result.ok()) << result.status();
+  const std::string expected_metadata =
+      absl::Base64Escape(metadata.SerializeAsString());
+  const std::string expected_arg = absl::Base64Escape(arg.SerializeAsString());
+  EXPECT_EQ(*result, absl::StrCat(R"("[\")", expected_metadata, R"(\",\")",
+                                  expected_arg, R"(\"]")"));
+
+  absl::Status stop = udf_client.value()->Stop();
+  EXPECT_TRUE(stop.ok());
+}
+
 TEST_F(UdfClientTest, JsEchoCallSucceeds_SimpleUDFArg_string_tagged) {
   auto udf_client = CreateUdfClient();
   EXPECT_TRUE(udf_client.ok());
@@ -290,6 +327,139 @@ TEST_F(UdfClientTest, JsEchoHookCallSucceeds) {
   EXPECT_TRUE(stop.ok());
 }
 
+TEST_F(UdfClientTest, WarmsUpCodeObjectBeforeItIsSet) {
+  std::atomic<int> num_calls = 0;
+  auto function_object =
+      std::make_unique<FunctionBindingObjectV2<RequestContext>>();
+  function_object->function_name = "count";
+  function_object->function =
+      [&num_calls](FunctionBindingPayload<RequestContext>& payload) {
+        num_calls++;
+      };
+
+  Config<RequestContext> config;
+  config.number_of_workers = 2;
+  config.RegisterFunctionBinding(std::move(function_object));
+  absl::StatusOr<std::unique_ptr<UdfClient>> udf_client =
+      UdfClient::Create(std::move(config), absl::Seconds(5),
+                        /*udf_min_log_level=*/0, /*warm_up_invocations=*/3);
+  ASSERT_TRUE(udf_client.ok());
+
+  absl::Status code_obj_status = udf_client.value()->SetCodeObject(CodeConfig{
+      .js = "hello = (metadata) => { count(''); return metadata; };",
+      .udf_handler_name = "hello",
+      .logical_commit_time = 1,
+      .version = 1,
+  });
+  EXPECT_TRUE(code_obj_status.ok());
+  EXPECT_EQ(num_calls, 6);
+  ScopeMetricsContext metrics_context;
+  absl::StatusOr<std::string> result = udf_client.value()->ExecuteCode(
+      RequestContext(metrics_context), {R"("input")"});
+  EXPECT_TRUE(result.ok());
+  EXPECT_EQ(*result, R"("input")");
+  EXPECT_EQ(num_calls, 7);
+
+  absl::Status stop = udf_client.value()->Stop();
+  EXPECT_TRUE(stop.ok());
+}
+
+absl::StatusOr<std::unique_ptr<UdfClient>> CreateBatchingUdfClient(
+    absl::Duration batch_window, int max_batch_size) {
+  Config<RequestContext> config;
+  config.number_of_workers = 1;
+  absl::StatusOr<std::unique_ptr<UdfClient>> udf_client = UdfClient::Create(
+      std::move(config), absl::Seconds(5), /*udf_min_log_level=*/0,
+      /*warm_up_invocations=*/0, /*native_udfs=*/nullptr, batch_window,
+      max_batch_size);
+  if (!udf_client.ok()) {
+    return udf_client;
+  }
+  if (absl::Status status = (*udf_client)->SetCodeObject(CodeConfig{
+          .js = R"(
+            hello = (metadata, input) => 'single ' + input;
+            helloBatch = (inputs) => inputs.map(
+                ([metadata, input]) => `batch ${input} of ${inputs.length}`);
+          )",
+          .udf_handler_name = "hello",
+          .logical_commit_time = 1,
+          .version = 1,
+          .batch_handler_name = "helloBatch",
+      });
+      !status.ok()) {
+    return status;
+  }
+  return udf_client;
+}
+
+// Executes `udf_client` asynchronously once per input, and returns the
+// outputs in the order of the inputs.
+std::vector<absl::StatusOr<std::string>> ExecuteAsync(
+    const UdfClient& udf_client, const std::vector<std::string>& inputs) {
+  ScopeMetricsContext metrics_context;
+  std::vector<absl::StatusOr<std::string>> results(inputs.size());
+  absl::BlockingCounter done(inputs.size());
+  for (size_t i = 0; i < inputs.size(); ++i) {
+    google::protobuf::RepeatedPtrField<UDFArgument> args;
+    args.Add()->mutable_data()->set_string_value(inputs[i]);
+    udf_client.ExecuteCodeAsync(
+        RequestContext(metrics_context), {}, args,
+        [&results, &done, i](absl::StatusOr<std::string> result) {
+          results[i] = std::move(result);
+          done.DecrementCount();
+        });
+  }
+  done.Wait();
+  return results;
+}
+
+TEST_F(UdfClientTest, BatchesConcurrentAsyncExecutions) {
+  auto udf_client =
+      CreateBatchingUdfClient(absl::Seconds(5), /*max_batch_size=*/2);
+  ASSERT_TRUE(udf_client.ok()) << udf_client.status();
+
+  std::vector<absl::StatusOr<std::string>> results =
+      ExecuteAsync(**udf_client, {"a", "b"});
+  ASSERT_TRUE(results[0].ok()) << results[0].status();
+  EXPECT_EQ(*results[0], R"("batch a of 2")");
+  ASSERT_TRUE(results[1].ok()) << results[1].status();
+  EXPECT_EQ(*results[1], R"("batch b of 2")");
+
+  absl::Status stop = udf_client.value()->Stop();
+  EXPECT_TRUE(stop.ok());
+}
+
+TEST_F(UdfClientTest, RunsBatchAfterBatchWindow) {
+  auto udf_client =
+      CreateBatchingUdfClient(absl::Milliseconds(10), /*max_batch_size=*/16);
+  ASSERT_TRUE(udf_client.ok()) << udf_client.status();
+
+  std::vector<absl::StatusOr<std::string>> results =
+      ExecuteAsync(**udf_client, {"a"});
+  ASSERT_TRUE(results[0].ok()) << results[0].status();
+  EXPECT_EQ(*results[0], R"("batch a of 1")");
+
+  absl::Status stop = udf_client.value()->Stop();
+  EXPECT_TRUE(stop.ok());
+}
+
+TEST_F(UdfClientTest, DoesNotBatchBlockingExecutions) {
+  auto udf_client =
+      CreateBatchingUdfClient(absl::Seconds(5), /*max_batch_size=*/2);
+  ASSERT_TRUE(udf_client.ok()) << udf_client.status();
+
+  google::protobuf::RepeatedPtrField<UDFArgument> args;
+  args.Add()->mutable_data()->set_string_value("a");
+  ScopeMetricsContext metrics_context;
+  absl::StatusOr<std::string> result = udf_client.value()->ExecuteCode(
+      RequestContext(metrics_context), {}, args);
+  ASSERT_TRUE(result.ok()) << result.status();
+  EXPECT_EQ(*result, R"("single a")");
+
+  absl::Status stop = udf_client.value()->Stop();
+  EXPECT_TRUE(stop.ok());
+}
+
 TEST_F(UdfClientTest, JsStringInWithGetValuesHookSucceeds) {
   auto mock_lookup = std::make_unique<MockLookup>();
 
@@ -558,6 +728,135 @@ TEST_F(UdfClientTest, IgnoresCodeObjectWithSmallerCommitTime) {
   EXPECT_TRUE(stop.ok());
 }
 
+absl::StatusOr<std::string> ExecuteWithMetadata(
+    const UdfClient& udf_client, UDFExecutionMetadata execution_metadata) {
+  ScopeMetricsContext metrics_context;
+  google::protobuf::RepeatedPtrField<UDFArgument> args;
+  return udf_client.ExecuteCode(RequestContext(metrics_context),
+                                std::move(execution_metadata), args);
+}
+
+TEST_F(UdfClientTest, SwitchesBackToResidentVersionWithoutWarmUp) {
+  std::atomic<int> num_calls = 0;
+  auto function_object =
+      std::make_unique<FunctionBindingObjectV2<RequestContext>>();
+  function_object->function_name = "count";
+  function_object->function =
+      [&num_calls](FunctionBindingPayload<RequestContext>& payload) {
+        num_calls++;
+      };
+  Config<RequestContext> config;
+  config.number_of_workers = 1;
+  config.RegisterFunctionBinding(std::move(function_object));
+  absl::StatusOr<std::unique_ptr<UdfClient>> udf_client =
+      UdfClient::Create(std::move(config), absl::Seconds(5),
+                        /*udf_min_log_level=*/0, /*warm_up_invocations=*/1);
+  ASSERT_TRUE(udf_client.ok());
+
+  const CodeConfig version1{
+      .js = "hello = () => { count(''); return '1'; };",
+      .udf_handler_name = "hello",
+      .logical_commit_time = 1,
+      .version = 1,
+  };
+  ASSERT_TRUE((*udf_client)->SetCodeObject(version1).ok());
+  ASSERT_TRUE((*udf_client)
+                  ->SetCodeObject(CodeConfig{
+                      .js = "hello = () => { count(''); return '2'; };",
+                      .udf_handler_name = "hello",
+                      .logical_commit_time = 2,
+                      .version = 2,
+                  })
+                  .ok());
+  EXPECT_EQ(num_calls, 2);
+  CodeConfig rollback = version1;
+  rollback.logical_commit_time = 3;
+  ASSERT_TRUE((*udf_client)->SetCodeObject(rollback).ok());
+  EXPECT_EQ(num_calls, 2);
+  EXPECT_EQ((*udf_client)->GetCodeObjectLogicalCommitTime(), 3);
+  absl::StatusOr<std::string> result = ExecuteWithMetadata(**udf_client, {});
+  ASSERT_TRUE(result.ok()) << result.status();
+  EXPECT_EQ(*result, R"("1")");
+
+  EXPECT_TRUE((*udf_client)->Stop().ok());
+}
+
+TEST_F(UdfClientTest, RunsCanaryForItsPercentageOfExecutions) {
+  auto udf_client = CreateUdfClient();
+  ASSERT_TRUE(udf_client.ok());
+  ASSERT_TRUE((*udf_client)
+                  ->SetCodeObject(CodeConfig{
+                      .js = "hello = () => 'stable';",
+                      .udf_handler_name = "hello",
+                      .logical_commit_time = 1,
+                      .version = 1,
+                  })
+                  .ok());
+  const CodeConfig canary{
+      .js = "hello = () => 'canary';",
+      .udf_handler_name = "hello",
+      .logical_commit_time = 2,
+      .version = 2,
+      .canary_percent = 25,
+  };
+  ASSERT_TRUE((*udf_client)->SetCodeObject(canary).ok());
+  std::vector<std::string> results;
+  for (int i = 0; i < 8; ++i) {
+    absl::StatusOr<std::string> result = ExecuteWithMetadata(**udf_client, {});
+    ASSERT_TRUE(result.ok()) << result.status();
+    results.push_back(*result);
+  }
+  EXPECT_THAT(results, testing::ElementsAre(
+                           R"("stable")", R"("stable")", R"("stable")",
+                           R"("canary")", R"("stable")", R"("stable")",
+                           R"("stable")", R"("canary")"));
+
+  // Setting the canary version again without a percentage promotes it.
+  CodeConfig promoted = canary;
+  promoted.logical_commit_time = 3;
+  promoted.canary_percent = 0;
+  ASSERT_TRUE((*udf_client)->SetCodeObject(promoted).ok());
+  for (int i = 0; i < 4; ++i) {
+    absl::StatusOr<std::string> result = ExecuteWithMetadata(**udf_client, {});
+    ASSERT_TRUE(result.ok()) << result.status();
+    EXPECT_EQ(*result, R"("canary")");
+  }
+
+  EXPECT_TRUE((*udf_client)->Stop().ok());
+}
+
+TEST_F(UdfClientTest, RunsResidentVersionPinnedByRequestMetadata) {
+  auto udf_client = CreateUdfClient();
+  ASSERT_TRUE(udf_client.ok());
+  for (int version = 1; version <= 2; ++version) {
+    ASSERT_TRUE((*udf_client)
+                    ->SetCodeObject(CodeConfig{
+                        .js = absl::StrCat("hello = () => '", version, "';"),
+                        .udf_handler_name = "hello",
+                        .logical_commit_time = version,
+                        .version = version,
+                    })
+                    .ok());
+  }
+  UDFExecutionMetadata pinned;
+  (*pinned.mutable_request_metadata()->mutable_fields())["udf_version"]
+      .set_number_value(1);
+  absl::StatusOr<std::string> result =
+      ExecuteWithMetadata(**udf_client, pinned);
+  ASSERT_TRUE(result.ok()) << result.status();
+  EXPECT_EQ(*result, R"("1")");
+
+  // Versions that are not resident run the active code object.
+  UDFExecutionMetadata unknown;
+  (*unknown.mutable_request_metadata()->mutable_fields())["udf_version"]
+      .set_number_value(7);
+  result = ExecuteWithMetadata(**udf_client, unknown);
+  ASSERT_TRUE(result.ok()) << result.status();
+  EXPECT_EQ(*result, R"("2")");
+
+  EXPECT_TRUE((*udf_client)->Stop().ok());
+}
+
 TEST_F(UdfClientTest, CodeObjectNotSetError) {
   auto udf_client = CreateUdfClient();
   EXPECT_TRUE(udf_client.ok());
@@ -21,9 +21,11 @@
 #include <utility>
 #include <vector>
 
+#include "components/udf/hooks/get_keys_containing_hook.h"
 #include "components/udf/hooks/get_values_hook.h"
 #include "components/udf/hooks/logging_hook.h"
 #include "components/udf/hooks/run_query_hook.h"
+#include "components/udf/hooks/udf_cache_hook.h"
 #include "src/roma/config/config.h"
 #include "src/roma/config/function_binding_object_v2.h"
 #include "src/roma/interface/roma.h"
@@ -37,7 +39,14 @@ using google::scp::roma::FunctionBindingPayload;
 
 constexpr char kStringGetValuesHookJsName[] = "getValues";
 constexpr char kBinaryGetValuesHookJsName[] = "getValuesBinary";
+constexpr char kGroupedGetValuesHookJsName[] = "getValuesGrouped";
+constexpr char kPrefixGetValuesHookJsName[] = "getValuesByPrefix";
 constexpr char kRunQueryHookJsName[] = "runQuery";
+constexpr char kBinaryRunQueryHookJsName[] = "runQueryBinary";
+constexpr char kUInt32RunQueryHookJsName[] = "runSetQueryUInt32";
+constexpr char kGetKeysContainingHookJsName[] = "getKeysContaining";
+constexpr char kCacheGetHookJsName[] = "cacheGet";
+constexpr char kCachePutHookJsName[] = "cachePut";
 
 std::unique_ptr<FunctionBindingObjectV2<RequestContext>>
 GetValuesFunctionObject(GetValuesHook& get_values_hook,
@@ -52,6 +61,18 @@ GetValuesFunctionObject(GetValuesHook& get_values_hook,
   return get_values_function_object;
 }
 
+std::unique_ptr<FunctionBindingObjectV2<RequestContext>>
+RunQueryFunctionObject(RunQueryHook& run_query_hook, std::string handler_name) {
+  auto run_query_function_object =
+      std::make_unique<FunctionBindingObjectV2<RequestContext>>();
+  run_query_function_object->function_name = std::move(handler_name);
+  run_query_function_object->function =
+      [&run_query_hook](FunctionBindingPayload<RequestContext>& in) {
+        run_query_hook(in);
+      };
+  return run_query_function_object;
+}
+
 }  // namespace
 
 UdfConfigBuilder& UdfConfigBuilder::RegisterStringGetValuesHook(
@@ -68,16 +89,84 @@ UdfConfigBuilder& UdfConfigBuilder::RegisterBinaryGetValuesHook(
   return *this;
 }
 
+UdfConfigBuilder& UdfConfigBuilder::RegisterGroupedGetValuesHook(
+    GetValuesHook& get_values_hook) {
+  auto function_object =
+      std::make_unique<FunctionBindingObjectV2<RequestContext>>();
+  function_object->function_name = kGroupedGetValuesHookJsName;
+  function_object->function =
+      [&get_values_hook](FunctionBindingPayload<RequestContext>& in) {
+        get_values_hook.GetGroupedValues(in);
+      };
+  config_.RegisterFunctionBinding(std::move(function_object));
+  return *this;
+}
+
+UdfConfigBuilder& UdfConfigBuilder::RegisterPrefixGetValuesHook(
+    GetValuesHook& get_values_hook) {
+  auto function_object =
+      std::make_unique<FunctionBindingObjectV2<RequestContext>>();
+  function_object->function_name = kPrefixGetValuesHookJsName;
+  function_object->function =
+      [&get_values_hook](FunctionBindingPayload<RequestContext>& in) {
+        get_values_hook.GetValuesByPrefix(in);
+      };
+  config_.RegisterFunctionBinding(std::move(function_object));
+  return *this;
+}
+
 UdfConfigBuilder& UdfConfigBuilder::RegisterRunQueryHook(
     RunQueryHook& run_query_hook) {
-  auto run_query_function_object =
+  config_.RegisterFunctionBinding(
+      RunQueryFunctionObject(run_query_hook, kRunQueryHookJsName));
+  return *this;
+}
+
+UdfConfigBuilder& UdfConfigBuilder::RegisterBinaryRunQueryHook(
+    RunQueryHook& run_query_hook) {
+  config_.RegisterFunctionBinding(
+      RunQueryFunctionObject(run_query_hook, kBinaryRunQueryHookJsName));
+  return *this;
+}
+
+UdfConfigBuilder& UdfConfigBuilder::RegisterUInt32RunQueryHook(
+    RunQueryHook& run_query_hook) {
+  config_.RegisterFunctionBinding(
+      RunQueryFunctionObject(run_query_hook, kUInt32RunQueryHookJsName));
+  return *this;
+}
+
+UdfConfigBuilder& UdfConfigBuilder::RegisterGetKeysContainingHook(
+    GetKeysContainingHook& get_keys_containing_hook) {
+  auto function_object =
       std::make_unique<FunctionBindingObjectV2<RequestContext>>();
-  run_query_function_object->function_name = kRunQueryHookJsName;
-  run_query_function_object->function =
-      [&run_query_hook](FunctionBindingPayload<RequestContext>& in) {
-        run_query_hook(in);
+  function_object->function_name = kGetKeysContainingHookJsName;
+  function_object->function =
+      [&get_keys_containing_hook](FunctionBindingPayload<RequestContext>& in) {
+        get_keys_containing_hook(in);
+      };
+  config_.RegisterFunctionBinding(std::move(function_object));
+  return *this;
+}
+
+UdfConfigBuilder& UdfConfigBuilder::RegisterCacheHook(
+    UdfCacheHook& cache_hook) {
+  auto get_function_object =
+      std::make_unique<FunctionBindingObjectV2<RequestContext>>();
+  get_function_object->function_name = kCacheGetHookJsName;
+  get_function_object->function =
+      [&cache_hook](FunctionBindingPayload<RequestContext>& in) {
+        cache_hook.Get(in);
+      };
+  config_.RegisterFunctionBinding(std::move(get_function_object));
+  auto put_function_object =
+      std::make_unique<FunctionBindingObjectV2<RequestContext>>();
+  put_function_object->function_name = kCachePutHookJsName;
+  put_function_object->function =
+      [&cache_hook](FunctionBindingPayload<RequestContext>& in) {
+        cache_hook.Put(in);
       };
-  config_.RegisterFunctionBinding(std::move(run_query_function_object));
+  config_.RegisterFunctionBinding(std::move(put_function_object));
   return *this;
 }
 
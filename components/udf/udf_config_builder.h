@@ -15,8 +15,10 @@
  */
 #include <memory>
 
+#include "components/udf/hooks/get_keys_containing_hook.h"
 #include "components/udf/hooks/get_values_hook.h"
 #include "components/udf/hooks/run_query_hook.h"
+#include "components/udf/hooks/udf_cache_hook.h"
 #include "src/roma/config/config.h"
 
 namespace kv_server {
@@ -27,8 +29,25 @@ class UdfConfigBuilder {
 
   UdfConfigBuilder& RegisterBinaryGetValuesHook(GetValuesHook& get_values_hook);
 
+  // Registers `getValuesGrouped`, see `GetValuesHook::GetGroupedValues`.
+  UdfConfigBuilder& RegisterGroupedGetValuesHook(
+      GetValuesHook& get_values_hook);
+
+  // Registers `getValuesByPrefix`, see `GetValuesHook::GetValuesByPrefix`.
+  UdfConfigBuilder& RegisterPrefixGetValuesHook(GetValuesHook& get_values_hook);
+
   UdfConfigBuilder& RegisterRunQueryHook(RunQueryHook& run_query_hook);
 
+  UdfConfigBuilder& RegisterBinaryRunQueryHook(RunQueryHook& run_query_hook);
+
+  UdfConfigBuilder& RegisterUInt32RunQueryHook(RunQueryHook& run_query_hook);
+
+  UdfConfigBuilder& RegisterGetKeysContainingHook(
+      GetKeysContainingHook& get_keys_containing_hook);
+
+  // Registers `cacheGet` and `cachePut`.
+  UdfConfigBuilder& RegisterCacheHook(UdfCacheHook& cache_hook);
+
   UdfConfigBuilder& RegisterLoggingFunction();
 
   UdfConfigBuilder& SetNumberOfWorkers(int number_of_workers);
@@ -0,0 +1,114 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/util/executor.h"
+
+#include <utility>
+#include <vector>
+
+#include "absl/time/clock.h"
+
+namespace kv_server {
+
+Executor::Executor(int num_threads)
+    : thread_pool_(std::make_unique<ThreadPool>(num_threads)),
+      timer_thread_(&Executor::TimerLoop, this) {}
+
+Executor::~Executor() {
+  {
+    absl::MutexLock lock(&timer_mutex_);
+    stopping_ = true;
+  }
+  timer_thread_.join();
+  thread_pool_.reset();
+}
+
+void Executor::Schedule(std::string_view queue,
+                        absl::AnyInvocable<void() &&> task) {
+  thread_pool_->Schedule(
+      [this, queue = std::string(queue), task = std::move(task)]() mutable {
+        const absl::Time start = absl::Now();
+        std::move(task)();
+        const absl::Duration run_time = absl::Now() - start;
+        absl::MutexLock lock(&stats_mutex_);
+        QueueStats& stats = stats_[queue];
+        stats.tasks_run++;
+        stats.run_time += run_time;
+      });
+}
+
+Executor::TimerId Executor::ScheduleAfter(std::string_view queue,
+                                          absl::Duration delay,
+                                          absl::AnyInvocable<void() &&> task) {
+  const absl::Time due_time = absl::Now() + delay;
+  absl::MutexLock lock(&timer_mutex_);
+  const TimerId timer_id = next_timer_id_++;
+  if (timers_.empty() || due_time < timers_.begin()->first.first) {
+    timers_changed_ = true;
+  }
+  timers_.emplace(std::make_pair(due_time, timer_id),
+                  Timer{.queue = std::string(queue), .task = std::move(task)});
+  timer_due_times_.emplace(timer_id, due_time);
+  return timer_id;
+}
+
+bool Executor::Cancel(TimerId timer_id) {
+  absl::MutexLock lock(&timer_mutex_);
+  const auto iter = timer_due_times_.find(timer_id);
+  if (iter == timer_due_times_.end()) {
+    return false;
+  }
+  timers_.erase(std::make_pair(iter->second, timer_id));
+  timer_due_times_.erase(iter);
+  return true;
+}
+
+absl::flat_hash_map<std::string, Executor::QueueStats> Executor::Stats()
+    const {
+  absl::MutexLock lock(&stats_mutex_);
+  return stats_;
+}
+
+void Executor::TimerLoop() {
+  absl::MutexLock lock(&timer_mutex_);
+  while (true) {
+    // Schedules the timers that are due, including on the last iteration.
+    const absl::Time now = absl::Now();
+    std::vector<Timer> due_timers;
+    while (!timers_.empty() && timers_.begin()->first.first <= now) {
+      auto node = timers_.extract(timers_.begin());
+      timer_due_times_.erase(node.key().second);
+      due_timers.push_back(std::move(node.mapped()));
+    }
+    for (Timer& timer : due_timers) {
+      Schedule(timer.queue, std::move(timer.task));
+    }
+    if (stopping_) {
+      return;
+    }
+    timers_changed_ = false;
+    const absl::Time deadline =
+        timers_.empty() ? absl::InfiniteFuture() : timers_.begin()->first.first;
+    timer_mutex_.AwaitWithDeadline(
+        absl::Condition(
+            +[](Executor* executor) ABSL_EXCLUSIVE_LOCKS_REQUIRED(
+                 executor->timer_mutex_) {
+              return executor->stopping_ || executor->timers_changed_;
+            },
+            this),
+        deadline);
+  }
+}
+
+}  // namespace kv_server
@@ -0,0 +1,109 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef COMPONENTS_UTIL_EXECUTOR_H_
+#define COMPONENTS_UTIL_EXECUTOR_H_
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/functional/any_invocable.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "components/util/thread_pool.h"
+
+namespace kv_server {
+
+// Runs the background tasks of several components on one fixed set of
+// threads, rather than on a thread per component. Tasks are scheduled on
+// named queues, whose counts and run times are tracked so that the
+// utilization of the threads is observable in one place. Delayed tasks wait
+// on a single timer thread until they are due.
+//
+// Tasks hold a thread while they run, so must not block for long. Safe to use
+// from multiple threads.
+class Executor {
+ public:
+  using TimerId = int64_t;
+
+  struct QueueStats {
+    int64_t tasks_run = 0;
+    absl::Duration run_time = absl::ZeroDuration();
+  };
+
+  explicit Executor(int num_threads);
+
+  // Drops the delayed tasks that are not due yet, runs the tasks that are,
+  // then joins the threads.
+  ~Executor();
+
+  Executor(const Executor&) = delete;
+  Executor& operator=(const Executor&) = delete;
+
+  void Schedule(std::string_view queue, absl::AnyInvocable<void() &&> task)
+      ABSL_LOCKS_EXCLUDED(stats_mutex_);
+
+  // Schedules `task` on `queue` once `delay` has passed. Returns an id to
+  // cancel it with.
+  TimerId ScheduleAfter(std::string_view queue, absl::Duration delay,
+                        absl::AnyInvocable<void() &&> task)
+      ABSL_LOCKS_EXCLUDED(timer_mutex_);
+
+  // Returns true if the task of `timer_id` was not due yet and won't run.
+  bool Cancel(TimerId timer_id) ABSL_LOCKS_EXCLUDED(timer_mutex_);
+
+  // Returns the stats of every queue since construction.
+  absl::flat_hash_map<std::string, QueueStats> Stats() const
+      ABSL_LOCKS_EXCLUDED(stats_mutex_);
+
+ private:
+  struct Timer {
+    std::string queue;
+    absl::AnyInvocable<void() &&> task;
+  };
+
+  void TimerLoop() ABSL_LOCKS_EXCLUDED(timer_mutex_);
+
+  mutable absl::Mutex stats_mutex_;
+  absl::flat_hash_map<std::string, QueueStats> stats_
+      ABSL_GUARDED_BY(stats_mutex_);
+
+  absl::Mutex timer_mutex_;
+  // Ordered by due time, then id.
+  std::map<std::pair<absl::Time, TimerId>, Timer> timers_
+      ABSL_GUARDED_BY(timer_mutex_);
+  absl::flat_hash_map<TimerId, absl::Time> timer_due_times_
+      ABSL_GUARDED_BY(timer_mutex_);
+  TimerId next_timer_id_ ABSL_GUARDED_BY(timer_mutex_) = 0;
+  // Set when a timer due before the ones waited for is scheduled.
+  bool timers_changed_ ABSL_GUARDED_BY(timer_mutex_) = false;
+  bool stopping_ ABSL_GUARDED_BY(timer_mutex_) = false;
+
+  // Reset once the timer thread is joined, which runs the queued tasks.
+  std::unique_ptr<ThreadPool> thread_pool_;
+  std::thread timer_thread_;
+};
+
+}  // namespace kv_server
+
+#endif  // COMPONENTS_UTIL_EXECUTOR_H_
@@ -0,0 +1,102 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/util/executor.h"
+
+#include <atomic>
+
+#include "absl/synchronization/notification.h"
+#include "absl/time/clock.h"
+#include "gtest/gtest.h"
+
+namespace kv_server {
+namespace {
+
+TEST(ExecutorTest, RunsScheduledTasks) {
+  std::atomic<int> count = 0;
+  {
+    Executor executor(/*num_threads=*/2);
+    for (int i = 0; i < 100; i++) {
+      executor.Schedule("queue", [&count] { count++; });
+    }
+  }
+  EXPECT_EQ(count, 100);
+}
+
+TEST(ExecutorTest, CountsTasksPerQueue) {
+  Executor executor(/*num_threads=*/2);
+  absl::Notification first_done;
+  absl::Notification second_done;
+  executor.Schedule("first", [] {});
+  executor.Schedule("first", [&first_done] { first_done.Notify(); });
+  executor.Schedule("second", [&second_done] { second_done.Notify(); });
+  first_done.WaitForNotification();
+  second_done.WaitForNotification();
+  // The stats are updated once the tasks return.
+  while (true) {
+    const auto stats = executor.Stats();
+    if (stats.contains("first") && stats.at("first").tasks_run == 2 &&
+        stats.contains("second") && stats.at("second").tasks_run == 1) {
+      break;
+    }
+    absl::SleepFor(absl::Milliseconds(1));
+  }
+}
+
+TEST(ExecutorTest, RunsDelayedTasksOnceDue) {
+  Executor executor(/*num_threads=*/1);
+  absl::Notification done;
+  constexpr absl::Duration delay = absl::Milliseconds(20);
+  const absl::Time start = absl::Now();
+  absl::Time run_time;
+  executor.ScheduleAfter("queue", delay, [&run_time, &done] {
+    run_time = absl::Now();
+    done.Notify();
+  });
+  done.WaitForNotification();
+  EXPECT_GE(run_time - start, delay);
+}
+
+TEST(ExecutorTest, RunsEarlierTimerScheduledLater) {
+  Executor executor(/*num_threads=*/1);
+  absl::Notification done;
+  executor.ScheduleAfter("queue", absl::Hours(1), [] {});
+  executor.ScheduleAfter("queue", absl::Milliseconds(1),
+                         [&done] { done.Notify(); });
+  EXPECT_TRUE(done.WaitForNotificationWithTimeout(absl::Seconds(10)));
+}
+
+TEST(ExecutorTest, CancelsTimer) {
+  bool ran = false;
+  {
+    Executor executor(/*num_threads=*/1);
+    const Executor::TimerId timer_id =
+        executor.ScheduleAfter("queue", absl::Hours(1), [&ran] { ran = true; });
+    EXPECT_TRUE(executor.Cancel(timer_id));
+    EXPECT_FALSE(executor.Cancel(timer_id));
+  }
+  EXPECT_FALSE(ran);
+}
+
+TEST(ExecutorTest, DropsTimersNotDueOnDestruction) {
+  bool ran = false;
+  {
+    Executor executor(/*num_threads=*/1);
+    executor.ScheduleAfter("queue", absl::Hours(1), [&ran] { ran = true; });
+  }
+  EXPECT_FALSE(ran);
+}
+
+}  // namespace
+}  // namespace kv_server
@@ -0,0 +1,64 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/util/lock_profiler.h"
+
+#include "components/telemetry/server_definition.h"
+
+namespace kv_server {
+namespace {
+
+template <const auto& kWaitDefinition, const auto& kHoldDefinition>
+void LogLockTimes(absl::Duration wait, absl::Duration hold) {
+  LogIfError(KVServerContextMap()->SafeMetric().LogHistogram<kWaitDefinition>(
+      absl::ToDoubleMicroseconds(wait)));
+  LogIfError(KVServerContextMap()->SafeMetric().LogHistogram<kHoldDefinition>(
+      absl::ToDoubleMicroseconds(hold)));
+}
+
+}  // namespace
+
+std::atomic<bool> LockProfiler::enabled_ = false;
+
+void LockProfiler::Record(LockSite site, absl::Duration wait,
+                          absl::Duration hold) {
+  switch (site) {
+    case LockSite::kCacheKeyMap:
+      LogLockTimes<kCacheKeyMapLockWaitTime, kCacheKeyMapLockHoldTime>(wait,
+                                                                       hold);
+      break;
+    case LockSite::kCacheSetMap:
+      LogLockTimes<kCacheSetMapLockWaitTime, kCacheSetMapLockHoldTime>(wait,
+                                                                       hold);
+      break;
+    case LockSite::kCacheValueSet:
+      LogLockTimes<kCacheValueSetLockWaitTime, kCacheValueSetLockHoldTime>(
+          wait, hold);
+      break;
+    case LockSite::kShardManager:
+      LogLockTimes<kShardManagerLockWaitTime, kShardManagerLockHoldTime>(
+          wait, hold);
+      break;
+    case LockSite::kDeltaFileQueue:
+      LogLockTimes<kDeltaFileQueueLockWaitTime, kDeltaFileQueueLockHoldTime>(
+          wait, hold);
+      break;
+    case LockSite::kRealtimeCoalescer:
+      LogLockTimes<kRealtimeCoalescerLockWaitTime,
+                   kRealtimeCoalescerLockHoldTime>(wait, hold);
+      break;
+  }
+}
+
+}  // namespace kv_server
@@ -0,0 +1,133 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef COMPONENTS_UTIL_LOCK_PROFILER_H_
+#define COMPONENTS_UTIL_LOCK_PROFILER_H_
+
+#include <atomic>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+
+namespace kv_server {
+
+// Locks whose contention can be profiled.
+enum class LockSite {
+  // `KeyValueCache` map of keys to values.
+  kCacheKeyMap,
+  // `KeyValueCache` map of keys to value sets.
+  kCacheSetMap,
+  // `KeyValueCache` stripes of the value sets.
+  kCacheValueSet,
+  // Latency tracking of the remote lookup clients of `ShardManager`.
+  kShardManager,
+  // Queue of the delta files found by the delta file notifier.
+  kDeltaFileQueue,
+  // Pending mutations of the realtime update coalescer.
+  kRealtimeCoalescer,
+};
+
+// Records how long locks wait to be acquired and how long they are held, as
+// histograms by lock site. Disabled by default, in which case profiled locks
+// cost one relaxed atomic load more than plain ones.
+class LockProfiler {
+ public:
+  static void SetEnabled(bool enabled) {
+    enabled_.store(enabled, std::memory_order_relaxed);
+  }
+  static bool IsEnabled() { return enabled_.load(std::memory_order_relaxed); }
+
+  static void Record(LockSite site, absl::Duration wait, absl::Duration hold);
+
+ private:
+  static std::atomic<bool> enabled_;
+};
+
+// Same as `absl::MutexLock`, profiling the lock as `site`.
+class ABSL_SCOPED_LOCKABLE ProfiledMutexLock {
+ public:
+  ProfiledMutexLock(absl::Mutex* mu, LockSite site)
+      ABSL_EXCLUSIVE_LOCK_FUNCTION(mu)
+      : mu_(mu), site_(site) {
+    if (!LockProfiler::IsEnabled()) {
+      mu_->Lock();
+      return;
+    }
+    const absl::Time start = absl::Now();
+    mu_->Lock();
+    locked_ = absl::Now();
+    wait_ = locked_ - start;
+  }
+  ~ProfiledMutexLock() ABSL_UNLOCK_FUNCTION() {
+    if (locked_ == absl::InfinitePast()) {
+      mu_->Unlock();
+      return;
+    }
+    const absl::Duration hold = absl::Now() - locked_;
+    mu_->Unlock();
+    LockProfiler::Record(site_, wait_, hold);
+  }
+  ProfiledMutexLock(const ProfiledMutexLock&) = delete;
+  ProfiledMutexLock& operator=(const ProfiledMutexLock&) = delete;
+
+ private:
+  absl::Mutex* const mu_;
+  const LockSite site_;
+  // Infinite past unless profiled.
+  absl::Time locked_ = absl::InfinitePast();
+  absl::Duration wait_;
+};
+
+// Same as `absl::ReaderMutexLock`, profiling the lock as `site`.
+class ABSL_SCOPED_LOCKABLE ProfiledReaderMutexLock {
+ public:
+  ProfiledReaderMutexLock(absl::Mutex* mu, LockSite site)
+      ABSL_SHARED_LOCK_FUNCTION(mu)
+      : mu_(mu), site_(site) {
+    if (!LockProfiler::IsEnabled()) {
+      mu_->ReaderLock();
+      return;
+    }
+    const absl::Time start = absl::Now();
+    mu_->ReaderLock();
+    locked_ = absl::Now();
+    wait_ = locked_ - start;
+  }
+  ~ProfiledReaderMutexLock() ABSL_UNLOCK_FUNCTION() {
+    if (locked_ == absl::InfinitePast()) {
+      mu_->ReaderUnlock();
+      return;
+    }
+    const absl::Duration hold = absl::Now() - locked_;
+    mu_->ReaderUnlock();
+    LockProfiler::Record(site_, wait_, hold);
+  }
+  ProfiledReaderMutexLock(const ProfiledReaderMutexLock&) = delete;
+  ProfiledReaderMutexLock& operator=(const ProfiledReaderMutexLock&) = delete;
+
+ private:
+  absl::Mutex* const mu_;
+  const LockSite site_;
+  // Infinite past unless profiled.
+  absl::Time locked_ = absl::InfinitePast();
+  absl::Duration wait_;
+};
+
+}  // namespace kv_server
+
+#endif  // COMPONENTS_UTIL_LOCK_PROFILER_H_
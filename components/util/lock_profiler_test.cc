@@ -0,0 +1,63 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/util/lock_profiler.h"
+
+#include "absl/synchronization/mutex.h"
+#include "components/telemetry/server_definition.h"
+#include "gtest/gtest.h"
+
+namespace kv_server {
+namespace {
+
+class LockProfilerTest : public ::testing::TestWithParam<bool> {
+ protected:
+  void SetUp() override {
+    InitMetricsContextMap();
+    LockProfiler::SetEnabled(GetParam());
+  }
+  void TearDown() override { LockProfiler::SetEnabled(false); }
+};
+
+INSTANTIATE_TEST_SUITE_P(Enabled, LockProfilerTest, ::testing::Bool());
+
+TEST_P(LockProfilerTest, MutexLockHoldsLockInScope) {
+  absl::Mutex mutex;
+  {
+    ProfiledMutexLock lock(&mutex, LockSite::kCacheKeyMap);
+    mutex.AssertHeld();
+  }
+  EXPECT_TRUE(mutex.TryLock());
+  mutex.Unlock();
+}
+
+TEST_P(LockProfilerTest, ReaderMutexLockHoldsSharedLockInScope) {
+  absl::Mutex mutex;
+  {
+    ProfiledReaderMutexLock lock(&mutex, LockSite::kCacheSetMap);
+    mutex.AssertReaderHeld();
+    EXPECT_TRUE(mutex.ReaderTryLock());
+    mutex.ReaderUnlock();
+    EXPECT_FALSE(mutex.TryLock());
+  }
+  EXPECT_TRUE(mutex.TryLock());
+  mutex.Unlock();
+}
+
+TEST(LockProfilerEnabledTest, IsDisabledByDefault) {
+  EXPECT_FALSE(LockProfiler::IsEnabled());
+}
+
+}  // namespace
+}  // namespace kv_server
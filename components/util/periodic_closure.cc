@@ -14,9 +14,12 @@
 
 #include "components/util/periodic_closure.h"
 
+#include <string>
 #include <thread>
 #include <utility>
 
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
 #include "absl/synchronization/notification.h"
 
 namespace kv_server {
@@ -69,8 +72,110 @@ class PeriodicClosureImpl : public PeriodicClosure {
   std::unique_ptr<std::thread> thread_;
   absl::Notification notification_;
 };
+
+// Runs the closure as tasks of an executor. Every run schedules the next one
+// `interval` after it finishes, like the thread of `PeriodicClosureImpl`.
+class ExecutorPeriodicClosure : public PeriodicClosure {
+ public:
+  ExecutorPeriodicClosure(Executor& executor, std::string queue)
+      : executor_(executor), queue_(std::move(queue)) {}
+
+  ~ExecutorPeriodicClosure() { Stop(); }
+
+  absl::Status StartNow(absl::Duration interval,
+                        std::function<void()> closure) override {
+    return StartInternal(interval, /*run_first=*/true, std::move(closure));
+  }
+
+  absl::Status StartDelayed(absl::Duration interval,
+                            std::function<void()> closure) override {
+    return StartInternal(interval, /*run_first=*/false, std::move(closure));
+  }
+
+  void Stop() override ABSL_LOCKS_EXCLUDED(mutex_) {
+    absl::MutexLock lock(&mutex_);
+    if (!started_ || stopped_) {
+      return;
+    }
+    stopped_ = true;
+    // A run that is already due can't be cancelled, so is waited for.
+    if (executor_.Cancel(timer_id_)) {
+      run_pending_ = false;
+    }
+    mutex_.Await(absl::Condition(
+        +[](ExecutorPeriodicClosure* closure)
+            ABSL_EXCLUSIVE_LOCKS_REQUIRED(closure->mutex_) {
+              return !closure->run_pending_ && !closure->closure_running_;
+            },
+        this));
+  }
+
+  bool IsRunning() const override ABSL_LOCKS_EXCLUDED(mutex_) {
+    absl::MutexLock lock(&mutex_);
+    return started_ && !stopped_;
+  }
+
+ private:
+  absl::Status StartInternal(absl::Duration interval, bool run_first,
+                             std::function<void()> closure)
+      ABSL_LOCKS_EXCLUDED(mutex_) {
+    absl::MutexLock lock(&mutex_);
+    if (stopped_) {
+      return absl::FailedPreconditionError("Already ran.");
+    }
+    if (started_) {
+      return absl::FailedPreconditionError("Already running.");
+    }
+    started_ = true;
+    interval_ = interval;
+    closure_ = std::move(closure);
+    ScheduleRun(run_first ? absl::ZeroDuration() : interval_);
+    return absl::OkStatus();
+  }
+
+  void ScheduleRun(absl::Duration delay) ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+    run_pending_ = true;
+    timer_id_ = executor_.ScheduleAfter(queue_, delay, [this] { Run(); });
+  }
+
+  void Run() ABSL_LOCKS_EXCLUDED(mutex_) {
+    {
+      absl::MutexLock lock(&mutex_);
+      run_pending_ = false;
+      if (stopped_) {
+        return;
+      }
+      closure_running_ = true;
+    }
+    closure_();
+    absl::MutexLock lock(&mutex_);
+    closure_running_ = false;
+    if (!stopped_) {
+      ScheduleRun(interval_);
+    }
+  }
+
+  Executor& executor_;
+  const std::string queue_;
+  mutable absl::Mutex mutex_;
+  bool started_ ABSL_GUARDED_BY(mutex_) = false;
+  bool stopped_ ABSL_GUARDED_BY(mutex_) = false;
+  // Set from scheduling a run until it starts.
+  bool run_pending_ ABSL_GUARDED_BY(mutex_) = false;
+  bool closure_running_ ABSL_GUARDED_BY(mutex_) = false;
+  Executor::TimerId timer_id_ ABSL_GUARDED_BY(mutex_) = -1;
+  absl::Duration interval_ ABSL_GUARDED_BY(mutex_);
+  // Only called by `Run`, after it is set.
+  std::function<void()> closure_;
+};
+
 }  // namespace
 std::unique_ptr<PeriodicClosure> PeriodicClosure::Create() {
   return std::make_unique<PeriodicClosureImpl>();
 }
+
+std::unique_ptr<PeriodicClosure> PeriodicClosure::Create(Executor& executor,
+                                                         std::string queue) {
+  return std::make_unique<ExecutorPeriodicClosure>(executor, std::move(queue));
+}
 }  // namespace kv_server
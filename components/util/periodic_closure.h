@@ -19,9 +19,11 @@
 
 #include <functional>
 #include <memory>
+#include <string>
 
 #include "absl/status/status.h"
 #include "absl/time/time.h"
+#include "components/util/executor.h"
 
 namespace kv_server {
 
@@ -44,6 +46,11 @@ class PeriodicClosure {
   virtual bool IsRunning() const = 0;
 
   static std::unique_ptr<PeriodicClosure> Create();
+
+  // Runs the closure on `executor`, in `queue`, rather than on a thread of
+  // its own. `executor` must outlive the returned closure.
+  static std::unique_ptr<PeriodicClosure> Create(Executor& executor,
+                                                 std::string queue);
 };
 }  // namespace kv_server
 
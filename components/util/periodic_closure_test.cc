@@ -14,6 +14,7 @@
 
 #include "components/util/periodic_closure.h"
 
+#include <atomic>
 #include <chrono>
 #include <thread>
 
@@ -115,5 +116,48 @@ TEST(PeriodicClosureTest, StartAfterStopped) {
   ASSERT_FALSE(periodic_closure->StartNow(absl::Milliseconds(1), []() {}).ok());
 }
 
+TEST(PeriodicClosureTest, RunsOnExecutor) {
+  Executor executor(/*num_threads=*/1);
+  std::unique_ptr<PeriodicClosure> periodic_closure =
+      PeriodicClosure::Create(executor, "queue");
+  absl::Notification notification;
+  std::atomic<int32_t> count = 0;
+  ASSERT_TRUE(periodic_closure
+                  ->StartNow(absl::Milliseconds(1),
+                             [&count, &notification]() {
+                               if (++count == 3) {
+                                 notification.Notify();
+                               }
+                             })
+                  .ok());
+  ASSERT_TRUE(periodic_closure->IsRunning());
+  notification.WaitForNotification();
+  periodic_closure->Stop();
+  ASSERT_FALSE(periodic_closure->IsRunning());
+  const int32_t stopped_count = count;
+  absl::SleepFor(absl::Milliseconds(10));
+  ASSERT_EQ(count, stopped_count);
+  ASSERT_FALSE(periodic_closure->StartNow(absl::Milliseconds(1), []() {}).ok());
+}
+
+TEST(PeriodicClosureTest, StopWaitsForClosureOnExecutor) {
+  Executor executor(/*num_threads=*/1);
+  std::unique_ptr<PeriodicClosure> periodic_closure =
+      PeriodicClosure::Create(executor, "queue");
+  absl::Notification started;
+  bool finished = false;
+  ASSERT_TRUE(periodic_closure
+                  ->StartNow(absl::Hours(1),
+                             [&started, &finished]() {
+                               started.Notify();
+                               absl::SleepFor(absl::Milliseconds(10));
+                               finished = true;
+                             })
+                  .ok());
+  started.WaitForNotification();
+  periodic_closure->Stop();
+  ASSERT_TRUE(finished);
+}
+
 }  // namespace
 }  // namespace kv_server
@@ -27,5 +27,23 @@ InternalLookupMetricsContext& RequestContext::GetInternalLookupMetricsContext()
     const {
   return internal_lookup_metrics_context_;
 }
+absl::Time RequestContext::GetDeadline() const { return deadline_; }
+void RequestContext::SetDeadline(absl::Time deadline) { deadline_ = deadline; }
+RequestLookupCache& RequestContext::GetLookupCache() const {
+  return *lookup_cache_;
+}
+void RequestContext::SetTrace(std::shared_ptr<RequestTrace> trace) {
+  trace_ = std::move(trace);
+}
+int64_t RequestContext::GetUdfCodeCommitTime() const {
+  return udf_code_commit_time_;
+}
+void RequestContext::SetUdfCodeCommitTime(int64_t logical_commit_time) {
+  udf_code_commit_time_ = logical_commit_time;
+}
+int64_t RequestContext::GetUdfCodeVersion() const { return udf_code_version_; }
+void RequestContext::SetUdfCodeVersion(int64_t version) {
+  udf_code_version_ = version;
+}
 
 }  // namespace kv_server
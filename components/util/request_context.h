@@ -17,18 +17,21 @@
 #ifndef COMPONENTS_UTIL_REQUEST_CONTEXT_H_
 #define COMPONENTS_UTIL_REQUEST_CONTEXT_H_
 
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <utility>
 
+#include "absl/time/time.h"
+#include "components/internal_server/request_lookup_cache.h"
+#include "components/telemetry/request_trace.h"
 #include "components/telemetry/server_definition.h"
 
 namespace kv_server {
 
 // RequestContext holds the reference of udf request metrics context and
 // internal lookup request context that ties to a single
-// request. The request_id can be either passed from upper stream or assigned
-// from uuid generated when RequestContext is constructed.
+// request.
 
 class RequestContext {
  public:
@@ -36,15 +39,46 @@ class RequestContext {
       : udf_request_metrics_context_(
             metrics_context.GetUdfRequestMetricsContext()),
         internal_lookup_metrics_context_(
-            metrics_context.GetInternalLookupMetricsContext()) {}
+            metrics_context.GetInternalLookupMetricsContext()),
+        metrics_batch_(metrics_context.GetMetricsBatch()) {}
   UdfRequestMetricsContext& GetUdfRequestMetricsContext() const;
   InternalLookupMetricsContext& GetInternalLookupMetricsContext() const;
+  // Counters that lookups update many times per request, added to the
+  // metrics contexts once the request ends.
+  RequestMetricsBatch& GetMetricsBatch() const { return metrics_batch_; }
+  // Time by which lookups made for the request should have finished.
+  // Infinite future, unless set.
+  absl::Time GetDeadline() const;
+  void SetDeadline(absl::Time deadline);
+  // Results of the lookups and of the UDF queries made for the request, which
+  // later lookups of the same keys return. Shared by the copies of the
+  // request context.
+  RequestLookupCache& GetLookupCache() const;
+  // Trace that records the stages of the request, if it is sampled, or
+  // nullptr. Shared by the copies of the request context.
+  const RequestTrace* GetTrace() const { return trace_.get(); }
+  void SetTrace(std::shared_ptr<RequestTrace> trace);
+  // Logical commit time of the UDF code object that the request executes, or
+  // -1 outside of UDF executions.
+  int64_t GetUdfCodeCommitTime() const;
+  void SetUdfCodeCommitTime(int64_t logical_commit_time);
+  // Version of the UDF code object that the request executes, or -1 outside
+  // of UDF executions. Hooks account their usage to it.
+  int64_t GetUdfCodeVersion() const;
+  void SetUdfCodeVersion(int64_t version);
 
   ~RequestContext() = default;
 
  private:
   UdfRequestMetricsContext& udf_request_metrics_context_;
   InternalLookupMetricsContext& internal_lookup_metrics_context_;
+  RequestMetricsBatch& metrics_batch_;
+  absl::Time deadline_ = absl::InfiniteFuture();
+  std::shared_ptr<RequestLookupCache> lookup_cache_ =
+      RequestLookupCache::Acquire();
+  std::shared_ptr<RequestTrace> trace_;
+  int64_t udf_code_commit_time_ = -1;
+  int64_t udf_code_version_ = -1;
 };
 
 }  // namespace kv_server
@@ -0,0 +1,169 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/util/thread_placement.h"
+
+#include <linux/mempolicy.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <climits>
+#include <cstring>
+
+#include "absl/strings/ascii.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_split.h"
+
+namespace kv_server {
+namespace {
+
+// Number of NUMA nodes that node masks hold.
+constexpr int kMaxNumaNodes = 1024;
+constexpr int kBitsPerMaskWord = sizeof(unsigned long) * CHAR_BIT;
+
+using NodeMask = unsigned long[kMaxNumaNodes / kBitsPerMaskWord];
+
+absl::Status ErrnoStatus(std::string_view operation) {
+  return absl::InternalError(
+      absl::StrCat(operation, " failed: ", std::strerror(errno)));
+}
+
+absl::StatusOr<int> ParseCpu(std::string_view cpu, std::string_view cpu_list) {
+  int result;
+  if (!absl::SimpleAtoi(cpu, &result) || result < 0 || result >= CPU_SETSIZE) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("Invalid CPU \"", cpu, "\" in CPU list: ", cpu_list));
+  }
+  return result;
+}
+
+absl::Status SetMemoryPolicy(MemoryPolicy policy) {
+  switch (policy) {
+    case MemoryPolicy::kLocal:
+      if (syscall(SYS_set_mempolicy, MPOL_DEFAULT, nullptr, 0) != 0) {
+        return ErrnoStatus("set_mempolicy");
+      }
+      return absl::OkStatus();
+    case MemoryPolicy::kInterleave: {
+      NodeMask nodes = {};
+      // Interleaves over the nodes that the process may allocate on.
+      if (syscall(SYS_get_mempolicy, nullptr, nodes, kMaxNumaNodes, nullptr,
+                  MPOL_F_MEMS_ALLOWED) != 0) {
+        return ErrnoStatus("get_mempolicy");
+      }
+      if (syscall(SYS_set_mempolicy, MPOL_INTERLEAVE, nodes, kMaxNumaNodes) !=
+          0) {
+        return ErrnoStatus("set_mempolicy");
+      }
+      return absl::OkStatus();
+    }
+  }
+  return absl::InvalidArgumentError("Unknown memory policy");
+}
+
+}  // namespace
+
+absl::StatusOr<std::vector<int>> ParseCpuList(std::string_view cpu_list) {
+  std::vector<int> cpus;
+  for (std::string_view range :
+       absl::StrSplit(cpu_list, ',', absl::SkipWhitespace())) {
+    std::vector<std::string_view> bounds =
+        absl::StrSplit(range, absl::MaxSplits('-', 1));
+    const auto first = ParseCpu(absl::StripAsciiWhitespace(bounds[0]),
+                                cpu_list);
+    if (!first.ok()) {
+      return first.status();
+    }
+    const auto last =
+        bounds.size() == 1
+            ? first
+            : ParseCpu(absl::StripAsciiWhitespace(bounds[1]), cpu_list);
+    if (!last.ok()) {
+      return last.status();
+    }
+    if (*last < *first) {
+      return absl::InvalidArgumentError(
+          absl::StrCat("Invalid CPU range \"", range, "\" in CPU list: ",
+                       cpu_list));
+    }
+    for (int cpu = *first; cpu <= *last; cpu++) {
+      cpus.push_back(cpu);
+    }
+  }
+  return cpus;
+}
+
+absl::StatusOr<MemoryPolicy> ParseMemoryPolicy(std::string_view policy) {
+  if (policy.empty() || policy == "local") {
+    return MemoryPolicy::kLocal;
+  }
+  if (policy == "interleave") {
+    return MemoryPolicy::kInterleave;
+  }
+  return absl::InvalidArgumentError(
+      absl::StrCat("Unknown memory policy: ", policy));
+}
+
+absl::StatusOr<ThreadPlacement> GetCurrentThreadPlacement() {
+  ThreadPlacement placement;
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  if (sched_getaffinity(0, sizeof(cpu_set), &cpu_set) != 0) {
+    return ErrnoStatus("sched_getaffinity");
+  }
+  for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+    if (CPU_ISSET(cpu, &cpu_set)) {
+      placement.cpus.push_back(cpu);
+    }
+  }
+  int mode;
+  NodeMask nodes = {};
+  if (syscall(SYS_get_mempolicy, &mode, nodes, kMaxNumaNodes, nullptr, 0) !=
+      0) {
+    return ErrnoStatus("get_mempolicy");
+  }
+  switch (mode & ~MPOL_MODE_FLAGS) {
+    case MPOL_DEFAULT:
+    case MPOL_LOCAL:
+      placement.memory_policy = MemoryPolicy::kLocal;
+      break;
+    case MPOL_INTERLEAVE:
+      placement.memory_policy = MemoryPolicy::kInterleave;
+      break;
+    default:
+      return absl::UnimplementedError(
+          absl::StrCat("Unsupported memory policy mode: ", mode));
+  }
+  return placement;
+}
+
+absl::Status SetCurrentThreadPlacement(const ThreadPlacement& placement) {
+  if (!placement.cpus.empty()) {
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    for (int cpu : placement.cpus) {
+      CPU_SET(cpu, &cpu_set);
+    }
+    // With pid 0, only the calling thread is pinned, not the whole process.
+    if (sched_setaffinity(0, sizeof(cpu_set), &cpu_set) != 0) {
+      return ErrnoStatus("sched_setaffinity");
+    }
+  }
+  return SetMemoryPolicy(placement.memory_policy);
+}
+
+}  // namespace kv_server
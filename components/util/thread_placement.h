@@ -0,0 +1,63 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef COMPONENTS_UTIL_THREAD_PLACEMENT_H_
+#define COMPONENTS_UTIL_THREAD_PLACEMENT_H_
+
+#include <string_view>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+
+namespace kv_server {
+
+// NUMA policy of the memory that a thread allocates.
+enum class MemoryPolicy {
+  // On the NUMA node of the allocating CPU, the system default.
+  kLocal,
+  // Interleaved over all NUMA nodes, page by page.
+  kInterleave,
+};
+
+// CPUs a thread runs on and the NUMA policy of its memory. Linux threads
+// inherit both from the thread that creates them, so placing a thread places
+// the threads it creates afterwards too.
+struct ThreadPlacement {
+  // CPUs the thread may run on. Left unchanged if empty.
+  std::vector<int> cpus;
+  MemoryPolicy memory_policy = MemoryPolicy::kLocal;
+};
+
+// Parses a list of CPUs in the format of `taskset -c`, e.g. "0-15,32-47".
+// Returns an empty list for an empty string.
+absl::StatusOr<std::vector<int>> ParseCpuList(std::string_view cpu_list);
+
+// Parses "local" or "interleave", and "" as "local".
+absl::StatusOr<MemoryPolicy> ParseMemoryPolicy(std::string_view policy);
+
+// Returns the placement of the calling thread. Fails if the thread has a
+// memory policy other than the ones of `MemoryPolicy`.
+absl::StatusOr<ThreadPlacement> GetCurrentThreadPlacement();
+
+// Places the calling thread. The memory policy only applies to pages the
+// thread faults in afterwards, memory that the allocator already holds stays
+// where it is.
+absl::Status SetCurrentThreadPlacement(const ThreadPlacement& placement);
+
+}  // namespace kv_server
+
+#endif  // COMPONENTS_UTIL_THREAD_PLACEMENT_H_
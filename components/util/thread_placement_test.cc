@@ -0,0 +1,81 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/util/thread_placement.h"
+
+#include <thread>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace kv_server {
+namespace {
+
+using testing::ElementsAre;
+using testing::IsEmpty;
+
+TEST(ThreadPlacementTest, ParseCpuList) {
+  auto cpus = ParseCpuList("0-3, 8,10-11");
+  ASSERT_TRUE(cpus.ok()) << cpus.status();
+  EXPECT_THAT(*cpus, ElementsAre(0, 1, 2, 3, 8, 10, 11));
+}
+
+TEST(ThreadPlacementTest, ParseCpuList_Empty) {
+  auto cpus = ParseCpuList("");
+  ASSERT_TRUE(cpus.ok()) << cpus.status();
+  EXPECT_THAT(*cpus, IsEmpty());
+}
+
+TEST(ThreadPlacementTest, ParseCpuList_Invalid) {
+  for (const auto* cpu_list : {"a", "-1", "3-1", "1-", "0-100000"}) {
+    EXPECT_EQ(ParseCpuList(cpu_list).status().code(),
+              absl::StatusCode::kInvalidArgument)
+        << cpu_list;
+  }
+}
+
+TEST(ThreadPlacementTest, ParseMemoryPolicy) {
+  EXPECT_EQ(*ParseMemoryPolicy(""), MemoryPolicy::kLocal);
+  EXPECT_EQ(*ParseMemoryPolicy("local"), MemoryPolicy::kLocal);
+  EXPECT_EQ(*ParseMemoryPolicy("interleave"), MemoryPolicy::kInterleave);
+  EXPECT_EQ(ParseMemoryPolicy("bind").status().code(),
+            absl::StatusCode::kInvalidArgument);
+}
+
+TEST(ThreadPlacementTest, PlacesCurrentThreadOnly) {
+  const auto original = GetCurrentThreadPlacement();
+  ASSERT_TRUE(original.ok()) << original.status();
+  ASSERT_FALSE(original->cpus.empty());
+  std::thread([&original] {
+    ASSERT_TRUE(
+        SetCurrentThreadPlacement({.cpus = {original->cpus.back()}}).ok());
+    const auto placement = GetCurrentThreadPlacement();
+    ASSERT_TRUE(placement.ok()) << placement.status();
+    EXPECT_THAT(placement->cpus, ElementsAre(original->cpus.back()));
+    EXPECT_EQ(placement->memory_policy, MemoryPolicy::kLocal);
+    // Threads created by a placed thread inherit its placement.
+    std::thread([&original] {
+      const auto placement = GetCurrentThreadPlacement();
+      ASSERT_TRUE(placement.ok()) << placement.status();
+      EXPECT_THAT(placement->cpus, ElementsAre(original->cpus.back()));
+    }).join();
+  }).join();
+  const auto placement = GetCurrentThreadPlacement();
+  ASSERT_TRUE(placement.ok()) << placement.status();
+  EXPECT_EQ(placement->cpus, original->cpus);
+}
+
+}  // namespace
+}  // namespace kv_server
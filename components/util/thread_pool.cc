@@ -0,0 +1,77 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/util/thread_pool.h"
+
+#include <utility>
+
+#include "absl/log/check.h"
+
+namespace kv_server {
+
+ThreadPool::ThreadPool(int num_threads, DequeueCallback on_dequeue)
+    : on_dequeue_(std::move(on_dequeue)) {
+  CHECK_GT(num_threads, 0) << "ThreadPool needs at least one thread";
+  threads_.reserve(num_threads);
+  for (int i = 0; i < num_threads; i++) {
+    threads_.emplace_back(&ThreadPool::WorkLoop, this);
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    absl::MutexLock lock(&mutex_);
+    stopping_ = true;
+  }
+  for (auto& thread : threads_) {
+    thread.join();
+  }
+}
+
+void ThreadPool::Schedule(absl::AnyInvocable<void() &&> task) {
+  absl::MutexLock lock(&mutex_);
+  queue_.push_back(Task{std::move(task), absl::Now()});
+}
+
+int64_t ThreadPool::QueueDepth() const {
+  absl::MutexLock lock(&mutex_);
+  return queue_.size();
+}
+
+void ThreadPool::WorkLoop() {
+  while (true) {
+    Task task;
+    int64_t queue_depth;
+    {
+      absl::MutexLock lock(&mutex_);
+      mutex_.Await(absl::Condition(
+          +[](ThreadPool* pool) ABSL_EXCLUSIVE_LOCKS_REQUIRED(pool->mutex_) {
+            return pool->stopping_ || !pool->queue_.empty();
+          },
+          this));
+      if (queue_.empty()) {
+        return;
+      }
+      task = std::move(queue_.front());
+      queue_.pop_front();
+      queue_depth = queue_.size();
+    }
+    if (on_dequeue_) {
+      on_dequeue_(queue_depth, absl::Now() - task.schedule_time);
+    }
+    std::move(task.fn)();
+  }
+}
+
+}  // namespace kv_server
@@ -0,0 +1,71 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef COMPONENTS_UTIL_THREAD_POOL_H_
+#define COMPONENTS_UTIL_THREAD_POOL_H_
+
+#include <cstdint>
+#include <deque>
+#include <thread>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/functional/any_invocable.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+
+namespace kv_server {
+
+// Runs tasks on a fixed set of threads owned by this class, in the order they
+// were scheduled. Safe to use from multiple threads.
+class ThreadPool {
+ public:
+  // Called by a worker for every task it takes off the queue, with the number
+  // of tasks left in the queue and how long the task waited in it. Workers
+  // call it concurrently.
+  using DequeueCallback =
+      absl::AnyInvocable<void(int64_t queue_depth, absl::Duration queue_wait)>;
+
+  explicit ThreadPool(int num_threads, DequeueCallback on_dequeue = nullptr);
+
+  // Runs the tasks that are still queued, then joins the threads.
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  void Schedule(absl::AnyInvocable<void() &&> task) ABSL_LOCKS_EXCLUDED(mutex_);
+
+  int64_t QueueDepth() const ABSL_LOCKS_EXCLUDED(mutex_);
+
+ private:
+  struct Task {
+    absl::AnyInvocable<void() &&> fn;
+    absl::Time schedule_time;
+  };
+
+  void WorkLoop() ABSL_LOCKS_EXCLUDED(mutex_);
+
+  DequeueCallback on_dequeue_;
+  mutable absl::Mutex mutex_;
+  std::deque<Task> queue_ ABSL_GUARDED_BY(mutex_);
+  bool stopping_ ABSL_GUARDED_BY(mutex_) = false;
+  std::vector<std::thread> threads_;
+};
+
+}  // namespace kv_server
+
+#endif  // COMPONENTS_UTIL_THREAD_POOL_H_
@@ -0,0 +1,109 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "components/util/thread_pool.h"
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "absl/synchronization/blocking_counter.h"
+#include "absl/synchronization/notification.h"
+#include "absl/time/time.h"
+#include "gtest/gtest.h"
+
+namespace kv_server {
+namespace {
+
+TEST(ThreadPoolTest, RunsAllTasks) {
+  ThreadPool pool(4);
+  std::atomic<int> count = 0;
+  absl::BlockingCounter done(100);
+  for (int i = 0; i < 100; i++) {
+    pool.Schedule([&count, &done]() {
+      count++;
+      done.DecrementCount();
+    });
+  }
+  done.Wait();
+  EXPECT_EQ(count, 100);
+}
+
+TEST(ThreadPoolTest, RunsTasksOnPoolThreads) {
+  ThreadPool pool(1);
+  absl::Notification done;
+  std::thread::id task_thread;
+  pool.Schedule([&task_thread, &done]() {
+    task_thread = std::this_thread::get_id();
+    done.Notify();
+  });
+  done.WaitForNotification();
+  EXPECT_NE(task_thread, std::this_thread::get_id());
+}
+
+TEST(ThreadPoolTest, DestructorRunsQueuedTasks) {
+  std::atomic<int> count = 0;
+  {
+    ThreadPool pool(1);
+    for (int i = 0; i < 10; i++) {
+      pool.Schedule([&count]() { count++; });
+    }
+  }
+  EXPECT_EQ(count, 10);
+}
+
+TEST(ThreadPoolTest, RunsMoveOnlyTasks) {
+  ThreadPool pool(1);
+  absl::Notification done;
+  auto value = std::make_unique<int>(42);
+  int result = 0;
+  pool.Schedule([value = std::move(value), &result, &done]() {
+    result = *value;
+    done.Notify();
+  });
+  done.WaitForNotification();
+  EXPECT_EQ(result, 42);
+}
+
+TEST(ThreadPoolTest, ReportsQueueDepthAndWait) {
+  std::vector<int64_t> queue_depths;
+  absl::Duration total_wait;
+  absl::Notification unblock;
+  absl::BlockingCounter done(3);
+  {
+    ThreadPool pool(1, [&queue_depths, &total_wait](int64_t queue_depth,
+                                                    absl::Duration queue_wait) {
+      queue_depths.push_back(queue_depth);
+      total_wait += queue_wait;
+    });
+    pool.Schedule([&unblock, &done]() {
+      unblock.WaitForNotification();
+      done.DecrementCount();
+    });
+    pool.Schedule([&done]() { done.DecrementCount(); });
+    pool.Schedule([&done]() { done.DecrementCount(); });
+    absl::SleepFor(absl::Milliseconds(5));
+    EXPECT_EQ(pool.QueueDepth(), 2);
+    unblock.Notify();
+    done.Wait();
+  }
+  ASSERT_EQ(queue_depths.size(), 3);
+  EXPECT_EQ(queue_depths[1], 1);
+  EXPECT_EQ(queue_depths[2], 0);
+  EXPECT_GE(total_wait, absl::Milliseconds(5));
+}
+
+}  // namespace
+}  // namespace kv_server
@@ -79,6 +79,104 @@ module "kv_server" {
   s3client_max_range_bytes           = var.s3client_max_range_bytes
   data_loading_file_format           = var.data_loading_file_format
   data_loading_blob_prefix_allowlist = var.data_loading_blob_prefix_allowlist
+  cache_num_segments                 = var.cache_num_segments
+  use_epoch_based_cache              = var.use_epoch_based_cache
+  cache_intern_set_values            = var.cache_intern_set_values
+  lookup_hedge_percentile            = var.lookup_hedge_percentile
+  lookup_skip_empty_shards           = var.lookup_skip_empty_shards
+  lookup_padding_bucket              = var.lookup_padding_bucket
+  lookup_query_pushdown              = var.lookup_query_pushdown
+  lookup_channels_per_replica        = var.lookup_channels_per_replica
+  lookup_keepalive_ms                = var.lookup_keepalive_ms
+  data_loading_concurrency           = var.data_loading_concurrency
+  blob_read_ahead_chunks             = var.blob_read_ahead_chunks
+  blob_cache_directory               = var.blob_cache_directory
+  blob_cache_max_size_mb             = var.blob_cache_max_size_mb
+  cache_checkpoint_file              = var.cache_checkpoint_file
+  cache_checkpoint_mins              = var.cache_checkpoint_mins
+  reader_shards_per_thread           = var.reader_shards_per_thread
+  data_loading_apply_threads         = var.data_loading_apply_threads
+  realtime_applier_threads           = var.realtime_applier_threads
+  cache_cleanup_millis               = var.cache_cleanup_millis
+  cache_cleanup_pause_ms             = var.cache_cleanup_pause_ms
+  realtime_coalesce_millis           = var.realtime_coalesce_millis
+  push_delta_notifications           = var.push_delta_notifications
+  delta_prefetch_max_mb              = var.delta_prefetch_max_mb
+  udf_warm_up_invocations            = var.udf_warm_up_invocations
+  response_brotli_quality            = var.response_brotli_quality
+  response_brotli_window             = var.response_brotli_window
+  cache_precompute_json_values       = var.cache_precompute_json_values
+  v1_direct_serialization            = var.v1_direct_serialization
+  grpc_max_concurrent_streams        = var.grpc_max_concurrent_streams
+  grpc_max_threads_per_core          = var.grpc_max_threads_per_core
+  grpc_memory_quota_mb               = var.grpc_memory_quota_mb
+  admission_max_in_flight            = var.admission_max_in_flight
+  admission_critical_reserve_percent = var.admission_critical_reserve_percent
+  admission_latency_target_ms        = var.admission_latency_target_ms
+  lookup_batch_window_micros         = var.lookup_batch_window_micros
+  lookup_batch_max_keys              = var.lookup_batch_max_keys
+  lookup_key_filter_interval_ms      = var.lookup_key_filter_interval_ms
+  lookup_key_filter_bits_per_key     = var.lookup_key_filter_bits_per_key
+  lookup_cache_max_entries           = var.lookup_cache_max_entries
+  lookup_cache_ttl_ms                = var.lookup_cache_ttl_ms
+  response_cache_max_entries         = var.response_cache_max_entries
+  response_cache_ttl_ms              = var.response_cache_ttl_ms
+  use_siphash_sharding               = var.use_siphash_sharding
+  num_logical_shards                 = var.num_logical_shards
+  trust_data_file_records            = var.trust_data_file_records
+  serving_cpus                       = var.serving_cpus
+  serving_memory_policy              = var.serving_memory_policy
+  data_loading_cpus                  = var.data_loading_cpus
+  data_loading_memory_policy         = var.data_loading_memory_policy
+  snapshot_reload_mins               = var.snapshot_reload_mins
+  readiness_max_lag_secs             = var.readiness_max_lag_secs
+  use_data_file_manifest             = var.use_data_file_manifest
+  cache_compress_values              = var.cache_compress_values
+  cache_deduplicate_values           = var.cache_deduplicate_values
+  cache_cold_value_directory         = var.cache_cold_value_directory
+  cache_max_hot_value_mb             = var.cache_max_hot_value_mb
+  cache_isolate_prefixes             = var.cache_isolate_prefixes
+  cache_index_set_values             = var.cache_index_set_values
+  cache_index_keys                   = var.cache_index_keys
+  cache_hot_key_sample_rate          = var.cache_hot_key_sample_rate
+  data_loading_priority_prefixes     = var.data_loading_priority_prefixes
+  lookup_plan_queries_with_set_sizes = var.lookup_plan_queries_with_set_sizes
+  cache_use_huge_pages               = var.cache_use_huge_pages
+  query_evaluation_threads           = var.query_evaluation_threads
+
+  # Variables related to the compression of remote lookup responses.
+  lookup_response_compression_min_bytes = var.lookup_response_compression_min_bytes
+
+  # Variables related to the V1 lookups.
+  v1_merge_namespace_lookups = var.v1_merge_namespace_lookups
+
+  # Variables related to the batching of UDF executions.
+  udf_batch_window_us = var.udf_batch_window_us
+  udf_max_batch_size  = var.udf_max_batch_size
+
+  # Variables related to the cache of UDFs.
+  udf_cache_max_mb = var.udf_cache_max_mb
+
+  # Variables related to receiving realtime updates.
+  realtime_max_receivers = var.realtime_max_receivers
+
+  # Variables related to compacted delta files.
+  load_compacted_delta_files = var.load_compacted_delta_files
+
+  # Variables related to snapshot downloads.
+  download_snapshot_files = var.download_snapshot_files
+
+  # Variables related to bulk loading snapshots.
+  bulk_load_snapshots = var.bulk_load_snapshots
+
+  # Variables related to the heap allocator.
+  heap_allocator_max_per_cpu_cache_bytes = var.heap_allocator_max_per_cpu_cache_bytes
+  release_heap_memory_after_loading      = var.release_heap_memory_after_loading
+
+  # Variables related to throttling of data loading.
+  data_loading_max_records_per_second = var.data_loading_max_records_per_second
+  data_loading_min_records_per_second = var.data_loading_min_records_per_second
+  data_loading_latency_target_ms      = var.data_loading_latency_target_ms
 
   # Variables related to sharding.
   num_shards             = var.num_shards
@@ -179,6 +179,95 @@ module "parameter" {
   sharding_key_regex_parameter_value       = var.sharding_key_regex
   enable_otel_logger_parameter_value       = var.enable_otel_logger
   data_loading_blob_prefix_allowlist       = var.data_loading_blob_prefix_allowlist
+  cache_num_segments_parameter_value       = var.cache_num_segments
+  use_epoch_based_cache_parameter_value    = var.use_epoch_based_cache
+  cache_intern_set_values_parameter_value  = var.cache_intern_set_values
+  lookup_hedge_percentile_parameter_value  = var.lookup_hedge_percentile
+  lookup_skip_empty_shards_parameter_value = var.lookup_skip_empty_shards
+  lookup_padding_bucket_parameter_value    = var.lookup_padding_bucket
+  lookup_query_pushdown_parameter_value    = var.lookup_query_pushdown
+  lookup_channels_per_replica_parameter_value = var.lookup_channels_per_replica
+  lookup_keepalive_ms_parameter_value      = var.lookup_keepalive_ms
+  data_loading_concurrency_parameter_value = var.data_loading_concurrency
+  blob_read_ahead_chunks_parameter_value   = var.blob_read_ahead_chunks
+  blob_cache_directory_parameter_value     = var.blob_cache_directory
+  blob_cache_max_size_mb_parameter_value   = var.blob_cache_max_size_mb
+  cache_checkpoint_file_parameter_value    = var.cache_checkpoint_file
+  cache_checkpoint_mins_parameter_value    = var.cache_checkpoint_mins
+  reader_shards_per_thread_parameter_value = var.reader_shards_per_thread
+  realtime_applier_threads_parameter_value = var.realtime_applier_threads
+  cache_cleanup_millis_parameter_value     = var.cache_cleanup_millis
+  cache_cleanup_pause_ms_parameter_value   = var.cache_cleanup_pause_ms
+  realtime_coalesce_millis_parameter_value = var.realtime_coalesce_millis
+  push_delta_notifications_parameter_value = var.push_delta_notifications
+  delta_prefetch_max_mb_parameter_value    = var.delta_prefetch_max_mb
+  udf_warm_up_invocations_parameter_value  = var.udf_warm_up_invocations
+  response_brotli_quality_parameter_value  = var.response_brotli_quality
+  response_brotli_window_parameter_value   = var.response_brotli_window
+  cache_precompute_json_values_parameter_value = var.cache_precompute_json_values
+  v1_direct_serialization_parameter_value      = var.v1_direct_serialization
+  grpc_max_concurrent_streams_parameter_value  = var.grpc_max_concurrent_streams
+  grpc_max_threads_per_core_parameter_value    = var.grpc_max_threads_per_core
+  grpc_memory_quota_mb_parameter_value         = var.grpc_memory_quota_mb
+  admission_max_in_flight_parameter_value      = var.admission_max_in_flight
+  admission_critical_reserve_percent_parameter_value = var.admission_critical_reserve_percent
+  admission_latency_target_ms_parameter_value        = var.admission_latency_target_ms
+  lookup_batch_window_micros_parameter_value         = var.lookup_batch_window_micros
+  lookup_batch_max_keys_parameter_value              = var.lookup_batch_max_keys
+  lookup_key_filter_interval_ms_parameter_value      = var.lookup_key_filter_interval_ms
+  lookup_key_filter_bits_per_key_parameter_value     = var.lookup_key_filter_bits_per_key
+  lookup_cache_max_entries_parameter_value           = var.lookup_cache_max_entries
+  lookup_cache_ttl_ms_parameter_value                = var.lookup_cache_ttl_ms
+  response_cache_max_entries_parameter_value         = var.response_cache_max_entries
+  response_cache_ttl_ms_parameter_value              = var.response_cache_ttl_ms
+  use_siphash_sharding_parameter_value               = var.use_siphash_sharding
+  num_logical_shards_parameter_value                 = var.num_logical_shards
+  trust_data_file_records_parameter_value            = var.trust_data_file_records
+  serving_cpus_parameter_value                       = var.serving_cpus
+  serving_memory_policy_parameter_value              = var.serving_memory_policy
+  data_loading_cpus_parameter_value                  = var.data_loading_cpus
+  data_loading_memory_policy_parameter_value         = var.data_loading_memory_policy
+  snapshot_reload_mins_parameter_value               = var.snapshot_reload_mins
+  readiness_max_lag_secs_parameter_value             = var.readiness_max_lag_secs
+  use_data_file_manifest_parameter_value             = var.use_data_file_manifest
+  cache_compress_values_parameter_value              = var.cache_compress_values
+  cache_deduplicate_values_parameter_value           = var.cache_deduplicate_values
+  cache_cold_value_directory_parameter_value         = var.cache_cold_value_directory
+  cache_max_hot_value_mb_parameter_value             = var.cache_max_hot_value_mb
+  cache_isolate_prefixes_parameter_value             = var.cache_isolate_prefixes
+  cache_index_set_values_parameter_value             = var.cache_index_set_values
+  cache_index_keys_parameter_value                   = var.cache_index_keys
+  cache_hot_key_sample_rate_parameter_value          = var.cache_hot_key_sample_rate
+  data_loading_priority_prefixes_parameter_value     = var.data_loading_priority_prefixes
+  lookup_plan_queries_with_set_sizes_parameter_value = var.lookup_plan_queries_with_set_sizes
+  cache_use_huge_pages_parameter_value               = var.cache_use_huge_pages
+  query_evaluation_threads_parameter_value           = var.query_evaluation_threads
+
+  lookup_response_compression_min_bytes_parameter_value = var.lookup_response_compression_min_bytes
+
+  v1_merge_namespace_lookups_parameter_value = var.v1_merge_namespace_lookups
+
+  udf_batch_window_us_parameter_value = var.udf_batch_window_us
+  udf_max_batch_size_parameter_value  = var.udf_max_batch_size
+
+  udf_cache_max_mb_parameter_value = var.udf_cache_max_mb
+
+  realtime_max_receivers_parameter_value = var.realtime_max_receivers
+
+  load_compacted_delta_files_parameter_value = var.load_compacted_delta_files
+
+  data_loading_apply_threads_parameter_value = var.data_loading_apply_threads
+
+  download_snapshot_files_parameter_value = var.download_snapshot_files
+
+  bulk_load_snapshots_parameter_value = var.bulk_load_snapshots
+
+  heap_allocator_max_per_cpu_cache_bytes_parameter_value = var.heap_allocator_max_per_cpu_cache_bytes
+  release_heap_memory_after_loading_parameter_value      = var.release_heap_memory_after_loading
+
+  data_loading_max_records_per_second_parameter_value = var.data_loading_max_records_per_second
+  data_loading_min_records_per_second_parameter_value = var.data_loading_min_records_per_second
+  data_loading_latency_target_ms_parameter_value      = var.data_loading_latency_target_ms
 }
 
 module "security_group_rules" {
@@ -231,7 +320,85 @@ module "iam_role_policies" {
     module.parameter.udf_timeout_millis_parameter_arn,
     module.parameter.udf_min_log_level_parameter_arn,
     module.parameter.enable_otel_logger_parameter_arn,
-  module.parameter.data_loading_blob_prefix_allowlist_parameter_arn]
+    module.parameter.data_loading_blob_prefix_allowlist_parameter_arn,
+    module.parameter.cache_num_segments_parameter_arn,
+    module.parameter.use_epoch_based_cache_parameter_arn,
+    module.parameter.cache_intern_set_values_parameter_arn,
+    module.parameter.lookup_hedge_percentile_parameter_arn,
+    module.parameter.lookup_skip_empty_shards_parameter_arn,
+    module.parameter.lookup_padding_bucket_parameter_arn,
+    module.parameter.lookup_query_pushdown_parameter_arn,
+    module.parameter.lookup_channels_per_replica_parameter_arn,
+    module.parameter.lookup_keepalive_ms_parameter_arn,
+    module.parameter.data_loading_concurrency_parameter_arn,
+    module.parameter.blob_read_ahead_chunks_parameter_arn,
+    module.parameter.blob_cache_directory_parameter_arn,
+    module.parameter.blob_cache_max_size_mb_parameter_arn,
+    module.parameter.cache_checkpoint_file_parameter_arn,
+    module.parameter.cache_checkpoint_mins_parameter_arn,
+    module.parameter.reader_shards_per_thread_parameter_arn,
+    module.parameter.realtime_applier_threads_parameter_arn,
+    module.parameter.cache_cleanup_millis_parameter_arn,
+    module.parameter.cache_cleanup_pause_ms_parameter_arn,
+    module.parameter.realtime_coalesce_millis_parameter_arn,
+    module.parameter.push_delta_notifications_parameter_arn,
+    module.parameter.delta_prefetch_max_mb_parameter_arn,
+    module.parameter.udf_warm_up_invocations_parameter_arn,
+    module.parameter.response_brotli_quality_parameter_arn,
+    module.parameter.response_brotli_window_parameter_arn,
+    module.parameter.cache_precompute_json_values_parameter_arn,
+    module.parameter.v1_direct_serialization_parameter_arn,
+    module.parameter.grpc_max_concurrent_streams_parameter_arn,
+    module.parameter.grpc_max_threads_per_core_parameter_arn,
+    module.parameter.grpc_memory_quota_mb_parameter_arn,
+    module.parameter.admission_max_in_flight_parameter_arn,
+    module.parameter.admission_critical_reserve_percent_parameter_arn,
+    module.parameter.admission_latency_target_ms_parameter_arn,
+    module.parameter.lookup_batch_window_micros_parameter_arn,
+    module.parameter.lookup_batch_max_keys_parameter_arn,
+    module.parameter.lookup_key_filter_interval_ms_parameter_arn,
+    module.parameter.lookup_key_filter_bits_per_key_parameter_arn,
+    module.parameter.lookup_cache_max_entries_parameter_arn,
+    module.parameter.lookup_cache_ttl_ms_parameter_arn,
+    module.parameter.use_siphash_sharding_parameter_arn,
+    module.parameter.num_logical_shards_parameter_arn,
+    module.parameter.trust_data_file_records_parameter_arn,
+    module.parameter.serving_cpus_parameter_arn,
+    module.parameter.serving_memory_policy_parameter_arn,
+    module.parameter.data_loading_cpus_parameter_arn,
+    module.parameter.data_loading_memory_policy_parameter_arn,
+    module.parameter.data_loading_max_records_per_second_parameter_arn,
+    module.parameter.data_loading_min_records_per_second_parameter_arn,
+    module.parameter.data_loading_latency_target_ms_parameter_arn,
+    module.parameter.snapshot_reload_mins_parameter_arn,
+    module.parameter.readiness_max_lag_secs_parameter_arn,
+    module.parameter.use_data_file_manifest_parameter_arn,
+    module.parameter.cache_compress_values_parameter_arn,
+    module.parameter.cache_deduplicate_values_parameter_arn,
+    module.parameter.cache_cold_value_directory_parameter_arn,
+    module.parameter.cache_max_hot_value_mb_parameter_arn,
+    module.parameter.cache_isolate_prefixes_parameter_arn,
+    module.parameter.cache_index_set_values_parameter_arn,
+    module.parameter.query_evaluation_threads_parameter_arn,
+    module.parameter.lookup_response_compression_min_bytes_parameter_arn,
+    module.parameter.v1_merge_namespace_lookups_parameter_arn,
+    module.parameter.udf_batch_window_us_parameter_arn,
+    module.parameter.udf_max_batch_size_parameter_arn,
+    module.parameter.udf_cache_max_mb_parameter_arn,
+    module.parameter.realtime_max_receivers_parameter_arn,
+    module.parameter.load_compacted_delta_files_parameter_arn,
+    module.parameter.data_loading_apply_threads_parameter_arn,
+    module.parameter.download_snapshot_files_parameter_arn,
+    module.parameter.heap_allocator_max_per_cpu_cache_bytes_parameter_arn,
+    module.parameter.release_heap_memory_after_loading_parameter_arn,
+    module.parameter.cache_use_huge_pages_parameter_arn,
+    module.parameter.response_cache_max_entries_parameter_arn,
+    module.parameter.response_cache_ttl_ms_parameter_arn,
+    module.parameter.bulk_load_snapshots_parameter_arn,
+    module.parameter.cache_index_keys_parameter_arn,
+    module.parameter.lookup_plan_queries_with_set_sizes_parameter_arn,
+    module.parameter.cache_hot_key_sample_rate_parameter_arn,
+  module.parameter.data_loading_priority_prefixes_parameter_arn]
   coordinator_parameter_arns = (
     var.use_real_coordinators ? [
       module.parameter.primary_coordinator_account_identity_parameter_arn,
@@ -261,3 +261,549 @@ resource "aws_ssm_parameter" "data_loading_blob_prefix_allowlist" {
   value     = var.data_loading_blob_prefix_allowlist
   overwrite = true
 }
+
+resource "aws_ssm_parameter" "cache_num_segments_parameter" {
+  name      = "${var.service}-${var.environment}-cache-num-segments"
+  type      = "String"
+  value     = var.cache_num_segments_parameter_value
+  overwrite = true
+}
+
+resource "aws_ssm_parameter" "use_epoch_based_cache_parameter" {
+  name      = "${var.service}-${var.environment}-use-epoch-based-cache"
+  type      = "String"
+  value     = var.use_epoch_based_cache_parameter_value
+  overwrite = true
+}
+
+resource "aws_ssm_parameter" "cache_intern_set_values_parameter" {
+  name      = "${var.service}-${var.environment}-cache-intern-set-values"
+  type      = "String"
+  value     = var.cache_intern_set_values_parameter_value
+  overwrite = true
+}
+
+resource "aws_ssm_parameter" "lookup_hedge_percentile_parameter" {
+  name      = "${var.service}-${var.environment}-lookup-hedge-percentile"
+  type      = "String"
+  value     = var.lookup_hedge_percentile_parameter_value
+  overwrite = true
+}
+
+resource "aws_ssm_parameter" "lookup_skip_empty_shards_parameter" {
+  name      = "${var.service}-${var.environment}-lookup-skip-empty-shards"
+  type      = "String"
+  value     = var.lookup_skip_empty_shards_parameter_value
+  overwrite = true
+}
+
+resource "aws_ssm_parameter" "lookup_padding_bucket_parameter" {
+  name      = "${var.service}-${var.environment}-lookup-padding-bucket"
+  type      = "String"
+  value     = var.lookup_padding_bucket_parameter_value
+  overwrite = true
+}
+
+resource "aws_ssm_parameter" "lookup_query_pushdown_parameter" {
+  name      = "${var.service}-${var.environment}-lookup-query-pushdown"
+  type      = "String"
+  value     = var.lookup_query_pushdown_parameter_value
+  overwrite = true
+}
+
+resource "aws_ssm_parameter" "lookup_channels_per_replica_parameter" {
+  name      = "${var.service}-${var.environment}-lookup-channels-per-replica"
+  type      = "String"
+  value     = var.lookup_channels_per_replica_parameter_value
+  overwrite = true
+}
+
+resource "aws_ssm_parameter" "lookup_keepalive_ms_parameter" {
+  name      = "${var.service}-${var.environment}-lookup-keepalive-ms"
+  type      = "String"
+  value     = var.lookup_keepalive_ms_parameter_value
+  overwrite = true
+}
+
+resource "aws_ssm_parameter" "data_loading_concurrency_parameter" {
+  name      = "${var.service}-${var.environment}-data-loading-concurrency"
+  type      = "String"
+  value     = var.data_loading_concurrency_parameter_value
+  overwrite = true
+}
+
+resource "aws_ssm_parameter" "blob_read_ahead_chunks_parameter" {
+  name      = "${var.service}-${var.environment}-blob-read-ahead-chunks"
+  type      = "String"
+  value     = var.blob_read_ahead_chunks_parameter_value
+  overwrite = true
+}
+
+resource "aws_ssm_parameter" "blob_cache_directory_parameter" {
+  name      = "${var.service}-${var.environment}-blob-cache-directory"
+  type      = "String"
+  value     = var.blob_cache_directory_parameter_value
+  overwrite = true
+}
+
+resource "aws_ssm_parameter" "blob_cache_max_size_mb_parameter" {
+  name      = "${var.service}-${var.environment}-blob-cache-max-size-mb"
+  type      = "String"
+  value     = var.blob_cache_max_size_mb_parameter_value
+  overwrite = true
+}
+
+resource "aws_ssm_parameter" "cache_checkpoint_file_parameter" {
+  name      = "${var.service}-${var.environment}-cache-checkpoint-file"
+  type      = "String"
+  value     = var.cache_checkpoint_file_parameter_value
+  overwrite = true
+}
+
+resource "aws_ssm_parameter" "cache_checkpoint_mins_parameter" {
+  name      = "${var.service}-${var.environment}-cache-checkpoint-mins"
+  type      = "String"
+  value     = var.cache_checkpoint_mins_parameter_value
+  overwrite = true
+}
+
+resource "aws_ssm_parameter" "reader_shards_per_thread_parameter" {
+  name      = "${var.service}-${var.environment}-reader-shards-per-thread"
+  type      = "String"
+  value     = var.reader_shards_per_thread_parameter_value
+  overwrite = true
+}
+
+resource "aws_ssm_parameter" "realtime_applier_threads_parameter" {
+  name      = "${var.service}-${var.environment}-realtime-applier-threads"
+  type      = "String"
+  value     = var.realtime_applier_threads_parameter_value
+  overwrite = true
+}
+
+resource "aws_ssm_parameter" "cache_cleanup_millis_parameter" {
+  name      = "${var.service}-${var.environment}-cache-cleanup-millis"
+  type      = "String"
+  value     = var.cache_cleanup_millis_parameter_value
+  overwrite = true
+}
+
+resource "aws_ssm_parameter" "cache_cleanup_pause_ms_parameter" {
+  name      = "${var.service}-${var.environment}-cache-cleanup-pause-ms"
+  type      = "String"
+  value     = var.cache_cleanup_pause_ms_parameter_value
+  overwrite = true
+}
+
+resource "aws_ssm_parameter" "realtime_coalesce_millis_parameter" {
+  name      = "${var.service}-${var.environment}-realtime-coalesce-millis"
+  type      = "String"
+  value     = var.realtime_coalesce_millis_parameter_value
+  overwrite = true
+}
+
+resource "aws_ssm_parameter" "push_delta_notifications_parameter" {
+  name      = "${var.service}-${var.environment}-push-delta-notifications"
+  type      = "String"
+  value     = var.push_delta_notifications_parameter_value
+  overwrite = true
+}
+
+resource "aws_ssm_parameter" "delta_prefetch_max_mb_parameter" {
+  name      = "${var.service}-${var.environment}-delta-prefetch-max-mb"
+  type      = "String"
+  value     = var.delta_prefetch_max_mb_parameter_value
+  overwrite = true
+}
+
+resource "aws_ssm_parameter" "udf_warm_up_invocations_parameter" {
+  name      = "${var.service}-${var.environment}-udf-warm-up-invocations"
+  type      = "String"
+  value     = var.udf_warm_up_invocations_parameter_value
+  overwrite = true
+}
+
+resource "aws_ssm_parameter" "response_brotli_quality_parameter" {
+  name      = "${var.service}-${var.environment}-response-brotli-quality"
+  type      = "String"
+  value     = var.response_brotli_quality_parameter_value
+  overwrite = true
+}
+
+resource "aws_ssm_parameter" "response_brotli_window_parameter" {
+  name      = "${var.service}-${var.environment}-response-brotli-window"
+  type      = "String"
+  value     = var.response_brotli_window_parameter_value
+  overwrite = true
+}
+
+resource "aws_ssm_parameter" "cache_precompute_json_values_parameter" {
+  name      = "${var.service}-${var.environment}-cache-precompute-json-values"
+  type      = "String"
+  value     = var.cache_precompute_json_values_parameter_value
+  overwrite = true
+}
+
+resource "aws_ssm_parameter" "v1_direct_serialization_parameter" {
+  name      = "${var.service}-${var.environment}-v1-direct-serialization"
+  type      = "String"
+  value     = var.v1_direct_serialization_parameter_value
+  overwrite = true
+}
+
+resource "aws_ssm_parameter" "grpc_max_concurrent_streams_parameter" {
+  name      = "${var.service}-${var.environment}-grpc-max-concurrent-streams"
+  type      = "String"
+  value     = var.grpc_max_concurrent_streams_parameter_value
+  overwrite = true
+}
+
+resource "aws_ssm_parameter" "grpc_max_threads_per_core_parameter" {
+  name      = "${var.service}-${var.environment}-grpc-max-threads-per-core"
+  type      = "String"
+  value     = var.grpc_max_threads_per_core_parameter_value
+  overwrite = true
+}
+
+resource "aws_ssm_parameter" "grpc_memory_quota_mb_parameter" {
+  name      = "${var.service}-${var.environment}-grpc-memory-quota-mb"
+  type      = "String"
+  value     = var.grpc_memory_quota_mb_parameter_value
+  overwrite = true
+}
+
+resource "aws_ssm_parameter" "admission_max_in_flight_parameter" {
+  name      = "${var.service}-${var.environment}-admission-max-in-flight"
+  type      = "String"
+  value     = var.admission_max_in_flight_parameter_value
+  overwrite = true
+}
+
+resource "aws_ssm_parameter" "admission_critical_reserve_percent_parameter" {
+  name      = "${var.service}-${var.environment}-admission-critical-reserve-percent"
+  type      = "String"
+  value     = var.admission_critical_reserve_percent_parameter_value
+  overwrite = true
+}
+
+resource "aws_ssm_parameter" "admission_latency_target_ms_parameter" {
+  name      = "${var.service}-${var.environment}-admission-latency-target-ms"
+  type      = "String"
+  value     = var.admission_latency_target_ms_parameter_value
+  overwrite = true
+}
+
+resource "aws_ssm_parameter" "lookup_batch_window_micros_parameter" {
+  name      = "${var.service}-${var.environment}-lookup-batch-window-micros"
+  type      = "String"
+  value     = var.lookup_batch_window_micros_parameter_value
+  overwrite = true
+}
+
+resource "aws_ssm_parameter" "lookup_batch_max_keys_parameter" {
+  name      = "${var.service}-${var.environment}-lookup-batch-max-keys"
+  type      = "String"
+  value     = var.lookup_batch_max_keys_parameter_value
+  overwrite = true
+}
+
+resource "aws_ssm_parameter" "lookup_key_filter_interval_ms_parameter" {
+  name      = "${var.service}-${var.environment}-lookup-key-filter-interval-ms"
+  type      = "String"
+  value     = var.lookup_key_filter_interval_ms_parameter_value
+  overwrite = true
+}
+
+resource "aws_ssm_parameter" "lookup_key_filter_bits_per_key_parameter" {
+  name      = "${var.service}-${var.environment}-lookup-key-filter-bits-per-key"
+  type      = "String"
+  value     = var.lookup_key_filter_bits_per_key_parameter_value
+  overwrite = true
+}
+
+resource "aws_ssm_parameter" "lookup_cache_max_entries_parameter" {
+  name      = "${var.service}-${var.environment}-lookup-cache-max-entries"
+  type      = "String"
+  value     = var.lookup_cache_max_entries_parameter_value
+  overwrite = true
+}
+
+resource "aws_ssm_parameter" "lookup_cache_ttl_ms_parameter" {
+  name      = "${var.service}-${var.environment}-lookup-cache-ttl-ms"
+  type      = "String"
+  value     = var.lookup_cache_ttl_ms_parameter_value
+  overwrite = true
+}
+
+resource "aws_ssm_parameter" "use_siphash_sharding_parameter" {
+  name      = "${var.service}-${var.environment}-use-siphash-sharding"
+  type      = "String"
+  value     = var.use_siphash_sharding_parameter_value
+  overwrite = true
+}
+
+resource "aws_ssm_parameter" "num_logical_shards_parameter" {
+  name      = "${var.service}-${var.environment}-num-logical-shards"
+  type      = "String"
+  value     = var.num_logical_shards_parameter_value
+  overwrite = true
+}
+
+resource "aws_ssm_parameter" "trust_data_file_records_parameter" {
+  name      = "${var.service}-${var.environment}-trust-data-file-records"
+  type      = "String"
+  value     = var.trust_data_file_records_parameter_value
+  overwrite = true
+}
+
+resource "aws_ssm_parameter" "serving_cpus_parameter" {
+  name      = "${var.service}-${var.environment}-serving-cpus"
+  type      = "String"
+  value     = var.serving_cpus_parameter_value
+  overwrite = true
+}
+
+resource "aws_ssm_parameter" "serving_memory_policy_parameter" {
+  name      = "${var.service}-${var.environment}-serving-memory-policy"
+  type      = "String"
+  value     = var.serving_memory_policy_parameter_value
+  overwrite = true
+}
+
+resource "aws_ssm_parameter" "data_loading_cpus_parameter" {
+  name      = "${var.service}-${var.environment}-data-loading-cpus"
+  type      = "String"
+  value     = var.data_loading_cpus_parameter_value
+  overwrite = true
+}
+
+resource "aws_ssm_parameter" "data_loading_memory_policy_parameter" {
+  name      = "${var.service}-${var.environment}-data-loading-memory-policy"
+  type      = "String"
+  value     = var.data_loading_memory_policy_parameter_value
+  overwrite = true
+}
+
+resource "aws_ssm_parameter" "data_loading_max_records_per_second_parameter" {
+  name      = "${var.service}-${var.environment}-data-loading-max-records-per-second"
+  type      = "String"
+  value     = var.data_loading_max_records_per_second_parameter_value
+  overwrite = true
+}
+
+resource "aws_ssm_parameter" "data_loading_min_records_per_second_parameter" {
+  name      = "${var.service}-${var.environment}-data-loading-min-records-per-second"
+  type      = "String"
+  value     = var.data_loading_min_records_per_second_parameter_value
+  overwrite = true
+}
+
+resource "aws_ssm_parameter" "data_loading_latency_target_ms_parameter" {
+  name      = "${var.service}-${var.environment}-data-loading-latency-target-ms"
+  type      = "String"
+  value     = var.data_loading_latency_target_ms_parameter_value
+  overwrite = true
+}
+
+resource "aws_ssm_parameter" "snapshot_reload_mins_parameter" {
+  name      = "${var.service}-${var.environment}-snapshot-reload-mins"
+  type      = "String"
+  value     = var.snapshot_reload_mins_parameter_value
+  overwrite = true
+}
+
+resource "aws_ssm_parameter" "readiness_max_lag_secs_parameter" {
+  name      = "${var.service}-${var.environment}-readiness-max-lag-secs"
+  type      = "String"
+  value     = var.readiness_max_lag_secs_parameter_value
+  overwrite = true
+}
+
+resource "aws_ssm_parameter" "use_data_file_manifest_parameter" {
+  name      = "${var.service}-${var.environment}-use-data-file-manifest"
+  type      = "String"
+  value     = var.use_data_file_manifest_parameter_value
+  overwrite = true
+}
+
+resource "aws_ssm_parameter" "cache_compress_values_parameter" {
+  name      = "${var.service}-${var.environment}-cache-compress-values"
+  type      = "String"
+  value     = var.cache_compress_values_parameter_value
+  overwrite = true
+}
+
+resource "aws_ssm_parameter" "cache_deduplicate_values_parameter" {
+  name      = "${var.service}-${var.environment}-cache-deduplicate-values"
+  type      = "String"
+  value     = var.cache_deduplicate_values_parameter_value
+  overwrite = true
+}
+
+resource "aws_ssm_parameter" "cache_cold_value_directory_parameter" {
+  name      = "${var.service}-${var.environment}-cache-cold-value-directory"
+  type      = "String"
+  value     = var.cache_cold_value_directory_parameter_value
+  overwrite = true
+}
+
+resource "aws_ssm_parameter" "cache_max_hot_value_mb_parameter" {
+  name      = "${var.service}-${var.environment}-cache-max-hot-value-mb"
+  type      = "String"
+  value     = var.cache_max_hot_value_mb_parameter_value
+  overwrite = true
+}
+
+resource "aws_ssm_parameter" "cache_isolate_prefixes_parameter" {
+  name      = "${var.service}-${var.environment}-cache-isolate-prefixes"
+  type      = "String"
+  value     = var.cache_isolate_prefixes_parameter_value
+  overwrite = true
+}
+
+resource "aws_ssm_parameter" "cache_index_set_values_parameter" {
+  name      = "${var.service}-${var.environment}-cache-index-set-values"
+  type      = "String"
+  value     = var.cache_index_set_values_parameter_value
+  overwrite = true
+}
+
+resource "aws_ssm_parameter" "query_evaluation_threads_parameter" {
+  name      = "${var.service}-${var.environment}-query-evaluation-threads"
+  type      = "String"
+  value     = var.query_evaluation_threads_parameter_value
+  overwrite = true
+}
+
+resource "aws_ssm_parameter" "lookup_response_compression_min_bytes_parameter" {
+  name      = "${var.service}-${var.environment}-lookup-response-compression-min-bytes"
+  type      = "String"
+  value     = var.lookup_response_compression_min_bytes_parameter_value
+  overwrite = true
+}
+
+resource "aws_ssm_parameter" "v1_merge_namespace_lookups_parameter" {
+  name      = "${var.service}-${var.environment}-v1-merge-namespace-lookups"
+  type      = "String"
+  value     = var.v1_merge_namespace_lookups_parameter_value
+  overwrite = true
+}
+
+resource "aws_ssm_parameter" "udf_batch_window_us_parameter" {
+  name      = "${var.service}-${var.environment}-udf-batch-window-us"
+  type      = "String"
+  value     = var.udf_batch_window_us_parameter_value
+  overwrite = true
+}
+
+resource "aws_ssm_parameter" "udf_max_batch_size_parameter" {
+  name      = "${var.service}-${var.environment}-udf-max-batch-size"
+  type      = "String"
+  value     = var.udf_max_batch_size_parameter_value
+  overwrite = true
+}
+
+resource "aws_ssm_parameter" "udf_cache_max_mb_parameter" {
+  name      = "${var.service}-${var.environment}-udf-cache-max-mb"
+  type      = "String"
+  value     = var.udf_cache_max_mb_parameter_value
+  overwrite = true
+}
+
+resource "aws_ssm_parameter" "realtime_max_receivers_parameter" {
+  name      = "${var.service}-${var.environment}-realtime-max-receivers"
+  type      = "String"
+  value     = var.realtime_max_receivers_parameter_value
+  overwrite = true
+}
+
+resource "aws_ssm_parameter" "load_compacted_delta_files_parameter" {
+  name      = "${var.service}-${var.environment}-load-compacted-delta-files"
+  type      = "String"
+  value     = var.load_compacted_delta_files_parameter_value
+  overwrite = true
+}
+
+resource "aws_ssm_parameter" "data_loading_apply_threads_parameter" {
+  name      = "${var.service}-${var.environment}-data-loading-apply-threads"
+  type      = "String"
+  value     = var.data_loading_apply_threads_parameter_value
+  overwrite = true
+}
+
+resource "aws_ssm_parameter" "download_snapshot_files_parameter" {
+  name      = "${var.service}-${var.environment}-download-snapshot-files"
+  type      = "String"
+  value     = var.download_snapshot_files_parameter_value
+  overwrite = true
+}
+
+resource "aws_ssm_parameter" "heap_allocator_max_per_cpu_cache_bytes_parameter" {
+  name      = "${var.service}-${var.environment}-heap-allocator-max-per-cpu-cache-bytes"
+  type      = "String"
+  value     = var.heap_allocator_max_per_cpu_cache_bytes_parameter_value
+  overwrite = true
+}
+
+resource "aws_ssm_parameter" "release_heap_memory_after_loading_parameter" {
+  name      = "${var.service}-${var.environment}-release-heap-memory-after-loading"
+  type      = "String"
+  value     = var.release_heap_memory_after_loading_parameter_value
+  overwrite = true
+}
+
+resource "aws_ssm_parameter" "cache_use_huge_pages_parameter" {
+  name      = "${var.service}-${var.environment}-cache-use-huge-pages"
+  type      = "String"
+  value     = var.cache_use_huge_pages_parameter_value
+  overwrite = true
+}
+
+resource "aws_ssm_parameter" "response_cache_max_entries_parameter" {
+  name      = "${var.service}-${var.environment}-response-cache-max-entries"
+  type      = "String"
+  value     = var.response_cache_max_entries_parameter_value
+  overwrite = true
+}
+
+resource "aws_ssm_parameter" "response_cache_ttl_ms_parameter" {
+  name      = "${var.service}-${var.environment}-response-cache-ttl-ms"
+  type      = "String"
+  value     = var.response_cache_ttl_ms_parameter_value
+  overwrite = true
+}
+
+resource "aws_ssm_parameter" "bulk_load_snapshots_parameter" {
+  name      = "${var.service}-${var.environment}-bulk-load-snapshots"
+  type      = "String"
+  value     = var.bulk_load_snapshots_parameter_value
+  overwrite = true
+}
+
+resource "aws_ssm_parameter" "cache_index_keys_parameter" {
+  name      = "${var.service}-${var.environment}-cache-index-keys"
+  type      = "String"
+  value     = var.cache_index_keys_parameter_value
+  overwrite = true
+}
+
+resource "aws_ssm_parameter" "lookup_plan_queries_with_set_sizes_parameter" {
+  name      = "${var.service}-${var.environment}-lookup-plan-queries-with-set-sizes"
+  type      = "String"
+  value     = var.lookup_plan_queries_with_set_sizes_parameter_value
+  overwrite = true
+}
+
+resource "aws_ssm_parameter" "cache_hot_key_sample_rate_parameter" {
+  name      = "${var.service}-${var.environment}-cache-hot-key-sample-rate"
+  type      = "String"
+  value     = var.cache_hot_key_sample_rate_parameter_value
+  overwrite = true
+}
+
+resource "aws_ssm_parameter" "data_loading_priority_prefixes_parameter" {
+  name      = "${var.service}-${var.environment}-data-loading-priority-prefixes"
+  type      = "String"
+  value     = var.data_loading_priority_prefixes_parameter_value
+  overwrite = true
+}
@@ -153,3 +153,315 @@ output "enable_otel_logger_parameter_arn" {
 output "data_loading_blob_prefix_allowlist_parameter_arn" {
   value = aws_ssm_parameter.data_loading_blob_prefix_allowlist.arn
 }
+
+output "cache_num_segments_parameter_arn" {
+  value = aws_ssm_parameter.cache_num_segments_parameter.arn
+}
+
+output "use_epoch_based_cache_parameter_arn" {
+  value = aws_ssm_parameter.use_epoch_based_cache_parameter.arn
+}
+
+output "cache_intern_set_values_parameter_arn" {
+  value = aws_ssm_parameter.cache_intern_set_values_parameter.arn
+}
+
+output "lookup_hedge_percentile_parameter_arn" {
+  value = aws_ssm_parameter.lookup_hedge_percentile_parameter.arn
+}
+
+output "lookup_skip_empty_shards_parameter_arn" {
+  value = aws_ssm_parameter.lookup_skip_empty_shards_parameter.arn
+}
+
+output "lookup_padding_bucket_parameter_arn" {
+  value = aws_ssm_parameter.lookup_padding_bucket_parameter.arn
+}
+
+output "lookup_query_pushdown_parameter_arn" {
+  value = aws_ssm_parameter.lookup_query_pushdown_parameter.arn
+}
+
+output "lookup_channels_per_replica_parameter_arn" {
+  value = aws_ssm_parameter.lookup_channels_per_replica_parameter.arn
+}
+
+output "lookup_keepalive_ms_parameter_arn" {
+  value = aws_ssm_parameter.lookup_keepalive_ms_parameter.arn
+}
+
+output "data_loading_concurrency_parameter_arn" {
+  value = aws_ssm_parameter.data_loading_concurrency_parameter.arn
+}
+
+output "blob_read_ahead_chunks_parameter_arn" {
+  value = aws_ssm_parameter.blob_read_ahead_chunks_parameter.arn
+}
+
+output "blob_cache_directory_parameter_arn" {
+  value = aws_ssm_parameter.blob_cache_directory_parameter.arn
+}
+
+output "blob_cache_max_size_mb_parameter_arn" {
+  value = aws_ssm_parameter.blob_cache_max_size_mb_parameter.arn
+}
+
+output "cache_checkpoint_file_parameter_arn" {
+  value = aws_ssm_parameter.cache_checkpoint_file_parameter.arn
+}
+
+output "cache_checkpoint_mins_parameter_arn" {
+  value = aws_ssm_parameter.cache_checkpoint_mins_parameter.arn
+}
+
+output "reader_shards_per_thread_parameter_arn" {
+  value = aws_ssm_parameter.reader_shards_per_thread_parameter.arn
+}
+
+output "realtime_applier_threads_parameter_arn" {
+  value = aws_ssm_parameter.realtime_applier_threads_parameter.arn
+}
+
+output "cache_cleanup_millis_parameter_arn" {
+  value = aws_ssm_parameter.cache_cleanup_millis_parameter.arn
+}
+
+output "cache_cleanup_pause_ms_parameter_arn" {
+  value = aws_ssm_parameter.cache_cleanup_pause_ms_parameter.arn
+}
+
+output "realtime_coalesce_millis_parameter_arn" {
+  value = aws_ssm_parameter.realtime_coalesce_millis_parameter.arn
+}
+
+output "push_delta_notifications_parameter_arn" {
+  value = aws_ssm_parameter.push_delta_notifications_parameter.arn
+}
+
+output "delta_prefetch_max_mb_parameter_arn" {
+  value = aws_ssm_parameter.delta_prefetch_max_mb_parameter.arn
+}
+
+output "udf_warm_up_invocations_parameter_arn" {
+  value = aws_ssm_parameter.udf_warm_up_invocations_parameter.arn
+}
+
+output "response_brotli_quality_parameter_arn" {
+  value = aws_ssm_parameter.response_brotli_quality_parameter.arn
+}
+
+output "response_brotli_window_parameter_arn" {
+  value = aws_ssm_parameter.response_brotli_window_parameter.arn
+}
+
+output "cache_precompute_json_values_parameter_arn" {
+  value = aws_ssm_parameter.cache_precompute_json_values_parameter.arn
+}
+
+output "v1_direct_serialization_parameter_arn" {
+  value = aws_ssm_parameter.v1_direct_serialization_parameter.arn
+}
+
+output "grpc_max_concurrent_streams_parameter_arn" {
+  value = aws_ssm_parameter.grpc_max_concurrent_streams_parameter.arn
+}
+
+output "grpc_max_threads_per_core_parameter_arn" {
+  value = aws_ssm_parameter.grpc_max_threads_per_core_parameter.arn
+}
+
+output "grpc_memory_quota_mb_parameter_arn" {
+  value = aws_ssm_parameter.grpc_memory_quota_mb_parameter.arn
+}
+
+output "admission_max_in_flight_parameter_arn" {
+  value = aws_ssm_parameter.admission_max_in_flight_parameter.arn
+}
+
+output "admission_critical_reserve_percent_parameter_arn" {
+  value = aws_ssm_parameter.admission_critical_reserve_percent_parameter.arn
+}
+
+output "admission_latency_target_ms_parameter_arn" {
+  value = aws_ssm_parameter.admission_latency_target_ms_parameter.arn
+}
+
+output "lookup_batch_window_micros_parameter_arn" {
+  value = aws_ssm_parameter.lookup_batch_window_micros_parameter.arn
+}
+
+output "lookup_batch_max_keys_parameter_arn" {
+  value = aws_ssm_parameter.lookup_batch_max_keys_parameter.arn
+}
+
+output "lookup_key_filter_interval_ms_parameter_arn" {
+  value = aws_ssm_parameter.lookup_key_filter_interval_ms_parameter.arn
+}
+
+output "lookup_key_filter_bits_per_key_parameter_arn" {
+  value = aws_ssm_parameter.lookup_key_filter_bits_per_key_parameter.arn
+}
+
+output "lookup_cache_max_entries_parameter_arn" {
+  value = aws_ssm_parameter.lookup_cache_max_entries_parameter.arn
+}
+
+output "lookup_cache_ttl_ms_parameter_arn" {
+  value = aws_ssm_parameter.lookup_cache_ttl_ms_parameter.arn
+}
+
+output "use_siphash_sharding_parameter_arn" {
+  value = aws_ssm_parameter.use_siphash_sharding_parameter.arn
+}
+
+output "num_logical_shards_parameter_arn" {
+  value = aws_ssm_parameter.num_logical_shards_parameter.arn
+}
+
+output "trust_data_file_records_parameter_arn" {
+  value = aws_ssm_parameter.trust_data_file_records_parameter.arn
+}
+
+output "serving_cpus_parameter_arn" {
+  value = aws_ssm_parameter.serving_cpus_parameter.arn
+}
+
+output "serving_memory_policy_parameter_arn" {
+  value = aws_ssm_parameter.serving_memory_policy_parameter.arn
+}
+
+output "data_loading_cpus_parameter_arn" {
+  value = aws_ssm_parameter.data_loading_cpus_parameter.arn
+}
+
+output "data_loading_memory_policy_parameter_arn" {
+  value = aws_ssm_parameter.data_loading_memory_policy_parameter.arn
+}
+
+output "data_loading_max_records_per_second_parameter_arn" {
+  value = aws_ssm_parameter.data_loading_max_records_per_second_parameter.arn
+}
+
+output "data_loading_min_records_per_second_parameter_arn" {
+  value = aws_ssm_parameter.data_loading_min_records_per_second_parameter.arn
+}
+
+output "data_loading_latency_target_ms_parameter_arn" {
+  value = aws_ssm_parameter.data_loading_latency_target_ms_parameter.arn
+}
+
+output "snapshot_reload_mins_parameter_arn" {
+  value = aws_ssm_parameter.snapshot_reload_mins_parameter.arn
+}
+
+output "readiness_max_lag_secs_parameter_arn" {
+  value = aws_ssm_parameter.readiness_max_lag_secs_parameter.arn
+}
+
+output "use_data_file_manifest_parameter_arn" {
+  value = aws_ssm_parameter.use_data_file_manifest_parameter.arn
+}
+
+output "cache_compress_values_parameter_arn" {
+  value = aws_ssm_parameter.cache_compress_values_parameter.arn
+}
+
+output "cache_deduplicate_values_parameter_arn" {
+  value = aws_ssm_parameter.cache_deduplicate_values_parameter.arn
+}
+
+output "cache_cold_value_directory_parameter_arn" {
+  value = aws_ssm_parameter.cache_cold_value_directory_parameter.arn
+}
+
+output "cache_max_hot_value_mb_parameter_arn" {
+  value = aws_ssm_parameter.cache_max_hot_value_mb_parameter.arn
+}
+
+output "cache_isolate_prefixes_parameter_arn" {
+  value = aws_ssm_parameter.cache_isolate_prefixes_parameter.arn
+}
+
+output "cache_index_set_values_parameter_arn" {
+  value = aws_ssm_parameter.cache_index_set_values_parameter.arn
+}
+
+output "query_evaluation_threads_parameter_arn" {
+  value = aws_ssm_parameter.query_evaluation_threads_parameter.arn
+}
+
+output "lookup_response_compression_min_bytes_parameter_arn" {
+  value = aws_ssm_parameter.lookup_response_compression_min_bytes_parameter.arn
+}
+
+output "v1_merge_namespace_lookups_parameter_arn" {
+  value = aws_ssm_parameter.v1_merge_namespace_lookups_parameter.arn
+}
+
+output "udf_batch_window_us_parameter_arn" {
+  value = aws_ssm_parameter.udf_batch_window_us_parameter.arn
+}
+
+output "udf_max_batch_size_parameter_arn" {
+  value = aws_ssm_parameter.udf_max_batch_size_parameter.arn
+}
+
+output "udf_cache_max_mb_parameter_arn" {
+  value = aws_ssm_parameter.udf_cache_max_mb_parameter.arn
+}
+
+output "realtime_max_receivers_parameter_arn" {
+  value = aws_ssm_parameter.realtime_max_receivers_parameter.arn
+}
+
+output "load_compacted_delta_files_parameter_arn" {
+  value = aws_ssm_parameter.load_compacted_delta_files_parameter.arn
+}
+
+output "data_loading_apply_threads_parameter_arn" {
+  value = aws_ssm_parameter.data_loading_apply_threads_parameter.arn
+}
+
+output "download_snapshot_files_parameter_arn" {
+  value = aws_ssm_parameter.download_snapshot_files_parameter.arn
+}
+
+output "heap_allocator_max_per_cpu_cache_bytes_parameter_arn" {
+  value = aws_ssm_parameter.heap_allocator_max_per_cpu_cache_bytes_parameter.arn
+}
+
+output "release_heap_memory_after_loading_parameter_arn" {
+  value = aws_ssm_parameter.release_heap_memory_after_loading_parameter.arn
+}
+
+output "cache_use_huge_pages_parameter_arn" {
+  value = aws_ssm_parameter.cache_use_huge_pages_parameter.arn
+}
+
+output "response_cache_max_entries_parameter_arn" {
+  value = aws_ssm_parameter.response_cache_max_entries_parameter.arn
+}
+
+output "response_cache_ttl_ms_parameter_arn" {
+  value = aws_ssm_parameter.response_cache_ttl_ms_parameter.arn
+}
+
+output "bulk_load_snapshots_parameter_arn" {
+  value = aws_ssm_parameter.bulk_load_snapshots_parameter.arn
+}
+
+output "cache_index_keys_parameter_arn" {
+  value = aws_ssm_parameter.cache_index_keys_parameter.arn
+}
+
+output "lookup_plan_queries_with_set_sizes_parameter_arn" {
+  value = aws_ssm_parameter.lookup_plan_queries_with_set_sizes_parameter.arn
+}
+
+output "cache_hot_key_sample_rate_parameter_arn" {
+  value = aws_ssm_parameter.cache_hot_key_sample_rate_parameter.arn
+}
+
+output "data_loading_priority_prefixes_parameter_arn" {
+  value = aws_ssm_parameter.data_loading_priority_prefixes_parameter.arn
+}
@@ -188,3 +188,393 @@ variable "public_key_endpoint_parameter_value" {
   description = "Public key endpoint. Can only be overriden in non-prod mode."
   type        = string
 }
+
+variable "cache_num_segments_parameter_value" {
+  description = "Number of independently locked segments in the key value cache. Values greater than 1 enable the sharded cache, which reduces lock contention between reads and updates."
+  type        = number
+}
+
+variable "use_epoch_based_cache_parameter_value" {
+  description = "Whether key-value lookups use the epoch based cache, which reads without taking locks. Takes precedence over cache_num_segments."
+  type        = bool
+}
+
+variable "cache_intern_set_values_parameter_value" {
+  description = "Whether the key value cache interns set values as 32 bit ids so queries run as bitmap set operations."
+  type        = bool
+}
+
+variable "lookup_hedge_percentile_parameter_value" {
+  description = "Percentile of recent remote shard lookup latencies after which a lookup is also sent to another replica of the shard. 0 disables hedged lookups."
+  type        = number
+}
+
+variable "lookup_skip_empty_shards_parameter_value" {
+  description = "Whether sharded lookups skip shards without keys instead of sending them padded requests. Reveals which shards a request touches."
+  type        = bool
+}
+
+variable "lookup_padding_bucket_parameter_value" {
+  description = "Pads sharded lookup requests to a multiple of this many bytes. 0 pads every shard request to the largest one."
+  type        = number
+}
+
+variable "lookup_query_pushdown_parameter_value" {
+  description = "Whether the parts of a query whose sets are all on one shard are run on that shard, instead of fetching the sets. All servers must support it."
+  type        = bool
+}
+
+variable "lookup_channels_per_replica_parameter_value" {
+  description = "Number of gRPC channels, each with its own connection, to each replica of the other shards."
+  type        = number
+}
+
+variable "lookup_keepalive_ms_parameter_value" {
+  description = "Interval in milliseconds of the keepalive pings between shards. 0 disables keepalive pings."
+  type        = number
+}
+
+variable "data_loading_concurrency_parameter_value" {
+  description = "Number of snapshot or delta files loaded at the same time when initializing the cache."
+  type        = number
+}
+
+variable "blob_read_ahead_chunks_parameter_value" {
+  description = "Number of ranges of a data file read ahead, concurrently, of the one being loaded. 0 disables reading ahead."
+  type        = number
+}
+
+variable "blob_cache_directory_parameter_value" {
+  description = "Directory in which data files are cached across restarts. Empty disables the cache."
+  type        = string
+}
+
+variable "blob_cache_max_size_mb_parameter_value" {
+  description = "If positive, maximum size in MB of the cached data files."
+  type        = number
+}
+
+variable "cache_checkpoint_file_parameter_value" {
+  description = "File to which the cache is checkpointed and from which it is restored on startup. Empty disables checkpoints."
+  type        = string
+}
+
+variable "cache_checkpoint_mins_parameter_value" {
+  description = "Minimum number of minutes between cache checkpoints."
+  type        = number
+}
+
+variable "reader_shards_per_thread_parameter_value" {
+  description = "Number of shards data files are split into per data loading thread. Threads that finish their shards early read the remaining ones."
+  type        = number
+}
+
+variable "realtime_applier_threads_parameter_value" {
+  description = "Number of threads applying realtime updates. 0 applies them on the thread receiving them."
+  type        = number
+}
+
+variable "cache_cleanup_millis_parameter_value" {
+  description = "Interval between removals of deleted keys from the cache on a background thread. 0 removes them after loading every file."
+  type        = number
+}
+
+variable "cache_cleanup_pause_ms_parameter_value" {
+  description = "Maximum time the background removal of deleted keys locks a map of the cache at once."
+  type        = number
+}
+
+variable "realtime_coalesce_millis_parameter_value" {
+  description = "Window in which realtime updates are coalesced, keeping the latest update of every key, before being applied together. 0 applies every update as it arrives."
+  type        = number
+}
+
+variable "push_delta_notifications_parameter_value" {
+  description = "Whether new delta files are loaded as they are notified, and only listed every backup poll to find lost notifications."
+  type        = bool
+}
+
+variable "delta_prefetch_max_mb_parameter_value" {
+  description = "If positive, the next queued delta file is downloaded while the current one is loaded, unless it is larger than this many MB."
+  type        = number
+}
+
+variable "udf_warm_up_invocations_parameter_value" {
+  description = "Number of times every UDF worker runs new UDF code before requests use it."
+  type        = number
+}
+
+variable "response_brotli_quality_parameter_value" {
+  description = "Brotli quality of compressed V2 responses, from 0 to 11. Lower is faster."
+  type        = number
+}
+
+variable "response_brotli_window_parameter_value" {
+  description = "Base 2 logarithm of the Brotli window size of compressed V2 responses, from 10 to 24."
+  type        = number
+}
+
+variable "cache_precompute_json_values_parameter_value" {
+  description = "Whether the cache parses values as JSON once when they are loaded, so that V1 lookups do not parse them on every request."
+  type        = bool
+}
+
+variable "v1_direct_serialization_parameter_value" {
+  description = "Whether V1 responses are serialized directly from the cache values instead of being built as protos."
+  type        = bool
+}
+
+variable "grpc_max_concurrent_streams_parameter_value" {
+  description = "If positive, maximum number of concurrent streams of every connection to the gRPC server."
+  type        = number
+}
+
+variable "grpc_max_threads_per_core_parameter_value" {
+  description = "If positive, maximum number of threads of the gRPC server per CPU core."
+  type        = number
+}
+
+variable "grpc_memory_quota_mb_parameter_value" {
+  description = "If positive, maximum memory in MB that the gRPC server uses for its connections and calls."
+  type        = number
+}
+
+variable "admission_max_in_flight_parameter_value" {
+  description = "Maximum number of requests in flight before requests are shed. 0 disables load shedding."
+  type        = number
+}
+
+variable "admission_critical_reserve_percent_parameter_value" {
+  description = "Percentage of admission-max-in-flight reserved to requests with the critical priority hint."
+  type        = number
+}
+
+variable "admission_latency_target_ms_parameter_value" {
+  description = "Average request latency in milliseconds above which requests without the critical priority hint are shed earlier. 0 disables the latency signal."
+  type        = number
+}
+
+variable "lookup_batch_window_micros_parameter_value" {
+  description = "Time in microseconds the lookup server of a shard waits to merge concurrent lookups into one cache lookup. 0 disables batching."
+  type        = number
+}
+
+variable "lookup_batch_max_keys_parameter_value" {
+  description = "Number of keys at which a batch of lookups on the lookup server of a shard is looked up before the end of its window."
+  type        = number
+}
+
+variable "lookup_key_filter_interval_ms_parameter_value" {
+  description = "Interval in milliseconds at which each shard rebuilds the Bloom filter of its keys, and the other shards fetch it to skip lookups of keys that the shard does not have. 0 disables key filters. Only used when sharded."
+  type        = number
+}
+
+variable "lookup_key_filter_bits_per_key_parameter_value" {
+  description = "Bits per key of the shard key filters. More bits lower the false positive rate at the cost of memory and transfer size. Only used when sharded."
+  type        = number
+}
+
+variable "lookup_cache_max_entries_parameter_value" {
+  description = "Maximum number of keys whose sharded lookup results are cached for the UDF hooks. 0 disables the lookup cache. Only used when sharded."
+  type        = number
+}
+
+variable "lookup_cache_ttl_ms_parameter_value" {
+  description = "Time in milliseconds for which a cached sharded lookup result is served, unless a mutation of its key is loaded first. Only used when sharded."
+  type        = number
+}
+
+variable "use_siphash_sharding_parameter_value" {
+  description = "Whether keys are sharded with SipHash instead of SHA-256, which is several times faster but assigns keys to different shards. Data files written for a shard must be sharded the same way. Only used when sharded."
+  type        = bool
+}
+
+variable "num_logical_shards_parameter_value" {
+  description = "Number of logical shards that keys are hashed into and that are mapped to the num_shards physical shards, so that changing num_shards only moves whole logical shards. 0 hashes keys into the physical shards directly. Only used if num_shards is greater than 1."
+  type        = number
+}
+
+variable "trust_data_file_records_parameter_value" {
+  description = "If true, records of snapshot and delta files are decoded without verifying their flatbuffers, relying on the chunk hashes of the files."
+  type        = bool
+}
+
+variable "serving_cpus_parameter_value" {
+  description = "CPUs of the threads that serve requests, e.g. 0-15,32-47. Empty runs them on any CPU."
+  type        = string
+}
+
+variable "serving_memory_policy_parameter_value" {
+  description = "NUMA policy of the memory of the threads that serve requests, local or interleave. Empty is local."
+  type        = string
+}
+
+variable "data_loading_cpus_parameter_value" {
+  description = "CPUs of the threads that load data into the cache, e.g. 16-31,48-63. Empty runs them on the serving CPUs."
+  type        = string
+}
+
+variable "data_loading_memory_policy_parameter_value" {
+  description = "NUMA policy of the memory of the threads that load data into the cache, and so of the cache, local or interleave. Empty is local."
+  type        = string
+}
+
+variable "data_loading_max_records_per_second_parameter_value" {
+  description = "If positive, maximum number of records of new data files loaded per second, so that loading leaves CPU to serving. Files of the initial load and realtime updates are not throttled."
+  type        = number
+}
+
+variable "data_loading_min_records_per_second_parameter_value" {
+  description = "Number of records of new data files loaded per second however high the serving latency is, which bounds how far loading falls behind. Only used if data_loading_max_records_per_second is positive."
+  type        = number
+}
+
+variable "data_loading_latency_target_ms_parameter_value" {
+  description = "If positive, the loading rate of new data files halves whenever the average serving latency exceeds this many milliseconds, and grows back while it is under. Only used if data_loading_max_records_per_second is positive."
+  type        = number
+}
+
+variable "snapshot_reload_mins_parameter_value" {
+  description = "If positive, checks for new snapshot files every this many minutes. When there are some, they are loaded with the newer delta files into a new cache in the background, which replaces the current cache once loaded. Memory has to fit both caches. 0 only loads snapshot files on startup."
+  type        = number
+}
+
+variable "readiness_max_lag_secs_parameter_value" {
+  description = "If positive, the server is only ready once initialized and the delta files of every prefix available on startup are loaded, and no file waits to be loaded for longer than this many seconds. 0 makes it ready once initialized."
+  type        = number
+}
+
+variable "use_data_file_manifest_parameter_value" {
+  description = "If true, data files are listed from the DATA_FILE_MANIFEST file of their directory, if any, and only the files named after it are listed from blob storage. The data pipeline must rewrite the manifest whenever it deletes data files."
+  type        = bool
+}
+
+variable "cache_compress_values_parameter_value" {
+  description = "Whether the cache stores values compressed with zstd, with a dictionary per prefix trained on its first loaded values. Not supported by the epoch based cache."
+  type        = bool
+}
+
+variable "cache_deduplicate_values_parameter_value" {
+  description = "Whether the cache stores identical values of different keys once. Not supported by the epoch based cache."
+  type        = bool
+}
+
+variable "cache_cold_value_directory_parameter_value" {
+  description = "Directory on local disk, preferably on an SSD, that the cache spills the values looked up the least into. Values are all kept in memory if empty. Requires the background cleanup, not supported by the epoch based cache."
+  type        = string
+}
+
+variable "cache_max_hot_value_mb_parameter_value" {
+  description = "Megabytes of values that the cache keeps in memory when it spills values to disk."
+  type        = number
+}
+
+variable "cache_isolate_prefixes_parameter_value" {
+  description = "Whether the cache keeps the data of every prefix in a sub-cache of its own, so that loading or cleaning up one data source does not block the others. Takes precedence over cache_num_segments and cache_cold_value_directory."
+  type        = bool
+}
+
+variable "cache_index_set_values_parameter_value" {
+  description = "Whether the cache keeps an index from every value of the key-value sets to the keys whose sets hold it, which UDFs read with getKeysContaining."
+  type        = bool
+}
+
+variable "query_evaluation_threads_parameter_value" {
+  description = "Number of threads that evaluate the independent operands of large set queries in parallel. 0 evaluates queries on the request thread only."
+  type        = number
+}
+
+variable "lookup_response_compression_min_bytes_parameter_value" {
+  description = "Minimum size in bytes of the responses of remote shards that they compress with zstd, which trades their CPU for network bandwidth on large key sets. 0 disables compression."
+  type        = number
+}
+
+variable "v1_merge_namespace_lookups_parameter_value" {
+  description = "Whether the V1 API looks up the keys of all the namespaces of a request at once, with one cache lookup, rather than one lookup per namespace. The namespaces of large requests are then processed concurrently on the query evaluation threads, if any."
+  type        = bool
+}
+
+variable "udf_batch_window_us_parameter_value" {
+  description = "How long, in microseconds, a UDF execution waits for concurrent executions of the same code object to run together in one invocation of its batch handler. Only applies to code objects with a batch handler. 0 disables batching."
+  type        = number
+}
+
+variable "udf_max_batch_size_parameter_value" {
+  description = "Most UDF executions that run together in one invocation of the batch handler."
+  type        = number
+}
+
+variable "udf_cache_max_mb_parameter_value" {
+  description = "Most megabytes of values that UDFs keep in the cache of the cacheGet and cachePut functions. 0 disables the cache."
+  type        = number
+}
+
+variable "realtime_max_receivers_parameter_value" {
+  description = "Maximum number of threads receiving realtime updates from the queue of each realtime notifier. Receivers are added while the queue holds more than 100 messages per receiver."
+  type        = number
+}
+
+variable "load_compacted_delta_files_parameter_value" {
+  description = "Whether to load the compacted delta files written by data_cli compact_deltas in place of the delta files they include."
+  type        = bool
+}
+
+variable "data_loading_apply_threads_parameter_value" {
+  description = "Number of threads that apply the batches of records read from a data file to the cache, while the data-loading-num-threads threads keep reading and decompressing the file. If 0, records are applied on the reading threads."
+  type        = number
+}
+
+variable "download_snapshot_files_parameter_value" {
+  description = "Whether snapshot files are downloaded into memory with parallel range reads before they are loaded, rather than streamed."
+  type        = bool
+}
+
+variable "heap_allocator_max_per_cpu_cache_bytes_parameter_value" {
+  description = "Maximum bytes of free memory the heap allocator caches for every CPU. Smaller caches make memory freed by some threads available to the others. 0 keeps the allocator default."
+  type        = number
+}
+
+variable "release_heap_memory_after_loading_parameter_value" {
+  description = "Whether to return the free heap memory to the OS after the initial data load and after every snapshot reload, so that the resident memory drops back from its peak while loading."
+  type        = bool
+}
+
+variable "cache_use_huge_pages_parameter_value" {
+  description = "Whether the slabs that the cache stores keys and values in are backed by transparent huge pages, which saves TLB misses on lookups in large caches."
+  type        = bool
+}
+
+variable "response_cache_max_entries_parameter_value" {
+  description = "Most responses to V2 requests cached and served to identical requests, evicting the least recently used. Zero disables the response cache. It is also disabled with more than one shard, since updates to the values of other shards would not invalidate it."
+  type        = number
+}
+
+variable "response_cache_ttl_ms_parameter_value" {
+  description = "Milliseconds a cached response to a V2 request is served for. Responses are also dropped when data is loaded."
+  type        = number
+}
+
+variable "bulk_load_snapshots_parameter_value" {
+  description = "Whether snapshot files loaded into an empty cache are staged and the cache is built from them at once, rather than applying their records one by one. Takes memory for a copy of the records while the cache is built."
+  type        = bool
+}
+
+variable "cache_index_keys_parameter_value" {
+  description = "Whether the cache keeps its keys in order, which UDFs read with getValuesByPrefix. Not supported by the epoch based cache."
+  type        = bool
+}
+
+variable "lookup_plan_queries_with_set_sizes_parameter_value" {
+  description = "Whether runQuery on sharded servers first looks up the sizes of the sets of a query, which order its evaluation and skip fetching the sets that cannot change the result, at the cost of one more round trip per query."
+  type        = bool
+}
+
+variable "cache_hot_key_sample_rate_parameter_value" {
+  description = "Samples one in this many lookups of the cache to find the keys looked up the most, which the admin profiling service returns. 0 disables the sampling. Not supported by the epoch based cache."
+  type        = number
+}
+
+variable "data_loading_priority_prefixes_parameter_value" {
+  description = "Comma separated prefixes of data_loading_blob_prefix_allowlist loaded first on startup, in order. Every one is loaded from its snapshot to its last delta file before the next starts, using all the data_loading_concurrency, so that it can be served while the others load. The other prefixes are loaded together after them."
+  type        = string
+}
@@ -107,5 +107,84 @@ module "kv_server" {
     enable-external-traffic                    = var.enable_external_traffic
     telemetry-config                           = var.telemetry_config
     data-loading-blob-prefix-allowlist         = var.data_loading_blob_prefix_allowlist
+    cache-num-segments                         = var.cache_num_segments
+    use-epoch-based-cache                      = var.use_epoch_based_cache
+    cache-intern-set-values                    = var.cache_intern_set_values
+    lookup-hedge-percentile                    = var.lookup_hedge_percentile
+    lookup-skip-empty-shards                   = var.lookup_skip_empty_shards
+    lookup-padding-bucket                      = var.lookup_padding_bucket
+    lookup-query-pushdown                      = var.lookup_query_pushdown
+    lookup-channels-per-replica                = var.lookup_channels_per_replica
+    lookup-keepalive-ms                        = var.lookup_keepalive_ms
+    data-loading-concurrency                   = var.data_loading_concurrency
+    blob-read-ahead-chunks                     = var.blob_read_ahead_chunks
+    blob-cache-directory                       = var.blob_cache_directory
+    blob-cache-max-size-mb                     = var.blob_cache_max_size_mb
+    cache-checkpoint-file                      = var.cache_checkpoint_file
+    cache-checkpoint-mins                      = var.cache_checkpoint_mins
+    reader-shards-per-thread                   = var.reader_shards_per_thread
+    cache-cleanup-millis                       = var.cache_cleanup_millis
+    cache-cleanup-pause-ms                     = var.cache_cleanup_pause_ms
+    realtime-coalesce-millis                   = var.realtime_coalesce_millis
+    push-delta-notifications                   = var.push_delta_notifications
+    delta-prefetch-max-mb                      = var.delta_prefetch_max_mb
+    udf-warm-up-invocations                    = var.udf_warm_up_invocations
+    response-brotli-quality                    = var.response_brotli_quality
+    response-brotli-window                     = var.response_brotli_window
+    cache-precompute-json-values               = var.cache_precompute_json_values
+    v1-direct-serialization                    = var.v1_direct_serialization
+    grpc-max-concurrent-streams                = var.grpc_max_concurrent_streams
+    grpc-max-threads-per-core                  = var.grpc_max_threads_per_core
+    grpc-memory-quota-mb                       = var.grpc_memory_quota_mb
+    admission-max-in-flight                    = var.admission_max_in_flight
+    admission-critical-reserve-percent         = var.admission_critical_reserve_percent
+    admission-latency-target-ms                = var.admission_latency_target_ms
+    lookup-batch-window-micros                 = var.lookup_batch_window_micros
+    lookup-batch-max-keys                      = var.lookup_batch_max_keys
+    lookup-key-filter-interval-ms              = var.lookup_key_filter_interval_ms
+    lookup-key-filter-bits-per-key             = var.lookup_key_filter_bits_per_key
+    lookup-cache-max-entries                   = var.lookup_cache_max_entries
+    lookup-cache-ttl-ms                        = var.lookup_cache_ttl_ms
+    use-siphash-sharding                       = var.use_siphash_sharding
+    num-logical-shards                         = var.num_logical_shards
+    trust-data-file-records                    = var.trust_data_file_records
+    serving-cpus                               = var.serving_cpus
+    serving-memory-policy                      = var.serving_memory_policy
+    data-loading-cpus                          = var.data_loading_cpus
+    data-loading-memory-policy                 = var.data_loading_memory_policy
+    data-loading-max-records-per-second        = var.data_loading_max_records_per_second
+    data-loading-min-records-per-second        = var.data_loading_min_records_per_second
+    data-loading-latency-target-ms             = var.data_loading_latency_target_ms
+    snapshot-reload-mins                       = var.snapshot_reload_mins
+    readiness-max-lag-secs                     = var.readiness_max_lag_secs
+    use-data-file-manifest                     = var.use_data_file_manifest
+    cache-compress-values                      = var.cache_compress_values
+    cache-deduplicate-values                   = var.cache_deduplicate_values
+    cache-cold-value-directory                 = var.cache_cold_value_directory
+    cache-max-hot-value-mb                     = var.cache_max_hot_value_mb
+    cache-isolate-prefixes                     = var.cache_isolate_prefixes
+    cache-index-set-values                     = var.cache_index_set_values
+    cache-index-keys                           = var.cache_index_keys
+    cache-hot-key-sample-rate                  = var.cache_hot_key_sample_rate
+    data-loading-priority-prefixes             = var.data_loading_priority_prefixes
+    lookup-plan-queries-with-set-sizes         = var.lookup_plan_queries_with_set_sizes
+    query-evaluation-threads                   = var.query_evaluation_threads
+    lookup-response-compression-min-bytes      = var.lookup_response_compression_min_bytes
+    v1-merge-namespace-lookups                 = var.v1_merge_namespace_lookups
+    udf-batch-window-us                        = var.udf_batch_window_us
+    udf-max-batch-size                         = var.udf_max_batch_size
+    udf-cache-max-mb                           = var.udf_cache_max_mb
+    realtime-applier-threads                   = var.realtime_applier_threads
+    realtime-max-outstanding-messages          = var.realtime_max_outstanding_messages
+    realtime-max-outstanding-mb                = var.realtime_max_outstanding_mb
+    load-compacted-delta-files                 = var.load_compacted_delta_files
+    data-loading-apply-threads                 = var.data_loading_apply_threads
+    download-snapshot-files                    = var.download_snapshot_files
+    heap-allocator-max-per-cpu-cache-bytes     = var.heap_allocator_max_per_cpu_cache_bytes
+    release-heap-memory-after-loading          = var.release_heap_memory_after_loading
+    cache-use-huge-pages                       = var.cache_use_huge_pages
+    response-cache-max-entries                 = var.response_cache_max_entries
+    response-cache-ttl-ms                      = var.response_cache_ttl_ms
+    bulk-load-snapshots                        = var.bulk_load_snapshots
   }
 }
@@ -352,3 +352,477 @@ variable "public_key_endpoint" {
   description = "Public key endpoint. Can only be overriden in non-prod mode."
   type        = string
 }
+
+variable "cache_num_segments" {
+  description = "Number of independently locked segments in the key value cache. Values greater than 1 enable the sharded cache, which reduces lock contention between reads and updates."
+  default     = 1
+  type        = number
+}
+
+variable "use_epoch_based_cache" {
+  description = "Whether key-value lookups use the epoch based cache, which reads without taking locks. Takes precedence over cache_num_segments."
+  default     = false
+  type        = bool
+}
+
+variable "cache_intern_set_values" {
+  description = "Whether the key value cache interns set values as 32 bit ids so queries run as bitmap set operations."
+  default     = false
+  type        = bool
+}
+
+variable "lookup_hedge_percentile" {
+  description = "Percentile of recent remote shard lookup latencies after which a lookup is also sent to another replica of the shard. 0 disables hedged lookups."
+  default     = 0
+  type        = number
+}
+
+variable "lookup_skip_empty_shards" {
+  description = "Whether sharded lookups skip shards without keys instead of sending them padded requests. Reveals which shards a request touches."
+  default     = false
+  type        = bool
+}
+
+variable "lookup_padding_bucket" {
+  description = "Pads sharded lookup requests to a multiple of this many bytes. 0 pads every shard request to the largest one."
+  default     = 0
+  type        = number
+}
+
+variable "lookup_query_pushdown" {
+  description = "Whether the parts of a query whose sets are all on one shard are run on that shard, instead of fetching the sets. All servers must support it."
+  default     = false
+  type        = bool
+}
+
+variable "lookup_channels_per_replica" {
+  description = "Number of gRPC channels, each with its own connection, to each replica of the other shards."
+  default     = 1
+  type        = number
+}
+
+variable "lookup_keepalive_ms" {
+  description = "Interval in milliseconds of the keepalive pings between shards. 0 disables keepalive pings."
+  default     = 0
+  type        = number
+}
+
+variable "data_loading_concurrency" {
+  description = "Number of snapshot or delta files loaded at the same time when initializing the cache."
+  default     = 1
+  type        = number
+}
+
+variable "blob_read_ahead_chunks" {
+  description = "Number of ranges of a data file read ahead, concurrently, of the one being loaded. 0 disables reading ahead."
+  default     = 0
+  type        = number
+}
+
+variable "blob_cache_directory" {
+  description = "Directory in which data files are cached across restarts. Empty disables the cache."
+  default     = ""
+  type        = string
+}
+
+variable "blob_cache_max_size_mb" {
+  description = "If positive, maximum size in MB of the cached data files."
+  default     = 0
+  type        = number
+}
+
+variable "cache_checkpoint_file" {
+  description = "File to which the cache is checkpointed and from which it is restored on startup. Empty disables checkpoints."
+  default     = ""
+  type        = string
+}
+
+variable "cache_checkpoint_mins" {
+  description = "Minimum number of minutes between cache checkpoints."
+  default     = 10
+  type        = number
+}
+
+variable "reader_shards_per_thread" {
+  description = "Number of shards data files are split into per data loading thread. Threads that finish their shards early read the remaining ones."
+  default     = 1
+  type        = number
+}
+
+variable "cache_cleanup_millis" {
+  description = "Interval between removals of deleted keys from the cache on a background thread. 0 removes them after loading every file."
+  default     = 0
+  type        = number
+}
+
+variable "cache_cleanup_pause_ms" {
+  description = "Maximum time the background removal of deleted keys locks a map of the cache at once."
+  default     = 1
+  type        = number
+}
+
+variable "realtime_coalesce_millis" {
+  description = "Window in which realtime updates are coalesced, keeping the latest update of every key, before being applied together. 0 applies every update as it arrives."
+  default     = 0
+  type        = number
+}
+
+variable "push_delta_notifications" {
+  description = "Whether new delta files are loaded as they are notified, and only listed every backup poll to find lost notifications."
+  default     = false
+  type        = bool
+}
+
+variable "delta_prefetch_max_mb" {
+  description = "If positive, the next queued delta file is downloaded while the current one is loaded, unless it is larger than this many MB."
+  default     = 0
+  type        = number
+}
+
+variable "udf_warm_up_invocations" {
+  description = "Number of times every UDF worker runs new UDF code before requests use it."
+  default     = 0
+  type        = number
+}
+
+variable "response_brotli_quality" {
+  description = "Brotli quality of compressed V2 responses, from 0 to 11. Lower is faster."
+  default     = 11
+  type        = number
+}
+
+variable "response_brotli_window" {
+  description = "Base 2 logarithm of the Brotli window size of compressed V2 responses, from 10 to 24."
+  default     = 22
+  type        = number
+}
+
+variable "cache_precompute_json_values" {
+  description = "Whether the cache parses values as JSON once when they are loaded, so that V1 lookups do not parse them on every request."
+  default     = false
+  type        = bool
+}
+
+variable "v1_direct_serialization" {
+  description = "Whether V1 responses are serialized directly from the cache values instead of being built as protos."
+  default     = false
+  type        = bool
+}
+
+variable "grpc_max_concurrent_streams" {
+  description = "If positive, maximum number of concurrent streams of every connection to the gRPC server."
+  default     = 0
+  type        = number
+}
+
+variable "grpc_max_threads_per_core" {
+  description = "If positive, maximum number of threads of the gRPC server per CPU core."
+  default     = 0
+  type        = number
+}
+
+variable "grpc_memory_quota_mb" {
+  description = "If positive, maximum memory in MB that the gRPC server uses for its connections and calls."
+  default     = 0
+  type        = number
+}
+
+variable "admission_max_in_flight" {
+  description = "Maximum number of requests in flight before requests are shed. 0 disables load shedding."
+  default     = 0
+  type        = number
+}
+
+variable "admission_critical_reserve_percent" {
+  description = "Percentage of admission-max-in-flight reserved to requests with the critical priority hint."
+  default     = 20
+  type        = number
+}
+
+variable "admission_latency_target_ms" {
+  description = "Average request latency in milliseconds above which requests without the critical priority hint are shed earlier. 0 disables the latency signal."
+  default     = 0
+  type        = number
+}
+
+variable "lookup_batch_window_micros" {
+  description = "Time in microseconds the lookup server of a shard waits to merge concurrent lookups into one cache lookup. 0 disables batching."
+  default     = 0
+  type        = number
+}
+
+variable "lookup_batch_max_keys" {
+  description = "Number of keys at which a batch of lookups on the lookup server of a shard is looked up before the end of its window."
+  default     = 1000
+  type        = number
+}
+
+variable "lookup_key_filter_interval_ms" {
+  description = "Interval in milliseconds at which each shard rebuilds the Bloom filter of its keys, and the other shards fetch it to skip lookups of keys that the shard does not have. 0 disables key filters. Only used when sharded."
+  default     = 0
+  type        = number
+}
+
+variable "lookup_key_filter_bits_per_key" {
+  description = "Bits per key of the shard key filters. More bits lower the false positive rate at the cost of memory and transfer size. Only used when sharded."
+  default     = 10
+  type        = number
+}
+
+variable "lookup_cache_max_entries" {
+  description = "Maximum number of keys whose sharded lookup results are cached for the UDF hooks. 0 disables the lookup cache. Only used when sharded."
+  default     = 0
+  type        = number
+}
+
+variable "lookup_cache_ttl_ms" {
+  description = "Time in milliseconds for which a cached sharded lookup result is served, unless a mutation of its key is loaded first. Only used when sharded."
+  default     = 1000
+  type        = number
+}
+
+variable "use_siphash_sharding" {
+  description = "Whether keys are sharded with SipHash instead of SHA-256, which is several times faster but assigns keys to different shards. Data files written for a shard must be sharded the same way. Only used when sharded."
+  default     = false
+  type        = bool
+}
+
+variable "num_logical_shards" {
+  description = "Number of logical shards that keys are hashed into and that are mapped to the num_shards physical shards, so that changing num_shards only moves whole logical shards. 0 hashes keys into the physical shards directly. Only used if num_shards is greater than 1."
+  default     = 0
+  type        = number
+}
+
+variable "trust_data_file_records" {
+  description = "If true, records of snapshot and delta files are decoded without verifying their flatbuffers, relying on the chunk hashes of the files."
+  default     = false
+  type        = bool
+}
+
+variable "serving_cpus" {
+  description = "CPUs of the threads that serve requests, e.g. 0-15,32-47. Empty runs them on any CPU."
+  default     = ""
+  type        = string
+}
+
+variable "serving_memory_policy" {
+  description = "NUMA policy of the memory of the threads that serve requests, local or interleave. Empty is local."
+  default     = ""
+  type        = string
+}
+
+variable "data_loading_cpus" {
+  description = "CPUs of the threads that load data into the cache, e.g. 16-31,48-63. Empty runs them on the serving CPUs."
+  default     = ""
+  type        = string
+}
+
+variable "data_loading_memory_policy" {
+  description = "NUMA policy of the memory of the threads that load data into the cache, and so of the cache, local or interleave. Empty is local."
+  default     = ""
+  type        = string
+}
+
+variable "data_loading_max_records_per_second" {
+  description = "If positive, maximum number of records of new data files loaded per second, so that loading leaves CPU to serving. Files of the initial load and realtime updates are not throttled."
+  default     = 0
+  type        = number
+}
+
+variable "data_loading_min_records_per_second" {
+  description = "Number of records of new data files loaded per second however high the serving latency is, which bounds how far loading falls behind. Only used if data_loading_max_records_per_second is positive."
+  default     = 0
+  type        = number
+}
+
+variable "data_loading_latency_target_ms" {
+  description = "If positive, the loading rate of new data files halves whenever the average serving latency exceeds this many milliseconds, and grows back while it is under. Only used if data_loading_max_records_per_second is positive."
+  default     = 0
+  type        = number
+}
+
+variable "snapshot_reload_mins" {
+  description = "If positive, checks for new snapshot files every this many minutes. When there are some, they are loaded with the newer delta files into a new cache in the background, which replaces the current cache once loaded. Memory has to fit both caches. 0 only loads snapshot files on startup."
+  default     = 0
+  type        = number
+}
+
+variable "readiness_max_lag_secs" {
+  description = "If positive, the server is only ready once initialized and the delta files of every prefix available on startup are loaded, and no file waits to be loaded for longer than this many seconds. 0 makes it ready once initialized."
+  default     = 0
+  type        = number
+}
+
+variable "use_data_file_manifest" {
+  description = "If true, data files are listed from the DATA_FILE_MANIFEST file of their directory, if any, and only the files named after it are listed from blob storage. The data pipeline must rewrite the manifest whenever it deletes data files."
+  default     = false
+  type        = bool
+}
+
+variable "cache_compress_values" {
+  description = "Whether the cache stores values compressed with zstd, with a dictionary per prefix trained on its first loaded values. Not supported by the epoch based cache."
+  default     = false
+  type        = bool
+}
+
+variable "cache_deduplicate_values" {
+  description = "Whether the cache stores identical values of different keys once. Not supported by the epoch based cache."
+  default     = false
+  type        = bool
+}
+
+variable "cache_cold_value_directory" {
+  description = "Directory on local disk, preferably on an SSD, that the cache spills the values looked up the least into. Values are all kept in memory if empty. Requires the background cleanup, not supported by the epoch based cache."
+  default     = ""
+  type        = string
+}
+
+variable "cache_max_hot_value_mb" {
+  description = "Megabytes of values that the cache keeps in memory when it spills values to disk."
+  default     = 1024
+  type        = number
+}
+
+variable "cache_isolate_prefixes" {
+  description = "Whether the cache keeps the data of every prefix in a sub-cache of its own, so that loading or cleaning up one data source does not block the others. Takes precedence over cache_num_segments and cache_cold_value_directory."
+  default     = false
+  type        = bool
+}
+
+variable "cache_index_set_values" {
+  description = "Whether the cache keeps an index from every value of the key-value sets to the keys whose sets hold it, which UDFs read with getKeysContaining."
+  default     = false
+  type        = bool
+}
+
+variable "query_evaluation_threads" {
+  description = "Number of threads that evaluate the independent operands of large set queries in parallel. 0 evaluates queries on the request thread only."
+  default     = 0
+  type        = number
+}
+
+variable "lookup_response_compression_min_bytes" {
+  description = "Minimum size in bytes of the responses of remote shards that they compress with zstd, which trades their CPU for network bandwidth on large key sets. 0 disables compression."
+  default     = 0
+  type        = number
+}
+
+variable "v1_merge_namespace_lookups" {
+  description = "Whether the V1 API looks up the keys of all the namespaces of a request at once, with one cache lookup, rather than one lookup per namespace. The namespaces of large requests are then processed concurrently on the query evaluation threads, if any."
+  default     = false
+  type        = bool
+}
+
+variable "udf_batch_window_us" {
+  description = "How long, in microseconds, a UDF execution waits for concurrent executions of the same code object to run together in one invocation of its batch handler. Only applies to code objects with a batch handler. 0 disables batching."
+  default     = 0
+  type        = number
+}
+
+variable "udf_max_batch_size" {
+  description = "Most UDF executions that run together in one invocation of the batch handler."
+  default     = 16
+  type        = number
+}
+
+variable "udf_cache_max_mb" {
+  description = "Most megabytes of values that UDFs keep in the cache of the cacheGet and cachePut functions. 0 disables the cache."
+  default     = 0
+  type        = number
+}
+
+variable "realtime_applier_threads" {
+  description = "Number of threads applying realtime updates. 0 applies them on the thread receiving them."
+  default     = 0
+  type        = number
+}
+
+variable "realtime_max_outstanding_messages" {
+  description = "Maximum number of realtime updates received from Pub/Sub but not yet applied. 0 uses the default of the Pub/Sub client library."
+  default     = 0
+  type        = number
+}
+
+variable "realtime_max_outstanding_mb" {
+  description = "Maximum size in MB of the realtime updates received from Pub/Sub but not yet applied. 0 uses the default of the Pub/Sub client library."
+  default     = 0
+  type        = number
+}
+
+variable "load_compacted_delta_files" {
+  description = "Whether to load the compacted delta files written by data_cli compact_deltas in place of the delta files they include."
+  default     = false
+  type        = bool
+}
+
+variable "data_loading_apply_threads" {
+  description = "Number of threads that apply the batches of records read from a data file to the cache, while the data-loading-num-threads threads keep reading and decompressing the file. If 0, records are applied on the reading threads."
+  default     = 0
+  type        = number
+}
+
+variable "download_snapshot_files" {
+  description = "Whether snapshot files are downloaded into memory with parallel range reads before they are loaded, rather than streamed."
+  default     = false
+  type        = bool
+}
+
+variable "heap_allocator_max_per_cpu_cache_bytes" {
+  description = "Maximum bytes of free memory the heap allocator caches for every CPU. Smaller caches make memory freed by some threads available to the others. 0 keeps the allocator default."
+  default     = 0
+  type        = number
+}
+
+variable "release_heap_memory_after_loading" {
+  description = "Whether to return the free heap memory to the OS after the initial data load and after every snapshot reload, so that the resident memory drops back from its peak while loading."
+  default     = false
+  type        = bool
+}
+
+variable "cache_use_huge_pages" {
+  description = "Whether the slabs that the cache stores keys and values in are backed by transparent huge pages, which saves TLB misses on lookups in large caches."
+  default     = false
+  type        = bool
+}
+
+variable "response_cache_max_entries" {
+  description = "Most responses to V2 requests cached and served to identical requests, evicting the least recently used. Zero disables the response cache. It is also disabled with more than one shard, since updates to the values of other shards would not invalidate it."
+  default     = 0
+  type        = number
+}
+
+variable "response_cache_ttl_ms" {
+  description = "Milliseconds a cached response to a V2 request is served for. Responses are also dropped when data is loaded."
+  default     = 1000
+  type        = number
+}
+
+variable "bulk_load_snapshots" {
+  description = "Whether snapshot files loaded into an empty cache are staged and the cache is built from them at once, rather than applying their records one by one. Takes memory for a copy of the records while the cache is built."
+  default     = false
+  type        = bool
+}
+
+variable "cache_index_keys" {
+  description = "Whether the cache keeps its keys in order, which UDFs read with getValuesByPrefix. Not supported by the epoch based cache."
+  default     = false
+  type        = bool
+}
+
+variable "lookup_plan_queries_with_set_sizes" {
+  description = "Whether runQuery on sharded servers first looks up the sizes of the sets of a query, which order its evaluation and skip fetching the sets that cannot change the result, at the cost of one more round trip per query."
+  default     = false
+  type        = bool
+}
+
+variable "cache_hot_key_sample_rate" {
+  description = "Samples one in this many lookups of the cache to find the keys looked up the most, which the admin profiling service returns. 0 disables the sampling. Not supported by the epoch based cache."
+  default     = 0
+  type        = number
+}
+
+variable "data_loading_priority_prefixes" {
+  description = "Comma separated prefixes of data_loading_blob_prefix_allowlist loaded first on startup, in order. Every one is loaded from its snapshot to its last delta file before the next starts, using all the data_loading_concurrency, so that it can be served while the others load. The other prefixes are loaded together after them."
+  default     = ""
+  type        = string
+}
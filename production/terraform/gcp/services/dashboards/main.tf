@@ -519,6 +519,25 @@ resource "google_monitoring_dashboard" "environment_dashboard" {
                     "filter": "metric.type=\"workload.googleapis.com/ShardedLookupRunQueryLatencyInMicros\" resource.type=\"generic_task\" metric.label.\"deployment_environment\"=\"${var.environment}\" metric.label.\"service_name\"=\"kv-server\""
                   }
                 }
+              },
+              {
+                "minAlignmentPeriod": "60s",
+                "plotType": "LINE",
+                "targetAxis": "Y1",
+                "timeSeriesQuery": {
+                  "timeSeriesFilter": {
+                    "aggregation": {
+                      "alignmentPeriod": "60s",
+                      "crossSeriesReducer": "REDUCE_PERCENTILE_95",
+                      "groupByFields": [
+                        "metric.label.\"shard_number\"",
+                        "metric.label.\"service_instance_id\""
+                      ],
+                      "perSeriesAligner": "ALIGN_DELTA"
+                    },
+                    "filter": "metric.type=\"workload.googleapis.com/ShardedLookupExecutorQueueLatencyInMicros\" resource.type=\"generic_task\" metric.label.\"deployment_environment\"=\"${var.environment}\" metric.label.\"service_name\"=\"kv-server\""
+                  }
+                }
               }
             ],
             "yAxis": {
@@ -746,6 +765,31 @@ resource "google_monitoring_dashboard" "environment_dashboard" {
                     }
                   }
                 }
+              },
+              {
+                "minAlignmentPeriod": "60s",
+                "plotType": "LINE",
+                "targetAxis": "Y1",
+                "timeSeriesQuery": {
+                  "timeSeriesFilter": {
+                    "aggregation": {
+                      "alignmentPeriod": "60s",
+                      "perSeriesAligner": "ALIGN_RATE"
+                    },
+                    "filter": "metric.type=\"workload.googleapis.com/QueryCacheAccessEventCount\" resource.type=\"generic_task\" metric.label.\"deployment_environment\"=\"${var.environment}\" metric.label.\"service_name\"=\"kv-server\"",
+                    "secondaryAggregation": {
+                      "alignmentPeriod": "60s",
+                      "crossSeriesReducer": "REDUCE_MEAN",
+                      "groupByFields": [
+                        "metric.label.\"Noise\"",
+                        "metric.label.\"cache_access\"",
+                        "metric.label.\"shard_number\"",
+                        "metric.label.\"service_instance_id\""
+                      ],
+                      "perSeriesAligner": "ALIGN_MEAN"
+                    }
+                  }
+                }
               }
             ],
             "yAxis": {
@@ -14,10 +14,19 @@
 
 #include "public/applications/pa/response_utils.h"
 
+#include <string>
+#include <string_view>
+
+#include "absl/status/status.h"
 #include "google/protobuf/util/json_util.h"
 #include "src/util/status_macro/status_macros.h"
 
 namespace kv_server::application_pa {
+namespace {
+
+constexpr char kProtoOutputMarker = '\0';
+
+}  // namespace
 
 using google::protobuf::util::JsonStringToMessage;
 using google::protobuf::util::MessageToJsonString;
@@ -36,4 +45,23 @@ absl::StatusOr<std::string> KeyGroupOutputsToJson(
   return json_str;
 }
 
+std::string KeyGroupOutputsToProtoOutput(
+    const KeyGroupOutputs& key_group_outputs) {
+  std::string output(1, kProtoOutputMarker);
+  key_group_outputs.AppendToString(&output);
+  return output;
+}
+
+absl::StatusOr<KeyGroupOutputs> KeyGroupOutputsFromUdfOutput(
+    std::string_view output) {
+  if (output.empty() || output[0] != kProtoOutputMarker) {
+    return KeyGroupOutputsFromJson(output);
+  }
+  KeyGroupOutputs outputs_proto;
+  if (!outputs_proto.ParseFromArray(output.data() + 1, output.size() - 1)) {
+    return absl::InvalidArgumentError("Invalid proto output of UDF");
+  }
+  return outputs_proto;
+}
+
 }  // namespace kv_server::application_pa
@@ -18,18 +18,35 @@
 #define PUBLIC_APPLICATIONS_PA_RESPONSE_UTILS_H_
 
 #include <string>
+#include <string_view>
 
 #include "absl/status/statusor.h"
 #include "public/applications/pa/api_overlay.pb.h"
 
 namespace kv_server::application_pa {
 
+// Field of the request metadata of UDF executions whose caller also accepts
+// the proto form of `KeyGroupOutputsToProtoOutput`. UDFs may ignore it and
+// return JSON.
+inline constexpr std::string_view kAcceptsProtoOutputMetadataKey =
+    "kvAcceptsProtoOutput";
+
 absl::StatusOr<KeyGroupOutputs> KeyGroupOutputsFromJson(
     std::string_view json_str);
 
 absl::StatusOr<std::string> KeyGroupOutputsToJson(
     const KeyGroupOutputs& key_group_outputs);
 
+// Returns the serialized `key_group_outputs`, after a NUL byte that JSON
+// never starts with, so that it can't be mistaken for a JSON output.
+std::string KeyGroupOutputsToProtoOutput(
+    const KeyGroupOutputs& key_group_outputs);
+
+// Parses a UDF output, either JSON or the proto form of
+// `KeyGroupOutputsToProtoOutput`.
+absl::StatusOr<KeyGroupOutputs> KeyGroupOutputsFromUdfOutput(
+    std::string_view output);
+
 }  // namespace kv_server::application_pa
 
 #endif  // PUBLIC_APPLICATIONS_PA_RESPONSE_UTILS_H_
@@ -16,6 +16,8 @@
 
 #include "public/applications/pa/response_utils.h"
 
+#include <string>
+
 #include "google/protobuf/text_format.h"
 #include "gtest/gtest.h"
 #include "public/test_util/proto_matcher.h"
@@ -72,5 +74,32 @@ TEST(ResponseUtils, KeyGroupOutputsFromAndToJson) {
   ASSERT_TRUE(maybe_proto.ok());
   EXPECT_THAT(*maybe_proto, EqualsProto(proto));
 }
+
+TEST(ResponseUtils, KeyGroupOutputsFromUdfOutput) {
+  KeyGroupOutputs proto;
+  TextFormat::ParseFromString(
+      R"(
+        key_group_outputs {
+          tags: "custom"
+          tags: "keys"
+          key_values: {
+            key: "key1"
+            value: { value: { string_value: "" } }
+          }
+        }
+        udf_output_api_version: 1
+      )",
+      &proto);
+  auto from_proto =
+      KeyGroupOutputsFromUdfOutput(KeyGroupOutputsToProtoOutput(proto));
+  ASSERT_TRUE(from_proto.ok()) << from_proto.status();
+  EXPECT_THAT(*from_proto, EqualsProto(proto));
+  auto json = KeyGroupOutputsToJson(proto);
+  ASSERT_TRUE(json.ok());
+  auto from_json = KeyGroupOutputsFromUdfOutput(*json);
+  ASSERT_TRUE(from_json.ok()) << from_json.status();
+  EXPECT_THAT(*from_json, EqualsProto(proto));
+  EXPECT_FALSE(KeyGroupOutputsFromUdfOutput(std::string("\0\xff", 2)).ok());
+}
 }  // namespace
 }  // namespace kv_server::application_pa
@@ -0,0 +1,120 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Compares building retrieval requests on the heap and on an arena, and
+// getting the retrieval output of a parsed and of a serialized response.
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/str_cat.h"
+#include "benchmark/benchmark.h"
+#include "public/applications/pas/retrieval_request_builder.h"
+#include "public/applications/pas/retrieval_response_parser.h"
+
+namespace kv_server::application_pas {
+namespace {
+
+constexpr int kNumDeviceMetadata = 8;
+
+struct RetrievalArguments {
+  std::string protected_signals;
+  absl::flat_hash_map<std::string, std::string> device_metadata;
+  std::string contextual_signals;
+  std::vector<std::string> ad_ids;
+};
+
+RetrievalArguments MakeRetrievalArguments(int num_ad_ids) {
+  RetrievalArguments arguments{
+      .protected_signals = std::string(1024, 'p'),
+      .contextual_signals = std::string(256, 'c'),
+  };
+  for (int i = 0; i < kNumDeviceMetadata; i++) {
+    arguments.device_metadata[absl::StrCat("metadata", i)] =
+        absl::StrCat("value", i);
+  }
+  for (int i = 0; i < num_ad_ids; i++) {
+    arguments.ad_ids.push_back(absl::StrCat("ad_id", i));
+  }
+  return arguments;
+}
+
+std::string MakeSerializedResponse(int output_bytes) {
+  v2::GetValuesResponse response;
+  response.mutable_single_partition()->set_string_output(
+      std::string(output_bytes, 'o'));
+  return response.SerializeAsString();
+}
+
+// The arguments are copied, as callers keep theirs.
+void BM_BuildRetrievalRequest(benchmark::State& state) {
+  const RetrievalArguments arguments = MakeRetrievalArguments(state.range(0));
+  for (auto _ : state) {
+    v2::GetValuesRequest request = BuildRetrievalRequest(
+        arguments.protected_signals, arguments.device_metadata,
+        arguments.contextual_signals, arguments.ad_ids);
+    benchmark::DoNotOptimize(request);
+  }
+}
+
+void BM_BuildRetrievalRequestOnArena(benchmark::State& state) {
+  const RetrievalArguments arguments = MakeRetrievalArguments(state.range(0));
+  for (auto _ : state) {
+    google::protobuf::Arena arena;
+    v2::GetValuesRequest* request = BuildRetrievalRequest(
+        arena, arguments.protected_signals, arguments.device_metadata,
+        arguments.contextual_signals, arguments.ad_ids);
+    benchmark::DoNotOptimize(request);
+  }
+}
+
+void BM_GetRetrievalOutputOfParsedResponse(benchmark::State& state) {
+  const std::string serialized_response =
+      MakeSerializedResponse(state.range(0));
+  for (auto _ : state) {
+    v2::GetValuesResponse response;
+    response.ParseFromString(serialized_response);
+    auto output = GetRetrievalOutput(response);
+    benchmark::DoNotOptimize(output);
+  }
+  state.SetBytesProcessed(state.iterations() * serialized_response.size());
+}
+
+void BM_GetRetrievalOutputOfSerializedResponse(benchmark::State& state) {
+  const std::string serialized_response =
+      MakeSerializedResponse(state.range(0));
+  for (auto _ : state) {
+    auto output = GetRetrievalOutput(std::string_view(serialized_response));
+    benchmark::DoNotOptimize(output);
+  }
+  state.SetBytesProcessed(state.iterations() * serialized_response.size());
+}
+
+BENCHMARK(BM_BuildRetrievalRequest)->Arg(10)->Arg(100)->Arg(1000);
+BENCHMARK(BM_BuildRetrievalRequestOnArena)->Arg(10)->Arg(100)->Arg(1000);
+BENCHMARK(BM_GetRetrievalOutputOfParsedResponse)
+    ->Arg(1 << 10)
+    ->Arg(1 << 16)
+    ->Arg(1 << 20);
+BENCHMARK(BM_GetRetrievalOutputOfSerializedResponse)
+    ->Arg(1 << 10)
+    ->Arg(1 << 16)
+    ->Arg(1 << 20);
+
+}  // namespace
+}  // namespace kv_server::application_pas
+
+BENCHMARK_MAIN();
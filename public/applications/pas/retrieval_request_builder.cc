@@ -15,13 +15,32 @@
 #include "public/applications/pas/retrieval_request_builder.h"
 
 namespace kv_server::application_pas {
+namespace {
 
-v2::GetValuesRequest GetRequest() {
+void SetRequestMetadata(v2::GetValuesRequest& req) {
   static const std::string* kClient = new std::string("Retrieval.20231018");
-  v2::GetValuesRequest req;
   req.set_client_version(*kClient);
   (*(req.mutable_metadata()->mutable_fields()))["is_pas"].set_string_value(
       "true");
+}
+
+void AddAdIds(absl::Span<const std::string> ad_ids, UDFArgument& arg) {
+  if (ad_ids.empty()) {
+    return;
+  }
+  google::protobuf::ListValue* list_value =
+      arg.mutable_data()->mutable_list_value();
+  list_value->mutable_values()->Reserve(ad_ids.size());
+  for (const std::string& ad_id : ad_ids) {
+    list_value->add_values()->set_string_value(ad_id);
+  }
+}
+
+}  // namespace
+
+v2::GetValuesRequest GetRequest() {
+  v2::GetValuesRequest req;
+  SetRequestMetadata(req);
   return req;
 }
 
@@ -75,4 +94,40 @@ v2::GetValuesRequest BuildLookupRequest(std::vector<std::string> ad_ids) {
   return req;
 }
 
+v2::GetValuesRequest* BuildRetrievalRequest(
+    google::protobuf::Arena& arena, std::string_view protected_signals,
+    const absl::flat_hash_map<std::string, std::string>& device_metadata,
+    std::string_view contextual_signals,
+    absl::Span<const std::string> optional_ad_ids) {
+  auto* req =
+      google::protobuf::Arena::CreateMessage<v2::GetValuesRequest>(&arena);
+  SetRequestMetadata(*req);
+  v2::RequestPartition* partition = req->add_partitions();
+  partition->mutable_arguments()->Reserve(4);
+  partition->add_arguments()->mutable_data()->set_string_value(
+      protected_signals.data(), protected_signals.size());
+  {
+    auto* fields = partition->add_arguments()
+                       ->mutable_data()
+                       ->mutable_struct_value()
+                       ->mutable_fields();
+    for (const auto& [key, value] : device_metadata) {
+      (*fields)[key].set_string_value(value);
+    }
+  }
+  partition->add_arguments()->mutable_data()->set_string_value(
+      contextual_signals.data(), contextual_signals.size());
+  AddAdIds(optional_ad_ids, *partition->add_arguments());
+  return req;
+}
+
+v2::GetValuesRequest* BuildLookupRequest(google::protobuf::Arena& arena,
+                                         absl::Span<const std::string> ad_ids) {
+  auto* req =
+      google::protobuf::Arena::CreateMessage<v2::GetValuesRequest>(&arena);
+  SetRequestMetadata(*req);
+  AddAdIds(ad_ids, *req->add_partitions()->add_arguments());
+  return req;
+}
+
 }  // namespace kv_server::application_pas
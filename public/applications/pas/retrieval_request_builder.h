@@ -18,9 +18,12 @@
 #define PUBLIC_APPLICATIONS_PAS_RETRIEVAL_REQUEST_BUILDER_H_
 
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include "absl/container/flat_hash_map.h"
+#include "absl/types/span.h"
+#include "google/protobuf/arena.h"
 #include "public/query/v2/get_values_v2.pb.h"
 
 namespace kv_server::application_pas {
@@ -38,6 +41,17 @@ v2::GetValuesRequest BuildRetrievalRequest(
 // Builds a GetValuesRequest. Stores the input arguments into the request.
 v2::GetValuesRequest BuildLookupRequest(std::vector<std::string> ad_ids);
 
+// Like the above, but builds the request on `arena`, which owns it, so that
+// its messages and strings are allocated in a few blocks rather than one by
+// one. The arguments are copied once, into the arena.
+v2::GetValuesRequest* BuildRetrievalRequest(
+    google::protobuf::Arena& arena, std::string_view protected_signals,
+    const absl::flat_hash_map<std::string, std::string>& device_metadata,
+    std::string_view contextual_signals,
+    absl::Span<const std::string> optional_ad_ids = {});
+v2::GetValuesRequest* BuildLookupRequest(google::protobuf::Arena& arena,
+                                         absl::Span<const std::string> ad_ids);
+
 }  // namespace kv_server::application_pas
 
 #endif  // PUBLIC_APPLICATIONS_PAS_RETRIEVAL_REQUEST_BUILDER_H_
@@ -16,6 +16,9 @@
 
 #include "public/applications/pas/retrieval_request_builder.h"
 
+#include <string>
+#include <vector>
+
 #include "google/protobuf/text_format.h"
 #include "gtest/gtest.h"
 #include "public/query/cpp/client_utils.h"
@@ -72,5 +75,25 @@ TEST(RequestBuilder, Build) {
       EqualsProto(expected));
 }
 
+TEST(RequestBuilder, BuildOnArena) {
+  google::protobuf::Arena arena;
+  const std::vector<std::string> ad_ids = {"item1", "item2", "item3"};
+  const absl::flat_hash_map<std::string, std::string> device_metadata = {
+      {"m1", "v1"}, {"m2", "v2"}};
+  v2::GetValuesRequest* request =
+      BuildRetrievalRequest(arena, "protected signals", device_metadata,
+                            "contextual signals", ad_ids);
+  EXPECT_EQ(request->GetArena(), &arena);
+  EXPECT_THAT(*request, EqualsProto(BuildRetrievalRequest(
+                            "protected signals", device_metadata,
+                            "contextual signals", ad_ids)));
+  EXPECT_THAT(*BuildRetrievalRequest(arena, "protected signals",
+                                     device_metadata, "contextual signals"),
+              EqualsProto(BuildRetrievalRequest(
+                  "protected signals", device_metadata, "contextual signals")));
+  EXPECT_THAT(*BuildLookupRequest(arena, ad_ids),
+              EqualsProto(BuildLookupRequest(ad_ids)));
+}
+
 }  // namespace
 }  // namespace kv_server::application_pas
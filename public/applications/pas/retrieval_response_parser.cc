@@ -14,12 +14,77 @@
 
 #include "public/applications/pas/retrieval_response_parser.h"
 
+#include <cstdint>
+#include <optional>
+
 #include "absl/strings/str_cat.h"
+#include "google/protobuf/io/coded_stream.h"
 
 namespace kv_server::application_pas {
+namespace {
 
+using google::protobuf::io::CodedInputStream;
+using v2::GetValuesResponse;
 using v2::ResponsePartition;
 
+constexpr uint32_t kWireTypeVarint = 0;
+constexpr uint32_t kWireTypeFixed64 = 1;
+constexpr uint32_t kWireTypeLengthDelimited = 2;
+constexpr uint32_t kWireTypeFixed32 = 5;
+
+// Scans the serialized message in `buffer`, calling `on_field` with the number
+// and the bytes of each of its length-delimited fields, in order, and skipping
+// the others.
+template <typename OnField>
+absl::Status ForEachLengthDelimitedField(std::string_view buffer,
+                                         OnField on_field) {
+  CodedInputStream input(reinterpret_cast<const uint8_t*>(buffer.data()),
+                         buffer.size());
+  while (const uint32_t tag = input.ReadTag()) {
+    bool ok = false;
+    switch (tag & 7) {
+      case kWireTypeVarint: {
+        uint64_t value;
+        ok = input.ReadVarint64(&value);
+        break;
+      }
+      case kWireTypeFixed64:
+        ok = input.Skip(8);
+        break;
+      case kWireTypeFixed32:
+        ok = input.Skip(4);
+        break;
+      case kWireTypeLengthDelimited: {
+        uint32_t length;
+        if (!input.ReadVarint32(&length)) {
+          break;
+        }
+        const int offset = input.CurrentPosition();
+        ok = input.Skip(length);
+        if (!ok) {
+          break;
+        }
+        if (absl::Status status =
+                on_field(tag >> 3, buffer.substr(offset, length));
+            !status.ok()) {
+          return status;
+        }
+        break;
+      }
+    }
+    if (!ok) {
+      return absl::InvalidArgumentError("Malformed GetValuesResponse");
+    }
+  }
+  // `ReadTag` also returns 0 on errors.
+  if (input.CurrentPosition() != buffer.size()) {
+    return absl::InvalidArgumentError("Malformed GetValuesResponse");
+  }
+  return absl::OkStatus();
+}
+
+}  // namespace
+
 absl::StatusOr<std::string> GetRetrievalOutput(
     const v2::GetValuesResponse& response) {
   switch (response.single_partition().output_type_case()) {
@@ -38,4 +103,56 @@ absl::StatusOr<std::string> GetRetrievalOutput(
   }
 }
 
+absl::StatusOr<std::string_view> GetRetrievalOutput(
+    std::string_view serialized_response) {
+  // Occurrences of a message field are merged, and the last field of a oneof
+  // is the one set, as when parsing.
+  bool single_partition = false;
+  std::optional<std::string_view> string_output;
+  std::optional<std::string_view> status;
+  const auto on_partition_field = [&string_output, &status](
+                                      int number, std::string_view bytes) {
+    if (number == ResponsePartition::kStringOutputFieldNumber) {
+      string_output = bytes;
+      status.reset();
+    } else if (number == ResponsePartition::kStatusFieldNumber) {
+      string_output.reset();
+      status = bytes;
+    }
+    return absl::OkStatus();
+  };
+  if (absl::Status parse_status = ForEachLengthDelimitedField(
+          serialized_response,
+          [&](int number, std::string_view bytes) {
+            if (number == GetValuesResponse::kSinglePartitionFieldNumber) {
+              if (!single_partition) {
+                string_output.reset();
+                status.reset();
+              }
+              single_partition = true;
+              return ForEachLengthDelimitedField(bytes, on_partition_field);
+            }
+            if (number ==
+                GetValuesResponse::kCompressedPartitionGroupsFieldNumber) {
+              single_partition = false;
+            }
+            return absl::OkStatus();
+          });
+      !parse_status.ok()) {
+    return parse_status;
+  }
+  if (single_partition && string_output.has_value()) {
+    return *string_output;
+  }
+  if (single_partition && status.has_value()) {
+    google::rpc::Status rpc_status;
+    if (!rpc_status.ParseFromArray(status->data(), status->size())) {
+      return absl::InvalidArgumentError("Malformed GetValuesResponse");
+    }
+    return absl::Status(static_cast<absl::StatusCode>(rpc_status.code()),
+                        rpc_status.message());
+  }
+  return absl::UnimplementedError("output type unimplemented");
+}
+
 }  // namespace kv_server::application_pas
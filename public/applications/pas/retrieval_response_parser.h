@@ -18,6 +18,7 @@
 #define PUBLIC_APPLICATIONS_PAS_RETRIEVAL_RESPONSE_PARSER_H_
 
 #include <string>
+#include <string_view>
 
 #include "absl/status/statusor.h"
 #include "public/query/v2/get_values_v2.pb.h"
@@ -29,6 +30,12 @@ namespace kv_server::application_pas {
 absl::StatusOr<std::string> GetRetrievalOutput(
     const v2::GetValuesResponse& response);
 
+// Like the above, but for a serialized response, which is scanned for the
+// output rather than parsed into messages. The returned view is into
+// `serialized_response`, so is only valid as long as it is.
+absl::StatusOr<std::string_view> GetRetrievalOutput(
+    std::string_view serialized_response);
+
 }  // namespace kv_server::application_pas
 
 #endif  // PUBLIC_APPLICATIONS_PAS_RETRIEVAL_RESPONSE_PARSER_H_
@@ -16,6 +16,9 @@
 
 #include "public/applications/pas/retrieval_response_parser.h"
 
+#include <string>
+#include <string_view>
+
 #include "google/protobuf/text_format.h"
 #include "gtest/gtest.h"
 
@@ -54,5 +57,64 @@ single_partition {
   EXPECT_EQ(maybe_output.status().code(), absl::StatusCode::kCancelled);
 }
 
+TEST(RetrievalResponseParser, GetRetrievalOutputFromSerializedResponse) {
+  v2::GetValuesResponse response;
+  response.mutable_single_partition()->set_id(1);
+  response.mutable_single_partition()->set_string_output("output");
+  const std::string serialized_response = response.SerializeAsString();
+  auto maybe_output = GetRetrievalOutput(std::string_view(serialized_response));
+  ASSERT_TRUE(maybe_output.ok()) << maybe_output.status();
+  EXPECT_EQ(*maybe_output, "output");
+  // The output is a view into the serialized response.
+  EXPECT_GE(maybe_output->data(), serialized_response.data());
+  EXPECT_LE(maybe_output->data() + maybe_output->size(),
+            serialized_response.data() + serialized_response.size());
+}
+
+TEST(RetrievalResponseParser, GetRetrievalOutputFromSerializedResponseError) {
+  v2::GetValuesResponse response;
+  response.mutable_single_partition()->mutable_status()->set_code(1);
+  response.mutable_single_partition()->mutable_status()->set_message("error");
+  auto maybe_output =
+      GetRetrievalOutput(std::string_view(response.SerializeAsString()));
+  ASSERT_FALSE(maybe_output.ok());
+  EXPECT_EQ(maybe_output.status().code(), absl::StatusCode::kCancelled);
+  EXPECT_EQ(maybe_output.status().message(), "error");
+}
+
+TEST(RetrievalResponseParser, GetRetrievalOutputFromMergedResponse) {
+  v2::GetValuesResponse first;
+  first.mutable_single_partition()->set_string_output("first");
+  v2::GetValuesResponse second;
+  second.mutable_single_partition()->set_id(1);
+  // Parsing concatenated messages merges them.
+  const std::string serialized_response =
+      first.SerializeAsString() + second.SerializeAsString();
+  auto maybe_output = GetRetrievalOutput(std::string_view(serialized_response));
+  ASSERT_TRUE(maybe_output.ok()) << maybe_output.status();
+  EXPECT_EQ(*maybe_output, "first");
+}
+
+TEST(RetrievalResponseParser, GetRetrievalOutputFromCompressedResponse) {
+  v2::GetValuesResponse response;
+  response.mutable_compressed_partition_groups()
+      ->add_compressed_partition_groups("group");
+  auto maybe_output =
+      GetRetrievalOutput(std::string_view(response.SerializeAsString()));
+  ASSERT_FALSE(maybe_output.ok());
+  EXPECT_EQ(maybe_output.status().code(), absl::StatusCode::kUnimplemented);
+}
+
+TEST(RetrievalResponseParser, GetRetrievalOutputFromMalformedResponse) {
+  v2::GetValuesResponse response;
+  response.mutable_single_partition()->set_string_output("output");
+  const std::string serialized_response = response.SerializeAsString();
+  auto maybe_output = GetRetrievalOutput(
+      std::string_view(serialized_response)
+          .substr(0, serialized_response.size() - 1));
+  ASSERT_FALSE(maybe_output.ok());
+  EXPECT_EQ(maybe_output.status().code(), absl::StatusCode::kInvalidArgument);
+}
+
 }  // namespace
 }  // namespace kv_server::application_pas
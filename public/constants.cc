@@ -38,6 +38,12 @@ const std::regex& SnapshotFileFormatRegex() {
   return *regex;
 }
 
+const std::regex& CompactedDeltaFileFormatRegex() {
+  static const std::regex* const regex =
+      new std::regex(FileFormatRegex<FileType::COMPACTED_DELTA>());
+  return *regex;
+}
+
 const std::regex& LogicalShardingConfigFileFormatRegex() {
   static const std::regex* const regex =
       new std::regex(FileFormatRegex<FileType::LOGICAL_SHARDING_CONFIG>());
@@ -71,6 +71,16 @@ constexpr char kQueryArgDelimiter = ',';
 //            indicates a more recent snapshot.
 const std::regex& SnapshotFileFormatRegex();
 
+// Returns a compiled compacted delta file name regex defined as follows:
+//
+// Compiled regex = "COMPACTED_DELTA_\d{16}"
+// Regex parts:
+// - prefix = "COMPACTED_DELTA"
+// - component delimiter = "_"
+// - suffix = a 16 digit number, the logical time of the most recent delta
+//            file merged into the compacted delta file.
+const std::regex& CompactedDeltaFileFormatRegex();
+
 // Returns a compiled file group file name regex defined as follows:
 //
 // Compiled regex = "(DELTA|SNAPSHOT)_\d{16}_\d{5}_OF_\d{6}". Regex parts
@@ -16,13 +16,15 @@
 
 #include "public/data_loading/aggregation/record_aggregator.h"
 
+#include <cstdint>
 #include <iostream>
 #include <sstream>
 #include <utility>
+#include <variant>
+#include <vector>
 
 #include "absl/container/flat_hash_set.h"
 #include "absl/log/log.h"
-#include "absl/memory/memory.h"
 #include "absl/strings/numbers.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_format.h"
@@ -164,6 +166,11 @@ absl::Status ValidateRecord(const KeyValueMutationRecordStruct& record) {
   if (IsEmptyValue(record.value)) {
     return absl::InvalidArgumentError("Record value must not be empty.");
   }
+  if (std::holds_alternative<std::vector<uint32_t>>(record.value) ||
+      std::holds_alternative<std::vector<uint64_t>>(record.value)) {
+    return absl::InvalidArgumentError(
+        "Numeric set values can not be aggregated.");
+  }
   return absl::OkStatus();
 }
 
@@ -239,37 +246,41 @@ absl::StatusOr<int> ProcessRecordRow(RecordRowCallback& row_callback,
   return error_code;
 }
 
-}  // namespace
+class SqliteRecordAggregator : public RecordAggregator {
+ public:
+  // Frees up resources associated with the sqlite3 connection object.
+  struct DbDeleter {
+    // Does not take ownership of the db pointer.
+    void operator()(sqlite3* db) noexcept;
+  };
+  explicit SqliteRecordAggregator(std::unique_ptr<sqlite3, DbDeleter> db)
+      : db_(std::move(db)) {}
+
+  absl::Status InsertOrUpdateRecord(
+      int64_t record_key, const KeyValueMutationRecordStruct& record) override;
+  absl::Status ReadRecord(
+      int64_t record_key,
+      std::function<absl::Status(KeyValueMutationRecordStruct)>
+          record_callback) override;
+  absl::Status ReadRecords(
+      std::function<absl::Status(KeyValueMutationRecordStruct)>
+          record_callback) override;
+  absl::Status DeleteRecord(int64_t record_key) override;
+  absl::Status DeleteRecords() override;
 
-void RecordAggregator::DbDeleter::operator()(sqlite3* db) noexcept {
-  sqlite3_close(db);
-}
+ private:
+  absl::StatusOr<std::vector<std::string>> MergeSetValueIfRecordExists(
+      int64_t record_key, const KeyValueMutationRecordStruct& record);
 
-absl::StatusOr<std::unique_ptr<RecordAggregator>>
-RecordAggregator::CreateInMemoryAggregator() {
-  return CreateFileBackedAggregator(kInMemoryPath);
-}
+  std::unique_ptr<sqlite3, DbDeleter> db_;
+};
 
-absl::StatusOr<std::unique_ptr<RecordAggregator>>
-RecordAggregator::CreateFileBackedAggregator(std::string_view data_file) {
-  sqlite3* db;
-  DbDeleter db_deleter;
-  if (sqlite3_open(data_file.data(), &db) != SQLITE_OK) {
-    std::string error_msg = GetErrorMessage(db);
-    db_deleter(db);
-    return absl::InvalidArgumentError(
-        absl::StrCat("Failed to open data file: ", data_file, error_msg));
-  }
-  auto db_owner =
-      std::unique_ptr<sqlite3, DbDeleter>(db, std::move(db_deleter));
-  if (absl::Status status = CreateRecordsTable(db_owner.get()); !status.ok()) {
-    return status;
-  }
-  return absl::WrapUnique(new RecordAggregator(std::move(db_owner)));
+void SqliteRecordAggregator::DbDeleter::operator()(sqlite3* db) noexcept {
+  sqlite3_close(db);
 }
 
 absl::StatusOr<std::vector<std::string>>
-RecordAggregator::MergeSetValueIfRecordExists(
+SqliteRecordAggregator::MergeSetValueIfRecordExists(
     int64_t record_key, const KeyValueMutationRecordStruct& record) {
   auto new_values_set = std::get<std::vector<std::string_view>>(record.value);
   absl::flat_hash_set<std::string_view> merged_values_set;
@@ -297,7 +308,7 @@ RecordAggregator::MergeSetValueIfRecordExists(
   return merged_values_list;
 }
 
-absl::Status RecordAggregator::InsertOrUpdateRecord(
+absl::Status SqliteRecordAggregator::InsertOrUpdateRecord(
     int64_t record_key, const KeyValueMutationRecordStruct& record) {
   if (absl::Status status = ValidateRecord(record); !status.ok()) {
     return status;
@@ -347,7 +358,7 @@ absl::Status RecordAggregator::InsertOrUpdateRecord(
   return absl::OkStatus();
 }
 
-absl::Status RecordAggregator::ReadRecord(
+absl::Status SqliteRecordAggregator::ReadRecord(
     int64_t record_key,
     std::function<absl::Status(KeyValueMutationRecordStruct)> record_callback) {
   sqlite3_stmt* select_stmt;
@@ -376,7 +387,7 @@ absl::Status RecordAggregator::ReadRecord(
                    " error: ", sqlite3_errstr(*result)));
 }
 
-absl::Status RecordAggregator::ReadRecords(
+absl::Status SqliteRecordAggregator::ReadRecords(
     std::function<absl::Status(KeyValueMutationRecordStruct)> record_callback) {
   sqlite3_stmt* batch_select_stmt;
   if (absl::Status status = PrepareStatement(kBatchSelectRecordsSql,
@@ -433,7 +444,7 @@ absl::Status RecordAggregator::ReadRecords(
   return absl::OkStatus();
 }
 
-absl::Status RecordAggregator::DeleteRecord(int64_t record_key) {
+absl::Status SqliteRecordAggregator::DeleteRecord(int64_t record_key) {
   auto sql = absl::StrFormat(kDeleteRecordSql, record_key);
   if (sqlite3_exec(db_.get(), sql.c_str(), /*callback=*/nullptr,
                    /*callback_arg0=*/0, /*errmsg=*/nullptr) != SQLITE_OK) {
@@ -443,7 +454,7 @@ absl::Status RecordAggregator::DeleteRecord(int64_t record_key) {
   return absl::OkStatus();
 }
 
-absl::Status RecordAggregator::DeleteRecords() {
+absl::Status SqliteRecordAggregator::DeleteRecords() {
   if (sqlite3_exec(db_.get(), kDeleteAllRecordsSql.data(),
                    /*callback=*/nullptr,
                    /*callback_arg0=*/0, /*errmsg=*/nullptr) != SQLITE_OK) {
@@ -453,4 +464,29 @@ absl::Status RecordAggregator::DeleteRecords() {
   return absl::OkStatus();
 }
 
+}  // namespace
+
+absl::StatusOr<std::unique_ptr<RecordAggregator>>
+RecordAggregator::CreateInMemoryAggregator() {
+  return CreateFileBackedAggregator(kInMemoryPath);
+}
+
+absl::StatusOr<std::unique_ptr<RecordAggregator>>
+RecordAggregator::CreateFileBackedAggregator(std::string_view data_file) {
+  sqlite3* db;
+  SqliteRecordAggregator::DbDeleter db_deleter;
+  if (sqlite3_open(data_file.data(), &db) != SQLITE_OK) {
+    std::string error_msg = GetErrorMessage(db);
+    db_deleter(db);
+    return absl::InvalidArgumentError(
+        absl::StrCat("Failed to open data file: ", data_file, error_msg));
+  }
+  auto db_owner = std::unique_ptr<sqlite3, SqliteRecordAggregator::DbDeleter>(
+      db, std::move(db_deleter));
+  if (absl::Status status = CreateRecordsTable(db_owner.get()); !status.ok()) {
+    return status;
+  }
+  return std::make_unique<SqliteRecordAggregator>(std::move(db_owner));
+}
+
 }  // namespace kv_server
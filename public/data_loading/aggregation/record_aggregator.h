@@ -29,8 +29,6 @@
 #include "absl/status/statusor.h"
 #include "public/data_loading/records_utils.h"
 
-#include "sqlite3.h"
-
 namespace kv_server {
 // A `RecordAggregator` aggregates `KeyValueMutationRecordStruct` records added
 // to an aggregator instance from potentially multiple record streams. Records
@@ -54,20 +52,24 @@ namespace kv_server {
 //   }
 // }
 //```
+//
+// The aggregators created by the factories below are backed by SQLite. See
+// `SortingRecordAggregator` for an aggregator that keeps records in memory and
+// spills sorted runs to disk instead.
 class RecordAggregator {
  public:
-  ~RecordAggregator() = default;
+  virtual ~RecordAggregator() = default;
   RecordAggregator(const RecordAggregator&) = delete;
   RecordAggregator& operator=(const RecordAggregator&) = delete;
 
-  // Creates a `RecordAggregator` that uses RAM to aggregate and store
+  // Creates a SQLite `RecordAggregator` that uses RAM to aggregate and store
   // records.
   //
   // Returns a `not ok()` status if creating the aggregator fails.
   static absl::StatusOr<std::unique_ptr<RecordAggregator>>
   CreateInMemoryAggregator();
-  // Creates a `RecordAggregator` that uses a user provided backup file to
-  // aggregate and store records.
+  // Creates a SQLite `RecordAggregator` that uses a user provided backup file
+  // to aggregate and store records.
   //
   // Returns a `not ok()` status if creating the aggregator fails.
   static absl::StatusOr<std::unique_ptr<RecordAggregator>>
@@ -82,8 +84,8 @@ class RecordAggregator {
   // successfully.
   // - !absl::OkStatus() - if there are any errors. The returned status
   // contains a detailed error message.
-  absl::Status InsertOrUpdateRecord(int64_t record_key,
-                                    const KeyValueMutationRecordStruct& record);
+  virtual absl::Status InsertOrUpdateRecord(
+      int64_t record_key, const KeyValueMutationRecordStruct& record) = 0;
   // Reads a record keyed by `record_key` and calls the provided
   // `record_callback` function with the record. If no record keyed by
   // `record_key` exists, then `record_callback` is never called.
@@ -92,20 +94,21 @@ class RecordAggregator {
   // - absl::OkStatus() - if record is read and processed successfully.
   // - !absl::OkStatus() - if there are any errors. The returned status
   // contains a detailed error message.
-  absl::Status ReadRecord(
+  virtual absl::Status ReadRecord(
       int64_t record_key,
       std::function<absl::Status(KeyValueMutationRecordStruct)>
-          record_callback);
-  // Reads all records currently in the aggregator. The `record_callback`
-  // function is called exactly once for each record.
+          record_callback) = 0;
+  // Reads all records currently in the aggregator in increasing order of their
+  // keys. The `record_callback` function is called exactly once for each
+  // record.
   //
   // Returns:
   // - absl::OkStatus() - if all records are read and processed successfully.
   // - !absl::OkStatus() - if there are any errors. The returned status
   // contains a detailed error message.
-  absl::Status ReadRecords(
+  virtual absl::Status ReadRecords(
       std::function<absl::Status(KeyValueMutationRecordStruct)>
-          record_callback);
+          record_callback) = 0;
   // Deletes record keyed by `record_key`. Silently succeeds if the record
   // does not exist.
   //
@@ -113,28 +116,17 @@ class RecordAggregator {
   // - absl::OkStatus() - if record is deleted successfully.
   // - !absl::OkStatus() - if there are any errors. The returned status
   // contains a detailed error message.
-  absl::Status DeleteRecord(int64_t record_key);
+  virtual absl::Status DeleteRecord(int64_t record_key) = 0;
   // Deletes all records in the aggregator.
   //
   // Returns:
   // - absl::OkStatus() - if all records are deleted successfully.
   // - !absl::OkStatus() - if there are any errors. The returned status
   // contains a detailed error message.
-  absl::Status DeleteRecords();
-
- private:
-  // Frees up resources associated with the sqlite3 connection object.
-  struct DbDeleter {
-    // Does not take ownership of the db pointer.
-    void operator()(sqlite3* db) noexcept;
-  };
-  explicit RecordAggregator(std::unique_ptr<sqlite3, DbDeleter> db)
-      : db_(std::move(db)) {}
-
-  absl::StatusOr<std::vector<std::string>> MergeSetValueIfRecordExists(
-      int64_t record_key, const KeyValueMutationRecordStruct& record);
+  virtual absl::Status DeleteRecords() = 0;
 
-  std::unique_ptr<sqlite3, DbDeleter> db_;
+ protected:
+  RecordAggregator() = default;
 };
 }  // namespace kv_server
 
@@ -18,11 +18,13 @@
 #include "absl/strings/str_cat.h"
 #include "benchmark/benchmark.h"
 #include "public/data_loading/aggregation/record_aggregator.h"
+#include "public/data_loading/aggregation/sorting_record_aggregator.h"
 #include "public/data_loading/records_utils.h"
 
 using kv_server::KeyValueMutationRecordStruct;
 using kv_server::KeyValueMutationType;
 using kv_server::RecordAggregator;
+using kv_server::SortingRecordAggregator;
 
 static std::string GenerateRecordValue(int64_t char_count) {
   return std::string(char_count, 'A' + (std::rand() % 15));
@@ -47,6 +49,26 @@ static void BM_InMemoryRecordAggregator_InsertRecord(benchmark::State& state) {
   state.SetBytesProcessed(state.range(0) * state.iterations());
 }
 
+static void BM_SortingRecordAggregator_InsertRecord(benchmark::State& state) {
+  auto record_aggregator = SortingRecordAggregator::Create({});
+  std::string record_value = GenerateRecordValue(state.range(0));
+  KeyValueMutationRecordStruct record{
+      .mutation_type = KeyValueMutationType::Update,
+      .logical_commit_time = 1234567890,
+      .value = record_value};
+  for (auto _ : state) {
+    state.PauseTiming();
+    std::string record_key = absl::StrCat("key", std::rand() % 10'000);
+    record.key = record_key;
+    size_t record_hash = absl::HashOf(record.key);
+    state.ResumeTiming();
+    auto ignored =
+        (*record_aggregator)->InsertOrUpdateRecord(record_hash, record);
+  }
+  state.SetBytesProcessed(state.range(0) * state.iterations());
+}
+
 BENCHMARK(BM_InMemoryRecordAggregator_InsertRecord)->Range(64, 8192);
+BENCHMARK(BM_SortingRecordAggregator_InsertRecord)->Range(64, 8192);
 
 BENCHMARK_MAIN();
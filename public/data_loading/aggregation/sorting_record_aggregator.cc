@@ -0,0 +1,406 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "public/data_loading/aggregation/sorting_record_aggregator.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <queue>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "absl/container/flat_hash_set.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+
+namespace kv_server {
+namespace {
+
+// Run files hold the keys in increasing order. Each key is followed by its
+// `RecordVersions`:
+//
+//   int64 key, uint8 reset, uint32 num_versions,
+//   num_versions x (int64 logical_commit_time, uint8 is_set,
+//                   uint32 record_size, record_size bytes of record)
+
+template <typename T>
+void WriteValue(T value, std::ostream& stream) {
+  stream.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+template <typename T>
+bool ReadValue(std::istream& stream, T& value) {
+  return static_cast<bool>(
+      stream.read(reinterpret_cast<char*>(&value), sizeof(value)));
+}
+
+absl::Status ValidateRecord(const KeyValueMutationRecordStruct& record) {
+  if (record.key.empty()) {
+    return absl::InvalidArgumentError("Record key must not be empty.");
+  }
+  if (IsEmptyValue(record.value)) {
+    return absl::InvalidArgumentError("Record value must not be empty.");
+  }
+  if (std::holds_alternative<std::vector<uint32_t>>(record.value) ||
+      std::holds_alternative<std::vector<uint64_t>>(record.value)) {
+    return absl::InvalidArgumentError(
+        "Numeric set values can not be aggregated.");
+  }
+  return absl::OkStatus();
+}
+
+}  // namespace
+
+class SortingRecordAggregator::RunReader {
+ public:
+  explicit RunReader(std::string_view run_file)
+      : run_file_(run_file), stream_(run_file_, std::ios::binary) {}
+
+  // Reads the records of the next key. Returns false at the end of the run.
+  absl::StatusOr<bool> Next() {
+    if (!stream_.is_open()) {
+      return absl::InternalError(
+          absl::StrCat("Failed to open run file: ", run_file_));
+    }
+    if (stream_.peek() == std::ifstream::traits_type::eof()) {
+      return false;
+    }
+    uint8_t reset;
+    uint32_t num_versions;
+    if (!ReadValue(stream_, key_) || !ReadValue(stream_, reset) ||
+        !ReadValue(stream_, num_versions)) {
+      return TruncatedRunError();
+    }
+    record_versions_ = RecordVersions{.reset = reset != 0};
+    record_versions_.versions.reserve(num_versions);
+    for (uint32_t i = 0; i < num_versions; ++i) {
+      Version version;
+      uint8_t is_set;
+      uint32_t record_size;
+      if (!ReadValue(stream_, version.logical_commit_time) ||
+          !ReadValue(stream_, is_set) || !ReadValue(stream_, record_size)) {
+        return TruncatedRunError();
+      }
+      version.is_set = is_set != 0;
+      version.record.resize(record_size);
+      if (!stream_.read(version.record.data(), record_size)) {
+        return TruncatedRunError();
+      }
+      record_versions_.versions.push_back(std::move(version));
+    }
+    return true;
+  }
+
+  int64_t key() const { return key_; }
+  RecordVersions& record_versions() { return record_versions_; }
+
+ private:
+  absl::Status TruncatedRunError() const {
+    return absl::DataLossError(
+        absl::StrCat("Run file is truncated: ", run_file_));
+  }
+
+  const std::string run_file_;
+  std::ifstream stream_;
+  int64_t key_ = 0;
+  RecordVersions record_versions_;
+};
+
+SortingRecordAggregator::~SortingRecordAggregator() { RemoveRunFiles(); }
+
+absl::StatusOr<std::unique_ptr<SortingRecordAggregator>>
+SortingRecordAggregator::Create(Options options) {
+  if (options.max_memory_bytes <= 0) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("max_memory_bytes must be positive, got ",
+                     options.max_memory_bytes));
+  }
+  return absl::WrapUnique(new SortingRecordAggregator(std::move(options)));
+}
+
+void SortingRecordAggregator::AddVersion(Version version,
+                                         RecordVersions& record_versions) {
+  // Same as the SQLite aggregators, records with the same logical commit time
+  // as the current one replace it.
+  if (!record_versions.versions.empty() &&
+      version.logical_commit_time <
+          record_versions.versions.back().logical_commit_time) {
+    return;
+  }
+  if (!version.is_set) {
+    record_versions.versions.clear();
+  }
+  record_versions.versions.push_back(std::move(version));
+}
+
+void SortingRecordAggregator::MergeVersions(RecordVersions newer,
+                                            RecordVersions& record_versions) {
+  if (newer.reset) {
+    record_versions = std::move(newer);
+    return;
+  }
+  for (Version& version : newer.versions) {
+    AddVersion(std::move(version), record_versions);
+  }
+}
+
+absl::Status SortingRecordAggregator::ReadVersions(
+    const RecordVersions& record_versions,
+    const std::function<absl::Status(KeyValueMutationRecordStruct)>&
+        record_callback) {
+  if (record_versions.versions.empty()) {
+    return absl::OkStatus();
+  }
+  const Version& last_version = record_versions.versions.back();
+  if (!last_version.is_set) {
+    return DeserializeRecord(
+        last_version.record,
+        [&record_callback](const KeyValueMutationRecordStruct& record) {
+          return record_callback(record);
+        });
+  }
+  // Set values accepted since the last record without a set value are merged.
+  KeyValueMutationRecordStruct aggregated_record;
+  std::vector<std::string_view> values;
+  absl::flat_hash_set<std::string_view> seen_values;
+  for (const Version& version : record_versions.versions) {
+    if (!version.is_set) {
+      continue;
+    }
+    if (absl::Status status = DeserializeRecord(
+            version.record,
+            [&aggregated_record, &values,
+             &seen_values](const KeyValueMutationRecordStruct& record) {
+              aggregated_record = record;
+              for (std::string_view value :
+                   std::get<std::vector<std::string_view>>(record.value)) {
+                if (seen_values.insert(value).second) {
+                  values.push_back(value);
+                }
+              }
+              return absl::OkStatus();
+            });
+        !status.ok()) {
+      return status;
+    }
+  }
+  aggregated_record.value = std::move(values);
+  return record_callback(std::move(aggregated_record));
+}
+
+int64_t SortingRecordAggregator::MemoryUsage(
+    const RecordVersions& record_versions) {
+  int64_t bytes = sizeof(std::pair<const int64_t, RecordVersions>);
+  for (const Version& version : record_versions.versions) {
+    bytes += sizeof(Version) + version.record.size();
+  }
+  return bytes;
+}
+
+absl::Status SortingRecordAggregator::InsertOrUpdateRecord(
+    int64_t record_key, const KeyValueMutationRecordStruct& record) {
+  if (absl::Status status = ValidateRecord(record); !status.ok()) {
+    return status;
+  }
+  Version version{
+      .logical_commit_time = record.logical_commit_time,
+      .is_set =
+          std::holds_alternative<std::vector<std::string_view>>(record.value),
+      .record = std::string(ToStringView(ToFlatBufferBuilder(record))),
+  };
+  RecordVersions& record_versions = records_[record_key];
+  memory_bytes_ -= MemoryUsage(record_versions);
+  AddVersion(std::move(version), record_versions);
+  memory_bytes_ += MemoryUsage(record_versions);
+  return MaybeSpill();
+}
+
+absl::Status SortingRecordAggregator::ReadRecord(
+    int64_t record_key,
+    std::function<absl::Status(KeyValueMutationRecordStruct)> record_callback) {
+  RecordVersions record_versions;
+  for (const std::string& run_file : run_files_) {
+    RunReader run(run_file);
+    while (true) {
+      absl::StatusOr<bool> has_records = run.Next();
+      if (!has_records.ok()) {
+        return has_records.status();
+      }
+      if (!*has_records || run.key() > record_key) {
+        break;
+      }
+      if (run.key() == record_key) {
+        MergeVersions(std::move(run.record_versions()), record_versions);
+        break;
+      }
+    }
+  }
+  if (auto it = records_.find(record_key); it != records_.end()) {
+    MergeVersions(it->second, record_versions);
+  }
+  return ReadVersions(record_versions, record_callback);
+}
+
+absl::Status SortingRecordAggregator::ReadRecords(
+    std::function<absl::Status(KeyValueMutationRecordStruct)> record_callback) {
+  std::vector<std::unique_ptr<RunReader>> runs;
+  runs.reserve(run_files_.size());
+  // Next key of each run paired with the index of the run, so that runs are
+  // merged in the order they were written.
+  using RunKey = std::pair<int64_t, size_t>;
+  std::priority_queue<RunKey, std::vector<RunKey>, std::greater<RunKey>>
+      run_keys;
+  for (const std::string& run_file : run_files_) {
+    auto run = std::make_unique<RunReader>(run_file);
+    absl::StatusOr<bool> has_records = run->Next();
+    if (!has_records.ok()) {
+      return has_records.status();
+    }
+    if (*has_records) {
+      run_keys.push({run->key(), runs.size()});
+    }
+    runs.push_back(std::move(run));
+  }
+  std::vector<int64_t> memory_keys;
+  memory_keys.reserve(records_.size());
+  for (const auto& [key, unused] : records_) {
+    memory_keys.push_back(key);
+  }
+  std::sort(memory_keys.begin(), memory_keys.end());
+  auto memory_key = memory_keys.begin();
+  while (!run_keys.empty() || memory_key != memory_keys.end()) {
+    int64_t key;
+    if (run_keys.empty()) {
+      key = *memory_key;
+    } else if (memory_key == memory_keys.end()) {
+      key = run_keys.top().first;
+    } else {
+      key = std::min(*memory_key, run_keys.top().first);
+    }
+    const bool in_memory =
+        memory_key != memory_keys.end() && *memory_key == key;
+    if (in_memory) {
+      ++memory_key;
+    }
+    if (run_keys.empty() || run_keys.top().first != key) {
+      // Only held in memory, so there is nothing to merge.
+      if (absl::Status status = ReadVersions(records_.at(key), record_callback);
+          !status.ok()) {
+        return status;
+      }
+      continue;
+    }
+    RecordVersions record_versions;
+    while (!run_keys.empty() && run_keys.top().first == key) {
+      const size_t run_index = run_keys.top().second;
+      run_keys.pop();
+      RunReader& run = *runs[run_index];
+      MergeVersions(std::move(run.record_versions()), record_versions);
+      absl::StatusOr<bool> has_records = run.Next();
+      if (!has_records.ok()) {
+        return has_records.status();
+      }
+      if (*has_records) {
+        run_keys.push({run.key(), run_index});
+      }
+    }
+    if (in_memory) {
+      MergeVersions(records_.at(key), record_versions);
+    }
+    if (absl::Status status = ReadVersions(record_versions, record_callback);
+        !status.ok()) {
+      return status;
+    }
+  }
+  return absl::OkStatus();
+}
+
+absl::Status SortingRecordAggregator::DeleteRecord(int64_t record_key) {
+  auto it = records_.find(record_key);
+  if (it != records_.end()) {
+    memory_bytes_ -= MemoryUsage(it->second);
+    records_.erase(it);
+  }
+  if (!run_files_.empty()) {
+    // Hide the records of the key that were already spilled.
+    RecordVersions& record_versions = records_[record_key];
+    record_versions.reset = true;
+    memory_bytes_ += MemoryUsage(record_versions);
+  }
+  return absl::OkStatus();
+}
+
+absl::Status SortingRecordAggregator::DeleteRecords() {
+  records_.clear();
+  memory_bytes_ = 0;
+  RemoveRunFiles();
+  return absl::OkStatus();
+}
+
+absl::Status SortingRecordAggregator::MaybeSpill() {
+  if (options_.spill_file_prefix.empty() ||
+      memory_bytes_ < options_.max_memory_bytes) {
+    return absl::OkStatus();
+  }
+  std::vector<int64_t> keys;
+  keys.reserve(records_.size());
+  for (const auto& [key, unused] : records_) {
+    keys.push_back(key);
+  }
+  std::sort(keys.begin(), keys.end());
+  std::string run_file =
+      absl::StrCat(options_.spill_file_prefix, ".run.", run_files_.size());
+  std::ofstream stream(run_file, std::ios::binary | std::ios::trunc);
+  for (int64_t key : keys) {
+    const RecordVersions& record_versions = records_.at(key);
+    WriteValue<int64_t>(key, stream);
+    WriteValue<uint8_t>(record_versions.reset, stream);
+    WriteValue<uint32_t>(record_versions.versions.size(), stream);
+    for (const Version& version : record_versions.versions) {
+      WriteValue<int64_t>(version.logical_commit_time, stream);
+      WriteValue<uint8_t>(version.is_set, stream);
+      WriteValue<uint32_t>(version.record.size(), stream);
+      stream.write(version.record.data(), version.record.size());
+    }
+  }
+  stream.close();
+  if (!stream) {
+    std::error_code error;
+    std::filesystem::remove(run_file, error);
+    return absl::InternalError(
+        absl::StrCat("Failed to write run file: ", run_file));
+  }
+  run_files_.push_back(std::move(run_file));
+  records_.clear();
+  memory_bytes_ = 0;
+  return absl::OkStatus();
+}
+
+void SortingRecordAggregator::RemoveRunFiles() {
+  for (const std::string& run_file : run_files_) {
+    std::error_code error;
+    std::filesystem::remove(run_file, error);
+  }
+  run_files_.clear();
+}
+
+}  // namespace kv_server
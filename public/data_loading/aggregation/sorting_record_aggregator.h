@@ -0,0 +1,126 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PUBLIC_DATA_LOADING_AGGREGATION_SORTING_RECORD_AGGREGATOR_H_
+#define PUBLIC_DATA_LOADING_AGGREGATION_SORTING_RECORD_AGGREGATOR_H_
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "public/data_loading/aggregation/record_aggregator.h"
+#include "public/data_loading/records_utils.h"
+
+namespace kv_server {
+
+// A `RecordAggregator` that keeps records in a hash table instead of SQLite.
+// Once the records held in memory exceed `Options::max_memory_bytes`, they are
+// sorted by key and spilled to a run file on disk, and `ReadRecords()` merges
+// the runs with the records still in memory. Aggregating records this way
+// produces the same results as the SQLite aggregators.
+//
+// Since records of a key may be spread across runs, every accepted update of a
+// set value is kept until the records are read. `ReadRecord()` scans every run
+// and is only meant for tests and debugging.
+//
+// NOTE: This class is not thread safe.
+class SortingRecordAggregator : public RecordAggregator {
+ public:
+  struct Options {
+    // Approximate size of the records held in memory before they are spilled
+    // to a run file.
+    int64_t max_memory_bytes = int64_t{1} << 30;
+    // Prefix of the run files, which are named "<prefix>.run.<n>". Records are
+    // never spilled if empty.
+    std::string spill_file_prefix;
+  };
+
+  ~SortingRecordAggregator() override;
+
+  // Returns an invalid argument error if `max_memory_bytes` is not positive.
+  static absl::StatusOr<std::unique_ptr<SortingRecordAggregator>> Create(
+      Options options);
+
+  absl::Status InsertOrUpdateRecord(
+      int64_t record_key, const KeyValueMutationRecordStruct& record) override;
+  absl::Status ReadRecord(
+      int64_t record_key,
+      std::function<absl::Status(KeyValueMutationRecordStruct)>
+          record_callback) override;
+  absl::Status ReadRecords(
+      std::function<absl::Status(KeyValueMutationRecordStruct)>
+          record_callback) override;
+  absl::Status DeleteRecord(int64_t record_key) override;
+  absl::Status DeleteRecords() override;
+
+  // Number of runs spilled to disk so far.
+  int64_t num_runs() const { return run_files_.size(); }
+
+ private:
+  // A serialized record accepted for a key, see `RecordVersions`.
+  struct Version {
+    int64_t logical_commit_time;
+    bool is_set;
+    std::string record;
+  };
+  // The records accepted for a key, in insertion order. Only the last record
+  // that does not hold a set value and the set records accepted after it are
+  // kept, since older ones no longer affect the aggregated record. `reset` is
+  // set if the key was deleted, which hides the records of older runs.
+  struct RecordVersions {
+    bool reset = false;
+    std::vector<Version> versions;
+  };
+
+  // Reads the records of a run file in order of their keys.
+  class RunReader;
+
+  explicit SortingRecordAggregator(Options options)
+      : options_(std::move(options)) {}
+
+  // Adds `version` to `record_versions` unless it is older than the last
+  // record accepted for the key.
+  static void AddVersion(Version version, RecordVersions& record_versions);
+  // Adds the records of `newer` to `record_versions` as if they had been
+  // inserted after them.
+  static void MergeVersions(RecordVersions newer,
+                            RecordVersions& record_versions);
+  // Calls `record_callback` with the aggregated record, if there is one.
+  static absl::Status ReadVersions(
+      const RecordVersions& record_versions,
+      const std::function<absl::Status(KeyValueMutationRecordStruct)>&
+          record_callback);
+  static int64_t MemoryUsage(const RecordVersions& record_versions);
+
+  // Writes the records in memory to a new run file if they exceed
+  // `max_memory_bytes`.
+  absl::Status MaybeSpill();
+  void RemoveRunFiles();
+
+  Options options_;
+  absl::flat_hash_map<int64_t, RecordVersions> records_;
+  int64_t memory_bytes_ = 0;
+  std::vector<std::string> run_files_;
+};
+
+}  // namespace kv_server
+
+#endif  // PUBLIC_DATA_LOADING_AGGREGATION_SORTING_RECORD_AGGREGATOR_H_
@@ -0,0 +1,218 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "public/data_loading/aggregation/sorting_record_aggregator.h"
+
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_replace.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace kv_server {
+namespace {
+
+using testing::ElementsAre;
+using testing::UnorderedElementsAre;
+
+KeyValueMutationRecordStruct GetRecord(
+    std::string_view key, KeyValueMutationRecordValueT value,
+    int64_t logical_commit_time,
+    KeyValueMutationType mutation_type = KeyValueMutationType::Update) {
+  return KeyValueMutationRecordStruct{
+      .mutation_type = mutation_type,
+      .logical_commit_time = logical_commit_time,
+      .key = key,
+      .value = value,
+  };
+}
+
+// Aggregated record of a key, with its set values copied and sorted.
+struct ReadResult {
+  std::string key;
+  int64_t logical_commit_time;
+  std::string value;
+  std::vector<std::string> set_values;
+};
+
+// Runs are spilled after every insert if `GetParam()` is true.
+class SortingRecordAggregatorTest : public ::testing::TestWithParam<bool> {
+ protected:
+  SortingRecordAggregatorTest()
+      : spill_file_prefix_(
+            (std::filesystem::path(::testing::TempDir()) /
+             absl::StrReplaceAll(::testing::UnitTest::GetInstance()
+                                     ->current_test_info()
+                                     ->name(),
+                                 {{"/", "_"}}))
+                .string()) {
+    auto aggregator = SortingRecordAggregator::Create({
+        .max_memory_bytes = GetParam() ? 1 : int64_t{1} << 30,
+        .spill_file_prefix = spill_file_prefix_,
+    });
+    EXPECT_TRUE(aggregator.ok()) << aggregator.status();
+    aggregator_ = *std::move(aggregator);
+  }
+
+  void Insert(int64_t record_key, const KeyValueMutationRecordStruct& record) {
+    absl::Status status = aggregator_->InsertOrUpdateRecord(record_key, record);
+    EXPECT_TRUE(status.ok()) << status;
+  }
+
+  std::vector<ReadResult> ReadRecords() {
+    std::vector<ReadResult> results;
+    absl::Status status =
+        aggregator_->ReadRecords([&results](KeyValueMutationRecordStruct record) {
+          ReadResult result{.key = std::string(record.key),
+                            .logical_commit_time = record.logical_commit_time};
+          if (const auto* value = std::get_if<std::string_view>(&record.value)) {
+            result.value = *value;
+          } else {
+            for (std::string_view value :
+                 std::get<std::vector<std::string_view>>(record.value)) {
+              result.set_values.emplace_back(value);
+            }
+          }
+          results.push_back(std::move(result));
+          return absl::OkStatus();
+        });
+    EXPECT_TRUE(status.ok()) << status;
+    return results;
+  }
+
+  const std::string spill_file_prefix_;
+  std::unique_ptr<SortingRecordAggregator> aggregator_;
+};
+
+INSTANTIATE_TEST_SUITE_P(SpillsEveryRecord, SortingRecordAggregatorTest,
+                         testing::Bool());
+
+TEST(SortingRecordAggregatorCreateTest, RejectsNonPositiveMemoryLimit) {
+  EXPECT_EQ(SortingRecordAggregator::Create({.max_memory_bytes = 0})
+                .status()
+                .code(),
+            absl::StatusCode::kInvalidArgument);
+}
+
+TEST_P(SortingRecordAggregatorTest, ReadsLatestRecordsInKeyOrder) {
+  Insert(3, GetRecord("key3", "value3", 1));
+  Insert(1, GetRecord("key1", "old", 1));
+  Insert(2, GetRecord("key2", "value2", 5));
+  Insert(1, GetRecord("key1", "new", 2));
+  Insert(2, GetRecord("key2", "ignored", 4));
+  EXPECT_EQ(aggregator_->num_runs(), GetParam() ? 5 : 0);
+
+  std::vector<ReadResult> results = ReadRecords();
+  ASSERT_EQ(results.size(), 3);
+  EXPECT_EQ(results[0].key, "key1");
+  EXPECT_EQ(results[0].value, "new");
+  EXPECT_EQ(results[1].key, "key2");
+  EXPECT_EQ(results[1].value, "value2");
+  EXPECT_EQ(results[1].logical_commit_time, 5);
+  EXPECT_EQ(results[2].key, "key3");
+  EXPECT_EQ(results[2].value, "value3");
+}
+
+TEST_P(SortingRecordAggregatorTest, MergesSetValuesLikeSqliteAggregator) {
+  Insert(1, GetRecord("key1", std::vector<std::string_view>{"a", "b"}, 10));
+  // Older than the first record, so it is dropped even though it is older
+  // than the record after it too.
+  Insert(1, GetRecord("key1", std::vector<std::string_view>{"c"}, 5));
+  Insert(1, GetRecord("key1", std::vector<std::string_view>{"b", "d"}, 12));
+  // A value that is not a set replaces the set values merged so far.
+  Insert(2, GetRecord("key2", std::vector<std::string_view>{"a"}, 1));
+  Insert(2, GetRecord("key2", "value", 2));
+  Insert(2, GetRecord("key2", std::vector<std::string_view>{"b"}, 3));
+
+  std::vector<ReadResult> results = ReadRecords();
+  ASSERT_EQ(results.size(), 2);
+  EXPECT_THAT(results[0].set_values, UnorderedElementsAre("a", "b", "d"));
+  EXPECT_EQ(results[0].logical_commit_time, 12);
+  EXPECT_THAT(results[1].set_values, ElementsAre("b"));
+  EXPECT_EQ(results[1].logical_commit_time, 3);
+}
+
+TEST_P(SortingRecordAggregatorTest, ReadRecordMergesRuns) {
+  Insert(1, GetRecord("key1", std::vector<std::string_view>{"a"}, 1));
+  Insert(2, GetRecord("key2", "value", 1));
+  Insert(1, GetRecord("key1", std::vector<std::string_view>{"b"}, 2));
+
+  testing::MockFunction<absl::Status(KeyValueMutationRecordStruct)> callback;
+  EXPECT_CALL(callback, Call).WillOnce([](KeyValueMutationRecordStruct record) {
+    EXPECT_EQ(record.key, "key1");
+    EXPECT_THAT(std::get<std::vector<std::string_view>>(record.value),
+                UnorderedElementsAre("a", "b"));
+    return absl::OkStatus();
+  });
+  EXPECT_TRUE(aggregator_->ReadRecord(1, callback.AsStdFunction()).ok());
+  testing::MockFunction<absl::Status(KeyValueMutationRecordStruct)> missing;
+  EXPECT_CALL(missing, Call).Times(0);
+  EXPECT_TRUE(aggregator_->ReadRecord(3, missing.AsStdFunction()).ok());
+}
+
+TEST_P(SortingRecordAggregatorTest, DeleteRecordHidesSpilledRecords) {
+  Insert(1, GetRecord("key1", "value1", 1));
+  Insert(2, GetRecord("key2", "value2", 1));
+  ASSERT_TRUE(aggregator_->DeleteRecord(1).ok());
+  // Older than the deleted record, but the key was deleted in between.
+  Insert(1, GetRecord("key1", std::vector<std::string_view>{"a"}, 0));
+
+  std::vector<ReadResult> results = ReadRecords();
+  ASSERT_EQ(results.size(), 2);
+  EXPECT_EQ(results[0].key, "key1");
+  EXPECT_THAT(results[0].set_values, ElementsAre("a"));
+  EXPECT_EQ(results[1].key, "key2");
+}
+
+TEST_P(SortingRecordAggregatorTest, DeleteRecordsRemovesRunFiles) {
+  Insert(1, GetRecord("key1", "value1", 1));
+  Insert(2, GetRecord("key2", "value2", 1));
+  EXPECT_EQ(std::filesystem::exists(spill_file_prefix_ + ".run.0"),
+            GetParam());
+  ASSERT_TRUE(aggregator_->DeleteRecords().ok());
+  EXPECT_FALSE(std::filesystem::exists(spill_file_prefix_ + ".run.0"));
+  EXPECT_EQ(aggregator_->num_runs(), 0);
+  EXPECT_TRUE(ReadRecords().empty());
+}
+
+TEST_P(SortingRecordAggregatorTest, RejectsInvalidRecords) {
+  EXPECT_EQ(aggregator_->InsertOrUpdateRecord(1, GetRecord("", "value", 1))
+                .code(),
+            absl::StatusCode::kInvalidArgument);
+  EXPECT_EQ(aggregator_
+                ->InsertOrUpdateRecord(1, GetRecord("key", std::monostate(), 1))
+                .code(),
+            absl::StatusCode::kInvalidArgument);
+}
+
+TEST_P(SortingRecordAggregatorTest, ReturnsCallbackErrors) {
+  Insert(1, GetRecord("key1", "value1", 1));
+  EXPECT_EQ(aggregator_
+                ->ReadRecords([](KeyValueMutationRecordStruct) {
+                  return absl::InternalError("Callback failed.");
+                })
+                .code(),
+            absl::StatusCode::kInternal);
+}
+
+}  // namespace
+}  // namespace kv_server
@@ -16,12 +16,16 @@
 
 #include "public/data_loading/csv/csv_delta_record_stream_reader.h"
 
+#include <cstdint>
+#include <string_view>
 #include <utility>
+#include <vector>
 
 #include "absl/log/log.h"
 #include "absl/strings/ascii.h"
 #include "absl/strings/escaping.h"
 #include "absl/strings/match.h"
+#include "absl/strings/numbers.h"
 #include "absl/strings/str_split.h"
 #include "public/data_loading/record_utils.h"
 
@@ -70,6 +74,23 @@ absl::StatusOr<std::vector<std::string>> GetSetValue(
   return absl::StrSplit(csv_record[kValueColumn], value_separator);
 }
 
+// Numbers are always in decimal, whatever the encoding of strings.
+template <typename NumberT>
+absl::StatusOr<std::vector<NumberT>> GetNumericSetValue(
+    const riegeli::CsvRecord& csv_record, char value_separator) {
+  std::vector<NumberT> result;
+  for (std::string_view set_value : absl::StrSplit(
+           csv_record[kValueColumn], value_separator, absl::SkipEmpty())) {
+    if (NumberT number; absl::SimpleAtoi(set_value, &number)) {
+      result.push_back(number);
+    } else {
+      return absl::InvalidArgumentError(absl::StrCat(
+          "Cannot convert set value: ", set_value, " to a number."));
+    }
+  }
+  return result;
+}
+
 absl::StatusOr<KeyValueMutationType> GetDeltaMutationType(
     absl::string_view mutation_type) {
   if (absl::EqualsIgnoreCase(
@@ -115,6 +136,28 @@ absl::Status SetRecordValue(char value_separator,
     mutation_record.value.Set(std::move(set_value));
     return absl::OkStatus();
   }
+  if (absl::EqualsIgnoreCase(type, kValueTypeUInt32Set)) {
+    auto maybe_value =
+        GetNumericSetValue<uint32_t>(csv_record, value_separator);
+    if (!maybe_value.ok()) {
+      return maybe_value.status();
+    }
+    UInt32SetT set_value;
+    set_value.value = std::move(*maybe_value);
+    mutation_record.value.Set(std::move(set_value));
+    return absl::OkStatus();
+  }
+  if (absl::EqualsIgnoreCase(type, kValueTypeUInt64Set)) {
+    auto maybe_value =
+        GetNumericSetValue<uint64_t>(csv_record, value_separator);
+    if (!maybe_value.ok()) {
+      return maybe_value.status();
+    }
+    UInt64SetT set_value;
+    set_value.value = std::move(*maybe_value);
+    mutation_record.value.Set(std::move(set_value));
+    return absl::OkStatus();
+  }
   return absl::InvalidArgumentError(
       absl::StrCat("Value type: ", type, " is not supported"));
 }
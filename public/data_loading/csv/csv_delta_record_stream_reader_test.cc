@@ -244,6 +244,72 @@ TEST(CsvDeltaRecordStreamReaderTest,
   EXPECT_TRUE(status.ok()) << status;
 }
 
+TEST(CsvDeltaRecordStreamReaderTest,
+     ValidateReadingAndWriting_KVMutation_UInt32SetValues_Success) {
+  const std::vector<uint32_t> values{1, 20, 4294967295};
+  std::stringstream string_stream;
+  CsvDeltaRecordStreamWriter record_writer(string_stream);
+
+  UInt32SetT set_value;
+  set_value.value = values;
+  auto [legacy_mutation, mutation] =
+      GetKVMutationRecord(std::move(set_value), values);
+  auto input = GetDataRecord(legacy_mutation);
+  auto expected = GetNativeDataRecord(mutation);
+  EXPECT_TRUE(record_writer.WriteRecord(input).ok());
+  EXPECT_TRUE(record_writer.Flush().ok());
+  CsvDeltaRecordStreamReader record_reader(string_stream);
+  auto status =
+      record_reader.ReadRecords([&expected](const DataRecord& record) {
+        std::unique_ptr<DataRecordT> native_type_record(record.UnPack());
+        EXPECT_EQ(*native_type_record, expected);
+        return absl::OkStatus();
+      });
+  EXPECT_TRUE(status.ok()) << status;
+}
+
+TEST(CsvDeltaRecordStreamReaderTest,
+     ValidateReadingAndWriting_KVMutation_UInt64SetValues_Base64_Success) {
+  const std::vector<uint64_t> values{1, 18446744073709551615u};
+  std::stringstream string_stream;
+  CsvDeltaRecordStreamWriter record_writer(
+      string_stream, CsvDeltaRecordStreamWriter<std::stringstream>::Options{
+                         .csv_encoding = CsvEncoding::kBase64});
+
+  UInt64SetT set_value;
+  set_value.value = values;
+  auto [legacy_mutation, mutation] =
+      GetKVMutationRecord(std::move(set_value), values);
+  auto input = GetDataRecord(legacy_mutation);
+  auto expected = GetNativeDataRecord(mutation);
+  EXPECT_TRUE(record_writer.WriteRecord(input).ok());
+  EXPECT_TRUE(record_writer.Flush().ok());
+  CsvDeltaRecordStreamReader record_reader(
+      string_stream, CsvDeltaRecordStreamReader<std::stringstream>::Options{
+                         .csv_encoding = CsvEncoding::kBase64});
+  auto status =
+      record_reader.ReadRecords([&expected](const DataRecord& record) {
+        std::unique_ptr<DataRecordT> native_type_record(record.UnPack());
+        EXPECT_EQ(*native_type_record, expected);
+        return absl::OkStatus();
+      });
+  EXPECT_TRUE(status.ok()) << status;
+}
+
+TEST(CsvDeltaRecordStreamReaderTest,
+     ValidateReadingCsvRecord_KVMutation_UInt32SetValues_Invalid_Failure) {
+  const char data[] =
+      R"csv(key,value,value_type,mutation_type,logical_commit_time
+  key,1|4294967296,uint32_set,Update,1)csv";
+  std::stringstream csv_stream;
+  csv_stream.str(data);
+  CsvDeltaRecordStreamReader record_reader(csv_stream);
+  const auto status = record_reader.ReadRecords(
+      [](const DataRecord&) { return absl::OkStatus(); });
+  EXPECT_FALSE(status.ok()) << status;
+  EXPECT_EQ(status.code(), absl::StatusCode::kInvalidArgument) << status;
+}
+
 TEST(CsvDeltaRecordStreamReaderTest,
      ValidateReadingAndWriting_KVMutation_SetValues_Base64_Invalid_Failure) {
   const char data[] =
@@ -84,6 +84,19 @@ absl::StatusOr<ValueStruct> GetRecordValue(
                                      value_separator),
           };
         }
+        // Numbers are written in decimal whatever the encoding of strings.
+        if constexpr (std::is_same_v<VariantT, std::vector<uint32_t>>) {
+          return ValueStruct{
+              .value_type = std::string(kValueTypeUInt32Set),
+              .value = absl::StrJoin(arg, value_separator),
+          };
+        }
+        if constexpr (std::is_same_v<VariantT, std::vector<uint64_t>>) {
+          return ValueStruct{
+              .value_type = std::string(kValueTypeUInt64Set),
+              .value = absl::StrJoin(arg, value_separator),
+          };
+        }
         return absl::InvalidArgumentError("Value must be set.");
       },
       value);
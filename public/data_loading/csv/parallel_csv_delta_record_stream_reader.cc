@@ -0,0 +1,78 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "public/data_loading/csv/parallel_csv_delta_record_stream_reader.h"
+
+#include <utility>
+
+#include "public/data_loading/record_utils.h"
+#include "riegeli/bytes/string_reader.h"
+
+namespace kv_server {
+namespace internal {
+namespace {
+constexpr char kQuote = '"';
+constexpr char kLineBreak = '\n';
+}  // namespace
+
+size_t FindFirstCsvRecordEnd(std::string_view data) {
+  bool quoted = false;
+  for (size_t i = 0; i < data.size(); ++i) {
+    if (data[i] == kQuote) {
+      // Escaped quotes toggle twice, so they do not change `quoted`.
+      quoted = !quoted;
+    } else if (data[i] == kLineBreak && !quoted) {
+      return i + 1;
+    }
+  }
+  return 0;
+}
+
+size_t FindLastCsvRecordEnd(std::string_view data) {
+  bool quoted = false;
+  size_t records_end = 0;
+  for (size_t i = 0; i < data.size(); ++i) {
+    if (data[i] == kQuote) {
+      quoted = !quoted;
+    } else if (data[i] == kLineBreak && !quoted) {
+      records_end = i + 1;
+    }
+  }
+  return records_end;
+}
+
+ParsedCsvChunk ParseCsvChunk(
+    std::string chunk, const riegeli::CsvReaderBase::Options& reader_options,
+    const CsvDeltaRecordStreamReaderOptions& options) {
+  ParsedCsvChunk result;
+  riegeli::CsvReader<riegeli::StringReader<>> record_reader(
+      riegeli::StringReader<>(chunk), reader_options);
+  riegeli::CsvRecord csv_record;
+  while (record_reader.ReadRecord(csv_record)) {
+    absl::StatusOr<DataRecordT> delta_record =
+        MakeDeltaFileRecordStruct(csv_record, options);
+    if (!delta_record.ok()) {
+      result.status.Update(delta_record.status());
+      continue;
+    }
+    auto [builder, serialized_string_view] = Serialize(*delta_record);
+    result.records.push_back(std::move(builder));
+  }
+  result.status.Update(record_reader.status());
+  record_reader.Close();
+  return result;
+}
+
+}  // namespace internal
+}  // namespace kv_server
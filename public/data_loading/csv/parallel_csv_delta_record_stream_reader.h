@@ -0,0 +1,200 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PUBLIC_DATA_LOADING_CSV_PARALLEL_CSV_DELTA_RECORD_STREAM_READER_H_
+#define PUBLIC_DATA_LOADING_CSV_PARALLEL_CSV_DELTA_RECORD_STREAM_READER_H_
+
+#include <deque>
+#include <functional>
+#include <future>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "absl/log/log.h"
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "public/data_loading/csv/csv_delta_record_stream_reader.h"
+#include "public/data_loading/readers/delta_record_reader.h"
+#include "riegeli/csv/csv_reader.h"
+
+namespace kv_server {
+
+// A `ParallelCsvDeltaRecordStreamReader` reads the same CSV records as a
+// `CsvDeltaRecordStreamReader`, but splits the input into chunks on record
+// boundaries and parses up to `num_worker_threads` chunks concurrently.
+// Records are passed to the callback on the calling thread, in input order.
+//
+// A record boundary is a line break outside of a quoted field, so quoted
+// fields may contain line breaks, e.g., for UDF code snippets. Each chunk is
+// parsed with the header of the input, so a chunk holds about
+// `chunk_size_bytes` bytes of records and at most `num_worker_threads` parsed
+// chunks are held in memory at a time.
+//
+// ```
+// std::ifstream csv_file(my_filename);
+// ParallelCsvDeltaRecordStreamReader record_reader(
+//     csv_file, ParallelCsvDeltaRecordStreamReader<>::Options{
+//                   .num_worker_threads = 8});
+// absl::Status status = record_reader.ReadRecords(
+//  [](const DataRecord& record) {
+//    UseRecord(record);
+//    return absl::OkStatus();
+//  }
+// );
+// ```
+struct ParallelCsvDeltaRecordStreamReaderOptions {
+  CsvDeltaRecordStreamReaderOptions csv_options;
+  int64_t num_worker_threads = std::thread::hardware_concurrency();
+  int64_t chunk_size_bytes = 8 * 1024 * 1024;
+};
+
+namespace internal {
+
+// Records of a CSV chunk serialized as `DataRecord` flatbuffers.
+struct ParsedCsvChunk {
+  std::vector<flatbuffers::FlatBufferBuilder> records;
+  absl::Status status;
+};
+
+// Returns the position right after the first line break of `data` that is
+// outside of a quoted field, or 0 if there is none.
+size_t FindFirstCsvRecordEnd(std::string_view data);
+
+// Returns the position right after the last line break of `data` that is
+// outside of a quoted field, or 0 if there is none.
+size_t FindLastCsvRecordEnd(std::string_view data);
+
+// Parses `chunk`, which starts with the CSV header, into records.
+ParsedCsvChunk ParseCsvChunk(
+    std::string chunk, const riegeli::CsvReaderBase::Options& reader_options,
+    const CsvDeltaRecordStreamReaderOptions& options);
+
+}  // namespace internal
+
+template <typename SrcStreamT = std::iostream>
+class ParallelCsvDeltaRecordStreamReader : public DeltaRecordReader {
+ public:
+  using Options = ParallelCsvDeltaRecordStreamReaderOptions;
+  ParallelCsvDeltaRecordStreamReader(SrcStreamT& src_stream,
+                                     Options options = Options())
+      : src_stream_(src_stream),
+        options_(std::move(options)),
+        reader_options_(internal::GetRecordReaderOptions<SrcStreamT>(
+            options_.csv_options)) {}
+  ParallelCsvDeltaRecordStreamReader(
+      const ParallelCsvDeltaRecordStreamReader&) = delete;
+  ParallelCsvDeltaRecordStreamReader& operator=(
+      const ParallelCsvDeltaRecordStreamReader&) = delete;
+
+  absl::Status ReadRecords(const std::function<absl::Status(const DataRecord&)>&
+                               record_callback) override;
+  absl::Status ReadRecords(const std::function<absl::Status(DataRecordStruct)>&
+                               record_callback) override {
+    return absl::UnimplementedError(
+        "CSV reader is updated to use newer data structures");
+  }
+  bool IsOpen() const override { return !src_stream_.bad(); };
+  absl::Status Status() const override { return status_; }
+
+ private:
+  SrcStreamT& src_stream_;
+  Options options_;
+  riegeli::CsvReaderBase::Options reader_options_;
+  absl::Status status_;
+};
+
+template <typename SrcStreamT>
+absl::Status ParallelCsvDeltaRecordStreamReader<SrcStreamT>::ReadRecords(
+    const std::function<absl::Status(const DataRecord&)>& record_callback) {
+  if (options_.num_worker_threads < 1 || options_.chunk_size_bytes < 1) {
+    return absl::InvalidArgumentError(absl::StrCat(
+        "Num worker threads ", options_.num_worker_threads,
+        " and chunk size ", options_.chunk_size_bytes, " must be positive."));
+  }
+  VLOG(9) << "Reading CSV records in parallel. Record type: "
+          << EnumNameRecord(options_.csv_options.record_type);
+  absl::Status overall_status;
+  std::deque<std::future<internal::ParsedCsvChunk>> chunks;
+  const auto consume_oldest_chunk = [&chunks, &overall_status,
+                                     &record_callback]() {
+    internal::ParsedCsvChunk chunk = chunks.front().get();
+    chunks.pop_front();
+    for (const auto& record : chunk.records) {
+      overall_status.Update(record_callback(
+          *flatbuffers::GetRoot<DataRecord>(record.GetBufferPointer())));
+    }
+    overall_status.Update(chunk.status);
+  };
+  std::string header;
+  bool has_header = false;
+  bool has_chunks = false;
+  std::string pending;
+  bool at_end = false;
+  while (!at_end) {
+    const size_t pending_size = pending.size();
+    pending.resize(pending_size + options_.chunk_size_bytes);
+    src_stream_.read(pending.data() + pending_size, options_.chunk_size_bytes);
+    pending.resize(pending_size + src_stream_.gcount());
+    at_end = !src_stream_.good();
+    if (!has_header) {
+      size_t header_end = internal::FindFirstCsvRecordEnd(pending);
+      if (header_end == 0) {
+        if (!at_end) {
+          continue;
+        }
+        header_end = pending.size();
+      }
+      header = pending.substr(0, header_end);
+      pending.erase(0, header_end);
+      has_header = true;
+    }
+    const size_t records_end =
+        at_end ? pending.size() : internal::FindLastCsvRecordEnd(pending);
+    // The header is parsed at least once so that invalid headers fail.
+    if (records_end == 0 && (has_chunks || !at_end)) {
+      continue;
+    }
+    std::string chunk;
+    chunk.reserve(header.size() + records_end);
+    chunk.append(header);
+    chunk.append(pending, 0, records_end);
+    pending.erase(0, records_end);
+    if (chunks.size() >= static_cast<size_t>(options_.num_worker_threads)) {
+      consume_oldest_chunk();
+    }
+    // std::async is generally not preffered, but works fine as an
+    // initial implementation.
+    chunks.push_back(std::async(std::launch::async, internal::ParseCsvChunk,
+                                std::move(chunk), std::cref(reader_options_),
+                                std::cref(options_.csv_options)));
+    has_chunks = true;
+  }
+  while (!chunks.empty()) {
+    consume_oldest_chunk();
+  }
+  if (src_stream_.bad()) {
+    status_ = absl::InternalError("Failed to read the CSV input stream.");
+  }
+  overall_status.Update(status_);
+  return overall_status;
+}
+
+}  // namespace kv_server
+
+#endif  // PUBLIC_DATA_LOADING_CSV_PARALLEL_CSV_DELTA_RECORD_STREAM_READER_H_
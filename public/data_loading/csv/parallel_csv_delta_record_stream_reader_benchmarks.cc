@@ -0,0 +1,82 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <sstream>
+#include <string>
+
+#include "absl/strings/str_cat.h"
+#include "benchmark/benchmark.h"
+#include "public/data_loading/csv/csv_delta_record_stream_reader.h"
+#include "public/data_loading/csv/parallel_csv_delta_record_stream_reader.h"
+
+using kv_server::CsvDeltaRecordStreamReader;
+using kv_server::DataRecord;
+using kv_server::ParallelCsvDeltaRecordStreamReader;
+
+static constexpr int64_t kNumRecords = 100'000;
+
+static const std::string& GetCsv() {
+  static const std::string* csv = [] {
+    auto* csv = new std::string(
+        "key,value,value_type,mutation_type,logical_commit_time\n");
+    for (int64_t i = 0; i < kNumRecords; ++i) {
+      absl::StrAppend(csv, "key", i, ",", std::string(64, 'A' + i % 26),
+                      ",string,Update,", i, "\n");
+    }
+    return csv;
+  }();
+  return *csv;
+}
+
+static void BM_CsvDeltaRecordStreamReader(benchmark::State& state) {
+  const std::string& csv = GetCsv();
+  for (auto _ : state) {
+    std::istringstream csv_stream(csv);
+    CsvDeltaRecordStreamReader<std::istringstream> record_reader(csv_stream);
+    auto status = record_reader.ReadRecords([](const DataRecord& record) {
+      benchmark::DoNotOptimize(record);
+      return absl::OkStatus();
+    });
+    benchmark::DoNotOptimize(status);
+  }
+  state.SetBytesProcessed(csv.size() * state.iterations());
+  state.SetItemsProcessed(kNumRecords * state.iterations());
+}
+
+static void BM_ParallelCsvDeltaRecordStreamReader(benchmark::State& state) {
+  const std::string& csv = GetCsv();
+  for (auto _ : state) {
+    std::istringstream csv_stream(csv);
+    ParallelCsvDeltaRecordStreamReader<std::istringstream> record_reader(
+        csv_stream,
+        ParallelCsvDeltaRecordStreamReader<std::istringstream>::Options{
+            .num_worker_threads = state.range(0),
+            .chunk_size_bytes = 1024 * 1024});
+    auto status = record_reader.ReadRecords([](const DataRecord& record) {
+      benchmark::DoNotOptimize(record);
+      return absl::OkStatus();
+    });
+    benchmark::DoNotOptimize(status);
+  }
+  state.SetBytesProcessed(csv.size() * state.iterations());
+  state.SetItemsProcessed(kNumRecords * state.iterations());
+}
+
+BENCHMARK(BM_CsvDeltaRecordStreamReader)->UseRealTime();
+BENCHMARK(BM_ParallelCsvDeltaRecordStreamReader)
+    ->RangeMultiplier(2)
+    ->Range(1, 16)
+    ->UseRealTime();
+
+BENCHMARK_MAIN();
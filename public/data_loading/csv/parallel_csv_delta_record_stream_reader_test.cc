@@ -0,0 +1,171 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "public/data_loading/csv/parallel_csv_delta_record_stream_reader.h"
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace kv_server {
+namespace {
+
+using testing::ElementsAreArray;
+
+std::string GetKVMutationRecordsCsv(int num_records) {
+  std::string csv = "key,value,value_type,mutation_type,logical_commit_time\n";
+  for (int i = 0; i < num_records; ++i) {
+    absl::StrAppend(&csv, "key", i, ",value", i, ",string,Update,", i, "\n");
+  }
+  return csv;
+}
+
+std::vector<std::string> ReadKeys(
+    std::stringstream& csv_stream,
+    ParallelCsvDeltaRecordStreamReader<std::stringstream>::Options options,
+    absl::Status& status) {
+  std::vector<std::string> keys;
+  ParallelCsvDeltaRecordStreamReader record_reader(csv_stream, options);
+  status = record_reader.ReadRecords([&keys](const DataRecord& record) {
+    keys.push_back(record.record_as_KeyValueMutationRecord()->key()->str());
+    return absl::OkStatus();
+  });
+  return keys;
+}
+
+TEST(ParallelCsvDeltaRecordStreamReaderTest, FindCsvRecordEnds) {
+  EXPECT_EQ(internal::FindFirstCsvRecordEnd("a,b\nc,d\ne"), 4);
+  EXPECT_EQ(internal::FindLastCsvRecordEnd("a,b\nc,d\ne"), 8);
+  EXPECT_EQ(internal::FindFirstCsvRecordEnd("a,b"), 0);
+  EXPECT_EQ(internal::FindLastCsvRecordEnd("a,b"), 0);
+  EXPECT_EQ(internal::FindFirstCsvRecordEnd("\"a\nb\",\"\"\"c\"\nd"), 12);
+  EXPECT_EQ(internal::FindLastCsvRecordEnd("a\n\"b\nc"), 2);
+}
+
+TEST(ParallelCsvDeltaRecordStreamReaderTest,
+     ReadsKVMutationRecordsInInputOrder) {
+  std::stringstream csv_stream(GetKVMutationRecordsCsv(1000));
+  absl::Status status;
+  std::vector<std::string> keys = ReadKeys(
+      csv_stream, {.num_worker_threads = 4, .chunk_size_bytes = 100}, status);
+  EXPECT_TRUE(status.ok()) << status;
+  std::vector<std::string> expected;
+  for (int i = 0; i < 1000; ++i) {
+    expected.push_back(absl::StrCat("key", i));
+  }
+  EXPECT_THAT(keys, ElementsAreArray(expected));
+}
+
+TEST(ParallelCsvDeltaRecordStreamReaderTest,
+     ReadsSameRecordsAsCsvDeltaRecordStreamReader) {
+  const std::string csv =
+      "key,value,value_type,mutation_type,logical_commit_time\n"
+      "key1,a|b|c,string_set,Update,1\n"
+      "key2,value2,string,Delete,2\n"
+      "key3,\"value,3\",string,Update,3";
+  std::stringstream expected_stream(csv);
+  std::vector<DataRecordT> expected;
+  CsvDeltaRecordStreamReader expected_reader(expected_stream);
+  ASSERT_TRUE(expected_reader
+                  .ReadRecords([&expected](const DataRecord& record) {
+                    expected.push_back(
+                        *std::unique_ptr<DataRecordT>(record.UnPack()));
+                    return absl::OkStatus();
+                  })
+                  .ok());
+  ASSERT_EQ(expected.size(), 3);
+
+  std::stringstream csv_stream(csv);
+  std::vector<DataRecordT> records;
+  ParallelCsvDeltaRecordStreamReader record_reader(
+      csv_stream,
+      ParallelCsvDeltaRecordStreamReader<std::stringstream>::Options{
+          .num_worker_threads = 2, .chunk_size_bytes = 16});
+  auto status = record_reader.ReadRecords([&records](const DataRecord& record) {
+    records.push_back(*std::unique_ptr<DataRecordT>(record.UnPack()));
+    return absl::OkStatus();
+  });
+  EXPECT_TRUE(status.ok()) << status;
+  EXPECT_EQ(records, expected);
+}
+
+TEST(ParallelCsvDeltaRecordStreamReaderTest,
+     ReadsUdfConfigWithLineBreaksInQuotedField) {
+  std::stringstream csv_stream(
+      "code_snippet,handler_name,language,logical_commit_time,version\n"
+      "\"function hello() {\n  return \"\"hi\"\";\n}\",hello,javascript,1,1\n");
+  std::vector<std::string> code_snippets;
+  ParallelCsvDeltaRecordStreamReader record_reader(
+      csv_stream,
+      ParallelCsvDeltaRecordStreamReader<std::stringstream>::Options{
+          .csv_options = {.record_type = Record::UserDefinedFunctionsConfig},
+          .num_worker_threads = 2,
+          .chunk_size_bytes = 8});
+  auto status =
+      record_reader.ReadRecords([&code_snippets](const DataRecord& record) {
+        code_snippets.push_back(record.record_as_UserDefinedFunctionsConfig()
+                                    ->code_snippet()
+                                    ->str());
+        return absl::OkStatus();
+      });
+  EXPECT_TRUE(status.ok()) << status;
+  EXPECT_THAT(code_snippets,
+              ElementsAreArray({"function hello() {\n  return \"hi\";\n}"}));
+}
+
+TEST(ParallelCsvDeltaRecordStreamReaderTest,
+     InvalidRecordsFailButValidRecordsAreRead) {
+  std::stringstream csv_stream(
+      "key,value,value_type,mutation_type,logical_commit_time\n"
+      "key1,value1,string,Update,1\n"
+      "key2,value2,string,Update,invalid_time\n"
+      "key3,value3,string,Update,3\n");
+  absl::Status status;
+  std::vector<std::string> keys = ReadKeys(
+      csv_stream, {.num_worker_threads = 2, .chunk_size_bytes = 32}, status);
+  EXPECT_EQ(status.code(), absl::StatusCode::kInvalidArgument) << status;
+  EXPECT_EQ(status.message(),
+            "Cannot convert logical_commit_time:invalid_time to a number.");
+  EXPECT_THAT(keys, ElementsAreArray({"key1", "key3"}));
+}
+
+TEST(ParallelCsvDeltaRecordStreamReaderTest, InvalidHeaderFails) {
+  std::stringstream csv_stream("key,value\n");
+  absl::Status status;
+  std::vector<std::string> keys = ReadKeys(csv_stream, {}, status);
+  EXPECT_FALSE(status.ok());
+  EXPECT_TRUE(keys.empty());
+}
+
+TEST(ParallelCsvDeltaRecordStreamReaderTest, HeaderWithoutRecordsSucceeds) {
+  std::stringstream csv_stream(GetKVMutationRecordsCsv(0));
+  absl::Status status;
+  std::vector<std::string> keys = ReadKeys(csv_stream, {}, status);
+  EXPECT_TRUE(status.ok()) << status;
+  EXPECT_TRUE(keys.empty());
+}
+
+TEST(ParallelCsvDeltaRecordStreamReaderTest, InvalidOptionsFail) {
+  std::stringstream csv_stream(GetKVMutationRecordsCsv(1));
+  absl::Status status;
+  ReadKeys(csv_stream, {.num_worker_threads = 0}, status);
+  EXPECT_EQ(status.code(), absl::StatusCode::kInvalidArgument) << status;
+}
+
+}  // namespace
+}  // namespace kv_server
@@ -38,6 +38,14 @@ struct StringSet;
 struct StringSetBuilder;
 struct StringSetT;
 
+struct UInt32Set;
+struct UInt32SetBuilder;
+struct UInt32SetT;
+
+struct UInt64Set;
+struct UInt64SetBuilder;
+struct UInt64SetT;
+
 struct KeyValueMutationRecord;
 struct KeyValueMutationRecordBuilder;
 struct KeyValueMutationRecordT;
@@ -50,6 +58,10 @@ struct ShardMappingRecord;
 struct ShardMappingRecordBuilder;
 struct ShardMappingRecordT;
 
+struct CompressionDictionaryConfig;
+struct CompressionDictionaryConfigBuilder;
+struct CompressionDictionaryConfigT;
+
 struct DataRecord;
 struct DataRecordBuilder;
 struct DataRecordT;
@@ -84,22 +96,26 @@ enum class Value : uint8_t {
   NONE = 0,
   String = 1,
   StringSet = 2,
+  UInt32Set = 3,
+  UInt64Set = 4,
   MIN = NONE,
-  MAX = StringSet
+  MAX = UInt64Set
 };
 
-inline const Value (&EnumValuesValue())[3] {
-  static const Value values[] = {Value::NONE, Value::String, Value::StringSet};
+inline const Value (&EnumValuesValue())[5] {
+  static const Value values[] = {Value::NONE, Value::String, Value::StringSet,
+                                 Value::UInt32Set, Value::UInt64Set};
   return values;
 }
 
 inline const char* const* EnumNamesValue() {
-  static const char* const names[4] = {"NONE", "String", "StringSet", nullptr};
+  static const char* const names[6] = {"NONE",      "String",    "StringSet",
+                                       "UInt32Set", "UInt64Set", nullptr};
   return names;
 }
 
 inline const char* EnumNameValue(Value e) {
-  if (flatbuffers::IsOutRange(e, Value::NONE, Value::StringSet)) return "";
+  if (flatbuffers::IsOutRange(e, Value::NONE, Value::UInt64Set)) return "";
   const size_t index = static_cast<size_t>(e);
   return EnumNamesValue()[index];
 }
@@ -119,6 +135,16 @@ struct ValueTraits<kv_server::StringSet> {
   static const Value enum_value = Value::StringSet;
 };
 
+template <>
+struct ValueTraits<kv_server::UInt32Set> {
+  static const Value enum_value = Value::UInt32Set;
+};
+
+template <>
+struct ValueTraits<kv_server::UInt64Set> {
+  static const Value enum_value = Value::UInt64Set;
+};
+
 template <typename T>
 struct ValueUnionTraits {
   static const Value enum_value = Value::NONE;
@@ -134,6 +160,16 @@ struct ValueUnionTraits<kv_server::StringSetT> {
   static const Value enum_value = Value::StringSet;
 };
 
+template <>
+struct ValueUnionTraits<kv_server::UInt32SetT> {
+  static const Value enum_value = Value::UInt32Set;
+};
+
+template <>
+struct ValueUnionTraits<kv_server::UInt64SetT> {
+  static const Value enum_value = Value::UInt64Set;
+};
+
 struct ValueUnion {
   Value type;
   void* value;
@@ -195,6 +231,26 @@ struct ValueUnion {
                ? reinterpret_cast<const kv_server::StringSetT*>(value)
                : nullptr;
   }
+  kv_server::UInt32SetT* AsUInt32Set() {
+    return type == Value::UInt32Set
+               ? reinterpret_cast<kv_server::UInt32SetT*>(value)
+               : nullptr;
+  }
+  const kv_server::UInt32SetT* AsUInt32Set() const {
+    return type == Value::UInt32Set
+               ? reinterpret_cast<const kv_server::UInt32SetT*>(value)
+               : nullptr;
+  }
+  kv_server::UInt64SetT* AsUInt64Set() {
+    return type == Value::UInt64Set
+               ? reinterpret_cast<kv_server::UInt64SetT*>(value)
+               : nullptr;
+  }
+  const kv_server::UInt64SetT* AsUInt64Set() const {
+    return type == Value::UInt64Set
+               ? reinterpret_cast<const kv_server::UInt64SetT*>(value)
+               : nullptr;
+  }
 };
 
 bool VerifyValue(flatbuffers::Verifier& verifier, const void* obj, Value type);
@@ -230,31 +286,66 @@ inline const char* EnumNameUserDefinedFunctionsLanguage(
   return EnumNamesUserDefinedFunctionsLanguage()[index];
 }
 
+enum class UserDefinedFunctionsInputFormat : int8_t {
+  Json = 0,
+  Protobuf = 1,
+  MIN = Json,
+  MAX = Protobuf
+};
+
+inline const UserDefinedFunctionsInputFormat (
+    &EnumValuesUserDefinedFunctionsInputFormat())[2] {
+  static const UserDefinedFunctionsInputFormat values[] = {
+      UserDefinedFunctionsInputFormat::Json,
+      UserDefinedFunctionsInputFormat::Protobuf};
+  return values;
+}
+
+inline const char* const* EnumNamesUserDefinedFunctionsInputFormat() {
+  static const char* const names[3] = {"Json", "Protobuf", nullptr};
+  return names;
+}
+
+inline const char* EnumNameUserDefinedFunctionsInputFormat(
+    UserDefinedFunctionsInputFormat e) {
+  if (flatbuffers::IsOutRange(e, UserDefinedFunctionsInputFormat::Json,
+                              UserDefinedFunctionsInputFormat::Protobuf))
+    return "";
+  const size_t index = static_cast<size_t>(e);
+  return EnumNamesUserDefinedFunctionsInputFormat()[index];
+}
+
 enum class Record : uint8_t {
   NONE = 0,
   KeyValueMutationRecord = 1,
   UserDefinedFunctionsConfig = 2,
   ShardMappingRecord = 3,
+  CompressionDictionaryConfig = 4,
   MIN = NONE,
-  MAX = ShardMappingRecord
+  MAX = CompressionDictionaryConfig
 };
 
-inline const Record (&EnumValuesRecord())[4] {
-  static const Record values[] = {Record::NONE, Record::KeyValueMutationRecord,
-                                  Record::UserDefinedFunctionsConfig,
-                                  Record::ShardMappingRecord};
+inline const Record (&EnumValuesRecord())[5] {
+  static const Record values[] = {
+      Record::NONE, Record::KeyValueMutationRecord,
+      Record::UserDefinedFunctionsConfig, Record::ShardMappingRecord,
+      Record::CompressionDictionaryConfig};
   return values;
 }
 
 inline const char* const* EnumNamesRecord() {
-  static const char* const names[5] = {"NONE", "KeyValueMutationRecord",
+  static const char* const names[6] = {"NONE",
+                                       "KeyValueMutationRecord",
                                        "UserDefinedFunctionsConfig",
-                                       "ShardMappingRecord", nullptr};
+                                       "ShardMappingRecord",
+                                       "CompressionDictionaryConfig",
+                                       nullptr};
   return names;
 }
 
 inline const char* EnumNameRecord(Record e) {
-  if (flatbuffers::IsOutRange(e, Record::NONE, Record::ShardMappingRecord))
+  if (flatbuffers::IsOutRange(e, Record::NONE,
+                              Record::CompressionDictionaryConfig))
     return "";
   const size_t index = static_cast<size_t>(e);
   return EnumNamesRecord()[index];
@@ -280,6 +371,11 @@ struct RecordTraits<kv_server::ShardMappingRecord> {
   static const Record enum_value = Record::ShardMappingRecord;
 };
 
+template <>
+struct RecordTraits<kv_server::CompressionDictionaryConfig> {
+  static const Record enum_value = Record::CompressionDictionaryConfig;
+};
+
 template <typename T>
 struct RecordUnionTraits {
   static const Record enum_value = Record::NONE;
@@ -300,6 +396,11 @@ struct RecordUnionTraits<kv_server::ShardMappingRecordT> {
   static const Record enum_value = Record::ShardMappingRecord;
 };
 
+template <>
+struct RecordUnionTraits<kv_server::CompressionDictionaryConfigT> {
+  static const Record enum_value = Record::CompressionDictionaryConfig;
+};
+
 struct RecordUnion {
   Record type;
   void* value;
@@ -376,6 +477,19 @@ struct RecordUnion {
                ? reinterpret_cast<const kv_server::ShardMappingRecordT*>(value)
                : nullptr;
   }
+  kv_server::CompressionDictionaryConfigT* AsCompressionDictionaryConfig() {
+    return type == Record::CompressionDictionaryConfig
+               ? reinterpret_cast<kv_server::CompressionDictionaryConfigT*>(
+                     value)
+               : nullptr;
+  }
+  const kv_server::CompressionDictionaryConfigT* AsCompressionDictionaryConfig()
+      const {
+    return type == Record::CompressionDictionaryConfig
+               ? reinterpret_cast<
+                     const kv_server::CompressionDictionaryConfigT*>(value)
+               : nullptr;
+  }
 };
 
 bool VerifyRecord(flatbuffers::Verifier& verifier, const void* obj,
@@ -535,6 +649,146 @@ flatbuffers::Offset<StringSet> CreateStringSet(
     flatbuffers::FlatBufferBuilder& _fbb, const StringSetT* _o,
     const flatbuffers::rehasher_function_t* _rehasher = nullptr);
 
+struct UInt32SetT : public flatbuffers::NativeTable {
+  typedef UInt32Set TableType;
+  std::vector<uint32_t> value{};
+};
+
+struct UInt32Set FLATBUFFERS_FINAL_CLASS : private flatbuffers::Table {
+  typedef UInt32SetT NativeTableType;
+  typedef UInt32SetBuilder Builder;
+  struct Traits;
+  enum FlatBuffersVTableOffset FLATBUFFERS_VTABLE_UNDERLYING_TYPE {
+    VT_VALUE = 4
+  };
+  const flatbuffers::Vector<uint32_t>* value() const {
+    return GetPointer<const flatbuffers::Vector<uint32_t>*>(VT_VALUE);
+  }
+  bool Verify(flatbuffers::Verifier& verifier) const {
+    return VerifyTableStart(verifier) && VerifyOffset(verifier, VT_VALUE) &&
+           verifier.VerifyVector(value()) && verifier.EndTable();
+  }
+  UInt32SetT* UnPack(
+      const flatbuffers::resolver_function_t* _resolver = nullptr) const;
+  void UnPackTo(
+      UInt32SetT* _o,
+      const flatbuffers::resolver_function_t* _resolver = nullptr) const;
+  static flatbuffers::Offset<UInt32Set> Pack(
+      flatbuffers::FlatBufferBuilder& _fbb, const UInt32SetT* _o,
+      const flatbuffers::rehasher_function_t* _rehasher = nullptr);
+};
+
+struct UInt32SetBuilder {
+  typedef UInt32Set Table;
+  flatbuffers::FlatBufferBuilder& fbb_;
+  flatbuffers::uoffset_t start_;
+  void add_value(flatbuffers::Offset<flatbuffers::Vector<uint32_t>> value) {
+    fbb_.AddOffset(UInt32Set::VT_VALUE, value);
+  }
+  explicit UInt32SetBuilder(flatbuffers::FlatBufferBuilder& _fbb) : fbb_(_fbb) {
+    start_ = fbb_.StartTable();
+  }
+  flatbuffers::Offset<UInt32Set> Finish() {
+    const auto end = fbb_.EndTable(start_);
+    auto o = flatbuffers::Offset<UInt32Set>(end);
+    return o;
+  }
+};
+
+inline flatbuffers::Offset<UInt32Set> CreateUInt32Set(
+    flatbuffers::FlatBufferBuilder& _fbb,
+    flatbuffers::Offset<flatbuffers::Vector<uint32_t>> value = 0) {
+  UInt32SetBuilder builder_(_fbb);
+  builder_.add_value(value);
+  return builder_.Finish();
+}
+
+struct UInt32Set::Traits {
+  using type = UInt32Set;
+  static auto constexpr Create = CreateUInt32Set;
+};
+
+inline flatbuffers::Offset<UInt32Set> CreateUInt32SetDirect(
+    flatbuffers::FlatBufferBuilder& _fbb,
+    const std::vector<uint32_t>* value = nullptr) {
+  auto value__ = value ? _fbb.CreateVector<uint32_t>(*value) : 0;
+  return kv_server::CreateUInt32Set(_fbb, value__);
+}
+
+flatbuffers::Offset<UInt32Set> CreateUInt32Set(
+    flatbuffers::FlatBufferBuilder& _fbb, const UInt32SetT* _o,
+    const flatbuffers::rehasher_function_t* _rehasher = nullptr);
+
+struct UInt64SetT : public flatbuffers::NativeTable {
+  typedef UInt64Set TableType;
+  std::vector<uint64_t> value{};
+};
+
+struct UInt64Set FLATBUFFERS_FINAL_CLASS : private flatbuffers::Table {
+  typedef UInt64SetT NativeTableType;
+  typedef UInt64SetBuilder Builder;
+  struct Traits;
+  enum FlatBuffersVTableOffset FLATBUFFERS_VTABLE_UNDERLYING_TYPE {
+    VT_VALUE = 4
+  };
+  const flatbuffers::Vector<uint64_t>* value() const {
+    return GetPointer<const flatbuffers::Vector<uint64_t>*>(VT_VALUE);
+  }
+  bool Verify(flatbuffers::Verifier& verifier) const {
+    return VerifyTableStart(verifier) && VerifyOffset(verifier, VT_VALUE) &&
+           verifier.VerifyVector(value()) && verifier.EndTable();
+  }
+  UInt64SetT* UnPack(
+      const flatbuffers::resolver_function_t* _resolver = nullptr) const;
+  void UnPackTo(
+      UInt64SetT* _o,
+      const flatbuffers::resolver_function_t* _resolver = nullptr) const;
+  static flatbuffers::Offset<UInt64Set> Pack(
+      flatbuffers::FlatBufferBuilder& _fbb, const UInt64SetT* _o,
+      const flatbuffers::rehasher_function_t* _rehasher = nullptr);
+};
+
+struct UInt64SetBuilder {
+  typedef UInt64Set Table;
+  flatbuffers::FlatBufferBuilder& fbb_;
+  flatbuffers::uoffset_t start_;
+  void add_value(flatbuffers::Offset<flatbuffers::Vector<uint64_t>> value) {
+    fbb_.AddOffset(UInt64Set::VT_VALUE, value);
+  }
+  explicit UInt64SetBuilder(flatbuffers::FlatBufferBuilder& _fbb) : fbb_(_fbb) {
+    start_ = fbb_.StartTable();
+  }
+  flatbuffers::Offset<UInt64Set> Finish() {
+    const auto end = fbb_.EndTable(start_);
+    auto o = flatbuffers::Offset<UInt64Set>(end);
+    return o;
+  }
+};
+
+inline flatbuffers::Offset<UInt64Set> CreateUInt64Set(
+    flatbuffers::FlatBufferBuilder& _fbb,
+    flatbuffers::Offset<flatbuffers::Vector<uint64_t>> value = 0) {
+  UInt64SetBuilder builder_(_fbb);
+  builder_.add_value(value);
+  return builder_.Finish();
+}
+
+struct UInt64Set::Traits {
+  using type = UInt64Set;
+  static auto constexpr Create = CreateUInt64Set;
+};
+
+inline flatbuffers::Offset<UInt64Set> CreateUInt64SetDirect(
+    flatbuffers::FlatBufferBuilder& _fbb,
+    const std::vector<uint64_t>* value = nullptr) {
+  auto value__ = value ? _fbb.CreateVector<uint64_t>(*value) : 0;
+  return kv_server::CreateUInt64Set(_fbb, value__);
+}
+
+flatbuffers::Offset<UInt64Set> CreateUInt64Set(
+    flatbuffers::FlatBufferBuilder& _fbb, const UInt64SetT* _o,
+    const flatbuffers::rehasher_function_t* _rehasher = nullptr);
+
 struct KeyValueMutationRecordT : public flatbuffers::NativeTable {
   typedef KeyValueMutationRecord TableType;
   kv_server::KeyValueMutationType mutation_type =
@@ -582,6 +836,16 @@ struct KeyValueMutationRecord FLATBUFFERS_FINAL_CLASS
                ? static_cast<const kv_server::StringSet*>(value())
                : nullptr;
   }
+  const kv_server::UInt32Set* value_as_UInt32Set() const {
+    return value_type() == kv_server::Value::UInt32Set
+               ? static_cast<const kv_server::UInt32Set*>(value())
+               : nullptr;
+  }
+  const kv_server::UInt64Set* value_as_UInt64Set() const {
+    return value_type() == kv_server::Value::UInt64Set
+               ? static_cast<const kv_server::UInt64Set*>(value())
+               : nullptr;
+  }
   bool Verify(flatbuffers::Verifier& verifier) const {
     return VerifyTableStart(verifier) &&
            VerifyField<int8_t>(verifier, VT_MUTATION_TYPE, 1) &&
@@ -613,6 +877,18 @@ KeyValueMutationRecord::value_as<kv_server::StringSet>() const {
   return value_as_StringSet();
 }
 
+template <>
+inline const kv_server::UInt32Set*
+KeyValueMutationRecord::value_as<kv_server::UInt32Set>() const {
+  return value_as_UInt32Set();
+}
+
+template <>
+inline const kv_server::UInt64Set*
+KeyValueMutationRecord::value_as<kv_server::UInt64Set>() const {
+  return value_as_UInt64Set();
+}
+
 struct KeyValueMutationRecordBuilder {
   typedef KeyValueMutationRecord Table;
   flatbuffers::FlatBufferBuilder& fbb_;
@@ -693,6 +969,10 @@ struct UserDefinedFunctionsConfigT : public flatbuffers::NativeTable {
   std::string handler_name{};
   int64_t logical_commit_time = 0;
   int64_t version = 0;
+  kv_server::UserDefinedFunctionsInputFormat input_format =
+      kv_server::UserDefinedFunctionsInputFormat::Json;
+  std::string batch_handler_name{};
+  int32_t canary_percent = 0;
 };
 
 struct UserDefinedFunctionsConfig FLATBUFFERS_FINAL_CLASS
@@ -705,7 +985,10 @@ struct UserDefinedFunctionsConfig FLATBUFFERS_FINAL_CLASS
     VT_CODE_SNIPPET = 6,
     VT_HANDLER_NAME = 8,
     VT_LOGICAL_COMMIT_TIME = 10,
-    VT_VERSION = 12
+    VT_VERSION = 12,
+    VT_INPUT_FORMAT = 14,
+    VT_BATCH_HANDLER_NAME = 16,
+    VT_CANARY_PERCENT = 18
   };
   kv_server::UserDefinedFunctionsLanguage language() const {
     return static_cast<kv_server::UserDefinedFunctionsLanguage>(
@@ -721,6 +1004,16 @@ struct UserDefinedFunctionsConfig FLATBUFFERS_FINAL_CLASS
     return GetField<int64_t>(VT_LOGICAL_COMMIT_TIME, 0);
   }
   int64_t version() const { return GetField<int64_t>(VT_VERSION, 0); }
+  kv_server::UserDefinedFunctionsInputFormat input_format() const {
+    return static_cast<kv_server::UserDefinedFunctionsInputFormat>(
+        GetField<int8_t>(VT_INPUT_FORMAT, 0));
+  }
+  const flatbuffers::String* batch_handler_name() const {
+    return GetPointer<const flatbuffers::String*>(VT_BATCH_HANDLER_NAME);
+  }
+  int32_t canary_percent() const {
+    return GetField<int32_t>(VT_CANARY_PERCENT, 0);
+  }
   bool Verify(flatbuffers::Verifier& verifier) const {
     return VerifyTableStart(verifier) &&
            VerifyField<int8_t>(verifier, VT_LANGUAGE, 1) &&
@@ -729,7 +1022,12 @@ struct UserDefinedFunctionsConfig FLATBUFFERS_FINAL_CLASS
            VerifyOffset(verifier, VT_HANDLER_NAME) &&
            verifier.VerifyString(handler_name()) &&
            VerifyField<int64_t>(verifier, VT_LOGICAL_COMMIT_TIME, 8) &&
-           VerifyField<int64_t>(verifier, VT_VERSION, 8) && verifier.EndTable();
+           VerifyField<int64_t>(verifier, VT_VERSION, 8) &&
+           VerifyField<int8_t>(verifier, VT_INPUT_FORMAT, 1) &&
+           VerifyOffset(verifier, VT_BATCH_HANDLER_NAME) &&
+           verifier.VerifyString(batch_handler_name()) &&
+           VerifyField<int32_t>(verifier, VT_CANARY_PERCENT, 4) &&
+           verifier.EndTable();
   }
   UserDefinedFunctionsConfigT* UnPack(
       const flatbuffers::resolver_function_t* _resolver = nullptr) const;
@@ -764,6 +1062,20 @@ struct UserDefinedFunctionsConfigBuilder {
     fbb_.AddElement<int64_t>(UserDefinedFunctionsConfig::VT_VERSION, version,
                              0);
   }
+  void add_input_format(
+      kv_server::UserDefinedFunctionsInputFormat input_format) {
+    fbb_.AddElement<int8_t>(UserDefinedFunctionsConfig::VT_INPUT_FORMAT,
+                            static_cast<int8_t>(input_format), 0);
+  }
+  void add_batch_handler_name(
+      flatbuffers::Offset<flatbuffers::String> batch_handler_name) {
+    fbb_.AddOffset(UserDefinedFunctionsConfig::VT_BATCH_HANDLER_NAME,
+                   batch_handler_name);
+  }
+  void add_canary_percent(int32_t canary_percent) {
+    fbb_.AddElement<int32_t>(UserDefinedFunctionsConfig::VT_CANARY_PERCENT,
+                             canary_percent, 0);
+  }
   explicit UserDefinedFunctionsConfigBuilder(
       flatbuffers::FlatBufferBuilder& _fbb)
       : fbb_(_fbb) {
@@ -783,12 +1095,19 @@ CreateUserDefinedFunctionsConfig(
         kv_server::UserDefinedFunctionsLanguage::Javascript,
     flatbuffers::Offset<flatbuffers::String> code_snippet = 0,
     flatbuffers::Offset<flatbuffers::String> handler_name = 0,
-    int64_t logical_commit_time = 0, int64_t version = 0) {
+    int64_t logical_commit_time = 0, int64_t version = 0,
+    kv_server::UserDefinedFunctionsInputFormat input_format =
+        kv_server::UserDefinedFunctionsInputFormat::Json,
+    flatbuffers::Offset<flatbuffers::String> batch_handler_name = 0,
+    int32_t canary_percent = 0) {
   UserDefinedFunctionsConfigBuilder builder_(_fbb);
   builder_.add_version(version);
   builder_.add_logical_commit_time(logical_commit_time);
+  builder_.add_canary_percent(canary_percent);
+  builder_.add_batch_handler_name(batch_handler_name);
   builder_.add_handler_name(handler_name);
   builder_.add_code_snippet(code_snippet);
+  builder_.add_input_format(input_format);
   builder_.add_language(language);
   return builder_.Finish();
 }
@@ -804,12 +1123,17 @@ CreateUserDefinedFunctionsConfigDirect(
     kv_server::UserDefinedFunctionsLanguage language =
         kv_server::UserDefinedFunctionsLanguage::Javascript,
     const char* code_snippet = nullptr, const char* handler_name = nullptr,
-    int64_t logical_commit_time = 0, int64_t version = 0) {
+    int64_t logical_commit_time = 0, int64_t version = 0,
+    kv_server::UserDefinedFunctionsInputFormat input_format =
+        kv_server::UserDefinedFunctionsInputFormat::Json,
+    const char* batch_handler_name = nullptr, int32_t canary_percent = 0) {
   auto code_snippet__ = code_snippet ? _fbb.CreateString(code_snippet) : 0;
   auto handler_name__ = handler_name ? _fbb.CreateString(handler_name) : 0;
+  auto batch_handler_name__ =
+      batch_handler_name ? _fbb.CreateString(batch_handler_name) : 0;
   return kv_server::CreateUserDefinedFunctionsConfig(
       _fbb, language, code_snippet__, handler_name__, logical_commit_time,
-      version);
+      version, input_format, batch_handler_name__, canary_percent);
 }
 
 flatbuffers::Offset<UserDefinedFunctionsConfig>
@@ -894,6 +1218,111 @@ flatbuffers::Offset<ShardMappingRecord> CreateShardMappingRecord(
     flatbuffers::FlatBufferBuilder& _fbb, const ShardMappingRecordT* _o,
     const flatbuffers::rehasher_function_t* _rehasher = nullptr);
 
+struct CompressionDictionaryConfigT : public flatbuffers::NativeTable {
+  typedef CompressionDictionaryConfig TableType;
+  std::vector<uint8_t> dictionary{};
+  int64_t logical_commit_time = 0;
+  int64_t version = 0;
+};
+
+struct CompressionDictionaryConfig FLATBUFFERS_FINAL_CLASS
+    : private flatbuffers::Table {
+  typedef CompressionDictionaryConfigT NativeTableType;
+  typedef CompressionDictionaryConfigBuilder Builder;
+  struct Traits;
+  enum FlatBuffersVTableOffset FLATBUFFERS_VTABLE_UNDERLYING_TYPE {
+    VT_DICTIONARY = 4,
+    VT_LOGICAL_COMMIT_TIME = 6,
+    VT_VERSION = 8
+  };
+  const flatbuffers::Vector<uint8_t>* dictionary() const {
+    return GetPointer<const flatbuffers::Vector<uint8_t>*>(VT_DICTIONARY);
+  }
+  int64_t logical_commit_time() const {
+    return GetField<int64_t>(VT_LOGICAL_COMMIT_TIME, 0);
+  }
+  int64_t version() const { return GetField<int64_t>(VT_VERSION, 0); }
+  bool Verify(flatbuffers::Verifier& verifier) const {
+    return VerifyTableStart(verifier) &&
+           VerifyOffset(verifier, VT_DICTIONARY) &&
+           verifier.VerifyVector(dictionary()) &&
+           VerifyField<int64_t>(verifier, VT_LOGICAL_COMMIT_TIME, 8) &&
+           VerifyField<int64_t>(verifier, VT_VERSION, 8) &&
+           verifier.EndTable();
+  }
+  CompressionDictionaryConfigT* UnPack(
+      const flatbuffers::resolver_function_t* _resolver = nullptr) const;
+  void UnPackTo(
+      CompressionDictionaryConfigT* _o,
+      const flatbuffers::resolver_function_t* _resolver = nullptr) const;
+  static flatbuffers::Offset<CompressionDictionaryConfig> Pack(
+      flatbuffers::FlatBufferBuilder& _fbb,
+      const CompressionDictionaryConfigT* _o,
+      const flatbuffers::rehasher_function_t* _rehasher = nullptr);
+};
+
+struct CompressionDictionaryConfigBuilder {
+  typedef CompressionDictionaryConfig Table;
+  flatbuffers::FlatBufferBuilder& fbb_;
+  flatbuffers::uoffset_t start_;
+  void add_dictionary(
+      flatbuffers::Offset<flatbuffers::Vector<uint8_t>> dictionary) {
+    fbb_.AddOffset(CompressionDictionaryConfig::VT_DICTIONARY, dictionary);
+  }
+  void add_logical_commit_time(int64_t logical_commit_time) {
+    fbb_.AddElement<int64_t>(
+        CompressionDictionaryConfig::VT_LOGICAL_COMMIT_TIME,
+        logical_commit_time, 0);
+  }
+  void add_version(int64_t version) {
+    fbb_.AddElement<int64_t>(CompressionDictionaryConfig::VT_VERSION, version,
+                             0);
+  }
+  explicit CompressionDictionaryConfigBuilder(
+      flatbuffers::FlatBufferBuilder& _fbb)
+      : fbb_(_fbb) {
+    start_ = fbb_.StartTable();
+  }
+  flatbuffers::Offset<CompressionDictionaryConfig> Finish() {
+    const auto end = fbb_.EndTable(start_);
+    auto o = flatbuffers::Offset<CompressionDictionaryConfig>(end);
+    return o;
+  }
+};
+
+inline flatbuffers::Offset<CompressionDictionaryConfig>
+CreateCompressionDictionaryConfig(
+    flatbuffers::FlatBufferBuilder& _fbb,
+    flatbuffers::Offset<flatbuffers::Vector<uint8_t>> dictionary = 0,
+    int64_t logical_commit_time = 0, int64_t version = 0) {
+  CompressionDictionaryConfigBuilder builder_(_fbb);
+  builder_.add_version(version);
+  builder_.add_logical_commit_time(logical_commit_time);
+  builder_.add_dictionary(dictionary);
+  return builder_.Finish();
+}
+
+struct CompressionDictionaryConfig::Traits {
+  using type = CompressionDictionaryConfig;
+  static auto constexpr Create = CreateCompressionDictionaryConfig;
+};
+
+inline flatbuffers::Offset<CompressionDictionaryConfig>
+CreateCompressionDictionaryConfigDirect(
+    flatbuffers::FlatBufferBuilder& _fbb,
+    const std::vector<uint8_t>* dictionary = nullptr,
+    int64_t logical_commit_time = 0, int64_t version = 0) {
+  auto dictionary__ = dictionary ? _fbb.CreateVector<uint8_t>(*dictionary) : 0;
+  return kv_server::CreateCompressionDictionaryConfig(
+      _fbb, dictionary__, logical_commit_time, version);
+}
+
+flatbuffers::Offset<CompressionDictionaryConfig>
+CreateCompressionDictionaryConfig(
+    flatbuffers::FlatBufferBuilder& _fbb,
+    const CompressionDictionaryConfigT* _o,
+    const flatbuffers::rehasher_function_t* _rehasher = nullptr);
+
 struct DataRecordT : public flatbuffers::NativeTable {
   typedef DataRecord TableType;
   kv_server::RecordUnion record{};
@@ -931,6 +1360,13 @@ struct DataRecord FLATBUFFERS_FINAL_CLASS : private flatbuffers::Table {
                ? static_cast<const kv_server::ShardMappingRecord*>(record())
                : nullptr;
   }
+  const kv_server::CompressionDictionaryConfig*
+  record_as_CompressionDictionaryConfig() const {
+    return record_type() == kv_server::Record::CompressionDictionaryConfig
+               ? static_cast<const kv_server::CompressionDictionaryConfig*>(
+                     record())
+               : nullptr;
+  }
   bool Verify(flatbuffers::Verifier& verifier) const {
     return VerifyTableStart(verifier) &&
            VerifyField<uint8_t>(verifier, VT_RECORD_TYPE, 1) &&
@@ -966,6 +1402,12 @@ DataRecord::record_as<kv_server::ShardMappingRecord>() const {
   return record_as_ShardMappingRecord();
 }
 
+template <>
+inline const kv_server::CompressionDictionaryConfig*
+DataRecord::record_as<kv_server::CompressionDictionaryConfig>() const {
+  return record_as_CompressionDictionaryConfig();
+}
+
 struct DataRecordBuilder {
   typedef DataRecord Table;
   flatbuffers::FlatBufferBuilder& fbb_;
@@ -1088,6 +1530,92 @@ inline flatbuffers::Offset<StringSet> CreateStringSet(
   return kv_server::CreateStringSet(_fbb, _value);
 }
 
+inline UInt32SetT* UInt32Set::UnPack(
+    const flatbuffers::resolver_function_t* _resolver) const {
+  auto _o = std::make_unique<UInt32SetT>();
+  UnPackTo(_o.get(), _resolver);
+  return _o.release();
+}
+
+inline void UInt32Set::UnPackTo(
+    UInt32SetT* _o, const flatbuffers::resolver_function_t* _resolver) const {
+  (void)_o;
+  (void)_resolver;
+  {
+    auto _e = value();
+    if (_e) {
+      _o->value.resize(_e->size());
+      for (flatbuffers::uoffset_t _i = 0; _i < _e->size(); _i++) {
+        _o->value[_i] = _e->Get(_i);
+      }
+    }
+  }
+}
+
+inline flatbuffers::Offset<UInt32Set> UInt32Set::Pack(
+    flatbuffers::FlatBufferBuilder& _fbb, const UInt32SetT* _o,
+    const flatbuffers::rehasher_function_t* _rehasher) {
+  return CreateUInt32Set(_fbb, _o, _rehasher);
+}
+
+inline flatbuffers::Offset<UInt32Set> CreateUInt32Set(
+    flatbuffers::FlatBufferBuilder& _fbb, const UInt32SetT* _o,
+    const flatbuffers::rehasher_function_t* _rehasher) {
+  (void)_rehasher;
+  (void)_o;
+  struct _VectorArgs {
+    flatbuffers::FlatBufferBuilder* __fbb;
+    const UInt32SetT* __o;
+    const flatbuffers::rehasher_function_t* __rehasher;
+  } _va = {&_fbb, _o, _rehasher};
+  (void)_va;
+  auto _value = _o->value.size() ? _fbb.CreateVector(_o->value) : 0;
+  return kv_server::CreateUInt32Set(_fbb, _value);
+}
+
+inline UInt64SetT* UInt64Set::UnPack(
+    const flatbuffers::resolver_function_t* _resolver) const {
+  auto _o = std::make_unique<UInt64SetT>();
+  UnPackTo(_o.get(), _resolver);
+  return _o.release();
+}
+
+inline void UInt64Set::UnPackTo(
+    UInt64SetT* _o, const flatbuffers::resolver_function_t* _resolver) const {
+  (void)_o;
+  (void)_resolver;
+  {
+    auto _e = value();
+    if (_e) {
+      _o->value.resize(_e->size());
+      for (flatbuffers::uoffset_t _i = 0; _i < _e->size(); _i++) {
+        _o->value[_i] = _e->Get(_i);
+      }
+    }
+  }
+}
+
+inline flatbuffers::Offset<UInt64Set> UInt64Set::Pack(
+    flatbuffers::FlatBufferBuilder& _fbb, const UInt64SetT* _o,
+    const flatbuffers::rehasher_function_t* _rehasher) {
+  return CreateUInt64Set(_fbb, _o, _rehasher);
+}
+
+inline flatbuffers::Offset<UInt64Set> CreateUInt64Set(
+    flatbuffers::FlatBufferBuilder& _fbb, const UInt64SetT* _o,
+    const flatbuffers::rehasher_function_t* _rehasher) {
+  (void)_rehasher;
+  (void)_o;
+  struct _VectorArgs {
+    flatbuffers::FlatBufferBuilder* __fbb;
+    const UInt64SetT* __o;
+    const flatbuffers::rehasher_function_t* __rehasher;
+  } _va = {&_fbb, _o, _rehasher};
+  (void)_va;
+  auto _value = _o->value.size() ? _fbb.CreateVector(_o->value) : 0;
+  return kv_server::CreateUInt64Set(_fbb, _value);
+}
+
 inline KeyValueMutationRecordT* KeyValueMutationRecord::UnPack(
     const flatbuffers::resolver_function_t* _resolver) const {
   auto _o = std::make_unique<KeyValueMutationRecordT>();
@@ -1182,6 +1710,18 @@ inline void UserDefinedFunctionsConfig::UnPackTo(
     auto _e = version();
     _o->version = _e;
   }
+  {
+    auto _e = input_format();
+    _o->input_format = _e;
+  }
+  {
+    auto _e = batch_handler_name();
+    if (_e) _o->batch_handler_name = _e->str();
+  }
+  {
+    auto _e = canary_percent();
+    _o->canary_percent = _e;
+  }
 }
 
 inline flatbuffers::Offset<UserDefinedFunctionsConfig>
@@ -1210,9 +1750,14 @@ CreateUserDefinedFunctionsConfig(
       _o->handler_name.empty() ? 0 : _fbb.CreateString(_o->handler_name);
   auto _logical_commit_time = _o->logical_commit_time;
   auto _version = _o->version;
+  auto _input_format = _o->input_format;
+  auto _batch_handler_name = _o->batch_handler_name.empty()
+                                 ? 0
+                                 : _fbb.CreateString(_o->batch_handler_name);
+  auto _canary_percent = _o->canary_percent;
   return kv_server::CreateUserDefinedFunctionsConfig(
       _fbb, _language, _code_snippet, _handler_name, _logical_commit_time,
-      _version);
+      _version, _input_format, _batch_handler_name, _canary_percent);
 }
 
 inline ShardMappingRecordT* ShardMappingRecord::UnPack(
@@ -1260,6 +1805,64 @@ inline flatbuffers::Offset<ShardMappingRecord> CreateShardMappingRecord(
                                              _physical_shard);
 }
 
+inline CompressionDictionaryConfigT* CompressionDictionaryConfig::UnPack(
+    const flatbuffers::resolver_function_t* _resolver) const {
+  auto _o = std::make_unique<CompressionDictionaryConfigT>();
+  UnPackTo(_o.get(), _resolver);
+  return _o.release();
+}
+
+inline void CompressionDictionaryConfig::UnPackTo(
+    CompressionDictionaryConfigT* _o,
+    const flatbuffers::resolver_function_t* _resolver) const {
+  (void)_o;
+  (void)_resolver;
+  {
+    auto _e = dictionary();
+    if (_e) {
+      _o->dictionary.resize(_e->size());
+      std::copy(_e->begin(), _e->end(), _o->dictionary.begin());
+    }
+  }
+  {
+    auto _e = logical_commit_time();
+    _o->logical_commit_time = _e;
+  }
+  {
+    auto _e = version();
+    _o->version = _e;
+  }
+}
+
+inline flatbuffers::Offset<CompressionDictionaryConfig>
+CompressionDictionaryConfig::Pack(
+    flatbuffers::FlatBufferBuilder& _fbb,
+    const CompressionDictionaryConfigT* _o,
+    const flatbuffers::rehasher_function_t* _rehasher) {
+  return CreateCompressionDictionaryConfig(_fbb, _o, _rehasher);
+}
+
+inline flatbuffers::Offset<CompressionDictionaryConfig>
+CreateCompressionDictionaryConfig(
+    flatbuffers::FlatBufferBuilder& _fbb,
+    const CompressionDictionaryConfigT* _o,
+    const flatbuffers::rehasher_function_t* _rehasher) {
+  (void)_rehasher;
+  (void)_o;
+  struct _VectorArgs {
+    flatbuffers::FlatBufferBuilder* __fbb;
+    const CompressionDictionaryConfigT* __o;
+    const flatbuffers::rehasher_function_t* __rehasher;
+  } _va = {&_fbb, _o, _rehasher};
+  (void)_va;
+  auto _dictionary =
+      _o->dictionary.size() ? _fbb.CreateVector(_o->dictionary) : 0;
+  auto _logical_commit_time = _o->logical_commit_time;
+  auto _version = _o->version;
+  return kv_server::CreateCompressionDictionaryConfig(
+      _fbb, _dictionary, _logical_commit_time, _version);
+}
+
 inline DataRecordT* DataRecord::UnPack(
     const flatbuffers::resolver_function_t* _resolver) const {
   auto _o = std::make_unique<DataRecordT>();
@@ -1319,6 +1922,14 @@ inline bool VerifyValue(flatbuffers::Verifier& verifier, const void* obj,
       auto ptr = reinterpret_cast<const kv_server::StringSet*>(obj);
       return verifier.VerifyTable(ptr);
     }
+    case Value::UInt32Set: {
+      auto ptr = reinterpret_cast<const kv_server::UInt32Set*>(obj);
+      return verifier.VerifyTable(ptr);
+    }
+    case Value::UInt64Set: {
+      auto ptr = reinterpret_cast<const kv_server::UInt64Set*>(obj);
+      return verifier.VerifyTable(ptr);
+    }
     default:
       return true;
   }
@@ -1351,6 +1962,14 @@ inline void* ValueUnion::UnPack(
       auto ptr = reinterpret_cast<const kv_server::StringSet*>(obj);
       return ptr->UnPack(resolver);
     }
+    case Value::UInt32Set: {
+      auto ptr = reinterpret_cast<const kv_server::UInt32Set*>(obj);
+      return ptr->UnPack(resolver);
+    }
+    case Value::UInt64Set: {
+      auto ptr = reinterpret_cast<const kv_server::UInt64Set*>(obj);
+      return ptr->UnPack(resolver);
+    }
     default:
       return nullptr;
   }
@@ -1369,6 +1988,14 @@ inline flatbuffers::Offset<void> ValueUnion::Pack(
       auto ptr = reinterpret_cast<const kv_server::StringSetT*>(value);
       return CreateStringSet(_fbb, ptr, _rehasher).Union();
     }
+    case Value::UInt32Set: {
+      auto ptr = reinterpret_cast<const kv_server::UInt32SetT*>(value);
+      return CreateUInt32Set(_fbb, ptr, _rehasher).Union();
+    }
+    case Value::UInt64Set: {
+      auto ptr = reinterpret_cast<const kv_server::UInt64SetT*>(value);
+      return CreateUInt64Set(_fbb, ptr, _rehasher).Union();
+    }
     default:
       return 0;
   }
@@ -1387,6 +2014,16 @@ inline ValueUnion::ValueUnion(const ValueUnion& u)
           *reinterpret_cast<kv_server::StringSetT*>(u.value));
       break;
     }
+    case Value::UInt32Set: {
+      value = new kv_server::UInt32SetT(
+          *reinterpret_cast<kv_server::UInt32SetT*>(u.value));
+      break;
+    }
+    case Value::UInt64Set: {
+      value = new kv_server::UInt64SetT(
+          *reinterpret_cast<kv_server::UInt64SetT*>(u.value));
+      break;
+    }
     default:
       break;
   }
@@ -1404,6 +2041,16 @@ inline void ValueUnion::Reset() {
       delete ptr;
       break;
     }
+    case Value::UInt32Set: {
+      auto ptr = reinterpret_cast<kv_server::UInt32SetT*>(value);
+      delete ptr;
+      break;
+    }
+    case Value::UInt64Set: {
+      auto ptr = reinterpret_cast<kv_server::UInt64SetT*>(value);
+      delete ptr;
+      break;
+    }
     default:
       break;
   }
@@ -1431,6 +2078,11 @@ inline bool VerifyRecord(flatbuffers::Verifier& verifier, const void* obj,
       auto ptr = reinterpret_cast<const kv_server::ShardMappingRecord*>(obj);
       return verifier.VerifyTable(ptr);
     }
+    case Record::CompressionDictionaryConfig: {
+      auto ptr =
+          reinterpret_cast<const kv_server::CompressionDictionaryConfig*>(obj);
+      return verifier.VerifyTable(ptr);
+    }
     default:
       return true;
   }
@@ -1469,6 +2121,11 @@ inline void* RecordUnion::UnPack(
       auto ptr = reinterpret_cast<const kv_server::ShardMappingRecord*>(obj);
       return ptr->UnPack(resolver);
     }
+    case Record::CompressionDictionaryConfig: {
+      auto ptr =
+          reinterpret_cast<const kv_server::CompressionDictionaryConfig*>(obj);
+      return ptr->UnPack(resolver);
+    }
     default:
       return nullptr;
   }
@@ -1494,6 +2151,12 @@ inline flatbuffers::Offset<void> RecordUnion::Pack(
       auto ptr = reinterpret_cast<const kv_server::ShardMappingRecordT*>(value);
       return CreateShardMappingRecord(_fbb, ptr, _rehasher).Union();
     }
+    case Record::CompressionDictionaryConfig: {
+      auto ptr =
+          reinterpret_cast<const kv_server::CompressionDictionaryConfigT*>(
+              value);
+      return CreateCompressionDictionaryConfig(_fbb, ptr, _rehasher).Union();
+    }
     default:
       return 0;
   }
@@ -1517,6 +2180,11 @@ inline RecordUnion::RecordUnion(const RecordUnion& u)
           *reinterpret_cast<kv_server::ShardMappingRecordT*>(u.value));
       break;
     }
+    case Record::CompressionDictionaryConfig: {
+      value = new kv_server::CompressionDictionaryConfigT(
+          *reinterpret_cast<kv_server::CompressionDictionaryConfigT*>(u.value));
+      break;
+    }
     default:
       break;
   }
@@ -1540,6 +2208,12 @@ inline void RecordUnion::Reset() {
       delete ptr;
       break;
     }
+    case Record::CompressionDictionaryConfig: {
+      auto ptr =
+          reinterpret_cast<kv_server::CompressionDictionaryConfigT*>(value);
+      delete ptr;
+      break;
+    }
     default:
       break;
   }
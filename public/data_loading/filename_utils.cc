@@ -66,6 +66,24 @@ absl::StatusOr<std::string> ToSnapshotFileName(uint64_t logical_commit_time) {
   return result;
 }
 
+bool IsCompactedDeltaFilename(std::string_view basename) {
+  return std::regex_match(basename.begin(), basename.end(),
+                          CompactedDeltaFileFormatRegex());
+}
+
+absl::StatusOr<std::string> ToCompactedDeltaFileName(
+    uint64_t logical_commit_time) {
+  const std::string result =
+      GetFilename<FileType::COMPACTED_DELTA>(logical_commit_time);
+  if (!IsCompactedDeltaFilename(result)) {
+    return absl::InvalidArgumentError(absl::StrCat(
+        "Unable to build a valid compacted delta file name with logical "
+        "commit time: ",
+        logical_commit_time, " which makes a file name: ", result));
+  }
+  return result;
+}
+
 bool IsLogicalShardingConfigFilename(std::string_view basename) {
   return std::regex_match(basename.begin(), basename.end(),
                           LogicalShardingConfigFileFormatRegex());
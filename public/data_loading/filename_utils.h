@@ -42,6 +42,19 @@ bool IsSnapshotFilename(std::string_view basename);
 // construct a valid snapshot filename.
 absl::StatusOr<std::string> ToSnapshotFileName(uint64_t logical_commit_time);
 
+// Returns true if `basename` is a valid compacted delta filename.
+// Valid compacted delta filenames conform to the regex return by
+// `CompactedDeltaFileFormatRegex()` in constants.h
+bool IsCompactedDeltaFilename(std::string_view basename);
+
+// Attempts to construct a valid compacted delta filename from the
+// `logical_commit_time` of the most recent delta file it merges.
+//
+// Returns absl::InvalidArgumentError if `logical_commit_time` cannot be used to
+// construct a valid compacted delta filename.
+absl::StatusOr<std::string> ToCompactedDeltaFileName(
+    uint64_t logical_commit_time);
+
 // Returns true if `basename` is a valid logical sharding config filename.
 //
 // Valid logical sharding config filenames conform to the regex return by
@@ -95,6 +95,22 @@ TEST(SnapshotFilename, ToLogicalShardingConfigFilename) {
             ("LOGICAL_SHARDING_CONFIG_1234512345123451"));
 }
 
+TEST(CompactedDeltaFilename, IsCompactedDeltaFilename) {
+  EXPECT_FALSE(IsCompactedDeltaFilename(""));
+  EXPECT_FALSE(IsCompactedDeltaFilename("COMPACTED_DELTA_"));
+  EXPECT_FALSE(IsCompactedDeltaFilename("DELTA_1234512345123451"));
+  EXPECT_FALSE(IsCompactedDeltaFilename("COMPACTED_DELTA_12345123451234510"));
+  EXPECT_TRUE(IsCompactedDeltaFilename("COMPACTED_DELTA_1234512345123451"));
+  EXPECT_FALSE(IsDeltaFilename("COMPACTED_DELTA_1234512345123451"));
+}
+
+TEST(CompactedDeltaFilename, ToCompactedDeltaFilename) {
+  EXPECT_EQ(ToCompactedDeltaFileName(-1).status().code(),
+            absl::StatusCode::kInvalidArgument);
+  EXPECT_EQ(ToCompactedDeltaFileName(1234512345123451).value(),
+            "COMPACTED_DELTA_1234512345123451");
+}
+
 TEST(FileGroupFilename, IsFileGroupFileName) {
   EXPECT_FALSE(IsFileGroupFileName(""));
   EXPECT_FALSE(IsFileGroupFileName("DELTA"));
@@ -68,19 +68,27 @@ absl::StatusOr<int64_t> AvroConcurrentStreamRecordReader::RecordStreamSize() {
 
 absl::StatusOr<std::vector<AvroConcurrentStreamRecordReader::ByteRange>>
 AvroConcurrentStreamRecordReader::BuildByteRanges() {
+  if (options_.num_worker_threads < 1) {
+    return absl::InvalidArgumentError(
+        absl::StrFormat("Num worker threads %d must be at least 1.",
+                        options_.num_worker_threads));
+  }
   absl::StatusOr<int64_t> stream_size = RecordStreamSize();
   if (!stream_size.ok()) {
     return stream_size.status();
   }
+  const int64_t num_byte_ranges =
+      options_.num_worker_threads *
+      std::max<int64_t>(options_.shards_per_worker, 1);
   // The chunk size must be at least `options_.min_chunk_size_bytes` and
   // at most `*stream_size`.
   int64_t byte_range_size = std::min(
-      *stream_size, std::max(int64_t(std::ceil((double)*stream_size /
-                                               options_.num_worker_threads)),
-                             options_.min_byte_range_size_bytes));
+      *stream_size,
+      std::max(int64_t(std::ceil((double)*stream_size / num_byte_ranges)),
+               options_.min_byte_range_size_bytes));
   int64_t byte_range_begin_offset = 0;
   std::vector<ByteRange> byte_ranges;
-  byte_ranges.reserve(options_.num_worker_threads);
+  byte_ranges.reserve(num_byte_ranges);
   while (byte_range_begin_offset < *stream_size) {
     int64_t end_offset = byte_range_begin_offset + byte_range_size;
     end_offset = std::min(end_offset, *stream_size);
@@ -88,7 +96,9 @@ AvroConcurrentStreamRecordReader::BuildByteRanges() {
         .begin_offset = byte_range_begin_offset,
         .end_offset = end_offset,
     });
-    byte_range_begin_offset = end_offset + 1;
+    // Ranges are contiguous, so that a sync marker starting at `end_offset`
+    // is found by the next range.
+    byte_range_begin_offset = end_offset;
   }
   if (byte_ranges.empty() || byte_ranges.back().end_offset != *stream_size) {
     return absl::InternalError("Failed to generate byte_ranges.");
@@ -100,6 +110,21 @@ AvroConcurrentStreamRecordReader::BuildByteRanges() {
 // stream are read.
 absl::Status AvroConcurrentStreamRecordReader::ReadStreamRecords(
     const std::function<absl::Status(const std::string_view&)>& callback) {
+  return ReadByteRanges(
+      [&callback](absl::Span<const std::string_view> records) {
+        return callback(records.front());
+      },
+      /*batch_size=*/1);
+}
+
+absl::Status AvroConcurrentStreamRecordReader::ReadStreamRecordBatches(
+    const std::function<absl::Status(absl::Span<const std::string_view>)>&
+        callback) {
+  return ReadByteRanges(callback, std::max<int64_t>(options_.batch_size, 1));
+}
+
+absl::Status AvroConcurrentStreamRecordReader::ReadByteRanges(
+    const BatchCallback& batch_callback, int64_t batch_size) {
   ScopeLatencyMetricsRecorder<
       ServerSafeMetricsContext,
       kConcurrentStreamRecordReaderReadStreamRecordsLatency>
@@ -108,27 +133,51 @@ absl::Status AvroConcurrentStreamRecordReader::ReadStreamRecords(
   if (!byte_ranges.ok() || byte_ranges->empty()) {
     return byte_ranges.status();
   }
-  std::vector<std::future<absl::StatusOr<ByteRangeResult>>>
-      byte_range_reader_tasks;
-  for (const auto& byte_range : *byte_ranges) {
+  const int64_t num_byte_ranges = byte_ranges->size();
+  // Set for the byte ranges read, which are the first ones when one failed.
+  std::vector<std::optional<absl::StatusOr<ByteRangeResult>>>
+      byte_range_results(num_byte_ranges);
+  {
+    std::atomic<int64_t> next_byte_range_index = 0;
+    std::atomic<bool> failed = false;
+    const auto read_byte_ranges = [this, &byte_ranges, &byte_range_results,
+                                   &batch_callback, batch_size,
+                                   num_byte_ranges, &next_byte_range_index,
+                                   &failed]() {
+      for (int64_t i = next_byte_range_index++; i < num_byte_ranges && !failed;
+           i = next_byte_range_index++) {
+        if (!byte_range_results[i]
+                 .emplace(ReadByteRangeExceptionless(
+                     (*byte_ranges)[i], batch_callback, batch_size))
+                 .ok()) {
+          failed = true;
+        }
+      }
+    };
     // TODO: b/268339067 - Investigate using an executor because
     // std::async is generally not preferred, but works fine as an
     // initial implementation.
-    byte_range_reader_tasks.push_back(std::async(
-        std::launch::async,
-        &AvroConcurrentStreamRecordReader::ReadByteRangeExceptionless, this,
-        std::ref(byte_range), std::ref(callback)));
+    std::vector<std::future<void>> workers;
+    for (int64_t i = 0;
+         i < std::min(options_.num_worker_threads, num_byte_ranges); i++) {
+      workers.push_back(std::async(std::launch::async, read_byte_ranges));
+    }
+    for (auto& worker : workers) {
+      worker.get();
+    }
   }
   int64_t total_records_read = 0;
-  for (auto& task : byte_range_reader_tasks) {
-    absl::StatusOr<ByteRangeResult> curr_byte_range_result = task.get();
+  for (const auto& byte_range_result : byte_range_results) {
     // TODO: The stuff below should be handled more gracefully,
     // e.g., only retry the byte_range that failed or skipped some
     // records.
-    if (!curr_byte_range_result.ok()) {
-      return curr_byte_range_result.status();
+    if (!byte_range_result.has_value()) {
+      continue;
+    }
+    if (!byte_range_result->ok()) {
+      return byte_range_result->status();
     }
-    total_records_read += curr_byte_range_result->num_records_read;
+    total_records_read += (*byte_range_result)->num_records_read;
   }
   VLOG(2) << "Done reading " << total_records_read << " records in "
           << absl::ToDoubleMilliseconds(latency_recorder.GetLatency())
@@ -138,11 +187,10 @@ absl::Status AvroConcurrentStreamRecordReader::ReadStreamRecords(
 
 absl::StatusOr<typename AvroConcurrentStreamRecordReader::ByteRangeResult>
 AvroConcurrentStreamRecordReader::ReadByteRangeExceptionless(
-    const ByteRange& byte_range,
-    const std::function<absl::Status(const std::string_view&)>&
-        record_callback) noexcept {
+    const ByteRange& byte_range, const BatchCallback& batch_callback,
+    int64_t batch_size) noexcept {
   try {
-    return ReadByteRange(byte_range, record_callback);
+    return ReadByteRange(byte_range, batch_callback, batch_size);
   } catch (const std::exception& e) {
     return absl::InternalError(e.what());
   }
@@ -150,12 +198,11 @@ AvroConcurrentStreamRecordReader::ReadByteRangeExceptionless(
 
 absl::StatusOr<typename AvroConcurrentStreamRecordReader::ByteRangeResult>
 AvroConcurrentStreamRecordReader::ReadByteRange(
-    const ByteRange& byte_range,
-    const std::function<absl::Status(const std::string_view&)>&
-        record_callback) {
+    const ByteRange& byte_range, const BatchCallback& batch_callback,
+    int64_t batch_size) {
   VLOG(2) << "Reading byte_range: "
           << "[" << byte_range.begin_offset << "," << byte_range.end_offset
-          << "]";
+          << ")";
   ScopeLatencyMetricsRecorder<ServerSafeMetricsContext,
                               kConcurrentStreamRecordReaderReadByteRangeLatency>
       latency_recorder(KVServerContextMap()->SafeMetric());
@@ -173,13 +220,25 @@ AvroConcurrentStreamRecordReader::ReadByteRange(
   record_stream->Stream().clear();
   record_reader->sync(byte_range.begin_offset);
   int64_t num_records_read = 0;
-  std::string record;
+  std::vector<std::string> records(batch_size);
+  std::vector<std::string_view> batch;
+  batch.reserve(batch_size);
   absl::Status overall_status;
+  const auto flush_batch = [&batch, &batch_callback, &overall_status]() {
+    if (!batch.empty()) {
+      overall_status.Update(batch_callback(batch));
+      batch.clear();
+    }
+  };
   while (!record_reader->pastSync(byte_range.end_offset) &&
-         record_reader->read(record)) {
-    overall_status.Update(record_callback(record));
+         record_reader->read(records[batch.size()])) {
+    batch.push_back(records[batch.size()]);
     num_records_read++;
+    if (static_cast<int64_t>(batch.size()) == batch_size) {
+      flush_batch();
+    }
   }
+  flush_batch();
   // TODO: b/269119466 - Figure out how to handle this better. Maybe add
   // metrics to track callback failures (??).
   if (!overall_status.ok()) {
@@ -188,7 +247,7 @@ AvroConcurrentStreamRecordReader::ReadByteRange(
     return overall_status;
   }
   VLOG(2) << "Done reading " << num_records_read << " records in byte_range: ["
-          << byte_range.begin_offset << "," << byte_range.end_offset << "] in "
+          << byte_range.begin_offset << "," << byte_range.end_offset << ") in "
           << absl::ToDoubleMilliseconds(latency_recorder.GetLatency())
           << " ms.";
   ByteRangeResult result;
@@ -18,10 +18,13 @@
 #define PUBLIC_DATA_LOADING_READERS_AVRO_STREAM_IO_H_
 
 #include <algorithm>
+#include <atomic>
 #include <cmath>
 #include <future>
 #include <memory>
+#include <optional>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -31,6 +34,7 @@
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/str_format.h"
+#include "absl/types/span.h"
 #include "components/telemetry/server_definition.h"
 #include "public/data_loading/readers/stream_record_reader.h"
 #include "public/data_loading/riegeli_metadata.pb.h"
@@ -62,9 +66,12 @@ class AvroStreamReader : public StreamRecordReader {
 // An `AvroConcurrentStreamRecordReader` reads a Avro data stream containing
 // string records concurrently. The reader splits the data stream
 // into byte ranges with an approximately equal number of bytes and reads the
-// chunks in parallel. Each record in the underlying data stream is guaranteed
-// to be read exactly once. The concurrency level can be configured using
-// `AvroConcurrentStreamRecordReader::Options`.
+// chunks in parallel, with worker threads taking the next unread byte range as
+// they finish one. A byte range holds the Avro blocks whose sync marker starts
+// in it, so each record in the underlying data stream is guaranteed to be read
+// exactly once. The concurrency level can be configured using
+// `AvroConcurrentStreamRecordReader::Options`. `ReadStreamRecordBatches`
+// passes the records of each byte range in batches of `Options::batch_size`.
 //
 // Sample usage:
 //
@@ -93,6 +100,13 @@ class AvroConcurrentStreamRecordReader : public StreamRecordReader {
   struct Options {
     int64_t num_worker_threads = std::thread::hardware_concurrency();
     int64_t min_byte_range_size_bytes = 8 * 1024 * 1024;  // 8MB
+    // Maximum number of records per batch of `ReadStreamRecordBatches`.
+    int64_t batch_size = 1024;
+    // Number of byte ranges the stream is split into per worker thread, byte
+    // ranges are still at least `min_byte_range_size_bytes`. With more than
+    // one, workers that finish their byte ranges early read the remaining
+    // ones instead of waiting for a slow one.
+    int64_t shards_per_worker = 1;
     Options() {}
   };
   AvroConcurrentStreamRecordReader(
@@ -109,10 +123,14 @@ class AvroConcurrentStreamRecordReader : public StreamRecordReader {
   absl::Status ReadStreamRecords(
       const std::function<absl::Status(const std::string_view&)>& callback)
       override;
+  absl::Status ReadStreamRecordBatches(
+      const std::function<absl::Status(absl::Span<const std::string_view>)>&
+          callback) override;
 
  private:
   // Defines a byte range in the underlying record stream that will be read
-  // concurrently with other byte ranges.
+  // concurrently with other byte ranges. Blocks whose sync marker starts in
+  // `[begin_offset, end_offset)` are read.
   struct ByteRange {
     int64_t begin_offset;
     int64_t end_offset;
@@ -124,14 +142,18 @@ class AvroConcurrentStreamRecordReader : public StreamRecordReader {
     int64_t num_records_read;
   };
 
+  using BatchCallback =
+      std::function<absl::Status(absl::Span<const std::string_view>)>;
+  // Reads all byte ranges concurrently, passing batches of at most
+  // `batch_size` records to `batch_callback`.
+  absl::Status ReadByteRanges(const BatchCallback& batch_callback,
+                              int64_t batch_size);
   absl::StatusOr<ByteRangeResult> ReadByteRange(
-      const ByteRange& shard,
-      const std::function<absl::Status(const std::string_view&)>&
-          record_callback);
+      const ByteRange& byte_range, const BatchCallback& batch_callback,
+      int64_t batch_size);
   absl::StatusOr<ByteRangeResult> ReadByteRangeExceptionless(
-      const ByteRange& shard,
-      const std::function<absl::Status(const std::string_view&)>&
-          record_callback) noexcept;
+      const ByteRange& byte_range, const BatchCallback& batch_callback,
+      int64_t batch_size) noexcept;
   absl::StatusOr<std::vector<ByteRange>> BuildByteRanges();
   absl::StatusOr<int64_t> RecordStreamSize();
   std::function<std::unique_ptr<RecordStream>()> stream_factory_;
@@ -16,7 +16,11 @@
 
 #include <filesystem>
 #include <fstream>
+#include <string>
+#include <vector>
 
+#include "absl/strings/str_cat.h"
+#include "absl/synchronization/mutex.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "third_party/avro/api/DataFile.hh"
@@ -48,6 +52,23 @@ void WriteAvroToFile(const std::vector<std::string_view>& records,
   record_writer.close();
 }
 
+// Writes `num_records` distinct records, "record<i>", to `path`.
+std::vector<std::string> WriteDistinctAvroRecordsToFile(
+    int64_t num_records, const std::filesystem::path& path) {
+  std::ofstream dest_stream(path);
+  avro::OutputStreamPtr avro_output_stream =
+      avro::ostreamOutputStream(dest_stream);
+  avro::DataFileWriter<std::string> record_writer(
+      std::move(avro_output_stream), avro::ValidSchema(avro::BytesSchema()));
+  std::vector<std::string> records;
+  for (int64_t i = 0; i < num_records; i++) {
+    records.push_back(absl::StrCat("record", i));
+    record_writer.write(records.back());
+  }
+  record_writer.close();
+  return records;
+}
+
 // This test can be used to debug Avro related operations.
 // TEST(AvroStreamIO, Avro) {
 //   const std::filesystem::path path =
@@ -165,5 +186,81 @@ TEST(AvroStreamIO, SequentialReadingInvalidFile) {
   EXPECT_FALSE(status.ok());
 }
 
+TEST(AvroStreamIO, ConcurrentReadingManyByteRangesReadsRecordsOnce) {
+  kv_server::InitMetricsContextMap();
+  const std::filesystem::path path =
+      std::filesystem::path(::testing::TempDir()) / "ManyByteRanges.avro";
+  const std::vector<std::string> expected =
+      WriteDistinctAvroRecordsToFile(100'000, path);
+
+  AvroConcurrentStreamRecordReader::Options options;
+  options.num_worker_threads = 4;
+  options.min_byte_range_size_bytes = 1024;
+  options.shards_per_worker = 16;
+  AvroConcurrentStreamRecordReader record_reader(
+      [&path] { return std::make_unique<iStreamRecordStream>(path); }, options);
+  absl::Mutex mutex;
+  std::vector<std::string> records;
+  auto status = record_reader.ReadStreamRecords(
+      [&mutex, &records](const std::string_view& record) {
+        absl::MutexLock lock(&mutex);
+        records.emplace_back(record);
+        return absl::OkStatus();
+      });
+  EXPECT_TRUE(status.ok()) << status;
+  EXPECT_THAT(records, testing::UnorderedElementsAreArray(expected));
+}
+
+TEST(AvroStreamIO, ConcurrentReadingRecordBatches) {
+  kv_server::InitMetricsContextMap();
+  const std::filesystem::path path =
+      std::filesystem::path(::testing::TempDir()) / "RecordBatches.avro";
+  const std::vector<std::string> expected =
+      WriteDistinctAvroRecordsToFile(10'000, path);
+
+  AvroConcurrentStreamRecordReader::Options options;
+  options.num_worker_threads = 2;
+  options.min_byte_range_size_bytes = 4096;
+  options.batch_size = 100;
+  AvroConcurrentStreamRecordReader record_reader(
+      [&path] { return std::make_unique<iStreamRecordStream>(path); }, options);
+  absl::Mutex mutex;
+  std::vector<std::string> records;
+  auto status = record_reader.ReadStreamRecordBatches(
+      [&mutex, &records](absl::Span<const std::string_view> batch) {
+        EXPECT_LE(batch.size(), 100);
+        absl::MutexLock lock(&mutex);
+        records.insert(records.end(), batch.begin(), batch.end());
+        return absl::OkStatus();
+      });
+  EXPECT_TRUE(status.ok()) << status;
+  EXPECT_THAT(records, testing::UnorderedElementsAreArray(expected));
+}
+
+TEST(AvroStreamIO, ConcurrentReadingSmallFileWithManyWorkers) {
+  kv_server::InitMetricsContextMap();
+  const std::filesystem::path path =
+      std::filesystem::path(::testing::TempDir()) / "SmallFile.avro";
+  const std::vector<std::string> expected =
+      WriteDistinctAvroRecordsToFile(10, path);
+
+  AvroConcurrentStreamRecordReader::Options options;
+  options.num_worker_threads = 8;
+  options.min_byte_range_size_bytes = 1;
+  options.shards_per_worker = 4;
+  AvroConcurrentStreamRecordReader record_reader(
+      [&path] { return std::make_unique<iStreamRecordStream>(path); }, options);
+  absl::Mutex mutex;
+  std::vector<std::string> records;
+  auto status = record_reader.ReadStreamRecords(
+      [&mutex, &records](const std::string_view& record) {
+        absl::MutexLock lock(&mutex);
+        records.emplace_back(record);
+        return absl::OkStatus();
+      });
+  EXPECT_TRUE(status.ok()) << status;
+  EXPECT_THAT(records, testing::UnorderedElementsAreArray(expected));
+}
+
 }  // namespace
 }  // namespace kv_server
@@ -18,10 +18,14 @@
 #define PUBLIC_DATA_LOADING_READERS_RIEGELI_STREAM_IO_H_
 
 #include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <deque>
 #include <future>
 #include <memory>
+#include <optional>
 #include <string>
+#include <string_view>
 #include <utility>
 #include <vector>
 
@@ -31,11 +35,19 @@
 #include "absl/log/log.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
 #include "absl/strings/str_format.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
 #include "components/telemetry/server_definition.h"
 #include "public/data_loading/readers/stream_record_reader.h"
 #include "public/data_loading/riegeli_metadata.pb.h"
+#include "public/sharding/logical_shard_mapping.h"
 #include "riegeli/bytes/istream_reader.h"
+#include "riegeli/bytes/reader.h"
+#include "riegeli/bytes/string_reader.h"
 #include "riegeli/records/record_reader.h"
 #include "src/telemetry/telemetry_provider.h"
 
@@ -49,10 +61,17 @@ class RiegeliStreamReader : public StreamRecordReader {
   explicit RiegeliStreamReader(
       std::istream& data_input,
       std::function<bool(const riegeli::SkippedRegion&)> recover)
-      : reader_(riegeli::RecordReader(
-            riegeli::IStreamReader(&data_input),
-            riegeli::RecordReaderBase::Options().set_recovery(
-                std::move(recover)))) {}
+      : reader_(std::make_unique<riegeli::IStreamReader<>>(&data_input),
+                riegeli::RecordReaderBase::Options().set_recovery(
+                    std::move(recover))) {}
+
+  // Reads `data` in place. `data` must outlive the reader.
+  explicit RiegeliStreamReader(
+      std::string_view data,
+      std::function<bool(const riegeli::SkippedRegion&)> recover)
+      : reader_(std::make_unique<riegeli::StringReader<>>(data),
+                riegeli::RecordReaderBase::Options().set_recovery(
+                    std::move(recover))) {}
 
   absl::StatusOr<KVFileMetadata> GetKVFileMetadata() override {
     riegeli::RecordsMetadata metadata;
@@ -90,22 +109,151 @@ class RiegeliStreamReader : public StreamRecordReader {
   absl::Status Status() const { return reader_.status(); }
 
  private:
-  riegeli::RecordReader<riegeli::IStreamReader<>> reader_;
+  riegeli::RecordReader<std::unique_ptr<riegeli::Reader>> reader_;
 };
 
 const int64_t kDefaultNumWorkerThreads = std::thread::hardware_concurrency();
 constexpr int64_t kDefaultMinShardSize = 8 * 1024 * 1024;  // 8MB
+constexpr int64_t kDefaultRecordBatchSize = 1024;
 constexpr std::string_view kReadShardRecordsLatencyEvent =
     "ConcurrentStreamRecordReader::ReadShardRecords";
 constexpr std::string_view kReadStreamRecordsLatencyEvent =
     "ConcurrentStreamRecordReader::ReadStreamRecords";
 
+// Returns a Riegeli reader of `record_stream`, which reads its `Contents()`
+// in place when they are in memory.
+inline std::unique_ptr<riegeli::Reader> NewRiegeliReader(
+    RecordStream& record_stream) {
+  if (auto contents = record_stream.Contents(); contents.has_value()) {
+    return std::make_unique<riegeli::StringReader<>>(*contents);
+  }
+  return std::make_unique<riegeli::IStreamReader<>>(&record_stream.Stream());
+}
+
+// Returns the size of `record_stream`, which must support seeking.
+inline absl::StatusOr<int64_t> GetRecordStreamSize(
+    RecordStream& record_stream) {
+  if (auto contents = record_stream.Contents(); contents.has_value()) {
+    return contents->size();
+  }
+  auto& stream = record_stream.Stream();
+  stream.seekg(0, std::ios_base::end);
+  int64_t size = stream.tellg();
+  if (size == -1) {
+    return absl::InvalidArgumentError("Input streams do not support seeking.");
+  }
+  return size;
+}
+
+// Reads the last record of `record_stream` of `stream_size` bytes into
+// `record`, e.g. the `ShardRecordRanges` of streams with shard record ranges.
+inline absl::Status ReadLastRecord(RecordStream& record_stream,
+                                   int64_t stream_size,
+                                   google::protobuf::MessageLite& record) {
+  riegeli::RecordReader<std::unique_ptr<riegeli::Reader>> record_reader(
+      NewRiegeliReader(record_stream));
+  if (!record_reader.Seek(stream_size) || !record_reader.SeekBack() ||
+      !record_reader.ReadRecord(record)) {
+    if (record_reader.ok()) {
+      return absl::DataLossError(
+          absl::StrCat(record.GetTypeName(), " not found."));
+    }
+    return record_reader.status();
+  }
+  return absl::OkStatus();
+}
+
+// Bounded pool of record batches that shard readers fill and apply threads
+// pass to the batch callback, so that reading and decompressing a stream
+// overlaps with applying its records. Readers wait for a free batch while the
+// apply threads are behind, which bounds the memory held by the batches.
+class RecordBatchQueue {
+ public:
+  struct Batch {
+    // Only the first `size` records belong to the batch. The strings keep
+    // their capacity when the batch is reused.
+    std::vector<std::string> records;
+    int64_t size = 0;
+  };
+
+  RecordBatchQueue(int64_t num_batches, int64_t batch_size)
+      : batches_(num_batches) {
+    for (Batch& batch : batches_) {
+      batch.records.resize(batch_size);
+      free_.push_back(&batch);
+    }
+  }
+
+  // Waits for a free, empty batch.
+  Batch* AcquireFree() ABSL_LOCKS_EXCLUDED(mutex_) {
+    absl::MutexLock lock(&mutex_);
+    mutex_.Await(absl::Condition(
+        +[](RecordBatchQueue* queue) ABSL_EXCLUSIVE_LOCKS_REQUIRED(
+             queue->mutex_) { return !queue->free_.empty(); },
+        this));
+    Batch* batch = free_.front();
+    free_.pop_front();
+    batch->size = 0;
+    return batch;
+  }
+
+  // Queues `batch` to be applied.
+  void PushFull(Batch* batch) ABSL_LOCKS_EXCLUDED(mutex_) {
+    absl::MutexLock lock(&mutex_);
+    full_.push_back(batch);
+  }
+
+  // Waits for a batch to apply. Returns null once closed and drained.
+  Batch* PopFull() ABSL_LOCKS_EXCLUDED(mutex_) {
+    absl::MutexLock lock(&mutex_);
+    mutex_.Await(absl::Condition(
+        +[](RecordBatchQueue* queue) ABSL_EXCLUSIVE_LOCKS_REQUIRED(
+             queue->mutex_) { return queue->closed_ || !queue->full_.empty(); },
+        this));
+    if (full_.empty()) {
+      return nullptr;
+    }
+    Batch* batch = full_.front();
+    full_.pop_front();
+    return batch;
+  }
+
+  // Returns `batch` to the free batches.
+  void Release(Batch* batch) ABSL_LOCKS_EXCLUDED(mutex_) {
+    absl::MutexLock lock(&mutex_);
+    free_.push_back(batch);
+  }
+
+  // Called once no more batches are pushed.
+  void Close() ABSL_LOCKS_EXCLUDED(mutex_) {
+    absl::MutexLock lock(&mutex_);
+    closed_ = true;
+  }
+
+ private:
+  std::vector<Batch> batches_;
+  absl::Mutex mutex_;
+  std::deque<Batch*> free_ ABSL_GUARDED_BY(mutex_);
+  std::deque<Batch*> full_ ABSL_GUARDED_BY(mutex_);
+  bool closed_ ABSL_GUARDED_BY(mutex_) = false;
+};
+
 // A `ConcurrentStreamRecordReader` reads a Riegeli data stream containing
 // `RecordT` records concurrently. The reader splits the data stream
 // into shards with an approximately equal number of records and reads the
-// shards in parallel. Each record in the underlying data stream is guaranteed
+// shards in parallel, with worker threads taking the next unread shard as
+// they finish one. Each record in the underlying data stream is guaranteed
 // to be read exactly once. The concurrency level can be configured using
-// `ConcurrentStreamRecordReader<RecordT>::Options`.
+// `ConcurrentStreamRecordReader<RecordT>::Options`. `ReadStreamRecordBatches`
+// passes the records of each shard in batches of `Options::batch_size`.
+// Streams whose `ShardingMetadata` has `has_shard_record_ranges` are only read
+// in the record ranges of `Options::shard_num`, or of its logical shards, so
+// records of other data shards are never decoded. The `SnapshotKeyIndex` of
+// snapshots with `has_key_index` is not read as a record. With
+// `Options::num_apply_threads`, `ReadStreamRecordBatches` reads and
+// decompresses the stream on the worker threads and passes the batches to the
+// callback on separate apply threads, so that each stage can be given the
+// threads it needs.
 //
 // Sample usage:
 //
@@ -127,7 +275,8 @@ constexpr std::string_view kReadStreamRecordsLatencyEvent =
 // Note that the input `stream_factory` is required to produce streams that
 // support seeking, can be read independently and point to the same
 // underlying underlying Riegeli data stream, e.g., multiple `std::ifstream`
-// streams pointing to the same underlying file.
+// streams pointing to the same underlying file. Streams whose `Contents()`
+// are in memory are read in place instead.
 template <typename RecordT>
 class ConcurrentStreamRecordReader : public StreamRecordReader {
  public:
@@ -139,6 +288,26 @@ class ConcurrentStreamRecordReader : public StreamRecordReader {
           LOG(WARNING) << "Skipping over corrupted region: " << region;
           return true;
         };
+    // Maximum number of records per batch of `ReadStreamRecordBatches`.
+    int64_t batch_size = kDefaultRecordBatchSize;
+    // Data shard whose records are read from streams with shard record
+    // ranges. Records of all shards are read if negative.
+    int64_t shard_num = -1;
+    // If set, `shard_num` is a physical shard and the ranges of streams
+    // sharded into the same logical shards are read if their logical shard is
+    // mapped to it, see `MayHoldRecordsOfShard`.
+    std::shared_ptr<const LogicalShardMapping> logical_shard_mapping;
+    // Number of shards the stream is split into per worker thread, shards
+    // are still at least `min_shard_size_bytes`. With more than one, workers
+    // that finish their shards early read the remaining shards instead of
+    // waiting for a slow shard, e.g. one with dense chunks or slow storage
+    // reads.
+    int64_t shards_per_worker = 1;
+    // If positive, `ReadStreamRecordBatches` passes the batches read by the
+    // worker threads to the callback on this many other threads, through a
+    // bounded queue of batches, instead of on the worker threads. Worker
+    // threads then keep reading while the callback processes earlier batches.
+    int64_t num_apply_threads = 0;
   };
   ConcurrentStreamRecordReader(
       std::function<std::unique_ptr<RecordStream>()> stream_factory,
@@ -150,6 +319,9 @@ class ConcurrentStreamRecordReader : public StreamRecordReader {
   absl::StatusOr<KVFileMetadata> GetKVFileMetadata() override;
   absl::Status ReadStreamRecords(
       const std::function<absl::Status(const RecordT&)>& callback) override;
+  absl::Status ReadStreamRecordBatches(
+      const std::function<absl::Status(absl::Span<const std::string_view>)>&
+          callback) override;
 
  private:
   // Defines a byte range in the underlying record stream that will be read
@@ -157,6 +329,9 @@ class ConcurrentStreamRecordReader : public StreamRecordReader {
   struct ShardRange {
     int64_t start_pos;
     int64_t end_pos;
+    // Whether the shard starts a range of records to read. Records before the
+    // shard are then not expected to be read by the previous shard.
+    bool starts_record_range = true;
   };
   // Defines metadata/stats returned by a shard reading task. This is useful
   // for correctness checks.
@@ -165,10 +340,27 @@ class ConcurrentStreamRecordReader : public StreamRecordReader {
     int64_t next_shard_first_record_pos;
     int64_t num_records_read;
   };
+  using BatchCallback =
+      std::function<absl::Status(absl::Span<const std::string_view>)>;
+  // Reads all shards concurrently, passing batches of at most `batch_size`
+  // records to `batch_callback`.
+  absl::Status ReadShards(const BatchCallback& batch_callback,
+                          int64_t batch_size);
+  // Reads the records of `shard` in batches of at most `batch_size` records,
+  // which are pushed to `batch_queue` if set, or passed to `batch_callback`.
   absl::StatusOr<ShardResult> ReadShardRecords(
-      const ShardRange& shard,
-      const std::function<absl::Status(const RecordT&)>& record_callback);
+      const ShardRange& shard, const BatchCallback& batch_callback,
+      int64_t batch_size, RecordBatchQueue* batch_queue);
+  // Passes the batches of `batch_queue` to `batch_callback` until the queue
+  // is closed and drained.
+  static absl::Status ApplyBatches(RecordBatchQueue& batch_queue,
+                                   const BatchCallback& batch_callback);
   absl::StatusOr<std::vector<ShardRange>> BuildShards();
+  // Returns the inclusive byte ranges of the stream that hold the records to
+  // read, in order.
+  absl::StatusOr<std::vector<ShardRange>> BuildRecordRanges(
+      int64_t stream_size);
+  absl::StatusOr<ShardRecordRanges> ReadShardRecordRanges(int64_t stream_size);
   absl::StatusOr<int64_t> RecordStreamSize();
   std::function<std::unique_ptr<RecordStream>()> stream_factory_;
   Options options_;
@@ -197,14 +389,68 @@ ConcurrentStreamRecordReader<RecordT>::GetKVFileMetadata() {
 template <typename RecordT>
 absl::StatusOr<int64_t>
 ConcurrentStreamRecordReader<RecordT>::RecordStreamSize() {
-  auto record_stream = stream_factory_();
-  auto& stream = record_stream->Stream();
-  stream.seekg(0, std::ios_base::end);
-  int64_t size = stream.tellg();
-  if (size == -1) {
-    return absl::InvalidArgumentError("Input streams do not support seeking.");
+  return GetRecordStreamSize(*stream_factory_());
+}
+
+template <typename RecordT>
+absl::StatusOr<ShardRecordRanges>
+ConcurrentStreamRecordReader<RecordT>::ReadShardRecordRanges(
+    int64_t stream_size) {
+  ShardRecordRanges shard_record_ranges;
+  if (absl::Status status = ReadLastRecord(*stream_factory_(), stream_size,
+                                           shard_record_ranges);
+      !status.ok()) {
+    return status;
   }
-  return size;
+  return shard_record_ranges;
+}
+
+template <typename RecordT>
+absl::StatusOr<
+    std::vector<typename ConcurrentStreamRecordReader<RecordT>::ShardRange>>
+ConcurrentStreamRecordReader<RecordT>::BuildRecordRanges(int64_t stream_size) {
+  using ShardRangeT =
+      typename ConcurrentStreamRecordReader<RecordT>::ShardRange;
+  absl::StatusOr<KVFileMetadata> metadata = GetKVFileMetadata();
+  if (metadata.ok() && metadata->snapshot().has_key_index()) {
+    SnapshotKeyIndex key_index;
+    if (absl::Status status =
+            ReadLastRecord(*stream_factory_(), stream_size, key_index);
+        !status.ok()) {
+      return status;
+    }
+    // Records are before the key index, which is the last record.
+    return std::vector<ShardRangeT>{ShardRangeT{
+        .start_pos = 0, .end_pos = key_index.records_end_pos() - 1}};
+  }
+  if (!metadata.ok() ||
+      !metadata->sharding_metadata().has_shard_record_ranges()) {
+    // Streams without shard record ranges are read whole.
+    return std::vector<ShardRangeT>{
+        ShardRangeT{.start_pos = 0, .end_pos = stream_size}};
+  }
+  absl::StatusOr<ShardRecordRanges> shard_record_ranges =
+      ReadShardRecordRanges(stream_size);
+  if (!shard_record_ranges.ok()) {
+    return shard_record_ranges.status();
+  }
+  std::vector<ShardRangeT> record_ranges;
+  for (const ShardRecordRange& range : shard_record_ranges->ranges()) {
+    if (range.begin_pos() >= range.end_pos() ||
+        (options_.shard_num >= 0 &&
+         !MayHoldRecordsOfShard(
+             options_.logical_shard_mapping.get(),
+             metadata->sharding_metadata().num_logical_shards(),
+             range.shard_num(), options_.shard_num))) {
+      continue;
+    }
+    // Records of the range are at positions before `end_pos`.
+    record_ranges.push_back(ShardRangeT{.start_pos = range.begin_pos(),
+                                        .end_pos = range.end_pos() - 1});
+  }
+  VLOG(2) << "Reading " << record_ranges.size() << " of "
+          << shard_record_ranges->ranges_size() << " shard record ranges.";
+  return record_ranges;
 }
 
 template <typename RecordT>
@@ -222,26 +468,40 @@ ConcurrentStreamRecordReader<RecordT>::BuildShards() {
         absl::StrFormat("Num worker threads %d must be at least 1.",
                         options_.num_worker_threads));
   }
+  absl::StatusOr<std::vector<ShardRangeT>> record_ranges =
+      BuildRecordRanges(*stream_size);
+  if (!record_ranges.ok()) {
+    return record_ranges.status();
+  }
+  int64_t total_size = 0;
+  for (const ShardRangeT& range : *record_ranges) {
+    total_size += range.end_pos - range.start_pos;
+  }
+  const int64_t num_shards =
+      options_.num_worker_threads * std::max<int64_t>(
+                                        options_.shards_per_worker, 1);
   // The shard size must be at least `options_.min_shard_size_bytes` and
-  // at most `*stream_size`.
+  // at most `total_size`.
   int64_t shard_size = std::min(
-      *stream_size, std::max(int64_t(std::ceil((double)*stream_size /
-                                               options_.num_worker_threads)),
-                             options_.min_shard_size_bytes));
-  int64_t shard_start_pos = 0;
+      total_size,
+      std::max(int64_t(std::ceil((double)total_size / num_shards)),
+               options_.min_shard_size_bytes));
   std::vector<ShardRangeT> shards;
-  shards.reserve(options_.num_worker_threads);
-  while (shard_start_pos < *stream_size) {
-    int64_t shard_end_pos = shard_start_pos + shard_size;
-    shard_end_pos = std::min(shard_end_pos, *stream_size);
-    shards.push_back(ShardRangeT{
-        .start_pos = shard_start_pos,
-        .end_pos = shard_end_pos,
-    });
-    shard_start_pos = shard_end_pos + 1;
-  }
-  if (shards.empty() || shards.back().end_pos != *stream_size) {
-    return absl::InternalError("Failed to generate shards.");
+  shards.reserve(num_shards + record_ranges->size());
+  for (const ShardRangeT& range : *record_ranges) {
+    int64_t shard_start_pos = range.start_pos;
+    bool starts_record_range = true;
+    do {
+      int64_t shard_end_pos = shard_start_pos + shard_size;
+      shard_end_pos = std::min(shard_end_pos, range.end_pos);
+      shards.push_back(ShardRangeT{
+          .start_pos = shard_start_pos,
+          .end_pos = shard_end_pos,
+          .starts_record_range = starts_record_range,
+      });
+      shard_start_pos = shard_end_pos + 1;
+      starts_record_range = false;
+    } while (shard_start_pos <= range.end_pos);
   }
   return shards;
 }
@@ -251,6 +511,25 @@ ConcurrentStreamRecordReader<RecordT>::BuildShards() {
 template <typename RecordT>
 absl::Status ConcurrentStreamRecordReader<RecordT>::ReadStreamRecords(
     const std::function<absl::Status(const RecordT&)>& callback) {
+  // Batches of one record are views of the record read, so no record is
+  // copied.
+  return ReadShards(
+      [&callback](absl::Span<const std::string_view> records) {
+        return callback(records.front());
+      },
+      /*batch_size=*/1);
+}
+
+template <typename RecordT>
+absl::Status ConcurrentStreamRecordReader<RecordT>::ReadStreamRecordBatches(
+    const std::function<absl::Status(absl::Span<const std::string_view>)>&
+        callback) {
+  return ReadShards(callback, std::max<int64_t>(options_.batch_size, 1));
+}
+
+template <typename RecordT>
+absl::Status ConcurrentStreamRecordReader<RecordT>::ReadShards(
+    const BatchCallback& batch_callback, int64_t batch_size) {
   ScopeLatencyMetricsRecorder<
       ServerSafeMetricsContext,
       kConcurrentStreamRecordReaderReadStreamRecordsLatency>
@@ -259,31 +538,88 @@ absl::Status ConcurrentStreamRecordReader<RecordT>::ReadStreamRecords(
   if (!shards.ok() || shards->empty()) {
     return shards.status();
   }
-  std::vector<std::future<absl::StatusOr<ShardResult>>> shard_reader_tasks;
-  for (const auto& shard : *shards) {
+  const int64_t num_shards = shards->size();
+  const int64_t num_workers =
+      std::min(options_.num_worker_threads, num_shards);
+  // Every worker fills a batch while the apply threads apply one each and
+  // another one each is queued.
+  std::optional<RecordBatchQueue> batch_queue;
+  std::vector<std::future<absl::Status>> appliers;
+  if (batch_size > 1 && options_.num_apply_threads > 0) {
+    batch_queue.emplace(num_workers + 2 * options_.num_apply_threads,
+                        batch_size);
+    for (int64_t i = 0; i < options_.num_apply_threads; i++) {
+      appliers.push_back(
+          std::async(std::launch::async, [&batch_queue, &batch_callback]() {
+            return ApplyBatches(*batch_queue, batch_callback);
+          }));
+    }
+  }
+  // Set for the shards read, which are the first ones when a shard failed.
+  std::vector<std::optional<absl::StatusOr<ShardResult>>> shard_results(
+      num_shards);
+  {
+    const absl::Time start = absl::Now();
+    std::atomic<int64_t> next_shard_index = 0;
+    std::atomic<bool> failed = false;
+    RecordBatchQueue* queue =
+        batch_queue.has_value() ? &*batch_queue : nullptr;
+    const auto read_shards = [this, &shards, &shard_results, &batch_callback,
+                              batch_size, queue, num_shards, start,
+                              &next_shard_index, &failed]() {
+      for (int64_t i = next_shard_index++; i < num_shards && !failed;
+           i = next_shard_index++) {
+        LogIfError(
+            KVServerContextMap()
+                ->SafeMetric()
+                .LogHistogram<
+                    kConcurrentStreamRecordReaderShardQueueLatency>(
+                    absl::ToDoubleMicroseconds(absl::Now() - start)));
+        if (!shard_results[i]
+                 .emplace(ReadShardRecords((*shards)[i], batch_callback,
+                                           batch_size, queue))
+                 .ok()) {
+          failed = true;
+        }
+      }
+    };
     // TODO: b/268339067 - Investigate using an executor because
     // std::async is generally not preffered, but works fine as an
     // initial implementation.
-    shard_reader_tasks.push_back(
-        std::async(std::launch::async,
-                   &ConcurrentStreamRecordReader<RecordT>::ReadShardRecords,
-                   this, std::ref(shard), std::ref(callback)));
+    std::vector<std::future<void>> workers;
+    for (int64_t i = 0; i < num_workers; i++) {
+      workers.push_back(std::async(std::launch::async, read_shards));
+    }
+    for (auto& worker : workers) {
+      worker.get();
+    }
   }
-  absl::StatusOr<ShardResult> prev_shard_result = shard_reader_tasks[0].get();
-  if (!prev_shard_result.ok()) {
-    return prev_shard_result.status();
+  if (batch_queue.has_value()) {
+    batch_queue->Close();
+    absl::Status apply_status;
+    for (auto& applier : appliers) {
+      apply_status.Update(applier.get());
+    }
+    if (!apply_status.ok()) {
+      LOG(ERROR) << "Record callback failed to process some records with: "
+                 << apply_status;
+    }
+  }
+  for (const auto& shard_result : shard_results) {
+    if (shard_result.has_value() && !shard_result->ok()) {
+      return shard_result->status();
+    }
   }
+  const ShardResult* prev_shard_result = &**shard_results[0];
   int64_t total_records_read = prev_shard_result->num_records_read;
-  for (int i = 1; i < shard_reader_tasks.size(); i++) {
-    absl::StatusOr<ShardResult> curr_shard_result = shard_reader_tasks[i].get();
+  for (int i = 1; i < num_shards; i++) {
+    const ShardResult* curr_shard_result = &**shard_results[i];
     // TODO: The stuff below should be handled more gracefully,
     // e.g., only retry the shard that failed or skipped some
     // records.
-    if (!curr_shard_result.ok()) {
-      return curr_shard_result.status();
-    }
-    if (prev_shard_result->next_shard_first_record_pos <
-        curr_shard_result->first_record_pos) {
+    if (!(*shards)[i].starts_record_range &&
+        prev_shard_result->next_shard_first_record_pos <
+            curr_shard_result->first_record_pos) {
       return absl::InternalError(
           absl::StrFormat("Skipped some records between byte=%d and byte=%d.",
                           prev_shard_result->next_shard_first_record_pos,
@@ -301,8 +637,8 @@ absl::Status ConcurrentStreamRecordReader<RecordT>::ReadStreamRecords(
 template <typename RecordT>
 absl::StatusOr<typename ConcurrentStreamRecordReader<RecordT>::ShardResult>
 ConcurrentStreamRecordReader<RecordT>::ReadShardRecords(
-    const ShardRange& shard,
-    const std::function<absl::Status(const RecordT&)>& record_callback) {
+    const ShardRange& shard, const BatchCallback& batch_callback,
+    int64_t batch_size, RecordBatchQueue* batch_queue) {
   VLOG(2) << "Reading shard: "
           << "[" << shard.start_pos << "," << shard.end_pos << "]";
   ScopeLatencyMetricsRecorder<
@@ -310,8 +646,8 @@ ConcurrentStreamRecordReader<RecordT>::ReadShardRecords(
       kConcurrentStreamRecordReaderReadShardRecordsLatency>
       latency_recorder(KVServerContextMap()->SafeMetric());
   auto record_stream = stream_factory_();
-  riegeli::RecordReader<riegeli::IStreamReader<>> record_reader(
-      riegeli::IStreamReader(&record_stream->Stream()),
+  riegeli::RecordReader<std::unique_ptr<riegeli::Reader>> record_reader(
+      NewRiegeliReader(*record_stream),
       riegeli::RecordReaderBase::Options().set_recovery(
           options_.recovery_callback));
   if (auto result = record_reader.Seek(shard.start_pos); !result) {
@@ -321,12 +657,53 @@ ConcurrentStreamRecordReader<RecordT>::ReadShardRecords(
   ShardResult shard_result;
   shard_result.first_record_pos = next_record_pos;
   int64_t num_records_read = 0;
-  RecordT record;
   absl::Status overall_status;
-  while (next_record_pos <= shard.end_pos && record_reader.ReadRecord(record)) {
-    overall_status.Update(record_callback(record));
-    num_records_read++;
-    next_record_pos = record_reader.pos().numeric();
+  if (batch_size <= 1) {
+    RecordT record;
+    while (next_record_pos <= shard.end_pos &&
+           record_reader.ReadRecord(record)) {
+      const std::string_view record_view = record;
+      overall_status.Update(
+          batch_callback(absl::MakeConstSpan(&record_view, 1)));
+      num_records_read++;
+      next_record_pos = record_reader.pos().numeric();
+    }
+  } else if (batch_queue != nullptr) {
+    RecordBatchQueue::Batch* batch = batch_queue->AcquireFree();
+    while (next_record_pos <= shard.end_pos &&
+           record_reader.ReadRecord(batch->records[batch->size])) {
+      batch->size++;
+      num_records_read++;
+      next_record_pos = record_reader.pos().numeric();
+      if (batch->size == batch_size) {
+        batch_queue->PushFull(batch);
+        batch = batch_queue->AcquireFree();
+      }
+    }
+    if (batch->size > 0) {
+      batch_queue->PushFull(batch);
+    } else {
+      batch_queue->Release(batch);
+    }
+  } else {
+    // Records read are only valid until the next read, so they are copied to
+    // buffers that are reused across batches.
+    std::vector<std::string> buffers(batch_size);
+    std::vector<std::string_view> batch;
+    batch.reserve(batch_size);
+    while (next_record_pos <= shard.end_pos &&
+           record_reader.ReadRecord(buffers[batch.size()])) {
+      batch.push_back(buffers[batch.size()]);
+      num_records_read++;
+      next_record_pos = record_reader.pos().numeric();
+      if (static_cast<int64_t>(batch.size()) == batch_size) {
+        overall_status.Update(batch_callback(batch));
+        batch.clear();
+      }
+    }
+    if (!batch.empty()) {
+      overall_status.Update(batch_callback(batch));
+    }
   }
   // TODO: b/269119466 - Figure out how to handle this better. Maybe add
   // metrics to track callback failures (??).
@@ -346,6 +723,20 @@ ConcurrentStreamRecordReader<RecordT>::ReadShardRecords(
   return shard_result;
 }
 
+template <typename RecordT>
+absl::Status ConcurrentStreamRecordReader<RecordT>::ApplyBatches(
+    RecordBatchQueue& batch_queue, const BatchCallback& batch_callback) {
+  std::vector<std::string_view> batch_views;
+  absl::Status status;
+  while (RecordBatchQueue::Batch* batch = batch_queue.PopFull()) {
+    batch_views.assign(batch->records.begin(),
+                       batch->records.begin() + batch->size);
+    status.Update(batch_callback(batch_views));
+    batch_queue.Release(batch);
+  }
+  return status;
+}
+
 }  // namespace kv_server
 
 #endif  // PUBLIC_DATA_LOADING_READERS_RIEGELI_STREAM_IO_H_
@@ -16,12 +16,16 @@
 
 #include <filesystem>
 #include <fstream>
+#include <optional>
 #include <sstream>
 #include <string>
+#include <string_view>
 #include <utility>
+#include <vector>
 
 #include "absl/log/check.h"
 #include "absl/status/status.h"
+#include "absl/synchronization/mutex.h"
 #include "gmock/gmock.h"
 #include "google/protobuf/text_format.h"
 #include "gtest/gtest.h"
@@ -160,6 +164,32 @@ TEST_P(StreamRecordReaderTest, BadStreamFailure) {
           .ok());
 }
 
+TEST(RiegeliStreamRecordReaderFactoryTest, ReadsInMemoryData) {
+  kv_server::InitMetricsContextMap();
+  std::string content;
+  riegeli::RecordWriterBase::Options options;
+  riegeli::RecordsMetadata metadata;
+  KVFileMetadata file_metadata;
+  *metadata.MutableExtension(kv_server::kv_file_metadata) = file_metadata;
+  options.set_metadata(std::move(metadata));
+  auto writer = riegeli::RecordWriter(riegeli::StringWriter(&content), options);
+  writer.WriteRecord("record1");
+  writer.WriteRecord("record2");
+  ASSERT_TRUE(writer.Close());
+
+  std::vector<std::string> records;
+  auto reader =
+      RiegeliStreamRecordReaderFactory().CreateInMemoryReader(content);
+  EXPECT_THAT(reader->GetKVFileMetadata().value(), EqualsProto(file_metadata));
+  EXPECT_TRUE(reader
+                  ->ReadStreamRecords([&records](std::string_view record) {
+                    records.emplace_back(record);
+                    return absl::OkStatus();
+                  })
+                  .ok());
+  EXPECT_THAT(records, testing::ElementsAre("record1", "record2"));
+}
+
 TEST_P(StreamRecordReaderTest, SkipsOverCorruption) {
   std::string uncorrupted_content;
   riegeli::RecordWriterBase::Options options;
@@ -214,6 +244,17 @@ INSTANTIATE_TEST_SUITE_P(ConcurrentOptions, ConcurrentStreamRecordReaderTest,
                              ConcurrentReaderOptions{
                                  .num_worker_threads = 5,
                                  .min_shard_size_bytes = 1024 * 1024,
+                             },
+                             ConcurrentReaderOptions{
+                                 .num_worker_threads = 3,
+                                 .min_shard_size_bytes = 128,
+                                 .shards_per_worker = 16,
+                             },
+                             ConcurrentReaderOptions{
+                                 .num_worker_threads = 3,
+                                 .min_shard_size_bytes = 128,
+                                 .shards_per_worker = 4,
+                                 .num_apply_threads = 2,
                              }));
 
 TEST_P(ConcurrentStreamRecordReaderTest, ReadsAllRecordsExactlyOnce) {
@@ -241,6 +282,77 @@ TEST_P(ConcurrentStreamRecordReaderTest, ReadsAllRecordsExactlyOnce) {
   }
 }
 
+TEST_P(ConcurrentStreamRecordReaderTest, ReadsAllRecordsInBatches) {
+  std::string content;
+  auto writer = riegeli::RecordWriter(riegeli::StringWriter(&content),
+                                      riegeli::RecordWriterBase::Options());
+  for (int i = 0; i < 2500; i++) {
+    writer.WriteRecord(absl::StrCat(i));
+  }
+  ASSERT_TRUE(writer.Close());
+  ConcurrentReaderOptions options = GetParam();
+  options.batch_size = 100;
+  ConcurrentStreamRecordReader<std::string_view> record_reader(
+      [&content]() { return std::make_unique<StringBlobStream>(content); },
+      options);
+  absl::Mutex mutex;
+  std::vector<std::string> records_read;
+  EXPECT_TRUE(record_reader
+                  .ReadStreamRecordBatches(
+                      [&mutex, &records_read](
+                          absl::Span<const std::string_view> batch) {
+                        EXPECT_GE(batch.size(), 1);
+                        EXPECT_LE(batch.size(), 100);
+                        absl::MutexLock lock(&mutex);
+                        records_read.insert(records_read.end(), batch.begin(),
+                                            batch.end());
+                        return absl::OkStatus();
+                      })
+                  .ok());
+  std::vector<std::string> expected_records;
+  for (int i = 0; i < 2500; i++) {
+    expected_records.push_back(absl::StrCat(i));
+  }
+  EXPECT_THAT(records_read,
+              testing::UnorderedElementsAreArray(expected_records));
+}
+
+// Holds `blob` contents in memory. Its stream is empty, so reading it fails.
+class InMemoryBlobStream : public RecordStream {
+ public:
+  explicit InMemoryBlobStream(std::string_view blob) : blob_(blob) {}
+  std::istream& Stream() { return stream_; }
+  std::optional<std::string_view> Contents() override { return blob_; }
+
+ private:
+  std::string_view blob_;
+  std::stringstream stream_;
+};
+
+TEST_P(ConcurrentStreamRecordReaderTest, ReadsInMemoryContents) {
+  std::string content;
+  auto writer = riegeli::RecordWriter(riegeli::StringWriter(&content),
+                                      riegeli::RecordWriterBase::Options());
+  for (int i = 0; i < 1000; i++) {
+    writer.WriteRecord(absl::StrCat(i));
+  }
+  ASSERT_TRUE(writer.Close());
+  ConcurrentStreamRecordReader<std::string_view> record_reader(
+      [&content]() { return std::make_unique<InMemoryBlobStream>(content); },
+      GetParam());
+  absl::Mutex mutex;
+  std::vector<std::string> records_read;
+  EXPECT_TRUE(
+      record_reader
+          .ReadStreamRecords([&mutex, &records_read](std::string_view record) {
+            absl::MutexLock lock(&mutex);
+            records_read.emplace_back(record);
+            return absl::OkStatus();
+          })
+          .ok());
+  EXPECT_EQ(records_read.size(), 1000);
+}
+
 // Disables seeking from stringbufs.
 class NonSeekingSStreamBuf : public std::stringbuf {
  public:
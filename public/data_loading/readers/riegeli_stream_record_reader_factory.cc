@@ -18,13 +18,26 @@
 
 namespace kv_server {
 
+namespace {
+
+bool SkipCorruptedRegion(const riegeli::SkippedRegion& skipped_region) {
+  LOG(WARNING) << "Skipping over corrupted region: " << skipped_region;
+  return true;
+}
+
+}  // namespace
+
 std::unique_ptr<StreamRecordReader>
 RiegeliStreamRecordReaderFactory::CreateReader(std::istream& data_input) const {
   return std::make_unique<RiegeliStreamReader<std::string_view>>(
-      data_input, [](const riegeli::SkippedRegion& skipped_region) {
-        LOG(WARNING) << "Skipping over corrupted region: " << skipped_region;
-        return true;
-      });
+      data_input, SkipCorruptedRegion);
+}
+
+std::unique_ptr<StreamRecordReader>
+RiegeliStreamRecordReaderFactory::CreateInMemoryReader(
+    std::string_view data) const {
+  return std::make_unique<RiegeliStreamReader<std::string_view>>(
+      data, SkipCorruptedRegion);
 }
 
 std::unique_ptr<StreamRecordReader>
@@ -18,6 +18,7 @@
 #define PUBLIC_DATA_LOADING_READERS_RIEGELI_STREAM_RECORD_READER_FACTORY_H_
 
 #include <memory>
+#include <string_view>
 
 #include "public/data_loading/readers/riegeli_stream_io.h"
 #include "public/data_loading/readers/stream_record_reader_factory.h"
@@ -40,6 +41,10 @@ class RiegeliStreamRecordReaderFactory : public StreamRecordReaderFactory {
       std::function<std::unique_ptr<RecordStream>()> stream_factory)
       const override;
 
+  // Reads `data` in place, without copying it into Riegeli buffers.
+  std::unique_ptr<StreamRecordReader> CreateInMemoryReader(
+      std::string_view data) const override;
+
  private:
   ConcurrentStreamRecordReader<std::string_view>::Options options_;
 };
@@ -0,0 +1,203 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "public/data_loading/readers/sorted_snapshot_record_reader.h"
+
+#include <utility>
+#include <vector>
+
+#include "absl/log/log.h"
+#include "public/data_loading/readers/riegeli_stream_io.h"
+#include "public/data_loading/records_utils.h"
+#include "public/data_loading/snapshot_key_index.h"
+#include "riegeli/records/record_reader.h"
+
+namespace kv_server {
+namespace {
+
+// Calls `callback` with the key of the key value mutation `record`, or fails
+// if it is not one.
+absl::Status WithRecordKey(
+    std::string_view record,
+    const std::function<absl::Status(std::string_view)>& callback) {
+  return DeserializeDataRecord(
+      record, [&callback](const DataRecord& data_record) {
+        const KeyValueMutationRecord* kv_record =
+            data_record.record_as_KeyValueMutationRecord();
+        if (kv_record == nullptr) {
+          return absl::DataLossError(
+              "Blocks of sorted snapshots must only hold key value "
+              "mutations.");
+        }
+        return callback(kv_record->key()->string_view());
+      });
+}
+
+}  // namespace
+
+SortedSnapshotRecordReader::SortedSnapshotRecordReader(
+    std::function<std::unique_ptr<RecordStream>()> stream_factory,
+    Options options)
+    : stream_factory_(std::move(stream_factory)),
+      options_(std::move(options)) {}
+
+absl::StatusOr<KVFileMetadata> SortedSnapshotRecordReader::GetKVFileMetadata() {
+  auto record_stream = stream_factory_();
+  riegeli::RecordReader<std::unique_ptr<riegeli::Reader>> record_reader(
+      NewRiegeliReader(*record_stream));
+  riegeli::RecordsMetadata metadata;
+  if (!record_reader.ReadMetadata(metadata)) {
+    if (record_reader.ok()) {
+      return absl::UnavailableError(
+          "Metadata not found. Please ensure metadata is set properly.");
+    }
+    return record_reader.status();
+  }
+  return metadata.GetExtension(kv_file_metadata);
+}
+
+absl::StatusOr<const SnapshotKeyIndex*>
+SortedSnapshotRecordReader::GetKeyIndex() {
+  if (key_index_.has_value()) {
+    return &*key_index_;
+  }
+  absl::StatusOr<KVFileMetadata> metadata = GetKVFileMetadata();
+  if (!metadata.ok()) {
+    return metadata.status();
+  }
+  if (!metadata->snapshot().has_key_index()) {
+    return absl::FailedPreconditionError("Snapshot has no key index.");
+  }
+  absl::StatusOr<int64_t> stream_size = GetRecordStreamSize(*stream_factory_());
+  if (!stream_size.ok()) {
+    return stream_size.status();
+  }
+  SnapshotKeyIndex key_index;
+  if (absl::Status status =
+          ReadLastRecord(*stream_factory_(), *stream_size, key_index);
+      !status.ok()) {
+    return status;
+  }
+  return &key_index_.emplace(std::move(key_index));
+}
+
+absl::Status SortedSnapshotRecordReader::ReadStreamRecords(
+    const std::function<absl::Status(const std::string_view&)>& callback) {
+  absl::StatusOr<const SnapshotKeyIndex*> key_index = GetKeyIndex();
+  if (!key_index.ok()) {
+    return key_index.status();
+  }
+  absl::Status overall_status;
+  absl::Status status;
+  if (options_.begin_key.empty() && options_.end_key.empty()) {
+    status = ReadRecordRange(
+        0, (*key_index)->records_end_pos(),
+        [&callback, &overall_status](std::string_view record) {
+          overall_status.Update(callback(record));
+          return absl::OkStatus();
+        });
+  } else {
+    const auto in_range = [this](std::string_view key) {
+      return key >= options_.begin_key &&
+             (options_.end_key.empty() || key < options_.end_key);
+    };
+    for (int i : FindSnapshotKeyIndexBlocks(**key_index, options_.begin_key,
+                                            options_.end_key)) {
+      const SnapshotKeyIndexBlock& block = (*key_index)->blocks(i);
+      // Only the records of blocks at the ends of the range are decoded.
+      const bool whole_block =
+          in_range(block.first_key()) && in_range(block.last_key());
+      status = ReadRecordRange(
+          block.begin_pos(), block.end_pos(),
+          [&callback, &overall_status, &in_range,
+           whole_block](std::string_view record) {
+            if (whole_block) {
+              overall_status.Update(callback(record));
+              return absl::OkStatus();
+            }
+            return WithRecordKey(record, [&](std::string_view key) {
+              if (in_range(key)) {
+                overall_status.Update(callback(record));
+              }
+              return absl::OkStatus();
+            });
+          });
+      if (!status.ok()) {
+        break;
+      }
+    }
+  }
+  if (!overall_status.ok()) {
+    LOG(ERROR) << overall_status;
+  }
+  return status;
+}
+
+absl::StatusOr<bool> SortedSnapshotRecordReader::ContainsKey(
+    std::string_view key) {
+  absl::StatusOr<const SnapshotKeyIndex*> key_index = GetKeyIndex();
+  if (!key_index.ok()) {
+    return key_index.status();
+  }
+  for (int i : FindSnapshotKeyIndexBlocks(**key_index, key, "")) {
+    const SnapshotKeyIndexBlock& block = (*key_index)->blocks(i);
+    if (block.first_key() > key) {
+      break;
+    }
+    if (!SnapshotKeyIndexBlockMayContain(**key_index, block, key)) {
+      continue;
+    }
+    bool found = false;
+    if (absl::Status status = ReadRecordRange(
+            block.begin_pos(), block.end_pos(),
+            [key, &found](std::string_view record) {
+              return WithRecordKey(record,
+                                   [key, &found](std::string_view record_key) {
+                                     found |= record_key == key;
+                                     return absl::OkStatus();
+                                   });
+            });
+        !status.ok()) {
+      return status;
+    }
+    if (found) {
+      return true;
+    }
+  }
+  return false;
+}
+
+absl::Status SortedSnapshotRecordReader::ReadRecordRange(
+    int64_t begin_pos, int64_t end_pos,
+    const std::function<absl::Status(std::string_view)>& callback) {
+  auto record_stream = stream_factory_();
+  riegeli::RecordReader<std::unique_ptr<riegeli::Reader>> record_reader(
+      NewRiegeliReader(*record_stream));
+  if (!record_reader.Seek(begin_pos)) {
+    return record_reader.status();
+  }
+  absl::string_view record;
+  while (record_reader.pos().numeric() < end_pos &&
+         record_reader.ReadRecord(record)) {
+    if (absl::Status status = callback(record); !status.ok()) {
+      return status;
+    }
+  }
+  if (!record_reader.Close()) {
+    return record_reader.status();
+  }
+  return absl::OkStatus();
+}
+
+}  // namespace kv_server
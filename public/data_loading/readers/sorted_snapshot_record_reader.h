@@ -0,0 +1,83 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PUBLIC_DATA_LOADING_READERS_SORTED_SNAPSHOT_RECORD_READER_H_
+#define PUBLIC_DATA_LOADING_READERS_SORTED_SNAPSHOT_RECORD_READER_H_
+
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "public/data_loading/readers/stream_record_reader.h"
+#include "public/data_loading/riegeli_metadata.pb.h"
+
+namespace kv_server {
+
+// Reads snapshots written sorted by key with a `SnapshotKeyIndex`, see
+// `SnapshotMetadata.has_key_index`. Only the blocks of records that may hold
+// the keys read are decoded, so a key range of a large snapshot is loaded, or
+// a key is looked up, without reading the whole snapshot.
+//
+// Like `ConcurrentStreamRecordReader`, `stream_factory` must produce streams
+// that support seeking and point to the same snapshot.
+class SortedSnapshotRecordReader : public StreamRecordReader {
+ public:
+  struct Options {
+    // Only the records with keys in [`begin_key`, `end_key`) are read, up to
+    // the last key if `end_key` is empty. Records that are not key value
+    // mutations, e.g. the UDF config, are only read if both are empty.
+    std::string begin_key;
+    std::string end_key;
+  };
+
+  explicit SortedSnapshotRecordReader(
+      std::function<std::unique_ptr<RecordStream>()> stream_factory,
+      Options options = Options());
+  SortedSnapshotRecordReader(const SortedSnapshotRecordReader&) = delete;
+  SortedSnapshotRecordReader& operator=(const SortedSnapshotRecordReader&) =
+      delete;
+
+  absl::StatusOr<KVFileMetadata> GetKVFileMetadata() override;
+  absl::Status ReadStreamRecords(
+      const std::function<absl::Status(const std::string_view&)>& callback)
+      override;
+
+  // Returns whether the snapshot holds a record of `key`, reading at most the
+  // blocks whose Bloom filter may contain it.
+  absl::StatusOr<bool> ContainsKey(std::string_view key);
+
+  // Returns the key index of the snapshot, which is read once. Fails if the
+  // snapshot has none.
+  absl::StatusOr<const SnapshotKeyIndex*> GetKeyIndex();
+
+ private:
+  // Calls `callback` with the records at positions [`begin_pos`, `end_pos`).
+  absl::Status ReadRecordRange(
+      int64_t begin_pos, int64_t end_pos,
+      const std::function<absl::Status(std::string_view)>& callback);
+
+  std::function<std::unique_ptr<RecordStream>()> stream_factory_;
+  Options options_;
+  std::optional<SnapshotKeyIndex> key_index_;
+};
+
+}  // namespace kv_server
+
+#endif  // PUBLIC_DATA_LOADING_READERS_SORTED_SNAPSHOT_RECORD_READER_H_
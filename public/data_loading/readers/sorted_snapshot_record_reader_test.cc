@@ -0,0 +1,224 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "public/data_loading/readers/sorted_snapshot_record_reader.h"
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "absl/log/check.h"
+#include "absl/strings/str_format.h"
+#include "absl/synchronization/mutex.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "public/data_loading/readers/riegeli_stream_io.h"
+#include "public/data_loading/records_utils.h"
+#include "public/data_loading/writers/snapshot_stream_writer.h"
+
+namespace kv_server {
+namespace {
+
+using testing::ElementsAreArray;
+using testing::UnorderedElementsAreArray;
+
+constexpr int kNumKeys = 100;
+
+class StringBlobStream : public RecordStream {
+ public:
+  explicit StringBlobStream(const std::string& blob) : stream_(blob) {}
+  std::istream& Stream() override { return stream_; }
+
+ private:
+  std::stringstream stream_;
+};
+
+std::string Key(int i) { return absl::StrFormat("key%03d", i); }
+
+KVFileMetadata GetSnapshotMetadata() {
+  KVFileMetadata metadata;
+  SnapshotMetadata* snapshot = metadata.mutable_snapshot();
+  snapshot->set_starting_file("DELTA_0000000000000001");
+  snapshot->set_ending_delta_file("DELTA_0000000000000010");
+  return metadata;
+}
+
+// Returns a snapshot of `kNumKeys` keys, written in reverse order, and a UDF
+// config.
+std::string WriteSnapshot(int64_t key_index_block_size) {
+  std::stringstream snapshot_stream;
+  auto writer = SnapshotStreamWriter<std::stringstream>::Create(
+      {.metadata = GetSnapshotMetadata(),
+       .key_index_block_size = key_index_block_size},
+      snapshot_stream);
+  CHECK(writer.ok()) << writer.status();
+  for (int i = kNumKeys - 1; i >= 0; i--) {
+    const std::string key = Key(i);
+    CHECK((*writer)
+              ->WriteRecord(DataRecordStruct{
+                  .record = KeyValueMutationRecordStruct{
+                      .mutation_type = KeyValueMutationType::Update,
+                      .logical_commit_time = 1,
+                      .key = key,
+                      .value = "value",
+                  }})
+              .ok());
+  }
+  CHECK((*writer)
+            ->WriteRecord(DataRecordStruct{
+                .record = UserDefinedFunctionsConfigStruct{
+                    .language = UserDefinedFunctionsLanguage::Javascript,
+                    .code_snippet = "function hello(){}",
+                    .handler_name = "hello",
+                    .logical_commit_time = 1,
+                    .version = 1,
+                }})
+            .ok());
+  CHECK((*writer)->Finalize().ok());
+  return snapshot_stream.str();
+}
+
+std::function<std::unique_ptr<RecordStream>()> StreamFactory(
+    const std::string& snapshot) {
+  return [&snapshot]() { return std::make_unique<StringBlobStream>(snapshot); };
+}
+
+// Returns the keys of the key value mutations read and counts the other
+// records in `num_other_records`.
+std::vector<std::string> ReadKeys(StreamRecordReader& reader,
+                                  int* num_other_records = nullptr) {
+  std::vector<std::string> keys;
+  auto status = reader.ReadStreamRecords([&](const std::string_view& record) {
+    return DeserializeDataRecord(
+        record, [&](const DataRecordStruct& data_record) {
+          if (const auto* kv_record = std::get_if<KeyValueMutationRecordStruct>(
+                  &data_record.record)) {
+            keys.emplace_back(kv_record->key);
+          } else if (num_other_records != nullptr) {
+            (*num_other_records)++;
+          }
+          return absl::OkStatus();
+        });
+  });
+  EXPECT_TRUE(status.ok()) << status;
+  return keys;
+}
+
+std::vector<std::string> Keys(int begin, int end) {
+  std::vector<std::string> keys;
+  for (int i = begin; i < end; i++) {
+    keys.push_back(Key(i));
+  }
+  return keys;
+}
+
+TEST(SortedSnapshotRecordReaderTest, WritesBlocksOfSortedKeys) {
+  const std::string snapshot = WriteSnapshot(/*key_index_block_size=*/10);
+  SortedSnapshotRecordReader reader(StreamFactory(snapshot));
+  auto metadata = reader.GetKVFileMetadata();
+  ASSERT_TRUE(metadata.ok()) << metadata.status();
+  EXPECT_TRUE(metadata->snapshot().has_key_index());
+  auto key_index = reader.GetKeyIndex();
+  ASSERT_TRUE(key_index.ok()) << key_index.status();
+  ASSERT_EQ((*key_index)->blocks_size(), 10);
+  int64_t prev_end_pos = 0;
+  for (int i = 0; i < 10; i++) {
+    const SnapshotKeyIndexBlock& block = (*key_index)->blocks(i);
+    EXPECT_EQ(block.first_key(), Key(i * 10));
+    EXPECT_EQ(block.last_key(), Key(i * 10 + 9));
+    EXPECT_GE(block.begin_pos(), prev_end_pos);
+    EXPECT_LT(block.begin_pos(), block.end_pos());
+    prev_end_pos = block.end_pos();
+  }
+  EXPECT_EQ((*key_index)->records_end_pos(), prev_end_pos);
+}
+
+TEST(SortedSnapshotRecordReaderTest, ReadsAllRecordsInKeyOrder) {
+  const std::string snapshot = WriteSnapshot(/*key_index_block_size=*/10);
+  SortedSnapshotRecordReader reader(StreamFactory(snapshot));
+  int num_other_records = 0;
+  EXPECT_THAT(ReadKeys(reader, &num_other_records),
+              ElementsAreArray(Keys(0, kNumKeys)));
+  EXPECT_EQ(num_other_records, 1);
+}
+
+TEST(SortedSnapshotRecordReaderTest, ReadsRecordsInKeyRange) {
+  const std::string snapshot = WriteSnapshot(/*key_index_block_size=*/10);
+  SortedSnapshotRecordReader reader(
+      StreamFactory(snapshot), {.begin_key = Key(15), .end_key = Key(42)});
+  int num_other_records = 0;
+  EXPECT_THAT(ReadKeys(reader, &num_other_records),
+              ElementsAreArray(Keys(15, 42)));
+  EXPECT_EQ(num_other_records, 0);
+}
+
+TEST(SortedSnapshotRecordReaderTest, ReadsRecordsFromBeginKey) {
+  const std::string snapshot = WriteSnapshot(/*key_index_block_size=*/7);
+  SortedSnapshotRecordReader reader(StreamFactory(snapshot),
+                                    {.begin_key = Key(90)});
+  EXPECT_THAT(ReadKeys(reader), ElementsAreArray(Keys(90, kNumKeys)));
+}
+
+TEST(SortedSnapshotRecordReaderTest, ContainsKey) {
+  const std::string snapshot = WriteSnapshot(/*key_index_block_size=*/10);
+  SortedSnapshotRecordReader reader(StreamFactory(snapshot));
+  for (int i = 0; i < kNumKeys; i++) {
+    auto contains = reader.ContainsKey(Key(i));
+    ASSERT_TRUE(contains.ok()) << contains.status();
+    EXPECT_TRUE(*contains) << Key(i);
+  }
+  for (std::string_view key : {"", "key", "key0005", "key100", "other"}) {
+    auto contains = reader.ContainsKey(key);
+    ASSERT_TRUE(contains.ok()) << contains.status();
+    EXPECT_FALSE(*contains) << key;
+  }
+}
+
+TEST(SortedSnapshotRecordReaderTest, FailsWithoutKeyIndex) {
+  const std::string snapshot = WriteSnapshot(/*key_index_block_size=*/0);
+  SortedSnapshotRecordReader reader(StreamFactory(snapshot));
+  EXPECT_EQ(reader.GetKeyIndex().status().code(),
+            absl::StatusCode::kFailedPrecondition);
+  EXPECT_FALSE(reader.ContainsKey(Key(0)).ok());
+}
+
+TEST(SortedSnapshotRecordReaderTest, ConcurrentReaderSkipsKeyIndex) {
+  kv_server::InitMetricsContextMap();
+  const std::string snapshot = WriteSnapshot(/*key_index_block_size=*/10);
+  ConcurrentStreamRecordReader<std::string_view> reader(
+      StreamFactory(snapshot), {.num_worker_threads = 2,
+                                .min_shard_size_bytes = 1});
+  absl::Mutex mutex;
+  std::vector<std::string> keys;
+  int num_other_records = 0;
+  auto status = reader.ReadStreamRecords([&](const std::string_view& record) {
+    absl::MutexLock lock(&mutex);
+    return DeserializeDataRecord(
+        record, [&](const DataRecordStruct& data_record) {
+          if (const auto* kv_record = std::get_if<KeyValueMutationRecordStruct>(
+                  &data_record.record)) {
+            keys.emplace_back(kv_record->key);
+          } else {
+            num_other_records++;
+          }
+          return absl::OkStatus();
+        });
+  });
+  EXPECT_TRUE(status.ok()) << status;
+  EXPECT_THAT(keys, UnorderedElementsAreArray(Keys(0, kNumKeys)));
+  EXPECT_EQ(num_other_records, 1);
+}
+
+}  // namespace
+}  // namespace kv_server
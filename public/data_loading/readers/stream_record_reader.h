@@ -17,8 +17,14 @@
 #ifndef PUBLIC_DATA_LOADING_READERS_STREAM_RECORD_READER_H_
 #define PUBLIC_DATA_LOADING_READERS_STREAM_RECORD_READER_H_
 
+#include <functional>
+#include <istream>
+#include <optional>
+#include <string_view>
+
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/types/span.h"
 #include "public/data_loading/riegeli_metadata.pb.h"
 
 namespace kv_server {
@@ -42,6 +48,18 @@ class StreamRecordReader {
   // reading and logs the error at the end.
   virtual absl::Status ReadStreamRecords(
       const std::function<absl::Status(const std::string_view&)>& callback) = 0;
+
+  // Same as `ReadStreamRecords`, but calls `callback` with batches of records,
+  // which are only valid during the call. Batches may be passed to `callback`
+  // from multiple threads at once. The default implementation passes one
+  // record per batch.
+  virtual absl::Status ReadStreamRecordBatches(
+      const std::function<absl::Status(absl::Span<const std::string_view>)>&
+          callback) {
+    return ReadStreamRecords([&callback](const std::string_view& record) {
+      return callback(absl::MakeConstSpan(&record, 1));
+    });
+  }
 };
 
 // Holds a stream of data.
@@ -49,6 +67,10 @@ class RecordStream {
  public:
   virtual ~RecordStream() = default;
   virtual std::istream& Stream() = 0;
+  // Returns the whole data if it is already in memory, e.g., in a
+  // memory-mapped file, so that readers can use it without copying it through
+  // `Stream()`. The view is valid for the lifetime of the stream.
+  virtual std::optional<std::string_view> Contents() { return std::nullopt; }
 };
 
 }  // namespace kv_server
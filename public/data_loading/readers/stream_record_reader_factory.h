@@ -18,6 +18,10 @@
 #define PUBLIC_DATA_LOADING_READERS_STREAM_RECORD_READER_FACTORY_H_
 
 #include <memory>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <utility>
 
 #include "public/data_loading/readers/stream_record_reader.h"
 #include "src/telemetry/telemetry_provider.h"
@@ -35,8 +39,51 @@ class StreamRecordReaderFactory {
 
   virtual std::unique_ptr<StreamRecordReader> CreateConcurrentReader(
       std::function<std::unique_ptr<RecordStream>()> stream_factory) const = 0;
+
+  // Creates a reader of `data`, which is already in memory and must outlive
+  // the reader. The default implementation reads a copy of `data` through
+  // `CreateReader`, factories that can read memory in place override it.
+  virtual std::unique_ptr<StreamRecordReader> CreateInMemoryReader(
+      std::string_view data) const;
 };
 
+namespace internal {
+
+// Reader of a stream that it owns, with a reader created for that stream.
+class StreamOwningRecordReader : public StreamRecordReader {
+ public:
+  StreamOwningRecordReader(std::string_view data,
+                           const StreamRecordReaderFactory& factory)
+      : stream_(std::string(data)), reader_(factory.CreateReader(stream_)) {}
+
+  absl::StatusOr<KVFileMetadata> GetKVFileMetadata() override {
+    return reader_->GetKVFileMetadata();
+  }
+
+  absl::Status ReadStreamRecords(
+      const std::function<absl::Status(const std::string_view&)>& callback)
+      override {
+    return reader_->ReadStreamRecords(callback);
+  }
+
+  absl::Status ReadStreamRecordBatches(
+      const std::function<absl::Status(absl::Span<const std::string_view>)>&
+          callback) override {
+    return reader_->ReadStreamRecordBatches(callback);
+  }
+
+ private:
+  std::istringstream stream_;
+  std::unique_ptr<StreamRecordReader> reader_;
+};
+
+}  // namespace internal
+
+inline std::unique_ptr<StreamRecordReader>
+StreamRecordReaderFactory::CreateInMemoryReader(std::string_view data) const {
+  return std::make_unique<internal::StreamOwningRecordReader>(data, *this);
+}
+
 }  // namespace kv_server
 
 #endif  // PUBLIC_DATA_LOADING_READERS_STREAM_RECORD_READER_FACTORY_H_
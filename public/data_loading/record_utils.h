@@ -17,6 +17,7 @@
 #ifndef PUBLIC_DATA_LOADING_RECORD_UTILS_H_
 #define PUBLIC_DATA_LOADING_RECORD_UTILS_H_
 
+#include <cstdint>
 #include <ostream>
 #include <string_view>
 #include <type_traits>
@@ -44,6 +45,20 @@ inline std::ostream& operator<<(std::ostream& os,
   }
   return os;
 }
+inline std::ostream& operator<<(std::ostream& os,
+                                const UInt32SetT& uint32_set_value) {
+  for (uint32_t value : uint32_set_value.value) {
+    os << value << ", ";
+  }
+  return os;
+}
+inline std::ostream& operator<<(std::ostream& os,
+                                const UInt64SetT& uint64_set_value) {
+  for (uint64_t value : uint64_set_value.value) {
+    os << value << ", ";
+  }
+  return os;
+}
 
 inline std::ostream& operator<<(std::ostream& os,
                                 const ValueUnion& value_union) {
@@ -56,6 +71,14 @@ inline std::ostream& operator<<(std::ostream& os,
       os << *(reinterpret_cast<const StringSetT*>(value_union.value));
       break;
     }
+    case Value::UInt32Set: {
+      os << *(reinterpret_cast<const UInt32SetT*>(value_union.value));
+      break;
+    }
+    case Value::UInt64Set: {
+      os << *(reinterpret_cast<const UInt64SetT*>(value_union.value));
+      break;
+    }
     case Value::NONE: {
       break;
     }
@@ -163,7 +186,8 @@ absl::Status DeserializeRecord(
 // be called after checking the type of the union value using
 // `record.value_type()` function.
 //
-// Only string and string_set have implementations. See below.
+// Only string, string_set and the numeric sets have implementations. See
+// below.
 template <typename ValueT>
 absl::StatusOr<ValueT> MaybeGetRecordValue(
     const KeyValueMutationRecord& record);
@@ -180,6 +204,15 @@ template <>
 absl::StatusOr<std::vector<std::string_view>> MaybeGetRecordValue(
     const KeyValueMutationRecord& record);
 
+// Returns the numbers stored in `record.value`. Returns error if the
+// record.value is not a set of numbers of that width.
+template <>
+absl::StatusOr<std::vector<uint32_t>> MaybeGetRecordValue(
+    const KeyValueMutationRecord& record);
+template <>
+absl::StatusOr<std::vector<uint64_t>> MaybeGetRecordValue(
+    const KeyValueMutationRecord& record);
+
 }  // namespace kv_server
 
 #endif  // PUBLIC_DATA_LOADING_RECORD_UTILS_H_
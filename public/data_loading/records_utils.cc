@@ -50,6 +50,18 @@ ValueUnion BuildValueUnion(const KeyValueMutationRecordValueT& value,
               .value = CreateStringSet(builder, values_offset).Union(),
           };
         }
+        if constexpr (std::is_same_v<VariantT, std::vector<uint32_t>>) {
+          return ValueUnion{
+              .value_type = Value::UInt32Set,
+              .value = CreateUInt32SetDirect(builder, &arg).Union(),
+          };
+        }
+        if constexpr (std::is_same_v<VariantT, std::vector<uint64_t>>) {
+          return ValueUnion{
+              .value_type = Value::UInt64Set,
+              .value = CreateUInt64SetDirect(builder, &arg).Union(),
+          };
+        }
         if constexpr (std::is_same_v<VariantT, std::monostate>) {
           return ValueUnion{
               .value_type = Value::NONE,
@@ -76,7 +88,12 @@ flatbuffers::Offset<UserDefinedFunctionsConfig> UdfConfigFromStruct(
       builder, udf_config_struct.language,
       udf_config_struct.code_snippet.data(),
       udf_config_struct.handler_name.data(),
-      udf_config_struct.logical_commit_time, udf_config_struct.version);
+      udf_config_struct.logical_commit_time, udf_config_struct.version,
+      udf_config_struct.input_format,
+      udf_config_struct.batch_handler_name.empty()
+          ? nullptr
+          : udf_config_struct.batch_handler_name.data(),
+      udf_config_struct.canary_percent);
 }
 
 flatbuffers::Offset<ShardMappingRecord> ShardMappingFromStruct(
@@ -148,6 +165,16 @@ absl::Status ValidateValue(const KeyValueMutationRecord& kv_mutation_record) {
        kv_mutation_record.value_as_StringSet()->value() == nullptr)) {
     return absl::InvalidArgumentError("StringSet value not set.");
   }
+  if (kv_mutation_record.value_type() == Value::UInt32Set &&
+      (kv_mutation_record.value_as_UInt32Set() == nullptr ||
+       kv_mutation_record.value_as_UInt32Set()->value() == nullptr)) {
+    return absl::InvalidArgumentError("UInt32Set value not set.");
+  }
+  if (kv_mutation_record.value_type() == Value::UInt64Set &&
+      (kv_mutation_record.value_as_UInt64Set() == nullptr ||
+       kv_mutation_record.value_as_UInt64Set()->value() == nullptr)) {
+    return absl::InvalidArgumentError("UInt64Set value not set.");
+  }
   return absl::OkStatus();
 }
 
@@ -170,6 +197,15 @@ absl::Status ValidateUserDefinedFunctionsConfig(
   return absl::OkStatus();
 }
 
+absl::Status ValidateCompressionDictionaryConfig(
+    const CompressionDictionaryConfig& dictionary_config) {
+  if (dictionary_config.dictionary() == nullptr ||
+      dictionary_config.dictionary()->size() == 0) {
+    return absl::InvalidArgumentError("dictionary not set.");
+  }
+  return absl::OkStatus();
+}
+
 absl::Status ValidateData(const DataRecord& data_record) {
   if (data_record.record() == nullptr) {
     return absl::InvalidArgumentError("Record not set.");
@@ -190,6 +226,14 @@ absl::Status ValidateData(const DataRecord& data_record) {
       return status;
     }
   }
+
+  if (data_record.record_type() == Record::CompressionDictionaryConfig) {
+    if (const auto status = ValidateCompressionDictionaryConfig(
+            *data_record.record_as_CompressionDictionaryConfig());
+        !status.ok()) {
+      return status;
+    }
+  }
   return absl::OkStatus();
 }
 
@@ -202,6 +246,12 @@ KeyValueMutationRecordValueT GetRecordStructValue(
   if (fbs_record.value_type() == Value::StringSet) {
     value = GetRecordValue<std::vector<std::string_view>>(fbs_record);
   }
+  if (fbs_record.value_type() == Value::UInt32Set) {
+    value = GetRecordValue<std::vector<uint32_t>>(fbs_record);
+  }
+  if (fbs_record.value_type() == Value::UInt64Set) {
+    value = GetRecordValue<std::vector<uint64_t>>(fbs_record);
+  }
   return value;
 }
 
@@ -241,7 +291,10 @@ bool operator==(const UserDefinedFunctionsConfigStruct& lhs_record,
          lhs_record.version == rhs_record.version &&
          lhs_record.handler_name == rhs_record.handler_name &&
          lhs_record.language == rhs_record.language &&
-         lhs_record.code_snippet == rhs_record.code_snippet;
+         lhs_record.code_snippet == rhs_record.code_snippet &&
+         lhs_record.input_format == rhs_record.input_format &&
+         lhs_record.batch_handler_name == rhs_record.batch_handler_name &&
+         lhs_record.canary_percent == rhs_record.canary_percent;
 }
 
 bool operator!=(const UserDefinedFunctionsConfigStruct& lhs_record,
@@ -324,6 +377,26 @@ absl::Status DeserializeDataRecord(
   return record_callback(**fbs_record);
 }
 
+absl::Status DeserializeTrustedDataRecord(
+    std::string_view record_bytes,
+    const std::function<absl::Status(const DataRecord&)>& record_callback) {
+  // The root offset must at least be within the record.
+  if (record_bytes.size() < sizeof(flatbuffers::uoffset_t) ||
+      flatbuffers::ReadScalar<flatbuffers::uoffset_t>(record_bytes.data()) >=
+          record_bytes.size()) {
+    LOG_FIRST_N(ERROR, 3) << "Record deserialization failed: "
+                          << "Invalid flatbuffer bytes.";
+    return absl::InvalidArgumentError("Invalid flatbuffer bytes.");
+  }
+  const auto* fbs_record =
+      flatbuffers::GetRoot<DataRecord>(record_bytes.data());
+  if (const auto status = ValidateData(*fbs_record); !status.ok()) {
+    LOG_FIRST_N(ERROR, 3) << "Data validation failed: " << status;
+    return status;
+  }
+  return record_callback(*fbs_record);
+}
+
 absl::Status DeserializeDataRecord(
     std::string_view record_bytes,
     const std::function<absl::Status(const DataRecordStruct&)>&
@@ -344,13 +417,27 @@ std::string_view GetRecordValue(const KeyValueMutationRecord& record) {
 template <>
 std::vector<std::string_view> GetRecordValue(
     const KeyValueMutationRecord& record) {
+  const auto& fbs_values = *record.value_as_StringSet()->value();
   std::vector<std::string_view> values;
-  for (const auto val : *record.value_as_StringSet()->value()) {
+  values.reserve(fbs_values.size());
+  for (const auto val : fbs_values) {
     values.push_back(val->string_view());
   }
   return values;
 }
 
+template <>
+std::vector<uint32_t> GetRecordValue(const KeyValueMutationRecord& record) {
+  const auto& fbs_values = *record.value_as_UInt32Set()->value();
+  return std::vector<uint32_t>(fbs_values.begin(), fbs_values.end());
+}
+
+template <>
+std::vector<uint64_t> GetRecordValue(const KeyValueMutationRecord& record) {
+  const auto& fbs_values = *record.value_as_UInt64Set()->value();
+  return std::vector<uint64_t>(fbs_values.begin(), fbs_values.end());
+}
+
 template <>
 KeyValueMutationRecordStruct GetTypedRecordStruct(
     const DataRecord& data_record) {
@@ -375,6 +462,12 @@ UserDefinedFunctionsConfigStruct GetTypedRecordStruct(
   udf_config_struct.code_snippet = udf_config->code_snippet()->string_view();
   udf_config_struct.handler_name = udf_config->handler_name()->string_view();
   udf_config_struct.version = udf_config->version();
+  udf_config_struct.input_format = udf_config->input_format();
+  if (udf_config->batch_handler_name() != nullptr) {
+    udf_config_struct.batch_handler_name =
+        udf_config->batch_handler_name()->string_view();
+  }
+  udf_config_struct.canary_percent = udf_config->canary_percent();
   return udf_config_struct;
 }
 
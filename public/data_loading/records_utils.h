@@ -17,6 +17,7 @@
 #ifndef PUBLIC_DATA_LOADING_RECORDS_UTILS_H_
 #define PUBLIC_DATA_LOADING_RECORDS_UTILS_H_
 
+#include <cstdint>
 #include <string>
 #include <string_view>
 #include <utility>
@@ -38,7 +39,8 @@ enum class DataRecordType : int {
 
 using KeyValueMutationRecordValueT =
     std::variant<std::monostate, std::string_view,
-                 std::vector<std::string_view>>;
+                 std::vector<std::string_view>, std::vector<uint32_t>,
+                 std::vector<uint64_t>>;
 
 struct KeyValueMutationRecordStruct {
   KeyValueMutationType mutation_type;
@@ -53,6 +55,10 @@ struct UserDefinedFunctionsConfigStruct {
   std::string_view handler_name;
   int64_t logical_commit_time;
   int64_t version;
+  UserDefinedFunctionsInputFormat input_format =
+      UserDefinedFunctionsInputFormat::Json;
+  std::string_view batch_handler_name;
+  int32_t canary_percent = 0;
 };
 
 struct ShardMappingRecordStruct {
@@ -121,6 +127,14 @@ absl::Status DeserializeDataRecord(
     std::string_view record_bytes,
     const std::function<absl::Status(const DataRecord&)>& record_callback);
 
+// Same as `DeserializeDataRecord`, but without verifying the flatbuffer, which
+// walks the whole record, only that the fields read are set. Only for records
+// of trusted files whose integrity is already checked, e.g. by the chunk
+// hashes of Riegeli files, as malformed records may be read out of bounds.
+absl::Status DeserializeTrustedDataRecord(
+    std::string_view record_bytes,
+    const std::function<absl::Status(const DataRecord&)>& record_callback);
+
 // Deserializes "data_loading.fbs:DataRecord" raw flatbuffer record
 // bytes and calls `record_callback` with the resulting
 // `DataRecordStruct` object.
@@ -141,6 +155,10 @@ std::string_view GetRecordValue(const KeyValueMutationRecord& record);
 template <>
 std::vector<std::string_view> GetRecordValue(
     const KeyValueMutationRecord& record);
+template <>
+std::vector<uint32_t> GetRecordValue(const KeyValueMutationRecord& record);
+template <>
+std::vector<uint64_t> GetRecordValue(const KeyValueMutationRecord& record);
 
 // Utility function to get the union record set on the `data_record`. Must
 // be called after checking the type of the union record using
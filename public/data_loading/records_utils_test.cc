@@ -421,6 +421,29 @@ TEST(DataRecordTest,
   EXPECT_TRUE(status.ok()) << status;
 }
 
+TEST(DataRecordTest,
+     DeserializeDataRecord_ToStruct_KVMutation_NumericSetValues_Success) {
+  std::vector<KeyValueMutationRecordValueT> values = {
+      std::vector<uint32_t>{1, 4294967295},
+      std::vector<uint64_t>{1, 18446744073709551615u},
+  };
+  for (const auto& value : values) {
+    auto data_record_struct = GetDataRecord(GetKeyValueMutationRecord(value));
+    testing::MockFunction<absl::Status(const DataRecordStruct&)>
+        record_callback;
+    EXPECT_CALL(record_callback, Call)
+        .WillOnce(
+            [&data_record_struct](const DataRecordStruct& actual_record) {
+              EXPECT_EQ(data_record_struct, actual_record);
+              return absl::OkStatus();
+            });
+    auto status = DeserializeDataRecord(
+        ToStringView(ToFlatBufferBuilder(data_record_struct)),
+        record_callback.AsStdFunction());
+    EXPECT_TRUE(status.ok()) << status;
+  }
+}
+
 TEST(DataRecordTest, DeserializeDataRecord_ToStruct_UdfConfig_Success) {
   auto data_record_struct = GetDataRecord(GetUdfConfigStruct());
   testing::MockFunction<absl::Status(const DataRecordStruct&)> record_callback;
@@ -435,6 +458,54 @@ TEST(DataRecordTest, DeserializeDataRecord_ToStruct_UdfConfig_Success) {
   EXPECT_TRUE(status.ok()) << status;
 }
 
+TEST(DataRecordTest, DeserializeDataRecord_ToStruct_UdfConfigInputFormat) {
+  UserDefinedFunctionsConfigStruct udf_config_struct = GetUdfConfigStruct();
+  udf_config_struct.input_format = UserDefinedFunctionsInputFormat::Protobuf;
+  auto data_record_struct = GetDataRecord(udf_config_struct);
+  testing::MockFunction<absl::Status(const DataRecordStruct&)> record_callback;
+  EXPECT_CALL(record_callback, Call)
+      .WillOnce([&data_record_struct](const DataRecordStruct& actual_record) {
+        EXPECT_EQ(data_record_struct, actual_record);
+        return absl::OkStatus();
+      });
+  auto status = DeserializeDataRecord(
+      ToStringView(ToFlatBufferBuilder(data_record_struct)),
+      record_callback.AsStdFunction());
+  EXPECT_TRUE(status.ok()) << status;
+}
+
+TEST(DataRecordTest, DeserializeDataRecord_ToStruct_UdfConfigBatchHandler) {
+  UserDefinedFunctionsConfigStruct udf_config_struct = GetUdfConfigStruct();
+  udf_config_struct.batch_handler_name = "HandleBatch";
+  auto data_record_struct = GetDataRecord(udf_config_struct);
+  testing::MockFunction<absl::Status(const DataRecordStruct&)> record_callback;
+  EXPECT_CALL(record_callback, Call)
+      .WillOnce([&data_record_struct](const DataRecordStruct& actual_record) {
+        EXPECT_EQ(data_record_struct, actual_record);
+        return absl::OkStatus();
+      });
+  auto status = DeserializeDataRecord(
+      ToStringView(ToFlatBufferBuilder(data_record_struct)),
+      record_callback.AsStdFunction());
+  EXPECT_TRUE(status.ok()) << status;
+}
+
+TEST(DataRecordTest, DeserializeDataRecord_ToStruct_UdfConfigCanary) {
+  UserDefinedFunctionsConfigStruct udf_config_struct = GetUdfConfigStruct();
+  udf_config_struct.canary_percent = 5;
+  auto data_record_struct = GetDataRecord(udf_config_struct);
+  testing::MockFunction<absl::Status(const DataRecordStruct&)> record_callback;
+  EXPECT_CALL(record_callback, Call)
+      .WillOnce([&data_record_struct](const DataRecordStruct& actual_record) {
+        EXPECT_EQ(data_record_struct, actual_record);
+        return absl::OkStatus();
+      });
+  auto status = DeserializeDataRecord(
+      ToStringView(ToFlatBufferBuilder(data_record_struct)),
+      record_callback.AsStdFunction());
+  EXPECT_TRUE(status.ok()) << status;
+}
+
 TEST(DataRecordTest, DeserializeDataRecord_ToFbsRecord_ShardMapping_Success) {
   auto data_record_struct = GetDataRecord(
       ShardMappingRecordStruct{.logical_shard = 0, .physical_shard = 0});
@@ -465,5 +536,45 @@ TEST(DataRecordTest, DeserializeDataRecord_ToStruct_ShardMapping_Success) {
   EXPECT_TRUE(status.ok()) << status;
 }
 
+TEST(DataRecordTest, DeserializeTrustedDataRecord_StringVectorValue_Success) {
+  std::vector<std::string_view> values({"value1", "value2"});
+  auto data_record_struct = GetDataRecord(GetKeyValueMutationRecord(values));
+  testing::MockFunction<absl::Status(const DataRecord&)> record_callback;
+  EXPECT_CALL(record_callback, Call)
+      .WillOnce([&data_record_struct](const DataRecord& data_record_fbs) {
+        ExpectEqual(data_record_struct, data_record_fbs);
+        return absl::OkStatus();
+      });
+  auto status = DeserializeTrustedDataRecord(
+      ToStringView(ToFlatBufferBuilder(data_record_struct)),
+      record_callback.AsStdFunction());
+  EXPECT_TRUE(status.ok()) << status;
+}
+
+TEST(DataRecordTest, DeserializeTrustedDataRecord_EmptyRecord_Failure) {
+  flatbuffers::FlatBufferBuilder builder;
+  const auto data_record_fbs = CreateDataRecord(builder);
+  builder.Finish(data_record_fbs);
+
+  testing::MockFunction<absl::Status(const DataRecord&)> record_callback;
+  EXPECT_CALL(record_callback, Call).Times(0);
+  auto status = DeserializeTrustedDataRecord(ToStringView(builder),
+                                             record_callback.AsStdFunction());
+  EXPECT_FALSE(status.ok()) << status;
+  EXPECT_EQ(status.message(), "Record not set.");
+}
+
+TEST(DataRecordTest, DeserializeTrustedDataRecord_TruncatedRecord_Failure) {
+  testing::MockFunction<absl::Status(const DataRecord&)> record_callback;
+  EXPECT_CALL(record_callback, Call).Times(0);
+  EXPECT_FALSE(
+      DeserializeTrustedDataRecord("", record_callback.AsStdFunction()).ok());
+  // The root offset points past the record.
+  EXPECT_FALSE(DeserializeTrustedDataRecord(
+                   std::string_view("\xff\0\0\0", 4),
+                   record_callback.AsStdFunction())
+                   .ok());
+}
+
 }  // namespace
 }  // namespace kv_server
@@ -0,0 +1,126 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "public/data_loading/snapshot_key_index.h"
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+
+namespace kv_server {
+namespace {
+
+// More probes per key cost more than they save in false positives.
+constexpr uint32_t kMaxNumHashes = 16;
+
+// FNV-1a, followed by the finalizer of SplitMix64 to spread the bits. It is
+// the same in every process, unlike `absl::Hash`, since the filters are
+// written to snapshots.
+uint64_t Hash(std::string_view key) {
+  uint64_t hash = 0xcbf29ce484222325;
+  for (const unsigned char c : key) {
+    hash = (hash ^ c) * 0x100000001b3;
+  }
+  hash = (hash ^ (hash >> 30)) * 0xbf58476d1ce4e5b9;
+  hash = (hash ^ (hash >> 27)) * 0x94d049bb133111eb;
+  return hash ^ (hash >> 31);
+}
+
+// Calls `f` with the `num_hashes` bit positions of `key`, by double hashing.
+// `num_bits` must be positive.
+template <typename F>
+void ForEachBit(std::string_view key, uint32_t num_hashes, uint64_t num_bits,
+                F f) {
+  uint64_t hash = Hash(key);
+  const uint64_t delta = (hash >> 33) | (hash << 31) | 1;
+  for (uint32_t i = 0; i < num_hashes; i++) {
+    f(hash % num_bits);
+    hash += delta;
+  }
+}
+
+}  // namespace
+
+void AddSnapshotKeyIndexBlock(absl::Span<const std::string_view> sorted_keys,
+                              int64_t begin_pos, int64_t end_pos,
+                              SnapshotKeyIndex& index) {
+  if (!index.has_bloom_filter_num_hashes()) {
+    // ln(2) bits per key set per key minimize the false positives.
+    index.set_bloom_filter_num_hashes(std::clamp<uint32_t>(
+        static_cast<uint32_t>(std::lround(kSnapshotKeyIndexBitsPerKey * 0.69)),
+        1, kMaxNumHashes));
+  }
+  SnapshotKeyIndexBlock& block = *index.add_blocks();
+  block.set_begin_pos(begin_pos);
+  block.set_end_pos(end_pos);
+  if (sorted_keys.empty()) {
+    return;
+  }
+  block.set_first_key(std::string(sorted_keys.front()));
+  block.set_last_key(std::string(sorted_keys.back()));
+  std::string& bits = *block.mutable_bloom_filter();
+  bits.assign(
+      std::max<uint64_t>(
+          8, (sorted_keys.size() * kSnapshotKeyIndexBitsPerKey + 7) / 8),
+      '\0');
+  for (std::string_view key : sorted_keys) {
+    ForEachBit(key, index.bloom_filter_num_hashes(), bits.size() * 8,
+               [&bits](uint64_t bit) {
+                 bits[bit / 8] |= static_cast<char>(1 << (bit % 8));
+               });
+  }
+}
+
+bool SnapshotKeyIndexBlockMayContain(const SnapshotKeyIndex& index,
+                                     const SnapshotKeyIndexBlock& block,
+                                     std::string_view key) {
+  if (key < block.first_key() || key > block.last_key()) {
+    return false;
+  }
+  const std::string& bits = block.bloom_filter();
+  if (bits.empty() || index.bloom_filter_num_hashes() == 0) {
+    // Blocks without a filter may hold any key of their range.
+    return true;
+  }
+  bool may_contain = true;
+  ForEachBit(key,
+             std::min(index.bloom_filter_num_hashes(), kMaxNumHashes),
+             bits.size() * 8, [&bits, &may_contain](uint64_t bit) {
+               may_contain &= ((bits[bit / 8] >> (bit % 8)) & 1) != 0;
+             });
+  return may_contain;
+}
+
+std::vector<int> FindSnapshotKeyIndexBlocks(const SnapshotKeyIndex& index,
+                                            std::string_view begin_key,
+                                            std::string_view end_key) {
+  const auto& blocks = index.blocks();
+  // Blocks are sorted by key, so the first block that may hold `begin_key`
+  // is the first one whose last key is not before it.
+  auto it = std::partition_point(
+      blocks.begin(), blocks.end(),
+      [begin_key](const SnapshotKeyIndexBlock& block) {
+        return block.last_key() < begin_key;
+      });
+  std::vector<int> block_indexes;
+  for (; it != blocks.end(); ++it) {
+    if (!end_key.empty() && it->first_key() >= end_key) {
+      break;
+    }
+    block_indexes.push_back(it - blocks.begin());
+  }
+  return block_indexes;
+}
+
+}  // namespace kv_server
@@ -0,0 +1,50 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PUBLIC_DATA_LOADING_SNAPSHOT_KEY_INDEX_H_
+#define PUBLIC_DATA_LOADING_SNAPSHOT_KEY_INDEX_H_
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "absl/types/span.h"
+#include "public/data_loading/riegeli_metadata.pb.h"
+
+namespace kv_server {
+
+// Bits of the Bloom filter of a block per key, for about 1% false positives.
+inline constexpr int32_t kSnapshotKeyIndexBitsPerKey = 10;
+
+// Appends the block of the records with `sorted_keys`, written at positions
+// [`begin_pos`, `end_pos`), to `index`. Blocks must be added in key order.
+void AddSnapshotKeyIndexBlock(absl::Span<const std::string_view> sorted_keys,
+                              int64_t begin_pos, int64_t end_pos,
+                              SnapshotKeyIndex& index);
+
+// Returns whether the block may hold a record of `key`, false for most keys
+// it does not hold.
+bool SnapshotKeyIndexBlockMayContain(const SnapshotKeyIndex& index,
+                                     const SnapshotKeyIndexBlock& block,
+                                     std::string_view key);
+
+// Returns the indexes of the blocks with keys in [`begin_key`, `end_key`), or
+// from `begin_key` on if `end_key` is empty.
+std::vector<int> FindSnapshotKeyIndexBlocks(const SnapshotKeyIndex& index,
+                                            std::string_view begin_key,
+                                            std::string_view end_key);
+
+}  // namespace kv_server
+
+#endif  // PUBLIC_DATA_LOADING_SNAPSHOT_KEY_INDEX_H_
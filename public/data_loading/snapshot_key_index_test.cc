@@ -0,0 +1,114 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "public/data_loading/snapshot_key_index.h"
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "absl/strings/str_format.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace kv_server {
+namespace {
+
+using testing::ElementsAre;
+using testing::IsEmpty;
+
+// Returns the sorted keys "key<begin>" to "key<end - 1>", zero padded.
+std::vector<std::string> SortedKeys(int begin, int end) {
+  std::vector<std::string> keys;
+  for (int i = begin; i < end; i++) {
+    keys.push_back(absl::StrFormat("key%05d", i));
+  }
+  return keys;
+}
+
+void AddBlock(const std::vector<std::string>& keys, int64_t begin_pos,
+              int64_t end_pos, SnapshotKeyIndex& index) {
+  std::vector<std::string_view> key_views(keys.begin(), keys.end());
+  AddSnapshotKeyIndexBlock(key_views, begin_pos, end_pos, index);
+}
+
+TEST(SnapshotKeyIndexTest, AddsBlocksWithKeyRanges) {
+  SnapshotKeyIndex index;
+  AddBlock(SortedKeys(0, 10), 100, 200, index);
+  AddBlock(SortedKeys(10, 20), 200, 300, index);
+  ASSERT_EQ(index.blocks_size(), 2);
+  EXPECT_GT(index.bloom_filter_num_hashes(), 0);
+  EXPECT_EQ(index.blocks(0).first_key(), "key00000");
+  EXPECT_EQ(index.blocks(0).last_key(), "key00009");
+  EXPECT_EQ(index.blocks(0).begin_pos(), 100);
+  EXPECT_EQ(index.blocks(0).end_pos(), 200);
+  EXPECT_EQ(index.blocks(1).first_key(), "key00010");
+  EXPECT_EQ(index.blocks(1).last_key(), "key00019");
+}
+
+TEST(SnapshotKeyIndexTest, BlockMayContainAllItsKeys) {
+  SnapshotKeyIndex index;
+  const std::vector<std::string> keys = SortedKeys(0, 10'000);
+  AddBlock(keys, 0, 1, index);
+  for (const std::string& key : keys) {
+    EXPECT_TRUE(
+        SnapshotKeyIndexBlockMayContain(index, index.blocks(0), key))
+        << key;
+  }
+}
+
+TEST(SnapshotKeyIndexTest, BlockRejectsMostOtherKeys) {
+  SnapshotKeyIndex index;
+  std::vector<std::string> keys;
+  for (int i = 0; i < 10'000; i += 2) {
+    keys.push_back(absl::StrFormat("key%05d", i));
+  }
+  AddBlock(keys, 0, 1, index);
+  int false_positives = 0;
+  for (int i = 1; i < 10'000; i += 2) {
+    false_positives += SnapshotKeyIndexBlockMayContain(
+        index, index.blocks(0), absl::StrFormat("key%05d", i));
+  }
+  EXPECT_LT(false_positives, 150);
+}
+
+TEST(SnapshotKeyIndexTest, BlockRejectsKeysOutsideItsRange) {
+  SnapshotKeyIndex index;
+  AddBlock(SortedKeys(10, 20), 0, 1, index);
+  EXPECT_FALSE(
+      SnapshotKeyIndexBlockMayContain(index, index.blocks(0), "key00009"));
+  EXPECT_FALSE(
+      SnapshotKeyIndexBlockMayContain(index, index.blocks(0), "key00020"));
+  EXPECT_FALSE(SnapshotKeyIndexBlockMayContain(index, index.blocks(0), ""));
+}
+
+TEST(SnapshotKeyIndexTest, FindsBlocksInKeyRange) {
+  SnapshotKeyIndex index;
+  AddBlock(SortedKeys(0, 10), 0, 1, index);
+  AddBlock(SortedKeys(10, 20), 1, 2, index);
+  AddBlock(SortedKeys(20, 30), 2, 3, index);
+  EXPECT_THAT(FindSnapshotKeyIndexBlocks(index, "", ""),
+              ElementsAre(0, 1, 2));
+  EXPECT_THAT(FindSnapshotKeyIndexBlocks(index, "key00005", "key00015"),
+              ElementsAre(0, 1));
+  EXPECT_THAT(FindSnapshotKeyIndexBlocks(index, "key00010", "key00020"),
+              ElementsAre(1));
+  EXPECT_THAT(FindSnapshotKeyIndexBlocks(index, "key00019", ""),
+              ElementsAre(1, 2));
+  EXPECT_THAT(FindSnapshotKeyIndexBlocks(index, "key00030", ""), IsEmpty());
+  EXPECT_THAT(FindSnapshotKeyIndexBlocks(index, "", "key00000"), IsEmpty());
+}
+
+}  // namespace
+}  // namespace kv_server
@@ -15,21 +15,10 @@
 #include "public/data_loading/writers/delta_record_limiting_file_writer.h"
 
 #include "absl/log/log.h"
+#include "public/data_loading/writers/delta_record_stream_writer.h"
 
 namespace kv_server {
 
-riegeli::RecordWriterBase::Options GetRecordWriterOptions(
-    const DeltaRecordWriter::Options& options) {
-  riegeli::RecordWriterBase::Options writer_options;
-  if (!options.enable_compression) {
-    writer_options.set_uncompressed();
-  }
-  riegeli::RecordsMetadata metadata;
-  *metadata.MutableExtension(kv_server::kv_file_metadata) = options.metadata;
-  writer_options.set_metadata(std::move(metadata));
-  return writer_options;
-}
-
 riegeli::LimitingWriterBase::Options GetLimitingWriterOptions(
     int max_file_size_bytes) {
   riegeli::LimitingWriterBase::Options limiting_options;
@@ -55,6 +44,10 @@ DeltaRecordLimitingFileWriter::DeltaRecordLimitingFileWriter(
 absl::StatusOr<std::unique_ptr<DeltaRecordLimitingFileWriter>>
 DeltaRecordLimitingFileWriter::Create(std::string file_name, Options options,
                                       int64_t max_file_size_bytes) {
+  if (absl::Status status = ValidateRecordWriterOptions(options);
+      !status.ok()) {
+    return status;
+  }
   return absl::WrapUnique(new DeltaRecordLimitingFileWriter(
       file_name, options, max_file_size_bytes));
 }
@@ -14,15 +14,82 @@
 
 #include "public/data_loading/writers/delta_record_stream_writer.h"
 
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
 #include "riegeli/bytes/ostream_writer.h"
 #include "riegeli/records/record_writer.h"
 
 namespace kv_server {
+namespace {
+constexpr int kMinBrotliLevel = 0;
+constexpr int kMaxBrotliLevel = 11;
+constexpr int kMinZstdLevel = -131072;
+constexpr int kMaxZstdLevel = 22;
+}  // namespace
+
+absl::Status ValidateRecordWriterOptions(
+    const DeltaRecordWriter::Options& options) {
+  if (options.parallelism < 0) {
+    return absl::InvalidArgumentError(absl::StrCat(
+        "Parallelism must not be negative, got ", options.parallelism));
+  }
+  if (!options.enable_compression || !options.compression_level.has_value()) {
+    return absl::OkStatus();
+  }
+  const int level = *options.compression_level;
+  switch (options.compression) {
+    case DeltaRecordWriter::Compression::kBrotli:
+      if (level < kMinBrotliLevel || level > kMaxBrotliLevel) {
+        return absl::InvalidArgumentError(absl::StrFormat(
+            "Brotli compression level %d is not in [%d, %d].", level,
+            kMinBrotliLevel, kMaxBrotliLevel));
+      }
+      return absl::OkStatus();
+    case DeltaRecordWriter::Compression::kZstd:
+      if (level < kMinZstdLevel || level > kMaxZstdLevel) {
+        return absl::InvalidArgumentError(
+            absl::StrFormat("Zstd compression level %d is not in [%d, %d].",
+                            level, kMinZstdLevel, kMaxZstdLevel));
+      }
+      return absl::OkStatus();
+    case DeltaRecordWriter::Compression::kSnappy:
+      return absl::InvalidArgumentError(
+          "Snappy compression does not have levels.");
+  }
+  return absl::InvalidArgumentError("Unknown compression.");
+}
+
 riegeli::RecordWriterBase::Options GetRecordWriterOptions(
     const DeltaRecordWriter::Options& options) {
   riegeli::RecordWriterBase::Options writer_options;
   if (!options.enable_compression) {
     writer_options.set_uncompressed();
+  } else {
+    switch (options.compression) {
+      case DeltaRecordWriter::Compression::kBrotli:
+        if (options.compression_level.has_value()) {
+          writer_options.set_brotli(*options.compression_level);
+        } else {
+          writer_options.set_brotli();
+        }
+        break;
+      case DeltaRecordWriter::Compression::kZstd:
+        if (options.compression_level.has_value()) {
+          writer_options.set_zstd(*options.compression_level);
+        } else {
+          writer_options.set_zstd();
+        }
+        break;
+      case DeltaRecordWriter::Compression::kSnappy:
+        writer_options.set_snappy();
+        break;
+    }
+  }
+  if (options.chunk_size_bytes > 0) {
+    writer_options.set_chunk_size(options.chunk_size_bytes);
+  }
+  if (options.parallelism > 0) {
+    writer_options.set_parallelism(options.parallelism);
   }
   riegeli::RecordsMetadata metadata;
   *metadata.MutableExtension(kv_server::kv_file_metadata) = options.metadata;
@@ -18,6 +18,7 @@
 #define PUBLIC_DATA_LOADING_WRITERS_DELTA_RECORD_STREAM_WRITER_H_
 
 #include <memory>
+#include <string_view>
 #include <utility>
 #include <vector>
 
@@ -42,6 +43,10 @@ class DeltaRecordStreamWriter : public DeltaRecordWriter {
   static absl::StatusOr<std::unique_ptr<DeltaRecordStreamWriter>> Create(
       DestStreamT& dest_stream, Options options);
   absl::Status WriteRecord(const DataRecordStruct& data_record) override;
+  // Writes `serialized_record` without re-encoding it, so it must already be
+  // a verified `DataRecord` flatbuffer.
+  absl::Status WriteSerializedRecord(
+      std::string_view serialized_record) override;
   const Options& GetOptions() const override { return options_; }
   absl::Status Flush() override;
   void Close() override { record_writer_->Close(); }
@@ -56,6 +61,11 @@ class DeltaRecordStreamWriter : public DeltaRecordWriter {
       record_writer_;
 };
 
+// Returns an error if `options` cannot be translated to riegeli options, e.g.,
+// if the compression level is out of range.
+absl::Status ValidateRecordWriterOptions(
+    const DeltaRecordWriter::Options& options);
+
 riegeli::RecordWriterBase::Options GetRecordWriterOptions(
     const DeltaRecordWriter::Options& options);
 
@@ -73,7 +83,12 @@ template <typename DestStreamT>
 absl::StatusOr<std::unique_ptr<DeltaRecordStreamWriter<DestStreamT>>>
 DeltaRecordStreamWriter<DestStreamT>::Create(DestStreamT& dest_stream,
                                              Options options) {
-  return absl::WrapUnique(new DeltaRecordStreamWriter(dest_stream, options));
+  if (absl::Status status = ValidateRecordWriterOptions(options);
+      !status.ok()) {
+    return status;
+  }
+  return absl::WrapUnique(
+      new DeltaRecordStreamWriter(dest_stream, std::move(options)));
 }
 
 template <typename DestStreamT>
@@ -87,6 +102,20 @@ absl::Status DeltaRecordStreamWriter<DestStreamT>::WriteRecord(
   return record_writer_->status();
 }
 
+template <typename DestStreamT>
+absl::Status DeltaRecordStreamWriter<DestStreamT>::WriteSerializedRecord(
+    std::string_view serialized_record) {
+  if (!record_writer_->WriteRecord(serialized_record) &&
+      options_.recovery_function) {
+    auto ignored = DeserializeDataRecord(
+        serialized_record, [this](const DataRecordStruct& data_record) {
+          options_.recovery_function(data_record);
+          return absl::OkStatus();
+        });
+  }
+  return record_writer_->status();
+}
+
 template <typename DestStreamT>
 absl::Status DeltaRecordStreamWriter<DestStreamT>::Flush() {
   if (!record_writer_->Flush()) {
@@ -0,0 +1,80 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "benchmark/benchmark.h"
+#include "public/data_loading/writers/delta_record_stream_writer.h"
+
+using kv_server::DataRecordStruct;
+using kv_server::DeltaRecordStreamWriter;
+using kv_server::DeltaRecordWriter;
+using kv_server::KeyValueMutationRecordStruct;
+using kv_server::KeyValueMutationType;
+
+static constexpr int64_t kNumRecords = 100'000;
+// Compression used by the benchmarks, uncompressed if negative.
+static constexpr int kUncompressed = -1;
+
+static void BM_DeltaRecordStreamWriter_WriteRecords(benchmark::State& state) {
+  const int compression = state.range(0);
+  DeltaRecordWriter::Options options{
+      .enable_compression = compression != kUncompressed,
+      .compression = compression == kUncompressed
+                         ? DeltaRecordWriter::Compression::kBrotli
+                         : static_cast<DeltaRecordWriter::Compression>(
+                               compression),
+      .parallelism = static_cast<int>(state.range(1))};
+  std::vector<std::string> keys;
+  keys.reserve(kNumRecords);
+  for (int64_t i = 0; i < kNumRecords; ++i) {
+    keys.push_back(absl::StrCat("key", i));
+  }
+  const std::string value(256, 'A');
+  int64_t bytes_written = 0;
+  for (auto _ : state) {
+    std::ostringstream delta_stream;
+    auto record_writer =
+        DeltaRecordStreamWriter<std::ostringstream>::Create(delta_stream,
+                                                            options);
+    for (const auto& key : keys) {
+      auto ignored = (*record_writer)
+                         ->WriteRecord(DataRecordStruct{
+                             .record = KeyValueMutationRecordStruct{
+                                 .mutation_type = KeyValueMutationType::Update,
+                                 .logical_commit_time = 1234567890,
+                                 .key = key,
+                                 .value = std::string_view(value)}});
+    }
+    (*record_writer)->Close();
+    bytes_written = delta_stream.tellp();
+  }
+  state.SetItemsProcessed(kNumRecords * state.iterations());
+  state.counters["bytes_written"] = bytes_written;
+}
+
+BENCHMARK(BM_DeltaRecordStreamWriter_WriteRecords)
+    ->ArgNames({"compression", "parallelism"})
+    ->ArgsProduct({{kUncompressed,
+                    static_cast<int>(DeltaRecordWriter::Compression::kBrotli),
+                    static_cast<int>(DeltaRecordWriter::Compression::kZstd),
+                    static_cast<int>(DeltaRecordWriter::Compression::kSnappy)},
+                   {0, 2, 4, 8}})
+    ->UseRealTime();
+
+BENCHMARK_MAIN();
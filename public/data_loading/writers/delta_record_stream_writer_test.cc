@@ -84,7 +84,19 @@ INSTANTIATE_TEST_SUITE_P(
     testing::Values(DeltaRecordWriter::Options{.enable_compression = false,
                                                .metadata = GetMetadata()},
                     DeltaRecordWriter::Options{.enable_compression = true,
-                                               .metadata = GetMetadata()}));
+                                               .metadata = GetMetadata()},
+                    DeltaRecordWriter::Options{
+                        .enable_compression = true,
+                        .metadata = GetMetadata(),
+                        .compression = DeltaRecordWriter::Compression::kZstd,
+                        .compression_level = 1,
+                        .chunk_size_bytes = 1024,
+                        .parallelism = 4},
+                    DeltaRecordWriter::Options{
+                        .enable_compression = true,
+                        .metadata = GetMetadata(),
+                        .compression = DeltaRecordWriter::Compression::kSnappy,
+                        .parallelism = 2}));
 
 TEST_P(DeltaRecordStreamWriterTest,
        ValidateWritingAndReadingWithKVMutationDeltaStream) {
@@ -120,6 +132,32 @@ TEST_P(DeltaRecordStreamWriterTest,
           .ok());
 }
 
+TEST_P(DeltaRecordStreamWriterTest, WritesSerializedRecordsAsIs) {
+  std::stringstream string_stream;
+  auto record_writer = CreateDeltaRecordStreamWriter(string_stream);
+  EXPECT_TRUE(record_writer.ok());
+
+  KeyValueMutationRecordStruct expected_kv = GetKeyValueMutationRecord();
+  const auto fbs_builder = ToFlatBufferBuilder(GetDataRecord(expected_kv));
+  const std::string_view serialized_record(
+      reinterpret_cast<const char*>(fbs_builder.GetBufferPointer()),
+      fbs_builder.GetSize());
+  EXPECT_TRUE((*record_writer)->WriteSerializedRecord(serialized_record).ok());
+  (*record_writer)->Close();
+  auto stream_reader_factory =
+      std::make_unique<RiegeliStreamRecordReaderFactory>();
+  auto stream_reader = stream_reader_factory->CreateReader(string_stream);
+  int num_records = 0;
+  EXPECT_TRUE(stream_reader
+                  ->ReadStreamRecords([&](std::string_view record_string) {
+                    num_records++;
+                    EXPECT_EQ(record_string, serialized_record);
+                    return absl::OkStatus();
+                  })
+                  .ok());
+  EXPECT_EQ(num_records, 1);
+}
+
 TEST_P(DeltaRecordStreamWriterTest,
        ValidateWritingAndReadingWithUdfConfigDeltaStream) {
   std::stringstream string_stream;
@@ -197,5 +235,18 @@ TEST(DeltaRecordStreamWriterTest, ValidateWritingFailsAfterClose) {
   EXPECT_FALSE(status.ok());
 }
 
+TEST(DeltaRecordStreamWriterTest, ValidateInvalidCompressionLevelFails) {
+  std::stringstream string_stream;
+  auto record_writer = DeltaRecordStreamWriter<std::stringstream>::Create(
+      string_stream,
+      DeltaRecordWriter::Options{
+          .enable_compression = true,
+          .metadata = GetMetadata(),
+          .compression = DeltaRecordWriter::Compression::kBrotli,
+          .compression_level = 12});
+  EXPECT_EQ(record_writer.status().code(), absl::StatusCode::kInvalidArgument)
+      << record_writer.status();
+}
+
 }  // namespace
 }  // namespace kv_server
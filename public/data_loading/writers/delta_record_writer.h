@@ -18,6 +18,8 @@
 #define PUBLIC_DATA_LOADING_WRITERS_DELTA_RECORD_WRITER_H_
 
 #include <functional>
+#include <optional>
+#include <string_view>
 #include <vector>
 
 #include "absl/status/status.h"
@@ -46,6 +48,9 @@ namespace kv_server {
 // ```
 class DeltaRecordWriter {
  public:
+  // Compression algorithms for delta files, see `riegeli::CompressorOptions`.
+  enum class Compression { kBrotli, kZstd, kSnappy };
+
   // Options for writing delta files.
   struct Options {
     // If true, record compression will be enabled.
@@ -56,12 +61,34 @@ class DeltaRecordWriter {
 
     // Metadata required for delta files.
     KVFileMetadata metadata;
+
+    // Compression algorithm used if `enable_compression` is true.
+    Compression compression = Compression::kBrotli;
+    // Compression level, or the default level of `compression` if unset.
+    // Brotli levels are in [0, 11] and zstd levels in [-131072, 22], snappy
+    // has no levels.
+    std::optional<int> compression_level;
+    // If positive, the approximate size in bytes of uncompressed chunks,
+    // otherwise the riegeli default of 1 MiB.
+    uint64_t chunk_size_bytes = 0;
+    // If positive, chunks are encoded and compressed by this many background
+    // threads while records are written.
+    int parallelism = 0;
   };
   virtual ~DeltaRecordWriter() = default;
 
   // Writes a `DataRecordStruct` record to the underlying
   // destination.
   virtual absl::Status WriteRecord(const DataRecordStruct& data_record) = 0;
+  // Writes a record serialized as a `DataRecord` flatbuffer. Writers that
+  // store flatbuffers write it as is, others deserialize it for `WriteRecord`.
+  virtual absl::Status WriteSerializedRecord(
+      std::string_view serialized_record) {
+    return DeserializeDataRecord(
+        serialized_record, [this](const DataRecordStruct& data_record) {
+          return WriteRecord(data_record);
+        });
+  }
   // Flushes any written data to the underlying destination and makes it
   // visible outside the writing process. `Flush()` is different from
   // `Close()` in that it allows for more records to be written after some data
@@ -16,12 +16,21 @@
 
 #include "public/data_loading/writers/sharded_record_buffer.h"
 
+#include <fstream>
 #include <iostream>
 #include <sstream>
+#include <string>
+#include <utility>
 
+#include "absl/log/log.h"
 #include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
 #include "absl/strings/str_format.h"
+#include "public/data_loading/riegeli_metadata.pb.h"
+#include "public/data_loading/writers/delta_record_stream_writer.h"
+#include "riegeli/bytes/istream_reader.h"
 #include "riegeli/bytes/ostream_writer.h"
+#include "riegeli/records/record_reader.h"
 #include "riegeli/records/record_writer.h"
 
 namespace kv_server {
@@ -32,13 +41,17 @@ class RecordBufferImpl : public RecordBuffer {
   ~RecordBufferImpl() { record_writer_.Close(); }
 
   absl::Status AddRecord(const DataRecordStruct& record) override {
-    if (!record_writer_.WriteRecord(
-            ToStringView(ToFlatBufferBuilder(record)))) {
+    const std::string_view serialized =
+        ToStringView(ToFlatBufferBuilder(record));
+    if (!record_writer_.WriteRecord(serialized)) {
       return record_writer_.status();
     }
+    buffered_bytes_ += serialized.size();
     return absl::OkStatus();
   }
 
+  int64_t BufferedBytes() const override { return buffered_bytes_; }
+
   absl::Status Flush() override {
     if (!record_writer_.Flush()) {
       return record_writer_.status();
@@ -70,6 +83,7 @@ class RecordBufferImpl : public RecordBuffer {
   std::unique_ptr<std::stringstream> record_stream_;
   riegeli::RecordWriter<riegeli::OStreamWriter<std::stringstream*>>
       record_writer_;
+  int64_t buffered_bytes_ = 0;
 };
 
 absl::Status IsWithinBounds(int shard_id, int num_shards) {
@@ -80,64 +94,279 @@ absl::Status IsWithinBounds(int shard_id, int num_shards) {
   return absl::OkStatus();
 }
 
+// Writes the records of `src_stream` to `record_writer`, leaving
+// `src_stream` positioned at its beginning.
+absl::Status CopyRecords(std::istream& src_stream,
+                         riegeli::RecordWriterBase& record_writer) {
+  // The stream may have been read from `GetShardRecordStream`.
+  src_stream.clear();
+  src_stream.seekg(0);
+  {
+    riegeli::RecordReader<riegeli::IStreamReader<std::istream*>> reader{
+        riegeli::IStreamReader(&src_stream)};
+    absl::string_view record;
+    while (reader.ReadRecord(record)) {
+      if (!record_writer.WriteRecord(record)) {
+        return record_writer.status();
+      }
+    }
+    if (!reader.Close()) {
+      return reader.status();
+    }
+  }
+  src_stream.clear();
+  src_stream.seekg(0);
+  return absl::OkStatus();
+}
+
 }  // namespace
 
 ShardedRecordBuffer::ShardedRecordBuffer(
-    ShardingFunction sharding_func,
-    std::vector<std::unique_ptr<RecordBuffer>> shard_buffers)
+    ShardingFunction sharding_func, std::vector<std::unique_ptr<Shard>> shards,
+    Options options)
     : sharding_func_(std::move(sharding_func)),
-      shard_buffers_(std::move(shard_buffers)) {}
+      shards_(std::move(shards)),
+      options_(std::move(options)) {}
+
+ShardedRecordBuffer::~ShardedRecordBuffer() {
+  if (auto status = WaitForSpills(); !status.ok()) {
+    LOG(ERROR) << "Failed to spill shard records: " << status;
+  }
+}
 
 absl::StatusOr<std::unique_ptr<ShardedRecordBuffer>>
-ShardedRecordBuffer::Create(int num_shards, ShardingFunction sharding_func) {
+ShardedRecordBuffer::Create(int num_shards, ShardingFunction sharding_func,
+                            Options options) {
   if (num_shards <= 0) {
     return absl::InvalidArgumentError(absl::StrFormat(
         "Number of shards: %d must be greater than 0", num_shards));
   }
-  std::vector<std::unique_ptr<RecordBuffer>> shard_stores;
-  shard_stores.reserve(num_shards);
+  if (options.memory_budget_bytes > 0 && options.spill_file_prefix.empty()) {
+    return absl::InvalidArgumentError(
+        "Spill file prefix is required with a memory budget.");
+  }
+  if (auto status = ValidateRecordWriterOptions(options.spill_options);
+      !status.ok()) {
+    return status;
+  }
+  std::vector<std::unique_ptr<Shard>> shards;
+  shards.reserve(num_shards);
   for (int shard_id = 0; shard_id < num_shards; shard_id++) {
-    shard_stores.push_back(RecordBufferImpl::Create());
+    shards.push_back(std::make_unique<Shard>(RecordBufferImpl::Create()));
+  }
+  return absl::WrapUnique(new ShardedRecordBuffer(
+      std::move(sharding_func), std::move(shards), std::move(options)));
+}
+
+absl::StatusOr<std::unique_ptr<ShardedRecordBuffer>>
+ShardedRecordBuffer::CreateWithLogicalShards(int num_logical_shards,
+                                             ShardingFunction sharding_func,
+                                             Options options) {
+  auto buffer =
+      Create(num_logical_shards, std::move(sharding_func), std::move(options));
+  if (buffer.ok()) {
+    (*buffer)->logical_shards_ = true;
   }
-  return absl::WrapUnique(new ShardedRecordBuffer(std::move(sharding_func),
-                                                  std::move(shard_stores)));
+  return buffer;
 }
 
 absl::StatusOr<std::istream*> ShardedRecordBuffer::GetShardRecordStream(
     int shard_id) {
-  if (auto status = IsWithinBounds(shard_id, shard_buffers_.size());
-      !status.ok()) {
+  if (auto status = IsWithinBounds(shard_id, shards_.size()); !status.ok()) {
     return status;
   }
-  return shard_buffers_[shard_id]->RecordStream();
+  absl::MutexLock lock(&shards_[shard_id]->mutex);
+  return shards_[shard_id]->buffer->RecordStream();
+}
+
+absl::StatusOr<std::vector<std::string>>
+ShardedRecordBuffer::GetShardSpillFiles(int shard_id) {
+  if (auto status = IsWithinBounds(shard_id, shards_.size()); !status.ok()) {
+    return status;
+  }
+  absl::MutexLock lock(&shards_[shard_id]->mutex);
+  return shards_[shard_id]->spill_files;
 }
 
 absl::Status ShardedRecordBuffer::AddRecord(
     const DataRecordStruct& data_record) {
-  if (std::holds_alternative<KeyValueMutationRecordStruct>(
+  if (!std::holds_alternative<KeyValueMutationRecordStruct>(
           data_record.record)) {
-    auto kv_record = std::get<KeyValueMutationRecordStruct>(data_record.record);
-    auto shard_id =
-        sharding_func_.GetShardNumForKey(kv_record.key, shard_buffers_.size());
-    return shard_buffers_[shard_id]->AddRecord(data_record);
+    return absl::OkStatus();
+  }
+  const auto& kv_record =
+      std::get<KeyValueMutationRecordStruct>(data_record.record);
+  auto shard_id =
+      sharding_func_.GetShardNumForKey(kv_record.key, shards_.size());
+  Shard& shard = *shards_[shard_id];
+  int64_t added_bytes = 0;
+  {
+    absl::MutexLock lock(&shard.mutex);
+    const int64_t bytes_before = shard.buffer->BufferedBytes();
+    if (auto status = shard.buffer->AddRecord(data_record); !status.ok()) {
+      return status;
+    }
+    added_bytes = shard.buffer->BufferedBytes() - bytes_before;
+    shard.buffered_bytes += added_bytes;
+  }
+  if (options_.memory_budget_bytes > 0 &&
+      buffered_bytes_.fetch_add(added_bytes) + added_bytes >
+          options_.memory_budget_bytes) {
+    SpillShards();
   }
   return absl::OkStatus();
 }
 
+void ShardedRecordBuffer::SpillShards() {
+  absl::MutexLock spill_lock(&spill_mutex_);
+  while (buffered_bytes_ > options_.memory_budget_bytes) {
+    int largest_shard_id = 0;
+    for (int shard_id = 1; shard_id < static_cast<int>(shards_.size());
+         shard_id++) {
+      if (shards_[shard_id]->buffered_bytes >
+          shards_[largest_shard_id]->buffered_bytes) {
+        largest_shard_id = shard_id;
+      }
+    }
+    Shard& shard = *shards_[largest_shard_id];
+    std::unique_ptr<RecordBuffer> full_buffer;
+    std::string spill_file;
+    {
+      absl::MutexLock lock(&shard.mutex);
+      if (shard.buffer->BufferedBytes() == 0) {
+        return;
+      }
+      full_buffer = std::exchange(shard.buffer, RecordBufferImpl::Create());
+      shard.buffered_bytes = 0;
+      spill_file =
+          absl::StrCat(options_.spill_file_prefix, "_shard_", largest_shard_id,
+                       "_", shard.spill_files.size());
+      shard.spill_files.push_back(spill_file);
+    }
+    buffered_bytes_ -= full_buffer->BufferedBytes();
+    spills_.push_back(std::async(
+        std::launch::async,
+        [this, largest_shard_id, spill_file = std::move(spill_file),
+         full_buffer = std::move(full_buffer)]() {
+          return SpillBuffer(largest_shard_id, spill_file, *full_buffer);
+        }));
+  }
+}
+
+absl::Status ShardedRecordBuffer::SpillBuffer(int shard_id,
+                                              const std::string& spill_file,
+                                              RecordBuffer& buffer) const {
+  if (auto status = buffer.Flush(); !status.ok()) {
+    return status;
+  }
+  std::ofstream spill_stream(spill_file, std::ios::binary | std::ios::trunc);
+  if (!spill_stream.is_open()) {
+    return absl::InternalError(
+        absl::StrCat("Failed to open spill file ", spill_file));
+  }
+  DeltaRecordWriter::Options options = options_.spill_options;
+  ShardingMetadata* sharding_metadata =
+      options.metadata.mutable_sharding_metadata();
+  sharding_metadata->set_shard_num(shard_id);
+  if (logical_shards_) {
+    sharding_metadata->set_num_logical_shards(shards_.size());
+  }
+  riegeli::RecordWriter<riegeli::OStreamWriter<std::ofstream*>> record_writer(
+      riegeli::OStreamWriter(&spill_stream), GetRecordWriterOptions(options));
+  if (auto status = CopyRecords(*buffer.RecordStream(), record_writer);
+      !status.ok()) {
+    return status;
+  }
+  if (!record_writer.Close()) {
+    return record_writer.status();
+  }
+  return absl::OkStatus();
+}
+
+absl::Status ShardedRecordBuffer::WaitForSpills() {
+  absl::MutexLock spill_lock(&spill_mutex_);
+  absl::Status status;
+  for (auto& spill : spills_) {
+    status.Update(spill.get());
+  }
+  spills_.clear();
+  return status;
+}
+
 absl::Status ShardedRecordBuffer::Flush(int shard_id) {
+  if (auto status = WaitForSpills(); !status.ok()) {
+    return status;
+  }
   if (shard_id < 0) {
-    for (const auto& buffer : shard_buffers_) {
-      if (auto status = buffer->Flush(); !status.ok()) {
+    for (const auto& shard : shards_) {
+      absl::MutexLock lock(&shard->mutex);
+      if (auto status = shard->buffer->Flush(); !status.ok()) {
         return status;
       }
     }
     return absl::OkStatus();
   }
-  if (auto status = IsWithinBounds(shard_id, shard_buffers_.size());
-      !status.ok()) {
+  if (auto status = IsWithinBounds(shard_id, shards_.size()); !status.ok()) {
+    return status;
+  }
+  absl::MutexLock lock(&shards_[shard_id]->mutex);
+  return shards_[shard_id]->buffer->Flush();
+}
+
+absl::Status ShardedRecordBuffer::WriteShardedStream(
+    std::ostream& dest_stream, DeltaRecordWriter::Options options) {
+  if (auto status = Flush(); !status.ok()) {
     return status;
   }
-  return shard_buffers_[shard_id]->Flush();
+  ShardingMetadata* sharding_metadata =
+      options.metadata.mutable_sharding_metadata();
+  sharding_metadata->clear_shard_num();
+  sharding_metadata->set_has_shard_record_ranges(true);
+  if (logical_shards_) {
+    sharding_metadata->set_num_logical_shards(shards_.size());
+  } else {
+    sharding_metadata->clear_num_logical_shards();
+  }
+  riegeli::RecordWriter<riegeli::OStreamWriter<std::ostream*>> record_writer(
+      riegeli::OStreamWriter(&dest_stream), GetRecordWriterOptions(options));
+  ShardRecordRanges shard_record_ranges;
+  for (int shard_id = 0; shard_id < static_cast<int>(shards_.size());
+       shard_id++) {
+    Shard& shard = *shards_[shard_id];
+    absl::MutexLock lock(&shard.mutex);
+    const int64_t begin_pos = record_writer.Pos().numeric();
+    for (const auto& spill_file : shard.spill_files) {
+      std::ifstream spill_stream(spill_file, std::ios::binary);
+      if (!spill_stream.is_open()) {
+        return absl::InternalError(
+            absl::StrCat("Failed to open spill file ", spill_file));
+      }
+      if (auto status = CopyRecords(spill_stream, record_writer);
+          !status.ok()) {
+        return status;
+      }
+    }
+    if (auto status = CopyRecords(*shard.buffer->RecordStream(), record_writer);
+        !status.ok()) {
+      return status;
+    }
+    // Ends the chunk, so that the records of the next shard start a new one.
+    if (!record_writer.Flush()) {
+      return record_writer.status();
+    }
+    const int64_t end_pos = record_writer.Pos().numeric();
+    if (end_pos > begin_pos) {
+      ShardRecordRange* range = shard_record_ranges.add_ranges();
+      range->set_shard_num(shard_id);
+      range->set_begin_pos(begin_pos);
+      range->set_end_pos(end_pos);
+    }
+  }
+  if (!record_writer.WriteRecord(shard_record_ranges) ||
+      !record_writer.Close()) {
+    return record_writer.status();
+  }
+  return absl::OkStatus();
 }
 
 }  // namespace kv_server
@@ -17,13 +17,19 @@
 #ifndef PUBLIC_DATA_LOADING_WRITERS_SHARDED_RECORD_BUFFER_H_
 #define PUBLIC_DATA_LOADING_WRITERS_SHARDED_RECORD_BUFFER_H_
 
+#include <atomic>
+#include <future>
 #include <iostream>
 #include <memory>
+#include <string>
+#include <utility>
 #include <vector>
 
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/synchronization/mutex.h"
 #include "public/data_loading/records_utils.h"
+#include "public/data_loading/writers/delta_record_writer.h"
 #include "public/sharding/sharding_function.h"
 
 namespace kv_server {
@@ -38,6 +44,8 @@ class RecordBuffer {
   // Returns an error status if adding a record to the buffer fails for some
   // reason.
   virtual absl::Status AddRecord(const DataRecordStruct& record) = 0;
+  // Returns the size in bytes of the records added to the buffer.
+  virtual int64_t BufferedBytes() const = 0;
   // Flushes buffered records so that they are visible for reading via
   // `RecordStream()`.
   virtual absl::Status Flush() = 0;
@@ -46,29 +54,98 @@ class RecordBuffer {
   virtual std::istream* RecordStream() = 0;
 };
 
+struct ShardedRecordBufferOptions {
+  // If positive, once the records buffered in memory exceed this many bytes,
+  // the buffers of the largest shards are written in the background to
+  // rolling delta files named `<spill_file_prefix>_shard_<shard>_<sequence>`,
+  // until the buffered records fit the budget again.
+  int64_t memory_budget_bytes = 0;
+  // Required if `memory_budget_bytes` is positive.
+  std::string spill_file_prefix;
+  // Options of the spilled delta files. `metadata` is written with the shard
+  // number of the records.
+  DeltaRecordWriter::Options spill_options;
+};
+
 // A `ShardedRecordBuffer` buffers `DataRecordStruct` records
 // serialized as `data_loading.fbs:DataRecord` flatbuffers in
 // separate sharded streams
+//
+// `AddRecord` can be called concurrently from multiple threads, other
+// functions must not be called concurrently with any function.
 class ShardedRecordBuffer {
  public:
-  ~ShardedRecordBuffer() = default;
+  using Options = ShardedRecordBufferOptions;
+
+  ~ShardedRecordBuffer();
   ShardedRecordBuffer(const ShardedRecordBuffer&) = delete;
   ShardedRecordBuffer& operator=(const ShardedRecordBuffer&) = delete;
 
   static absl::StatusOr<std::unique_ptr<ShardedRecordBuffer>> Create(
-      int num_shards, ShardingFunction sharding_func = ShardingFunction(""));
+      int num_shards, ShardingFunction sharding_func = ShardingFunction(""),
+      Options options = Options());
+  // Same as `Create`, with the records buffered by logical shard, see
+  // `LogicalShardMapping`. `WriteShardedStream` records the number of logical
+  // shards, so that servers with the same number of logical shards only read
+  // the records of the logical shards mapped to them.
+  static absl::StatusOr<std::unique_ptr<ShardedRecordBuffer>>
+  CreateWithLogicalShards(
+      int num_logical_shards,
+      ShardingFunction sharding_func = ShardingFunction(""),
+      Options options = Options());
+  // Returns the records of `shard_id` that are buffered in memory, i.e., not
+  // the records already written to the files of `GetShardSpillFiles`.
   absl::StatusOr<std::istream*> GetShardRecordStream(int shard_id);
+  // Returns the files that records of `shard_id` were spilled to, in the
+  // order the records were added. Call `Flush()` to wait for the files to be
+  // written.
+  absl::StatusOr<std::vector<std::string>> GetShardSpillFiles(int shard_id);
   absl::Status AddRecord(const DataRecordStruct& record);
   // Flushes buffered records so that they are visible for reading via
   // `RecordStream()`. Specify a `shard_id` to flush records buffered for a
-  // specific shard or -1 to flush all buffered records.
+  // specific shard or -1 to flush all buffered records. Waits for spilled
+  // files to be written.
   absl::Status Flush(int shard_id = -1);
+  // Flushes all buffered records and writes them to `dest_stream` as one file
+  // with the records of every shard, grouped by shard and followed by their
+  // `ShardRecordRanges`, so that each shard can skip the records of the
+  // others. `options.metadata` is written with `has_shard_record_ranges` set.
+  // Records spilled to files are written before the ones still in memory.
+  absl::Status WriteShardedStream(std::ostream& dest_stream,
+                                  DeltaRecordWriter::Options options);
 
  private:
+  struct Shard {
+    explicit Shard(std::unique_ptr<RecordBuffer> buffer)
+        : buffer(std::move(buffer)) {}
+
+    absl::Mutex mutex;
+    std::unique_ptr<RecordBuffer> buffer ABSL_GUARDED_BY(mutex);
+    std::vector<std::string> spill_files ABSL_GUARDED_BY(mutex);
+    // Bytes of `buffer`, readable without holding `mutex`.
+    std::atomic<int64_t> buffered_bytes = 0;
+  };
+
   ShardedRecordBuffer(ShardingFunction sharding_func,
-                      std::vector<std::unique_ptr<RecordBuffer>> shard_buffers);
+                      std::vector<std::unique_ptr<Shard>> shards,
+                      Options options);
+  // Spills the largest shard buffers while the buffered bytes exceed
+  // `options_.memory_budget_bytes`.
+  void SpillShards() ABSL_LOCKS_EXCLUDED(spill_mutex_);
+  // Waits for the spills in progress and returns the first error.
+  absl::Status WaitForSpills() ABSL_LOCKS_EXCLUDED(spill_mutex_);
+  absl::Status SpillBuffer(int shard_id, const std::string& spill_file,
+                           RecordBuffer& buffer) const;
+
   ShardingFunction sharding_func_;
-  std::vector<std::unique_ptr<RecordBuffer>> shard_buffers_;
+  std::vector<std::unique_ptr<Shard>> shards_;
+  // Whether the shards of `shards_` are logical shards.
+  bool logical_shards_ = false;
+  Options options_;
+  // Bytes of all shard buffers, excluding the ones being spilled.
+  std::atomic<int64_t> buffered_bytes_ = 0;
+  absl::Mutex spill_mutex_;
+  std::vector<std::future<absl::Status>> spills_ ABSL_GUARDED_BY(spill_mutex_);
 };
 
 }  // namespace kv_server
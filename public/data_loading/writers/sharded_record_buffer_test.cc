@@ -16,14 +16,35 @@
 
 #include "public/data_loading/writers/sharded_record_buffer.h"
 
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "absl/synchronization/mutex.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "public/data_loading/readers/delta_record_stream_reader.h"
+#include "public/data_loading/readers/riegeli_stream_io.h"
+#include "public/sharding/logical_shard_mapping.h"
 #include "public/sharding/sharding_function.h"
 
 namespace kv_server {
 namespace {
 
+// Holds a stream that can be used to read `blob` contents.
+class StringRecordStream : public RecordStream {
+ public:
+  explicit StringRecordStream(const std::string& blob) : stream_(blob) {}
+  std::istream& Stream() override { return stream_; }
+
+ private:
+  std::stringstream stream_;
+};
+
 KeyValueMutationRecordStruct GetKVMutationRecord(std::string_view key) {
   return KeyValueMutationRecordStruct{
       .mutation_type = KeyValueMutationType::Update,
@@ -133,5 +154,236 @@ TEST(ShardedRecordBufferTest, ValidateAddingAndReadingRecords) {
   ValidateRecordStream({"key6"}, **shard_stream);
 }
 
+// Returns the keys of the records of `shard_num` read from `content`.
+std::vector<std::string> ReadShardKeys(
+    const std::string& content, int64_t shard_num,
+    std::shared_ptr<const LogicalShardMapping> logical_shard_mapping =
+        nullptr) {
+  ConcurrentStreamRecordReader<std::string_view>::Options options;
+  options.num_worker_threads = 2;
+  options.min_shard_size_bytes = 16;
+  options.shard_num = shard_num;
+  options.logical_shard_mapping = std::move(logical_shard_mapping);
+  ConcurrentStreamRecordReader<std::string_view> record_reader(
+      [&content]() { return std::make_unique<StringRecordStream>(content); },
+      options);
+  absl::Mutex mutex;
+  std::vector<std::string> keys;
+  auto status = record_reader.ReadStreamRecords(
+      [&mutex, &keys](std::string_view raw) {
+        return DeserializeDataRecord(
+            raw, [&mutex, &keys](const DataRecordStruct& data_record) {
+              absl::MutexLock lock(&mutex);
+              keys.emplace_back(
+                  std::get<KeyValueMutationRecordStruct>(data_record.record)
+                      .key);
+              return absl::OkStatus();
+            });
+      });
+  EXPECT_TRUE(status.ok()) << status;
+  return keys;
+}
+
+TEST(ShardedRecordBufferTest, WriteShardedStreamSkipsOtherShards) {
+  auto record_buffer = ShardedRecordBuffer::Create(7);
+  ASSERT_TRUE(record_buffer.ok()) << record_buffer.status();
+  for (const auto& key :
+       {"key1", "key2", "key3", "key4", "key5", "key6", "key7"}) {
+    auto status =
+        (*record_buffer)->AddRecord(GetDataRecord(GetKVMutationRecord(key)));
+    ASSERT_TRUE(status.ok()) << status;
+  }
+  std::stringstream dest_stream;
+  KVFileMetadata metadata;
+  *metadata.mutable_delta() = DeltaMetadata();
+  auto status = (*record_buffer)
+                    ->WriteShardedStream(
+                        dest_stream, DeltaRecordWriter::Options{
+                                         .enable_compression = false,
+                                         .metadata = metadata,
+                                     });
+  ASSERT_TRUE(status.ok()) << status;
+  const std::string content = dest_stream.str();
+
+  // {key1,key5}=5, {key2,key7}=6, key3=1, key4=0, key6=3
+  EXPECT_THAT(ReadShardKeys(content, 5),
+              testing::UnorderedElementsAre("key1", "key5"));
+  EXPECT_THAT(ReadShardKeys(content, 0), testing::ElementsAre("key4"));
+  EXPECT_THAT(ReadShardKeys(content, 2), testing::IsEmpty());
+  EXPECT_THAT(ReadShardKeys(content, -1),
+              testing::UnorderedElementsAre("key1", "key2", "key3", "key4",
+                                            "key5", "key6", "key7"));
+  // The records stay readable from the shard streams.
+  auto shard_stream = (*record_buffer)->GetShardRecordStream(6);
+  ASSERT_TRUE(shard_stream.ok()) << shard_stream.status();
+  ValidateRecordStream({"key2", "key7"}, **shard_stream);
+}
+
+TEST(ShardedRecordBufferTest, WriteShardedStreamWithLogicalShards) {
+  auto record_buffer = ShardedRecordBuffer::CreateWithLogicalShards(7);
+  ASSERT_TRUE(record_buffer.ok()) << record_buffer.status();
+  for (const auto& key :
+       {"key1", "key2", "key3", "key4", "key5", "key6", "key7"}) {
+    auto status =
+        (*record_buffer)->AddRecord(GetDataRecord(GetKVMutationRecord(key)));
+    ASSERT_TRUE(status.ok()) << status;
+  }
+  std::stringstream dest_stream;
+  KVFileMetadata metadata;
+  *metadata.mutable_delta() = DeltaMetadata();
+  auto status = (*record_buffer)
+                    ->WriteShardedStream(
+                        dest_stream, DeltaRecordWriter::Options{
+                                         .enable_compression = false,
+                                         .metadata = metadata,
+                                     });
+  ASSERT_TRUE(status.ok()) << status;
+  const std::string content = dest_stream.str();
+
+  // Logical shards {key1,key5}=5, {key2,key7}=6, key3=1, key4=0, key6=3.
+  auto mapping = LogicalShardMapping::Create(
+      7, 2, {{0, 0}, {1, 0}, {3, 0}, {5, 1}, {6, 1}});
+  ASSERT_TRUE(mapping.ok()) << mapping.status();
+  auto shared_mapping =
+      std::make_shared<const LogicalShardMapping>(*std::move(mapping));
+  EXPECT_THAT(ReadShardKeys(content, 1, shared_mapping),
+              testing::UnorderedElementsAre("key1", "key2", "key5", "key7"));
+  EXPECT_THAT(ReadShardKeys(content, 0, shared_mapping),
+              testing::UnorderedElementsAre("key3", "key4", "key6"));
+  // Without the same logical shards, all records may belong to the shard.
+  EXPECT_THAT(ReadShardKeys(content, 0),
+              testing::UnorderedElementsAre("key1", "key2", "key3", "key4",
+                                            "key5", "key6", "key7"));
+}
+
+// Returns the keys of the records spilled for `shard_id`, checking the shard
+// number of the spilled files.
+std::vector<std::string> ReadSpilledKeys(ShardedRecordBuffer& record_buffer,
+                                         int shard_id) {
+  std::vector<std::string> keys;
+  auto spill_files = record_buffer.GetShardSpillFiles(shard_id);
+  EXPECT_TRUE(spill_files.ok()) << spill_files.status();
+  for (const auto& spill_file : *spill_files) {
+    std::ifstream spill_stream(spill_file, std::ios::binary);
+    DeltaRecordStreamReader record_reader(spill_stream);
+    auto metadata = record_reader.ReadMetadata();
+    EXPECT_TRUE(metadata.ok()) << metadata.status();
+    EXPECT_EQ(metadata->sharding_metadata().shard_num(), shard_id);
+    auto status =
+        record_reader.ReadRecords([&keys](DataRecordStruct data_record) {
+          keys.emplace_back(
+              std::get<KeyValueMutationRecordStruct>(data_record.record).key);
+          return absl::OkStatus();
+        });
+    EXPECT_TRUE(status.ok()) << status;
+  }
+  return keys;
+}
+
+std::vector<std::string> GetKeys(int num_keys) {
+  std::vector<std::string> keys;
+  for (int i = 0; i < num_keys; ++i) {
+    keys.push_back(absl::StrCat("key", i));
+  }
+  return keys;
+}
+
+TEST(ShardedRecordBufferTest, ValidateCreatingBufferWithMemoryBudget) {
+  auto buffer = ShardedRecordBuffer::Create(
+      7, ShardingFunction(""),
+      ShardedRecordBuffer::Options{.memory_budget_bytes = 1024});
+  EXPECT_EQ(buffer.status().code(), absl::StatusCode::kInvalidArgument)
+      << buffer.status();
+  buffer = ShardedRecordBuffer::Create(
+      7, ShardingFunction(""),
+      ShardedRecordBuffer::Options{
+          .memory_budget_bytes = 1024,
+          .spill_file_prefix = absl::StrCat(testing::TempDir(), "/spill")});
+  EXPECT_TRUE(buffer.ok()) << buffer.status();
+}
+
+TEST(ShardedRecordBufferTest, SpillsShardsOverMemoryBudget) {
+  const int num_shards = 3;
+  const std::vector<std::string> keys = GetKeys(100);
+  auto record_buffer = ShardedRecordBuffer::Create(
+      num_shards, ShardingFunction(""),
+      ShardedRecordBuffer::Options{
+          .memory_budget_bytes = 1024,
+          .spill_file_prefix =
+              absl::StrCat(testing::TempDir(), "/spill_over_budget")});
+  ASSERT_TRUE(record_buffer.ok()) << record_buffer.status();
+  for (const auto& key : keys) {
+    auto status =
+        (*record_buffer)->AddRecord(GetDataRecord(GetKVMutationRecord(key)));
+    ASSERT_TRUE(status.ok()) << status;
+  }
+  auto status = (*record_buffer)->Flush();
+  ASSERT_TRUE(status.ok()) << status;
+  ShardingFunction sharding_func(/*seed=*/"");
+  int64_t num_spilled_keys = 0;
+  for (int shard_id = 0; shard_id < num_shards; ++shard_id) {
+    std::vector<std::string> shard_keys =
+        ReadSpilledKeys(**record_buffer, shard_id);
+    num_spilled_keys += shard_keys.size();
+    auto shard_stream = (*record_buffer)->GetShardRecordStream(shard_id);
+    ASSERT_TRUE(shard_stream.ok()) << shard_stream.status();
+    DeltaRecordStreamReader record_reader(**shard_stream);
+    status =
+        record_reader.ReadRecords([&shard_keys](DataRecordStruct data_record) {
+          shard_keys.emplace_back(
+              std::get<KeyValueMutationRecordStruct>(data_record.record).key);
+          return absl::OkStatus();
+        });
+    ASSERT_TRUE(status.ok()) << status;
+    std::vector<std::string> expected;
+    for (const auto& key : keys) {
+      if (sharding_func.GetShardNumForKey(key, num_shards) == shard_id) {
+        expected.push_back(key);
+      }
+    }
+    // Spilled records are followed by the ones still in memory.
+    EXPECT_THAT(shard_keys, testing::ElementsAreArray(expected));
+  }
+  EXPECT_GT(num_spilled_keys, 0);
+}
+
+TEST(ShardedRecordBufferTest, WriteShardedStreamWithConcurrentSpills) {
+  const std::vector<std::string> keys = GetKeys(1000);
+  auto record_buffer = ShardedRecordBuffer::Create(
+      7, ShardingFunction(""),
+      ShardedRecordBuffer::Options{
+          .memory_budget_bytes = 4096,
+          .spill_file_prefix =
+              absl::StrCat(testing::TempDir(), "/spill_concurrent")});
+  ASSERT_TRUE(record_buffer.ok()) << record_buffer.status();
+  const int num_threads = 4;
+  std::vector<std::thread> threads;
+  for (int thread_id = 0; thread_id < num_threads; ++thread_id) {
+    threads.emplace_back([&keys, &record_buffer, thread_id]() {
+      for (int i = thread_id; i < static_cast<int>(keys.size());
+           i += num_threads) {
+        auto status = (*record_buffer)->AddRecord(
+            GetDataRecord(GetKVMutationRecord(keys[i])));
+        EXPECT_TRUE(status.ok()) << status;
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  std::stringstream dest_stream;
+  KVFileMetadata metadata;
+  *metadata.mutable_delta() = DeltaMetadata();
+  auto status = (*record_buffer)
+                    ->WriteShardedStream(
+                        dest_stream, DeltaRecordWriter::Options{
+                                         .enable_compression = false,
+                                         .metadata = metadata,
+                                     });
+  ASSERT_TRUE(status.ok()) << status;
+  EXPECT_THAT(ReadShardKeys(dest_stream.str(), -1),
+              testing::UnorderedElementsAreArray(keys));
+}
+
 }  // namespace
 }  // namespace kv_server
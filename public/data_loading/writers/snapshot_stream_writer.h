@@ -17,26 +17,69 @@
 #ifndef PUBLIC_DATA_LOADING_WRITERS_SNAPSHOT_STREAM_WRITER_
 #define PUBLIC_DATA_LOADING_WRITERS_SNAPSHOT_STREAM_WRITER_
 
+#include <algorithm>
 #include <filesystem>
 #include <iostream>
 #include <memory>
 #include <string>
 #include <utility>
+#include <variant>
+#include <vector>
 
 #include "absl/hash/hash.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/str_cat.h"
+#include "absl/types/span.h"
 #include "public/data_loading/aggregation/record_aggregator.h"
+#include "public/data_loading/aggregation/sorting_record_aggregator.h"
 #include "public/data_loading/filename_utils.h"
 #include "public/data_loading/readers/delta_record_stream_reader.h"
 #include "public/data_loading/records_utils.h"
 #include "public/data_loading/riegeli_metadata.pb.h"
+#include "public/data_loading/snapshot_key_index.h"
 #include "public/data_loading/writers/delta_record_stream_writer.h"
 #include "public/data_loading/writers/delta_record_writer.h"
+#include "riegeli/bytes/ostream_writer.h"
+#include "riegeli/records/record_writer.h"
 
 namespace kv_server {
 
+// Writes `records`, pairs of a key and its serialized `DataRecord` sorted by
+// key, in blocks of `block_size` records that each start a chunk, followed by
+// their `SnapshotKeyIndex`, and closes `record_writer`.
+inline absl::Status WriteKeyIndexedRecords(
+    absl::Span<const std::pair<std::string, std::string>> records,
+    int64_t block_size, riegeli::RecordWriterBase& record_writer) {
+  // Ends the chunk, so that each block of records starts a new one.
+  if (!record_writer.Flush()) {
+    return record_writer.status();
+  }
+  SnapshotKeyIndex key_index;
+  std::vector<std::string_view> block_keys;
+  for (size_t begin = 0; begin < records.size(); begin += block_size) {
+    const size_t end = std::min<size_t>(records.size(), begin + block_size);
+    const int64_t begin_pos = record_writer.Pos().numeric();
+    block_keys.clear();
+    for (size_t i = begin; i < end; i++) {
+      if (!record_writer.WriteRecord(records[i].second)) {
+        return record_writer.status();
+      }
+      block_keys.push_back(records[i].first);
+    }
+    if (!record_writer.Flush()) {
+      return record_writer.status();
+    }
+    AddSnapshotKeyIndexBlock(block_keys, begin_pos,
+                             record_writer.Pos().numeric(), key_index);
+  }
+  key_index.set_records_end_pos(record_writer.Pos().numeric());
+  if (!record_writer.WriteRecord(key_index) || !record_writer.Close()) {
+    return record_writer.status();
+  }
+  return absl::OkStatus();
+}
+
 // A `SnapshotStreamWriter` writes `DataRecordStruct` records to a
 // destination snapshot stream. The `SnapshotStreamWriter` can be used to:
 // (1) merge multiple delta files into a single snapshot file or
@@ -63,13 +106,16 @@ namespace kv_server {
 //  status = (*snapshot_writer)->Finalize();
 //  HandleErrorStatus(status);
 // ```
+// If `Options.metadata` holds `CompactedDeltaMetadata` instead of
+// `SnapshotMetadata`, it writes a compacted delta file instead, which keeps
+// the DELETE mutations so that it can be loaded on top of earlier data.
 // NOTE: This class is not thread safe.
 template <typename DestStreamT = std::iostream>
 class SnapshotStreamWriter {
  public:
   struct Options {
-    // Metadata required for writing snapshot files. This is validated when the
-    // `SnapshotStreamWriter` is created and initialized.
+    // Metadata required for writing snapshot or compacted delta files. This is
+    // validated when the `SnapshotStreamWriter` is created and initialized.
     KVFileMetadata metadata;
     // File used to store temporary data generated when writing records or
     // record streams to the output snapshot stream. If empty, then snapshot
@@ -77,6 +123,16 @@ class SnapshotStreamWriter {
     std::string temp_data_file;
     // Whether to compress the snapshot stream or not.
     bool compress_snapshot;
+    // If positive, records are aggregated with a `SortingRecordAggregator`
+    // instead of SQLite, holding about this many bytes of records in memory.
+    // Sorted runs of records are then spilled to files prefixed by
+    // `temp_data_file`, or never spilled if it is empty.
+    int64_t aggregation_memory_bytes = 0;
+    // If positive, the records are written sorted by key, in blocks of this
+    // many records located by a `SnapshotKeyIndex`, see
+    // `SnapshotMetadata.has_key_index`. The records are then sorted in memory
+    // when finalizing. Not supported for compacted delta files.
+    int64_t key_index_block_size = 0;
   };
 
   ~SnapshotStreamWriter();
@@ -105,20 +161,37 @@ class SnapshotStreamWriter {
   absl::Status Finalize();
 
  private:
-  SnapshotStreamWriter(
-      std::unique_ptr<DeltaRecordStreamWriter<DestStreamT>> record_writer,
-      std::unique_ptr<RecordAggregator> record_aggregator, Options options);
+  SnapshotStreamWriter(DestStreamT& dest_snapshot_stream,
+                       std::unique_ptr<RecordAggregator> record_aggregator,
+                       Options options);
 
   absl::Status InsertOrUpdateRecord(const DataRecordStruct& record);
+  // Sets the key counts and value sizes of the aggregated records in the
+  // snapshot metadata.
+  absl::Status AddRecordSizesToMetadata();
   template <typename SrcStreamT>
   absl::Status InsertOrUpdateRecords(SrcStreamT& src_stream);
+  // Writes the aggregated records sorted by key in blocks, followed by their
+  // `SnapshotKeyIndex`.
+  absl::Status WriteSortedRecords();
   static absl::StatusOr<std::unique_ptr<RecordAggregator>>
-  CreateRecordAggregator(std::string_view temp_data_file);
+  CreateRecordAggregator(const Options& options);
   static DeltaRecordWriter::Options CreateDeltaRecordWriterOptions(
       const Options& options);
   static absl::Status ValidateRequiredSnapshotMetadata(
       const KVFileMetadata& metadata);
+  static absl::Status ValidateRequiredCompactedDeltaMetadata(
+      const Options& options);
+  // Whether `record` is left out of the written file.
+  bool SkipsRecord(const KeyValueMutationRecordStruct& record) const {
+    // By definition, snapshots do NOT contain DELETE mutations.
+    return record.mutation_type == KeyValueMutationType::Delete &&
+           !options_.metadata.has_compacted_delta();
+  }
 
+  DestStreamT& dest_snapshot_stream_;
+  // Created when finalizing, since the metadata is written before the records
+  // and holds their sizes.
   std::unique_ptr<DeltaRecordStreamWriter<DestStreamT>> record_writer_;
   std::unique_ptr<RecordAggregator> record_aggregator_;
   Options options_;
@@ -128,9 +201,9 @@ class SnapshotStreamWriter {
 
 template <typename DestStreamT>
 SnapshotStreamWriter<DestStreamT>::SnapshotStreamWriter(
-    std::unique_ptr<DeltaRecordStreamWriter<DestStreamT>> record_writer,
+    DestStreamT& dest_snapshot_stream,
     std::unique_ptr<RecordAggregator> record_aggregator, Options options)
-    : record_writer_(std::move(record_writer)),
+    : dest_snapshot_stream_(dest_snapshot_stream),
       record_aggregator_(std::move(record_aggregator)),
       options_(std::move(options)) {}
 
@@ -143,22 +216,19 @@ template <typename DestStreamT>
 absl::StatusOr<std::unique_ptr<SnapshotStreamWriter<DestStreamT>>>
 SnapshotStreamWriter<DestStreamT>::Create(Options options,
                                           DestStreamT& dest_snapshot_stream) {
-  if (absl::Status status = ValidateRequiredSnapshotMetadata(options.metadata);
+  if (absl::Status status =
+          options.metadata.has_compacted_delta()
+              ? ValidateRequiredCompactedDeltaMetadata(options)
+              : ValidateRequiredSnapshotMetadata(options.metadata);
       !status.ok()) {
     return status;
   }
-  auto record_aggregator = CreateRecordAggregator(options.temp_data_file);
+  auto record_aggregator = CreateRecordAggregator(options);
   if (!record_aggregator.ok()) {
     return record_aggregator.status();
   }
-  auto record_writer = DeltaRecordStreamWriter<DestStreamT>::Create(
-      dest_snapshot_stream, CreateDeltaRecordWriterOptions(options));
-  if (!record_writer.ok()) {
-    return record_writer.status();
-  }
   return absl::WrapUnique(new SnapshotStreamWriter<DestStreamT>(
-      std::move(*record_writer), std::move(*record_aggregator),
-      std::move(options)));
+      dest_snapshot_stream, std::move(*record_aggregator), std::move(options)));
 }
 
 template <typename DestStreamT>
@@ -200,10 +270,16 @@ SnapshotStreamWriter<DestStreamT>::CreateDeltaRecordWriterOptions(
 template <typename DestStreamT>
 absl::StatusOr<std::unique_ptr<RecordAggregator>>
 SnapshotStreamWriter<DestStreamT>::CreateRecordAggregator(
-    std::string_view temp_data_file) {
-  return temp_data_file.empty()
+    const Options& options) {
+  if (options.aggregation_memory_bytes > 0) {
+    return SortingRecordAggregator::Create(
+        {.max_memory_bytes = options.aggregation_memory_bytes,
+         .spill_file_prefix = options.temp_data_file});
+  }
+  return options.temp_data_file.empty()
              ? RecordAggregator::CreateInMemoryAggregator()
-             : RecordAggregator::CreateFileBackedAggregator(temp_data_file);
+             : RecordAggregator::CreateFileBackedAggregator(
+                   options.temp_data_file);
 }
 
 template <typename DestStreamT>
@@ -265,17 +341,70 @@ absl::Status SnapshotStreamWriter<DestStreamT>::WriteRecordStream(
   return InsertOrUpdateRecords(src_stream);
 }
 
+template <typename DestStreamT>
+absl::Status SnapshotStreamWriter<DestStreamT>::AddRecordSizesToMetadata() {
+  if (options_.metadata.has_compacted_delta()) {
+    return absl::OkStatus();
+  }
+  int64_t num_keys = 0;
+  int64_t num_set_keys = 0;
+  int64_t total_value_bytes = 0;
+  if (absl::Status status = record_aggregator_->ReadRecords(
+          [&num_keys, &num_set_keys,
+           &total_value_bytes](KeyValueMutationRecordStruct kv_mutation_record) {
+            if (kv_mutation_record.mutation_type ==
+                KeyValueMutationType::Delete) {
+              return absl::OkStatus();
+            }
+            if (const auto* value =
+                    std::get_if<std::string_view>(&kv_mutation_record.value)) {
+              num_keys++;
+              total_value_bytes += value->size();
+            } else if (const auto* values =
+                           std::get_if<std::vector<std::string_view>>(
+                               &kv_mutation_record.value)) {
+              num_set_keys++;
+              for (std::string_view value : *values) {
+                total_value_bytes += value.size();
+              }
+            }
+            return absl::OkStatus();
+          });
+      !status.ok()) {
+    return status;
+  }
+  SnapshotMetadata& snapshot = *options_.metadata.mutable_snapshot();
+  snapshot.set_num_keys(num_keys);
+  snapshot.set_num_set_keys(num_set_keys);
+  snapshot.set_total_value_bytes(total_value_bytes);
+  return absl::OkStatus();
+}
+
 template <typename DestStreamT>
 absl::Status SnapshotStreamWriter<DestStreamT>::Finalize() {
   if (is_finalized_) {
     return absl::OkStatus();
   }
+  if (absl::Status status = AddRecordSizesToMetadata(); !status.ok()) {
+    return status;
+  }
+  if (options_.key_index_block_size > 0) {
+    if (absl::Status status = WriteSortedRecords(); !status.ok()) {
+      return status;
+    }
+    is_finalized_ = true;
+    return absl::OkStatus();
+  }
+  auto record_writer = DeltaRecordStreamWriter<DestStreamT>::Create(
+      dest_snapshot_stream_, CreateDeltaRecordWriterOptions(options_));
+  if (!record_writer.ok()) {
+    return record_writer.status();
+  }
+  record_writer_ = *std::move(record_writer);
   if (absl::Status status = record_aggregator_->ReadRecords(
-          [record_writer = record_writer_.get()](
+          [this, record_writer = record_writer_.get()](
               KeyValueMutationRecordStruct kv_mutation_record) {
-            // By definition, snapshots do NOT contain DELETE mutations.
-            if (kv_mutation_record.mutation_type ==
-                KeyValueMutationType::Delete) {
+            if (SkipsRecord(kv_mutation_record)) {
               return absl::OkStatus();
             }
             DataRecordStruct data_record;
@@ -299,6 +428,42 @@ absl::Status SnapshotStreamWriter<DestStreamT>::Finalize() {
   return absl::OkStatus();
 }
 
+template <typename DestStreamT>
+absl::Status SnapshotStreamWriter<DestStreamT>::WriteSortedRecords() {
+  // Aggregators order records by a hash of their keys, so the serialized
+  // records are collected with their keys and sorted here.
+  std::vector<std::pair<std::string, std::string>> records;
+  if (absl::Status status = record_aggregator_->ReadRecords(
+          [this, &records](KeyValueMutationRecordStruct kv_mutation_record) {
+            if (SkipsRecord(kv_mutation_record)) {
+              return absl::OkStatus();
+            }
+            std::string key(kv_mutation_record.key);
+            DataRecordStruct data_record;
+            data_record.record = std::move(kv_mutation_record);
+            records.emplace_back(
+                std::move(key),
+                std::string(ToStringView(ToFlatBufferBuilder(data_record))));
+            return absl::OkStatus();
+          });
+      !status.ok()) {
+    return status;
+  }
+  std::sort(records.begin(), records.end(),
+            [](const auto& a, const auto& b) { return a.first < b.first; });
+  options_.metadata.mutable_snapshot()->set_has_key_index(true);
+  riegeli::RecordWriter<riegeli::OStreamWriter<DestStreamT*>> record_writer(
+      riegeli::OStreamWriter(&dest_snapshot_stream_),
+      GetRecordWriterOptions(CreateDeltaRecordWriterOptions(options_)));
+  if (udf_config_ != nullptr &&
+      !record_writer.WriteRecord(ToStringView(
+          ToFlatBufferBuilder(DataRecordStruct{.record = *udf_config_})))) {
+    return record_writer.status();
+  }
+  return WriteKeyIndexedRecords(records, options_.key_index_block_size,
+                                record_writer);
+}
+
 template <typename DestStreamT>
 absl::Status
 SnapshotStreamWriter<DestStreamT>::ValidateRequiredSnapshotMetadata(
@@ -329,6 +494,28 @@ SnapshotStreamWriter<DestStreamT>::ValidateRequiredSnapshotMetadata(
   }
   return absl::OkStatus();
 }
+
+template <typename DestStreamT>
+absl::Status
+SnapshotStreamWriter<DestStreamT>::ValidateRequiredCompactedDeltaMetadata(
+    const Options& options) {
+  const CompactedDeltaMetadata& metadata = options.metadata.compacted_delta();
+  if (!IsDeltaFilename(metadata.starting_delta_file()) ||
+      !IsDeltaFilename(metadata.ending_delta_file())) {
+    return absl::InvalidArgumentError(
+        "Compacted delta metadata must contain valid starting and ending "
+        "delta filenames.");
+  }
+  if (metadata.starting_delta_file() > metadata.ending_delta_file()) {
+    return absl::InvalidArgumentError(
+        "Compacted delta starting file must not be after its ending file.");
+  }
+  if (options.key_index_block_size > 0) {
+    return absl::InvalidArgumentError(
+        "Compacted delta files can't have a key index.");
+  }
+  return absl::OkStatus();
+}
 }  // namespace kv_server
 
 #endif  // PUBLIC_DATA_LOADING_WRITERS_SNAPSHOT_STREAM_WRITER_
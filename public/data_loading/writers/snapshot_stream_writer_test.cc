@@ -45,6 +45,13 @@ KVFileMetadata GetSnapshotMetadata() {
   *snapshot->mutable_ending_delta_file() = kEndingDeltaFilename;
   return metadata;
 }
+KVFileMetadata GetCompactedDeltaMetadata() {
+  KVFileMetadata metadata;
+  CompactedDeltaMetadata* compacted_delta = metadata.mutable_compacted_delta();
+  compacted_delta->set_starting_delta_file("DELTA_0000000000000002");
+  compacted_delta->set_ending_delta_file(kEndingDeltaFilename);
+  return metadata;
+}
 
 KeyValueMutationRecordStruct GetKVMutationRecord(std::string_view key = "key") {
   KeyValueMutationRecordStruct record;
@@ -104,7 +111,15 @@ INSTANTIATE_TEST_SUITE_P(
                               .compress_snapshot = false},
         SnapshotWriterOptions{.metadata = GetSnapshotMetadata(),
                               .temp_data_file = GetRecordAggregatorDbFile(),
-                              .compress_snapshot = true}));
+                              .compress_snapshot = true},
+        SnapshotWriterOptions{.metadata = GetSnapshotMetadata(),
+                              .temp_data_file = "",
+                              .compress_snapshot = false,
+                              .aggregation_memory_bytes = 1 << 20},
+        SnapshotWriterOptions{.metadata = GetSnapshotMetadata(),
+                              .temp_data_file = GetRecordAggregatorDbFile(),
+                              .compress_snapshot = false,
+                              .aggregation_memory_bytes = 1}));
 
 TEST_P(SnapshotStreamWriterTest, ValidateThatRecordsAreDedupedInSnapshot) {
   std::stringstream dest_stream;
@@ -255,8 +270,40 @@ TEST_P(SnapshotStreamWriterTest,
   DeltaRecordStreamReader record_reader(dest_stream);
   auto metadata = record_reader.ReadMetadata();
   EXPECT_TRUE(metadata.ok()) << metadata.status();
+  KVFileMetadata expected_metadata = GetSnapshotMetadata();
+  expected_metadata.mutable_snapshot()->set_num_keys(0);
+  expected_metadata.mutable_snapshot()->set_num_set_keys(0);
+  expected_metadata.mutable_snapshot()->set_total_value_bytes(0);
   EXPECT_TRUE(google::protobuf::util::MessageDifferencer::Equals(
-      GetSnapshotMetadata(), *metadata));
+      expected_metadata, *metadata));
+}
+
+TEST_P(SnapshotStreamWriterTest, SnapshotMetadataHoldsRecordSizes) {
+  std::stringstream dest_stream;
+  auto snapshot_writer =
+      SnapshotStreamWriterTest::CreateSnapshotWriter(dest_stream);
+  EXPECT_TRUE(snapshot_writer.ok()) << snapshot_writer.status();
+  KeyValueMutationRecordStruct set_record = GetKVMutationRecord("set_key");
+  std::vector<std::string_view> set_values = {"v1", "v2", "v3"};
+  set_record.value = set_values;
+  KeyValueMutationRecordStruct deleted_record =
+      GetKVMutationRecord("deleted_key");
+  deleted_record.mutation_type = KeyValueMutationType::Delete;
+  for (const auto& record :
+       {GetKVMutationRecord("key1"), GetKVMutationRecord("key2"), set_record,
+        deleted_record}) {
+    auto status = (*snapshot_writer)->WriteRecord(GetDataRecord(record));
+    EXPECT_TRUE(status.ok()) << status;
+  }
+  auto status = (*snapshot_writer)->Finalize();
+  EXPECT_TRUE(status.ok()) << status;
+  DeltaRecordStreamReader record_reader(dest_stream);
+  auto metadata = record_reader.ReadMetadata();
+  ASSERT_TRUE(metadata.ok()) << metadata.status();
+  EXPECT_EQ(metadata->snapshot().num_keys(), 2);
+  EXPECT_EQ(metadata->snapshot().num_set_keys(), 1);
+  // Two "value" values and the three set values.
+  EXPECT_EQ(metadata->snapshot().total_value_bytes(), 16);
 }
 
 TEST_P(SnapshotStreamWriterTest, UdfConfig_DedupedInSnapshot) {
@@ -342,6 +389,71 @@ TEST_P(SnapshotStreamWriterTest,
   EXPECT_TRUE(status.ok()) << status;
 }
 
+TEST(SnapshotStreamWriterTest, SortedSnapshotMetadataHasKeyIndex) {
+  std::stringstream dest_stream;
+  auto snapshot_writer = SnapshotStreamWriter<std::stringstream>::Create(
+      {.metadata = GetSnapshotMetadata(), .key_index_block_size = 2},
+      dest_stream);
+  ASSERT_TRUE(snapshot_writer.ok()) << snapshot_writer.status();
+  for (std::string_view key : {"key3", "key1", "key2"}) {
+    auto status = (*snapshot_writer)
+                      ->WriteRecord(GetDataRecord(GetKVMutationRecord(key)));
+    EXPECT_TRUE(status.ok()) << status;
+  }
+  auto status = (*snapshot_writer)->Finalize();
+  EXPECT_TRUE(status.ok()) << status;
+  DeltaRecordStreamReader record_reader(dest_stream);
+  auto metadata = record_reader.ReadMetadata();
+  ASSERT_TRUE(metadata.ok()) << metadata.status();
+  EXPECT_TRUE(metadata->snapshot().has_key_index());
+  EXPECT_EQ(metadata->snapshot().num_keys(), 3);
+}
+
+TEST(SnapshotStreamWriterTest, CompactedDeltaKeepsLatestDeletedRecords) {
+  std::stringstream dest_stream;
+  auto snapshot_writer = SnapshotStreamWriter<std::stringstream>::Create(
+      {.metadata = GetCompactedDeltaMetadata()}, dest_stream);
+  ASSERT_TRUE(snapshot_writer.ok()) << snapshot_writer.status();
+  auto kv_record = GetKVMutationRecord();
+  auto status = (*snapshot_writer)->WriteRecord(GetDataRecord(kv_record));
+  EXPECT_TRUE(status.ok()) << status;
+  kv_record.mutation_type = KeyValueMutationType::Delete;
+  kv_record.logical_commit_time++;
+  auto deletion = GetDataRecord(kv_record);
+  status = (*snapshot_writer)->WriteRecord(deletion);
+  EXPECT_TRUE(status.ok()) << status;
+  status = (*snapshot_writer)->Finalize();
+  EXPECT_TRUE(status.ok()) << status;
+
+  DeltaRecordStreamReader record_reader(dest_stream);
+  auto metadata = record_reader.ReadMetadata();
+  ASSERT_TRUE(metadata.ok()) << metadata.status();
+  EXPECT_TRUE(metadata->has_compacted_delta());
+  testing::MockFunction<absl::Status(DataRecordStruct)> record_callback;
+  EXPECT_CALL(record_callback, Call(deletion))
+      .Times(1)
+      .WillOnce([](DataRecordStruct) { return absl::OkStatus(); });
+  status = record_reader.ReadRecords(record_callback.AsStdFunction());
+  EXPECT_TRUE(status.ok()) << status;
+}
+
+TEST(SnapshotStreamWriterTest,
+     ValidateCreatingCompactedDeltaWriterWithInvalidMetadata) {
+  std::stringstream dest_stream;
+  auto metadata = GetCompactedDeltaMetadata();
+  metadata.mutable_compacted_delta()->set_starting_delta_file(
+      kBaseSnapshotFilename);
+  auto snapshot_writer =
+      SnapshotStreamWriter<>::Create({.metadata = metadata}, dest_stream);
+  EXPECT_EQ(snapshot_writer.status().code(),
+            absl::StatusCode::kInvalidArgument);
+  snapshot_writer = SnapshotStreamWriter<>::Create(
+      {.metadata = GetCompactedDeltaMetadata(), .key_index_block_size = 2},
+      dest_stream);
+  EXPECT_EQ(snapshot_writer.status().code(),
+            absl::StatusCode::kInvalidArgument);
+}
+
 TEST(SnapshotStreamWriterTest,
      ValidateCreatingSnapshotWriterWithValidMetadata) {
   std::stringstream dest_stream;
@@ -0,0 +1,202 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "public/query/cpp/async_grpc_client.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/log/check.h"
+#include "absl/status/status.h"
+#include "absl/time/clock.h"
+#include "grpcpp/alarm.h"
+
+namespace kv_server {
+
+struct AsyncGrpcClient::Attempt {
+  grpc::ClientContext context;
+  v2::GetValuesResponse response;
+};
+
+// Shared by the attempts of a call and the callers coalesced into it.
+struct AsyncGrpcClient::Call {
+  v2::GetValuesRequest request;
+  absl::Time deadline;
+  grpc::Alarm hedging_alarm;
+  absl::Mutex mutex;
+  bool done ABSL_GUARDED_BY(mutex) = false;
+  std::vector<Callback> callbacks ABSL_GUARDED_BY(mutex);
+  // Not added to once `done`.
+  std::vector<std::unique_ptr<Attempt>> attempts ABSL_GUARDED_BY(mutex);
+  int attempts_in_flight ABSL_GUARDED_BY(mutex) = 0;
+};
+
+std::vector<std::unique_ptr<v2::KeyValueService::StubInterface>>
+AsyncGrpcClient::CreateStubs(
+    const std::string& key_value_server_address,
+    std::shared_ptr<grpc::ChannelCredentials> credentials, int num_channels) {
+  std::vector<std::unique_ptr<v2::KeyValueService::StubInterface>> stubs;
+  for (int i = 0; i < num_channels; i++) {
+    grpc::ChannelArguments args;
+    // Channels share their connections to the same address otherwise.
+    args.SetInt(GRPC_ARG_USE_LOCAL_SUBCHANNEL_POOL, 1);
+    stubs.push_back(v2::KeyValueService::NewStub(grpc::CreateCustomChannel(
+        key_value_server_address, credentials, args)));
+  }
+  return stubs;
+}
+
+AsyncGrpcClient::AsyncGrpcClient(
+    std::vector<std::unique_ptr<v2::KeyValueService::StubInterface>> stubs,
+    Options options)
+    : stubs_(std::move(stubs)), options_(options) {
+  CHECK(!stubs_.empty()) << "AsyncGrpcClient needs at least one stub";
+}
+
+AsyncGrpcClient::~AsyncGrpcClient() {
+  absl::MutexLock lock(&mutex_);
+  mutex_.Await(absl::Condition(
+      +[](int64_t* tasks_in_flight) { return *tasks_in_flight == 0; },
+      &tasks_in_flight_));
+}
+
+void AsyncGrpcClient::GetValues(const v2::GetValuesRequest& request,
+                                Callback callback) {
+  auto call = std::make_shared<Call>();
+  if (options_.coalesce_requests) {
+    std::string coalescing_key = request.SerializeAsString();
+    absl::MutexLock lock(&mutex_);
+    if (const auto iter = coalesced_calls_.find(coalescing_key);
+        iter != coalesced_calls_.end()) {
+      absl::MutexLock call_lock(&iter->second->mutex);
+      if (!iter->second->done) {
+        iter->second->callbacks.push_back(std::move(callback));
+        return;
+      }
+    }
+    coalesced_calls_[std::move(coalescing_key)] = call;
+  }
+  call->request = request;
+  call->deadline = absl::Now() + options_.deadline;
+  {
+    absl::MutexLock lock(&call->mutex);
+    call->callbacks.push_back(std::move(callback));
+  }
+  StartAttempt(call);
+  if (options_.hedging_delay > absl::ZeroDuration()) {
+    StartTask();
+    call->hedging_alarm.Set(
+        absl::ToChronoTime(absl::Now() + options_.hedging_delay),
+        [this, weak_call = std::weak_ptr<Call>(call)](bool ok) {
+          // Not ok if cancelled once the call is done.
+          if (std::shared_ptr<Call> call = weak_call.lock(); ok && call) {
+            StartAttempt(call);
+          }
+          FinishTask();
+        });
+  }
+}
+
+std::future<absl::StatusOr<v2::GetValuesResponse>> AsyncGrpcClient::GetValues(
+    const v2::GetValuesRequest& request) {
+  auto promise = std::make_shared<
+      std::promise<absl::StatusOr<v2::GetValuesResponse>>>();
+  std::future<absl::StatusOr<v2::GetValuesResponse>> future =
+      promise->get_future();
+  GetValues(request,
+            [promise](absl::StatusOr<v2::GetValuesResponse> response) {
+              promise->set_value(std::move(response));
+            });
+  return future;
+}
+
+void AsyncGrpcClient::StartAttempt(const std::shared_ptr<Call>& call) {
+  auto attempt = std::make_unique<Attempt>();
+  attempt->context.set_deadline(absl::ToChronoTime(call->deadline));
+  Attempt* attempt_ptr = attempt.get();
+  {
+    absl::MutexLock lock(&call->mutex);
+    if (call->done) {
+      return;
+    }
+    call->attempts.push_back(std::move(attempt));
+    call->attempts_in_flight++;
+  }
+  StartTask();
+  stubs_[next_stub_++ % stubs_.size()]->async()->GetValues(
+      &attempt_ptr->context, &call->request, &attempt_ptr->response,
+      [this, call, attempt_ptr](grpc::Status status) {
+        OnAttemptDone(call, attempt_ptr, status);
+        FinishTask();
+      });
+}
+
+void AsyncGrpcClient::OnAttemptDone(const std::shared_ptr<Call>& call,
+                                    Attempt* attempt,
+                                    const grpc::Status& status) {
+  std::vector<Callback> callbacks;
+  absl::StatusOr<v2::GetValuesResponse> result;
+  {
+    absl::MutexLock lock(&call->mutex);
+    call->attempts_in_flight--;
+    // A failed attempt leaves the call to the other attempts in flight.
+    if (call->done || (!status.ok() && call->attempts_in_flight > 0)) {
+      return;
+    }
+    call->done = true;
+    callbacks = std::move(call->callbacks);
+    if (status.ok()) {
+      result = std::move(attempt->response);
+    } else {
+      result = absl::Status(static_cast<absl::StatusCode>(status.error_code()),
+                            status.error_message());
+    }
+  }
+  // `attempts` is not added to anymore. Cancelling may run the callbacks of
+  // the other attempts, so is done without holding the lock.
+  for (const auto& other_attempt : call->attempts) {
+    if (other_attempt.get() != attempt) {
+      other_attempt->context.TryCancel();
+    }
+  }
+  if (options_.hedging_delay > absl::ZeroDuration()) {
+    call->hedging_alarm.Cancel();
+  }
+  if (options_.coalesce_requests) {
+    absl::MutexLock lock(&mutex_);
+    if (const auto iter =
+            coalesced_calls_.find(call->request.SerializeAsString());
+        iter != coalesced_calls_.end() && iter->second == call) {
+      coalesced_calls_.erase(iter);
+    }
+  }
+  for (size_t i = 0; i + 1 < callbacks.size(); i++) {
+    std::move(callbacks[i])(result);
+  }
+  std::move(callbacks.back())(std::move(result));
+}
+
+void AsyncGrpcClient::StartTask() {
+  absl::MutexLock lock(&mutex_);
+  tasks_in_flight_++;
+}
+
+void AsyncGrpcClient::FinishTask() {
+  absl::MutexLock lock(&mutex_);
+  tasks_in_flight_--;
+}
+
+}  // namespace kv_server
@@ -0,0 +1,125 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PUBLIC_QUERY_CPP_ASYNC_GRPC_CLIENT_H_
+#define PUBLIC_QUERY_CPP_ASYNC_GRPC_CLIENT_H_
+
+#include <atomic>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/functional/any_invocable.h"
+#include "absl/status/statusor.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "grpcpp/grpcpp.h"
+#include "public/query/v2/get_values_v2.grpc.pb.h"
+
+namespace kv_server {
+
+// Asynchronous gRPC client. Sends requests without waiting for their
+// responses, so that one thread can issue many lookups at once. Requests are
+// spread over a pool of channels, round robin.
+//
+// Example usage:
+//
+// AsyncGrpcClient client(
+//     AsyncGrpcClient::CreateStubs("example.com:443",
+//         grpc::SslCredentials(grpc::SslCredentialsOptions()),
+//         /*num_channels=*/4));
+// client.GetValues(req, [](absl::StatusOr<v2::GetValuesResponse> response) {
+//   if (response.ok()) {
+//     ...
+//   }
+// });
+class AsyncGrpcClient {
+ public:
+  // Called once, on a gRPC thread, so must not block.
+  using Callback =
+      absl::AnyInvocable<void(absl::StatusOr<v2::GetValuesResponse>) &&>;
+
+  struct Options {
+    Options() {}
+    // Of a call, including its hedged attempts.
+    absl::Duration deadline = absl::Seconds(50);
+    // If positive, a call without a response after this delay is sent again
+    // on the next channel, and the first successful response is returned.
+    // Only for servers whose lookups are idempotent, which they are.
+    absl::Duration hedging_delay = absl::ZeroDuration();
+    // If true, a request equal to one in flight gets the response of the
+    // latter rather than being sent again.
+    bool coalesce_requests = false;
+  };
+
+  // Creates stubs of `num_channels` channels to `key_value_server_address`,
+  // each with a connection of its own, rather than a single connection that
+  // all calls are multiplexed on.
+  static std::vector<std::unique_ptr<v2::KeyValueService::StubInterface>>
+  CreateStubs(const std::string& key_value_server_address,
+              std::shared_ptr<grpc::ChannelCredentials> credentials,
+              int num_channels);
+
+  // `stubs` must not be empty.
+  explicit AsyncGrpcClient(
+      std::vector<std::unique_ptr<v2::KeyValueService::StubInterface>> stubs,
+      Options options = Options());
+
+  // Waits for the calls in flight.
+  ~AsyncGrpcClient() ABSL_LOCKS_EXCLUDED(mutex_);
+
+  AsyncGrpcClient(const AsyncGrpcClient&) = delete;
+  AsyncGrpcClient& operator=(const AsyncGrpcClient&) = delete;
+
+  // Sends `request` and calls `callback` with the response or an error.
+  void GetValues(const v2::GetValuesRequest& request, Callback callback)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Sends `request` and returns a future of the response or an error.
+  std::future<absl::StatusOr<v2::GetValuesResponse>> GetValues(
+      const v2::GetValuesRequest& request) ABSL_LOCKS_EXCLUDED(mutex_);
+
+ private:
+  struct Call;
+  struct Attempt;
+
+  void StartAttempt(const std::shared_ptr<Call>& call)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+  void OnAttemptDone(const std::shared_ptr<Call>& call, Attempt* attempt,
+                     const grpc::Status& status) ABSL_LOCKS_EXCLUDED(mutex_);
+  void StartTask() ABSL_LOCKS_EXCLUDED(mutex_);
+  void FinishTask() ABSL_LOCKS_EXCLUDED(mutex_);
+
+  const std::vector<std::unique_ptr<v2::KeyValueService::StubInterface>>
+      stubs_;
+  const Options options_;
+  std::atomic<uint64_t> next_stub_ = 0;
+
+  absl::Mutex mutex_;
+  // Attempts in flight and hedging timers set.
+  int64_t tasks_in_flight_ ABSL_GUARDED_BY(mutex_) = 0;
+  // Calls in flight by serialized request, if requests are coalesced.
+  absl::flat_hash_map<std::string, std::shared_ptr<Call>> coalesced_calls_
+      ABSL_GUARDED_BY(mutex_);
+};
+
+}  // namespace kv_server
+
+#endif  // PUBLIC_QUERY_CPP_ASYNC_GRPC_CLIENT_H_
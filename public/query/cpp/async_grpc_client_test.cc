@@ -0,0 +1,180 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "public/query/cpp/async_grpc_client.h"
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/synchronization/mutex.h"
+#include "absl/synchronization/notification.h"
+#include "gmock/gmock.h"
+#include "grpcpp/grpcpp.h"
+#include "gtest/gtest.h"
+
+namespace kv_server {
+namespace {
+
+// Responds with the client version of the request, or `status` if not ok. The
+// first `num_held_calls` calls are only responded to by `ReleaseHeldCalls`.
+class FakeKeyValueService : public v2::KeyValueService::CallbackService {
+ public:
+  grpc::ServerUnaryReactor* GetValues(
+      grpc::CallbackServerContext* context,
+      const v2::GetValuesRequest* request,
+      v2::GetValuesResponse* response) override {
+    response->mutable_single_partition()->set_string_output(
+        request->client_version());
+    grpc::ServerUnaryReactor* reactor = context->DefaultReactor();
+    absl::MutexLock lock(&mutex_);
+    if (++num_calls_ <= num_held_calls_) {
+      held_reactors_.push_back(reactor);
+    } else {
+      reactor->Finish(status_);
+    }
+    return reactor;
+  }
+
+  void ReleaseHeldCalls() {
+    absl::MutexLock lock(&mutex_);
+    for (grpc::ServerUnaryReactor* reactor : held_reactors_) {
+      reactor->Finish(status_);
+    }
+    held_reactors_.clear();
+  }
+
+  int num_calls() {
+    absl::MutexLock lock(&mutex_);
+    return num_calls_;
+  }
+
+  grpc::Status status_ = grpc::Status::OK;
+  int num_held_calls_ = 0;
+
+ private:
+  absl::Mutex mutex_;
+  int num_calls_ ABSL_GUARDED_BY(mutex_) = 0;
+  std::vector<grpc::ServerUnaryReactor*> held_reactors_ ABSL_GUARDED_BY(mutex_);
+};
+
+class AsyncGrpcClientTest : public ::testing::Test {
+ protected:
+  ~AsyncGrpcClientTest() {
+    service_.ReleaseHeldCalls();
+    client_.reset();
+    server_->Shutdown();
+    server_->Wait();
+  }
+
+  void StartClient(AsyncGrpcClient::Options options) {
+    grpc::ServerBuilder builder;
+    builder.RegisterService(&service_);
+    server_ = builder.BuildAndStart();
+    std::vector<std::unique_ptr<v2::KeyValueService::StubInterface>> stubs;
+    for (int i = 0; i < 2; i++) {
+      stubs.push_back(v2::KeyValueService::NewStub(
+          server_->InProcessChannel(grpc::ChannelArguments())));
+    }
+    client_ = std::make_unique<AsyncGrpcClient>(std::move(stubs), options);
+  }
+
+  static v2::GetValuesRequest CreateRequest() {
+    v2::GetValuesRequest request;
+    request.set_client_version("hello");
+    return request;
+  }
+
+  FakeKeyValueService service_;
+  std::unique_ptr<grpc::Server> server_;
+  std::unique_ptr<AsyncGrpcClient> client_;
+};
+
+TEST_F(AsyncGrpcClientTest, CallsCallbackWithResponse) {
+  StartClient(AsyncGrpcClient::Options());
+  absl::Notification done;
+  absl::StatusOr<v2::GetValuesResponse> response;
+  client_->GetValues(CreateRequest(),
+                     [&](absl::StatusOr<v2::GetValuesResponse> result) {
+                       response = std::move(result);
+                       done.Notify();
+                     });
+  done.WaitForNotification();
+  ASSERT_TRUE(response.ok()) << response.status();
+  EXPECT_EQ(response->single_partition().string_output(), "hello");
+}
+
+TEST_F(AsyncGrpcClientTest, ReturnsFutureOfResponses) {
+  StartClient(AsyncGrpcClient::Options());
+  std::vector<std::future<absl::StatusOr<v2::GetValuesResponse>>> futures;
+  for (int i = 0; i < 10; i++) {
+    futures.push_back(client_->GetValues(CreateRequest()));
+  }
+  for (auto& future : futures) {
+    absl::StatusOr<v2::GetValuesResponse> response = future.get();
+    ASSERT_TRUE(response.ok()) << response.status();
+    EXPECT_EQ(response->single_partition().string_output(), "hello");
+  }
+  EXPECT_EQ(service_.num_calls(), 10);
+}
+
+TEST_F(AsyncGrpcClientTest, ReturnsError) {
+  service_.status_ =
+      grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, "bad request");
+  StartClient(AsyncGrpcClient::Options());
+  absl::StatusOr<v2::GetValuesResponse> response =
+      client_->GetValues(CreateRequest()).get();
+  EXPECT_EQ(response.status().code(), absl::StatusCode::kInvalidArgument);
+  EXPECT_EQ(response.status().message(), "bad request");
+}
+
+TEST_F(AsyncGrpcClientTest, CoalescesEqualRequests) {
+  service_.num_held_calls_ = 1;
+  StartClient(AsyncGrpcClient::Options{.coalesce_requests = true});
+  auto future = client_->GetValues(CreateRequest());
+  auto coalesced_future = client_->GetValues(CreateRequest());
+  service_.ReleaseHeldCalls();
+  absl::StatusOr<v2::GetValuesResponse> response = future.get();
+  absl::StatusOr<v2::GetValuesResponse> coalesced_response =
+      coalesced_future.get();
+  ASSERT_TRUE(response.ok()) << response.status();
+  ASSERT_TRUE(coalesced_response.ok()) << coalesced_response.status();
+  EXPECT_EQ(coalesced_response->single_partition().string_output(), "hello");
+  EXPECT_EQ(service_.num_calls(), 1);
+  // Requests after the response are sent again.
+  EXPECT_TRUE(client_->GetValues(CreateRequest()).get().ok());
+  EXPECT_EQ(service_.num_calls(), 2);
+}
+
+TEST_F(AsyncGrpcClientTest, HedgesSlowCalls) {
+  service_.num_held_calls_ = 1;
+  StartClient(
+      AsyncGrpcClient::Options{.hedging_delay = absl::Milliseconds(10)});
+  absl::StatusOr<v2::GetValuesResponse> response =
+      client_->GetValues(CreateRequest()).get();
+  ASSERT_TRUE(response.ok()) << response.status();
+  EXPECT_EQ(response->single_partition().string_output(), "hello");
+  EXPECT_EQ(service_.num_calls(), 2);
+}
+
+TEST_F(AsyncGrpcClientTest, ReturnsDeadlineExceeded) {
+  service_.num_held_calls_ = 1;
+  StartClient(AsyncGrpcClient::Options{.deadline = absl::Milliseconds(100)});
+  absl::StatusOr<v2::GetValuesResponse> response =
+      client_->GetValues(CreateRequest()).get();
+  EXPECT_EQ(response.status().code(), absl::StatusCode::kDeadlineExceeded);
+}
+
+}  // namespace
+}  // namespace kv_server
@@ -16,30 +16,174 @@
 
 #include "public/sharding/key_sharder.h"
 
+#include <utility>
+
 namespace kv_server {
+namespace {
+
+constexpr std::string_view kRegexSpecialCharacters = "\\^$.|?*+()[]{}";
+
+// Parses a pattern of the form "^(.*)<delimiter>.*$", with optional anchors,
+// an optionally lazy first group and an optional group around the last
+// wildcard. Returns the delimiter and whether the group is lazy, or null for
+// other patterns.
+std::optional<std::pair<std::string, bool>> ParseDelimiterPattern(
+    std::string_view pattern) {
+  if (pattern.substr(0, 1) == "^") {
+    pattern.remove_prefix(1);
+  }
+  if (pattern.size() > 1 && pattern.back() == '$' &&
+      pattern[pattern.size() - 2] != '\\') {
+    pattern.remove_suffix(1);
+  }
+  bool lazy = false;
+  if (pattern.substr(0, 5) == "(.*?)") {
+    lazy = true;
+    pattern.remove_prefix(5);
+  } else if (pattern.substr(0, 4) == "(.*)") {
+    pattern.remove_prefix(4);
+  } else {
+    return std::nullopt;
+  }
+  if (pattern.size() >= 4 && pattern.substr(pattern.size() - 4) == "(.*)") {
+    pattern.remove_suffix(4);
+  } else if (pattern.size() >= 2 &&
+             pattern.substr(pattern.size() - 2) == ".*") {
+    pattern.remove_suffix(2);
+  } else {
+    return std::nullopt;
+  }
+  std::string delimiter;
+  for (size_t i = 0; i < pattern.size(); ++i) {
+    char c = pattern[i];
+    if (c == '\\') {
+      // Only escaped punctuation is literal, e.g. "\d" is a character class.
+      if (i + 1 == pattern.size() ||
+          kRegexSpecialCharacters.find(pattern[i + 1]) == std::string::npos) {
+        return std::nullopt;
+      }
+      c = pattern[++i];
+    } else if (kRegexSpecialCharacters.find(c) != std::string::npos) {
+      return std::nullopt;
+    }
+    delimiter.push_back(c);
+  }
+  if (delimiter.empty()) {
+    return std::nullopt;
+  }
+  return std::make_pair(std::move(delimiter), lazy);
+}
+
+}  // namespace
 
 KeySharder::KeySharder(ShardingFunction sharding_function,
-                       std::optional<std::regex> shard_key_regex)
+                       std::optional<std::regex> shard_key_regex,
+                       absl::flat_hash_set<std::string> replicated_keys,
+                       std::optional<LogicalShardMapping> logical_shard_mapping)
     : sharding_function_(std::move(sharding_function)),
-      shard_key_regex_(std::move(shard_key_regex)) {}
+      shard_key_regex_(std::move(shard_key_regex)) {
+  if (!replicated_keys.empty()) {
+    replicated_keys_ = std::make_shared<const absl::flat_hash_set<std::string>>(
+        std::move(replicated_keys));
+  }
+  if (logical_shard_mapping.has_value()) {
+    logical_shard_mapping_ = std::make_shared<const LogicalShardMapping>(
+        std::move(*logical_shard_mapping));
+  }
+}
+
+KeySharder::KeySharder(ShardingFunction sharding_function,
+                       std::string_view shard_key_pattern,
+                       absl::flat_hash_set<std::string> replicated_keys,
+                       std::optional<LogicalShardMapping> logical_shard_mapping)
+    : KeySharder(std::move(sharding_function),
+                 // https://en.cppreference.com/w/cpp/regex/syntax_option_type
+                 // optimize -- "Instructs the regular expression engine to
+                 // make matching faster, with the potential cost of making
+                 // construction slower."
+                 std::regex(std::string(shard_key_pattern),
+                            std::regex_constants::optimize),
+                 std::move(replicated_keys),
+                 std::move(logical_shard_mapping)) {
+  if (auto parsed = ParseDelimiterPattern(shard_key_pattern)) {
+    delimiter_extractor_ = DelimiterExtractor{
+        .delimiter = std::move(parsed->first), .lazy = parsed->second};
+  }
+}
+
+std::optional<std::string_view> KeySharder::GetShardingKey(
+    std::string_view key) const {
+  if (!shard_key_regex_.has_value()) {
+    return std::nullopt;
+  }
+  // The wildcards of the regex do not match line terminators, so keys with
+  // them are left to the regex.
+  if (delimiter_extractor_.has_value() &&
+      key.find_first_of("\n\r") == std::string_view::npos) {
+    const size_t pos = delimiter_extractor_->lazy
+                           ? key.find(delimiter_extractor_->delimiter)
+                           : key.rfind(delimiter_extractor_->delimiter);
+    if (pos == std::string_view::npos) {
+      return std::nullopt;
+    }
+    return key.substr(0, pos);
+  }
+  std::match_results<std::string_view::const_iterator> match_result;
+  if (!std::regex_match(key.begin(), key.end(), match_result,
+                        shard_key_regex_.value())) {
+    return std::nullopt;
+  }
+  return key.substr(match_result[1].first - key.begin(),
+                    match_result[1].length());
+}
+
+int KeySharder::GetShardNumForShardingKey(std::string_view sharding_key,
+                                          int num_shards) const {
+  if (logical_shard_mapping_ == nullptr) {
+    return sharding_function_.GetShardNumForKey(sharding_key, num_shards);
+  }
+  return logical_shard_mapping_->GetPhysicalShard(
+      sharding_function_.GetShardNumForKey(
+          sharding_key, logical_shard_mapping_->num_logical_shards()));
+}
 
 Shard KeySharder::GetShardNumForKey(std::string_view key,
                                     int num_shards) const {
-  if (shard_key_regex_.has_value()) {
-    std::smatch match_result;
-    // regex doesn't support string_view yet, though there is a proposal
-    auto key_string = std::string(key);
-    if (std::regex_match(key_string, match_result, shard_key_regex_.value())) {
-      // match result doesn't implicitly convert to std::string_view, and we
-      // also need to return it, so that the caller can log it.
-      std::string sharding_key = std::move(match_result[1]);
-      return Shard{.shard_num = sharding_function_.GetShardNumForKey(
-                       sharding_key, num_shards),
-                   .sharding_key = std::move(sharding_key)};
-    }
+  if (const auto sharding_key = GetShardingKey(key)) {
+    // Returns the sharding key too, so that the caller can log it.
+    return Shard{
+        .shard_num = GetShardNumForShardingKey(*sharding_key, num_shards),
+        .sharding_key = std::string(*sharding_key)};
   }
-  return Shard{.shard_num =
-                   sharding_function_.GetShardNumForKey(key, num_shards)};
+  return Shard{.shard_num = GetShardNumForShardingKey(key, num_shards)};
+}
+
+int KeySharder::GetShardNum(std::string_view key, int num_shards) const {
+  return GetShardNumForShardingKey(GetShardingKey(key).value_or(key),
+                                   num_shards);
+}
+
+int KeySharder::GetLogicalShardNum(std::string_view key) const {
+  if (logical_shard_mapping_ == nullptr) {
+    return -1;
+  }
+  return sharding_function_.GetShardNumForKey(
+      GetShardingKey(key).value_or(key),
+      logical_shard_mapping_->num_logical_shards());
+}
+
+std::vector<int> KeySharder::GetShardNumsForKeys(
+    absl::Span<const std::string_view> keys, int num_shards) const {
+  std::vector<int> shard_nums;
+  shard_nums.reserve(keys.size());
+  for (const std::string_view key : keys) {
+    shard_nums.push_back(GetShardNum(key, num_shards));
+  }
+  return shard_nums;
+}
+
+bool KeySharder::IsReplicated(std::string_view key) const {
+  return replicated_keys_ != nullptr && replicated_keys_->contains(key);
 }
 
 }  // namespace kv_server
@@ -17,11 +17,16 @@
 #ifndef PUBLIC_SHARDING_KEY_SHARDER_H_
 #define PUBLIC_SHARDING_KEY_SHARDER_H_
 
+#include <memory>
 #include <optional>
 #include <regex>
 #include <string>
 #include <string_view>
+#include <vector>
 
+#include "absl/container/flat_hash_set.h"
+#include "absl/types/span.h"
+#include "public/sharding/logical_shard_mapping.h"
 #include "public/sharding/sharding_function.h"
 
 namespace kv_server {
@@ -42,20 +47,76 @@ class KeySharder {
  public:
   // Constructs a key sharder that would calculate a shard number.
   // If `shard_key_regex` is set, data locality logic is applied during the
-  // calculation.
-  explicit KeySharder(ShardingFunction sharding_function,
-                      std::optional<std::regex> shard_key_regex = std::nullopt);
+  // calculation. `replicated_keys` are loaded by every shard, see
+  // `IsReplicated`. If `logical_shard_mapping` is set, keys are hashed into
+  // its logical shards, which are then mapped to the physical shards.
+  explicit KeySharder(
+      ShardingFunction sharding_function,
+      std::optional<std::regex> shard_key_regex = std::nullopt,
+      absl::flat_hash_set<std::string> replicated_keys = {},
+      std::optional<LogicalShardMapping> logical_shard_mapping = std::nullopt);
+  // Same as above, with the regex given by its pattern. Patterns of the form
+  // "^(.*)<delimiter>.*$", e.g. "^(.*)_.*$", with a literal delimiter and an
+  // optionally lazy first group, extract the sharding key by searching the
+  // delimiter instead of running the regex.
+  KeySharder(
+      ShardingFunction sharding_function, std::string_view shard_key_pattern,
+      absl::flat_hash_set<std::string> replicated_keys = {},
+      std::optional<LogicalShardMapping> logical_shard_mapping = std::nullopt);
   // Get a shard number for the given key.
   // If `shard_key_regex` is set, data locality logic is applied during the
   // calculation. Specifically, it would apply the regex to the key specified in
   // `GetShardNumForKey`. If there is a match, that would be treated as the
   // sharding key. Otherwise, the key itself is treated as the sharding
-  // key.
+  // key. With a logical shard mapping, `num_shards` must be its number of
+  // physical shards.
   Shard GetShardNumForKey(std::string_view key, int num_shards) const;
 
+  // Same as `GetShardNumForKey`, without copying the sharding key.
+  int GetShardNum(std::string_view key, int num_shards) const;
+
+  // Returns the shard number of every key of `keys`, in order.
+  std::vector<int> GetShardNumsForKeys(absl::Span<const std::string_view> keys,
+                                       int num_shards) const;
+
+  // Whether `key` is replicated to every shard, for keys requested so often
+  // that the shard they belong to would become a hotspot. Every shard loads
+  // replicated keys and looks them up locally.
+  bool IsReplicated(std::string_view key) const;
+
+  // Returns the logical shard of `key`, or -1 without a logical shard
+  // mapping.
+  int GetLogicalShardNum(std::string_view key) const;
+
+  // The logical shard mapping, or null if keys are hashed directly into the
+  // physical shards.
+  const std::shared_ptr<const LogicalShardMapping>& logical_shard_mapping()
+      const {
+    return logical_shard_mapping_;
+  }
+
  private:
+  // Finds the sharding key of a key by the last, or with a lazy group the
+  // first, occurrence of `delimiter`.
+  struct DelimiterExtractor {
+    std::string delimiter;
+    bool lazy;
+  };
+
+  // Returns the sharding key of `key`, or null if the regex does not match.
+  std::optional<std::string_view> GetShardingKey(std::string_view key) const;
+
+  // Returns the physical shard of `sharding_key`.
+  int GetShardNumForShardingKey(std::string_view sharding_key,
+                                int num_shards) const;
+
   ShardingFunction sharding_function_;
   std::optional<std::regex> shard_key_regex_;
+  // Set if the pattern of `shard_key_regex_` allows it.
+  std::optional<DelimiterExtractor> delimiter_extractor_;
+  // Shared by the copies of the sharder.
+  std::shared_ptr<const absl::flat_hash_set<std::string>> replicated_keys_;
+  std::shared_ptr<const LogicalShardMapping> logical_shard_mapping_;
 };
 
 }  // namespace kv_server
@@ -16,6 +16,9 @@
 
 #include "public/sharding/key_sharder.h"
 
+#include <string_view>
+#include <vector>
+
 #include "gtest/gtest.h"
 
 namespace kv_server {
@@ -47,7 +50,80 @@ TEST(KeySharderTest, VerifyAssigningKeysToShardsWithRegex) {
   EXPECT_EQ(1, key_sharder.GetShardNumForKey("key3", 7).shard_num);
 }
 
-// try with regex which doesn't match
+TEST(KeySharderTest, ReplicatedKeys) {
+  ShardingFunction func("");
+  KeySharder key_sharder(func, std::nullopt, {"hot1", "hot2"});
+  EXPECT_TRUE(key_sharder.IsReplicated("hot1"));
+  EXPECT_TRUE(key_sharder.IsReplicated("hot2"));
+  EXPECT_FALSE(key_sharder.IsReplicated("key1"));
+  KeySharder copy = key_sharder;
+  EXPECT_TRUE(copy.IsReplicated("hot1"));
+}
+
+TEST(KeySharderTest, NoReplicatedKeysByDefault) {
+  KeySharder key_sharder(ShardingFunction(""));
+  EXPECT_FALSE(key_sharder.IsReplicated("key1"));
+}
+
+TEST(KeySharderTest, PatternMatchesRegex) {
+  ShardingFunction func("");
+  KeySharder regex_sharder(func, std::regex("^(.*)_.*$"));
+  KeySharder pattern_sharder(func, "^(.*)_.*$");
+  for (std::string_view key :
+       {"key1_blah", "key1_blah_blah", "key1", "_", "key2_", "_key3", ""}) {
+    const auto expected = regex_sharder.GetShardNumForKey(key, 7);
+    const auto actual = pattern_sharder.GetShardNumForKey(key, 7);
+    EXPECT_EQ(expected.shard_num, actual.shard_num) << key;
+    EXPECT_EQ(expected.sharding_key, actual.sharding_key) << key;
+    EXPECT_EQ(expected.shard_num, pattern_sharder.GetShardNum(key, 7)) << key;
+  }
+}
+
+TEST(KeySharderTest, LazyPatternUsesFirstDelimiter) {
+  ShardingFunction func("");
+  KeySharder key_sharder(func, "^(.*?)::.*$");
+  auto result = key_sharder.GetShardNumForKey("key1::a::b", 7);
+  EXPECT_EQ(5, result.shard_num);
+  EXPECT_EQ("key1", result.sharding_key);
+}
+
+TEST(KeySharderTest, GeneralPatternFallsBackToRegex) {
+  ShardingFunction func("");
+  KeySharder key_sharder(func, "^([a-z]+[0-9])-.*$");
+  auto result = key_sharder.GetShardNumForKey("key2-blah", 7);
+  EXPECT_EQ(6, result.shard_num);
+  EXPECT_EQ("key2", result.sharding_key);
+}
+
+TEST(KeySharderTest, GetShardNumsForKeys) {
+  ShardingFunction func("");
+  KeySharder key_sharder(func, "^(.*)_.*$");
+  std::vector<std::string_view> keys = {"key1_a", "key2", "key3_b"};
+  EXPECT_EQ(key_sharder.GetShardNumsForKeys(keys, 7),
+            (std::vector<int>{5, 6, 1}));
+}
+
+TEST(KeySharderTest, LogicalShardMapping) {
+  ShardingFunction func("");
+  auto mapping = LogicalShardMapping::Create(7, 2, {{5, 1}, {6, 0}});
+  ASSERT_TRUE(mapping.ok()) << mapping.status();
+  KeySharder key_sharder(func, "^(.*)_.*$", {}, *std::move(mapping));
+  ASSERT_NE(key_sharder.logical_shard_mapping(), nullptr);
+  // "key1" is in logical shard 5 and "key2" in logical shard 6.
+  EXPECT_EQ(5, key_sharder.GetLogicalShardNum("key1_blah"));
+  EXPECT_EQ(1, key_sharder.GetShardNum("key1_blah", 2));
+  EXPECT_EQ(1, key_sharder.GetShardNumForKey("key1_blah", 2).shard_num);
+  EXPECT_EQ(6, key_sharder.GetLogicalShardNum("key2"));
+  EXPECT_EQ(0, key_sharder.GetShardNum("key2", 2));
+  EXPECT_EQ(key_sharder.GetShardNumsForKeys({"key1", "key2"}, 2),
+            (std::vector<int>{1, 0}));
+}
+
+TEST(KeySharderTest, NoLogicalShardsByDefault) {
+  KeySharder key_sharder(ShardingFunction(""));
+  EXPECT_EQ(key_sharder.logical_shard_mapping(), nullptr);
+  EXPECT_EQ(-1, key_sharder.GetLogicalShardNum("key1"));
+}
 
 }  // namespace
 }  // namespace kv_server
@@ -0,0 +1,110 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "public/sharding/logical_shard_mapping.h"
+
+#include <utility>
+
+#include "absl/status/status.h"
+#include "absl/strings/str_format.h"
+
+namespace kv_server {
+namespace {
+
+// Mixes the bits of the logical shard number, small numbers are poor keys
+// for the linear congruential generator of the jump consistent hash.
+uint64_t Mix(uint64_t x) {
+  x += 0x9e3779b97f4a7c15ULL;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+  return x ^ (x >> 31);
+}
+
+int JumpConsistentHash(uint64_t key, int num_buckets) {
+  int64_t bucket = -1;
+  int64_t next = 0;
+  while (next < num_buckets) {
+    bucket = next;
+    key = key * 2862933555777941757ULL + 1;
+    next = static_cast<int64_t>((bucket + 1) *
+                                (static_cast<double>(int64_t{1} << 31) /
+                                 static_cast<double>((key >> 33) + 1)));
+  }
+  return static_cast<int>(bucket);
+}
+
+}  // namespace
+
+LogicalShardMapping::LogicalShardMapping(std::vector<int> physical_shards,
+                                         int num_physical_shards)
+    : physical_shards_(std::move(physical_shards)),
+      num_physical_shards_(num_physical_shards) {}
+
+absl::StatusOr<LogicalShardMapping> LogicalShardMapping::Create(
+    int num_logical_shards, int num_physical_shards,
+    const absl::flat_hash_map<int32_t, int32_t>& overrides) {
+  if (num_physical_shards < 1 || num_logical_shards < num_physical_shards) {
+    return absl::InvalidArgumentError(absl::StrFormat(
+        "Cannot map %d logical shards to %d physical shards.",
+        num_logical_shards, num_physical_shards));
+  }
+  std::vector<int> physical_shards(num_logical_shards);
+  for (int logical_shard = 0; logical_shard < num_logical_shards;
+       ++logical_shard) {
+    physical_shards[logical_shard] =
+        JumpConsistentHash(Mix(logical_shard), num_physical_shards);
+  }
+  for (const auto& [logical_shard, physical_shard] : overrides) {
+    if (logical_shard < 0 || logical_shard >= num_logical_shards ||
+        physical_shard < 0 || physical_shard >= num_physical_shards) {
+      return absl::InvalidArgumentError(absl::StrFormat(
+          "Invalid mapping of logical shard %d to physical shard %d with %d "
+          "logical and %d physical shards.",
+          logical_shard, physical_shard, num_logical_shards,
+          num_physical_shards));
+    }
+    physical_shards[logical_shard] = physical_shard;
+  }
+  return LogicalShardMapping(std::move(physical_shards), num_physical_shards);
+}
+
+std::vector<int> LogicalShardMapping::GetLogicalShards(
+    int physical_shard) const {
+  std::vector<int> logical_shards;
+  for (int logical_shard = 0; logical_shard < num_logical_shards();
+       ++logical_shard) {
+    if (physical_shards_[logical_shard] == physical_shard) {
+      logical_shards.push_back(logical_shard);
+    }
+  }
+  return logical_shards;
+}
+
+bool MayHoldRecordsOfShard(const LogicalShardMapping* mapping,
+                           int64_t file_num_logical_shards,
+                           int64_t data_shard_num,
+                           int64_t physical_shard_num) {
+  const int64_t server_num_logical_shards =
+      mapping == nullptr ? 0 : mapping->num_logical_shards();
+  if (file_num_logical_shards != server_num_logical_shards) {
+    return true;
+  }
+  if (mapping == nullptr) {
+    return data_shard_num == physical_shard_num;
+  }
+  return data_shard_num >= 0 && data_shard_num < server_num_logical_shards &&
+         mapping->GetPhysicalShard(data_shard_num) == physical_shard_num;
+}
+
+}  // namespace kv_server
@@ -0,0 +1,80 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PUBLIC_SHARDING_LOGICAL_SHARD_MAPPING_H_
+#define PUBLIC_SHARDING_LOGICAL_SHARD_MAPPING_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/statusor.h"
+
+namespace kv_server {
+
+// Maps a fixed number of logical shards to the physical shards, i.e. the
+// servers. Keys are hashed into logical shards, so that changing the number
+// of physical shards only moves whole logical shards between them instead of
+// rehashing every key.
+//
+// Logical shards are assigned with a jump consistent hash
+// (https://arxiv.org/abs/1406.2294): going from n to n + 1 physical shards
+// only moves about 1 / (n + 1) of the logical shards, all of them to the new
+// physical shard. Assignments from `ShardMappingRecord`s take precedence.
+class LogicalShardMapping {
+ public:
+  // `overrides` maps logical shards to physical shards, e.g. as read from
+  // the `ShardMappingRecord`s of a logical sharding config file. Returns an
+  // error if a shard number is out of range or there are fewer logical than
+  // physical shards.
+  static absl::StatusOr<LogicalShardMapping> Create(
+      int num_logical_shards, int num_physical_shards,
+      const absl::flat_hash_map<int32_t, int32_t>& overrides = {});
+
+  int num_logical_shards() const { return physical_shards_.size(); }
+  int num_physical_shards() const { return num_physical_shards_; }
+
+  // Returns the physical shard of `logical_shard`, which must be in
+  // [0, num_logical_shards).
+  int GetPhysicalShard(int logical_shard) const {
+    return physical_shards_[logical_shard];
+  }
+
+  // Returns the logical shards assigned to `physical_shard`, in order.
+  std::vector<int> GetLogicalShards(int physical_shard) const;
+
+ private:
+  LogicalShardMapping(std::vector<int> physical_shards,
+                      int num_physical_shards);
+
+  // Physical shard of every logical shard.
+  std::vector<int> physical_shards_;
+  int num_physical_shards_;
+};
+
+// Whether the records of data shard `data_shard_num` of a file may belong to
+// physical shard `physical_shard_num`. `file_num_logical_shards` is the number
+// of logical shards the file was sharded into, or 0 if its data shards are
+// physical shards. `mapping` is the logical shard mapping of the server, or
+// null. If the file was sharded differently than the server shards its keys,
+// its records may belong to any shard.
+bool MayHoldRecordsOfShard(const LogicalShardMapping* mapping,
+                           int64_t file_num_logical_shards,
+                           int64_t data_shard_num, int64_t physical_shard_num);
+
+}  // namespace kv_server
+
+#endif  // PUBLIC_SHARDING_LOGICAL_SHARD_MAPPING_H_
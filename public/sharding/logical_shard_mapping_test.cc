@@ -0,0 +1,89 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "public/sharding/logical_shard_mapping.h"
+
+#include "gtest/gtest.h"
+
+namespace kv_server {
+namespace {
+
+TEST(LogicalShardMappingTest, MapsEveryLogicalShardToAPhysicalShard) {
+  auto mapping = LogicalShardMapping::Create(64, 3);
+  ASSERT_TRUE(mapping.ok()) << mapping.status();
+  EXPECT_EQ(mapping->num_logical_shards(), 64);
+  EXPECT_EQ(mapping->num_physical_shards(), 3);
+  int num_logical_shards = 0;
+  for (int physical_shard = 0; physical_shard < 3; ++physical_shard) {
+    const std::vector<int> logical_shards =
+        mapping->GetLogicalShards(physical_shard);
+    EXPECT_FALSE(logical_shards.empty());
+    for (const int logical_shard : logical_shards) {
+      EXPECT_EQ(mapping->GetPhysicalShard(logical_shard), physical_shard);
+    }
+    num_logical_shards += logical_shards.size();
+  }
+  EXPECT_EQ(num_logical_shards, 64);
+}
+
+TEST(LogicalShardMappingTest, AddingAPhysicalShardOnlyMovesShardsToIt) {
+  auto before = LogicalShardMapping::Create(1024, 4);
+  auto after = LogicalShardMapping::Create(1024, 5);
+  ASSERT_TRUE(before.ok() && after.ok());
+  int num_moved = 0;
+  for (int logical_shard = 0; logical_shard < 1024; ++logical_shard) {
+    if (before->GetPhysicalShard(logical_shard) !=
+        after->GetPhysicalShard(logical_shard)) {
+      EXPECT_EQ(after->GetPhysicalShard(logical_shard), 4);
+      ++num_moved;
+    }
+  }
+  // About a fifth of the logical shards move.
+  EXPECT_GT(num_moved, 1024 / 10);
+  EXPECT_LT(num_moved, 1024 * 3 / 10);
+}
+
+TEST(LogicalShardMappingTest, OverridesTakePrecedence) {
+  auto mapping = LogicalShardMapping::Create(8, 2, {{0, 1}, {1, 0}});
+  ASSERT_TRUE(mapping.ok()) << mapping.status();
+  EXPECT_EQ(mapping->GetPhysicalShard(0), 1);
+  EXPECT_EQ(mapping->GetPhysicalShard(1), 0);
+}
+
+TEST(LogicalShardMappingTest, RejectsInvalidMappings) {
+  EXPECT_FALSE(LogicalShardMapping::Create(2, 3).ok());
+  EXPECT_FALSE(LogicalShardMapping::Create(8, 0).ok());
+  EXPECT_FALSE(LogicalShardMapping::Create(8, 2, {{8, 0}}).ok());
+  EXPECT_FALSE(LogicalShardMapping::Create(8, 2, {{0, 2}}).ok());
+}
+
+TEST(LogicalShardMappingTest, MayHoldRecordsOfShard) {
+  auto mapping = LogicalShardMapping::Create(8, 2, {{3, 1}, {4, 0}});
+  ASSERT_TRUE(mapping.ok()) << mapping.status();
+  // Physical data shards.
+  EXPECT_TRUE(MayHoldRecordsOfShard(nullptr, 0, 1, 1));
+  EXPECT_FALSE(MayHoldRecordsOfShard(nullptr, 0, 0, 1));
+  // Logical data shards.
+  EXPECT_TRUE(MayHoldRecordsOfShard(&*mapping, 8, 3, 1));
+  EXPECT_FALSE(MayHoldRecordsOfShard(&*mapping, 8, 4, 1));
+  // Files sharded differently than the server may hold any key.
+  EXPECT_TRUE(MayHoldRecordsOfShard(&*mapping, 0, 4, 1));
+  EXPECT_TRUE(MayHoldRecordsOfShard(&*mapping, 16, 4, 1));
+  EXPECT_TRUE(MayHoldRecordsOfShard(nullptr, 8, 0, 1));
+}
+
+}  // namespace
+}  // namespace kv_server
@@ -16,13 +16,93 @@
 
 #include "public/sharding/sharding_function.h"
 
+#include <utility>
+
+#include "absl/numeric/int128.h"
+
 namespace kv_server {
+namespace {
+
+uint64_t RotateLeft(uint64_t x, int bits) {
+  return (x << bits) | (x >> (64 - bits));
+}
+
+void SipRound(uint64_t v[4]) {
+  v[0] += v[1];
+  v[1] = RotateLeft(v[1], 13);
+  v[1] ^= v[0];
+  v[0] = RotateLeft(v[0], 32);
+  v[2] += v[3];
+  v[3] = RotateLeft(v[3], 16);
+  v[3] ^= v[2];
+  v[0] += v[3];
+  v[3] = RotateLeft(v[3], 21);
+  v[3] ^= v[0];
+  v[2] += v[1];
+  v[1] = RotateLeft(v[1], 17);
+  v[1] ^= v[2];
+  v[2] = RotateLeft(v[2], 32);
+}
 
-ShardingFunction::ShardingFunction(std::string seed)
-    : hash_function_(std::move(seed)) {}
+uint64_t LoadLittleEndian64(const char* data) {
+  uint64_t word = 0;
+  for (int i = 7; i >= 0; --i) {
+    word = (word << 8) | static_cast<unsigned char>(data[i]);
+  }
+  return word;
+}
+
+// SipHash-2-4, see https://www.aumasson.jp/siphash/siphash.pdf.
+uint64_t SipHash24(const uint64_t key[2], std::string_view data) {
+  uint64_t v[4] = {key[0] ^ 0x736f6d6570736575ULL,
+                   key[1] ^ 0x646f72616e646f6dULL,
+                   key[0] ^ 0x6c7967656e657261ULL,
+                   key[1] ^ 0x7465646279746573ULL};
+  const size_t num_words = data.size() / 8;
+  for (size_t i = 0; i < num_words; ++i) {
+    const uint64_t word = LoadLittleEndian64(data.data() + i * 8);
+    v[3] ^= word;
+    SipRound(v);
+    SipRound(v);
+    v[0] ^= word;
+  }
+  uint64_t last = static_cast<uint64_t>(data.size()) << 56;
+  for (size_t i = num_words * 8; i < data.size(); ++i) {
+    last |= static_cast<uint64_t>(static_cast<unsigned char>(data[i]))
+            << (8 * (i - num_words * 8));
+  }
+  v[3] ^= last;
+  SipRound(v);
+  SipRound(v);
+  v[0] ^= last;
+  v[2] ^= 0xff;
+  for (int i = 0; i < 4; ++i) {
+    SipRound(v);
+  }
+  return v[0] ^ v[1] ^ v[2] ^ v[3];
+}
+
+}  // namespace
+
+ShardingFunction::ShardingFunction(std::string seed, ShardingHash hash)
+    : hash_(hash), hash_function_(seed) {
+  // Derives the SipHash key from the seed so that all components configured
+  // with the same seed agree on the shard of every key.
+  constexpr uint64_t kSeedKey[2] = {0, 0};
+  const uint64_t first = SipHash24(kSeedKey, seed);
+  const uint64_t second_key[2] = {first, 0};
+  sip_key_[0] = first;
+  sip_key_[1] = SipHash24(second_key, seed);
+}
 
 int ShardingFunction::GetShardNumForKey(std::string_view key,
                                         int num_shards) const {
+  if (hash_ == ShardingHash::kSipHash) {
+    // Maps the hash to [0, num_shards) with a multiplication, which is
+    // cheaper than a modulo.
+    return static_cast<int>(absl::Uint128High64(
+        absl::uint128(SipHash24(sip_key_, key)) * num_shards));
+  }
   return hash_function_(key, num_shards);
 }
 
@@ -17,6 +17,7 @@
 #ifndef PUBLIC_SHARDING_SHARDING_FUNCTION_H_
 #define PUBLIC_SHARDING_SHARDING_FUNCTION_H_
 
+#include <cstdint>
 #include <string>
 #include <string_view>
 
@@ -24,15 +25,30 @@
 
 namespace kv_server {
 
+// Hash functions that keys can be sharded with. Every component that shards
+// keys, i.e. the servers and the tools writing data files for a shard, must
+// use the same one.
+enum class ShardingHash {
+  // SHA-256 of the seed and the key.
+  kSha256,
+  // SipHash-2-4 of the key, keyed with the seed. Several times faster than
+  // `kSha256`, but assigns keys to different shards.
+  kSipHash,
+};
+
 // Sharding function to assign different keys to shard numbers within the range
 // [0, `num_shards`).
 class ShardingFunction {
  public:
-  explicit ShardingFunction(std::string seed);
+  explicit ShardingFunction(std::string seed,
+                            ShardingHash hash = ShardingHash::kSha256);
   int GetShardNumForKey(std::string_view key, int num_shards) const;
 
  private:
+  ShardingHash hash_;
   distributed_point_functions::SHA256HashFunction hash_function_;
+  // SipHash key, derived from the seed.
+  uint64_t sip_key_[2];
 };
 
 }  // namespace kv_server
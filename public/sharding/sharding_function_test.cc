@@ -16,6 +16,8 @@
 
 #include "public/sharding/sharding_function.h"
 
+#include <string>
+
 #include "gtest/gtest.h"
 
 namespace kv_server {
@@ -28,5 +30,21 @@ TEST(ShardingFunctionTest, VerifyAssigningKeysToShards) {
   EXPECT_EQ(1, func.GetShardNumForKey("key3", 7));
 }
 
+TEST(ShardingFunctionTest, VerifyAssigningKeysToShardsWithSipHash) {
+  ShardingFunction func("seed", ShardingHash::kSipHash);
+  EXPECT_EQ(3, func.GetShardNumForKey("key1", 7));
+  EXPECT_EQ(5, func.GetShardNumForKey("key2", 7));
+  EXPECT_EQ(0, func.GetShardNumForKey("key3", 7));
+}
+
+TEST(ShardingFunctionTest, SipHashShardsAreInRange) {
+  ShardingFunction func("", ShardingHash::kSipHash);
+  for (int i = 0; i < 1000; ++i) {
+    const int shard_num = func.GetShardNumForKey(std::to_string(i), 3);
+    EXPECT_GE(shard_num, 0);
+    EXPECT_LT(shard_num, 3);
+  }
+}
+
 }  // namespace
 }  // namespace kv_server
@@ -0,0 +1,128 @@
+/**
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * Decodes the elements returned by `runQueryBinary`, only when they are read.
+ *
+ * `runQueryBinary` returns a Uint8Array with every element of the query result
+ * preceded by its size in bytes, as a 32 bit little endian integer. Elements
+ * that are never read are never converted to strings.
+ *
+ * Example:
+ *   const result = new RunQueryBinaryResult(runQueryBinary(query));
+ *   for (let i = 0; i < result.size(); i++) {
+ *     if (result.getBytes(i).length > 0) {
+ *       use(result.get(i));
+ *     }
+ *   }
+ */
+class RunQueryBinaryResult {
+  /**
+   * @param {!Uint8Array} bytes Output of `runQueryBinary`.
+   */
+  constructor(bytes) {
+    /** @private @const {!Uint8Array} */
+    this.bytes_ = bytes;
+    /** @private @const {!Array<number>} Offset of every element. */
+    this.offsets_ = [];
+    let offset = 0;
+    while (offset + 4 <= bytes.length) {
+      const size =
+        (bytes[offset] | (bytes[offset + 1] << 8) | (bytes[offset + 2] << 16) | (bytes[offset + 3] << 24)) >>> 0;
+      offset += 4;
+      if (offset + size > bytes.length) {
+        break;
+      }
+      this.offsets_.push(offset);
+      offset += size;
+    }
+  }
+
+  /**
+   * @return {number} Number of elements.
+   */
+  size() {
+    return this.offsets_.length;
+  }
+
+  /**
+   * @param {number} i Index of the element.
+   * @return {!Uint8Array} The UTF-8 bytes of element `i`, without a copy.
+   */
+  getBytes(i) {
+    const offset = this.offsets_[i];
+    const bytes = this.bytes_;
+    const size =
+      (bytes[offset - 4] | (bytes[offset - 3] << 8) | (bytes[offset - 2] << 16) | (bytes[offset - 1] << 24)) >>> 0;
+    return bytes.subarray(offset, offset + size);
+  }
+
+  /**
+   * @param {number} i Index of the element.
+   * @return {string} Element `i`.
+   */
+  get(i) {
+    return decodeUtf8(this.getBytes(i));
+  }
+
+  /**
+   * @return {!Array<string>} All the elements.
+   */
+  toArray() {
+    const elements = new Array(this.size());
+    for (let i = 0; i < elements.length; i++) {
+      elements[i] = this.get(i);
+    }
+    return elements;
+  }
+}
+
+/**
+ * Decodes UTF-8 `bytes`, since UDFs don't have a TextDecoder.
+ *
+ * @param {!Uint8Array} bytes
+ * @return {string}
+ */
+function decodeUtf8(bytes) {
+  const codeUnits = [];
+  let i = 0;
+  while (i < bytes.length) {
+    const byte = bytes[i++];
+    let codePoint;
+    if (byte < 0x80) {
+      codePoint = byte;
+    } else if (byte < 0xe0) {
+      codePoint = ((byte & 0x1f) << 6) | (bytes[i++] & 0x3f);
+    } else if (byte < 0xf0) {
+      codePoint = ((byte & 0x0f) << 12) | ((bytes[i++] & 0x3f) << 6) | (bytes[i++] & 0x3f);
+    } else {
+      codePoint =
+        ((byte & 0x07) << 18) | ((bytes[i++] & 0x3f) << 12) | ((bytes[i++] & 0x3f) << 6) | (bytes[i++] & 0x3f);
+    }
+    if (codePoint > 0xffff) {
+      codePoint -= 0x10000;
+      codeUnits.push(0xd800 | (codePoint >> 10), 0xdc00 | (codePoint & 0x3ff));
+    } else {
+      codeUnits.push(codePoint);
+    }
+  }
+  let result = '';
+  // Stays below the argument limits of String.fromCharCode.
+  for (let start = 0; start < codeUnits.length; start += 4096) {
+    result += String.fromCharCode.apply(null, codeUnits.slice(start, start + 4096));
+  }
+  return result;
+}
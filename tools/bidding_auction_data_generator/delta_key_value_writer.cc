@@ -21,15 +21,18 @@
 
 namespace kv_server {
 absl::StatusOr<std::unique_ptr<DeltaKeyValueWriter>>
-DeltaKeyValueWriter::Create(std::ostream& output_stream) {
+DeltaKeyValueWriter::Create(std::ostream& output_stream, Options options) {
   KVFileMetadata metadata;
   auto delta_record_writer = DeltaRecordStreamWriter<std::ostream>::Create(
-      output_stream, DeltaRecordWriter::Options{.metadata = metadata});
+      output_stream, DeltaRecordWriter::Options{
+                         .metadata = metadata,
+                         .parallelism = options.parallelism,
+                     });
   if (!delta_record_writer.ok()) {
     return delta_record_writer.status();
   }
-  return absl::WrapUnique(
-      new DeltaKeyValueWriter(std::move(*delta_record_writer)));
+  return absl::WrapUnique(new DeltaKeyValueWriter(
+      std::move(*delta_record_writer), options.flush_on_write));
 }
 
 absl::Status DeltaKeyValueWriter::Write(
@@ -53,6 +56,13 @@ absl::Status DeltaKeyValueWriter::Write(
       return status;
     }
   }
+  if (!flush_on_write_) {
+    return absl::OkStatus();
+  }
+  return Flush();
+}
+
+absl::Status DeltaKeyValueWriter::Flush() {
   if (const auto status = delta_record_writer_->Flush(); !status.ok()) {
     LOG(ERROR) << "Failed to flush delta record writer";
     return status;
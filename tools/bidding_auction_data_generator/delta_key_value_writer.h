@@ -31,17 +31,30 @@ namespace kv_server {
 // stream
 class DeltaKeyValueWriter {
  public:
+  struct Options {
+    Options() {}
+    // If positive, records are encoded by this many background threads while
+    // the next ones are written.
+    int parallelism = 0;
+    // If true, every `Write` flushes the records to the output stream,
+    // otherwise only `Flush` does.
+    bool flush_on_write = true;
+  };
+
   static absl::StatusOr<std::unique_ptr<DeltaKeyValueWriter>> Create(
-      std::ostream& output_stream);
+      std::ostream& output_stream, Options options = Options());
   absl::Status Write(
       const absl::flat_hash_map<std::string, std::string>& key_value_map,
       int64_t logical_commit_time, KeyValueMutationType mutation_type);
+  absl::Status Flush();
 
  private:
-  explicit DeltaKeyValueWriter(
-      std::unique_ptr<DeltaRecordWriter> delta_record_writer)
-      : delta_record_writer_(std::move(delta_record_writer)) {}
+  DeltaKeyValueWriter(std::unique_ptr<DeltaRecordWriter> delta_record_writer,
+                      bool flush_on_write)
+      : delta_record_writer_(std::move(delta_record_writer)),
+        flush_on_write_(flush_on_write) {}
   std::unique_ptr<DeltaRecordWriter> delta_record_writer_;
+  const bool flush_on_write_;
 };
 
 }  // namespace kv_server
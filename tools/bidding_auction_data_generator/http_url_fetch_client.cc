@@ -17,14 +17,19 @@
 #include "tools/bidding_auction_data_generator/http_url_fetch_client.h"
 
 #include <string>
+#include <utility>
 #include <vector>
 
+#include "absl/container/node_hash_map.h"
 #include "absl/log/log.h"
 #include "absl/status/statusor.h"
 #include "curl/multi.h"
 
 namespace kv_server {
 namespace {
+// Time waited for activity on the transfers before performing them again.
+constexpr int kMultiWaitTimeoutMs = 100;
+
 // callback function to write the received data to the output
 // https://curl.se/libcurl/c/CURLOPT_WRITEFUNCTION.html
 static size_t WriteCallback(void* data, size_t size, size_t number_of_elements,
@@ -33,46 +38,86 @@ static size_t WriteCallback(void* data, size_t size, size_t number_of_elements,
                                                  size * number_of_elements);
   return size * number_of_elements;
 }
+
+struct Transfer {
+  int64_t url_index;
+  std::string response;
+};
 }  // namespace
 
 absl::StatusOr<std::vector<std::string>> HttpUrlFetchClient::FetchUrls(
     const std::vector<std::string>& urls, int64_t timeout_ms) {
   std::vector<std::string> responses(urls.size());
-  CURLM* multi_handle = curl_multi_init();
-  for (int i = 0; i < urls.size(); i++) {
-    VLOG(5) << "Request url: " << urls[i];
-    CURL* eh = curl_easy_init();
-    curl_easy_setopt(eh, CURLOPT_WRITEFUNCTION, WriteCallback);
-    curl_easy_setopt(eh, CURLOPT_WRITEDATA, &responses[i]);
-    curl_easy_setopt(eh, CURLOPT_URL, urls[i].c_str());
-    curl_easy_setopt(eh, CURLOPT_PRIVATE, urls[i].c_str());
-    curl_easy_setopt(eh, CURLOPT_TIMEOUT_MS, timeout_ms);
-    curl_multi_add_handle(multi_handle, eh);
+  if (absl::Status status = FetchUrlsStreamed(
+          urls, timeout_ms,
+          [&responses](int64_t url_index, std::string response) {
+            responses[url_index] = std::move(response);
+          });
+      !status.ok()) {
+    return status;
   }
-  // keep track of number of running handles
-  int still_running = 1;
-  while (still_running) {
+  return responses;
+}
+
+absl::Status HttpUrlFetchClient::FetchUrlsStreamed(
+    const std::vector<std::string>& urls, int64_t timeout_ms,
+    const ResponseCallback& callback) {
+  const int64_t max_requests_in_flight =
+      max_requests_in_flight_ > 0 ? max_requests_in_flight_ : urls.size();
+  CURLM* multi_handle = curl_multi_init();
+  // Transfers in flight, by easy handle. Nodes keep the responses in place
+  // while curl writes to them.
+  absl::node_hash_map<CURL*, Transfer> transfers;
+  int64_t next_url_index = 0;
+  absl::Status status;
+  while (status.ok() && (next_url_index < urls.size() || !transfers.empty())) {
+    while (next_url_index < urls.size() &&
+           transfers.size() < max_requests_in_flight) {
+      const std::string& url = urls[next_url_index];
+      VLOG(5) << "Request url: " << url;
+      CURL* eh = curl_easy_init();
+      Transfer& transfer = transfers[eh];
+      transfer.url_index = next_url_index++;
+      curl_easy_setopt(eh, CURLOPT_WRITEFUNCTION, WriteCallback);
+      curl_easy_setopt(eh, CURLOPT_WRITEDATA, &transfer.response);
+      curl_easy_setopt(eh, CURLOPT_URL, url.c_str());
+      curl_easy_setopt(eh, CURLOPT_TIMEOUT_MS, timeout_ms);
+      curl_multi_add_handle(multi_handle, eh);
+    }
+    int still_running;
+    curl_multi_perform(multi_handle, &still_running);
     CURLMsg* msg;
     int msg_in_queue;
-    curl_multi_perform(multi_handle, &still_running);
-    while ((msg = curl_multi_info_read(multi_handle, &msg_in_queue))) {
-      if (msg->msg == CURLMSG_DONE) {
-        if (msg->data.result != CURLE_OK) {
-          const auto error_msg = curl_easy_strerror(msg->data.result);
-          LOG(ERROR) << "Error in the curl handle: " << error_msg;
-          return absl::InternalError(error_msg);
-        }
-        CURL* eh = msg->easy_handle;
-        curl_multi_remove_handle(multi_handle, eh);
-        curl_easy_cleanup(eh);
-      } else {
-        return absl::InternalError(
+    while (status.ok() &&
+           (msg = curl_multi_info_read(multi_handle, &msg_in_queue))) {
+      if (msg->msg != CURLMSG_DONE) {
+        status = absl::InternalError(
             "Unable to read message from curl multi handle.");
+        break;
+      }
+      if (msg->data.result != CURLE_OK) {
+        const auto error_msg = curl_easy_strerror(msg->data.result);
+        LOG(ERROR) << "Error in the curl handle: " << error_msg;
+        status = absl::InternalError(error_msg);
+        break;
       }
+      CURL* eh = msg->easy_handle;
+      auto it = transfers.find(eh);
+      callback(it->second.url_index, std::move(it->second.response));
+      transfers.erase(it);
+      curl_multi_remove_handle(multi_handle, eh);
+      curl_easy_cleanup(eh);
     }
+    if (status.ok() && still_running > 0) {
+      curl_multi_wait(multi_handle, nullptr, 0, kMultiWaitTimeoutMs, nullptr);
+    }
+  }
+  for (auto& [eh, transfer] : transfers) {
+    curl_multi_remove_handle(multi_handle, eh);
+    curl_easy_cleanup(eh);
   }
   curl_multi_cleanup(multi_handle);
-  return responses;
+  return status;
 }
 
 }  // namespace kv_server
@@ -17,9 +17,12 @@
 #ifndef TOOLS_BIDDING_AUCTION_DATA_GENERATOR_HTTP_URL_FETCH_CLIENT_H_
 #define TOOLS_BIDDING_AUCTION_DATA_GENERATOR_HTTP_URL_FETCH_CLIENT_H_
 
+#include <cstdint>
+#include <functional>
 #include <string>
 #include <vector>
 
+#include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "curl/curl.h"
 
@@ -27,12 +30,30 @@ namespace kv_server {
 // Defines a class that sends http requests and fetches the responses
 class HttpUrlFetchClient {
  public:
-  HttpUrlFetchClient() { curl_global_init(CURL_GLOBAL_ALL); }
+  // Called with the index of a fetched url and its response.
+  using ResponseCallback =
+      std::function<void(int64_t url_index, std::string response)>;
+
+  // At most `max_requests_in_flight` requests are sent at once, or all of
+  // them if not positive.
+  explicit HttpUrlFetchClient(int max_requests_in_flight = 0)
+      : max_requests_in_flight_(max_requests_in_flight) {
+    curl_global_init(CURL_GLOBAL_ALL);
+  }
   virtual ~HttpUrlFetchClient() { curl_global_cleanup(); }
   // Sends http requests for the given urls and saves the response to the
   // response vector
   virtual absl::StatusOr<std::vector<std::string>> FetchUrls(
       const std::vector<std::string>& urls, int64_t timeout_ms);
+  // Sends http requests for the given urls and calls `callback` with each
+  // response as soon as it is received, so that responses are processed while
+  // the next ones are fetched. `callback` is called on the calling thread.
+  virtual absl::Status FetchUrlsStreamed(const std::vector<std::string>& urls,
+                                         int64_t timeout_ms,
+                                         const ResponseCallback& callback);
+
+ private:
+  const int max_requests_in_flight_;
 };
 
 }  // namespace kv_server
@@ -27,6 +27,8 @@
 #include "absl/log/log.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/synchronization/mutex.h"
+#include "components/util/thread_pool.h"
 #include "google/protobuf/util/json_util.h"
 #include "public/query/get_values.pb.h"
 #include "tools/bidding_auction_data_generator/value_fetch_util.h"
@@ -35,6 +37,28 @@ namespace kv_server {
 namespace {
 constexpr int64_t kTimeoutInMs = 5000;
 using v1::GetValuesResponse;
+
+// Parses `json_res` and extracts its key value pairs into `key_value_map` with
+// `callback`.
+void ParseResponse(
+    const std::string& json_res,
+    const std::function<
+        void(GetValuesResponse& response,
+             absl::flat_hash_map<std::string, std::string>& key_value_map)>&
+        callback,
+    absl::flat_hash_map<std::string, std::string>& key_value_map) {
+  google::protobuf::util::JsonParseOptions json_parse_options;
+  json_parse_options.ignore_unknown_fields = true;
+  GetValuesResponse response;
+  absl::Status status = google::protobuf::util::JsonStringToMessage(
+      json_res, &response, json_parse_options);
+  if (!status.ok()) {
+    LOG(ERROR) << "Unable to convert json response to GetValueResponse "
+               << status.ToString();
+  } else {
+    callback(response, key_value_map);
+  }
+}
 }  // namespace
 
 std::vector<std::string> HttpValueRetriever::GetBatchedUrls(
@@ -86,9 +110,6 @@ HttpValueRetriever::RetrieveValues(
   LOG(INFO) << "Retrieved values from " << urls.size() << " urls";
 
   // parse responses to get key value pairs in parallel with max threads allowed
-  google::protobuf::util::JsonParseOptions json_parse_options;
-  json_parse_options.ignore_unknown_fields = true;
-
   int max_thread_count = (int)std::thread::hardware_concurrency();
   int num_responses_processed = 0;
   while (num_responses_processed < responses.value().size()) {
@@ -99,19 +120,10 @@ HttpValueRetriever::RetrieveValues(
       int offset = i + num_responses_processed;
       const std::string& json_res =
           responses.value()[i + num_responses_processed];
-      threads.push_back(std::move(std::thread([json_res, callback, offset,
-                                               &json_parse_options, &output]() {
-        GetValuesResponse response;
-        absl::flat_hash_map<std::string, std::string> key_value_map;
-        absl::Status status = google::protobuf::util::JsonStringToMessage(
-            json_res, &response, json_parse_options);
-        if (!status.ok()) {
-          LOG(ERROR) << "Unable to convert json response to GetValueResponse "
-                     << status.ToString();
-        } else {
-          callback(response, output[offset]);
-        }
-      })));
+      threads.push_back(
+          std::move(std::thread([json_res, callback, offset, &output]() {
+            ParseResponse(json_res, callback, output[offset]);
+          })));
     }
     for (std::thread& thread : threads) {
       thread.join();
@@ -121,6 +133,45 @@ HttpValueRetriever::RetrieveValues(
   return output;
 }
 
+absl::Status HttpValueRetriever::StreamValues(
+    const absl::flat_hash_set<std::string>& keys, const std::string& base_url,
+    const std::string& key_namespace,
+    std::function<
+        void(GetValuesResponse& response,
+             absl::flat_hash_map<std::string, std::string>& key_value_map)>
+        callback,
+    bool need_encode, int num_keys_per_batch, int num_parsing_threads,
+    std::function<
+        absl::Status(const absl::flat_hash_map<std::string, std::string>&)>
+        output_callback) {
+  const std::vector<std::string> urls = GetBatchedUrls(
+      keys, key_namespace, base_url, need_encode, num_keys_per_batch);
+  absl::Mutex mutex;
+  absl::Status output_status;
+  absl::Status fetch_status;
+  {
+    ThreadPool parsing_pool(std::max(num_parsing_threads, 1));
+    fetch_status = http_url_fetch_client_.FetchUrlsStreamed(
+        urls, kTimeoutInMs,
+        [&](int64_t url_index, std::string json_res) {
+          parsing_pool.Schedule([&, json_res = std::move(json_res)]() {
+            absl::flat_hash_map<std::string, std::string> key_value_map;
+            ParseResponse(json_res, callback, key_value_map);
+            absl::MutexLock lock(&mutex);
+            if (output_status.ok()) {
+              output_status = output_callback(key_value_map);
+            }
+          });
+        });
+    // The pool runs the parsing tasks still queued before it is destroyed.
+  }
+  LOG(INFO) << "Retrieved values from " << urls.size() << " urls";
+  if (!fetch_status.ok()) {
+    return fetch_status;
+  }
+  return output_status;
+}
+
 std::unique_ptr<HttpValueRetriever> HttpValueRetriever::Create(
     HttpUrlFetchClient& http_url_fetch_client) {
   return std::make_unique<HttpValueRetriever>(http_url_fetch_client);
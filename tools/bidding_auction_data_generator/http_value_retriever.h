@@ -56,6 +56,21 @@ class HttpValueRetriever {
                          absl::flat_hash_map<std::string, std::string>&)>
           callback,
       bool need_encode, int num_keys_per_batch);
+  // Like `RetrieveValues`, but passes the key value map of each response to
+  // `output_callback` once it is parsed, rather than returning them all once
+  // every response is fetched. Responses are parsed on `num_parsing_threads`
+  // threads while the next ones are fetched. `output_callback` is called by
+  // one thread at a time, and stops the retrieval if it returns an error.
+  absl::Status StreamValues(
+      const absl::flat_hash_set<std::string>& keys, const std::string& base_url,
+      const std::string& key_namespace,
+      std::function<void(v1::GetValuesResponse&,
+                         absl::flat_hash_map<std::string, std::string>&)>
+          callback,
+      bool need_encode, int num_keys_per_batch, int num_parsing_threads,
+      std::function<absl::Status(
+          const absl::flat_hash_map<std::string, std::string>&)>
+          output_callback);
 
  private:
   HttpUrlFetchClient& http_url_fetch_client_;
@@ -19,6 +19,7 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "gtest/gtest.h"
 #include "tools/bidding_auction_data_generator/mocks.h"
@@ -168,5 +169,37 @@ TEST(HttpUrlFetchClientTest, SellerSkipEmptyValueTest) {
   EXPECT_THAT(seller_output.value()[0].find("url3")->second, R"(["v3"])");
 }
 
+TEST(HttpUrlFetchClientTest, StreamsParsedResponses) {
+  kv_server::MockHttpUrlFetchClient mock_http_url_fetch_client;
+  EXPECT_CALL(mock_http_url_fetch_client, FetchUrlsStreamed)
+      .WillOnce([](const std::vector<std::string>& urls, int64_t timeout_ms,
+                   const HttpUrlFetchClient::ResponseCallback& callback) {
+        EXPECT_EQ(urls.size(), 2);
+        callback(1, R"({"keys":{"key2": { "value": ["v2"] }}})");
+        callback(0, R"({"keys":{"key1": { "value": ["v1"] }}})");
+        return absl::OkStatus();
+      });
+
+  std::unique_ptr<kv_server::HttpValueRetriever> test_value_retriever =
+      HttpValueRetriever::Create(mock_http_url_fetch_client);
+  absl::flat_hash_set<std::string> keys = {"key1", "key2"};
+  absl::flat_hash_map<std::string, std::string> key_values;
+  int num_outputs = 0;
+  const absl::Status status = test_value_retriever->StreamValues(
+      keys, "https:://test_domain?", "keys",
+      kv_server::GetDataExtractorForKeys(), false, 1,
+      /*num_parsing_threads=*/2,
+      [&key_values, &num_outputs](
+          const absl::flat_hash_map<std::string, std::string>& output) {
+        num_outputs++;
+        key_values.insert(output.begin(), output.end());
+        return absl::OkStatus();
+      });
+  EXPECT_TRUE(status.ok()) << status;
+  EXPECT_EQ(num_outputs, 2);
+  EXPECT_EQ(key_values["key1"], R"(["v1"])");
+  EXPECT_EQ(key_values["key2"], R"(["v2"])");
+}
+
 }  // namespace
 }  // namespace kv_server
@@ -28,6 +28,9 @@ class MockHttpUrlFetchClient : public HttpUrlFetchClient {
  public:
   MOCK_METHOD(absl::StatusOr<std::vector<std::string>>, FetchUrls,
               (const std::vector<std::string>& urls, int64_t timeout_ms));
+  MOCK_METHOD(absl::Status, FetchUrlsStreamed,
+              (const std::vector<std::string>& urls, int64_t timeout_ms,
+               const ResponseCallback& callback));
 };
 }  // namespace kv_server
 
@@ -0,0 +1,401 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "tools/data_cli/commands/estimate_memory_command.h"
+
+#include <algorithm>
+#include <fstream>
+#include <functional>
+#include <string_view>
+
+#include "absl/container/flat_hash_set.h"
+#include "absl/hash/hash.h"
+#include "absl/log/log.h"
+#include "absl/memory/memory.h"
+#include "absl/numeric/bits.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "components/data_server/cache/cache.h"
+#include "components/data_server/cache/epoch_key_value_cache.h"
+#include "components/data_server/cache/key_value_cache.h"
+#include "public/data_loading/readers/delta_record_stream_reader.h"
+#include "public/data_loading/records_utils.h"
+#include "public/sharding/sharding_function.h"
+#include "tcmalloc/malloc_extension.h"
+
+namespace kv_server {
+namespace {
+
+constexpr double kBytesPerMib = 1024 * 1024;
+
+// A key-value mutation of a sampled key, copied out of its record.
+struct SampledMutation {
+  KeyValueMutationType mutation_type;
+  int64_t logical_commit_time;
+  std::string key;
+  Value value_type;
+  std::string value;
+  std::vector<std::string> set_values;
+  std::vector<uint32_t> uint32_set_values;
+};
+
+struct CacheRepresentation {
+  std::string_view description;
+  std::function<std::unique_ptr<Cache>()> create;
+};
+
+std::vector<CacheRepresentation> CacheRepresentations() {
+  return {
+      {"arena (default)", [] { return KeyValueCache::Create(); }},
+      {"arena, compressed values",
+       [] {
+         return KeyValueCache::Create(/*intern_set_values=*/false,
+                                      /*precompute_json_values=*/false,
+                                      /*compress_values=*/true);
+       }},
+      {"arena, interned set values",
+       [] { return KeyValueCache::Create(/*intern_set_values=*/true); }},
+      {"arena, deduplicated values",
+       [] {
+         return KeyValueCache::Create(/*intern_set_values=*/false,
+                                      /*precompute_json_values=*/false,
+                                      /*compress_values=*/false,
+                                      /*deduplicate_values=*/true);
+       }},
+      {"heap entries (epoch cache)",
+       [] { return EpochKeyValueCache::Create(); }},
+  };
+}
+
+std::optional<int64_t> GetAllocatedBytes() {
+  std::optional<size_t> bytes = tcmalloc::MallocExtension::GetNumericProperty(
+      "generic.current_allocated_bytes");
+  if (!bytes.has_value()) {
+    return std::nullopt;
+  }
+  return *bytes;
+}
+
+SampledMutation ToSampledMutation(const KeyValueMutationRecord& record) {
+  SampledMutation mutation{
+      .mutation_type = record.mutation_type(),
+      .logical_commit_time = record.logical_commit_time(),
+      .key = std::string(record.key()->string_view()),
+      .value_type = record.value_type(),
+  };
+  switch (record.value_type()) {
+    case Value::StringValue:
+      mutation.value = GetRecordValue<std::string_view>(record);
+      break;
+    case Value::StringSet:
+      for (std::string_view value :
+           GetRecordValue<std::vector<std::string_view>>(record)) {
+        mutation.set_values.emplace_back(value);
+      }
+      break;
+    case Value::UInt32Set:
+      mutation.uint32_set_values =
+          GetRecordValue<std::vector<uint32_t>>(record);
+      break;
+    default:
+      break;
+  }
+  return mutation;
+}
+
+void ApplyMutation(const SampledMutation& mutation, Cache& cache) {
+  const bool is_update = mutation.mutation_type == KeyValueMutationType::Update;
+  switch (mutation.value_type) {
+    case Value::StringValue:
+      if (is_update) {
+        cache.UpdateKeyValue(mutation.key, mutation.value,
+                             mutation.logical_commit_time);
+      } else {
+        cache.DeleteKey(mutation.key, mutation.logical_commit_time);
+      }
+      break;
+    case Value::StringSet: {
+      std::vector<std::string_view> values(mutation.set_values.begin(),
+                                           mutation.set_values.end());
+      if (is_update) {
+        cache.UpdateKeyValueSet(mutation.key, absl::MakeSpan(values),
+                                mutation.logical_commit_time);
+      } else {
+        cache.DeleteValuesInSet(mutation.key, absl::MakeSpan(values),
+                                mutation.logical_commit_time);
+      }
+      break;
+    }
+    case Value::UInt32Set:
+      if (is_update) {
+        cache.UpdateKeyValueUInt32Set(mutation.key,
+                                      mutation.uint32_set_values,
+                                      mutation.logical_commit_time);
+      } else {
+        cache.DeleteValuesInUInt32Set(mutation.key,
+                                      mutation.uint32_set_values,
+                                      mutation.logical_commit_time);
+      }
+      break;
+    default:
+      // Not supported by the caches.
+      break;
+  }
+}
+
+// Returns the heap bytes of a cache of `representation` holding `mutations`,
+// once the deleted values were cleaned up.
+std::optional<int64_t> MeasureCache(
+    const CacheRepresentation& representation,
+    const std::vector<SampledMutation>& mutations) {
+  const std::optional<int64_t> bytes_before = GetAllocatedBytes();
+  if (!bytes_before.has_value()) {
+    return std::nullopt;
+  }
+  std::unique_ptr<Cache> cache = representation.create();
+  int64_t max_logical_commit_time = 0;
+  for (const SampledMutation& mutation : mutations) {
+    ApplyMutation(mutation, *cache);
+    max_logical_commit_time =
+        std::max(max_logical_commit_time, mutation.logical_commit_time);
+  }
+  cache->RemoveDeletedKeys(max_logical_commit_time + 1);
+  return *GetAllocatedBytes() - *bytes_before;
+}
+
+std::string FormatMib(std::optional<int64_t> bytes) {
+  if (!bytes.has_value()) {
+    return "n/a";
+  }
+  return absl::StrFormat("%.1f MiB", *bytes / kBytesPerMib);
+}
+
+void WriteDistribution(
+    std::string_view name,
+    const EstimateMemoryCommand::SizeDistribution& distribution,
+    std::ostream& output_stream) {
+  output_stream << absl::StrFormat(
+      "%-16s count %d, mean %.1f, p50 <= %d, p90 <= %d, p99 <= %d, max %d\n",
+      name, distribution.count(), distribution.mean(),
+      distribution.Percentile(50), distribution.Percentile(90),
+      distribution.Percentile(99), distribution.max());
+}
+
+}  // namespace
+
+void EstimateMemoryCommand::SizeDistribution::Add(int64_t size) {
+  buckets_[absl::bit_width(static_cast<uint64_t>(size))]++;
+  count_++;
+  sum_ += size;
+  max_ = std::max(max_, size);
+}
+
+double EstimateMemoryCommand::SizeDistribution::mean() const {
+  return count_ == 0 ? 0 : static_cast<double>(sum_) / count_;
+}
+
+int64_t EstimateMemoryCommand::SizeDistribution::Percentile(
+    double percentile) const {
+  const double rank = count_ * percentile / 100;
+  int64_t num_sizes = 0;
+  for (size_t i = 0; i < buckets_.size(); i++) {
+    num_sizes += buckets_[i];
+    if (num_sizes > 0 && num_sizes >= rank) {
+      const int64_t upper_bound =
+          i == 0 ? 0 : static_cast<int64_t>((uint64_t{1} << i) - 1);
+      return std::min(upper_bound, max_);
+    }
+  }
+  return max_;
+}
+
+absl::StatusOr<std::unique_ptr<EstimateMemoryCommand>>
+EstimateMemoryCommand::Create(Params params, std::ostream& output_stream) {
+  if (params.input_files.empty()) {
+    return absl::InvalidArgumentError("At least one input file is required.");
+  }
+  if (params.sample_one_in_n_keys < 1) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("sample_one_in_n_keys must be positive, got ",
+                     params.sample_one_in_n_keys));
+  }
+  return absl::WrapUnique(
+      new EstimateMemoryCommand(std::move(params), output_stream));
+}
+
+absl::StatusOr<EstimateMemoryCommand::Estimate>
+EstimateMemoryCommand::EstimateMemory() {
+  Estimate estimate;
+  ShardingFunction sharding_function(/*seed=*/"",
+                                     params_.use_siphash_sharding
+                                         ? ShardingHash::kSipHash
+                                         : ShardingHash::kSha256);
+  estimate.shards.resize(std::max<int64_t>(params_.number_of_shards, 0));
+  std::vector<SampledMutation> sampled_mutations;
+  absl::flat_hash_set<std::string> sampled_keys;
+  const auto process_record = [&](const DataRecord& data_record) {
+    if (data_record.record_type() != Record::KeyValueMutationRecord) {
+      return absl::OkStatus();
+    }
+    const auto& record = *data_record.record_as_KeyValueMutationRecord();
+    const std::string_view key = record.key()->string_view();
+    estimate.num_records++;
+    if (record.mutation_type() == KeyValueMutationType::Update) {
+      estimate.num_updates++;
+      int64_t payload_bytes = key.size();
+      estimate.key_sizes.Add(key.size());
+      switch (record.value_type()) {
+        case Value::StringValue: {
+          const int64_t value_size =
+              GetRecordValue<std::string_view>(record).size();
+          estimate.value_sizes.Add(value_size);
+          payload_bytes += value_size;
+          break;
+        }
+        case Value::StringSet: {
+          const auto values =
+              GetRecordValue<std::vector<std::string_view>>(record);
+          estimate.set_sizes.Add(values.size());
+          for (std::string_view value : values) {
+            estimate.set_value_sizes.Add(value.size());
+            payload_bytes += value.size();
+          }
+          break;
+        }
+        case Value::UInt32Set: {
+          const auto values = GetRecordValue<std::vector<uint32_t>>(record);
+          estimate.set_sizes.Add(values.size());
+          payload_bytes += values.size() * sizeof(uint32_t);
+          break;
+        }
+        default:
+          break;
+      }
+      if (!estimate.shards.empty()) {
+        ShardEstimate& shard =
+            estimate.shards[sharding_function.GetShardNumForKey(
+                key, estimate.shards.size())];
+        shard.num_updates++;
+        shard.payload_bytes += payload_bytes;
+      }
+    } else {
+      estimate.num_deletes++;
+    }
+    // Sampled by key, so that all the mutations of a sampled key are applied.
+    if (absl::HashOf(key) % params_.sample_one_in_n_keys == 0) {
+      sampled_mutations.push_back(ToSampledMutation(record));
+      sampled_keys.emplace(key);
+    }
+    return absl::OkStatus();
+  };
+  for (const std::string& input_file : params_.input_files) {
+    std::ifstream input_stream(input_file);
+    if (!input_stream.is_open()) {
+      return absl::NotFoundError(absl::StrCat("Failed to open ", input_file));
+    }
+    LOG(INFO) << "Reading records of " << input_file;
+    DeltaRecordStreamReader record_reader(input_stream);
+    if (auto status = record_reader.ReadRecords(process_record); !status.ok()) {
+      return status;
+    }
+  }
+  estimate.num_sampled_keys = sampled_keys.size();
+  estimate.projected_num_keys =
+      estimate.num_sampled_keys * params_.sample_one_in_n_keys;
+  sampled_keys.clear();
+  for (const CacheRepresentation& representation : CacheRepresentations()) {
+    LOG(INFO) << "Measuring cache: " << representation.description;
+    CacheEstimate cache_estimate{
+        .representation = std::string(representation.description),
+        .sampled_bytes = MeasureCache(representation, sampled_mutations),
+    };
+    if (cache_estimate.sampled_bytes.has_value()) {
+      cache_estimate.projected_bytes =
+          *cache_estimate.sampled_bytes * params_.sample_one_in_n_keys;
+    }
+    estimate.caches.push_back(std::move(cache_estimate));
+  }
+  int64_t total_payload_bytes = 0;
+  for (const ShardEstimate& shard : estimate.shards) {
+    total_payload_bytes += shard.payload_bytes;
+  }
+  for (ShardEstimate& shard : estimate.shards) {
+    for (const CacheEstimate& cache_estimate : estimate.caches) {
+      std::optional<int64_t> shard_bytes;
+      if (cache_estimate.projected_bytes.has_value() &&
+          total_payload_bytes > 0) {
+        shard_bytes = *cache_estimate.projected_bytes *
+                      static_cast<double>(shard.payload_bytes) /
+                      total_payload_bytes;
+      }
+      shard.projected_bytes.push_back(shard_bytes);
+    }
+  }
+  return estimate;
+}
+
+absl::Status EstimateMemoryCommand::Execute() {
+  absl::StatusOr<Estimate> estimate = EstimateMemory();
+  if (!estimate.ok()) {
+    return estimate.status();
+  }
+  output_stream_ << absl::StrFormat(
+      "Key-value mutations: %d (%d updates, %d deletes)\n"
+      "Keys: about %d, %d sampled (one in %d)\n",
+      estimate->num_records, estimate->num_updates, estimate->num_deletes,
+      estimate->projected_num_keys, estimate->num_sampled_keys,
+      params_.sample_one_in_n_keys);
+  output_stream_ << "\nSizes of the updates:\n";
+  WriteDistribution("Key bytes", estimate->key_sizes, output_stream_);
+  WriteDistribution("Value bytes", estimate->value_sizes, output_stream_);
+  WriteDistribution("Set sizes", estimate->set_sizes, output_stream_);
+  WriteDistribution("Set value bytes", estimate->set_value_sizes,
+                    output_stream_);
+  output_stream_ << "\nProjected cache memory:\n";
+  for (const CacheEstimate& cache_estimate : estimate->caches) {
+    output_stream_ << absl::StrFormat(
+        "%-28s %s", cache_estimate.representation,
+        FormatMib(cache_estimate.projected_bytes));
+    if (cache_estimate.sampled_bytes.has_value() &&
+        estimate->num_sampled_keys > 0) {
+      output_stream_ << absl::StrFormat(
+          ", %.1f bytes/key",
+          static_cast<double>(*cache_estimate.sampled_bytes) /
+              estimate->num_sampled_keys);
+    }
+    output_stream_ << "\n";
+  }
+  if (!estimate->caches.empty() &&
+      !estimate->caches.front().projected_bytes.has_value()) {
+    output_stream_ << "Heap usage can only be measured with tcmalloc.\n";
+  }
+  for (size_t i = 0; i < estimate->shards.size(); i++) {
+    const ShardEstimate& shard = estimate->shards[i];
+    output_stream_ << absl::StrFormat(
+        "\nShard %d of %d: %d updates, %s of keys and values\n", i,
+        estimate->shards.size(), shard.num_updates,
+        FormatMib(shard.payload_bytes));
+    for (size_t j = 0; j < estimate->caches.size(); j++) {
+      output_stream_ << absl::StrFormat("  %-26s %s\n",
+                                        estimate->caches[j].representation,
+                                        FormatMib(shard.projected_bytes[j]));
+    }
+  }
+  return absl::OkStatus();
+}
+
+}  // namespace kv_server
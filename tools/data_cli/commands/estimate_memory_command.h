@@ -0,0 +1,139 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef TOOLS_DATA_CLI_COMMANDS_ESTIMATE_MEMORY_COMMAND_H_
+#define TOOLS_DATA_CLI_COMMANDS_ESTIMATE_MEMORY_COMMAND_H_
+
+#include <array>
+#include <memory>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "tools/data_cli/commands/command.h"
+
+namespace kv_server {
+
+// An `EstimateMemoryCommand` reads the records of a snapshot, or of a snapshot
+// followed by delta files, and estimates how much memory a server needs to
+// hold them in each representation of the cache, without loading all of them.
+// Keys are sampled by hash, and the records of the sampled keys are loaded
+// into each representation in turn. Their heap usage, as measured by tcmalloc,
+// is then scaled by the sampling rate. Also reports the size distributions of
+// the keys and values, and the memory of each shard of `number_of_shards`.
+//
+// The command can be used as follows:
+// ```
+// auto command = EstimateMemoryCommand::Create(
+//     {.input_files = {"SNAPSHOT_0000000000000001"}, .number_of_shards = 4},
+//     std::cout);
+// if (command.ok()) {
+//   auto status = (*command)->Execute();
+// }
+// ```
+class EstimateMemoryCommand : public Command {
+ public:
+  struct Params {
+    // Snapshot and delta files, applied in this order.
+    std::vector<std::string> input_files;
+    // The records of one in this many keys are loaded into the caches. Larger
+    // values use less memory and time, but give rougher estimates.
+    int64_t sample_one_in_n_keys = 10;
+    // If positive, the memory of each shard is estimated too.
+    int64_t number_of_shards = -1;
+    // Must match the use-siphash-sharding parameter of the servers.
+    bool use_siphash_sharding = false;
+  };
+
+  // Distribution of sizes, counted in buckets of powers of two.
+  class SizeDistribution {
+   public:
+    void Add(int64_t size);
+    int64_t count() const { return count_; }
+    int64_t max() const { return max_; }
+    double mean() const;
+    // Returns an upper bound of the `percentile` of the sizes, the upper end
+    // of its bucket.
+    int64_t Percentile(double percentile) const;
+
+   private:
+    // Bucket `i > 0` counts the sizes in [2^(i-1), 2^i).
+    std::array<int64_t, 65> buckets_ = {};
+    int64_t count_ = 0;
+    int64_t sum_ = 0;
+    int64_t max_ = 0;
+  };
+
+  struct CacheEstimate {
+    // Description of the cache representation.
+    std::string representation;
+    // Heap bytes of the cache of the sampled keys, unset if heap usage cannot
+    // be measured, i.e., without tcmalloc.
+    std::optional<int64_t> sampled_bytes;
+    // Heap bytes of the cache of all keys.
+    std::optional<int64_t> projected_bytes;
+  };
+
+  struct ShardEstimate {
+    int64_t num_updates = 0;
+    // Bytes of the keys and values of the updates.
+    int64_t payload_bytes = 0;
+    // Heap bytes of each representation of `Estimate::caches`, in the same
+    // order, assuming that memory is proportional to `payload_bytes`.
+    std::vector<std::optional<int64_t>> projected_bytes;
+  };
+
+  struct Estimate {
+    int64_t num_records = 0;
+    int64_t num_updates = 0;
+    int64_t num_deletes = 0;
+    int64_t num_sampled_keys = 0;
+    int64_t projected_num_keys = 0;
+    // Of the updates.
+    SizeDistribution key_sizes;
+    SizeDistribution value_sizes;
+    // Number of values of set updates.
+    SizeDistribution set_sizes;
+    SizeDistribution set_value_sizes;
+    std::vector<CacheEstimate> caches;
+    std::vector<ShardEstimate> shards;
+  };
+
+  static absl::StatusOr<std::unique_ptr<EstimateMemoryCommand>> Create(
+      Params params, std::ostream& output_stream);
+
+  // Reads the input files and returns the estimate.
+  absl::StatusOr<Estimate> EstimateMemory();
+
+  // Writes a report of the estimate to the output stream.
+  absl::Status Execute() override;
+
+ private:
+  EstimateMemoryCommand(Params params, std::ostream& output_stream)
+      : params_(std::move(params)), output_stream_(output_stream) {}
+
+  Params params_;
+  std::ostream& output_stream_;
+};
+
+}  //  namespace kv_server
+
+#endif  // TOOLS_DATA_CLI_COMMANDS_ESTIMATE_MEMORY_COMMAND_H_
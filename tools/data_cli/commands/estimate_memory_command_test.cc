@@ -0,0 +1,156 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "tools/data_cli/commands/estimate_memory_command.h"
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "public/data_loading/writers/delta_record_stream_writer.h"
+
+namespace kv_server {
+namespace {
+
+DataRecordStruct GetDataRecord(std::string_view key,
+                               KeyValueMutationRecordValueT value,
+                               KeyValueMutationType mutation_type =
+                                   KeyValueMutationType::Update) {
+  KeyValueMutationRecordStruct record;
+  record.key = key;
+  record.value = value;
+  record.logical_commit_time = 1234567890;
+  record.mutation_type = mutation_type;
+  DataRecordStruct data_record;
+  data_record.record = record;
+  return data_record;
+}
+
+std::string WriteDeltaFile(std::string_view name,
+                           const std::vector<DataRecordStruct>& records) {
+  std::stringstream delta_stream;
+  auto delta_writer = DeltaRecordStreamWriter<std::stringstream>::Create(
+      delta_stream, DeltaRecordWriter::Options{.metadata = KVFileMetadata()});
+  EXPECT_TRUE(delta_writer.ok()) << delta_writer.status();
+  for (const auto& record : records) {
+    EXPECT_TRUE((*delta_writer)->WriteRecord(record).ok());
+  }
+  (*delta_writer)->Close();
+  const std::string path = absl::StrCat(::testing::TempDir(), "/", name);
+  std::ofstream file(path);
+  file << delta_stream.str();
+  return path;
+}
+
+std::vector<std::string> WriteInputFiles() {
+  std::vector<DataRecordStruct> snapshot_records;
+  for (int i = 0; i < 100; i++) {
+    snapshot_records.push_back(
+        GetDataRecord(absl::StrCat("key", i), "value"));
+  }
+  for (int i = 0; i < 10; i++) {
+    snapshot_records.push_back(
+        GetDataRecord(absl::StrCat("set", i),
+                      std::vector<std::string_view>{"a", "bb", "ccc"}));
+  }
+  std::vector<DataRecordStruct> delta_records;
+  for (int i = 0; i < 5; i++) {
+    delta_records.push_back(GetDataRecord(absl::StrCat("key", i), "",
+                                          KeyValueMutationType::Delete));
+  }
+  return {WriteDeltaFile("SNAPSHOT_0000000000000001", snapshot_records),
+          WriteDeltaFile("DELTA_0000000000000002", delta_records)};
+}
+
+TEST(EstimateMemoryCommandTest, RejectsInvalidParams) {
+  std::stringstream output;
+  EXPECT_FALSE(EstimateMemoryCommand::Create({}, output).ok());
+  EXPECT_FALSE(EstimateMemoryCommand::Create(
+                   {.input_files = {"SNAPSHOT_0000000000000001"},
+                    .sample_one_in_n_keys = 0},
+                   output)
+                   .ok());
+}
+
+TEST(EstimateMemoryCommandTest, CountsRecordsAndSizes) {
+  std::stringstream output;
+  auto command = EstimateMemoryCommand::Create(
+      {.input_files = WriteInputFiles(),
+       .sample_one_in_n_keys = 1,
+       .number_of_shards = 2},
+      output);
+  ASSERT_TRUE(command.ok()) << command.status();
+  auto estimate = (*command)->EstimateMemory();
+  ASSERT_TRUE(estimate.ok()) << estimate.status();
+  EXPECT_EQ(estimate->num_records, 115);
+  EXPECT_EQ(estimate->num_updates, 110);
+  EXPECT_EQ(estimate->num_deletes, 5);
+  EXPECT_EQ(estimate->num_sampled_keys, 110);
+  EXPECT_EQ(estimate->projected_num_keys, 110);
+  EXPECT_EQ(estimate->key_sizes.count(), 110);
+  EXPECT_EQ(estimate->key_sizes.max(), 5);
+  EXPECT_EQ(estimate->value_sizes.count(), 100);
+  EXPECT_EQ(estimate->value_sizes.Percentile(50), 5);
+  EXPECT_EQ(estimate->set_sizes.count(), 10);
+  EXPECT_EQ(estimate->set_value_sizes.count(), 30);
+  EXPECT_DOUBLE_EQ(estimate->set_value_sizes.mean(), 2);
+  EXPECT_EQ(estimate->caches.size(), 5);
+  ASSERT_EQ(estimate->shards.size(), 2);
+  EXPECT_EQ(estimate->shards[0].num_updates + estimate->shards[1].num_updates,
+            110);
+  for (const auto& shard : estimate->shards) {
+    EXPECT_EQ(shard.projected_bytes.size(), estimate->caches.size());
+  }
+}
+
+TEST(EstimateMemoryCommandTest, SamplesKeys) {
+  std::stringstream output;
+  auto command = EstimateMemoryCommand::Create(
+      {.input_files = WriteInputFiles(), .sample_one_in_n_keys = 4}, output);
+  ASSERT_TRUE(command.ok()) << command.status();
+  auto estimate = (*command)->EstimateMemory();
+  ASSERT_TRUE(estimate.ok()) << estimate.status();
+  EXPECT_LT(estimate->num_sampled_keys, 110);
+  EXPECT_EQ(estimate->projected_num_keys, estimate->num_sampled_keys * 4);
+  EXPECT_TRUE(estimate->shards.empty());
+}
+
+TEST(EstimateMemoryCommandTest, WritesReport) {
+  std::stringstream output;
+  auto command = EstimateMemoryCommand::Create(
+      {.input_files = WriteInputFiles(), .number_of_shards = 2}, output);
+  ASSERT_TRUE(command.ok()) << command.status();
+  EXPECT_TRUE((*command)->Execute().ok());
+  EXPECT_THAT(output.str(), testing::HasSubstr("Key-value mutations: 115"));
+  EXPECT_THAT(output.str(), testing::HasSubstr("Shard 1 of 2"));
+}
+
+TEST(EstimateMemoryCommandTest, MissingInputFileFails) {
+  std::stringstream output;
+  auto command = EstimateMemoryCommand::Create(
+      {.input_files = {absl::StrCat(::testing::TempDir(), "/missing")}},
+      output);
+  ASSERT_TRUE(command.ok()) << command.status();
+  EXPECT_FALSE((*command)->EstimateMemory().ok());
+}
+
+}  // namespace
+}  // namespace kv_server
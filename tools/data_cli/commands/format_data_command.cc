@@ -16,8 +16,11 @@
 
 #include "tools/data_cli/commands/format_data_command.h"
 
+#include <deque>
+#include <future>
 #include <memory>
 #include <utility>
+#include <vector>
 
 #include "absl/memory/memory.h"
 #include "absl/status/status.h"
@@ -26,6 +29,7 @@
 #include "absl/strings/str_cat.h"
 #include "public/data_loading/csv/csv_delta_record_stream_reader.h"
 #include "public/data_loading/csv/csv_delta_record_stream_writer.h"
+#include "public/data_loading/csv/parallel_csv_delta_record_stream_reader.h"
 #include "public/data_loading/readers/avro_delta_record_stream_reader.h"
 #include "public/data_loading/readers/delta_record_stream_reader.h"
 #include "public/data_loading/writers/avro_delta_record_stream_writer.h"
@@ -47,6 +51,33 @@ constexpr std::string_view kEncodingPlaintext = "plaintext";
 constexpr std::string_view kEncodingBase64 = "base64";
 constexpr double kSamplingThreshold = 0.02;
 constexpr std::string_view kShardMappingRecord = "shard_mapping_record";
+// Records converted together by a worker thread.
+constexpr int kConversionBatchSize = 1024;
+
+// Records of a batch serialized as verified `DataRecord` flatbuffers.
+struct ConvertedBatch {
+  std::vector<flatbuffers::FlatBufferBuilder> records;
+  absl::Status status;
+};
+
+// Serializes `records` and verifies them, as the writers expect valid
+// records. Records that fail verification are dropped with an error status.
+ConvertedBatch ConvertBatch(std::vector<std::unique_ptr<DataRecordT>> records) {
+  ConvertedBatch batch;
+  batch.records.reserve(records.size());
+  for (const auto& record : records) {
+    auto [fbs_buffer, serialized_string_view] = Serialize(*record);
+    if (absl::Status status = DeserializeDataRecord(
+            serialized_string_view,
+            [](const DataRecord&) { return absl::OkStatus(); });
+        !status.ok()) {
+      batch.status.Update(status);
+      continue;
+    }
+    batch.records.push_back(std::move(fbs_buffer));
+  }
+  return batch;
+}
 
 absl::Status ValidateParams(const FormatDataCommand::Params& params) {
   if (params.input_format.empty()) {
@@ -64,6 +95,10 @@ absl::Status ValidateParams(const FormatDataCommand::Params& params) {
         "Input and output format must be different. Input format: ",
         params.input_format, " Output format: ", params.output_format));
   }
+  if (params.num_threads < 1) {
+    return absl::InvalidArgumentError(absl::StrCat(
+        "Number of threads must be at least 1, got ", params.num_threads));
+  }
   if (params.shard_number >= 0 &&
       params.number_of_shards <= params.shard_number) {
     return absl::InvalidArgumentError(absl::StrCat(
@@ -123,13 +158,22 @@ absl::StatusOr<std::unique_ptr<DeltaRecordReader>> CreateRecordReader(
   if (lw_input_format == kCsvFormat) {
     PS_ASSIGN_OR_RETURN(auto record_type, GetRecordKind(params.record_type));
     PS_ASSIGN_OR_RETURN(auto csv_encoding, GetCsvEncoding(params.csv_encoding));
+    CsvDeltaRecordStreamReader<std::istream>::Options csv_options{
+        .field_separator = params.csv_column_delimiter,
+        .value_separator = params.csv_value_delimiter,
+        .record_type = std::move(record_type),
+        .csv_encoding = std::move(csv_encoding),
+    };
+    if (params.num_threads > 1) {
+      return std::make_unique<ParallelCsvDeltaRecordStreamReader<std::istream>>(
+          input_stream,
+          ParallelCsvDeltaRecordStreamReader<std::istream>::Options{
+              .csv_options = std::move(csv_options),
+              .num_worker_threads = params.num_threads,
+          });
+    }
     return std::make_unique<CsvDeltaRecordStreamReader<std::istream>>(
-        input_stream, CsvDeltaRecordStreamReader<std::istream>::Options{
-                          .field_separator = params.csv_column_delimiter,
-                          .value_separator = params.csv_value_delimiter,
-                          .record_type = std::move(record_type),
-                          .csv_encoding = std::move(csv_encoding),
-                      });
+        input_stream, std::move(csv_options));
   }
   if (lw_input_format == kDeltaFormat) {
     return std::make_unique<DeltaRecordStreamReader<std::istream>>(
@@ -164,9 +208,15 @@ absl::StatusOr<std::unique_ptr<DeltaRecordWriter>> CreateRecordWriter(
     if (params.shard_number >= 0) {
       auto* shard_metadata = metadata.mutable_sharding_metadata();
       shard_metadata->set_shard_num(params.shard_number);
+      if (params.logical_shards) {
+        shard_metadata->set_num_logical_shards(params.number_of_shards);
+      }
     }
     return DeltaRecordStreamWriter<std::ostream>::Create(
-        output_stream, DeltaRecordWriter::Options{.metadata = metadata});
+        output_stream,
+        DeltaRecordWriter::Options{
+            .metadata = metadata,
+            .parallelism = params.num_threads > 1 ? params.num_threads : 0});
   }
   if (lw_output_format == kAvroFormat) {
     auto delta_record_writer = AvroDeltaRecordStreamWriter::Create(
@@ -203,9 +253,45 @@ absl::StatusOr<std::unique_ptr<FormatDataCommand>> FormatDataCommand::Create(
 absl::Status FormatDataCommand::Execute() {
   LOG(INFO) << "Formatting records ...";
   int64_t records_count = 0;
-  ShardingFunction sharding_function(/*seed=*/"");
+  ShardingFunction sharding_function(/*seed=*/"",
+                                     params_.use_siphash_sharding
+                                         ? ShardingHash::kSipHash
+                                         : ShardingHash::kSha256);
+  // Batches are converted on worker threads, at most `num_threads` at a time,
+  // and written in order on this thread. With a single thread they are
+  // converted when written.
+  const std::launch conversion_policy =
+      params_.num_threads > 1 ? std::launch::async : std::launch::deferred;
+  std::deque<std::future<ConvertedBatch>> converted_batches;
+  std::vector<std::unique_ptr<DataRecordT>> batch;
+  absl::Status write_status;
+  const auto write_oldest_batch = [&converted_batches, &write_status, this]() {
+    ConvertedBatch converted = converted_batches.front().get();
+    converted_batches.pop_front();
+    for (const auto& record : converted.records) {
+      if (auto status = record_writer_->WriteSerializedRecord(
+              ToStringView(record));
+          !status.ok()) {
+        LOG(ERROR) << "Failed to write record: " << status;
+        write_status.Update(status);
+      }
+    }
+    write_status.Update(converted.status);
+  };
+  const auto convert_batch = [&]() {
+    if (converted_batches.size() >=
+        static_cast<size_t>(params_.num_threads)) {
+      write_oldest_batch();
+    }
+    converted_batches.push_back(
+        std::async(conversion_policy, ConvertBatch, std::move(batch)));
+    batch.clear();
+    batch.reserve(kConversionBatchSize);
+  };
   absl::Status status = record_reader_->ReadRecords([&records_count,
                                                      &sharding_function,
+                                                     &batch, &write_status,
+                                                     &convert_batch,
                                                      this](const DataRecord&
                                                                data_record) {
     if (params_.shard_number >= 0 &&
@@ -227,17 +313,21 @@ absl::Status FormatDataCommand::Execute() {
     if ((double)std::rand() / RAND_MAX <= kSamplingThreshold) {
       LOG(INFO) << "Formatting record: " << records_count;
     }
-    std::unique_ptr<DataRecordT> data_record_native(data_record.UnPack());
-    auto [fbs_buffer, serialized_string_view] = Serialize(*data_record_native);
-    return DeserializeDataRecord(
-        serialized_string_view, [this](const DataRecordStruct& data_record) {
-          auto status = record_writer_->WriteRecord(data_record);
-          if (!status.ok()) {
-            LOG(ERROR) << "Failed to write record: " << status;
-          }
-          return status;
-        });
+    // The record is only valid in the callback, so it is copied before it is
+    // converted.
+    batch.emplace_back(data_record.UnPack());
+    if (batch.size() >= kConversionBatchSize) {
+      convert_batch();
+    }
+    return write_status;
   });
+  if (!batch.empty()) {
+    convert_batch();
+  }
+  while (!converted_batches.empty()) {
+    write_oldest_batch();
+  }
+  status.Update(write_status);
   record_writer_->Close();
   if (status.ok()) {
     LOG(INFO) << "Sucessfully formated records.";
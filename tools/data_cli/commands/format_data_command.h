@@ -63,6 +63,16 @@ class FormatDataCommand : public Command {
     std::string csv_encoding = "PLAINTEXT";
     int64_t shard_number = -1;
     int64_t number_of_shards = -1;
+    // Must match the use-siphash-sharding parameter of the servers.
+    bool use_siphash_sharding = false;
+    // Whether `shard_number` is a logical shard out of `number_of_shards`
+    // logical shards, see the num-logical-shards parameter of the servers.
+    bool logical_shards = false;
+    // If greater than 1, CSV input is split into chunks that are parsed on
+    // this many threads, batches of records are converted on this many
+    // threads, and delta output chunks are encoded on this many threads.
+    // Records are still written in input order.
+    int32_t num_threads = 1;
   };
 
   static absl::StatusOr<std::unique_ptr<FormatDataCommand>> Create(
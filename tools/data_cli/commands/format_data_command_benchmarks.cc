@@ -0,0 +1,80 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Converts CSV records with values of typical sizes to a delta file, on
+// increasing numbers of threads.
+
+#include <sstream>
+#include <string>
+#include <string_view>
+
+#include "absl/strings/str_cat.h"
+#include "benchmark/benchmark.h"
+#include "public/data_loading/csv/csv_delta_record_stream_writer.h"
+#include "tools/data_cli/commands/format_data_command.h"
+
+namespace kv_server {
+namespace {
+
+constexpr int64_t kNumRecords = 100'000;
+
+std::string MakeCsvInput(int64_t value_size) {
+  std::stringstream csv_stream;
+  CsvDeltaRecordStreamWriter csv_writer(csv_stream);
+  const std::string value(value_size, 'v');
+  for (int64_t i = 0; i < kNumRecords; ++i) {
+    const std::string key = absl::StrCat("key", i);
+    auto ignored = csv_writer.WriteRecord(DataRecordStruct{
+        .record = KeyValueMutationRecordStruct{
+            .mutation_type = KeyValueMutationType::Update,
+            .logical_commit_time = 1234567890,
+            .key = key,
+            .value = std::string_view(value)}});
+  }
+  csv_writer.Close();
+  return csv_stream.str();
+}
+
+void BM_FormatCsvToDelta(benchmark::State& state) {
+  const std::string csv_input = MakeCsvInput(state.range(0));
+  int64_t bytes_written = 0;
+  for (auto _ : state) {
+    std::istringstream csv_stream(csv_input);
+    std::ostringstream delta_stream;
+    auto command = FormatDataCommand::Create(
+        FormatDataCommand::Params{
+            .num_threads = static_cast<int32_t>(state.range(1))},
+        csv_stream, delta_stream);
+    if (!command.ok() || !(*command)->Execute().ok()) {
+      state.SkipWithError("Failed to format the records.");
+      return;
+    }
+    bytes_written = delta_stream.tellp();
+  }
+  state.SetItemsProcessed(kNumRecords * state.iterations());
+  state.SetBytesProcessed(csv_input.size() * state.iterations());
+  state.counters["bytes_written"] = bytes_written;
+}
+
+BENCHMARK(BM_FormatCsvToDelta)
+    ->ArgNames({"value_size", "num_threads"})
+    ->ArgsProduct({{16, 256, 4096}, {1, 2, 4, 8}})
+    ->UseRealTime();
+
+}  // namespace
+}  // namespace kv_server
+
+BENCHMARK_MAIN();
@@ -185,6 +185,32 @@ TEST(FormatDataCommandTest,
   EXPECT_TRUE(delta_reader.ReadRecords(record_callback.AsStdFunction()).ok());
 }
 
+TEST(FormatDataCommandTest,
+     ValidateGeneratingCsvToDeltaData_KVMutations_MultipleThreads) {
+  std::stringstream csv_stream;
+  std::stringstream delta_stream;
+  CsvDeltaRecordStreamWriter csv_writer(csv_stream);
+  const auto& record = GetDataRecord(GetKVMutationRecord());
+  for (int i = 0; i < 100; ++i) {
+    EXPECT_TRUE(csv_writer.WriteRecord(record).ok());
+  }
+  csv_writer.Close();
+  auto params = GetParams();
+  params.num_threads = 4;
+  auto command = FormatDataCommand::Create(params, csv_stream, delta_stream);
+  EXPECT_TRUE(command.ok()) << command.status();
+  EXPECT_TRUE((*command)->Execute().ok());
+  DeltaRecordStreamReader delta_reader(delta_stream);
+  testing::MockFunction<absl::Status(DataRecordStruct)> record_callback;
+  EXPECT_CALL(record_callback, Call)
+      .Times(100)
+      .WillRepeatedly([&record](DataRecordStruct actual_record) {
+        EXPECT_EQ(actual_record, record);
+        return absl::OkStatus();
+      });
+  EXPECT_TRUE(delta_reader.ReadRecords(record_callback.AsStdFunction()).ok());
+}
+
 TEST(FormatDataCommandTest,
      ValidateGeneratingDeltaToCsvData_KvMutations_Base64) {
   std::stringstream delta_stream;
@@ -499,5 +525,14 @@ TEST(FormatDataCommandTest, ValidateIncorrectShardingMetadataParams) {
       << status;
 }
 
+TEST(FormatDataCommandTest, ValidateIncorrectNumThreadsParams) {
+  std::stringstream unused_stream;
+  auto params = GetParams();
+  params.num_threads = 0;
+  absl::Status status =
+      FormatDataCommand::Create(params, unused_stream, unused_stream).status();
+  EXPECT_EQ(status.code(), absl::StatusCode::kInvalidArgument) << status;
+}
+
 }  // namespace
 }  // namespace kv_server
@@ -21,21 +21,32 @@
 #include <fstream>
 #include <functional>
 #include <memory>
+#include <string>
+#include <thread>
 #include <utility>
+#include <variant>
 #include <vector>
 
+#include "absl/cleanup/cleanup.h"
+#include "absl/hash/hash.h"
 #include "absl/memory/memory.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/strings/match.h"
+#include "absl/strings/numbers.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_format.h"
 #include "components/data/blob_storage/blob_storage_client.h"
 #include "public/constants.h"
 #include "public/data_loading/filename_utils.h"
 #include "public/data_loading/readers/delta_record_stream_reader.h"
+#include "public/data_loading/readers/riegeli_stream_io.h"
+#include "public/data_loading/records_utils.h"
 #include "public/data_loading/riegeli_metadata.pb.h"
+#include "public/data_loading/writers/delta_record_stream_writer.h"
 #include "public/sharding/sharding_function.h"
+#include "riegeli/bytes/ostream_writer.h"
+#include "riegeli/records/record_writer.h"
 #include "src/telemetry/telemetry_provider.h"
 
 namespace kv_server {
@@ -89,6 +100,39 @@ absl::Status ValidateRequiredParams(GenerateSnapshotCommand::Params& params) {
         ". Valid inputs must satisfy the requirement: 0 <= shard_number < "
         "number_of_shards"));
   }
+  if (params.num_threads < 1) {
+    return absl::InvalidArgumentError(absl::StrCat(
+        "Number of threads must be positive, got ", params.num_threads));
+  }
+  if (params.shard_snapshot_files) {
+    if (params.shard_number >= 0 || params.number_of_shards <= 0) {
+      return absl::InvalidArgumentError(
+          "Sharded snapshot files require number_of_shards and no "
+          "shard_number.");
+    }
+    if (!IsSnapshotFilename(params.snapshot_file)) {
+      return absl::InvalidArgumentError(
+          "Sharded snapshot files are named after the snapshot file, which "
+          "must be a valid snapshot filename.");
+    }
+  }
+  if (params.compacted_delta) {
+    if (!IsDeltaFilename(params.starting_file)) {
+      return absl::InvalidArgumentError(
+          "Compacted deltas must start at a delta file.");
+    }
+    if (params.snapshot_file != kStdioSymbol &&
+        !IsCompactedDeltaFilename(params.snapshot_file)) {
+      return absl::InvalidArgumentError(
+          "Compacted delta file must have a valid compacted delta filename.");
+    }
+    // Like delta files, compacted deltas hold the records of all shards.
+    if (params.shard_number >= 0 || params.shard_snapshot_files ||
+        params.key_index_block_size > 0) {
+      return absl::InvalidArgumentError(
+          "Compacted deltas can't be sharded or have a key index.");
+    }
+  }
   return absl::OkStatus();
 }
 
@@ -115,12 +159,21 @@ std::filesystem::path GetTempSnapshotFile(
 absl::StatusOr<KVFileMetadata> CreateSnapshotMetadata(
     const GenerateSnapshotCommand::Params& params) {
   KVFileMetadata metadata;
+  if (params.compacted_delta) {
+    auto* compacted_delta_metadata = metadata.mutable_compacted_delta();
+    compacted_delta_metadata->set_starting_delta_file(params.starting_file);
+    compacted_delta_metadata->set_ending_delta_file(params.ending_delta_file);
+    return metadata;
+  }
   auto snapshot_metadata = metadata.mutable_snapshot();
   *snapshot_metadata->mutable_starting_file() = params.starting_file;
   *snapshot_metadata->mutable_ending_delta_file() = params.ending_delta_file;
   if (params.shard_number >= 0) {
     auto* sharding_metadata = metadata.mutable_sharding_metadata();
     sharding_metadata->set_shard_num(params.shard_number);
+    if (params.logical_shards) {
+      sharding_metadata->set_num_logical_shards(params.number_of_shards);
+    }
   }
   return metadata;
 }
@@ -134,19 +187,20 @@ absl::Status WriteRecordsToSnapshotStream(
     const GenerateSnapshotCommand::Params& params,
     DeltaRecordStreamReader<std::istream>& record_reader,
     SnapshotStreamWriter<std::ostream>& snapshot_writer) {
-  ShardingFunction sharding_function(/*seed=*/"");
+  ShardingFunction sharding_function(/*seed=*/"",
+                                     params.use_siphash_sharding
+                                         ? ShardingHash::kSipHash
+                                         : ShardingHash::kSha256);
   return record_reader.ReadRecords(
       [&params, &snapshot_writer,
        &sharding_function](DataRecordStruct data_record) {
-        if (params.shard_number >= 0 &&
-            std::holds_alternative<KeyValueMutationRecordStruct>(
-                data_record.record)) {
-          KeyValueMutationRecordStruct record_struct =
-              std::get<KeyValueMutationRecordStruct>(data_record.record);
+        const auto* record_struct =
+            std::get_if<KeyValueMutationRecordStruct>(&data_record.record);
+        if (record_struct != nullptr && params.shard_number >= 0) {
           auto record_shard_num = sharding_function.GetShardNumForKey(
-              record_struct.key, params.number_of_shards);
+              record_struct->key, params.number_of_shards);
           if (params.shard_number != record_shard_num) {
-            LOG(INFO) << "Skipping record with key: " << record_struct.key
+            LOG(INFO) << "Skipping record with key: " << record_struct->key
                       << " . The record belongs to shard: " << record_shard_num
                       << ", but shard_number is " << params.shard_number;
             return absl::OkStatus();
@@ -206,6 +260,368 @@ absl::Status WriteDeltaFilesToSnapshot(
   }
   return absl::OkStatus();
 }
+
+// Returns the delta files after `start_after_delta_file`, preceded by the
+// starting file if it is a delta file.
+absl::StatusOr<std::vector<std::string>> ListDeltaFiles(
+    const GenerateSnapshotCommand::Params& params,
+    BlobStorageClient& blob_client, std::string_view start_after_delta_file) {
+  auto delta_files =
+      blob_client.ListBlobs({.bucket = params.data_dir},
+                            {.prefix = FilePrefix<FileType::DELTA>().data(),
+                             .start_after = start_after_delta_file.data()});
+  if (!delta_files.ok()) {
+    return delta_files.status();
+  }
+  if (IsDeltaFilename(params.starting_file)) {
+    delta_files->insert(delta_files->begin(), params.starting_file);
+  }
+  return delta_files;
+}
+
+absl::StatusOr<std::string> ReadSnapshotEndingDeltaFile(
+    const GenerateSnapshotCommand::Params& params,
+    BlobStorageClient& blob_client) {
+  auto blob_reader = blob_client.GetBlobReader(
+      {.bucket = params.data_dir.data(), .key = params.starting_file.data()});
+  DeltaRecordStreamReader record_reader(blob_reader->Stream());
+  auto metadata = record_reader.ReadMetadata();
+  if (!metadata.ok()) {
+    return metadata.status();
+  }
+  return metadata->snapshot().ending_delta_file();
+}
+
+absl::StatusOr<uint64_t> GetSnapshotLogicalCommitTime(
+    std::string_view snapshot_file) {
+  uint64_t logical_commit_time;
+  if (!absl::SimpleAtoi(
+          snapshot_file.substr(snapshot_file.rfind(kFileComponentDelimiter) +
+                               1),
+          &logical_commit_time)) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("Invalid snapshot filename: ", snapshot_file));
+  }
+  return logical_commit_time;
+}
+
+absl::Status PutSnapshotFile(const GenerateSnapshotCommand::Params& params,
+                             BlobStorageClient& blob_client,
+                             const std::filesystem::path& local_file,
+                             std::string_view snapshot_file) {
+  FileBlobReader file_blob_reader(local_file);
+  LOG(INFO) << "Writing snapshot file: " << params.data_dir << "/"
+            << snapshot_file;
+  if (auto status = blob_client.PutBlob(
+          file_blob_reader,
+          {.bucket = params.data_dir, .key = std::string(snapshot_file)});
+      !status.ok()) {
+    return status;
+  }
+  LOG(INFO) << "Successfully wrote snapshot file: " << params.data_dir << "/"
+            << snapshot_file;
+  return absl::OkStatus();
+}
+
+// Record batches queued per partition writing thread, which bounds how far
+// reading the input files runs ahead of the writers.
+constexpr int64_t kQueuedBatchesPerThread = 4;
+
+// A thread aggregating snapshot partitions when generating snapshots in
+// parallel. Thread `i` of `n` writes the partitions `i`, `i + n`, ...
+struct PartitionWriterThread {
+  RecordBatchQueue queue{kQueuedBatchesPerThread, kDefaultRecordBatchSize};
+  absl::Status status;
+  std::thread thread;
+};
+
+// Reads the records of the input files once and routes each one, still
+// serialized, to the thread writing its partition, so that the records are
+// only decoded by the threads aggregating them.
+class PartitionRecordRouter {
+ public:
+  PartitionRecordRouter(
+      const GenerateSnapshotCommand::Params& params,
+      std::function<int64_t(std::string_view key)> get_partition,
+      std::vector<std::unique_ptr<PartitionWriterThread>>& threads)
+      : params_(params),
+        get_partition_(std::move(get_partition)),
+        sharding_function_(/*seed=*/"", params.use_siphash_sharding
+                                            ? ShardingHash::kSipHash
+                                            : ShardingHash::kSha256),
+        threads_(threads),
+        batches_(threads.size(), nullptr),
+        route_record_([this](const DataRecord& data_record) {
+          RouteRecord(data_record);
+          return absl::OkStatus();
+        }) {}
+
+  // Routes the records of the file `key` of the data directory.
+  absl::Status RouteFileRecords(BlobStorageClient& blob_client,
+                                std::string_view key) {
+    auto blob_reader = blob_client.GetBlobReader(
+        {.bucket = params_.data_dir, .key = std::string(key)});
+    RiegeliStreamReader<std::string_view> record_reader(
+        blob_reader->Stream(), [](const riegeli::SkippedRegion& region) {
+          LOG(ERROR) << "Failed to read region: " << region;
+          return true;
+        });
+    // Like `DeltaRecordStreamReader`, skips the records that fail to
+    // deserialize.
+    return record_reader.ReadStreamRecords([this](std::string_view record) {
+      record_ = record;
+      return DeserializeTrustedDataRecord(record, route_record_);
+    });
+  }
+
+  // Queues the last batches and closes the queues of the threads.
+  void Close() {
+    for (size_t i = 0; i < threads_.size(); ++i) {
+      if (batches_[i] != nullptr) {
+        threads_[i]->queue.PushFull(batches_[i]);
+        batches_[i] = nullptr;
+      }
+      threads_[i]->queue.Close();
+    }
+  }
+
+ private:
+  // Routes `record_`, deserialized as `data_record`.
+  void RouteRecord(const DataRecord& data_record) {
+    const auto* kv_record = data_record.record_as_KeyValueMutationRecord();
+    if (kv_record == nullptr) {
+      // Every shard file holds the UDF configs, which are written once
+      // otherwise.
+      const size_t num_threads =
+          params_.shard_snapshot_files ? threads_.size() : 1;
+      for (size_t i = 0; i < num_threads; ++i) {
+        AddToBatch(i);
+      }
+      return;
+    }
+    const std::string_view key = kv_record->key()->string_view();
+    if (params_.shard_number >= 0) {
+      auto record_shard_num =
+          sharding_function_.GetShardNumForKey(key, params_.number_of_shards);
+      if (params_.shard_number != record_shard_num) {
+        LOG(INFO) << "Skipping record with key: " << key
+                  << " . The record belongs to shard: " << record_shard_num
+                  << ", but shard_number is " << params_.shard_number;
+        return;
+      }
+    }
+    AddToBatch(static_cast<size_t>(get_partition_(key)) % threads_.size());
+  }
+
+  void AddToBatch(size_t thread_index) {
+    RecordBatchQueue::Batch*& batch = batches_[thread_index];
+    if (batch == nullptr) {
+      batch = threads_[thread_index]->queue.AcquireFree();
+    }
+    batch->records[batch->size++].assign(record_);
+    if (batch->size == static_cast<int64_t>(batch->records.size())) {
+      threads_[thread_index]->queue.PushFull(batch);
+      batch = nullptr;
+    }
+  }
+
+  const GenerateSnapshotCommand::Params& params_;
+  std::function<int64_t(std::string_view key)> get_partition_;
+  ShardingFunction sharding_function_;
+  std::vector<std::unique_ptr<PartitionWriterThread>>& threads_;
+  // The batch being filled for each thread, if any.
+  std::vector<RecordBatchQueue::Batch*> batches_;
+  // The record being routed, only valid while it is read.
+  std::string_view record_;
+  // Converted to a `std::function` once, not per record.
+  const std::function<absl::Status(const DataRecord&)> route_record_;
+};
+
+// Aggregates the records that `thread` of `num_threads` pops from its queue
+// into its partitions of `partition_files`. If `shard_snapshot_files` is set,
+// the partitions are shards of the servers. Keeps popping batches after
+// failing, so that the router is never blocked.
+absl::Status WritePartitionSnapshots(
+    const GenerateSnapshotCommand::Params& params,
+    const std::function<int64_t(std::string_view key)>& get_partition,
+    int64_t thread_num, int64_t num_threads, PartitionWriterThread& thread,
+    const std::vector<std::filesystem::path>& partition_files) {
+  std::vector<std::unique_ptr<std::ofstream>> partition_ofstreams;
+  std::vector<std::unique_ptr<SnapshotStreamWriter<std::ostream>>> writers;
+  std::vector<std::string> temp_data_files;
+  absl::Cleanup remove_temp_data_files = [&temp_data_files] {
+    for (const auto& temp_data_file : temp_data_files) {
+      if (!temp_data_file.empty()) {
+        std::filesystem::remove(temp_data_file);
+      }
+    }
+  };
+  absl::Status status;
+  for (int64_t partition_num = thread_num;
+       status.ok() &&
+       partition_num < static_cast<int64_t>(partition_files.size());
+       partition_num += num_threads) {
+    auto metadata = CreateSnapshotMetadata(params);
+    if (!metadata.ok()) {
+      status = metadata.status();
+      break;
+    }
+    if (params.shard_snapshot_files) {
+      auto* sharding_metadata = metadata->mutable_sharding_metadata();
+      sharding_metadata->set_shard_num(partition_num);
+      if (params.logical_shards) {
+        sharding_metadata->set_num_logical_shards(params.number_of_shards);
+      }
+    }
+    const std::filesystem::path& partition_file =
+        partition_files[partition_num];
+    temp_data_files.push_back(
+        params.in_memory_compaction
+            ? ""
+            : absl::StrCat(partition_file.string(), ".aggregator.db"));
+    partition_ofstreams.push_back(
+        std::make_unique<std::ofstream>(partition_file));
+    auto writer = SnapshotStreamWriter<std::ostream>::Create(
+        {.metadata = *std::move(metadata),
+         .temp_data_file = temp_data_files.back(),
+         .aggregation_memory_bytes = params.aggregation_memory_mb << 20,
+         // Partitions concatenated into one snapshot are indexed when
+         // concatenated.
+         .key_index_block_size =
+             params.shard_snapshot_files ? params.key_index_block_size : 0},
+        *partition_ofstreams.back());
+    if (!writer.ok()) {
+      status = writer.status();
+      break;
+    }
+    writers.push_back(*std::move(writer));
+  }
+  const auto write_record = [&](const DataRecordStruct& data_record) {
+    const auto* kv_record =
+        std::get_if<KeyValueMutationRecordStruct>(&data_record.record);
+    if (kv_record == nullptr) {
+      for (auto& writer : writers) {
+        if (absl::Status write_status = writer->WriteRecord(data_record);
+            !write_status.ok()) {
+          return write_status;
+        }
+      }
+      return absl::OkStatus();
+    }
+    const int64_t writer_index =
+        writers.size() == 1 ? 0 : get_partition(kv_record->key) / num_threads;
+    return writers[writer_index]->WriteRecord(data_record);
+  };
+  while (RecordBatchQueue::Batch* batch = thread.queue.PopFull()) {
+    for (int64_t i = 0; status.ok() && i < batch->size; ++i) {
+      status = DeserializeDataRecord(batch->records[i], write_record);
+    }
+    thread.queue.Release(batch);
+  }
+  for (size_t i = 0; status.ok() && i < writers.size(); ++i) {
+    status = writers[i]->Finalize();
+    writers[i].reset();
+    partition_ofstreams[i]->close();
+    if (status.ok() && !*partition_ofstreams[i]) {
+      status = absl::InternalError(absl::StrCat(
+          "Failed to write ",
+          partition_files[thread_num + i * num_threads].string()));
+    }
+  }
+  return status;
+}
+
+// Writes the partitions in `partition_files`, which hold disjoint keys, to
+// `dest_stream` as one snapshot without aggregating their records again. The
+// records are only sorted by key for a key index.
+absl::Status ConcatenatePartitions(
+    const GenerateSnapshotCommand::Params& params,
+    const std::vector<std::filesystem::path>& partition_files,
+    std::ostream& dest_stream) {
+  auto metadata = CreateSnapshotMetadata(params);
+  if (!metadata.ok()) {
+    return metadata.status();
+  }
+  if (metadata->has_snapshot()) {
+    SnapshotMetadata& snapshot = *metadata->mutable_snapshot();
+    snapshot.set_num_keys(0);
+    snapshot.set_num_set_keys(0);
+    snapshot.set_total_value_bytes(0);
+    for (const auto& partition_file : partition_files) {
+      std::ifstream partition_ifstream(partition_file);
+      DeltaRecordStreamReader record_reader(partition_ifstream);
+      auto partition_metadata = record_reader.ReadMetadata();
+      if (!partition_metadata.ok()) {
+        return partition_metadata.status();
+      }
+      const SnapshotMetadata& partition = partition_metadata->snapshot();
+      snapshot.set_num_keys(snapshot.num_keys() + partition.num_keys());
+      snapshot.set_num_set_keys(snapshot.num_set_keys() +
+                                partition.num_set_keys());
+      snapshot.set_total_value_bytes(snapshot.total_value_bytes() +
+                                     partition.total_value_bytes());
+    }
+    if (params.key_index_block_size > 0) {
+      snapshot.set_has_key_index(true);
+    }
+  }
+  riegeli::RecordWriter<riegeli::OStreamWriter<std::ostream*>> record_writer(
+      riegeli::OStreamWriter(&dest_stream),
+      GetRecordWriterOptions({.enable_compression = false,
+                              .metadata = *std::move(metadata)}));
+  // Pairs of a key and its record, for a key index.
+  std::vector<std::pair<std::string, std::string>> sorted_records;
+  for (const auto& partition_file : partition_files) {
+    std::ifstream partition_ifstream(partition_file);
+    RiegeliStreamReader<std::string_view> record_reader(
+        partition_ifstream, [](const riegeli::SkippedRegion& region) {
+          LOG(ERROR) << "Failed to read region: " << region;
+          return false;
+        });
+    absl::Status status;
+    if (absl::Status read_status = record_reader.ReadStreamRecords(
+            [&](std::string_view record) {
+              if (params.key_index_block_size <= 0) {
+                if (!record_writer.WriteRecord(record)) {
+                  status.Update(record_writer.status());
+                }
+                return absl::OkStatus();
+              }
+              status.Update(DeserializeTrustedDataRecord(
+                  record, [&](const DataRecord& data_record) {
+                    const auto* kv_record =
+                        data_record.record_as_KeyValueMutationRecord();
+                    // The UDF config precedes the indexed records.
+                    if (kv_record == nullptr) {
+                      if (!record_writer.WriteRecord(record)) {
+                        return record_writer.status();
+                      }
+                      return absl::OkStatus();
+                    }
+                    sorted_records.emplace_back(kv_record->key()->str(),
+                                                std::string(record));
+                    return absl::OkStatus();
+                  }));
+              return absl::OkStatus();
+            });
+        !read_status.ok()) {
+      return read_status;
+    }
+    if (!status.ok()) {
+      return status;
+    }
+  }
+  if (params.key_index_block_size > 0) {
+    std::sort(sorted_records.begin(), sorted_records.end(),
+              [](const auto& a, const auto& b) { return a.first < b.first; });
+    return WriteKeyIndexedRecords(sorted_records, params.key_index_block_size,
+                                  record_writer);
+  }
+  if (!record_writer.Close()) {
+    return record_writer.status();
+  }
+  return absl::OkStatus();
+}
 }  // namespace
 
 GenerateSnapshotCommand::GenerateSnapshotCommand(
@@ -234,6 +650,9 @@ GenerateSnapshotCommand::Create(Params params) {
 }
 
 absl::Status GenerateSnapshotCommand::Execute() {
+  if (params_.num_threads > 1 || params_.shard_snapshot_files) {
+    return ExecuteInParallel();
+  }
   auto snapshot_metadata = CreateSnapshotMetadata(params_);
   if (!snapshot_metadata.ok()) {
     return snapshot_metadata.status();
@@ -246,30 +665,29 @@ absl::Status GenerateSnapshotCommand::Execute() {
       {.metadata = *snapshot_metadata,
        .temp_data_file = params_.in_memory_compaction
                              ? ""
-                             : GetTempAggregatorDbFile(params_)},
+                             : GetTempAggregatorDbFile(params_),
+       .aggregation_memory_bytes = params_.aggregation_memory_mb << 20,
+       .key_index_block_size = params_.key_index_block_size},
       *snapshot_ostream);
   if (!snapshot_writer.ok()) {
     return snapshot_writer.status();
   }
   std::string_view start_after_delta_file = params_.starting_file;
+  std::string snapshot_end_file;
   if (IsSnapshotFilename(params_.starting_file)) {
-    auto snapshot_end_file =
+    auto end_file =
         WriteBaseSnapshotData(params_, *blob_client_, **snapshot_writer);
-    if (!snapshot_end_file.ok()) {
-      return snapshot_end_file.status();
+    if (!end_file.ok()) {
+      return end_file.status();
     }
-    start_after_delta_file = *snapshot_end_file;
+    snapshot_end_file = *std::move(end_file);
+    start_after_delta_file = snapshot_end_file;
   }
   auto delta_files =
-      blob_client_->ListBlobs({.bucket = params_.data_dir},
-                              {.prefix = FilePrefix<FileType::DELTA>().data(),
-                               .start_after = start_after_delta_file.data()});
+      ListDeltaFiles(params_, *blob_client_, start_after_delta_file);
   if (!delta_files.ok()) {
     return delta_files.status();
   }
-  if (IsDeltaFilename(params_.starting_file)) {
-    delta_files->insert(delta_files->begin(), start_after_delta_file.data());
-  }
   if (auto status = WriteDeltaFilesToSnapshot(*delta_files, params_,
                                               *blob_client_, **snapshot_writer);
       !status.ok()) {
@@ -279,18 +697,134 @@ absl::Status GenerateSnapshotCommand::Execute() {
     return status;
   }
   snapshot_ofstream.close();
-  FileBlobReader file_blob_reader(temp_snapshot);
-  LOG(INFO) << "Writing snapshot file: " << params_.data_dir << "/"
-            << params_.snapshot_file;
-  if (auto status = blob_client_->PutBlob(
-          file_blob_reader,
-          {.bucket = params_.data_dir, .key = params_.snapshot_file});
+  return PutSnapshotFile(params_, *blob_client_, temp_snapshot,
+                         params_.snapshot_file);
+}
+
+absl::Status GenerateSnapshotCommand::ExecuteInParallel() {
+  std::string start_after_delta_file = params_.starting_file;
+  if (IsSnapshotFilename(params_.starting_file)) {
+    auto snapshot_end_file =
+        ReadSnapshotEndingDeltaFile(params_, *blob_client_);
+    if (!snapshot_end_file.ok()) {
+      return snapshot_end_file.status();
+    }
+    start_after_delta_file = *std::move(snapshot_end_file);
+  }
+  auto delta_files =
+      ListDeltaFiles(params_, *blob_client_, start_after_delta_file);
+  if (!delta_files.ok()) {
+    return delta_files.status();
+  }
+  // With sharded snapshot files, every partition is a shard of the servers.
+  // Otherwise keys are partitioned across the threads and the partitions are
+  // concatenated into a single snapshot file.
+  const int64_t num_partitions = params_.shard_snapshot_files
+                                     ? params_.number_of_shards
+                                     : params_.num_threads;
+  ShardingFunction sharding_function(/*seed=*/"",
+                                     params_.use_siphash_sharding
+                                         ? ShardingHash::kSipHash
+                                         : ShardingHash::kSha256);
+  auto get_partition = [this, &sharding_function,
+                        num_partitions](std::string_view key) -> int64_t {
+    if (params_.shard_snapshot_files) {
+      return sharding_function.GetShardNumForKey(key, num_partitions);
+    }
+    return absl::HashOf(key) % num_partitions;
+  };
+  const std::string snapshot_basename = params_.snapshot_file == kStdioSymbol
+                                            ? "SNAPSHOT"
+                                            : params_.snapshot_file;
+  std::vector<std::filesystem::path> partition_files;
+  for (int64_t i = 0; i < num_partitions; ++i) {
+    partition_files.push_back(
+        std::filesystem::path(params_.working_dir) /
+        absl::StrCat(snapshot_basename, ".partition.", i));
+  }
+  absl::Cleanup remove_partition_files = [&partition_files] {
+    for (const auto& partition_file : partition_files) {
+      std::filesystem::remove(partition_file);
+    }
+  };
+  const int64_t num_threads =
+      std::min<int64_t>(params_.num_threads, num_partitions);
+  std::vector<std::unique_ptr<PartitionWriterThread>> threads;
+  for (int64_t i = 0; i < num_threads; ++i) {
+    threads.push_back(std::make_unique<PartitionWriterThread>());
+  }
+  for (int64_t i = 0; i < num_threads; ++i) {
+    threads[i]->thread = std::thread(
+        [this, &get_partition, &partition_files, num_threads, i,
+         thread = threads[i].get()]() {
+          thread->status =
+              WritePartitionSnapshots(params_, get_partition, i, num_threads,
+                                      *thread, partition_files);
+        });
+  }
+  PartitionRecordRouter router(params_, get_partition, threads);
+  absl::Status partitions_status;
+  if (IsSnapshotFilename(params_.starting_file)) {
+    LOG(INFO) << "Compacting base snapshot file: " << params_.starting_file;
+    partitions_status =
+        router.RouteFileRecords(*blob_client_, params_.starting_file);
+  }
+  for (const auto& delta_file : *delta_files) {
+    if (!partitions_status.ok()) {
+      break;
+    }
+    if (!IsDeltaFilename(delta_file)) {
+      LOG(INFO) << "Skipping invalid delta filename: " << delta_file;
+      continue;
+    }
+    if (params_.ending_delta_file < delta_file) {
+      LOG(INFO) << "Delta file " << delta_file
+                << "is out of range. So we are done processing, skippping it.";
+      break;
+    }
+    LOG(INFO) << "Compacting delta file: " << delta_file;
+    partitions_status = router.RouteFileRecords(*blob_client_, delta_file);
+  }
+  router.Close();
+  for (auto& thread : threads) {
+    thread->thread.join();
+    partitions_status.Update(thread->status);
+  }
+  if (!partitions_status.ok()) {
+    return partitions_status;
+  }
+  if (params_.shard_snapshot_files) {
+    auto logical_commit_time =
+        GetSnapshotLogicalCommitTime(params_.snapshot_file);
+    if (!logical_commit_time.ok()) {
+      return logical_commit_time.status();
+    }
+    for (int64_t i = 0; i < num_partitions; ++i) {
+      auto snapshot_file = ToFileGroupFileName(
+          FileType::SNAPSHOT, *logical_commit_time, i, num_partitions);
+      if (!snapshot_file.ok()) {
+        return snapshot_file.status();
+      }
+      if (auto status = PutSnapshotFile(params_, *blob_client_,
+                                        partition_files[i], *snapshot_file);
+          !status.ok()) {
+        return status;
+      }
+    }
+    return absl::OkStatus();
+  }
+  const std::filesystem::path temp_snapshot(GetTempSnapshotFile(params_));
+  std::ofstream snapshot_ofstream(temp_snapshot);
+  std::ostream* snapshot_ostream =
+      params_.snapshot_file == kStdioSymbol ? &std::cout : &snapshot_ofstream;
+  if (auto status =
+          ConcatenatePartitions(params_, partition_files, *snapshot_ostream);
       !status.ok()) {
     return status;
   }
-  LOG(INFO) << "Successfully wrote snapshot file: " << params_.data_dir << "/"
-            << params_.snapshot_file;
-  return absl::OkStatus();
+  snapshot_ofstream.close();
+  return PutSnapshotFile(params_, *blob_client_, temp_snapshot,
+                         params_.snapshot_file);
 }
 
 }  // namespace kv_server
@@ -37,8 +37,29 @@ class GenerateSnapshotCommand : public Command {
     std::string ending_delta_file;
     std::string snapshot_file;
     bool in_memory_compaction;
+    // If positive, records are aggregated without SQLite, holding about this
+    // many MiB of records in memory before spilling them to `working_dir`.
+    int64_t aggregation_memory_mb = 0;
     int64_t shard_number = -1;
     int64_t number_of_shards = -1;
+    // Must match the use-siphash-sharding parameter of the servers.
+    bool use_siphash_sharding = false;
+    // Whether `shard_number` is a logical shard out of `number_of_shards`
+    // logical shards, see the num-logical-shards parameter of the servers.
+    bool logical_shards = false;
+    // Number of threads that aggregate the records in parallel, each one
+    // keeping the keys of its partitions. The input files are read once.
+    int32_t num_threads = 1;
+    // Whether to write a snapshot file per shard of `number_of_shards`, named
+    // as a file group after `snapshot_file`, instead of a single snapshot.
+    bool shard_snapshot_files = false;
+    // If positive, snapshots are written sorted by key with a key index of
+    // blocks of this many records, see `SnapshotMetadata.has_key_index`.
+    int64_t key_index_block_size = 0;
+    // Whether to merge the delta files from `starting_file` to
+    // `ending_delta_file` into the compacted delta file `snapshot_file`,
+    // keeping the deletions, instead of generating a snapshot.
+    bool compacted_delta = false;
   };
 
   ~GenerateSnapshotCommand();
@@ -53,6 +74,11 @@ class GenerateSnapshotCommand : public Command {
   GenerateSnapshotCommand(Params params,
                           std::unique_ptr<BlobStorageClient> blob_client);
 
+  // Reads the input files once, routing each record to the thread that
+  // aggregates its partition, and writes the partitions as shard files or
+  // concatenates them into the snapshot file.
+  absl::Status ExecuteInParallel();
+
   Params params_;
   std::unique_ptr<BlobStorageClient> blob_client_;
 };
@@ -0,0 +1,230 @@
+/*
+ * Copyright 2023 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tools/data_cli/commands/generate_snapshot_command.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "gmock/gmock.h"
+#include "google/protobuf/util/message_differencer.h"
+#include "gtest/gtest.h"
+#include "public/data_loading/filename_utils.h"
+#include "public/data_loading/readers/riegeli_stream_io.h"
+#include "public/data_loading/writers/delta_record_stream_writer.h"
+
+namespace kv_server {
+namespace {
+
+constexpr std::string_view kStartingFile = "DELTA_0000000000000001";
+constexpr std::string_view kEndingDeltaFile = "DELTA_0000000000000002";
+
+DataRecordStruct GetDataRecord(std::string_view key,
+                               KeyValueMutationRecordValueT value,
+                               int64_t logical_commit_time,
+                               KeyValueMutationType mutation_type =
+                                   KeyValueMutationType::Update) {
+  KeyValueMutationRecordStruct record;
+  record.key = key;
+  record.value = value;
+  record.logical_commit_time = logical_commit_time;
+  record.mutation_type = mutation_type;
+  DataRecordStruct data_record;
+  data_record.record = record;
+  return data_record;
+}
+
+DataRecordStruct GetUdfConfigRecord(std::string_view code_snippet,
+                                    int64_t logical_commit_time) {
+  UserDefinedFunctionsConfigStruct udf_config;
+  udf_config.language = UserDefinedFunctionsLanguage::Javascript;
+  udf_config.code_snippet = code_snippet;
+  udf_config.handler_name = "HandleRequest";
+  udf_config.logical_commit_time = logical_commit_time;
+  udf_config.version = logical_commit_time;
+  DataRecordStruct data_record;
+  data_record.record = udf_config;
+  return data_record;
+}
+
+void WriteDeltaFile(const std::filesystem::path& path,
+                    const std::vector<DataRecordStruct>& records) {
+  std::stringstream delta_stream;
+  auto delta_writer = DeltaRecordStreamWriter<std::stringstream>::Create(
+      delta_stream, DeltaRecordWriter::Options{.metadata = KVFileMetadata()});
+  ASSERT_TRUE(delta_writer.ok()) << delta_writer.status();
+  for (const auto& record : records) {
+    EXPECT_TRUE((*delta_writer)->WriteRecord(record).ok());
+  }
+  (*delta_writer)->Close();
+  std::ofstream file(path);
+  file << delta_stream.str();
+}
+
+// The metadata of a snapshot file and its records, serialized and sorted,
+// since partitions are written in a different order.
+struct SnapshotContents {
+  KVFileMetadata metadata;
+  std::vector<std::string> records;
+};
+
+SnapshotContents ReadSnapshot(const std::filesystem::path& path) {
+  std::ifstream stream(path);
+  RiegeliStreamReader<std::string_view> record_reader(
+      stream, [](const riegeli::SkippedRegion&) { return false; });
+  SnapshotContents contents;
+  auto metadata = record_reader.GetKVFileMetadata();
+  EXPECT_TRUE(metadata.ok()) << metadata.status();
+  if (metadata.ok()) {
+    contents.metadata = *std::move(metadata);
+  }
+  EXPECT_TRUE(record_reader
+                  .ReadStreamRecords([&contents](std::string_view record) {
+                    contents.records.emplace_back(record);
+                    return absl::OkStatus();
+                  })
+                  .ok());
+  std::sort(contents.records.begin(), contents.records.end());
+  return contents;
+}
+
+void ExpectSameSnapshot(const std::filesystem::path& actual,
+                        const std::filesystem::path& expected) {
+  SnapshotContents actual_contents = ReadSnapshot(actual);
+  SnapshotContents expected_contents = ReadSnapshot(expected);
+  EXPECT_TRUE(google::protobuf::util::MessageDifferencer::Equals(
+      expected_contents.metadata, actual_contents.metadata))
+      << actual_contents.metadata.DebugString();
+  EXPECT_EQ(actual_contents.records.size(), expected_contents.records.size());
+  EXPECT_TRUE(actual_contents.records == expected_contents.records);
+}
+
+class GenerateSnapshotCommandTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    const std::filesystem::path test_dir =
+        std::filesystem::path(::testing::TempDir()) /
+        ::testing::UnitTest::GetInstance()->current_test_info()->name();
+    data_dir_ = test_dir / "data";
+    working_dir_ = test_dir / "working";
+    std::filesystem::remove_all(test_dir);
+    std::filesystem::create_directories(data_dir_);
+    std::filesystem::create_directories(working_dir_);
+    for (int i = 0; i < 200; i++) {
+      keys_.push_back(absl::StrCat("key", i));
+    }
+    std::vector<DataRecordStruct> records;
+    for (const auto& key : keys_) {
+      records.push_back(GetDataRecord(key, "value1", 1));
+    }
+    for (int i = 0; i < 20; i++) {
+      records.push_back(GetDataRecord(
+          keys_[i], std::vector<std::string_view>{"a", "bb", "ccc"}, 1));
+    }
+    records.push_back(GetUdfConfigRecord("function v1() {}", 1));
+    WriteDeltaFile(data_dir_ / kStartingFile, records);
+    records.clear();
+    for (int i = 20; i < 100; i++) {
+      records.push_back(GetDataRecord(keys_[i], "value2", 2));
+    }
+    for (int i = 100; i < 120; i++) {
+      records.push_back(
+          GetDataRecord(keys_[i], "", 2, KeyValueMutationType::Delete));
+    }
+    records.push_back(GetUdfConfigRecord("function v2() {}", 2));
+    WriteDeltaFile(data_dir_ / kEndingDeltaFile, records);
+  }
+
+  GenerateSnapshotCommand::Params GetParams(std::string_view snapshot_file) {
+    return {.data_dir = data_dir_.string(),
+            .working_dir = working_dir_.string(),
+            .starting_file = std::string(kStartingFile),
+            .ending_delta_file = std::string(kEndingDeltaFile),
+            .snapshot_file = std::string(snapshot_file),
+            .in_memory_compaction = true};
+  }
+
+  void Execute(GenerateSnapshotCommand::Params params) {
+    auto command = GenerateSnapshotCommand::Create(std::move(params));
+    ASSERT_TRUE(command.ok()) << command.status();
+    EXPECT_TRUE((*command)->Execute().ok());
+  }
+
+  std::filesystem::path data_dir_;
+  std::filesystem::path working_dir_;
+  std::vector<std::string> keys_;
+};
+
+TEST_F(GenerateSnapshotCommandTest, ParallelSnapshotMatchesSequentialOne) {
+  Execute(GetParams("SNAPSHOT_0000000000000002"));
+  auto params = GetParams("SNAPSHOT_0000000000000003");
+  params.num_threads = 4;
+  Execute(std::move(params));
+  ExpectSameSnapshot(data_dir_ / "SNAPSHOT_0000000000000003",
+                     data_dir_ / "SNAPSHOT_0000000000000002");
+}
+
+TEST_F(GenerateSnapshotCommandTest, IndexedSnapshotMatchesSequentialOne) {
+  auto params = GetParams("SNAPSHOT_0000000000000002");
+  params.key_index_block_size = 16;
+  Execute(params);
+  params.snapshot_file = "SNAPSHOT_0000000000000003";
+  params.num_threads = 4;
+  Execute(std::move(params));
+  ExpectSameSnapshot(data_dir_ / "SNAPSHOT_0000000000000003",
+                     data_dir_ / "SNAPSHOT_0000000000000002");
+}
+
+TEST_F(GenerateSnapshotCommandTest, CompactedDeltaMatchesSequentialOne) {
+  auto params = GetParams("COMPACTED_DELTA_0000000000000002");
+  params.compacted_delta = true;
+  Execute(params);
+  params.snapshot_file = "COMPACTED_DELTA_0000000000000003";
+  params.num_threads = 4;
+  Execute(std::move(params));
+  ExpectSameSnapshot(data_dir_ / "COMPACTED_DELTA_0000000000000003",
+                     data_dir_ / "COMPACTED_DELTA_0000000000000002");
+}
+
+TEST_F(GenerateSnapshotCommandTest, ShardFilesMatchSequentialShardSnapshots) {
+  constexpr int kNumShards = 3;
+  auto params = GetParams("SNAPSHOT_0000000000000003");
+  params.number_of_shards = kNumShards;
+  params.shard_snapshot_files = true;
+  params.num_threads = 2;
+  Execute(std::move(params));
+  for (int shard_num = 0; shard_num < kNumShards; shard_num++) {
+    const std::string sequential_file =
+        absl::StrCat("SNAPSHOT_000000000000000", 4 + shard_num);
+    params = GetParams(sequential_file);
+    params.shard_number = shard_num;
+    params.number_of_shards = kNumShards;
+    Execute(std::move(params));
+    auto shard_file =
+        ToFileGroupFileName(FileType::SNAPSHOT, 3, shard_num, kNumShards);
+    ASSERT_TRUE(shard_file.ok()) << shard_file.status();
+    ExpectSameSnapshot(data_dir_ / *shard_file, data_dir_ / sequential_file);
+  }
+}
+
+}  // namespace
+}  // namespace kv_server
@@ -22,11 +22,14 @@
 #include "absl/log/flags.h"
 #include "absl/log/initialize.h"
 #include "absl/log/log.h"
+#include "absl/strings/str_split.h"
 #include "components/util/platform_initializer.h"
 #include "tools/data_cli/commands/command.h"
+#include "tools/data_cli/commands/estimate_memory_command.h"
 #include "tools/data_cli/commands/format_data_command.h"
 #include "tools/data_cli/commands/generate_snapshot_command.h"
 
+using kv_server::EstimateMemoryCommand;
 using kv_server::FormatDataCommand;
 using kv_server::GenerateSnapshotCommand;
 
@@ -53,6 +56,21 @@ ABSL_FLAG(
 ABSL_FLAG(
     bool, in_memory_compaction, true,
     "If true, delta file compaction to generate snapshots is done in memory.");
+ABSL_FLAG(int64_t, aggregation_memory_mb, 0,
+          "If positive, delta file compaction aggregates records without "
+          "SQLite, holding about this many MiB of records in memory and "
+          "spilling sorted runs to --working_dir unless "
+          "--in_memory_compaction is true.");
+ABSL_FLAG(int32_t, num_threads, 1,
+          "Number of threads that generate the snapshot, each one aggregating "
+          "the records of a partition of the keys, or that parse CSV input "
+          "and encode delta output chunks for format_data.");
+ABSL_FLAG(bool, shard_snapshot_files, false,
+          "If true, a snapshot file is written for each of --number_of_shards "
+          "shards, as a file group named after --snapshot_file.");
+ABSL_FLAG(int64_t, key_index_block_size, 0,
+          "If positive, snapshots are written sorted by key, with a key index "
+          "of blocks of this many records and their Bloom filters.");
 ABSL_FLAG(std::string, csv_column_delimiter, ",",
           "Column delimiter for csv files");
 ABSL_FLAG(std::string, csv_value_delimiter, "|",
@@ -70,6 +88,16 @@ ABSL_FLAG(int64_t, shard_number, -1,
 ABSL_FLAG(
     int64_t, number_of_shards, -1,
     "Total number of shards. Must be > --shard_number if shard_number >= 0.");
+ABSL_FLAG(bool, use_siphash_sharding, false,
+          "Whether records are assigned to shards with SipHash instead of "
+          "SHA-256. Must match the use-siphash-sharding server parameter.");
+ABSL_FLAG(int64_t, sample_one_in_n_keys, 10,
+          "For estimate_memory, the records of one in this many keys are "
+          "loaded into the caches to measure their memory.");
+ABSL_FLAG(bool, logical_shards, false,
+          "Whether --shard_number is a logical shard and --number_of_shards "
+          "the number of logical shards. Must match the num-logical-shards "
+          "server parameter.");
 
 constexpr std::string_view kUsageMessage = R"(
 Usage: data_cli <command> <flags>
@@ -89,6 +117,9 @@ Commands:
                                   If the values are binary, BASE64 is recommended.
     [--shard_number]     (Optional) Defaults to -1 (i.e., not specified).
     [--number_of_shards] (Optional) Defaults to -1 (i.e., not specified). Must be > --shard_number if shard_number >= 0.
+    [--use_siphash_sharding] (Optional) Defaults to false. Must match the use-siphash-sharding server parameter.
+    [--logical_shards]   (Optional) Defaults to false. Whether --shard_number and --number_of_shards are logical shards. Must match the num-logical-shards server parameter.
+    [--num_threads]      (Optional) Defaults to 1. Number of threads parsing CSV input and encoding DELTA output in parallel.
   Examples:
     (1) Generate a csv file to a delta file and write output records to std::cout.
     - data_cli format_data --input_file="$PWD/data.csv"
@@ -110,22 +141,62 @@ Commands:
     [--data_dir]                (Required) Directory with input delta files.
     [--working_dir]             (Optional) Defaults to "/tmp". Directory used to write temporary data.
     [--in_memory_compaction]    (Optional) Defaults to true. If false, file backed compaction is used.
+    [--aggregation_memory_mb]   (Optional) Defaults to 0. If positive, records are aggregated without SQLite and sorted runs are spilled to --working_dir once they exceed this size.
     [--shard_number]            (Optional) Defaults to -1 (i.e., not specified).
     [--number_of_shards]        (Optional) Defaults to -1 (i.e., not specified). Must be > --shard_number if shard_number >= 0.
+    [--use_siphash_sharding]    (Optional) Defaults to false. Must match the use-siphash-sharding server parameter.
+    [--logical_shards]          (Optional) Defaults to false. Whether --shard_number and --number_of_shards are logical shards. Must match the num-logical-shards server parameter.
+    [--num_threads]             (Optional) Defaults to 1. Number of threads aggregating partitions of the keys in parallel.
+    [--shard_snapshot_files]    (Optional) Defaults to false. If true, writes a snapshot file group with a file per shard of --number_of_shards.
+    [--key_index_block_size]    (Optional) Defaults to 0. If positive, writes the snapshot sorted by key with a key index of blocks of this many records.
   Examples:
     (1) Generate snapshot using delta files from local disk.
     - data_cli generate_snapshot --data_dir="$DATA_DIR" --starting_file="DELTA_1670532228628680" \
         --ending_delta_file="DELTA_1670532717393878" --snapshot_file="SNAPSHOT_0000000000000003"
 
+    (2) Generate a snapshot file per shard for servers with 4 shards, using 4 threads.
+    - data_cli generate_snapshot --data_dir="$DATA_DIR" --starting_file="DELTA_1670532228628680" \
+        --ending_delta_file="DELTA_1670532717393878" --snapshot_file="SNAPSHOT_0000000000000003" \
+        --number_of_shards=4 --shard_snapshot_files --num_threads=4
+
+- compact_deltas                Merges a range of delta files, including their deletions, into a single compacted delta file.
+                                Servers with load-compacted-delta-files load it instead of the delta files it covers.
+    [--starting_file]           (Required) Oldest delta file to include in compaction.
+    [--ending_delta_file]       (Required) Most recent delta file to include compaction.
+    [--snapshot_file]           (Optional) Defaults to stdout. Output compacted delta file, named after the ending delta file.
+    [--data_dir]                (Required) Directory with input delta files.
+    [--working_dir]             (Optional) Defaults to "/tmp". Directory used to write temporary data.
+    [--in_memory_compaction]    (Optional) Defaults to true. If false, file backed compaction is used.
+    [--aggregation_memory_mb]   (Optional) Defaults to 0. Same as for generate_snapshot.
+    [--num_threads]             (Optional) Defaults to 1. Number of threads aggregating partitions of the keys in parallel.
+  Examples:
+    (1) Compact the delta files written since the last snapshot.
+    - data_cli compact_deltas --data_dir="$DATA_DIR" --starting_file="DELTA_1670532228628680" \
+        --ending_delta_file="DELTA_1670532717393878" --snapshot_file="COMPACTED_DELTA_1670532717393878"
+
+- estimate_memory               Estimates the server memory needed to hold a snapshot and delta files.
+    [--input_file]              (Required) Comma separated snapshot and delta files, applied in this order.
+    [--sample_one_in_n_keys]    (Optional) Defaults to 10. The records of one in this many keys are loaded into the caches.
+    [--number_of_shards]        (Optional) Defaults to -1 (i.e., not specified). If positive, estimates the memory of each shard.
+    [--use_siphash_sharding]    (Optional) Defaults to false. Must match the use-siphash-sharding server parameter.
+  Examples:
+    (1) Estimate the memory of the shards of servers with 4 shards.
+    - data_cli estimate_memory --input_file="$DATA_DIR/SNAPSHOT_0000000000000003,$DATA_DIR/DELTA_1670532717393878" \
+        --number_of_shards=4
+
 Try --help to see detailed flag descriptions and associated default values.
 )";
 
 constexpr std::string_view kStdioSymbol = "-";
 constexpr std::string_view kFormatDataCommand = "format_data";
 constexpr std::string_view kGenerateSnapshotCommand = "generate_snapshot";
+constexpr std::string_view kCompactDeltasCommand = "compact_deltas";
+constexpr std::string_view kEstimateMemoryCommand = "estimate_memory";
 constexpr std::array kSupportedCommands = {
     kFormatDataCommand,
     kGenerateSnapshotCommand,
+    kCompactDeltasCommand,
+    kEstimateMemoryCommand,
 };
 
 bool IsSupportedCommand(std::string_view command) {
@@ -182,6 +253,9 @@ int main(int argc, char** argv) {
             .csv_encoding = absl::GetFlag(FLAGS_csv_encoding),
             .shard_number = absl::GetFlag(FLAGS_shard_number),
             .number_of_shards = absl::GetFlag(FLAGS_number_of_shards),
+            .use_siphash_sharding = absl::GetFlag(FLAGS_use_siphash_sharding),
+            .logical_shards = absl::GetFlag(FLAGS_logical_shards),
+            .num_threads = absl::GetFlag(FLAGS_num_threads),
         },
         *i_stream, *o_stream);
     if (!format_data_command.ok()) {
@@ -194,7 +268,8 @@ int main(int argc, char** argv) {
       return -1;
     }
   }
-  if (command_name == kGenerateSnapshotCommand) {
+  if (command_name == kGenerateSnapshotCommand ||
+      command_name == kCompactDeltasCommand) {
     auto generate_snapshot_command =
         GenerateSnapshotCommand::Create(GenerateSnapshotCommand::Params{
             .data_dir = absl::GetFlag(FLAGS_data_dir),
@@ -203,8 +278,15 @@ int main(int argc, char** argv) {
             .ending_delta_file = absl::GetFlag(FLAGS_ending_delta_file),
             .snapshot_file = absl::GetFlag(FLAGS_snapshot_file),
             .in_memory_compaction = absl::GetFlag(FLAGS_in_memory_compaction),
+            .aggregation_memory_mb = absl::GetFlag(FLAGS_aggregation_memory_mb),
             .shard_number = absl::GetFlag(FLAGS_shard_number),
             .number_of_shards = absl::GetFlag(FLAGS_number_of_shards),
+            .use_siphash_sharding = absl::GetFlag(FLAGS_use_siphash_sharding),
+            .logical_shards = absl::GetFlag(FLAGS_logical_shards),
+            .num_threads = absl::GetFlag(FLAGS_num_threads),
+            .shard_snapshot_files = absl::GetFlag(FLAGS_shard_snapshot_files),
+            .key_index_block_size = absl::GetFlag(FLAGS_key_index_block_size),
+            .compacted_delta = command_name == kCompactDeltasCommand,
         });
     if (!generate_snapshot_command.ok()) {
       LOG(ERROR) << "Failed to create command to generate snapshot. "
@@ -217,5 +299,26 @@ int main(int argc, char** argv) {
       return -1;
     }
   }
+  if (command_name == kEstimateMemoryCommand) {
+    auto estimate_memory_command = EstimateMemoryCommand::Create(
+        EstimateMemoryCommand::Params{
+            .input_files = absl::StrSplit(absl::GetFlag(FLAGS_input_file), ',',
+                                          absl::SkipEmpty()),
+            .sample_one_in_n_keys = absl::GetFlag(FLAGS_sample_one_in_n_keys),
+            .number_of_shards = absl::GetFlag(FLAGS_number_of_shards),
+            .use_siphash_sharding = absl::GetFlag(FLAGS_use_siphash_sharding),
+        },
+        std::cout);
+    if (!estimate_memory_command.ok()) {
+      LOG(ERROR) << "Failed to create command to estimate memory. "
+                 << estimate_memory_command.status();
+      return -1;
+    }
+    if (absl::Status status = (*estimate_memory_command)->Execute();
+        !status.ok()) {
+      LOG(ERROR) << "Failed to execute estimate memory command. " << status;
+      return -1;
+    }
+  }
   return 0;
 }
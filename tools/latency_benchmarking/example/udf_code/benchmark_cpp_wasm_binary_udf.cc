@@ -0,0 +1,243 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Same workload as benchmark_cpp_wasm_udf.cc, without JSON. The UDF input
+// is passed as base64 strings of serialized protos, which are decoded in WASM,
+// and hook results are copied into WASM linear memory as bytes.
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "absl/status/statusor.h"
+#include "absl/strings/escaping.h"
+#include "absl/strings/str_join.h"
+#include "emscripten/bind.h"
+#include "public/api_schema.pb.h"
+#include "public/udf/binary_get_values.pb.h"
+
+namespace {
+
+using google::protobuf::Struct;
+using kv_server::UDFArgument;
+
+constexpr int kTopK = 4;
+constexpr int kLookupNKeysFromRunQuery = 100;
+
+// Copies `bytes`, a Uint8Array, into linear memory in one bulk copy.
+std::string CopyToLinearMemory(const emscripten::val& bytes) {
+  std::string buffer(bytes["length"].as<size_t>(), '\0');
+  emscripten::val(emscripten::typed_memory_view(
+                      buffer.size(), reinterpret_cast<uint8_t*>(buffer.data())))
+      .call<void>("set", bytes);
+  return buffer;
+}
+
+template <typename Message>
+absl::StatusOr<Message> ParseProtoInput(const emscripten::val& input) {
+  std::string serialized;
+  if (!absl::Base64Unescape(input.as<std::string>(), &serialized)) {
+    return absl::InvalidArgumentError("UDF input is not base64");
+  }
+  Message message;
+  if (!message.ParseFromString(serialized)) {
+    return absl::InvalidArgumentError("UDF input is not a valid proto");
+  }
+  return message;
+}
+
+int GetIntMetadata(const Struct& request_metadata, const std::string& name,
+                   int default_value) {
+  const auto it = request_metadata.fields().find(name);
+  if (it == request_metadata.fields().end() ||
+      !it->second.has_number_value()) {
+    return default_value;
+  }
+  return static_cast<int>(it->second.number_value());
+}
+
+bool GetBoolMetadata(const Struct& request_metadata, const std::string& name) {
+  const auto it = request_metadata.fields().find(name);
+  return it != request_metadata.fields().end() && it->second.bool_value();
+}
+
+std::vector<std::string_view> GetKeys(const UDFArgument& argument) {
+  std::vector<std::string_view> keys;
+  for (const auto& key : argument.data().list_value().values()) {
+    keys.push_back(key.string_value());
+  }
+  return keys;
+}
+
+// Calls getValuesBinary for every batch of `keys` and adds the values to
+// `kv_map`.
+absl::Status GetValuesBinary(const emscripten::val& get_values_binary_cb,
+                             const Struct& request_metadata,
+                             const std::vector<std::string_view>& keys,
+                             std::map<std::string, std::string>& kv_map) {
+  if (keys.empty()) {
+    return absl::InvalidArgumentError("No keys to look up");
+  }
+  const int batch_size_metadata =
+      GetIntMetadata(request_metadata, "lookup_batch_size", keys.size());
+  const size_t batch_size =
+      batch_size_metadata > 0 ? batch_size_metadata : keys.size();
+  for (size_t start = 0; start < keys.size(); start += batch_size) {
+    emscripten::val key_list = emscripten::val::array();
+    for (size_t i = start; i < keys.size() && i < start + batch_size; ++i) {
+      key_list.call<void>("push", std::string(keys[i]));
+    }
+    kv_server::BinaryGetValuesResponse response;
+    if (!response.ParseFromString(
+            CopyToLinearMemory(get_values_binary_cb(key_list)))) {
+      return absl::InternalError("Could not parse binary response to proto");
+    }
+    for (auto& [key, value] : *response.mutable_kv_pairs()) {
+      if (value.has_data()) {
+        kv_map[key] = std::move(*value.mutable_data());
+      }
+    }
+  }
+  return absl::OkStatus();
+}
+
+// Returns the elements of the output of runQueryBinary, each preceded by its
+// size as a 32 bit little endian integer.
+std::vector<std::string> ParseRunQueryBinaryOutput(std::string_view bytes) {
+  std::vector<std::string> elements;
+  while (bytes.size() >= 4) {
+    const uint32_t size = static_cast<uint8_t>(bytes[0]) |
+                          static_cast<uint8_t>(bytes[1]) << 8 |
+                          static_cast<uint8_t>(bytes[2]) << 16 |
+                          static_cast<uint32_t>(static_cast<uint8_t>(bytes[3]))
+                              << 24;
+    bytes.remove_prefix(4);
+    if (size > bytes.size()) {
+      break;
+    }
+    elements.emplace_back(bytes.substr(0, size));
+    bytes.remove_prefix(size);
+  }
+  return elements;
+}
+
+emscripten::val ToKeyValues(const std::map<std::string, std::string>& kv_map,
+                            int max_size) {
+  emscripten::val kv_pairs = emscripten::val::object();
+  kv_pairs.set("udfApi", "getValuesBinary");
+  int i = 0;
+  for (const auto& [key, value] : kv_map) {
+    if (i++ >= max_size) {
+      break;
+    }
+    emscripten::val json_value = emscripten::val::object();
+    json_value.set("value", value);
+    kv_pairs.set(key, json_value);
+  }
+  return kv_pairs;
+}
+
+emscripten::val HandleGetValuesFlow(
+    const emscripten::val& get_values_binary_cb, const Struct& request_metadata,
+    const std::vector<UDFArgument>& arguments) {
+  emscripten::val key_group_outputs = emscripten::val::array();
+  for (const UDFArgument& argument : arguments) {
+    std::map<std::string, std::string> kv_map;
+    if (!GetValuesBinary(get_values_binary_cb, request_metadata,
+                         GetKeys(argument), kv_map)
+             .ok()) {
+      continue;
+    }
+    emscripten::val key_group_output = emscripten::val::object();
+    key_group_output.set("keyValues", ToKeyValues(kv_map, kv_map.size()));
+    key_group_outputs.call<void>("push", key_group_output);
+  }
+  emscripten::val result = emscripten::val::object();
+  result.set("keyGroupOutputs", key_group_outputs);
+  result.set("udfOutputApiVersion", emscripten::val(1));
+  return result;
+}
+
+// Same as the run query flow of benchmark_cpp_wasm_udf.cc, with
+// runQueryBinary and getValuesBinary.
+emscripten::val HandleRunQueryFlow(
+    const emscripten::val& get_values_binary_cb,
+    const emscripten::val& run_query_binary_cb, const Struct& request_metadata,
+    const std::vector<UDFArgument>& arguments) {
+  emscripten::val result = emscripten::val::object();
+  result.set("udfOutputApiVersion", emscripten::val(1));
+  if (arguments.empty()) {
+    return result;
+  }
+  const std::string query = absl::StrJoin(GetKeys(arguments[0]), "|");
+  const std::string query_output =
+      CopyToLinearMemory(run_query_binary_cb(query));
+  std::vector<std::string> keys = ParseRunQueryBinaryOutput(query_output);
+  const int n = GetIntMetadata(request_metadata, "lookup_n_keys_from_runquery",
+                               kLookupNKeysFromRunQuery);
+  if (keys.size() > static_cast<size_t>(n)) {
+    keys.resize(n);
+  }
+  std::map<std::string, std::string> kv_map;
+  if (!GetValuesBinary(get_values_binary_cb, request_metadata,
+                       std::vector<std::string_view>(keys.begin(), keys.end()),
+                       kv_map)
+           .ok()) {
+    return result;
+  }
+  emscripten::val key_group_output = emscripten::val::object();
+  // Like benchmark_cpp_wasm_udf.cc, which stops after kTopK + 1 pairs.
+  key_group_output.set("keyValues", ToKeyValues(kv_map, kTopK + 1));
+  emscripten::val key_group_outputs = emscripten::val::array();
+  key_group_outputs.call<void>("push", key_group_output);
+  result.set("keyGroupOutputs", key_group_outputs);
+  return result;
+}
+
+}  // namespace
+
+emscripten::val HandleRequestBinaryCc(
+    const emscripten::val& get_values_binary_cb,
+    const emscripten::val& run_query_binary_cb,
+    const emscripten::val& execution_metadata,
+    const emscripten::val& udf_arguments) {
+  absl::StatusOr<kv_server::UDFExecutionMetadata> metadata =
+      ParseProtoInput<kv_server::UDFExecutionMetadata>(execution_metadata);
+  if (!metadata.ok()) {
+    return emscripten::val(std::string(metadata.status().message()));
+  }
+  std::vector<UDFArgument> arguments;
+  for (const emscripten::val& udf_argument :
+       emscripten::vecFromJSArray<emscripten::val>(udf_arguments)) {
+    absl::StatusOr<UDFArgument> argument =
+        ParseProtoInput<UDFArgument>(udf_argument);
+    if (!argument.ok()) {
+      return emscripten::val(std::string(argument.status().message()));
+    }
+    arguments.push_back(*std::move(argument));
+  }
+  if (GetBoolMetadata(metadata->request_metadata(), "runQuery")) {
+    return HandleRunQueryFlow(get_values_binary_cb, run_query_binary_cb,
+                              metadata->request_metadata(), arguments);
+  }
+  return HandleGetValuesFlow(get_values_binary_cb,
+                             metadata->request_metadata(), arguments);
+}
+
+EMSCRIPTEN_BINDINGS(HandleRequestBinaryExample) {
+  emscripten::function("handleRequestBinaryCc", &HandleRequestBinaryCc);
+}
@@ -0,0 +1,23 @@
+/**
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// The metadata and arguments are base64 strings of serialized protos, which
+// are passed to WASM as is.
+async function HandleRequest(executionMetadata, ...udf_arguments) {
+  const module = await getModule();
+  const result = module.handleRequestBinaryCc(getValuesBinary, runQueryBinary, executionMetadata, udf_arguments);
+  return result;
+}
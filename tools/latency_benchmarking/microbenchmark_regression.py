@@ -0,0 +1,382 @@
+# Copyright 2024 Google LLC
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""
+Runs the server microbenchmarks with repetitions, appends their results to a
+JSON lines history file and flags statistically significant regressions
+against a baseline run of the history.
+
+Time and throughput metrics are compared with a two-sided Mann-Whitney U test
+over the repetitions, and flagged if significant and larger than a minimum
+relative change. Peak memory is measured once per benchmark binary, so it is
+flagged on the relative change alone.
+"""
+
+import argparse
+import datetime
+import json
+import math
+import os
+import statistics
+import subprocess
+import sys
+import tempfile
+
+DEFAULT_TARGETS = [
+    "//components/tools/benchmarks:cache_benchmark",
+    "//components/tools/benchmarks:data_loading_benchmark",
+    "//public/data_loading/aggregation:record_aggregator_benchmarks",
+    "//components/query:query_benchmark",
+    "//components/udf/hooks:get_values_hook_benchmark",
+    "//components/telemetry:telemetry_benchmark",
+]
+
+# Flags the benchmarks need to run. `{data_directory}` is replaced by a
+# temporary directory.
+TARGET_ARGS = {
+    "//components/tools/benchmarks:data_loading_benchmark": [
+        "--data_directory={data_directory}",
+        "--filename=DELTA_1700000000000000",
+        "--create_input_file",
+        "--num_records=10000",
+        "--record_size=1024",
+    ],
+}
+
+# Peak resident memory of a benchmark binary, in KiB.
+MAX_RSS_METRIC = "max_rss_kb"
+
+_NANOSECONDS_PER_UNIT = {"ns": 1, "us": 1e3, "ms": 1e6, "s": 1e9}
+# Fields of benchmark results that are not metrics.
+_NON_METRIC_FIELDS = {
+    "name",
+    "family_index",
+    "per_family_instance_index",
+    "run_name",
+    "run_type",
+    "repetitions",
+    "repetition_index",
+    "threads",
+    "iterations",
+    "time_unit",
+    "aggregate_name",
+    "aggregate_unit",
+    "error_occurred",
+    "error_message",
+    "label",
+}
+
+
+def HigherIsBetter(metric: str) -> bool:
+    """Returns whether larger values of `metric` are improvements."""
+    return metric.endswith("_per_second")
+
+
+def ParseBenchmarkJson(benchmark_json: dict) -> dict:
+    """Returns the values of the repetitions of each benchmark and metric.
+
+    Times are converted to nanoseconds, e.g. `real_time_ns`. Aggregates such as
+    means are skipped, as they are computed again from the repetitions.
+
+    Example: {"BM_Lookup/10": {"real_time_ns": [105.0, 98.2], ...}}
+    """
+    results = {}
+    for run in benchmark_json.get("benchmarks", []):
+        if run.get("run_type", "iteration") != "iteration" or run.get(
+            "error_occurred"
+        ):
+            continue
+        metrics = results.setdefault(run.get("run_name", run["name"]), {})
+        scale = _NANOSECONDS_PER_UNIT[run.get("time_unit", "ns")]
+        for field, value in run.items():
+            if field in _NON_METRIC_FIELDS or not isinstance(value, (int, float)):
+                continue
+            if field in ("real_time", "cpu_time"):
+                metrics.setdefault(f"{field}_ns", []).append(value * scale)
+            else:
+                metrics.setdefault(field, []).append(float(value))
+    return results
+
+
+def MannWhitneyUPValue(xs: list, ys: list) -> float:
+    """Returns the two-sided p-value of the Mann-Whitney U test of xs and ys.
+
+    Uses the normal approximation with tie correction, which needs about 8
+    repetitions per sample to be meaningful.
+    """
+    n1, n2 = len(xs), len(ys)
+    if n1 == 0 or n2 == 0:
+        return 1.0
+    values = sorted([(x, 0) for x in xs] + [(y, 1) for y in ys])
+    ranks = [0.0] * len(values)
+    tie_term = 0.0
+    i = 0
+    while i < len(values):
+        j = i
+        while j + 1 < len(values) and values[j + 1][0] == values[i][0]:
+            j += 1
+        for k in range(i, j + 1):
+            ranks[k] = (i + j) / 2 + 1
+        tied = j - i + 1
+        tie_term += tied**3 - tied
+        i = j + 1
+    rank_sum = sum(rank for rank, (_, sample) in zip(ranks, values) if sample == 0)
+    u = rank_sum - n1 * (n1 + 1) / 2
+    n = n1 + n2
+    variance = n1 * n2 / 12 * ((n + 1) - tie_term / (n * (n - 1)))
+    if variance <= 0:
+        return 1.0
+    # Continuity corrected.
+    z = (abs(u - n1 * n2 / 2) - 0.5) / math.sqrt(variance)
+    return max(0.0, min(1.0, math.erfc(max(z, 0.0) / math.sqrt(2))))
+
+
+def Percentile(values: list, percentile: float) -> float:
+    """Returns the `percentile` of `values`, interpolating linearly."""
+    ordered = sorted(values)
+    position = (len(ordered) - 1) * percentile / 100
+    lower = math.floor(position)
+    upper = math.ceil(position)
+    return ordered[lower] + (ordered[upper] - ordered[lower]) * (position - lower)
+
+
+def Compare(
+    baseline: dict,
+    candidate: dict,
+    alpha: float,
+    min_relative_change: float,
+    max_rss_relative_change: float,
+) -> list:
+    """Returns the comparisons of the metrics of two runs of the history.
+
+    Each comparison is a dict with the benchmark, metric, baseline and
+    candidate medians, p90s, relative change of the medians, p-value, and
+    whether it is a regression.
+    """
+    comparisons = []
+    for benchmark, candidate_metrics in sorted(candidate["results"].items()):
+        baseline_metrics = baseline["results"].get(benchmark)
+        if baseline_metrics is None:
+            continue
+        for metric, candidate_values in sorted(candidate_metrics.items()):
+            baseline_values = baseline_metrics.get(metric)
+            if not baseline_values or not candidate_values:
+                continue
+            baseline_median = statistics.median(baseline_values)
+            candidate_median = statistics.median(candidate_values)
+            if baseline_median == 0:
+                continue
+            change = (candidate_median - baseline_median) / abs(baseline_median)
+            worse = -change if HigherIsBetter(metric) else change
+            if metric == MAX_RSS_METRIC:
+                p_value = None
+                regression = worse > max_rss_relative_change
+            else:
+                p_value = MannWhitneyUPValue(baseline_values, candidate_values)
+                regression = p_value < alpha and worse > min_relative_change
+            comparisons.append(
+                {
+                    "benchmark": benchmark,
+                    "metric": metric,
+                    "baseline_median": baseline_median,
+                    "candidate_median": candidate_median,
+                    "baseline_p90": Percentile(baseline_values, 90),
+                    "candidate_p90": Percentile(candidate_values, 90),
+                    "relative_change": change,
+                    "p_value": p_value,
+                    "regression": regression,
+                }
+            )
+    return comparisons
+
+
+def ReadHistory(history_file: str) -> list:
+    """Returns the runs of the history, oldest first."""
+    if not os.path.exists(history_file):
+        return []
+    with open(history_file, "r") as f:
+        return [json.loads(line) for line in f if line.strip()]
+
+
+def AppendToHistory(history_file: str, run: dict):
+    with open(history_file, "a") as f:
+        f.write(json.dumps(run, sort_keys=True) + "\n")
+
+
+def FindBaseline(history: list, baseline_commit: str):
+    """Returns the latest run of `baseline_commit`, or the latest run."""
+    for run in reversed(history):
+        if not baseline_commit or run["commit"].startswith(baseline_commit):
+            return run
+    return None
+
+
+def _GitCommit() -> str:
+    try:
+        return subprocess.run(
+            ["git", "rev-parse", "HEAD"],
+            check=True,
+            capture_output=True,
+            text=True,
+        ).stdout.strip()
+    except (OSError, subprocess.CalledProcessError):
+        return "unknown"
+
+
+def _BinaryPath(target: str) -> str:
+    package, name = target.lstrip("/").split(":")
+    return os.path.join("bazel-bin", package, name)
+
+
+def RunBenchmarks(
+    targets: list, repetitions: int, bazel_flags: list, benchmark_args: list
+) -> dict:
+    """Builds and runs `targets`, returning a run of the history."""
+    subprocess.run(["bazel", "build"] + bazel_flags + targets, check=True)
+    results = {}
+    for target in targets:
+        with tempfile.TemporaryDirectory() as data_directory:
+            output = os.path.join(data_directory, "benchmark_results.json")
+            target_args = [
+                arg.format(data_directory=data_directory)
+                for arg in TARGET_ARGS.get(target, [])
+            ]
+            process = subprocess.Popen(
+                [
+                    _BinaryPath(target),
+                    f"--benchmark_repetitions={repetitions}",
+                    f"--benchmark_out={output}",
+                    "--benchmark_out_format=json",
+                ]
+                + target_args
+                + benchmark_args
+            )
+            # Waits for the process itself, so that its peak memory is
+            # measured rather than that of all children.
+            _, status, usage = os.wait4(process.pid, 0)
+            if os.waitstatus_to_exitcode(status) != 0:
+                print(f"{target} failed, skipping it.", file=sys.stderr)
+                continue
+            with open(output, "r") as f:
+                benchmark_results = ParseBenchmarkJson(json.load(f))
+        for benchmark, metrics in benchmark_results.items():
+            results[f"{target}/{benchmark}"] = metrics
+        # ru_maxrss is in KiB on Linux.
+        results[f"{target}/process"] = {MAX_RSS_METRIC: [float(usage.ru_maxrss)]}
+    return {
+        "timestamp": datetime.datetime.now(datetime.timezone.utc).isoformat(),
+        "commit": _GitCommit(),
+        "repetitions": repetitions,
+        "results": results,
+    }
+
+
+def PrintComparisons(comparisons: list):
+    for comparison in comparisons:
+        p_value = comparison["p_value"]
+        print(
+            "{flag} {benchmark} {metric}: {baseline_median:.4g} -> "
+            "{candidate_median:.4g} ({relative_change:+.1%}, p90 "
+            "{baseline_p90:.4g} -> {candidate_p90:.4g}, p={p})".format(
+                flag="REGRESSION" if comparison["regression"] else "ok",
+                p="n/a" if p_value is None else f"{p_value:.3g}",
+                **comparison,
+            )
+        )
+
+
+def Main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument(
+        "--history-file",
+        dest="history_file",
+        required=True,
+        help="JSON lines file the runs are appended to and compared against.",
+    )
+    parser.add_argument(
+        "--targets",
+        nargs="+",
+        default=DEFAULT_TARGETS,
+        help="Bazel benchmark targets to run.",
+    )
+    parser.add_argument("--repetitions", type=int, default=10)
+    parser.add_argument(
+        "--bazel-flags",
+        dest="bazel_flags",
+        nargs="*",
+        default=["-c", "opt"],
+    )
+    parser.add_argument(
+        "--benchmark-args",
+        dest="benchmark_args",
+        nargs="*",
+        default=[],
+        help="Extra flags of the benchmarks, e.g. --benchmark_filter=.",
+    )
+    parser.add_argument(
+        "--baseline-commit",
+        dest="baseline_commit",
+        default="",
+        help="Commit, or prefix, of the baseline run. Defaults to the latest.",
+    )
+    parser.add_argument(
+        "--compare-only",
+        dest="compare_only",
+        action="store_true",
+        help="Compares the latest run of the history instead of running.",
+    )
+    parser.add_argument("--alpha", type=float, default=0.01)
+    parser.add_argument(
+        "--min-relative-change",
+        dest="min_relative_change",
+        type=float,
+        default=0.05,
+    )
+    parser.add_argument(
+        "--max-rss-relative-change",
+        dest="max_rss_relative_change",
+        type=float,
+        default=0.1,
+    )
+    args = parser.parse_args()
+
+    history = ReadHistory(args.history_file)
+    if args.compare_only:
+        if not history:
+            sys.exit(f"{args.history_file} has no runs.")
+        candidate = history.pop()
+    else:
+        candidate = RunBenchmarks(
+            args.targets, args.repetitions, args.bazel_flags, args.benchmark_args
+        )
+        AppendToHistory(args.history_file, candidate)
+    baseline = FindBaseline(history, args.baseline_commit)
+    if baseline is None:
+        print("No baseline run to compare against.")
+        return
+    print(f"Comparing {candidate['commit']} against {baseline['commit']}")
+    comparisons = Compare(
+        baseline,
+        candidate,
+        args.alpha,
+        args.min_relative_change,
+        args.max_rss_relative_change,
+    )
+    PrintComparisons(comparisons)
+    if any(comparison["regression"] for comparison in comparisons):
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    Main()
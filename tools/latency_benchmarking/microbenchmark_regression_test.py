@@ -0,0 +1,162 @@
+# Copyright 2024 Google LLC
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+"""Tests for microbenchmark_regression."""
+import microbenchmark_regression
+import os
+import tempfile
+import unittest
+
+
+def MakeRun(commit, metrics):
+    return {"commit": commit, "results": {"//target/BM_Test": metrics}}
+
+
+class MicrobenchmarkRegressionTest(unittest.TestCase):
+    def test_parses_repetitions_and_skips_aggregates(self):
+        results = microbenchmark_regression.ParseBenchmarkJson(
+            {
+                "benchmarks": [
+                    {
+                        "name": "BM_Test/8",
+                        "run_name": "BM_Test/8",
+                        "run_type": "iteration",
+                        "iterations": 100,
+                        "real_time": 2.0,
+                        "cpu_time": 1.5,
+                        "time_unit": "us",
+                        "items_per_second": 500.0,
+                    },
+                    {
+                        "name": "BM_Test/8",
+                        "run_name": "BM_Test/8",
+                        "run_type": "iteration",
+                        "iterations": 100,
+                        "real_time": 3.0,
+                        "cpu_time": 2.5,
+                        "time_unit": "us",
+                        "items_per_second": 400.0,
+                    },
+                    {
+                        "name": "BM_Test/8_mean",
+                        "run_name": "BM_Test/8",
+                        "run_type": "aggregate",
+                        "aggregate_name": "mean",
+                        "real_time": 2.5,
+                        "time_unit": "us",
+                    },
+                ]
+            }
+        )
+        self.assertEqual(
+            results,
+            {
+                "BM_Test/8": {
+                    "real_time_ns": [2000.0, 3000.0],
+                    "cpu_time_ns": [1500.0, 2500.0],
+                    "items_per_second": [500.0, 400.0],
+                }
+            },
+        )
+
+    def test_mann_whitney_u_p_values(self):
+        self.assertAlmostEqual(
+            microbenchmark_regression.MannWhitneyUPValue(
+                list(range(10)), list(range(10))
+            ),
+            1.0,
+        )
+        self.assertLess(
+            microbenchmark_regression.MannWhitneyUPValue(
+                list(range(10)), list(range(100, 110))
+            ),
+            0.001,
+        )
+        self.assertEqual(
+            microbenchmark_regression.MannWhitneyUPValue([1.0] * 5, [1.0] * 5),
+            1.0,
+        )
+
+    def test_flags_significant_regressions_only(self):
+        baseline = MakeRun(
+            "a",
+            {
+                "real_time_ns": [100.0 + i for i in range(10)],
+                "items_per_second": [1000.0 + i for i in range(10)],
+                "cpu_time_ns": [100.0 + i for i in range(10)],
+            },
+        )
+        candidate = MakeRun(
+            "b",
+            {
+                # Significantly slower.
+                "real_time_ns": [150.0 + i for i in range(10)],
+                # Significantly higher throughput.
+                "items_per_second": [1500.0 + i for i in range(10)],
+                # Noise.
+                "cpu_time_ns": [101.0 + i for i in range(10)],
+            },
+        )
+        comparisons = microbenchmark_regression.Compare(
+            baseline,
+            candidate,
+            alpha=0.01,
+            min_relative_change=0.05,
+            max_rss_relative_change=0.1,
+        )
+        regressions = {c["metric"]: c["regression"] for c in comparisons}
+        self.assertEqual(
+            regressions,
+            {
+                "cpu_time_ns": False,
+                "items_per_second": False,
+                "real_time_ns": True,
+            },
+        )
+
+    def test_flags_memory_growth(self):
+        metric = microbenchmark_regression.MAX_RSS_METRIC
+        comparisons = microbenchmark_regression.Compare(
+            MakeRun("a", {metric: [1000.0]}),
+            MakeRun("b", {metric: [1200.0]}),
+            alpha=0.01,
+            min_relative_change=0.05,
+            max_rss_relative_change=0.1,
+        )
+        self.assertEqual(len(comparisons), 1)
+        self.assertTrue(comparisons[0]["regression"])
+        self.assertIsNone(comparisons[0]["p_value"])
+
+    def test_history_round_trip_and_baseline(self):
+        with tempfile.TemporaryDirectory() as directory:
+            history_file = os.path.join(directory, "history.jsonl")
+            self.assertEqual(microbenchmark_regression.ReadHistory(history_file), [])
+            microbenchmark_regression.AppendToHistory(
+                history_file, MakeRun("aaaa", {})
+            )
+            microbenchmark_regression.AppendToHistory(
+                history_file, MakeRun("bbbb", {})
+            )
+            history = microbenchmark_regression.ReadHistory(history_file)
+        self.assertEqual([run["commit"] for run in history], ["aaaa", "bbbb"])
+        self.assertEqual(
+            microbenchmark_regression.FindBaseline(history, "")["commit"], "bbbb"
+        )
+        self.assertEqual(
+            microbenchmark_regression.FindBaseline(history, "aa")["commit"], "aaaa"
+        )
+        self.assertIsNone(microbenchmark_regression.FindBaseline(history, "cc"))
+
+
+if __name__ == "__main__":
+    unittest.main()
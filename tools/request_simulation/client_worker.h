@@ -18,11 +18,14 @@
 #define TOOLS_REQUEST_SIMULATION_CLIENT_WORKER_H_
 
 #include <memory>
+#include <optional>
 #include <string>
 #include <utility>
 
 #include "absl/functional/any_invocable.h"
 #include "absl/log/log.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
 #include "components/data/common/thread_manager.h"
 #include "grpcpp/grpcpp.h"
 #include "tools/request_simulation/grpc_client.h"
@@ -55,16 +58,23 @@ class ClientWorker {
   // Message queue to read and send requests from
   //
   // Rate limiter to control the rate of the requests sent.
+  //
+  // Requests per second of the open-loop mode. If positive, the worker sends
+  // requests asynchronously on a fixed timeline of this rate instead of
+  // acquiring permits from the rate limiter and waiting for each response,
+  // so the offered load does not drop when the server slows down. Latencies
+  // are then also recorded from the intended send time of each request.
   ClientWorker(int id, std::shared_ptr<grpc::Channel> channel,
                std::string_view service_method, absl::Duration request_timeout,
                absl::AnyInvocable<RequestT(std::string)> request_converter,
                MessageQueue& message_queue, RateLimiter& rate_limiter,
                MetricsCollector& metrics_collector,
-               bool is_client_channel = true)
+               bool is_client_channel = true, int64_t open_loop_rps = 0)
       : service_method_(service_method),
         message_queue_(message_queue),
         rate_limiter_(rate_limiter),
         metrics_collector_(metrics_collector),
+        open_loop_rps_(open_loop_rps),
         request_converter_(std::move(request_converter)),
         thread_manager_(
             ThreadManager::Create(absl::StrCat("Client worker ", id))) {
@@ -85,10 +95,21 @@ class ClientWorker {
  private:
   // The actual function that sends requests.
   void SendRequests();
+  // Sends requests asynchronously at `open_loop_rps_` and waits for the
+  // outstanding responses once stopped.
+  void SendRequestsOpenLoop();
+  // Records the metrics of a response to a request sent at `send_time`,
+  // which was intended to be sent at `intended_send_time` in open-loop mode.
+  void RecordResponse(const absl::Status& status, absl::Time send_time,
+                      std::optional<absl::Time> intended_send_time);
   std::string service_method_;
   MessageQueue& message_queue_;
   RateLimiter& rate_limiter_;
   MetricsCollector& metrics_collector_;
+  int64_t open_loop_rps_;
+  absl::Mutex mutex_;
+  // Number of open-loop requests waiting for a response.
+  int64_t outstanding_requests_ ABSL_GUARDED_BY(mutex_) = 0;
   // Grpc client used to send requests.
   std::unique_ptr<GrpcClient<RequestT, ResponseT>> grpc_client_;
   absl::AnyInvocable<RequestT(std::string)> request_converter_;
@@ -98,6 +119,9 @@ class ClientWorker {
 
 template <typename RequestT, typename ResponseT>
 absl::Status ClientWorker<RequestT, ResponseT>::Start() {
+  if (open_loop_rps_ > 0) {
+    return thread_manager_->Start([this]() { SendRequestsOpenLoop(); });
+  }
   return thread_manager_->Start([this]() { SendRequests(); });
 }
 
@@ -126,15 +150,7 @@ void ClientWorker<RequestT, ResponseT>::SendRequests() {
         auto status =
             grpc_client_->SendMessage(request_converter_(request_body.value()),
                                       service_method_, response);
-        metrics_collector_.IncrementServerResponseStatusEvent(status);
-        if (!status.ok()) {
-          VLOG(8) << "Received error in response " << status;
-          metrics_collector_.IncrementRequestsWithErrorResponsePerInterval();
-        } else {
-          metrics_collector_.IncrementRequestsWithOkResponsePerInterval();
-          metrics_collector_.AddLatencyToHistogram(absl::Now() - start);
-          VLOG(9) << "Received ok response";
-        }
+        RecordResponse(status, start, std::nullopt);
       }
     } else {
       VLOG(8) << "Acquire timeout";
@@ -142,6 +158,62 @@ void ClientWorker<RequestT, ResponseT>::SendRequests() {
   }
 }
 
+template <typename RequestT, typename ResponseT>
+void ClientWorker<RequestT, ResponseT>::SendRequestsOpenLoop() {
+  const absl::Duration send_interval = absl::Seconds(1) / open_loop_rps_;
+  absl::Time intended_send_time = absl::Now();
+  while (!thread_manager_->ShouldStop()) {
+    // The timeline does not move with the server's response times, a send
+    // that falls behind it is counted from its intended send time.
+    intended_send_time += send_interval;
+    absl::SleepFor(intended_send_time - absl::Now());
+    const auto request_body = message_queue_.Pop();
+    if (!request_body.ok()) {
+      continue;
+    }
+    VLOG(8) << "Sending message " << request_body.value();
+    metrics_collector_.IncrementRequestSentPerInterval();
+    {
+      absl::MutexLock lock(&mutex_);
+      ++outstanding_requests_;
+    }
+    auto request =
+        std::make_shared<RequestT>(request_converter_(request_body.value()));
+    auto start = absl::Now();
+    grpc_client_->SendMessageAsync(
+        std::move(request), service_method_, std::make_shared<ResponseT>(),
+        [this, start, intended_send_time](absl::Status status) {
+          RecordResponse(status, start, intended_send_time);
+          absl::MutexLock lock(&mutex_);
+          --outstanding_requests_;
+        });
+  }
+  absl::MutexLock lock(&mutex_);
+  mutex_.Await(absl::Condition(
+      +[](int64_t* outstanding_requests) { return *outstanding_requests == 0; },
+      &outstanding_requests_));
+}
+
+template <typename RequestT, typename ResponseT>
+void ClientWorker<RequestT, ResponseT>::RecordResponse(
+    const absl::Status& status, absl::Time send_time,
+    std::optional<absl::Time> intended_send_time) {
+  metrics_collector_.IncrementServerResponseStatusEvent(status);
+  if (!status.ok()) {
+    VLOG(8) << "Received error in response " << status;
+    metrics_collector_.IncrementRequestsWithErrorResponsePerInterval();
+    return;
+  }
+  const absl::Time now = absl::Now();
+  metrics_collector_.IncrementRequestsWithOkResponsePerInterval();
+  metrics_collector_.AddLatencyToHistogram(now - send_time);
+  if (intended_send_time.has_value()) {
+    metrics_collector_.AddCorrectedLatencyToHistogram(now -
+                                                      *intended_send_time);
+  }
+  VLOG(9) << "Received ok response";
+}
+
 }  // namespace kv_server
 
 #endif  // TOOLS_REQUEST_SIMULATION_CLIENT_WORKER_H_
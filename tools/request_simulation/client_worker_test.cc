@@ -92,7 +92,7 @@ TEST_F(ClientWorkerTest, SingleClientWorkerTest) {
                            std::move(sleep_for_), absl::Seconds(0));
   EXPECT_CALL(*sleep_for_metrics_collector_, Duration(_))
       .WillRepeatedly(Return(true));
-  EXPECT_CALL(metrics_recorder_, RegisterHistogram(_, _, _, _)).Times(5);
+  EXPECT_CALL(metrics_recorder_, RegisterHistogram(_, _, _, _)).Times(8);
   std::unique_ptr<MockMetricsCollector> metrics_collector =
       std::make_unique<MockMetricsCollector>(
           metrics_recorder_, std::move(sleep_for_metrics_collector_));
@@ -136,7 +136,7 @@ TEST_F(ClientWorkerTest, MultipleClientWorkersTest) {
                            std::move(sleep_for_), absl::Seconds(0));
   EXPECT_CALL(*sleep_for_metrics_collector_, Duration(_))
       .WillRepeatedly(Return(true));
-  EXPECT_CALL(metrics_recorder_, RegisterHistogram(_, _, _, _)).Times(5);
+  EXPECT_CALL(metrics_recorder_, RegisterHistogram(_, _, _, _)).Times(8);
   std::unique_ptr<MockMetricsCollector> metrics_collector =
       std::make_unique<MockMetricsCollector>(
           metrics_recorder_, std::move(sleep_for_metrics_collector_));
@@ -169,6 +169,52 @@ TEST_F(ClientWorkerTest, MultipleClientWorkersTest) {
   }
   EXPECT_EQ(message_queue.Size(), 500);
 }
+
+TEST_F(ClientWorkerTest, OpenLoopClientWorkerTest) {
+  std::string key("key");
+  std::string method("/kv_server.v2.KeyValueService/GetValuesHttp");
+  auto request_converter = [](const std::string& request_body) {
+    RawRequest request;
+    request.mutable_raw_body()->set_data(request_body);
+    return request;
+  };
+
+  MessageQueue message_queue(10000);
+  int num_of_messages_prefill = 100;
+  PrefillMessageQueue(message_queue, num_of_messages_prefill, key);
+
+  // The rate limiter is not used in open-loop mode.
+  RateLimiter rate_limiter(0, 1, sim_clock_, std::move(sleep_for_),
+                           absl::Seconds(0));
+  EXPECT_CALL(*sleep_for_metrics_collector_, Duration(_))
+      .WillRepeatedly(Return(true));
+  EXPECT_CALL(metrics_recorder_, RegisterHistogram(_, _, _, _)).Times(8);
+  std::unique_ptr<MockMetricsCollector> metrics_collector =
+      std::make_unique<MockMetricsCollector>(
+          metrics_recorder_, std::move(sleep_for_metrics_collector_));
+  EXPECT_CALL(*metrics_collector, IncrementServerResponseStatusEvent(_))
+      .Times(num_of_messages_prefill);
+  EXPECT_CALL(*metrics_collector, IncrementRequestSentPerInterval())
+      .Times(num_of_messages_prefill);
+  EXPECT_CALL(*metrics_collector, IncrementRequestsWithOkResponsePerInterval())
+      .Times(num_of_messages_prefill);
+  EXPECT_CALL(*metrics_collector, AddLatencyToHistogram(_))
+      .Times(num_of_messages_prefill);
+  EXPECT_CALL(*metrics_collector, AddCorrectedLatencyToHistogram(_))
+      .Times(num_of_messages_prefill);
+  int requests_per_second = 1000;
+  auto worker =
+      std::make_unique<ClientWorker<RawRequest, google::api::HttpBody>>(
+          0, server_->InProcessChannel(grpc::ChannelArguments()), method,
+          absl::Seconds(1), request_converter, message_queue, rate_limiter,
+          *metrics_collector, false, requests_per_second);
+  EXPECT_TRUE(worker->Start().ok());
+  EXPECT_TRUE(worker->IsRunning());
+  absl::SleepFor(absl::Seconds(1));
+  // Stopping waits for the responses of the requests sent.
+  EXPECT_TRUE(worker->Stop().ok());
+  EXPECT_TRUE(message_queue.Empty());
+}
 }  // namespace
 
 }  // namespace kv_server
@@ -128,6 +128,9 @@ DeltaBasedRequestGenerator::CreateRequestsAndAddToMessageQueue(
       if (record->value_type() == Value::StringValue) {
         options_.message_queue.Push(
             request_generation_fn_(record->key()->string_view()));
+        if (options_.key_space != nullptr) {
+          options_.key_space->AddKey(record->key()->string_view());
+        }
         if (record->mutation_type() == KeyValueMutationType::Update) {
           data_loading_stats.total_updated_records++;
         } else if (record->mutation_type() == KeyValueMutationType::Delete) {
@@ -31,6 +31,7 @@
 #include "public/data_loading/readers/riegeli_stream_io.h"
 #include "public/data_loading/readers/stream_record_reader_factory.h"
 #include "src/telemetry/metrics_recorder.h"
+#include "tools/request_simulation/key_generator.h"
 #include "tools/request_simulation/message_queue.h"
 #include "tools/request_simulation/request_generation_util.h"
 
@@ -50,6 +51,9 @@ class DeltaBasedRequestGenerator {
     DeltaFileNotifier& delta_notifier;
     BlobStorageChangeNotifier& change_notifier;
     StreamRecordReaderFactory& delta_stream_reader_factory;
+    // If set, the keys read from delta files are also added to this key
+    // space, for synthetic requests to pick keys from.
+    KeySpace* key_space = nullptr;
   };
   DeltaBasedRequestGenerator(
       Options options,
@@ -82,13 +82,15 @@ class GenerateRequestsFromDeltaFilesTest : public ::testing::Test {
  protected:
   GenerateRequestsFromDeltaFilesTest()
       : message_queue_(10000),
+        key_space_(KeySpace::Create(10)),
         options_(DeltaBasedRequestGenerator::Options{
             .data_bucket = GetTestLocation().bucket,
             .message_queue = message_queue_,
             .blob_client = blob_client_,
             .delta_notifier = notifier_,
             .change_notifier = change_notifier_,
-            .delta_stream_reader_factory = delta_stream_reader_factory_}) {}
+            .delta_stream_reader_factory = delta_stream_reader_factory_,
+            .key_space = key_space_.get()}) {}
 
   MockBlobStorageClient blob_client_;
   MockDeltaFileNotifier notifier_;
@@ -96,6 +98,7 @@ class GenerateRequestsFromDeltaFilesTest : public ::testing::Test {
   MockStreamRecordReaderFactory delta_stream_reader_factory_;
   MockMetricsRecorder metrics_recorder_;
   MessageQueue message_queue_;
+  std::unique_ptr<KeySpace> key_space_;
   DeltaBasedRequestGenerator::Options options_;
 };
 
@@ -148,6 +151,9 @@ TEST_F(GenerateRequestsFromDeltaFilesTest, LoadingDataFromDeltaFiles) {
   EXPECT_TRUE(message_in_the_queue.ok());
   EXPECT_EQ(message_in_the_queue.value(),
             kv_server::CreateKVDSPRequestBodyInJson({std::string("key")}));
+  // Synthetic requests can pick the keys read from delta files.
+  EXPECT_EQ(key_space_->Size(), 1);
+  EXPECT_EQ(key_space_->KeyAt(0), "key");
 }
 
 }  // namespace
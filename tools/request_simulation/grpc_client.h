@@ -24,6 +24,7 @@
 #include "absl/functional/any_invocable.h"
 #include "absl/status/statusor.h"
 #include "absl/synchronization/notification.h"
+#include "absl/time/time.h"
 #include "grpcpp/generic/generic_stub.h"
 #include "grpcpp/grpcpp.h"
 #include "src/google/protobuf/message.h"
@@ -156,6 +157,36 @@ class GrpcClient {
     }
     return *grpc_status;
   }
+  // Sends message via grpc unary call without waiting for the response.
+  // The callback is called with the call status once the response is
+  // received or the call passes the timeout deadline, it may be called on a
+  // grpc thread.
+  void SendMessageAsync(std::shared_ptr<RequestT> request,
+                        const std::string& request_method,
+                        std::shared_ptr<ResponseT> response,
+                        absl::AnyInvocable<void(absl::Status)> callback) {
+    if (is_client_channel_ &&
+        grpc_channel_->GetState(true) != GRPC_CHANNEL_READY) {
+      callback(absl::UnavailableError("GRPC channel is disconnected"));
+      return;
+    }
+    std::shared_ptr<grpc::ClientContext> client_context =
+        std::make_shared<grpc::ClientContext>();
+    client_context->set_deadline(absl::ToChronoTime(absl::Now() + timeout_));
+    // grpc requires a copyable callback, and the request, response and client
+    // context must outlive the call.
+    auto shared_callback =
+        std::make_shared<absl::AnyInvocable<void(absl::Status)>>(
+            std::move(callback));
+    generic_stub_->UnaryCall(
+        client_context.get(), request_method, grpc::StubOptions(),
+        request.get(), response.get(),
+        [request, response, client_context,
+         shared_callback](grpc::Status status) {
+          (*shared_callback)(absl::Status(
+              absl::StatusCode(status.error_code()), status.error_message()));
+        });
+  }
 
  private:
   absl::Duration timeout_;
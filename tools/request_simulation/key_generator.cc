@@ -0,0 +1,246 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tools/request_simulation/key_generator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <optional>
+#include <utility>
+
+#include "absl/memory/memory.h"
+#include "absl/random/random.h"
+#include "absl/random/zipf_distribution.h"
+#include "absl/strings/ascii.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/str_split.h"
+
+namespace kv_server {
+namespace {
+
+// Generates keys by picking their index in a key space.
+class KeySpaceKeyGenerator : public KeyGenerator {
+ public:
+  explicit KeySpaceKeyGenerator(const KeySpace& key_space)
+      : key_space_(key_space) {}
+
+  absl::StatusOr<std::vector<std::string>> GenerateKeys(
+      int number_of_keys) override {
+    const int64_t num_keys = key_space_.Size();
+    if (num_keys == 0) {
+      return absl::FailedPreconditionError("Key space is empty");
+    }
+    std::vector<std::string> keys;
+    keys.reserve(number_of_keys);
+    for (int i = 0; i < number_of_keys; ++i) {
+      keys.push_back(key_space_.KeyAt(NextKeyIndex(num_keys)));
+    }
+    return keys;
+  }
+
+ protected:
+  // Returns the index of the next key in a key space of `num_keys` keys.
+  virtual int64_t NextKeyIndex(int64_t num_keys) = 0;
+
+  absl::BitGen bitgen_;
+
+ private:
+  const KeySpace& key_space_;
+};
+
+class UniformKeyGenerator : public KeySpaceKeyGenerator {
+ public:
+  using KeySpaceKeyGenerator::KeySpaceKeyGenerator;
+
+ protected:
+  int64_t NextKeyIndex(int64_t num_keys) override {
+    return absl::Uniform<int64_t>(bitgen_, 0, num_keys);
+  }
+};
+
+class ZipfianKeyGenerator : public KeySpaceKeyGenerator {
+ public:
+  ZipfianKeyGenerator(const KeySpace& key_space, double exponent)
+      : KeySpaceKeyGenerator(key_space), exponent_(exponent) {}
+
+ protected:
+  int64_t NextKeyIndex(int64_t num_keys) override {
+    if (num_keys == 1) {
+      return 0;
+    }
+    // The key space grows while delta files are read, the distribution is
+    // only rebuilt then since building it is not free.
+    if (distribution_num_keys_ != num_keys) {
+      distribution_.emplace(num_keys - 1, exponent_);
+      distribution_num_keys_ = num_keys;
+    }
+    return (*distribution_)(bitgen_);
+  }
+
+ private:
+  const double exponent_;
+  int64_t distribution_num_keys_ = 0;
+  std::optional<absl::zipf_distribution<int64_t>> distribution_;
+};
+
+class HotspotKeyGenerator : public KeySpaceKeyGenerator {
+ public:
+  HotspotKeyGenerator(const KeySpace& key_space, double key_fraction,
+                      double request_fraction)
+      : KeySpaceKeyGenerator(key_space),
+        key_fraction_(key_fraction),
+        request_fraction_(request_fraction) {}
+
+ protected:
+  int64_t NextKeyIndex(int64_t num_keys) override {
+    const int64_t num_hot_keys = std::clamp<int64_t>(
+        std::ceil(num_keys * key_fraction_), 1, num_keys);
+    if (num_hot_keys == num_keys ||
+        absl::Bernoulli(bitgen_, request_fraction_)) {
+      return absl::Uniform<int64_t>(bitgen_, 0, num_hot_keys);
+    }
+    return absl::Uniform<int64_t>(bitgen_, num_hot_keys, num_keys);
+  }
+
+ private:
+  const double key_fraction_;
+  const double request_fraction_;
+};
+
+class TraceReplayKeyGenerator : public KeyGenerator {
+ public:
+  explicit TraceReplayKeyGenerator(
+      std::vector<std::vector<std::string>> key_sets)
+      : key_sets_(std::move(key_sets)) {}
+
+  absl::StatusOr<std::vector<std::string>> GenerateKeys(
+      int number_of_keys) override {
+    const auto& keys = key_sets_[next_key_set_];
+    next_key_set_ = (next_key_set_ + 1) % key_sets_.size();
+    return keys;
+  }
+
+ private:
+  const std::vector<std::vector<std::string>> key_sets_;
+  size_t next_key_set_ = 0;
+};
+
+absl::StatusOr<std::vector<std::vector<std::string>>> ReadTraceKeySets(
+    const std::string& trace_file) {
+  std::ifstream trace_stream(trace_file);
+  if (!trace_stream.is_open()) {
+    return absl::NotFoundError(
+        absl::StrCat("Failed to open trace file ", trace_file));
+  }
+  std::vector<std::vector<std::string>> key_sets;
+  std::string line;
+  while (std::getline(trace_stream, line)) {
+    std::vector<std::string> keys;
+    for (absl::string_view key : absl::StrSplit(line, ',')) {
+      key = absl::StripAsciiWhitespace(key);
+      if (!key.empty()) {
+        keys.emplace_back(key);
+      }
+    }
+    if (!keys.empty()) {
+      key_sets.push_back(std::move(keys));
+    }
+  }
+  if (key_sets.empty()) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("Trace file ", trace_file, " has no keys"));
+  }
+  return key_sets;
+}
+
+}  // namespace
+
+std::unique_ptr<KeySpace> KeySpace::CreateSynthetic(int64_t num_keys,
+                                                    int key_size) {
+  return absl::WrapUnique(
+      new KeySpace(std::max<int64_t>(num_keys, 0), key_size,
+                   /*max_num_keys=*/0));
+}
+
+std::unique_ptr<KeySpace> KeySpace::Create(int64_t max_num_keys) {
+  return absl::WrapUnique(new KeySpace(/*num_synthetic_keys=*/0,
+                                       /*key_size=*/0, max_num_keys));
+}
+
+void KeySpace::AddKey(std::string_view key) {
+  absl::MutexLock lock(&mutex_);
+  if (static_cast<int64_t>(keys_.size()) < max_num_keys_) {
+    keys_.emplace_back(key);
+  }
+}
+
+int64_t KeySpace::Size() const {
+  if (num_synthetic_keys_ > 0) {
+    return num_synthetic_keys_;
+  }
+  absl::MutexLock lock(&mutex_);
+  return keys_.size();
+}
+
+std::string KeySpace::KeyAt(int64_t index) const {
+  if (num_synthetic_keys_ > 0) {
+    return absl::StrFormat("%0*d", key_size_, index);
+  }
+  absl::MutexLock lock(&mutex_);
+  return keys_[index];
+}
+
+absl::StatusOr<std::unique_ptr<KeyGenerator>> CreateKeyGenerator(
+    const KeyGeneratorOptions& options, const KeySpace& key_space) {
+  switch (options.distribution) {
+    case KeyDistribution::kUniform:
+      return std::make_unique<UniformKeyGenerator>(key_space);
+    case KeyDistribution::kZipfian:
+      if (!(options.zipfian_exponent > 1)) {
+        return absl::InvalidArgumentError(
+            absl::StrCat("Zipfian exponent must be greater than 1, got ",
+                         options.zipfian_exponent));
+      }
+      return std::make_unique<ZipfianKeyGenerator>(key_space,
+                                                   options.zipfian_exponent);
+    case KeyDistribution::kHotspot:
+      if (!(options.hotspot_key_fraction > 0 &&
+            options.hotspot_key_fraction <= 1) ||
+          !(options.hotspot_request_fraction >= 0 &&
+            options.hotspot_request_fraction <= 1)) {
+        return absl::InvalidArgumentError(absl::StrCat(
+            "Hotspot fractions must be within [0, 1] and the key fraction "
+            "positive, got key fraction ",
+            options.hotspot_key_fraction, " and request fraction ",
+            options.hotspot_request_fraction));
+      }
+      return std::make_unique<HotspotKeyGenerator>(
+          key_space, options.hotspot_key_fraction,
+          options.hotspot_request_fraction);
+    case KeyDistribution::kTraceReplay: {
+      auto key_sets = ReadTraceKeySets(options.trace_file);
+      if (!key_sets.ok()) {
+        return key_sets.status();
+      }
+      return std::make_unique<TraceReplayKeyGenerator>(std::move(*key_sets));
+    }
+    default:
+      return absl::InvalidArgumentError(
+          absl::StrCat("Unsupported key distribution ",
+                       AbslUnparseFlag(options.distribution)));
+  }
+}
+
+}  // namespace kv_server
@@ -0,0 +1,155 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TOOLS_REQUEST_SIMULATION_KEY_GENERATOR_H_
+#define TOOLS_REQUEST_SIMULATION_KEY_GENERATOR_H_
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/synchronization/mutex.h"
+
+namespace kv_server {
+
+// Distribution of the keys of synthetic requests.
+enum class KeyDistribution {
+  // Every key of the key space is equally likely
+  kUniform = 0,
+  // The popularity of the key of rank i decays as 1 / (i + 1)^exponent
+  kZipfian,
+  // A fraction of the requests hits a small set of hot keys
+  kHotspot,
+  // The keys of requests are replayed in order from a trace file
+  kTraceReplay,
+};
+
+// Overloads AbslParseFlag and AbslUnparseFlag to allow KeyDistribution
+// passed as enum flag. https://abseil.io/docs/cpp/guides/flags#custom
+inline bool AbslParseFlag(absl::string_view text,
+                          KeyDistribution* distribution, std::string* error) {
+  if (text == "uniform") {
+    *distribution = KeyDistribution::kUniform;
+    return true;
+  }
+  if (text == "zipfian") {
+    *distribution = KeyDistribution::kZipfian;
+    return true;
+  }
+  if (text == "hotspot") {
+    *distribution = KeyDistribution::kHotspot;
+    return true;
+  }
+  if (text == "trace_replay") {
+    *distribution = KeyDistribution::kTraceReplay;
+    return true;
+  }
+  *error = "unknown value for enumeration";
+  return false;
+}
+
+inline std::string AbslUnparseFlag(KeyDistribution distribution) {
+  switch (distribution) {
+    case KeyDistribution::kUniform:
+      return "uniform";
+    case KeyDistribution::kZipfian:
+      return "zipfian";
+    case KeyDistribution::kHotspot:
+      return "hotspot";
+    case KeyDistribution::kTraceReplay:
+      return "trace_replay";
+    default:
+      return absl::StrCat(distribution);
+  }
+}
+
+// The keys that synthetic requests pick from. Either a fixed number of
+// synthetic keys derived from their index, or the keys added with `AddKey`,
+// e.g., the keys of delta files read by `DeltaBasedRequestGenerator`, so that
+// the skew of synthetic requests applies to keys the server has. Keys are
+// ordered by popularity for the distributions, i.e., the first keys are the
+// hot ones. Thread-safe.
+class KeySpace {
+ public:
+  // Creates a key space of `num_keys` synthetic keys of `key_size` bytes.
+  static std::unique_ptr<KeySpace> CreateSynthetic(int64_t num_keys,
+                                                   int key_size);
+  // Creates an empty key space that holds up to `max_num_keys` keys added
+  // with `AddKey`.
+  static std::unique_ptr<KeySpace> Create(int64_t max_num_keys);
+
+  // Adds a key to the key space unless it is full. Ignored for synthetic key
+  // spaces.
+  void AddKey(std::string_view key) ABSL_LOCKS_EXCLUDED(mutex_);
+  // Returns the number of keys of the key space.
+  int64_t Size() const ABSL_LOCKS_EXCLUDED(mutex_);
+  // Returns the key at `index`, which must be less than `Size()`.
+  std::string KeyAt(int64_t index) const ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // KeySpace is neither copyable nor movable.
+  KeySpace(const KeySpace&) = delete;
+  KeySpace& operator=(const KeySpace&) = delete;
+
+ private:
+  KeySpace(int64_t num_synthetic_keys, int key_size, int64_t max_num_keys)
+      : num_synthetic_keys_(num_synthetic_keys),
+        key_size_(key_size),
+        max_num_keys_(max_num_keys) {}
+
+  const int64_t num_synthetic_keys_;
+  const int key_size_;
+  const int64_t max_num_keys_;
+  mutable absl::Mutex mutex_;
+  std::vector<std::string> keys_ ABSL_GUARDED_BY(mutex_);
+};
+
+struct KeyGeneratorOptions {
+  KeyDistribution distribution = KeyDistribution::kUniform;
+  // Exponent of the Zipfian distribution, must be greater than 1.
+  double zipfian_exponent = 1.1;
+  // Fraction of the key space that is hot for the hotspot distribution.
+  double hotspot_key_fraction = 0.2;
+  // Fraction of the keys of requests that are hot keys for the hotspot
+  // distribution.
+  double hotspot_request_fraction = 0.8;
+  // File with the keys of one request per line, separated by commas, for
+  // the trace replay distribution. The trace is replayed in a loop.
+  std::string trace_file;
+};
+
+// Generates the keys of synthetic requests. Not thread-safe.
+class KeyGenerator {
+ public:
+  virtual ~KeyGenerator() = default;
+  // Generates the keys of the next request, which are `number_of_keys` keys
+  // unless they are replayed from a trace. Returns an error if there is no
+  // key to generate from, e.g., no delta file was read yet.
+  virtual absl::StatusOr<std::vector<std::string>> GenerateKeys(
+      int number_of_keys) = 0;
+};
+
+// Creates a key generator of `options.distribution`, which picks keys from
+// `key_space` unless it replays a trace. `key_space` must outlive the key
+// generator.
+absl::StatusOr<std::unique_ptr<KeyGenerator>> CreateKeyGenerator(
+    const KeyGeneratorOptions& options, const KeySpace& key_space);
+
+}  // namespace kv_server
+
+#endif  // TOOLS_REQUEST_SIMULATION_KEY_GENERATOR_H_
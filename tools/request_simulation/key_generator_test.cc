@@ -0,0 +1,163 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tools/request_simulation/key_generator.h"
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "gtest/gtest.h"
+
+namespace kv_server {
+namespace {
+
+constexpr int kNumKeysGenerated = 10000;
+
+// Returns how often each key was generated.
+absl::flat_hash_map<std::string, int> CountKeys(KeyGenerator& key_generator) {
+  absl::flat_hash_map<std::string, int> key_counts;
+  auto keys = key_generator.GenerateKeys(kNumKeysGenerated);
+  EXPECT_TRUE(keys.ok()) << keys.status();
+  for (const auto& key : *keys) {
+    ++key_counts[key];
+  }
+  return key_counts;
+}
+
+TEST(KeySpaceTest, SyntheticKeySpace) {
+  auto key_space = KeySpace::CreateSynthetic(100, 5);
+  EXPECT_EQ(key_space->Size(), 100);
+  EXPECT_EQ(key_space->KeyAt(42), "00042");
+  key_space->AddKey("ignored");
+  EXPECT_EQ(key_space->Size(), 100);
+}
+
+TEST(KeySpaceTest, KeySpaceOfAddedKeys) {
+  auto key_space = KeySpace::Create(2);
+  EXPECT_EQ(key_space->Size(), 0);
+  key_space->AddKey("first");
+  key_space->AddKey("second");
+  key_space->AddKey("third");
+  EXPECT_EQ(key_space->Size(), 2);
+  EXPECT_EQ(key_space->KeyAt(1), "second");
+}
+
+TEST(KeyGeneratorTest, EmptyKeySpaceFails) {
+  auto key_space = KeySpace::Create(10);
+  auto key_generator = CreateKeyGenerator(KeyGeneratorOptions{}, *key_space);
+  ASSERT_TRUE(key_generator.ok());
+  EXPECT_EQ((*key_generator)->GenerateKeys(1).status().code(),
+            absl::StatusCode::kFailedPrecondition);
+  key_space->AddKey("key");
+  auto keys = (*key_generator)->GenerateKeys(2);
+  ASSERT_TRUE(keys.ok());
+  EXPECT_EQ(*keys, (std::vector<std::string>{"key", "key"}));
+}
+
+TEST(KeyGeneratorTest, UniformKeysCoverKeySpace) {
+  auto key_space = KeySpace::CreateSynthetic(10, 2);
+  auto key_generator = CreateKeyGenerator(
+      KeyGeneratorOptions{.distribution = KeyDistribution::kUniform},
+      *key_space);
+  ASSERT_TRUE(key_generator.ok());
+  auto key_counts = CountKeys(**key_generator);
+  EXPECT_EQ(key_counts.size(), 10);
+  for (const auto& [key, count] : key_counts) {
+    EXPECT_GT(count, kNumKeysGenerated / 20) << key;
+  }
+}
+
+TEST(KeyGeneratorTest, ZipfianKeysAreSkewed) {
+  auto key_space = KeySpace::CreateSynthetic(1000, 4);
+  auto key_generator =
+      CreateKeyGenerator(KeyGeneratorOptions{.distribution =
+                                                 KeyDistribution::kZipfian,
+                                             .zipfian_exponent = 1.5},
+                         *key_space);
+  ASSERT_TRUE(key_generator.ok());
+  auto key_counts = CountKeys(**key_generator);
+  // The most popular key takes about 40% of the requests with exponent 1.5.
+  EXPECT_GT(key_counts["0000"], kNumKeysGenerated / 4);
+  EXPECT_GT(key_counts["0000"], key_counts["0001"]);
+  EXPECT_GT(key_counts["0001"], key_counts["0009"]);
+}
+
+TEST(KeyGeneratorTest, InvalidZipfianExponentFails) {
+  auto key_space = KeySpace::CreateSynthetic(10, 2);
+  EXPECT_EQ(
+      CreateKeyGenerator(KeyGeneratorOptions{.distribution =
+                                                 KeyDistribution::kZipfian,
+                                             .zipfian_exponent = 0.99},
+                         *key_space)
+          .status()
+          .code(),
+      absl::StatusCode::kInvalidArgument);
+}
+
+TEST(KeyGeneratorTest, HotspotKeysHitHotKeys) {
+  auto key_space = KeySpace::CreateSynthetic(100, 3);
+  auto key_generator = CreateKeyGenerator(
+      KeyGeneratorOptions{.distribution = KeyDistribution::kHotspot,
+                          .hotspot_key_fraction = 0.1,
+                          .hotspot_request_fraction = 0.9},
+      *key_space);
+  ASSERT_TRUE(key_generator.ok());
+  int num_hot_keys_generated = 0;
+  for (const auto& [key, count] : CountKeys(**key_generator)) {
+    if (key < "010") {
+      num_hot_keys_generated += count;
+    }
+  }
+  EXPECT_GT(num_hot_keys_generated, kNumKeysGenerated * 0.85);
+  EXPECT_LT(num_hot_keys_generated, kNumKeysGenerated * 0.95);
+}
+
+TEST(KeyGeneratorTest, TraceReplayKeysLoop) {
+  const std::string trace_file =
+      std::filesystem::path(::testing::TempDir()) / "key_trace";
+  {
+    std::ofstream trace_stream(trace_file);
+    trace_stream << "key1, key2\n\nkey3\n";
+  }
+  auto key_space = KeySpace::Create(0);
+  auto key_generator = CreateKeyGenerator(
+      KeyGeneratorOptions{.distribution = KeyDistribution::kTraceReplay,
+                          .trace_file = trace_file},
+      *key_space);
+  ASSERT_TRUE(key_generator.ok());
+  EXPECT_EQ((*key_generator)->GenerateKeys(1).value(),
+            (std::vector<std::string>{"key1", "key2"}));
+  EXPECT_EQ((*key_generator)->GenerateKeys(1).value(),
+            std::vector<std::string>{"key3"});
+  EXPECT_EQ((*key_generator)->GenerateKeys(1).value(),
+            (std::vector<std::string>{"key1", "key2"}));
+}
+
+TEST(KeyGeneratorTest, MissingTraceFileFails) {
+  auto key_space = KeySpace::Create(0);
+  EXPECT_EQ(CreateKeyGenerator(
+                KeyGeneratorOptions{.distribution =
+                                        KeyDistribution::kTraceReplay,
+                                    .trace_file = "/nonexistent/key_trace"},
+                *key_space)
+                .status()
+                .code(),
+            absl::StatusCode::kNotFound);
+}
+
+}  // namespace
+}  // namespace kv_server
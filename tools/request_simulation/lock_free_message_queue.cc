@@ -0,0 +1,161 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tools/request_simulation/lock_free_message_queue.h"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+namespace kv_server {
+
+LockFreeMessageQueue::LockFreeMessageQueue(int64_t capacity)
+    : MessageQueue(capacity),
+      num_slots_(std::max<int64_t>(capacity, 1)),
+      slots_(std::make_unique<Slot[]>(num_slots_)) {
+  for (int64_t i = 0; i < num_slots_; ++i) {
+    slots_[i].sequence.store(i, std::memory_order_relaxed);
+  }
+}
+
+int64_t LockFreeMessageQueue::ClaimPushSlots(int64_t max_messages,
+                                             int64_t& num_claimed) {
+  int64_t position = push_position_.load(std::memory_order_relaxed);
+  while (true) {
+    num_claimed = 0;
+    while (num_claimed < max_messages &&
+           SlotAt(position + num_claimed)
+                   .sequence.load(std::memory_order_acquire) ==
+               position + num_claimed) {
+      ++num_claimed;
+    }
+    if (num_claimed > 0) {
+      // Free slots stay free until the push position moves past them, so
+      // they are ours if the push position did not move.
+      if (push_position_.compare_exchange_weak(position,
+                                               position + num_claimed,
+                                               std::memory_order_relaxed)) {
+        return position;
+      }
+      continue;
+    }
+    if (SlotAt(position).sequence.load(std::memory_order_acquire) <
+        position) {
+      // The slot still holds the message pushed one lap before.
+      return position;
+    }
+    position = push_position_.load(std::memory_order_relaxed);
+  }
+}
+
+int64_t LockFreeMessageQueue::ClaimPopSlots(int64_t max_messages,
+                                            int64_t& num_claimed) {
+  int64_t position = pop_position_.load(std::memory_order_relaxed);
+  while (true) {
+    num_claimed = 0;
+    while (num_claimed < max_messages &&
+           SlotAt(position + num_claimed)
+                   .sequence.load(std::memory_order_acquire) ==
+               position + num_claimed + 1) {
+      ++num_claimed;
+    }
+    if (num_claimed > 0) {
+      if (pop_position_.compare_exchange_weak(position,
+                                              position + num_claimed,
+                                              std::memory_order_relaxed)) {
+        return position;
+      }
+      continue;
+    }
+    if (SlotAt(position).sequence.load(std::memory_order_acquire) <
+        position + 1) {
+      // No message was pushed to the slot yet.
+      return position;
+    }
+    position = pop_position_.load(std::memory_order_relaxed);
+  }
+}
+
+void LockFreeMessageQueue::Push(std::string message) {
+  int64_t num_claimed;
+  const int64_t position = ClaimPushSlots(1, num_claimed);
+  if (num_claimed == 0) {
+    return;
+  }
+  Slot& slot = SlotAt(position);
+  slot.message = std::move(message);
+  slot.sequence.store(position + 1, std::memory_order_release);
+}
+
+void LockFreeMessageQueue::Push(std::vector<std::string> messages) {
+  int64_t num_pushed = 0;
+  const int64_t num_messages = messages.size();
+  while (num_pushed < num_messages) {
+    int64_t num_claimed;
+    const int64_t position =
+        ClaimPushSlots(num_messages - num_pushed, num_claimed);
+    if (num_claimed == 0) {
+      return;
+    }
+    for (int64_t i = 0; i < num_claimed; ++i) {
+      Slot& slot = SlotAt(position + i);
+      slot.message = std::move(messages[num_pushed + i]);
+      slot.sequence.store(position + i + 1, std::memory_order_release);
+    }
+    num_pushed += num_claimed;
+  }
+}
+
+absl::StatusOr<std::string> LockFreeMessageQueue::Pop() {
+  int64_t num_claimed;
+  const int64_t position = ClaimPopSlots(1, num_claimed);
+  if (num_claimed == 0) {
+    return absl::FailedPreconditionError("Queue is empty");
+  }
+  Slot& slot = SlotAt(position);
+  std::string message = std::move(slot.message);
+  slot.sequence.store(position + num_slots_, std::memory_order_release);
+  return message;
+}
+
+std::vector<std::string> LockFreeMessageQueue::PopBatch(int64_t max_messages) {
+  std::vector<std::string> messages;
+  if (max_messages <= 0) {
+    return messages;
+  }
+  int64_t num_claimed;
+  const int64_t position = ClaimPopSlots(max_messages, num_claimed);
+  messages.reserve(num_claimed);
+  for (int64_t i = 0; i < num_claimed; ++i) {
+    Slot& slot = SlotAt(position + i);
+    messages.push_back(std::move(slot.message));
+    slot.sequence.store(position + i + num_slots_, std::memory_order_release);
+  }
+  return messages;
+}
+
+bool LockFreeMessageQueue::Empty() const { return Size() == 0; }
+
+size_t LockFreeMessageQueue::Size() const {
+  const int64_t pop_position = pop_position_.load(std::memory_order_relaxed);
+  const int64_t push_position = push_position_.load(std::memory_order_relaxed);
+  return std::max<int64_t>(push_position - pop_position, 0);
+}
+
+void LockFreeMessageQueue::Clear() {
+  while (!PopBatch(num_slots_).empty()) {
+  }
+}
+
+}  // namespace kv_server
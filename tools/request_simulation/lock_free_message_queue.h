@@ -0,0 +1,85 @@
+/*
+ * Copyright 2024 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TOOLS_REQUEST_SIMULATION_LOCK_FREE_MESSAGE_QUEUE_H_
+#define TOOLS_REQUEST_SIMULATION_LOCK_FREE_MESSAGE_QUEUE_H_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/status/statusor.h"
+#include "tools/request_simulation/message_queue.h"
+
+namespace kv_server {
+
+// Bounded lock-free multi-producer multi-consumer message queue, for when
+// client workers and request generators contend on the mutex of
+// `MessageQueue`. Messages are stored in a ring buffer of `capacity` slots
+// that is allocated upfront, each slot has a sequence number telling
+// producers and consumers whether it holds a message for them, see
+// https://www.1024cores.net/home/lock-free-algorithms/queues/bounded-mpmc-queue
+// Batches of messages are pushed and popped by claiming consecutive slots
+// at once. As with `MessageQueue`, messages pushed while the queue is full
+// are dropped.
+class LockFreeMessageQueue : public MessageQueue {
+ public:
+  explicit LockFreeMessageQueue(int64_t capacity);
+  void Push(std::string message) override;
+  void Push(std::vector<std::string> messages) override;
+  absl::StatusOr<std::string> Pop() override;
+  std::vector<std::string> PopBatch(int64_t max_messages) override;
+  bool Empty() const override;
+  // Returns the size of the queue, which is approximate while messages are
+  // pushed or popped concurrently
+  size_t Size() const override;
+  void Clear() override;
+  ~LockFreeMessageQueue() override = default;
+
+  // LockFreeMessageQueue is neither copyable nor movable.
+  LockFreeMessageQueue(const LockFreeMessageQueue&) = delete;
+  LockFreeMessageQueue& operator=(const LockFreeMessageQueue&) = delete;
+
+ private:
+  struct Slot {
+    // Equal to the slot's position when it is free to push to, and to the
+    // position plus one when it holds a message to pop.
+    std::atomic<int64_t> sequence;
+    std::string message;
+  };
+  // Claims up to `max_messages` consecutive slots for pushing, returns the
+  // position of the first one and sets `num_claimed`, which is 0 when the
+  // queue is full.
+  int64_t ClaimPushSlots(int64_t max_messages, int64_t& num_claimed);
+  // Claims up to `max_messages` consecutive slots for popping, returns the
+  // position of the first one and sets `num_claimed`, which is 0 when the
+  // queue is empty.
+  int64_t ClaimPopSlots(int64_t max_messages, int64_t& num_claimed);
+  Slot& SlotAt(int64_t position) { return slots_[position % num_slots_]; }
+
+  const int64_t num_slots_;
+  std::unique_ptr<Slot[]> slots_;
+  // Next positions to push to and to pop from, on their own cache lines so
+  // that producers and consumers do not contend on them.
+  alignas(64) std::atomic<int64_t> push_position_{0};
+  alignas(64) std::atomic<int64_t> pop_position_{0};
+};
+
+}  // namespace kv_server
+
+#endif  // TOOLS_REQUEST_SIMULATION_LOCK_FREE_MESSAGE_QUEUE_H_
@@ -0,0 +1,122 @@
+// Copyright 2024 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tools/request_simulation/lock_free_message_queue.h"
+
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "gtest/gtest.h"
+
+namespace kv_server {
+namespace {
+
+TEST(TestLockFreeMessageQueue, TestQueueOperation) {
+  LockFreeMessageQueue queue(100);
+  queue.Push("first");
+  queue.Push("second");
+  EXPECT_EQ(queue.Size(), 2);
+  auto pop = queue.Pop();
+  EXPECT_TRUE(pop.ok());
+  EXPECT_EQ(pop.value(), "first");
+  EXPECT_EQ(queue.Size(), 1);
+  EXPECT_FALSE(queue.Empty());
+  pop = queue.Pop();
+  EXPECT_TRUE(pop.ok());
+  EXPECT_EQ(pop.value(), "second");
+  EXPECT_TRUE(queue.Empty());
+  pop = queue.Pop();
+  EXPECT_FALSE(pop.ok());
+}
+
+TEST(TestLockFreeMessageQueue, TestCapacityConstraint) {
+  LockFreeMessageQueue queue(2);
+  queue.Push(std::vector<std::string>{"first", "second", "third"});
+  EXPECT_EQ(queue.Size(), 2);
+  queue.Push("fourth");
+  EXPECT_EQ(queue.Size(), 2);
+  EXPECT_EQ(queue.Pop().value(), "first");
+  // Pushes wrap around the ring buffer.
+  queue.Push("fifth");
+  EXPECT_EQ(queue.PopBatch(10),
+            (std::vector<std::string>{"second", "fifth"}));
+}
+
+TEST(TestLockFreeMessageQueue, TestBatchOperation) {
+  LockFreeMessageQueue queue(5);
+  for (int i = 0; i < 3; ++i) {
+    queue.Push(std::vector<std::string>{"first", "second", "third"});
+    EXPECT_EQ(queue.PopBatch(2),
+              (std::vector<std::string>{"first", "second"}));
+    EXPECT_EQ(queue.PopBatch(2), std::vector<std::string>{"third"});
+    EXPECT_TRUE(queue.PopBatch(2).empty());
+  }
+  queue.Push(std::vector<std::string>{"first", "second"});
+  queue.Clear();
+  EXPECT_TRUE(queue.Empty());
+}
+
+TEST(TestLockFreeMessageQueue, TestConcurrentProducersAndConsumers) {
+  constexpr int kNumThreads = 4;
+  constexpr int kNumMessagesPerProducer = 1000;
+  LockFreeMessageQueue queue(64);
+  std::atomic<int> num_popped = 0;
+  std::vector<std::vector<std::string>> popped(kNumThreads);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kNumThreads; ++i) {
+    threads.emplace_back([&queue, i]() {
+      int num_pushed = 0;
+      while (num_pushed < kNumMessagesPerProducer) {
+        // Only pushes what fits, so that no message is dropped.
+        if (queue.Size() < 32) {
+          queue.Push(std::vector<std::string>{
+              absl::StrCat(i, "_", num_pushed),
+              absl::StrCat(i, "_", num_pushed + 1)});
+          num_pushed += 2;
+        }
+      }
+    });
+    threads.emplace_back([&queue, &num_popped, &popped, i]() {
+      while (num_popped < kNumThreads * kNumMessagesPerProducer) {
+        for (auto& message : queue.PopBatch(3)) {
+          popped[i].push_back(std::move(message));
+          ++num_popped;
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  std::vector<std::string> all_popped;
+  for (const auto& messages : popped) {
+    all_popped.insert(all_popped.end(), messages.begin(), messages.end());
+  }
+  std::vector<std::string> expected;
+  for (int i = 0; i < kNumThreads; ++i) {
+    for (int j = 0; j < kNumMessagesPerProducer; ++j) {
+      expected.push_back(absl::StrCat(i, "_", j));
+    }
+  }
+  std::sort(all_popped.begin(), all_popped.end());
+  std::sort(expected.begin(), expected.end());
+  EXPECT_EQ(all_popped, expected);
+}
+
+}  // namespace
+}  // namespace kv_server
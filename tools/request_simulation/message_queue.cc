@@ -45,6 +45,17 @@ absl::StatusOr<std::string> MessageQueue::Pop() {
   return front;
 }
 
+std::vector<std::string> MessageQueue::PopBatch(int64_t max_messages) {
+  absl::MutexLock lock(&mutex_);
+  std::vector<std::string> messages;
+  while (!queue_.empty() &&
+         static_cast<int64_t>(messages.size()) < max_messages) {
+    messages.push_back(std::move(queue_.front()));
+    queue_.pop_front();
+  }
+  return messages;
+}
+
 bool MessageQueue::Empty() const {
   absl::MutexLock lock(&mutex_);
   return queue_.empty();
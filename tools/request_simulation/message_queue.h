@@ -32,18 +32,20 @@ class MessageQueue {
  public:
   explicit MessageQueue(int64_t capacity) : capacity_(capacity) {}
   // Pushes new message to the queue
-  void Push(std::string message);
+  virtual void Push(std::string message);
   // Pushes new messages to the queue
-  void Push(std::vector<std::string> messages);
+  virtual void Push(std::vector<std::string> messages);
   // Pops off message from the queue
-  absl::StatusOr<std::string> Pop();
+  virtual absl::StatusOr<std::string> Pop();
+  // Pops off up to max_messages messages from the queue
+  virtual std::vector<std::string> PopBatch(int64_t max_messages);
   // Checks if the queue is empty
-  bool Empty() const;
+  virtual bool Empty() const;
   // Returns the size of the queue
-  size_t Size() const;
+  virtual size_t Size() const;
   // Clears the queue
-  void Clear();
-  ~MessageQueue() = default;
+  virtual void Clear();
+  virtual ~MessageQueue() = default;
 
   // MessageQueue is neither copyable nor movable.
   MessageQueue(const MessageQueue&) = delete;
@@ -49,5 +49,13 @@ TEST(TestMessageQueue, TestCapacityConstraint) {
   EXPECT_EQ(pop.value(), "first");
 }
 
+TEST(TestMessageQueue, TestPopBatch) {
+  MessageQueue queue(100);
+  queue.Push(std::vector<std::string>{"first", "second", "third"});
+  EXPECT_EQ(queue.PopBatch(2), (std::vector<std::string>{"first", "second"}));
+  EXPECT_EQ(queue.PopBatch(2), std::vector<std::string>{"third"});
+  EXPECT_TRUE(queue.PopBatch(2).empty());
+}
+
 }  // namespace
 }  // namespace kv_server
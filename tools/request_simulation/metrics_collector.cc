@@ -26,6 +26,9 @@ namespace kv_server {
 constexpr char* kP50GrpcLatency = "P50GrpcLatency";
 constexpr char* kP90GrpcLatency = "P90GrpcLatency";
 constexpr char* kP99GrpcLatency = "P99GrpcLatency";
+constexpr char* kP50CorrectedGrpcLatency = "P50CorrectedGrpcLatency";
+constexpr char* kP90CorrectedGrpcLatency = "P90CorrectedGrpcLatency";
+constexpr char* kP99CorrectedGrpcLatency = "P99CorrectedGrpcLatency";
 constexpr char* kEstimatedQPS = "EstimatedQPS";
 constexpr char* kRequestsSent = "RequestsSent";
 constexpr char* KServerResponseStatus = "ServerResponseStatus";
@@ -46,6 +49,8 @@ MetricsCollector::MetricsCollector(
       sleep_for_(std::move(sleep_for)) {
   histogram_per_interval_ = grpc_histogram_create(kDefaultHistogramResolution,
                                                   kDefaultHistogramMaxBucket);
+  corrected_histogram_per_interval_ = grpc_histogram_create(
+      kDefaultHistogramResolution, kDefaultHistogramMaxBucket);
   metrics_recorder_.RegisterHistogram(kRequestsSent, "Requests sent", "");
   metrics_recorder_.RegisterHistogram(kEstimatedQPS, "Estimated QPS", "");
   metrics_recorder_.RegisterHistogram(kP50GrpcLatency, "P50 Latency",
@@ -54,6 +59,15 @@ MetricsCollector::MetricsCollector(
                                       "microsecond");
   metrics_recorder_.RegisterHistogram(kP99GrpcLatency, "P99 Latency",
                                       "microsecond");
+  metrics_recorder_.RegisterHistogram(
+      kP50CorrectedGrpcLatency, "P50 Latency from intended send time",
+      "microsecond");
+  metrics_recorder_.RegisterHistogram(
+      kP90CorrectedGrpcLatency, "P90 Latency from intended send time",
+      "microsecond");
+  metrics_recorder_.RegisterHistogram(
+      kP99CorrectedGrpcLatency, "P99 Latency from intended send time",
+      "microsecond");
 }
 
 void MetricsCollector::AddLatencyToHistogram(absl::Duration latency) {
@@ -67,6 +81,23 @@ absl::Duration MetricsCollector::GetPercentileLatency(double percentile) {
       grpc_histogram_percentile(histogram_per_interval_, percentile));
 }
 
+void MetricsCollector::AddCorrectedLatencyToHistogram(absl::Duration latency) {
+  absl::MutexLock lock(&mutex_);
+  grpc_histogram_add(corrected_histogram_per_interval_,
+                     absl::ToDoubleMicroseconds(latency));
+}
+absl::Duration MetricsCollector::GetPercentileCorrectedLatency(
+    double percentile) {
+  absl::MutexLock lock(&mutex_);
+  return absl::Microseconds(grpc_histogram_percentile(
+      corrected_histogram_per_interval_, percentile));
+}
+
+bool MetricsCollector::HasCorrectedLatencies() {
+  absl::MutexLock lock(&mutex_);
+  return grpc_histogram_count(corrected_histogram_per_interval_) > 0;
+}
+
 void MetricsCollector::IncrementRequestsWithOkResponsePerInterval() {
   requests_with_ok_response_per_interval_.fetch_add(1,
                                                     std::memory_order_relaxed);
@@ -116,6 +147,26 @@ void MetricsCollector::PublishMetrics() {
     LOG(INFO) << "P50 latency " << p50_latency;
     LOG(INFO) << "P90 latency " << p90_latency;
     LOG(INFO) << "P99 latency " << p99_latency;
+    if (HasCorrectedLatencies()) {
+      auto p50_corrected_latency = GetPercentileCorrectedLatency(0.5);
+      auto p90_corrected_latency = GetPercentileCorrectedLatency(0.9);
+      auto p99_corrected_latency = GetPercentileCorrectedLatency(0.99);
+      metrics_recorder_.RecordHistogramEvent(
+          kP50CorrectedGrpcLatency,
+          absl::ToInt64Microseconds(p50_corrected_latency));
+      metrics_recorder_.RecordHistogramEvent(
+          kP90CorrectedGrpcLatency,
+          absl::ToInt64Microseconds(p90_corrected_latency));
+      metrics_recorder_.RecordHistogramEvent(
+          kP99CorrectedGrpcLatency,
+          absl::ToInt64Microseconds(p99_corrected_latency));
+      LOG(INFO) << "P50 latency from intended send time "
+                << p50_corrected_latency;
+      LOG(INFO) << "P90 latency from intended send time "
+                << p90_corrected_latency;
+      LOG(INFO) << "P99 latency from intended send time "
+                << p99_corrected_latency;
+    }
     ResetHistogram();
     ResetRequestsPerInterval();
   }
@@ -133,6 +184,11 @@ void MetricsCollector::ResetHistogram() {
   }
   histogram_per_interval_ = grpc_histogram_create(kDefaultHistogramResolution,
                                                   kDefaultHistogramMaxBucket);
+  if (corrected_histogram_per_interval_) {
+    grpc_histogram_destroy(corrected_histogram_per_interval_);
+  }
+  corrected_histogram_per_interval_ = grpc_histogram_create(
+      kDefaultHistogramResolution, kDefaultHistogramMaxBucket);
 }
 
 int64_t MetricsCollector::GetQPS() {
@@ -46,6 +46,13 @@ class MetricsCollector {
   virtual void AddLatencyToHistogram(absl::Duration latency);
   // Gets percentile latency from histogram
   virtual absl::Duration GetPercentileLatency(double percentile);
+  // Adds latency data point measured from the intended send time of the
+  // request to the corrected latency histogram. Open-loop client workers
+  // record these so that the time requests wait behind a slow server is not
+  // omitted from the latency percentiles (coordinated omission).
+  virtual void AddCorrectedLatencyToHistogram(absl::Duration latency);
+  // Gets percentile latency from the corrected latency histogram
+  virtual absl::Duration GetPercentileCorrectedLatency(double percentile);
   // Starts the metrics collector
   virtual absl::Status Start();
   // Stops the metrics collector
@@ -53,6 +60,7 @@ class MetricsCollector {
 
   virtual ~MetricsCollector() {
     grpc_histogram_destroy(histogram_per_interval_);
+    grpc_histogram_destroy(corrected_histogram_per_interval_);
   }
 
   // MetricsReporter is neither copyable nor movable.
@@ -69,6 +77,9 @@ class MetricsCollector {
   // Resets histogram for the current interval to have a fresh
   // start for collecting latency data points for the next interval
   void ResetHistogram();
+  // Whether latencies were added to the corrected latency histogram in the
+  // current interval, i.e., whether requests were sent open-loop
+  bool HasCorrectedLatencies();
   // Gets estimated query per seconds, which is the
   // number of requests with ok response divided by report interval in seconds
   int64_t GetQPS();
@@ -81,6 +92,7 @@ class MetricsCollector {
   privacy_sandbox::server_common::MetricsRecorder& metrics_recorder_;
   std::unique_ptr<SleepFor> sleep_for_;
   grpc_histogram* histogram_per_interval_ ABSL_GUARDED_BY(mutex_);
+  grpc_histogram* corrected_histogram_per_interval_ ABSL_GUARDED_BY(mutex_);
   friend class MetricsCollectorPeer;
 };
 
@@ -97,5 +97,19 @@ TEST_F(MetricsCollectorTest, TestCollectMetrics) {
             10);
 }
 
+TEST_F(MetricsCollectorTest, TestCorrectedLatencies) {
+  for (int i = 1; i <= 100; i++) {
+    metrics_collector_->AddLatencyToHistogram(absl::Milliseconds(1));
+    metrics_collector_->AddCorrectedLatencyToHistogram(absl::Milliseconds(i));
+  }
+  EXPECT_LT(metrics_collector_->GetPercentileLatency(0.99),
+            absl::Milliseconds(2));
+  EXPECT_GT(metrics_collector_->GetPercentileCorrectedLatency(0.99),
+            absl::Milliseconds(90));
+  MetricsCollectorPeer::ResetStats(*metrics_collector_);
+  EXPECT_EQ(metrics_collector_->GetPercentileCorrectedLatency(0.99),
+            absl::ZeroDuration());
+}
+
 }  // namespace
 }  // namespace kv_server
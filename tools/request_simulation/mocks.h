@@ -44,6 +44,12 @@ class MockMetricsCollector : public MetricsCollector {
   MOCK_METHOD(absl::Duration, GetPercentileLatency, (double percentile),
               (override));
 
+  MOCK_METHOD(void, AddCorrectedLatencyToHistogram, (absl::Duration latency),
+              (override));
+
+  MOCK_METHOD(absl::Duration, GetPercentileCorrectedLatency,
+              (double percentile), (override));
+
   MOCK_METHOD(absl::Status, Start, (), (override));
 
   MOCK_METHOD(absl::Status, Stop, (), (override));
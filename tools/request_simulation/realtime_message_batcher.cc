@@ -16,18 +16,27 @@
 
 #include "tools/request_simulation/realtime_message_batcher.h"
 
-#include <fstream>
+#include <algorithm>
 #include <utility>
 
 #include "absl/log/check.h"
-#include "absl/strings/substitute.h"
+#include "absl/log/log.h"
+#include "absl/strings/escaping.h"
+#include "absl/strings/str_cat.h"
+#include "public/data_loading/writers/delta_record_stream_writer.h"
+#include "riegeli/bytes/string_writer.h"
+#include "riegeli/records/record_writer.h"
 #include "src/util/status_macro/status_macros.h"
 
 namespace kv_server {
 namespace {
+// Bounds how many records are buffered for one message when the previous
+// messages compressed very well.
+constexpr double kMaxCompressionRatio = 10;
+
 DeltaRecordWriter::Options GetOptions(int num_shards, int shard_num) {
   DeltaRecordWriter::Options options;
-  options.enable_compression = false;
+  options.enable_compression = true;
   if (num_shards > 1) {
     KVFileMetadata file_metadata;
     ShardingMetadata sharding_metadata;
@@ -37,66 +46,102 @@ DeltaRecordWriter::Options GetOptions(int num_shards, int shard_num) {
   }
   return options;
 }
-}  // namespace
-
-RealtimeMessageBatcher::FileHandler::FileHandler(std::string file_name,
-                                                 int file_descriptor)
-    : file_name(file_name), file_descriptor_(file_descriptor) {}
 
-RealtimeMessageBatcher::FileHandler::~FileHandler() {
-  // Close and unlink, which will delete the tmp file.
-  unlink(file_name.c_str());
-  close(file_descriptor_);
-}
-
-absl::StatusOr<std::unique_ptr<RealtimeMessageBatcher::FileHandler>>
-RealtimeMessageBatcher::FileHandler::Create() {
-  char file_name_template[16] = "/tmp/fileXXXXXX";
-  auto file_descriptor = mkstemp(file_name_template);
-  if (file_descriptor == -1) {
-    return absl::InternalError("Failed creating a temporary file.");
-  }
-  return std::make_unique<RealtimeMessageBatcher::FileHandler>(
-      std::string(file_name_template), file_descriptor);
+// Number of bytes that base64 encodes in `encoded_size` bytes.
+int64_t GetBase64DecodedSize(int64_t encoded_size) {
+  return encoded_size / 4 * 3;
 }
+}  // namespace
 
 RealtimeMessageBatcher::RealtimeMessageBatcher(
-    std::vector<DeltaRecordLimitingFileWriterWrapper> writer_wrappers,
     std::queue<RealtimeMessage>& realtime_messages, absl::Mutex& queue_mutex,
     int num_shards, int message_size_kb)
-    : writer_wrappers_(std::move(writer_wrappers)),
+    : mutex_(queue_mutex),
       realtime_messages_(realtime_messages),
-      mutex_(queue_mutex),
-      num_shards_(num_shards),
-      message_size_kb_(message_size_kb),
+      shard_records_(num_shards),
       key_sharder_(
-          kv_server::KeySharder(kv_server::ShardingFunction{/*seed=*/""})) {}
+          kv_server::KeySharder(kv_server::ShardingFunction{/*seed=*/""})),
+      num_shards_(num_shards),
+      message_size_kb_(message_size_kb) {}
 
-DeltaRecordLimitingFileWriter& RealtimeMessageBatcher::GetWriter(
-    int shard_num) const {
-  CHECK(shard_num >= 0) << "shard_num must be >= 0";
-  CHECK(shard_num < num_shards_) << "shard_num must be < num_shards_";
-  if (num_shards_ > 1) {
-    return *(writer_wrappers_[shard_num].file_writer);
-  } else {
-    return *(writer_wrappers_[0].file_writer);
-  }
+int64_t RealtimeMessageBatcher::GetRecordBytesPerMessage(int shard_num) const {
+  return GetBase64DecodedSize(message_size_kb_ * 1024) *
+         shard_records_[shard_num].compression_ratio;
 }
 
-RealtimeMessage RealtimeMessageBatcher::GetMessage(int shard_num) const {
-  auto file_stream =
-      std::ifstream(writer_wrappers_[shard_num].file_handler->file_name);
+absl::StatusOr<RealtimeMessage> RealtimeMessageBatcher::GetMessage(
+    int shard_num, absl::Span<const std::string> records) const {
+  std::string delta;
+  riegeli::RecordWriter writer(
+      riegeli::StringWriter(&delta),
+      GetRecordWriterOptions(GetOptions(num_shards_, shard_num)));
+  for (const std::string& record : records) {
+    if (!writer.WriteRecord(record)) {
+      break;
+    }
+  }
+  if (!writer.Close()) {
+    return writer.status();
+  }
   std::optional<int> shard_num_opt = std::nullopt;
   if (num_shards_ > 1) {
     shard_num_opt = shard_num;
   }
-  RealtimeMessage rm{
-      .message = absl::Base64Escape(
-          std::string(std::istreambuf_iterator<char>(file_stream),
-                      std::istreambuf_iterator<char>())),
+  return RealtimeMessage{
+      .message = absl::Base64Escape(delta),
       .shard_num = shard_num_opt,
   };
-  return rm;
+}
+
+absl::Status RealtimeMessageBatcher::PublishShard(int shard_num,
+                                                  bool allow_empty) {
+  CHECK(shard_num >= 0) << "shard_num must be >= 0";
+  CHECK(shard_num < num_shards_) << "shard_num must be < num_shards_";
+  ShardRecords& shard = shard_records_[shard_num];
+  if (shard.records.empty() && !allow_empty) {
+    return absl::OkStatus();
+  }
+  const std::vector<std::string> records = std::exchange(shard.records, {});
+  shard.num_bytes = 0;
+  const size_t max_message_size = message_size_kb_ * 1024;
+  absl::Span<const std::string> remaining = records;
+  absl::Status status = absl::OkStatus();
+  do {
+    size_t num_records = remaining.size();
+    PS_ASSIGN_OR_RETURN(RealtimeMessage message,
+                        GetMessage(shard_num, remaining));
+    // The records compressed worse than estimated, so put fewer of them in
+    // this message.
+    while (message.message.size() > max_message_size && num_records > 1) {
+      num_records /= 2;
+      PS_ASSIGN_OR_RETURN(message,
+                          GetMessage(shard_num, remaining.first(num_records)));
+    }
+    if (message.message.size() > max_message_size) {
+      status = absl::InvalidArgumentError(absl::StrCat(
+          "A record of ", remaining.front().size(),
+          " bytes does not fit in a realtime message of ", message_size_kb_,
+          " kb, dropping it."));
+      remaining.remove_prefix(num_records);
+      continue;
+    }
+    if (num_records > 0) {
+      int64_t num_bytes = 0;
+      for (const std::string& record : remaining.first(num_records)) {
+        num_bytes += record.size();
+      }
+      shard.compression_ratio = std::min(
+          kMaxCompressionRatio,
+          static_cast<double>(num_bytes) /
+              GetBase64DecodedSize(message.message.size()));
+    }
+    {
+      absl::MutexLock lock(&mutex_);
+      realtime_messages_.push(std::move(message));
+    }
+    remaining.remove_prefix(num_records);
+  } while (!remaining.empty());
+  return status;
 }
 
 absl::Status RealtimeMessageBatcher::Insert(
@@ -104,45 +149,29 @@ absl::Status RealtimeMessageBatcher::Insert(
   const int shard_num =
       key_sharder_.GetShardNumForKey(key_value_mutation.key, num_shards_)
           .shard_num;
-  auto data_record = DataRecordStruct{.record = std::move(key_value_mutation)};
-  auto write_result = GetWriter(shard_num).WriteRecord(data_record);
-  if (write_result.ok()) {
-    return absl::OkStatus();
-  }
-  if (!absl::IsResourceExhausted(write_result)) {
-    VLOG(5) << "Failed to write to the file. Did not hit the size limit.";
-    return write_result;
+  std::string record(ToStringView(ToFlatBufferBuilder(
+      DataRecordStruct{.record = std::move(key_value_mutation)})));
+  // This per shard queue would get over the `message_size_kb` limit.
+  // Batch all messages in realtime messages, tag them with a shard number, and
+  // insert them into `realtime_messages_`.
+  absl::Status status = absl::OkStatus();
+  if (const ShardRecords& pending = shard_records_[shard_num];
+      !pending.records.empty() &&
+      pending.num_bytes + record.size() > GetRecordBytesPerMessage(shard_num)) {
+    status = PublishShard(shard_num, /*allow_empty=*/false);
   }
-  // This per shard queue got over the `message_size_kb` limit.
-  // Batch all messages in a realtime message, tag it with a shard number, and
-  // insert it into `realtime_messages_`.
-  auto message = GetMessage(shard_num);
-  {
-    absl::MutexLock lock(&mutex_);
-    realtime_messages_.push(std::move(message));
-  }
-  // recreate the writer, and the underlying file, since the old one is
-  // exhausted.
-  writer_wrappers_[shard_num].file_writer->Close();
-  PS_ASSIGN_OR_RETURN(std::unique_ptr<FileHandler> file_handler,
-                      FileHandler::Create());
-  writer_wrappers_[shard_num].file_handler = std::move(file_handler);
-  PS_ASSIGN_OR_RETURN(
-      std::unique_ptr<kv_server::DeltaRecordLimitingFileWriter> record_writer,
-      kv_server::DeltaRecordLimitingFileWriter::Create(
-          writer_wrappers_[shard_num].file_handler->file_name,
-          GetOptions(num_shards_, shard_num), message_size_kb_ * 1024));
-  writer_wrappers_[shard_num].file_writer = std::move(record_writer);
-  return absl::OkStatus();
+  ShardRecords& pending = shard_records_[shard_num];
+  pending.num_bytes += record.size();
+  pending.records.push_back(std::move(record));
+  return status;
 }
 
 RealtimeMessageBatcher::~RealtimeMessageBatcher() {
   for (int i = 0; i < num_shards_; i++) {
-    writer_wrappers_[i].file_writer->Close();
-    auto message = GetMessage(i);
-    {
-      absl::MutexLock lock(&mutex_);
-      realtime_messages_.push(std::move(message));
+    if (absl::Status status = PublishShard(i, /*allow_empty=*/true);
+        !status.ok()) {
+      LOG(ERROR) << "Failed to publish the records of shard " << i << ": "
+                 << status;
     }
   }
 }
@@ -151,23 +180,12 @@ absl::StatusOr<std::unique_ptr<RealtimeMessageBatcher>>
 RealtimeMessageBatcher::Create(std::queue<RealtimeMessage>& realtime_messages,
                                absl::Mutex& queue_mutex, int num_shards,
                                int message_size_kb) {
-  std::vector<DeltaRecordLimitingFileWriterWrapper> writer_wrappers;
-  for (int i = 0; i < num_shards; i++) {
-    PS_ASSIGN_OR_RETURN(std::unique_ptr<FileHandler> file_handler,
-                        FileHandler::Create());
-    DeltaRecordLimitingFileWriterWrapper ww{.file_handler =
-                                                std::move(file_handler)};
-    PS_ASSIGN_OR_RETURN(
-        std::unique_ptr<kv_server::DeltaRecordLimitingFileWriter> record_writer,
-        kv_server::DeltaRecordLimitingFileWriter::Create(
-            ww.file_handler->file_name, GetOptions(num_shards, i),
-            message_size_kb * 1024));
-    ww.file_writer = std::move(record_writer);
-    writer_wrappers.push_back(std::move(ww));
+  if (num_shards < 1 || message_size_kb < 1) {
+    return absl::InvalidArgumentError(
+        "num_shards and message_size_kb must be positive.");
   }
-  return absl::WrapUnique(
-      new RealtimeMessageBatcher(std::move(writer_wrappers), realtime_messages,
-                                 queue_mutex, num_shards, message_size_kb));
+  return absl::WrapUnique(new RealtimeMessageBatcher(
+      realtime_messages, queue_mutex, num_shards, message_size_kb));
 }
 
 }  // namespace kv_server
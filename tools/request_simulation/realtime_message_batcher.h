@@ -22,8 +22,9 @@
 #include <string>
 #include <vector>
 
+#include "absl/types/span.h"
 #include "components/tools/concurrent_publishing_engine.h"
-#include "public/data_loading/writers/delta_record_limiting_file_writer.h"
+#include "public/data_loading/writers/delta_record_writer.h"
 #include "public/sharding/key_sharder.h"
 
 namespace kv_server {
@@ -32,10 +33,16 @@ namespace kv_server {
 // over the `message_size_kb` limit, RealtimeMessageBatcher batches all the
 // messages together in one realtime message, tags it with a shard number, and
 // inserts it into `realtime_messages_`.
+//
+// Messages are compressed, so how many records fit in one is estimated from
+// how well the previous message compressed. Messages that turn out larger
+// than `message_size_kb` once base64 encoded are split, so every message fits
+// the limit and no record is dropped.
 // Not thread safe.
 class RealtimeMessageBatcher {
  public:
   // Not thread safe.
+  // Returns an error if records inserted before had to be dropped.
   absl::Status Insert(
       kv_server::KeyValueMutationRecordStruct key_value_mutation);
   ~RealtimeMessageBatcher();
@@ -46,32 +53,34 @@ class RealtimeMessageBatcher {
       int num_shards, int message_size_kb);
 
  private:
-  class FileHandler {
-   public:
-    FileHandler(std::string file_name, int file_descriptor);
-    ~FileHandler();
-    const std::string file_name;
-    static absl::StatusOr<std::unique_ptr<FileHandler>> Create();
-
-   private:
-    const int file_descriptor_;
+  // Serialized records of one shard that are not in a message yet.
+  struct ShardRecords {
+    std::vector<std::string> records;
+    int64_t num_bytes = 0;
+    // Ratio of the size of serialized records to the size of the message
+    // they were encoded in, as of the last message of the shard.
+    double compression_ratio = 1.0;
   };
 
-  struct DeltaRecordLimitingFileWriterWrapper {
-    std::unique_ptr<FileHandler> file_handler;
-    std::unique_ptr<DeltaRecordLimitingFileWriter> file_writer;
-  };
+  RealtimeMessageBatcher(std::queue<RealtimeMessage>& realtime_messages,
+                         absl::Mutex& queue_mutex, int num_shards,
+                         int message_size_kb);
 
-  RealtimeMessageBatcher(
-      std::vector<DeltaRecordLimitingFileWriterWrapper> writer_wrappers,
-      std::queue<RealtimeMessage>& realtime_messages, absl::Mutex& queue_mutex,
-      int num_shards, int message_size_kb);
+  // Number of bytes of serialized records of `shard_num` expected to fit in
+  // one message.
+  int64_t GetRecordBytesPerMessage(int shard_num) const;
+  // Encodes `records` of `shard_num` in one message.
+  absl::StatusOr<RealtimeMessage> GetMessage(
+      int shard_num, absl::Span<const std::string> records) const;
+  // Puts the pending records of `shard_num` in as many messages as needed.
+  // Puts one empty message if there are none and `allow_empty` is true.
+  // Drops records that do not fit in a message on their own, and returns an
+  // error for them.
+  absl::Status PublishShard(int shard_num, bool allow_empty);
 
-  DeltaRecordLimitingFileWriter& GetWriter(int shard_num) const;
-  RealtimeMessage GetMessage(int shard_num) const;
   absl::Mutex& mutex_;
   std::queue<RealtimeMessage>& realtime_messages_ ABSL_GUARDED_BY(mutex_);
-  std::vector<DeltaRecordLimitingFileWriterWrapper> writer_wrappers_;
+  std::vector<ShardRecords> shard_records_;
   const kv_server::KeySharder key_sharder_;
 
   const int num_shards_;
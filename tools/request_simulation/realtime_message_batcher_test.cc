@@ -179,5 +179,65 @@ TEST(RealtimeMessageBatcher,
   }
 }
 
+TEST(RealtimeMessageBatcher,
+     CompressedMessagesFitTheLimitWithoutLosingRecords) {
+  std::queue<RealtimeMessage> realtime_messages;
+  int rows_number = 5000;
+  int num_shards = 1;
+  ASSERT_NO_FATAL_FAILURE(Write(realtime_messages, rows_number, num_shards));
+  // Uncompressed, the records would need more than 30 messages of 10 kb.
+  EXPECT_LT(realtime_messages.size(), 15);
+  int total_rows = 0;
+  while (!realtime_messages.empty()) {
+    auto message = realtime_messages.front();
+    realtime_messages.pop();
+    EXPECT_LE(message.message.size(), 10 * 1024);
+    auto maybe_delta_rows = Convert(message);
+    ASSERT_TRUE(maybe_delta_rows.ok());
+    total_rows += maybe_delta_rows->size();
+  }
+  EXPECT_EQ(total_rows, rows_number);
+}
+
+TEST(RealtimeMessageBatcher, DropsRecordsLargerThanAMessage) {
+  std::queue<RealtimeMessage> realtime_messages;
+  absl::Mutex mutex;
+  {
+    auto batcher = RealtimeMessageBatcher::Create(realtime_messages, mutex,
+                                                  /*num_shards=*/1,
+                                                  /*message_size_kb=*/1);
+    ASSERT_TRUE(batcher.ok());
+    // Values that do not compress well.
+    std::string large_value;
+    for (int i = 0; i < 2048; i++) {
+      large_value += absl::StrCat(i * 7919 % 10007);
+    }
+    ASSERT_TRUE((*batcher)
+                    ->Insert({.mutation_type = KeyValueMutationType::Update,
+                              .logical_commit_time = 1,
+                              .key = "key1",
+                              .value = large_value})
+                    .ok());
+    // Each insert publishes, and drops, the large record before it.
+    EXPECT_FALSE((*batcher)
+                     ->Insert({.mutation_type = KeyValueMutationType::Update,
+                               .logical_commit_time = 2,
+                               .key = "key2",
+                               .value = large_value})
+                     .ok());
+    EXPECT_FALSE((*batcher)
+                     ->Insert({.mutation_type = KeyValueMutationType::Update,
+                               .logical_commit_time = 3,
+                               .key = "key3",
+                               .value = "value"})
+                     .ok());
+  }
+  ASSERT_EQ(realtime_messages.size(), 1);
+  auto delta_rows = Convert(realtime_messages.front());
+  ASSERT_TRUE(delta_rows.ok());
+  ASSERT_EQ(delta_rows->size(), 1);
+  EXPECT_EQ((*delta_rows)[0].logical_commit_time, 3);
+}
+
 }  // namespace
 }  // namespace kv_server
@@ -44,6 +44,11 @@ ABSL_FLAG(int, concurrency, 10,
           "Number of concurrent requests sent to the server,"
           "this number will be limited by the maximum concurrent threads"
           "supported by state of the machine");
+ABSL_FLAG(bool, open_loop, false,
+          "Whether client workers send requests open-loop, i.e., at the rps "
+          "rate regardless of outstanding responses, and report latencies from "
+          "the intended send time of requests in addition to the latencies "
+          "from their actual send time");
 ABSL_FLAG(absl::Duration, request_timeout, absl::Seconds(300),
           "The timeout duration for getting response for the request");
 ABSL_FLAG(int64_t, synthetic_requests_fill_qps, 1000,
@@ -52,6 +57,29 @@ ABSL_FLAG(int64_t, synthetic_requests_fill_qps, 1000,
 ABSL_FLAG(int, number_of_keys_per_request, 1,
           "The number of keys in one synthetic request");
 ABSL_FLAG(int, key_size, 20, "The size of the key in bytes");
+ABSL_FLAG(kv_server::KeyDistribution, key_distribution,
+          kv_server::KeyDistribution::kUniform,
+          "The distribution of the keys of synthetic requests: uniform, "
+          "zipfian, hotspot or trace_replay");
+ABSL_FLAG(int64_t, synthetic_key_space_size, 1000000,
+          "The number of distinct keys of synthetic requests, or the maximum "
+          "number of keys taken from delta files with "
+          "synthetic_keys_from_delta_files");
+ABSL_FLAG(bool, synthetic_keys_from_delta_files, false,
+          "Whether synthetic requests pick their keys from the keys of the "
+          "delta files read by the delta based request generator, in file "
+          "order of popularity, rather than from made-up keys");
+ABSL_FLAG(double, zipfian_exponent, 1.1,
+          "The exponent of the zipfian key distribution, greater than 1");
+ABSL_FLAG(double, hotspot_key_fraction, 0.2,
+          "The fraction of hot keys of the hotspot key distribution");
+ABSL_FLAG(double, hotspot_request_fraction, 0.8,
+          "The fraction of keys of synthetic requests that are hot keys for "
+          "the hotspot key distribution");
+ABSL_FLAG(std::string, key_trace_file, "",
+          "The file to replay the keys of synthetic requests from with the "
+          "trace_replay key distribution, one request per line with its keys "
+          "separated by commas");
 ABSL_FLAG(absl::Duration, client_worker_rate_limiter_acquire_timeout,
           absl::Milliseconds(10),
           "The client worker's timeout duration for acquiring permits from "
@@ -69,6 +97,11 @@ ABSL_FLAG(int, synthetic_requests_generator_rate_limiter_initial_permits, 1500,
           "generator when the rate limiter is created");
 ABSL_FLAG(int64_t, message_queue_max_capacity, 10000000,
           "The maximum number of messages held by the message queue");
+ABSL_FLAG(bool, lock_free_message_queue, false,
+          "Whether to stage requests in a lock-free ring buffer rather than a "
+          "mutex guarded queue, for high rps with many client workers. The "
+          "ring buffer allocates message_queue_max_capacity slots upfront, "
+          "so a smaller capacity is recommended with it");
 ABSL_FLAG(kv_server::GrpcAuthenticationMode, server_auth_mode,
           kv_server::GrpcAuthenticationMode::kSsl,
           "The server authentication mode");
@@ -156,17 +189,41 @@ absl::Status RequestSimulationSystem::Init(
       sleep_for_request_generator_rate_limiter == nullptr
           ? std::move(std::make_unique<SleepFor>())
           : std::move(sleep_for_request_generator_rate_limiter));
-  message_queue_ = absl::make_unique<MessageQueue>(
-      absl::GetFlag(FLAGS_message_queue_max_capacity));
+  if (absl::GetFlag(FLAGS_lock_free_message_queue)) {
+    message_queue_ = std::make_unique<LockFreeMessageQueue>(
+        absl::GetFlag(FLAGS_message_queue_max_capacity));
+  } else {
+    message_queue_ = std::make_unique<MessageQueue>(
+        absl::GetFlag(FLAGS_message_queue_max_capacity));
+  }
+  key_space_ =
+      absl::GetFlag(FLAGS_synthetic_keys_from_delta_files)
+          ? KeySpace::Create(absl::GetFlag(FLAGS_synthetic_key_space_size))
+          : KeySpace::CreateSynthetic(
+                absl::GetFlag(FLAGS_synthetic_key_space_size),
+                synthetic_request_gen_option_.key_size_in_bytes);
+  PS_ASSIGN_OR_RETURN(
+      key_generator_,
+      CreateKeyGenerator(
+          KeyGeneratorOptions{
+              .distribution = absl::GetFlag(FLAGS_key_distribution),
+              .zipfian_exponent = absl::GetFlag(FLAGS_zipfian_exponent),
+              .hotspot_key_fraction = absl::GetFlag(FLAGS_hotspot_key_fraction),
+              .hotspot_request_fraction =
+                  absl::GetFlag(FLAGS_hotspot_request_fraction),
+              .trace_file = absl::GetFlag(FLAGS_key_trace_file),
+          },
+          *key_space_));
   synthetic_request_generator_ = std::make_unique<SyntheticRequestGenerator>(
       *message_queue_, *synthetic_request_generator_rate_limiter_,
       sleep_for_request_generator == nullptr
           ? std::move(std::make_unique<SleepFor>())
           : std::move(sleep_for_request_generator),
-      synthetic_requests_fill_qps_, [this]() {
-        const auto keys = kv_server::GenerateRandomKeys(
-            synthetic_request_gen_option_.number_of_keys_per_request,
-            synthetic_request_gen_option_.key_size_in_bytes);
+      synthetic_requests_fill_qps_, [this]() -> absl::StatusOr<std::string> {
+        PS_ASSIGN_OR_RETURN(
+            const auto keys,
+            key_generator_->GenerateKeys(
+                synthetic_request_gen_option_.number_of_keys_per_request));
         return kv_server::CreateKVDSPRequestBodyInJson(keys);
       });
 
@@ -224,7 +281,10 @@ absl::Status RequestSimulationSystem::Init(
           .blob_client = *blob_storage_client_,
           .delta_notifier = *delta_file_notifier_,
           .change_notifier = *blob_change_notifier_,
-          .delta_stream_reader_factory = *delta_stream_reader_factory_},
+          .delta_stream_reader_factory = *delta_stream_reader_factory_,
+          .key_space = absl::GetFlag(FLAGS_synthetic_keys_from_delta_files)
+                           ? key_space_.get()
+                           : nullptr},
       CreateRequestFromKeyFn(), metrics_recorder_);
   PS_ASSIGN_OR_RETURN(realtime_message_batcher_,
                       RealtimeMessageBatcher::Create(
@@ -286,7 +346,17 @@ absl::Status RequestSimulationSystem::InitializeGrpcClientWorkers() {
         "check grpc connection in start up", LogMetricsNoOpCallback());
   }
   auto request_timeout = absl::GetFlag(FLAGS_request_timeout);
+  const bool open_loop = absl::GetFlag(FLAGS_open_loop);
+  const int64_t rps = absl::GetFlag(FLAGS_rps);
+  if (open_loop && rps < num_of_workers) {
+    num_of_workers = std::max<int64_t>(rps, 1);
+  }
   for (int i = 0; i < num_of_workers; ++i) {
+    // In open-loop mode the workers split the rps between their timelines.
+    int64_t open_loop_rps = 0;
+    if (open_loop) {
+      open_loop_rps = rps / num_of_workers + (i < rps % num_of_workers ? 1 : 0);
+    }
     auto request_converter = [](const std::string& request_body) {
       RawRequest request;
       request.mutable_raw_body()->set_data(request_body);
@@ -296,7 +366,7 @@ absl::Status RequestSimulationSystem::InitializeGrpcClientWorkers() {
         std::make_unique<ClientWorker<RawRequest, google::api::HttpBody>>(
             i, channel, server_method_, request_timeout, request_converter,
             *message_queue_, *grpc_request_rate_limiter_, *metrics_collector_,
-            is_client_channel);
+            is_client_channel, open_loop_rps);
     grpc_client_workers_.push_back(std::move(worker));
   }
   return absl::OkStatus();
@@ -39,6 +39,8 @@
 #include "tools/request_simulation/client_worker.h"
 #include "tools/request_simulation/delta_based_request_generator.h"
 #include "tools/request_simulation/detla_based_realtime_updates_publisher.h"
+#include "tools/request_simulation/key_generator.h"
+#include "tools/request_simulation/lock_free_message_queue.h"
 #include "tools/request_simulation/message_queue.h"
 #include "tools/request_simulation/rate_limiter.h"
 #include "tools/request_simulation/request/raw_request.pb.h"
@@ -50,10 +52,14 @@ ABSL_DECLARE_FLAG(std::string, server_method);
 ABSL_DECLARE_FLAG(bool, is_client_channel);
 ABSL_DECLARE_FLAG(int64_t, rps);
 ABSL_DECLARE_FLAG(int, concurrency);
+ABSL_DECLARE_FLAG(bool, open_loop);
 ABSL_DECLARE_FLAG(absl::Duration, request_timeout);
 ABSL_DECLARE_FLAG(int64_t, synthetic_requests_fill_qps);
 ABSL_DECLARE_FLAG(int, number_of_keys_per_request);
 ABSL_DECLARE_FLAG(int, key_size);
+ABSL_DECLARE_FLAG(kv_server::KeyDistribution, key_distribution);
+ABSL_DECLARE_FLAG(int64_t, synthetic_key_space_size);
+ABSL_DECLARE_FLAG(bool, synthetic_keys_from_delta_files);
 ABSL_DECLARE_FLAG(absl::Duration, client_worker_rate_limiter_acquire_timeout);
 ABSL_DECLARE_FLAG(absl::Duration,
                   synthetic_requests_generator_rate_limiter_acquire_timeout);
@@ -61,6 +67,7 @@ ABSL_DECLARE_FLAG(int, client_worker_rate_limiter_initial_permits);
 ABSL_DECLARE_FLAG(int,
                   synthetic_requests_generator_rate_limiter_initial_permits);
 ABSL_DECLARE_FLAG(int64_t, message_queue_max_capacity);
+ABSL_DECLARE_FLAG(bool, lock_free_message_queue);
 ABSL_DECLARE_FLAG(kv_server::GrpcAuthenticationMode,
                   server_authentication_mode);
 ABSL_DECLARE_FLAG(std::string, delta_file_bucket);
@@ -69,12 +76,14 @@ namespace kv_server {
 // The request simulation system has the following key components:
 // 1. A message queue that staged the requests waiting to be sent.
 // 2. A synthetic request generator that generates made-up requests at given
-// rate.
+// rate, with keys of the key_distribution parameter that are made-up or taken
+// from delta files.
 // 3. A delta based request generator that reads keys from delta file and
 // generates requests from them
 // 4. Client workers that send requests to the target server.
 // The number of client workers is determined by the given concurrency
-// parameter.
+// parameter. With the open_loop parameter, the workers send requests on a
+// fixed timeline of the rps rate without waiting for responses.
 // 5. A delta based request generator that reads keys from delta file and
 // publishes realtime updates to the specified SNS/pubsub endpoint.
 //
@@ -148,6 +157,9 @@ class RequestSimulationSystem {
   int concurrent_number_of_requests_;
   int64_t synthetic_requests_fill_qps_;
   SyntheticRequestGenOption synthetic_request_gen_option_;
+  // Keys of synthetic requests and the generator picking them.
+  std::unique_ptr<KeySpace> key_space_;
+  std::unique_ptr<KeyGenerator> key_generator_;
   std::unique_ptr<BlobStorageClient> blob_storage_client_;
   std::unique_ptr<MessageService> message_service_blob_;
   std::unique_ptr<BlobStorageChangeNotifier> blob_change_notifier_;
@@ -37,7 +37,12 @@ void SyntheticRequestGenerator::GenerateRequests() {
     if (rate_limiter_.Acquire(number_of_requests).ok()) {
       std::vector<std::string> messages;
       for (int i = 0; i < number_of_requests; ++i) {
-        messages.push_back(std::move(request_body_generation_fn_()));
+        auto request_body = request_body_generation_fn_();
+        if (!request_body.ok()) {
+          VLOG(8) << "Failed to generate request " << request_body.status();
+          continue;
+        }
+        messages.push_back(std::move(*request_body));
       }
       VLOG(7) << "Filled " << number_of_requests;
       message_queue_.Push(std::move(messages));
@@ -43,7 +43,8 @@ class SyntheticRequestGenerator {
   SyntheticRequestGenerator(
       MessageQueue& message_queue, RateLimiter& rate_limiter,
       std::unique_ptr<SleepFor> sleep_for, int64_t requests_fill_qps,
-      absl::AnyInvocable<std::string()> request_body_generation_fn)
+      absl::AnyInvocable<absl::StatusOr<std::string>()>
+          request_body_generation_fn)
       : thread_manager_(ThreadManager::Create("Synthetic request generator")),
         message_queue_(message_queue),
         rate_limiter_(rate_limiter),
@@ -70,7 +71,10 @@ class SyntheticRequestGenerator {
   RateLimiter& rate_limiter_;
   std::unique_ptr<SleepFor> sleep_for_;
   int64_t requests_fill_qps_;
-  absl::AnyInvocable<std::string()> request_body_generation_fn_;
+  // Returns the body of the next request, requests whose body cannot be
+  // generated are skipped
+  absl::AnyInvocable<absl::StatusOr<std::string>()>
+      request_body_generation_fn_;
 };
 }  // namespace kv_server
 
@@ -23,6 +23,7 @@ def inline_wasm_udf_delta(
         custom_udf_js_handler = "HandleRequest",
         output_file_name = "DELTA_0000000000000005",
         logical_commit_time = None,
+        proto_udf_input = False,
         udf_tool = "//tools/udf/udf_generator:udf_delta_file_generator",
         tags = ["manual"]):
     """Generate a JS + inline WASM UDF delta file and put it under dist/ directory
@@ -53,6 +54,8 @@ def inline_wasm_udf_delta(
             Recommended to follow DELTA file naming convention.
             Defaults to `DELTA_0000000000000005`
         logical_commit_time: Logical commit timestamp for UDF config. Optional, defaults to now.
+        proto_udf_input: Whether the UDF takes its metadata and arguments as base64 strings of
+            serialized protos instead of JSON.
         udf_tool: build target for the udf_delta_file_generator.
             Defaults to `//tools/udf/udf_generator:udf_delta_file_generator`
         tags: tags to propagate to rules
@@ -79,6 +82,7 @@ def inline_wasm_udf_delta(
     )
 
     logical_commit_time_args = [] if logical_commit_time == None else ["--logical_commit_time", logical_commit_time]
+    proto_udf_input_args = ["--proto_udf_input"] if proto_udf_input else []
 
     run_binary(
         name = "{}_udf_delta".format(name),
@@ -95,7 +99,7 @@ def inline_wasm_udf_delta(
             "$(location {})".format(output_file_name),
             "--udf_handler_name",
             custom_udf_js_handler,
-        ] + logical_commit_time_args,
+        ] + logical_commit_time_args + proto_udf_input_args,
         tool = udf_tool,
         visibility = ["//visibility:private"],
         tags = tags,
@@ -128,6 +132,7 @@ def cc_inline_wasm_udf_delta(
         custom_udf_js_handler = "HandleRequest",
         output_file_name = "DELTA_0000000000000005",
         logical_commit_time = None,
+        proto_udf_input = False,
         udf_tool = "//tools/udf/udf_generator:udf_delta_file_generator",
         deps = [],
         tags = ["manual"],
@@ -167,6 +172,8 @@ def cc_inline_wasm_udf_delta(
             Recommended to follow DELTA file naming convention.
             Defaults to `DELTA_0000000000000005`
         logical_commit_time: Logical commit timestamp for UDF config.
+        proto_udf_input: Whether the UDF takes its metadata and arguments as base64 strings of
+            serialized protos instead of JSON.
         udf_tool: build target for the udf_delta_file_generator.
             Defaults to `//tools/udf/udf_generator:udf_delta_file_generator`
         tags: tags to propagate to rules
@@ -197,6 +204,7 @@ def cc_inline_wasm_udf_delta(
         custom_udf_js_handler = custom_udf_js_handler,
         output_file_name = output_file_name,
         logical_commit_time = logical_commit_time,
+        proto_udf_input = proto_udf_input,
         udf_tool = udf_tool,
         tags = tags,
     )
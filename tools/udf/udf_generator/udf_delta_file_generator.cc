@@ -43,6 +43,14 @@ ABSL_FLAG(std::string, output_path, "",
 ABSL_FLAG(int64_t, logical_commit_time, absl::ToUnixMicros(absl::Now()),
           "Record logical_commit_time. Default is current timestamp.");
 ABSL_FLAG(int64_t, code_snippet_version, 2, "UDF version. Default is 2.");
+ABSL_FLAG(bool, proto_udf_input, false,
+          "Whether the UDF takes its metadata and arguments as base64 strings "
+          "of serialized protos instead of JSON.");
+ABSL_FLAG(std::string, udf_batch_handler_name, "",
+          "UDF handler that executes a batch of requests at once. Optional.");
+ABSL_FLAG(int32_t, udf_canary_percent, 0,
+          "Percentage of requests, from 1 to 99, that run the UDF as a canary "
+          "of the UDF set before it. Zero runs it for every request.");
 ABSL_FLAG(std::string, data_loading_file_format,
           std::string(kv_server::kFileFormats[static_cast<int>(
               kv_server::FileFormat::kRiegeli)]),
@@ -58,6 +66,7 @@ using kv_server::ToDeltaFileName;
 using kv_server::ToFlatBufferBuilder;
 using kv_server::ToStringView;
 using kv_server::UserDefinedFunctionsConfigStruct;
+using kv_server::UserDefinedFunctionsInputFormat;
 using kv_server::UserDefinedFunctionsLanguage;
 
 absl::StatusOr<std::string> ReadCodeSnippetAsString(std::string udf_file_path) {
@@ -76,6 +85,8 @@ absl::Status WriteUdfConfig(std::ostream* output_stream) {
   }
   const std::string udf_file_path = absl::GetFlag(FLAGS_udf_file_path);
   const std::string udf_handler_name = absl::GetFlag(FLAGS_udf_handler_name);
+  const std::string batch_handler_name =
+      absl::GetFlag(FLAGS_udf_batch_handler_name);
   int64_t logical_commit_time = absl::GetFlag(FLAGS_logical_commit_time);
   int64_t version = absl::GetFlag(FLAGS_code_snippet_version);
   absl::StatusOr<std::string> code_snippet =
@@ -106,7 +117,12 @@ absl::Status WriteUdfConfig(std::ostream* output_stream) {
       .handler_name = std::move(udf_handler_name),
       .logical_commit_time = logical_commit_time,
       .version = version,
-      .language = UserDefinedFunctionsLanguage::Javascript};
+      .language = UserDefinedFunctionsLanguage::Javascript,
+      .input_format = absl::GetFlag(FLAGS_proto_udf_input)
+                          ? UserDefinedFunctionsInputFormat::Protobuf
+                          : UserDefinedFunctionsInputFormat::Json,
+      .batch_handler_name = batch_handler_name,
+      .canary_percent = absl::GetFlag(FLAGS_udf_canary_percent)};
   if (absl::Status status = delta_record_writer.value()->WriteRecord(
           DataRecordStruct{.record = std::move(udf_config)});
       !status.ok()) {
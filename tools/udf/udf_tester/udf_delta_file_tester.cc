@@ -21,7 +21,9 @@
 #include "components/data_server/cache/cache.h"
 #include "components/data_server/cache/key_value_cache.h"
 #include "components/internal_server/local_lookup.h"
+#include "components/udf/hooks/get_keys_containing_hook.h"
 #include "components/udf/hooks/get_values_hook.h"
+#include "components/udf/native_udf_registry.h"
 #include "components/udf/udf_client.h"
 #include "components/udf/udf_config_builder.h"
 #include "google/protobuf/util/json_util.h"
@@ -140,6 +142,8 @@ absl::Status TestUdf(const std::string& kv_delta_file_path,
   InitMetricsContextMap();
   LOG(INFO) << "Loading cache from delta file: " << kv_delta_file_path;
   std::unique_ptr<Cache> cache = KeyValueCache::Create();
+  PS_RETURN_IF_ERROR(cache->EnableSetValueIndex());
+  PS_RETURN_IF_ERROR(cache->EnableSortedKeyIndex());
   PS_RETURN_IF_ERROR(LoadCacheFromFile(kv_delta_file_path, *cache))
       << "Error loading cache from file";
 
@@ -159,14 +163,31 @@ absl::Status TestUdf(const std::string& kv_delta_file_path,
   binary_get_values_hook->FinishInit(CreateLocalLookup(*cache));
   auto run_query_hook = RunQueryHook::Create();
   run_query_hook->FinishInit(CreateLocalLookup(*cache));
+  auto binary_run_query_hook =
+      RunQueryHook::Create(RunQueryHook::OutputType::kBinary);
+  binary_run_query_hook->FinishInit(CreateLocalLookup(*cache));
+  auto uint32_run_query_hook =
+      RunQueryHook::Create(RunQueryHook::OutputType::kUInt32);
+  uint32_run_query_hook->FinishInit(CreateLocalLookup(*cache));
+  auto get_keys_containing_hook = GetKeysContainingHook::Create();
+  get_keys_containing_hook->FinishInit(CreateLocalLookup(*cache));
+  auto native_udfs = NativeUdfRegistry::Create();
+  native_udfs->FinishInit(CreateLocalLookup(*cache));
   absl::StatusOr<std::unique_ptr<UdfClient>> udf_client =
       UdfClient::Create(std::move(
           config_builder.RegisterStringGetValuesHook(*string_get_values_hook)
               .RegisterBinaryGetValuesHook(*binary_get_values_hook)
+              .RegisterGroupedGetValuesHook(*string_get_values_hook)
+              .RegisterPrefixGetValuesHook(*string_get_values_hook)
               .RegisterRunQueryHook(*run_query_hook)
+              .RegisterBinaryRunQueryHook(*binary_run_query_hook)
+              .RegisterUInt32RunQueryHook(*uint32_run_query_hook)
+              .RegisterGetKeysContainingHook(*get_keys_containing_hook)
               .RegisterLoggingFunction()
               .SetNumberOfWorkers(1)
-              .Config()));
+              .Config()),
+          absl::Seconds(5), /*udf_min_log_level=*/0,
+          /*warm_up_invocations=*/0, native_udfs.get());
   PS_RETURN_IF_ERROR(udf_client.status())
       << "Error starting UDF execution engine";
 